@@ -0,0 +1,106 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Sample program running independent estimations in several
+   threads at once. Each thread calls libgretl_thread_init() to get
+   its own interpreter context (user variables, settings, RNG
+   stream) and works on a dataset of its own.
+*/
+
+#include <gretl/libgretl.h>
+
+#define NTHREADS 4
+
+typedef struct job_ {
+    int id;       /* job number */
+    int err;      /* error code */
+    double b[2];  /* estimated coefficients */
+} job;
+
+static gpointer run_job (gpointer data)
+{
+    job *jb = data;
+    DATASET *dset;
+    MODEL *model;
+    PRN *prn;
+    int list[4] = {3, 1, 0, 2};
+
+    jb->err = libgretl_thread_init();
+    if (jb->err) {
+        return NULL;
+    }
+
+    /* a seed specific to this job, so the results are reproducible */
+    gretl_rand_set_seed(1000 + jb->id);
+
+    prn = gretl_print_new(GRETL_PRINT_BUFFER, NULL);
+    dset = create_new_dataset(1, 500, 0);
+
+    /* series 1 is y, series 2 is x */
+    generate("series y = 0", dset, GRETL_TYPE_SERIES, OPT_Q, prn);
+    generate("series x = normal()", dset, GRETL_TYPE_SERIES, OPT_Q, prn);
+    jb->err = generate("y = 1 + 2*x + normal()", dset,
+                       GRETL_TYPE_SERIES, OPT_Q, prn);
+
+    if (!jb->err) {
+        model = gretl_model_new();
+        *model = lsq(list, dset, OLS, OPT_NONE);
+        jb->err = model->errcode;
+        if (!jb->err) {
+            jb->b[0] = model->coeff[0];
+            jb->b[1] = model->coeff[1];
+        }
+        gretl_model_free(model);
+    }
+
+    destroy_dataset(dset);
+    gretl_print_destroy(prn);
+    libgretl_thread_cleanup();
+
+    return NULL;
+}
+
+int main (void)
+{
+    GThread *threads[NTHREADS];
+    job jobs[NTHREADS];
+    int i;
+
+    libgretl_init();
+
+    for (i=0; i<NTHREADS; i++) {
+        jobs[i].id = i;
+        jobs[i].err = 0;
+        threads[i] = g_thread_new(NULL, run_job, &jobs[i]);
+    }
+
+    for (i=0; i<NTHREADS; i++) {
+        g_thread_join(threads[i]);
+        if (jobs[i].err) {
+            printf("job %d: error %d\n", i, jobs[i].err);
+        } else {
+            printf("job %d: const = %g, slope = %g\n", i,
+                   jobs[i].b[0], jobs[i].b[1]);
+        }
+    }
+
+    libgretl_cleanup();
+
+    return 0;
+}
@@ -59,6 +59,12 @@ Direct inquiries to 30 Frost Street, Cambridge, MA 02140
 
 static int cephes_errno = 0;
 
+/* per-thread, so that (e.g.) normal_cdf() can be called from
+   within OpenMP-parallel loops */
+#if defined(_OPENMP)
+#pragma omp threadprivate(cephes_errno)
+#endif
+
 /* Notice: the order of appearance of the following
  * messages is bound to the error codes defined
  * in mconf.h.
@@ -0,0 +1,254 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* cli_server.c for gretl: "gretlcli --server=<socket> init.inp".
+
+   The initial script is run as in batch mode, typically to open
+   datasets, load function packages and build matrices. gretlcli
+   then listens on a Unix-domain socket. Each connection supplies a
+   hansl script, terminated by the client shutting down its writing
+   side, and gets back the script's output before the connection is
+   closed. For example,
+
+     socat -t 3600 - UNIX-CONNECT:/tmp/gretl.sock < job.inp
+
+   Each request is run in a child process forked from the server,
+   so it starts with everything the initial script set up, without
+   reloading anything (the memory is shared until written to). Any
+   changes the request makes, to the dataset or user variables, are
+   private to it and vanish when it completes. Up to --server-jobs
+   requests (by default, the number of cores) run at once.
+*/
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <errno.h>
+
+#define SERVER_BUFSIZE 8192
+
+static int server_listen (const char *path)
+{
+    struct sockaddr_un addr;
+    struct stat sbuf;
+    int sock;
+
+    if (strlen(path) >= sizeof addr.sun_path) {
+        fprintf(stderr, "gretlcli: socket path is too long\n");
+        return -1;
+    }
+
+    sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        perror("gretlcli: socket");
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    /* remove a socket left by an earlier server, but refuse to
+       touch anything else that's in the way */
+    if (lstat(path, &sbuf) == 0) {
+        if (!S_ISSOCK(sbuf.st_mode)) {
+            fprintf(stderr, "gretlcli: %s exists and is not a socket\n",
+                    path);
+            close(sock);
+            return -1;
+        }
+        unlink(path);
+    }
+
+    if (bind(sock, (struct sockaddr *) &addr, sizeof addr) < 0 ||
+        listen(sock, 64) < 0) {
+        perror("gretlcli: socket");
+        close(sock);
+        return -1;
+    }
+
+    return sock;
+}
+
+/* read the script sent over @conn into a file in the
+   (per-request) dotdir, whose name is written into @fname */
+
+static int server_read_request (int conn, char *fname)
+{
+    char buf[SERVER_BUFSIZE];
+    ssize_t n;
+    FILE *fp;
+    int err = 0;
+
+    sprintf(fname, "%srequest.inp", gretl_dotdir());
+    fp = gretl_fopen(fname, "w");
+    if (fp == NULL) {
+        return E_FOPEN;
+    }
+
+    while ((n = read(conn, buf, sizeof buf)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            err = E_DATA;
+            break;
+        }
+        fwrite(buf, 1, n, fp);
+    }
+
+    /* guard against a missing final newline */
+    fputc('\n', fp);
+    fclose(fp);
+
+    return err;
+}
+
+/* In the child process: run the script supplied on @conn, with
+   stdout directed to @conn, then exit.
+*/
+
+static void server_handle_request (int conn, ExecState *s,
+                                   DATASET *dset, char *runfile)
+{
+    char fname[MAXLEN];
+    gchar *dotdir;
+    int err;
+
+    /* a private dotdir for temporary files */
+    dotdir = g_strdup_printf("%sserver-%ld/", gretl_dotdir(),
+                             (long) getpid());
+    gretl_mkdir(dotdir);
+    gretl_set_path_by_name("dotdir", dotdir);
+
+    /* concurrency comes from the processes; also, the OpenMP
+       thread pool inherited from the server may not survive
+       the fork
+    */
+    gretl_set_omp_threads(1);
+
+    err = server_read_request(conn, fname);
+
+    fflush(stdout);
+    dup2(conn, STDOUT_FILENO);
+
+    if (err) {
+        errmsg(err, s->prn);
+    } else {
+        runit = 0;
+        fb = NULL;
+        s->cmd->ci = 0;
+        sprintf(s->line, "run \"%s\"", fname);
+        err = cli_exec_line(s, dset, NULL);
+        if (!err || fb != NULL) {
+            err = cli_main_loop(s, dset, NULL, runfile, err);
+        }
+    }
+
+    fflush(stdout);
+    shutdown(STDOUT_FILENO, SHUT_RDWR);
+    gretl_deltree(dotdir);
+    g_free(dotdir);
+
+    /* skip the atexit cleanup, which belongs to the server */
+    _exit(err ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/* wait for a child to finish: block if @hang is non-zero, and
+   return the number reaped */
+
+static int server_reap (int hang)
+{
+    int n = 0;
+
+    while (waitpid(-1, NULL, hang ? 0 : WNOHANG) > 0) {
+        n++;
+        if (hang) {
+            break;
+        }
+    }
+
+    return n;
+}
+
+static int cli_serve (const char *path, ExecState *s,
+                      DATASET *dset, char *runfile)
+{
+    int njobs = 0;
+    int sock;
+
+    if (server_jobs <= 0) {
+        server_jobs = gretl_n_physical_cores();
+    }
+
+    sock = server_listen(path);
+    if (sock < 0) {
+        return E_EXTERNAL;
+    }
+
+    fprintf(stderr, "gretlcli: serving on %s (%d jobs)\n", path,
+            server_jobs);
+    fflush(stdout);
+
+    while (!get_user_stop()) {
+        pid_t pid;
+        int conn;
+
+        njobs -= server_reap(0);
+        if (njobs >= server_jobs) {
+            /* wait for a request to complete */
+            if (server_reap(1) > 0) {
+                njobs--;
+            } else if (errno == ECHILD) {
+                njobs = 0;
+            }
+            continue;
+        }
+
+        conn = accept(sock, NULL, NULL);
+        if (conn < 0) {
+            if (errno != EINTR) {
+                perror("gretlcli: accept");
+                break;
+            }
+            continue;
+        }
+
+        pid = fork();
+        if (pid == 0) {
+            close(sock);
+            server_handle_request(conn, s, dset, runfile);
+        } else if (pid < 0) {
+            perror("gretlcli: fork");
+            close(conn);
+        } else {
+            close(conn);
+            njobs++;
+        }
+    }
+
+    /* shut down: let requests in progress complete */
+    close(sock);
+    unlink(path);
+    while (njobs > 0 && server_reap(1) > 0) {
+        njobs--;
+    }
+
+    return 0;
+}
@@ -36,6 +36,11 @@
 #include "dbread.h"
 #include "uservar.h"
 #include "csvdata.h"
+#include "gretl_profile.h"
+#include "gretl_memstats.h"
+#include "gretl_trace.h"
+#include "gretl_blasstats.h"
+#include "gretl_mt.h"
 #ifdef USE_CURL
 # include "gretl_www.h"
 #endif
@@ -49,6 +54,7 @@
 # include <sys/types.h>
 # include <fcntl.h>
 # include <unistd.h>
+# include <signal.h>
 #endif
 
 #ifdef HAVE_READLINE
@@ -70,6 +76,14 @@ int indent0;
 int batch_stdin;
 int data_status;
 int gui_exec;
+int profile;
+int memstats;
+static char *tracefile;
+int tune;
+static int progress;
+static int startup_times;
+static char *server_path;
+static int server_jobs;
 char linebak[MAXLINE];      /* for storing comments */
 char *line_read;
 static char *ai_prompt;
@@ -124,6 +138,27 @@ static int parse_options (int *pargc, char ***pargv, gretlopt *popt,
             opt |= (OPT_TOOL | OPT_BATCH);
         } else if (!strcmp(s, "-n") || !strcmp(s, "--no-plots")) {
             opt |= OPT_NO_PLOT;
+        } else if (!strcmp(s, "-p") || !strcmp(s, "--profile")) {
+            profile = 1;
+        } else if (!strcmp(s, "--tune")) {
+            tune = 1;
+        } else if (!strcmp(s, "--memstats")) {
+            memstats = 1;
+        } else if (!strncmp(s, "--trace=", 8)) {
+            g_free(tracefile);
+            tracefile = g_strdup(s + 8);
+        } else if (!strcmp(s, "--progress")) {
+            progress = 1;
+        } else if (!strcmp(s, "--fast-start")) {
+            gretl_set_fast_start();
+        } else if (!strcmp(s, "--startup-times")) {
+            startup_times = 1;
+        } else if (!strncmp(s, "--server=", 9)) {
+            g_free(server_path);
+            server_path = g_strdup(s + 9);
+            opt |= OPT_BATCH;
+        } else if (!strncmp(s, "--server-jobs=", 14)) {
+            server_jobs = atoi(s + 14);
 	} else if (!strcmp(s, "-x") || !strcmp(s, "--exec")) {
 	    gui_exec = 1;
 	    opt |= OPT_BATCH;
@@ -182,6 +217,20 @@ static void usage (int err)
              " -q or --quiet     Print less verbose program information.\n"
              " -t or --tool      Operate silently.\n"
              " -n or --no-plots  Suppress production of plots.\n"
+             " -p or --profile   Report where the time goes when running a script.\n"
+             " --memstats        Report memory usage by subsystem after running a script.\n"
+             " --trace=FILE      Write a timing trace of the commands executed to FILE\n"
+             "                   (Chrome trace format, as read by Perfetto).\n"
+             " --progress        Show the progress of long computations on stderr.\n"
+             " --fast-start      Skip the configuration file and the checks on\n"
+             "                   working directories at startup.\n"
+             " --startup-times   Show the time taken by each stage of startup on stderr.\n"
+             " --server=SOCKET   Run a script, then run the scripts sent to the Unix\n"
+             "                   socket SOCKET, each starting from the state the\n"
+             "                   first script left.\n"
+             " --server-jobs=N   Run at most N requests at once in server mode.\n"
+             " --tune            Calibrate performance thresholds for this machine\n"
+             "                   and save them for later sessions, then exit.\n"
              "Example of batch mode usage:\n"
              " gretlcli -b myfile.inp > myfile.out\n"
              "Example of run mode usage:\n"
@@ -208,6 +257,11 @@ static void check_blas_threading (int tool, int quiet)
     const char *blas_type;
     char *s1, *s2, *non_omp;
 
+    if (!blas_is_threaded()) {
+        /* and don't hold up startup identifying the BLAS */
+        return;
+    }
+
     blas_type = blas_variant_string();
     if (strcmp(blas_type, "mkl") == 0) {
         non_omp = "TBB";
@@ -624,6 +678,8 @@ static void handle_datafile (char *filearg, char *runfile,
     case GRETL_JMULTI:
     case GRETL_OCTAVE:
     case GRETL_WF1:
+    case GRETL_PARQUET:
+    case GRETL_ARROW:
         err = import_other(datafile, ftype, dset,
                            OPT_NONE, prn);
         break;
@@ -666,9 +722,157 @@ static void check_help_file (void)
     }
 }
 
-int main (int argc, char *argv[])
+/* progress callback for the --progress option: a status line on
+   stderr, overwritten in place, with an estimate of the time
+   remaining when the total amount of work is known */
+
+static int cli_show_progress (const char *task, double done,
+                              double total, void *data)
+{
+    static char curr[32];
+    static gint64 t0;
+    gint64 now = g_get_monotonic_time();
+    char msg[80];
+
+    if (done == 0 || strcmp(task, curr)) {
+        *curr = '\0';
+        strncat(curr, task, sizeof curr - 1);
+        t0 = now;
+    }
+
+    if (total > 0) {
+        int n = snprintf(msg, sizeof msg, "%s: %3.0f%%", task,
+                         100 * done / total);
+
+        if (done > 0 && done < total && n < (int) sizeof msg) {
+            double secs = (now - t0) / 1.0e6 * (total - done) / done;
+
+            snprintf(msg + n, sizeof msg - n, ", about %.0f s to go", secs);
+        }
+    } else {
+        snprintf(msg, sizeof msg, "%s: %g", task, done);
+    }
+
+    fprintf(stderr, "\r%-60s", msg);
+    if (total > 0 && done >= total) {
+        fputc('\n', stderr);
+    }
+
+    return 0;
+}
+
+#ifndef WIN32
+
+/* On SIGTERM (or SIGINT in batch mode) ask libgretl to stop at the
+   next opportunity, so that a script can be cancelled cleanly;
+   a second signal has the default effect.
+*/
+
+static void cli_stop_handler (int sig)
+{
+    set_user_stop(1);
+}
+
+static void cli_set_stop_handler (void)
+{
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = cli_stop_handler;
+    sa.sa_flags = SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, NULL);
+    if (batch) {
+        sigaction(SIGINT, &sa, NULL);
+    }
+}
+
+#endif /* !WIN32 */
+
+/* The main command loop: read and execute commands, from a script
+   or the terminal, until there's no more input or a fatal error
+   occurs. @err is the result of executing any command already
+   given. The return value is the error code from the last command
+   executed.
+*/
+
+static int cli_main_loop (ExecState *s, DATASET *dset,
+                          PRN *cmdprn, char *runfile, int err)
 {
     char linecopy[MAXLINE];
+
+    *linecopy = '\0';
+
+    while (s->cmd->ci != QUIT && fb != NULL) {
+        if (get_user_stop()) {
+            /* cancelled by signal or progress callback */
+            err = E_STOP;
+            errmsg(err, s->prn);
+            break;
+        }
+        if (err && gretl_error_is_fatal()) {
+            gretl_abort(linecopy);
+        }
+        if (gretl_execute_loop()) {
+            s->cmd->ci = RUNLOOP;
+            err = cli_exec_line(s, dset, cmdprn);
+            s->cmd->ci = 0;
+        } else {
+            err = cli_get_input_line(s, runfile);
+            if (err) {
+                errmsg(err, s->prn);
+                break;
+            } else if (s->cmd->ci == QUIT) {
+                /* no more input available */
+                cli_exec_line(s, dset, cmdprn);
+                if (runit == 0) {
+                    err = gretl_if_state_check(0);
+                    if (err) {
+                        errmsg(err, s->prn);
+                    }
+                }
+                continue;
+            }
+        }
+
+        if (xout) {
+            /* readline Ctrl-X: get out without saving
+               input or output */
+            gretl_print_destroy(cmdprn);
+            gretl_remove(cmdfile);
+            break;
+        }
+
+        if (!s->in_comment) {
+            if (s->cmd->context == FOREIGN || s->cmd->context == MPI ||
+                gretl_compiling_python(s->line)) {
+                tailstrip(s->line);
+            } else {
+                err = maybe_get_input_line_continuation(s->line);
+                if (err) {
+                    errmsg(err, s->prn);
+                    break;
+                }
+            }
+        }
+
+#ifdef G_OS_WIN32
+        line_ensure_utf8(s->line);
+#endif
+        strcpy(linecopy, s->line);
+        tailstrip(linecopy);
+        err = cli_exec_line(s, dset, cmdprn);
+    }
+
+    return err;
+}
+
+#ifndef WIN32
+# include "cli_server.c"
+#endif
+
+int main (int argc, char *argv[])
+{
     DATASET *dset = NULL;
     MODEL *model = NULL;
     ExecState state;
@@ -685,6 +889,8 @@ int main (int argc, char *argv[])
     PRN *cmdprn = NULL;
     int err = 0;
 
+    gretl_startup_mark(NULL);
+
 #if defined(G_OS_WIN32)
     win32_get_args(&argc, &argv);
     console_use_utf8();
@@ -777,8 +983,15 @@ int main (int argc, char *argv[])
         }
     }
 
+    gretl_startup_mark("options, nls");
     libgretl_init();
 
+    if (profile) {
+        libset_set_bool(GRETL_PROFILE, 1);
+    }
+    if (memstats) {
+        libset_set_bool(MEMSTATS, 1);
+    }
     if (ai_prompt != NULL && *ai_prompt != '\0') {
         GretlLLMProvider p = GRETL_LLM_NONE;
         char *reply = NULL;
@@ -826,6 +1039,7 @@ int main (int argc, char *argv[])
 #if defined(OPENMP_BUILD) && !defined(WIN32) && !defined(__APPLE__)
     check_blas_threading(tool, quiet);
 #endif
+    gretl_startup_mark("banner");
 
     prn = gretl_print_new(GRETL_PRINT_STDOUT, &err);
     if (err) {
@@ -843,6 +1057,32 @@ int main (int argc, char *argv[])
     cli_read_rc();
 #endif /* WIN32 */
 
+    if (tune) {
+        err = libset_autotune(prn);
+        if (err) {
+            errmsg(err, prn);
+        }
+        gretl_print_destroy(prn);
+        libgretl_cleanup();
+        return err ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    if (progress) {
+        set_progress_func(cli_show_progress, NULL);
+    }
+#ifndef WIN32
+    cli_set_stop_handler();
+#endif
+
+    if (tracefile != NULL) {
+        /* relative to workdir, so wait until that is set */
+        if (gretl_trace_start(tracefile)) {
+            errmsg(E_FOPEN, prn);
+        }
+        g_free(tracefile);
+        tracefile = NULL;
+    }
+
     if (!batch && !tool) {
         strcpy(cmdfile, gretl_workdir());
         strcat(cmdfile, "session.inp");
@@ -897,6 +1137,11 @@ int main (int argc, char *argv[])
     initialize_readline();
 #endif
 
+    gretl_startup_mark("session setup");
+    if (startup_times) {
+        gretl_startup_report(stderr);
+    }
+
     if (batch || runit) {
         /* re-initialize: will be incremented by "run" cmd */
         runit = 0;
@@ -919,64 +1164,14 @@ int main (int argc, char *argv[])
         }
     }
 
-    *linecopy = '\0';
-
-    /* enter main command loop */
-
-    while (cmd.ci != QUIT && fb != NULL) {
-        if (err && gretl_error_is_fatal()) {
-            gretl_abort(linecopy);
-        }
-        if (gretl_execute_loop()) {
-            state.cmd->ci = RUNLOOP;
-            err = cli_exec_line(&state, dset, cmdprn);
-            state.cmd->ci = 0;
-        } else {
-            err = cli_get_input_line(&state, runfile);
-            if (err) {
-                errmsg(err, prn);
-                break;
-            } else if (cmd.ci == QUIT) {
-                /* no more input available */
-                cli_exec_line(&state, dset, cmdprn);
-                if (runit == 0) {
-                    err = gretl_if_state_check(0);
-                    if (err) {
-                        errmsg(err, prn);
-                    }
-                }
-                continue;
-            }
-        }
-
-        if (xout) {
-            /* readline Ctrl-X: get out without saving
-               input or output */
-            gretl_print_destroy(cmdprn);
-            gretl_remove(cmdfile);
-            break;
-        }
+    err = cli_main_loop(&state, dset, cmdprn, runfile, err);
 
-        if (!state.in_comment) {
-            if (cmd.context == FOREIGN || cmd.context == MPI ||
-                gretl_compiling_python(line)) {
-                tailstrip(line);
-            } else {
-                err = maybe_get_input_line_continuation(line);
-                if (err) {
-                    errmsg(err, prn);
-                    break;
-                }
-            }
-        }
-
-#ifdef G_OS_WIN32
-        line_ensure_utf8(line);
-#endif
-        strcpy(linecopy, line);
-        tailstrip(linecopy);
-        err = cli_exec_line(&state, dset, cmdprn);
+#ifndef WIN32
+    if (!err && server_path != NULL) {
+        /* hand over to the request loop: see cli_server.c */
+        err = cli_serve(server_path, &state, dset, runfile);
     }
+#endif
 
     /* finished main command loop */
 
@@ -1003,6 +1198,27 @@ int main (int argc, char *argv[])
         cli_exec_line(&state, dset, cmdprn);
     }
 
+    if (libset_get_bool(GRETL_PROFILE)) {
+        libset_set_bool(GRETL_PROFILE, 0);
+    }
+    gretl_profile_report(prn);
+
+    if (libset_get_bool(MEMSTATS)) {
+        libset_set_bool(MEMSTATS, 0);
+    }
+    gretl_memstats_report(dset, prn);
+
+    if (libset_get_bool(GENR_STATS)) {
+        /* report on the counters for this run */
+        libset_set_bool(GENR_STATS, 0);
+        genr_stats_report(prn);
+    }
+    if (libset_get_bool(BLAS_STATS)) {
+        libset_set_bool(BLAS_STATS, 0);
+        gretl_blasstats_report(prn);
+    }
+    gretl_trace_stop();
+
     /* leak check -- try explicitly freeing all memory allocated */
 
     destroy_working_model(model);
@@ -1247,6 +1463,10 @@ static int cli_exec_line (ExecState *s, DATASET *dset, PRN *cmdprn)
         return 0;
     }
 
+    if (gretl_profiling() && !gretl_compiling_loop()) {
+        gretl_profile_line(line, 0);
+    }
+
     if (!gretl_compiling_loop() && !s->in_comment &&
         !cmd->context && gretl_if_state_true()) {
         /* catch requests relating to saved objects, which are not
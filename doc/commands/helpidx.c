@@ -0,0 +1,96 @@
+/* helpidx.c -- write a binary index of the topics in a plain-text
+   ("CLI") help file, for use by cli_help() in libgretl, which
+   can then seek straight to the requested topic instead of
+   scanning the file from the top.
+
+   Usage: helpidx helpfile helpfile.idx
+
+   The index holds the 8 bytes "gretlhix", the number of topics
+   and the size of the help file in bytes, then for each topic
+   the byte offset of its "# topic" line, the length of the topic
+   word and the word itself (without a terminating NUL). Counts,
+   sizes and offsets are 32-bit little-endian, lengths one byte.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAXTOPICS 4096
+#define TOPICLEN 16
+
+struct topic {
+    char word[TOPICLEN];
+    unsigned long offset;
+};
+
+static void put_u32 (unsigned long u, FILE *fp)
+{
+    fputc(u & 0xff, fp);
+    fputc((u >> 8) & 0xff, fp);
+    fputc((u >> 16) & 0xff, fp);
+    fputc((u >> 24) & 0xff, fp);
+}
+
+int main (int argc, char **argv)
+{
+    static struct topic topics[MAXTOPICS];
+    char line[1024];
+    unsigned long pos = 0;
+    int bol = 1, n = 0;
+    int i, len;
+    FILE *fp;
+
+    if (argc != 3) {
+	fputs("Usage: helpidx helpfile idxfile\n", stderr);
+	exit(EXIT_FAILURE);
+    }
+
+    fp = fopen(argv[1], "rb");
+    if (fp == NULL) {
+	fprintf(stderr, "helpidx: couldn't open %s\n", argv[1]);
+	exit(EXIT_FAILURE);
+    }
+
+    while (fgets(line, sizeof line, fp) != NULL) {
+	len = strlen(line);
+	/* topics are "# word" lines; "## " marks a sub-heading */
+	if (bol && line[0] == '#' && line[1] == ' ') {
+	    if (n == MAXTOPICS) {
+		fputs("helpidx: too many topics\n", stderr);
+		exit(EXIT_FAILURE);
+	    }
+	    if (sscanf(line + 2, "%15s", topics[n].word) == 1) {
+		topics[n++].offset = pos;
+	    }
+	}
+	bol = (len > 0 && line[len-1] == '\n');
+	pos += len;
+    }
+
+    fclose(fp);
+
+    fp = fopen(argv[2], "wb");
+    if (fp == NULL) {
+	fprintf(stderr, "helpidx: couldn't write %s\n", argv[2]);
+	exit(EXIT_FAILURE);
+    }
+
+    fputs("gretlhix", fp);
+    put_u32(n, fp);
+    put_u32(pos, fp);
+
+    for (i=0; i<n; i++) {
+	len = strlen(topics[i].word);
+	put_u32(topics[i].offset, fp);
+	fputc(len, fp);
+	fwrite(topics[i].word, 1, len, fp);
+    }
+
+    if (fclose(fp) != 0) {
+	fprintf(stderr, "helpidx: error writing %s\n", argv[2]);
+	exit(EXIT_FAILURE);
+    }
+
+    return 0;
+}
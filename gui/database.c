@@ -1435,6 +1435,14 @@ static int add_local_db_series_list (windata_t *vwin)
 	tailstrip(line2);
 	row[2] = line2;
 
+	if (!strcmp(sername, DB_TOMBSTONE)) {
+	    /* a superseded record: skip its data */
+	    if (sscanf(line2, "%*c %*s - %*s %*s = %d", &nobs) == 1) {
+		offset += nobs;
+		continue;
+	    }
+	}
+
 	if (!err) {
 	    err = check_serinfo(line2, sername, &nobs);
 	}
@@ -1494,6 +1502,14 @@ static int add_remote_db_series_list (windata_t *vwin, char *buf)
 	}
 
 	row[2] = tailstrip(line2);
+	if (!strcmp(sername, DB_TOMBSTONE)) {
+	    /* a superseded record: skip its data */
+	    if (sscanf(line2, "%*c %*s - %*s %*s = %d", &nobs) == 1) {
+		offset += nobs;
+		continue;
+	    }
+	}
+
 	if (!err) {
 	    err = check_serinfo(line2, sername, &nobs);
 	}
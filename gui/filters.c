@@ -1226,7 +1226,7 @@ static int save_filtered_var (filter_info *finfo, double *x, int i,
     if (v == dataset->v) {
 	err = dataset_add_allocated_series(dataset, x);
     } else {
-	free(dataset->Z[v]);
+	dataset_release_series(dataset->Z[v]);
 	dataset->Z[v] = x;
 	series_set_discrete(dataset, v, 0);
     }
@@ -625,11 +625,13 @@ static void check_for_plasma_wayland (void)
 
 /* callback from within potentially lengthy libgretl
    operations: try to avoid having the GUI become
-   totally unresponsive
+   totally unresponsive, and show any script output
+   so far
 */
 
 static void gui_show_activity (void)
 {
+    stream_script_output();
     while (gtk_events_pending()) {
 	gtk_main_iteration();
     }
@@ -8410,8 +8410,15 @@ static void handle_flush_callback (gretlopt opt)
     if (oh.vwin != NULL) {
         /* we have a "flushable" window in place */
         char *buf = gretl_print_get_chunk(oh.prn);
-	int ctrlr = buf[strlen(buf)-1] == '\r';
+	int ctrlr;
 
+	if (buf == NULL || (*buf == '\0' && !(opt & OPT_F))) {
+	    /* nothing new to show */
+	    free(buf);
+	    return;
+	}
+
+	ctrlr = *buf != '\0' && buf[strlen(buf)-1] == '\r';
 	if (ctrlr) {
 	    buf[strlen(buf)-1] = '\0';
 	}
@@ -8443,6 +8450,21 @@ static void handle_flush_callback (gretlopt opt)
     }
 }
 
+/* Called via the libgretl activity callback, which is invoked
+   between commands and within loops and iterative estimators (at
+   most ten times a second): pass any output produced since the
+   last call to the script output window, so that the output of a
+   long-running script appears as it's produced, even if the
+   script doesn't use "flush".
+*/
+
+void stream_script_output (void)
+{
+    if (oh.vwin != NULL && oh.prn != NULL && script_wait) {
+	handle_flush_callback(OPT_Q);
+    }
+}
+
 int vwin_is_busy (windata_t *vwin)
 {
     return vwin != NULL && vwin == oh.vwin;
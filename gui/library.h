@@ -351,6 +351,8 @@ int waiting_for_output (void);
 
 int vwin_is_busy (windata_t *vwin);
 
+void stream_script_output (void);
+
 /* other */
 
 gchar *get_genr_string (GtkWidget *entry, dialog_t *dlg);
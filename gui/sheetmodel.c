@@ -0,0 +1,293 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* sheetmodel.c for gretl: a "virtual" GtkTreeModel for the data
+   editor, used in place of a GtkListStore when the dataset is long.
+   Nothing is stored per row: the text of a cell is produced from
+   the dataset only when the tree view asks for it, which it does
+   only for the rows that are visible. The exception is cells the
+   user has edited, whose text is held (until the edits are applied
+   to the dataset, and beyond) in a hash table keyed by position.
+*/
+
+#include "gretl.h"
+#include "sheetmodel.h"
+
+typedef struct _SheetModel SheetModel;
+typedef struct _SheetModelClass SheetModelClass;
+
+struct _SheetModel {
+    GObject parent;
+    gint stamp;        /* validates iters */
+    gint nrows;        /* number of observations shown */
+    gint ncols;        /* number of columns, including labels */
+    gint t1;           /* observation in row 0 */
+    int *varlist;      /* series shown in columns 1, 2, ... */
+    char numfmt[8];    /* format for values, taking @digits */
+    int digits;        /* precision of values */
+    GHashTable *edits; /* text of edited cells */
+};
+
+struct _SheetModelClass {
+    GObjectClass parent_class;
+};
+
+static void sheet_model_iface_init (GtkTreeModelIface *iface);
+GType sheet_model_get_type (void);
+
+G_DEFINE_TYPE_WITH_CODE (SheetModel,
+			 sheet_model,
+			 G_TYPE_OBJECT,
+			 G_IMPLEMENT_INTERFACE(GTK_TYPE_TREE_MODEL,
+					       sheet_model_iface_init))
+
+#define SHEET_MODEL(o) ((SheetModel *) (o))
+
+#define iter_row(i) GPOINTER_TO_INT((i)->user_data)
+
+static void sheet_model_init (SheetModel *sm)
+{
+    sm->stamp = g_random_int();
+    sm->nrows = sm->ncols = 0;
+    sm->t1 = 0;
+    sm->varlist = NULL;
+    *sm->numfmt = '\0';
+    sm->digits = 0;
+    sm->edits = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+				      g_free, g_free);
+}
+
+static void sheet_model_finalize (GObject *obj)
+{
+    SheetModel *sm = SHEET_MODEL(obj);
+
+    g_hash_table_destroy(sm->edits);
+    free(sm->varlist);
+
+    G_OBJECT_CLASS(sheet_model_parent_class)->finalize(obj);
+}
+
+static void sheet_model_class_init (SheetModelClass *klass)
+{
+    G_OBJECT_CLASS(klass)->finalize = sheet_model_finalize;
+}
+
+static GtkTreeModelFlags sheet_model_get_flags (GtkTreeModel *model)
+{
+    return GTK_TREE_MODEL_LIST_ONLY | GTK_TREE_MODEL_ITERS_PERSIST;
+}
+
+static gint sheet_model_get_n_columns (GtkTreeModel *model)
+{
+    return SHEET_MODEL(model)->ncols;
+}
+
+static GType sheet_model_get_column_type (GtkTreeModel *model,
+					  gint col)
+{
+    return G_TYPE_STRING;
+}
+
+static gboolean sheet_model_set_iter (SheetModel *sm,
+				      GtkTreeIter *iter,
+				      gint row)
+{
+    if (row < 0 || row >= sm->nrows) {
+	iter->stamp = 0;
+	return FALSE;
+    }
+
+    iter->stamp = sm->stamp;
+    iter->user_data = GINT_TO_POINTER(row);
+    iter->user_data2 = iter->user_data3 = NULL;
+
+    return TRUE;
+}
+
+static gboolean sheet_model_get_iter (GtkTreeModel *model,
+				      GtkTreeIter *iter,
+				      GtkTreePath *path)
+{
+    if (gtk_tree_path_get_depth(path) != 1) {
+	return FALSE;
+    }
+
+    return sheet_model_set_iter(SHEET_MODEL(model), iter,
+				gtk_tree_path_get_indices(path)[0]);
+}
+
+static GtkTreePath *sheet_model_get_path (GtkTreeModel *model,
+					  GtkTreeIter *iter)
+{
+    return gtk_tree_path_new_from_indices(iter_row(iter), -1);
+}
+
+static gchar *sheet_model_edited_text (SheetModel *sm, gint row,
+				       gint col)
+{
+    gint64 key = (gint64) row * sm->ncols + col;
+
+    return g_hash_table_lookup(sm->edits, &key);
+}
+
+static void sheet_model_get_value (GtkTreeModel *model,
+				   GtkTreeIter *iter,
+				   gint col,
+				   GValue *value)
+{
+    SheetModel *sm = SHEET_MODEL(model);
+    gint row = iter_row(iter);
+    gchar *s;
+
+    g_value_init(value, G_TYPE_STRING);
+
+    if (col < 0 || col >= sm->ncols || row >= sm->nrows) {
+	return;
+    }
+
+    s = sheet_model_edited_text(sm, row, col);
+
+    if (s != NULL) {
+	g_value_set_string(value, s);
+    } else if (col == 0) {
+	char obs[OBSLEN];
+
+	get_obs_string(obs, sm->t1 + row, dataset);
+	g_value_set_string(value, obs);
+    } else {
+	double x = dataset->Z[sm->varlist[col]][sm->t1 + row];
+
+	if (na(x)) {
+	    g_value_set_static_string(value, "");
+	} else {
+	    g_value_take_string(value, g_strdup_printf(sm->numfmt,
+						       sm->digits, x));
+	}
+    }
+}
+
+static gboolean sheet_model_iter_next (GtkTreeModel *model,
+				       GtkTreeIter *iter)
+{
+    return sheet_model_set_iter(SHEET_MODEL(model), iter,
+				iter_row(iter) + 1);
+}
+
+static gboolean sheet_model_iter_nth_child (GtkTreeModel *model,
+					    GtkTreeIter *iter,
+					    GtkTreeIter *parent,
+					    gint n)
+{
+    if (parent != NULL) {
+	iter->stamp = 0;
+	return FALSE;
+    }
+
+    return sheet_model_set_iter(SHEET_MODEL(model), iter, n);
+}
+
+static gboolean sheet_model_iter_children (GtkTreeModel *model,
+					   GtkTreeIter *iter,
+					   GtkTreeIter *parent)
+{
+    return sheet_model_iter_nth_child(model, iter, parent, 0);
+}
+
+static gboolean sheet_model_iter_has_child (GtkTreeModel *model,
+					    GtkTreeIter *iter)
+{
+    return FALSE;
+}
+
+static gint sheet_model_iter_n_children (GtkTreeModel *model,
+					 GtkTreeIter *iter)
+{
+    return (iter == NULL)? SHEET_MODEL(model)->nrows : 0;
+}
+
+static gboolean sheet_model_iter_parent (GtkTreeModel *model,
+					 GtkTreeIter *iter,
+					 GtkTreeIter *child)
+{
+    iter->stamp = 0;
+    return FALSE;
+}
+
+static void sheet_model_iface_init (GtkTreeModelIface *iface)
+{
+    iface->get_flags = sheet_model_get_flags;
+    iface->get_n_columns = sheet_model_get_n_columns;
+    iface->get_column_type = sheet_model_get_column_type;
+    iface->get_iter = sheet_model_get_iter;
+    iface->get_path = sheet_model_get_path;
+    iface->get_value = sheet_model_get_value;
+    iface->iter_next = sheet_model_iter_next;
+    iface->iter_children = sheet_model_iter_children;
+    iface->iter_has_child = sheet_model_iter_has_child;
+    iface->iter_n_children = sheet_model_iter_n_children;
+    iface->iter_nth_child = sheet_model_iter_nth_child;
+    iface->iter_parent = sheet_model_iter_parent;
+}
+
+/* Create a model of the data for the current sample range of the
+   series in @varlist, with the observation labels in column 0 and
+   the series in columns 1, 2, and so on. Values are printed using
+   @numfmt, which takes @digits as precision.
+*/
+
+GtkTreeModel *sheet_model_new (const int *varlist,
+			       const char *numfmt,
+			       int digits)
+{
+    SheetModel *sm = g_object_new(sheet_model_get_type(), NULL);
+
+    sm->varlist = gretl_list_copy(varlist);
+    sm->nrows = dataset->t2 - dataset->t1 + 1;
+    sm->ncols = varlist[0] + 1;
+    sm->t1 = dataset->t1;
+    strcpy(sm->numfmt, numfmt);
+    sm->digits = digits;
+
+    return GTK_TREE_MODEL(sm);
+}
+
+/* counterpart to gtk_list_store_set(), for a single cell */
+
+void sheet_model_set_text (GtkTreeModel *model,
+			   GtkTreeIter *iter,
+			   gint col,
+			   const gchar *s)
+{
+    SheetModel *sm = SHEET_MODEL(model);
+    gint row = iter_row(iter);
+    GtkTreePath *path;
+    gint64 *key;
+
+    if (col < 0 || col >= sm->ncols || row >= sm->nrows) {
+	return;
+    }
+
+    key = g_new(gint64, 1);
+    *key = (gint64) row * sm->ncols + col;
+    g_hash_table_replace(sm->edits, key, g_strdup(s));
+
+    path = gtk_tree_path_new_from_indices(row, -1);
+    gtk_tree_model_row_changed(model, path, iter);
+    gtk_tree_path_free(path);
+}
@@ -0,0 +1,32 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef SHEETMODEL_H
+#define SHEETMODEL_H
+
+GtkTreeModel *sheet_model_new (const int *varlist,
+			       const char *numfmt,
+			       int digits);
+
+void sheet_model_set_text (GtkTreeModel *model,
+			   GtkTreeIter *iter,
+			   gint col,
+			   const gchar *s);
+
+#endif /* SHEETMODEL_H */
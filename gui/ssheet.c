@@ -21,6 +21,7 @@
 #include "gui_utils.h"
 #include "treeutils.h"
 #include "ssheet.h"
+#include "sheetmodel.h"
 #include "dlgutils.h"
 #include "menustate.h"
 #include "selector.h"
@@ -49,9 +50,18 @@ typedef enum {
     SHEET_USE_COMMA     = 1 << 4,
     SHEET_MODIFIED      = 1 << 5,
     SHEET_COLNAME_MOD   = 1 << 6,
-    SHEET_CUSTOM_FMT    = 1 << 7
+    SHEET_CUSTOM_FMT    = 1 << 7,
+    SHEET_VIRTUAL       = 1 << 8
 } SheetFlags;
 
+/* Number of observations at which the data editor switches from
+   a GtkListStore, holding the text of every cell, to a "virtual"
+   model that formats cells only as they come into view (see
+   sheetmodel.c). Adding series or observations is not supported
+   in that case.
+*/
+#define SHEET_VIRTUAL_ROWS 100000
+
 enum {
     SHEET_AT_END,
     SHEET_AT_POINT
@@ -196,6 +206,8 @@ static Spreadsheet *scalars_sheet;
 
 #define editing_scalars(s) (s->cmd == SHEET_EDIT_SCALARS)
 
+#define sheet_is_virtual(s) (s->flags & SHEET_VIRTUAL)
+
 static void sheet_set_modified (Spreadsheet *sheet, gboolean s)
 {
     if (s) {
@@ -608,8 +620,12 @@ maybe_update_store (Spreadsheet *sheet, const gchar *new_text,
 #endif
 
     if (old_text == NULL || strcmp(old_text, new_text)) {
-	gtk_list_store_set(GTK_LIST_STORE(model), &iter,
-			   colnum, new_text, -1);
+	if (sheet_is_virtual(sheet)) {
+	    sheet_model_set_text(model, &iter, colnum, new_text);
+	} else {
+	    gtk_list_store_set(GTK_LIST_STORE(model), &iter,
+			       colnum, new_text, -1);
+	}
 
 	if (sheet->matrix != NULL) {
 	    update_sheet_matrix_element(sheet, new_text, path_string, colnum);
@@ -1631,7 +1647,8 @@ static void update_dataset_from_sheet (Spreadsheet *sheet)
 
     /* copy observation markers, if relevant */
 
-    if (dataset_has_markers(dataset)) {
+    if (dataset_has_markers(dataset) &&
+	(!sheet_is_virtual(sheet) || data_column_edited(sheet, 0))) {
 	gchar *marker;
 
 	gtk_tree_model_get_iter_first(model, &iter);
@@ -2101,6 +2118,13 @@ static int add_data_to_sheet (Spreadsheet *sheet, SheetCmd c)
     fprintf(stderr, "Doing add_data_to_sheet\n");
 #endif
 
+    if (sheet_is_virtual(sheet)) {
+	/* the model reads the dataset directly */
+	sheet->datarows = dataset->t2 - dataset->t1 + 1;
+	sheet->orig_main_v = dataset->v;
+	return 0;
+    }
+
     store = GTK_LIST_STORE(gtk_tree_view_get_model(view));
 
     /* insert observation markers */
@@ -2533,7 +2557,7 @@ static gint catch_spreadsheet_click (GtkWidget *view,
     }
 
     if (sheet->matrix == NULL && !editing_scalars(sheet) &&
-	(right_click(event))) {
+	!sheet_is_virtual(sheet) && right_click(event)) {
 
 	if (sheet->popup == NULL) {
 	    build_sheet_popup(sheet);
@@ -2616,9 +2640,26 @@ static void sheet_show_popup (GtkWidget *w, Spreadsheet *sheet)
 		   1, gtk_get_current_event_time());
 }
 
+/* With a virtual model, the tree view must not measure every
+   row to size the columns, so we switch to fixed sizing */
+
+static void sheet_view_set_fixed_sizing (GtkTreeView *view)
+{
+    GtkTreeViewColumn *column;
+    gint i, w;
+
+    for (i=0; (column = gtk_tree_view_get_column(view, i)) != NULL; i++) {
+	w = gtk_tree_view_column_get_min_width(column);
+	gtk_tree_view_column_set_sizing(column, GTK_TREE_VIEW_COLUMN_FIXED);
+	gtk_tree_view_column_set_fixed_width(column, w + 8);
+    }
+
+    gtk_tree_view_set_fixed_height_mode(view, TRUE);
+}
+
 static int build_sheet_view (Spreadsheet *sheet)
 {
-    GtkListStore *store;
+    GtkTreeModel *model;
     GtkWidget *view;
     GtkTreeViewColumn *column;
     GtkTreeSelection *select;
@@ -2630,9 +2671,15 @@ static int build_sheet_view (Spreadsheet *sheet)
 	sheet->flags |= SHEET_USE_COMMA;
     }
 
-    store = make_sheet_liststore(sheet);
-    view = gtk_tree_view_new_with_model(GTK_TREE_MODEL(store));
-    g_object_unref(G_OBJECT(store));
+    if (sheet_is_virtual(sheet)) {
+	sheet->totcols = sheet->datacols + 1;
+	model = sheet_model_new(sheet->varlist, sheet->numfmt,
+				sheet->digits);
+    } else {
+	model = GTK_TREE_MODEL(make_sheet_liststore(sheet));
+    }
+    view = gtk_tree_view_new_with_model(model);
+    g_object_unref(G_OBJECT(model));
 
     gtk_tree_view_set_rules_hint(GTK_TREE_VIEW(view), FALSE);
     gtk_tree_view_set_grid_lines(GTK_TREE_VIEW(view), GTK_TREE_VIEW_GRID_LINES_BOTH);
@@ -2729,6 +2776,10 @@ static int build_sheet_view (Spreadsheet *sheet)
 	}
     }
 
+    if (sheet_is_virtual(sheet)) {
+	sheet_view_set_fixed_sizing(GTK_TREE_VIEW(view));
+    }
+
     /* set the selection property on the tree view */
     select = gtk_tree_view_get_selection(GTK_TREE_VIEW(view));
     gtk_tree_selection_set_mode(select, GTK_SELECTION_NONE);
@@ -3069,7 +3120,8 @@ static void adjust_add_menu_state (Spreadsheet *sheet)
 {
     sheet->flags |= (SHEET_ADD_OBS_OK | SHEET_INSERT_OBS_OK);
 
-    if (complex_subsampled() || dataset->t2 < dataset->n - 1) {
+    if (sheet_is_virtual(sheet) || complex_subsampled() ||
+	dataset->t2 < dataset->n - 1) {
 	sheet->flags &= ~SHEET_ADD_OBS_OK;
 	sheet->flags &= ~SHEET_INSERT_OBS_OK;
     } else if (dataset_is_panel(dataset)) {
@@ -3127,6 +3179,9 @@ static void sheet_add_toolbar (Spreadsheet *sheet, GtkWidget *vbox)
 	    if (item->flag == SHEET_APPLY_BTN) {
 		sheet->apply = button;
 		gtk_widget_set_sensitive(sheet->apply, FALSE);
+	    } else if (sheet_is_virtual(sheet)) {
+		/* can't add series or observations */
+		gtk_widget_set_sensitive(button, FALSE);
 	    }
 	    if (item->flag != SHEET_ADD_BTN) {
 		g_signal_connect(G_OBJECT(button), "enter-notify-event",
@@ -3264,6 +3319,10 @@ static void real_show_spreadsheet (Spreadsheet **psheet, SheetCmd c,
 		if (sheet->varlist[0] < dataset->v - 1) {
 		    sheet->flags |= SHEET_SHORT_VARLIST;
 		}
+		if (c != SHEET_NEW_DATASET &&
+		    dataset->t2 - dataset->t1 + 1 >= SHEET_VIRTUAL_ROWS) {
+		    sheet->flags |= SHEET_VIRTUAL;
+		}
 	    }
 	}
 	sheet_add_toolbar(sheet, main_vbox);
@@ -284,45 +284,52 @@ static int OLS_demean_detrend (double *y, int offset,
     return err;
 }
 
+/* Write the first difference of the series under test, its
+   first lag and the lagged differences into a block of scratch
+   series, and record them in the regression list. These are not
+   registered as named transforms via diffgenr() and laggenr():
+   they are needed only as columns of the test regression and
+   are dropped when the test is done.
+*/
+
 static int real_adf_form_list (adf_info *ainfo,
 			       DATASET *dset)
 {
-    int v, save_t1 = dset->t1;
-    int k, j, err = 0;
+    int v, v0 = dset->v;
+    int save_t1 = dset->t1;
+    int k, vk, err;
 
     /* using the original var, or transformed? */
     v = ainfo->altv > 0 ? ainfo->altv : ainfo->v;
 
+    err = dataset_add_series(dset, ainfo->order + 2);
+    if (err) {
+	return err;
+    }
+
     /* temporararily reset sample */
     dset->t1 = 0;
 
-    /* generate the first difference of series @v:
-       this will be the LHS variable in the test
+    /* the first difference of series @v: this will be the
+       LHS variable in the test
     */
-    ainfo->list[1] = diffgenr(v, DIFF, dset);
-    if (ainfo->list[1] < 0) {
-	dset->t1 = save_t1;
-	return E_DATA;
-    }
+    ainfo->list[1] = v0;
+    err = transform_values(DIFF, v, 0, dset->Z[v0],
+			   dset->varname[v0], dset);
 
-    /* generate lag 1 of series @v: the basic RHS series */
-    ainfo->list[2] = laggenr(v, 1, dset);
-    if (ainfo->list[2] < 0) {
-	dset->t1 = save_t1;
-	return E_DATA;
+    if (!err) {
+	/* lag 1 of series @v: the basic RHS series */
+	ainfo->list[2] = v0 + 1;
+	err = transform_values(LAGS, v, 1, dset->Z[v0+1],
+			       dset->varname[v0+1], dset);
     }
 
-    /* generate lagged differences for augmented test */
-    j = 3;
+    /* lagged differences for augmented test */
     for (k=1; k<=ainfo->order && !err; k++) {
-	int vk = laggenr(ainfo->list[1], k, dset);
-
-	if (vk < 0) {
-	    fprintf(stderr, "Error generating lags\n");
-	    err = E_DATA;
-	} else {
-	    ainfo->list[j++] = vk;
-	}
+	vk = v0 + k + 1;
+	ainfo->list[k+2] = vk;
+	err = transform_values(LAGS, v0, k, dset->Z[vk],
+			       dset->varname[vk], dset);
     }
 
     if (!err && ainfo->nseas > 0) {
@@ -915,6 +922,107 @@ static double get_sum_y2 (adf_info *ainfo, MODEL *pmod,
    2015-03-31).
 */
 
+/* Given the list for the maximal-order test regression, which has
+   the lagged differences in positions 3 to @kmax + 2, use a single
+   Cholesky decomposition to find the lag order that minimizes AIC
+   or BIC over the current sample range. With the lagged differences
+   moved to the end of X, the regressors for each order form a
+   leading block of columns; so if X'X = LL' and c = L^{-1} X'y,
+   the SSR for an order with m regressors is y'y minus the sum of
+   the first m squared elements of c. Returns the optimal order, or
+   -1 if the decomposition fails, in which case the caller should
+   fall back on estimating the regressions one by one.
+*/
+
+static int ic_order_via_cholesky (const int *list, int kmax,
+				  int kmethod, const DATASET *dset)
+{
+    gretl_matrix *X, *XTX, *c;
+    const double *y = dset->Z[list[1]];
+    int nx = list[0] - 1;
+    int T = sample_size(dset);
+    int ndet = nx - kmax - 1;
+    double x, yy, ess, IC, ICmin = 0;
+    double ll, crit[3];
+    int i, j, k, t, kopt = -1;
+
+    X = gretl_matrix_alloc(T, nx);
+    XTX = gretl_matrix_alloc(nx, nx);
+    c = gretl_column_vector_alloc(nx);
+
+    if (X == NULL || XTX == NULL || c == NULL) {
+	goto bailout;
+    }
+
+    /* y(-1) and the deterministic terms first, then the
+       lagged differences */
+    for (j=0; j<nx; j++) {
+	if (j == 0) {
+	    i = 2;
+	} else if (j <= ndet) {
+	    i = kmax + 2 + j;
+	} else {
+	    i = 2 + j - ndet;
+	}
+	for (t=0; t<T; t++) {
+	    gretl_matrix_set(X, t, j, dset->Z[list[i]][dset->t1 + t]);
+	}
+    }
+
+    yy = 0.0;
+    for (t=dset->t1; t<=dset->t2; t++) {
+	yy += y[t] * y[t];
+    }
+    for (j=0; j<nx; j++) {
+	x = 0.0;
+	for (t=0; t<T; t++) {
+	    x += gretl_matrix_get(X, t, j) * y[dset->t1 + t];
+	}
+	c->val[j] = x;
+    }
+
+    gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+			      X, GRETL_MOD_NONE,
+			      XTX, GRETL_MOD_NONE);
+    if (gretl_matrix_cholesky_decomp(XTX)) {
+	goto bailout;
+    }
+
+    /* forward substitution, cumulating the SSR as we go */
+    ess = yy;
+    for (j=0; j<nx; j++) {
+	x = c->val[j];
+	for (i=0; i<j; i++) {
+	    x -= gretl_matrix_get(XTX, j, i) * c->val[i];
+	}
+	c->val[j] = x / gretl_matrix_get(XTX, j, j);
+	ess -= c->val[j] * c->val[j];
+	k = j - ndet; /* the lag order with @j + 1 regressors */
+	if (k < 0) {
+	    continue;
+	}
+	if (gretl_calculate_criteria(ess, T, j + 1, &ll, &crit[0],
+				     &crit[1], &crit[2])) {
+	    kopt = -1;
+	    break;
+	}
+	IC = (kmethod == k_BIC)? crit[1] : crit[0];
+	/* as in ic_adjust_order(), ties go to the higher order */
+	if (kopt < 0 || IC <= ICmin) {
+	    ICmin = IC;
+	    kopt = k;
+	}
+    }
+
+ bailout:
+
+    gretl_matrix_free(X);
+    gretl_matrix_free(XTX);
+    gretl_matrix_free(c);
+
+    return kopt;
+}
+
 static int ic_adjust_order (adf_info *ainfo, int kmethod,
 			    DATASET *dset, gretlopt opt,
 			    int test_num, int *err,
@@ -981,6 +1089,18 @@ static int ic_adjust_order (adf_info *ainfo, int kmethod,
 	    dset->t1 = kmod.t1;
 	    dset->t2 = kmod.t2;
 	    ICmin = IC;
+	    if (!use_MIC && ainfo->verbosity == 0 &&
+		kmod.missmask == NULL &&
+		kmod.ncoeff == tmplist[0] - 1) {
+		/* try for all the orders at once */
+		int kc = ic_order_via_cholesky(tmplist, kmax, kmethod, dset);
+
+		if (kc >= 0) {
+		    kopt = kc;
+		    clear_model(&kmod);
+		    break;
+		}
+	    }
 	} else if (IC < ICmin) {
 	    ICmin = IC;
 	    kopt = k;
@@ -1072,6 +1192,38 @@ double get_urc_pvalue (double tau, int n, int niv, int itv)
     return pval;
 }
 
+/**
+ * get_urc_pvalues:
+ * @tau: array of @k test statistics.
+ * @pval: array to receive the @k p-values.
+ * @k: number of statistics.
+ * @n: sample size (or 0 for asymptotic result).
+ * @niv: number of potentially cointegrated variables
+ * (1 for simple unit-root test).
+ * @itv: code: 1, 2, 3, 4 for nc, c, ct, ctt models
+ * respectively.
+ *
+ * As get_urc_pvalue(), but for several test statistics
+ * at once: the response-surface critical values for @n
+ * are computed just once. Missing values in @tau give
+ * missing p-values.
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int get_urc_pvalues (const double *tau, double *pval, int k,
+		     int n, int niv, int itv)
+{
+    int (*pvfunc)(const double *, double *, int, int, int, int);
+
+    pvfunc = get_plugin_function("mackinnon_pvalues");
+    if (pvfunc == NULL) {
+	return E_FOPEN;
+    }
+
+    return (*pvfunc)(tau, pval, k, n, niv, itv);
+}
+
 static double get_mackinnon_pvalue (adf_info *ainfo)
 {
     int asy = (ainfo->kmax > 0 || ainfo->order > 0);
@@ -1443,14 +1595,21 @@ static int real_adf_test (adf_info *ainfo, DATASET *dset,
     if (opt & OPT_F) {
 	/* difference the target series before testing */
 	int t1 = dset->t1;
+	int vd = dset->v;
 
+	if (dataset_add_series(dset, 1)) {
+	    return E_ALLOC;
+	}
 	dset->t1 = 0;
-	ainfo->v = diffgenr(ainfo->v, DIFF, dset);
+	err = transform_values(DIFF, ainfo->v, 0, dset->Z[vd],
+			       dset->varname[vd], dset);
 	dset->t1 = t1;
-	if (ainfo->v < 0) {
-	    return E_DATA;
+	if (err) {
+	    dataset_drop_last_variables(dset, 1);
+	    return err;
 	}
-	ainfo->vname = dset->varname[ainfo->v];
+	ainfo->v = vd;
+	ainfo->vname = dset->varname[vd];
     }
 
     if ((opt & OPT_D) && dset->pd > 1) {
@@ -2040,6 +2199,55 @@ int levin_lin_test (int vnum, const int *plist,
  * Returns: 0 on successful completion, non-zero on error.
  */
 
+/* When a unit-root test is applied to several series, allocate
+   vectors to hold the per-series test statistics and p-values,
+   which are recorded as a whole on completion.
+*/
+
+static int batch_results_init (const int *list, gretl_matrix **ptests,
+			       gretl_matrix **ppvals)
+{
+    *ptests = gretl_column_vector_alloc(list[0]);
+    *ppvals = gretl_column_vector_alloc(list[0]);
+
+    if (*ptests == NULL || *ppvals == NULL) {
+	gretl_matrix_free(*ptests);
+	gretl_matrix_free(*ppvals);
+	*ptests = *ppvals = NULL;
+	return E_ALLOC;
+    }
+
+    return 0;
+}
+
+static void batch_results_add (gretl_matrix *tests, gretl_matrix *pvals,
+			       int i)
+{
+    tests->val[i] = get_last_test_statistic();
+    pvals->val[i] = get_last_pvalue();
+}
+
+static void batch_results_record (gretl_matrix *tests, gretl_matrix *pvals,
+				  const int *list, const DATASET *dset,
+				  int err)
+{
+    if (err) {
+	gretl_matrix_free(tests);
+	gretl_matrix_free(pvals);
+    } else {
+	char **S = strings_array_new(list[0]);
+	int i;
+
+	if (S != NULL) {
+	    for (i=0; i<list[0]; i++) {
+		S[i] = gretl_strdup(dset->varname[list[i+1]]);
+	    }
+	    gretl_matrix_set_rownames(tests, S);
+	}
+	record_matrix_test_result(tests, pvals);
+    }
+}
+
 int adf_test (int order, const int *list, DATASET *dset,
 	      gretlopt opt, PRN *prn)
 {
@@ -2065,9 +2273,15 @@ int adf_test (int order, const int *list, DATASET *dset,
 	err = panel_DF_test(list[1], order, dset, opt, prn);
     } else {
 	/* regular time series case */
+	gretl_matrix *tests = NULL;
+	gretl_matrix *pvals = NULL;
 	int i, v, vlist[2] = {1, 0};
 	adf_info ainfo = {0};
 
+	if (list[0] > 1) {
+	    err = batch_results_init(list, &tests, &pvals);
+	}
+
 	ainfo.niv = 1;
 	if (opt & OPT_V) {
 	    int vlevel = get_optval_int(ADF, OPT_V, &err);
@@ -2100,9 +2314,16 @@ int adf_test (int order, const int *list, DATASET *dset,
 	    if (!err) {
 		err = real_adf_test(&ainfo, dset, opt, prn);
 	    }
+	    if (!err && tests != NULL) {
+		batch_results_add(tests, pvals, i-1);
+	    }
 	    dset->t1 = save_t1;
 	    dset->t2 = save_t2;
 	}
+
+	if (tests != NULL) {
+	    batch_results_record(tests, pvals, list, dset, err);
+	}
     }
 
     dset->t1 = save_t1;
@@ -2572,8 +2793,14 @@ int kpss_test (int order, const int *list, DATASET *dset,
 	err = panel_kpss_test(order, list[1], dset, opt, prn);
     } else {
 	/* regular time series case */
+	gretl_matrix *tests = NULL;
+	gretl_matrix *pvals = NULL;
 	int i, v, vlist[2] = {1, 0};
 
+	if (list[0] > 1) {
+	    err = batch_results_init(list, &tests, &pvals);
+	}
+
 	for (i=1; i<=list[0] && !err; i++) {
 	    v = list[i];
 	    vlist[1] = v;
@@ -2582,9 +2809,16 @@ int kpss_test (int order, const int *list, DATASET *dset,
 	    if (!err) {
 		err = real_kpss_test(order, v, dset, opt, NULL, prn);
 	    }
+	    if (!err && tests != NULL) {
+		batch_results_add(tests, pvals, i-1);
+	    }
 	    dset->t1 = save_t1;
 	    dset->t2 = save_t2;
 	}
+
+	if (tests != NULL) {
+	    batch_results_record(tests, pvals, list, dset, err);
+	}
     }
 
     dset->t1 = save_t1;
@@ -34,6 +34,9 @@ int engle_granger_test (int order, const int *list, DATASET *dset,
 
 double get_urc_pvalue (double tau, int n, int niv, int itv);
 
+int get_urc_pvalues (const double *tau, double *pval, int k,
+		     int n, int niv, int itv);
+
 gretl_matrix *kpss_critvals (int T, int trend, int *err);
 
 #endif /* ADF_KPSS_H */
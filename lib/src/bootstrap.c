@@ -23,6 +23,7 @@
 #include "gretl_xml.h"
 #include "qr_estimate.h"
 #include "bootstrap.h"
+#include "gretl_mt.h"
 
 #define BDEBUG 0
 
@@ -470,14 +471,50 @@ static int ldv_lag (boot *bs, int k)
     return 0;
 }
 
-static void make_normal_y (boot *bs)
+/* The random input for one replication is drawn by boot_draw(),
+   into the integer array @z or the double array @xz, depending on
+   the method; the artificial data are then constructed from these
+   drawings by one of the make_* functions below. Splitting the two
+   steps allows the drawings to be made serially, in a fixed order,
+   while the replications themselves are run in parallel.
+*/
+
+static void boot_draw (boot *bs, int *z, double *xz)
+{
+    if (resampling_u(bs)) {
+	if (bs->blocklen > 1) {
+	    int n = bs->T / bs->blocklen + (bs->T % bs->blocklen > 0);
+	    int rmax = bs->T - bs->blocklen;
+
+	    if (rmax >= 0) {
+		gretl_rand_int_minmax(z, n, 0, rmax);
+	    }
+	} else {
+	    /* T uniform drawings from [0 .. T-1] */
+	    gretl_rand_int_minmax(z, bs->T, 0, bs->T - 1);
+	}
+    } else if (resampling_pairs(bs)) {
+	gretl_rand_int_minmax(z, bs->T, 0, bs->T - 1);
+    } else if (wild_boot(bs)) {
+	if (bs->flags & BOOT_WILD_M) {
+	    gretl_rand_uniform(xz, 0, bs->T - 1);
+	} else {
+	    gretl_rand_int_minmax(z, bs->T, 0, 1);
+	}
+    } else {
+	gretl_rand_normal(xz, 0, bs->T - 1);
+    }
+}
+
+static void make_normal_y (boot *bs, const double *xz)
 {
     double xti;
     int i, t, p;
 
-    /* generate scaled normal errors */
-    gretl_matrix_random_fill(bs->y, D_NORMAL);
-    gretl_matrix_multiply_by_scalar(bs->y, bs->SER0);
+    /* scaled normal errors */
+    for (t=0; t<bs->T; t++) {
+	bs->y->val[t] = xz[t] * bs->SER0;
+    }
 
     /* construct y recursively */
     for (t=0; t<bs->X->rows; t++) {
@@ -492,13 +529,32 @@ static void make_normal_y (boot *bs)
     }  	
 }
 
+/* resample blocks of @u0 into @u, following the block
+   starting points in @z */
+
 static void 
-resample_vector (const gretl_matrix *u0, gretl_matrix *u, int *z)
+block_resample_vector (const gretl_matrix *u0, gretl_matrix *u,
+		       int blocklen, const int *z)
 {
-    int t, T = u->rows;
+    int T = u->rows;
+    int n = T / blocklen + (T % blocklen > 0);
+    int b, s, t = 0;
+
+    if (T - blocklen < 0) {
+	return;
+    }
+
+    for (b=0; b<n && t<T; b++) {
+	for (s=0; s<blocklen && t<T; s++) {
+	    u->val[t++] = u0->val[z[b] + s];
+	}
+    }
+}
 
-    /* generate T uniform drawings from [0 .. T-1] */
-    gretl_rand_int_minmax(z, T, 0, T-1);
+static void 
+resample_vector (const gretl_matrix *u0, gretl_matrix *u, const int *z)
+{
+    int t, T = u->rows;
 
     /* sample from source vector based on indices */
     for (t=0; t<T; t++) {
@@ -508,7 +564,7 @@ resample_vector (const gretl_matrix *u0, gretl_matrix *u, int *z)
 
 #define HAC_DEBUG 0
 
-static void make_resampled_y (boot *bs, int *z)
+static void make_resampled_y (boot *bs, const int *z)
 {
     double xti;
     int i, t, p;
@@ -520,7 +576,7 @@ static void make_resampled_y (boot *bs, int *z)
 
     /* resample the residuals, into y */
     if (bs->blocklen > 1) {
-	gretl_matrix_block_resample2(bs->y, bs->u0, bs->blocklen, z);
+	block_resample_vector(bs->u0, bs->y, bs->blocklen, z);
     } else {
 	resample_vector(bs->u0, bs->y, z);
     }
@@ -558,25 +614,19 @@ static void make_resampled_y (boot *bs, int *z)
    0.28. (Mammen, 1993)
 */
 
-static void make_wild_y (boot *bs, int *z, double *xz)
+static void make_wild_y (boot *bs, const int *z, const double *xz)
 {
-    static double pminus, mminus, mplus;
+    double pminus = 0, mminus = 0, mplus = 0;
     double xti;
     int i, t, p;
 
     if (bs->flags & BOOT_WILD_M) {
 	/* Mammen */
-	if (pminus == 0.0) {
-	    double r5 = sqrt(5.0);
+	double r5 = sqrt(5.0);
 
-	    pminus = (r5 + 1)/(2*r5);
-	    mminus = -(r5 - 1)/2.0;
-	    mplus = (r5 + 1)/2.0;
-	}
-	gretl_rand_uniform(xz, 0, bs->T - 1);
-    } else {
-	/* Rademacher */
-	gretl_rand_int_minmax(z, bs->T, 0, 1);
+	pminus = (r5 + 1)/(2*r5);
+	mminus = -(r5 - 1)/2.0;
+	mplus = (r5 + 1)/2.0;
     }
 
     /* construct y recursively */
@@ -598,14 +648,11 @@ static void make_wild_y (boot *bs, int *z, double *xz)
     }
 }
 
-static void make_resampled_pairs (boot *bs, int *z)
+static void make_resampled_pairs (boot *bs, const int *z)
 {
     double xti;
     int i, s, t;
 
-    /* fill the resampling array */
-    gretl_rand_int_minmax(z, bs->T, 0, bs->T-1);
-
     /* fill y and X with resampled "pairs" */
     for (t=0; t<bs->T; t++) {
 	s = z[t];
@@ -1115,6 +1162,197 @@ static double boot_tau (boot *bs,
     return (b->val[j] - bs->bp0) / se;
 }
 
+/* Per-thread workspace for bootstrap replications: a shallow copy
+   of the main struct with private y (and, if the regressors vary
+   across replications, private X and factorization), plus private
+   results storage. When X is fixed the factorization of the
+   original X (Cholesky or QR) is shared, read-only, and each
+   replication just needs X'y followed by triangular solves.
+*/
+
+typedef struct bootwork_ bootwork;
+
+struct bootwork_ {
+    boot b;             /* copy of main struct, private y and X */
+    gretl_matrix *XTX;  /* X'X, Cholesky-decomposed */
+    gretl_matrix *XTXI; /* X'X^{-1} */
+    gretl_matrix *Q;    /* for use with QR decomp */
+    gretl_matrix *R;    /* for use with QR decomp */
+    gretl_matrix *g;    /* workspace, QR decomp */
+    gretl_matrix *d;    /* workspace */
+    gretl_matrix *bj;   /* re-estimated coeffs */
+    gretl_matrix *V;    /* covariance matrix */
+    int own_X;          /* X and its decomposition are private? */
+};
+
+static void boot_work_free (bootwork *w)
+{
+    if (w != NULL) {
+	gretl_matrix_free(w->b.y);
+	if (w->own_X) {
+	    gretl_matrix_free(w->b.X);
+	    gretl_matrix_free(w->XTX);
+	    gretl_matrix_free(w->XTXI);
+	    gretl_matrix_free(w->Q);
+	    gretl_matrix_free(w->R);
+	}
+	gretl_matrix_free(w->g);
+	gretl_matrix_free(w->d);
+	gretl_matrix_free(w->bj);
+	gretl_matrix_free(w->V);
+	free(w);
+    }
+}
+
+static bootwork *boot_work_new (const boot *bs, int own_X,
+				gretl_matrix *XTX,
+				gretl_matrix *XTXI,
+				gretl_matrix *Q,
+				gretl_matrix *R)
+{
+    bootwork *w = malloc(sizeof *w);
+    int k = bs->k;
+    int err = 0;
+
+    if (w == NULL) {
+	return NULL;
+    }
+
+    w->b = *bs;
+    w->own_X = own_X;
+    w->b.y = gretl_matrix_copy(bs->y);
+    w->g = w->V = NULL;
+    w->d = gretl_column_vector_alloc(bs->T);
+    w->bj = gretl_column_vector_alloc(k);
+
+    if (own_X) {
+	w->b.X = gretl_matrix_copy(bs->X);
+	w->XTXI = gretl_matrix_alloc(k, k);
+	w->XTX = w->Q = w->R = NULL;
+	if (Q != NULL) {
+	    w->Q = gretl_matrix_alloc(bs->T, k);
+	    w->R = gretl_matrix_alloc(k, k);
+	    err = (w->Q == NULL || w->R == NULL);
+	} else {
+	    w->XTX = gretl_matrix_alloc(k, k);
+	    err = (w->XTX == NULL);
+	}
+	err = err || w->b.X == NULL || w->XTXI == NULL;
+    } else {
+	/* share the decomposition of the original X */
+	w->XTX = XTX;
+	w->XTXI = XTXI;
+	w->Q = Q;
+	w->R = R;
+    }
+
+    if (Q != NULL) {
+	w->g = gretl_matrix_alloc(k, 1);
+	err = err || w->g == NULL;
+    }
+
+    if (bs->hc_version >= 0 || boot_use_hac(bs) || doing_Ftest(bs)) {
+	/* covariance matrix needed */
+	w->V = gretl_matrix_alloc(k, k);
+	err = err || w->V == NULL;
+    }
+
+    if (err || w->b.y == NULL || w->d == NULL || w->bj == NULL) {
+	boot_work_free(w);
+	w = NULL;
+    }
+
+    return w;
+}
+
+/* Run one replication, given its random drawings @z or @xz,
+   writing the statistic of interest into @stat (the F-test, the
+   bootstrap t-statistic if wanted, otherwise the coefficient) and
+   the coefficient itself into @bp.
+*/
+
+static int boot_round (bootwork *w, const gretl_matrix *h,
+		       const int *z, const double *xz,
+		       double *stat, double *bp)
+{
+    boot *bs = &w->b;
+    gretl_matrix *b = w->bj;
+    gretl_matrix *V = w->V;
+    gretl_matrix *d = w->d;
+    double s2 = 0, tau = 0;
+    int err = 0;
+
+    if (resampling_u(bs)) {
+	make_resampled_y(bs, z);
+    } else if (resampling_pairs(bs)) {
+	make_resampled_pairs(bs, z);
+    } else if (wild_boot(bs)) {
+	make_wild_y(bs, z, xz);
+    } else {
+	make_normal_y(bs, xz);
+    }
+
+    if (w->own_X) {
+	/* If the X matrix includes lags of the dependent variable,
+	   it has to be rewritten, and X'X-inverse (or Q and R)
+	   recalculated. If we're doing the pairs bootstrap, X will
+	   have been revised already but again X'X-inverse or Q, R
+	   need redoing.
+	*/
+	if (bs->ldv != NULL) {
+	    recreate_ldv_X(bs);
+	}
+	err = boot_calc_1(bs, w->XTX, w->XTXI, w->Q, w->R, NULL);
+    }
+
+    if (!err) {
+	err = boot_calc_2(bs, w->XTX, w->Q, w->R, w->g, b, d, &s2);
+    }
+
+    if (err) {
+	return err;
+    }
+
+    *bp = b->val[bs->p];
+
+    if (doing_Ftest(bs)) {
+	if (bs->hc_version >= 0) {
+	    err = qr_matrix_hccme(bs->X, h, w->XTXI, d,
+				  V, bs->hc_version);
+	} else if (boot_use_hac(bs)) {
+	    err = boot_hac_vcv(bs, w->XTXI, d, V);
+	} else {
+	    gretl_matrix_copy_values(V, w->XTXI);
+	    gretl_matrix_multiply_by_scalar(V, s2);
+	}
+	if (!err) {
+	    *stat = bs_F_test(b, V, bs, &err);
+	}
+	return err;
+    }
+
+    if (tau_wanted(bs)) {
+	/* bootstrap t-statistic */
+	if (bs->hc_version >= 0) {
+	    tau = boot_hc_tau(bs, w->XTXI, b, h, d, V, &err);
+	} else if (boot_use_hac(bs)) {
+	    tau = boot_hac_tau(bs, w->XTXI, b, d, V, &err);
+	} else {
+	    tau = boot_tau(bs, w->XTXI, b, s2);
+	}
+	*stat = tau;
+    } else {
+	*stat = *bp;
+    }
+
+    return err;
+}
+
+/* number of replications whose random drawings are made
+   at one go, before being shared out among threads */
+
+#define BOOT_BATCH 256
+
 /* Do the actual bootstrap analysis: the objective is either to form a
    confidence interval or to compute a p-value; the methodology is
    one of
@@ -1123,6 +1361,12 @@ static double boot_tau (boot *bs,
    - resampling the y, X pairs
    - wild bootstrap (Davidson-Flachaire)
    - simulate normal errors with the empirically given variance
+
+   The random drawings for each batch of replications are made
+   serially, in the order in which sequential code would make
+   them, and the replications in the batch are then run in
+   parallel. So for a given seed the results don't depend on the
+   number of threads.
 */
 
 static int real_bootstrap (boot *bs, gretl_matrix *ci, PRN *prn)
@@ -1131,19 +1375,19 @@ static int real_bootstrap (boot *bs, gretl_matrix *ci, PRN *prn)
     gretl_matrix *XTXI = NULL;  /* X'X^{-1} */
     gretl_matrix *Q = NULL;     /* for use with QR decomp */
     gretl_matrix *R = NULL;     /* for use with QR decomp */
-    gretl_matrix *g = NULL;     /* workspace, QR decomp */
     gretl_matrix *h = NULL;     /* "hat" vector (QR) */
-    gretl_matrix *d = NULL;     /* workspace */
-    gretl_matrix *b = NULL;     /* re-estimated coeffs */
-    gretl_matrix *V = NULL;     /* covariance matrix */
     gretl_matrix *r = NULL;     /* recorder for results */
-    int *z = NULL;              /* integer resampling array */
+    double *bp = NULL;          /* recorder for coefficient */
+    int *errs = NULL;           /* per-replication error codes */
+    int *z = NULL;              /* integer resampling arrays */
     double *xz = NULL;          /* random doubles */
     int k = bs->k;
-    int p = bs->p;
+    int nz = 0, nx = 0;
+    int own_X = 0;
     int tail = 0;
     int use_qr = 0;
     int use_h = 0;
+    int stop = 0;
     int j, err = 0;
 
     if ((bs->flags & BOOT_PVAL) && !resampling_pairs(bs)) {
@@ -1160,11 +1404,15 @@ static int real_bootstrap (boot *bs, gretl_matrix *ci, PRN *prn)
 	use_qr = use_h = 1;
     }
 
-    b = gretl_column_vector_alloc(k);
-    d = gretl_column_vector_alloc(bs->T);
+    /* do the regressors change across replications? */
+    own_X = bs->ldv != NULL || resampling_pairs(bs);
+
     XTXI = gretl_matrix_alloc(k, k);
+    r = gretl_matrix_alloc(bs->B, 1);
+    bp = malloc(bs->B * sizeof *bp);
+    errs = calloc(bs->B, sizeof *errs);
 
-    if (b == NULL || d == NULL || XTXI == NULL) {
+    if (XTXI == NULL || r == NULL || bp == NULL || errs == NULL) {
 	err = E_ALLOC;
 	goto bailout;
     }
@@ -1172,8 +1420,7 @@ static int real_bootstrap (boot *bs, gretl_matrix *ci, PRN *prn)
     if (use_qr) {
 	Q = gretl_matrix_alloc(bs->T, k);
 	R = gretl_matrix_alloc(k, k);
-	g = gretl_matrix_alloc(k, 1);
-	if (Q == NULL || R == NULL || g == NULL) {
+	if (Q == NULL || R == NULL) {
 	    err = E_ALLOC;
 	    goto bailout;
 	}
@@ -1193,188 +1440,147 @@ static int real_bootstrap (boot *bs, gretl_matrix *ci, PRN *prn)
 	}
     }
 
-    if (bs->flags & BOOT_WILD_M) {
-	/* wild bootstrap with Mammen distribution */
-	xz = malloc(bs->T * sizeof *xz);
+    if ((bs->flags & BOOT_WILD_M) || !(resampling(bs) || wild_boot(bs))) {
+	/* Mammen's wild bootstrap, or normal errors */
+	nx = bs->T;
+	xz = malloc(BOOT_BATCH * nx * sizeof *xz);
 	if (xz == NULL) {
 	    err = E_ALLOC;
 	    goto bailout;
 	}
-    } else if (resampling(bs) || wild_boot(bs)) {
-	/* random integer array */
-	int nz = bs->T;
-
-	if (bs->blocklen > 1) {
+    } else {
+	/* random integer arrays */
+	nz = bs->T;
+	if (resampling_u(bs) && bs->blocklen > 1) {
 	    nz = bs->T / bs->blocklen + (bs->T % bs->blocklen > 0);
 	}
-	z = malloc(nz * sizeof *z);
+	z = malloc(BOOT_BATCH * nz * sizeof *z);
 	if (z == NULL) {
 	    err = E_ALLOC;
 	    goto bailout;
 	}
     }
 
-    if (bs->flags & (BOOT_CI | BOOT_GRAPH | BOOT_SAVE)) {
-	/* storage for results */
-	r = gretl_matrix_alloc(bs->B, 1);
-	if (r == NULL) {
-	    err = E_ALLOC;
-	    goto bailout;
-	}
-    }	
-
-    if (bs->hc_version >= 0 || boot_use_hac(bs) || doing_Ftest(bs)) {
-	/* covariance matrix needed */
-	V = gretl_matrix_alloc(k, k);
-	if (V == NULL) {
-	    err = E_ALLOC;
-	    goto bailout;
-	}
-    }
-
     err = boot_calc_1(bs, XTX, XTXI, Q, R, h);
 
     if (resampling_u(bs) || wild_boot(bs)) {
 	rescale_residuals(bs, h);
     }
 
-    if (!err && verbose(bs)) {
-	if (doing_Ftest(bs)) {
-	    pputc(prn, '\n');
-	} else {
-	    pprintf(prn, "%13s %13s\n", "b", "tval");
-	}
+    if (err) {
+	goto bailout;
     }
 
     /* carry out B replications */
 
-    for (j=0; j<bs->B && !err; j++) {
-	double s2 = 0, tau = 0;
-
-#if BDEBUG > 1
-	fprintf(stderr, "real_bootstrap: round %d\n", j);
+#if defined(_OPENMP)
+#pragma omp parallel if (!verbose(bs) && gretl_use_openmp((guint64) bs->B * bs->T * k))
 #endif
+    {
+	bootwork *w = boot_work_new(bs, own_X, XTX, XTXI, Q, R);
+	int j0, nj, i;
 
-	if (resampling_u(bs)) {
-	    make_resampled_y(bs, z);
-	} else if (resampling_pairs(bs)) {
-	    make_resampled_pairs(bs, z);
-	} else if (wild_boot(bs)) {
-	    make_wild_y(bs, z, xz);
-	} else {
-	    make_normal_y(bs);
+	if (w == NULL) {
+#if defined(_OPENMP)
+#pragma omp critical
+#endif
+	    err = E_ALLOC;
 	}
 
-	if (bs->ldv != NULL || resampling_pairs(bs)) {
-	    /* If the X matrix includes lags of the dependent variable,
-	       it has to be rewritten, and X'X-inverse (or Q and R) 
-	       recalculated. If we're doing the pairs bootstrap, X will
-	       have been revised already but again X'X-inverse or Q, R
-	       need redoing.
-	    */
-	    if (bs->ldv != NULL) {
-		recreate_ldv_X(bs);
+	/* note: @stop is written only within the "single" block,
+	   which ends in a barrier, so all threads see the same
+	   value at the top of the loop */
+	for (j0=0; j0<bs->B && !stop; j0+=BOOT_BATCH) {
+	    nj = MIN(BOOT_BATCH, bs->B - j0);
+#if defined(_OPENMP)
+#pragma omp single
+#endif
+	    {
+		stop = gretl_progress("bootstrap", j0, bs->B);
+		for (i=0; i<nj && !stop; i++) {
+		    boot_draw(bs, z + i * nz, xz + i * nx);
+		}
+	    }
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+	    for (i=0; i<nj; i++) {
+		if (w != NULL && !stop) {
+		    errs[j0+i] = boot_round(w, h, z + i * nz, xz + i * nx,
+					    &r->val[j0+i], &bp[j0+i]);
+		}
 	    }
-	    err = boot_calc_1(bs, XTX, XTXI, Q, R, NULL);
 	}
 
-	if (!err) {
-	    err = boot_calc_2(bs, XTX, Q, R, g, b, d, &s2);
-	}
+	boot_work_free(w);
+    }
 
-	if (err) {
-	    break;
-	}	
+    if (stop) {
+	err = E_STOP;
+    }
+
+    for (j=0; j<bs->B && !err; j++) {
+	err = errs[j];
+    }
+
+    if (err) {
+	goto bailout;
+    }
 
+    if (verbose(bs)) {
 	if (doing_Ftest(bs)) {
-	    double test = 0;
-	    
-	    if (bs->hc_version >= 0) {
-		err = qr_matrix_hccme(bs->X, h, XTXI, d,
-				      V, bs->hc_version);
-	    } else if (boot_use_hac(bs)) {
-		err = boot_hac_vcv(bs, XTXI, d, V);
-	    } else {
-		gretl_matrix_copy_values(V, XTXI);
-		gretl_matrix_multiply_by_scalar(V, s2);
-	    }
-	    if (!err) {
-		test = bs_F_test(b, V, bs, &err);
-		if (verbose(bs)) {
-		    print_test_round(bs, j, test, prn);
-		}
+	    pputc(prn, '\n');
+	} else {
+	    pprintf(prn, "%13s %13s\n", "b", "tval");
+	}
+    }
+
+    for (j=0; j<bs->B; j++) {
+	if (doing_Ftest(bs)) {
+	    if (verbose(bs)) {
+		print_test_round(bs, j, r->val[j], prn);
 	    }
-	    if (test > bs->test0) {
+	    if (r->val[j] > bs->test0) {
 		tail++;
 	    }
-	    if (bs->flags & (BOOT_GRAPH | BOOT_SAVE)) {
-		r->val[j] = test;
-	    }
 	    continue;
 	}
-
-	if (tau_wanted(bs)) {
-	    /* bootstrap t-statistic */
-	    if (bs->hc_version >= 0) {
-		tau = boot_hc_tau(bs, XTXI, b, h, d, V, &err);
-	    } else if (boot_use_hac(bs)) {
-		tau = boot_hac_tau(bs, XTXI, b, d, V, &err);
-	    } else {
-		tau = boot_tau(bs, XTXI, b, s2);
-	    }
-	    if (verbose(bs)) {
-		pprintf(prn, "%13g %13g\n", b->val[p], tau);
-	    }
+	if (tau_wanted(bs) && verbose(bs)) {
+	    pprintf(prn, "%13g %13g\n", bp[j], r->val[j]);
 	}
-
 	if (bs->flags & BOOT_CI) {
-	    /* doing a confidence interval */
-	    if (studentizing(bs)) {
-		/* record bootstrap t-stat */
-		r->val[j] = tau;
-	    } else {
-		/* record bootstrap coeff */
-		r->val[j] = b->val[p];
-	    }
-	} else {
+	    /* recording bootstrap coeff or t-stat */
+	    ;
+	} else if (fabs(r->val[j]) > fabs(bs->test0)) {
 	    /* doing p-value */
-	    if (bs->flags & (BOOT_GRAPH | BOOT_SAVE)) {
-		r->val[j] = tau;
-	    }
-	    if (fabs(tau) > fabs(bs->test0)) {
-		tail++;
-	    }
+	    tail++;
 	}
     }
 
-    if (!err) {
-	if (ci != NULL) {
-	    bs_calc_ci(bs, r, ci);
-	} else if (bs->flags & BOOT_PVAL) {
-	    bs->pval = (double) tail / bs->B;
-	    record_test_result(bs->test0, bs->pval);
-	}
-	if (!(bs->flags & BOOT_SILENT)) {
-	    bs_print_result(bs, r, tail, prn);
-	}	
-	if (bs->flags & BOOT_SAVE) {
-	    bs_store_result(bs, &r);
-	}
+    if (ci != NULL) {
+	bs_calc_ci(bs, r, ci);
+    } else if (bs->flags & BOOT_PVAL) {
+	bs->pval = (double) tail / bs->B;
+	record_test_result(bs->test0, bs->pval);
+    }
+    if (!(bs->flags & BOOT_SILENT)) {
+	bs_print_result(bs, r, tail, prn);
+    }	
+    if (bs->flags & BOOT_SAVE) {
+	bs_store_result(bs, &r);
     }
 
  bailout:
 
-    gretl_matrix_free(b);
     gretl_matrix_free(XTX);
     gretl_matrix_free(XTXI);
     gretl_matrix_free(Q);
     gretl_matrix_free(R);
-    gretl_matrix_free(g);
     gretl_matrix_free(h);
-    gretl_matrix_free(d);
-    gretl_matrix_free(V);
     gretl_matrix_free(r);
 
+    free(bp);
+    free(errs);
     free(z);
     free(xz);
     
@@ -55,6 +55,52 @@ static int days_in_month[2][13] = {
 */
 #define JDN_ADJ 1721425
 
+/* The number that must be added to an epoch day to obtain the
+   count of days since 1 March of the (proleptic Gregorian) year 0,
+   the origin used by the integer conversions below.
+*/
+#define MAR1_ADJ 305
+
+/* Integer conversion from Gregorian y, m, d to epoch day, and back,
+   following the "days from civil" algorithm of H. Hinnant. Shifting
+   the start of the year to 1 March puts the leap day at the end,
+   after which every 400-year era has the same length. These
+   functions do no validation: callers must check their input.
+*/
+
+static inline guint32 civil_to_epoch_day (int y, int m, int d)
+{
+    int yoe, doy, doe, era;
+
+    y -= (m <= 2);
+    era = y / 400;
+    yoe = y - era * 400;
+    doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    doe = yoe * 365 + yoe/4 - yoe/100 + doy;
+
+    return (guint32) era * 146097 + doe - MAR1_ADJ;
+}
+
+static inline void epoch_day_to_civil (guint32 ed, int *y, int *m, int *d)
+{
+    guint32 z = ed + MAR1_ADJ;
+    int era = z / 146097;
+    int doe = z - era * 146097;
+    int yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+    int doy = doe - (365 * yoe + yoe/4 - yoe/100);
+    int mp = (5 * doy + 2) / 153;
+
+    *d = doy - (153 * mp + 2)/5 + 1;
+    *m = mp < 10 ? mp + 3 : mp - 9;
+    *y = yoe + era * 400 + (*m <= 2);
+}
+
+/* Monday = 1 to Sunday = 7, for @ed >= 1 */
+#define epoch_day_weekday(ed) ((int) (((ed) - 1 + DAY1 - 1) % 7) + 1)
+
+/* upper limit as for GDate, which stores the year as guint16 */
+#define MAX_EPOCH_DAY 23936166
+
 /* Note on the GLib API used below: where "julian" occurs in the names
    of GLib calendrical functions it refers to the "Julian day"; that is,
    the number of days since some fixed starting point, as used by
@@ -122,16 +168,11 @@ static int day_of_week_from_ymd (int y, int m, int d, int julian)
 
 guint32 epoch_day_from_ymd (int y, int m, int d)
 {
-    GDate date;
-
     if (!g_date_valid_dmy(d, m, y)) {
 	return 0;
     }
 
-    g_date_clear(&date, 1);
-    g_date_set_dmy(&date, d, m, y);
-
-    return g_date_get_julian(&date);
+    return civil_to_epoch_day(y, m, d);
 }
 
 /**
@@ -150,7 +191,6 @@ guint32 epoch_day_from_ymd (int y, int m, int d)
 
 guint32 nearby_epoch_day (int y, int m, int d, int wkdays)
 {
-    GDate date;
     int dow;
     guint32 j;
 
@@ -158,10 +198,8 @@ guint32 nearby_epoch_day (int y, int m, int d, int wkdays)
 	return 0;
     }
 
-    g_date_clear(&date, 1);
-    g_date_set_dmy(&date, d, m, y);
-    j = g_date_get_julian(&date);
-    dow = g_date_get_weekday(&date);
+    j = civil_to_epoch_day(y, m, d);
+    dow = epoch_day_weekday(j);
 
     if (wkdays != 7 && dow == G_DATE_SUNDAY) {
 	j++;
@@ -187,18 +225,51 @@ guint32 nearby_epoch_day (int y, int m, int d, int wkdays)
 
 int ymd_bits_from_epoch_day (guint32 ed, int *y, int *m, int *d)
 {
-    GDate date;
-
-    if (!g_date_valid_julian(ed)) {
+    if (ed == 0 || ed > MAX_EPOCH_DAY) {
 	return E_INVARG;
     }
 
-    g_date_clear(&date, 1);
-    g_date_set_julian(&date, ed);
+    epoch_day_to_civil(ed, y, m, d);
 
-    *y = g_date_get_year(&date);
-    *m = g_date_get_month(&date);
-    *d = g_date_get_day(&date);
+    return 0;
+}
+
+/**
+ * ymd_basic_from_epoch_days:
+ * @ed: array of epoch days.
+ * @targ: array to be filled.
+ * @n: number of elements in @ed and @targ.
+ * @julian: non-zero to use Julian calendar, otherwise Gregorian.
+ *
+ * Vector version of ymd_basic_from_epoch_day(): fills @targ with
+ * YYYYMMDD values corresponding to the epoch days in @ed. Missing
+ * values in @ed are passed through as #NADBL. @ed and @targ may
+ * be the same array.
+ *
+ * Returns: 0 on success, E_INVARG if any non-missing element of
+ * @ed is not a valid epoch day.
+ */
+
+int ymd_basic_from_epoch_days (const double *ed, double *targ,
+			       int n, int julian)
+{
+    int y, m, d;
+    int i;
+
+    for (i=0; i<n; i++) {
+	if (na(ed[i])) {
+	    targ[i] = NADBL;
+	} else if (ed[i] < 1 || ed[i] > MAX_EPOCH_DAY) {
+	    return E_INVARG;
+	} else {
+	    if (julian) {
+		julian_ymd_bits_from_epoch_day((guint32) ed[i], &y, &m, &d);
+	    } else {
+		epoch_day_to_civil((guint32) ed[i], &y, &m, &d);
+	    }
+	    targ[i] = 10000*y + 100*m + d;
+	}
+    }
 
     return 0;
 }
@@ -396,16 +467,11 @@ guint32 epoch_day_from_ymd_basic (double ymd)
 
 int weekday_from_epoch_day (guint32 ed)
 {
-    GDate date;
-
-    if (!g_date_valid_julian(ed)) {
+    if (ed == 0 || ed > MAX_EPOCH_DAY) {
 	return 0;
     }
 
-    g_date_clear(&date, 1);
-    g_date_set_julian(&date, ed);
-
-    return g_date_get_weekday(&date);
+    return epoch_day_weekday(ed);
 }
 
 /**
@@ -416,13 +482,55 @@ int weekday_from_epoch_day (guint32 ed)
  * Returns: the epoch day number, or 0 on failure.
  */
 
+/* Fast path for get_epoch_day(): parse a date of the form
+   YYYY-MM-DD or YY-MM-DD (or the same with slashes) without
+   recourse to sscanf, as may be done for every observation of
+   a daily dataset. Returns the number of year digits, or 0 if
+   @s doesn't have this form.
+*/
+
+static int quick_parse_ymd (const char *s, int *y, int *m, int *d)
+{
+    const char *p = s;
+    char sep;
+    int ny, nd;
+
+    for (*y=0, ny=0; isdigit((unsigned char) *p); p++, ny++) {
+	*y = 10 * *y + (*p - '0');
+    }
+    if (ny != 4 && ny != 2) {
+	return 0;
+    }
+    sep = *p++;
+    if (sep != '-' && sep != '/') {
+	return 0;
+    }
+    for (*m=0, nd=0; isdigit((unsigned char) *p); p++, nd++) {
+	*m = 10 * *m + (*p - '0');
+    }
+    if (nd < 1 || nd > 2 || *p++ != sep) {
+	return 0;
+    }
+    for (*d=0, nd=0; isdigit((unsigned char) *p); p++, nd++) {
+	*d = 10 * *d + (*p - '0');
+    }
+    if (nd < 1 || nd > 2) {
+	return 0;
+    }
+
+    return ny;
+}
+
 guint32 get_epoch_day (const char *datestr)
 {
-    GDate date;
     int y, m, d, nf = 0;
-    int ydigits = 0;
+    int ydigits;
 
-    if (strchr(datestr, '-')) {
+    ydigits = quick_parse_ymd(datestr, &y, &m, &d);
+
+    if (ydigits > 0) {
+	nf = 3;
+    } else if (strchr(datestr, '-')) {
 	ydigits = strcspn(datestr, "-");
 	nf = sscanf(datestr, YMD_READ_FMT, &y, &m, &d);
     } else if (strchr(datestr, '/')) {
@@ -445,10 +553,7 @@ guint32 get_epoch_day (const char *datestr)
 	return 0;
     }
 
-    g_date_clear(&date, 1);
-    g_date_set_dmy(&date, d, m, y);
-
-    return g_date_get_julian(&date);
+    return civil_to_epoch_day(y, m, d);
 }
 
 /* Note that ed0 cannot be a Sunday, since we're working with a 5- or
@@ -568,6 +673,74 @@ guint32 epoch_day_from_t (int t, const DATASET *dset)
     return dt;
 }
 
+/**
+ * calendar_epoch_days:
+ * @dset: pointer to dataset.
+ * @t1: first 0-based observation index.
+ * @t2: last 0-based observation index.
+ * @ed: array of length at least @t2 - @t1 + 1.
+ *
+ * Fills @ed with the epoch days of observations @t1 to @t2 of
+ * a calendar dataset: @ed[0] corresponds to @t1. If @dset has
+ * date strings as observation markers these are taken as
+ * authoritative; otherwise the days are generated from the
+ * starting date and the periodicity of @dset, without any
+ * per-observation division or string handling.
+ *
+ * Returns: 0 on success, non-zero on error.
+ */
+
+int calendar_epoch_days (const DATASET *dset, int t1, int t2,
+			 guint32 *ed)
+{
+    int n = t2 - t1 + 1;
+    int i, dow;
+
+    if (!calendar_data(dset) || t1 < 0 || t2 >= dset->n || n < 1) {
+	return E_DATA;
+    } else if (dset->sd0 <= 1) {
+	gretl_errmsg_set("The dataset lacks calendrical information");
+	return E_DATA;
+    }
+
+    if (dataset_has_markers(dset)) {
+	for (i=0; i<n; i++) {
+	    ed[i] = get_epoch_day(dset->S[t1+i]);
+	    if (ed[i] == 0) {
+		return E_DATA;
+	    }
+	}
+	return 0;
+    }
+
+    ed[0] = epoch_day_from_t(t1, dset);
+
+    if (dset->pd == 52 || dset->pd == 7) {
+	int step = dset->pd == 52 ? 7 : 1;
+
+	for (i=1; i<n; i++) {
+	    ed[i] = ed[i-1] + step;
+	}
+    } else {
+	/* 5- or 6-day data: step over the weekends */
+	dow = epoch_day_weekday(ed[0]);
+	if (dow > dset->pd) {
+	    return E_DATA;
+	}
+	for (i=1; i<n; i++) {
+	    if (dow < dset->pd) {
+		ed[i] = ed[i-1] + 1;
+		dow++;
+	    } else {
+		ed[i] = ed[i-1] + 8 - dset->pd;
+		dow = 1;
+	    }
+	}
+    }
+
+    return 0;
+}
+
 /**
  * calendar_date_string:
  * @targ: string to be filled out.
@@ -1725,3 +1898,185 @@ char *gretl_strptime (const char *s, const char *format, double *dt)
 
     return rem;
 }
+
+/* Support for intraday data held as Unix timestamps: seconds since
+   1970-01-01 UTC, as produced by strptime() and accepted by
+   strftime(), possibly with a fractional part. Internally these are
+   put onto an integer nanosecond scale so that the assignment of
+   observations to bars is exact; the double storage itself carries
+   roughly microsecond precision for contemporary dates.
+*/
+
+#define NS_PER_SEC  G_GINT64_CONSTANT(1000000000)
+#define NS_PER_DAY  (G_GINT64_CONSTANT(86400) * NS_PER_SEC)
+#define UNIX_EPOCH_DAY 719163 /* epoch day of 1970-01-01 */
+#define MAX_TS_BARS 100000000
+
+static inline gint64 ts_to_ns (double t)
+{
+    return (gint64) llround(t * 1.0e9);
+}
+
+/* integer floor division for possibly negative @a, @b > 0 */
+
+static inline gint64 floor_div64 (gint64 a, gint64 b)
+{
+    gint64 q = a / b;
+
+    return (a % b != 0 && a < 0) ? q - 1 : q;
+}
+
+/**
+ * timestamp_search:
+ * @ts: array of non-decreasing timestamps.
+ * @n: length of @ts.
+ * @t: target timestamp.
+ *
+ * Locates @t in @ts by bisection.
+ *
+ * Returns: the 0-based index of the first element of @ts that
+ * is greater than or equal to @t, or @n if there is none.
+ */
+
+int timestamp_search (const double *ts, int n, double t)
+{
+    int lo = 0, hi = n;
+    int mid;
+
+    while (lo < hi) {
+	mid = lo + (hi - lo) / 2;
+	if (ts[mid] < t) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid;
+	}
+    }
+
+    return lo;
+}
+
+/**
+ * timestamp_bars:
+ * @ts: array of non-decreasing Unix timestamps.
+ * @x: array of values observed at @ts.
+ * @n: length of @ts and @x.
+ * @width: bar width in seconds.
+ * @err: location to receive error code.
+ *
+ * Aggregates irregularly spaced observations into bars of fixed
+ * width, aligned on multiples of @width since the Unix epoch.
+ * Observations with missing timestamp or value are skipped. The
+ * bars run from the one containing the first valid observation to
+ * the one containing the last; if @width divides a day they are
+ * extended to cover whole days, so that the rows can be arranged
+ * by day, as for a MIDAS list. Empty bars get missing prices and
+ * a count of zero.
+ *
+ * Returns: a matrix with columns holding the start time of the bar,
+ * its epoch day, open, high, low, close, and the number of
+ * observations, or NULL on failure.
+ */
+
+gretl_matrix *timestamp_bars (const double *ts, const double *x,
+			      int n, double width, int *err)
+{
+    const char *cnames[] = {
+	"time", "epochday", "open", "high", "low", "close", "nobs"
+    };
+    gretl_matrix *B = NULL;
+    char **S;
+    gint64 w, tns, b, b0 = 0, b1 = 0;
+    double prev = NADBL;
+    int nbars, nvalid = 0;
+    int i, j;
+
+    if (na(width) || width <= 0 || width * 1.0e9 < 1) {
+	*err = E_INVARG;
+	return NULL;
+    }
+
+    w = ts_to_ns(width);
+
+    for (i=0; i<n; i++) {
+	if (na(ts[i])) {
+	    continue;
+	} else if (!na(prev) && ts[i] < prev) {
+	    gretl_errmsg_set(_("Timestamps must be in non-decreasing order"));
+	    *err = E_DATA;
+	    return NULL;
+	}
+	prev = ts[i];
+	if (!na(x[i])) {
+	    b = floor_div64(ts_to_ns(ts[i]), w);
+	    if (nvalid++ == 0) {
+		b0 = b;
+	    }
+	    b1 = b;
+	}
+    }
+
+    if (nvalid == 0) {
+	*err = E_MISSDATA;
+	return NULL;
+    }
+
+    if (NS_PER_DAY % w == 0) {
+	/* pad out to whole days */
+	gint64 perday = NS_PER_DAY / w;
+
+	b0 = floor_div64(b0, perday) * perday;
+	b1 = (floor_div64(b1, perday) + 1) * perday - 1;
+    }
+
+    if (b1 - b0 + 1 > MAX_TS_BARS) {
+	gretl_errmsg_set(_("Too many bars: please use a greater width"));
+	*err = E_INVARG;
+	return NULL;
+    }
+
+    nbars = (int) (b1 - b0 + 1);
+    B = gretl_matrix_alloc(nbars, 7);
+    if (B == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    for (j=0; j<nbars; j++) {
+	tns = (b0 + j) * w;
+	gretl_matrix_set(B, j, 0, tns / 1.0e9);
+	gretl_matrix_set(B, j, 1, floor_div64(tns, NS_PER_DAY) + UNIX_EPOCH_DAY);
+	gretl_matrix_set(B, j, 2, NADBL);
+	gretl_matrix_set(B, j, 3, NADBL);
+	gretl_matrix_set(B, j, 4, NADBL);
+	gretl_matrix_set(B, j, 5, NADBL);
+	gretl_matrix_set(B, j, 6, 0);
+    }
+
+    for (i=0; i<n; i++) {
+	if (na(ts[i]) || na(x[i])) {
+	    continue;
+	}
+	j = (int) (floor_div64(ts_to_ns(ts[i]), w) - b0);
+	if (gretl_matrix_get(B, j, 6) == 0) {
+	    gretl_matrix_set(B, j, 2, x[i]);
+	    gretl_matrix_set(B, j, 3, x[i]);
+	    gretl_matrix_set(B, j, 4, x[i]);
+	} else if (x[i] > gretl_matrix_get(B, j, 3)) {
+	    gretl_matrix_set(B, j, 3, x[i]);
+	} else if (x[i] < gretl_matrix_get(B, j, 4)) {
+	    gretl_matrix_set(B, j, 4, x[i]);
+	}
+	gretl_matrix_set(B, j, 5, x[i]);
+	gretl_matrix_set(B, j, 6, gretl_matrix_get(B, j, 6) + 1);
+    }
+
+    S = strings_array_new(7);
+    if (S != NULL) {
+	for (j=0; j<7; j++) {
+	    S[j] = gretl_strdup(cnames[j]);
+	}
+	gretl_matrix_set_colnames(B, S);
+    }
+
+    return B;
+}
@@ -43,6 +43,9 @@ double ymd_basic_from_epoch_day (guint32 ed, int julian, int *err);
 
 int ymd_bits_from_epoch_day (guint32 ed, int *y, int *m, int *d);
 
+int ymd_basic_from_epoch_days (const double *ed, double *targ,
+			       int n, int julian);
+
 int julian_ymd_bits_from_epoch_day (guint32 ed, int *y, int *m, int *d);
 
 int iso_basic_to_extended (const double *b, double *y, double *m, 
@@ -76,6 +79,9 @@ int daily_index_to_date (char *targ, int y, int m, int idx,
 int calendar_obs_number (const char *datestr, const DATASET *dset,
 			 int nolimit);
 
+int calendar_epoch_days (const DATASET *dset, int t1, int t2,
+			 guint32 *ed);
+
 int calendar_date_string (char *targ, int t, const DATASET *dset);
 
 int MS_excel_date_string (char *targ, int mst, int pd, int d1904);
@@ -114,4 +120,9 @@ int gretl_strftime (char *s, int slen, const char *format,
 char *gretl_strptime (const char *s, const char *format,
 		      double *dt);
 
+int timestamp_search (const double *ts, int n, double t);
+
+gretl_matrix *timestamp_bars (const double *ts, const double *x,
+			      int n, double width, int *err);
+
 #endif /* CALENDAR_H */ 
@@ -1435,6 +1435,17 @@ void dsyrk_ (const char *UPLO, const char *TRANS, const integer *N,
 	     const integer *LDA, const double *BETA, double *C,
 	     const integer *LDC);
 
+void sgemm_ (const char *TRANSA, const char *TRANSB,
+	     const integer *M, const integer *N, const integer *K,
+	     const float *ALPHA, const float *A, const integer *LDA,
+	     const float *B, const integer *LDB,
+	     const float *BETA, float *C, const integer *LDC);
+
+void ssyrk_ (const char *UPLO, const char *TRANS, const integer *N,
+	     const integer *K, const float *ALPHA, const float *A,
+	     const integer *LDA, const float *BETA, float *C,
+	     const integer *LDC);
+
 void dsymm_ (const char *SIDE, const char *UPLO,
 	     const integer *M, const integer *N,
 	     const double *ALPHA, const double *A,
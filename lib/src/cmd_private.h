@@ -137,4 +137,13 @@ int statements_get_structure (stmt *lines, int n_lines,
 
 int cmd_arg1_quoted (CMD *cmd);
 
+typedef struct cmd_cache_ cmd_cache;
+
+cmd_cache *cmd_cache_new (const CMD *cmd, const DATASET *dset);
+
+int cmd_restore_from_cache (CMD *cmd, const cmd_cache *cc,
+			    const DATASET *dset);
+
+void cmd_cache_free (cmd_cache *cc);
+
 #endif /* CMD_PRIVATE_H */
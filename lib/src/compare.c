@@ -1787,8 +1787,9 @@ static int use_stepwise_omit (MODEL *orig, int crit)
     if (orig->ci != OLS || (orig->opt & OPT_R)) {
         /* we only handle OLS with classical std errors */
         return 0;
-    } else if (crit > C_HQC) {
-        /* we only handle the info criterion approach */
+    } else if (crit > C_HQC && !orig->ifc) {
+        /* on the p-value criterion we require that the
+           constant remains in the model, as a minimum */
         return 0;
     } else if (getenv("USE_AUTO_OMIT")) {
         /* we allow forcing use of the older code */
@@ -29,12 +29,14 @@
 #include "gretl_join.h"
 #include "join_priv.h"
 #include "csvdata.h"
+#include "gretl_mt.h"
 
 #ifdef WIN32
 # include "gretl_win32.h"
 #endif
 
 #include <errno.h>
+#include <locale.h>
 
 #define CDEBUG 0    /* CSV reading in general */
 #define COMPDEBUG 0 /* line compression */
@@ -74,6 +76,7 @@ struct csvdata_ {
     char decpoint;
     char thousep;
     char qchar;
+    char locdot;
     int markerpd;
     int maxlinelen;
     int real_n;
@@ -205,6 +208,7 @@ static csvdata *csvdata_new (DATASET *dset)
     c->delim = '\t';
     c->thousep = 0;
     c->qchar = 0;
+    c->locdot = 0;
     c->markerpd = -1;
     c->maxlinelen = 0;
     c->real_n = 0;
@@ -1424,17 +1428,149 @@ int test_markers_for_dates (DATASET *dset, int *reversed,
     return pd;
 }
 
-static int utf8_ok (gzFile fp, int pos)
+/* Input for the CSV reader. We make several passes through the
+   data, so an uncompressed file is memory-mapped: this is a great
+   deal faster than reading it character by character via zlib.
+   Only gzipped input is read via gzFile.
+*/
+
+typedef struct csvfile_ csvfile;
+
+struct csvfile_ {
+    GMappedFile *map; /* mapping of uncompressed file, or NULL */
+    const char *buf;  /* content of mapped file */
+    gint64 len;       /* length of mapped content */
+    gint64 pos;       /* current read position in @buf */
+    gzFile gz;        /* handle for compressed file, or NULL */
+};
+
+static csvfile *csvfile_open (const char *fname)
+{
+    csvfile *f = calloc(1, sizeof *f);
+
+    if (f == NULL) {
+        return NULL;
+    }
+
+    if (!is_gzipped(fname)) {
+        f->map = g_mapped_file_new(fname, FALSE, NULL);
+        if (f->map != NULL) {
+            f->buf = g_mapped_file_get_contents(f->map);
+            f->len = g_mapped_file_get_length(f->map);
+            return f;
+        }
+    }
+
+    f->gz = gretl_gzopen(fname, "rb");
+    if (f->gz == NULL) {
+        free(f);
+        f = NULL;
+    }
+
+    return f;
+}
+
+static void csvfile_close (csvfile *f)
+{
+    if (f != NULL) {
+        if (f->map != NULL) {
+            g_mapped_file_unref(f->map);
+        } else if (f->gz != NULL) {
+            gzclose(f->gz);
+        }
+        free(f);
+    }
+}
+
+static inline int csv_getc (csvfile *f)
+{
+    if (f->map != NULL) {
+        return f->pos < f->len ? (unsigned char) f->buf[f->pos++] : EOF;
+    } else {
+        return gzgetc(f->gz);
+    }
+}
+
+static void csv_ungetc (int c, csvfile *f)
+{
+    if (f->map != NULL) {
+        if (c != EOF && f->pos > 0) {
+            f->pos -= 1;
+        }
+    } else {
+        gzungetc(c, f->gz);
+    }
+}
+
+static long csv_tell (csvfile *f)
 {
-    long mark = gztell(fp);
+    return f->map != NULL ? (long) f->pos : (long) gztell(f->gz);
+}
+
+static void csv_seek (csvfile *f, long pos)
+{
+    if (f->map != NULL) {
+        f->pos = pos < 0 ? 0 : pos > f->len ? f->len : pos;
+    } else {
+        gzseek(f->gz, pos, SEEK_SET);
+    }
+}
+
+static void csv_rewind (csvfile *f)
+{
+    if (f->map != NULL) {
+        f->pos = 0;
+    } else {
+        gzrewind(f->gz);
+    }
+}
+
+static int csv_read (csvfile *f, void *targ, int n)
+{
+    if (f->map != NULL) {
+        if (n > f->len - f->pos) {
+            n = f->len - f->pos;
+        }
+        memcpy(targ, f->buf + f->pos, n);
+        f->pos += n;
+        return n;
+    } else {
+        return gzread(f->gz, targ, n);
+    }
+}
+
+/* analogue of fgets(), with no conversion of line endings */
+
+static char *csv_gets (csvfile *f, char *s, int n)
+{
+    int c, i = 0;
+
+    if (f->map == NULL) {
+        return gzgets(f->gz, s, n);
+    }
+
+    while (i < n - 1 && (c = csv_getc(f)) != EOF) {
+        s[i++] = c;
+        if (c == '\n') {
+            break;
+        }
+    }
+    s[i] = '\0';
+
+    return i > 0 ? s : NULL;
+}
+
+static int utf8_ok (csvfile *fp, int pos)
+{
+    long mark = csv_tell(fp);
     int len = pos + 9;
     char *test = malloc(len + 1);
     int i, ret = 0;
 
-    gzseek(fp, mark - pos - 1, SEEK_SET);
+    csv_seek(fp, mark - pos - 1);
 
     for (i=0; i<len; i++) {
-        test[i] = gzgetc(fp);
+        test[i] = csv_getc(fp);
     }
     test[i] = '\0';
 
@@ -1458,7 +1594,7 @@ static int utf8_ok (gzFile fp, int pos)
 
     free(test);
 
-    gzseek(fp, mark, SEEK_SET);
+    csv_seek(fp, mark);
 
     return ret;
 }
@@ -1474,7 +1610,7 @@ enum {
    user's "dotdir" (and then delete that file once we're done).
 */
 
-static int csv_recode_input (gzFile *fpp,
+static int csv_recode_input (csvfile **fpp,
                              const char *fname,
                              gchar **pfname,
                              int ucode,
@@ -1488,7 +1624,7 @@ static int csv_recode_input (gzFile *fpp,
     /* the current stream is not useable as is,
        so shut it down
     */
-    gzclose(*fpp);
+    csvfile_close(*fpp);
     *fpp = NULL;
 
     /* we'll recode to a temp file in dotdir */
@@ -1500,7 +1636,7 @@ static int csv_recode_input (gzFile *fpp,
 
     if (!err) {
         /* try reattaching the stream */
-        *fpp = gretl_gzopen(altname, "rb");
+        *fpp = csvfile_open(altname);
         if (*fpp == NULL) {
             gretl_remove(altname);
             err = E_FOPEN;
@@ -1524,10 +1660,10 @@ static int csv_recode_input (gzFile *fpp,
    recording of the input (via GLib) before we start reading data.
 */
 
-static int csv_unicode_check (gzFile fp, csvdata *c, PRN *prn)
+static int csv_unicode_check (csvfile *fp, csvdata *c, PRN *prn)
 {
     unsigned char b[4];
-    int n = gzread(fp, b, 4);
+    int n = csv_read(fp, b, 4);
     int ucode = 0;
 
     if (n == 4) {
@@ -1554,10 +1690,10 @@ static int csv_unicode_check (gzFile fp, csvdata *c, PRN *prn)
 
     if (ucode == UTF_8) {
         csv_set_has_bom(c);
-        gzseek(fp, 3, SEEK_SET);
+        csv_seek(fp, 3);
         ucode = 0;
     } else {
-        gzrewind(fp);
+        csv_rewind(fp);
     }
 
     return ucode;
@@ -1590,9 +1726,9 @@ static int report_quotation_info (int *qtotal, int *nqmax,
     return err;
 }
 
-static int handle_CR (int *crlf, gzFile fp)
+static int handle_CR (int *crlf, csvfile *fp)
 {
-    int c, c1 = gzgetc(fp);
+    int c, c1 = csv_getc(fp);
 
     if (c1 == EOF) {
         return c1;
@@ -1603,7 +1739,7 @@ static int handle_CR (int *crlf, gzFile fp)
     } else {
         /* old Mac-style: CR not followed by LF */
         c = 0x0a;
-        gzungetc(c1, fp);
+        csv_ungetc(c1, fp);
     }
 
     return c;
@@ -1623,7 +1759,7 @@ static int handle_CR (int *crlf, gzFile fp)
    We return the maximum line length, or -1 on error.
 */
 
-static int csv_max_line_length (gzFile fp, csvdata *cdata, PRN *prn)
+static int csv_max_line_length (csvfile *fp, csvdata *cdata, PRN *prn)
 {
     int c, c1, cbak = 0, cc = 0;
     int comment = 0, maxlinelen = 0;
@@ -1637,7 +1773,7 @@ static int csv_max_line_length (gzFile fp, csvdata *cdata, PRN *prn)
 
     csv_set_trailing_comma(cdata); /* just provisionally */
 
-    while ((c = gzgetc(fp)) != EOF) {
+    while ((c = csv_getc(fp)) != EOF) {
         if (c == 0x0d) {
             c = handle_CR(&crlf, fp);
             if (c == EOF) {
@@ -1684,11 +1820,11 @@ static int csv_max_line_length (gzFile fp, csvdata *cdata, PRN *prn)
         if (!comment) {
             if (c == '\t') {
                 /* let's ignore trailing tabs in this heuristic */
-                c1 = gzgetc(fp);
+                c1 = csv_getc(fp);
                 if (c1 != 0x0d && c1 != 0x0a) {
                     csv_set_got_tab(cdata);
                 }
-                gzungetc(c1, fp);
+                csv_ungetc(c1, fp);
             }
             if (c == ';') {
                 csv_set_got_semi(cdata);
@@ -1773,9 +1909,8 @@ static int count_csv_fields (csvdata *c)
     return nf + 1;
 }
 
-static void purge_quoted_delimiters (csvdata *c)
+static void purge_quoted_delimiters (csvdata *c, char *s)
 {
-    char *s = c->line;
     int inquote = 0;
 
     while (*s) {
@@ -1802,10 +1937,10 @@ static void purge_unquoted_spaces (char *s)
     }
 }
 
-static void compress_csv_line (csvdata *c, int nospace)
+static void compress_csv_buf (csvdata *c, char *line, int nospace)
 {
-    int n = strlen(c->line);
-    char *p = c->line + n - 1;
+    int n = strlen(line);
+    char *p = line + n - 1;
 
     if (*p == 0x0a) {
         *p = '\0';
@@ -1819,39 +1954,44 @@ static void compress_csv_line (csvdata *c, int nospace)
 #if COMPDEBUG
     fprintf(stderr, "HERE compress: keep_quotes=%d, qchar=%c\n",
             csv_keep_quotes(c) ? 1 : 0, c->qchar ? c->qchar : '0');
-    fprintf(stderr, " before:\n  '%s'\n", c->line);
+    fprintf(stderr, " before:\n  '%s'\n", line);
 #endif
 
     if (!csv_keep_quotes(c)) {
-        purge_quoted_delimiters(c);
+        purge_quoted_delimiters(c, line);
     }
 
     if (c->delim != ' ') {
         if (nospace) {
-            purge_unquoted_spaces(c->line);
+            purge_unquoted_spaces(line);
         }
     } else {
-        compress_spaces(c->line);
+        compress_spaces(line);
     }
 
     if (!csv_keep_quotes(c)) {
-        gretl_delchar('"', c->line);
+        gretl_delchar('"', line);
     }
 
 #if COMPDEBUG
-    fprintf(stderr, " after:\n  '%s'\n", c->line);
+    fprintf(stderr, " after:\n  '%s'\n", line);
 #endif
 
 
     if (csv_has_trailing_comma(c)) {
         /* chop trailing comma */
-        n = strlen(c->line);
+        n = strlen(line);
         if (n > 0) {
-            c->line[n-1] = '\0';
+            line[n-1] = '\0';
         }
     }
 }
 
+static void compress_csv_line (csvdata *c, int nospace)
+{
+    compress_csv_buf(c, c->line, nospace);
+}
+
 int import_obs_label (const char *s)
 {
     char tmp[VNAMELEN];
@@ -2346,7 +2486,35 @@ static int all_digits_and_seps (const char *s)
     return strspn(s, test) == strlen(s);
 }
 
-static double eval_non_numeric (csvdata *c, int i, const char *s)
+/* When rows of data are parsed in parallel, the heuristic for
+   detecting a thousands separator (which depends on the order in
+   which fields are seen) is deferred: we record the candidate
+   fields and check them in order once the block of rows is done.
+*/
+
+typedef struct tsep_check_ tsep_check;
+
+struct tsep_check_ {
+    int t;   /* observation */
+    int i;   /* series ID */
+    char *s; /* copy of the field */
+};
+
+static void defer_tsep_check (GArray *tsep, int t, int i, const char *s)
+{
+    tsep_check tc;
+
+    tc.t = t;
+    tc.i = i;
+    tc.s = gretl_strdup(s);
+#if defined(_OPENMP)
+#pragma omp critical (csv_tsep)
+#endif
+    g_array_append_val(tsep, tc);
+}
+
+static double eval_non_numeric (csvdata *c, int i, const char *s,
+                                int t, GArray *tsep)
 {
     double x = NON_NUMERIC;
 
@@ -2380,7 +2548,11 @@ static double eval_non_numeric (csvdata *c, int i, const char *s)
            second pass through the data.
         */
         if (all_digits_and_seps(s)) {
-            test_for_thousands_sep(c, s);
+            if (tsep != NULL) {
+                defer_tsep_check(tsep, t, i, s);
+            } else {
+                test_for_thousands_sep(c, s);
+            }
         }
     }
 
@@ -2417,11 +2589,69 @@ static char *csv_unquote (char *s)
     return s;
 }
 
-static double csv_atof (csvdata *c, int i)
+/* Fast conversion of the common case of a plain decimal number
+   with at most 15 significant digits and at most 22 digits after
+   the decimal point: both the digit string and the power of 10 are
+   then exactly representable, so a single IEEE division gives the
+   correctly rounded result, identical to that from strtod(). We
+   return 0 for anything else, which is then left to strtod().
+   Note that @dotok must be non-zero for us to handle a '.', since
+   strtod() will only accept it in a locale that uses decimal dot.
+*/
+
+static int csv_fast_atof (const char *s, int dotok, double *px)
+{
+    static const double p10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+        1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19,
+        1e20, 1e21, 1e22
+    };
+    guint64 m = 0;
+    int neg = 0, nd = 0, sig = 0;
+    int k = -1;
+
+    if (*s == '-' || *s == '+') {
+        neg = (*s == '-');
+        s++;
+    }
+
+    for (;; s++) {
+        if (*s >= '0' && *s <= '9') {
+            nd++;
+            if (sig > 0 || *s != '0') {
+                if (++sig > 15) {
+                    return 0;
+                }
+            }
+            m = 10 * m + (*s - '0');
+            if (k >= 0) {
+                k++;
+            }
+        } else if (*s == '.' && dotok && k < 0) {
+            k = 0;
+        } else {
+            break;
+        }
+    }
+
+    if (*s != '\0' || nd == 0 || k > 22) {
+        return 0;
+    }
+
+    *px = (k > 0)? (double) m / p10[k] : (double) m;
+    if (neg) {
+        *px = -*px;
+    }
+
+    return 1;
+}
+
+static double csv_atof (csvdata *c, char *str, int i, int t,
+                        GArray *tsep)
 {
     char tmp[CSVSTRLEN], clean[CSVSTRLEN];
     double x = NON_NUMERIC;
-    const char *s = c->str;
+    const char *s = str;
     char *test;
 
     if (csv_scrub_thousep(c) && strchr(s, c->thousep) &&
@@ -2438,6 +2668,9 @@ static double csv_atof (csvdata *c, int i)
         /* either we're currently set to the correct locale,
            or there's no problematic decimal point in @s
         */
+        if (csv_fast_atof(s, c->locdot, &x)) {
+            return x; /* handled */
+        }
         errno = 0;
         x = strtod(s, &test);
         if (converted_ok(s, test, x)) {
@@ -2467,11 +2700,11 @@ static double csv_atof (csvdata *c, int i)
 
     /* fallback */
     /* revised 2020-02-13 to use csv_unquote */
-    return eval_non_numeric(c, i, csv_unquote(c->str));
+    return eval_non_numeric(c, i, csv_unquote(str), t, tsep);
 }
 
-static int process_csv_obs (csvdata *c, int i, int t, int *miss_shown,
-                            PRN *prn)
+static int process_csv_obs (csvdata *c, char *str, int i, int t,
+                            int *miss_shown, GArray *tsep, PRN *prn)
 {
     int err = 0;
 
@@ -2481,12 +2714,12 @@ static int process_csv_obs (csvdata *c, int i, int t, int *miss_shown,
             double zit = c->dset->Z[i][t];
             int ix;
 
-            if (na(zit) && *c->str != '\0' && c->user_na == NULL) {
+            if (na(zit) && *str != '\0' && c->user_na == NULL) {
                 /* by default (no user_na) only blanks count as NAs */
                 zit = NON_NUMERIC;
             }
             if (!na(zit)) {
-                ix = gretl_string_table_index(c->st, c->str, i, 0, prn);
+                ix = gretl_string_table_index(c->st, str, i, 0, prn);
                 if (ix > 0) {
                     c->dset->Z[i][t] = (double) ix;
                 } else {
@@ -2494,11 +2727,11 @@ static int process_csv_obs (csvdata *c, int i, int t, int *miss_shown,
                 }
             }
         }
-    } else if (csv_missval(c->str, i, t+1, miss_shown, prn)) {
+    } else if (csv_missval(str, i, t+1, miss_shown, prn)) {
         c->dset->Z[i][t] = NADBL;
     } else {
-        gretl_strstrip(c->str);
-        c->dset->Z[i][t] = csv_atof(c, i);
+        gretl_strstrip(str);
+        c->dset->Z[i][t] = csv_atof(c, str, i, t, tsep);
     }
 
     return err;
@@ -2509,14 +2742,14 @@ static int process_csv_obs (csvdata *c, int i, int t, int *miss_shown,
    Line-endings are converted to LF (0x0a).
 */
 
-static char *csv_fgets (csvdata *cdata, gzFile fp)
+static char *csv_fgets (csvdata *cdata, csvfile *fp)
 {
     char *s = cdata->line;
     int n = cdata->maxlinelen;
     int i, c1, c = 0;
 
     for (i=0; i<n-1 && c!=0x0a; i++) {
-        c = gzgetc(fp);
+        c = csv_getc(fp);
         if (c == EOF) {
             if (i == 0) {
                 /* signal end of read */
@@ -2528,9 +2761,9 @@ static char *csv_fgets (csvdata *cdata, gzFile fp)
             /* CR: convert to LF and peek at next char: if it's
                LF swallow it, otherwise put it back */
             c = 0x0a;
-            c1 = gzgetc(fp);
+            c1 = csv_getc(fp);
             if (c1 != 0x0a) {
-                gzungetc(c1, fp);
+                csv_ungetc(c1, fp);
             }
         }
         s[i] = c;
@@ -2543,7 +2776,7 @@ static char *csv_fgets (csvdata *cdata, gzFile fp)
 
 /* pick up any comments following the data block in a CSV file */
 
-static char *get_csv_descrip (csvdata *c, gzFile fp)
+static char *get_csv_descrip (csvdata *c, csvfile *fp)
 {
     char *line = c->line;
     char *desc = NULL;
@@ -2596,7 +2829,7 @@ csv_msg = N_("\nPlease note:\n"
    fields per line in the CSV file.
 */
 
-static int csv_fields_check (gzFile fp, csvdata *c, PRN *prn)
+static int csv_fields_check (csvfile *fp, csvdata *c, PRN *prn)
 {
     int gotdata = 0;
     int chkcols = 0;
@@ -2605,7 +2838,7 @@ static int csv_fields_check (gzFile fp, csvdata *c, PRN *prn)
     c->ncols = c->nrows = 0;
 
     if (csv_has_bom(c)) {
-        gzseek(fp, 3, SEEK_SET);
+        csv_seek(fp, 3);
     }
 
     while (csv_fgets(c, fp) && !err) {
@@ -2894,7 +3127,7 @@ static int handle_join_varname (csvdata *c, int k, int *pj)
 
 #define obs_labels_no_varnames(o,c,n)  (!o && c->v > 3 && n == c->v - 2)
 
-static int csv_varname_scan (csvdata *c, gzFile fp, PRN *prn, PRN *mprn)
+static int csv_varname_scan (csvdata *c, csvfile *fp, PRN *prn, PRN *mprn)
 {
     char *p;
     int obscol = csv_has_obs_column(c);
@@ -2906,7 +3139,7 @@ static int csv_varname_scan (csvdata *c, gzFile fp, PRN *prn, PRN *mprn)
     }
 
     if (csv_has_bom(c)) {
-        gzseek(fp, 3, SEEK_SET);
+        csv_seek(fp, 3);
     }
 
     while (csv_fgets(c, fp)) {
@@ -2917,7 +3150,7 @@ static int csv_varname_scan (csvdata *c, gzFile fp, PRN *prn, PRN *mprn)
         }
     }
 
-    c->datapos = gztell(fp);
+    c->datapos = csv_tell(fp);
 
     compress_csv_line(c, 1);
 
@@ -3035,7 +3268,7 @@ static int row_not_wanted (csvdata *c, int t)
 /* read numerical data when we've been given a fixed column-reading
    specification */
 
-static int fixed_format_read (csvdata *c, gzFile fp, PRN *prn)
+static int fixed_format_read (csvdata *c, csvfile *fp, PRN *prn)
 {
     char *p;
     int miss_shown = 0;
@@ -3047,7 +3280,7 @@ static int fixed_format_read (csvdata *c, gzFile fp, PRN *prn)
     c->real_n = c->dset->n;
 
     if (csv_has_bom(c)) {
-        gzseek(fp, 3, SEEK_SET);
+        csv_seek(fp, 3);
     }
 
     if (csv_is_verbose(c)) {
@@ -3085,7 +3318,7 @@ static int fixed_format_read (csvdata *c, gzFile fp, PRN *prn)
             if (csv_missval(c->str, i, t+1, missp, prn)) {
                 c->dset->Z[i][t] = NADBL;
             } else {
-                c->dset->Z[i][t] = csv_atof(c, i);
+                c->dset->Z[i][t] = csv_atof(c, c->str, i, t, NULL);
                 if (c->dset->Z[i][t] == NON_NUMERIC) {
                     gretl_errmsg_sprintf(_("At row %d, column %d:\n"), t+1, k);
                     gretl_errmsg_sprintf(_("'%s' -- no numeric conversion performed!"),
@@ -3129,6 +3362,9 @@ static int maybe_fix_csv_string (gchar *s)
         tr = g_convert(s, -1, "UTF-8", "ISO-8859-15",
                        NULL, &wrote, &gerr);
         if (gerr != NULL) {
+#if defined(_OPENMP)
+#pragma omp critical (csv_errmsg)
+#endif
             gretl_errmsg_set(gerr->message);
             g_error_free(gerr);
             err = E_DATA;
@@ -3155,9 +3391,8 @@ static int maybe_fix_csv_string (gchar *s)
     return err;
 }
 
-static void transcribe_obs_label (csvdata *c, int t)
+static void transcribe_obs_label (csvdata *c, char *s, int t)
 {
-    char *s = c->str;
     char c0 = *s;
     int n = strlen(s);
 
@@ -3187,88 +3422,265 @@ static void transcribe_obs_label (csvdata *c, int t)
     gretl_utf8_strncat(c->dset->S[t], s, n);
 }
 
-static int real_read_labels_and_data (csvdata *c, gzFile fp, PRN *prn)
+/* Parse the data @line for observation @t into the dataset,
+   using @str as workspace. If @tsep is non-NULL we're running in
+   parallel and the thousands-separator heuristic is deferred.
+*/
+
+static int csv_parse_data_line (csvdata *c, char *line, char *str,
+                                int t, int *missp, int *truncated,
+                                GArray *tsep, PRN *prn)
 {
     char *p;
-    int miss_shown = 0;
-    int *missp = NULL;
-    int truncated = 0;
-    int t = 0, s = 0;
+    int inquote = 0;
     int i, j, k;
     int err = 0;
 
-    if (csv_is_verbose(c)) {
-        missp = &miss_shown;
+    compress_csv_buf(c, line, 0);
+    p = line;
+
+    if (c->delim == ' ') {
+        if (*p == ' ') p++;
+    } else {
+        p += strspn(p, " ");
     }
 
-    c->real_n = c->dset->n;
+    j = 1;
+    for (k=0; k<c->ncols && !err; k++) {
+        i = 0;
+        while (*p) {
+            if (csv_keep_quotes(c) && *p == c->qchar) {
+                inquote = !inquote;
+            } else if (!inquote && *p == c->delim) {
+                break;
+            }
+            if (i < CSVSTRLEN - 1) {
+                str[i++] = *p;
+            } else {
+                *truncated += 1;
+            }
+            p++;
+        }
+        str[i] = '\0';
+        err = maybe_fix_csv_string(str);
+        if (!err) {
+            if (k == 0 && csv_skip_col_1(c) && c->dset->S != NULL) {
+                transcribe_obs_label(c, str, t);
+            } else if (cols_subset(c) && skip_data_column(c, k)) {
+                ; /* no-op */
+            } else {
+                err = process_csv_obs(c, str, j++, t, missp, tsep, prn);
+            }
+        }
+        if (!err) {
+            /* prep for next column */
+            if (*p == c->delim) {
+                p++;
+            }
+            if (c->delim != ' ') {
+                p += strspn(p, " ");
+            }
+        }
+    }
 
-    while (csv_fgets(c, fp) && !err) {
-        int inquote = 0;
+    return err;
+}
+
+/* Get the next line of data from @fp into c->line, skipping
+   comments, blank lines and rows that are not wanted; @s is
+   the running index of candidate rows. Returns 0 at end of
+   input.
+*/
 
+static int csv_next_data_line (csvdata *c, csvfile *fp, int *s)
+{
+    while (csv_fgets(c, fp)) {
         if (*c->line == '#' || string_is_blank(c->line)) {
             continue;
         } else if (*c->skipstr != '\0' && strstr(c->line, c->skipstr)) {
             c->real_n -= 1;
             continue;
-        } else if (row_not_wanted(c, s)) {
-            s++;
+        } else if (row_not_wanted(c, *s)) {
+            *s += 1;
             continue;
         }
+        *s += 1;
+        return 1;
+    }
+
+    return 0;
+}
 
-        compress_csv_line(c, 0);
-        p = c->line;
+#if defined(_OPENMP)
 
-        if (c->delim == ' ') {
-            if (*p == ' ') p++;
-        } else {
-            p += strspn(p, " ");
+#define CSV_BLOCK_ROWS 8192
+
+static int tsep_check_compare (const void *a, const void *b)
+{
+    const tsep_check *ta = a;
+    const tsep_check *tb = b;
+
+    return (ta->t != tb->t)? ta->t - tb->t : ta->i - tb->i;
+}
+
+/* Run the deferred thousands-separator checks in the order in which
+   they would have been encountered in a serial read.
+*/
+
+static void run_tsep_checks (csvdata *c, GArray *tsep)
+{
+    tsep_check *tc;
+    guint k;
+
+    g_array_sort(tsep, tsep_check_compare);
+
+    for (k=0; k<tsep->len; k++) {
+        tc = &g_array_index(tsep, tsep_check, k);
+        if (c->thousep >= 0) {
+            test_for_thousands_sep(c, tc->s);
         }
+        free(tc->s);
+    }
+
+    g_array_set_size(tsep, 0);
+}
+
+/* Threaded variant of the data read: lines are gathered serially
+   in blocks, each block is parsed in parallel, row by row, into
+   the dataset.
+*/
+
+static int csv_read_data_blocks (csvdata *c, csvfile *fp, int *truncated,
+                                 PRN *prn)
+{
+    GArray *tsep = g_array_new(FALSE, FALSE, sizeof(tsep_check));
+    char *lines = NULL;
+    size_t *offs = NULL;
+    size_t asize = 0;
+    int ntrunc = 0;
+    int t = 0, s = 0;
+    int err = 0;
+
+    offs = malloc(CSV_BLOCK_ROWS * sizeof *offs);
+    if (offs == NULL) {
+        g_array_free(tsep, TRUE);
+        return E_ALLOC;
+    }
 
-        j = 1;
-        for (k=0; k<c->ncols && !err; k++) {
-            i = 0;
-            while (*p) {
-                if (csv_keep_quotes(c) && *p == c->qchar) {
-                    inquote = !inquote;
-                } else if (!inquote && *p == c->delim) {
+    while (!err && t < c->dset->n) {
+        size_t used = 0;
+        int r, nr = 0;
+
+        /* gather a block of lines */
+        while (nr < CSV_BLOCK_ROWS && t + nr < c->dset->n &&
+               csv_next_data_line(c, fp, &s)) {
+            size_t len = strlen(c->line) + 1;
+
+            if (used + len > asize) {
+                size_t newsize = 2 * (used + len) + CSV_BLOCK_ROWS;
+                char *tmp = realloc(lines, newsize);
+
+                if (tmp == NULL) {
+                    err = E_ALLOC;
                     break;
                 }
-                if (i < CSVSTRLEN - 1) {
-                    c->str[i++] = *p;
-                } else {
-                    truncated++;
-                }
-                p++;
+                lines = tmp;
+                asize = newsize;
             }
-            c->str[i] = '\0';
-            err = maybe_fix_csv_string(c->str);
-            if (!err) {
-                if (k == 0 && csv_skip_col_1(c) && c->dset->S != NULL) {
-                    transcribe_obs_label(c, t);
-                } else if (cols_subset(c) && skip_data_column(c, k)) {
-                    ; /* no-op */
-                } else {
-                    err = process_csv_obs(c, j++, t, missp, prn);
-                }
+            memcpy(lines + used, c->line, len);
+            offs[nr++] = used;
+            used += len;
+        }
+
+        if (err || nr == 0) {
+            break;
+        }
+
+        /* and parse it */
+#pragma omp parallel for private(r) reduction(+:ntrunc)
+        for (r=0; r<nr; r++) {
+            char str[CSVSTRLEN];
+            int rtrunc = 0;
+            int rerr;
+
+            if (err) {
+                continue;
             }
-            if (!err) {
-                /* prep for next column */
-                if (*p == c->delim) {
-                    p++;
-                }
-                if (c->delim != ' ') {
-                    p += strspn(p, " ");
-                }
+            rerr = csv_parse_data_line(c, lines + offs[r], str, t + r,
+                                       NULL, &rtrunc, tsep, prn);
+            ntrunc += rtrunc;
+            if (rerr) {
+#pragma omp critical (csv_err)
+                err = rerr;
             }
         }
 
-        s++;
+        if (tsep->len > 0) {
+            run_tsep_checks(c, tsep);
+        }
+        t += nr;
+    }
+
+    run_tsep_checks(c, tsep);
+    g_array_free(tsep, TRUE);
+    free(lines);
+    free(offs);
+
+    *truncated = ntrunc;
+
+    return err;
+}
+
+/* Can we usefully parse rows of data in parallel? Not when
+   assigning codes to string values, since that requires a
+   serial pass, nor when reporting on missing values.
+*/
+
+static int csv_read_threaded (csvdata *c, int *missp)
+{
+    return c->st == NULL && missp == NULL &&
+        gretl_use_openmp((guint64) c->dset->n * c->ncols) &&
+        c->dset->n > CSV_BLOCK_ROWS / 8;
+}
+
+#endif /* _OPENMP */
+
+static int real_read_labels_and_data (csvdata *c, csvfile *fp, PRN *prn)
+{
+    int miss_shown = 0;
+    int *missp = NULL;
+    int truncated = 0;
+    int t = 0, s = 0;
+    int err = 0;
+
+    if (csv_is_verbose(c)) {
+        missp = &miss_shown;
+    }
+
+    c->real_n = c->dset->n;
+
+    /* can strtod() accept '.' as the decimal character? */
+    c->locdot = (*localeconv()->decimal_point == '.');
+
+#if defined(_OPENMP)
+    if (csv_read_threaded(c, missp)) {
+        err = csv_read_data_blocks(c, fp, &truncated, prn);
+        goto finish;
+    }
+#endif
+
+    while (!err && csv_next_data_line(c, fp, &s)) {
+        err = csv_parse_data_line(c, c->line, c->str, t, missp,
+                                  &truncated, NULL, prn);
         if (++t == c->dset->n) {
             break;
         }
     }
 
+#if defined(_OPENMP)
+ finish:
+#endif
+
     if (truncated) {
         pprintf(prn, _("warning: %d strings were truncated.\n"), truncated);
     }
@@ -3305,7 +3717,7 @@ static int csv_skip_dates (csvdata *c)
     }
 }
 
-static int csv_read_data (csvdata *c, gzFile fp, PRN *prn, PRN *mprn)
+static int csv_read_data (csvdata *c, csvfile *fp, PRN *prn, PRN *mprn)
 {
     int reversed = csv_data_reversed(c);
     int err;
@@ -3318,7 +3730,7 @@ static int csv_read_data (csvdata *c, gzFile fp, PRN *prn, PRN *mprn)
         }
     }
 
-    gzseek(fp, c->datapos, SEEK_SET);
+    csv_seek(fp, c->datapos);
 
     err = real_read_labels_and_data(c, fp, prn);
 
@@ -3473,7 +3885,7 @@ int real_import_csv (const char *fname,
 		     PRN *prn)
 {
     csvdata *c = NULL;
-    gzFile fp = NULL;
+    csvfile *fp = NULL;
     PRN *mprn = NULL;
     gchar *altname = NULL;
     int recode = 0;
@@ -3486,7 +3898,7 @@ int real_import_csv (const char *fname,
         mprn = prn;
     }
 
-    fp = gretl_gzopen(fname, "rb");
+    fp = csvfile_open(fname);
     if (fp == NULL) {
         pprintf(prn, _("Couldn't open %s\n"), fname);
         err = E_FOPEN;
@@ -3530,6 +3942,11 @@ int real_import_csv (const char *fname,
     if (join != NULL) {
         c->jspec = join;
         c->flags |= CSV_HAVEDATA;
+        if (join->rowmask != NULL) {
+            /* rows pre-selected by gretl_join.c */
+            c->rowmask = join->rowmask;
+            c->masklen = gretl_vector_get_length(join->rowmask);
+        }
     } else if (probe != NULL) {
         c->probe = probe;
         c->flags |= CSV_HAVEDATA;
@@ -3606,7 +4023,7 @@ int real_import_csv (const char *fname,
         csv_unset_trailing_comma(c);
     }
 
-    gzrewind(fp);
+    csv_rewind(fp);
 
     /* read lines, check for consistency in number of fields */
     err = csv_fields_check(fp, c, mprn);
@@ -3650,7 +4067,7 @@ int real_import_csv (const char *fname,
 
     /* second pass */
 
-    gzrewind(fp);
+    csv_rewind(fp);
 
     if (fixed_format(c)) {
         err = fixed_format_read(c, fp, prn);
@@ -3814,7 +4231,7 @@ int real_import_csv (const char *fname,
  csv_bailout:
 
     if (fp != NULL) {
-        gzclose(fp);
+        csvfile_close(fp);
     }
 
     if (!err && c->jspec != NULL) {
@@ -4030,12 +4447,12 @@ int csv_open_needs_matrix (gretlopt opt)
 int peek_at_csv (const char *fname, int n_lines, PRN *prn)
 {
     csvdata *c = NULL;
-    gzFile fp = NULL;
+    csvfile *fp = NULL;
     gchar *altname = NULL;
     int recode;
     int err = 0;
 
-    fp = gretl_gzopen(fname, "rb");
+    fp = csvfile_open(fname);
     if (fp == NULL) {
         return E_FOPEN;
     }
@@ -4070,12 +4487,12 @@ int peek_at_csv (const char *fname, int n_lines, PRN *prn)
         char *s;
         int i;
 
-        gzrewind(fp);
+        csv_rewind(fp);
         gretl_print_reset_buffer(prn);
 
         for (i=0; i<n_lines; i++) {
-            s = gzgets(fp, c->line, c->maxlinelen);
-            if (s == Z_NULL) {
+            s = csv_gets(fp, c->line, c->maxlinelen);
+            if (s == NULL) {
                 break;
             } else {
                 pputs(prn, s);
@@ -4083,7 +4500,7 @@ int peek_at_csv (const char *fname, int n_lines, PRN *prn)
         }
     }
 
-    gzclose(fp);
+    csvfile_close(fp);
     csvdata_free(c);
 
     if (altname != NULL) {
@@ -58,7 +58,8 @@ typedef enum {
     GRETL_FMT_DB,        /* gretl native database format */
     GRETL_FMT_JM,        /* JMulti ascii data */
     GRETL_FMT_DTA,       /* Stata .dta format */
-    GRETL_FMT_JSON       /* geojson (maps) */
+    GRETL_FMT_JSON,      /* geojson (maps) */
+    GRETL_FMT_ARROW      /* Apache Parquet or Arrow IPC */
 } GretlDataFormat;
 
 #define IS_DATE_SEP(c) (c == '.' || c == ':' || c == ',')
@@ -312,6 +313,41 @@ static int datecmp (const char *s1, int y21, int slash1,
     }
 }
 
+/* Look up @date among the date strings of a calendar dataset
+   with "hard-wired" markers (checked to be increasing when the
+   data were read) by bisection on epoch days. Returns the 0-based
+   observation index, -1 if @date is not present, or -2 if the
+   bisection can't be used (unparseable or unordered dates).
+*/
+
+static int bisect_date_markers (const char *date, const DATASET *dset)
+{
+    guint32 ed, edt;
+    int lo = 0, hi = dset->n - 1;
+    int t;
+
+    ed = get_epoch_day(date);
+    if (ed == 0 || get_epoch_day(dset->S[lo]) >= get_epoch_day(dset->S[hi])) {
+        return -2;
+    }
+
+    while (lo <= hi) {
+        t = lo + (hi - lo) / 2;
+        edt = get_epoch_day(dset->S[t]);
+        if (edt == 0) {
+            return -2;
+        } else if (edt == ed) {
+            return t;
+        } else if (edt < ed) {
+            lo = t + 1;
+        } else {
+            hi = t - 1;
+        }
+    }
+
+    return -1;
+}
+
 static int
 real_dateton (const char *date, const DATASET *dset, int nolimit)
 {
@@ -338,6 +374,12 @@ real_dateton (const char *date, const DATASET *dset, int nolimit)
             if (!tryit) {
                 return -1;
             }
+            if (y21 == y22 && dset->n > 1) {
+                t = bisect_date_markers(date, dset);
+                if (t > -2) {
+                    return t;
+                }
+            }
             for (t=0; t<dset->n; t++) {
                 if (!datecmp(date, y21, slash1, dset->S[t], y22, slash2)) {
                     /* handled */
@@ -738,7 +780,10 @@ static struct extmap data_ftype_map[] = {
     { GRETL_WF1,          ".wf1" },
     { GRETL_DTA,          ".dta" },
     { GRETL_SAV,          ".sav" },
-    { GRETL_SAS,          ".xpt" }
+    { GRETL_SAS,          ".xpt" },
+    { GRETL_PARQUET,      ".parquet" },
+    { GRETL_ARROW,        ".arrow" },
+    { GRETL_ARROW,        ".feather" }
 };
 
 static const char *map_suffixes[] = {
@@ -889,6 +934,10 @@ format_from_opt_or_name (gretlopt opt, const char *fname,
             *delim = ' ';
         } else if (has_suffix(fname, ".dta")) {
             fmt = GRETL_FMT_DTA;
+        } else if (has_suffix(fname, ".parquet") ||
+                   has_suffix(fname, ".arrow") ||
+                   has_suffix(fname, ".feather")) {
+            fmt = GRETL_FMT_ARROW;
         } else if (has_suffix(fname, ".bin")) {
             fmt = GRETL_FMT_DB;
         }
@@ -1085,6 +1134,24 @@ static int write_dta_data (const char *fname, const int *list,
     return err;
 }
 
+static int write_arrow_data (const char *fname, const int *list,
+                             gretlopt opt, const DATASET *dset)
+{
+    int (*exporter) (const char *, const int *, gretlopt,
+                     const DATASET *);
+    int err = 0;
+
+    exporter = get_plugin_function("arrow_export");
+
+    if (exporter == NULL) {
+        err = 1;
+    } else {
+        err = (*exporter)(fname, list, opt, dset);
+    }
+
+    return err;
+}
+
 static int write_map_data (const char *fname,
                            const int *list,
                            const DATASET *dset)
@@ -1132,6 +1199,13 @@ static int real_write_data (const char *fname, int *list,
 
     fmt = format_from_opt_or_name(opt, fname, &delim, &add_ext,
                                   &gzip, &err);
+    if (!err && (opt & (OPT_C | OPT_K)) && fmt != GRETL_FMT_BINARY) {
+        /* --compress and --mmap are specific to gdtb */
+        err = E_BADOPT;
+    } else if (!err && (opt & OPT_C) && (opt & OPT_K)) {
+        /* a compressed file can't be mapped */
+        err = E_BADOPT;
+    }
     if (err) {
         return err;
     }
@@ -1168,6 +1242,12 @@ static int real_write_data (const char *fname, int *list,
         goto write_exit;
     }
 
+    if (fmt == GRETL_FMT_ARROW) {
+        /* Parquet or Arrow IPC */
+        err = write_arrow_data(fname, list, opt, dset);
+        goto write_exit;
+    }
+
     if (fmt == GRETL_FMT_JSON) {
         /* writing map as geojson */
         err = write_map_data(fname, list, dset);
@@ -2171,6 +2251,10 @@ static int merge_lengthen_series (DATASET *dset,
         }
     }
 
+    if (!err) {
+        err = dataset_unmap_series(dset);
+    }
+
     for (i=0; i<dset->v && !err; i++) {
         double *x;
 
@@ -3578,6 +3662,8 @@ int import_other (const char *fname, GretlFileType ftype,
         importer = get_plugin_function("jmulti_get_data");
     } else if (ftype == GRETL_MAP) {
         importer = get_plugin_function("map_get_data");
+    } else if (ARROW_IMPORT(ftype)) {
+        return import_arrow(fname, dset, NULL, 0, NULL, NULL, opt, prn);
     } else {
         pprintf(prn, _("Unrecognized data type"));
         pputc(prn, '\n');
@@ -3593,6 +3679,98 @@ int import_other (const char *fname, GretlFileType ftype,
     return err;
 }
 
+/**
+ * import_arrow:
+ * @fname: name of file.
+ * @dset: pointer to dataset struct.
+ * @S: array of names of columns to import, or NULL.
+ * @ns: number of elements in @S.
+ * @cols: list of (1-based) column numbers to import, or NULL.
+ * @filter: condition that rows must satisfy to be imported, or NULL.
+ * @opt: option flag; see gretl_get_data().
+ * @prn: gretl printing struct.
+ *
+ * Open a data file in Apache Parquet or Arrow IPC format. At
+ * most one of @S and @cols should be non-NULL; if both are NULL
+ * all columns of supported type are imported.
+ *
+ * Returns: 0 on successful completion, non-zero otherwise.
+ */
+
+int import_arrow (const char *fname, DATASET *dset,
+                  char **S, int ns, const int *cols,
+                  const char *filter, gretlopt opt,
+                  PRN *prn)
+{
+    int (*importer) (const char *, DATASET *, char **, int,
+                     const int *, const char *, gretlopt, PRN *);
+    int err = 0;
+
+    if (gretl_test_fopen(fname, "r") != 0) {
+        pprintf(prn, _("Couldn't open %s\n"), fname);
+        return E_FOPEN;
+    }
+
+    importer = get_plugin_function("arrow_get_data");
+
+    if (importer == NULL) {
+        err = 1;
+    } else {
+        err = (*importer)(fname, dset, S, ns, cols, filter, opt, prn);
+    }
+
+    return err;
+}
+
+/**
+ * import_other_subset:
+ * @fname: name of file.
+ * @ftype: type of data file (%GRETL_DTA, %GRETL_SAV or %GRETL_WF1).
+ * @dset: pointer to dataset struct.
+ * @S: array of names of series to import, or NULL.
+ * @ns: number of elements in @S.
+ * @cols: list of (1-based) variable positions to import, or NULL.
+ * @opt: option flag; see gretl_get_data().
+ * @prn: gretl printing struct.
+ *
+ * Open a Stata, SPSS or EViews data file, importing only a subset of its
+ * variables. Exactly one of @S and @cols should be non-NULL.
+ *
+ * Returns: 0 on successful completion, non-zero otherwise.
+ */
+
+int import_other_subset (const char *fname, GretlFileType ftype,
+                         DATASET *dset, char **S, int ns,
+                         const int *cols, gretlopt opt, PRN *prn)
+{
+    int (*importer) (const char *, DATASET *, char **, int,
+                     const int *, gretlopt, PRN *);
+    int err = 0;
+
+    if (gretl_test_fopen(fname, "r") != 0) {
+        pprintf(prn, _("Couldn't open %s\n"), fname);
+        return E_FOPEN;
+    }
+
+    if (ftype == GRETL_DTA) {
+        importer = get_plugin_function("dta_get_data_subset");
+    } else if (ftype == GRETL_SAV) {
+        importer = get_plugin_function("sav_get_data_subset");
+    } else if (ftype == GRETL_WF1) {
+        importer = get_plugin_function("wf1_get_data_subset");
+    } else {
+        return E_BADOPT;
+    }
+
+    if (importer == NULL) {
+        err = 1;
+    } else {
+        err = (*importer)(fname, dset, S, ns, cols, opt, prn);
+    }
+
+    return err;
+}
+
 /**
  * import_spreadsheet:
  * @fname: name of file.
@@ -3996,7 +4174,9 @@ void dataset_add_import_info (DATASET *dset, const char *fname,
         { GRETL_DTA,      "Stata" },
         { GRETL_SAV,      "SPSS" },
         { GRETL_SAS,      "SAS" },
-        { GRETL_JMULTI,   "JMulTi" }
+        { GRETL_JMULTI,   "JMulTi" },
+        { GRETL_PARQUET,  "Parquet" },
+        { GRETL_ARROW,    "Arrow" }
     };
     int i, nt = G_N_ELEMENTS(ftypes);
     const char *src = NULL;
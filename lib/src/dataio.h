@@ -37,6 +37,8 @@ typedef enum {
     GRETL_SAV,            /* SPSS .sav data */
     GRETL_SAS,            /* SAS xport data file */
     GRETL_JMULTI,         /* JMulTi data file */
+    GRETL_PARQUET,        /* Apache Parquet file */
+    GRETL_ARROW,          /* Arrow IPC (feather) file */
     GRETL_DATA_MAX,       /* -- place marker -- */
     GRETL_SCRIPT,         /* file containing gretl commands */
     GRETL_SESSION,        /* zipped session file */
@@ -66,7 +68,16 @@ typedef enum {
                          f == GRETL_JMULTI ||	\
                          f == GRETL_OCTAVE ||	\
 			 f == GRETL_WF1 ||	\
-			 f == GRETL_MAP)
+			 f == GRETL_MAP ||	\
+			 f == GRETL_PARQUET ||	\
+			 f == GRETL_ARROW)
+
+#define ARROW_IMPORT(f) (f == GRETL_PARQUET || f == GRETL_ARROW)
+
+/* formats supporting import_other_subset() */
+#define STATPKG_SUBSET(f) (f == GRETL_DTA ||	\
+			   f == GRETL_SAV ||	\
+			   f == GRETL_WF1)
 
 #define free_datainfo(p) do { if (p != NULL) { clear_datainfo(p, 0); free(p); } \
                             } while (0);
@@ -127,6 +138,15 @@ int import_spreadsheet (const char *fname, GretlFileType ftype,
 int import_other (const char *fname, GretlFileType ftype,
 		  DATASET *dset, gretlopt opt, PRN *prn);
 
+int import_arrow (const char *fname, DATASET *dset,
+		  char **S, int ns, const int *cols,
+		  const char *filter, gretlopt opt,
+		  PRN *prn);
+
+int import_other_subset (const char *fname, GretlFileType ftype,
+			 DATASET *dset, char **S, int ns,
+			 const int *cols, gretlopt opt, PRN *prn);
+
 int peek_at_csv (const char *fname, int n_lines, PRN *prn);
 
 int gretl_read_purebin (const char *fname, DATASET *dset,
@@ -25,6 +25,11 @@
 #include "libset.h"
 #include "dbread.h"
 #include "varinfo_priv.h"
+#include "gretl_mt.h"
+
+#if defined(_OPENMP)
+# include <omp.h>
+#endif
 
 #define DDEBUG 0
 #define FULLDEBUG 0
@@ -35,6 +40,38 @@
 
 static int pad_daily_data (DATASET *dset, int pd, PRN *prn);
 
+/* Counter for invalidating cached name -> ID look-ups of series
+   (see reattach_series() in geneval.c). It is bumped whenever the
+   mapping may have changed: when series are dropped, renamed or
+   reordered, when their visibility at a level of function execution
+   changes, and when a set of series names is created or destroyed.
+   Adding a series does not affect the ID of any existing one.
+   Since the counter is common to all threads it is accessed
+   atomically.
+*/
+
+static gint series_names_gen = 1;
+
+static inline void series_names_changed (void)
+{
+    if (g_atomic_int_add(&series_names_gen, 1) == -1) {
+	/* wrapped round to zero, which means "never resolved" */
+	g_atomic_int_compare_and_exchange(&series_names_gen, 0, 1);
+    }
+}
+
+/**
+ * dataset_names_generation:
+ *
+ * Returns: a number that changes whenever the mapping from series
+ * names to ID numbers may have changed, in any dataset.
+ */
+
+guint32 dataset_names_generation (void)
+{
+    return (guint32) g_atomic_int_get(&series_names_gen);
+}
+
 /**
  * check_dataset_is_changed:
  * @dset: dataset to check.
@@ -78,6 +115,234 @@ static void dataset_set_nobs (DATASET *dset, int n)
     }
 }
 
+/* Apparatus for series whose storage lies in a private (copy-on-write)
+   mapping of a data file rather than on the heap, as produced by
+   "open --mmap" on a purebin .gdtb file. Each mapping carries a count
+   of the data columns pointing into it, and it is released when the
+   last of these is freed.
+*/
+
+typedef struct series_map_ series_map;
+
+struct series_map_ {
+    GMappedFile *mf;    /* the mapped file */
+    const char *start;  /* start of the mapped region */
+    const char *stop;   /* one past the end of the region */
+    int ncols;          /* number of columns still referencing it */
+};
+
+/* Since the maps are identified by address they are common to all
+   threads, and access to them is serialized.
+*/
+
+static series_map *series_maps;
+static int n_series_maps;
+
+G_LOCK_DEFINE_STATIC(series_maps);
+
+/* While any dataset checkpoint is active (see dataset_checkpoint_set()),
+   the storage of series dropped from the end of a dataset is kept in
+   an "arena" for reuse by series added subsequently, rather than being
+   freed; and the arrays of series pointers, names and metadata are not
+   shrunk. This spares the allocator when auxiliary series come and go
+   repeatedly. The arena is emptied when the last checkpoint is
+   restored.
+*/
+
+#define ARENA_MAX 64
+
+static double *arena_x[ARENA_MAX]; /* spare series storage */
+static int arena_n;                /* number of spare series */
+static int arena_len;              /* length of each spare series */
+static int n_checkpoints;          /* number of active checkpoints */
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(arena_x, arena_n, arena_len, n_checkpoints)
+#endif
+
+static int series_is_mapped (const double *x);
+
+static int arena_keep (double *x, int n)
+{
+    if (n_checkpoints == 0 || x == NULL || arena_n == ARENA_MAX) {
+	return 0;
+    } else if (arena_n > 0 && n != arena_len) {
+	return 0;
+    } else if (series_is_mapped(x)) {
+	return 0;
+    }
+
+    arena_len = n;
+    arena_x[arena_n++] = x;
+
+    return 1;
+}
+
+static double *arena_take (int n)
+{
+    if (arena_n > 0 && n == arena_len) {
+	return arena_x[--arena_n];
+    } else {
+	return NULL;
+    }
+}
+
+static void arena_free (void)
+{
+    while (arena_n > 0) {
+	free(arena_x[--arena_n]);
+    }
+}
+
+static series_map *get_series_map (const double *x)
+{
+    const char *s = (const char *) x;
+    int i;
+
+    for (i=0; i<n_series_maps; i++) {
+	if (s >= series_maps[i].start && s < series_maps[i].stop) {
+	    return &series_maps[i];
+	}
+    }
+
+    return NULL;
+}
+
+static int series_is_mapped (const double *x)
+{
+    int ret;
+
+    G_LOCK(series_maps);
+    ret = n_series_maps > 0 && get_series_map(x) != NULL;
+    G_UNLOCK(series_maps);
+
+    return ret;
+}
+
+/**
+ * dataset_register_series_map:
+ * @mf: mapped data file, opened as writable.
+ * @ncols: the number of data columns that point into @mf.
+ *
+ * Transfers ownership of @mf to libgretl, which will unref it
+ * once all of the @ncols series referencing it have been freed
+ * via dataset_release_series().
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int dataset_register_series_map (GMappedFile *mf, int ncols)
+{
+    series_map *maps;
+    const char *s;
+    int err = 0;
+
+    G_LOCK(series_maps);
+    maps = realloc(series_maps, (n_series_maps + 1) * sizeof *maps);
+    if (maps == NULL) {
+	err = E_ALLOC;
+    } else {
+	s = g_mapped_file_get_contents(mf);
+	series_maps = maps;
+	maps[n_series_maps].mf = mf;
+	maps[n_series_maps].start = s;
+	maps[n_series_maps].stop = s + g_mapped_file_get_length(mf);
+	maps[n_series_maps].ncols = ncols;
+	n_series_maps++;
+    }
+    G_UNLOCK(series_maps);
+
+    return err;
+}
+
+/**
+ * dataset_series_maps_active:
+ *
+ * Returns: 1 if the storage of any series lies in a mapped data
+ * file, otherwise 0.
+ */
+
+int dataset_series_maps_active (void)
+{
+    int ret;
+
+    G_LOCK(series_maps);
+    ret = n_series_maps > 0;
+    G_UNLOCK(series_maps);
+
+    return ret;
+}
+
+/**
+ * dataset_release_series:
+ * @x: storage for a data series.
+ *
+ * Frees @x, which is either a regular heap allocation or a column
+ * of a mapped data file; in the latter case the mapping itself is
+ * released when no series refers to it any longer.
+ */
+
+void dataset_release_series (double *x)
+{
+    series_map *m = NULL;
+
+    if (x == NULL) {
+	return;
+    }
+
+    G_LOCK(series_maps);
+    if (n_series_maps > 0) {
+	m = get_series_map(x);
+    }
+    if (m != NULL && --m->ncols == 0) {
+	g_mapped_file_unref(m->mf);
+	*m = series_maps[--n_series_maps];
+	if (n_series_maps == 0) {
+	    free(series_maps);
+	    series_maps = NULL;
+	}
+    }
+    G_UNLOCK(series_maps);
+
+    if (m == NULL) {
+	free(x);
+    }
+}
+
+/**
+ * dataset_unmap_series:
+ * @dset: dataset.
+ *
+ * Copies onto the heap any series in @dset whose storage lies in a
+ * mapped data file. This is required before the length of the series
+ * can be changed.
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int dataset_unmap_series (DATASET *dset)
+{
+    int i;
+
+    if (dset == NULL || dset->Z == NULL || !dataset_series_maps_active()) {
+	return 0;
+    }
+
+    for (i=1; i<dset->v; i++) {
+	if (series_is_mapped(dset->Z[i])) {
+	    double *x = copyvec(dset->Z[i], dset->n);
+
+	    if (x == NULL) {
+		return E_ALLOC;
+	    }
+	    dataset_release_series(dset->Z[i]);
+	    dset->Z[i] = x;
+	}
+    }
+
+    return 0;
+}
+
 /**
  * free_Z:
  * @dset: dataset.
@@ -94,7 +359,7 @@ void free_Z (DATASET *dset)
 	fprintf(stderr, "Freeing Z (%p): %d vars\n", (void *) dset->Z, vmax);
 #endif
 	for (i=0; i<vmax; i++) {
-	    free(dset->Z[i]);
+	    dataset_release_series(dset->Z[i]);
 	}
 	free(dset->Z);
 	dset->Z = NULL;
@@ -174,6 +439,7 @@ void clear_datainfo (DATASET *dset, int code)
     /* if this is not a sub-sample datainfo, free varnames, labels, etc. */
 
     vmax = dset->n_varinfo > 0 ? dset->n_varinfo : dset->v;
+    series_names_changed();
 
     if (code == CLEAR_FULL) {
 	if (dset->varname != NULL) {
@@ -231,16 +497,45 @@ void destroy_dataset (DATASET *dset)
    needs to look up series by name.
 */
 
-static DATASET *current_dset;
+/* A thread that calls libgretl_thread_init() has a current dataset
+   of its own; other threads, OpenMP workers included, see the one
+   for the program as a whole.
+*/
+
+static DATASET *main_dset;
+static DATASET *thread_dset;
+static int thread_owns_dset;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(thread_dset, thread_owns_dset)
+#endif
 
 DATASET *get_current_dataset (void)
 {
-    return current_dset;
+    return thread_owns_dset ? thread_dset : main_dset;
 }
 
 void set_current_dataset (DATASET *dset)
 {
-    current_dset = dset;
+    if (thread_owns_dset) {
+	thread_dset = dset;
+    } else {
+	main_dset = dset;
+    }
+}
+
+/* called by libgretl_thread_init() and libgretl_thread_cleanup() */
+
+void dataset_thread_init (void)
+{
+    thread_owns_dset = 1;
+    thread_dset = NULL;
+}
+
+void dataset_thread_cleanup (void)
+{
+    thread_owns_dset = 0;
+    thread_dset = NULL;
 }
 
 /**
@@ -422,6 +717,7 @@ int shrink_varinfo (DATASET *dset, int nv)
 	free(dset->varname[i]);
 	free_varinfo(dset, i);
     }
+    series_names_changed();
 
     vnames = realloc(dset->varname, nv * sizeof *vnames);
     vi = realloc(dset->varinfo, nv * sizeof *vi);
@@ -460,6 +756,7 @@ int dataset_allocate_varnames (DATASET *dset)
     if (dset->varname == NULL) {
 	return E_ALLOC;
     }
+    series_names_changed();
 
     dset->varinfo = calloc(v, sizeof *dset->varinfo);
     if (dset->varinfo == NULL) {
@@ -1117,6 +1414,11 @@ static int real_dataset_add_observations (DATASET *dset, int n,
 	return 0;
     }
 
+    err = dataset_unmap_series(dset);
+    if (err) {
+	return err;
+    }
+
     bign = oldn + n;
 
     for (i=0; i<dset->v; i++) {
@@ -1274,7 +1576,7 @@ static int panel_dataset_extend_time (DATASET *dset, int n,
 	    }
 	    memcpy(vtmp + j*newT, utmp, usz);
 	}
-	free(dset->Z[i]);
+	dataset_release_series(dset->Z[i]);
 	dset->Z[i] = vtmp;
     }
 
@@ -1362,7 +1664,12 @@ static int real_insert_observation (int pos, DATASET *dset)
     double *x;
     int n = dset->n + 1;
     int i, t;
-    int err = 0;
+    int err;
+
+    err = dataset_unmap_series(dset);
+    if (err) {
+	return err;
+    }
 
     for (i=0; i<dset->v; i++) {
 	x = realloc(dset->Z[i], n * sizeof *x);
@@ -1433,6 +1740,10 @@ int dataset_drop_observations (DATASET *dset, int n)
 	return 0;
     }
 
+    if (dataset_unmap_series(dset)) {
+	return E_ALLOC;
+    }
+
     for (i=0; i<dset->v; i++) {
 	x = realloc(dset->Z[i], newn * sizeof *x);
 	if (x == NULL) {
@@ -1516,6 +1827,61 @@ int dataset_shrink_obs_range (DATASET *dset)
     return err;
 }
 
+/**
+ * dataset_obs_range_from_string:
+ * @s: string specifying a starting and an ending observation,
+ * separated by a space or comma.
+ * @dset: pointer to dataset.
+ * @t1: location to receive the starting observation (0-based).
+ * @t2: location to receive the ending observation.
+ *
+ * Determines the range of observations in @dset specified by @s.
+ * The observations may be given as dates or as 1-based indices;
+ * in the case of panel data the range must comprise whole units.
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int dataset_obs_range_from_string (const char *s, const DATASET *dset,
+				   int *t1, int *t2)
+{
+    char obs1[OBSLEN], obs2[OBSLEN];
+    char *tmp = gretl_strdup(s);
+    int err = 0;
+
+    if (tmp == NULL) {
+	return E_ALLOC;
+    }
+
+    gretl_charsub(tmp, ',', ' ');
+    if (sscanf(tmp, "%15s %15s", obs1, obs2) != 2) {
+	gretl_errmsg_sprintf(_("'%s': invalid observation range"), s);
+	err = E_DATA;
+    }
+    free(tmp);
+
+    if (!err) {
+	*t1 = get_t_from_obs_string(obs1, dset);
+	*t2 = get_t_from_obs_string(obs2, dset);
+	if (*t1 < 0 || *t2 < 0) {
+	    err = E_DATA;
+	} else if (*t2 < *t1) {
+	    gretl_errmsg_set(_("Invalid null sample"));
+	    err = E_DATA;
+	} else if (dataset_is_panel(dset)) {
+	    if (*t1 % dset->pd != 0) {
+		gretl_errmsg_sprintf(_("'%s': invalid starting observation"), obs1);
+		err = E_DATA;
+	    } else if ((*t2 + 1) % dset->pd != 0) {
+		gretl_errmsg_sprintf(_("'%s': invalid ending observation"), obs2);
+		err = E_DATA;
+	    }
+	}
+    }
+
+    return err;
+}
+
 static int dataset_expand_varinfo (int v0, int newvars,
 				   DATASET *dset)
 {
@@ -1601,7 +1967,10 @@ static int real_add_series (int newvars, double *x,
 	    newZ[v0] = x;
 	} else {
 	    for (i=0; i<newvars && !err; i++) {
-		newZ[v0+i] = malloc(dset->n * sizeof **newZ);
+		newZ[v0+i] = arena_take(dset->n);
+		if (newZ[v0+i] == NULL) {
+		    newZ[v0+i] = malloc(dset->n * sizeof **newZ);
+		}
 		if (newZ[v0+i] == NULL) {
 		    err = E_ALLOC;
 		}
@@ -1793,6 +2162,7 @@ int dataset_add_series_as (DATASET *dset, double *x, const char *name)
 	}
 	strcpy(dset->varname[v], name);
 	dset->varinfo[v]->stack_level += 1;
+	series_names_changed();
     }
 
     return err;
@@ -1833,6 +2203,7 @@ int dataset_copy_series_as (DATASET *dset, int v, const char *name)
 	    dset->varinfo[vnew]->flags &= ~VAR_LISTARG;
 	}
 	dset->varinfo[vnew]->stack_level = gretl_function_depth() + 1;
+	series_names_changed();
 #if 0
 	fprintf(stderr, "copied var %d ('%s', level %d) as var %d ('%s', level %d): ",
 		v, dset->varname[v], dset->varinfo[v]->stack_level,
@@ -1866,6 +2237,13 @@ static int shrink_dataset_to_size (DATASET *dset, int nv, int drop)
 	    (drop == DROP_NORMAL)? "DROP_NORMAL" : "DROP_SPECIAL");
 #endif
 
+    if (n_checkpoints > 0) {
+	/* retain the capacity of the arrays for reuse */
+	dset->v = nv;
+	series_names_changed();
+	return 0;
+    }
+
     if (drop == DROP_NORMAL) {
 	char **varname = realloc(dset->varname, nv * sizeof *varname);
 	VARINFO **varinfo = realloc(dset->varinfo, nv * sizeof *varinfo);
@@ -1888,6 +2266,7 @@ static int shrink_dataset_to_size (DATASET *dset, int nv, int drop)
 
     dset->Z = newZ;
     dset->v = nv;
+    series_names_changed();
 
     return 0;
 }
@@ -1978,6 +2357,7 @@ static int real_rename_series (DATASET *dset, int v, const char *name, int *fata
 	dset->varname[v][0] = '\0';
 	strncat(dset->varname[v], name, VNAMELEN-1);
 	set_dataset_is_changed(dset, 1);
+	series_names_changed();
     }
 
     return err;
@@ -2051,7 +2431,7 @@ int dataset_replace_series (DATASET *dset, int v,
     series_set_label(dset, v, descrip);
 
     if (flag == DS_GRAB_VALUES) {
-	free(dset->Z[v]);
+	dataset_release_series(dset->Z[v]);
 	dset->Z[v] = x;
     } else {
 	int t;
@@ -2202,7 +2582,7 @@ static int real_drop_listed_vars (int *list, DATASET *dset,
     for (i=1; i<=list[0]; i++) {
 	v = list[i];
 	if (v > 0 && v < oldv) {
-	    free(dset->Z[v]);
+	    dataset_release_series(dset->Z[v]);
 	    dset->Z[v] = NULL;
 	    if (drop == DROP_NORMAL) {
 		free(dset->varname[v]);
@@ -2479,6 +2859,7 @@ int dataset_renumber_variable (int v_old, int v_new,
     dset->varinfo[v_new] = vinfo;
 
     set_dataset_is_changed(dset, 1);
+    series_names_changed();
 
     return 0;
 }
@@ -2683,121 +3064,6 @@ int maybe_prune_dataset (DATASET **pdset, gretl_string_table *st)
     return err;
 }
 
-/* apparatus for sorting entire dataset */
-
-typedef struct spoints_t_ spoints_t;
-typedef struct spoint_t_ spoint_t;
-
-/* these structs will be passed to qsort() */
-struct spoint_t_ {
-    int obsnum;
-    int nvals;
-    double *vals;
-};
-
-/* wrapper for spoint_t to economize on malloc/free */
-struct spoints_t_ {
-    int n_points;
-    int n_vals;
-    spoint_t *points;
-    double *val;
-};
-
-static void free_spoints (spoints_t *sv)
-{
-    free(sv->points);
-    if (sv->n_vals > 1) {
-	/* if n_vals == 1, @val is borrowed */
-	free(sv->val);
-    }
-    free(sv);
-}
-
-static spoints_t *allocate_spoints (DATASET *dset,
-				    const int *list)
-{
-    spoints_t *sv;
-    int n = dset->n;
-    int v = list[0];
-
-    sv = malloc(sizeof *sv);
-
-    if (sv != NULL) {
-	sv->n_vals = v;
-	sv->n_points = n;
-	sv->points = malloc(n * sizeof *sv->points);
-	if (v == 1) {
-	    /* can point directly at data array */
-	    sv->val = dset->Z[list[1]];
-	} else {
-	    /* need to allocate storage */
-	    sv->val = malloc((n * v) * sizeof(double));
-	}
-	if (sv->points == NULL || sv->val == NULL) {
-	    free_spoints(sv);
-	    sv = NULL;
-	} else {
-	    double *x = sv->val;
-	    int i;
-
-	    for (i=0; i<n; i++) {
-		sv->points[i].obsnum = i;
-		sv->points[i].nvals = v;
-		sv->points[i].vals = x;
-		x += v;
-	    }
-	}
-    }
-
-    return sv;
-}
-
-static int compare_vals_up (const void *a, const void *b)
-{
-    const spoint_t *pa = (const spoint_t *) a;
-    const spoint_t *pb = (const spoint_t *) b;
-    int i, naa, nab, ret = 0;
-
-    for (i=0; i<pa->nvals && !ret; i++) {
-	naa = isnan(pa->vals[i]);
-	nab = isnan(pb->vals[i]);
-	if (naa || nab) {
-	    if (!naa) {
-		ret = -1;
-	    } else if (!nab) {
-		ret = 1;
-	    }
-	} else {
-	    ret = (pa->vals[i] > pb->vals[i]) - (pa->vals[i] < pb->vals[i]);
-	}
-    }
-
-    return ret;
-}
-
-static int compare_vals_down (const void *a, const void *b)
-{
-    const spoint_t *pa = (const spoint_t *) a;
-    const spoint_t *pb = (const spoint_t *) b;
-    int i, naa, nab, ret = 0;
-
-    for (i=0; i<pa->nvals && !ret; i++) {
-	naa = isnan(pa->vals[i]);
-	nab = isnan(pb->vals[i]);
-	if (naa || nab) {
-	    if (!naa) {
-		ret = 1;
-	    } else if (!nab) {
-		ret = -1;
-	    }
-	} else {
-	    ret = (pa->vals[i] < pb->vals[i]) - (pa->vals[i] > pb->vals[i]);
-	}
-    }
-
-    return ret;
-}
-
 /* Turn a string-valued series into an integer-valued series
    representing the places of the strings in lexical order.
 */
@@ -2822,9 +3088,13 @@ static int series_to_lexvals (DATASET *dset, int v, int *targ)
     series_table *st = series_get_string_table(dset, v);
     char **strs = series_table_get_strings(st, &n_strs);
     lexval *lexvals;
+    int *rank;
 
     lexvals = calloc(n_strs, sizeof *lexvals);
-    if (lexvals == NULL) {
+    rank = malloc((n_strs + 1) * sizeof *rank);
+    if (lexvals == NULL || rank == NULL) {
+	free(lexvals);
+	free(rank);
 	return E_ALLOC;
     }
 
@@ -2835,55 +3105,102 @@ static int series_to_lexvals (DATASET *dset, int v, int *targ)
 
     qsort(lexvals, n_strs, sizeof *lexvals, compare_lexvals);
 
+    /* map each code to its lexical place, once */
+    for (i=0; i<n_strs; i++) {
+	rank[lexvals[i].code] = i+1;
+    }
+
     for (t=0; t<dset->n; t++) {
 	if (na(dset->Z[v][t])) {
 	    targ[t] = INT_MAX;
 	} else {
 	    ct = (int) dset->Z[v][t];
-	    targ[t] = 0;
-	    for (i=0; i<n_strs; i++) {
-		if (ct == lexvals[i].code) {
-		    targ[t] = i+1;
-		    break;
-		}
-	    }
+	    targ[t] = (ct >= 1 && ct <= n_strs)? rank[ct] : 0;
 	}
     }
 
     free(lexvals);
+    free(rank);
+
+    return 0;
+}
+
+/* Reorder series 1 to v-1 of @dset according to the permutation
+   @idx. The series are handled in parallel when the volume of data
+   is large enough, each thread gathering into its own buffer; the
+   number of threads is capped so that the buffers stay within
+   PERMUTE_MAXBUF doubles in total.
+*/
+
+#define PERMUTE_MAXBUF (1 << 27)
+
+static int dataset_apply_permutation (DATASET *dset, const int *idx)
+{
+    double *buf;
+    int n = dset->n;
+    int nt = 1;
+    int i;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+    if (dset->v > 2 && gretl_use_openmp((guint64) n * (dset->v - 1))) {
+	nt = MIN(gretl_get_omp_threads(), dset->v - 1);
+	nt = MIN(nt, MAX(1, PERMUTE_MAXBUF / MAX(n, 1)));
+    }
+#endif
+
+    /* allocate all the workspace up front, so we don't fail
+       with the dataset partially reordered */
+    buf = malloc((size_t) nt * n * sizeof *buf);
+    if (buf == NULL) {
+	return E_ALLOC;
+    }
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp parallel for schedule(dynamic, 4) if (nt > 1) num_threads(nt)
+#endif
+    for (i=1; i<dset->v; i++) {
+	double *x = buf;
+	const double *z = dset->Z[i];
+	int t;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+	x += (size_t) omp_get_thread_num() * n;
+#endif
+	for (t=0; t<n; t++) {
+	    x[t] = z[idx[t]];
+	}
+	memcpy(dset->Z[i], x, n * sizeof *x);
+    }
+
+    free(buf);
 
     return 0;
 }
 
 int dataset_sort_by (DATASET *dset, const int *list, gretlopt opt)
 {
-    spoints_t *sv = NULL;
-    double *x = NULL;
+    const double **keys = NULL;
+    double *xd = NULL;
     char **S = NULL;
     int *xs = NULL;
     int *xsi = NULL;
+    int *idx = NULL;
     int ns = list[0];
     int nsvals = 0;
     int i, t, v;
     int err = 0;
 
-    sv = allocate_spoints(dset, list);
-    if (sv == NULL) {
-	return E_ALLOC;
-    }
-
-    x = malloc(dset->n * sizeof *x);
-    if (x == NULL) {
-	free_spoints(sv);
-	return E_ALLOC;
+    keys = malloc(ns * sizeof *keys);
+    if (keys == NULL) {
+	err = E_ALLOC;
+	goto bailout;
     }
 
     if (dset->S != NULL) {
 	S = malloc(dset->n * sizeof *S);
 	if (S == NULL) {
-	    free_spoints(sv);
-	    free(x);
-	    return E_ALLOC;
+	    err = E_ALLOC;
+	    goto bailout;
 	}
     }
 
@@ -2900,7 +3217,8 @@ int dataset_sort_by (DATASET *dset, const int *list, gretlopt opt)
     }
     if (nsvals > 0) {
 	xs = malloc(nsvals * dset->n * sizeof *xs);
-	if (xs == NULL) {
+	xd = malloc(nsvals * dset->n * sizeof *xd);
+	if (xs == NULL || xd == NULL) {
 	    err = E_ALLOC;
 	} else {
 	    xsi = xs;
@@ -2921,41 +3239,35 @@ int dataset_sort_by (DATASET *dset, const int *list, gretlopt opt)
     for (i=0; i<ns; i++) {
 	v = list[i+1];
 	if (is_string_valued(dset, v)) {
+	    double *xdi = xd + (xsi - xs);
+
 	    for (t=0; t<dset->n; t++) {
-		if (xsi[t] == INT_MAX) {
-		    sv->points[t].vals[i] = NADBL;
-		} else {
-		    sv->points[t].vals[i] = (double) xsi[t];
-		}
+		xdi[t] = (xsi[t] == INT_MAX)? NADBL : (double) xsi[t];
 	    }
+	    keys[i] = xdi;
 	    xsi += dset->n;
-	} else if (ns > 1) {
-	    for (t=0; t<dset->n; t++) {
-		sv->points[t].vals[i] = dset->Z[v][t];
-	    }
+	} else {
+	    keys[i] = dset->Z[v];
 	}
     }
 
-    if (opt & OPT_D) {
-	/* descending */
-	qsort(sv->points, dset->n, sizeof(spoint_t), compare_vals_down);
-    } else {
-	/* ascending */
-	qsort(sv->points, dset->n, sizeof(spoint_t), compare_vals_up);
+    /* a single stable permutation serves for all series */
+    idx = gretl_sort_index(keys, ns, dset->n, (opt & OPT_D)? 1 : 0,
+			   &err);
+    if (err) {
+	goto bailout;
     }
 
     /* reorder data values */
-    for (i=1; i<dset->v; i++) {
-	for (t=0; t<dset->n; t++) {
-	    x[t] = dset->Z[i][sv->points[t].obsnum];
-	}
-	memcpy(dset->Z[i], x, dset->n * sizeof *x);
+    err = dataset_apply_permutation(dset, idx);
+    if (err) {
+	goto bailout;
     }
 
     if (S != NULL) {
 	/* reorder observation markers */
 	for (t=0; t<dset->n; t++) {
-	    S[t] = dset->S[sv->points[t].obsnum];
+	    S[t] = dset->S[idx[t]];
 	}
 	for (t=0; t<dset->n; t++) {
 	    dset->S[t] = S[t];
@@ -2964,10 +3276,11 @@ int dataset_sort_by (DATASET *dset, const int *list, gretlopt opt)
 
  bailout:
 
-    free_spoints(sv);
+    free(keys);
+    free(idx);
     free(xs);
+    free(xd);
     free(S);
-    free(x);
 
     return err;
 }
@@ -3045,7 +3358,9 @@ int dataset_drop_last_variables (DATASET *dset, int delvars)
     for (i=newv; i<dset->v; i++) {
 	free(dset->varname[i]);
 	free_varinfo(dset, i);
-	free(dset->Z[i]);
+	if (!arena_keep(dset->Z[i], dset->n)) {
+	    dataset_release_series(dset->Z[i]);
+	}
 	dset->Z[i] = NULL;
     }
 
@@ -3084,7 +3399,7 @@ int dataset_drop_last_variables (DATASET *dset, int delvars)
 		    fset->v, newv);
 #endif
 	    for (i=newv; i<fset->v; i++) {
-		free(fset->Z[i]);
+		dataset_release_series(fset->Z[i]);
 		fset->Z[i] = NULL;
 	    }
 	    err = shrink_dataset_to_size(fset, newv, DROP_SPECIAL);
@@ -3094,6 +3409,57 @@ int dataset_drop_last_variables (DATASET *dset, int delvars)
     return err;
 }
 
+/**
+ * dataset_checkpoint_set:
+ * @dset: pointer to dataset.
+ * @cp: location to record the state of @dset.
+ *
+ * Records the number of series in @dset and its sample range,
+ * prior to the temporary addition of series and/or change of
+ * sample. Until the matching call to dataset_checkpoint_restore(),
+ * the storage of series dropped from the end of a dataset is
+ * recycled rather than freed. Checkpoints may be nested, but
+ * must be restored in reverse order.
+ */
+
+void dataset_checkpoint_set (const DATASET *dset, dset_checkpoint *cp)
+{
+    cp->v = dset->v;
+    cp->t1 = dset->t1;
+    cp->t2 = dset->t2;
+    n_checkpoints++;
+}
+
+/**
+ * dataset_checkpoint_restore:
+ * @dset: pointer to dataset.
+ * @cp: state recorded by dataset_checkpoint_set().
+ *
+ * Drops any series added to @dset since @cp was recorded and
+ * restores the sample range. If this is the outermost checkpoint,
+ * recycled series storage is freed.
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int dataset_checkpoint_restore (DATASET *dset, const dset_checkpoint *cp)
+{
+    int err = 0;
+
+    if (dset->v > cp->v) {
+	err = dataset_drop_last_variables(dset, dset->v - cp->v);
+    }
+
+    dset->t1 = cp->t1;
+    dset->t2 = cp->t2;
+
+    if (n_checkpoints > 0 && --n_checkpoints == 0) {
+	arena_free();
+    }
+
+    return err;
+}
+
 /**
  * build_stacked_series:
  * @pstack: location for returning stacked series.
@@ -4286,6 +4652,9 @@ void series_set_flag (DATASET *dset, int i, VarFlags flag)
 {
     if (i > 0 && i < dset->v) {
 	dset->varinfo[i]->flags |= flag;
+	if (flag & VAR_LISTARG) {
+	    series_names_changed();
+	}
     }
 }
 
@@ -4302,6 +4671,9 @@ void series_unset_flag (DATASET *dset, int i, VarFlags flag)
 {
     if (i > 0 && i < dset->v) {
 	dset->varinfo[i]->flags &= ~flag;
+	if (flag & VAR_LISTARG) {
+	    series_names_changed();
+	}
     }
 }
 
@@ -4334,6 +4706,7 @@ void series_zero_flags (DATASET *dset, int i)
 {
     if (i >= 0 && i < dset->v) {
 	dset->varinfo[i]->flags = 0;
+	series_names_changed();
     }
 }
 
@@ -4563,6 +4936,7 @@ void series_set_stack_level (DATASET *dset, int i, int level)
 {
     if (i > 0 && i < dset->v) {
 	dset->varinfo[i]->stack_level = level;
+	series_names_changed();
     }
 }
 
@@ -4570,6 +4944,7 @@ void series_increment_stack_level (DATASET *dset, int i)
 {
     if (i > 0 && i < dset->v) {
 	dset->varinfo[i]->stack_level += 1;
+	series_names_changed();
     }
 }
 
@@ -4577,6 +4952,7 @@ void series_decrement_stack_level (DATASET *dset, int i)
 {
     if (i > 0 && i < dset->v) {
 	dset->varinfo[i]->stack_level -= 1;
+	series_names_changed();
     }
 }
 
@@ -4599,6 +4975,7 @@ void series_ensure_level_zero (DATASET *dset)
 	for (i=1; i<dset->v; i++) {
 	    if (dset->varinfo[i]->stack_level > 0) {
 		dset->varinfo[i]->stack_level = 0;
+		series_names_changed();
 	    }
 	}
     }
@@ -5170,32 +5547,45 @@ int merge_string_tables (DATASET *l_dset, int lvar,
 			 DATASET *r_dset, int rvar)
 {
     series_table *lst = l_dset->varinfo[lvar]->st;
-    double dx, *x = r_dset->Z[rvar];
-    const char *sr;
-    int t, idx, err = 0;
+    series_table *rst = r_dset->varinfo[rvar]->st;
+    double *x = r_dset->Z[rvar];
+    char **S;
+    int *map;
+    int t, k, ns;
+    int err = 0;
+
+    S = series_table_get_strings(rst, &ns);
+    if (S == NULL) {
+	return E_DATA;
+    }
+
+    /* map the right-hand codes onto those of @lst, once */
+    map = series_table_map(rst, lst);
+    if (map == NULL) {
+	return E_ALLOC;
+    }
 
     for (t=0; t<r_dset->n && !err; t++) {
 	if (na(x[t])) {
 	    continue;
 	}
-	/* get the right-hand side string associated with x[t] */
-	sr = series_get_string_for_value(r_dset, rvar, x[t]);
-	/* and look up its numeric code on the left */
-	dx = series_decode_string(l_dset, lvar, sr);
-	if (!na(dx)) {
-	    /* got a match: apply the code from @lst */
-	    x[t] = dx;
-	} else {
+	k = (int) x[t];
+	if (k < 1 || k > ns) {
+	    err = E_DATA;
+	} else if (map[k] < 0) {
 	    /* no match: we need to add a string to @lst */
-	    idx = series_table_add_string(lst, sr);
-	    if (idx < 0) {
+	    map[k] = series_table_add_string(lst, S[k-1]);
+	    if (map[k] < 0) {
 		err = E_ALLOC;
-	    } else {
-		x[t] = (double) idx;
 	    }
 	}
+	if (!err) {
+	    x[t] = (double) map[k];
+	}
     }
 
+    free(map);
+
     return err;
 }
 
@@ -90,6 +90,17 @@ typedef enum {
 
 typedef struct series_table_ series_table;
 
+typedef struct dset_checkpoint_ dset_checkpoint;
+
+/* record of the state of a dataset, for cheap restoration
+   after temporary additions of series or changes of sample
+*/
+struct dset_checkpoint_ {
+    int v;  /* number of series */
+    int t1; /* start of sample range */
+    int t2; /* end of sample range */
+};
+
 /**
  * dataset_is_cross_section:
  * @p: pointer to dataset.
@@ -323,6 +334,14 @@ typedef struct series_table_ series_table;
  */
 #define dset_set_data(d,i,t,x) (d->Z[i][t]=x)
 
+int dataset_register_series_map (GMappedFile *mf, int ncols);
+
+int dataset_series_maps_active (void);
+
+void dataset_release_series (double *x);
+
+int dataset_unmap_series (DATASET *dset);
+
 void free_Z (DATASET *dset);
 
 DATASET *datainfo_new (void);
@@ -340,8 +359,14 @@ void destroy_dataset (DATASET *dset);
 
 DATASET *get_current_dataset (void);
 
+guint32 dataset_names_generation (void);
+
 void set_current_dataset (DATASET *dset);
 
+void dataset_thread_init (void);
+
+void dataset_thread_cleanup (void);
+
 void clear_datainfo (DATASET *dset, int code);
 
 int allocate_Z (DATASET *dset, gretlopt opt);
@@ -376,6 +401,9 @@ int dataset_drop_observations (DATASET *dset, int n);
 
 int dataset_shrink_obs_range (DATASET *dset);
 
+int dataset_obs_range_from_string (const char *s, const DATASET *dset,
+				   int *t1, int *t2);
+
 int dataset_add_series (DATASET *dset, int newvars);
 
 int matrix_dataset_expand_Z (DATASET *dset, int newcols);
@@ -415,6 +443,12 @@ int dataset_destroy_hidden_variables (DATASET *dset, int vmin);
 
 int dataset_drop_last_variables (DATASET *dset, int delvars);
 
+void dataset_checkpoint_set (const DATASET *dset,
+			     dset_checkpoint *cp);
+
+int dataset_checkpoint_restore (DATASET *dset,
+				const dset_checkpoint *cp);
+
 int dataset_renumber_variable (int v_old, int v_new, 
 			       DATASET *dset);
 
@@ -34,6 +34,7 @@
 #endif
 
 #include <glib.h>
+#include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
 
@@ -105,6 +106,289 @@ static FILE *open_binfile (const char *dbbase, int offset, int *err)
     return fp;
 }
 
+/* In-memory cache of the index of a native database, plus a
+   mapping of its binary file. The index is read once, on the
+   first lookup, into a hash table keyed by series name, with the
+   offset of each series in the binary file worked out as we go;
+   it's then reused for as long as the index file is unchanged.
+   On the same basis the binary file is mapped into memory, so
+   that retrieving a series involves no seeking or reading.
+*/
+
+typedef struct db_entry_ db_entry;
+
+struct db_entry_ {
+    char *line1;   /* name plus description */
+    char *line2;   /* frequency, range and number of obs */
+    int offset;    /* byte offset of the data in the .bin file */
+};
+
+typedef struct native_db_cache_ native_db_cache;
+
+struct native_db_cache_ {
+    char *idxname;     /* path to the .idx file */
+    gint64 idxsize;    /* size of same */
+    gint64 idxtime;    /* and its modification time */
+    char *binname;     /* path to the .bin file */
+    gint64 binsize;    /* size of same */
+    gint64 bintime;    /* and its modification time */
+    db_entry *entries; /* series, in index order */
+    char **names;      /* names of same */
+    int n;             /* number of series */
+    GHashTable *ht;    /* lookup: name -> entry */
+    GMappedFile *bin;  /* mapping of the .bin file, or NULL */
+};
+
+static native_db_cache *ndb_cache;
+
+static int file_size_and_time (const char *fname, gint64 *size,
+			       gint64 *mtime)
+{
+    struct stat buf;
+
+    if (gretl_stat(fname, &buf) != 0) {
+	return E_FOPEN;
+    }
+
+    *size = (gint64) buf.st_size;
+    *mtime = (gint64) buf.st_mtime;
+
+    return 0;
+}
+
+/**
+ * native_db_cache_clear:
+ *
+ * Frees the cached index and binary-file mapping of the most
+ * recently accessed native database, if any. This must be called
+ * before a database is modified, and before the program exits.
+ */
+
+void native_db_cache_clear (void)
+{
+    native_db_cache *nc = ndb_cache;
+    int i;
+
+    if (nc == NULL) {
+	return;
+    }
+
+    for (i=0; i<nc->n; i++) {
+	g_free(nc->entries[i].line1);
+	g_free(nc->entries[i].line2);
+    }
+    free(nc->entries);
+    strings_array_free(nc->names, nc->n);
+    if (nc->ht != NULL) {
+	g_hash_table_destroy(nc->ht);
+    }
+    if (nc->bin != NULL) {
+	g_mapped_file_unref(nc->bin);
+    }
+    g_free(nc->idxname);
+    g_free(nc->binname);
+    free(nc);
+
+    ndb_cache = NULL;
+}
+
+static int native_db_cache_load (native_db_cache *nc)
+{
+    /* as in the original line-by-line reader, lines of more
+       than 1023 bytes are not supported */
+    char s1[1024], s2[72];
+    char sername[VNAMELEN];
+    FILE *fp;
+    int nalloc = 0;
+    int offset = 0;
+    int nobs, err = 0;
+
+    fp = gretl_fopen(nc->idxname, "rb");
+    if (fp == NULL) {
+	return E_FOPEN;
+    }
+
+    nc->ht = g_hash_table_new(g_str_hash, g_str_equal);
+
+    while (!err && fgets(s1, sizeof s1, fp)) {
+	if (*s1 == '#') {
+	    continue;
+	}
+	if (gretl_scan_varname(s1, sername) != 1) {
+	    break;
+	}
+	if (fgets(s2, sizeof s2, fp) == NULL) {
+	    err = DB_PARSE_ERROR;
+	    break;
+	}
+	if (sscanf(s2, "%*c %*s %*s %*s %*s %*s %d", &nobs) != 1) {
+	    gretl_errmsg_set(_("Failed to parse series information"));
+	    err = DB_PARSE_ERROR;
+	    break;
+	}
+	if (!strcmp(sername, DB_TOMBSTONE)) {
+	    /* superseded: skip the data */
+	    offset += nobs * sizeof(dbnumber);
+	    continue;
+	}
+	if (nc->n == nalloc) {
+	    int newsize = (nalloc == 0)? 1024 : 2 * nalloc;
+	    db_entry *e = realloc(nc->entries, newsize * sizeof *e);
+	    char **S = realloc(nc->names, newsize * sizeof *S);
+
+	    if (e != NULL) {
+		nc->entries = e;
+	    }
+	    if (S != NULL) {
+		nc->names = S;
+	    }
+	    if (e == NULL || S == NULL) {
+		err = E_ALLOC;
+		break;
+	    }
+	    nalloc = newsize;
+	}
+	nc->entries[nc->n].line1 = g_strdup(s1);
+	nc->entries[nc->n].line2 = g_strdup(s2);
+	nc->entries[nc->n].offset = offset;
+	nc->names[nc->n] = gretl_strdup(sername);
+	/* the first occurrence of a name takes precedence */
+	if (g_hash_table_lookup(nc->ht, sername) == NULL) {
+	    g_hash_table_insert(nc->ht, nc->names[nc->n],
+				&nc->entries[nc->n]);
+	}
+	nc->n += 1;
+	offset += nobs * sizeof(dbnumber);
+    }
+
+    fclose(fp);
+
+    return err;
+}
+
+/* Get the cache for the index file @idxname, building it if
+   need be. If @binname is non-NULL, also try to map the binary
+   file; failure to do so is not an error, since the caller can
+   fall back on reading the file.
+*/
+
+static native_db_cache *get_native_db_cache (const char *idxname,
+					     const char *binname,
+					     int *err)
+{
+    native_db_cache *nc = ndb_cache;
+    gint64 size, mtime;
+
+    *err = file_size_and_time(idxname, &size, &mtime);
+    if (*err) {
+	native_db_cache_clear();
+	return NULL;
+    }
+
+    if (nc != NULL && (strcmp(nc->idxname, idxname) ||
+		       nc->idxsize != size || nc->idxtime != mtime)) {
+	native_db_cache_clear();
+	nc = NULL;
+    }
+
+    if (nc == NULL) {
+	nc = calloc(1, sizeof *nc);
+	if (nc == NULL) {
+	    *err = E_ALLOC;
+	    return NULL;
+	}
+	nc->idxname = g_strdup(idxname);
+	nc->idxsize = size;
+	nc->idxtime = mtime;
+	ndb_cache = nc;
+	*err = native_db_cache_load(nc);
+	if (*err) {
+	    native_db_cache_clear();
+	    return NULL;
+	}
+    }
+
+    if (binname != NULL && nc->bin != NULL) {
+	/* check that the mapping is still current */
+	if (strcmp(nc->binname, binname) ||
+	    file_size_and_time(binname, &size, &mtime) ||
+	    nc->binsize != size || nc->bintime != mtime) {
+	    g_mapped_file_unref(nc->bin);
+	    nc->bin = NULL;
+	}
+    }
+
+    if (binname != NULL && nc->bin == NULL &&
+	!file_size_and_time(binname, &size, &mtime)) {
+	nc->bin = g_mapped_file_new(binname, FALSE, NULL);
+	if (nc->bin != NULL) {
+	    g_free(nc->binname);
+	    nc->binname = g_strdup(binname);
+	    nc->binsize = size;
+	    nc->bintime = mtime;
+	}
+    }
+
+    return nc;
+}
+
+/* Build the names of the .idx and .bin files for @dbbase, which
+   may or may not carry the .bin suffix. */
+
+static void native_db_filenames (const char *dbbase,
+				 char *idxname,
+				 char *binname)
+{
+    int n = strlen(dbbase);
+
+    if (has_suffix(dbbase, ".bin")) {
+	n -= 4;
+    }
+    sprintf(idxname, "%.*s.idx", n, dbbase);
+    sprintf(binname, "%.*s.bin", n, dbbase);
+}
+
+/* Transcribe the values of the series described by @sinfo from
+   the mapped binary file @bin; return -1 if the mapping is for
+   some reason unusable, so the caller should read the file.
+*/
+
+static int get_mapped_db_data (GMappedFile *bin, SERIESINFO *sinfo,
+			       double **Z)
+{
+    const char *buf = g_mapped_file_get_contents(bin);
+    gsize len = g_mapped_file_get_length(bin);
+    char numstr[32];
+    dbnumber x;
+    int v = sinfo->v;
+    int t, t1, t2;
+    gsize pos;
+
+    t1 = sinfo->t1;
+    t2 = (sinfo->t2 > 0)? sinfo->t2 : sinfo->nobs - 1;
+
+    if (sinfo->offset < 0 || t2 < t1) {
+	return -1;
+    }
+
+    pos = (gsize) sinfo->offset;
+    if (pos + (gsize) (t2 - t1 + 1) * sizeof x > len) {
+	return DB_PARSE_ERROR;
+    }
+
+    for (t=t1; t<=t2; t++) {
+	memcpy(&x, buf + pos, sizeof x);
+	pos += sizeof x;
+	sprintf(numstr, "%.7g", (double) x); /* N.B. converting a float */
+	Z[v][t] = atof(numstr);
+	if (Z[v][t] == DBNA) {
+	    Z[v][t] = NADBL;
+	}
+    }
+
+    return 0;
+}
+
 /**
  * get_native_db_data:
  * @dbbase:
@@ -117,12 +401,27 @@ static FILE *open_binfile (const char *dbbase, int offset, int *err)
 int get_native_db_data (const char *dbbase, SERIESINFO *sinfo,
 			double **Z)
 {
+    char idxname[FILENAME_MAX];
+    char binname[FILENAME_MAX];
+    native_db_cache *nc;
     char numstr[32];
     FILE *fp;
     dbnumber x;
     int v = sinfo->v;
     int t, t2, err = 0;
 
+    if (strlen(dbbase) < FILENAME_MAX - 4) {
+	native_db_filenames(dbbase, idxname, binname);
+	nc = get_native_db_cache(idxname, binname, &err);
+	if (nc != NULL && nc->bin != NULL) {
+	    err = get_mapped_db_data(nc->bin, sinfo, Z);
+	    if (err >= 0) {
+		return err;
+	    }
+	}
+	err = 0;
+    }
+
     fp = open_binfile(dbbase, sinfo->offset, &err);
     if (err) {
 	return err;
@@ -147,8 +446,106 @@ int get_native_db_data (const char *dbbase, SERIESINFO *sinfo,
     return err;
 }
 
+static int is_glob (const char *s)
+{
+    return strchr(s, '*') || strchr(s, '?');
+}
+
 #ifdef USE_CURL
 
+/* Series data from the gretl server, retrieved ahead of need so
+   that a multi-series import can issue its requests concurrently.
+*/
+
+static char **prefetch_names;
+static char **prefetch_bufs;
+static int n_prefetch;
+
+static void remote_prefetch_clear (void)
+{
+    int i;
+
+    for (i=0; i<n_prefetch; i++) {
+	free(prefetch_bufs[i]);
+    }
+    strings_array_free(prefetch_names, n_prefetch);
+    free(prefetch_bufs);
+    prefetch_names = prefetch_bufs = NULL;
+    n_prefetch = 0;
+}
+
+static void remote_prefetch (char **vnames, int n)
+{
+    char **names, **bufs, **tmp;
+    int i, m = 0;
+
+    names = strings_array_new(n);
+    if (names == NULL) {
+	return;
+    }
+    for (i=0; i<n; i++) {
+	if (!is_glob(vnames[i])) {
+	    names[m++] = gretl_strdup(vnames[i]);
+	}
+    }
+    if (m < 2) {
+	/* not worth it */
+	strings_array_free(names, n);
+	return;
+    }
+
+    bufs = calloc(m, sizeof *bufs);
+    if (bufs == NULL ||
+	retrieve_remote_db_data_multi(saved_db_name, (const char **) names,
+				      m, bufs)) {
+	/* we'll fall back on retrieving series one at a time */
+	strings_array_free(names, n);
+	free(bufs);
+	return;
+    }
+
+    /* add to any data already on hand */
+    tmp = realloc(prefetch_names, (n_prefetch + m) * sizeof *tmp);
+    if (tmp != NULL) {
+	prefetch_names = tmp;
+	tmp = realloc(prefetch_bufs, (n_prefetch + m) * sizeof *tmp);
+    }
+    if (tmp == NULL) {
+	for (i=0; i<m; i++) {
+	    free(bufs[i]);
+	}
+    } else {
+	prefetch_bufs = tmp;
+	for (i=0; i<m; i++) {
+	    prefetch_names[n_prefetch] = names[i];
+	    prefetch_bufs[n_prefetch] = bufs[i];
+	    names[i] = NULL;
+	    n_prefetch++;
+	}
+    }
+
+    strings_array_free(names, n);
+    free(bufs);
+}
+
+/* If the data for @vname have been prefetched, hand them over */
+
+static char *remote_prefetched (const char *vname)
+{
+    char *ret = NULL;
+    int i;
+
+    for (i=0; i<n_prefetch; i++) {
+	if (prefetch_bufs[i] != NULL && !strcmp(vname, prefetch_names[i])) {
+	    ret = prefetch_bufs[i];
+	    prefetch_bufs[i] = NULL;
+	    break;
+	}
+    }
+
+    return ret;
+}
+
 /**
  * get_remote_db_data:
  * @dbbase:
@@ -170,10 +567,13 @@ int get_remote_db_data (const char *dbbase, SERIESINFO *sinfo,
     netfloat nf;
 #endif
 
-    err = retrieve_remote_db_data(dbbase, sinfo->varname, &getbuf);
-    if (err) {
-	free(getbuf);
-	return E_FOPEN;
+    getbuf = remote_prefetched(sinfo->varname);
+    if (getbuf == NULL) {
+	err = retrieve_remote_db_data(dbbase, sinfo->varname, &getbuf);
+	if (err) {
+	    free(getbuf);
+	    return E_FOPEN;
+	}
     }
 
     t2 = (sinfo->t2 > 0)? sinfo->t2 : sinfo->nobs - 1;
@@ -352,67 +752,37 @@ static char *native_db_index_name (void)
     return fname;
 }
 
-static int db_match_glob (FILE *fp,
-			  char *line, int linelen,
-			  GPatternSpec *pspec,
-			  char **S, int *err)
-{
-    char vname[VNAMELEN], l2[72];
-    int n = 0;
-
-    while (fgets(line, linelen, fp) && !*err) {
-	if (*line == '#') {
-	    continue;
-	}
-	if (gretl_scan_varname(line, vname) != 1) {
-	    break;
-	}
-	if (g_pattern_match_string(pspec, vname)) {
-	    if (S != NULL) {
-		S[n] = gretl_strdup(vname);
-	    }
-	    n++;
-	}
-	if (fgets(l2, sizeof l2, fp) == NULL) {
-	    *err = DB_PARSE_ERROR;
-	}
-    }
-
-    return n;
-}
-
 static char **native_db_match_series (const char *glob, int *nmatch,
 				      const char *idxname, int *err)
 {
+    native_db_cache *nc;
     GPatternSpec *pspec;
     char **S = NULL;
-    FILE *fp = NULL;
-    char line[256];
+    int i, n = 0;
 
-    fp = gretl_fopen(idxname, "rb");
-    if (fp == NULL) {
-	*err = E_FOPEN;
-	*nmatch = 0;
+    *nmatch = 0;
+
+    nc = get_native_db_cache(idxname, NULL, err);
+    if (nc == NULL) {
 	return NULL;
     }
 
     pspec = g_pattern_spec_new(glob);
 
-    *nmatch = db_match_glob(fp, line, sizeof line, pspec, NULL, err);
-
-    if (!*err && *nmatch > 0) {
-	S = strings_array_new(*nmatch);
-	if (S == NULL) {
-	    *nmatch = 0;
-	    *err = E_ALLOC;
-	} else {
-	    rewind(fp);
-	    db_match_glob(fp, line, sizeof line, pspec, S, err);
+    for (i=0; i<nc->n && !*err; i++) {
+	if (g_pattern_match_string(pspec, nc->names[i])) {
+	    *err = strings_array_add(&S, &n, nc->names[i]);
 	}
     }
 
     g_pattern_spec_free(pspec);
-    fclose(fp);
+
+    if (*err) {
+	strings_array_free(S, n);
+	S = NULL;
+    } else {
+	*nmatch = n;
+    }
 
     return S;
 }
@@ -421,63 +791,34 @@ static int get_native_series_info (const char *series,
 				   SERIESINFO *sinfo,
 				   const char *idxname)
 {
-    FILE *fp = NULL;
-    char sername[VNAMELEN];
-    /* 2019-01-08: enlarge @s1 from 256 to 1024 */
-    char s1[1024], s2[72];
+    native_db_cache *nc;
+    db_entry *entry;
     char stobs[OBSLEN], endobs[OBSLEN];
     char pdc;
-    int offset = 0;
-    int gotit = 0, err = 0;
-    int n;
+    int err = 0;
 
-    fp = gretl_fopen(idxname, "rb");
-    if (fp == NULL) {
-	return E_FOPEN;
+    nc = get_native_db_cache(idxname, NULL, &err);
+    if (nc == NULL) {
+	return err;
     }
 
-    while (fgets(s1, sizeof s1, fp) && !gotit) {
-	if (*s1 == '#') {
-	    continue;
-	}
-	if (gretl_scan_varname(s1, sername) != 1) {
-	    break;
-	}
-	if (!strcmp(series, sername)) {
-	    gotit = 1;
-	    strcpy(sinfo->varname, sername);
-	}
-	if (fgets(s2, sizeof s2, fp) == NULL) {
-	    err = DB_PARSE_ERROR;
-	    break;
-	}
-	if (gotit) {
-	    get_native_series_comment(sinfo, s1);
-	    if (sscanf(s2, "%c %10s %*s %10s %*s %*s %d",
-		       &pdc, stobs, endobs, &sinfo->nobs) != 4) {
-		gretl_errmsg_set(_("Failed to parse series information"));
-		err = DB_PARSE_ERROR;
-	    } else {
-		get_native_series_pd(sinfo, pdc);
-		get_native_series_obs(sinfo, stobs, endobs);
-		sinfo->offset = offset;
-		sinfo->t2 = sinfo->nobs - 1;
-	    }
-	} else {
-	    if (sscanf(s2, "%*c %*s %*s %*s %*s %*s %d", &n) != 1) {
-		gretl_errmsg_set(_("Failed to parse series information"));
-		err = DB_PARSE_ERROR;
-	    } else {
-		offset += n * sizeof(dbnumber);
-	    }
-	}
+    entry = g_hash_table_lookup(nc->ht, series);
+    if (entry == NULL) {
+	gretl_errmsg_sprintf(_("Series not found, '%s'"), series);
+	return DB_NO_SUCH_SERIES;
     }
 
-    fclose(fp);
-
-    if (!err && !gotit) {
-	gretl_errmsg_sprintf(_("Series not found, '%s'"), series);
-	err = DB_NO_SUCH_SERIES;
+    strcpy(sinfo->varname, series);
+    get_native_series_comment(sinfo, entry->line1);
+    if (sscanf(entry->line2, "%c %10s %*s %10s %*s %*s %d",
+	       &pdc, stobs, endobs, &sinfo->nobs) != 4) {
+	gretl_errmsg_set(_("Failed to parse series information"));
+	err = DB_PARSE_ERROR;
+    } else {
+	get_native_series_pd(sinfo, pdc);
+	get_native_series_obs(sinfo, stobs, endobs);
+	sinfo->offset = entry->offset;
+	sinfo->t2 = sinfo->nobs - 1;
     }
 
     return err;
@@ -797,6 +1138,8 @@ int set_db_name (const char *fname, int filetype, PRN *prn)
     FILE *fp;
     int err = 0;
 
+    native_db_cache_clear();
+
     *saved_db_name = '\0';
     if (fname != NULL) {
 	strncat(saved_db_name, fname, MAXLEN - 1);
@@ -1757,11 +2100,6 @@ static int get_one_db_series (const char *sername,
     return err;
 }
 
-static int is_glob (const char *s)
-{
-    return strchr(s, '*') || strchr(s, '?');
-}
-
 static int process_import_name_option (char *vname)
 {
     const char *s = get_optval_string(DATA, OPT_N);
@@ -1895,6 +2233,13 @@ int db_get_series (const char *line, DATASET *dset,
 	}
     }
 
+#ifdef USE_CURL
+    if (!err && saved_db_type == GRETL_NATIVE_DB_WWW) {
+	/* get the data for multiple series in one batch */
+	remote_prefetch(vnames, nnames);
+    }
+#endif
+
     /* now process the imports individually */
 
     for (i=0; i<nnames && !err; i++) {
@@ -1910,6 +2255,11 @@ int db_get_series (const char *line, DATASET *dset,
 
 		tmp = native_db_match_series(vnames[i], &nmatch,
 					     idxname, &err);
+#ifdef USE_CURL
+		if (!err && saved_db_type == GRETL_NATIVE_DB_WWW) {
+		    remote_prefetch(tmp, nmatch);
+		}
+#endif
 		for (j=0; j<nmatch && !err; j++) {
 		    err = get_one_db_series(tmp[j], altname, dset,
 					    cmethod, idxname, prn);
@@ -1945,10 +2295,15 @@ int db_get_series (const char *line, DATASET *dset,
 	if (saved_db_type == GRETL_NATIVE_DB_WWW) {
 	    /* this file is a temporary download */
 	    gretl_remove(idxname);
+	    native_db_cache_clear();
 	}
 	free(idxname);
     }
 
+#ifdef USE_CURL
+    remote_prefetch_clear();
+#endif
+
     return err;
 }
 
@@ -2009,6 +2364,9 @@ static int db_delete_series (const char *line, const int *list,
 	return err;
     }
 
+    /* the files are about to be replaced */
+    native_db_cache_clear();
+
     strcpy(tmp1, gretl_dotdir());
     strcat(tmp1, "tmpidx");
     f1 = tempfile_open(tmp1, &err);
@@ -2050,8 +2408,12 @@ static int db_delete_series (const char *line, const int *list,
 	if (i % 2 != 0) {
 	    /* odd lines contain varnames */
 	    print = 1;
-	    if (snames != NULL) {
-		sscanf(s, "%s", series);
+	    gretl_scan_varname(s, series);
+	    if (!strcmp(series, DB_TOMBSTONE)) {
+		/* drop superseded records while we're at it; they
+		   don't count in the numbering of series */
+		print = 0;
+	    } else if (snames != NULL) {
 		for (j=0; j<ns; j++) {
 		    if (!strcmp(series, snames[j])) {
 			print = 0;
@@ -3820,6 +4182,9 @@ static int daily_dataset_to_weekly_special (DATASET *dset,
     }
 
     err = shorten_the_constant(dset->Z, n);
+    if (!err) {
+	err = dataset_unmap_series(dset);
+    }
 
     for (i=1; i<dset->v && !err; i++) {
 	int s = 0;
@@ -3888,7 +4253,7 @@ static int daily_dataset_to_monthly (DATASET *dset,
 	if (x == NULL) {
 	    err = E_ALLOC;
 	} else {
-	    free(dset->Z[i]);
+	    dataset_release_series(dset->Z[i]);
 	    dset->Z[i] = x;
 	}
     }
@@ -4254,7 +4619,7 @@ int compact_dataset (DATASET *dset, int newpd,
 	if (x == NULL) {
 	    err = E_ALLOC;
 	} else {
-	    free(dset->Z[i]);
+	    dataset_release_series(dset->Z[i]);
 	    dset->Z[i] = x;
 	}
     }
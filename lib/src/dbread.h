@@ -31,6 +31,13 @@ typedef enum {
     DB_PARSE_ERROR
 } DBError;
 
+/* Name given to the index entry of a series that has been
+   superseded in place by a write to a native database: see
+   dbwrite.c. Since it can't be a valid identifier such an entry
+   never matches a lookup, but it retains its place so that the
+   offsets of the following series are unaffected. */
+#define DB_TOMBSTONE "-"
+
 /**
  * dbnumber:
  *
@@ -98,6 +105,8 @@ int get_native_db_data (const char *dbbase, SERIESINFO *sinfo,
 int get_remote_db_data (const char *dbbase, SERIESINFO *sinfo,
 			double **Z);
 
+void native_db_cache_clear (void);
+
 int get_pcgive_db_data (const char *dbbase, SERIESINFO *sinfo,
 			double **Z);
 
@@ -19,6 +19,7 @@
 
 #include "libgretl.h"
 #include "dbwrite.h"
+#include "dbread.h"
 
 /**
  * SECTION:dbwrite
@@ -182,16 +183,19 @@ check_for_db_duplicates (const int *list, const DATASET *dset,
     return ret;
 }
 
-static int output_db_var (int v, const DATASET *dset,
-			  FILE *fidx, FILE *fbin) 
+/* Get the range of observations of series @v to be saved,
+   skipping NAs at the start and end of time series, and the
+   number of values to be written, including any hidden missing
+   observations in dated daily data (written to @dskip). Returns
+   0 if there's nothing to save.
+*/
+
+static int db_var_range (int v, const DATASET *dset,
+			 int *pt1, int *pt2, int *dskip)
 {
-    char stobs[OBSLEN], endobs[OBSLEN];
-    const char *vlabel;
     int t1 = dset->t1;
     int t2 = dset->t2;
-    int dskip = 0, npad = 0;
-    int t, s, nobs;
-    float val;
+    int t, nobs;
 
     if (dataset_is_time_series(dset)) {
 	/* trim the sample to skip NAs at start and end */
@@ -205,11 +209,33 @@ static int output_db_var (int v, const DATASET *dset,
 	}
     }
 
+    *pt1 = t1;
+    *pt2 = t2;
+    *dskip = 0;
+
     nobs = t2 - t1 + 1;
     if (nobs <= 0) {
 	return 0;
     }
 
+    if (dated_daily_data(dset) && dataset_has_markers(dset)) {
+	*dskip = n_hidden_missing_obs(dset, t1, t2);
+	nobs += *dskip;
+    }
+
+    return nobs;
+}
+
+/* Compose the two index lines for series @v, without trailing
+   newlines. */
+
+static void db_var_index_lines (int v, const DATASET *dset,
+				int t1, int t2, int nobs,
+				gchar **line1, gchar **line2)
+{
+    char stobs[OBSLEN], endobs[OBSLEN];
+    const char *vlabel;
+
     ntolabel(stobs, t1, dset);
     ntolabel(endobs, t2, dset);
     if (dset->pd == 4 || dset->pd == 12) {
@@ -217,16 +243,19 @@ static int output_db_var (int v, const DATASET *dset,
 	dotify(endobs);
     }
 
-    if (dated_daily_data(dset) && dataset_has_markers(dset)) {
-	dskip = n_hidden_missing_obs(dset, t1, t2);
-	nobs += dskip;
-    }
-
     vlabel = series_get_label(dset, v);
-    fprintf(fidx, "%s  %s\n", dset->varname[v],
-	    vlabel == NULL ? "" : vlabel);
-    fprintf(fidx, "%c  %s - %s  n = %d\n", pd_char(dset),
-	    stobs, endobs, nobs);
+    *line1 = g_strdup_printf("%s  %s", dset->varname[v],
+			     vlabel == NULL ? "" : vlabel);
+    *line2 = g_strdup_printf("%c  %s - %s  n = %d", pd_char(dset),
+			     stobs, endobs, nobs);
+}
+
+static void output_db_values (int v, const DATASET *dset,
+			      int t1, int t2, int dskip,
+			      FILE *fbin)
+{
+    int t, s, npad = 0;
+    float val;
 
     for (t=t1; t<=t2; t++) {
 	if (dskip > 0) {
@@ -246,6 +275,26 @@ static int output_db_var (int v, const DATASET *dset,
 	}
 	fwrite(&val, sizeof val, 1, fbin);
     }
+}
+
+static int output_db_var (int v, const DATASET *dset,
+			  FILE *fidx, FILE *fbin) 
+{
+    gchar *line1, *line2;
+    int t1, t2, dskip;
+    int nobs;
+
+    nobs = db_var_range(v, dset, &t1, &t2, &dskip);
+    if (nobs <= 0) {
+	return 0;
+    }
+
+    db_var_index_lines(v, dset, t1, t2, nobs, &line1, &line2);
+    fprintf(fidx, "%s\n%s\n", line1, line2);
+    g_free(line1);
+    g_free(line2);
+
+    output_db_values(v, dset, t1, t2, dskip, fbin);
 
     return 0;
 }
@@ -284,6 +333,196 @@ static void list_delete_element (int *list, int m)
     }
 }
 
+/* Replacement of series in an existing database is done without
+   rewriting the files. A series whose new record has the same
+   index lines and number of observations as the old one is simply
+   overwritten in place; otherwise the old record is turned into a
+   "tombstone" by overwriting its name in the index with
+   DB_TOMBSTONE (padded to the same length), and the new record is
+   appended. Since a tombstone keeps its place in both files the
+   implied offsets of all other series are unchanged, and readers
+   that don't know about tombstones are unaffected; they just can't
+   match the name. The space held by tombstones is reclaimed by
+   compact_db_files() once it amounts to half the binary file.
+*/
+
+typedef struct db_record_ db_record;
+
+struct db_record_ {
+    char name[VNAMELEN]; /* series name */
+    long idxpos;         /* position of the name line in the .idx */
+    char *line1;         /* the name line, without newline */
+    char *line2;         /* the obs line, without newline */
+    int nobs;            /* number of values */
+    long offset;         /* position of the data in the .bin */
+};
+
+static void db_records_free (db_record *recs, int n)
+{
+    int i;
+
+    for (i=0; i<n; i++) {
+	g_free(recs[i].line1);
+	g_free(recs[i].line2);
+    }
+    free(recs);
+}
+
+static char *chomp_dup (const char *s)
+{
+    return g_strndup(s, strcspn(s, "\r\n"));
+}
+
+static int read_db_records (const char *idxname, db_record **precs,
+			    int *pn)
+{
+    char line1[1024], line2[256];
+    db_record *recs = NULL;
+    long offset = 0L;
+    long pos = 0L;
+    int n = 0, nalloc = 0;
+    int err = 0;
+    FILE *fp;
+
+    fp = gretl_fopen(idxname, "rb");
+    if (fp == NULL) {
+	return E_FOPEN;
+    }
+
+    while (!err && fgets(line1, sizeof line1, fp)) {
+	if (*line1 == '#' || string_is_blank(line1)) {
+	    pos = ftell(fp);
+	    continue;
+	}
+	if (n == nalloc) {
+	    db_record *tmp;
+
+	    nalloc = (nalloc == 0)? 256 : 2 * nalloc;
+	    tmp = realloc(recs, nalloc * sizeof *recs);
+	    if (tmp == NULL) {
+		err = E_ALLOC;
+		break;
+	    }
+	    recs = tmp;
+	}
+	if (gretl_scan_varname(line1, recs[n].name) != 1 ||
+	    fgets(line2, sizeof line2, fp) == NULL ||
+	    sscanf(line2, "%*s  %*s - %*s  n = %d", &recs[n].nobs) != 1) {
+	    /* db index lines must be in pairs */
+	    err = E_DATA;
+	    break;
+	}
+	recs[n].idxpos = pos;
+	recs[n].line1 = chomp_dup(line1);
+	recs[n].line2 = chomp_dup(line2);
+	recs[n].offset = offset;
+	offset += recs[n].nobs * sizeof(float);
+	pos = ftell(fp);
+	n++;
+    }
+
+    fclose(fp);
+
+    if (err) {
+	db_records_free(recs, n);
+    } else {
+	*precs = recs;
+	*pn = n;
+    }
+
+    return err;
+}
+
+static int is_tombstone (const char *name)
+{
+    return strcmp(name, DB_TOMBSTONE) == 0;
+}
+
+/* Rewrite the database files without the records marked as
+   tombstones. */
+
+static int compact_db_files (const char *idxname,
+			     const char *binname)
+{
+    char idxtmp[FILENAME_MAX];
+    char bintmp[FILENAME_MAX];
+    char line1[1024], line2[256];
+    char sername[VNAMELEN];
+    FILE *fp = NULL, *fq = NULL;
+    FILE *fidx = NULL, *fbin = NULL;
+    long offset = 0L;
+    int nobs, err = 0;
+
+    sprintf(idxtmp, "%s.tmp", idxname);
+    sprintf(bintmp, "%s.tmp", binname);
+
+    fp = gretl_fopen(idxname, "r");
+    fq = gretl_fopen(binname, "rb");
+    fidx = gretl_fopen(idxtmp, "w");
+    fbin = gretl_fopen(bintmp, "wb");
+
+    if (fp == NULL || fq == NULL || fidx == NULL || fbin == NULL) {
+	err = E_FOPEN;
+    }
+
+    while (!err && fgets(line1, sizeof line1, fp)) {
+	if (*line1 == '#' || string_is_blank(line1)) {
+	    if (*line1 == '#') {
+		fputs(line1, fidx);
+	    }
+	    continue;
+	}
+	if (gretl_scan_varname(line1, sername) != 1 ||
+	    fgets(line2, sizeof line2, fp) == NULL ||
+	    sscanf(line2, "%*s  %*s - %*s  n = %d", &nobs) != 1) {
+	    err = E_DATA;
+	    break;
+	}
+	if (!is_tombstone(sername)) {
+	    fputs(line1, fidx);
+	    fputs(line2, fidx);
+	    err = write_old_bin_chunk(offset, nobs, fq, fbin);
+	}
+	offset += nobs * sizeof(float);
+    }
+
+    if (fp != NULL) fclose(fp);
+    if (fq != NULL) fclose(fq);
+    if (fidx != NULL) fclose(fidx);
+    if (fbin != NULL) fclose(fbin);
+
+    if (!err) {
+	err = gretl_rename(idxtmp, idxname);
+	if (!err) {
+	    err = gretl_rename(bintmp, binname);
+	}
+    } else {
+	gretl_remove(idxtmp);
+	gretl_remove(bintmp);
+    }
+
+    return err;
+}
+
+/* Overwrite the name of the record @r in the index with a
+   tombstone of the same length. */
+
+static int write_tombstone (const db_record *r, FILE *fidx)
+{
+    int i, len = strlen(r->name);
+
+    if (fseek(fidx, r->idxpos, SEEK_SET)) {
+	return E_DATA;
+    }
+
+    fputs(DB_TOMBSTONE, fidx);
+    for (i=strlen(DB_TOMBSTONE); i<len; i++) {
+	fputc(' ', fidx);
+    }
+
+    return 0;
+}
+
 /* writing to a previously existing database, replacing any existing
    variables with the same name as "new" ones, but otherwise
    preserving the existing content 
@@ -296,181 +535,116 @@ append_db_data_with_replacement (const char *idxname,
 				 const DATASET *dset) 
 {
     FILE *fidx = NULL, *fbin = NULL;
-    char **oldnames = NULL;
-    char *mask = NULL;
+    GHashTable *ht = NULL;
+    db_record *recs = NULL;
     int *newlist = NULL;
-    int i, j, v, oldv;
-    int nrep, err = 0;
+    gint64 dead = 0, total = 0;
+    int i, v, nrec = 0;
+    int err = 0;
 
-    err = get_db_series_names(idxname, &oldnames, &oldv);
+    err = read_db_records(idxname, &recs, &nrec);
     if (err) {
 	return err;
     }
 
-    mask = calloc(oldv, 1);
-    if (mask == NULL) {
-	err = E_ALLOC;
-	goto bailout;
-    }	
-
     newlist = gretl_list_copy(list);
     if (newlist == NULL) {
 	err = E_ALLOC;
 	goto bailout;
     }
 
-    nrep = 0;
-    for (i=1; i<=list[0]; i++) {
-	v = list[i];
-	for (j=0; j<oldv; j++) {
-	    if (!strcmp(oldnames[j], dset->varname[v])) {
-		/* match: remove var v from "newlist" and flag that it
-		   is a replacement in "mask" */
-		list_delete_element(newlist, v);
-#if DB_DEBUG
-		fprintf(stderr, "match: var %d and old db var %d\n", v, j);
-#endif    
-		mask[j] = 1;
-		nrep++;
-		break;
-	    }
+    /* map from names to live records */
+    ht = g_hash_table_new(g_str_hash, g_str_equal);
+    for (i=0; i<nrec; i++) {
+	total += recs[i].nobs;
+	if (is_tombstone(recs[i].name)) {
+	    dead += recs[i].nobs;
+	} else if (g_hash_table_lookup(ht, recs[i].name) == NULL) {
+	    g_hash_table_insert(ht, recs[i].name, &recs[i]);
 	}
     }
 
-#if DB_DEBUG
-    fprintf(stderr, "write_db_data_with_replacement: replicated vars = %d\n", 
-	    nrep);
-    printlist(list, "full var list");
-    printlist(newlist, "new var list");
-#endif    
+    fidx = gretl_fopen(idxname, "r+b");
+    fbin = gretl_fopen(binname, "r+b");
+    if (fidx == NULL || fbin == NULL) {
+	err = E_FOPEN;
+    }
 
     /* handle replacement variables first */
-    if (nrep > 0) {
-	char idxcpy[FILENAME_MAX];
-	char bincpy[FILENAME_MAX];
-
-	strcpy(idxcpy, idxname);
-	strcat(idxcpy, ".cpy");
-
-	strcpy(bincpy, binname);
-	strcat(bincpy, ".cpy");
+    for (i=1; i<=list[0] && !err; i++) {
+	db_record *r;
+	gchar *line1, *line2;
+	int t1, t2, dskip, nobs;
 
-	err = gretl_copy_file(idxname, idxcpy);
-
-	if (!err) {
-	    err = gretl_copy_file(binname, bincpy);
+	v = list[i];
+	r = g_hash_table_lookup(ht, dset->varname[v]);
+	if (r == NULL) {
+	    continue;
 	}
 
-	if (!err) {
-	    FILE *fp = NULL, *fq = NULL;
-	    char line1[256], line2[256];
-	    long offset = 0L;
-	    int nobs;
-
-	    fp = fq = NULL;
-	    
-	    fp = gretl_fopen(idxcpy, "r");
-	    if (fp == NULL) {
-		err = E_FOPEN;
-	    }
-
-	    if (!err) {
-		fidx = gretl_fopen(idxname, "w");
-		if (fidx == NULL) {
-		    err = E_FOPEN;
-		}
-	    }
+	nobs = db_var_range(v, dset, &t1, &t2, &dskip);
+	db_var_index_lines(v, dset, t1, t2, nobs, &line1, &line2);
 
-	    if (!err) {
-		fq = gretl_fopen(bincpy, "rb");
-		if (fq == NULL) {
-		    err = E_FOPEN;
-		}
-	    }
-
-	    if (!err) {
-		fbin = gretl_fopen(binname, "wb");
-		if (fbin == NULL) {
-		    err = E_FOPEN;
-		}
-	    }	    
-
-	    i = 0;
-	    while (fgets(line1, sizeof line1, fp) && !err) {
-		if (*line1 == '#' || string_is_blank(line1)) {
-		    if (*line1 == '#') {
-			fputs(line1, fidx);
-		    }	
-		    continue;
-		}
-		if (fgets(line2, sizeof line2, fp) == NULL) {
-		    /* db index lines must be in pairs */
-		    err = 1;
-		    break;
-		}
-		if (sscanf(line2, "%*s  %*s - %*s  n = %d\n", &nobs) != 1) {
-		    err = 1;
-		    break;
-		}
-
-#if DB_DEBUG
-		fprintf(stderr, "old db, var %d, nobs = %d\n", i, nobs);
-#endif
-		if (mask[i]) {
-		    v = series_index(dset, oldnames[i]);
+	if (nobs == r->nobs && !strcmp(line1, r->line1) &&
+	    !strcmp(line2, r->line2)) {
 #if DB_DEBUG
-		    fprintf(stderr, "replacing this with var %d\n", v);
+	    fprintf(stderr, "overwriting var %d in place\n", v);
 #endif
-		    output_db_var(v, dset, fidx, fbin);
-		} else {
+	    if (fseek(fbin, r->offset, SEEK_SET)) {
+		err = E_DATA;
+	    } else {
+		output_db_values(v, dset, t1, t2, dskip, fbin);
+		list_delete_element(newlist, v);
+	    }
+	} else {
 #if DB_DEBUG
-		    fprintf(stderr, "passing through old var\n");
+	    fprintf(stderr, "replacing var %d: tombstone plus append\n", v);
 #endif
-		    fputs(line1, fidx);
-		    fputs(line2, fidx);
-		    write_old_bin_chunk(offset, nobs, fq, fbin);
-		}
-		i++;
-		offset += nobs * sizeof(float);
-	    }
-
-	    if (fp != NULL) fclose(fp);
-	    if (fq != NULL) fclose(fq);
+	    /* leave @v in newlist, to be appended */
+	    err = write_tombstone(r, fidx);
+	    dead += r->nobs;
 	}
 
-	gretl_remove(idxcpy);
-	gretl_remove(bincpy);
-    } else {
-	/* no variables to be replaced */
+	g_free(line1);
+	g_free(line2);
+    }
+
+    if (fidx != NULL) fclose(fidx);
+    if (fbin != NULL) fclose(fbin);
+    fidx = fbin = NULL;
+
+    if (!err && newlist[0] > 0) {
+	/* do any newly added or relocated variables */
 	fidx = gretl_fopen(idxname, "a");
-	if (fidx == NULL) {
+	fbin = gretl_fopen(binname, "ab");
+	if (fidx == NULL || fbin == NULL) {
 	    err = E_FOPEN;
 	}
-	if (!err) {
-	    fbin = gretl_fopen(binname, "ab");
-	    if (fbin == NULL) {
-		err = E_FOPEN;
-	    }
-	}
-    }
-
-    if (!err) {
-	/* do any newly added variables */
-	for (i=1; i<=newlist[0]; i++) {
+	for (i=1; i<=newlist[0] && !err; i++) {
 #if DB_DEBUG
-	    fprintf(stderr, "adding new var, %d\n", newlist[i]);
+	    fprintf(stderr, "adding var %d\n", newlist[i]);
 #endif
+	    int t1, t2, dskip;
+
 	    output_db_var(newlist[i], dset, fidx, fbin);
+	    total += db_var_range(newlist[i], dset, &t1, &t2, &dskip);
 	}
+	if (fidx != NULL) fclose(fidx);
+	if (fbin != NULL) fclose(fbin);
+	fidx = fbin = NULL;
     }
 
- bailout:
+    if (!err && dead > 0 && 2 * dead > total) {
+	/* the dead records have come to dominate */
+	err = compact_db_files(idxname, binname);
+    }
 
-    if (fidx != NULL) fclose(fidx);
-    if (fbin != NULL) fclose(fbin);
+ bailout:
 
-    strings_array_free(oldnames, oldv);
-    free(mask);
+    if (ht != NULL) {
+	g_hash_table_destroy(ht);
+    }
+    db_records_free(recs, nrec);
     free(newlist);
 
     return err;
@@ -620,6 +794,10 @@ int write_db_data (const char *fname, const int *list, gretlopt opt,
 	return E_PDWRONG;
     }
 
+    /* drop any cached index and mapping of the files we're
+       about to modify */
+    native_db_cache_clear();
+
     if (open_db_files(fname, idxname, binname, 
 		      &fidx, &fbin, &append)) {
 	return 1;
@@ -24,10 +24,15 @@
 #include "gretl_panel.h"
 #include "gretl_string_table.h"
 #include "libset.h"
+#include "gretl_mt.h"
 #include "plotspec.h"
 #include "usermat.h"
 #include "genfuncs.h"
 
+#if defined(_OPENMP)
+# include <omp.h>
+#endif
+
 #include <unistd.h>
 
 #ifdef WIN32
@@ -153,6 +158,76 @@ double gretl_max (int t1, int t2, const double *x)
     return max;
 }
 
+/* Blocked summation for "set deterministic": the range is split
+   into blocks of fixed size, which may be summed on several
+   threads, and the block sums are then combined pairwise in a
+   fixed order, so the result does not depend on the number of
+   threads. We return the sum over the non-missing values of
+   x - @c (if @pw = 1) or (x - @c)^2 (if @pw = 2); the number of
+   such values is written to @pn.
+*/
+
+#define DET_BLOCK 1024
+
+static double det_sum (int t1, int t2, const double *x,
+		       double c, int pw, int *pn)
+{
+    int nb = (t2 - t1) / DET_BLOCK + 1;
+    double bsum0, *bsum = &bsum0;
+    int bn0, *bn = &bn0;
+    int b, step, n = 0;
+
+    if (nb > 1) {
+	bsum = malloc(nb * sizeof *bsum);
+	bn = malloc(nb * sizeof *bn);
+	if (bsum == NULL || bn == NULL) {
+	    free(bsum);
+	    free(bn);
+	    *pn = 0;
+	    return NADBL;
+	}
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (nb > 1 && gretl_use_openmp((guint64) (t2 - t1 + 1)))
+#endif
+    for (b=0; b<nb; b++) {
+	int s = t1 + b * DET_BLOCK;
+	int e = MIN(t2, s + DET_BLOCK - 1);
+	double d, sum = 0.0;
+	int t, m = 0;
+
+	for (t=s; t<=e; t++) {
+	    if (!na(x[t])) {
+		d = x[t] - c;
+		sum += (pw == 2)? d * d : d;
+		m++;
+	    }
+	}
+	bsum[b] = sum;
+	bn[b] = m;
+    }
+
+    for (step=1; step<nb; step*=2) {
+	for (b=0; b+step<nb; b+=2*step) {
+	    bsum[b] += bsum[b+step];
+	}
+    }
+    for (b=0; b<nb; b++) {
+	n += bn[b];
+    }
+
+    bsum0 = bsum[0];
+    if (nb > 1) {
+	free(bsum);
+	free(bn);
+    }
+
+    *pn = n;
+
+    return bsum0;
+}
+
 /**
  * gretl_sum:
  * @t1: starting observation.
@@ -169,6 +244,11 @@ double gretl_sum (int t1, int t2, const double *x)
     double sum = 0.0;
     int t, n = 0;
 
+    if (libset_get_bool(DETERMINISTIC)) {
+	sum = det_sum(t1, t2, x, 0.0, 1, &n);
+	return (n == 0)? NADBL : sum;
+    }
+
     for (t=t1; t<=t2; t++) {
 	if (!(na(x[t]))) {
 	    sum += x[t];
@@ -195,6 +275,15 @@ double gretl_mean (int t1, int t2, const double *x)
     double xbar, sum = 0.0;
     int t, n = 0;
 
+    if (libset_get_bool(DETERMINISTIC)) {
+	sum = det_sum(t1, t2, x, 0.0, 1, &n);
+	if (n == 0) {
+	    return NADBL;
+	}
+	xbar = sum / n;
+	return xbar + det_sum(t1, t2, x, xbar, 1, &n) / n;
+    }
+
     for (t=t1; t<=t2; t++) {
 	if (!(na(x[t]))) {
 	    sum += x[t];
@@ -386,7 +475,7 @@ static double find_hoare_inexact (double *a, double p,
    of size @n (which may not be an integer).
 */
 
-static double quantile_index (int n, double p)
+double gretl_quantile_index (int n, double p)
 {
     int Qtype = libset_get_int(QUANTILE_TYPE);
     double h;
@@ -445,7 +534,7 @@ double gretl_quantile (int t1, int t2, const double *x, double p,
     }
 
     if (!*err) {
-	h = quantile_index(n, p);
+	h = gretl_quantile_index(n, p);
 	hf = floor(h);
 	hc = ceil(h);
 
@@ -516,7 +605,7 @@ int gretl_array_quantiles (double *a, int n, double *p, int k)
 	    break;
 	}
 
-	h = quantile_index(n, p[i]);
+	h = gretl_quantile_index(n, p[i]);
 	hf = floor(h);
 	hc = ceil(h);
 
@@ -630,11 +719,15 @@ double real_gretl_variance (int t1, int t2, const double *x,
     v = 0.0;
     n = 0;
 
-    for (t=t1; t<=t2; t++) {
-	if (!na(x[t])) {
-	    dx = x[t] - xbar;
-	    v += dx * dx;
-	    n++;
+    if (libset_get_bool(DETERMINISTIC)) {
+	v = det_sum(t1, t2, x, xbar, 2, &n);
+    } else {
+	for (t=t1; t<=t2; t++) {
+	    if (!na(x[t])) {
+		dx = x[t] - xbar;
+		v += dx * dx;
+		n++;
+	    }
 	}
     }
 
@@ -1086,7 +1179,7 @@ int gretl_moments (int t1, int t2, const double *x,
 		   double *skew, double *kurt, int k)
 {
     int t, n;
-    double dev, var;
+    double dev, dev2, var;
     double s, s2, s3, s4;
     int allstats = 1;
     int weighted = (wts != NULL);
@@ -1150,25 +1243,28 @@ int gretl_moments (int t1, int t2, const double *x,
 	*skew = *kurt = 0.0;
     }
 
-    /* compute quantities needed for higher moments */
+    /* compute quantities needed for higher moments: all
+       three sums in one pass, without recourse to pow()
+    */
     s2 = s3 = s4 = 0.0;
     for (t=t1; t<=t2; t++) {
 	if (!na(x[t])) {
 	    dev = x[t] - *xbar;
+	    dev2 = dev * dev;
 	    if (weighted) {
 		wt = wts[t];
 		if (!na(wt) && wt != 0.0) {
-		    s2 += wt * dev * dev;
+		    s2 += wt * dev2;
 		    if (allstats) {
-			s3 += wt * pow(dev, 3);
-			s4 += wt * pow(dev, 4);
+			s3 += wt * dev2 * dev;
+			s4 += wt * dev2 * dev2;
 		    }
 		}
 	    } else {
-		s2 += dev * dev;
+		s2 += dev2;
 		if (allstats) {
-		    s3 += pow(dev, 3);
-		    s4 += pow(dev, 4);
+		    s3 += dev2 * dev;
+		    s4 += dev2 * dev2;
 		}
 	    }
 	}
@@ -1902,16 +1998,206 @@ FreqDist *get_string_freq (int v, const DATASET *dset,
     return freq;
 }
 
+/* Apparatus for counting the distinct values of a series by
+   hashing: an open-addressing table with linear probing, which is
+   kept at most half full. A zero count marks an empty slot.
+*/
+
+typedef struct valcounter_ {
+    double *x;  /* distinct values */
+    int *n;     /* their counts */
+    int size;   /* capacity, a power of 2 */
+    int used;   /* number of distinct values */
+} valcounter;
+
+static void valcounter_free (valcounter *vc)
+{
+    free(vc->x);
+    free(vc->n);
+}
+
+static int valcounter_init (valcounter *vc, int size)
+{
+    vc->x = malloc(size * sizeof *vc->x);
+    vc->n = calloc(size, sizeof *vc->n);
+    vc->size = size;
+    vc->used = 0;
+
+    if (vc->x == NULL || vc->n == NULL) {
+	valcounter_free(vc);
+	vc->x = NULL;
+	vc->n = NULL;
+	return E_ALLOC;
+    }
+
+    return 0;
+}
+
+static guint32 valhash (double x)
+{
+    guint64 u;
+
+    if (x == 0) {
+	/* don't distinguish -0 from 0 */
+	x = 0.0;
+    }
+    memcpy(&u, &x, sizeof u);
+    u *= G_GUINT64_CONSTANT(0x9E3779B97F4A7C15);
+
+    return (guint32) (u >> 32);
+}
+
+static int valcounter_add (valcounter *vc, double x, int n);
+
+static int valcounter_grow (valcounter *vc)
+{
+    valcounter big;
+    int i, err;
+
+    err = valcounter_init(&big, 2 * vc->size);
+    for (i=0; i<vc->size && !err; i++) {
+	if (vc->n[i] > 0) {
+	    err = valcounter_add(&big, vc->x[i], vc->n[i]);
+	}
+    }
+    valcounter_free(vc);
+    *vc = big;
+
+    return err;
+}
+
+static int valcounter_add (valcounter *vc, double x, int n)
+{
+    guint32 mask = vc->size - 1;
+    guint32 h = valhash(x) & mask;
+
+    while (vc->n[h] > 0 && vc->x[h] != x) {
+	h = (h + 1) & mask;
+    }
+
+    if (vc->n[h] > 0) {
+	vc->n[h] += n;
+    } else {
+	vc->x[h] = x;
+	vc->n[h] = n;
+	vc->used += 1;
+	if (2 * vc->used > vc->size) {
+	    return valcounter_grow(vc);
+	}
+    }
+
+    return 0;
+}
+
+struct valcount {
+    double x;
+    int n;
+};
+
+static int compare_valcounts (const void *a, const void *b)
+{
+    const struct valcount *va = a;
+    const struct valcount *vb = b;
+
+    return (va->x > vb->x) - (va->x < vb->x);
+}
+
+/* Count the distinct non-missing values of @x over @t1 to @t2,
+   using a hash table per thread whose results are then merged.
+   Returns an array of values and counts, sorted by value, with
+   its length in @nv.
+*/
+
+static struct valcount *count_values (const double *x, int t1, int t2,
+				      int *nv, int *err)
+{
+    struct valcount *vals = NULL;
+    valcounter all;
+    valcounter *vcs;
+    int nt = 1;
+    int i, j;
+
+#if defined(_OPENMP)
+    if (gretl_use_openmp((guint64) (t2 - t1 + 1) * 4)) {
+	nt = gretl_get_omp_threads();
+    }
+#endif
+
+    vcs = calloc(nt, sizeof *vcs);
+    if (vcs == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel num_threads(nt) if (nt > 1)
+#endif
+    {
+	int ierr, t, me = 0;
+
+#if defined(_OPENMP)
+	me = omp_get_thread_num();
+#endif
+	ierr = valcounter_init(&vcs[me], 64);
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+	for (t=t1; t<=t2; t++) {
+	    if (!ierr && !na(x[t])) {
+		ierr = valcounter_add(&vcs[me], x[t], 1);
+	    }
+	}
+	if (ierr) {
+#if defined(_OPENMP)
+#pragma omp critical (count_values_err)
+#endif
+	    *err = ierr;
+	}
+    }
+
+    if (!*err && nt > 1) {
+	/* merge into the first table */
+	for (j=1; j<nt && !*err; j++) {
+	    for (i=0; i<vcs[j].size && !*err; i++) {
+		if (vcs[j].n[i] > 0) {
+		    *err = valcounter_add(&vcs[0], vcs[j].x[i], vcs[j].n[i]);
+		}
+	    }
+	}
+    }
+
+    if (!*err) {
+	all = vcs[0];
+	vals = malloc(all.used * sizeof *vals);
+	if (vals == NULL) {
+	    *err = E_ALLOC;
+	} else {
+	    for (i=0, j=0; i<all.size; i++) {
+		if (all.n[i] > 0) {
+		    vals[j].x = all.x[i];
+		    vals[j++].n = all.n[i];
+		}
+	    }
+	    qsort(vals, all.used, sizeof *vals, compare_valcounts);
+	    *nv = all.used;
+	}
+    }
+
+    for (j=0; j<nt; j++) {
+	valcounter_free(&vcs[j]);
+    }
+    free(vcs);
+
+    return vals;
+}
+
 FreqDist *get_discrete_freq (int v, const DATASET *dset,
 			     gretlopt opt, int *err)
 {
     FreqDist *freq;
     const double *x = dset->Z[v];
-    int *ifreq = NULL;
-    double *ivals = NULL;
-    double *sorted = NULL;
-    double last;
-    int i, t, nv;
+    struct valcount *vals = NULL;
+    int i, t, nv = 0;
 
     freq = freq_new(dset, v);
     if (freq == NULL) {
@@ -1941,22 +2227,11 @@ FreqDist *get_discrete_freq (int v, const DATASET *dset,
     freq->test = NADBL;
     freq->dist = 0;
 
-    sorted = malloc(freq->n * sizeof *sorted);
-    if (sorted == NULL) {
-	*err = E_ALLOC;
+    vals = count_values(x, freq->t1, freq->t2, &nv, err);
+    if (*err) {
 	goto bailout;
     }
 
-    i = 0;
-    for (t=freq->t1; t<=freq->t2; t++) {
-	if (!na(x[t])) {
-	    sorted[i++] = x[t];
-	}
-    }
-
-    qsort(sorted, freq->n, sizeof *sorted, gretl_compare_doubles);
-    nv = count_distinct_values(sorted, freq->n);
-
     if (nv >= 10 && !(opt & OPT_X)) {
 	freq_dist_stat(freq, x, opt, 1);
     } else if (opt & (OPT_Z | OPT_O)) {
@@ -1964,37 +2239,17 @@ FreqDist *get_discrete_freq (int v, const DATASET *dset,
 	freq->sdx = gretl_stddev(freq->t1, freq->t2, x);
     }
 
-    ifreq = malloc(nv * sizeof *ifreq);
-    ivals = malloc(nv * sizeof *ivals);
-    if (ifreq == NULL || ivals == NULL) {
-	*err = E_ALLOC;
-	goto bailout;
-    }
-
-    ivals[0] = last = sorted[0];
-    ifreq[0] = i = 1;
-
-    for (t=1; t<freq->n; t++) {
-	if (sorted[t] != last) {
-	    last = sorted[t];
-	    ifreq[i] = 1;
-	    ivals[i++] = last;
-	} else {
-	    ifreq[i-1] += 1;
-	}
-    }
-
     if (freq_add_arrays(freq, nv)) {
 	*err = E_ALLOC;
     } else {
 	int allints = 1;
 
 	for (i=0; i<nv; i++) {
-	    if (allints && ivals[i] != floor(ivals[i])) {
+	    if (allints && vals[i].x != floor(vals[i].x)) {
 		allints = 0;
 	    }
-	    freq->midpt[i] = ivals[i];
-	    freq->f[i] = ifreq[i];
+	    freq->midpt[i] = vals[i].x;
+	    freq->f[i] = vals[i].n;
 	}
 
 	if (allints) {
@@ -2004,9 +2259,7 @@ FreqDist *get_discrete_freq (int v, const DATASET *dset,
 
  bailout:
 
-    free(sorted);
-    free(ivals);
-    free(ifreq);
+    free(vals);
 
     if (*err && freq != NULL) {
 	free_freq(freq);
@@ -2729,22 +2982,69 @@ static int xtab_get_data (Xtab *tab, int v, int j,
     return err;
 }
 
-static int xtab_row_match (Xtab *tab, int i, const char *s, double x)
+/* Write into @idx, for each observation in the current sample
+   range, the position of the value of series @v among the rows
+   (@j = 0) or columns (@j = 1) of @tab, or -1 if the value is
+   missing. For string-valued series we map string-table codes to
+   positions via a hash table on the strings, otherwise we do a
+   binary search in the (sorted) distinct values.
+*/
+
+static int xtab_get_indices (Xtab *tab, int v, int j,
+			     const DATASET *dset,
+			     series_table *st,
+			     int *idx)
 {
-    if (tab->rstrs) {
-	return strcmp(s, tab->Sr[i]) == 0;
-    } else {
-	return x == tab->rval[i];
+    const double *x = dset->Z[v] + dset->t1;
+    int strs = (j == 1)? tab->cstrs : tab->rstrs;
+    int nv = (j == 1)? tab->cols : tab->rows;
+    int n = sample_size(dset);
+    int *map = NULL;
+    int t;
+
+    if (strs) {
+	char **S = (j == 1)? tab->Sc : tab->Sr;
+	GHashTable *ht;
+	char **S0;
+	gpointer p;
+	int i, ns;
+
+	S0 = series_table_get_strings(st, &ns);
+	map = malloc(ns * sizeof *map);
+	if (map == NULL) {
+	    return E_ALLOC;
+	}
+	ht = g_hash_table_new(g_str_hash, g_str_equal);
+	for (i=0; i<nv; i++) {
+	    g_hash_table_insert(ht, S[i], GINT_TO_POINTER(i+1));
+	}
+	for (i=0; i<ns; i++) {
+	    p = g_hash_table_lookup(ht, S0[i]);
+	    map[i] = GPOINTER_TO_INT(p) - 1;
+	}
+	g_hash_table_destroy(ht);
     }
-}
 
-static int xtab_col_match (Xtab *tab, int j, const char *s, double x)
-{
-    if (tab->cstrs) {
-	return strcmp(s, tab->Sc[j]) == 0;
-    } else {
-	return x == tab->cval[j];
+#if defined(_OPENMP)
+#pragma omp parallel for private(t) if (gretl_use_openmp((guint64) n * 8))
+#endif
+    for (t=0; t<n; t++) {
+	if (na(x[t])) {
+	    idx[t] = -1;
+	} else if (strs) {
+	    idx[t] = map[(int) x[t] - 1];
+	} else {
+	    const double *vals = (j == 1)? tab->cval : tab->rval;
+	    const double *pos = bsearch(&x[t], vals, nv, sizeof *vals,
+					gretl_compare_doubles);
+
+	    idx[t] = (pos == NULL)? -1 : pos - vals;
+	}
     }
+
+    free(map);
+
+    return 0;
 }
 
 #define complete_obs(x,y,t) (!na(x[t]) && !na(y[t]))
@@ -2756,11 +3056,8 @@ static Xtab *get_new_xtab (int rv, int cv, const DATASET *dset,
 {
     series_table *sti = NULL;
     series_table *stj = NULL;
-    const char *s1 = NULL;
-    const char *s2 = NULL;
-    double x1 = 0, x2 = 0;
     Xtab *tab = NULL;
-    int imatch, jmatch;
+    int *ri = NULL, *ci;
     int i, j, t, n = 0;
 
     for (t=dset->t1; t<=dset->t2; t++) {
@@ -2789,6 +3086,12 @@ static Xtab *get_new_xtab (int rv, int cv, const DATASET *dset,
     if (!*err) {
 	*err = xtab_allocate_arrays(tab);
     }
+    if (!*err) {
+	ri = malloc(2 * sample_size(dset) * sizeof *ri);
+	if (ri == NULL) {
+	    *err = E_ALLOC;
+	}
+    }
 
     if (*err) goto bailout;
 
@@ -2796,42 +3099,28 @@ static Xtab *get_new_xtab (int rv, int cv, const DATASET *dset,
     strcpy(tab->rvarname, dset->varname[rv]);
     strcpy(tab->cvarname, dset->varname[cv]);
 
-    /* The following could be made more efficient by substituting
-       sorted arrays for dset->Z[rv] and dset->Z[cv] but I'm not
-       sure if the fixed cost would be recouped.
-    */
+    /* find the row and column of each observation, then count */
+    ci = ri + sample_size(dset);
+    *err = xtab_get_indices(tab, rv, 0, dset, sti, ri);
+    if (!*err) {
+	*err = xtab_get_indices(tab, cv, 1, dset, stj, ci);
+    }
+    if (*err) goto bailout;
 
-    for (t=dset->t1; t<=dset->t2; t++) {
-	if (!complete_obs(dset->Z[rv], dset->Z[cv], t)) {
-	    continue;
-	}
-	x1 = dset->Z[rv][t];
-	if (tab->rstrs) {
-	    s1 = series_table_get_string(sti, x1);
-	}
-	x2 = dset->Z[cv][t];
-	if (tab->cstrs) {
-	    s2 = series_table_get_string(stj, x2);
-	}
-	for (i=0; i<tab->rows; i++) {
-	    imatch = xtab_row_match(tab, i, s1, x1);
-	    if (imatch) {
-		jmatch = 0;
-		for (j=0; j<tab->cols && !jmatch; j++) {
-		    jmatch = xtab_col_match(tab, j, s2, x2);
-		    if (jmatch) {
-			tab->f[i][j] += 1;
-			tab->rtotal[i] += 1;
-			tab->ctotal[j] += 1;
-		    }
-		}
-		break;
-	    }
+    for (t=0; t<sample_size(dset); t++) {
+	i = ri[t];
+	j = ci[t];
+	if (i >= 0 && j >= 0) {
+	    tab->f[i][j] += 1;
+	    tab->rtotal[i] += 1;
+	    tab->ctotal[j] += 1;
 	}
     }
 
  bailout:
 
+    free(ri);
+
     if (*err) {
 	free_xtab(tab);
 	tab = NULL;
@@ -5752,29 +6041,56 @@ Summary *get_summary_weighted (const int *list, const DATASET *dset,
     return s;
 }
 
-/* Get the additional statistics wanted if the --simple
-   flag was not given to the summary command.
+/* Get the median and, if the --simple flag was not given to the
+   summary command, the other order statistics and the coefficient
+   of variation. The @n valid values of @x are copied just once and
+   the quantiles are then found together, by selection on the copy.
 */
 
 static int get_extra_stats (Summary *s, int i,
 			    int t1, int t2,
-			    const double *x)
+			    const double *x, int n)
 {
+    double p[5] = {0.5, 0.05, 0.95, 0.25, 0.75};
+    int simple = (s->opt & OPT_S);
+    double *a;
+    int t, k = 0;
     int err = 0;
 
-    if (floateq(s->mean[i], 0.0)) {
-	s->cv[i] = NADBL;
-    } else if (floateq(s->sd[i], 0.0)) {
-	s->cv[i] = 0.0;
+    if (!simple) {
+	if (floateq(s->mean[i], 0.0)) {
+	    s->cv[i] = NADBL;
+	} else if (floateq(s->sd[i], 0.0)) {
+	    s->cv[i] = 0.0;
+	} else {
+	    s->cv[i] = fabs(s->sd[i] / s->mean[i]);
+	}
+    }
+
+    a = malloc(n * sizeof *a);
+    if (a == NULL) {
+	err = E_ALLOC;
     } else {
-	s->cv[i] = fabs(s->sd[i] / s->mean[i]);
+	for (t=t1; t<=t2 && k<n; t++) {
+	    if (!na(x[t])) {
+		a[k++] = x[t];
+	    }
+	}
+	err = gretl_array_quantiles(a, k, p, simple ? 1 : 5);
+	free(a);
     }
 
-    s->perc05[i] = gretl_quantile(t1, t2, x, 0.05, OPT_Q, &err);
-    s->perc95[i] = gretl_quantile(t1, t2, x, 0.95, OPT_Q, &err);
-    s->iqr[i] = gretl_quantile(t1, t2, x, 0.75, OPT_NONE, &err);
-    if (!na(s->iqr[i])) {
-	s->iqr[i] -= gretl_quantile(t1, t2, x, 0.25, OPT_NONE, &err);
+    if (err) {
+	for (k=0; k<5; k++) {
+	    p[k] = NADBL;
+	}
+    }
+
+    s->median[i] = p[0];
+    if (!simple) {
+	s->perc05[i] = p[1];
+	s->perc95[i] = p[2];
+	s->iqr[i] = (na(p[3]) || na(p[4]))? NADBL : p[4] - p[3];
     }
 
     return err;
@@ -5878,11 +6194,7 @@ Summary *get_summary_restricted (const int *list, const DATASET *dset,
 
 	summary_minmax(t1, t2, x, s, i);
 	gretl_moments(t1, t2, x, NULL, &s->mean[i], &s->sd[i], pskew, pkurt, 1);
-	s->median[i] = gretl_median(t1, t2, x);
-
-	if (!(opt & OPT_S)) {
-	    *err = get_extra_stats(s, i, t1, t2, x);
-	}
+	*err = get_extra_stats(s, i, t1, t2, x, ni);
 
 	if (dataset_is_panel(dset) && list[0] == 1) {
 	    panel_variance_info(x, dset, s->mean[0], &s->sw, &s->sb);
@@ -5914,7 +6226,7 @@ Summary *get_summary (const int *list, const DATASET *dset,
     int t1 = dset->t1;
     int t2 = dset->t2;
     Summary *s;
-    int i, nmax;
+    int i, nv, nmax;
 
     s = summary_new(list, 0, opt, err);
     if (s == NULL) {
@@ -5923,18 +6235,15 @@ Summary *get_summary (const int *list, const DATASET *dset,
 
     nmax = sample_size(dset);
 
+    /* first drop any series that can't be summarized */
     for (i=0; i<s->list[0]; i++)  {
-	double *pskew = NULL, *pkurt = NULL;
-	const double *x;
-	double x0;
 	int vi = s->list[i+1];
 	int strvals;
 	int ni = 0;
 
 	strvals = is_string_valued(dset, vi);
 	if (!strvals) {
-	    x = dset->Z[vi];
-	    ni = good_obs(x + t1, nmax, &x0);
+	    ni = good_obs(dset->Z[vi] + t1, nmax, NULL);
 	    s->misscount[i] = nmax - ni;
 	    if (ni > s->n) {
 		s->n = ni;
@@ -5956,12 +6265,25 @@ Summary *get_summary (const int *list, const DATASET *dset,
 		continue;
 	    }
 	}
+    }
+
+    nv = s->list[0];
+
+    /* then compute the statistics: the series are independent,
+       so with a long list they can be handled on several threads
+    */
+#if defined(_OPENMP)
+#pragma omp parallel for if (nv > 1 && gretl_use_openmp((guint64) nv * nmax))
+#endif
+    for (i=0; i<nv; i++)  {
+	const double *x = dset->Z[s->list[i+1]];
+	double *pskew = NULL, *pkurt = NULL;
+	int ierr;
 
 	if (opt & OPT_S) {
 	    s->skew[i] = NADBL;
 	    s->xkurt[i] = NADBL;
 	    s->cv[i] = NADBL;
-	    s->median[i] = NADBL;
 	} else {
 	    pskew = &s->skew[i];
 	    pkurt = &s->xkurt[i];
@@ -5977,16 +6299,19 @@ Summary *get_summary (const int *list, const DATASET *dset,
 			  pskew, pkurt, 0);
 	}
 
-	/* included in both simple and full variants */
-	s->median[i] = gretl_median(t1, t2, x);
-
-	if (!(opt & OPT_S)) {
-	    *err = get_extra_stats(s, i, t1, t2, x);
+	/* the median is included in both simple and full variants */
+	ierr = get_extra_stats(s, i, t1, t2, x, nmax - s->misscount[i]);
+	if (ierr) {
+#if defined(_OPENMP)
+#pragma omp critical (summary_err)
+#endif
+	    *err = ierr;
 	}
+    }
 
-	if (dataset_is_panel(dset) && list[0] == 1) {
-	    panel_variance_info(x, dset, s->mean[0], &s->sw, &s->sb);
-	}
+    if (dataset_is_panel(dset) && list[0] == 1) {
+	panel_variance_info(dset->Z[s->list[1]], dset, s->mean[0],
+			    &s->sw, &s->sb);
     }
 
     return s;
@@ -6446,6 +6771,193 @@ enum {
     COVMAT
 };
 
+#define CORR_BLOCK 256
+
+/* Compute all the pairwise-complete correlations or covariances for
+   the series in @v at once, via matrix products over blocks of
+   CORR_BLOCK observations. Each series is first centred on its own
+   mean, and missing values are set to zero. Then with X the centred
+   data and M the 0/1 matrix of valid observations, for each pair
+   (i, j), N = M'M gives the common number of observations, X'M the
+   sum of x_i and (X.*X)'M the sum of x_i^2 over those observations,
+   and X'X the cross-products, from which the deviations from the
+   pairwise means follow. In the absence of missing values only X'X
+   is needed. The number of missing observations for each pair is
+   written to @nmiss, following gretl_corr() and gretl_covar(),
+   which this replicates. Returns non-zero if the workspace can't
+   be allocated, in which case the caller should go pair by pair.
+*/
+
+static int corrcov_by_gemm (VMatrix *v, const DATASET *dset,
+			    int flag, int *nmiss)
+{
+    gretl_matrix *X, *M, *X2;
+    gretl_matrix *P, *N, *S, *Q;
+    double *c, *sum;
+    char *isconst;
+    int vn = v->t2 - v->t1 + 1;
+    int m = v->dim;
+    int b = MIN(vn, CORR_BLOCK);
+    int anyna = 0;
+    int i, j, t, t0, nt;
+    int err = 0;
+
+    c = malloc(m * sizeof *c);
+    sum = calloc(m, sizeof *sum);
+    isconst = malloc(m);
+    X = gretl_matrix_alloc(b, m);
+    P = gretl_zero_matrix_new(m, m);
+    M = X2 = N = S = Q = NULL;
+
+    if (c == NULL || sum == NULL || isconst == NULL ||
+	X == NULL || P == NULL) {
+	err = E_ALLOC;
+	goto bailout;
+    }
+
+    /* per-series means (the centring shift) and constancy */
+    for (i=0; i<m; i++) {
+	const double *x = dset->Z[v->list[i+1]];
+	int n = 0;
+
+	c[i] = 0.0;
+	for (t=v->t1; t<=v->t2; t++) {
+	    if (na(x[t])) {
+		anyna = 1;
+	    } else {
+		c[i] += x[t];
+		n++;
+	    }
+	}
+	c[i] = (n > 0)? c[i] / n : 0.0;
+	isconst[i] = gretl_isconst(v->t1, v->t2, x);
+    }
+
+    if (anyna) {
+	M = gretl_matrix_alloc(b, m);
+	X2 = gretl_matrix_alloc(b, m);
+	N = gretl_zero_matrix_new(m, m);
+	S = gretl_zero_matrix_new(m, m);
+	Q = gretl_zero_matrix_new(m, m);
+	if (M == NULL || X2 == NULL || N == NULL ||
+	    S == NULL || Q == NULL) {
+	    err = E_ALLOC;
+	    goto bailout;
+	}
+    }
+
+    for (t0=v->t1; t0<=v->t2; t0+=b) {
+	nt = MIN(b, v->t2 - t0 + 1);
+	gretl_matrix_reuse(X, nt, m);
+	if (anyna) {
+	    gretl_matrix_reuse(M, nt, m);
+	    gretl_matrix_reuse(X2, nt, m);
+	}
+#if defined(_OPENMP)
+#pragma omp parallel for private(t) if (m > 1 && gretl_use_openmp((guint64) nt * m))
+#endif
+	for (i=0; i<m; i++) {
+	    const double *x = dset->Z[v->list[i+1]] + t0;
+	    double *xi = X->val + (size_t) i * nt;
+	    double ssum = 0.0;
+
+	    for (t=0; t<nt; t++) {
+		xi[t] = na(x[t])? 0.0 : x[t] - c[i];
+		ssum += xi[t];
+		if (anyna) {
+		    M->val[(size_t) i * nt + t] = na(x[t])? 0.0 : 1.0;
+		    X2->val[(size_t) i * nt + t] = xi[t] * xi[t];
+		}
+	    }
+	    sum[i] += ssum;
+	}
+	gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+				  X, GRETL_MOD_NONE,
+				  P, GRETL_MOD_CUMULATE);
+	if (anyna) {
+	    gretl_matrix_multiply_mod(M, GRETL_MOD_TRANSPOSE,
+				      M, GRETL_MOD_NONE,
+				      N, GRETL_MOD_CUMULATE);
+	    gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+				      M, GRETL_MOD_NONE,
+				      S, GRETL_MOD_CUMULATE);
+	    gretl_matrix_multiply_mod(X2, GRETL_MOD_TRANSPOSE,
+				      M, GRETL_MOD_NONE,
+				      Q, GRETL_MOD_CUMULATE);
+	}
+    }
+
+    for (i=0; i<m; i++) {
+	for (j=i; j<m; j++) {
+	    int idx = ijton(i, j, m);
+	    double sij, sji, sxy;
+	    int nn;
+
+	    nmiss[idx] = 0;
+	    if (i == j && flag == CORRMAT) {
+		v->vec[idx] = 1.0;
+		continue;
+	    } else if (flag == CORRMAT && (isconst[i] || isconst[j])) {
+		v->vec[idx] = NADBL;
+		continue;
+	    }
+	    if (anyna) {
+		nn = (int) gretl_matrix_get(N, i, j);
+		sij = gretl_matrix_get(S, i, j);
+		sji = gretl_matrix_get(S, j, i);
+	    } else {
+		nn = vn;
+		sij = sum[i];
+		sji = sum[j];
+	    }
+	    if (nn < 2) {
+		v->vec[idx] = NADBL;
+		continue;
+	    }
+	    sxy = gretl_matrix_get(P, i, j) - sij * sji / nn;
+	    if (flag == COVMAT) {
+		v->vec[idx] = sxy / (nn - 1);
+	    } else {
+		double sxx, syy, den;
+
+		if (anyna) {
+		    sxx = gretl_matrix_get(Q, i, j) - sij * sij / nn;
+		    syy = gretl_matrix_get(Q, j, i) - sji * sji / nn;
+		} else {
+		    sxx = gretl_matrix_get(P, i, i) - sij * sij / nn;
+		    syy = gretl_matrix_get(P, j, j) - sji * sji / nn;
+		}
+		if (sxx <= 1.0e-13 * (sxx + sij * sij / nn) ||
+		    syy <= 1.0e-13 * (syy + sji * sji / nn)) {
+		    /* constant on the common sample, up to rounding */
+		    sxy = 0.0;
+		}
+		v->vec[idx] = 0.0;
+		if (sxy != 0.0) {
+		    den = sxx * syy;
+		    v->vec[idx] = (den > 0.0)? sxy / sqrt(den) : NADBL;
+		}
+	    }
+	    nmiss[idx] = vn - nn;
+	}
+    }
+
+ bailout:
+
+    free(c);
+    free(sum);
+    free(isconst);
+    gretl_matrix_free(X);
+    gretl_matrix_free(M);
+    gretl_matrix_free(X2);
+    gretl_matrix_free(P);
+    gretl_matrix_free(N);
+    gretl_matrix_free(S);
+    gretl_matrix_free(Q);
+
+    return err;
+}
+
 /* Compute correlation or covariance matrix, using the maximum
    available sample for each coefficient.
 */
@@ -6457,42 +6969,60 @@ static int max_corrcov_matrix (VMatrix *v, const DATASET *dset,
     int i, j, vi, vj, idx;
     int vn = v->t2 - v->t1 + 1;
     int m = v->dim;
-    int nij, nmiss;
+    int *nmiss;
+    int nij;
+
+    nmiss = malloc(((m * (m + 1)) / 2) * sizeof *nmiss);
+    if (nmiss == NULL) {
+	return E_ALLOC;
+    }
+
+    if (corrcov_by_gemm(v, dset, flag, nmiss)) {
+	/* short of memory? try one pair at a time */
+	for (i=0; i<m; i++) {
+	    vi = v->list[i+1];
+	    for (j=i; j<m; j++)  {
+		vj = v->list[j+1];
+		idx = ijton(i, j, m);
+		nmiss[idx] = 0;
+		if (i == j && flag == CORRMAT) {
+		    v->vec[idx] = 1.0;
+		} else if (flag == COVMAT) {
+		    v->vec[idx] = gretl_covar(v->t1, v->t2, Z[vi], Z[vj],
+					      &nmiss[idx]);
+		} else {
+		    v->vec[idx] = gretl_corr(v->t1, v->t2, Z[vi], Z[vj],
+					     &nmiss[idx]);
+		}
+	    }
+	}
+    }
 
     v->nmin = vn;
     v->nmax = 0;
 
     for (i=0; i<m; i++) {
-	vi = v->list[i+1];
 	for (j=i; j<m; j++)  {
-	    vj = v->list[j+1];
+	    if (i == j && flag == CORRMAT) {
+		continue;
+	    }
 	    idx = ijton(i, j, m);
 	    nij = vn;
-	    if (i == j && flag == CORRMAT) {
-		v->vec[idx] = 1.0;
-	    } else {
-		nmiss = 0;
-		if (flag == COVMAT) {
-		    v->vec[idx] = gretl_covar(v->t1, v->t2, Z[vi], Z[vj],
-					      &nmiss);
-		} else {
-		    v->vec[idx] = gretl_corr(v->t1, v->t2, Z[vi], Z[vj],
-					     &nmiss);
-		}
-		if (nmiss > 0) {
-		    v->missing += 1;
-		    nij -= nmiss;
-		}
-		if (nij > v->nmax) {
-		    v->nmax = nij;
-		}
-		if (nij < v->nmin) {
-		    v->nmin = nij;
-		}
+	    if (nmiss[idx] > 0) {
+		v->missing += 1;
+		nij -= nmiss[idx];
+	    }
+	    if (nij > v->nmax) {
+		v->nmax = nij;
+	    }
+	    if (nij < v->nmin) {
+		v->nmin = nij;
 	    }
 	}
     }
 
+    free(nmiss);
+
     /* We'll record an "ncrit" value if there's something resembling
        a common number of observations across the coefficients.
        Specifically, we require that the difference between the max
@@ -6588,6 +7118,21 @@ static int uniform_corrcov_matrix (VMatrix *v, const DATASET *dset,
 	xbar[i] /= n;
     }
 
+    if (v->vec == NULL) {
+	/* PCA via SVD of the data: just the moments are wanted */
+	for (t=v->t1; t<=v->t2; t++) {
+	    miss = 0;
+	    for (i=0; i<m && !miss; i++) {
+		miss = na(Z[v->list[i+1]][t]);
+	    }
+	    for (i=0; i<m && !miss; i++) {
+		d1 = Z[v->list[i+1]][t] - xbar[i];
+		ssx[i] += d1 * d1;
+	    }
+	}
+	goto finish;
+    }
+
     for (i=0; i<mm; i++) {
 	v->vec[i] = 0.0;
     }
@@ -6644,6 +7189,8 @@ static int uniform_corrcov_matrix (VMatrix *v, const DATASET *dset,
 	}
     }
 
+ finish:
+
     v->nmax = v->nmin = v->ncrit = n;
 
     if (ci == PCA) {
@@ -6732,7 +7279,10 @@ static void corrlist_adjust_sample (const int *list,
  * flags contain OPT_N, a uniform sample is ensured: only those
  * observations for which all the listed variables have valid
  * values are used.  If OPT_C is included, we actually calculate
- * covariances rather than correlations.
+ * covariances rather than correlations. If @ci is PCA and OPT_K
+ * is included the matrix itself is not computed, only the means
+ * and sums of squared deviations, for use in PCA via the SVD of
+ * the data.
  *
  * Returns: gretl correlation matrix struct, or NULL on failure.
  */
@@ -6784,10 +7334,13 @@ VMatrix *corrlist (int ci, int *list, const DATASET *dset,
     mm = (m * (m + 1)) / 2;
 
     v->names = strings_array_new(m);
-    v->vec = malloc(mm * sizeof *v->vec);
+    if (ci != PCA || !(opt & OPT_K)) {
+	v->vec = malloc(mm * sizeof *v->vec);
+    }
     v->list = gretl_list_copy(list);
 
-    if (v->names == NULL || v->vec == NULL || v->list == NULL) {
+    if (v->names == NULL || v->list == NULL ||
+	(v->vec == NULL && (ci != PCA || !(opt & OPT_K)))) {
 	*err = E_ALLOC;
 	goto bailout;
     }
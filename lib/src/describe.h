@@ -98,6 +98,8 @@ double gretl_restricted_mean (int t1, int t2, const double *x,
 			      const double *y, GretlOp yop,
 			      double yval);
 
+double gretl_quantile_index (int n, double p);
+
 double gretl_quantile (int t1, int t2, const double *x,
 		       double p, gretlopt opt, int *err);
 
@@ -25,6 +25,7 @@
 #include "qr_estimate.h"
 #include "matrix_extra.h"
 #include "gretl_string_table.h"
+#include "gretl_mt.h"
 
 #include <errno.h>
 
@@ -630,46 +631,29 @@ double mn_logit_prediction (const gretl_matrix *Xt,
                             const double *b,
                             const gretl_matrix *yvals)
 {
-    double *eXtb = NULL;
-    double St, pj, pmax;
+    double Xtb, Xtbmax = 0.0;
     int i, j, k, m, nx;
     int pidx = 0;
 
     nx = gretl_vector_get_length(Xt);
     m = gretl_vector_get_length(yvals);
 
-    eXtb = malloc(m * sizeof *eXtb);
-    if (eXtb == NULL) {
-        return NADBL;
-    }
-
-    /* base case */
-    eXtb[0] = St = 1.0;
+    /* The most probable outcome is the one with the largest
+       index value, X*beta, where the index is zero for the base
+       case; so there's no need to compute the probabilities.
+    */
     k = 0;
-
-    /* loop across the other y-values */
     for (j=1; j<m; j++) {
-        /* accumulate exp(X*beta) */
-        eXtb[j] = 0.0;
+        Xtb = 0.0;
         for (i=0; i<nx; i++) {
-            eXtb[j] += Xt->val[i] * b[k++];
+            Xtb += Xt->val[i] * b[k++];
         }
-        eXtb[j] = exp(eXtb[j]);
-        St += eXtb[j];
-    }
-
-    pmax = 0.0;
-
-    for (j=0; j<m; j++) {
-        pj = eXtb[j] / St;
-        if (pj > pmax) {
-            pmax = pj;
+        if (Xtb > Xtbmax) {
+            Xtbmax = Xtb;
             pidx = j;
         }
     }
 
-    free(eXtb);
-
     return yvals->val[pidx];
 }
 
@@ -1718,6 +1702,19 @@ static char *classifier_check (int *list, const DATASET *dset,
     return mask;
 }
 
+/* Number of observations per block in the threaded loglikelihood
+   kernels for binary and multinomial logit/probit. The per-block
+   partial sums are added up in a fixed order, so the result does
+   not depend on the number of threads.
+*/
+
+#define LL_BLOCK 4096
+
+static int ll_blocks (int T)
+{
+    return (T + LL_BLOCK - 1) / LL_BLOCK;
+}
+
 /* struct for holding multinomial logit info */
 
 typedef struct mnl_info_ mnl_info;
@@ -1728,19 +1725,23 @@ struct mnl_info_ {
     int npar;         /* total number of parameters */
     int T;            /* number of observations */
     double *theta;    /* coeffs for Newton/BFGS */
+    double *llb;      /* loglikelihood by block of observations */
     gretl_matrix_block *B;
     gretl_matrix *y;  /* dependent variable */
     gretl_matrix *X;  /* regressors */
     gretl_matrix *b;  /* coefficients, matrix form */
     gretl_matrix *Xb; /* coeffs times regressors */
     gretl_matrix *P;  /* probabilities */
+    gretl_matrix *W;  /* workspace for score and Hessian */
 };
 
 static void mnl_info_destroy (mnl_info *mnl)
 {
     if (mnl != NULL) {
         gretl_matrix_block_destroy(mnl->B);
+        gretl_matrix_free(mnl->W);
         free(mnl->theta);
+        free(mnl->llb);
         free(mnl);
     }
 }
@@ -1756,23 +1757,23 @@ static mnl_info *mnl_info_new (int n, int k, int T)
         mnl->T = T;
         mnl->npar = k * n;
         mnl->theta = malloc(mnl->npar * sizeof *mnl->theta);
-        if (mnl->theta == NULL) {
-            free(mnl);
-            return NULL;
-        }
+        mnl->llb = malloc(ll_blocks(T) * sizeof *mnl->llb);
+        mnl->W = gretl_matrix_alloc(T, MAX(n, k));
         mnl->B = gretl_matrix_block_new(&mnl->y, T, 1,
                                         &mnl->X, T, k,
                                         &mnl->b, k, n,
                                         &mnl->Xb, T, n,
                                         &mnl->P, T, n,
                                         NULL);
-        if (mnl->B == NULL) {
-            free(mnl->theta);
-            free(mnl);
+        if (mnl->theta == NULL || mnl->llb == NULL ||
+            mnl->W == NULL || mnl->B == NULL) {
+            mnl_info_destroy(mnl);
             mnl = NULL;
         } else {
             for (i=0; i<mnl->npar; i++) {
                 mnl->theta[i] = 0.0;
+                /* mark the probabilities as not yet computed */
+                mnl->b->val[i] = NADBL;
             }
         }
     }
@@ -1780,13 +1781,23 @@ static mnl_info *mnl_info_new (int n, int k, int T)
     return mnl;
 }
 
-/* compute loglikelihood for multinomial logit */
+/* compute loglikelihood for multinomial logit: this also writes
+   the outcome probabilities into mnl->P, for use by the score
+   and Hessian functions. The log of the sum of exponentials is
+   computed relative to its largest term (taking the base case's
+   index as zero), so that neither large index values nor a large
+   number of outcomes can cause overflow.
+*/
 
 static double mn_logit_loglik (const double *theta, void *ptr)
 {
     mnl_info *mnl = (mnl_info *) ptr;
-    double x, xti, exti, ll = 0.0;
-    int yt, i, t;
+    const double *Xb = mnl->Xb->val;
+    double *P = mnl->P->val;
+    int T = mnl->T, n = mnl->n;
+    int nb = ll_blocks(T);
+    double ll = 0.0;
+    int i;
 
     for (i=0; i<mnl->npar; i++) {
         mnl->b->val[i] = theta[i];
@@ -1794,116 +1805,238 @@ static double mn_logit_loglik (const double *theta, void *ptr)
 
     gretl_matrix_multiply(mnl->X, mnl->b, mnl->Xb);
 
-    for (t=0; t<mnl->T; t++) {
-        x = 1.0;
-        for (i=0; i<mnl->n; i++) {
-            /* sum row i of exp(Xb) */
-            xti = gretl_matrix_get(mnl->Xb, t, i);
-            exti = exp(xti);
-            x += exti;
-        }
-        ll -= log(x);
-        yt = gretl_vector_get(mnl->y, t);
-        if (yt > 0) {
-            ll += gretl_matrix_get(mnl->Xb, t, yt-1);
+#if defined(_OPENMP)
+#pragma omp parallel for private(i) if (nb > 1 && gretl_use_openmp((guint64) T * n))
+#endif
+    for (i=0; i<nb; i++) {
+        int t1 = i * LL_BLOCK;
+        int t2 = MIN(t1 + LL_BLOCK, T);
+        double x, m, lli = 0.0;
+        int j, t, yt;
+
+        for (t=t1; t<t2; t++) {
+            m = 0.0;
+            for (j=0; j<n; j++) {
+                if (Xb[j*T+t] > m) {
+                    m = Xb[j*T+t];
+                }
+            }
+            x = exp(-m);
+            for (j=0; j<n; j++) {
+                /* sum row t of exp(Xb - m) */
+                P[j*T+t] = exp(Xb[j*T+t] - m);
+                x += P[j*T+t];
+            }
+            for (j=0; j<n; j++) {
+                P[j*T+t] /= x;
+            }
+            lli -= m + log(x);
+            yt = mnl->y->val[t];
+            if (yt > 0) {
+                lli += Xb[(yt-1)*T+t];
+            }
         }
+        mnl->llb[i] = lli;
+    }
+
+    for (i=0; i<nb; i++) {
+        ll += mnl->llb[i];
     }
 
     return ll;
 }
 
-static int mn_logit_score (double *theta, double *s, int npar,
-                           BFGS_CRIT_FUNC ll, void *ptr)
-{
-    mnl_info *mnl = (mnl_info *) ptr;
-    double x, xti, exti, pti, p, g;
-    int i, j, k, t, yt;
-    int err = 0;
+/* Make sure that mnl->P holds the probabilities at @theta: this
+   is normally the case, since the optimizers call the score and
+   Hessian functions at the point where the loglikelihood was last
+   evaluated, but it's not guaranteed.
+*/
 
-    for (i=0; i<npar; i++) {
-        s[i] = 0.0;
+static void mnl_sync (mnl_info *mnl, const double *theta)
+{
+    if (memcmp(theta, mnl->b->val, mnl->npar * sizeof *theta)) {
+        mn_logit_loglik(theta, mnl);
     }
+}
 
-    for (t=0; t<mnl->T && !errno; t++) {
-        x = 1.0;
-        for (i=0; i<mnl->n; i++) {
-            /* sum row i of exp(Xb) */
-            xti = gretl_matrix_get(mnl->Xb, t, i);
-            exti = exp(xti);
-            x += exti;
-            gretl_matrix_set(mnl->P, t, i, exti);
-        }
-        yt = gretl_vector_get(mnl->y, t);
-        k = 0;
-        for (i=0; i<mnl->n; i++) {
-            pti = gretl_matrix_get(mnl->P, t, i) / x;
-            gretl_matrix_set(mnl->P, t, i, pti);
-            p = (i == (yt-1)) - pti;
-            for (j=0; j<mnl->k; j++) {
-                g = p * gretl_matrix_get(mnl->X, t, j);
-                s[k++] += g;
-            }
+/* Write the per-observation score weights, (y_t == i) - P_ti,
+   into the T x n matrix @W; the score is then X'W.
+*/
+
+static void mnl_score_weights (mnl_info *mnl, gretl_matrix *W)
+{
+    int T = mnl->T, n = mnl->n;
+    int t;
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(t) if (gretl_use_openmp((guint64) T * n))
+#endif
+    for (t=0; t<T; t++) {
+        int i, yt = mnl->y->val[t];
+
+        for (i=0; i<n; i++) {
+            W->val[i*T+t] = (i == (yt-1)) - mnl->P->val[i*T+t];
         }
     }
+}
 
-    return err;
+static int mn_logit_score (double *theta, double *s, int npar,
+                           BFGS_CRIT_FUNC ll, void *ptr)
+{
+    mnl_info *mnl = (mnl_info *) ptr;
+    gretl_matrix W = {0};
+    gretl_matrix S = {0};
+
+    /* the score, as a k x n matrix, is X'W */
+    mnl_sync(mnl, theta);
+    gretl_matrix_init_full(&W, mnl->T, mnl->n, mnl->W->val);
+    gretl_matrix_init_full(&S, mnl->k, mnl->n, s);
+    mnl_score_weights(mnl, &W);
+
+    return gretl_matrix_multiply_mod(mnl->X, GRETL_MOD_TRANSPOSE,
+                                     &W, GRETL_MOD_NONE,
+                                     &S, GRETL_MOD_NONE);
 }
 
 /* multinomial logit: form the negative of the analytical
-   Hessian */
+   Hessian. This is the sum over t of (diag(p_t) - p_t p_t')
+   kronecker x_t x_t', which we split into a block-diagonal part,
+   with blocks X' diag(p_j) X, minus Z'Z, where row t of Z is p_t
+   kronecker x_t. The latter is accumulated over blocks of rows of
+   Z, so the storage needed is independent of the sample size and
+   the work is done by BLAS in a single symmetric rank-k update
+   per block, rather than by a separate product for each pair of
+   outcomes.
+*/
+
+#define MNL_HBLOCK 512
 
 static int mnl_hessian (double *theta, gretl_matrix *H, void *data)
 {
     mnl_info *mnl = data;
-    gretl_matrix_block *B;
-    gretl_matrix *x;
-    gretl_matrix *xx;
-    gretl_matrix *hjk;
-    double xti, ptj, ptk;
-    int r, c;
-    int i, j, k, t;
-
-    B = gretl_matrix_block_new(&x, 1, mnl->k,
-                               &xx, mnl->k, mnl->k,
-                               &hjk, mnl->k, mnl->k,
-                               NULL);
-    if (B == NULL) {
+    gretl_matrix *hjj, *Z;
+    gretl_matrix pX = {0};
+    int T = mnl->T, k = mnl->k, n = mnl->n;
+    int rb = MIN(T, MNL_HBLOCK);
+    int i, j, t0, nr;
+
+    hjj = gretl_matrix_alloc(k, k);
+    Z = gretl_matrix_alloc(rb, mnl->npar);
+    if (hjj == NULL || Z == NULL) {
+        gretl_matrix_free(hjj);
+        gretl_matrix_free(Z);
         return E_ALLOC;
     }
 
-    r = c = 0;
+    mnl_sync(mnl, theta);
+    gretl_matrix_zero(H);
+    gretl_matrix_init_full(&pX, T, k, mnl->W->val);
 
-    for (j=0; j<mnl->n; j++) {
-        for (k=0; k<=j; k++) {
-            gretl_matrix_zero(hjk);
-            for (t=0; t<mnl->T; t++) {
-                for (i=0; i<mnl->k; i++) {
-                    xti = gretl_matrix_get(mnl->X, t, i);
-                    gretl_vector_set(x, i, xti);
-                }
-                gretl_matrix_multiply_mod(x, GRETL_MOD_TRANSPOSE,
-                                          x, GRETL_MOD_NONE,
-                                          xx, GRETL_MOD_NONE);
-                ptj = gretl_matrix_get(mnl->P, t, j);
-                ptk = gretl_matrix_get(mnl->P, t, k);
-                gretl_matrix_multiply_by_scalar(xx, ptj * ((j == k) - ptk));
-                gretl_matrix_add_to(hjk, xx);
+    for (j=0; j<n; j++) {
+        const double *pj = mnl->P->val + j * T;
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(i) if (gretl_use_openmp((guint64) T * k))
+#endif
+        for (i=0; i<k; i++) {
+            const double *xi = mnl->X->val + i * T;
+            double *pxi = pX.val + i * T;
+            int t;
+
+            for (t=0; t<T; t++) {
+                pxi[t] = pj[t] * xi[t];
             }
-            gretl_matrix_inscribe_matrix(H, hjk, r, c, GRETL_MOD_NONE);
-            if (j != k) {
-                gretl_matrix_inscribe_matrix(H, hjk, c, r, GRETL_MOD_NONE);
+        }
+        gretl_matrix_multiply_mod(mnl->X, GRETL_MOD_TRANSPOSE,
+                                  &pX, GRETL_MOD_NONE,
+                                  hjj, GRETL_MOD_NONE);
+        gretl_matrix_inscribe_matrix(H, hjj, j*k, j*k, GRETL_MOD_NONE);
+    }
+
+    for (t0=0; t0<T; t0+=rb) {
+        nr = MIN(rb, T - t0);
+        gretl_matrix_reuse(Z, nr, mnl->npar);
+#if defined(_OPENMP)
+#pragma omp parallel for private(i) if (gretl_use_openmp((guint64) nr * mnl->npar))
+#endif
+        for (i=0; i<mnl->npar; i++) {
+            /* column i of Z is p_j .* x_l, for j = i / k, l = i % k */
+            const double *pj = mnl->P->val + (i / k) * T + t0;
+            const double *xl = mnl->X->val + (i % k) * T + t0;
+            double *zi = Z->val + i * nr;
+            int s;
+
+            for (s=0; s<nr; s++) {
+                zi[s] = pj[s] * xl[s];
             }
-            c += mnl->k;
         }
-        r += mnl->k;
-        c = 0;
+        gretl_matrix_multiply_mod(Z, GRETL_MOD_TRANSPOSE,
+                                  Z, GRETL_MOD_NONE,
+                                  H, GRETL_MOD_DECREMENT);
     }
 
-    gretl_matrix_block_destroy(B);
+    gretl_matrix_free(hjj);
+    gretl_matrix_free(Z);
 
     return 0;
 }
 
+/* multinomial logit: the product of the Hessian with the vector
+   @v, for use with trust_newton_max() when there are too many
+   parameters for the dense Hessian. Writing V for @v as a k x n
+   matrix, and U = XV, row t of the result (as a T x n matrix
+   A, before premultiplication by -X') is p_t .* (u_t - p_t'u_t).
+   This takes O(Tkn) operations and O(Tn) storage.
+*/
+
+static int mnl_hessvec (double *theta, const double *v, double *Hv,
+                        int npar, void *data)
+{
+    mnl_info *mnl = data;
+    gretl_matrix V = {0};
+    gretl_matrix A = {0};
+    gretl_matrix R = {0};
+    int T = mnl->T, n = mnl->n;
+    int i, t, err;
+
+    mnl_sync(mnl, theta);
+
+    gretl_matrix_init_full(&V, mnl->k, n, (double *) v);
+    gretl_matrix_init_full(&A, T, n, mnl->W->val);
+    gretl_matrix_init_full(&R, mnl->k, n, Hv);
+
+    err = gretl_matrix_multiply(mnl->X, &V, &A);
+    if (err) {
+        return err;
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(t) if (gretl_use_openmp((guint64) T * n))
+#endif
+    for (t=0; t<T; t++) {
+        const double *P = mnl->P->val;
+        double *a = A.val;
+        double pu = 0.0;
+        int j;
+
+        for (j=0; j<n; j++) {
+            pu += P[j*T+t] * a[j*T+t];
+        }
+        for (j=0; j<n; j++) {
+            a[j*T+t] = P[j*T+t] * (a[j*T+t] - pu);
+        }
+    }
+
+    err = gretl_matrix_multiply_mod(mnl->X, GRETL_MOD_TRANSPOSE,
+                                    &A, GRETL_MOD_NONE,
+                                    &R, GRETL_MOD_NONE);
+    for (i=0; i<npar && !err; i++) {
+        Hv[i] = -Hv[i];
+    }
+
+    return err;
+}
+
 static gretl_matrix *mnl_hessian_inverse (mnl_info *mnl, int *err)
 {
     gretl_matrix *H;
@@ -1925,23 +2058,27 @@ static gretl_matrix *mnl_hessian_inverse (mnl_info *mnl, int *err)
 static gretl_matrix *mnl_score_matrix (mnl_info *mnl, int *err)
 {
     gretl_matrix *G;
-    double p, g;
-    int yt, i, j, k, t;
+    gretl_matrix W = {0};
+    int T = mnl->T;
+    int i, j, t;
 
-    G = gretl_matrix_alloc(mnl->T, mnl->npar);
+    G = gretl_matrix_alloc(T, mnl->npar);
     if (G == NULL) {
         *err = E_ALLOC;
         return NULL;
     }
 
-    for (t=0; t<mnl->T; t++) {
-        yt = gretl_vector_get(mnl->y, t);
-        k = 0;
-        for (i=0; i<mnl->n; i++) {
-            p = (i == (yt-1)) - gretl_matrix_get(mnl->P, t, i);
-            for (j=0; j<mnl->k; j++) {
-                g = p * gretl_matrix_get(mnl->X, t, j);
-                gretl_matrix_set(G, t, k++, g);
+    gretl_matrix_init_full(&W, T, mnl->n, mnl->W->val);
+    mnl_score_weights(mnl, &W);
+
+    /* column i*k + j of G holds W[,i] .* X[,j] */
+    for (i=0; i<mnl->n; i++) {
+        for (j=0; j<mnl->k; j++) {
+            double *g = G->val + (i * mnl->k + j) * T;
+            const double *x = mnl->X->val + j * T;
+
+            for (t=0; t<T; t++) {
+                g[t] = W.val[i*T+t] * x[t];
             }
         }
     }
@@ -2063,11 +2200,8 @@ gretl_matrix *mn_logit_probabilities (const MODEL *pmod,
     gretl_matrix *P = NULL;
     const gretl_matrix *yvals = NULL;
     const double *b = NULL;
-    double *eXbt = NULL;
-    double St, ptj;
     char **S = NULL;
-    int j, k, s, t, vi, ok;
-    int i, m = 0;
+    int i, s, n, m = 0;
 
     if (pmod == NULL || pmod->list == NULL || pmod->coeff == NULL) {
         *err = E_DATA;
@@ -2093,8 +2227,7 @@ gretl_matrix *mn_logit_probabilities (const MODEL *pmod,
     }
 
     if (!*err) {
-        int n = t2 - t1 + 1;
-
+        n = t2 - t1 + 1;
         P = gretl_matrix_alloc(n, m);
         if (P == NULL) {
             *err = E_ALLOC;
@@ -2103,22 +2236,25 @@ gretl_matrix *mn_logit_probabilities (const MODEL *pmod,
         }
     }
 
-    if (!*err) {
-        /* allocate required workspace */
-        eXbt = malloc(m * sizeof *eXbt);
-        if (eXbt == NULL) {
-            *err = E_ALLOC;
-        }
-    }
-
     if (*err) {
         goto bailout;
     }
 
     b = pmod->coeff;
 
-    for (t=t1, s=0; t<=t2; t++, s++) {
-        ok = 1;
+    /* the rows of P are independent, so can be done in parallel;
+       the index values are written straight into P and then
+       transformed in place
+    */
+#if defined(_OPENMP)
+#pragma omp parallel for private(s) if (gretl_use_openmp((guint64) n * m * pmod->list[0]))
+#endif
+    for (s=0; s<n; s++) {
+        double St, Xbt, eXbt, Xbmax;
+        int i, j, k, vi;
+        int t = t1 + s;
+        int ok = 1;
+
         for (i=2; i<=pmod->list[0]; i++) {
             vi = pmod->list[i];
             if (na(dset->Z[vi][t])) {
@@ -2131,28 +2267,38 @@ gretl_matrix *mn_logit_probabilities (const MODEL *pmod,
             for (j=0; j<m; j++) {
                 gretl_matrix_set(P, s, j, NADBL);
             }
-        } else {
-            /* base case */
-            eXbt[0] = St = 1.0;
-            k = 0;
-            /* loop across the other y-values */
-            for (j=1; j<m; j++) {
-                /* accumulate exp(X*beta) */
-                eXbt[j] = 0.0;
-                for (i=2; i<=pmod->list[0]; i++) {
-                    vi = pmod->list[i];
-                    eXbt[j] += dset->Z[vi][t] * b[k++];
-                }
-                eXbt[j] = exp(eXbt[j]);
-                St += eXbt[j];
+            continue;
+        }
+        /* index values, X*beta, zero for the base case */
+        gretl_matrix_set(P, s, 0, 0.0);
+        Xbmax = 0.0;
+        k = 0;
+        for (j=1; j<m; j++) {
+            Xbt = 0.0;
+            for (i=2; i<=pmod->list[0]; i++) {
+                vi = pmod->list[i];
+                Xbt += dset->Z[vi][t] * b[k++];
             }
-            for (j=0; j<m; j++) {
-                ptj = eXbt[j] / St;
-                gretl_matrix_set(P, s, j, ptj);
+            gretl_matrix_set(P, s, j, Xbt);
+            if (Xbt > Xbmax) {
+                Xbmax = Xbt;
             }
         }
-        if (S != NULL) {
-            S[s] = retrieve_date_string(t+1, dset, err);
+        /* exponentiate relative to the largest, and normalize */
+        St = 0.0;
+        for (j=0; j<m; j++) {
+            eXbt = exp(gretl_matrix_get(P, s, j) - Xbmax);
+            gretl_matrix_set(P, s, j, eXbt);
+            St += eXbt;
+        }
+        for (j=0; j<m; j++) {
+            gretl_matrix_set(P, s, j, gretl_matrix_get(P, s, j) / St);
+        }
+    }
+
+    if (S != NULL) {
+        for (s=0; s<n && !*err; s++) {
+            S[s] = retrieve_date_string(t1 + s + 1, dset, err);
         }
     }
 
@@ -2166,8 +2312,6 @@ gretl_matrix *mn_logit_probabilities (const MODEL *pmod,
 
  bailout:
 
-    free(eXbt);
-
     return P;
 }
 
@@ -2364,12 +2508,14 @@ static void mnl_finish (mnl_info *mnl, MODEL *pmod,
     pmod->errcode = gretl_model_write_coeffs(pmod, mnl->theta, mnl->npar);
 
     if (!pmod->errcode) {
+        /* note: this also refreshes the probabilities used
+           by the Hessian and score matrix */
+        pmod->lnL = mn_logit_loglik(mnl->theta, mnl);
         pmod->errcode = mnl_add_variance_matrix(pmod, mnl, dset, opt);
     }
 
     if (!pmod->errcode) {
         pmod->ci = LOGIT;
-        pmod->lnL = mn_logit_loglik(mnl->theta, mnl);
         mle_criteria(pmod, 0);
 
         gretl_model_set_int(pmod, "multinom", mnl->n);
@@ -2531,11 +2677,22 @@ static MODEL mnl_model (const int *list, DATASET *dset,
         double gradtol = 1.0e-7;
 
         maxit = 100;
-        mod.errcode = newton_raphson_max(mnl->theta, mnl->npar, maxit,
-                                         crittol, gradtol, &fncount,
-                                         C_LOGLIK, mn_logit_loglik,
-                                         mn_logit_score, mnl_hessian, mnl,
-                                         maxopt, prn);
+        if (mnl->npar > NR_DENSE_MAX) {
+            /* many outcomes and/or regressors: use Hessian-vector
+               products rather than the dense Hessian */
+            maxit = 500;
+            mod.errcode = trust_newton_max(mnl->theta, mnl->npar, maxit,
+                                           crittol, gradtol, &fncount,
+                                           C_LOGLIK, mn_logit_loglik,
+                                           mn_logit_score, mnl_hessvec,
+                                           mnl, maxopt, prn);
+        } else {
+            mod.errcode = newton_raphson_max(mnl->theta, mnl->npar, maxit,
+                                             crittol, gradtol, &fncount,
+                                             C_LOGLIK, mn_logit_loglik,
+                                             mn_logit_score, mnl_hessian,
+                                             mnl, maxopt, prn);
+        }
     }
 
     if (!mod.errcode) {
@@ -2602,12 +2759,15 @@ struct bin_info_ {
     int T;            /* number of observations */
     int pp_err;       /* to record perfect-prediction error */
     double *theta;    /* coeffs for Newton-Raphson */
+    double *llb;      /* per-block workspace for loglik */
     int *y;           /* dependent variable */
     gretl_matrix *X;  /* regressors */
     gretl_matrix *Ri; /* inverse of R from decomp of X */
     gretl_matrix_block *B;
     gretl_matrix *pX; /* for use with Hessian */
     gretl_matrix *Xb; /* index function values */
+    gretl_matrix *w;  /* score weights */
+    gretl_matrix *h;  /* Hessian weights */
 };
 
 static void bin_info_destroy (bin_info *bin)
@@ -2617,6 +2777,7 @@ static void bin_info_destroy (bin_info *bin)
         gretl_matrix_free(bin->X);
         gretl_matrix_free(bin->Ri);
         free(bin->theta);
+        free(bin->llb);
         free(bin->y);
         free(bin);
     }
@@ -2639,12 +2800,15 @@ static bin_info *bin_info_new (int ci, int k, int T)
     bin->T = T;
     bin->pp_err = 0;
     bin->theta = malloc(k * sizeof *bin->theta);
+    bin->llb = malloc(3 * ll_blocks(T) * sizeof *bin->llb);
     bin->y = malloc(T * sizeof *bin->y);
-    if (bin->theta == NULL || bin->y == NULL) {
+    if (bin->theta == NULL || bin->llb == NULL || bin->y == NULL) {
         err = E_ALLOC;
     } else {
         bin->B = gretl_matrix_block_new(&bin->pX, T, k,
                                         &bin->Xb, T, 1,
+                                        &bin->w, T, 1,
+                                        &bin->h, T, 1,
                                         NULL);
         if (bin->B == NULL) {
             err = E_ALLOC;
@@ -2658,45 +2822,79 @@ static bin_info *bin_info_new (int ci, int k, int T)
     return bin;
 }
 
-/* compute loglikelihood for binary probit/logit */
+/* compute loglikelihood for binary probit/logit: in the same
+   pass over the data we record, for each observation, the
+   weights which turn the regressors into the score and the
+   (negative) Hessian, so that binary_score() and binary_hessian()
+   reduce to matrix products
+*/
 
 static double binary_loglik (const double *theta, void *ptr)
 {
     bin_info *bin = (bin_info *) ptr;
+    int nb = ll_blocks(bin->T);
+    double *llb = bin->llb;
+    double *max0 = llb + nb;
+    double *min1 = max0 + nb;
     gretl_matrix b;
-    double max0 = -1.0e200;
-    double min1 = 1.0e200;
-    double e, ndx, p;
     double ll = 0.0;
-    int t;
+    int i;
 
     gretl_matrix_init_full(&b, bin->k, 1, (double *) theta);
     gretl_matrix_multiply(bin->X, &b, bin->Xb);
 
-    /* perfect prediction check */
-    for (t=0; t<bin->T; t++) {
-        ndx = gretl_vector_get(bin->Xb, t);
-        if (bin->y[t] == 0 && ndx > max0) {
-            max0 = ndx;
-        } else if (bin->y[t] == 1 && ndx < min1) {
-            min1 = ndx;
+#if defined(_OPENMP)
+#pragma omp parallel for private(i) if (nb > 1 && gretl_use_openmp((guint64) bin->T * 8))
+#endif
+    for (i=0; i<nb; i++) {
+        int t1 = i * LL_BLOCK;
+        int t2 = MIN(t1 + LL_BLOCK, bin->T);
+        double ndx, e, p, w;
+        int t, yt;
+
+        llb[i] = 0.0;
+        max0[i] = -1.0e200;
+        min1[i] = 1.0e200;
+
+        for (t=t1; t<t2; t++) {
+            yt = bin->y[t];
+            ndx = bin->Xb->val[t];
+            /* for the perfect prediction check */
+            if (yt == 0 && ndx > max0[i]) {
+                max0[i] = ndx;
+            } else if (yt == 1 && ndx < min1[i]) {
+                min1[i] = ndx;
+            }
+            if (bin->ci == PROBIT) {
+                p = yt ? normal_cdf(ndx) : normal_cdf(-ndx);
+                w = yt ? invmills(-ndx) : -invmills(ndx);
+                bin->h->val[t] = w * (ndx + w);
+            } else {
+                e = logit(ndx);
+                p = yt ? e : 1-e;
+                w = yt - e;
+                bin->h->val[t] = e * (1-e);
+            }
+            bin->w->val[t] = w;
+            llb[i] += log(p);
         }
     }
-    if (min1 > max0) {
+
+    for (i=1; i<nb; i++) {
+        if (max0[i] > max0[0]) {
+            max0[0] = max0[i];
+        }
+        if (min1[i] < min1[0]) {
+            min1[0] = min1[i];
+        }
+    }
+    if (min1[0] > max0[0]) {
         bin->pp_err = 1;
         return NADBL;
     }
 
-    /* compute loglikelihood */
-    for (t=0; t<bin->T; t++) {
-        ndx = gretl_vector_get(bin->Xb, t);
-        if (bin->ci == PROBIT) {
-            p = bin->y[t] ? normal_cdf(ndx) : normal_cdf(-ndx);
-        } else {
-            e = logit(ndx);
-            p = bin->y[t] ? e : 1-e;
-        }
-        ll += log(p);
+    for (i=0; i<nb; i++) {
+        ll += llb[i];
     }
 
     return ll;
@@ -2706,54 +2904,40 @@ static int binary_score (double *theta, double *s, int k,
                          BFGS_CRIT_FUNC ll, void *ptr)
 {
     bin_info *bin = (bin_info *) ptr;
-    double ndx, w;
-    int t, j, yt;
-    int err = 0;
-
-    for (j=0; j<bin->k; j++) {
-        s[j] = 0.0;
-    }
-
-    for (t=0; t<bin->T; t++) {
-        yt = bin->y[t];
-        ndx = gretl_vector_get(bin->Xb, t);
-        if (bin->ci == PROBIT) {
-            w = yt ? invmills(-ndx) : -invmills(ndx);
-        } else {
-            w = yt - logit(ndx);
-        }
-        for (j=0; j<bin->k; j++) {
-            s[j] += w * gretl_matrix_get(bin->X, t, j);
-        }
-    }
+    gretl_matrix g = {0};
+    int err;
 
+    /* the score is X'w */
+    gretl_matrix_init_full(&g, bin->k, 1, s);
+    err = gretl_matrix_multiply_mod(bin->X, GRETL_MOD_TRANSPOSE,
+                                    bin->w, GRETL_MOD_NONE,
+                                    &g, GRETL_MOD_NONE);
     errno = 0;
 
     return err;
 }
 
 /* binary probit/logit: form the negative of the analytical
-   Hessian */
+   Hessian, X' diag(h) X
+*/
 
 static int binary_hessian (double *theta, gretl_matrix *H,
                            void *data)
 {
     bin_info *bin = data;
-    double w, p, ndx, xtj;
-    int t, j;
-
-    for (t=0; t<bin->T; t++) {
-        ndx = gretl_vector_get(bin->Xb, t);
-        if (bin->ci == PROBIT) {
-            w = bin->y[t] ? invmills(-ndx) : -invmills(ndx);
-            p = w * (ndx + w);
-        } else {
-            p = logit(ndx);
-            p = p * (1-p);
-        }
-        for (j=0; j<bin->k; j++) {
-            xtj = gretl_matrix_get(bin->X, t, j);
-            gretl_matrix_set(bin->pX, t, j, p * xtj);
+    int T = bin->T;
+    int j;
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(j) if (gretl_use_openmp((guint64) T * bin->k))
+#endif
+    for (j=0; j<bin->k; j++) {
+        const double *xj = bin->X->val + j * T;
+        double *pxj = bin->pX->val + j * T;
+        int t;
+
+        for (t=0; t<T; t++) {
+            pxj[t] = bin->h->val[t] * xj[t];
         }
     }
 
@@ -2788,27 +2972,22 @@ static gretl_matrix *binary_hessian_inverse (bin_info *bin, int *err)
 static gretl_matrix *binary_score_matrix (bin_info *bin, int *err)
 {
     gretl_matrix *G;
-    double w, ndx, xtj;
-    int yt, j, t;
+    int T = bin->T;
+    int j, t;
 
-    G = gretl_matrix_alloc(bin->T, bin->k);
+    G = gretl_matrix_alloc(T, bin->k);
 
     if (G == NULL) {
         *err = E_ALLOC;
         return NULL;
     }
 
-    for (t=0; t<bin->T && !errno; t++) {
-        yt = bin->y[t];
-        ndx = gretl_vector_get(bin->Xb, t);
-        if (bin->ci == PROBIT) {
-            w = yt ? invmills(-ndx) : -invmills(ndx);
-        } else {
-            w = yt - logit(ndx);
-        }
-        for (j=0; j<bin->k; j++) {
-            xtj = gretl_matrix_get(bin->X, t, j);
-            gretl_matrix_set(G, t, j, w * xtj);
+    for (j=0; j<bin->k; j++) {
+        const double *xj = bin->X->val + j * T;
+        double *gj = G->val + j * T;
+
+        for (t=0; t<T; t++) {
+            gj[t] = bin->w->val[t] * xj[t];
         }
     }
 
@@ -3786,51 +3965,54 @@ MODEL logistic_model (const int *list, double lmax,
     return lmod;
 }
 
-static double choose (double n, double k, int *err)
+/* log of the (hypergeometric) probability of a 2 x 2 table with
+   cells a, b (first row) and c, d, given its margins */
+
+static double table_logprob (double a, double b, double c, double d)
 {
-    double c = 1.0;
-    int i;
+    return lgamma(a+b+1) - lgamma(a+1) - lgamma(b+1)
+        + lgamma(c+d+1) - lgamma(c+1) - lgamma(d+1)
+        + lgamma(a+c+1) + lgamma(b+d+1) - lgamma(a+b+c+d+1);
+}
 
-    for (i=0; i<k; i++) {
-        c *= (n - i) / (k - i);
-    }
+/* tolerance for treating the probability of a table as no greater
+   than that of the observed one */
+#define FISHER_RELTOL 1.0e-7
 
-    if (na(c)) {
-        *err = 1;
-    }
+/* once past the mode, tables this much less probable (in logs)
+   than the observed one no longer matter */
+#define FISHER_LOGMIN 50
 
-    return c;
-}
+/* Add the probabilities of the tables reached from the observed one
+   by moving @dir (1 or -1) units into cell a, for as long as the
+   margins permit, to the one-tailed sum @P1 (all tables, if @all is
+   non-zero, else only those no more probable than the observed one)
+   and to the two-tailed sum @P2.
+*/
 
-static double table_prob (double a, double b, double c, double d,
-                          double n, int *err)
+static void fisher_tail (const Xtab *tab, int dir, double lp0,
+                         int all, double *P1, double *P2)
 {
-    double p1, p2, p3, P = NADBL;
-
-    p1 = choose(a+b, a, err);
-    if (!*err) {
-        p2 = choose(c+d, c, err);
-    }
-    if (!*err) {
-        p3 = choose(n, a+c, err);
-    }
-
-    if (!*err) {
-        P = p1 * p2 / p3;
-        if (na(P)) {
-            *err = 1;
-            P = NADBL;
+    double a = tab->f[0][0], b = tab->f[0][1];
+    double c = tab->f[1][0], d = tab->f[1][1];
+    double lpi, lprev = lp0;
+
+    while ((dir < 0 && a > 0 && d > 0) || (dir > 0 && b > 0 && c > 0)) {
+        a += dir; d += dir;
+        b -= dir; c -= dir;
+        lpi = table_logprob(a, b, c, d);
+        if (lpi < lp0 - FISHER_LOGMIN && lpi < lprev) {
+            /* the remaining terms are negligible */
+            break;
+        }
+        if (all || lpi <= lp0 + FISHER_RELTOL) {
+            *P1 += exp(lpi);
         }
+        if (lpi <= lp0 + FISHER_RELTOL) {
+            *P2 += exp(lpi);
+        }
+        lprev = lpi;
     }
-
-#if 0
-    fprintf(stderr, "\ntable_prob: a=%g, b=%g, c=%g, d=%g, n=%g\n",
-            a, b, c, d, n);
-    fprintf(stderr, " p1=%g, p2=%g, p3=%g; P = %g\n",
-            p1, p2, p3, P);
-#endif
-
-    return P;
 }
 
 /**
@@ -3840,84 +4022,46 @@ static double table_prob (double a, double b, double c, double d,
  *
  * Computes and prints to @prn the p-value for Fisher's Exact Test for
  * association between the two variables represented in @tab.
+ * The table probabilities are computed in logs, so there is no
+ * limit on the number of observations; and terms that cannot
+ * affect the result are skipped, so the number of tables visited
+ * is not proportional to the sample size.
  *
  * Returns: 0 on successful completion, error code on error.
  */
 
 int fishers_exact_test (const Xtab *tab, PRN *prn)
 {
-    double a, b, c, d, n, E0;
-    double P0, Pi, PL, PR, P2;
-    int err = 0;
+    double n, E0, lp0;
+    double P0, PL, PR, P2;
 
     if (tab->rows != 2 || tab->cols != 2) {
         return E_DATA;
     }
 
-    if (tab->n > 1000) {
-        /* not worth trying? */
-        return E_DATA;
-    }
-
-    a = tab->f[0][0];
-    b = tab->f[0][1];
-    c = tab->f[1][0];
-    d = tab->f[1][1];
     n = tab->n;
-
-    E0 = (tab->rtotal[0] * tab->ctotal[0]) / n;
+    E0 = (tab->rtotal[0] * (double) tab->ctotal[0]) / n;
 
     /* Probability of the observed table */
-    PL = PR = P2 = P0 = table_prob(a, b, c, d, n, &err);
-
-    if (!err) {
-        while (a > 0 && d > 0) {
-            a -= 1; d -= 1;
-            c += 1; b += 1;
-            Pi = table_prob(a, b, c, d, n, &err);
-            if (err) {
-                break;
-            }
-            if (Pi <= P0 || tab->f[0][0] > E0) {
-                PL += Pi;
-            }
-            if (Pi <= P0) {
-                P2 += Pi;
-            }
-        }
+    lp0 = table_logprob(tab->f[0][0], tab->f[0][1],
+                        tab->f[1][0], tab->f[1][1]);
+    if (!isfinite(lp0)) {
+        return E_NAN;
     }
 
-    if (!err) {
-        a = tab->f[0][0];
-        b = tab->f[0][1];
-        c = tab->f[1][0];
-        d = tab->f[1][1];
-
-        while (c > 0 && b > 0) {
-            c -= 1; b -= 1;
-            a += 1; d += 1;
-            Pi = table_prob(a, b, c, d, n, &err);
-            if (err) {
-                break;
-            }
-            if (Pi <= P0 || tab->f[0][0] < E0) {
-                PR += Pi;
-            }
-            if (Pi <= P0) {
-                P2 += Pi;
-            }
-        }
-    }
+    PL = PR = P2 = P0 = exp(lp0);
 
-    if (!err) {
-        pprintf(prn, "\n%s:\n", _("Fisher's Exact Test"));
-        pprintf(prn, _("  Left:   P-value = %g\n"), PL);
-        pprintf(prn, _("  Right:  P-value = %g\n"), PR);
-        pprintf(prn, _("  2-Tail: P-value = %g\n"), P2);
-        pputc(prn, '\n');
-    }
+    /* tables with smaller a, then larger */
+    fisher_tail(tab, -1, lp0, tab->f[0][0] > E0, &PL, &P2);
+    fisher_tail(tab, 1, lp0, tab->f[0][0] < E0, &PR, &P2);
 
-    return err;
+    pprintf(prn, "\n%s:\n", _("Fisher's Exact Test"));
+    pprintf(prn, _("  Left:   P-value = %g\n"), PL);
+    pprintf(prn, _("  Right:  P-value = %g\n"), PR);
+    pprintf(prn, _("  2-Tail: P-value = %g\n"), P2);
+    pputc(prn, '\n');
+
+    return 0;
 }
 
 /**
@@ -4139,7 +4283,8 @@ static int get_trailing_var (int *list)
  * @list: dependent variable plus list of regressors.
  * @ci: either POISSON or NEGBIN.
  * @dset: dataset struct.
- * @opt: may include OPT_R for robust covariance matrix.
+ * @opt: may include OPT_R for robust covariance matrix, or
+ * (POISSON only) OPT_G to absorb fixed effects.
  * @prn: printing struct for iteration info (or NULL is this is not
  * wanted).
  *
@@ -4162,7 +4307,15 @@ MODEL count_model (const int *list, int ci, DATASET *dset,
 
     gretl_model_init(&cmod, dset);
 
-    if (!gretl_iscount(dset->t1, dset->t2, dset->Z[list[1]])) {
+    if (ci == POISSON && (opt & OPT_G)) {
+        /* PPML: any non-negative dependent variable will do */
+        if (!gretl_ispositive(dset->t1, dset->t2, dset->Z[list[1]], 0)) {
+            gretl_errmsg_sprintf(_("%s: the dependent variable must be non-negative"),
+                                 gretl_command_word(ci));
+            cmod.errcode = E_DATA;
+            return cmod;
+        }
+    } else if (!gretl_iscount(dset->t1, dset->t2, dset->Z[list[1]])) {
         gretl_errmsg_sprintf(_("%s: the dependent variable must be count data"),
                              gretl_command_word(ci));
         cmod.errcode = E_DATA;
@@ -28,6 +28,7 @@
 #include "system.h"
 #include "tsls.h"
 #include "nls.h"
+#include "gretl_mt.h"
 
 #ifdef WIN32
 # include "gretl_win32.h"
@@ -697,6 +698,59 @@ void maybe_shift_ldepvar (MODEL *pmod, DATASET *dset)
     }
 }
 
+/* Number of observations per block in XTX_XTy(): with 8 bytes
+   per value the blocks of a couple of dozen regressors fit into
+   a typical L2 cache. */
+#define XTX_BLOCK 1024
+
+/* transformation of the data applied by XTX_XTy() */
+typedef struct xtx_spec_ {
+    const double *w;   /* weight variable, or NULL */
+    const char *mask;  /* missing obs mask, or NULL */
+    double rho;        /* quasi-differencing coefficient, or 0 */
+    double pw1;        /* Prais-Winsten factor, or 0 */
+    int pwe;           /* use Prais-Winsten for first obs? */
+} xtx_spec;
+
+/* Add to @x the cross-products of (transformed) @a and @b over
+   observations @s to @e, where @t1 is the first observation in
+   the full range, and return the result. */
+
+static double xtx_accum (double x, const double *a, const double *b,
+			 int s, int e, int t1, const xtx_spec *xs)
+{
+    const double rho = xs->rho;
+    int t;
+
+    if (rho != 0.0) {
+	for (t=s; t<=e; t++) {
+	    if (xs->pwe && t == t1) {
+		x += xs->pw1 * a[t] * xs->pw1 * b[t];
+	    } else {
+		x += (a[t] - rho * a[t-1]) * (b[t] - rho * b[t-1]);
+	    }
+	}
+    } else if (xs->w != NULL) {
+	for (t=s; t<=e; t++) {
+	    if (!masked(xs->mask, t)) {
+		x += xs->w[t] * a[t] * b[t];
+	    }
+	}
+    } else if (xs->mask != NULL) {
+	for (t=s; t<=e; t++) {
+	    if (!masked(xs->mask, t)) {
+		x += a[t] * b[t];
+	    }
+	}
+    } else {
+	for (t=s; t<=e; t++) {
+	    x += a[t] * b[t];
+	}
+    }
+
+    return x;
+}
+
 /*
  * XTX_XTy:
  * @list: list of variables in model.
@@ -738,8 +792,9 @@ static int XTX_XTy (const int *list, int t1, int t2,
     const double *w = NULL;
     const double *xi = NULL;
     const double *xj = NULL;
+    xtx_spec xs = {0};
     double x, pw1;
-    int i, j, t, m;
+    int i, j, s, t, m;
     int err = 0;
 
     /* Prais-Winsten term */
@@ -758,6 +813,12 @@ static int XTX_XTy (const int *list, int t1, int t2,
 	w = dset->Z[nwt];
     }
 
+    xs.w = w;
+    xs.mask = mask;
+    xs.rho = rho;
+    xs.pw1 = pw1;
+    xs.pwe = pwe;
+
     if (xpy != NULL) {
 	*ysum = *ypy = 0.0;
 
@@ -785,118 +846,50 @@ static int XTX_XTy (const int *list, int t1, int t2,
 	}
     }
 
-    m = 0;
-
-    if (qdiff) {
-	/* quasi-difference the data */
-	for (i=lmin; i<=lmax; i++) {
-	    xi = dset->Z[list[i]];
-	    for (j=i; j<=lmax; j++) {
-		xj = dset->Z[list[j]];
-		x = 0.0;
-		for (t=t1; t<=t2; t++) {
-		    if (pwe && t == t1) {
-			x += pw1 * xi[t1] * pw1 * xj[t];
-		    } else {
-			x += (xi[t] - rho * xi[t-1]) *
-			    (xj[t] - rho * xj[t-1]);
-		    }
-		}
-		if (i == j && x < DBL_EPSILON)  {
-		    return E_SINGULAR;
-		}
-		xpx[m++] = x;
-	    }
-	    if (xpy != NULL) {
-		x = 0.0;
-		for (t=t1; t<=t2; t++) {
-		    if (pwe && t == t1) {
-			x += pw1 * y[t] * pw1 * xi[t];
-		    } else {
-			x += (y[t] - rho * y[t-1]) *
-			    (xi[t] - rho * xi[t-1]);
-		    }
-		}
-		xpy[i-2] = x;
-	    }
-	}
-    } else if (nwt) {
-	/* weight the data */
+    /* Rather than making a full pass through the data for each
+       element of X'X, we take the observations in blocks small
+       enough for the block of every regressor to stay in cache,
+       accumulating all the cross-products for one block before
+       moving on. So the data are read only once, which matters
+       when the series are paged in from a mapped data file (see
+       "open --mmap") that may be much larger than RAM. Each sum
+       is still formed in observation order, so the results are
+       exactly as before.
+    */
+    m = (lmax - lmin + 1) * (lmax - lmin + 2) / 2;
+    for (i=0; i<m; i++) {
+	xpx[i] = 0.0;
+    }
+    if (xpy != NULL) {
 	for (i=lmin; i<=lmax; i++) {
-	    xi = dset->Z[list[i]];
-	    for (j=i; j<=lmax; j++) {
-		xj = dset->Z[list[j]];
-		x = 0.0;
-		for (t=t1; t<=t2; t++) {
-		    if (!masked(mask, t)) {
-			x += w[t] * xi[t] * xj[t];
-		    }
-		}
-		if (i == j && x < DBL_EPSILON) {
-		    return E_SINGULAR;
-		}
-		xpx[m++] = x;
-	    }
-	    if (xpy != NULL) {
-		x = 0.0;
-		for (t=t1; t<=t2; t++) {
-		    if (!masked(mask, t)) {
-			x += w[t] * y[t] * xi[t];
-		    }
-		}
-		xpy[i-2] = x;
-	    }
+	    xpy[i-2] = 0.0;
 	}
-    } else if (mask != NULL) {
-	/* plain data, but with missing obs mask */
+    }
+
+    for (s=t1; s<=t2; s+=XTX_BLOCK) {
+	int e = MIN(s + XTX_BLOCK - 1, t2);
+
+	m = 0;
 	for (i=lmin; i<=lmax; i++) {
 	    xi = dset->Z[list[i]];
 	    for (j=i; j<=lmax; j++) {
 		xj = dset->Z[list[j]];
-		x = 0.0;
-		for (t=t1; t<=t2; t++) {
-		    if (!masked(mask, t)) {
-			x += xi[t] * xj[t];
-		    }
-		}
-		if (i == j && x < DBL_EPSILON) {
-		    return E_SINGULAR;
-		}
-		xpx[m++] = x;
+		xpx[m] = xtx_accum(xpx[m], xi, xj, s, e, t1, &xs);
+		m++;
 	    }
 	    if (xpy != NULL) {
-		x = 0.0;
-		for (t=t1; t<=t2; t++) {
-		    if (!masked(mask, t)) {
-			x += y[t] * xi[t];
-		    }
-		}
-		xpy[i-2] = x;
+		xpy[i-2] = xtx_accum(xpy[i-2], y, xi, s, e, t1, &xs);
 	    }
 	}
-    } else {
-	/* plain data, no missing obs mask */
-	for (i=lmin; i<=lmax; i++) {
-	    xi = dset->Z[list[i]];
-	    for (j=i; j<=lmax; j++) {
-		xj = dset->Z[list[j]];
-		x = 0.0;
-		for (t=t1; t<=t2; t++) {
-		    x += xi[t] * xj[t];
-		}
-		if (i == j && x < DBL_EPSILON) {
-		    return E_SINGULAR;
-		}
-		xpx[m++] = x;
-	    }
-	    if (xpy != NULL) {
-		x = 0.0;
-		for (t=t1; t<=t2; t++) {
-		    x += y[t] * xi[t];
-		}
-		xpy[i-2] = x;
-	    }
+    }
+
+    /* check the diagonal of X'X */
+    m = 0;
+    for (i=lmin; i<=lmax; i++) {
+	if (xpx[m] < DBL_EPSILON) {
+	    return E_SINGULAR;
 	}
+	m += lmax - i + 1;
     }
 
     return err;
@@ -1080,6 +1073,25 @@ static void model_free_storage (MODEL *pmod)
     pmod->sderr = NULL;
 }
 
+/* When a model is to be replaced by a fresh least-squares estimate,
+   as in the grid search for rho or in a loop, pass on its
+   dataset-length arrays of residuals and fitted values to the new
+   model @targ rather than freeing them and allocating new ones.
+   They're all overwritten in estimation. @prev is then cleared.
+*/
+
+static void recycle_model_arrays (MODEL *targ, MODEL *prev,
+				  const DATASET *dset)
+{
+    if (dset != NULL && prev->full_n == dset->n &&
+	prev->uhat != NULL && prev->yhat != NULL) {
+	targ->uhat = prev->uhat;
+	targ->yhat = prev->yhat;
+	prev->uhat = prev->yhat = NULL;
+    }
+    clear_model(prev);
+}
+
 /*
  * ar1_lsq:
  * @list: model specification.
@@ -1087,17 +1099,19 @@ static void model_free_storage (MODEL *pmod)
  * @ci: command index, e.g. OLS, AR1.
  * @opt: option flags (see lsq and ar1_model).
  * @rho: coefficient for quasi-differencing the data, or 0.
+ * @prev: model to be replaced by the result, or NULL.
  *
  * Nests lsq() and ar1_model(); is also used internally with ci == OLS
  * but rho != 0.0 when estimating rho via, e.g., Cochrane-Orcutt
- * iteration.
+ * iteration. If @prev is non-NULL it is cleared, but its storage
+ * for residuals and fitted values is reused if possible.
  *
  * Returns: model struct containing the estimates.
  */
 
 static MODEL ar1_lsq (const int *list, DATASET *dset,
 		      GretlCmdIndex ci, gretlopt opt,
-		      double rho)
+		      double rho, MODEL *prev)
 {
     MODEL mdl;
     int wtdobs = 0;
@@ -1109,6 +1123,10 @@ static MODEL ar1_lsq (const int *list, DATASET *dset,
 
     gretl_model_init(&mdl, dset);
 
+    if (prev != NULL) {
+	recycle_model_arrays(&mdl, prev, dset);
+    }
+
     if (list == NULL || dset == NULL || dset->Z == NULL) {
 	fprintf(stderr, "E_DATA: lsq: list = %p, dset = %p\n",
 		(void *) list, (void *) dset);
@@ -1399,7 +1417,33 @@ static MODEL ar1_lsq (const int *list, DATASET *dset,
 MODEL lsq (const int *list, DATASET *dset, GretlCmdIndex ci,
 	   gretlopt opt)
 {
-    return ar1_lsq(list, dset, ci, opt, 0.0);
+    return ar1_lsq(list, dset, ci, opt, 0.0, NULL);
+}
+
+/**
+ * lsq_reuse:
+ * @pmod: pointer to model to be replaced.
+ * @list: dependent variable plus list of regressors.
+ * @dset: dataset struct.
+ * @ci: one of the command indices in #LSQ_MODEL.
+ * @opt: option flags (see lsq()).
+ *
+ * Equivalent to clear_model(@pmod) followed by assignment to
+ * @pmod of the result of lsq(), except that the arrays of residuals
+ * and fitted values already attached to @pmod are reused for the
+ * new estimates when they have the right length. This saves
+ * allocating and freeing two dataset-length arrays per model
+ * when the same regression is run many times in a loop.
+ *
+ * Returns: the error code of the new model.
+ */
+
+int lsq_reuse (MODEL *pmod, const int *list, DATASET *dset,
+	       GretlCmdIndex ci, gretlopt opt)
+{
+    *pmod = ar1_lsq(list, dset, ci, opt, 0.0, pmod);
+
+    return pmod->errcode;
 }
 
 /**
@@ -1429,7 +1473,7 @@ MODEL ar1_model (const int *list, DATASET *dset,
 	mdl.errcode = err;
 	return mdl;
     } else {
-	return ar1_lsq(list, dset, AR1, opt, rho);
+	return ar1_lsq(list, dset, AR1, opt, rho, NULL);
     }
 }
 
@@ -2239,9 +2283,7 @@ static double hilu_search (const int *list, DATASET *dset,
     }
 
     for (r = -0.99; r < 1.0; r += .01, iter++) {
-	clear_model(pmod);
-
-	*pmod = ar1_lsq(list, dset, OLS, OPT_A, r);
+	*pmod = ar1_lsq(list, dset, OLS, OPT_A, r, pmod);
 	if (pmod->errcode) {
 	    free(ssr);
 	    return NADBL;
@@ -2267,8 +2309,7 @@ static double hilu_search (const int *list, DATASET *dset,
     if (hl_rho > 0.989) {
 	/* try exploring this funny region? */
 	for (r = 0.99; r <= 0.999; r += .001) {
-	    clear_model(pmod);
-	    *pmod = ar1_lsq(list, dset, OLS, OPT_A, r);
+	    *pmod = ar1_lsq(list, dset, OLS, OPT_A, r, pmod);
 	    if (pmod->errcode) {
 		free(ssr);
 		return NADBL;
@@ -2284,8 +2325,7 @@ static double hilu_search (const int *list, DATASET *dset,
     if (hl_rho > 0.9989) {
 	/* this even funnier one? */
 	for (r = 0.9991; r <= 0.9999; r += .0001) {
-	    clear_model(pmod);
-	    *pmod = ar1_lsq(list, dset, OLS, OPT_A, r);
+	    *pmod = ar1_lsq(list, dset, OLS, OPT_A, r, pmod);
 	    if (pmod->errcode) {
 		free(ssr);
 		return NADBL;
@@ -2410,8 +2450,7 @@ static double estimate_rho (const int *list, DATASET *dset,
 	}
 
 	while (++iter <= itermax && !converged) {
-	    clear_model(&armod);
-	    armod = ar1_lsq(list, dset, OLS, lsqopt, rho);
+	    armod = ar1_lsq(list, dset, OLS, lsqopt, rho, &armod);
 	    if ((*err = armod.errcode)) {
 		break;
 	    }
@@ -2883,8 +2922,7 @@ static int tsls_hetero_test (MODEL *pmod, DATASET *dset,
 {
     int pos, newv = dset->v;
     int *ptlist = NULL, *testlist = NULL;
-    int save_t1 = dset->t1;
-    int save_t2 = dset->t2;
+    dset_checkpoint cp;
     MODEL ptmod;
     double x;
     int i, h, t;
@@ -2911,6 +2949,8 @@ static int tsls_hetero_test (MODEL *pmod, DATASET *dset,
 	ptlist[i] = pmod->list[i + pos - 1];
     }
 
+    dataset_checkpoint_set(dset, &cp);
+
     testlist[1] = newv;
     testlist[2] = 0;
     testlist[3] = newv + 1;
@@ -2990,15 +3030,12 @@ static int tsls_hetero_test (MODEL *pmod, DATASET *dset,
 
     clear_model(&ptmod);
 
-    dataset_drop_last_variables(dset, 2);
-
  bailout:
 
     free(ptlist);
     free(testlist);
 
-    dset->t1 = save_t1;
-    dset->t2 = save_t2;
+    dataset_checkpoint_restore(dset, &cp);
 
     return err;
 }
@@ -3107,6 +3144,246 @@ static int *ensure_const_augment_list (const MODEL *pmod, int aux,
     return list;
 }
 
+#define WHITE_BLOCK_BYTES (1 << 21) /* target size of a block of Z */
+#define WHITE_DROP_TOL 1.0e-10      /* relative pivot for dropping a term */
+
+/* Factorize in place the lower triangle of the m x m matrix @A,
+   after scaling it to unit diagonal, dropping any column whose
+   pivot is negligible (that is, any term which is collinear with
+   those before it), and at the same time solve L w = @b, with @b
+   overwritten by w. The quantity w'w = b'A^{-1}b is unaffected by
+   the scaling. The trailing updates are done in parallel by column.
+   Returns the number of columns retained.
+*/
+
+static int cholesky_drop_solve (gretl_matrix *A, double *b)
+{
+    int m = A->rows;
+    double *a = A->val;
+    double *d0;
+    int i, j, k;
+    int nk = 0;
+
+    d0 = malloc(m * sizeof *d0);
+    if (d0 == NULL) {
+	return -1;
+    }
+
+    for (j=0; j<m; j++) {
+	d0[j] = a[(size_t) j * m + j];
+	d0[j] = (d0[j] > 0)? 1.0 / sqrt(d0[j]) : 0.0;
+    }
+    for (j=0; j<m; j++) {
+	for (i=j; i<m; i++) {
+	    a[(size_t) j * m + i] *= d0[i] * d0[j];
+	}
+	b[j] *= d0[j];
+    }
+
+    for (j=0; j<m; j++) {
+	double *lj = a + (size_t) j * m;
+	double ljj = lj[j];
+
+	if (d0[j] == 0 || ljj <= WHITE_DROP_TOL) {
+	    for (i=j; i<m; i++) {
+		lj[i] = 0.0;
+	    }
+	    b[j] = 0.0;
+	    continue;
+	}
+	nk++;
+	ljj = sqrt(ljj);
+	lj[j] = ljj;
+	for (i=j+1; i<m; i++) {
+	    lj[i] /= ljj;
+	}
+	b[j] /= ljj;
+	for (i=j+1; i<m; i++) {
+	    b[i] -= lj[i] * b[j];
+	}
+#if defined(_OPENMP)
+#pragma omp parallel for private(i) if (gretl_use_openmp((guint64) (m - j) * (m - j)))
+#endif
+	for (k=j+1; k<m; k++) {
+	    double *ak = a + (size_t) k * m;
+	    double lkj = lj[k];
+
+	    if (lkj != 0.0) {
+		for (i=k; i<m; i++) {
+		    ak[i] -= lj[i] * lkj;
+		}
+	    }
+	}
+    }
+
+    free(d0);
+
+    return nk;
+}
+
+/* White's test without adding series to the dataset, for use when
+   the auxiliary regression is not to be printed. The auxiliary
+   regressors (constant, original regressors, squares of the
+   non-dummy ones and, unless @aux is AUX_SQ, cross-products) are
+   formed a block of rows at a time, with the columns filled in
+   parallel, and Z'Z and Z'u^2 accumulated block by block. The terms
+   are in the same order as augment_regression_list() would give,
+   and those which are collinear with earlier ones are dropped in
+   the factorization of Z'Z, as lsq() would drop them. Since the
+   constant is included, TR^2 follows from w'w, where L w = Z'u^2.
+*/
+
+static int whites_test_matrix (const MODEL *pmod, const DATASET *dset,
+			       int aux, double *LM, int *df)
+{
+    gretl_matrix *ZZ = NULL;
+    gretl_matrix *Zb = NULL;
+    gretl_matrix *ub = NULL;
+    gretl_matrix *Zu = NULL;
+    int *ta = NULL, *tb = NULL;
+    int *tt = NULL;
+    int *xl = NULL;
+    double uu = 0.0, usum = 0.0;
+    double ww = 0.0, tss;
+    int p = 0, m, B, T = 0;
+    int i, j, c, r, t;
+    int err = 0;
+
+    xl = malloc(pmod->list[0] * sizeof *xl);
+    if (xl == NULL) {
+	return E_ALLOC;
+    }
+    for (i=2; i<=pmod->list[0]; i++) {
+	if (pmod->list[i] != 0) {
+	    xl[p++] = pmod->list[i];
+	}
+    }
+
+    /* terms: const, levels, then squares and cross-products */
+    m = 1 + p + ((aux == AUX_SQ)? p : p * (p + 1) / 2);
+    ta = malloc(m * sizeof *ta);
+    tb = malloc(m * sizeof *tb);
+    if (ta == NULL || tb == NULL) {
+	err = E_ALLOC;
+	goto bailout;
+    }
+
+    ta[0] = tb[0] = 0;
+    for (i=0, c=1; i<p; i++, c++) {
+	ta[c] = xl[i];
+	tb[c] = 0;
+    }
+    for (i=0; i<p; i++) {
+	if (!gretl_isdummy(dset->t1, dset->t2, dset->Z[xl[i]])) {
+	    ta[c] = tb[c] = xl[i];
+	    c++;
+	}
+	if (aux == AUX_WHITE) {
+	    for (j=i+1; j<p; j++) {
+		ta[c] = xl[i];
+		tb[c++] = xl[j];
+	    }
+	}
+    }
+    m = c;
+
+    B = MAX(WHITE_BLOCK_BYTES / (m * sizeof(double)), 32);
+    B = MIN(B, pmod->nobs);
+    ZZ = gretl_zero_matrix_new(m, m);
+    Zu = gretl_zero_matrix_new(m, 1);
+    Zb = gretl_matrix_alloc(B, m);
+    ub = gretl_matrix_alloc(B, 1);
+    tt = malloc(B * sizeof *tt);
+    if (ZZ == NULL || Zu == NULL || Zb == NULL || ub == NULL || tt == NULL) {
+	err = E_ALLOC;
+	goto bailout;
+    }
+
+    for (t=pmod->t1; t<=pmod->t2 && !err; ) {
+	/* gather the next block of usable observations */
+	for (r=0; r<B && t<=pmod->t2; t++) {
+	    if (!na(pmod->uhat[t])) {
+		double u2 = pmod->uhat[t] * pmod->uhat[t];
+
+		ub->val[r] = u2;
+		uu += u2 * u2;
+		usum += u2;
+		tt[r++] = t;
+	    }
+	}
+	if (r == 0) {
+	    break;
+	}
+	T += r;
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(i) if (gretl_use_openmp((guint64) B * m))
+#endif
+	for (c=0; c<m; c++) {
+	    double *z = Zb->val + (size_t) c * B;
+	    const double *xa = (ta[c] > 0)? dset->Z[ta[c]] : NULL;
+	    const double *xb = (tb[c] > 0)? dset->Z[tb[c]] : NULL;
+
+	    for (i=0; i<r; i++) {
+		z[i] = (xa == NULL)? 1.0 : xa[tt[i]];
+		if (xb != NULL) {
+		    z[i] *= xb[tt[i]];
+		}
+	    }
+	    for (i=r; i<B; i++) {
+		z[i] = 0.0;
+	    }
+	}
+	for (i=r; i<B; i++) {
+	    ub->val[i] = 0.0;
+	}
+
+	err = gretl_matrix_multiply_mod(Zb, GRETL_MOD_TRANSPOSE,
+					Zb, GRETL_MOD_NONE,
+					ZZ, GRETL_MOD_CUMULATE);
+	if (!err) {
+	    err = gretl_matrix_multiply_mod(Zb, GRETL_MOD_TRANSPOSE,
+					    ub, GRETL_MOD_NONE,
+					    Zu, GRETL_MOD_CUMULATE);
+	}
+    }
+
+    if (!err) {
+	int nk = cholesky_drop_solve(ZZ, Zu->val);
+
+	if (nk < 0) {
+	    err = E_ALLOC;
+	} else if (nk >= T) {
+	    err = E_DF;
+	} else {
+	    for (c=0; c<m; c++) {
+		ww += Zu->val[c] * Zu->val[c];
+	    }
+	    /* R^2 = 1 - SSR/TSS, with SSR = u'u - w'w */
+	    tss = uu - usum * usum / T;
+	    if (tss <= 0) {
+		err = E_DATA;
+	    } else {
+		*LM = T * (1.0 - (uu - ww) / tss);
+		*df = nk - 1;
+	    }
+	}
+    }
+
+ bailout:
+
+    gretl_matrix_free(ZZ);
+    gretl_matrix_free(Zu);
+    gretl_matrix_free(Zb);
+    gretl_matrix_free(ub);
+    free(ta);
+    free(tb);
+    free(tt);
+    free(xl);
+
+    return err;
+}
+
 /**
  * whites_test:
  * @pmod: pointer to model.
@@ -3129,11 +3406,11 @@ int whites_test (MODEL *pmod, DATASET *dset,
     int aux = AUX_NONE;
     int v = dset->v;
     int *list = NULL;
-    int save_t1 = dset->t1;
-    int save_t2 = dset->t2;
+    dset_checkpoint cp;
     double zz, LM = 0;
     MODEL white;
-    int t, err = 0;
+    int t, df = 0;
+    int err = 0;
 
     if (pmod->ci == IVREG) {
 	return tsls_hetero_test(pmod, dset, opt, prn);
@@ -3153,6 +3430,7 @@ int whites_test (MODEL *pmod, DATASET *dset,
 	return err;
     }
 
+    dataset_checkpoint_set(dset, &cp);
     impose_model_smpl(pmod, dset);
 
     /* what can we do, with the degrees of freedom available? */
@@ -3162,8 +3440,7 @@ int whites_test (MODEL *pmod, DATASET *dset,
 	} else {
 	    aux = get_whites_aux(pmod, (const double **) dset->Z);
 	    if (aux == AUX_NONE) {
-		dset->t1 = save_t1;
-		dset->t2 = save_t2;
+		dataset_checkpoint_restore(dset, &cp);
 		return E_DF;
 	    }
 	}
@@ -3171,6 +3448,13 @@ int whites_test (MODEL *pmod, DATASET *dset,
 
     gretl_model_init(&white, dset);
 
+    if (!BP && (opt & (OPT_Q | OPT_I))) {
+	/* the auxiliary regression won't be shown: we can skip
+	   generating its regressors as series */
+	err = whites_test_matrix(pmod, dset, aux, &LM, &df);
+	goto report;
+    }
+
     /* make space in data set */
     if (dataset_add_series(dset, 1)) {
 	err = E_ALLOC;
@@ -3215,10 +3499,12 @@ int whites_test (MODEL *pmod, DATASET *dset,
 		white.aux = AUX_WHITE;
 	    }
 	}
+	df = white.ncoeff - 1;
     }
 
+ report:
+
     if (!err) {
-	int df = white.ncoeff - 1;
 	double pval = chisq_cdf_comp(df, LM);
 	gretlopt testopt = OPT_NONE;
 
@@ -3259,12 +3545,9 @@ int whites_test (MODEL *pmod, DATASET *dset,
     }
 
     clear_model(&white);
-    dataset_drop_last_variables(dset, dset->v - v);
+    dataset_checkpoint_restore(dset, &cp);
     free(list);
 
-    dset->t1 = save_t1;
-    dset->t2 = save_t2;
-
     return err;
 }
 
@@ -4386,6 +4669,9 @@ static int check_panel_options (gretlopt opt)
     } else if (incompatible_options(opt, OPT_B | OPT_U | OPT_P)) {
 	/* mutually exclusive estimator requests */
 	return E_BADOPT;
+    } else if ((opt & OPT_G) && (opt & (OPT_B | OPT_U | OPT_P | OPT_H))) {
+	/* absorbing extra effects requires fixed effects */
+	return E_BADOPT;
     } else if (opt & OPT_J) {
 	/* jackknife option not OK for panel data, at present */
 	gretl_errmsg_set("The --jackknife option is not supported for panel data");
@@ -4542,3 +4828,910 @@ int anova (const int *list, const DATASET *dset,
 
     return (*gretl_anova)(list, dset, opt, prn);
 }
+
+/* Transcribe from @dset into @X the series in @list, skipping the
+   observations flagged in @skip, which has length @n = t2 - t1 + 1.
+*/
+
+static void batch_transcribe (gretl_matrix *X, const int *list,
+			      const char *skip, const DATASET *dset)
+{
+    int i, s, t;
+
+    for (i=0; i<list[0]; i++) {
+	const double *x = dset->Z[list[i+1]];
+
+	for (t=dset->t1, s=0; t<=dset->t2; t++) {
+	    if (!skip[t - dset->t1]) {
+		gretl_matrix_set(X, s++, i, x[t]);
+	    }
+	}
+    }
+}
+
+static char **batch_names (const int *list, const DATASET *dset,
+			   int *err)
+{
+    char **S = strings_array_new(list[0]);
+    int i;
+
+    if (S == NULL) {
+	*err = E_ALLOC;
+    } else {
+	for (i=0; i<list[0] && !*err; i++) {
+	    S[i] = gretl_strdup(dset->varname[list[i+1]]);
+	    if (S[i] == NULL) {
+		*err = E_ALLOC;
+	    }
+	}
+    }
+
+    return S;
+}
+
+/* Fill column @j of the statistics matrices, given the coefficients
+   in @b (of which the @kj selected ones are indexed by @sel), the
+   diagonal of (X'X)^{-1} in @d, and the sums of squares.
+*/
+
+static void batch_fill (gretl_matrix *B, gretl_matrix *SE,
+			gretl_matrix *stats, int j,
+			const double *b, const double *d,
+			const int *sel, int kj, int T,
+			double ssr, double tss)
+{
+    double s2 = ssr / (T - kj);
+    int i, r;
+
+    for (i=0; i<kj; i++) {
+	r = (sel == NULL)? i : sel[i];
+	gretl_matrix_set(B, r, j, b[i]);
+	gretl_matrix_set(SE, r, j, sqrt(s2 * d[i]));
+    }
+    gretl_matrix_set(stats, 0, j, 1.0 - ssr / tss);
+    gretl_matrix_set(stats, 1, j, ssr);
+    gretl_matrix_set(stats, 2, j, sqrt(s2));
+    gretl_matrix_set(stats, 3, j, T - kj);
+}
+
+/* All equations share the regressor set: factorize X'X once and
+   solve for all the columns of X'Y together. If @cols is non-NULL
+   it gives, for each column of @Y, the column of the output
+   matrices to be filled.
+*/
+
+static int batch_shared (const gretl_matrix *X, const gretl_matrix *Y,
+			 const int *cols, gretl_matrix *B,
+			 gretl_matrix *SE, gretl_matrix *stats,
+			 const double *tss)
+{
+    gretl_matrix_block *MB;
+    gretl_matrix *XTX, *XXi, *Bj, *E;
+    int T = X->rows, k = X->cols, m = Y->cols;
+    double *d = NULL;
+    int i, j, t;
+    int err = 0;
+
+    MB = gretl_matrix_block_new(&XTX, k, k, &XXi, k, k,
+				&Bj, k, m, &E, T, m, NULL);
+    d = malloc(k * sizeof *d);
+    if (MB == NULL || d == NULL) {
+	gretl_matrix_block_destroy(MB);
+	free(d);
+	return E_ALLOC;
+    }
+
+    gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+			      X, GRETL_MOD_NONE,
+			      XTX, GRETL_MOD_NONE);
+    gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+			      Y, GRETL_MOD_NONE,
+			      Bj, GRETL_MOD_NONE);
+    err = gretl_cholesky_decomp_solve(XTX, Bj);
+    if (!err) {
+	err = gretl_inverse_from_cholesky_decomp(XXi, XTX);
+    }
+
+    if (!err) {
+	/* residuals for all equations at once: E = Y - XB */
+	gretl_matrix_copy_values(E, Y);
+	gretl_matrix_multiply_mod(X, GRETL_MOD_NONE,
+				  Bj, GRETL_MOD_NONE,
+				  E, GRETL_MOD_DECREMENT);
+	for (i=0; i<k; i++) {
+	    d[i] = gretl_matrix_get(XXi, i, i);
+	}
+	for (j=0; j<m; j++) {
+	    const double *e = E->val + (size_t) j * T;
+	    double ssr = 0.0;
+
+	    for (t=0; t<T; t++) {
+		ssr += e[t] * e[t];
+	    }
+	    batch_fill(B, SE, stats, cols == NULL ? j : cols[j],
+		       Bj->val + (size_t) j * k, d, NULL, k, T, ssr,
+		       tss[j]);
+	}
+    }
+
+    gretl_matrix_block_destroy(MB);
+    free(d);
+
+    return err;
+}
+
+/* A single dependent variable and many subsets of the regressors,
+   per the rows of @S: each model is solved from the relevant
+   sub-blocks of the full cross-products, and the models are handled
+   in parallel. A model whose regressors are collinear gets NAs.
+*/
+
+static int batch_subsets (const gretl_matrix *X, const gretl_matrix *y,
+			  const gretl_matrix *S, gretl_matrix *B,
+			  gretl_matrix *SE, gretl_matrix *stats,
+			  double tss)
+{
+    gretl_matrix *XTX, *XTy;
+    int T = X->rows, k = X->cols, m = S->rows;
+    double yy = 0.0;
+    int j, t;
+    int err = 0;
+
+    XTX = gretl_matrix_alloc(k, k);
+    XTy = gretl_matrix_alloc(k, 1);
+    if (XTX == NULL || XTy == NULL) {
+	err = E_ALLOC;
+	goto bailout;
+    }
+
+    gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+			      X, GRETL_MOD_NONE,
+			      XTX, GRETL_MOD_NONE);
+    gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+			      y, GRETL_MOD_NONE,
+			      XTy, GRETL_MOD_NONE);
+    for (t=0; t<T; t++) {
+	yy += y->val[t] * y->val[t];
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (m > 1 && gretl_use_openmp((guint64) m * k * k * k))
+#endif
+    for (j=0; j<m; j++) {
+	gretl_matrix *A = NULL, *b = NULL, *Ai = NULL;
+	double *d = NULL;
+	int *sel = NULL;
+	double ssr;
+	int i, l, kj = 0;
+	int jerr = 0;
+
+	for (i=0; i<k; i++) {
+	    if (gretl_matrix_get(S, j, i) != 0) {
+		kj++;
+	    }
+	}
+	if (kj == 0 || kj >= T) {
+	    continue;
+	}
+	sel = malloc(kj * sizeof *sel);
+	d = malloc(kj * sizeof *d);
+	A = gretl_matrix_alloc(kj, kj);
+	Ai = gretl_matrix_alloc(kj, kj);
+	b = gretl_matrix_alloc(kj, 1);
+	if (sel == NULL || d == NULL || A == NULL || Ai == NULL || b == NULL) {
+	    jerr = E_ALLOC;
+	} else {
+	    for (i=0, l=0; i<k; i++) {
+		if (gretl_matrix_get(S, j, i) != 0) {
+		    sel[l++] = i;
+		}
+	    }
+	    for (i=0; i<kj; i++) {
+		for (l=0; l<kj; l++) {
+		    gretl_matrix_set(A, i, l, gretl_matrix_get(XTX, sel[i], sel[l]));
+		}
+		b->val[i] = XTy->val[sel[i]];
+	    }
+	    if (gretl_cholesky_decomp_solve(A, b) == 0 &&
+		gretl_inverse_from_cholesky_decomp(Ai, A) == 0) {
+		ssr = yy;
+		for (i=0; i<kj; i++) {
+		    ssr -= b->val[i] * XTy->val[sel[i]];
+		    d[i] = gretl_matrix_get(Ai, i, i);
+		}
+		batch_fill(B, SE, stats, j, b->val, d, sel, kj, T,
+			   ssr < 0 ? 0 : ssr, tss);
+	    }
+	}
+	if (jerr) {
+#if defined(_OPENMP)
+#pragma omp critical (batch_err)
+#endif
+	    err = jerr;
+	}
+	free(sel);
+	free(d);
+	gretl_matrix_free(A);
+	gretl_matrix_free(Ai);
+	gretl_matrix_free(b);
+    }
+
+ bailout:
+
+    gretl_matrix_free(XTX);
+    gretl_matrix_free(XTy);
+
+    return err;
+}
+
+/* Equations whose dependent variable is missing at some of the
+   observations in @X, each to be estimated on its own sample, as
+   indexed by @cols. We form X'X once; for each equation we then
+   either subtract the contributions of its missing observations
+   or, if these are the majority, accumulate its valid ones. The
+   equations are handled in parallel. An equation with too few
+   observations, or with collinear regressors on its sample, gets
+   NAs. The number of observations used is written into @Tv.
+*/
+
+static int batch_ragged (const gretl_matrix *X, const gretl_matrix *Y,
+			 const int *cols, int nc, int ifc,
+			 gretl_matrix *B, gretl_matrix *SE,
+			 gretl_matrix *stats, double *Tv)
+{
+    gretl_matrix *XTX;
+    int T = X->rows, k = X->cols;
+    int c;
+    int err = 0;
+
+    XTX = gretl_matrix_alloc(k, k);
+    if (XTX == NULL) {
+	return E_ALLOC;
+    }
+
+    gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+			      X, GRETL_MOD_NONE,
+			      XTX, GRETL_MOD_NONE);
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (nc > 1 && gretl_use_openmp((guint64) nc * T * k * k))
+#endif
+    for (c=0; c<nc; c++) {
+	int j = cols[c];
+	const double *y = Y->val + (size_t) j * T;
+	gretl_matrix *A = NULL, *b = NULL, *Ai = NULL;
+	double *d = NULL;
+	double ybar = 0.0, ssr = 0.0, tss = 0.0;
+	double xti, e;
+	int i, l, t, Tj = 0;
+	int jerr = 0;
+
+	for (t=0; t<T; t++) {
+	    if (!na(y[t])) {
+		ybar += y[t];
+		Tj++;
+	    }
+	}
+	Tv[j] = Tj;
+	if (Tj <= k) {
+	    continue;
+	}
+	ybar = ifc ? ybar / Tj : 0.0;
+
+	A = gretl_matrix_alloc(k, k);
+	Ai = gretl_matrix_alloc(k, k);
+	b = gretl_zero_matrix_new(k, 1);
+	d = malloc(k * sizeof *d);
+	if (A == NULL || Ai == NULL || b == NULL || d == NULL) {
+	    jerr = E_ALLOC;
+	    goto next;
+	}
+
+	if (2 * Tj >= T) {
+	    /* downdate the full cross-products */
+	    gretl_matrix_copy_values(A, XTX);
+	} else {
+	    gretl_matrix_zero(A);
+	}
+	for (t=0; t<T; t++) {
+	    if (na(y[t]) == (2 * Tj >= T)) {
+		double sgn = na(y[t]) ? -1.0 : 1.0;
+
+		for (i=0; i<k; i++) {
+		    xti = sgn * gretl_matrix_get(X, t, i);
+		    for (l=0; l<=i; l++) {
+			A->val[i + l * k] += xti * gretl_matrix_get(X, t, l);
+		    }
+		}
+	    }
+	    if (!na(y[t])) {
+		for (i=0; i<k; i++) {
+		    b->val[i] += gretl_matrix_get(X, t, i) * y[t];
+		}
+		tss += (y[t] - ybar) * (y[t] - ybar);
+	    }
+	}
+	for (i=0; i<k; i++) {
+	    for (l=0; l<i; l++) {
+		A->val[l + i * k] = A->val[i + l * k];
+	    }
+	}
+
+	if (gretl_cholesky_decomp_solve(A, b) == 0 &&
+	    gretl_inverse_from_cholesky_decomp(Ai, A) == 0) {
+	    for (t=0; t<T; t++) {
+		if (!na(y[t])) {
+		    e = y[t];
+		    for (i=0; i<k; i++) {
+			e -= gretl_matrix_get(X, t, i) * b->val[i];
+		    }
+		    ssr += e * e;
+		}
+	    }
+	    for (i=0; i<k; i++) {
+		d[i] = gretl_matrix_get(Ai, i, i);
+	    }
+	    batch_fill(B, SE, stats, j, b->val, d, NULL, k, Tj, ssr, tss);
+	}
+
+    next:
+
+	if (jerr) {
+#if defined(_OPENMP)
+#pragma omp critical (batch_err)
+#endif
+	    err = jerr;
+	}
+	free(d);
+	gretl_matrix_free(A);
+	gretl_matrix_free(Ai);
+	gretl_matrix_free(b);
+    }
+
+    gretl_matrix_free(XTX);
+
+    return err;
+}
+
+/* Estimation of each equation on its own sample: the observations
+   at which the regressors are all valid, less those at which its
+   own dependent variable is missing. Equations whose dependent
+   variable is complete on the regressors' sample are handled
+   together, as in the default case.
+*/
+
+static int batch_each (const gretl_matrix *X, const gretl_matrix *Y,
+		       int ifc, gretl_matrix *B, gretl_matrix *SE,
+		       gretl_matrix *stats, double *Tv)
+{
+    gretl_matrix *Yc = NULL;
+    double *tss = NULL;
+    int *full, *ragged;
+    int T = X->rows, m = Y->cols;
+    int nf = 0, nr = 0;
+    int j, t, err = 0;
+
+    full = malloc(m * sizeof *full);
+    ragged = malloc(m * sizeof *ragged);
+    if (full == NULL || ragged == NULL) {
+	err = E_ALLOC;
+	goto bailout;
+    }
+
+    for (j=0; j<m; j++) {
+	const double *y = Y->val + (size_t) j * T;
+
+	for (t=0; t<T; t++) {
+	    if (na(y[t])) {
+		break;
+	    }
+	}
+	if (t < T) {
+	    ragged[nr++] = j;
+	} else {
+	    full[nf++] = j;
+	    Tv[j] = T;
+	}
+    }
+
+    if (nf > 0 && T > X->cols) {
+	Yc = gretl_matrix_alloc(T, nf);
+	tss = malloc(nf * sizeof *tss);
+	if (Yc == NULL || tss == NULL) {
+	    err = E_ALLOC;
+	    goto bailout;
+	}
+	for (j=0; j<nf; j++) {
+	    const double *y = Y->val + (size_t) full[j] * T;
+	    double ybar = 0.0;
+
+	    memcpy(Yc->val + (size_t) j * T, y, T * sizeof *y);
+	    if (ifc) {
+		for (t=0; t<T; t++) {
+		    ybar += y[t];
+		}
+		ybar /= T;
+	    }
+	    tss[j] = 0.0;
+	    for (t=0; t<T; t++) {
+		tss[j] += (y[t] - ybar) * (y[t] - ybar);
+	    }
+	}
+	err = batch_shared(X, Yc, full, B, SE, stats, tss);
+    }
+
+    if (!err && nr > 0) {
+	err = batch_ragged(X, Y, ragged, nr, ifc, B, SE, stats, Tv);
+    }
+
+ bailout:
+
+    gretl_matrix_free(Yc);
+    free(tss);
+    free(full);
+    free(ragged);
+
+    return err;
+}
+
+/**
+ * batch_ols:
+ * @ylist: list of dependent variables.
+ * @xlist: list of regressors.
+ * @S: optional matrix with one row per model and a column for each
+ * member of @xlist, non-zero entries selecting the regressors to
+ * include; or NULL. If given, @ylist must hold a single series.
+ * @each: if non-zero, estimate each equation on its own sample
+ * (not compatible with @S).
+ * @dset: dataset struct.
+ * @err: location to receive error code.
+ *
+ * Estimates by OLS a batch of equations, either each of the series
+ * in @ylist on all of @xlist, or the single series in @ylist on
+ * each of the subsets of @xlist selected by the rows of @S. The
+ * sample is the current one, less any observations at which any of
+ * the series involved is missing; or if @each is non-zero, less
+ * any observations at which a regressor or the equation's own
+ * dependent variable is missing. The design matrix is set up just
+ * once, and no #MODEL is created.
+ *
+ * Returns: a bundle holding k x m matrices "coeff" and "stderr",
+ * with NAs for regressors not included, and 1 x m vectors "rsq",
+ * "ssr", "sigma" and "df", where k is the number of regressors and
+ * m the number of models; plus the number of observations, "T",
+ * which is a 1 x m vector if @each is non-zero.
+ */
+
+gretl_bundle *batch_ols (const int *ylist, const int *xlist,
+			 const gretl_matrix *S, int each,
+			 const DATASET *dset, int *err)
+{
+    gretl_bundle *ret = NULL;
+    gretl_matrix *X = NULL, *Y = NULL;
+    gretl_matrix *B = NULL, *SE = NULL;
+    gretl_matrix *stats = NULL;
+    gretl_matrix *Tv = NULL;
+    double *tss = NULL;
+    char *skip = NULL;
+    int n = sample_size(dset);
+    int k = xlist[0];
+    int i, j, t, T = 0;
+    int m, ifc;
+
+    if (ylist[0] == 0 || k == 0) {
+	*err = E_ARGS;
+	return NULL;
+    } else if (S != NULL && each) {
+	*err = E_BADOPT;
+	return NULL;
+    } else if (S != NULL && (ylist[0] > 1 || S->cols != k)) {
+	*err = E_NONCONF;
+	return NULL;
+    }
+
+    m = (S != NULL)? S->rows : ylist[0];
+    ifc = in_gretl_list(xlist, 0);
+
+    /* listwise deletion of missing values */
+    skip = calloc(n, 1);
+    if (skip == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+    for (t=dset->t1; t<=dset->t2; t++) {
+	for (i=1; i<=ylist[0] && !each && !skip[t - dset->t1]; i++) {
+	    skip[t - dset->t1] = na(dset->Z[ylist[i]][t]);
+	}
+	for (i=1; i<=k && !skip[t - dset->t1]; i++) {
+	    skip[t - dset->t1] = na(dset->Z[xlist[i]][t]);
+	}
+	T += !skip[t - dset->t1];
+    }
+
+    if (T <= k && S == NULL) {
+	*err = E_DF;
+	goto bailout;
+    }
+
+    X = gretl_matrix_alloc(T, k);
+    Y = gretl_matrix_alloc(T, ylist[0]);
+    B = gretl_matrix_alloc(k, m);
+    SE = gretl_matrix_alloc(k, m);
+    stats = gretl_matrix_alloc(4, m);
+    tss = malloc(ylist[0] * sizeof *tss);
+
+    if (each) {
+	Tv = gretl_zero_matrix_new(1, m);
+    }
+
+    if (X == NULL || Y == NULL || B == NULL || SE == NULL ||
+	stats == NULL || tss == NULL || (each && Tv == NULL)) {
+	*err = E_ALLOC;
+	goto bailout;
+    }
+
+    batch_transcribe(X, xlist, skip, dset);
+    batch_transcribe(Y, ylist, skip, dset);
+    gretl_matrix_fill(B, NADBL);
+    gretl_matrix_fill(SE, NADBL);
+    gretl_matrix_fill(stats, NADBL);
+
+    for (j=0; j<ylist[0] && !each; j++) {
+	const double *y = Y->val + (size_t) j * T;
+	double ybar = 0.0;
+
+	if (ifc) {
+	    for (t=0; t<T; t++) {
+		ybar += y[t];
+	    }
+	    ybar /= T;
+	}
+	tss[j] = 0.0;
+	for (t=0; t<T; t++) {
+	    tss[j] += (y[t] - ybar) * (y[t] - ybar);
+	}
+    }
+
+    if (S != NULL) {
+	/* a centered R-squared only if the constant is selected */
+	*err = batch_subsets(X, Y, S, B, SE, stats, tss[0]);
+	if (!*err && ifc) {
+	    int c = ifc - 1;
+	    double yy = 0.0;
+
+	    for (t=0; t<T; t++) {
+		yy += Y->val[t] * Y->val[t];
+	    }
+	    for (j=0; j<m; j++) {
+		if (gretl_matrix_get(S, j, c) == 0 &&
+		    !na(gretl_matrix_get(stats, 0, j))) {
+		    gretl_matrix_set(stats, 0, j,
+				     1.0 - gretl_matrix_get(stats, 1, j) / yy);
+		}
+	    }
+	}
+    } else if (each) {
+	*err = batch_each(X, Y, ifc, B, SE, stats, Tv->val);
+    } else {
+	*err = batch_shared(X, Y, NULL, B, SE, stats, tss);
+    }
+
+    if (!*err) {
+	char **rn = batch_names(xlist, dset, err);
+
+	if (!*err) {
+	    gretl_matrix_set_rownames(B, rn);
+	    rn = batch_names(xlist, dset, err);
+	    if (!*err) {
+		gretl_matrix_set_rownames(SE, rn);
+	    }
+	}
+	if (!*err && S == NULL) {
+	    char **cn = batch_names(ylist, dset, err);
+
+	    if (!*err) {
+		gretl_matrix_set_colnames(B, cn);
+	    }
+	}
+    }
+
+    if (!*err) {
+	ret = gretl_bundle_new();
+	if (ret == NULL) {
+	    *err = E_ALLOC;
+	}
+    }
+
+    if (!*err) {
+	gretl_matrix *v;
+	const char *keys[] = {"rsq", "ssr", "sigma", "df"};
+
+	gretl_bundle_donate_data(ret, "coeff", B, GRETL_TYPE_MATRIX, 0);
+	gretl_bundle_donate_data(ret, "stderr", SE, GRETL_TYPE_MATRIX, 0);
+	B = SE = NULL;
+	for (i=0; i<4 && !*err; i++) {
+	    v = gretl_matrix_alloc(1, m);
+	    if (v == NULL) {
+		*err = E_ALLOC;
+	    } else {
+		for (j=0; j<m; j++) {
+		    v->val[j] = gretl_matrix_get(stats, i, j);
+		}
+		gretl_bundle_donate_data(ret, keys[i], v, GRETL_TYPE_MATRIX, 0);
+	    }
+	}
+	if (each) {
+	    gretl_bundle_donate_data(ret, "T", Tv, GRETL_TYPE_MATRIX, 0);
+	    Tv = NULL;
+	} else {
+	    gretl_bundle_set_scalar(ret, "T", T);
+	}
+    }
+
+ bailout:
+
+    gretl_matrix_free(X);
+    gretl_matrix_free(Y);
+    gretl_matrix_free(B);
+    gretl_matrix_free(SE);
+    gretl_matrix_free(stats);
+    gretl_matrix_free(Tv);
+    free(tss);
+    free(skip);
+
+    if (*err && ret != NULL) {
+	gretl_bundle_destroy(ret);
+	ret = NULL;
+    }
+
+    return ret;
+}
+
+#define ROLL_RCOND_MIN 1.0e-6
+
+/* Recompute from scratch, for rows @s0 to @s1 of @X and @y, the
+   cross-products X'y and y'y and the Cholesky factor of X'X,
+   which is written into @L.
+*/
+
+static int roll_refresh (const gretl_matrix *X, const double *y,
+			 int s0, int s1, gretl_matrix *L,
+			 double *Xy, double *yy)
+{
+    int k = X->cols;
+    int i, j, t;
+
+    gretl_matrix_zero(L);
+    for (i=0; i<k; i++) {
+	const double *xi = X->val + (size_t) i * X->rows;
+
+	Xy[i] = 0.0;
+	for (t=s0; t<=s1; t++) {
+	    Xy[i] += xi[t] * y[t];
+	}
+	for (j=i; j<k; j++) {
+	    const double *xj = X->val + (size_t) j * X->rows;
+	    double xx = 0.0;
+
+	    for (t=s0; t<=s1; t++) {
+		xx += xi[t] * xj[t];
+	    }
+	    gretl_matrix_set(L, j, i, xx);
+	}
+    }
+    *yy = 0.0;
+    for (t=s0; t<=s1; t++) {
+	*yy += y[t] * y[t];
+    }
+
+    return gretl_matrix_cholesky_decomp(L);
+}
+
+/* Add row @t of @X and @y to the factor and cross-products, or
+   remove it if @drop is non-zero.
+*/
+
+static int roll_update (const gretl_matrix *X, const double *y,
+			int t, int drop, gretl_matrix *L,
+			gretl_matrix *xt, double *Xy, double *yy)
+{
+    double s = drop ? -1.0 : 1.0;
+    int i, err;
+
+    for (i=0; i<X->cols; i++) {
+	xt->val[i] = gretl_matrix_get(X, t, i);
+    }
+    err = gretl_cholesky_update(L, xt, drop);
+    if (!err) {
+	for (i=0; i<X->cols; i++) {
+	    Xy[i] += s * xt->val[i] * y[t];
+	}
+	*yy += s * y[t] * y[t];
+    }
+
+    return err;
+}
+
+/**
+ * rolling_ols:
+ * @y: dependent variable.
+ * @xlist: list of regressors.
+ * @w: window length, which must exceed the number of regressors.
+ * @recursive: if non-zero, the windows all start at the beginning
+ * of the sample and grow by one observation at a time; otherwise
+ * they are of fixed length @w.
+ * @dset: dataset struct.
+ * @err: location to receive error code.
+ *
+ * Estimates by OLS the regression of @y on @xlist over a sequence
+ * of windows, the first comprising the first @w observations in
+ * the current sample and each subsequent one moving its end point
+ * forward by one observation. Rather than re-estimating from
+ * scratch, the Cholesky factor of X'X is carried from window to
+ * window via rank-one updates (and downdates, for fixed-length
+ * windows), so the cost per window is O(k^2) in the number of
+ * regressors k. To stop rounding error accumulating through the
+ * downdates the factor is recomputed from the data every @w
+ * windows, and whenever an update fails or leaves it badly
+ * conditioned. Missing values are not allowed within the sample
+ * range.
+ *
+ * Returns: a bundle holding m x k matrices "coeff" and "stderr",
+ * an m-vector "sigma" and an m-vector "obs" giving the 1-based
+ * index of the last observation in each window, where m is the
+ * number of windows. Windows in which the regressors are collinear
+ * get NAs.
+ */
+
+gretl_bundle *rolling_ols (const double *y, const int *xlist,
+			   int w, int recursive,
+			   const DATASET *dset, int *err)
+{
+    gretl_bundle *ret = NULL;
+    gretl_matrix_block *MB = NULL;
+    gretl_matrix *X, *L, *Li, *b, *xt;
+    gretl_matrix *B = NULL, *SE = NULL;
+    gretl_matrix *sig = NULL, *obs = NULL;
+    double *Xy = NULL;
+    double yy = 0.0;
+    int T = sample_size(dset);
+    int k = xlist[0];
+    int i, j, t, m;
+    int valid = 0;
+
+    if (k == 0) {
+	*err = E_ARGS;
+	return NULL;
+    } else if (w > T) {
+	*err = E_INVARG;
+	return NULL;
+    } else if (w <= k) {
+	*err = E_DF;
+	return NULL;
+    }
+
+    for (t=dset->t1; t<=dset->t2 && !*err; t++) {
+	if (na(y[t])) {
+	    *err = E_MISSDATA;
+	}
+	for (i=1; i<=k && !*err; i++) {
+	    if (na(dset->Z[xlist[i]][t])) {
+		*err = E_MISSDATA;
+	    }
+	}
+    }
+    if (*err) {
+	return NULL;
+    }
+
+    m = T - w + 1;
+    MB = gretl_matrix_block_new(&X, T, k, &L, k, k, &Li, k, k,
+				&b, k, 1, &xt, 1, k, NULL);
+    Xy = malloc(k * sizeof *Xy);
+    B = gretl_matrix_alloc(m, k);
+    SE = gretl_matrix_alloc(m, k);
+    sig = gretl_matrix_alloc(m, 1);
+    obs = gretl_matrix_alloc(m, 1);
+
+    if (MB == NULL || Xy == NULL || B == NULL || SE == NULL ||
+	sig == NULL || obs == NULL) {
+	*err = E_ALLOC;
+	goto bailout;
+    }
+
+    for (i=0; i<k; i++) {
+	const double *x = dset->Z[xlist[i+1]] + dset->t1;
+
+	memcpy(X->val + (size_t) i * T, x, T * sizeof *x);
+    }
+    y += dset->t1;
+
+    for (j=0; j<m; j++) {
+	int s0 = recursive ? 0 : j;
+	int s1 = w - 1 + j;
+	double ssr, s2;
+
+	if (valid && (recursive || j % w != 0)) {
+	    /* try moving the factor on from the last window */
+	    valid = roll_update(X, y, s1, 0, L, xt, Xy, &yy) == 0;
+	    if (valid && !recursive) {
+		valid = roll_update(X, y, s0 - 1, 1, L, xt, Xy, &yy) == 0;
+	    }
+	    if (valid) {
+		valid = gretl_triangular_matrix_rcond(L, 'L', 'N') >= ROLL_RCOND_MIN;
+	    }
+	}
+	if (!valid) {
+	    valid = roll_refresh(X, y, s0, s1, L, Xy, &yy) == 0 &&
+		gretl_triangular_matrix_rcond(L, 'L', 'N') >= ROLL_RCOND_MIN;
+	}
+
+	obs->val[j] = dset->t1 + s1 + 1;
+	if (!valid) {
+	    /* collinear regressors in this window */
+	    for (i=0; i<k; i++) {
+		gretl_matrix_set(B, j, i, NADBL);
+		gretl_matrix_set(SE, j, i, NADBL);
+	    }
+	    sig->val[j] = NADBL;
+	    continue;
+	}
+
+	memcpy(b->val, Xy, k * sizeof *Xy);
+	gretl_cholesky_solve(L, b);
+	gretl_inverse_from_cholesky_decomp(Li, L);
+	ssr = yy;
+	for (i=0; i<k; i++) {
+	    ssr -= b->val[i] * Xy[i];
+	}
+	s2 = (ssr > 0 ? ssr : 0) / (s1 - s0 + 1 - k);
+	for (i=0; i<k; i++) {
+	    gretl_matrix_set(B, j, i, b->val[i]);
+	    gretl_matrix_set(SE, j, i, sqrt(s2 * gretl_matrix_get(Li, i, i)));
+	}
+	sig->val[j] = sqrt(s2);
+    }
+
+    if (!*err) {
+	char **cn = batch_names(xlist, dset, err);
+
+	if (!*err) {
+	    gretl_matrix_set_colnames(B, cn);
+	    cn = batch_names(xlist, dset, err);
+	    if (!*err) {
+		gretl_matrix_set_colnames(SE, cn);
+	    }
+	}
+    }
+
+    if (!*err) {
+	ret = gretl_bundle_new();
+	if (ret == NULL) {
+	    *err = E_ALLOC;
+	}
+    }
+
+    if (!*err) {
+	gretl_matrix *R[] = {B, SE, sig, obs};
+	const char *keys[] = {"coeff", "stderr", "sigma", "obs"};
+
+	for (i=0; i<4; i++) {
+	    /* align the rows with the window end points */
+	    gretl_matrix_set_t1(R[i], dset->t1 + w - 1);
+	    gretl_matrix_set_t2(R[i], dset->t2);
+	    gretl_bundle_donate_data(ret, keys[i], R[i], GRETL_TYPE_MATRIX, 0);
+	}
+	B = SE = sig = obs = NULL;
+    }
+
+ bailout:
+
+    gretl_matrix_block_destroy(MB);
+    gretl_matrix_free(B);
+    gretl_matrix_free(SE);
+    gretl_matrix_free(sig);
+    gretl_matrix_free(obs);
+    free(Xy);
+
+    return ret;
+}
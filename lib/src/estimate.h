@@ -27,6 +27,9 @@
 MODEL lsq (const int *list, DATASET *dset, 
 	   GretlCmdIndex ci, gretlopt opt);
 
+int lsq_reuse (MODEL *pmod, const int *list, DATASET *dset,
+	       GretlCmdIndex ci, gretlopt opt);
+
 MODEL ar_model (const int *list, DATASET *dset, 
 		gretlopt opt, PRN *prn);
 
@@ -77,6 +80,14 @@ int *augment_regression_list (const int *orig, int aux,
 int anova (const int *list, const DATASET *dset, 
 	   gretlopt opt, PRN *prn);
 
+gretl_bundle *batch_ols (const int *ylist, const int *xlist,
+			 const gretl_matrix *S, int each,
+			 const DATASET *dset, int *err);
+
+gretl_bundle *rolling_ols (const double *y, const int *xlist,
+			   int w, int recursive,
+			   const DATASET *dset, int *err);
+
 #endif /* ESTIMATE_H */
 
 
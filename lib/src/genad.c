@@ -0,0 +1,735 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Forward-mode automatic differentiation of a compiled genr tree
+   with respect to a parameter vector, for use by the user-level
+   optimizers (see gretl_bfgs.c). This file is #included by
+   geneval.c.
+
+   Each node is evaluated to a value (scalar, matrix or series, the
+   latter as a vector over the current sample range) along with the
+   derivatives of all its elements with respect to the k elements
+   of the parameter vector, stored as an (elements x k) matrix. Only
+   a subset of the genr language is covered: arithmetic operators,
+   the elementwise "dot" operators, matrix multiplication and
+   transposition, element selection, the common smooth functions of
+   one argument and the sum and mean functions. Anything else (in
+   particular a call to a user-defined function) makes the tree
+   ineligible, in which case the caller should fall back on a
+   numerical gradient.
+*/
+
+#define ADDEBUG 0
+
+typedef struct adval_ adval;
+
+struct adval_ {
+    gretl_matrix *v; /* value */
+    gretl_matrix *d; /* derivatives of vec(v), or NULL if constant */
+    int series;      /* @v is a series: elementwise semantics */
+};
+
+typedef struct adinfo_ adinfo;
+
+struct adinfo_ {
+    parser *p;              /* the compiled generator */
+    const gretl_matrix *b;  /* the parameter vector */
+    int k;                  /* its length */
+};
+
+/* error code for "not differentiable by us": the caller falls back
+   on numerical derivatives */
+#define E_AD_UNSUPP E_TYPES
+
+static void adval_clear (adval *a)
+{
+    gretl_matrix_free(a->v);
+    gretl_matrix_free(a->d);
+    a->v = a->d = NULL;
+    a->series = 0;
+}
+
+static int adval_n (const adval *a)
+{
+    return a->v->rows * a->v->cols;
+}
+
+static int adval_is_scalar (const adval *a)
+{
+    return !a->series && adval_n(a) == 1;
+}
+
+static int ad_eval (NODE *t, adinfo *ai, adval *ret);
+
+static int ad_scalar (double x, adval *ret)
+{
+    ret->v = gretl_matrix_from_scalar(x);
+    return ret->v == NULL ? E_ALLOC : 0;
+}
+
+/* terminal nodes: scalars, matrices and series */
+
+static int ad_leaf (NODE *t, adinfo *ai, adval *ret)
+{
+    if (t->t == NUM && t->vname == NULL) {
+        return ad_scalar(t->v.xval, ret);
+    } else if (t->t == CON) {
+        return ad_scalar(get_const_by_id(t->v.idnum), ret);
+    } else if (t->t == SERIES) {
+        const DATASET *dset = ai->p->dset;
+        int v = t->vname != NULL ?
+            current_series_index(dset, t->vname) : t->vnum;
+        int i, n;
+
+        if (v < 0 || dset == NULL) {
+            return E_AD_UNSUPP;
+        }
+        n = dset->t2 - dset->t1 + 1;
+        ret->v = gretl_column_vector_alloc(n);
+        if (ret->v == NULL) {
+            return E_ALLOC;
+        }
+        for (i=0; i<n; i++) {
+            ret->v->val[i] = dset->Z[v][dset->t1 + i];
+            if (na(ret->v->val[i])) {
+                return E_AD_UNSUPP;
+            }
+        }
+        ret->series = 1;
+        return 0;
+    } else if ((t->t == NUM || t->t == MAT) && t->vname != NULL) {
+        user_var *uv = get_user_var_by_name(t->vname);
+        void *data = uv != NULL ? uv->ptr : NULL;
+
+        if (data == NULL) {
+            return E_AD_UNSUPP;
+        } else if (uv->type == GRETL_TYPE_DOUBLE) {
+            return ad_scalar(*(double *) data, ret);
+        } else if (uv->type != GRETL_TYPE_MATRIX ||
+                   ((gretl_matrix *) data)->is_complex) {
+            return E_AD_UNSUPP;
+        }
+        ret->v = gretl_matrix_copy(data);
+        if (ret->v == NULL) {
+            return E_ALLOC;
+        }
+        if (data == ai->b) {
+            /* the parameter vector itself */
+            ret->d = gretl_identity_matrix_new(ai->k);
+            if (ret->d == NULL) {
+                return E_ALLOC;
+            }
+        }
+        return 0;
+    } else if (t->t == MAT && t->vname == NULL && t->v.m != NULL &&
+               !t->v.m->is_complex) {
+        ret->v = gretl_matrix_copy(t->v.m);
+        return ret->v == NULL ? E_ALLOC : 0;
+    }
+
+    return E_AD_UNSUPP;
+}
+
+/* Allocate the derivative matrix for @ret, which has @n elements,
+   if either of the operands @a and @b has derivatives */
+
+static int ad_alloc_deriv (adval *ret, const adval *a,
+                           const adval *b, int n, int k)
+{
+    if ((a != NULL && a->d != NULL) || (b != NULL && b->d != NULL)) {
+        ret->d = gretl_zero_matrix_new(n, k);
+        if (ret->d == NULL) {
+            return E_ALLOC;
+        }
+    }
+
+    return 0;
+}
+
+/* Elementwise binary operations, with a scalar operand being
+   broadcast. For each element we get the value of the result and
+   its partial derivatives with respect to the two operands.
+*/
+
+static int ad_elementwise (int op, adval *a, adval *b, adval *ret,
+                           adinfo *ai)
+{
+    int na = adval_n(a), nb = adval_n(b);
+    int n, i, j, ia, ib;
+    double x, y, z, pa, pb;
+    adval *big;
+    int err;
+
+    if (na == nb && a->v->rows == b->v->rows) {
+        big = a;
+    } else if (adval_is_scalar(b)) {
+        big = a;
+    } else if (adval_is_scalar(a)) {
+        big = b;
+    } else {
+        return E_AD_UNSUPP;
+    }
+
+    n = adval_n(big);
+    ret->v = gretl_matrix_alloc(big->v->rows, big->v->cols);
+    if (ret->v == NULL) {
+        return E_ALLOC;
+    }
+    ret->series = a->series || b->series;
+    err = ad_alloc_deriv(ret, a, b, n, ai->k);
+    if (err) {
+        return err;
+    }
+
+    for (i=0; i<n; i++) {
+        ia = na == 1 ? 0 : i;
+        ib = nb == 1 ? 0 : i;
+        x = a->v->val[ia];
+        y = b->v->val[ib];
+        switch (op) {
+        case B_ADD:
+        case B_DOTADD:
+            z = x + y;
+            pa = 1;
+            pb = 1;
+            break;
+        case B_SUB:
+        case B_DOTSUB:
+            z = x - y;
+            pa = 1;
+            pb = -1;
+            break;
+        case B_MUL:
+        case B_DOTMULT:
+            z = x * y;
+            pa = y;
+            pb = x;
+            break;
+        case B_DIV:
+        case B_DOTDIV:
+            z = x / y;
+            pa = 1 / y;
+            pb = -z / y;
+            break;
+        default:
+            /* B_POW, B_DOTPOW */
+            z = pow(x, y);
+            pa = y == 0 ? 0 : y * pow(x, y - 1);
+            /* don't take the log of @x unless we have to */
+            pb = b->d != NULL ? z * log(x) : 0;
+            break;
+        }
+        ret->v->val[i] = z;
+        if (ret->d == NULL) {
+            continue;
+        }
+        for (j=0; j<ai->k; j++) {
+            x = 0;
+            if (a->d != NULL) {
+                x += pa * gretl_matrix_get(a->d, ia, j);
+            }
+            if (b->d != NULL) {
+                x += pb * gretl_matrix_get(b->d, ib, j);
+            }
+            gretl_matrix_set(ret->d, i, j, x);
+        }
+    }
+
+    return 0;
+}
+
+/* Matrix product, with either operand possibly transposed:
+   d(AB) = dA B + A dB, one parameter at a time */
+
+static int ad_matmul (adval *a, GretlMatrixMod amod,
+                      adval *b, adval *ret, adinfo *ai)
+{
+    gretl_matrix dA, dB, dC;
+    int ar = amod ? a->v->cols : a->v->rows;
+    int ac = amod ? a->v->rows : a->v->cols;
+    int r, c, j, err;
+
+    if (ac != b->v->rows) {
+        return E_AD_UNSUPP;
+    }
+
+    r = ar;
+    c = b->v->cols;
+    ret->v = gretl_matrix_alloc(r, c);
+    if (ret->v == NULL) {
+        return E_ALLOC;
+    }
+    err = gretl_matrix_multiply_mod(a->v, amod, b->v, GRETL_MOD_NONE,
+                                    ret->v, GRETL_MOD_NONE);
+    if (!err) {
+        err = ad_alloc_deriv(ret, a, b, r * c, ai->k);
+    }
+
+    for (j=0; j<ai->k && ret->d != NULL && !err; j++) {
+        gretl_matrix_init_full(&dC, r, c, ret->d->val + j * r * c);
+        if (a->d != NULL) {
+            gretl_matrix_init_full(&dA, a->v->rows, a->v->cols,
+                                   a->d->val + j * adval_n(a));
+            err = gretl_matrix_multiply_mod(&dA, amod, b->v, GRETL_MOD_NONE,
+                                            &dC, GRETL_MOD_CUMULATE);
+        }
+        if (!err && b->d != NULL) {
+            gretl_matrix_init_full(&dB, b->v->rows, b->v->cols,
+                                   b->d->val + j * adval_n(b));
+            err = gretl_matrix_multiply_mod(a->v, amod, &dB, GRETL_MOD_NONE,
+                                            &dC, GRETL_MOD_CUMULATE);
+        }
+    }
+
+    return err;
+}
+
+static int ad_binary (NODE *t, adinfo *ai, adval *ret)
+{
+    adval a = {0}, b = {0};
+    int unary_tr = t->t == B_TRMUL && t->R != NULL && t->R->t == EMPTY;
+    int err;
+
+    err = ad_eval(t->L, ai, &a);
+    if (!err && !unary_tr) {
+        err = ad_eval(t->R, ai, &b);
+    }
+    if (err) {
+        goto bailout;
+    }
+
+    if (unary_tr) {
+        /* postfix transpose */
+        if (a.series) {
+            err = E_AD_UNSUPP;
+        } else {
+            ret->v = gretl_matrix_copy_transpose(a.v);
+            if (ret->v == NULL) {
+                err = E_ALLOC;
+            } else if (a.d != NULL) {
+                int r = a.v->rows, c = a.v->cols;
+                int i, l, j;
+
+                ret->d = gretl_matrix_alloc(r * c, ai->k);
+                if (ret->d == NULL) {
+                    err = E_ALLOC;
+                }
+                for (j=0; j<ai->k && !err; j++) {
+                    for (l=0; l<c; l++) {
+                        for (i=0; i<r; i++) {
+                            gretl_matrix_set(ret->d, l + i * c, j,
+                                             gretl_matrix_get(a.d, i + l * r, j));
+                        }
+                    }
+                }
+            }
+        }
+    } else if (t->t == B_TRMUL) {
+        if (a.series || b.series) {
+            err = E_AD_UNSUPP;
+        } else {
+            err = ad_matmul(&a, GRETL_MOD_TRANSPOSE, &b, ret, ai);
+        }
+    } else {
+        int sa = adval_is_scalar(&a);
+        int sb = adval_is_scalar(&b);
+
+        if (a.series != b.series && !sa && !sb) {
+            /* series combined with a matrix */
+            err = E_AD_UNSUPP;
+        } else if (t->t == B_MUL && !sa && !sb && !a.series) {
+            err = ad_matmul(&a, GRETL_MOD_NONE, &b, ret, ai);
+        } else if ((t->t == B_DIV || t->t == B_POW) && !sb && !b.series) {
+            /* matrix division, or matrix exponent */
+            err = E_AD_UNSUPP;
+        } else if (t->t == B_POW && !sa && !a.series) {
+            /* power of a matrix */
+            err = E_AD_UNSUPP;
+        } else {
+            err = ad_elementwise(t->t, &a, &b, ret, ai);
+        }
+    }
+
+ bailout:
+
+    adval_clear(&a);
+    adval_clear(&b);
+
+    return err;
+}
+
+/* Smooth functions of one argument, applied elementwise: we get
+   the value and first derivative at @x */
+
+static int ad_func_value (int f, double x, double *y, double *dy)
+{
+    switch (f) {
+    case U_NEG:
+        *y = -x;
+        *dy = -1;
+        break;
+    case U_POS:
+        *y = x;
+        *dy = 1;
+        break;
+    case F_ABS:
+        *y = fabs(x);
+        *dy = x < 0 ? -1 : 1;
+        break;
+    case F_LOG:
+        *y = log(x);
+        *dy = 1 / x;
+        break;
+    case F_LOG10:
+        *y = log10(x);
+        *dy = 1 / (x * log(10.0));
+        break;
+    case F_EXP:
+        *y = exp(x);
+        *dy = *y;
+        break;
+    case F_SQRT:
+        *y = sqrt(x);
+        *dy = 0.5 / *y;
+        break;
+    case F_SIN:
+        *y = sin(x);
+        *dy = cos(x);
+        break;
+    case F_COS:
+        *y = cos(x);
+        *dy = -sin(x);
+        break;
+    case F_TANH:
+        *y = tanh(x);
+        *dy = 1 - *y * *y;
+        break;
+    case F_LOGISTIC:
+        *y = 1 / (1 + exp(-x));
+        *dy = *y * (1 - *y);
+        break;
+    case F_CNORM:
+        *y = normal_cdf(x);
+        *dy = normal_pdf(x);
+        break;
+    case F_DNORM:
+        *y = normal_pdf(x);
+        *dy = -x * *y;
+        break;
+    case F_LNGAMMA:
+        *y = lngamma(x);
+        *dy = digamma(x);
+        break;
+    default:
+        return E_AD_UNSUPP;
+    }
+
+    return 0;
+}
+
+static int ad_unary (NODE *t, adinfo *ai, adval *ret)
+{
+    adval a = {0};
+    double y, dy;
+    int i, j, n;
+    int err;
+
+    err = ad_eval(t->L, ai, &a);
+    if (err) {
+        adval_clear(&a);
+        return err;
+    }
+
+    n = adval_n(&a);
+    ret->series = a.series;
+    /* compute in place */
+    for (i=0; i<n && !err; i++) {
+        err = ad_func_value(t->t, a.v->val[i], &y, &dy);
+        a.v->val[i] = y;
+        for (j=0; j<ai->k && a.d != NULL && !err; j++) {
+            a.d->val[i + j * n] *= dy;
+        }
+    }
+
+    if (err) {
+        adval_clear(&a);
+    } else {
+        ret->v = a.v;
+        ret->d = a.d;
+    }
+
+    return err;
+}
+
+/* sum, mean and their by-column and by-row variants */
+
+static int ad_reduce (NODE *t, adinfo *ai, adval *ret)
+{
+    adval a = {0};
+    int f = t->t;
+    int r, c, rr, rc;
+    int i, l, j, ii;
+    double s = 1.0;
+    int err;
+
+    if (t->R != NULL && t->R->t != EMPTY) {
+        return E_AD_UNSUPP;
+    }
+
+    err = ad_eval(t->L, ai, &a);
+    if (err) {
+        goto bailout;
+    }
+
+    r = a.v->rows;
+    c = a.v->cols;
+    if (f == F_SUM || f == F_MEAN) {
+        rr = rc = 1;
+        if (f == F_MEAN) {
+            s = 1.0 / (r * c);
+        }
+    } else if (a.series) {
+        err = E_AD_UNSUPP;
+        goto bailout;
+    } else if (f == F_SUMC || f == F_MEANC) {
+        rr = 1;
+        rc = c;
+        if (f == F_MEANC) {
+            s = 1.0 / r;
+        }
+    } else {
+        rr = r;
+        rc = 1;
+        if (f == F_MEANR) {
+            s = 1.0 / c;
+        }
+    }
+
+    ret->v = gretl_zero_matrix_new(rr, rc);
+    if (ret->v == NULL) {
+        err = E_ALLOC;
+        goto bailout;
+    }
+    err = ad_alloc_deriv(ret, &a, NULL, rr * rc, ai->k);
+    if (err) {
+        goto bailout;
+    }
+
+    for (l=0; l<c; l++) {
+        for (i=0; i<r; i++) {
+            ii = rr == 1 ? (rc == 1 ? 0 : l) : i;
+            ret->v->val[ii] += s * a.v->val[i + l * r];
+            for (j=0; j<ai->k && ret->d != NULL; j++) {
+                ret->d->val[ii + j * rr * rc] +=
+                    s * a.d->val[i + l * r + j * r * c];
+            }
+        }
+    }
+
+ bailout:
+
+    adval_clear(&a);
+
+    return err;
+}
+
+/* a scalar that doesn't depend on the parameters, as in an
+   index or an exponent */
+
+static int ad_get_index (NODE *t, adinfo *ai, int *idx)
+{
+    adval a = {0};
+    int err = ad_eval(t, ai, &a);
+
+    if (!err) {
+        if (!adval_is_scalar(&a) || a.d != NULL ||
+            a.v->val[0] != floor(a.v->val[0])) {
+            err = E_AD_UNSUPP;
+        } else {
+            *idx = (int) a.v->val[0] - 1;
+        }
+    }
+    adval_clear(&a);
+
+    return err;
+}
+
+/* selection of a single element of a matrix, m[i] or m[i,j] */
+
+static int ad_element (NODE *t, adinfo *ai, adval *ret)
+{
+    NODE *s = t->R;
+    adval a = {0};
+    int i = 0, j = 0, l;
+    int err;
+
+    if (s == NULL || s->t != SLRAW || s->L == NULL ||
+        s->L->t == SUBSL || s->L->t == EMPTY ||
+        (s->R != NULL && (s->R->t == SUBSL || s->R->t == EMPTY))) {
+        return E_AD_UNSUPP;
+    }
+
+    err = ad_get_index(s->L, ai, &i);
+    if (!err && s->R != NULL) {
+        err = ad_get_index(s->R, ai, &j);
+    }
+    if (!err) {
+        err = ad_eval(t->L, ai, &a);
+    }
+    if (!err && a.series) {
+        err = E_AD_UNSUPP;
+    }
+    if (!err) {
+        if (s->R == NULL && gretl_vector_get_length(a.v) == 0) {
+            /* a single index is OK only for a vector */
+            err = E_AD_UNSUPP;
+        } else if (s->R != NULL) {
+            i += j * a.v->rows;
+        }
+    }
+    if (!err && (i < 0 || i >= adval_n(&a) ||
+                 (s->R != NULL && (j < 0 || j >= a.v->cols)))) {
+        err = E_AD_UNSUPP;
+    }
+    if (!err) {
+        ret->v = gretl_matrix_from_scalar(a.v->val[i]);
+        err = ad_alloc_deriv(ret, &a, NULL, 1, ai->k);
+        for (l=0; l<ai->k && ret->d != NULL; l++) {
+            ret->d->val[l] = gretl_matrix_get(a.d, i, l);
+        }
+    }
+
+    adval_clear(&a);
+
+    return err;
+}
+
+static int ad_eval (NODE *t, adinfo *ai, adval *ret)
+{
+    if (t == NULL) {
+        return E_AD_UNSUPP;
+    }
+
+#if ADDEBUG
+    fprintf(stderr, "ad_eval: %s\n", getsymb(t->t));
+#endif
+
+    switch (t->t) {
+    case NUM:
+    case MAT:
+    case SERIES:
+    case CON:
+        return ad_leaf(t, ai, ret);
+    case CSE:
+        /* evaluate the shared subexpression */
+        return ad_eval(t->L != NULL ? t->L : ((NODE *) t->v.ptr)->L,
+                       ai, ret);
+    case B_ADD:
+    case B_SUB:
+    case B_MUL:
+    case B_DIV:
+    case B_POW:
+    case B_TRMUL:
+    case B_DOTADD:
+    case B_DOTSUB:
+    case B_DOTMULT:
+    case B_DOTDIV:
+    case B_DOTPOW:
+        return ad_binary(t, ai, ret);
+    case U_NEG:
+    case U_POS:
+    case F_ABS:
+    case F_LOG:
+    case F_LOG10:
+    case F_EXP:
+    case F_SQRT:
+    case F_SIN:
+    case F_COS:
+    case F_TANH:
+    case F_LOGISTIC:
+    case F_CNORM:
+    case F_DNORM:
+    case F_LNGAMMA:
+        return ad_unary(t, ai, ret);
+    case F_SUM:
+    case F_MEAN:
+    case F_SUMC:
+    case F_SUMR:
+    case F_MEANC:
+    case F_MEANR:
+        return ad_reduce(t, ai, ret);
+    case OSL:
+        return ad_element(t, ai, ret);
+    default:
+        return E_AD_UNSUPP;
+    }
+}
+
+/**
+ * genr_autodiff:
+ * @p: compiled generator for a scalar criterion.
+ * @b: parameter vector, which must be a named matrix referenced
+ * in the criterion.
+ * @g: array of length equal to that of @b, to receive the
+ * gradient.
+ * @err: location to receive error code.
+ *
+ * Evaluates the criterion defined by @p at the current value of
+ * @b, along with its gradient with respect to @b, by forward-mode
+ * automatic differentiation of the syntax tree. An error code of
+ * %E_TYPES indicates that the criterion uses features that are
+ * not supported for differentiation.
+ *
+ * Returns: the value of the criterion, or %NADBL on failure.
+ */
+
+double genr_autodiff (parser *p, const gretl_matrix *b,
+                      double *g, int *err)
+{
+    adinfo ai;
+    adval ret = {0};
+    double x = NADBL;
+    int j;
+
+    ai.p = p;
+    ai.b = b;
+    ai.k = gretl_vector_get_length(b);
+
+    if (p == NULL || p->tree == NULL || ai.k == 0 ||
+        p->targ == SERIES || (p->flags & P_AUTOREG)) {
+        *err = E_AD_UNSUPP;
+        return NADBL;
+    }
+
+    *err = ad_eval(p->tree, &ai, &ret);
+
+    if (!*err && !adval_is_scalar(&ret)) {
+        *err = E_AD_UNSUPP;
+    }
+    if (!*err) {
+        x = ret.v->val[0];
+        for (j=0; j<ai.k; j++) {
+            g[j] = ret.d == NULL ? 0.0 : ret.d->val[j];
+        }
+    }
+
+    adval_clear(&ret);
+
+    return x;
+}
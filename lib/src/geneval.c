@@ -49,6 +49,9 @@
 #include "flow_control.h"
 #include "mapinfo.h"
 #include "gretl_sampler.h"
+#include "genvm.h"
+#include "gretl_task.h"
+#include "gretl_memstats.h"
 
 #include <time.h> /* for the $now accessor */
 
@@ -166,9 +169,14 @@ static char *get_opstr (int op);
 static gretl_bundle *node_get_bundle (NODE *n, parser *p);
 static int gen_type_is_arrayable (int gen_t);
 static GretlType gretl_type_from_gen_type (int gen_t);
+static NODE *eval_ufunc (NODE *t, NODE *m, parser *p);
 
 static int user_qsorting;
 
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(user_qsorting)
+#endif
+
 void set_user_qsorting (int s)
 {
     if (s != 0) {
@@ -409,6 +417,154 @@ static const char *free_tree_tag (int t)
 
 #endif /* EDEBUG */
 
+/* Counters for "set genr_stats on": how often expressions are
+   parsed versus re-run from a compiled tree, how the work was
+   done (scalar VM, fused series programs, shared subexpressions),
+   how many temporary nodes were created or reused, and the number
+   of elementwise function calls, by function. The bytes figure
+   covers temporary matrices and series that were discarded rather
+   than passed on as results.
+*/
+
+typedef struct genr_stats_ {
+    guint64 parses;     /* expressions lexed and parsed */
+    guint64 reuses;     /* evaluations of a compiled tree */
+    guint64 vm_runs;    /* evaluations done by the scalar VM */
+    guint64 fused;      /* fused series programs run */
+    guint64 cse_hits;   /* shared subexpressions reused */
+    guint64 tmp_new;    /* aux nodes created */
+    guint64 tmp_reused; /* aux nodes reused */
+    guint64 tmp_bytes;  /* bytes of discarded temporaries */
+    guint64 fcalls[FN_MAX]; /* elementwise calls, by function */
+} genr_stats;
+
+static int gstats_on;
+static genr_stats gstats;
+
+#define gstat_inc(k) do { if (gstats_on) gstats.k += 1; } while (0)
+#define gstat_fcall(f) do { if (gstats_on && f > F1_MIN && f < FN_MAX) \
+            gstats.fcalls[f] += 1; } while (0)
+
+static void gstat_tmp_free (NODE *t, parser *p)
+{
+    if (t->t == MAT && t->v.m != NULL) {
+        gstats.tmp_bytes += (guint64) t->v.m->rows * t->v.m->cols *
+            sizeof(double) * (t->v.m->is_complex ? 2 : 1);
+    } else if (t->t == SERIES && t->v.xvec != NULL && p != NULL) {
+        gstats.tmp_bytes += (guint64) p->dset_n * sizeof(double);
+    }
+}
+
+/**
+ * genr_stats_set_enabled:
+ * @s: non-zero to switch the genr counters on, 0 to switch
+ * them off.
+ *
+ * Switching the counters on resets them.
+ */
+
+void genr_stats_set_enabled (int s)
+{
+    if (s && !gstats_on) {
+        memset(&gstats, 0, sizeof gstats);
+    }
+    gstats_on = (s != 0);
+}
+
+/**
+ * genr_stats_bundle:
+ * @err: location to receive error code.
+ *
+ * Returns: a bundle holding the genr counters, plus a sub-bundle
+ * "functions" holding the number of elementwise calls of each
+ * function that has been called, keyed by name.
+ */
+
+gretl_bundle *genr_stats_bundle (int *err)
+{
+    gretl_bundle *b = gretl_bundle_new();
+    gretl_bundle *fb = gretl_bundle_new();
+    int f;
+
+    if (b == NULL || fb == NULL) {
+        gretl_bundle_destroy(b);
+        gretl_bundle_destroy(fb);
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    gretl_bundle_set_int(b, "tracking", gstats_on);
+    gretl_bundle_set_scalar(b, "parses", gstats.parses);
+    gretl_bundle_set_scalar(b, "reuses", gstats.reuses);
+    gretl_bundle_set_scalar(b, "vm_runs", gstats.vm_runs);
+    gretl_bundle_set_scalar(b, "fused", gstats.fused);
+    gretl_bundle_set_scalar(b, "cse_hits", gstats.cse_hits);
+    gretl_bundle_set_scalar(b, "temps", gstats.tmp_new);
+    gretl_bundle_set_scalar(b, "temps_reused", gstats.tmp_reused);
+    gretl_bundle_set_scalar(b, "temp_bytes", gstats.tmp_bytes);
+
+    for (f=0; f<FN_MAX; f++) {
+        if (gstats.fcalls[f] > 0) {
+            gretl_bundle_set_scalar(fb, getsymb(f), gstats.fcalls[f]);
+        }
+    }
+    gretl_bundle_donate_data(b, "functions", fb, GRETL_TYPE_BUNDLE, 0);
+
+    return b;
+}
+
+/**
+ * genr_stats_report:
+ * @prn: printing struct.
+ *
+ * Prints the genr counters accumulated since they were last
+ * switched on.
+ *
+ * Returns: 0.
+ */
+
+int genr_stats_report (PRN *prn)
+{
+    guint64 total = gstats.parses + gstats.reuses;
+    int f, header = 0;
+
+    pprintf(prn, "\n%s\n\n", _("Genr statistics"));
+    pprintf(prn, "  %-24s %12" G_GUINT64_FORMAT "\n", _("expressions parsed"),
+            gstats.parses);
+    pprintf(prn, "  %-24s %12" G_GUINT64_FORMAT, _("compiled trees re-run"),
+            gstats.reuses);
+    if (total > 0) {
+        pprintf(prn, " (%.1f%%)", 100.0 * gstats.reuses / total);
+    }
+    pputc(prn, '\n');
+    pprintf(prn, "  %-24s %12" G_GUINT64_FORMAT "\n", _("run by scalar VM"),
+            gstats.vm_runs);
+    pprintf(prn, "  %-24s %12" G_GUINT64_FORMAT "\n", _("fused series programs"),
+            gstats.fused);
+    pprintf(prn, "  %-24s %12" G_GUINT64_FORMAT "\n", _("shared subexpr reuses"),
+            gstats.cse_hits);
+    pprintf(prn, "  %-24s %12" G_GUINT64_FORMAT "\n", _("temporaries created"),
+            gstats.tmp_new);
+    pprintf(prn, "  %-24s %12" G_GUINT64_FORMAT "\n", _("temporaries reused"),
+            gstats.tmp_reused);
+    pprintf(prn, "  %-24s %12.3f\n", _("MB discarded"),
+            gstats.tmp_bytes / (1024.0 * 1024.0));
+
+    for (f=0; f<FN_MAX; f++) {
+        if (gstats.fcalls[f] > 0) {
+            if (!header) {
+                pprintf(prn, "\n  %s\n", _("elementwise calls"));
+                header = 1;
+            }
+            pprintf(prn, "  %-24s %12" G_GUINT64_FORMAT "\n", getsymb(f),
+                    gstats.fcalls[f]);
+        }
+    }
+    pputc(prn, '\n');
+
+    return 0;
+}
+
 /* used when we know that @t is a terminal node: skip
    the tests for attached tree */
 
@@ -425,6 +581,9 @@ static void free_node (NODE *t, parser *p)
 #if EDEBUG
         fprintf(stderr, " tmp node: freeing attached data\n");
 #endif
+        if (gstats_on) {
+            gstat_tmp_free(t, p);
+        }
         if (t->t == SERIES) {
             free(t->v.xvec);
         } else if (t->t == LIST || t->t == IVEC) {
@@ -454,7 +613,7 @@ static void free_node (NODE *t, parser *p)
         p->ret = NULL;
     }
 
-    free(t);
+    node_release(t);
 }
 
 /* A word on "aux" nodes. These come in two sorts, which
@@ -730,6 +889,9 @@ static void clear_tmp_node_data (NODE *n, parser *p)
         free(n->v.ivec);
     } else if (n->t == MAT) {
         /* (how) can we avoid doing this? */
+        if (gstats_on) {
+            gstat_tmp_free(n, p);
+        }
         gretl_matrix_free(n->v.m);
     } else if (n->t == MSPEC) {
         if (n->v.mspec != NULL) {
@@ -874,6 +1036,7 @@ static NODE *get_aux_node (parser *p, int t, int n, int flags)
 
     if (ret != NULL) {
         /* got a pre-existing aux node */
+        gstat_inc(tmp_reused);
         if (starting(p)) {
             if (ret->t != t) {
                 maybe_switch_node_type(ret, t, flags, p);
@@ -914,6 +1077,7 @@ static NODE *get_aux_node (parser *p, int t, int n, int flags)
 
         if (!p->err) {
             ret->flags |= AUX_NODE;
+            gstat_inc(tmp_new);
         }
     }
 
@@ -975,6 +1139,7 @@ static NODE *aux_sized_matrix_node (parser *p, int m, int n,
 
     if (ret != NULL) {
         /* got a pre-existing node */
+        gstat_inc(tmp_reused);
         if (ret->t == NUM) {
             /* switch @ret from scalar to matrix */
             ret->t = MAT;
@@ -1001,6 +1166,8 @@ static NODE *aux_sized_matrix_node (parser *p, int m, int n,
         ret = newmat(TMP_NODE | AUX_NODE);
         if (ret == NULL) {
             p->err = E_ALLOC;
+        } else {
+            gstat_inc(tmp_new);
         }
     }
 
@@ -1083,7 +1250,10 @@ static void *gen_get_lhs_var (parser *p, GretlType type)
     void *data = NULL;
 
     if (p->lh.uv != NULL && p->lh.uv->type == type) {
-        data = p->lh.uv->ptr;
+        /* the caller may modify the value in place */
+        if (user_var_unshare(p->lh.uv) == 0) {
+            data = p->lh.uv->ptr;
+        }
     } else {
         if (p->lh.uv == NULL) {
             fprintf(stderr, "*** get: LHS %s '%s' is NULL!\n",
@@ -1418,6 +1588,84 @@ static double xy_calc (double x, double y, int op, int targ, parser *p)
     }
 }
 
+#if defined(_OPENMP)
+
+/* Elementwise series operations that can safely be split across
+   OpenMP threads. B_POW is excluded since it may issue a warning,
+   as are functions that depend on non-reentrant state.
+*/
+
+static int series_mt_ok (int f)
+{
+    switch (f) {
+    case B_ADD:
+    case B_SUB:
+    case B_MUL:
+    case B_DIV:
+    case B_MOD:
+    case B_AND:
+    case B_OR:
+    case B_EQ:
+    case B_NEQ:
+    case B_GT:
+    case B_LT:
+    case B_GTE:
+    case B_LTE:
+    case U_NEG:
+    case U_POS:
+    case U_NOT:
+    case F_ABS:
+    case F_SGN:
+    case F_TOINT:
+    case F_CEIL:
+    case F_FLOOR:
+    case F_ROUND:
+    case F_SIN:
+    case F_COS:
+    case F_TAN:
+    case F_ASIN:
+    case F_ACOS:
+    case F_ATAN:
+    case F_SINH:
+    case F_COSH:
+    case F_TANH:
+    case F_ASINH:
+    case F_ACOSH:
+    case F_ATANH:
+    case F_LOG:
+    case F_LOG10:
+    case F_LOG2:
+    case F_EXP:
+    case F_SQRT:
+    case F_CNORM:
+    case F_DNORM:
+    case F_QNORM:
+    case F_LOGISTIC:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* relative per-observation cost of a function call, compared
+   with a simple arithmetic operation */
+#define SERIES_FUNC_COST 4
+
+/* Should a calculation involving @f, over @n observations and
+   with an overall cost of @cost per observation, be threaded?
+*/
+
+static int series_use_openmp (int f, int n, int cost, parser *p)
+{
+    if (autoreg(p) || !series_mt_ok(f)) {
+        return 0;
+    } else {
+        return gretl_use_openmp((guint64) n * cost);
+    }
+}
+
+#endif /* _OPENMP */
+
 static int rmatrix_xy_calc (gretl_matrix *targ,
                             gretl_matrix *src,
                             double x, int xleft,
@@ -1699,6 +1947,22 @@ static double scalar_pdist (int t, int d, const double *parm,
     return x;
 }
 
+/* Map from a probability-distribution function code to
+   the calculation code used for batch evaluation, or -1
+   if there's no such mapping.
+*/
+
+static int pdist_calc_code (int f)
+{
+    switch (f) {
+    case F_CDF:    return PD_CDF;
+    case F_PVAL:   return PD_PVAL;
+    case F_INVCDF: return PD_INVCDF;
+    case F_CRIT:   return PD_CRIT;
+    default:       return -1;
+    }
+}
+
 /* @parm contains an array of scalar parameters;
    @argvec contains a series of argument values.
 */
@@ -1708,17 +1972,24 @@ static int series_pdist (double *x, int f, int d,
                          const double *argvec,
                          parser *p)
 {
-    int t;
-
-    if (f == F_PDF) {
-        /* fast treatment, for pdf only at this point */
-        int n = sample_size(p->dset);
+    int n = sample_size(p->dset);
+    int t, err = E_NOTIMP;
 
+    if (f == F_PDF || pdist_calc_code(f) >= 0) {
         for (t=p->dset->t1; t<=p->dset->t2; t++) {
             x[t] = argvec[t];
         }
-        gretl_fill_pdf_array(d, parm, x + p->dset->t1, n);
-    } else {
+        if (f == F_PDF) {
+            gretl_fill_pdf_array(d, parm, x + p->dset->t1, n);
+            err = 0;
+        } else {
+            err = gretl_fill_pdist_array(d, pdist_calc_code(f), parm,
+                                         x + p->dset->t1, n);
+        }
+    }
+
+    if (err) {
+        /* no batch treatment available */
         for (t=p->dset->t1; t<=p->dset->t2; t++) {
             x[t] = scalar_pdist(f, d, parm, np, argvec[t], p);
         }
@@ -1752,6 +2023,20 @@ static gretl_matrix *matrix_pdist (int f, int d,
 
     n = m->rows * m->cols;
 
+    if (pdist_calc_code(f) >= 0) {
+        memcpy(m->val, argmat->val, n * sizeof *m->val);
+        if (gretl_fill_pdist_array(d, pdist_calc_code(f), parm,
+                                   m->val, n) == 0) {
+            for (i=0; i<n; i++) {
+                if (na(m->val[i])) {
+                    p->err = E_MISSDATA;
+                    break;
+                }
+            }
+            goto finish;
+        }
+    }
+
     for (i=0; i<n && !p->err; i++) {
         x = scalar_pdist(f, d, parm, np, argmat->val[i], p);
         if (na(x)) {
@@ -1761,6 +2046,8 @@ static gretl_matrix *matrix_pdist (int f, int d,
         }
     }
 
+ finish:
+
     if (p->err) {
         gretl_matrix_free(m);
         m = NULL;
@@ -1979,16 +2266,19 @@ static NODE *eval_urcpval (NODE *n, NODE *r, parser *p)
         NODE *e;
         int i, m = r->v.bn.n_nodes;
         int iargs[3] = {0};
+        gretl_matrix *tvec = NULL;
         double tau = NADBL;
 
         if (m != 4) {
             n_args_error(m, 4, 4, n->t, p);
         }
 
-        /* need double, int, int, int */
+        /* need double (or matrix), int, int, int */
         for (i=0; i<4 && !p->err; i++) {
             e = r->v.bn.n[i];
-            if (scalar_node(e)) {
+            if (i == 0 && e->t == MAT) {
+                tvec = e->v.m;
+            } else if (scalar_node(e)) {
                 if (i == 0) {
                     tau = node_get_scalar(e, p);
                 } else {
@@ -2004,9 +2294,24 @@ static NODE *eval_urcpval (NODE *n, NODE *r, parser *p)
             int niv = iargs[1];
             int itv = iargs[2];
 
-            ret = aux_scalar_node(p);
-            if (ret != NULL) {
-                ret->v.xval = get_urc_pvalue(tau, nobs, niv, itv);
+            if (tvec != NULL) {
+                /* p-values for a matrix of test statistics */
+                ret = aux_matrix_node(p);
+                if (ret != NULL) {
+                    ret->v.m = gretl_matrix_alloc(tvec->rows, tvec->cols);
+                    if (ret->v.m == NULL) {
+                        p->err = E_ALLOC;
+                    } else {
+                        p->err = get_urc_pvalues(tvec->val, ret->v.m->val,
+                                                 tvec->rows * tvec->cols,
+                                                 nobs, niv, itv);
+                    }
+                }
+            } else {
+                ret = aux_scalar_node(p);
+                if (ret != NULL) {
+                    ret->v.xval = get_urc_pvalue(tau, nobs, niv, itv);
+                }
             }
         }
     } else {
@@ -2063,7 +2368,7 @@ static NODE *bvnorm_node (NODE *n, parser *p)
     if (starting(p)) {
         double *avec = NULL, *bvec = NULL;
         gretl_matrix *amat = NULL, *bmat = NULL;
-        double a, b, args[2];
+        double args[2];
         double rho = NADBL;
         NODE *e;
         int i, mode = 0;
@@ -2118,17 +2423,15 @@ static NODE *bvnorm_node (NODE *n, parser *p)
             ret->v.xval = bvnorm_cdf(rho, args[0], args[1]);
         } else if (mode == 1) {
             /* a and/or b are series */
-            int t;
-
-            for (t=p->dset->t1; t<=p->dset->t2; t++) {
-                a = (avec != NULL)? avec[t] : args[0];
-                b = (bvec != NULL)? bvec[t] : args[1];
-                if (na(a) || na(b)) {
-                    ret->v.xvec[t] = NADBL;
-                } else {
-                    ret->v.xvec[t] = bvnorm_cdf(rho, a, b);
-                }
-            }
+            int t1 = p->dset->t1;
+            int n = p->dset->t2 - t1 + 1;
+
+            bvnorm_cdf_array(rho,
+                             avec != NULL ? avec + t1 : &args[0],
+                             avec != NULL ? 1 : 0,
+                             bvec != NULL ? bvec + t1 : &args[1],
+                             bvec != NULL ? 1 : 0,
+                             ret->v.xvec + t1, n);
         } else if (mode == 2) {
             /* a and/or b are matrices */
             gretl_matrix *m = NULL;
@@ -2142,10 +2445,13 @@ static NODE *bvnorm_node (NODE *n, parser *p)
             if (m != NULL) {
                 int i, n = r * c;
 
-                for (i=0; i<n && !p->err; i++) {
-                    a = (amat != NULL)? amat->val[i] : args[0];
-                    b = (bmat != NULL)? bmat->val[i] : args[1];
-                    m->val[i] = bvnorm_cdf(rho, a, b);
+                bvnorm_cdf_array(rho,
+                                 amat != NULL ? amat->val : &args[0],
+                                 amat != NULL ? 1 : 0,
+                                 bmat != NULL ? bmat->val : &args[1],
+                                 bmat != NULL ? 1 : 0,
+                                 m->val, n);
+                for (i=0; i<n; i++) {
                     if (na(m->val[i])) {
                         /* matrix: change NAs to NaNs */
                         m->val[i] = 0.0/0.0;
@@ -2555,6 +2861,13 @@ static NODE *mpi_barrier_node (parser *p)
     return NULL;
 }
 
+static NODE *mpimap_node (NODE *l, NODE *r, parser *p)
+{
+    gretl_errmsg_set(_("MPI is not supported in this gretl build"));
+    p->err = 1;
+    return NULL;
+}
+
 #endif /* !HAVE_MPI */
 
 static NODE *scalar_calc (NODE *x, NODE *y, int f, parser *p)
@@ -2801,16 +3114,17 @@ static NODE *series_calc (NODE *l, NODE *r, int f, parser *p)
     if (!p->err) {
         int t1 = autoreg(p) ? p->obs : p->dset->t1;
         int t2 = autoreg(p) ? p->obs : tmax;
+        double *z = ret->v.xvec;
         int t;
 
+#if defined(_OPENMP)
+        int mt = series_use_openmp(f, t2 - t1 + 1, 1, p);
+#pragma omp parallel for private(t) if (mt)
+#endif
         for (t=t1; t<=t2; t++) {
-            if (x != NULL) {
-                xt = x[t];
-            }
-            if (y != NULL) {
-                yt = y[t];
-            }
-            ret->v.xvec[t] = xy_calc(xt, yt, f, SERIES, p);
+            z[t] = xy_calc(x != NULL ? x[t] : xt,
+                           y != NULL ? y[t] : yt,
+                           f, SERIES, p);
         }
     }
 
@@ -3347,6 +3661,69 @@ static gretl_matrix *tmp_matrix_from_series (NODE *n, parser *p)
     return m;
 }
 
+/* For the timestamp functions: get the data of @n, which should
+   be either a series (in which case we take the current sample
+   range) or a vector, and write its length into @len.
+*/
+
+static const double *ts_node_get_data (NODE *n, int f, int i,
+                                       parser *p, int *len)
+{
+    if (n->t == SERIES) {
+        *len = sample_size(p->dset);
+        return n->v.xvec + p->dset->t1;
+    } else if (n->t == MAT && gretl_vector_get_length(n->v.m) > 0) {
+        *len = gretl_vector_get_length(n->v.m);
+        return n->v.m->val;
+    } else {
+        node_type_error(f, i, SERIES, n, p);
+        return NULL;
+    }
+}
+
+/* tsfind(ts, t): position of the first element of @l at or
+   after @r, by bisection. For a series this is an observation
+   number within the full dataset.
+*/
+
+static NODE *tsfind_node (NODE *l, NODE *r, parser *p)
+{
+    const double *ts;
+    NODE *ret = NULL;
+    int n, i, k = 0;
+    int offset = 1;
+
+    ts = ts_node_get_data(l, F_TSFIND, 1, p, &n);
+    if (p->err) {
+        return NULL;
+    } else if (l->t == SERIES) {
+        offset += p->dset->t1;
+    }
+
+    if (r->t == NUM) {
+        ret = aux_scalar_node(p);
+        if (ret != NULL) {
+            ret->v.xval = na(r->v.xval) ? NADBL :
+                timestamp_search(ts, n, r->v.xval) + offset;
+        }
+    } else if (r->t == MAT) {
+        k = r->v.m->rows * r->v.m->cols;
+        ret = aux_sized_matrix_node(p, r->v.m->rows, r->v.m->cols, 0);
+        if (ret != NULL) {
+            for (i=0; i<k; i++) {
+                double ti = r->v.m->val[i];
+
+                ret->v.m->val[i] = na(ti) ? NADBL :
+                    timestamp_search(ts, n, ti) + offset;
+            }
+        }
+    } else {
+        node_type_error(F_TSFIND, 2, NUM, r, p);
+    }
+
+    return ret;
+}
+
 /* "Fake" a series using a column vector: the vector must be
    of the same length as the current dataset.
 */
@@ -3723,6 +4100,9 @@ static user_var *ptr_node_get_uvar (NODE *n, int t, parser *p)
             }
             if (uv == NULL) {
                 p->err = E_DATA;
+            } else {
+                /* the referent may be modified */
+                p->err = user_var_unshare(uv);
             }
         }
     } else {
@@ -3775,6 +4155,18 @@ static NODE *ptr_node_get_referent_node (NODE *n, parser *p)
         if (ret->uv == NULL) {
             p->err = E_DATA;
             ret = NULL;
+        } else if (ret->uv->flags & UV_COW) {
+            /* the referent may be modified: give it its own data */
+            p->err = user_var_unshare(ret->uv);
+            if (!p->err) {
+                if (ret->t == MAT) {
+                    ret->v.m = ret->uv->ptr;
+                } else if (ret->t == BUNDLE) {
+                    ret->v.b = ret->uv->ptr;
+                } else if (ret->t == ARRAY) {
+                    ret->v.a = ret->uv->ptr;
+                }
+            }
         }
     }
 
@@ -3868,34 +4260,86 @@ static NODE *BFGS_constrained_max (NODE *t, NODE *n, parser *p)
     return ret;
 }
 
-static NODE *BFGS_maximize (NODE *l, NODE *m, NODE *r,
-                            parser *p, NODE *t)
+/* MSmax(&b, opts, f [, g]): if @opts is given in pointer form
+   the table of local optima is added to it */
+
+static NODE *multistart_max (NODE *t, NODE *n, parser *p)
 {
     NODE *ret = NULL;
+    NODE *e = NULL;
+    gretl_matrix *b = NULL;
+    gretl_bundle *opts = NULL;
+    gretl_bundle *out = NULL;
+    const char *sf = NULL;
+    const char *sg = NULL;
+    int i, k = n->v.bn.n_nodes;
 
-    if (starting(p)) {
-        gretl_matrix *b;
-        const char *sf = m->v.str;
-        const char *sg = NULL;
-
-        b = mat_node_get_real_matrix(l, p);
+    if (k < 3 || k > 4) {
+        n_args_error(k, 3, 4, F_MSMAX, p);
+    }
 
-        if (!p->err) {
-            if (r->t == STR) {
-                sg = r->v.str;
-            } else if (r->t != EMPTY) {
-                p->err = e_types(r);
+    for (i=0; i<k && !p->err; i++) {
+        e = n->v.bn.n[i];
+        if (i == 0) {
+            b = mat_node_get_real_matrix(e, p);
+        } else if (i == 1) {
+            opts = node_get_bundle(e, p);
+            if (e->t == U_ADDR) {
+                out = opts;
             }
+        } else if (i == 2) {
+            sf = node_get_fncall(e, p);
+        } else if (i == 3 && !null_node(e)) {
+            sg = node_get_fncall(e, p);
+        }
+    }
+
+    if (!p->err && gretl_is_null_matrix(b)) {
+        p->err = E_DATA;
+    }
+
+    if (!p->err) {
+        ret = aux_scalar_node(p);
+    }
+
+    if (!p->err) {
+        int minimize = alias_reversed(t) ? 1 : 0;
+
+        ret->v.xval = user_multistart(b, sf, sg, opts, out, p->dset,
+                                      minimize, p->prn, &p->err);
+    }
+
+    return ret;
+}
+
+static NODE *BFGS_maximize (NODE *l, NODE *m, NODE *r,
+                            parser *p, NODE *t)
+{
+    NODE *ret = NULL;
+
+    if (starting(p)) {
+        gretl_matrix *b;
+        const char *sf = m->v.str;
+        const char *sg = NULL;
+
+        b = mat_node_get_real_matrix(l, p);
+
+        if (!p->err) {
+            if (r->t == STR) {
+                sg = r->v.str;
+            } else if (r->t != EMPTY) {
+                p->err = e_types(r);
+            }
+        }
+        if (!p->err && !is_function_call(sf)) {
+            p->err = E_TYPES;
+        }
+        if (!p->err && sg != NULL && !is_function_call(sg)) {
+            p->err = E_TYPES;
+        }
+        if (!p->err && gretl_is_null_matrix(b)) {
+            p->err = E_DATA;
         }
-        if (!p->err && !is_function_call(sf)) {
-            p->err = E_TYPES;
-        }
-        if (!p->err && sg != NULL && !is_function_call(sg)) {
-            p->err = E_TYPES;
-        }
-        if (!p->err && gretl_is_null_matrix(b)) {
-            p->err = E_DATA;
-        }
         if (p->err) {
             return NULL;
         }
@@ -4174,6 +4618,47 @@ static NODE *matrix_scalar_func (NODE *l, NODE *r,
     return ret;
 }
 
+/* msortby() with a vector of (1-based) key columns */
+
+static NODE *msortby_multi_node (NODE *l, NODE *r, parser *p)
+{
+    NODE *ret = aux_matrix_node(p);
+
+    if (ret != NULL && starting(p)) {
+        gretl_matrix *m = l->v.m;
+        gretl_matrix *v = r->v.m;
+        int *cols = NULL;
+        int i, k, n;
+
+        n = gretl_vector_get_length(v);
+        if (n == 0 || gretl_is_null_matrix(m)) {
+            p->err = E_INVARG;
+        } else if (m->is_complex) {
+            p->err = E_CMPLX;
+        } else {
+            cols = gretl_list_new(n);
+            if (cols == NULL) {
+                p->err = E_ALLOC;
+            }
+        }
+        for (i=0; i<n && !p->err; i++) {
+            k = gretl_int_from_double(v->val[i], &p->err);
+            if (!p->err && (k < 1 || k > m->cols)) {
+                p->err = E_INVARG;
+            }
+            if (!p->err) {
+                cols[i+1] = k - 1;
+            }
+        }
+        if (!p->err) {
+            ret->v.m = gretl_matrix_sort_by_columns(m, cols, &p->err);
+        }
+        free(cols);
+    }
+
+    return ret;
+}
+
 static NODE *matrix_vector_func (NODE *l, NODE *m, NODE *r,
                                  int f, parser *p)
 {
@@ -4313,6 +4798,96 @@ static NODE *matrix_matrix_calc (NODE *l, NODE *r, int op, parser *p)
     return ret;
 }
 
+#define unary_transpose(n) (n->t == B_TRMUL && n->R != NULL && \
+                            n->R->t == EMPTY)
+
+/* Handle products of the forms X*Y', X'*Y and X'*Y', where X
+   and Y are named real matrices, by passing the transposition
+   flags to gretl_matrix_multiply_mod() rather than forming the
+   transpose(s) as temporaries. When X and Y are one and the same
+   the product of a matrix and its own transpose is then computed
+   via syrk. Returns NULL, without setting an error, if @t does
+   not fit this pattern, in which case regular evaluation of @t
+   should proceed.
+*/
+
+static NODE *lazy_transpose_mul (NODE *t, parser *p)
+{
+    GretlMatrixMod amod = GRETL_MOD_NONE;
+    GretlMatrixMod bmod = GRETL_MOD_NONE;
+    const gretl_matrix *A, *B;
+    NODE *l = t->L;
+    NODE *r = t->R;
+    NODE *ret;
+    int ra, ca, rb, cb;
+
+    if (unary_transpose(l)) {
+        amod = GRETL_MOD_TRANSPOSE;
+        l = l->L;
+    }
+    if (unary_transpose(r)) {
+        bmod = GRETL_MOD_TRANSPOSE;
+        r = r->L;
+    }
+    if ((amod == GRETL_MOD_NONE && bmod == GRETL_MOD_NONE) ||
+        l->t != MAT || r->t != MAT) {
+        return NULL;
+    }
+
+    if (!starting(p)) {
+        /* the product is already in place */
+        return get_aux_node(p, MAT, 0, TMP_NODE);
+    }
+
+    /* terminal nodes: this just refreshes their data */
+    l = eval(l, p);
+    r = eval(r, p);
+    if (p->err) {
+        return NULL;
+    }
+
+    A = l->v.m;
+    B = r->v.m;
+    if (A->is_complex || B->is_complex ||
+        gretl_is_null_matrix(A) || gretl_is_null_matrix(B) ||
+        gretl_matrix_is_scalar(A) || gretl_matrix_is_scalar(B)) {
+        return NULL;
+    }
+
+    ra = amod ? A->cols : A->rows;
+    ca = amod ? A->rows : A->cols;
+    rb = bmod ? B->cols : B->rows;
+    cb = bmod ? B->rows : B->cols;
+    if (ca != rb) {
+        p->err = E_NONCONF;
+        return NULL;
+    }
+
+    p->flags |= P_MSAVE;
+    ret = get_aux_node(p, MAT, 0, TMP_NODE);
+    p->flags ^= P_MSAVE;
+
+    if (ret != NULL) {
+        gretl_matrix *C = calc_get_matrix(&ret->v.m, ra, cb);
+
+        if (C == NULL) {
+            p->err = E_ALLOC;
+        } else {
+            p->err = gretl_matrix_multiply_mod(A, amod, B, bmod,
+                                               C, GRETL_MOD_NONE);
+            if (!p->err && amod == GRETL_MOD_NONE) {
+                gretl_matrix_transcribe_obs_info(C, A);
+            }
+            if (ret->v.m != NULL && ret->v.m != C) {
+                gretl_matrix_free(ret->v.m);
+            }
+            ret->v.m = C;
+        }
+    }
+
+    return ret;
+}
+
 static NODE *matrix_and_or (NODE *l, NODE *r, int op, parser *p)
 {
     NODE *ret = aux_matrix_node(p);
@@ -5041,7 +5616,12 @@ static int check_matrix_file (const char *fname, int *csv)
     return 0;
 }
 
-static NODE *read_object_func (NODE *n, NODE *r, int f, parser *p)
+/* mread() or bread(): @n holds the filename, @r the optional
+   import flag and, for mread(), @k the optional name of a
+   matrix within a binary file */
+
+static NODE *read_object_func (NODE *n, NODE *r, NODE *k,
+                               int f, parser *p)
 {
     NODE *ret;
 
@@ -5078,7 +5658,10 @@ static NODE *read_object_func (NODE *n, NODE *r, int f, parser *p)
 
         switch (f) {
         case F_MREAD:
-            if (csv) {
+            if (k != NULL && k->t == STR) {
+                ret->v.m = gretl_matrix_read_member(realpath, k->v.str,
+                                                    &p->err);
+            } else if (csv) {
                 ret->v.m = import_csv_as_matrix(realpath, &p->err);
             } else if (gdt) {
                 set_dset_matrix_target(&ret->v.m);
@@ -6308,6 +6891,7 @@ static NODE *apply_scalar_func (NODE *n, NODE *f, parser *p)
     if (ret != NULL) {
         double (*dfunc) (double) = f->v.ptr;
 
+        gstat_fcall(f->t);
         if (dfunc != NULL) {
             ret->v.xval = dfunc(n->v.xval);
         } else {
@@ -6378,46 +6962,1087 @@ static NODE *matrix_isnan_node (NODE *n, parser *p)
     return ret;
 }
 
-static NODE *apply_series_func (NODE *n, NODE *f, parser *p)
+static NODE *apply_series_func (NODE *n, NODE *f, parser *p)
+{
+    NODE *ret = aux_series_node(p);
+    int t;
+
+    if (ret != NULL) {
+        double (*dfunc) (double) = f->v.ptr;
+        const double *x;
+
+        if (n->t == SERIES) {
+            if (n->v.xvec == NULL) {
+                fprintf(stderr, "apply_series_func: got NULL xvec\n");
+                p->err = E_DATA;
+            } else {
+                x = n->v.xvec;
+            }
+        } else {
+            x = get_colvec_as_series(n, f->t, p);
+        }
+
+        if (!p->err) {
+            int t1 = p->dset->t1;
+            int t2 = p->dset->t2;
+            double *z = ret->v.xvec;
+#if defined(_OPENMP)
+            int mt = series_use_openmp(f->t, t2 - t1 + 1,
+                                       SERIES_FUNC_COST, p);
+#endif
+
+            gstat_fcall(f->t);
+            if (autoreg(p)) {
+                if (dfunc != NULL) {
+                    z[p->obs] = dfunc(x[p->obs]);
+                } else {
+                    z[p->obs] = real_apply_func(x[p->obs], f->t, p);
+                }
+            } else if (dfunc != NULL) {
+#if defined(_OPENMP)
+#pragma omp parallel for private(t) if (mt)
+#endif
+                for (t=t1; t<=t2; t++) {
+                    z[t] = dfunc(x[t]);
+                }
+            } else {
+#if defined(_OPENMP)
+#pragma omp parallel for private(t) if (mt)
+#endif
+                for (t=t1; t<=t2; t++) {
+                    z[t] = real_apply_func(x[t], f->t, p);
+                }
+            }
+        }
+    }
+
+    return ret;
+}
+
+/* Fusion of elementwise series expressions. A subtree built from
+   the arithmetic operators and one-argument numeric functions, whose
+   leaves are terminal series or scalars, is compiled into a postfix
+   program that is run in a single pass over the sample range. This
+   avoids the full-length temporary series that node-by-node
+   evaluation allocates for each intermediate result, along with the
+   associated passes over memory. The per-element arithmetic is done
+   by xy_calc() and the same function calls as apply_series_func(),
+   so results (including the handling of NAs) are unchanged.
+*/
+
+#define FUSE_MAXLEN 64 /* max number of program steps */
+#define FUSE_MAXDEPTH 16 /* max depth of evaluation stack */
+
+typedef struct fuse_step_ {
+    int op;                   /* operator or function; 0 for a leaf */
+    NODE *f;                  /* function node, if applicable */
+    const double *x;          /* series leaf */
+    double val;               /* scalar leaf */
+} fuse_step;
+
+static int fusible_binary (int op)
+{
+    return op == B_ADD || op == B_SUB || op == B_MUL ||
+        op == B_DIV || op == B_POW;
+}
+
+static int fusible_unary (int f)
+{
+    switch (f) {
+    case U_NEG:
+    case U_POS:
+    case F_ABS:
+    case F_SGN:
+    case F_TOINT:
+    case F_CEIL:
+    case F_FLOOR:
+    case F_ROUND:
+    case F_SIN:
+    case F_COS:
+    case F_TAN:
+    case F_ASIN:
+    case F_ACOS:
+    case F_ATAN:
+    case F_SINH:
+    case F_COSH:
+    case F_TANH:
+    case F_ASINH:
+    case F_ACOSH:
+    case F_ATANH:
+    case F_LOG:
+    case F_LOG10:
+    case F_LOG2:
+    case F_EXP:
+    case F_SQRT:
+    case F_CNORM:
+    case F_DNORM:
+    case F_QNORM:
+    case F_LOGISTIC:
+    case F_GAMMA:
+    case F_LNGAMMA:
+    case F_DIGAMMA:
+    case F_TRIGAMMA:
+    case F_INVMILLS:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+/* Check whether the subtree @t is fusible. Returns the depth of
+   evaluation stack it requires, or -1 if it cannot be fused. The
+   counts of program steps, operations and series leaves are
+   incremented in @nsteps, @nops and @nser respectively.
+*/
+
+static int fuse_check (NODE *t, int *nsteps, int *nops, int *nser,
+                       parser *p)
+{
+    int dl, dr;
+
+    if (t->t == SERIES) {
+        if (t->v.xvec == NULL || strvals_node(t, p)) {
+            return -1;
+        }
+        *nsteps += 1;
+        *nser += 1;
+        return 1;
+    } else if (t->t == NUM || t->t == CSE) {
+        /* a common subexpression may turn out to be a scalar, so
+           it doesn't count as a series leaf */
+        *nsteps += 1;
+        return 1;
+    } else if (fusible_binary(t->t)) {
+        dl = fuse_check(t->L, nsteps, nops, nser, p);
+        dr = (dl < 0)? -1 : fuse_check(t->R, nsteps, nops, nser, p);
+        *nsteps += 1;
+        *nops += 1;
+        return (dr < 0)? -1 : MAX(dl, dr + 1);
+    } else if (fusible_unary(t->t) && t->L != NULL && t->R == NULL) {
+        *nsteps += 1;
+        *nops += 1;
+        return fuse_check(t->L, nsteps, nops, nser, p);
+    } else {
+        return -1;
+    }
+}
+
+static int series_free_subtree (NODE *t)
+{
+    if (t->t == SERIES || t->t == CSE) {
+        return 0;
+    } else if (t->L != NULL && !series_free_subtree(t->L)) {
+        return 0;
+    } else if (t->R != NULL && !series_free_subtree(t->R)) {
+        return 0;
+    } else {
+        return 1;
+    }
+}
+
+/* Write the postfix program for @t into @prog, starting at
+   position @n; returns the new position, or -1 on error.
+   Terminal nodes are "evaluated" to refresh their data, and a
+   subtree that involves no series is evaluated as a scalar and
+   entered as a single leaf.
+*/
+
+static int fuse_compile (NODE *t, fuse_step *prog, int n, parser *p)
+{
+    NODE *e;
+
+    if (t->t == CSE) {
+        e = eval(t, p);
+        if (p->err || (e->t != NUM && e->t != SERIES)) {
+            return -1;
+        }
+        prog[n].op = 0;
+        prog[n].x = e->t == SERIES ? e->v.xvec : NULL;
+        prog[n].val = e->t == NUM ? e->v.xval : NADBL;
+        return n + 1;
+    } else if (t->t != SERIES && series_free_subtree(t)) {
+        e = eval(t, p);
+        if (p->err) {
+            return -1;
+        }
+        prog[n].op = 0;
+        prog[n].x = NULL;
+        prog[n].val = e->v.xval;
+        return n + 1;
+    } else if (t->t == SERIES) {
+        e = eval(t, p);
+        if (p->err) {
+            return -1;
+        }
+        prog[n].op = 0;
+        prog[n].x = e->v.xvec;
+        return n + 1;
+    }
+
+    n = fuse_compile(t->L, prog, n, p);
+    if (n > 0 && fusible_binary(t->t)) {
+        n = fuse_compile(t->R, prog, n, p);
+    }
+    if (n > 0) {
+        prog[n].op = t->t;
+        prog[n].f = t;
+        n++;
+    }
+
+    return n;
+}
+
+/* Returns NULL, without setting an error, if @t is not a
+   candidate for fusion, in which case @t should be evaluated in
+   the regular way.
+*/
+
+static NODE *fused_series_node (NODE *t, parser *p)
+{
+    fuse_step prog[FUSE_MAXLEN];
+    double stack[FUSE_MAXDEPTH];
+    double (*dfunc) (double);
+    NODE *ret;
+    int nsteps = 0;
+    int nops = 0;
+    int nser = 0;
+    int i, k, n, s, t1, t2;
+#if defined(_OPENMP)
+    int mt;
+#endif
+
+    if (p->dset == NULL || p->dset->n == 0 || autoreg(p) ||
+        p->targ == LIST || p->dset->n > p->dset_n) {
+        return NULL;
+    }
+
+    k = fuse_check(t, &nsteps, &nops, &nser, p);
+    if (k < 0 || k > FUSE_MAXDEPTH || nsteps > FUSE_MAXLEN ||
+        nser == 0 || nops < 2) {
+        /* not fusible, or too complex, or not enough to gain */
+        return NULL;
+    }
+
+    n = fuse_compile(t, prog, 0, p);
+    if (n < 0) {
+        return NULL;
+    }
+
+    /* note: evaluation of the leaves will have moved p->aux */
+    p->aux = t->aux;
+    ret = aux_series_node(p);
+    if (ret == NULL) {
+        return NULL;
+    }
+
+    t1 = p->dset->t1;
+    t2 = p->dset->t2;
+
+    if (gstats_on) {
+        gstats.fused += 1;
+        for (k=0; k<n; k++) {
+            if (prog[k].op != 0 && !fusible_binary(prog[k].op)) {
+                gstat_fcall(prog[k].op);
+            }
+        }
+    }
+
+#if defined(_OPENMP)
+    for (k=0; k<n; k++) {
+        if (prog[k].op != 0 && !series_mt_ok(prog[k].op)) {
+            break;
+        }
+    }
+    mt = (k == n) && series_use_openmp(t->t, t2 - t1 + 1, nops, p);
+#pragma omp parallel for private(i, k, s, stack, dfunc) if (mt)
+#endif
+    for (i=t1; i<=t2; i++) {
+        s = 0;
+        for (k=0; k<n; k++) {
+            if (prog[k].op == 0) {
+                stack[s++] = prog[k].x != NULL ? prog[k].x[i] : prog[k].val;
+            } else if (fusible_binary(prog[k].op)) {
+                s--;
+                stack[s-1] = xy_calc(stack[s-1], stack[s], prog[k].op,
+                                     SERIES, p);
+            } else {
+                dfunc = prog[k].f->v.ptr;
+                if (dfunc != NULL) {
+                    stack[s-1] = dfunc(stack[s-1]);
+                } else {
+                    stack[s-1] = real_apply_func(stack[s-1], prog[k].op, p);
+                }
+            }
+        }
+        ret->v.xvec[i] = stack[0];
+    }
+
+    return ret;
+}
+
+/* Optimization of the syntax tree, done once after parsing (so a
+   compiled tree is optimized just once). First, subtrees built from
+   the arithmetic operators and one-argument numeric functions whose
+   operands are all numeric literals are folded into a single literal.
+   Second, if a "pure" subexpression -- operators and side-effect free
+   functions applied to named variables and literals -- occurs more
+   than once in the tree, its first occurrence is moved under a CSE
+   node and the others are replaced by CSE nodes that refer to it. The
+   shared subexpression is then evaluated at most once per evaluation
+   of the tree, and the CSE nodes pass on its value via "fragile" aux
+   nodes (see the comment on aux nodes above) so that no copy is made.
+   Since the shared value is computed when first needed, this works
+   in the context of conditional evaluation (ternary "?" and the
+   logical operators).
+*/
+
+#define TREE_OPT_DEBUG 0
+#define CSE_MAXNODES 512 /* don't look for CSEs in a bigger tree */
+#define CSE_MAXREPL 32   /* max number of distinct CSEs per tree */
+
+/* evaluation counter, used to determine whether the value of a
+   shared subexpression is current */
+static int cse_pass;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(cse_pass)
+#endif
+
+#define literal_node(n) (n != NULL && n->t == NUM && n->vname == NULL)
+
+static void fold_constants (NODE *t, parser *p)
+{
+    double x;
+    int i;
+
+    if (t == NULL || p->err) {
+        return;
+    } else if (bnsym(t->t)) {
+        for (i=0; i<t->v.bn.n_nodes; i++) {
+            fold_constants(t->v.bn.n[i], p);
+        }
+        return;
+    }
+
+    fold_constants(t->L, p);
+    fold_constants(t->M, p);
+    fold_constants(t->R, p);
+
+    if (fusible_binary(t->t) && literal_node(t->L) && literal_node(t->R)) {
+        x = xy_calc(t->L->v.xval, t->R->v.xval, t->t, NUM, p);
+    } else if (fusible_unary(t->t) && literal_node(t->L) && t->R == NULL) {
+        double (*dfunc) (double) = t->v.ptr;
+
+        if (dfunc != NULL) {
+            x = dfunc(t->L->v.xval);
+        } else {
+            x = real_apply_func(t->L->v.xval, t->t, p);
+        }
+    } else {
+        return;
+    }
+
+    if (p->err) {
+        /* leave it to be reported on evaluation */
+        p->err = 0;
+        return;
+    }
+
+#if TREE_OPT_DEBUG
+    fprintf(stderr, "fold_constants: %s -> %g\n", getsymb(t->t), x);
+#endif
+
+    free_tree(t->L, p, FR_TREE);
+    free_tree(t->R, p, FR_TREE);
+    t->L = t->R = NULL;
+    t->t = NUM;
+    t->v.xval = x;
+}
+
+static int cse_pure_op (int f)
+{
+    switch (f) {
+    case B_ADD:
+    case B_SUB:
+    case B_MUL:
+    case B_DIV:
+    case B_POW:
+    case B_TRMUL:
+    case B_DOTMULT:
+    case B_DOTDIV:
+    case B_DOTPOW:
+    case B_DOTADD:
+    case B_DOTSUB:
+    case B_KRON:
+    case B_LDIV:
+    case F_TRANSP:
+    case F_INV:
+    case F_DET:
+    case F_LDET:
+    case F_SUM:
+    case F_MEAN:
+    case F_SUMC:
+    case F_SUMR:
+    case F_MEANC:
+    case F_MEANR:
+    case F_QFORM:
+        return 1;
+    default:
+        return fusible_unary(f);
+    }
+}
+
+/* operators whose operands may be replaced by CSE nodes */
+
+static int cse_parent_ok (int f)
+{
+    return cse_pure_op(f) || f == U_NOT || f == QUERY ||
+        (f >= B_EQ && f <= B_OR) || (f >= B_DOTEQ && f <= B_DOTNEQ);
+}
+
+#define cse_leaf(n) (n->t == NUM || n->t == SERIES || \
+                     n->t == MAT || n->t == EMPTY)
+
+static int cse_pure (NODE *t)
+{
+    if (t == NULL) {
+        return 1;
+    } else if (cse_leaf(t)) {
+        return 1;
+    } else if (cse_pure_op(t->t)) {
+        return cse_pure(t->L) && cse_pure(t->M) && cse_pure(t->R);
+    } else {
+        return 0;
+    }
+}
+
+/* Check that the tree as a whole is not too big and that it
+   contains nothing that could modify a variable (or the dataset)
+   in the course of evaluation.
+*/
+
+static int cse_tree_ok (NODE *t, int *nn)
+{
+    int i;
+
+    if (t == NULL) {
+        return 1;
+    } else if (++(*nn) > CSE_MAXNODES || (t->flags & LHT_NODE)) {
+        return 0;
+    }
+
+    switch (t->t) {
+    case UFUN:
+    case RFUN:
+    case U_ADDR:
+    case NUM_P:
+    case NUM_M:
+    case INC:
+    case DEC:
+    case B_ASN:
+    case B_DOTASN:
+    case F_GENSERIES:
+    case F_FEVAL:
+    case F_FEVALB:
+    case F_SPAWN:
+    case F_AWAIT:
+    case F_MPIMAP:
+    case F_PERMTEST:
+        return 0;
+    default:
+        break;
+    }
+
+    if (bnsym(t->t)) {
+        for (i=0; i<t->v.bn.n_nodes; i++) {
+            if (!cse_tree_ok(t->v.bn.n[i], nn)) {
+                return 0;
+            }
+        }
+        return 1;
+    } else {
+        return cse_tree_ok(t->L, nn) && cse_tree_ok(t->M, nn) &&
+            cse_tree_ok(t->R, nn);
+    }
+}
+
+static int same_subtree (NODE *a, NODE *b)
+{
+    if (a == NULL || b == NULL) {
+        return a == b;
+    } else if (a->t != b->t) {
+        return 0;
+    } else if (a->vname != NULL || b->vname != NULL) {
+        return a->vname != NULL && b->vname != NULL &&
+            a->vnum == b->vnum && !strcmp(a->vname, b->vname);
+    } else if (a->t == NUM) {
+        return a->v.xval == b->v.xval;
+    } else if (cse_leaf(a)) {
+        /* an anonymous matrix (or other) value: its content is
+           not examined, so only the node itself will do */
+        return a == b;
+    } else {
+        return same_subtree(a->L, b->L) && same_subtree(a->M, b->M) &&
+            same_subtree(a->R, b->R);
+    }
+}
+
+/* Record, in pre-order, the addresses of the pointers to candidate
+   subtrees: pure, not terminal, and an operand of an operator that
+   can handle a CSE node. We don't look inside existing CSEs.
+*/
+
+static void cse_collect (NODE **pt, int pok, NODE ***slots, int *n)
+{
+    NODE *t = *pt;
+    int i, ok;
+
+    if (t == NULL || t->t == CSE) {
+        return;
+    } else if (pok && !cse_leaf(t) && cse_pure(t) &&
+               !(unary_transpose(t) && cse_leaf(t->L))) {
+        /* note: a bare transpose is best left to lazy_transpose_mul() */
+        slots[*n] = pt;
+        *n += 1;
+    }
+
+    if (bnsym(t->t)) {
+        for (i=0; i<t->v.bn.n_nodes; i++) {
+            cse_collect(&t->v.bn.n[i], 0, slots, n);
+        }
+    } else {
+        ok = cse_parent_ok(t->t);
+        cse_collect(&t->L, ok, slots, n);
+        cse_collect(&t->M, ok, slots, n);
+        cse_collect(&t->R, ok, slots, n);
+    }
+}
+
+static void hoist_common_subexprs (parser *p)
+{
+    NODE **slots[CSE_MAXNODES];
+    NODE **match[CSE_MAXNODES];
+    NODE *tgt, *owner, *ref;
+    int nrep = 0, nn = 0;
+    int i, j, n, nm;
+
+    if (autoreg(p) || p->targ == LIST || !cse_tree_ok(p->tree, &nn)) {
+        return;
+    }
+
+    while (nrep < CSE_MAXREPL) {
+        n = nm = 0;
+        cse_collect(&p->tree, 0, slots, &n);
+        for (i=0; i<n && nm == 0; i++) {
+            tgt = *slots[i];
+            for (j=i+1; j<n; j++) {
+                if (find_in_tree(tgt, *slots[j]) ||
+                    (nm > 0 && find_in_tree(*match[nm-1], *slots[j]))) {
+                    /* nested in the target or a prior match */
+                    continue;
+                } else if (same_subtree(tgt, *slots[j])) {
+                    match[nm++] = slots[j];
+                }
+            }
+        }
+        if (nm == 0) {
+            break;
+        }
+
+        /* the first occurrence goes under the "owner" CSE node */
+        owner = new_node(CSE);
+        if (owner == NULL) {
+            p->err = E_ALLOC;
+            return;
+        }
+        tgt = *slots[i-1];
+        owner->L = tgt;
+        *slots[i-1] = owner;
+
+#if TREE_OPT_DEBUG
+        fprintf(stderr, "hoist_common_subexprs: %s subtree, %d uses\n",
+                getsymb(tgt->t), nm + 1);
+#endif
+
+        /* and the duplicates are replaced by references */
+        for (j=0; j<nm; j++) {
+            ref = new_node(CSE);
+            if (ref == NULL) {
+                p->err = E_ALLOC;
+                return;
+            }
+            free_tree(*match[j], p, FR_TREE);
+            ref->v.ptr = owner;
+            *match[j] = ref;
+        }
+        nrep++;
+    }
+}
+
+static void optimize_tree (parser *p)
+{
+    fold_constants(p->tree, p);
+    if (!p->err) {
+        hoist_common_subexprs(p);
+    }
+}
+
+/* Evaluation of a CSE node @t: the CSE "owner" (the node that
+   holds the shared subtree) stores a pointer to the result of its
+   most recent evaluation and the pass on which it was obtained.
+*/
+
+static NODE *cse_node (NODE *t, parser *p)
+{
+    NODE *owner = t->L != NULL ? t : t->v.ptr;
+    NODE *e, *ret = NULL;
+
+    if (owner->vnum != cse_pass) {
+        owner->L->parent = owner;
+        e = eval(owner->L, p);
+        if (e == NULL || p->err) {
+            if (!p->err) {
+                p->err = E_DATA;
+            }
+            return NULL;
+        }
+        owner->v.ptr = e;
+        owner->vnum = cse_pass;
+    } else {
+        e = owner->v.ptr;
+        gstat_inc(cse_hits);
+    }
+
+    p->aux = t->aux;
+
+    if (e->t == NUM) {
+        ret = aux_scalar_node(p);
+        if (ret != NULL) {
+            ret->v.xval = e->v.xval;
+        }
+    } else if (e->t == SERIES) {
+        ret = get_aux_node(p, SERIES, 0, 0);
+        if (ret != NULL) {
+            ret->v.xvec = e->v.xvec;
+        }
+    } else if (e->t == MAT) {
+        ret = matrix_pointer_node(p);
+        if (ret != NULL) {
+            ret->v.m = e->v.m;
+        }
+    } else {
+        p->err = e_types(e);
+    }
+
+    return ret;
+}
+
+/* A register-based bytecode engine for compiled genrs whose
+   right-hand side is a scalar expression: numeric literals and
+   scalar variables combined via the arithmetic, comparison and
+   logical operators and the one-argument numeric functions. Each
+   node of the tree gets a register; literals are written into
+   their registers once and for all, and the program consists of
+   loads of scalar variables plus operations whose type is fixed
+   at compile time, so that executing it bypasses the dispatch,
+   type checking and aux-node handling of eval(). The program is
+   built on the first execution of a compiled genr (loop lines,
+   function bodies) and anything it cannot handle -- including a
+   change of type of one of its variables -- is passed back to the
+   tree walker.
+*/
+
+#define GENVM_DEBUG 0
+#define GENVM_MAXREG 256
+
+struct genvm_ {
+    int ok;       /* 0 if the tree is not suitable */
+    int nreg;     /* number of registers */
+    int ninst;    /* number of instructions */
+    int ret;      /* register holding the result */
+    double *reg;
+    genvm_inst *inst;
+    int jit_tried;
+    genvm_native native; /* native code, under "set jit on" */
+    void *jit;           /* apparatus behind @native */
+};
+
+/* compile-time state */
+
+typedef struct {
+    double reg[GENVM_MAXREG];
+    genvm_inst inst[GENVM_MAXREG];
+    NODE *cse[CSE_MAXREPL];
+    int cse_reg[CSE_MAXREPL];
+    int nreg, ninst, ncse;
+    int cond;
+} genvm_ctx;
+
+static int genvm_scalar_binary (int f)
+{
+    return f == B_ADD || f == B_SUB || f == B_MUL || f == B_DIV ||
+        f == B_MOD || f == B_POW || f == B_AND || f == B_OR ||
+        f == B_EQ || f == B_NEQ || f == B_GT || f == B_LT ||
+        f == B_GTE || f == B_LTE;
+}
+
+static int genvm_emit (genvm_ctx *c, int op, int f, int dst,
+                       int a, int b, void *ptr)
+{
+    genvm_inst *in;
+
+    if (c->ninst == GENVM_MAXREG) {
+        return -1;
+    } else if (dst < 0) {
+        if (c->nreg == GENVM_MAXREG) {
+            return -1;
+        }
+        dst = c->nreg++;
+    }
+
+    in = &c->inst[c->ninst++];
+    in->op = op;
+    in->f = f;
+    in->dst = dst;
+    in->a = a;
+    in->b = b;
+    in->ptr = ptr;
+
+    return dst;
+}
+
+/* Returns the register that will hold the value of @t, or -1
+   if @t cannot be handled.
+*/
+
+static int genvm_compile (NODE *t, genvm_ctx *c)
+{
+    int a, b, i, op;
+
+    if (t->t == NUM && t->vname == NULL) {
+        if (c->nreg == GENVM_MAXREG) {
+            return -1;
+        }
+        c->reg[c->nreg] = t->v.xval;
+        return c->nreg++;
+    } else if (t->t == NUM) {
+        return genvm_emit(c, VM_LOAD, 0, -1, 0, 0, t);
+    } else if (t->t == CSE) {
+        NODE *owner = t->L != NULL ? t : t->v.ptr;
+
+        if (c->cond) {
+            /* the value might be computed on a skipped path */
+            return -1;
+        }
+        for (i=0; i<c->ncse; i++) {
+            if (c->cse[i] == owner) {
+                return c->cse_reg[i];
+            }
+        }
+        if (c->ncse == CSE_MAXREPL) {
+            return -1;
+        }
+        a = genvm_compile(owner->L, c);
+        if (a >= 0) {
+            c->cse[c->ncse] = owner;
+            c->cse_reg[c->ncse++] = a;
+        }
+        return a;
+    } else if (genvm_scalar_binary(t->t) && t->L != NULL &&
+               t->R != NULL && t->M == NULL) {
+        if ((a = genvm_compile(t->L, c)) < 0) {
+            return -1;
+        }
+        if (t->t == B_AND || t->t == B_OR) {
+            /* as in eval(), the right-hand term may not be needed */
+            int skip = c->ninst;
+            int op = t->t == B_AND ? VM_SKIPF : VM_SKIPT;
+            int dst = genvm_emit(c, op, t->t, -1, a, 0, NULL);
+
+            if (dst < 0) {
+                return -1;
+            }
+            c->cond++;
+            b = genvm_compile(t->R, c);
+            c->cond--;
+            if (b < 0 || genvm_emit(c, VM_CALC, t->t, dst, a, b, NULL) < 0) {
+                return -1;
+            }
+            c->inst[skip].b = c->ninst;
+            return dst;
+        }
+        if ((b = genvm_compile(t->R, c)) < 0) {
+            return -1;
+        }
+        op = t->t == B_ADD ? VM_ADD : t->t == B_SUB ? VM_SUB :
+            t->t == B_MUL ? VM_MUL : t->t == B_DIV ? VM_DIV : VM_CALC;
+        return genvm_emit(c, op, t->t, -1, a, b, NULL);
+    } else if ((fusible_unary(t->t) || t->t == U_NOT) &&
+               t->L != NULL && t->M == NULL && t->R == NULL) {
+        if ((a = genvm_compile(t->L, c)) < 0) {
+            return -1;
+        }
+        return genvm_emit(c, VM_FUNC, t->t, -1, a, 0, t->v.ptr);
+    } else {
+        return -1;
+    }
+}
+
+static void genvm_destroy (genvm *vm)
+{
+    if (vm != NULL) {
+        if (vm->jit != NULL) {
+            void (*jdestroy) (void *);
+
+            jdestroy = get_plugin_function("genvm_jit_destroy");
+            if (jdestroy != NULL) {
+                jdestroy(vm->jit);
+            }
+        }
+        free(vm->reg);
+        free(vm->inst);
+        free(vm);
+    }
+}
+
+/* Returns NULL if the program cannot be built right now; otherwise
+   a program which may be flagged as not usable.
+*/
+
+static genvm *genvm_build (parser *p)
+{
+    genvm_ctx *c;
+    genvm *vm;
+    NODE *t = p->tree;
+    int r = -1;
+
+    if (t == NULL || t->aux == NULL) {
+        /* the tree has not yet been evaluated */
+        return NULL;
+    }
+
+    vm = calloc(1, sizeof *vm);
+    c = calloc(1, sizeof *c);
+    if (vm == NULL || c == NULL) {
+        free(vm);
+        free(c);
+        return NULL;
+    }
+
+    if (t->t != NUM && t->t != CSE) {
+        r = genvm_compile(t, c);
+    }
+
+    if (r >= 0 && c->ninst > 0) {
+        vm->reg = malloc(c->nreg * sizeof *vm->reg);
+        vm->inst = malloc(c->ninst * sizeof *vm->inst);
+        if (vm->reg == NULL || vm->inst == NULL) {
+            genvm_destroy(vm);
+            free(c);
+            return NULL;
+        }
+        memcpy(vm->reg, c->reg, c->nreg * sizeof *vm->reg);
+        memcpy(vm->inst, c->inst, c->ninst * sizeof *vm->inst);
+        vm->nreg = c->nreg;
+        vm->ninst = c->ninst;
+        vm->ret = r;
+        vm->ok = 1;
+    }
+
+#if GENVM_DEBUG
+    fprintf(stderr, "genvm_build: '%s': ok = %d, %d registers, "
+            "%d instructions\n", p->input, vm->ok, vm->nreg, vm->ninst);
+#endif
+
+    free(c);
+
+    return vm;
+}
+
+/* Returns 0 on success or -1 if the tree walker should take over,
+   in which case nothing has been changed.
+*/
+
+static int genvm_load (genvm_inst *in, double *reg)
+{
+    NODE *n = in->ptr;
+    user_var *uv = n->uv;
+
+    if (uv == NULL || user_qsorting) {
+        uv = n->uv = get_user_var_by_name(n->vname);
+    }
+    if (uv == NULL || uv->ptr == NULL || uv->type != GRETL_TYPE_DOUBLE) {
+        return -1;
+    }
+    reg[in->dst] = *(double *) uv->ptr;
+
+    return 0;
+}
+
+/* Run the bytecode of @vm, or its native translation if @jit is
+   non-zero and one is available.
+*/
+
+static int genvm_run (genvm *vm, parser *p, int jit)
+{
+    int natest = (p->flags & P_NATEST) != 0;
+    double *reg = vm->reg;
+    double (*dfunc) (double);
+    genvm_inst *in;
+    double x, y;
+    int pc = 0;
+
+    if (jit && vm->native != NULL) {
+        /* do the loads, then hand over to native code */
+        for (pc=0; pc<vm->ninst; pc++) {
+            in = &vm->inst[pc];
+            if (in->op == VM_LOAD && genvm_load(in, reg)) {
+                return -1;
+            }
+        }
+        vm->native(reg, p, natest);
+        return 0;
+    }
+
+    while (pc < vm->ninst) {
+        in = &vm->inst[pc++];
+        x = reg[in->a];
+        y = (in->op == VM_SKIPF || in->op == VM_SKIPT)? 0 : reg[in->b];
+        switch (in->op) {
+        case VM_LOAD:
+            if (genvm_load(in, reg)) {
+                return -1;
+            }
+            break;
+        case VM_ADD:
+            reg[in->dst] = (na(x) || na(y))? NADBL : x + y;
+            break;
+        case VM_SUB:
+            reg[in->dst] = (na(x) || na(y))? NADBL : x - y;
+            break;
+        case VM_MUL:
+            if (x == 0 || y == 0) {
+                /* 0 times anything is 0, for scalars */
+                reg[in->dst] = (natest && (na(x) || na(y)))? NADBL : 0;
+            } else {
+                reg[in->dst] = (na(x) || na(y))? NADBL : x * y;
+            }
+            break;
+        case VM_DIV:
+            reg[in->dst] = (na(x) || na(y))? NADBL : x / y;
+            break;
+        case VM_CALC:
+            reg[in->dst] = xy_calc(x, y, in->f, NUM, p);
+            break;
+        case VM_FUNC:
+            dfunc = in->ptr;
+            if (dfunc != NULL) {
+                reg[in->dst] = dfunc(x);
+            } else {
+                reg[in->dst] = real_apply_func(x, in->f, p);
+            }
+            break;
+        case VM_SKIPF:
+        case VM_SKIPT:
+            if ((in->op == VM_SKIPF && x == 0.0) ||
+                (in->op == VM_SKIPT && !na(x) && x != 0.0)) {
+                reg[in->dst] = x;
+                pc = in->b;
+            }
+            break;
+        default:
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/* callbacks for native code */
+
+static double genvm_calc (double x, double y, int f, void *p)
+{
+    return xy_calc(x, y, f, NUM, p);
+}
+
+static double genvm_apply (double x, int f, void *p)
+{
+    return real_apply_func(x, f, p);
+}
+
+/* Under "set jit on", try translating the program into native
+   code via the genjit plugin. On failure we just carry on with
+   the bytecode. The lookup of the plugin function is shared by
+   all threads, hence the lock.
+*/
+
+G_LOCK_DEFINE_STATIC(genvm_jit);
+
+static void genvm_try_jit (genvm *vm)
+{
+    static int (*jcompile) (const genvm_inst *, int, int,
+                            const genvm_jit_helpers *,
+                            genvm_native *, void **);
+    int (*jfunc) (const genvm_inst *, int, int,
+                  const genvm_jit_helpers *,
+                  genvm_native *, void **);
+    genvm_jit_helpers h = {genvm_calc, genvm_apply};
+
+    vm->jit_tried = 1;
+
+    G_LOCK(genvm_jit);
+    if (jcompile == NULL) {
+        jcompile = get_plugin_function("genvm_jit_compile");
+    }
+    jfunc = jcompile;
+    G_UNLOCK(genvm_jit);
+
+    if (jfunc == NULL) {
+        gretl_error_clear();
+        return;
+    }
+
+    if (jfunc(vm->inst, vm->ninst, vm->nreg, &h,
+              &vm->native, &vm->jit)) {
+        vm->native = NULL;
+        vm->jit = NULL;
+    }
+}
+
+/* Try executing the compiled genr @p via its bytecode program.
+   Returns 1 if this was done, 0 otherwise.
+*/
+
+static int genvm_exec (parser *p)
 {
-    NODE *ret = aux_series_node(p);
-    int t;
+    NODE *ret;
+    int jit;
 
-    if (ret != NULL) {
-        double (*dfunc) (double) = f->v.ptr;
-        const double *x;
+    if (p->vm == NULL) {
+        p->vm = genvm_build(p);
+    }
 
-        if (n->t == SERIES) {
-            if (n->v.xvec == NULL) {
-                fprintf(stderr, "apply_series_func: got NULL xvec\n");
-                p->err = E_DATA;
-            } else {
-                x = n->v.xvec;
-            }
-        } else {
-            x = get_colvec_as_series(n, f->t, p);
-        }
+    if (p->vm == NULL || !p->vm->ok) {
+        return 0;
+    }
 
-        if (!p->err) {
-            if (autoreg(p)) {
-                if (dfunc != NULL) {
-                    ret->v.xvec[p->obs] = dfunc(x[p->obs]);
-                } else {
-                    ret->v.xvec[p->obs] = real_apply_func(x[p->obs], f->t, p);
-                }
-            } else if (dfunc != NULL) {
-                for (t=p->dset->t1; t<=p->dset->t2; t++) {
-                    ret->v.xvec[t] = dfunc(x[t]);
-                }
-            } else {
-                for (t=p->dset->t1; t<=p->dset->t2; t++) {
-                    ret->v.xvec[t] = real_apply_func(x[t], f->t, p);
-                }
-            }
-        }
+    /* "set jit" may have changed since the last run */
+    jit = libset_get_bool(GENR_JIT);
+    if (jit && !p->vm->jit_tried) {
+        genvm_try_jit(p->vm);
     }
 
-    return ret;
+    ret = p->tree->aux;
+    if (ret == NULL || ret->t != NUM || is_proxy_node(ret)) {
+        return 0;
+    } else if (genvm_run(p->vm, p, jit) < 0) {
+        return 0;
+    }
+
+    ret->v.xval = p->vm->reg[p->vm->ret];
+    p->ret = ret;
+
+    return 1;
 }
 
 /* argument is series or list; value returned is list */
@@ -7397,6 +9022,113 @@ static NODE *augment_array_node (NODE *l, NODE *r, parser *p)
     return ret;
 }
 
+/* batched operations on arrays of matrices: cholesky()
+   on a single array, or msolve() on two
+*/
+
+static NODE *matrix_array_batch_node (NODE *l, NODE *r, int f,
+                                      parser *p)
+{
+    NODE *ret = aux_array_node(p);
+
+    if (ret != NULL && starting(p)) {
+        gretl_array *A = l->v.a;
+
+        if (f == F_CHOL) {
+            ret->v.a = gretl_matrix_array_cholesky(A, &p->err);
+        } else if (f == F_MSOLVE) {
+            ret->v.a = gretl_matrix_array_solve(A, r->v.a, &p->err);
+        } else {
+            p->err = E_TYPES;
+        }
+    }
+
+    return ret;
+}
+
+/* mmult(): matrix product, possibly batched on arrays of
+   matrices, with an optional flag to compute the product(s)
+   in single precision
+*/
+
+static NODE *mmult_node (NODE *l, NODE *m, NODE *r, parser *p)
+{
+    int use_float = node_get_bool(r, p, 0);
+    NODE *ret = NULL;
+
+    if (p->err) {
+        return NULL;
+    } else if (l->t == ARRAY && m->t == ARRAY) {
+        ret = aux_array_node(p);
+        if (ret != NULL && starting(p)) {
+            ret->v.a = gretl_matrix_array_multiply(l->v.a, m->v.a,
+                                                   use_float, &p->err);
+        }
+    } else if (!use_float) {
+        ret = matrix_matrix_calc(l, m, B_MUL, p);
+    } else {
+        ret = aux_matrix_node(p);
+        if (ret != NULL && starting(p)) {
+            gretl_matrix *A = node_get_real_matrix(l, p, 0, 1);
+            gretl_matrix *B = NULL;
+            int rc, cc;
+
+            if (!p->err) {
+                B = node_get_real_matrix(m, p, 1, 2);
+            }
+            if (p->err) {
+                return NULL;
+            }
+            rc = gretl_matrix_is_scalar(A) ? B->rows : A->rows;
+            cc = gretl_matrix_is_scalar(B) ? A->cols : B->cols;
+            ret->v.m = gretl_matrix_alloc(rc, cc);
+            if (ret->v.m == NULL) {
+                p->err = E_ALLOC;
+            } else {
+                p->err = gretl_matrix_multiply_mod_float(A, GRETL_MOD_NONE,
+                                                         B, GRETL_MOD_NONE,
+                                                         ret->v.m,
+                                                         GRETL_MOD_NONE);
+            }
+        }
+    }
+
+    return ret;
+}
+
+/* Rank-one update or downdate of the Cholesky factor @l using
+   the row(s) of @m, with optional boolean @r to select downdating.
+*/
+
+static NODE *cholupdate_node (NODE *l, NODE *m, NODE *r, parser *p)
+{
+    int downdate = node_get_bool(r, p, 0);
+    NODE *ret = NULL;
+
+    if (!p->err) {
+        ret = aux_matrix_node(p);
+    }
+
+    if (ret != NULL && starting(p)) {
+        gretl_matrix *L = node_get_real_matrix(l, p, 0, 1);
+        gretl_matrix *X = NULL;
+
+        if (!p->err) {
+            X = node_get_real_matrix(m, p, 1, 2);
+        }
+        if (!p->err) {
+            ret->v.m = gretl_matrix_copy(L);
+            if (ret->v.m == NULL) {
+                p->err = E_ALLOC;
+            } else {
+                p->err = gretl_cholesky_update(ret->v.m, X, downdate);
+            }
+        }
+    }
+
+    return ret;
+}
+
 static NODE *subtract_from_array_node (NODE *l, NODE *r, parser *p)
 {
     NODE *ret = aux_array_node(p);
@@ -9653,24 +11385,13 @@ static NODE *isodate_node (NODE *l, NODE *r, NODE *f, parser *p)
                                                    julian, &p->err);
         }
     } else if (ret != NULL) {
-        double xt, *targ;
         int t1 = l->t == MAT ? 0 : p->dset->t1;
         int t2 = l->t == MAT ? n-1 : p->dset->t2;
-        int t;
+        const double *src = l->t == MAT ? l->v.m->val : l->v.xvec;
+        double *targ = l->t == MAT ? ret->v.m->val : ret->v.xvec;
 
-        for (t=t1; t<=t2; t++) {
-            targ = l->t == MAT ? &ret->v.m->val[t] : &ret->v.xvec[t];
-            xt = l->t == MAT ? l->v.m->val[t] : l->v.xvec[t];
-            if (na(xt)) {
-                *targ = NADBL;
-            } else if (xt >= 1 && xt <= UINT_MAX) {
-                *targ = ymd_basic_from_epoch_day((guint32) xt,
-                                                 julian, &p->err);
-            } else {
-                p->err = E_INVARG;
-                break;
-            }
-        }
+        p->err = ymd_basic_from_epoch_days(src + t1, targ + t1,
+                                           t2 - t1 + 1, julian);
     }
 
     return ret;
@@ -10657,6 +12378,44 @@ static int deseasonalize (const double *x, double *y,
                           f == F_PXMEAN ||  \
                           f == F_PSD)
 
+/* hpfilt() applied to a list: the result is a matrix with one
+   column per member series, covering the current sample range
+*/
+
+static NODE *hp_filter_list_node (NODE *l, NODE *r, NODE *o,
+                                  parser *p)
+{
+    NODE *ret = NULL;
+    double lambda = NADBL;
+    int oneside = 0;
+
+    if (!dataset_is_time_series(p->dset)) {
+        gretl_errmsg_set(_("This function requires time-series data"));
+        p->err = E_DATA;
+        return NULL;
+    }
+
+    if (!null_node(r)) {
+        if (!scalar_node(r)) {
+            node_type_error(F_HPFILT, 2, NUM, r, p);
+        } else {
+            lambda = node_get_scalar(r, p);
+        }
+    }
+    if (!p->err) {
+        oneside = node_get_bool(o, p, 0);
+    }
+    if (!p->err) {
+        ret = aux_matrix_node(p);
+    }
+    if (!p->err) {
+        ret->v.m = hp_filter_list(l->v.ivec, p->dset, lambda,
+                                  oneside, OPT_NONE, &p->err);
+    }
+
+    return ret;
+}
+
 /* Functions taking a series as argument and returning a series.  Note
    that the @r node may be null or may contain an auxiliary parameter,
    as follows:
@@ -10948,6 +12707,8 @@ static NODE *apply_matrix_func (NODE *t, NODE *f, parser *p)
         return ret;
     }
 
+    gstat_fcall(f->t);
+
     if (m->is_complex) {
         if (f->t == F_ABS) {
             apply_cmatrix_dfunc(ret->v.m, m, cabs);
@@ -11313,7 +13074,20 @@ static NODE *eval_ufunc (NODE *l, NODE *r, parser *p)
             void *data;
 
             data = arg_get_data(arg, reftype, &argt, &uv);
-            p->err = push_function_arg(fc, arg->vname, uv, argt, data);
+            if (uv == NULL && arg->vname == NULL && is_tmp_node(arg) &&
+                (arg->t == MAT || (arg->t == BUNDLE && !reusable(p)))) {
+                /* an anonymous temporary: offer it to the function
+                   rather than having it copied
+                */
+                int taken = 0;
+
+                p->err = push_temp_function_arg(fc, argt, data, &taken);
+                if (taken) {
+                    arg->v.ptr = NULL; /* avoid freeing! */
+                }
+            } else {
+                p->err = push_function_arg(fc, arg->vname, uv, argt, data);
+            }
         }
         if (p->err) {
             fprintf(stderr, "%s: error evaluating arg %d\n", funname, i+1);
@@ -11617,7 +13391,10 @@ static NODE *get_bundle_member (NODE *l, NODE *r, parser *p)
         ret = get_aux_node(p, gen_t, 0, 0);
     }
 
-    if (gretl_is_scalar_type(type)) {
+    if (type == GRETL_TYPE_DOUBLE) {
+        /* skip a second look-up in the common case */
+        ret->v.xval = *(double *) val;
+    } else if (gretl_is_scalar_type(type)) {
         ret->v.xval = gretl_bundle_get_scalar(l->v.b, key, NULL);
     } else if (type == GRETL_TYPE_STRING) {
         ret->v.str = (char *) val;
@@ -11723,6 +13500,111 @@ static const char *optional_bundle_get (gretl_bundle *b,
     return s;
 }
 
+#ifdef USE_CURL
+
+/* curl() with an array of URLs: carry out a batch of GET requests
+   concurrently, returning the number of failures.
+*/
+
+static int curl_multi_bundle (gretl_bundle *b, parser *p)
+{
+    gretl_array *U, *A = NULL;
+    const char *header = NULL;
+    double xinclude = 0;
+    double xnobody = 0;
+    char **urls, **output = NULL;
+    char **errmsgs = NULL;
+    int *codes = NULL;
+    int i, n = 0;
+    int ret = 0;
+
+    U = gretl_bundle_get_array(b, "URL", &p->err);
+    if (!p->err && gretl_array_get_type(U) != GRETL_TYPE_STRINGS) {
+        p->err = E_TYPES;
+    }
+    if (!p->err && gretl_bundle_has_key(b, "postdata")) {
+        gretl_errmsg_set("curl: postdata is not supported with multiple URLs");
+        p->err = E_INVARG;
+    }
+    header = optional_bundle_get(b, "header", NULL, &p->err);
+    optional_bundle_get(b, "include", &xinclude, &p->err);
+    optional_bundle_get(b, "nobody", &xnobody, &p->err);
+    if (p->err) {
+        return 0;
+    }
+
+    urls = gretl_array_get_strings(U, &n);
+    if (n == 0) {
+        p->err = E_DATA;
+        return 0;
+    }
+
+    output = strings_array_new(n);
+    errmsgs = strings_array_new(n);
+    codes = malloc(n * sizeof *codes);
+
+    if (output == NULL || errmsgs == NULL || codes == NULL) {
+        p->err = E_ALLOC;
+    } else {
+        int include = !isnan(xinclude) && (xinclude != 0.0);
+        int nobody = !isnan(xnobody) && (xnobody != 0.0);
+
+        ret = gretl_curl_multi((const char **) urls, n, header,
+                               include, nobody, output, codes,
+                               errmsgs);
+        if (ret < 0) {
+            p->err = -ret;
+            ret = 0;
+        }
+    }
+
+    if (!p->err) {
+        gretl_matrix *h = gretl_matrix_alloc(n, 1);
+
+        for (i=0; i<n; i++) {
+            if (output[i] == NULL) {
+                output[i] = gretl_strdup("");
+            }
+            if (errmsgs[i] == NULL) {
+                errmsgs[i] = gretl_strdup("");
+            }
+            if (h != NULL) {
+                h->val[i] = codes[i];
+            }
+        }
+        A = gretl_array_from_strings(output, n, 0, &p->err);
+        if (!p->err) {
+            output = NULL;
+            p->err = gretl_bundle_donate_data(b, "output", A,
+                                              GRETL_TYPE_ARRAY, 0);
+        }
+        if (!p->err && ret > 0) {
+            A = gretl_array_from_strings(errmsgs, n, 0, &p->err);
+            if (!p->err) {
+                errmsgs = NULL;
+                p->err = gretl_bundle_donate_data(b, "errmsg", A,
+                                                  GRETL_TYPE_ARRAY, 0);
+            }
+        }
+        if (h == NULL) {
+            p->err = E_ALLOC;
+        } else if (!p->err) {
+            p->err = gretl_bundle_donate_data(b, "http_code", h,
+                                              GRETL_TYPE_MATRIX, 0);
+        } else {
+            gretl_matrix_free(h);
+        }
+    }
+
+    strings_array_free(output, n);
+    strings_array_free(errmsgs, n);
+    free(codes);
+
+    return ret;
+}
+
+#endif
+
 static NODE *curl_bundle_node (NODE *n, parser *p)
 {
     NODE *ret = aux_scalar_node(p);
@@ -11759,6 +13641,12 @@ static NODE *curl_bundle_node (NODE *n, parser *p)
 	    double xnobody = 0;
 	    int http_code = 0;
 
+            if (gretl_bundle_get_member_type(b, "URL", NULL) == GRETL_TYPE_ARRAY) {
+                /* batch of GET requests */
+                ret->v.xval = curl_multi_bundle(b, p);
+                return ret;
+            }
+
             url = gretl_bundle_get_string(b, "URL", &p->err);
             header = optional_bundle_get(b, "header", NULL, &p->err);
             postdata = optional_bundle_get(b, "postdata", NULL, &p->err);
@@ -11920,6 +13808,12 @@ static gretl_bundle *bvar_get_bundle (NODE *n, parser *p)
         if (!p->err) {
             b = gretl_bundle_copy(tmp, &p->err);
         }
+    } else if (n->v.idnum == B_MEMOSTATS) {
+        b = memo_stats_bundle(&p->err);
+    } else if (n->v.idnum == B_MEMSTATS) {
+        b = gretl_memstats_bundle(p->dset, &p->err);
+    } else if (n->v.idnum == B_GENRSTATS) {
+        b = genr_stats_bundle(&p->err);
     } else if (n->v.idnum == R_RESULT) {
         GretlType type = 0;
         void *ptr = get_last_result_data(&type, &p->err);
@@ -12811,6 +14705,98 @@ static int set_series_obs_value (NODE *lhs, NODE *rhs, parser *p)
    or a scalar (or a series standing in for a matrix).
 */
 
+/* Elementwise operators that can be applied to a matrix in place
+   when the right-hand operand is a matrix of the same dimensions.
+*/
+
+static int inplace_elementwise_op (int op)
+{
+    return op == B_ADD || op == B_SUB || op == B_DOTADD ||
+        op == B_DOTSUB || op == B_DOTMULT || op == B_DOTDIV ||
+        op == B_DOTPOW;
+}
+
+static double inplace_calc (double x, double y, int op)
+{
+    switch (op) {
+    case B_ADD:
+    case B_DOTADD:
+        return x + y;
+    case B_SUB:
+    case B_DOTSUB:
+        return x - y;
+    case B_DOTMULT:
+        return x * y;
+    case B_DOTDIV:
+        return x / y;
+    case B_DOTPOW:
+        return pow(x, y);
+    default:
+        return NADBL;
+    }
+}
+
+/* Apply an inflected assignment such as M[,j] += v directly to the
+   elements of the real matrix @m1 selected by @spec, rather than
+   extracting the submatrix, computing a new one and writing it back.
+   If @m2 is non-NULL it must match the selection exactly; otherwise
+   the scalar @x is used. Returns 1 if the update was done here, 0 if
+   the caller should take the general route.
+*/
+
+static int inflect_submatrix_in_place (gretl_matrix *m1,
+                                       const gretl_matrix *m2,
+                                       double x,
+                                       matrix_subspec *spec,
+                                       parser *p)
+{
+    double y = x;
+    int r, c, i, j, k;
+    int mi, mj;
+
+    if (m1->is_complex) {
+        return 0;
+    } else if (m2 != NULL &&
+               (m2->is_complex || !inplace_elementwise_op(p->op))) {
+        return 0;
+    } else if (mspec_get_dims(spec, m1, &r, &c)) {
+        return 0;
+    } else if (m2 != NULL && (m2->rows != r || m2->cols != c)) {
+        /* leave broadcasting and error reporting to the general case */
+        return 0;
+    }
+
+    if (spec->ltype == SEL_CONTIG) {
+        double *targ = m1->val + mspec_get_offset(spec);
+        int n = r * c;
+
+        for (i=0; i<n; i++) {
+            if (m2 != NULL) {
+                targ[i] = inplace_calc(targ[i], m2->val[i], p->op);
+            } else {
+                targ[i] = xy_calc(targ[i], x, p->op, MAT, p);
+            }
+        }
+    } else {
+        k = 0;
+        for (j=0; j<c; j++) {
+            mj = (spec->cslice == NULL)? j : spec->cslice[j+1] - 1;
+            for (i=0; i<r; i++) {
+                mi = (spec->rslice == NULL)? i : spec->rslice[i+1] - 1;
+                mi += mj * m1->rows;
+                if (m2 != NULL) {
+                    y = m2->val[k++];
+                    m1->val[mi] = inplace_calc(m1->val[mi], y, p->op);
+                } else {
+                    m1->val[mi] = xy_calc(m1->val[mi], y, p->op, MAT, p);
+                }
+            }
+        }
+    }
+
+    return 1;
+}
+
 static int set_matrix_chunk (NODE *lhs, NODE *rhs, parser *p)
 {
     NODE *lh1 = lhs->L;
@@ -12954,7 +14940,19 @@ static int set_matrix_chunk (NODE *lhs, NODE *rhs, parser *p)
            submatrix @a and the newly generated matrix (or
            scalar value).
         */
-        gretl_matrix *a = matrix_get_submatrix(m1, spec, 1, &p->err);
+        gretl_matrix *a = NULL;
+
+        if (!rhs_cscalar &&
+            inflect_submatrix_in_place(m1, rhs_scalar ? NULL : m2,
+                                       rhs_x, spec, p)) {
+            /* done, without a temporary submatrix */
+            if (free_m2) {
+                gretl_matrix_free(m2);
+            }
+            return p->err;
+        }
+
+        a = matrix_get_submatrix(m1, spec, 1, &p->err);
 
         if (!p->err) {
             if (rhs_scalar || rhs_cscalar) {
@@ -13072,7 +15070,7 @@ static gretl_matrix *get_density_matrix (NODE *t, double bws,
                               gretlopt, int *);
     gretl_matrix *(*kdfunc2) (const gretl_matrix *, double,
                               gretlopt, int *);
-    gretlopt opt = ctrl ? OPT_O : OPT_NONE;
+    gretlopt opt = OPT_NONE;
     gretl_matrix *m = NULL;
     gretl_matrix *X = NULL;
     const double *x = NULL;
@@ -13082,6 +15080,15 @@ static gretl_matrix *get_density_matrix (NODE *t, double bws,
     kdfunc1 = NULL;
     kdfunc2 = NULL;
 
+    /* @ctrl: 1 for Epanechnikov, plus 2 to force exact
+       evaluation in large samples */
+    if (ctrl & 1) {
+        opt |= OPT_O;
+    }
+    if (ctrl & 2) {
+        opt |= OPT_X;
+    }
+
     if (t->t == SERIES) {
         n = sample_size(p->dset);
         x = t->v.xvec + p->dset->t1;
@@ -13657,6 +15664,41 @@ static NODE *eval_3args_func (NODE *l, NODE *m, NODE *r,
                 A = halton_matrix(rows, cols, offset, &p->err);
             }
         }
+    } else if (f == F_SOBOL) {
+        if (l->t != NUM) {
+            node_type_error(f, 1, NUM, l, p);
+        } else if (m->t != NUM) {
+            node_type_error(f, 2, NUM, m, p);
+        } else if (r->t != EMPTY && r->t != NUM) {
+            /* optional scramble flag */
+            node_type_error(f, 3, NUM, r, p);
+        } else {
+            int scramble = null_node(r) ? 0 : node_get_bool(r, p, 0);
+            int rows = node_get_int(l, p);
+            int cols = node_get_int(m, p);
+
+            if (!p->err) {
+                A = sobol_matrix(rows, cols, scramble, &p->err);
+            }
+        }
+    } else if (f == F_TSBARS) {
+        const double *ts, *x = NULL;
+        int nts = 0, nx = 0;
+
+        ts = ts_node_get_data(l, f, 1, p, &nts);
+        if (!p->err) {
+            x = ts_node_get_data(m, f, 2, p, &nx);
+        }
+        if (p->err) {
+            ; /* skip the rest */
+        } else if (!scalar_node(r)) {
+            node_type_error(f, 3, NUM, r, p);
+        } else if (nx != nts) {
+            p->err = E_NONCONF;
+        } else {
+            A = timestamp_bars(ts, x, nts, node_get_scalar(r, p),
+                               &p->err);
+        }
     } else if (f == F_IWISHART) {
         if (l->t != MAT && l->t != NUM) {
             node_type_error(f, 1, MAT, l, p);
@@ -14698,7 +16740,11 @@ static int check_argc (int f, int k, parser *p)
         { F_TDISAGG,   3, 5 },
         { F_COMMUTE,   2, 5 },
         { F_TOEPSOLV,  3, 4 },
-        { F_RGBMIX,    3, 4 }
+        { F_RGBMIX,    3, 4 },
+        { F_OLSBATCH,  2, 4 },
+        { F_OLSROLL,   3, 4 },
+        { F_PERMTEST,  3, 4 },
+        { F_MOVSTAT,   3, 4 }
     };
     int argc_min = 2;
     int argc_max = 4;
@@ -14731,6 +16777,61 @@ static int no_ts_data (parser *p)
 
 #define nargs_needs_ts(f) (f == F_BKFILT)
 
+/* permtest(): callback to evaluate a user-defined test statistic
+   for given samples @a and @b
+*/
+
+struct perm_ufunc {
+    const char *fname;
+    ufunc *u;
+    parser *p;
+};
+
+static double perm_ufunc_stat (const gretl_matrix *a,
+                               const gretl_matrix *b,
+                               void *data, int *err)
+{
+    struct perm_ufunc *pu = data;
+    parser *p = pu->p;
+    NODE *save_aux = p->aux;
+    NODE tmp = {0};
+    NODE mn = {0};
+    NODE an = {0};
+    NODE bn = {0};
+    NODE *args[2] = {&an, &bn};
+    NODE *val;
+    double x = NADBL;
+
+    an.t = bn.t = MAT;
+    an.v.m = (gretl_matrix *) a;
+    bn.v.m = (gretl_matrix *) b;
+
+    p->aux = NULL;
+    tmp.t = UFUN;
+    tmp.vname = (char *) pu->fname;
+    tmp.v.ptr = pu->u;
+    mn.v.bn.n_nodes = 2;
+    mn.v.bn.n = args;
+    tmp.R = &mn;
+    val = eval_ufunc(&tmp, &mn, p);
+    if (!p->err) {
+        if (val != NULL && val->t == NUM) {
+            x = val->v.xval;
+        } else {
+            p->err = E_TYPES;
+        }
+    }
+    if (val != NULL && is_aux_node(val)) {
+        free_node(val, p);
+    }
+    p->aux = save_aux;
+
+    *err = p->err;
+    p->err = 0;
+
+    return x;
+}
+
 /* evaluate a built-in function that has more than three arguments */
 
 static NODE *eval_nargs_func (NODE *t, NODE *n, parser *p)
@@ -14749,12 +16850,15 @@ static NODE *eval_nargs_func (NODE *t, NODE *n, parser *p)
 
     if (t->t == F_BKFILT) {
         const double *x = NULL;
+        const int *list = NULL;
         int bk[3] = {0};
 
         for (i=0; i<k && !p->err; i++) {
             e = n->v.bn.n[i];
             if (i == 0) {
-                if (e->t != SERIES) {
+                if (e->t == LIST) {
+                    list = e->v.ivec;
+                } else if (e->t != SERIES) {
                     node_type_error(t->t, 1, SERIES, e, p);
                 } else {
                     x = e->v.xvec;
@@ -14765,11 +16869,17 @@ static NODE *eval_nargs_func (NODE *t, NODE *n, parser *p)
                 bk[i-1] = node_get_int(e, p);
             }
         }
-        if (!p->err) {
+        if (!p->err && list != NULL) {
+            ret = aux_matrix_node(p);
+            if (!p->err) {
+                ret->v.m = bkbp_filter_list(list, p->dset, bk[0], bk[1],
+                                            bk[2], &p->err);
+            }
+        } else if (!p->err) {
             ret = aux_series_node(p);
-        }
-        if (!p->err) {
-            p->err = bkbp_filter(x, ret->v.xvec, p->dset, bk[0], bk[1], bk[2]);
+            if (!p->err) {
+                p->err = bkbp_filter(x, ret->v.xvec, p->dset, bk[0], bk[1], bk[2]);
+            }
         }
     } else if (t->t == F_FILTER) {
         const double *x = NULL; /* series */
@@ -15120,6 +17230,24 @@ static NODE *eval_nargs_func (NODE *t, NODE *n, parser *p)
                                                      p->dset, &p->err);
             }
         }
+    } else if (t->t == F_VARPATHS) {
+        int h = 0, npaths = 0;
+
+        if (k != 2) {
+            n_args_error(k, 2, 2, t->t, p);
+        } else {
+            h = node_get_int(n->v.bn.n[0], p);
+            if (!p->err) {
+                npaths = node_get_int(n->v.bn.n[1], p);
+            }
+        }
+        if (!p->err) {
+            ret = aux_matrix_node(p);
+        }
+        if (!p->err) {
+            ret->v.m = last_model_get_var_paths(h, npaths, p->dset,
+                                                &p->err);
+        }
     } else if (t->t == F_QLRPVAL) {
         double X2 = NADBL;
         double p1 = 0, p2 = 0;
@@ -15239,6 +17367,39 @@ static NODE *eval_nargs_func (NODE *t, NODE *n, parser *p)
                 p->err = movavg_series(x, ret->v.xvec, p->dset, len, ctrl);
             }
         }
+    } else if (t->t == F_MOVSTAT) {
+        const double *x = NULL;
+        const char *stat = NULL;
+        double prob = NADBL;
+        int len = 0;
+
+        for (i=0; i<k && !p->err; i++) {
+            e = n->v.bn.n[i];
+            if (i == 0) {
+                if (e->t == SERIES) {
+                    x = e->v.xvec;
+                } else {
+                    node_type_error(t->t, i+1, SERIES, e, p);
+                }
+            } else if (i == 1) {
+                len = node_get_int(e, p);
+            } else if (i == 2) {
+                if (e->t == STR) {
+                    stat = e->v.str;
+                } else {
+                    node_type_error(t->t, i+1, STR, e, p);
+                }
+            } else if (!null_node(e)) {
+                prob = node_get_scalar(e, p);
+            }
+        }
+        if (!p->err) {
+            ret = aux_series_node(p);
+        }
+        if (!p->err) {
+            p->err = movstat_series(x, ret->v.xvec, p->dset, len,
+                                    stat, prob);
+        }
     } else if (t->t == F_NADARWAT) {
         const double *x = NULL;
         const double *y = NULL;
@@ -15540,6 +17701,146 @@ static NODE *eval_nargs_func (NODE *t, NODE *n, parser *p)
         if (!p->err) {
             ret->v.a = colormix_array(c[0], c[1], f, nf, do_plot, &p->err);
         }
+    } else if (t->t == F_OLSBATCH) {
+        gretl_matrix *S = NULL;
+        int *ylist = NULL;
+        int *xlist = NULL;
+        int each = 0;
+
+        for (i=0; i<k && !p->err; i++) {
+            e = n->v.bn.n[i];
+            if (i == 0 || i == 1) {
+                /* dependent variables, regressors */
+                if (ok_list_node(e, p)) {
+                    if (i == 0) {
+                        ylist = node_get_list(e, p);
+                    } else {
+                        xlist = node_get_list(e, p);
+                    }
+                } else {
+                    node_type_error(t->t, i+1, LIST, e, p);
+                }
+            } else if (i == 2) {
+                /* optional regressor-selection matrix */
+                if (!null_node(e)) {
+                    S = node_get_real_matrix(e, p, 2, 3);
+                }
+            } else {
+                /* each equation on its own sample? */
+                each = node_get_bool(e, p, 0);
+            }
+        }
+        if (!p->err) {
+            ret = aux_bundle_node(p);
+        }
+        if (!p->err) {
+            ret->v.b = batch_ols(ylist, xlist, S, each, p->dset, &p->err);
+        }
+        free(ylist);
+        free(xlist);
+    } else if (t->t == F_OLSROLL) {
+        const double *y = NULL;
+        int *xlist = NULL;
+        int w = 0, recursive = 0;
+
+        for (i=0; i<k && !p->err; i++) {
+            e = n->v.bn.n[i];
+            if (i == 0) {
+                /* dependent variable */
+                if (e->t == SERIES) {
+                    y = e->v.xvec;
+                } else {
+                    node_type_error(t->t, 1, SERIES, e, p);
+                }
+            } else if (i == 1) {
+                /* regressors */
+                if (ok_list_node(e, p)) {
+                    xlist = node_get_list(e, p);
+                } else {
+                    node_type_error(t->t, 2, LIST, e, p);
+                }
+            } else if (i == 2) {
+                /* window length */
+                w = node_get_int(e, p);
+            } else {
+                /* expanding rather than fixed-length windows? */
+                recursive = node_get_bool(e, p, 0);
+            }
+        }
+        if (!p->err) {
+            ret = aux_bundle_node(p);
+        }
+        if (!p->err) {
+            ret->v.b = rolling_ols(y, xlist, w, recursive, p->dset, &p->err);
+        }
+        free(xlist);
+    } else if (t->t == F_PERMTEST) {
+        gretl_matrix *ab[2] = {NULL, NULL};
+        int freeab[2] = {0, 0};
+        gretl_bundle *opts = NULL;
+        struct perm_ufunc pu = {0};
+        const char *sname = NULL;
+        int stat = 0;
+
+        for (i=0; i<k && !p->err; i++) {
+            e = n->v.bn.n[i];
+            if (i < 2) {
+                /* the two samples */
+                if (e->t == MAT) {
+                    ab[i] = e->v.m;
+                } else if (e->t == SERIES) {
+                    ab[i] = series_to_matrix(e->v.xvec, p);
+                    freeab[i] = 1;
+                } else {
+                    node_type_error(t->t, i+1, MAT, e, p);
+                }
+            } else if (i == 2) {
+                /* the statistic: built-in or a user function */
+                if (e->t == STR) {
+                    sname = e->v.str;
+                } else {
+                    node_type_error(t->t, 3, STR, e, p);
+                }
+            } else if (!null_node(e)) {
+                /* options */
+                if (e->t == BUNDLE) {
+                    opts = e->v.b;
+                } else {
+                    node_type_error(t->t, 4, BUNDLE, e, p);
+                }
+            }
+        }
+        if (!p->err) {
+            stat = perm_stat_from_string(sname);
+            if (stat == 0) {
+                pu.u = get_user_function_by_name(sname);
+                if (pu.u == NULL) {
+                    gretl_errmsg_sprintf(_("%s: function not found"), sname);
+                    p->err = E_DATA;
+                } else if (user_func_get_return_type(pu.u) != GRETL_TYPE_DOUBLE) {
+                    gretl_errmsg_sprintf(_("permtest: the function %s must "
+                                           "return a scalar"), sname);
+                    p->err = E_TYPES;
+                } else {
+                    stat = PERM_USER;
+                    pu.fname = sname;
+                    pu.p = p;
+                }
+            }
+        }
+        if (!p->err) {
+            ret = aux_bundle_node(p);
+        }
+        if (!p->err) {
+            ret->v.b = permutation_test(ab[0], ab[1], stat,
+                                        stat == PERM_USER ? perm_ufunc_stat : NULL,
+                                        &pu, opts, &p->err);
+        }
+        for (i=0; i<2; i++) {
+            if (freeab[i]) {
+                gretl_matrix_free(ab[i]);
+            }
+        }
     } else if (t->t == HF_FELOGITR) {
         gretl_matrix *U = NULL;
         gretl_matrix *X = NULL;
@@ -15971,7 +18272,167 @@ static NODE *eval_feval (int f, NODE *l, NODE *r, parser *p)
         for (i=0; i<argc; i++) {
             free_node(nn[i], p);
         }
-        free(nn);
+        free(nn);
+    }
+
+    return ret;
+}
+
+/* spawn(): @l is a multi-node holding the name of a user function
+   plus its arguments. We start a task to call the function and
+   return the task ID; the function's return value is obtained via
+   await().
+*/
+
+static NODE *spawn_node (NODE *l, parser *p)
+{
+    NODE *ret = NULL;
+    NODE *e = NULL;
+    ufunc *u = NULL;
+    GretlType rtype = 0;
+    TaskRole role = TASK_PARENT;
+    int k = l->v.bn.n_nodes;
+    int id;
+
+    if (k < 1) {
+        p->err = E_ARGS;
+        return NULL;
+    }
+
+    e = l->v.bn.n[0];
+    if (e->t != STR) {
+        node_type_error(F_SPAWN, 1, STR, e, p);
+        return NULL;
+    }
+
+    u = get_user_function_by_name(e->v.str);
+    if (u == NULL) {
+        gretl_errmsg_sprintf(_("%s: function not found"), e->v.str);
+        p->err = E_DATA;
+        return NULL;
+    }
+
+    rtype = user_func_get_return_type(u);
+    if (rtype == GRETL_TYPE_VOID || rtype == GRETL_TYPE_SERIES ||
+        rtype == GRETL_TYPE_LIST) {
+        gretl_errmsg_sprintf(_("spawn: the function %s must return a "
+                               "scalar, matrix, string, bundle or array"),
+                             e->v.str);
+        p->err = E_TYPES;
+        return NULL;
+    }
+
+    gretl_print_flush_stream(p->prn);
+    id = gretl_task_start(&role, &p->err);
+    if (p->err) {
+        return NULL;
+    }
+
+    if (role != TASK_PARENT) {
+        /* we're to run the task ourselves */
+        NODE *save_aux = p->aux;
+        NODE tmp = {0};
+        NODE mn = {0};
+        NODE *val;
+        GretlType type = 0;
+        void *data = NULL;
+
+        p->aux = NULL;
+        tmp.t = UFUN;
+        tmp.vname = e->v.str;
+        tmp.v.ptr = u;
+        mn.v.bn.n_nodes = k - 1;
+        mn.v.bn.n = l->v.bn.n + 1;
+        tmp.R = &mn;
+        val = eval_ufunc(&tmp, &mn, p);
+        if (!p->err && val != NULL) {
+            if (val->t == NUM) {
+                data = &val->v.xval;
+                type = GRETL_TYPE_DOUBLE;
+            } else if (val->t == MAT) {
+                data = val->v.m;
+                type = GRETL_TYPE_MATRIX;
+            } else if (val->t == STR) {
+                data = val->v.str;
+                type = GRETL_TYPE_STRING;
+            } else if (val->t == BUNDLE) {
+                data = val->v.b;
+                type = GRETL_TYPE_BUNDLE;
+            } else if (val->t == ARRAY) {
+                data = val->v.a;
+                type = gretl_array_get_type(val->v.a);
+            }
+        }
+        gretl_task_finish(id, data, type, p->err);
+        /* note: not reached in the TASK_FORKED case */
+        if (val != NULL && is_aux_node(val)) {
+            free_node(val, p);
+        }
+        p->aux = save_aux;
+        if (p->err) {
+            /* the error belongs to the task: it's reported by await() */
+            gretl_error_clear();
+            p->err = 0;
+        }
+    }
+
+    ret = aux_scalar_node(p);
+    if (ret != NULL) {
+        ret->v.xval = id;
+    }
+
+    return ret;
+}
+
+/* await(): wait for the task with ID given by @l to finish
+   and return the value produced by its function
+*/
+
+static NODE *await_node (NODE *l, parser *p)
+{
+    NODE *ret = NULL;
+    GretlType type = 0;
+    void *val;
+    int id;
+
+    id = node_get_int(l, p);
+    if (p->err) {
+        return NULL;
+    }
+
+    val = gretl_task_await(id, &type, &p->err);
+    if (p->err) {
+        return NULL;
+    }
+
+    if (type == GRETL_TYPE_DOUBLE) {
+        ret = aux_scalar_node(p);
+        if (ret != NULL) {
+            ret->v.xval = *(double *) val;
+        }
+        free(val);
+    } else if (type == GRETL_TYPE_MATRIX) {
+        ret = aux_matrix_node(p);
+        if (ret != NULL) {
+            ret->v.m = val;
+        }
+    } else if (type == GRETL_TYPE_STRING) {
+        ret = aux_string_node(p);
+        if (ret != NULL) {
+            ret->v.str = val;
+        }
+    } else if (type == GRETL_TYPE_BUNDLE) {
+        ret = aux_bundle_node(p);
+        if (ret != NULL) {
+            ret->v.b = val;
+        }
+    } else if (gretl_array_type(type)) {
+        ret = aux_array_node(p);
+        if (ret != NULL) {
+            ret->v.a = val;
+        }
+    } else {
+        p->err = E_TYPES;
     }
 
     return ret;
@@ -16172,6 +18633,24 @@ static NODE *eval_kalman_bundle_func (NODE *t, NODE *n, parser *p)
         if (freeU) {
             gretl_matrix_free(U);
         }
+    } else if (t->t == F_KMFILTER) {
+        /* a bundle pointer plus a matrix of observables */
+        gretl_bundle *b = get_kalman_bundle_arg(n, p);
+        gretl_matrix *Y = NULL;
+
+        if (!p->err && k != 2) {
+            n_args_error(k, 2, 2, t->t, p);
+        }
+        if (!p->err) {
+            Y = mat_node_get_real_matrix(n->v.bn.n[1], p);
+        }
+        if (!p->err) {
+            ret = aux_bundle_node(p);
+        }
+        if (!p->err) {
+            ret->v.b = kalman_bundle_multi_filter(b, Y, p->prn,
+                                                  &p->err);
+        }
     }
 
     return ret;
@@ -16630,6 +19109,9 @@ static NODE *query_eval_series (const double *c, NODE *n, parser *p)
     double xt, yt;
     int t, t1, t2;
     int branch;
+#if defined(_OPENMP)
+    int mt;
+#endif
 
     branch = vec_branch(c, p);
 
@@ -16669,6 +19151,10 @@ static NODE *query_eval_series (const double *c, NODE *n, parser *p)
     t1 = autoreg(p) ? p->obs : p->dset->t1;
     t2 = autoreg(p) ? p->obs : p->dset->t2;
 
+#if defined(_OPENMP)
+    mt = !autoreg(p) && gretl_use_openmp((guint64) (t2 - t1 + 1));
+#pragma omp parallel for private(t, xt, yt) if (mt)
+#endif
     for (t=t1; t<=t2; t++) {
         if (na(c[t])) {
             ret->v.xvec[t] = NADBL;
@@ -17055,12 +19541,16 @@ static int dvar_get_series (double *x, int i, const DATASET *dset)
            here, so we have to explicitly exclude cases that
            require different treatment.
         */
-        char obs[12];
+        guint32 *ed = malloc(dset->n * sizeof *ed);
         int y, m, d;
 
+        if (ed == NULL) {
+            return E_ALLOC;
+        }
+        err = calendar_epoch_days(dset, 0, dset->n - 1, ed);
         for (t=0; t<dset->n && !err; t++) {
-            ntolabel(obs, t, dset);
-            if (sscanf(obs, YMD_READ_FMT, &y, &m, &d) != 3) {
+            err = ymd_bits_from_epoch_day(ed[t], &y, &m, &d);
+            if (err) {
                 err = E_DATA;
             } else if (i == R_OBSMAJ) {
                 x[t] = y;
@@ -17070,6 +19560,7 @@ static int dvar_get_series (double *x, int i, const DATASET *dset)
                 x[t] = d;
             }
         }
+        free(ed);
     } else if (i == R_TIME) {
         if (panel) {
             make_panel_time_var(x, dset);
@@ -17691,11 +20182,16 @@ static NODE *lhs_terminal_node (NODE *t, NODE *l, NODE *r,
    (2) the dataset has been differently sub-sampled, or
    (3) the series has been deleted (should be impossible).
 
-   In case (2) the ID number of the series should still
-   be valid, so it ought to be sufficient to reconnect the
-   xvec pointer as in the second branch below. In case (1),
-   however, it's necessary to look up the ID number by name
-   again (as things stand).
+   In case (2) the ID number of the series is still valid,
+   so it's sufficient to reconnect the xvec pointer. In cases
+   (1) and (3) the ID number has to be looked up by name again.
+   To avoid doing that on every execution, the node records
+   the "names generation" of the dataset at which its ID was
+   resolved (see dataset_names_generation()); the ID is reused
+   for as long as that number is unchanged. Names of list
+   members ("L.x") are always looked up, since they depend on
+   the current content of the list, as are names when loop
+   renaming is in force.
 
    Note that n->v.xvec will be NULL when this function is
    reached only in case a genr is attached to a loop that
@@ -17706,22 +20202,23 @@ static NODE *lhs_terminal_node (NODE *t, NODE *l, NODE *r,
 
 static void reattach_series (NODE *n, parser *p)
 {
-    /* FIXME relax the "1" below? */
-    if (1 || n->v.xvec == NULL || get_loop_renaming()) {
-        /* do a full reset */
-        n->vnum = current_series_index(p->dset, n->vname);
-        if (n->vnum < 0) {
-            gretl_errmsg_sprintf("'%s': not a series", n->vname);
-            p->err = E_DATA;
-        } else {
-            n->v.xvec = p->dset->Z[n->vnum];
-        }
-    } else if (n->vnum >= 0 && n->vnum < p->dset->v) {
-        /* handles the case of the dataset moving due to
-           sub-sampling, provided that no series are deleted
-           (the name -> ID mapping remains unchanged)
-        */
+    guint32 gen = dataset_names_generation();
+
+    if (n->gen == gen && n->vnum >= 0 && n->vnum < p->dset->v &&
+        !get_loop_renaming()) {
+        /* the resolved slot is still good */
+        n->v.xvec = p->dset->Z[n->vnum];
+        return;
+    }
+
+    n->vnum = current_series_index(p->dset, n->vname);
+    if (n->vnum < 0) {
+        gretl_errmsg_sprintf("'%s': not a series", n->vname);
+        p->err = E_DATA;
+        n->gen = 0;
+    } else {
         n->v.xvec = p->dset->Z[n->vnum];
+        n->gen = strchr(n->vname, '.') == NULL ? gen : 0;
     }
 }
 
@@ -17948,6 +20445,35 @@ static int empty_ok (NODE *n, parser *p)
 
 /* core function: evaluate the parsed syntax tree */
 
+/* For built-in functions that modify their first argument
+   in place (setnote, brename): if the object at the root of
+   that argument is sharing its data with a function's caller,
+   give it a private copy before the argument is evaluated.
+*/
+
+static void unshare_modified_arg (NODE *n, parser *p)
+{
+    user_var *uv;
+
+    while (n != NULL && (n->t == OSL || n->t == OBS || n->t == BMEMB)) {
+        n = n->L;
+    }
+    if (n == NULL || n->vname == NULL || n->t < NUM || n->t > STR) {
+        return;
+    }
+
+    uv = n->uv;
+    if (uv == NULL || user_qsorting) {
+        uv = n->uv = get_user_var_by_name(n->vname);
+    }
+    if (uv != NULL && (uv->flags & UV_COW)) {
+        p->err = user_var_unshare(uv);
+        if (!p->err && n->t != NUM) {
+            n->v.ptr = uv->ptr;
+        }
+    }
+}
+
 static NODE *eval (NODE *t, parser *p)
 {
     NODE *l = NULL, *m = NULL, *r = NULL;
@@ -17996,6 +20522,16 @@ static NODE *eval (NODE *t, parser *p)
         return t;
     }
 
+    if (t->t == CSE) {
+        /* common subexpression, see cse_node() */
+        ret = cse_node(t, p);
+        if (p->err) {
+            goto bailout;
+        } else {
+            goto finish;
+        }
+    }
+
     if (t->t == QUERY) {
         /* needs special treatment, see eval_query() */
         l = eval(t->L, p);
@@ -18006,6 +20542,34 @@ static NODE *eval (NODE *t, parser *p)
         }
     }
 
+    if (t->t == B_MUL) {
+        p->aux = t->aux;
+        ret = lazy_transpose_mul(t, p);
+        if (ret != NULL) {
+            goto finish;
+        } else if (p->err) {
+            goto bailout;
+        }
+    }
+
+    if (fusible_binary(t->t) || fusible_unary(t->t)) {
+        /* try for single-pass evaluation of a series expression */
+        p->aux = t->aux;
+        ret = fused_series_node(t, p);
+        if (ret != NULL) {
+            goto finish;
+        } else if (p->err) {
+            goto bailout;
+        }
+    }
+
+    if (t->t == F_SETNOTE || t->t == F_BRENAME) {
+        unshare_modified_arg(t->L, p);
+        if (p->err) {
+            goto bailout;
+        }
+    }
+
     /* handle multi-argument L or R subnodes */
     if (t->L != NULL && bnsym(t->L->t)) {
         t->L->parent = t;
@@ -18316,6 +20880,9 @@ static NODE *eval (NODE *t, parser *p)
         /* matrix on left, scalar on right */
         if (l->t == MAT && null_or_scalar(r)) {
             ret = matrix_scalar_func(l, r, t->t, p);
+        } else if (t->t == F_MSORTBY && l->t == MAT && r->t == MAT) {
+            /* or a vector of sort keys */
+            ret = msortby_multi_node(l, r, p);
         } else if (l->t == MAT) {
             node_type_error(t->t, 2, NUM, r, p);
         } else {
@@ -18330,6 +20897,26 @@ static NODE *eval (NODE *t, parser *p)
             node_type_error(t->t, 1, MAT, l, p);
         }
         break;
+    case F_CHOLUPD:
+        /* two matrices plus optional boolean */
+        if (l->t == MAT && ok_matrix_node(m)) {
+            ret = cholupdate_node(l, m, r, p);
+        } else {
+            node_type_error(t->t, (l->t == MAT)? 2 : 1,
+                            MAT, (l->t == MAT)? m : l, p);
+        }
+        break;
+    case F_MMULT:
+        /* matrices, or batched on arrays of matrices, plus
+           optional boolean */
+        if ((l->t == ARRAY && m->t == ARRAY) ||
+            (ok_matrix_node(l) && ok_matrix_node(m))) {
+            ret = mmult_node(l, m, r, p);
+        } else {
+            node_type_error(t->t, (l->t == MAT)? 2 : 1,
+                            MAT, (l->t == MAT)? m : l, p);
+        }
+        break;
     case F_MSPLITBY:
         /* matrix on left, vector, optional boolean */
         if (ok_matrix_node(l) && ok_matrix_node(m)) {
@@ -18724,6 +21311,8 @@ static NODE *eval (NODE *t, parser *p)
             } else {
                 ret = series_series_func(l, r, NULL, t->t, p);
             }
+        } else if (l->t == LIST && t->t == F_HPFILT) {
+            ret = hp_filter_list_node(l, m, r, p);
         } else {
             node_type_error(t->t, 0, SERIES, l, p);
         }
@@ -19044,10 +21633,26 @@ static NODE *eval (NODE *t, parser *p)
             ret = matrix_to_matrix_func(l, r, t->t, p);
         } else if (t->t == F_MREV && l->t == LIST) {
             ret = list_reverse_node(l, p);
+        } else if (t->t == F_CHOL && l->t == ARRAY) {
+            ret = matrix_array_batch_node(l, NULL, t->t, p);
         } else {
             node_type_error(t->t, 1, MAT, l, p);
         }
         break;
+    case F_MSOLVE:
+        /* matrices, or batched on arrays of matrices */
+        if (l->t == ARRAY && r->t == ARRAY) {
+            ret = matrix_array_batch_node(l, r, t->t, p);
+        } else if (ok_matrix_node(l) && ok_matrix_node(r)) {
+            ret = matrix_matrix_calc(l, r, B_LDIV, p);
+        } else {
+            node_type_error(t->t, (l->t == MAT)? 2 : 1,
+                            MAT, (l->t == MAT)? r : l, p);
+        }
+        break;
+    case F_TSFIND:
+        ret = tsfind_node(l, r, p);
+        break;
     case HF_GLASSO:
         if (l->t == MAT && r->t == BUNDLE) {
             ret = glasso_node(l, r, p);
@@ -19084,14 +21689,25 @@ static NODE *eval (NODE *t, parser *p)
             ret = matrix_to_alt_node(l, t->t, p);
         }
         break;
-    case F_MREAD:
     case F_BREAD:
         if (l->t != STR) {
             node_type_error(t->t, 1, STR, l, p);
         } else if (!null_or_scalar(r)) {
             node_type_error(t->t, 2, NUM, r, p);
         } else {
-            ret = read_object_func(l, r, t->t, p);
+            ret = read_object_func(l, r, NULL, t->t, p);
+        }
+        break;
+    case F_MREAD:
+        /* string, optional scalar, optional string */
+        if (l->t != STR) {
+            node_type_error(t->t, 1, STR, l, p);
+        } else if (!null_or_scalar(m)) {
+            node_type_error(t->t, 2, NUM, m, p);
+        } else if (!null_node(r) && r->t != STR) {
+            node_type_error(t->t, 3, STR, r, p);
+        } else {
+            ret = read_object_func(l, m, r, t->t, p);
         }
         break;
     case F_EIGSYM:
@@ -19149,6 +21765,9 @@ static NODE *eval (NODE *t, parser *p)
     case F_BFGSCMAX:
         ret = BFGS_constrained_max(t, multi, p);
         break;
+    case F_MSMAX:
+        ret = multistart_max(t, multi, p);
+        break;
     case F_SIMANN:
     case F_NMMAX:
     case F_GSSMAX:
@@ -19245,6 +21864,8 @@ static NODE *eval (NODE *t, parser *p)
     case F_EIGSOLVE:
     case F_PRINCOMP:
     case F_HALTON:
+    case F_SOBOL:
+    case F_TSBARS:
     case F_AGGRBY:
     case F_IWISHART:
     case F_MWEIGHTS:
@@ -19314,9 +21935,12 @@ static NODE *eval (NODE *t, parser *p)
     case F_BOOTCI:
     case F_BOOTPVAL:
     case F_MOVAVG:
+    case F_MOVSTAT:
     case F_IRF:
+    case F_VARPATHS:
     case F_NADARWAT:
     case F_FEVAL:
+    case F_SPAWN:
     case F_CHOWLIN:
     case F_HYP2F1:
     case F_TDISAGG:
@@ -19324,6 +21948,9 @@ static NODE *eval (NODE *t, parser *p)
     case F_COMMUTE:
     case F_TOEPSOLV:
     case F_RGBMIX:
+    case F_OLSBATCH:
+    case F_OLSROLL:
+    case F_PERMTEST:
     case HF_FELOGITR:
         /* built-in functions taking more than three args */
         if (multi == NULL) {
@@ -19332,6 +21959,8 @@ static NODE *eval (NODE *t, parser *p)
         } else if (t->t == F_FEVAL) {
             multi->parent = t;
             ret = eval_feval(t->t, multi, NULL, p);
+        } else if (t->t == F_SPAWN) {
+            ret = spawn_node(multi, p);
         } else {
             ret = eval_nargs_func(t, multi, p);
         }
@@ -19358,6 +21987,7 @@ static NODE *eval (NODE *t, parser *p)
     case F_KSMOOTH:
     case F_KSIMUL:
     case F_KDSMOOTH:
+    case F_KMFILTER:
         if (t->t == F_KSETUP || bundle_pointer_arg0(t)) {
             ret = eval_kalman_bundle_func(t, multi, p);
         } else {
@@ -19691,6 +22321,9 @@ static NODE *eval (NODE *t, parser *p)
     case F_MPI_RECV:
         ret = mpi_transfer_node(l, NULL, NULL, t->t, p);
         break;
+    case F_AWAIT:
+        ret = await_node(l, p);
+        break;
     case F_MPI_SEND:
     case F_BCAST:
     case F_ALLREDUCE:
@@ -19700,6 +22333,15 @@ static NODE *eval (NODE *t, parser *p)
             ret = mpi_transfer_node(l, r, NULL, t->t, p);
         }
         break;
+    case F_MPIMAP:
+        if (l->t != STR) {
+            node_type_error(t->t, 1, STR, l, p);
+        } else if (r->t != ARRAY) {
+            node_type_error(t->t, 2, ARRAY, r, p);
+        } else {
+            ret = mpimap_node(l, r, p);
+        }
+        break;
     case F_REDUCE:
     case F_SCATTER:
         if (m->t != STR) {
@@ -20679,7 +23321,21 @@ static void gen_preprocess (parser *p, int flags, int *done)
     if (p->lh.expr != NULL) {
         /* create syntax tree for the LHS expression */
         const char *savepoint = p->point;
+        int rlen = gretl_namechar_spn(p->lh.expr);
+
+        if (rlen > 0 && rlen < VNAMELEN) {
+            /* the root object is to be modified: if it's sharing
+               its data with a function's caller, unshare it now
+            */
+            char root[VNAMELEN];
 
+            *root = '\0';
+            strncat(root, p->lh.expr, rlen);
+            p->err = user_var_unshare(get_user_var_by_name(root));
+            if (p->err) {
+                return;
+            }
+        }
         p->point = p->lh.expr;
         p->ch = parser_getc(p);
         lex(p);
@@ -21078,6 +23734,48 @@ static gretl_matrix *assign_to_matrix (parser *p)
    the only caller.
 */
 
+/* Can the inflected assignment M op= @r be carried out on @m1
+   in place? This requires a real matrix result of the same
+   dimensions as @m1 and an elementwise operator.
+*/
+
+static int matrix_update_in_place_ok (gretl_matrix *m1, NODE *r, int op)
+{
+    gretl_matrix *m = (r->t == MAT)? r->v.m : NULL;
+
+    return m != NULL && inplace_elementwise_op(op) &&
+        !m1->is_complex && !m->is_complex &&
+        m->rows == m1->rows && m->cols == m1->cols &&
+        m1->rows * m1->cols > 0;
+}
+
+static void matrix_update_in_place (gretl_matrix *m1,
+                                    const gretl_matrix *m,
+                                    int op)
+{
+    int t1 = gretl_matrix_get_t1(m);
+    int t2 = gretl_matrix_get_t2(m);
+
+    if (op == B_ADD || op == B_DOTADD) {
+        gretl_matrix_add_to(m1, m);
+    } else if (op == B_SUB || op == B_DOTSUB) {
+        gretl_matrix_subtract_from(m1, m);
+    } else {
+        int i, n = m1->rows * m1->cols;
+
+        for (i=0; i<n; i++) {
+            m1->val[i] = inplace_calc(m1->val[i], m->val[i], op);
+        }
+    }
+
+    /* as in real_matrix_calc(), the RHS may supply data-row info */
+    if (gretl_matrix_get_t2(m1) <= gretl_matrix_get_t1(m1) &&
+        t1 >= 0 && t2 > t1) {
+        gretl_matrix_set_t1(m1, t1);
+        gretl_matrix_set_t2(m1, t2);
+    }
+}
+
 static gretl_matrix *assign_to_matrix_mod (gretl_matrix *m1,
                                            parser *p)
 {
@@ -21117,6 +23815,9 @@ static gretl_matrix *assign_to_matrix_mod (gretl_matrix *m1,
             } else {
                 p->err = E_TYPES;
             }
+        } else if (!mcat && matrix_update_in_place_ok(m1, p->ret, p->op)) {
+            matrix_update_in_place(m1, p->ret->v.m, p->op);
+            m2 = m1; /* no change in matrix pointer */
         } else {
             gretl_matrix *tmp = retrieve_matrix_result(p);
 
@@ -22024,6 +24725,29 @@ static int handle_overwrite_strvals (parser *p, int targ, NODE *r)
     return err;
 }
 
+/* Apply the operator of an inflected assignment such as x += y,
+   with a series or scalar right-hand side, directly to the target
+   series @z over the current sample. Since the update is
+   elementwise it can be split across threads in the same way as
+   the corresponding binary operation.
+*/
+
+static void series_inflect (double *z, const double *y, double yt,
+                            parser *p)
+{
+    int t1 = p->dset->t1;
+    int t2 = p->dset->t2;
+    int t;
+
+#if defined(_OPENMP)
+    int mt = series_use_openmp(p->op, t2 - t1 + 1, 1, p);
+#pragma omp parallel for private(t) if (mt)
+#endif
+    for (t=t1; t<=t2; t++) {
+        z[t] = xy_calc(z[t], y != NULL ? y[t] : yt, p->op, SERIES, p);
+    }
+}
+
 static int save_generated_var (parser *p, PRN *prn)
 {
     NODE *r = p->ret;
@@ -22031,7 +24755,7 @@ static int save_generated_var (parser *p, PRN *prn)
     double x;
     int no_decl = 0;
     int strv_ovwrite = 0;
-    int t, v = 0;
+    int v = 0;
 
 #if EDEBUG
     fprintf(stderr, "\nsave (%s): lhname='%s', callcount %d\n"
@@ -22158,14 +24882,11 @@ static int save_generated_var (parser *p, PRN *prn)
                     memcpy(Z[v] + p->dset->t1, x + p->dset->t1, sz);
                 }
             } else {
-                for (t=p->dset->t1; t<=p->dset->t2; t++) {
-                    Z[v][t] = xy_calc(Z[v][t], x[t], p->op, SERIES, p);
-                }
+                /* inflected: update the target in place */
+                series_inflect(Z[v], x, NADBL, p);
             }
         } else if (r->t == NUM) {
-            for (t=p->dset->t1; t<=p->dset->t2; t++) {
-                Z[v][t] = xy_calc(Z[v][t], r->v.xval, p->op, SERIES, p);
-            }
+            series_inflect(Z[v], NULL, r->v.xval, p);
         } else if (r->t == MAT) {
             series_from_matrix(Z[v], r->v.m, p);
         } else if (r->t == ARRAY) {
@@ -22450,6 +25171,7 @@ static void parser_init (parser *p, const char *str,
     p->lhres = NULL;
     p->tree = NULL;
     p->ret = NULL;
+    p->vm = NULL;
 
     /* left-hand side info */
     p->lh.t = 0;
@@ -22598,6 +25320,9 @@ void gen_cleanup (parser *p)
         rndebug(("freeing p->ret %p\n", (void *) p->ret));
         free_tree(p->ret, p, FR_RET);
 
+        genvm_destroy(p->vm);
+        p->vm = NULL;
+
         free(p->lh.expr);
     }
 
@@ -22635,6 +25360,184 @@ void genr_reset_uvars (parser *p)
     real_reset_uvars(p);
 }
 
+/* Support for the hoisting of loop-invariant statements (see
+   monte_carlo.c). The functions allowed in an invariant expression
+   are a superset of those allowed in a common subexpression: they
+   have no side effects and their values depend on nothing but their
+   operands.
+*/
+
+static int invariant_op (int f)
+{
+    switch (f) {
+    case F_CHOL:
+    case F_INVPD:
+    case F_ROWS:
+    case F_COLS:
+    case F_DIAG:
+    case F_TRACE:
+    case F_CDEMEAN:
+    case B_HCAT:
+    case B_VCAT:
+        return 1;
+    default:
+        return cse_pure_op(f);
+    }
+}
+
+static int tree_invariant_inputs (NODE *t, char ***pS, int *ns)
+{
+    if (t == NULL || t->t == EMPTY) {
+        return 1;
+    } else if (t->t == CSE) {
+        /* the owner of a shared subtree holds it as L; a reference
+           points to an owner elsewhere in the tree */
+        return tree_invariant_inputs(t->L, pS, ns);
+    } else if (t->t == NUM || t->t == MAT) {
+        if (t->vname != NULL) {
+            return strings_array_add_uniq(pS, ns, t->vname, NULL) == 0;
+        } else {
+            /* numeric literal OK, anonymous matrix not */
+            return t->t == NUM;
+        }
+    } else if (invariant_op(t->t)) {
+        return tree_invariant_inputs(t->L, pS, ns) &&
+            tree_invariant_inputs(t->M, pS, ns) &&
+            tree_invariant_inputs(t->R, pS, ns);
+    } else {
+        return 0;
+    }
+}
+
+/**
+ * genr_get_invariant_inputs:
+ * @p: pointer to compiled generator.
+ * @pS: location of array of strings.
+ * @ns: location of number of strings in @pS.
+ *
+ * Determines whether @p is a plain assignment to a named scalar
+ * or matrix of an expression whose value depends only on named
+ * scalars and matrices, via operators and functions that have no
+ * side effects. If so, the names of the variables referenced are
+ * added to @pS.
+ *
+ * Returns: 1 if @p is such an assignment, otherwise 0.
+ */
+
+int genr_get_invariant_inputs (const parser *p, char ***pS, int *ns)
+{
+    if (p->err || p->op != B_ASN || p->lh.name[0] == '\0' ||
+        p->lhtree != NULL || p->tree == NULL) {
+        return 0;
+    } else if (p->targ != NUM && p->targ != MAT) {
+        return 0;
+    } else if (p->flags & (P_DECL | P_DISCARD | P_VOID | P_AUTOREG |
+                           P_PRIV | P_ANON)) {
+        return 0;
+    } else {
+        return tree_invariant_inputs(p->tree, pS, ns);
+    }
+}
+
+static int tree_get_writes (NODE *t, char ***pS, int *ns)
+{
+    int i, ret = 0;
+
+    if (t == NULL) {
+        return 0;
+    }
+
+    switch (t->t) {
+    case U_ADDR:
+        /* pointer argument to a function */
+        if (t->L != NULL && t->L->vname != NULL) {
+            return strings_array_add(pS, ns, t->L->vname) != 0;
+        } else {
+            return 1;
+        }
+    case NUM_P:
+    case NUM_M:
+        if (t->vname != NULL) {
+            return strings_array_add(pS, ns, t->vname) != 0;
+        } else {
+            return 1;
+        }
+    case INC:
+    case DEC:
+    case B_ASN:
+    case B_DOTASN:
+    case F_GENSERIES:
+    case F_FEVAL:
+    case F_FEVALB:
+    case F_SPAWN:
+    case F_AWAIT:
+    case F_MPIMAP:
+    case F_PERMTEST:
+        return 1;
+    default:
+        break;
+    }
+
+    if (bnsym(t->t)) {
+        for (i=0; i<t->v.bn.n_nodes && !ret; i++) {
+            ret = tree_get_writes(t->v.bn.n[i], pS, ns);
+        }
+    } else {
+        ret = tree_get_writes(t->L, pS, ns) ||
+            tree_get_writes(t->M, pS, ns) ||
+            tree_get_writes(t->R, pS, ns);
+    }
+
+    return ret;
+}
+
+/**
+ * genr_get_writes:
+ * @p: pointer to compiled generator.
+ * @pS: location of array of strings.
+ * @ns: location of number of strings in @pS.
+ *
+ * Adds to @pS the names of the variables that may be assigned
+ * on execution of @p: the target, if any, plus variables passed
+ * in pointer form to functions. A name is added once for each
+ * such use.
+ *
+ * Returns: 0 if all such variables were identified, 1 if @p
+ * may modify variables that cannot be identified in advance.
+ */
+
+int genr_get_writes (const parser *p, char ***pS, int *ns)
+{
+    int ret = 0;
+
+    if (p->flags & P_DECL) {
+        return 1;
+    } else if (p->lh.name[0] != '\0') {
+        ret = strings_array_add(pS, ns, p->lh.name) != 0;
+    } else if (p->lh.expr != NULL) {
+        /* compound target: the first identifier names the
+           variable to be modified */
+        int n = gretl_namechar_spn(p->lh.expr);
+
+        if (n > 0 && n < VNAMELEN) {
+            char vname[VNAMELEN];
+
+            *vname = '\0';
+            strncat(vname, p->lh.expr, n);
+            ret = strings_array_add(pS, ns, vname) != 0;
+        } else {
+            ret = 1;
+        }
+    }
+
+    if (!ret) {
+        ret = tree_get_writes(p->lhtree, pS, ns) ||
+            tree_get_writes(p->tree, pS, ns);
+    }
+
+    return ret;
+}
+
 static void maybe_set_return_flags (parser *p)
 {
     NODE *t = p->tree;
@@ -22716,6 +25619,7 @@ int realgen (const char *s, parser *p, DATASET *dset, PRN *prn,
         fprintf(stderr, "*** printing p->tree (before reinit)\n");
         print_tree(p->tree, p, 0, 0);
 #endif
+        gstat_inc(reuses);
         parser_reinit(p, dset, prn);
         if (p->err) {
             fprintf(stderr, "error in parser_reinit\n");
@@ -22760,6 +25664,7 @@ int realgen (const char *s, parser *p, DATASET *dset, PRN *prn,
     }
 
     /* fire up the lexer */
+    gstat_inc(parses);
     lex(p);
     if (p->err) {
 #if EDEBUG
@@ -22800,6 +25705,12 @@ int realgen (const char *s, parser *p, DATASET *dset, PRN *prn,
         goto gen_finish;
     }
 
+    /* simplify the tree if possible */
+    optimize_tree(p);
+    if (p->err) {
+        goto gen_finish;
+    }
+
     if (flags & P_NOEXEC) {
         /* we're done at this point */
         goto gen_finish;
@@ -22856,7 +25767,12 @@ int realgen (const char *s, parser *p, DATASET *dset, PRN *prn,
         }
     } else {
         /* standard non-dynamic evaluation */
-        p->ret = eval(p->tree, p);
+        if (!(p->flags & P_EXEC) || !genvm_exec(p)) {
+            cse_pass++;
+            p->ret = eval(p->tree, p);
+        } else {
+            gstat_inc(vm_runs);
+        }
     }
 
     if (p->flags & P_EXEC) {
@@ -22889,3 +25805,7 @@ int realgen (const char *s, parser *p, DATASET *dset, PRN *prn,
 
     return p->err;
 }
+
+/* automatic differentiation of compiled trees */
+
+#include "genad.c"
@@ -32,7 +32,7 @@
 #include "matrix_extra.h"
 #include "gretl_btree.h"
 #include "gretl_func.h"
-#include "kalman.h"
+#include "gretl_mt.h"
 #include "../../cephes/cephes.h"
 
 #include <errno.h>
@@ -121,43 +121,139 @@ int gretl_sort_by (const double *x, const double *y,
     return 0;
 }
 
-static void genrank (const double *sz, int m,
-                     const double *z, int n,
-                     double *rz)
-{
-    int cases, k, i, j;
-    double avg, r = 1;
+#define RANK_RUN 32
 
-    for (i=0; i<m; i++) {
-        /* scan sorted z */
-        cases = k = 0;
+/* Stable merge sort of the indices in @idx by the values in @x,
+   ascending or (if @desc is non-zero) descending, with @tmp as
+   workspace. Runs of RANK_RUN are first put in order by insertion,
+   then merged pairwise; the runs, and the merges at each pass, are
+   independent of each other, so given enough data they're shared
+   out among threads.
+*/
 
-        if (i > 0 && sz[i] == sz[i-1]) {
-            continue;
-        }
+static void rank_merge_sort (const double *x, int *idx, int *tmp,
+                             int n, int desc)
+{
+    int par = gretl_use_openmp((guint64) n);
+    int *src = idx, *dest = tmp, *swap;
+    int lo, w;
 
-        for (j=0; j<n; j++) {
-            /* scan raw z for matches */
-            if (!na(z[j])) {
-                if (z[j] == sz[i]) {
-                    rz[k] = r;
-                    cases++;
+#if defined(_OPENMP)
+#pragma omp parallel for if (par)
+#endif
+    for (lo=0; lo<n; lo+=RANK_RUN) {
+        int hi = MIN(lo + RANK_RUN, n);
+        int i, j, k;
+
+        for (i=lo+1; i<hi; i++) {
+            k = idx[i];
+            for (j=i; j>lo; j--) {
+                if (desc ? x[idx[j-1]] >= x[k] : x[idx[j-1]] <= x[k]) {
+                    break;
                 }
-                k++;
+                idx[j] = idx[j-1];
             }
+            idx[j] = k;
         }
+    }
 
-        if (cases > 1) {
-            avg = (r + r + cases - 1.0) / 2.0;
-            for (j=0; j<m; j++) {
-                if (rz[j] == r) {
-                    rz[j] = avg;
+    for (w=RANK_RUN; w<n; w*=2) {
+#if defined(_OPENMP)
+#pragma omp parallel for if (par && n / w > 2)
+#endif
+        for (lo=0; lo<n; lo+=2*w) {
+            int mid = MIN(lo + w, n);
+            int hi = MIN(lo + 2*w, n);
+            int i = lo, j = mid, k = lo;
+
+            while (i < mid && j < hi) {
+                if (desc ? x[src[j]] > x[src[i]] : x[src[j]] < x[src[i]]) {
+                    dest[k++] = src[j++];
+                } else {
+                    dest[k++] = src[i++];
                 }
             }
+            while (i < mid) {
+                dest[k++] = src[i++];
+            }
+            while (j < hi) {
+                dest[k++] = src[j++];
+            }
+        }
+        swap = src;
+        src = dest;
+        dest = swap;
+    }
+
+    if (src != idx) {
+        memcpy(idx, src, n * sizeof *idx);
+    }
+}
+
+/**
+ * gretl_rank_values:
+ * @x: array of values (none of them missing).
+ * @n: number of values.
+ * @desc: if non-zero, rank from the largest value down,
+ * otherwise from the smallest up.
+ * @rank: array of length @n to receive the ranks.
+ * @order: array of length @n to receive the indices of the
+ * elements of @x in rank order, or %NULL.
+ *
+ * Ranks the @n values in @x, with tied values receiving the
+ * average of the ranks they span, by means of a sort which
+ * may be run on several threads. This is the common basis for
+ * the ranking functions and the rank-based tests.
+ *
+ * Returns: 0 on success, non-zero on failure.
+ */
+
+int gretl_rank_values (const double *x, int n, int desc,
+                       double *rank, int *order)
+{
+    int *idx, *tmp;
+    double avg, r = 1;
+    int cases, i, j;
+
+    if (n <= 0) {
+        return 0;
+    }
+
+    idx = (order != NULL)? order : malloc(n * sizeof *idx);
+    tmp = malloc(n * sizeof *tmp);
+
+    if (idx == NULL || tmp == NULL) {
+        if (idx != order) {
+            free(idx);
         }
+        free(tmp);
+        return E_ALLOC;
+    }
+
+    for (i=0; i<n; i++) {
+        idx[i] = i;
+    }
+
+    rank_merge_sort(x, idx, tmp, n, desc);
 
+    for (i=0; i<n; i+=cases) {
+        cases = 1;
+        while (i + cases < n && x[idx[i+cases]] == x[idx[i]]) {
+            cases++;
+        }
+        avg = (r + r + cases - 1.0) / 2.0;
+        for (j=i; j<i+cases; j++) {
+            rank[idx[j]] = avg;
+        }
         r += cases;
     }
+
+    if (idx != order) {
+        free(idx);
+    }
+    free(tmp);
+
+    return 0;
 }
 
 /* implements both rank_series() and rank_vector() */
@@ -167,7 +263,7 @@ static int rank_array (const double *x, double *y, int f, int n)
     double *sx = NULL;
     double *rx = NULL;
     int m = n;
-    int i, t;
+    int i, t, err;
 
     for (t=0; t<n; t++) {
         if (na(x[t])) m--;
@@ -185,33 +281,27 @@ static int rank_array (const double *x, double *y, int f, int n)
     i = 0;
     for (t=0; t<n; t++) {
         if (!na(x[t])) {
-            sx[i] = x[t];
-            rx[i] = 0.0;
-            i++;
+            sx[i++] = x[t];
         }
     }
 
-    if (f == F_DSORT) {
-        qsort(sx, m, sizeof *sx, gretl_inverse_compare_doubles);
-    } else {
-        qsort(sx, m, sizeof *sx, gretl_compare_doubles);
-    }
-
-    genrank(sx, m, x, n, rx);
+    err = gretl_rank_values(sx, m, f == F_DSORT, rx, NULL);
 
-    i = 0;
-    for (t=0; t<n; t++) {
-        if (na(x[t])) {
-            y[t] = NADBL;
-        } else {
-            y[t] = rx[i++];
+    if (!err) {
+        i = 0;
+        for (t=0; t<n; t++) {
+            if (na(x[t])) {
+                y[t] = NADBL;
+            } else {
+                y[t] = rx[i++];
+            }
         }
     }
 
     free(sx);
     free(rx);
 
-    return 0;
+    return err;
 }
 
 int rank_series (const double *x, double *y, int f,
@@ -1376,6 +1466,407 @@ int movavg_series (const double *x, double *y, const DATASET *dset,
     return 0;
 }
 
+/* Rolling-window statistics: each kernel works on a run of
+   @n valid observations and writes the statistic for the
+   window of @k observations ending at each i >= k-1.
+*/
+
+enum {
+    MOVSTAT_MEAN = 1,
+    MOVSTAT_VAR,
+    MOVSTAT_SD,
+    MOVSTAT_MIN,
+    MOVSTAT_MAX,
+    MOVSTAT_QUANTILE
+};
+
+/* Running mean and variance: Welford-type update on replacing
+   the oldest value in the window with the newest one. To stop
+   rounding error from accumulating over a long run, the moments
+   are recomputed directly every @k steps, which keeps the cost
+   O(1) per observation on average.
+*/
+
+static void movstat_moments (const double *x, double *y,
+                             int n, int k, int code)
+{
+    double m = 0, M2 = 0;
+    double d, mprev, xold;
+    int i, j;
+
+    for (i=k-1; i<n; i++) {
+        if ((i - k + 1) % k == 0) {
+            /* (re-)initialize on the current window */
+            m = M2 = 0.0;
+            for (j=i-k+1; j<=i; j++) {
+                m += x[j];
+            }
+            m /= k;
+            for (j=i-k+1; j<=i; j++) {
+                d = x[j] - m;
+                M2 += d * d;
+            }
+        } else {
+            xold = x[i-k];
+            mprev = m;
+            m += (x[i] - xold) / k;
+            M2 += (x[i] - xold) * (x[i] - m + xold - mprev);
+            if (M2 < 0) {
+                M2 = 0.0;
+            }
+        }
+        if (code == MOVSTAT_MEAN) {
+            y[i] = m;
+        } else if (code == MOVSTAT_VAR) {
+            y[i] = M2 / (k - 1);
+        } else {
+            y[i] = sqrt(M2 / (k - 1));
+        }
+    }
+}
+
+/* Running minimum or maximum via a monotone deque of indices
+   into @x: each index enters and leaves the deque once. The
+   workspace @dq must have room for @n ints.
+*/
+
+static void movstat_extreme (const double *x, double *y,
+                             int n, int k, int code, int *dq)
+{
+    int head = 0, tail = 0;
+    int i;
+
+    for (i=0; i<n; i++) {
+        if (code == MOVSTAT_MIN) {
+            while (tail > head && x[dq[tail-1]] >= x[i]) tail--;
+        } else {
+            while (tail > head && x[dq[tail-1]] <= x[i]) tail--;
+        }
+        dq[tail++] = i;
+        if (dq[head] <= i - k) {
+            head++;
+        }
+        if (i >= k - 1) {
+            y[i] = x[dq[head]];
+        }
+    }
+}
+
+/* Two heaps for a running quantile: heap 0 is a max-heap holding
+   the lowest @nlo values in the window and heap 1 a min-heap
+   holding the rest, so the tops of the two heaps are adjacent
+   order statistics. The heaps hold "slots" (positions in a ring
+   buffer of length k), and @pos and @which record where each
+   slot currently sits, so that the value leaving the window can
+   be replaced in place in O(log k).
+*/
+
+typedef struct qheaps_ {
+    double *v;  /* values, by slot */
+    int *h[2];  /* the two heaps */
+    int n[2];   /* heap sizes */
+    int *pos;   /* position of each slot in its heap */
+    int *which; /* the heap holding each slot */
+} qheaps;
+
+static inline int qh_before (const qheaps *q, int w, int a, int b)
+{
+    return w == 0 ? q->v[a] > q->v[b] : q->v[a] < q->v[b];
+}
+
+static void qh_sift (qheaps *q, int w, int i)
+{
+    int *h = q->h[w];
+    int n = q->n[w];
+    int c, s;
+
+    while (i > 0 && qh_before(q, w, h[i], h[(i-1)/2])) {
+        c = (i-1)/2;
+        s = h[i]; h[i] = h[c]; h[c] = s;
+        q->pos[h[i]] = i;
+        q->pos[h[c]] = c;
+        i = c;
+    }
+    while ((c = 2*i + 1) < n) {
+        if (c + 1 < n && qh_before(q, w, h[c+1], h[c])) {
+            c++;
+        }
+        if (!qh_before(q, w, h[c], h[i])) {
+            break;
+        }
+        s = h[i]; h[i] = h[c]; h[c] = s;
+        q->pos[h[i]] = i;
+        q->pos[h[c]] = c;
+        i = c;
+    }
+}
+
+static void qh_replace (qheaps *q, int slot, double xval)
+{
+    q->v[slot] = xval;
+    qh_sift(q, q->which[slot], q->pos[slot]);
+
+    if (q->n[0] > 0 && q->n[1] > 0) {
+        int a = q->h[0][0];
+        int b = q->h[1][0];
+
+        if (q->v[a] > q->v[b]) {
+            /* swap the tops across the heaps */
+            q->h[0][0] = b;
+            q->h[1][0] = a;
+            q->which[a] = 1;
+            q->which[b] = 0;
+            qh_sift(q, 0, 0);
+            qh_sift(q, 1, 0);
+        }
+    }
+}
+
+struct xslot {
+    double x;
+    int s;
+};
+
+/* @h is the (0-based) quantile index for a window of @k
+   observations, as given by gretl_quantile_index() */
+
+static void movstat_quantile (const double *x, double *y,
+                              int n, int k, double h,
+                              qheaps *q, struct xslot *xs)
+{
+    int hf = floor(h);
+    int hc = ceil(h);
+    double lo, frac = h - hf;
+    int i, j, nlo = hf + 1;
+
+    if (hc == 0 || hc == k) {
+        /* too few observations for this quantile */
+        return;
+    }
+
+    /* load the first window: the slot for x[i] is i % k */
+    for (i=0; i<k; i++) {
+        q->v[i] = xs[i].x = x[i];
+        xs[i].s = i;
+    }
+    qsort(xs, k, sizeof *xs, gretl_compare_doubles);
+    q->n[0] = nlo;
+    q->n[1] = k - nlo;
+    /* a descending array is a max-heap, an ascending one a min-heap */
+    for (j=0; j<nlo; j++) {
+        i = xs[nlo-1-j].s;
+        q->h[0][j] = i;
+        q->pos[i] = j;
+        q->which[i] = 0;
+    }
+    for (j=0; j<k-nlo; j++) {
+        i = xs[nlo+j].s;
+        q->h[1][j] = i;
+        q->pos[i] = j;
+        q->which[i] = 1;
+    }
+
+    for (i=k-1; i<n; i++) {
+        if (i >= k) {
+            qh_replace(q, i % k, x[i]);
+        }
+        lo = q->v[q->h[0][0]];
+        if (frac > 0) {
+            y[i] = lo + frac * (q->v[q->h[1][0]] - lo);
+        } else {
+            y[i] = lo;
+        }
+    }
+}
+
+struct movstat_work {
+    int *dq;
+    qheaps q;
+    struct xslot *xs;
+    double *v;
+};
+
+static int movstat_work_init (struct movstat_work *mw, int code,
+                              int T, int k)
+{
+    mw->dq = NULL;
+    mw->xs = NULL;
+    mw->v = NULL;
+    mw->q.h[0] = NULL;
+
+    if (code == MOVSTAT_MIN || code == MOVSTAT_MAX) {
+        mw->dq = malloc(T * sizeof *mw->dq);
+        return mw->dq == NULL ? E_ALLOC : 0;
+    } else if (code == MOVSTAT_QUANTILE) {
+        mw->v = malloc(k * sizeof *mw->v);
+        mw->xs = malloc(k * sizeof *mw->xs);
+        mw->q.h[0] = malloc(4 * k * sizeof(int));
+        if (mw->v == NULL || mw->xs == NULL || mw->q.h[0] == NULL) {
+            return E_ALLOC;
+        }
+        mw->q.v = mw->v;
+        mw->q.h[1] = mw->q.h[0] + k;
+        mw->q.pos = mw->q.h[1] + k;
+        mw->q.which = mw->q.pos + k;
+    }
+
+    return 0;
+}
+
+static void movstat_work_free (struct movstat_work *mw)
+{
+    free(mw->dq);
+    free(mw->xs);
+    free(mw->v);
+    free(mw->q.h[0]);
+}
+
+/* Apply the statistic to the range @s1 to @s2 of @x, one
+   run of valid observations at a time: windows that include
+   a missing value give NA.
+*/
+
+static void movstat_range (const double *x, double *y, int s1, int s2,
+                           int k, int code, double h,
+                           struct movstat_work *mw)
+{
+    int r0, r1;
+
+    for (r0=s1; r0<=s2; r0=r1) {
+        y[r0] = NADBL;
+        if (na(x[r0])) {
+            r1 = r0 + 1;
+            continue;
+        }
+        for (r1=r0+1; r1<=s2 && !na(x[r1]); r1++) {
+            y[r1] = NADBL;
+        }
+        if (r1 - r0 < k) {
+            continue;
+        }
+        if (code == MOVSTAT_MIN || code == MOVSTAT_MAX) {
+            movstat_extreme(x + r0, y + r0, r1 - r0, k, code, mw->dq);
+        } else if (code == MOVSTAT_QUANTILE) {
+            movstat_quantile(x + r0, y + r0, r1 - r0, k, h,
+                             &mw->q, mw->xs);
+        } else {
+            movstat_moments(x + r0, y + r0, r1 - r0, k, code);
+        }
+    }
+}
+
+static int movstat_code (const char *s)
+{
+    if (!strcmp(s, "mean")) {
+        return MOVSTAT_MEAN;
+    } else if (!strcmp(s, "var")) {
+        return MOVSTAT_VAR;
+    } else if (!strcmp(s, "sd")) {
+        return MOVSTAT_SD;
+    } else if (!strcmp(s, "min")) {
+        return MOVSTAT_MIN;
+    } else if (!strcmp(s, "max")) {
+        return MOVSTAT_MAX;
+    } else if (!strcmp(s, "median") || !strcmp(s, "quantile")) {
+        return MOVSTAT_QUANTILE;
+    } else {
+        return 0;
+    }
+}
+
+/**
+ * movstat_series:
+ * @x: array of original data.
+ * @y: array into which to write the result.
+ * @dset: data set information.
+ * @k: number of observations in the window.
+ * @stat: the statistic: "mean", "var", "sd", "min", "max",
+ * "median" or "quantile".
+ * @p: probability, for "quantile" only.
+ *
+ * Writes into @y the value of @stat for the @k observations
+ * of @x up to and including each observation (NA if any of
+ * these observations is missing). Each statistic is updated
+ * as the window moves, so the cost does not depend on @k
+ * (apart from a log(k) factor for quantiles). With panel data
+ * the windows do not cross unit boundaries, and the units are
+ * handled in parallel.
+ *
+ * Returns: 0 on success, non-zero error code on failure.
+ */
+
+int movstat_series (const double *x, double *y, const DATASET *dset,
+                    int k, const char *stat, double p)
+{
+    int code = movstat_code(stat);
+    int t1 = dset->t1;
+    int t2 = dset->t2;
+    double h = 0;
+    int err = 0;
+
+    if (code == 0 || k < 1) {
+        return E_INVARG;
+    } else if (k == 1 && (code == MOVSTAT_VAR || code == MOVSTAT_SD)) {
+        return E_INVARG;
+    }
+
+    if (!strcmp(stat, "median")) {
+        p = 0.5;
+    } else if (code == MOVSTAT_QUANTILE && (na(p) || p <= 0 || p >= 1)) {
+        return E_INVARG;
+    }
+
+    if (code == MOVSTAT_QUANTILE) {
+        /* depends on "set quantile_type": look it up here, not
+           in the OpenMP workers */
+        h = gretl_quantile_index(k, p);
+    }
+
+    if (dataset_is_panel(dset)) {
+        int T = dset->pd;
+        int u1 = t1 / T;
+        int u2 = t2 / T;
+        int u;
+
+#if defined(_OPENMP)
+#pragma omp parallel if (gretl_use_openmp((guint64) (t2 - t1 + 1) * 8))
+#endif
+        {
+            struct movstat_work mw;
+            int s1, s2, uerr;
+
+            uerr = movstat_work_init(&mw, code, T, k);
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+            for (u=u1; u<=u2; u++) {
+                if (!uerr) {
+                    s1 = (u*T < t1)? t1 : u*T;
+                    s2 = (u*T + T - 1 > t2)? t2 : u*T + T - 1;
+                    movstat_range(x, y, s1, s2, k, code, h, &mw);
+                }
+            }
+            if (uerr) {
+#if defined(_OPENMP)
+#pragma omp critical (movstat_err)
+#endif
+                err = uerr;
+            }
+            movstat_work_free(&mw);
+        }
+    } else {
+        struct movstat_work mw;
+
+        err = movstat_work_init(&mw, code, t2 - t1 + 1, k);
+        if (!err) {
+            movstat_range(x, y, t1, t2, k, code, h, &mw);
+        }
+        movstat_work_free(&mw);
+    }
+
+    return err;
+}
+
 int seasonally_adjust_series (const double *x, double *y,
                               const char *vname, DATASET *dset,
                               int tramo, gretl_bundle *b,
@@ -1476,55 +1967,653 @@ int tramo_linearize_series (const double *x, double *y,
     return err;
 }
 
-#define panel_obs_ok(x,t,m) ((m == NULL || m[t] != 0) && !na(x[t]))
-#define panel_obs_masked(m,t) (m != NULL && m[t] == 0)
+/* Group-by engine, shared by aggregate() and the panel statistics.
+   The observations are mapped onto groups in a single hashed pass
+   over the "by" values, then scattered (stably) into contiguous
+   per-group blocks of indices, so that any number of statistics
+   can be computed on any number of series without re-scanning or
+   re-sorting the data.
+*/
 
-#define PXSUM_SKIP_NA 1
+#define GB_OMP_MIN 20000
 
-/* Run a check for time-invariance of a panel series. If it isn't
-   time-invariant that should become apparent quickly, but if it is
-   we get a substantial shortcut for standard deviation.
-*/
+typedef struct groupby_ groupby;
 
-static int time_invariant (const double *x,
-                           int u1, int u2, int T,
-                           const double *mask)
+struct groupby_ {
+    int n;              /* number of observations */
+    int ng;             /* number of groups */
+    int maxcount;       /* size of the largest group */
+    int *start;         /* offsets of the groups in @perm (ng + 1) */
+    int *perm;          /* observation indices, ordered by group */
+    gretl_matrix *keys; /* ng x ny: the by-values for each group */
+};
+
+static uint64_t gb_mix (uint64_t u)
 {
-    double xmin, xmax;
-    int i, t, s;
-    int ret = 1;
+    u ^= u >> 30;
+    u *= 0xbf58476d1ce4e5b9ULL;
+    u ^= u >> 27;
+    u *= 0x94d049bb133111ebULL;
+    u ^= u >> 31;
 
-    for (i=u1; i<=u2 && ret; i++) {
-        xmin = xmax = NADBL;
-        for (t=0; t<T && ret; t++) {
-            s = i*T + t;
-            if (panel_obs_ok(x, s, mask)) {
-                if (na(xmax)) {
-                    xmin = xmax = x[s];
-                } else if (x[s] < xmin) {
-                    xmin = x[s];
-                } else if (x[s] > xmax) {
-                    xmax = x[s];
-                }
-            }
-            if (xmax > xmin) {
-                ret = 0;
-            }
-        }
-        if (ret && na(xmax)) {
-            ret = 0;
-        }
+    return u;
+}
+
+static uint64_t gb_hash_double (double x)
+{
+    uint64_t u;
+
+    if (x == 0.0) {
+        /* don't distinguish -0 from 0 */
+        x = 0.0;
     }
+    memcpy(&u, &x, sizeof u);
 
-    return ret;
+    return gb_mix(u);
 }
 
-/**
- * panel_statistic:
- * @x: source data.
- * @y: target into which to write.
- * @dset: data set information.
- * @k: code representing the desired statistic: F_PNOBS,
+static int gb_table_size (int k)
+{
+    int sz = 16;
+
+    while (sz < 2 * k) {
+        sz <<= 1;
+    }
+
+    return sz;
+}
+
+static void groupby_free (groupby *gb)
+{
+    if (gb != NULL) {
+        free(gb->start);
+        free(gb->perm);
+        gretl_matrix_free(gb->keys);
+        free(gb);
+    }
+}
+
+/* Write into @rank the 0-based position of y[t] among the sorted
+   distinct values in @vals, or -1 if y[t] is missing.
+*/
+
+static int gb_rank_values (const double *y, int n,
+                           const gretl_matrix *vals,
+                           int *rank)
+{
+    int k = gretl_vector_get_length(vals);
+    int sz = gb_table_size(k);
+    int mask = sz - 1;
+    int *tab;
+    int i, h, t;
+
+    tab = malloc(sz * sizeof *tab);
+    if (tab == NULL) {
+        return E_ALLOC;
+    }
+
+    for (h=0; h<sz; h++) {
+        tab[h] = -1;
+    }
+    for (i=0; i<k; i++) {
+        h = gb_hash_double(vals->val[i]) & mask;
+        while (tab[h] >= 0) {
+            h = (h + 1) & mask;
+        }
+        tab[h] = i;
+    }
+
+    for (t=0; t<n; t++) {
+        rank[t] = -1;
+        if (!na(y[t])) {
+            h = gb_hash_double(y[t]) & mask;
+            while (tab[h] >= 0) {
+                if (vals->val[tab[h]] == y[t]) {
+                    rank[t] = tab[h];
+                    break;
+                }
+                h = (h + 1) & mask;
+            }
+        }
+    }
+
+    free(tab);
+
+    return 0;
+}
+
+static int compare_int64 (const void *a, const void *b)
+{
+    const int64_t *ia = a;
+    const int64_t *ib = b;
+
+    return (*ia > *ib) - (*ia < *ib);
+}
+
+/* Replace the (non-negative) composite codes in @code by dense
+   group indices 0, 1, ... that respect the ordering of the codes.
+   Negative codes (missing by-values) are passed through as -1.
+*/
+
+static int gb_densify (int64_t *code, int n, int *ng)
+{
+    int64_t *dist = NULL;
+    int *tab = NULL;
+    int sz, mask;
+    int i, h, t, nd = 0;
+
+    sz = gb_table_size(n);
+    mask = sz - 1;
+    tab = malloc(sz * sizeof *tab);
+    dist = malloc(n * sizeof *dist);
+    if (tab == NULL || dist == NULL) {
+        free(tab);
+        free(dist);
+        return E_ALLOC;
+    }
+
+    /* collect the distinct codes */
+    for (h=0; h<sz; h++) {
+        tab[h] = -1;
+    }
+    for (t=0; t<n; t++) {
+        if (code[t] >= 0) {
+            h = gb_mix(code[t]) & mask;
+            while (tab[h] >= 0 && dist[tab[h]] != code[t]) {
+                h = (h + 1) & mask;
+            }
+            if (tab[h] < 0) {
+                tab[h] = nd;
+                dist[nd++] = code[t];
+            }
+        }
+    }
+
+    /* order them, and re-index the table accordingly */
+    qsort(dist, nd, sizeof *dist, compare_int64);
+    for (h=0; h<sz; h++) {
+        tab[h] = -1;
+    }
+    for (i=0; i<nd; i++) {
+        h = gb_mix(dist[i]) & mask;
+        while (tab[h] >= 0) {
+            h = (h + 1) & mask;
+        }
+        tab[h] = i;
+    }
+
+    for (t=0; t<n; t++) {
+        if (code[t] >= 0) {
+            h = gb_mix(code[t]) & mask;
+            while (dist[tab[h]] != code[t]) {
+                h = (h + 1) & mask;
+            }
+            code[t] = tab[h];
+        } else {
+            code[t] = -1;
+        }
+    }
+
+    *ng = nd;
+
+    free(tab);
+    free(dist);
+
+    return 0;
+}
+
+/* Given a group index for each observation (-1 for exclusion),
+   arrange the observation indices by group.
+*/
+
+static int groupby_scatter (groupby *gb, const int64_t *gid)
+{
+    int *pos;
+    int g, t;
+
+    gb->start = calloc(gb->ng + 1, sizeof *gb->start);
+    gb->perm = malloc((gb->n + 1) * sizeof *gb->perm);
+    if (gb->start == NULL || gb->perm == NULL) {
+        return E_ALLOC;
+    }
+
+    for (t=0; t<gb->n; t++) {
+        if (gid[t] >= 0) {
+            gb->start[gid[t] + 1] += 1;
+        }
+    }
+    gb->maxcount = 0;
+    for (g=0; g<gb->ng; g++) {
+        if (gb->start[g+1] > gb->maxcount) {
+            gb->maxcount = gb->start[g+1];
+        }
+        gb->start[g+1] += gb->start[g];
+    }
+
+    pos = malloc((gb->ng + 1) * sizeof *pos);
+    if (pos == NULL) {
+        return E_ALLOC;
+    }
+    memcpy(pos, gb->start, (gb->ng + 1) * sizeof *pos);
+    for (t=0; t<gb->n; t++) {
+        if (gid[t] >= 0) {
+            gb->perm[pos[gid[t]]++] = t;
+        }
+    }
+    free(pos);
+
+    return 0;
+}
+
+/* Build the groups defined by the @ny arrays of discrete values in
+   @Y, each of length @n. If @full is non-zero there's one group for
+   each combination of the distinct values of the Y columns, whether
+   or not the combination occurs in the data; otherwise only the
+   realized combinations are represented. Either way the groups are
+   in ascending lexicographic order of the by-values. Observations
+   at which any of the Y values is missing are excluded.
+*/
+
+static groupby *groupby_new (const double **Y, int ny, int n,
+                             int full, int *err)
+{
+    groupby *gb = NULL;
+    gretl_matrix **vals = NULL;
+    int64_t *code = NULL;
+    int *rank = NULL;
+    double ncells = 1;
+    int i, j, t;
+
+    gb = calloc(1, sizeof *gb);
+    vals = calloc(ny, sizeof *vals);
+    code = malloc(n * sizeof *code);
+    rank = malloc(n * sizeof *rank);
+
+    if (gb == NULL || vals == NULL || code == NULL || rank == NULL) {
+        *err = E_ALLOC;
+        goto bailout;
+    }
+
+    gb->n = n;
+
+    for (j=0; j<ny && !*err; j++) {
+        vals[j] = gretl_matrix_values(Y[j], n, OPT_S, err);
+        if (!*err && gretl_is_null_matrix(vals[j])) {
+            *err = E_MISSDATA;
+        }
+        if (!*err) {
+            *err = gb_rank_values(Y[j], n, vals[j], rank);
+        }
+        if (*err) {
+            break;
+        }
+        ncells *= vals[j]->rows;
+        if (full && ncells > INT_MAX) {
+            gretl_errmsg_set(_("Too many combinations of by-values"));
+            *err = E_DATA;
+            break;
+        }
+        for (t=0; t<n; t++) {
+            if (j == 0 || code[t] < 0) {
+                code[t] = rank[t];
+            } else if (rank[t] < 0) {
+                code[t] = -1;
+            } else {
+                code[t] = code[t] * vals[j]->rows + rank[t];
+            }
+        }
+        if (!full && j > 0) {
+            /* keep the codes bounded by the number of
+               realized combinations */
+            int nd = 0;
+
+            *err = gb_densify(code, n, &nd);
+            ncells = nd;
+        }
+    }
+
+    if (!*err) {
+        gb->ng = (int) ncells;
+        if (gb->ng == 0) {
+            *err = E_MISSDATA;
+        }
+    }
+
+    if (!*err) {
+        gb->keys = gretl_matrix_alloc(gb->ng, ny);
+        if (gb->keys == NULL) {
+            *err = E_ALLOC;
+        }
+    }
+
+    if (!*err && full) {
+        /* fill the keys in mixed-radix order */
+        int g, r, k;
+
+        for (g=0; g<gb->ng; g++) {
+            r = g;
+            for (j=ny-1; j>=0; j--) {
+                k = vals[j]->rows;
+                gretl_matrix_set(gb->keys, g, j, vals[j]->val[r % k]);
+                r /= k;
+            }
+        }
+    } else if (!*err) {
+        /* take the keys from the data */
+        for (t=0; t<n; t++) {
+            if (code[t] >= 0) {
+                for (j=0; j<ny; j++) {
+                    gretl_matrix_set(gb->keys, code[t], j, Y[j][t]);
+                }
+            }
+        }
+    }
+
+    if (!*err) {
+        *err = groupby_scatter(gb, code);
+    }
+
+ bailout:
+
+    if (vals != NULL) {
+        for (i=0; i<ny; i++) {
+            gretl_matrix_free(vals[i]);
+        }
+        free(vals);
+    }
+    free(code);
+    free(rank);
+
+    if (*err) {
+        groupby_free(gb);
+        gb = NULL;
+    }
+
+    return gb;
+}
+
+/* Build the groups directly from a vector of (dense) group indices,
+   with -1 marking excluded observations.
+*/
+
+static groupby *groupby_from_ids (const int64_t *gid, int n, int ng,
+                                  int *err)
+{
+    groupby *gb = calloc(1, sizeof *gb);
+
+    if (gb == NULL) {
+        *err = E_ALLOC;
+    } else {
+        gb->n = n;
+        gb->ng = ng;
+        *err = groupby_scatter(gb, gid);
+        if (*err) {
+            groupby_free(gb);
+            gb = NULL;
+        }
+    }
+
+    return gb;
+}
+
+static inline int groupby_count (const groupby *gb, int g)
+{
+    return gb->start[g+1] - gb->start[g];
+}
+
+/* Copy the values of @x for group @g into @buf, returning the
+   number of values.
+*/
+
+static int groupby_gather (const groupby *gb, int g,
+                           const double *x, double *buf)
+{
+    const int *p = gb->perm + gb->start[g];
+    int i, ni = groupby_count(gb, g);
+
+    for (i=0; i<ni; i++) {
+        buf[i] = x[p[i]];
+    }
+
+    return ni;
+}
+
+/* Apply the built-in aggregator @dfunc (or @ifunc) to the values of
+   @x within each group, writing the results into @ret at stride
+   @rstride.
+*/
+
+static int groupby_apply (const groupby *gb, const double *x,
+                          double (*dfunc) (int, int, const double *),
+                          int (*ifunc) (int, int, const double *),
+                          double *ret, int rstride)
+{
+    int err = 0;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp parallel if (gb->n > GB_OMP_MIN && gb->ng > 1)
+#endif
+    {
+        double *buf = malloc((gb->maxcount + 1) * sizeof *buf);
+        double fx;
+        int g, ni;
+
+        if (buf == NULL) {
+            err = E_ALLOC;
+        }
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp for schedule(dynamic, 16)
+#endif
+        for (g=0; g<gb->ng; g++) {
+            if (buf == NULL) {
+                continue;
+            }
+            ni = groupby_gather(gb, g, x, buf);
+            if (dfunc != NULL) {
+                fx = (*dfunc)(0, ni-1, buf);
+            } else {
+                fx = (double) (*ifunc)(0, ni-1, buf);
+            }
+            ret[g * rstride] = fx;
+        }
+        free(buf);
+    }
+
+    return err;
+}
+
+#define panel_obs_ok(x,t,m) ((m == NULL || m[t] != 0) && !na(x[t]))
+#define panel_obs_masked(m,t) (m != NULL && m[t] == 0)
+
+#define PXSUM_SKIP_NA 1
+
+/* Run a check for time-invariance of a panel series. If it isn't
+   time-invariant that should become apparent quickly, but if it is
+   we get a substantial shortcut for standard deviation.
+*/
+
+static int time_invariant (const double *x,
+                           int u1, int u2, int T,
+                           const double *mask)
+{
+    double xmin, xmax;
+    int i, t, s;
+    int ret = 1;
+
+    for (i=u1; i<=u2 && ret; i++) {
+        xmin = xmax = NADBL;
+        for (t=0; t<T && ret; t++) {
+            s = i*T + t;
+            if (panel_obs_ok(x, s, mask)) {
+                if (na(xmax)) {
+                    xmin = xmax = x[s];
+                } else if (x[s] < xmin) {
+                    xmin = x[s];
+                } else if (x[s] > xmax) {
+                    xmax = x[s];
+                }
+            }
+            if (xmax > xmin) {
+                ret = 0;
+            }
+        }
+        if (ret && na(xmax)) {
+            ret = 0;
+        }
+    }
+
+    return ret;
+}
+
+/* Per-unit kernels for panel_statistic(), applied via the
+   group-by engine to the valid observations for each unit.
+*/
+
+static double pstat_count (int t1, int t2, const double *x)
+{
+    return t2 - t1 + 1;
+}
+
+static double pstat_sum (int t1, int t2, const double *x)
+{
+    double xsum = 0.0;
+    int t;
+
+    if (t2 < t1) {
+        return NADBL;
+    }
+    for (t=t1; t<=t2; t++) {
+        xsum += x[t];
+    }
+
+    return xsum;
+}
+
+static double pstat_min (int t1, int t2, const double *x)
+{
+    double xmin = NADBL;
+    int t;
+
+    for (t=t1; t<=t2; t++) {
+        if (t == t1 || x[t] < xmin) {
+            xmin = x[t];
+        }
+    }
+
+    return xmin;
+}
+
+static double pstat_max (int t1, int t2, const double *x)
+{
+    double xmax = NADBL;
+    int t;
+
+    for (t=t1; t<=t2; t++) {
+        if (t == t1 || x[t] > xmax) {
+            xmax = x[t];
+        }
+    }
+
+    return xmax;
+}
+
+static double pstat_mean (int t1, int t2, const double *x)
+{
+    double xsum = pstat_sum(t1, t2, x);
+
+    return na(xsum) ? NADBL : xsum / (t2 - t1 + 1);
+}
+
+static double pstat_sd (int t1, int t2, const double *x)
+{
+    double xbar = pstat_mean(t1, t2, x);
+    double dev, ssx = 0.0;
+    int t;
+
+    if (na(xbar)) {
+        return NADBL;
+    } else if (t2 == t1) {
+        return 0.0;
+    }
+    for (t=t1; t<=t2; t++) {
+        dev = x[t] - xbar;
+        ssx += dev * dev;
+    }
+
+    return sqrt(ssx / (t2 - t1));
+}
+
+/* Compute one of the per-unit statistics, with the panel units as
+   groups, and write it into @y for each observation of the unit.
+*/
+
+static int panel_unit_statistic (const double *x, double *y,
+                                 int u1, int u2, int T, int k,
+                                 const double *mask)
+{
+    double (*kern) (int, int, const double *) = NULL;
+    groupby *gb = NULL;
+    int64_t *gid = NULL;
+    double *vals = NULL;
+    int N = u2 - u1 + 1;
+    int n = N * T;
+    int s0 = u1 * T;
+    int i, s, t;
+    int err = 0;
+
+    if (k == F_PNOBS) {
+        kern = pstat_count;
+    } else if (k == F_PMIN) {
+        kern = pstat_min;
+    } else if (k == F_PMAX) {
+        kern = pstat_max;
+    } else if (k == F_PSUM) {
+        kern = pstat_sum;
+    } else if (k == F_PMEAN) {
+        kern = pstat_mean;
+    } else {
+        kern = pstat_sd;
+    }
+
+    gid = malloc(n * sizeof *gid);
+    vals = malloc(N * sizeof *vals);
+    if (gid == NULL || vals == NULL) {
+        err = E_ALLOC;
+        goto bailout;
+    }
+
+    for (s=0; s<n; s++) {
+        gid[s] = panel_obs_ok(x, s0 + s, mask) ? s / T : -1;
+    }
+
+    gb = groupby_from_ids(gid, n, N, &err);
+    if (!err) {
+        err = groupby_apply(gb, x + s0, kern, NULL, vals, 1);
+    }
+
+    if (!err) {
+        for (i=0; i<N; i++) {
+            for (t=0; t<T; t++) {
+                y[s0 + i*T + t] = vals[i];
+            }
+        }
+    }
+
+ bailout:
+
+    groupby_free(gb);
+    free(gid);
+    free(vals);
+
+    return err;
+}
+
+/**
+ * panel_statistic:
+ * @x: source data.
+ * @y: target into which to write.
+ * @dset: data set information.
+ * @k: code representing the desired statistic: F_PNOBS,
  * F_PMIN, F_PMAX, F_PSUM, F_PMEAN, F_PXSUM, F_PSD, F_PXNOBS,
  * F_PXSUM, or F_PXMEAN.
  * @mask: either NULL or a series with 0s for observations
@@ -1540,7 +2629,7 @@ static int time_invariant (const double *x,
 int panel_statistic (const double *x, double *y, const DATASET *dset,
                      int k, const double *mask)
 {
-    int T, Ti;
+    int T;
     int i, s, t, u1, u2;
     int err = 0;
 
@@ -1561,103 +2650,9 @@ int panel_statistic (const double *x, double *y, const DATASET *dset,
         return 0;
     }
 
-    if (k == F_PNOBS) {
-	/* the number of valid observations */
-        for (i=u1; i<=u2; i++) {
-            Ti = 0;
-            for (t=0; t<T; t++) {
-                if (panel_obs_ok(x, i*T + t, mask)) {
-                    Ti++;
-                }
-            }
-            for (t=0; t<T; t++) {
-                y[i*T + t] = Ti;
-            }
-        }
-    } else if (k == F_PMIN || k == F_PMAX || k == F_PSUM) {
-        double yi;
-
-        for (i=u1; i<=u2; i++) {
-            yi = NADBL;
-            for (t=0; t<T; t++) {
-                s = i*T + t;
-                if (panel_obs_ok(x, s, mask)) {
-                    if (na(yi)) {
-			/* the first valid observation */
-                        yi = x[s];
-                    } else if (k == F_PMIN && x[s] < yi) {
-                        yi = x[s];
-                    } else if (k == F_PMAX && x[s] > yi) {
-                        yi = x[s];
-                    } else if (k == F_PSUM) {
-                        yi += x[s];
-                    }
-                }
-            }
-            for (t=0; t<T; t++) {
-                y[i*T + t] = yi;
-            }
-        }
-    } else if (k == F_PMEAN || k == F_PSD) {
-	/* in both of these cases we need the mean */
-	double xbar;
-
-	for (i=u1; i<=u2; i++) {
-	    xbar = NADBL;
-	    Ti = 0;
-	    for (t=0; t<T; t++) {
-		s = i*T + t;
-		if (panel_obs_ok(x, s, mask)) {
-		    if (na(xbar)) {
-			/* the first valid observation */
-			xbar = x[s];
-		    } else {
-			/* cumulate */
-			xbar += x[s];
-		    }
-		    Ti++;
-		}
-	    }
-	    if (!na(xbar)) {
-		xbar /= Ti;
-	    }
-	    for (t=0; t<T; t++) {
-		y[i*T + t] = xbar;
-	    }
-	}
-        if (k == F_PSD) {
-	    /* now we need the deviations from the mean */
-	    double xbar, dev, ssx, sd;
-
-            for (i=u1; i<=u2; i++) {
-                xbar = y[i*T]; /* the mean calculated above */
-		if (na(xbar)) {
-		    /* no calculation needed */
-		    for (t=1; t<T; t++) {
-			y[i*T + t] = NADBL;
-		    }
-		    continue;
-		}
-		ssx = 0;
-                Ti = 0;
-		for (t=0; t<T; t++) {
-		    s = i*T + t;
-		    if (panel_obs_ok(x, s, mask)) {
-			dev = x[s] - xbar;
-			ssx += dev * dev;
-			Ti++;
-		    }
-		}
-                if (Ti == 1) {
-                    sd = 0.0;
-                } else {
-                    sd = sqrt(ssx / (Ti-1));
-                }
-                for (t=0; t<T; t++) {
-                    y[i*T + t] = sd;
-                }
-            }
-        }
+    if (k == F_PNOBS || k == F_PMIN || k == F_PMAX ||
+        k == F_PSUM || k == F_PMEAN || k == F_PSD) {
+        err = panel_unit_statistic(x, y, u1, u2, T, k, mask);
     } else if (k == F_PXSUM || k == F_PXMEAN) {
         /* the sum or mean of cross-sectional values for each period */
         double yt;
@@ -1840,63 +2835,19 @@ static double default_hp_lambda (const DATASET *dset)
     return 100 * dset->pd * dset->pd;
 }
 
-/**
- * hp_filter:
- * @x: array of original data.
- * @hp: array in which filtered series is computed.
- * @dset: pointer to dataset.
- * @lambda: smoothing parameter (or #NADBL to use the default
- * value).
- * @opt: if %OPT_T, return the trend rather than the cycle.
- *
- * Calculates the "cycle" component of the time series in
- * array @x, using the Hodrick-Prescott filter.  Adapted from the
- * original FORTRAN code by E. Prescott.
- *
- * Returns: 0 on success, non-zero error code on failure.
- */
+/* Hodrick-Prescott filter, adapted from the original FORTRAN code
+   by E. Prescott. The recursion for the covariance matrices in
+   @V[0..2] depends only on the smoothing parameter and the number
+   of observations -- and for any t, V[*][t] is the same whatever
+   the length of the series -- so it can be done once and then used
+   for as many series as wanted, of any length up to @T.
+*/
 
-int hp_filter (const double *x, double *hp, const DATASET *dset,
-               double lambda, gretlopt opt)
+static void hp_covariances (double **V, int T, double lambda)
 {
-    int t1 = dset->t1, t2 = dset->t2;
     double v00 = 1.0, v11 = 1.0, v01 = 0.0;
     double det, tmp0, tmp1;
-    double e0, e1, b00, b01, b11;
-    double **V = NULL;
-    double m[2], tmp[2];
-    int i, t, T, tb;
-    int err = 0;
-
-    for (t=t1; t<=t2; t++) {
-        hp[t] = NADBL;
-    }
-
-    err = series_adjust_sample(x, &t1, &t2);
-    if (err) {
-        goto bailout;
-    }
-
-    T = t2 - t1 + 1;
-    if (T < 4) {
-        err = E_TOOFEW;
-        goto bailout;
-    }
-
-    if (na(lambda)) {
-        lambda = default_hp_lambda(dset);
-    }
-
-    V = doubles_array_new(4, T);
-    if (V == NULL) {
-        return E_ALLOC;
-    }
-
-    /* adjust starting points */
-    x += t1;
-    hp += t1;
-
-    /* covariance matrices for each obs */
+    int t;
 
     for (t=2; t<T; t++) {
         tmp0 = v00;
@@ -1916,6 +2867,21 @@ int hp_filter (const double *x, double *hp, const DATASET *dset,
         v11 -= v01 * v01 / tmp0;
         v01 -= (tmp1 / tmp0) * v01;
     }
+}
+
+/* The data-dependent part of the H-P filter: forward and backward
+   passes over the @T values in @x, using the covariances in @V and
+   the workspace @V3 (of length @T), writing the trend (if @opt
+   includes OPT_T) or the cycle into @hp.
+*/
+
+static void hp_smooth (const double *x, double *hp, double **V,
+                       double *V3, int T, gretlopt opt)
+{
+    double det, v00, v01;
+    double e0, e1, b00, b01, b11;
+    double m[2], tmp[2];
+    int s, t, tb;
 
     m[0] = x[0];
     m[1] = x[1];
@@ -1926,8 +2892,8 @@ int hp_filter (const double *x, double *hp, const DATASET *dset,
         m[1] = 2.0 * m[1] - m[0];
         m[0] = tmp[0];
 
-        V[3][t-1] = V[0][t] * m[1] + V[1][t] * m[0];
-        hp[t-1]   = V[1][t] * m[1] + V[2][t] * m[0];
+        V3[t-1] = V[0][t] * m[1] + V[1][t] * m[0];
+        hp[t-1] = V[1][t] * m[1] + V[2][t] * m[0];
 
         det = V[0][t] * V[2][t] - V[1][t] * V[1][t];
         v00 =  V[2][t] / det;
@@ -1938,14 +2904,14 @@ int hp_filter (const double *x, double *hp, const DATASET *dset,
         m[0] += v01 * tmp[1];
     }
 
-    V[3][T-2] = m[0];
-    V[3][T-1] = m[1];
+    V3[T-2] = m[0];
+    V3[T-1] = m[1];
     m[0] = x[T-2];
     m[1] = x[T-1];
 
     /* backward pass */
     for (t=T-3; t>=0; t--) {
-        t1 = t+1;
+        s = t+1;
         tb = T - t - 1;
 
         tmp[0] = m[0];
@@ -1954,14 +2920,14 @@ int hp_filter (const double *x, double *hp, const DATASET *dset,
 
         if (t > 1) {
             /* combine info for y < i with info for y > i */
-            e0 = V[2][tb] * m[1] + V[1][tb] * m[0] + V[3][t];
+            e0 = V[2][tb] * m[1] + V[1][tb] * m[0] + V3[t];
             e1 = V[1][tb] * m[1] + V[0][tb] * m[0] + hp[t];
-            b00 = V[2][tb] + V[0][t1];
-            b01 = V[1][tb] + V[1][t1];
-            b11 = V[0][tb] + V[2][t1];
+            b00 = V[2][tb] + V[0][s];
+            b01 = V[1][tb] + V[1][s];
+            b11 = V[0][tb] + V[2][s];
 
             det = b00 * b11 - b01 * b01;
-            V[3][t] = (b00 * e1 - b01 * e0) / det;
+            V3[t] = (b00 * e1 - b01 * e0) / det;
         }
 
         det = V[0][tb] * V[2][tb] - V[1][tb] * V[1][tb];
@@ -1973,31 +2939,132 @@ int hp_filter (const double *x, double *hp, const DATASET *dset,
         m[0] += v00 * tmp[1];
     }
 
-    V[3][0] = m[0];
-    V[3][1] = m[1];
+    V3[0] = m[0];
+    V3[1] = m[1];
 
     if (opt & OPT_T) {
         for (t=0; t<T; t++) {
-            hp[t] = V[3][t];
+            hp[t] = V3[t];
         }
     } else {
         for (t=0; t<T; t++) {
-            hp[t] = x[t] - V[3][t];
+            hp[t] = x[t] - V3[t];
         }
     }
+}
 
- bailout:
+/**
+ * hp_filter:
+ * @x: array of original data.
+ * @hp: array in which filtered series is computed.
+ * @dset: pointer to dataset.
+ * @lambda: smoothing parameter (or #NADBL to use the default
+ * value).
+ * @opt: if %OPT_T, return the trend rather than the cycle.
+ *
+ * Calculates the "cycle" component of the time series in
+ * array @x, using the Hodrick-Prescott filter.  Adapted from the
+ * original FORTRAN code by E. Prescott.
+ *
+ * Returns: 0 on success, non-zero error code on failure.
+ */
 
-    if (V != NULL) {
-        for (i=0; i<4; i++) {
-            free(V[i]);
-        }
-        free(V);
+int hp_filter (const double *x, double *hp, const DATASET *dset,
+               double lambda, gretlopt opt)
+{
+    int t1 = dset->t1, t2 = dset->t2;
+    double **V = NULL;
+    int t, T;
+    int err = 0;
+
+    for (t=t1; t<=t2; t++) {
+        hp[t] = NADBL;
+    }
+
+    err = series_adjust_sample(x, &t1, &t2);
+    if (err) {
+        return err;
+    }
+
+    T = t2 - t1 + 1;
+    if (T < 4) {
+        return E_TOOFEW;
+    }
+
+    if (na(lambda)) {
+        lambda = default_hp_lambda(dset);
+    }
+
+    V = doubles_array_new(4, T);
+    if (V == NULL) {
+        return E_ALLOC;
     }
 
+    hp_covariances(V, T, lambda);
+    hp_smooth(x + t1, hp + t1, V, V[3], T, opt);
+
+    doubles_array_free(V, 4);
+
     return err;
 }
 
+/* One-sided H-P filter: this is the Kalman filter for the model
+   y_t = tau_t + e_t, where tau_t follows a second-order random walk
+   and var(e)/var(eta) = lambda, with state (tau_t, tau_{t-1}) and a
+   "big kappa" diffuse prior. As with the two-sided filter the
+   gains do not depend on the data, so we compute them once, for
+   up to @T observations, in @k0 and @k1.
+*/
+
+#define OSHP_KAPPA 1.0e7
+
+static void oshp_gains (double *k0, double *k1, int T, double lambda)
+{
+    double H = sqrt(lambda);
+    double Q = 1.0 / H;
+    double p00 = OSHP_KAPPA, p01 = 0.0, p11 = OSHP_KAPPA;
+    double f00, f01, f11, F;
+    int t;
+
+    for (t=0; t<T; t++) {
+        F = p00 + H;
+        k0[t] = p00 / F;
+        k1[t] = p01 / F;
+        /* updated MSE */
+        f00 = p00 - p00 * k0[t];
+        f01 = p01 - p00 * k1[t];
+        f11 = p11 - p01 * k1[t];
+        /* and the MSE of the next prediction */
+        p00 = 4.0 * (f00 - f01) + f11 + Q;
+        p01 = 2.0 * f00 - f01;
+        p11 = f00;
+    }
+}
+
+/* The data-dependent part of the one-sided filter: the trend at
+   t is the updated estimate of tau_t. The initial state is the
+   backward linear extrapolation of the first two observations.
+*/
+
+static void oshp_smooth (const double *x, double *hp,
+                         const double *k0, const double *k1,
+                         int T, gretlopt opt)
+{
+    double a0 = 2 * x[0] - x[1];
+    double a1 = 3 * x[0] - 2 * x[1];
+    double v, f0, f1;
+    int t;
+
+    for (t=0; t<T; t++) {
+        v = x[t] - a0;
+        f0 = a0 + k0[t] * v;
+        f1 = a1 + k1[t] * v;
+        hp[t] = (opt & OPT_T)? f0 : x[t] - f0;
+        a0 = 2 * f0 - f1;
+        a1 = f0;
+    }
+}
+
 /**
  * oshp_filter:
  * @x: array of original data.
@@ -2018,14 +3085,8 @@ int oshp_filter (const double *x, double *hp, const DATASET *dset,
                  double lambda, gretlopt opt)
 {
     int t1 = dset->t1, t2 = dset->t2;
-    gretl_matrix *M[4] = {NULL};
-    gretl_matrix *Lambda = NULL;
-    gretl_matrix *a0 = NULL;
-    gretl_matrix *mu = NULL;
-    gretl_bundle *b = NULL;
-    int copy[4] = {0};
-    int T, t, err, kerr;
-    double mt, sqrt_lam;
+    double *k0;
+    int T, t, err;
 
     for (t=t1; t<=t2; t++) {
         hp[t] = NADBL;
@@ -2044,109 +3105,244 @@ int oshp_filter (const double *x, double *hp, const DATASET *dset,
     if (na(lambda)) {
         lambda = default_hp_lambda(dset);
     }
-    sqrt_lam = sqrt(lambda);
-
-    /* adjust starting points */
-    x += t1;
-    hp += t1;
 
-    /* begin Kalman filter setup */
+    k0 = malloc(2 * T * sizeof *k0);
+    if (k0 == NULL) {
+        return E_ALLOC;
+    }
+
+    oshp_gains(k0, k0 + T, T, lambda);
+    oshp_smooth(x + t1, hp + t1, k0, k0 + T, T, opt);
+
+    free(k0);
+
+    return 0;
+}
+
+/* Set up a matrix to hold the results of filtering the series
+   in @list over the current sample range, one per column.
+*/
+
+static gretl_matrix *filter_list_matrix (const int *list,
+                                         const DATASET *dset,
+                                         int *err)
+{
+    int T = sample_size(dset);
+    gretl_matrix *ret;
+    char **S = NULL;
+    int i;
+
+    ret = gretl_matrix_alloc(T, list[0]);
+    if (ret == NULL) {
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    for (i=0; i<T*list[0]; i++) {
+        ret->val[i] = NADBL;
+    }
+
+    S = strings_array_new(list[0]);
+    if (S != NULL) {
+        for (i=0; i<list[0]; i++) {
+            S[i] = gretl_strdup(dset->varname[list[i+1]]);
+        }
+        gretl_matrix_set_colnames(ret, S);
+    }
+    gretl_matrix_set_t1(ret, dset->t1);
+    gretl_matrix_set_t2(ret, dset->t2);
+
+    return ret;
+}
+
+/**
+ * hp_filter_list:
+ * @list: list of series to filter.
+ * @dset: pointer to dataset.
+ * @lambda: smoothing parameter (or #NADBL to use the default
+ * value).
+ * @oneside: if non-zero, use the one-sided filter.
+ * @opt: if %OPT_T, return the trends rather than the cycles.
+ * @err: location to receive error code.
+ *
+ * Applies the Hodrick-Prescott filter, as per hp_filter() or
+ * oshp_filter(), to each of the series in @list. The part of the
+ * computation which does not depend on the data is done just once,
+ * and the series are then filtered in parallel if that's worth it.
+ *
+ * Returns: a matrix with one column per series and one row per
+ * observation in the current sample range, or NULL on failure.
+ */
+
+gretl_matrix *hp_filter_list (const int *list, const DATASET *dset,
+                              double lambda, int oneside,
+                              gretlopt opt, int *err)
+{
+    gretl_matrix *ret = NULL;
+    double **V = NULL;
+    double *k0 = NULL;
+    int T = sample_size(dset);
+    int nv = list[0];
+    int i;
+
+    if (nv == 0) {
+        *err = E_DATA;
+        return NULL;
+    } else if (T < 4) {
+        *err = E_TOOFEW;
+        return NULL;
+    }
+
+    if (na(lambda)) {
+        lambda = default_hp_lambda(dset);
+    }
+
+    ret = filter_list_matrix(list, dset, err);
+    if (*err) {
+        return NULL;
+    }
+
+    if (oneside) {
+        k0 = malloc(2 * T * sizeof *k0);
+        if (k0 != NULL) {
+            oshp_gains(k0, k0 + T, T, lambda);
+        }
+    } else {
+        V = doubles_array_new(3, T);
+        if (V != NULL) {
+            hp_covariances(V, T, lambda);
+        }
+    }
+
+    if (k0 == NULL && V == NULL) {
+        *err = E_ALLOC;
+        gretl_matrix_free(ret);
+        return NULL;
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (nv > 1 && gretl_use_openmp((guint64) nv * T))
+#endif
+    for (i=0; i<nv; i++) {
+        const double *x = dset->Z[list[i+1]];
+        double *hp = ret->val + (size_t) i * T;
+        int t1 = dset->t1, t2 = dset->t2;
+        double *V3;
+        int n, ierr;
+
+        ierr = series_adjust_sample(x, &t1, &t2);
+        n = t2 - t1 + 1;
+        if (!ierr && n < 4) {
+            ierr = E_TOOFEW;
+        }
+        if (!ierr && oneside) {
+            hp += t1 - dset->t1;
+            oshp_smooth(x + t1, hp, k0, k0 + T, n, opt);
+        } else if (!ierr) {
+            V3 = malloc(n * sizeof *V3);
+            if (V3 == NULL) {
+                ierr = E_ALLOC;
+            } else {
+                hp += t1 - dset->t1;
+                hp_smooth(x + t1, hp, V, V3, n, opt);
+                free(V3);
+            }
+        }
+        if (ierr) {
+#if defined(_OPENMP)
+#pragma omp critical (hp_list_err)
+#endif
+            *err = ierr;
+        }
+    }
+
+    free(k0);
+    doubles_array_free(V, 3);
 
-    /* obsy */
-    M[0] = gretl_matrix_alloc(T+1, 1);
-    for (t=0; t<T; t++) {
-        gretl_matrix_set(M[0], t, 0, x[t]);
+    if (*err) {
+        gretl_matrix_free(ret);
+        ret = NULL;
     }
-    /* add a dummy trailing observation */
-    gretl_matrix_set(M[0], T, 0, 0.0);
 
-    /* obsymat */
-    M[1] = gretl_zero_matrix_new(2, 1);
-    gretl_matrix_set(M[1], 0, 0, 1);
+    return ret;
+}
+
+/* Compute the k+1 distinct Baxter-King weights for the band
+   @bkl, @bku, or the low-pass weights if @lowpass is non-zero.
+*/
 
-    /* statemat */
-    M[2] = gretl_zero_matrix_new(2, 2);
-    gretl_matrix_set(M[2], 0, 0, 2);
-    gretl_matrix_set(M[2], 0, 1, -1);
-    gretl_matrix_set(M[2], 1, 0, 1);
+static void bkbp_weights (double *a, int bkl, int bku, int k,
+                          int lowpass)
+{
+    double omubar = M_2PI / bkl;
+    double omlbar = lowpass? 0 : M_2PI / bku;
+    double avg_a;
+    int i;
 
-    /* statevar */
-    M[3] = gretl_zero_matrix_new(2, 2);
-    gretl_matrix_set(M[3], 0, 0, 1/sqrt_lam);
+    avg_a = a[0] = (omubar - omlbar) / M_PI;
 
-    b = kalman_bundle_new(M, copy, 4, 0, &err);
-    if (err) {
-        goto bailout;
+    if (lowpass) {
+        avg_a -= 1.0;
     }
 
-    /* obsvar */
-    Lambda = gretl_matrix_from_scalar(sqrt_lam);
-    err = gretl_bundle_donate_data(b, "obsvar", Lambda,
-                                   GRETL_TYPE_MATRIX, 0);
+    for (i=1; i<=k; i++) {
+        a[i] = (sin(i * omubar) - sin(i * omlbar)) / (i * M_PI);
+        avg_a += 2 * a[i];
+    }
 
-    /* diffuse prior */
-    err = gretl_bundle_set_scalar(b, "diffuse", 1);
+    avg_a /= (2 * k + 1);
 
-    if (err) {
-        goto bailout;
+    for (i=0; i<=k; i++) {
+        a[i] -= avg_a;
+#if BK_DEBUG
+        fprintf(stderr, "a[%d] = %#9.6g\n", i, a[i]);
+#endif
     }
+}
 
-    /* inistate */
-    a0 = gretl_matrix_alloc(2, 1);
-    gretl_matrix_set(a0, 0, 0, 2*x[0] - x[1]);
-    gretl_matrix_set(a0, 1, 0, 3*x[0] - 2*x[1]);
-    err = gretl_bundle_donate_data(b, "inistate", a0,
-                                   GRETL_TYPE_MATRIX, 0);
-    if (err) {
-        goto bailout;
-    }
+/* Apply the symmetric weights @a to @x for observations @t1 + @k
+   to @t2 - @k, writing into @bk; the first and last @k
+   observations are skipped.
+*/
 
-#if DEBUG
-    gretl_matrix_print(M[0], "obsy");
-    gretl_matrix_print(M[1], "obsymat");
-    gretl_matrix_print(M[2], "statemat");
-    gretl_matrix_print(M[3], "statevar");
-    gretl_matrix_print(a0, "inistate");
-#endif
+static void bkbp_apply (const double *x, double *bk, const double *a,
+                        int t1, int t2, int k)
+{
+    double bt;
+    int i, t;
 
-    kerr = kalman_bundle_filter(b, NULL, &err);
-    if (err || kerr) {
-        goto bailout;
+    for (t=t1+k; t<=t2-k; t++) {
+        bt = a[0] * x[t];
+        for (i=1; i<=k; i++) {
+            bt += a[i] * (x[t-i] + x[t+i]);
+        }
+        bk[t] = bt;
     }
+}
 
-    mu = gretl_bundle_get_matrix(b, "state", &err);
-    if (err) {
-        goto bailout;
+static int bkbp_params (const DATASET *dset, int *bkl, int *bku,
+                        int *k)
+{
+    if (*bkl <= 0 || *bku <= 0) {
+        /* get user settings if available (or the defaults) */
+        get_bkbp_periods(dset, bkl, bku);
     }
 
-#if DEBUG
-    printf("kerr = %d, err = %d\n", kerr, err);
-    gretl_matrix_print(mu, "state");
-#endif
-
-    /* take the "lead" of the second element of the
-       state estimate */
-    if (opt & OPT_T) {
-        for (t=0; t<T; t++) {
-            mt = gretl_matrix_get(mu, t+1, 1);
-            hp[t] = mt;
-        }
-    } else {
-        for (t=0; t<T; t++) {
-            mt = gretl_matrix_get(mu, t+1, 1);
-            hp[t] = x[t] - mt;
-        }
+    if (*k <= 0) {
+        *k = get_bkbp_k(dset);
     }
 
- bailout:
+#if BK_DEBUG
+    fprintf(stderr, "lower limit = %d, upper limit = %d, \n",
+            *bkl, *bku);
+#endif
 
-    /* since all the matrices we've allocated above belong
-       to the Kalman bundle, the following will suffice to
-       free everything on exit
-    */
-    gretl_bundle_destroy(b);
+    if (*bkl >= *bku) {
+        gretl_errmsg_set(_("Error in Baxter-King frequencies"));
+        return 1;
+    }
 
-    return err;
+    return 0;
 }
 
 /**
@@ -2170,29 +3366,12 @@ int bkbp_filter (const double *x, double *bk, const DATASET *dset,
                  int bkl, int bku, int k)
 {
     int t1 = dset->t1, t2 = dset->t2;
-    double omubar, omlbar;
-    double avg_a;
     double *a;
-    int i, t, err = 0;
-    int lowpass = 0;
-
-    if (bkl <= 0 || bku <= 0) {
-        /* get user settings if available (or the defaults) */
-        get_bkbp_periods(dset, &bkl, &bku);
-    }
-
-    if (k <= 0) {
-        k = get_bkbp_k(dset);
-    }
-
-#if BK_DEBUG
-    fprintf(stderr, "lower limit = %d, upper limit = %d, \n",
-            bkl, bku);
-#endif
+    int t, err;
 
-    if (bkl >= bku) {
-        gretl_errmsg_set(_("Error in Baxter-King frequencies"));
-        return 1;
+    err = bkbp_params(dset, &bkl, &bku, &k);
+    if (err) {
+        return err;
     }
 
     err = series_adjust_sample(x, &t1, &t2);
@@ -2205,57 +3384,115 @@ int bkbp_filter (const double *x, double *bk, const DATASET *dset,
         return E_DATA;
     }
 
-    if (bku >= t2 - t1 + 1) {
-        lowpass = 1;
-    }
-
     a = malloc((k + 1) * sizeof *a);
     if (a == NULL) {
         return E_ALLOC;
     }
 
-    omubar = M_2PI / bkl;
-    omlbar = lowpass? 0 : M_2PI / bku;
+    bkbp_weights(a, bkl, bku, k, bku >= t2 - t1 + 1);
 
-    /* first we compute the coefficients */
+    for (t=0; t<dset->n; t++) {
+        bk[t] = NADBL;
+    }
+    bkbp_apply(x, bk, a, t1, t2, k);
 
-    avg_a = a[0] = (omubar - omlbar) / M_PI;
+    free(a);
 
-    if (lowpass) {
-        avg_a -= 1.0;
+    return 0;
+}
+
+/**
+ * bkbp_filter_list:
+ * @list: list of series to filter.
+ * @dset: data set information.
+ * @bkl: lower frequency bound (or 0 for automatic).
+ * @bku: upper frequency bound (or 0 for automatic).
+ * @k: approximation order (or 0 for automatic).
+ * @err: location to receive error code.
+ *
+ * Applies the Baxter and King filter, as per bkbp_filter(), to
+ * each of the series in @list. The bandpass and low-pass weights
+ * are computed just once, and the series are then filtered in
+ * parallel if that's worth it.
+ *
+ * Returns: a matrix with one column per series and one row per
+ * observation in the current sample range, or NULL on failure.
+ */
+
+gretl_matrix *bkbp_filter_list (const int *list, const DATASET *dset,
+                                int bkl, int bku, int k, int *err)
+{
+    gretl_matrix *ret = NULL;
+    double *a = NULL;
+    int T = sample_size(dset);
+    int nv = list[0];
+    int i;
+
+    if (nv == 0) {
+        *err = E_DATA;
+        return NULL;
     }
 
-    for (i=1; i<=k; i++) {
-        a[i] = (sin(i * omubar) - sin(i * omlbar)) / (i * M_PI);
-        avg_a += 2 * a[i];
+    *err = bkbp_params(dset, &bkl, &bku, &k);
+    if (*err) {
+        return NULL;
     }
 
-    avg_a /= (2 * k + 1);
+    if (2 * k >= T) {
+        gretl_errmsg_set(_("Insufficient observations"));
+        *err = E_DATA;
+        return NULL;
+    }
 
-    for (i=0; i<=k; i++) {
-        a[i] -= avg_a;
-#if BK_DEBUG
-        fprintf(stderr, "a[%d] = %#9.6g\n", i, a[i]);
-#endif
+    ret = filter_list_matrix(list, dset, err);
+    if (*err) {
+        return NULL;
+    }
+
+    /* band-pass weights followed by low-pass weights */
+    a = malloc(2 * (k + 1) * sizeof *a);
+    if (a == NULL) {
+        *err = E_ALLOC;
+        gretl_matrix_free(ret);
+        return NULL;
     }
 
-    /* now we filter the series, skipping the first
-       and last k observations */
+    bkbp_weights(a, bkl, bku, k, 0);
+    bkbp_weights(a + k + 1, bkl, bku, k, 1);
 
-    for (t=0; t<dset->n; t++) {
-        if (t < t1 + k || t > t2 - k) {
-            bk[t] = NADBL;
+#if defined(_OPENMP)
+#pragma omp parallel for if (nv > 1 && gretl_use_openmp((guint64) nv * T * k))
+#endif
+    for (i=0; i<nv; i++) {
+        const double *x = dset->Z[list[i+1]];
+        double *bk = ret->val + (size_t) i * T;
+        int t1 = dset->t1, t2 = dset->t2;
+        int n, ierr;
+
+        ierr = series_adjust_sample(x, &t1, &t2);
+        n = t2 - t1 + 1;
+        if (!ierr && 2 * k >= n) {
+            ierr = E_DATA;
+        }
+        if (ierr) {
+#if defined(_OPENMP)
+#pragma omp critical (bkbp_list_err)
+#endif
+            *err = ierr;
         } else {
-            bk[t] = a[0] * x[t];
-            for (i=1; i<=k; i++) {
-                bk[t] += a[i] * (x[t-i] + x[t+i]);
-            }
+            bk += t1 - dset->t1;
+            bkbp_apply(x + t1, bk, (bku >= n)? a + k + 1 : a, 0, n - 1, k);
         }
     }
 
     free(a);
 
-    return err;
+    if (*err) {
+        gretl_matrix_free(ret);
+        ret = NULL;
+    }
+
+    return ret;
 }
 
 /* following: material relating to the Butterworth filter */
@@ -3930,6 +5167,10 @@ const double *gretl_plotx (const DATASET *dset, gretlopt opt)
     double sd0 = 0;
     float rm;
 
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(x, ptype, Tbak, sd0bak)
+#endif
+
     if (dset == NULL) {
         /* cleanup signal */
         free(x);
@@ -7018,299 +8259,80 @@ int gretl_loess (const double *y, const double *x, int poly_order,
         return E_DATA;
     }
 
-    err = xy_get_sample(y, x, &t1, &t2, &n);
-    if (err) {
-        return err;
-    }
-
-    /* note: n holds the number of non-missing observations
-       on x; the associated y-value may or may not be
-       missing
-    */
-
-    my = gretl_column_vector_alloc(n);
-    mx = gretl_column_vector_alloc(n);
-
-    if (my == NULL || mx == NULL) {
-        err = E_ALLOC;
-    } else {
-        s = 0;
-        for (t=t1; t<=t2; t++) {
-            if (!na(x[t])) {
-                my->val[s] = y[t];
-                mx->val[s] = x[t];
-                s++;
-            }
-        }
-        /* sort the points by the value of x */
-        err = sort_pairs_by_x(mx, my, &s_order, NULL);
-    }
-
-    if (!err) {
-        yh = loess_fit(mx, my, poly_order, bandwidth, opt, &err);
-    }
-
-    if (!err) {
-        /* put the yh values into dataset order */
-        for (s=0; s<n; s++) {
-            t = get_dataset_t(x, s_order[s], t1);
-            m[t] = yh->val[s];
-        }
-    }
-
-    gretl_matrix_free(my);
-    gretl_matrix_free(mx);
-    gretl_matrix_free(yh);
-    free(s_order);
-
-    return err;
-}
-
-double series_get_nobs (int t1, int t2, const double *x)
-{
-    int t, n = 0;
-
-    for (t=t1; t<=t2; t++) {
-        if (!na(x[t])) n++;
-    }
-
-    return n;
-}
-
-double series_sum_all (int t1, int t2, const double *x)
-{
-    double xsum = 0.0;
-    int t;
-
-    for (t=t1; t<=t2; t++) {
-        if (na(x[t])) {
-            xsum = NADBL;
-            break;
-        } else {
-            xsum += x[t];
-        }
-    }
-
-    return xsum;
-}
-
-static gretl_matrix *delete_null_cases (gretl_matrix *m,
-                                        int keeprows,
-                                        int *err)
-{
-    gretl_matrix *ret;
-
-    ret = gretl_matrix_alloc(keeprows, m->cols);
-    if (ret == NULL) {
-        *err = E_ALLOC;
-    } else {
-        double x;
-        int i, j;
-
-        for (i=0; i<keeprows; i++) {
-            for (j=0; j<m->cols; j++) {
-                x = gretl_matrix_get(m, i, j);
-                gretl_matrix_set(ret, i, j, x);
-            }
-        }
-    }
-
-    gretl_matrix_free(m);
-
-    return ret;
-}
-
-static gretl_matrix *real_aggregate_by (const double *x,
-                                        const double *y,
-                                        const int *xlist,
-                                        const int *ylist,
-                                        DATASET *dset,
-                                        double *tmp,
-                                        double (*dbuiltin)
-                                        (int, int, const double *),
-                                        int (*ibuiltin)
-                                        (int, int, const double *),
-                                        fncall *fc,
-                                        int just_count,
-                                        int *err)
-{
-    gretl_matrix *m = NULL;
-    gretl_matrix **listvals;
-    gretl_matrix *yvals;
-    int n = sample_size(dset);
-    int match;
-    int skipnull = 0;
-    int countcol = 1;
-    int maxcases;
-    int ny, nx, mcols;
-    int *idx;
-    double *valvec;
-    double fx;
-    int i, j, k, t, ni, ii;
-
-    /* note:
-       - to skip null cases in the output matrix, set skipnull = 1
-       - to eliminate the case-count column, set countcol = 0
-    */
-
-    ny = ylist == NULL ? 1 : ylist[0];
-
-    valvec = malloc(ny * sizeof *valvec);
-    idx = malloc(ny * sizeof *idx);
-    listvals = malloc(ny * sizeof *listvals);
-
-    if (valvec == NULL || idx == NULL || listvals == NULL) {
-        *err = E_ALLOC;
-        goto bailout;
-    }
-
-    for (j=0; j<ny; j++) {
-        listvals[j] = NULL;
-    }
-
-    /* For @y (or each member of @ylist), create a vector holding
-       its distinct values. As we go, count the combinations of
-       y-values and initialize the @valvec and @idx arrays.
-    */
-
-    maxcases = 1;
-    for (j=0; j<ny && !*err; j++) {
-        if (ylist != NULL) {
-            y = dset->Z[ylist[j+1]] + dset->t1;
-        }
-        listvals[j] = gretl_matrix_values(y, n, OPT_S, err);
-        if (!*err) {
-            maxcases *= listvals[j]->rows;
-            valvec[j] = listvals[j]->val[0];
-            idx[j] = 0;
-        }
-    }
-
-    if (just_count) {
-        x = NULL;
-        xlist = NULL;
-        skipnull = 0;
-        countcol = 0;
-        nx = 1;
-    } else {
-        nx = xlist == NULL ? 1 : xlist[0];
+    err = xy_get_sample(y, x, &t1, &t2, &n);
+    if (err) {
+        return err;
     }
 
-    mcols = ny + nx + countcol;
-
-    /* Allocate a matrix with enough rows to hold all the y-value
-       combinations (maxcases) and enough columns to hold a record of
-       the @y values, a count of matching cases, and the value(s) of
-       f(x).
+    /* note: n holds the number of non-missing observations
+       on x; the associated y-value may or may not be
+       missing
     */
 
-    m = gretl_zero_matrix_new(maxcases, mcols);
-    if (m == NULL) {
-        *err = E_ALLOC;
-        goto bailout;
-    }
-
-    ii = 0;
-    for (i=0; i<maxcases; i++) {
-        ni = 0;
-        for (k=0; k<nx && !*err; k++) {
-            /* fill tmp with x for {y} == {yi} */
-            if (xlist != NULL) {
-                x = dset->Z[xlist[k+1]] + dset->t1;
-            }
-            ni = 0;
-            for (t=0; t<n; t++) {
-                match = 1;
-                for (j=0; j<ny; j++) {
-                    if (ylist != NULL) {
-                        y = dset->Z[ylist[j+1]] + dset->t1;
-                    }
-                    if (y[t] != valvec[j]) {
-                        match = 0;
-                        break;
-                    }
-                }
-                if (match) {
-                    if (x != NULL) {
-                        tmp[ni] = x[t];
-                    }
-                    ni++;
-                }
-            }
-            if (just_count) {
-                gretl_matrix_set(m, ii, ny, ni);
-                break;
-            } else if (ni == 0 && skipnull) {
-                /* exclude cases where the obs count is 0 */
-                break;
-            } else {
-                /* aggregate x at current y values */
-                if (dbuiltin != NULL) {
-                    fx = (*dbuiltin)(0, ni-1, tmp);
-		} else if (ibuiltin != NULL) {
-		    fx = (double) (*ibuiltin)(0, ni-1, tmp);
-                } else {
-                    double *pfx = &fx;
-
-                    dset->t2 = ni-1;
-                    *err = gretl_function_exec(fc, GRETL_TYPE_DOUBLE,
-                                               dset, &pfx, NULL);
-                    fx = *pfx;
-                }
-                gretl_matrix_set(m, ii, ny+k+countcol, fx);
-            }
-        }
+    my = gretl_column_vector_alloc(n);
+    mx = gretl_column_vector_alloc(n);
 
-        if (ni > 0 || !skipnull) {
-            for (j=0; j<ny; j++) {
-                gretl_matrix_set(m, ii, j, valvec[j]);
-            }
-            if (countcol) {
-                gretl_matrix_set(m, ii, ny, ni);
+    if (my == NULL || mx == NULL) {
+        err = E_ALLOC;
+    } else {
+        s = 0;
+        for (t=t1; t<=t2; t++) {
+            if (!na(x[t])) {
+                my->val[s] = y[t];
+                mx->val[s] = x[t];
+                s++;
             }
-            ii++;
         }
+        /* sort the points by the value of x */
+        err = sort_pairs_by_x(mx, my, &s_order, NULL);
+    }
 
-        if (*err) {
-            break;
-        }
+    if (!err) {
+        yh = loess_fit(mx, my, poly_order, bandwidth, opt, &err);
+    }
 
-        /* set up the next y-values array */
-        for (j=ny-1; j>=0; j--) {
-            yvals = listvals[j];
-            if (idx[j] == yvals->rows - 1) {
-                /* restart the index at this level and pass
-                   the buck */
-                idx[j] = 0;
-                valvec[j] = yvals->val[0];
-            } else {
-                /* increment the index at this level and
-                   we're done */
-                idx[j] += 1;
-                valvec[j] = yvals->val[idx[j]];
-                break;
-            }
+    if (!err) {
+        /* put the yh values into dataset order */
+        for (s=0; s<n; s++) {
+            t = get_dataset_t(x, s_order[s], t1);
+            m[t] = yh->val[s];
         }
     }
 
-    if (skipnull && ii < maxcases) {
-        /* the matrix contains some null cases: shrink it */
-        m = delete_null_cases(m, ii, err);
+    gretl_matrix_free(my);
+    gretl_matrix_free(mx);
+    gretl_matrix_free(yh);
+    free(s_order);
+
+    return err;
+}
+
+double series_get_nobs (int t1, int t2, const double *x)
+{
+    int t, n = 0;
+
+    for (t=t1; t<=t2; t++) {
+        if (!na(x[t])) n++;
     }
 
- bailout:
+    return n;
+}
 
-    free(valvec);
-    free(idx);
+double series_sum_all (int t1, int t2, const double *x)
+{
+    double xsum = 0.0;
+    int t;
 
-    if (listvals != NULL) {
-        for (j=0; j<ny; j++) {
-            gretl_matrix_free(listvals[j]);
+    for (t=t1; t<=t2; t++) {
+        if (na(x[t])) {
+            xsum = NADBL;
+            break;
+        } else {
+            xsum += x[t];
         }
-        free(listvals);
     }
 
-    return m;
+    return xsum;
 }
 
 /* Add suitable column names to the matrix to be returned
@@ -7322,12 +8344,15 @@ static void aggr_add_colnames (gretl_matrix *m,
                                const int *ylist,
                                const gretl_matrix *X,
                                const gretl_matrix *Y,
+                               char **statnames,
+                               int nstat,
                                const DATASET *dset)
 {
     char **S = NULL;
     char **Sl = NULL;
+    char **Sx = NULL;
     const char **Sm;
-    int i, j, n = m->cols;
+    int i, j, s, n = m->cols;
     int ny = 1;
     int nx = 0;
     int err = 0;
@@ -7342,7 +8367,9 @@ static void aggr_add_colnames (gretl_matrix *m,
     } else if (Y != NULL) {
         ny = Y->cols;
     }
-    nx = n - ny - 1;
+    if (nstat > 0) {
+        nx = (n - ny - 1) / nstat;
+    }
     j = 0;
 
     if ((Sl = gretl_list_get_names_array(ylist, dset, NULL)) != NULL) {
@@ -7364,33 +8391,47 @@ static void aggr_add_colnames (gretl_matrix *m,
     S[j++] = gretl_strdup("count");
 
     if (nx > 0) {
-        if ((Sl = gretl_list_get_names_array(xlist, dset, NULL)) != NULL) {
+        Sx = strings_array_new(nx);
+        if (Sx == NULL) {
+            err = 1;
+        } else if ((Sl = gretl_list_get_names_array(xlist, dset, NULL)) != NULL) {
             for (i=0; i<nx; i++) {
-                S[j++] = Sl[i];
+                Sx[i] = Sl[i];
                 Sl[i] = NULL;
             }
             free(Sl);
         } else if ((Sm = gretl_matrix_get_colnames(X)) != NULL) {
             for (i=0; i<nx; i++) {
-                S[j++] = gretl_strdup(Sm[i]);
+                Sx[i] = gretl_strdup(Sm[i]);
             }
         } else {
             for (i=0; i<nx; i++) {
-                S[j++] = gretl_strdup("f(x)");
+                Sx[i] = gretl_strdup(nstat > 1 ? "x" : "f(x)");
+            }
+        }
+        for (s=0; s<nstat && !err; s++) {
+            for (i=0; i<nx; i++) {
+                if (nstat == 1 || Sx[i] == NULL) {
+                    S[j++] = gretl_strdup(Sx[i]);
+                } else {
+                    S[j++] = gretl_strdup_printf("%s(%s)", statnames[s],
+                                                 Sx[i]);
+                }
             }
         }
+        strings_array_free(Sx, nx);
     }
 
     /* basic check on validity of @S */
-    for (i=0; i<n; i++) {
+    for (i=0; i<n && !err; i++) {
         if (S[i] == NULL) {
-            strings_array_free(S, n);
             err = 1;
-            break;
         }
     }
 
-    if (!err) {
+    if (err) {
+        strings_array_free(S, n);
+    } else {
         gretl_matrix_set_colnames(m, S);
     }
 }
@@ -7495,13 +8536,123 @@ static int get_aggregator (const char *fname,
     return *dbuiltin != NULL || *ibuiltin != NULL;
 }
 
+#define AGGR_MAX_STATS 16
+
+/* Parse @fname, which names either a single aggregator (built-in
+   or user-defined) or several built-in aggregators separated by
+   commas and/or spaces, as in "mean,sd,max". The built-ins are
+   recorded in @dfuncs and @ifuncs; if there's just one name and
+   it's not a built-in, @nbuiltin is set to zero and the caller
+   should look for a user function.
+*/
+
+static char **parse_aggregators (const char *fname,
+                                 double (**dfuncs) (int, int, const double *),
+                                 int (**ifuncs) (int, int, const double *),
+                                 int *nstat, int *nbuiltin,
+                                 int *err)
+{
+    char **S;
+    int i, n = 0;
+
+    S = gretl_string_split(fname, &n, ", ");
+    *nstat = n;
+
+    if (S == NULL || n == 0) {
+        *err = E_INVARG;
+        return S;
+    } else if (n > AGGR_MAX_STATS) {
+        gretl_errmsg_sprintf("aggregate: at most %d statistics may be given",
+                             AGGR_MAX_STATS);
+        *err = E_INVARG;
+    }
+
+    *nbuiltin = 0;
+    for (i=0; i<n && !*err; i++) {
+        dfuncs[i] = NULL;
+        ifuncs[i] = NULL;
+        if (get_aggregator(S[i], &dfuncs[i], &ifuncs[i])) {
+            *nbuiltin += 1;
+        } else if (n > 1) {
+            gretl_errmsg_sprintf("aggregate: '%s' is not a supported function",
+                                 S[i]);
+            *err = E_INVARG;
+        }
+    }
+
+    return S;
+}
+
+/* Compute the aggregate() matrix: the by-values, the count of
+   cases, then the values of each of the @nstat statistics for
+   each of the @nx series in @X. In the user-function case
+   (@fc non-NULL) the function is called via @tmp and @dset.
+*/
+
+static gretl_matrix *groupby_aggregate (const groupby *gb,
+                                        const double **X, int nx,
+                                        double (**dfuncs) (int, int, const double *),
+                                        int (**ifuncs) (int, int, const double *),
+                                        int nstat, fncall *fc,
+                                        double *tmp, DATASET *dset,
+                                        int *err)
+{
+    gretl_matrix *m;
+    int ny = gb->keys->cols;
+    int ng = gb->ng;
+    int mcols = ny + 1 + nx * nstat;
+    int g, j, k, s, ni;
+    double *col;
+
+    m = gretl_matrix_alloc(ng, mcols);
+    if (m == NULL) {
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    memcpy(m->val, gb->keys->val, ng * ny * sizeof(double));
+    col = m->val + ng * ny;
+    for (g=0; g<ng; g++) {
+        col[g] = groupby_count(gb, g);
+    }
+
+    for (s=0; s<nstat && !*err; s++) {
+        for (k=0; k<nx && !*err; k++) {
+            j = ny + 1 + s * nx + k;
+            col = m->val + ng * j;
+            if (fc == NULL) {
+                *err = groupby_apply(gb, X[k], dfuncs[s], ifuncs[s],
+                                     col, 1);
+                continue;
+            }
+            for (g=0; g<ng && !*err; g++) {
+                double fx, *pfx = &fx;
+
+                ni = groupby_gather(gb, g, X[k], tmp);
+                dset->t2 = ni-1;
+                *err = gretl_function_exec(fc, GRETL_TYPE_DOUBLE,
+                                           dset, &pfx, NULL);
+                col[g] = *pfx;
+            }
+        }
+    }
+
+    if (*err) {
+        gretl_matrix_free(m);
+        m = NULL;
+    }
+
+    return m;
+}
+
 /**
  * aggregate_by:
  * @x: data array.
  * @y: discrete variable.
  * @xlist: list of x series or NULL.
  * @ylist: list of y series or NULL.
- * @fncall: the name of the aggregation function.
+ * @fname: the name of the aggregation function, or a list of
+ * names of built-in aggregators separated by commas or spaces.
  * @dset: data set information.
  * @err: location to receive error code.
  *
@@ -7524,13 +8675,19 @@ gretl_matrix *aggregate_by (const double *x,
                             DATASET *dset,
                             int *err)
 {
+    double (*dfuncs[AGGR_MAX_STATS]) (int, int, const double *);
+    int (*ifuncs[AGGR_MAX_STATS]) (int, int, const double *);
     gretl_matrix *m = NULL;
+    groupby *gb = NULL;
+    const double **X = NULL;
+    const double **Y = NULL;
+    char **names = NULL;
     double *tmp = NULL;
-    double (*dbuiltin) (int, int, const double *) = NULL;
-    int (*ibuiltin) (int, int, const double *) = NULL;
     fncall *fc = NULL;
     int just_count = 0;
-    int n;
+    int nstat = 0;
+    int nbuiltin = 0;
+    int i, n, nx, ny;
 
     if (fname == NULL || !strcmp(fname, "null")) {
         just_count = 1;
@@ -7542,43 +8699,59 @@ gretl_matrix *aggregate_by (const double *x,
         return NULL;
     }
 
+    n = sample_size(dset);
+    ny = ylist == NULL ? 1 : ylist[0];
+    nx = just_count ? 0 : xlist == NULL ? 1 : xlist[0];
+
     if (!just_count) {
-        get_aggregator(fname, &dbuiltin, &ibuiltin);
+        names = parse_aggregators(fname, dfuncs, ifuncs, &nstat,
+                                  &nbuiltin, err);
+        if (!*err && nbuiltin == 0) {
+            tmp = malloc(n * sizeof *tmp);
+            if (tmp == NULL) {
+                *err = E_ALLOC;
+            } else {
+                fc = get_user_aggrby_call(fname, 1, tmp, err);
+            }
+        }
     }
 
-    n = sample_size(dset);
-
-    if (just_count) {
-        ; /* nothing to do here */
-    } else {
-        tmp = malloc(n * sizeof *tmp);
-        if (tmp == NULL) {
+    if (!*err) {
+        X = malloc((nx + 1) * sizeof *X);
+        Y = malloc(ny * sizeof *Y);
+        if (X == NULL || Y == NULL) {
             *err = E_ALLOC;
-        } else if (dbuiltin == NULL && ibuiltin == NULL) {
-            fc = get_user_aggrby_call(fname, 1, tmp, err);
         }
     }
 
+    if (!*err) {
+        for (i=0; i<ny; i++) {
+            Y[i] = (ylist == NULL ? y : dset->Z[ylist[i+1]]) + dset->t1;
+        }
+        for (i=0; i<nx; i++) {
+            X[i] = (xlist == NULL ? x : dset->Z[xlist[i+1]]) + dset->t1;
+        }
+        /* note: all combinations of the by-values are shown */
+        gb = groupby_new(Y, ny, n, 1, err);
+    }
+
     if (!*err) {
         int save_t2 = dset->t2;
 
-        x = (x == NULL)? NULL : x + dset->t1;
-        y = (y == NULL)? NULL : y + dset->t1;
-        m = real_aggregate_by(x, y, xlist, ylist, dset, tmp,
-                              dbuiltin, ibuiltin, fc, just_count,
-			      err);
+        m = groupby_aggregate(gb, X, nx, dfuncs, ifuncs, nstat,
+                              fc, tmp, dset, err);
         dset->t2 = save_t2;
     }
 
-    if (m != NULL && *err) {
-        gretl_matrix_free(m);
-        m = NULL;
-    }
-
     if (m != NULL) {
-        aggr_add_colnames(m, xlist, ylist, NULL, NULL, dset);
+        aggr_add_colnames(m, xlist, ylist, NULL, NULL,
+                          names, nstat, dset);
     }
 
+    groupby_free(gb);
+    strings_array_free(names, nstat);
+    free(X);
+    free(Y);
     free(tmp);
 
     return m;
@@ -7612,28 +8785,8 @@ static gretl_matrix *series_aggregate (const gretl_matrix *X,
     return A;
 }
 
-static int row_starts_block (int i, const double *y,
-                             int ny, int n)
-{
-    int j;
-
-    if (i == 0) {
-        return 1;
-    } else {
-        for (j=0; j<ny; j++) {
-            if (y[i] > y[i-1]) {
-                return 1;
-            }
-            y += n;
-        }
-    }
-
-    return 0;
-}
-
-/* Design: start by forming (Y ~ X) and sorting this matrix by the Y
-   columns. This is an expensive operation, but once it's done the
-   rest of the calculation is very straightforward.
+/* Unlike the series variant, only the combinations of by-values
+   that are actually present in @Y are shown.
 */
 
 gretl_matrix *matrix_aggregate (const gretl_matrix *X,
@@ -7641,136 +8794,68 @@ gretl_matrix *matrix_aggregate (const gretl_matrix *X,
                                 const char *func,
                                 int *err)
 {
-    double (*dbuiltin) (int, int, const double *) = NULL;
-    int (*ibuiltin) (int, int, const double *) = NULL;
-    gretl_matrix *M;
-    gretl_matrix *ret;
-    double *y;
-    double rkj;
-    int *cols = NULL;
-    int *counts = NULL;
+    double (*dfuncs[AGGR_MAX_STATS]) (int, int, const double *);
+    int (*ifuncs[AGGR_MAX_STATS]) (int, int, const double *);
+    gretl_matrix *ret = NULL;
+    groupby *gb = NULL;
+    const double **Xc = NULL;
+    const double **Yc = NULL;
+    char **names = NULL;
     int just_count = 0;
-    int nx, ny;
-    int n, nby = 0;
-    int i, j, k;
+    int nstat = 0;
+    int nbuiltin = 0;
+    int nx, ny, n, j;
 
     if (func == NULL || !strcmp(func, "null")) {
         just_count = 1;
     } else if (X == NULL || Y == NULL || X->rows != Y->rows) {
         *err = E_NONCONF;
         return NULL;
-    } else if (!get_aggregator(func, &dbuiltin, &ibuiltin)) {
-        /* we can't handle a user-defined function here */
-        return series_aggregate(X, Y, func, err);
+    } else {
+        names = parse_aggregators(func, dfuncs, ifuncs, &nstat,
+                                  &nbuiltin, err);
+        if (!*err && nbuiltin == 0) {
+            /* we can't handle a user-defined function here */
+            strings_array_free(names, nstat);
+            return series_aggregate(X, Y, func, err);
+        }
     }
 
     nx = just_count ? 0 : X->cols;
     ny = Y->cols;
     n = Y->rows;
 
-    if (ny > 1) {
-        cols = gretl_consecutive_list_new(0, ny - 1);
-    }
-
-    if (nx == 0) {
-        /* make M = sorted Y */
-        if (ny > 1) {
-            M = gretl_matrix_sort_by_columns(Y, cols, err);
-        } else {
-            M = gretl_matrix_sort_by_column(Y, 0, err);
-        }
-    } else {
-        /* make M = (Y ~ X), sorted by Y */
-        gretl_matrix *Tmp = gretl_matrix_alloc(n, ny + nx);
-
-        if (Tmp == NULL) {
+    if (!*err) {
+        Xc = malloc((nx + 1) * sizeof *Xc);
+        Yc = malloc(ny * sizeof *Yc);
+        if (Xc == NULL || Yc == NULL) {
             *err = E_ALLOC;
-            return NULL;
-        }
-        memcpy(Tmp->val, Y->val, n * ny * sizeof(double));
-        memcpy(Tmp->val + n * ny, X->val, n * nx * sizeof(double));
-        if (ny > 1) {
-            M = gretl_matrix_sort_by_columns(Tmp, cols, err);
-        } else {
-            M = gretl_matrix_sort_by_column(Tmp, 0, err);
         }
-        gretl_matrix_free(Tmp);
-    }
-
-    if (*err) {
-        return NULL;
     }
 
-    /* determine the number of 'by' values */
-    nby = 0;
-    for (i=0; i<n; i++) {
-        if (row_starts_block(i, M->val, ny, n)) {
-            nby++;
+    if (!*err) {
+        for (j=0; j<ny; j++) {
+            Yc[j] = Y->val + j * n;
         }
-    }
-
-    /* allocate the return matrix */
-    ret = gretl_zero_matrix_new(nby, ny + 1 + nx);
-    if (ret == NULL) {
-        *err = E_ALLOC;
-        gretl_matrix_free(M);
-        free(cols);
-        return NULL;
-    }
-
-    /* find and record the per-value counts */
-    counts = calloc(nby, sizeof *counts);
-    counts[0] = 1;
-    for (i=1, k=0; i<n; i++) {
-        y = M->val;
-        if (row_starts_block(i, y, ny, n)) {
-            for (j=0; j<ny; j++) {
-                gretl_matrix_set(ret, k, j, y[i-1]);
-                y += n;
-            }
-            gretl_matrix_set(ret, k, j, (double) counts[k]);
-            counts[++k] = 1;
-        } else {
-            counts[k] += 1;
-            if (i == n - 1) {
-                for (j=0; j<ny; j++) {
-                    gretl_matrix_set(ret, k, j, y[i]);
-                    y += n;
-                }
-                gretl_matrix_set(ret, k, j, (double) counts[k]);
-            }
+        for (j=0; j<nx; j++) {
+            Xc[j] = X->val + j * n;
         }
+        gb = groupby_new(Yc, ny, n, 0, err);
     }
 
-    if (nx > 0) {
-        /* do the @X aggregation */
-        double *z = M->val + ny * n; /* the @X portion of @M */
-        double *zsave;
-        int nk;
-
-        for (k=0; k<nby; k++) {
-            zsave = z;
-            nk = counts[k] - 1;
-            for (j=0; j<nx; j++) {
-                if (dbuiltin) {
-                    rkj = (*dbuiltin)(0, nk, z);
-                } else {
-                    rkj = (double) (*ibuiltin)(0, nk, z);
-                }
-                gretl_matrix_set(ret, k, j + ny + 1, rkj);
-                /* skip to the next column */
-                z += n;
-            }
-            /* move to the next block of rows */
-            z = zsave + counts[k];
-        }
+    if (!*err) {
+        ret = groupby_aggregate(gb, Xc, nx, dfuncs, ifuncs, nstat,
+                                NULL, NULL, NULL, err);
     }
 
-    aggr_add_colnames(ret, NULL, NULL, X, Y, NULL);
+    if (ret != NULL) {
+        aggr_add_colnames(ret, NULL, NULL, X, Y, names, nstat, NULL);
+    }
 
-    gretl_matrix_free(M);
-    free(counts);
-    free(cols);
+    groupby_free(gb);
+    strings_array_free(names, nstat);
+    free(Xc);
+    free(Yc);
 
     return ret;
 }
@@ -7822,52 +8907,42 @@ static int annual_or_decennial_dates (const DATASET *dset,
     return 0;
 }
 
-static int panel_daily_or_weekly (const DATASET *dset, double *x)
+/* Fill @x with YYYYMMDD values for the first @T observations of
+   the calendar dataset @dset, via the dataset's epoch days.
+*/
+
+static int calendar_basic_dates (const DATASET *dset, int T, double *x)
 {
-    DATASET tsset = {0};
-    char datestr[16];
-    int t, y, m, d, n;
-    int err = 0;
+    guint32 *ed = malloc(T * sizeof *ed);
+    int t, err;
 
-    tsset.structure = TIME_SERIES;
-    tsset.pd = dset->panel_pd;
-    tsset.sd0 = dset->panel_sd0;
-    tsset.n = dset->pd;
-    calendar_date_string(tsset.stobs, 0, &tsset);
+    if (ed == NULL) {
+        return E_ALLOC;
+    }
 
-    for (t=0; t<dset->pd && !err; t++) {
-        ntolabel(datestr, t, &tsset);
-        n = sscanf(datestr, "%d-%d-%d", &y, &m, &d);
-        if (n != 3) {
-            err = E_DATA;
-        } else {
-            x[t] = 10000*y + 100*m + d;
+    err = calendar_epoch_days(dset, 0, T-1, ed);
+    if (!err) {
+        for (t=0; t<T; t++) {
+            x[t] = ed[t];
         }
+        err = ymd_basic_from_epoch_days(x, x, T, 0);
     }
 
+    free(ed);
+
     return err;
 }
 
-static int regular_daily_or_weekly (const DATASET *dset, double *x)
+static int panel_daily_or_weekly (const DATASET *dset, double *x)
 {
-    char datestr[16];
-    int t, y, m, d, n;
-    int err = 0;
+    DATASET tsset = {0};
 
-    for (t=0; t<dset->n && !err; t++) {
-        ntolabel(datestr, t, dset);
-#if 0
-        fprintf(stderr, "regular: datestr = '%s'\n", datestr);
-#endif
-        n = sscanf(datestr, "%d-%d-%d", &y, &m, &d);
-        if (n != 3) {
-            err = E_DATA;
-        } else {
-            x[t] = 10000*y + 100*m + d;
-        }
-    }
+    tsset.structure = TIME_SERIES;
+    tsset.pd = dset->panel_pd;
+    tsset.sd0 = dset->panel_sd0;
+    tsset.n = dset->pd;
 
-    return err;
+    return calendar_basic_dates(&tsset, dset->pd, x);
 }
 
 int fill_dataset_dates_series (const DATASET *dset, double *x)
@@ -7897,7 +8972,7 @@ int fill_dataset_dates_series (const DATASET *dset, double *x)
             err = panel_daily_or_weekly(dset, x);
         }
     } else if (calendar_data(dset)) {
-        err = regular_daily_or_weekly(dset, x);
+        err = calendar_basic_dates(dset, dset->n, x);
     } else if (quarterly_or_monthly(dset)) {
         err = monthly_or_quarterly_dates(dset, pd, sd0, T, x);
     } else if (annual_data(dset) || decennial_data(dset)) {
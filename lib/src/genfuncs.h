@@ -31,6 +31,9 @@ int rank_series (const double *x, double *y, int f,
 
 gretl_matrix *rank_vector (const gretl_matrix *x, int f, int *err);
 
+int gretl_rank_values (const double *x, int n, int desc,
+		       double *rank, int *order);
+
 int diff_series (const double *x, double *y, int f,
 		 const DATASET *dset);
 
@@ -82,6 +85,9 @@ int exponential_movavg_series (const double *x, double *y,
 int movavg_series (const double *x, double *y, const DATASET *dset,
 		   int k, int center);
 
+int movstat_series (const double *x, double *y, const DATASET *dset,
+		    int k, const char *stat, double p);
+
 int seasonally_adjust_series (const double *x, double *y,
 			      const char *vname, DATASET *dset,
 			      int tramo, gretl_bundle *b,
@@ -108,6 +114,13 @@ int oshp_filter (const double *x, double *hp, const DATASET *dset,
 int bkbp_filter (const double *x, double *bk, const DATASET *dset,
 		 int bkl, int bku, int k);
 
+gretl_matrix *hp_filter_list (const int *list, const DATASET *dset,
+			      double lambda, int oneside,
+			      gretlopt opt, int *err);
+
+gretl_matrix *bkbp_filter_list (const int *list, const DATASET *dset,
+				int bkl, int bku, int k, int *err);
+
 int butterworth_filter (const double *x, double *bw, const DATASET *dset,
 			int n, double cutoff);
 
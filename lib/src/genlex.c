@@ -205,6 +205,9 @@ struct str_table bvars[] = {
     { B_MODEL,   "$model" },
     { B_SYSTEM,  "$system" },
     { B_SYSINFO, "$sysinfo" },
+    { B_MEMOSTATS, "$memostats" },
+    { B_MEMSTATS, "$memstats" },
+    { B_GENRSTATS, "$genrstats" },
     { 0,         NULL }
 };
 
@@ -392,6 +395,7 @@ struct str_table funcs[] = {
     { F_FDJAC,    "fdjac" },
     { F_BFGSMAX,  "BFGSmax" },
     { F_BFGSCMAX, "BFGScmax" },
+    { F_MSMAX,    "MSmax" },
     { F_NRMAX,    "NRmax" },
     { F_NUMHESS,  "numhess" },
     { F_OBSNUM,   "obsnum" },
@@ -435,6 +439,7 @@ struct str_table funcs[] = {
     { F_KSMOOTH,  "ksmooth" },
     { F_KDSMOOTH, "kdsmooth" },
     { F_KSIMUL,   "ksimul" },
+    { F_KMFILTER, "kmfilter" },
     { F_KSIMDATA, "ksimdata" },
     { F_TRIMR,    "trimr" },
     { F_GETENV,   "getenv" },
@@ -464,6 +469,9 @@ struct str_table funcs[] = {
     { F_IMHOF,    "imhof" },
     { F_TOEPSOLV, "toepsolv" },
     { F_RGBMIX,   "rgbmix" },
+    { F_OLSROLL,  "olsroll" },
+    { F_PERMTEST, "permtest" },
+    { F_MOVSTAT,  "movstat" },
     { F_DSUM,     "diagcat" },
     { F_CORRGM,   "corrgm" },
     { F_MCOVG,    "mcovg" },
@@ -489,6 +497,7 @@ struct str_table funcs[] = {
     { F_ERRMSG,   "errmsg" },
     { F_ISCONST,  "isconst" },
     { F_IRF,      "irf" },
+    { F_VARPATHS, "varpaths" },
     { F_INBUNDLE, "inbundle" },
     { F_STRSUB,   "strsub" },
     { F_REGSUB,   "regsub" },
@@ -501,6 +510,9 @@ struct str_table funcs[] = {
     { F_LOESS,    "loess" },
     { F_GHK,      "ghk" },
     { F_HALTON,   "halton" },
+    { F_SOBOL,    "sobol" },
+    { F_TSBARS,   "tsbars" },
+    { F_TSFIND,   "tsfind" },
     { F_IWISHART, "iwishart" },
     { F_ISNAN,    "isnan" },
     { F_TYPESTR,  "typestr" },
@@ -522,6 +534,7 @@ struct str_table funcs[] = {
     { F_ALLREDUCE, "mpiallred" },
     { F_SCATTER,   "mpiscatter" },
     { F_BARRIER,   "mpibarrier" },
+    { F_MPIMAP,    "mpimap" },
     { F_EASTER,    "easterday" },
     { F_GENSERIES, "genseries" },
     { F_CURL,      "curl" },
@@ -566,6 +579,8 @@ struct str_table funcs[] = {
     { F_GETKEYS,   "getkeys" },
     { F_FEVAL,     "feval" },
     { F_FEVALB,    "fevalb" },
+    { F_SPAWN,     "spawn" },
+    { F_AWAIT,     "await" },
     { F_BINPERMS,  "binperms" },
     { F_BRENAME,   "brename" },
     { F_CCODE,     "isocountry" },
@@ -606,6 +621,10 @@ struct str_table funcs[] = {
     { F_SPHCORR,   "sphericorr" },
     { F_THRESHOLD, "thresh" },
     { F_LNMGAMMA,  "lnmgamma"},
+    { F_MMULT,     "mmult" },
+    { F_CHOLUPD,   "cholupdate" },
+    { F_OLSBATCH,  "olsbatch" },
+    { F_MSOLVE,    "msolve" },
     { 0,           NULL }
 };
 
@@ -616,6 +635,7 @@ struct str_table func_alias[] = {
     { F_NRMAX,    "NRmin" },
     { F_BFGSMAX,  "BFGSmin" },
     { F_BFGSCMAX, "BFGScmin" },
+    { F_MSMAX,    "MSmin" },
     { F_GSSMAX,   "GSSmin" },
     { F_GAMMA,    "gammafunc" },
     { F_GAMMA,    "gamma" },
@@ -694,6 +714,10 @@ static GHashTable *gretl_function_hash_init (void)
 
 static GHashTable *oht;
 
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(oht)
+#endif
+
 int install_function_override (const char *funname,
                                const char *pkgname,
                                gpointer data)
@@ -776,8 +800,9 @@ static int real_function_lookup (const char *s, int aliases,
         return 0;
     }
 
-    if (fht == NULL) {
-        fht = gretl_function_hash_init();
+    if (g_once_init_enter(&fht)) {
+        /* guard against concurrent first use by two threads */
+        g_once_init_leave(&fht, gretl_function_hash_init());
     }
 
     fnp = g_hash_table_lookup(fht, s);
@@ -1292,6 +1317,10 @@ void context_error (int c, parser *p, const char *func)
 
 static int parsing_query;
 
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(parsing_query)
+#endif
+
 void set_parsing_query (int s)
 {
     parsing_query = s;
@@ -1576,6 +1605,10 @@ static int maybe_get_R_function (const char *s)
 
 static int doing_genseries;
 
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(doing_genseries)
+#endif
+
 void set_doing_genseries (int s)
 {
     doing_genseries = s;
@@ -2790,6 +2823,8 @@ const char *getsymb_full (int t, const parser *p)
         return ":";
     case QUERY:
         return "query";
+    case CSE:
+        return "CSE";
     case LAG:
         return "lag";
     default:
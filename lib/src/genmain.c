@@ -559,6 +559,10 @@ int genr_special_word (const char *s)
 
 static GretlType genr_last_type;
 
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(genr_last_type)
+#endif
+
 GretlType genr_get_last_output_type (void)
 {
     return genr_last_type;
@@ -140,7 +140,10 @@ typedef enum {
 typedef enum {
     B_MODEL = M_MAX + 1, /* last model as bundle */
     B_SYSTEM,            /* last VAR/VECM/system as bundle */
-    B_SYSINFO            /* system information */
+    B_SYSINFO,           /* system information */
+    B_MEMOSTATS,         /* statistics on memoized functions */
+    B_MEMSTATS,          /* memory accounting */
+    B_GENRSTATS          /* genr performance counters */
 } BundleDataIndex;
 
 #define model_data_scalar(i) (i > R_MAX && i < M_SCALAR_MAX)
@@ -177,6 +180,9 @@ GretlType genr_get_last_output_type (void);
 
 gretl_matrix *genr_get_output_matrix (GENERATOR *genr);
 
+double genr_autodiff (GENERATOR *genr, const gretl_matrix *b,
+		      double *g, int *err);
+
 int series_index (const DATASET *dset, const char *varname);
 
 int series_greatest_index (const DATASET *dset, const char *varname);
@@ -239,6 +245,11 @@ void genr_unset_na_check (GENERATOR *genr);
 
 void genr_reset_uvars (GENERATOR *genr);
 
+int genr_get_invariant_inputs (const GENERATOR *genr, char ***pS,
+			       int *ns);
+
+int genr_get_writes (const GENERATOR *genr, char ***pS, int *ns);
+
 int function_lookup (const char *s);
 
 int is_function_alias (const char *s);
@@ -251,9 +262,17 @@ const char *gretl_function_complete (const char *s);
 
 void gretl_function_hash_cleanup (void);
 
+void genr_node_pool_free (void);
+
 void set_mpi_rank_and_size (int rank, int size);
 
 void set_user_qsorting (int s);
 
+void genr_stats_set_enabled (int s);
+
+int genr_stats_report (PRN *prn);
+
+gretl_bundle *genr_stats_bundle (int *err);
+
 #endif /* GENMAIN_H */
 
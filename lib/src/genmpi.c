@@ -390,3 +390,141 @@ static NODE *mpi_barrier_node (parser *p)
 
     return ret;
 }
+
+/* mpimap(): apply the user function named by @l to each element
+   of the array @r, with the elements dealt out dynamically to the
+   MPI processes by gretl_mpi_task_queue(). The results are
+   collected, in order, in an array at rank 0.
+*/
+
+struct mpimap_info {
+    const char *fname;
+    ufunc *u;
+    parser *p;
+};
+
+static void *mpimap_task (void *item, GretlType itype,
+			  void *ctx, int *err)
+{
+    struct mpimap_info *mi = ctx;
+    parser *p = mi->p;
+    NODE *save_aux = p->aux;
+    NODE tmp = {0};
+    NODE mn = {0};
+    NODE arg = {0};
+    NODE *argp = &arg;
+    NODE *val;
+    void *ret = NULL;
+
+    arg.t = gen_type_from_gretl_type(itype);
+    if (arg.t == MAT) {
+	arg.v.m = item;
+    } else if (arg.t == BUNDLE) {
+	arg.v.b = item;
+    } else if (arg.t == STR) {
+	arg.v.str = item;
+    } else if (arg.t == ARRAY) {
+	arg.v.a = item;
+    } else if (arg.t == LIST) {
+	arg.v.ivec = item;
+    } else {
+	*err = E_TYPES;
+	return NULL;
+    }
+
+    p->aux = NULL;
+    tmp.t = UFUN;
+    tmp.vname = (char *) mi->fname;
+    tmp.v.ptr = mi->u;
+    mn.v.bn.n_nodes = 1;
+    mn.v.bn.n = &argp;
+    tmp.R = &mn;
+    val = eval_ufunc(&tmp, &mn, p);
+
+    if (!p->err && val != NULL) {
+	/* take over the value if it's a temporary, else copy it */
+	int steal = is_tmp_node(val);
+
+	if (val->t == MAT) {
+	    ret = steal ? val->v.m : gretl_matrix_copy(val->v.m);
+	} else if (val->t == BUNDLE) {
+	    ret = steal ? val->v.b : gretl_bundle_copy(val->v.b, &p->err);
+	} else if (val->t == STR) {
+	    ret = steal ? val->v.str : gretl_strdup(val->v.str);
+	} else if (val->t == ARRAY) {
+	    ret = steal ? val->v.a : gretl_array_copy(val->v.a, &p->err);
+	} else {
+	    p->err = E_TYPES;
+	}
+	if (steal && ret != NULL) {
+	    val->v.ptr = NULL;
+	}
+	if (!p->err && ret == NULL) {
+	    p->err = E_ALLOC;
+	}
+    }
+    if (val != NULL && is_aux_node(val)) {
+	free_node(val, p);
+    }
+    p->aux = save_aux;
+
+    *err = p->err;
+    p->err = 0;
+
+    return ret;
+}
+
+static NODE *mpimap_node (NODE *l, NODE *r, parser *p)
+{
+    struct mpimap_info mi;
+    GretlType rtype;
+    gretl_array *a;
+    NODE *ret = NULL;
+
+    if (!gretl_mpi_initialized()) {
+	gretl_errmsg_set(_("The MPI library is not loaded"));
+	p->err = 1;
+	return NULL;
+    }
+
+    mi.fname = l->v.str;
+    mi.u = get_user_function_by_name(mi.fname);
+    mi.p = p;
+    if (mi.u == NULL) {
+	gretl_errmsg_sprintf(_("%s: function not found"), mi.fname);
+	p->err = E_DATA;
+	return NULL;
+    }
+
+    rtype = user_func_get_return_type(mi.u);
+    if (gretl_is_array_type(rtype)) {
+	rtype = GRETL_TYPE_ARRAY;
+    } else if (rtype != GRETL_TYPE_MATRIX &&
+	       rtype != GRETL_TYPE_BUNDLE &&
+	       rtype != GRETL_TYPE_STRING) {
+	gretl_errmsg_sprintf(_("mpimap: the function %s must return a "
+			       "matrix, string, bundle or array"),
+			     mi.fname);
+	p->err = E_TYPES;
+	return NULL;
+    }
+
+    a = gretl_mpi_task_queue(r->v.a, rtype, mpimap_task, &mi, &p->err);
+
+    if (!p->err) {
+	if (a == NULL) {
+	    /* not rank 0: give back an empty array of the right type */
+	    a = gretl_array_new(gretl_type_get_plural(rtype), 0, &p->err);
+	}
+	if (!p->err) {
+	    ret = aux_array_node(p);
+	}
+	if (ret != NULL) {
+	    ret->v.a = a;
+	} else {
+	    gretl_array_destroy(a);
+	}
+    }
+
+    return ret;
+}
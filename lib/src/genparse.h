@@ -128,6 +128,7 @@ enum {
               INC,        /* increment */
               DEC,        /* decrement */
 	      QUERY,      /* ternary "?" expression */
+	      CSE,        /* common subexpression (optimized tree) */
 	      EOT,	  /* end of transmission */
 	      UNK
 };
@@ -261,6 +262,7 @@ enum {
     F_ACCESS,
     F_POLROOTS,
     F_RANDSTR,
+    F_AWAIT,
     HF_JBTERMS,
     HF_FDEPTH,
     F1_MAX,	  /* SEPARATOR: end of single-arg functions */
@@ -322,7 +324,6 @@ enum {
     F_PSD,
     F_PSHRINK,
     F_RANDINT,
-    F_MREAD,
     F_BREAD,
     F_GETLINE,
     F_ISODATE,
@@ -333,6 +334,7 @@ enum {
     F_MPI_SEND,
     F_BCAST,
     F_ALLREDUCE,
+    F_MPIMAP,
     F_GENSERIES,
     F_KPSSCRIT,
     F_STRINGIFY,
@@ -396,8 +398,10 @@ enum {
     F_MNORM,
     F_LNMGAMMA,
     F_NULLSPC,
+    F_MSOLVE,
     HF_VCNORM,
     HF_GLASSO,
+    F_TSFIND,
     F2_MAX,	  /* SEPARATOR: end of two-arg functions */
     F_WMEAN,
     F_WVAR,
@@ -428,6 +432,9 @@ enum {
     F_EIGSOLVE,
     F_SIMANN,
     F_HALTON,
+    F_SOBOL,
+    F_TSBARS,
+    F_MREAD,
     F_MWRITE,
     F_BWRITE,
     F_AGGRBY,
@@ -478,6 +485,8 @@ enum {
     F_INSTRINGS,
     F_THRESHOLD,
     F_JSONGETB,
+    F_MMULT,
+    F_CHOLUPD,
     HF_REGLS,
     F3_MAX,       /* SEPARATOR: end of three-arg functions */
     F_URCPVAL,
@@ -499,6 +508,7 @@ enum {
     F_KSMOOTH,
     F_KDSMOOTH,
     F_KSIMUL,
+    F_KMFILTER,
     F_NRMAX,
     F_LOESS,
     F_GHK,
@@ -517,8 +527,10 @@ enum {
     F_BFGSCMAX,
     F_SVM,
     F_IRF,
+    F_VARPATHS,
     F_NADARWAT,
     F_FEVAL,
+    F_SPAWN,
     F_CHOWLIN,
     F_TDISAGG,
     F_HYP2F1,
@@ -526,6 +538,11 @@ enum {
     F_COMMUTE,
     F_TOEPSOLV,
     F_RGBMIX,
+    F_OLSBATCH,
+    F_OLSROLL,
+    F_PERMTEST,
+    F_MOVSTAT,
+    F_MSMAX,
     HF_FELOGITR,
     FN_MAX,	  /* SEPARATOR: end of n-arg functions */
 };
@@ -601,13 +618,13 @@ enum {
 			s == F_FDJAC || s == F_SIMANN || \
 			s == F_BFGSCMAX || s == F_NMMAX || \
 			s == F_GSSMAX || s == F_NUMHESS || \
-			s == F_FZERO)
+			s == F_FZERO || s == F_MSMAX)
 
 /* functions with "reversing" aliases */
 #define als_func(s) (s == F_BFGSMAX || s == F_NRMAX || \
 		     s == F_SIMANN || s == F_BFGSCMAX || \
 		     s == F_NMMAX || s == F_GSSMAX || \
-		     s == F_EXISTS)
+		     s == F_MSMAX || s == F_EXISTS)
 
 /* functions where the right-hand argument is actually a return
    location */
@@ -657,6 +674,7 @@ struct node {
     gint16 t;        /* type identifier */
     guint8 flags;    /* AUX_NODE etc., see above */
     int vnum;        /* associated series ID number */
+    guint32 gen;     /* names generation at which vnum was resolved */
     char *vname;     /* associated variable name */
     user_var *uv;    /* associated named variable */
     union val v;     /* value (of whatever type) */
@@ -714,6 +732,8 @@ struct lhinfo {
 
 typedef struct parser_ parser;
 
+typedef struct genvm_ genvm;
+
 struct parser_ {
     const char *input; /* complete input string */
     const char *point; /* remaining unprocessed input */
@@ -729,6 +749,7 @@ struct parser_ {
     NODE *lhres;       /* result of eval() on @lhtree */
     NODE *tree;        /* RHS syntax tree */
     NODE *ret;         /* result of eval() on @tree */
+    genvm *vm;         /* bytecode for @tree, if applicable */
     /* below: parser state variables */
     NODE *aux;         /* convenience pointer to current auxiliary node */
     int callcount;
@@ -752,6 +773,7 @@ int parser_print_input (parser *p);
 void free_tree (NODE *t, parser *p, int code);
 void lex (parser *s);
 NODE *new_node (int t);
+void node_release (NODE *n);
 NODE *expr (parser *s);
 NODE *newdbl (double x);
 NODE *newempty (void);
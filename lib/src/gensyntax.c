@@ -47,9 +47,60 @@ static void notify (const char *s, NODE *n, parser *p)
 }
 #endif
 
+/* Recycling of NODE structs. Evaluation of a genr that is not
+   compiled allocates a node for each term of the expression and
+   each intermediate result, and frees them all when the statement
+   is done, so in a loop body the same handful of nodes is
+   allocated and freed over and over. Instead of going back to the
+   system we keep freed nodes on a per-thread stack, from which
+   new_node() draws first.
+*/
+
+#define NODE_POOL_MAX 512
+
+static NODE *node_pool[NODE_POOL_MAX];
+static int n_pooled;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(node_pool, n_pooled)
+#endif
+
+/* Called by free_node() in place of free(), when any data
+   attached to @n have been freed. */
+
+void node_release (NODE *n)
+{
+    if (n_pooled < NODE_POOL_MAX) {
+	node_pool[n_pooled++] = n;
+    } else {
+	free(n);
+    }
+}
+
+/**
+ * genr_node_pool_free:
+ *
+ * Cleanup function: frees any genr nodes held for reuse by
+ * the calling thread.
+ */
+
+void genr_node_pool_free (void)
+{
+    while (n_pooled > 0) {
+	free(node_pool[--n_pooled]);
+    }
+}
+
 NODE *new_node (int t)
 {
-    NODE *n = calloc(1, sizeof *n);
+    NODE *n;
+
+    if (n_pooled > 0) {
+	n = node_pool[--n_pooled];
+	memset(n, 0, sizeof *n);
+    } else {
+	n = calloc(1, sizeof *n);
+    }
 
 #if MDEBUG
     fprintf(stderr, "new_node: allocated node of type %d (%s) at %p\n",
@@ -86,6 +137,9 @@ static NODE *newref (parser *p, int t)
 	    n->vnum = p->idnum;
 	    n->v.xvec = p->dset->Z[n->vnum];
 	    n->vname = p->idstr;
+	    if (n->vname != NULL && strchr(n->vname, '.') == NULL) {
+		n->gen = dataset_names_generation();
+	    }
 	} else if (t == NUM || t == NUM_P || t == NUM_M) {
 	    user_var *u = p->data;
 
@@ -505,7 +559,8 @@ static NODE *get_final_string_arg (parser *p, NODE *t, int sym,
 	    } else if (gretl_is_bundle(tmp)) {
 		lex(p);
 		ret = expr(p);
-	    } else if (c == '[' && get_array_by_name(tmp)) {
+	    } else if (c == '[' &&
+		       get_user_var_of_type_by_name(tmp, GRETL_TYPE_ARRAY)) {
 		lex(p);
 		ret = expr(p);
 	    }
@@ -1095,6 +1150,7 @@ struct argrecord fncall_argrec[] = {
     {F_GSSMAX,   {0, 1, 0, 0}},
     {F_NUMHESS,  {0, 1, 0, 0}},
     {F_FZERO,    {1, 0, 0, 0}},
+    {F_MSMAX,    {0, 0, 1, 1}},
 };
 
 static const int *get_callargs (int f)
@@ -1539,6 +1595,7 @@ static NODE *powterm (parser *p, NODE *l)
 
 		if (sym == F_NRMAX ||
 		    sym == F_BFGSCMAX ||
+		    sym == F_MSMAX ||
 		    sym == F_MOVAVG) {
 		    k = 4;
 		}
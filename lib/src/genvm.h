@@ -0,0 +1,67 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Bytecode for compiled scalar genrs (see geneval.c), shared with
+   the optional "genjit" plugin which translates it to native code.
+*/
+
+#ifndef GENVM_H_
+#define GENVM_H_
+
+enum {
+    VM_LOAD = 1, /* scalar variable to register */
+    VM_ADD,      /* specialized arithmetic */
+    VM_SUB,
+    VM_MUL,
+    VM_DIV,
+    VM_CALC,     /* other binary operators, via xy_calc() */
+    VM_FUNC,     /* one-argument function */
+    VM_SKIPF,    /* short-circuit for '&&': jump if false */
+    VM_SKIPT     /* short-circuit for '||': jump if true */
+};
+
+typedef struct genvm_inst_ genvm_inst;
+typedef struct genvm_jit_helpers_ genvm_jit_helpers;
+
+struct genvm_inst_ {
+    int op;    /* VM opcode */
+    int f;     /* genr operator or function */
+    int dst;   /* target register */
+    int a;     /* first operand register */
+    int b;     /* second operand register, or jump target */
+    void *ptr; /* variable node (VM_LOAD), C function (VM_FUNC) */
+};
+
+/* Operations that native code hands back to libgretl: @p is the
+   parser pointer passed to the native function.
+*/
+
+struct genvm_jit_helpers_ {
+    double (*calc) (double x, double y, int f, void *p);
+    double (*apply) (double x, int f, void *p);
+};
+
+/* Native code for a program, taking its register array, the parser
+   and the NA-testing flag. It skips VM_LOAD instructions: the caller
+   is responsible for loading variables into their registers.
+*/
+
+typedef void (*genvm_native) (double *reg, void *p, int natest);
+
+#endif /* GENVM_H_ */
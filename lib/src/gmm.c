@@ -53,6 +53,7 @@ struct ocset_ {
     gretl_matrix *W;      /* matrix of weights */
     gretl_matrix *tmp;    /* holds columnwise product of e and Z */
     gretl_matrix *sum;    /* holds column sums of tmp */
+    gretl_matrix *EZ;     /* workspace for cross-product of e and Z */
     gretl_matrix *S;      /* selector matrix for computing tmp */
     colsrc *ecols;        /* info on provenance of columns of 'e' */
     int noc;              /* total number of orthogonality conds. */
@@ -80,6 +81,7 @@ void oc_set_destroy (ocset *oc)
     gretl_matrix_free(oc->Z);
     gretl_matrix_free(oc->tmp);
     gretl_matrix_free(oc->sum);
+    gretl_matrix_free(oc->EZ);
     gretl_matrix_free(oc->S);
 
     free(oc->ecols);
@@ -110,6 +112,7 @@ static ocset *oc_set_new (void)
 	oc->W = NULL;
 	oc->tmp = NULL;
 	oc->sum = NULL;
+	oc->EZ = NULL;
 	oc->S = NULL;
 	oc->ecols = NULL;
 	oc->noc = 0;
@@ -865,8 +868,9 @@ static int gmm_add_workspace (nlspec *s)
 
     s->oc->tmp = gretl_matrix_alloc(s->nobs, k);
     s->oc->sum = gretl_column_vector_alloc(k);
+    s->oc->EZ = gretl_matrix_alloc(s->oc->e->cols, s->oc->Z->cols);
 
-    if (s->oc->tmp == NULL || s->oc->sum == NULL) {
+    if (s->oc->tmp == NULL || s->oc->sum == NULL || s->oc->EZ == NULL) {
 	err = E_ALLOC;
     }
 
@@ -1079,26 +1083,49 @@ static int gmm_multiply_ocs (nlspec *s)
     return err;
 }
 
+/* Compute the sums over observations of the O.C. contributions,
+   writing them into @targ. Since the sum of e_i * Z_j is just the
+   (i,j) element of e'Z we get these from a single matrix product,
+   without forming the columnwise products in s->oc->tmp.
+*/
+
+static int gmm_oc_sums (nlspec *s, double *targ)
+{
+    gretl_matrix *EZ = s->oc->EZ;
+    const gretl_matrix *S = s->oc->S;
+    int i, j, p = 0;
+    int err;
+
+    err = gretl_matrix_multiply_mod(s->oc->e, GRETL_MOD_TRANSPOSE,
+				    s->oc->Z, GRETL_MOD_NONE,
+				    EZ, GRETL_MOD_NONE);
+    if (err) {
+	return err;
+    }
+
+    /* the ordering here matches gretl_matrix_columnwise_product() */
+    for (i=0; i<EZ->rows; i++) {
+	for (j=0; j<EZ->cols; j++) {
+	    if (S == NULL || gretl_matrix_get(S, i, j) != 0) {
+		targ[p++] = gretl_matrix_get(EZ, i, j);
+	    }
+	}
+    }
+
+    return 0;
+}
+
 static double gmm_criterion (nlspec *s)
 {
     double crit = 0.0;
     gretl_matrix *sum = s->oc->sum;
-    int k = s->oc->noc;
-    int i, j, err;
+    int err;
 
-    err = gmm_multiply_ocs(s);
+    err = gmm_oc_sums(s, sum->val);
     if (err) {
 	return NADBL;
     }
 
-    /* compute column sums */
-    for (j=0; j<k; j++) {
-	sum->val[j] = 0.0;
-	for (i=0; i<s->nobs; i++) {
-	    sum->val[j] += gretl_matrix_get(s->oc->tmp, i, j);
-	}
-    }
-
     crit = gretl_scalar_qform(sum, s->oc->W, &err);
     if (!err) {
 	crit = -crit;
@@ -1144,7 +1171,7 @@ static int gmm_jacobian_calc (int m, int n, double *x, double *f,
 {
     nlspec *s = (nlspec *) p;
     double fac;
-    int i, t, T;
+    int i, T;
 
     update_coeff_values(x, p);
 
@@ -1158,7 +1185,7 @@ static int gmm_jacobian_calc (int m, int n, double *x, double *f,
 	return 1;
     }
 
-    if (gmm_multiply_ocs(s)) {
+    if (gmm_oc_sums(s, f)) {
 	*iflag = -1;
 	return 1;
     }
@@ -1167,10 +1194,6 @@ static int gmm_jacobian_calc (int m, int n, double *x, double *f,
     fac = sqrt((double) T) / T;
 
     for (i=0; i<m; i++) {
-	f[i] = 0.0;
-	for (t=0; t<T; t++) {
-	    f[i] += gretl_matrix_get(s->oc->tmp, t, i);
-	}
 	f[i] *= fac;
     }
 
@@ -1279,7 +1302,7 @@ static int gmm_HAC (gretl_matrix *E, gretl_matrix *V, hac_info *hinfo)
     static gretl_matrix *E2;
     int T, k;
     double w;
-    int i, err = 0;
+    int i, r, c, err = 0;
 
     if (E == NULL) {
 	/* cleanup signal */
@@ -1336,18 +1359,22 @@ static int gmm_HAC (gretl_matrix *E, gretl_matrix *V, hac_info *hinfo)
 	    w = hac_weight(hinfo->kern, hinfo->h, i);
 	}
 	gretl_matrix_inplace_lag(W, E, i);
-	gretl_matrix_multiply_by_scalar(W, 2*w);
 	gretl_matrix_multiply_mod(E, GRETL_MOD_TRANSPOSE,
 				  W, GRETL_MOD_NONE,
 				  Tmp, GRETL_MOD_NONE);
-	gretl_matrix_xtr_symmetric(Tmp);
-	gretl_matrix_add_to(V, Tmp);
+	/* add w * (Tmp + Tmp') to V, upper triangle only */
+	for (c=0; c<k; c++) {
+	    for (r=0; r<=c; r++) {
+		V->val[c*k+r] += w * (Tmp->val[c*k+r] + Tmp->val[r*k+c]);
+	    }
+	}
     }
 
-    if (!gretl_matrix_is_symmetric(V)) {
-	/* should we do this? */
-	fprintf(stderr, "gmm_HAC: V is not symmetric\n");
-	gretl_matrix_xtr_symmetric(V);
+    /* copy the accumulated upper triangle into the lower */
+    for (c=0; c<k; c++) {
+	for (r=c+1; r<k; r++) {
+	    V->val[c*k+r] = V->val[r*k+c];
+	}
     }
 
     if (hinfo->whiten) {
@@ -1708,6 +1735,10 @@ static int gmm_normalize_wts_2 (nlspec *s)
     inicrit = -1 * get_gmm_crit(coeff, s);
 
     if (inicrit > 0 && !na(inicrit)) {
+	err = gmm_multiply_ocs(s);
+    }
+
+    if (!err && inicrit > 0 && !na(inicrit)) {
 	int k = s->oc->noc;
 	int n = s->oc->tmp->rows;
 	gretl_vector *qvec;
@@ -1837,6 +1868,14 @@ int gmm_calculate (nlspec *s, PRN *prn)
 	fprintf(stderr, "GMM BFGS: err = %d\n", err);
 #endif
 
+	if (!err) {
+	    /* the criterion works from the sums of the O.C.
+	       contributions: form the contributions themselves,
+	       as needed for the weights and covariance matrix
+	    */
+	    err = gmm_multiply_ocs(s);
+	}
+
 	/* don't keep displaying certain things */
 	iopt |= OPT_Q;
 
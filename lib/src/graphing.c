@@ -2633,6 +2633,8 @@ void gnuplot_cleanup (void)
         g_free(alt_sty);
         alt_sty = NULL;
     }
+
+    gnuplot_pipe_close();
 }
 
 static int graph_file_written;
@@ -2662,6 +2664,193 @@ static void remove_old_png (void)
     g_free(tmp);
 }
 
+#ifndef WIN32
+
+/* Optional persistent gnuplot co-process, in effect when "set
+   gnuplot_pipe" is on: plots written to file are then passed to a
+   single long-lived gnuplot via a pipe rather than each one starting
+   up a fresh process, which is a substantial saving for scripts
+   that produce many graphs. Before each plot the gnuplot session is
+   reset, and after it the output is closed, so the files written
+   are the same as those from a one-off gnuplot. Completion of each
+   plot is signalled by a marker line on gnuplot's stderr, which
+   also carries gnuplot's error status.
+*/
+
+#define GP_DONE_MARK "__gretl_plot_done__"
+
+static GPid gp_pid;
+static FILE *gp_in;  /* gnuplot's stdin */
+static FILE *gp_err; /* gnuplot's stderr */
+
+/**
+ * gnuplot_pipe_close:
+ *
+ * Shuts down the persistent gnuplot co-process, if it is
+ * running (see "set gnuplot_pipe").
+ */
+
+void gnuplot_pipe_close (void)
+{
+    if (gp_in != NULL) {
+        /* gnuplot exits on end of input */
+        fclose(gp_in);
+        gp_in = NULL;
+    }
+    if (gp_err != NULL) {
+        fclose(gp_err);
+        gp_err = NULL;
+    }
+    if (gp_pid > 0) {
+        waitpid(gp_pid, NULL, 0);
+        g_spawn_close_pid(gp_pid);
+        gp_pid = 0;
+    }
+}
+
+static int gnuplot_pipe_open (void)
+{
+    GError *gerr = NULL;
+    gchar *argv[2];
+    int fd_in, fd_err;
+    gboolean ok;
+
+    if (*gnuplot_path == '\0') {
+        strcpy(gnuplot_path, gretl_gnuplot_path());
+    }
+
+    argv[0] = gnuplot_path;
+    argv[1] = NULL;
+
+    ok = g_spawn_async_with_pipes(NULL, argv, NULL,
+                                  G_SPAWN_SEARCH_PATH |
+                                  G_SPAWN_DO_NOT_REAP_CHILD |
+                                  G_SPAWN_STDOUT_TO_DEV_NULL,
+                                  NULL, NULL, &gp_pid,
+                                  &fd_in, NULL, &fd_err,
+                                  &gerr);
+    if (!ok) {
+        gretl_errmsg_set(gerr->message);
+        fprintf(stderr, "gnuplot_pipe_open: '%s'\n", gerr->message);
+        g_error_free(gerr);
+        gp_pid = 0;
+        return E_EXTERNAL;
+    }
+
+    gp_in = fdopen(fd_in, "w");
+    gp_err = fdopen(fd_err, "r");
+    if (gp_in == NULL || gp_err == NULL) {
+        gnuplot_pipe_close();
+        return E_EXTERNAL;
+    }
+
+    return 0;
+}
+
+/* Send the commands to produce the graph specified in @fname to
+   the co-process; returns non-zero if writing fails. SIGPIPE is
+   ignored meanwhile, so that a gnuplot which has died is reported
+   as an error rather than terminating gretl.
+*/
+
+static int gnuplot_pipe_send (const char *fname, const char *cwd)
+{
+    struct sigaction sa, oldsa;
+    int err = 0;
+
+    sa.sa_handler = SIG_IGN;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = 0;
+    sigaction(SIGPIPE, &sa, &oldsa);
+
+    fputs("reset session\n", gp_in);
+    fprintf(gp_in, "cd '%s'\n", cwd);
+    fprintf(gp_in, "load '%s'\n", fname);
+    fputs("unset output\n", gp_in);
+    fputs("set print\n", gp_in);
+    fprintf(gp_in, "print sprintf(\"%s %%d\", GPVAL_ERRNO)\n", GP_DONE_MARK);
+    fputs("reset errors\n", gp_in);
+    if (fflush(gp_in) != 0 || ferror(gp_in)) {
+        err = 1;
+    }
+
+    sigaction(SIGPIPE, &oldsa, NULL);
+
+    return err;
+}
+
+static int gnuplot_pipe_make_graph (const char *fname)
+{
+    gchar *cwd = g_get_current_dir();
+    size_t n = strlen(GP_DONE_MARK);
+    char line[1024];
+    GString *msg;
+    int gperr = -1;
+    int err = 0;
+
+    if (strchr(fname, '\'') != NULL || strchr(cwd, '\'') != NULL) {
+        /* can't be quoted for gnuplot: use a one-off process */
+        g_free(cwd);
+        return gnuplot_make_image(fname);
+    }
+
+    if (gp_in == NULL) {
+        err = gnuplot_pipe_open();
+    }
+    if (!err && gnuplot_pipe_send(fname, cwd)) {
+        /* gnuplot must have gone away: try once more */
+        gnuplot_pipe_close();
+        err = gnuplot_pipe_open();
+        if (!err && gnuplot_pipe_send(fname, cwd)) {
+            gretl_errmsg_set(_("Command failed"));
+            err = 1;
+        }
+    }
+    g_free(cwd);
+    if (err) {
+        return err;
+    }
+
+    msg = g_string_new(NULL);
+    while (fgets(line, sizeof line, gp_err) != NULL) {
+        if (!strncmp(line, GP_DONE_MARK, n)) {
+            gperr = atoi(line + n);
+            break;
+        }
+        g_string_append(msg, line);
+    }
+
+    if (gperr < 0) {
+        /* gnuplot exited, as it does on error when reading
+           from a pipe; it will be restarted if needed */
+        gnuplot_pipe_close();
+    }
+
+    if (gperr != 0) {
+        g_strstrip(msg->str);
+        if (*msg->str != '\0') {
+            gretl_errmsg_set(msg->str);
+        } else {
+            gretl_errmsg_set(_("Command failed"));
+        }
+        fprintf(stderr, "gnuplot pipe: '%s' failed\n", fname);
+        err = 1;
+    }
+
+    g_string_free(msg, TRUE);
+
+    return err;
+}
+
+#else
+
+void gnuplot_pipe_close (void)
+{
+    return;
+}
+
+#endif /* WIN32 or not */
+
 /*
  * gnuplot_make_graph:
  *
@@ -2708,13 +2897,19 @@ static int gnuplot_make_graph (void)
     }
     err = gretl_spawn(buf);
 #else /* !WIN32 */
-    if (gui || fmt) {
-        sprintf(buf, "%s \"%s\"", gretl_gnuplot_path(), fname);
+    if (fmt && fmt != GP_TERM_VAR && libset_get_bool(GNUPLOT_PIPE)) {
+        /* output to file via the persistent gnuplot */
+        sprintf(buf, "(pipe) \"%s\"", fname);
+        err = gnuplot_pipe_make_graph(fname);
     } else {
-        /* gretlcli, interactive */
-        sprintf(buf, "%s -persist \"%s\"", gretl_gnuplot_path(), fname);
+        if (gui || fmt) {
+            sprintf(buf, "%s \"%s\"", gretl_gnuplot_path(), fname);
+        } else {
+            /* gretlcli, interactive */
+            sprintf(buf, "%s -persist \"%s\"", gretl_gnuplot_path(), fname);
+        }
+        err = gretl_spawn(buf);
     }
-    err = gretl_spawn(buf);
 #endif
 
 #if GP_DEBUG
@@ -3714,12 +3909,66 @@ static int use_lines (gnuplot_info *gi)
    with NAs when printing the plot data */
 static int *na_skiplist;
 
+/* Time-series plots with more than GP_DECIMATE_MIN observations
+   are decimated before the data are written: see
+   gp_decimation_mask() below.
+*/
+#define GP_BUCKETS 2048
+#define GP_DECIMATE_MIN (50 * GP_BUCKETS)
+
+/* For plots of very long time series: mark for printing only the
+   first, last, minimum and maximum observations of @y in each of
+   GP_BUCKETS equal segments of the range @t1 to @t2. At any
+   plausible output resolution a segment is no wider than a pixel
+   or two, so the line drawn looks the same as with all the data.
+   A run of missing values is represented by its first member, so
+   gaps in the line are preserved.
+*/
+
+static void gp_decimation_mask (const double *y, int t1, int t2,
+                                char *keep)
+{
+    gint64 n = t2 - t1 + 1;
+    int b, t;
+
+    memset(keep, 0, n);
+
+    for (b=0; b<GP_BUCKETS; b++) {
+        int ta = t1 + (int) (n * b / GP_BUCKETS);
+        int tb = t1 + (int) (n * (b + 1) / GP_BUCKETS);
+        int tfirst = -1, tlast = -1;
+        int tmin = -1, tmax = -1;
+
+        for (t=ta; t<tb; t++) {
+            if (na(y[t])) {
+                if (t == t1 || !na(y[t-1])) {
+                    keep[t-t1] = 1;
+                }
+                continue;
+            }
+            if (tfirst < 0) {
+                tfirst = tmin = tmax = t;
+            } else if (y[t] < y[tmin]) {
+                tmin = t;
+            } else if (y[t] > y[tmax]) {
+                tmax = t;
+            }
+            tlast = t;
+        }
+        if (tfirst >= 0) {
+            keep[tfirst-t1] = keep[tlast-t1] = 1;
+            keep[tmin-t1] = keep[tmax-t1] = 1;
+        }
+    }
+}
+
 static void print_gp_data (gnuplot_info *gi, const DATASET *dset,
                            FILE *fp)
 {
     int n = gi->t2 - gi->t1 + 1;
     double offset = 0.0;
     int datlist[3];
+    char *keep = NULL;
     int lmax, ynum = 2;
     int nomarkers = 0;
     int i, t;
@@ -3729,6 +3978,13 @@ static void print_gp_data (gnuplot_info *gi, const DATASET *dset,
         offset = 0.10 * gi->xrange / n;
     }
 
+    if (n > GP_DECIMATE_MIN && (gi->flags & GPT_TS) && gi->x != NULL &&
+        !use_impulses(gi) && !dset->markers &&
+        dset->structure != STACKED_TIME_SERIES) {
+        /* a very long time series: cut down the data */
+        keep = malloc(n);
+    }
+
     if (gi->x != NULL) {
         lmax = gi->list[0] - 1;
         datlist[0] = 1;
@@ -3749,12 +4005,18 @@ static void print_gp_data (gnuplot_info *gi, const DATASET *dset,
         double xoff = offset * (i - 1);
 
         datlist[ynum] = gi->list[i];
+        if (keep != NULL) {
+            gp_decimation_mask(dset->Z[datlist[ynum]], gi->t1,
+                               gi->t2, keep);
+        }
 
         for (t=gi->t1; t<=gi->t2; t++) {
             const char *label = NULL;
             char obs[OBSLEN];
 
-            if (in_gretl_list(na_skiplist, datlist[ynum]) &&
+            if (keep != NULL && !keep[t - gi->t1]) {
+                continue;
+            } else if (in_gretl_list(na_skiplist, datlist[ynum]) &&
                 na(dset->Z[datlist[ynum]][t])) {
                 continue;
             } else if (gi->x == NULL &&
@@ -3777,6 +4039,8 @@ static void print_gp_data (gnuplot_info *gi, const DATASET *dset,
 
         fputs("e\n", fp);
     }
+
+    free(keep);
 }
 
 static int
@@ -193,6 +193,8 @@ int gnuplot_graph_wanted (PlotType ptype, gretlopt opt, int *err);
 
 void gnuplot_cleanup (void);
 
+void gnuplot_pipe_close (void);
+
 int specified_gp_output_format (void);
 
 int write_plot_output_line (const char *path, FILE *fp);
@@ -27,6 +27,8 @@
 #include "matrix_extra.h"
 #include "gretl_cmatrix.h"
 #include "gretl_array.h"
+#include "gretl_mt.h"
+#include "gretl_memstats.h"
 
 /**
  * gretl_array:
@@ -86,6 +88,7 @@ void gretl_array_destroy (gretl_array *A)
     if (A != NULL) {
 	gretl_array_destroy_data(A);
 	free(A);
+	gretl_memstats_object(GRETL_TYPE_ARRAY, -1);
     }
 }
 
@@ -208,6 +211,7 @@ gretl_array *gretl_array_new (GretlType type, int n, int *err)
 	A->n = n;
 	A->data = NULL;
 	A->mdata = NULL;
+	gretl_memstats_object(GRETL_TYPE_ARRAY, 1);
 	if (n > 0) {
 	    *err = array_allocate_storage(A);
 	    if (*err) {
@@ -318,6 +322,253 @@ gretl_array *gretl_matrix_array_sized (int n, int r, int c,
     return A;
 }
 
+/* Batched operations on arrays of matrices. In each case the
+   output is a new array whose members share a common block of
+   storage, as per gretl_matrix_array_sized(), and the work is
+   split across the members of the batch under OpenMP. The
+   inputs must hold real matrices all of the same dimensions,
+   except that an operand with a single member is applied to
+   every member of the other operand.
+*/
+
+static int matrix_array_common_dims (gretl_array *A, int *r, int *c)
+{
+    gretl_matrix *m;
+    int i;
+
+    if (A == NULL || A->type != GRETL_TYPE_MATRICES || A->n == 0) {
+	return E_TYPES;
+    }
+
+    for (i=0; i<A->n; i++) {
+	m = A->data[i];
+	if (gretl_is_null_matrix(m)) {
+	    return E_DATA;
+	} else if (m->is_complex) {
+	    return E_CMPLX;
+	} else if (i == 0) {
+	    *r = m->rows;
+	    *c = m->cols;
+	} else if (m->rows != *r || m->cols != *c) {
+	    gretl_errmsg_set(_("Batched operation: matrices must all "
+			       "be of the same dimensions"));
+	    return E_NONCONF;
+	}
+    }
+
+    return 0;
+}
+
+static int batch_length (gretl_array *A, gretl_array *B, int *err)
+{
+    int n = A->n;
+
+    if (A->n != B->n) {
+	if (A->n == 1) {
+	    n = B->n;
+	} else if (B->n != 1) {
+	    *err = E_NONCONF;
+	}
+    }
+
+    return n;
+}
+
+#define batch_elem(A,i) ((gretl_matrix *) A->data[A->n == 1 ? 0 : i])
+
+/**
+ * gretl_matrix_array_multiply:
+ * @A: array of matrices.
+ * @B: array of matrices.
+ * @use_float: if non-zero, compute the products in single
+ * precision; see gretl_matrix_multiply_mod_float().
+ * @err: location to receive error code.
+ *
+ * Returns: a new array holding the products of the
+ * corresponding members of @A and @B, or NULL on failure.
+ */
+
+gretl_array *gretl_matrix_array_multiply (gretl_array *A,
+					  gretl_array *B,
+					  int use_float,
+					  int *err)
+{
+    gretl_array *C = NULL;
+    int ar, ac, br, bc;
+    int i, n;
+
+    *err = matrix_array_common_dims(A, &ar, &ac);
+    if (!*err) {
+	*err = matrix_array_common_dims(B, &br, &bc);
+    }
+    if (!*err && ac != br) {
+	*err = E_NONCONF;
+    }
+    if (!*err) {
+	n = batch_length(A, B, err);
+    }
+    if (!*err) {
+	C = gretl_matrix_array_sized(n, ar, bc, err);
+    }
+
+    if (!*err && use_float) {
+	/* sgemm does its own threading */
+	for (i=0; i<n && !*err; i++) {
+	    *err = gretl_matrix_multiply_mod_float(batch_elem(A, i), GRETL_MOD_NONE,
+						   batch_elem(B, i), GRETL_MOD_NONE,
+						   C->data[i], GRETL_MOD_NONE);
+	}
+    } else if (!*err) {
+#if defined(_OPENMP)
+	guint64 fpm = (guint64) n * ar * ac * bc;
+#pragma omp parallel for private(i) if (gretl_use_openmp(fpm))
+#endif
+	for (i=0; i<n; i++) {
+	    gretl_matrix_multiply_mod_single(batch_elem(A, i), GRETL_MOD_NONE,
+					     batch_elem(B, i), GRETL_MOD_NONE,
+					     C->data[i], GRETL_MOD_NONE);
+	}
+    }
+
+    if (*err && C != NULL) {
+	gretl_array_destroy(C);
+	C = NULL;
+    }
+
+    return C;
+}
+
+/**
+ * gretl_matrix_array_cholesky:
+ * @A: array of symmetric positive definite matrices.
+ * @err: location to receive error code.
+ *
+ * Returns: a new array holding the lower-triangular Cholesky
+ * factors of the members of @A, or NULL on failure.
+ */
+
+gretl_array *gretl_matrix_array_cholesky (gretl_array *A, int *err)
+{
+    gretl_array *L = NULL;
+    int r, c, i;
+
+    *err = matrix_array_common_dims(A, &r, &c);
+    if (!*err && r != c) {
+	*err = E_NONCONF;
+    }
+    if (!*err) {
+	L = gretl_matrix_array_sized(A->n, r, r, err);
+    }
+
+    if (!*err) {
+	int ierr = 0;
+#if defined(_OPENMP)
+	guint64 fpm = (guint64) A->n * r * r * r;
+#pragma omp parallel for private(i) if (gretl_use_openmp(fpm))
+#endif
+	for (i=0; i<A->n; i++) {
+	    gretl_matrix *Li = L->data[i];
+	    int myerr;
+
+	    if (ierr) {
+		continue;
+	    }
+	    gretl_matrix_copy_values(Li, A->data[i]);
+	    myerr = gretl_matrix_cholesky_decomp(Li);
+	    if (myerr) {
+#if defined(_OPENMP)
+#pragma omp atomic write
+#endif
+		ierr = myerr;
+	    }
+	}
+	*err = ierr;
+    }
+
+    if (*err && L != NULL) {
+	gretl_array_destroy(L);
+	L = NULL;
+    }
+
+    return L;
+}
+
+/**
+ * gretl_matrix_array_solve:
+ * @A: array of square matrices.
+ * @B: array of matrices.
+ * @err: location to receive error code.
+ *
+ * Solves the systems A[i] X[i] = B[i] via LU decomposition.
+ *
+ * Returns: a new array holding the solutions X[i], or NULL
+ * on failure.
+ */
+
+gretl_array *gretl_matrix_array_solve (gretl_array *A,
+				       gretl_array *B,
+				       int *err)
+{
+    gretl_array *X = NULL;
+    int ar, ac, br, bc;
+    int i, n;
+
+    *err = matrix_array_common_dims(A, &ar, &ac);
+    if (!*err) {
+	*err = matrix_array_common_dims(B, &br, &bc);
+    }
+    if (!*err && ar != ac) {
+	*err = E_NONCONF;
+    } else if (!*err && br != ar) {
+	*err = E_NONCONF;
+    }
+    if (!*err) {
+	n = batch_length(A, B, err);
+    }
+    if (!*err) {
+	X = gretl_matrix_array_sized(n, br, bc, err);
+    }
+
+    if (!*err) {
+	int ierr = 0;
+#if defined(_OPENMP)
+	guint64 fpm = (guint64) n * ar * ar * (ar + bc);
+#pragma omp parallel for private(i) if (gretl_use_openmp(fpm))
+#endif
+	for (i=0; i<n; i++) {
+	    gretl_matrix *Ai;
+	    int myerr;
+
+	    if (ierr) {
+		continue;
+	    }
+	    /* the LU decomposition overwrites its input */
+	    Ai = gretl_matrix_copy(batch_elem(A, i));
+	    if (Ai == NULL) {
+		myerr = E_ALLOC;
+	    } else {
+		gretl_matrix_copy_values(X->data[i], batch_elem(B, i));
+		myerr = gretl_LU_solve(Ai, X->data[i]);
+		gretl_matrix_free(Ai);
+	    }
+	    if (myerr) {
+#if defined(_OPENMP)
+#pragma omp atomic write
+#endif
+		ierr = myerr;
+	    }
+	}
+	*err = ierr;
+    }
+
+    if (*err && X != NULL) {
+	gretl_array_destroy(X);
+	X = NULL;
+    }
+
+    return X;
+}
+
 /* When we're returning an array of strings, ensure
    that any NULL elements are converted to empty
    strings.
@@ -1982,6 +2233,10 @@ int gretl_array_copy_as (const char *name, const char *copyname,
     /* is there a pre-existing array named @copyname? */
     u = get_user_var_of_type_by_name(copyname, GRETL_TYPE_ARRAY);
     if (u != NULL) {
+	err = user_var_unshare(u);
+	if (err) {
+	    return err;
+	}
 	A1 = user_var_get_value(u);
     }
 
@@ -2010,6 +2265,10 @@ int gretl_array_copy_as (const char *name, const char *copyname,
  * get_array_by_name:
  * @name: the name to look up.
  *
+ * Note that an array function argument that is sharing its
+ * data with the calling function is first given its own copy,
+ * since the caller may modify the array.
+ *
  * Returns: pointer to a saved array, if found, else NULL.
  */
 
@@ -2021,7 +2280,7 @@ gretl_array *get_array_by_name (const char *name)
 	user_var *u =
 	    get_user_var_of_type_by_name(name, GRETL_TYPE_ARRAY);
 
-	if (u != NULL) {
+	if (u != NULL && user_var_unshare(u) == 0) {
 	    a = user_var_get_value(u);
 	}
     }
@@ -36,6 +36,17 @@ gretl_array *gretl_array_from_strings (char **S, int n,
 gretl_array *gretl_matrix_array_sized (int n, int r, int c,
 				       int *err);
 
+gretl_array *gretl_matrix_array_multiply (gretl_array *A,
+					  gretl_array *B,
+					  int use_float,
+					  int *err);
+
+gretl_array *gretl_matrix_array_cholesky (gretl_array *A, int *err);
+
+gretl_array *gretl_matrix_array_solve (gretl_array *A,
+				       gretl_array *B,
+				       int *err);
+
 gretl_array *gretl_singleton_array (void *ptr, GretlType atype,
 				    int copy, int *err);
 
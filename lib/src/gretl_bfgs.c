@@ -26,6 +26,8 @@
 #include "usermat.h"
 #include "uservar.h"
 #include "gretl_func.h"
+#include "gretl_mt.h"
+#include "gretl_task.h"
 
 #include "../../minpack/minpack.h"
 #include <float.h>
@@ -284,33 +286,55 @@ static double uhess_callback (const double *b, void *data)
     return ret;
 }
 
-/* apparatus for constructing numerical approximation to
-   the Hessian */
+static int numgrad_status;
 
-static void hess_h_init (double *h, double *h0, int n)
+int numgrad_in_progress (void)
 {
-    memcpy(h, h0, n * sizeof *h);
+    return numgrad_status;
 }
 
-static void hess_h_reduce (double *h, double v, int n)
+static void set_numgrad_status (int s)
 {
-    int i;
-
-    for (i=0; i<n; i++) {
-        h[i] /= v;
-    }
+    numgrad_status = s;
 }
 
-static int numgrad_status;
+/* A criterion function that can be called concurrently, and the
+   rough cost of one call to it: see numgrad_set_reentrant() */
+static BFGS_CRIT_FUNC mt_crit;
+static guint64 mt_crit_cost;
 
-int numgrad_in_progress (void)
+/**
+ * numgrad_set_reentrant:
+ * @func: criterion function, or %NULL.
+ * @cost: rough count of floating-point operations per call
+ * to @func.
+ *
+ * Declares that @func may be called concurrently from several
+ * threads with the same data pointer, provided that each call gets
+ * its own parameter array. Numerical gradients and Hessians of
+ * @func can then be computed by evaluating the criterion at the
+ * perturbed parameter vectors in parallel. The caller should
+ * cancel the declaration, by passing %NULL, once it's done with
+ * @func.
+ */
+
+void numgrad_set_reentrant (BFGS_CRIT_FUNC func, guint64 cost)
 {
-    return numgrad_status;
+    mt_crit = func;
+    mt_crit_cost = (func == NULL)? 0 : cost;
 }
 
-static void set_numgrad_status (int s)
+/* Should the @nf evaluations of @func needed for a numerical
+   derivative be shared among threads? */
+
+static int numgrad_parallel (BFGS_CRIT_FUNC func, int nf)
 {
-    numgrad_status = s;
+#if defined(_OPENMP)
+    return func != NULL && func == mt_crit &&
+        gretl_use_openmp(mt_crit_cost * nf);
+#else
+    return 0;
+#endif
 }
 
 /* number of Richardson steps */
@@ -322,6 +346,224 @@ static void set_numgrad_status (int s)
 */
 #define numhess_d 0.01
 
+/* smallest @d for numerical_hessian, when retrying after NAs */
+#define HESS_DSMALL 0.0001
+
+/* Richardson extrapolation of the @r estimates in @x, in place:
+   the result is in x[0] */
+
+static void richardson_extrap (double *x, int r)
+{
+    double p4m = 4.0;
+    int k, m;
+
+    for (m=0; m<r-1; m++) {
+        for (k=0; k<r-m-1; k++) {
+            x[k] = (x[k+1] * p4m - x[k]) / (p4m - 1);
+        }
+        p4m *= 4.0;
+    }
+}
+
+/* First derivative and diagonal second derivative with respect to
+   element @i of @b, for numerical_hessian(); @b is restored on
+   exit. The initial step is h0[i], reduced by a factor of @v at
+   each of the Richardson steps.
+*/
+
+static int hess_diag_term (double *b, int i, const double *h0,
+                           double v, double f0, BFGS_CRIT_FUNC func,
+                           void *data, double d, double *Di,
+                           double *Hi)
+{
+    double Dx[RSTEPS];
+    double Hx[RSTEPS];
+    double bi0 = b[i];
+    double hi = h0[i];
+    double f1, f2;
+    int k;
+
+    for (k=0; k<RSTEPS; k++) {
+        b[i] = bi0 + hi;
+        f1 = func(b, data);
+        if (!na(f1)) {
+            b[i] = bi0 - hi;
+            f2 = func(b, data);
+        }
+        if (na(f1) || na(f2)) {
+            if (d <= HESS_DSMALL) {
+                fprintf(stderr, "numerical_hessian: 1st derivative: "
+                        "criterion=NA for theta[%d] = %g (d=%g)\n", i, b[i], d);
+            }
+            b[i] = bi0;
+            return E_NAN;
+        }
+        /* F'(i) */
+        Dx[k] = (f1 - f2) / (2 * hi);
+        /* F''(i) */
+        Hx[k] = (f1 - 2*f0 + f2) / (hi * hi);
+        hi /= v;
+    }
+
+    b[i] = bi0;
+    richardson_extrap(Dx, RSTEPS);
+    richardson_extrap(Hx, RSTEPS);
+    *Di = Dx[0];
+    *Hi = Hx[0];
+
+    return 0;
+}
+
+/* Cross-partial with respect to elements @i and @j of @b, given
+   the diagonal terms in @Hd; @b is restored on exit */
+
+static int hess_cross_term (double *b, int i, int j, const double *h0,
+                            double v, double f0, const double *Hd,
+                            BFGS_CRIT_FUNC func, void *data, double d,
+                            double *Dij)
+{
+    double Dx[RSTEPS];
+    double bi0 = b[i];
+    double bj0 = b[j];
+    double hi = h0[i];
+    double hj = h0[j];
+    double f1, f2;
+    int k;
+
+    for (k=0; k<RSTEPS; k++) {
+        b[i] = bi0 + hi;
+        b[j] = bj0 + hj;
+        f1 = func(b, data);
+        if (!na(f1)) {
+            b[i] = bi0 - hi;
+            b[j] = bj0 - hj;
+            f2 = func(b, data);
+        }
+        if (na(f1) || na(f2)) {
+            if (d <= HESS_DSMALL) {
+                fprintf(stderr, "numerical_hessian: 2nd derivatives (%d,%d): "
+                        "objective function gave NA\n", i, j);
+            }
+            b[i] = bi0;
+            b[j] = bj0;
+            return E_NAN;
+        }
+        /* cross-partial */
+        Dx[k] = (f1 - 2*f0 + f2 - Hd[i]*hi*hi
+                 - Hd[j]*hj*hj) / (2*hi*hj);
+        hi /= v;
+        hj /= v;
+    }
+
+    b[i] = bi0;
+    b[j] = bj0;
+    richardson_extrap(Dx, RSTEPS);
+    *Dij = Dx[0];
+
+    return 0;
+}
+
+/* Sequential version of the derivative loops in
+   numerical_hessian(): first derivatives and the diagonal of the
+   Hessian go into @D and @Hd, then the lower triangle of the
+   Hessian goes into @D, following the first @n elements.
+*/
+
+static int numhess_seq (double *b, int n, const double *h0,
+                        double v, double f0, double *D, double *Hd,
+                        BFGS_CRIT_FUNC func, void *data, double d)
+{
+    int i, j, u = n;
+    int err = 0;
+
+    for (i=0; i<n && !err; i++) {
+        err = hess_diag_term(b, i, h0, v, f0, func, data, d,
+                             &D[i], &Hd[i]);
+    }
+
+    for (i=0; i<n && !err; i++) {
+        for (j=0; j<=i && !err; j++) {
+            if (i == j) {
+                D[u] = Hd[i];
+            } else {
+                err = hess_cross_term(b, i, j, h0, v, f0, Hd,
+                                      func, data, d, &D[u]);
+            }
+            u++;
+        }
+    }
+
+    return err;
+}
+
+#if defined(_OPENMP)
+
+/* Parallel version of the derivative loops in numerical_hessian(),
+   for a criterion that has been declared reentrant: each thread
+   perturbs its own copy of @b.
+*/
+
+static int numhess_mt (double *b, int n, const double *h0,
+                       double v, double f0, double *D, double *Hd,
+                       BFGS_CRIT_FUNC func, void *data, double d)
+{
+    int err = 0;
+
+#pragma omp parallel
+    {
+        double *bt = malloc(n * sizeof *bt);
+        int i, j, u, terr = 0;
+
+        if (bt == NULL) {
+            terr = E_ALLOC;
+        } else {
+            memcpy(bt, b, n * sizeof *bt);
+        }
+
+        /* first derivatives and Hessian diagonal */
+#pragma omp for
+        for (i=0; i<n; i++) {
+            if (!terr) {
+                terr = hess_diag_term(bt, i, h0, v, f0, func, data, d,
+                                      &D[i], &Hd[i]);
+            }
+        }
+
+        /* make sure Hd is complete, and that no thread goes on
+           after an error */
+        if (terr) {
+#pragma omp critical
+            err = terr;
+        }
+#pragma omp barrier
+
+        /* second derivatives: lower half of Hessian only */
+#pragma omp for schedule(dynamic)
+        for (i=0; i<n; i++) {
+            u = n + i * (i + 1) / 2;
+            for (j=0; j<=i && !err && !terr; j++) {
+                if (i == j) {
+                    D[u+j] = Hd[i];
+                } else {
+                    terr = hess_cross_term(bt, i, j, h0, v, f0, Hd,
+                                           func, data, d, &D[u+j]);
+                }
+            }
+        }
+
+        if (terr) {
+#pragma omp critical
+            err = terr;
+        }
+
+        free(bt);
+    }
+
+    return err;
+}
+
+#endif
+
 /* The algorithm below implements the method of Richardson
    Extrapolation.  It is derived from code in the gnu R package
    "numDeriv" by Paul Gilbert, which was in turn derived from code
@@ -335,35 +577,28 @@ int numerical_hessian (double *b, gretl_matrix *H,
                        BFGS_CRIT_FUNC func, void *data,
                        int neg, double d)
 {
-    double Dx[RSTEPS];
-    double Hx[RSTEPS];
     double *wspace;
-    double *h0, *h, *Hd, *D;
-    int r = RSTEPS;
-    double dsmall = 0.0001;
+    double *h0, *Hd, *D;
     double ztol, eps = 1e-4;
     double v = 2.0;    /* reduction factor for h */
-    double f0, f1, f2;
-    double p4m, hij;
-    double bi0, bj0;
+    double f0, hij;
     int n = gretl_matrix_rows(H);
     int vn = (n * (n + 1)) / 2;
     int dn = vn + n;
-    int i, j, k, m, u;
+    int i, j, u;
     int err = 0;
 
     if (d == 0.0) {
         d = numhess_d;
     }
 
-    wspace = malloc((3 * n + dn) * sizeof *wspace);
+    wspace = malloc((2 * n + dn) * sizeof *wspace);
     if (wspace == NULL) {
         return E_ALLOC;
     }
 
     h0 = wspace;
-    h = h0 + n;
-    Hd = h + n;
+    Hd = h0 + n;
     D = Hd + n; /* D is of length dn */
 
 #if 0
@@ -396,113 +631,17 @@ int numerical_hessian (double *b, gretl_matrix *H,
 
     f0 = func(b, data);
 
-    /* first derivatives and Hessian diagonal */
-
-    for (i=0; i<n; i++) {
-        bi0 = b[i];
-        hess_h_init(h, h0, n);
-        for (k=0; k<r; k++) {
-            b[i] = bi0 + h[i];
-            f1 = func(b, data);
-            if (na(f1)) {
-                if (d <= dsmall) {
-                    fprintf(stderr, "numerical_hessian: 1st derivative: "
-                            "criterion=NA for theta[%d] = %g (d=%g)\n", i, b[i], d);
-                }
-                b[i] = bi0;
-                err = E_NAN;
-                goto end_first_try;
-            }
-            b[i] = bi0 - h[i];
-            f2 = func(b, data);
-            if (na(f2)) {
-                if (d <= dsmall) {
-                    fprintf(stderr, "numerical_hessian: 1st derivative: "
-                            "criterion=NA for theta[%d] = %g (d=%g)\n", i, b[i], d);
-                }
-                b[i] = bi0;
-                err = E_NAN;
-                goto end_first_try;
-            }
-            /* F'(i) */
-            Dx[k] = (f1 - f2) / (2 * h[i]);
-            /* F''(i) */
-            Hx[k] = (f1 - 2*f0 + f2) / (h[i] * h[i]);
-            hess_h_reduce(h, v, n);
-        }
-        b[i] = bi0;
-        p4m = 4.0;
-        for (m=0; m<r-1; m++) {
-            for (k=0; k<r-m-1; k++) {
-                Dx[k] = (Dx[k+1] * p4m - Dx[k]) / (p4m - 1);
-                Hx[k] = (Hx[k+1] * p4m - Hx[k]) / (p4m - 1);
-            }
-            p4m *= 4.0;
-        }
-        D[i] = Dx[0];
-        Hd[i] = Hx[0];
-    }
-
-    /* second derivatives: lower half of Hessian only */
-
-    u = n;
-    for (i=0; i<n; i++) {
-        bi0 = b[i];
-        for (j=0; j<=i; j++) {
-            if (i == j) {
-                D[u] = Hd[i];
-            } else {
-                hess_h_init(h, h0, n);
-                bj0 = b[j];
-                for (k=0; k<r; k++) {
-                    b[i] = bi0 + h[i];
-                    b[j] = bj0 + h[j];
-                    f1 = func(b, data);
-                    if (na(f1)) {
-                        if (d <= dsmall) {
-                            fprintf(stderr, "numerical_hessian: 2nd derivatives (%d,%d): "
-                                    "objective function gave NA\n", i, j);
-                        }
-                        b[i] = bi0;
-                        b[j] = bj0;
-                        err = E_NAN;
-                        goto end_first_try;
-                    }
-                    b[i] = bi0 - h[i];
-                    b[j] = bj0 - h[j];
-                    f2 = func(b, data);
-                    if (na(f2)) {
-                        if (d <= dsmall) {
-                            fprintf(stderr, "numerical_hessian: 2nd derivatives (%d,%d): "
-                                    "objective function gave NA\n", i, j);
-                        }
-                        b[i] = bi0;
-                        b[j] = bj0;
-                        err = E_NAN;
-                        goto end_first_try;
-                    }
-                    /* cross-partial */
-                    Dx[k] = (f1 - 2*f0 + f2 - Hd[i]*h[i]*h[i]
-                             - Hd[j]*h[j]*h[j]) / (2*h[i]*h[j]);
-                    hess_h_reduce(h, v, n);
-                }
-                p4m = 4.0;
-                for (m=0; m<r-1; m++) {
-                    for (k=0; k<r-m-1; k++) {
-                        Dx[k] = (Dx[k+1] * p4m - Dx[k]) / (p4m - 1);
-                    }
-                    p4m *= 4.0;
-                }
-                D[u] = Dx[0];
-                b[j] = bj0;
-            }
-            u++;
-        }
-        b[i] = bi0;
+#if defined(_OPENMP)
+    if (numgrad_parallel(func, 2 * RSTEPS * vn)) {
+        err = numhess_mt(b, n, h0, v, f0, D, Hd, func, data, d);
+    } else {
+        err = numhess_seq(b, n, h0, v, f0, D, Hd, func, data, d);
     }
+#else
+    err = numhess_seq(b, n, h0, v, f0, D, Hd, func, data, d);
+#endif
 
- end_first_try:
-    if (err == E_NAN && d > dsmall) {
+    if (err == E_NAN && d > HESS_DSMALL) {
         err = 0;
         gretl_error_clear();
         d /= 10;
@@ -721,44 +860,125 @@ gretl_matrix *numerical_score_matrix (double *b, int T, int k,
     return G;
 }
 
-static int richardson_gradient (double *b, double *g, int n,
-                                BFGS_CRIT_FUNC func, void *data)
+/* Derivative of @func with respect to element @i of @b, by
+   Richardson extrapolation; @b is restored on exit */
+
+static int richardson_deriv (double *b, int i, double *gi,
+                             BFGS_CRIT_FUNC func, void *data)
 {
     double df[RSTEPS];
     double eps = 1.0e-4;
     double d = 0.0001;
-    double h, p4m;
-    double bi0, f1, f2;
-    int r = RSTEPS;
-    int i, k, m;
+    double bi0 = b[i];
+    double h, f1, f2;
+    int k;
 
-    for (i=0; i<n; i++) {
-        bi0 = b[i];
-        h = fabs(d * b[i]) + eps * (floateq(b[i], 0.0));
-        for (k=0; k<r; k++) {
-            b[i] = bi0 - h;
-            f1 = func(b, data);
-            b[i] = bi0 + h;
-            f2 = func(b, data);
-            if (na(f1) || na(f2)) {
-                b[i] = bi0;
-                return 1;
-            }
-            df[k] = (f2 - f1) / (2 * h);
-            h /= 2.0;
+    h = fabs(d * b[i]) + eps * (floateq(b[i], 0.0));
+    for (k=0; k<RSTEPS; k++) {
+        b[i] = bi0 - h;
+        f1 = func(b, data);
+        b[i] = bi0 + h;
+        f2 = func(b, data);
+        if (na(f1) || na(f2)) {
+            b[i] = bi0;
+            return 1;
         }
-        b[i] = bi0;
-        p4m = 4.0;
-        for (m=0; m<r-1; m++) {
-            for (k=0; k<r-m-1; k++) {
-                df[k] = (df[k+1] * p4m - df[k]) / (p4m - 1.0);
+        df[k] = (f2 - f1) / (2 * h);
+        h /= 2.0;
+    }
+    b[i] = bi0;
+    richardson_extrap(df, RSTEPS);
+    *gi = df[0];
+
+    return 0;
+}
+
+/* Simple two-sided derivative of @func with respect to element
+   @i of @b; @b is restored on exit */
+
+static int simple_deriv (double *b, int i, double *gi,
+                         BFGS_CRIT_FUNC func, void *data)
+{
+    const double h = 1.0e-8;
+    double bi0 = b[i];
+    double f1, f2;
+
+    b[i] = bi0 - h;
+    f1 = func(b, data);
+    b[i] = bi0 + h;
+    f2 = func(b, data);
+    b[i] = bi0;
+    if (na(f1) || na(f2)) {
+        return 1;
+    }
+    *gi = (f2 - f1) / (2.0 * h);
+#if BFGS_DEBUG > 1
+    fprintf(stderr, "g[%d] = (%.16g - %.16g) / (2.0 * %g) = %g\n",
+            i, f2, f1, h, *gi);
+#endif
+
+    return 0;
+}
+
+typedef int (*DERIV_FUNC) (double *, int, double *,
+                           BFGS_CRIT_FUNC, void *);
+
+#if defined(_OPENMP)
+
+/* Parallel gradient for a criterion that has been declared
+   reentrant: each thread perturbs its own copy of @b.
+*/
+
+static int gradient_mt (double *b, double *g, int n,
+                        DERIV_FUNC dfunc, BFGS_CRIT_FUNC func,
+                        void *data)
+{
+    int err = 0;
+
+#pragma omp parallel
+    {
+        double *bt = malloc(n * sizeof *bt);
+        int i, terr = 0;
+
+        if (bt == NULL) {
+            terr = E_ALLOC;
+        } else {
+            memcpy(bt, b, n * sizeof *bt);
+        }
+#pragma omp for
+        for (i=0; i<n; i++) {
+            if (!terr) {
+                terr = dfunc(bt, i, &g[i], func, data);
             }
-            p4m *= 4.0;
         }
-        g[i] = df[0];
+        if (terr) {
+#pragma omp critical
+            err = terr;
+        }
+        free(bt);
     }
 
-    return 0;
+    return err;
+}
+
+#endif
+
+static int richardson_gradient (double *b, double *g, int n,
+                                BFGS_CRIT_FUNC func, void *data)
+{
+    int i, err = 0;
+
+#if defined(_OPENMP)
+    if (numgrad_parallel(func, 2 * RSTEPS * n)) {
+        return gradient_mt(b, g, n, richardson_deriv, func, data);
+    }
+#endif
+
+    for (i=0; i<n && !err; i++) {
+        err = richardson_deriv(b, i, &g[i], func, data);
+    }
+
+    return err;
 }
 
 /* trigger for switch to Richardson gradient */
@@ -769,32 +989,31 @@ static int simple_gradient (double *b, double *g, int n,
                             int *redo)
 {
     const double h = 1.0e-8;
-    double bi0, f1, f2;
-    int i;
+    double bi0;
+    int i, err = 0;
 
+    /* check first whether the step is too small relative to
+       any of the parameters */
     for (i=0; i<n; i++) {
         bi0 = b[i];
-        b[i] = bi0 - h;
-        if (bi0 != 0.0 && fabs((bi0 - b[i]) / bi0) < B_RELMIN) {
+        if (bi0 != 0.0 && fabs((bi0 - (bi0 - h)) / bi0) < B_RELMIN) {
             fprintf(stderr, "numerical gradient: switching to Richardson\n");
             *redo = 1;
             return 0;
         }
-        f1 = func(b, data);
-        b[i] = bi0 + h;
-        f2 = func(b, data);
-        b[i] = bi0;
-        if (na(f1) || na(f2)) {
-            return 1;
-        }
-        g[i] = (f2 - f1) / (2.0 * h);
-#if BFGS_DEBUG > 1
-        fprintf(stderr, "g[%d] = (%.16g - %.16g) / (2.0 * %g) = %g\n",
-                i, f2, f1, h, g[i]);
+    }
+
+#if defined(_OPENMP)
+    if (numgrad_parallel(func, 2 * n)) {
+        return gradient_mt(b, g, n, simple_deriv, func, data);
+    }
 #endif
+
+    for (i=0; i<n && !err; i++) {
+        err = simple_deriv(b, i, &g[i], func, data);
     }
 
-    return 0;
+    return err;
 }
 
 /* default numerical calculation of gradient in context of BFGS */
@@ -1038,6 +1257,71 @@ static double simple_slen (int n, int *pndelta, double *b, double *X, double *t,
 
 #define GRADCHECK 0 /* 2023-10-30: for testing */
 
+/* Support for warm-starting BFGS (the "bfgs_warm" set variable,
+   off by default). At the end of a successful outermost BFGS run
+   we save the parameter vector and the inverse Hessian
+   approximation; the next run with the same number of parameters
+   and the same type of criterion starts from that curvature
+   matrix, and from the saved parameters if they give a better
+   criterion value than the caller's starting point. This helps
+   when a model is re-estimated many times on slightly different
+   data, as in rolling windows or bootstrap loops.
+*/
+
+static struct {
+    int n;
+    int crittype;
+    gretl_matrix *b;
+    gretl_matrix *H;
+} bfgs_warm;
+
+static void bfgs_warm_clear (void)
+{
+    gretl_matrix_free(bfgs_warm.b);
+    gretl_matrix_free(bfgs_warm.H);
+    bfgs_warm.b = bfgs_warm.H = NULL;
+    bfgs_warm.n = 0;
+}
+
+static int bfgs_warm_active (void)
+{
+    if (!libset_get_bool(BFGS_WARM)) {
+        if (bfgs_warm.n > 0) {
+            bfgs_warm_clear();
+        }
+        return 0;
+    }
+
+    /* don't get mixed up with nested optimization */
+    return gretl_iteration_depth() == 1;
+}
+
+static void bfgs_warm_save (const double *b, double **H,
+                            int n, int crittype)
+{
+    int i, j;
+
+    if (bfgs_warm.n != n) {
+        bfgs_warm_clear();
+        bfgs_warm.b = gretl_column_vector_alloc(n);
+        bfgs_warm.H = gretl_matrix_alloc(n, n);
+        if (bfgs_warm.b == NULL || bfgs_warm.H == NULL) {
+            bfgs_warm_clear();
+            return;
+        }
+        bfgs_warm.n = n;
+    }
+
+    bfgs_warm.crittype = crittype;
+    for (i=0; i<n; i++) {
+        bfgs_warm.b->val[i] = b[i];
+        for (j=0; j<=i; j++) {
+            gretl_matrix_set(bfgs_warm.H, i, j, H[i][j]);
+            gretl_matrix_set(bfgs_warm.H, j, i, H[i][j]);
+        }
+    }
+}
+
 static int BFGS_orig (double *b, int n, int maxit, double reltol,
                       int *fncount, int *grcount, BFGS_CRIT_FUNC cfunc,
                       int crittype, BFGS_GRAD_FUNC gradfunc, void *data,
@@ -1057,9 +1341,11 @@ static int BFGS_orig (double *b, int n, int maxit, double reltol,
     double fmax, f, f0, s, steplen = 0.0;
     double fdiff, D1, D2;
     int i, j, ilast, iter, done = 0;
+    int warm, usewarm = 0;
     int err = 0;
 
     optim_get_user_values(b, n, &maxit, &reltol, &gradmax, opt, prn);
+    warm = bfgs_warm_active();
 
     wspace = malloc(4 * n * sizeof *wspace);
     H = triangular_array_new(n);
@@ -1075,6 +1361,10 @@ static int BFGS_orig (double *b, int n, int maxit, double reltol,
     /* initialize curvature matrix */
     if (A0 != NULL) {
         err = copy_initial_hessian(H, A0, n);
+    } else if (warm && bfgs_warm.n == n && bfgs_warm.crittype == crittype &&
+               n_initcurv() == 0) {
+        err = copy_initial_hessian(H, bfgs_warm.H, n);
+        usewarm = 1;
     } else {
         gretl_matrix *A1 = get_initcurv();
 
@@ -1091,9 +1381,24 @@ static int BFGS_orig (double *b, int n, int maxit, double reltol,
     c = X + n;
 
     f = optim_fncall(cfunc, b, data, minimize);
+    fcount = 1;
 
-    if (na(f)) {
-        gretl_errmsg_set(_("BFGS: initial value of objective function is not finite"));
+    if (usewarm) {
+        double fw = optim_fncall(cfunc, bfgs_warm.b->val, data, minimize);
+
+        fcount++;
+        if (!na(fw) && (na(f) || fw > f)) {
+            memcpy(b, bfgs_warm.b->val, n * sizeof *b);
+            f = fw;
+        } else {
+            /* leave the caller's state consistent with @b */
+            f = optim_fncall(cfunc, b, data, minimize);
+            fcount++;
+        }
+    }
+
+    if (na(f)) {
+        gretl_errmsg_set(_("BFGS: initial value of objective function is not finite"));
         err = E_NAN;
         goto bailout;
     }
@@ -1103,7 +1408,7 @@ static int BFGS_orig (double *b, int n, int maxit, double reltol,
 #endif
 
     f0 = fmax = f;
-    iter = ilast = fcount = gcount = 1;
+    iter = ilast = gcount = 1;
     optim_gradcall(gradfunc, b, g, n, cfunc, data, minimize);
 
 #if BFGS_DEBUG > 1
@@ -1128,7 +1433,7 @@ static int BFGS_orig (double *b, int n, int maxit, double reltol,
         if (bfgs_print_iter(verbose, verbskip, iter)) {
             print_iter_info(iter, f, crittype, n, b, g, steplen, prn);
         }
-        if (show_activity && (iter % 10 == 0)) {
+        if (show_activity) {
             show_activity_callback();
         }
 
@@ -1334,6 +1639,10 @@ static int BFGS_orig (double *b, int n, int maxit, double reltol,
         /* pputc(prn, '\n'); */
     }
 
+    if (warm && !err) {
+        bfgs_warm_save(b, H, n, crittype);
+    }
+
  bailout:
 
     free(wspace);
@@ -1494,11 +1803,13 @@ int LBFGS_max (double *b, int n,
             goto bailout;
         }
     } else {
-        /* By default we just set all parameters to be
-           less than some ridiculously large number */
+        /* By default all parameters are unbounded: in that case
+           L-BFGS-B skips the generalized Cauchy point search and
+           the sorting of breakpoints, which matters for a large
+           number of parameters.
+        */
         for (i=0; i<n; i++) {
-            nbd[i] = 3; /* case 3: upper bound only */
-            u[i] = DBL_MAX / 100;
+            nbd[i] = 0;
         }
     }
 
@@ -1566,7 +1877,7 @@ int LBFGS_max (double *b, int n,
             ibak = iter;
         }
 
-        if (show_activity && (iter % 10 == 0)) {
+        if (show_activity) {
             show_activity_callback();
         }
     }
@@ -1625,7 +1936,10 @@ int LBFGS_max (double *b, int n,
  * gretl by Allin Cottrell and Jack Lucchetti). Alternatively,
  * if OPT_L is given, uses the L-BFGS-B method (limited memory
  * BFGS), based on Lbfgsb.3.0 by Ciyou Zhu, Richard Byrd, Jorge
- * Nocedal and Jose Luis Morales.
+ * Nocedal and Jose Luis Morales. L-BFGS-B is also used if @n
+ * exceeds %BFGS_DENSE_MAX and @A0 is %NULL, since the dense
+ * approximation to the inverse Hessian would then be too costly
+ * to store and update.
  *
  * Returns: 0 on successful completion, non-zero error code
  * on error.
@@ -1640,7 +1954,8 @@ int BFGS_max (double *b, int n, int maxit, double reltol,
 
     gretl_iteration_push();
 
-    if ((opt & OPT_L) || libset_get_bool(USE_LBFGS)) {
+    if ((opt & OPT_L) || libset_get_bool(USE_LBFGS) ||
+        (n > BFGS_DENSE_MAX && A0 == NULL)) {
         ret = LBFGS_max(b, n, maxit, reltol,
                         fncount, grcount, cfunc,
                         crittype, gradfunc, NULL, data,
@@ -1875,6 +2190,67 @@ static int user_get_gradient (double *b, double *g, int k,
     return err;
 }
 
+/* user-defined optimizer: get the gradient by automatic
+   differentiation of the criterion */
+
+static int user_get_ad_gradient (double *b, double *g, int k,
+                                 BFGS_CRIT_FUNC func, void *p)
+{
+    umax *u = (umax *) p;
+    int i, err = 0;
+
+    for (i=0; i<k; i++) {
+        u->b->val[i] = b[i];
+    }
+
+    genr_autodiff(u->gf, u->b, g, &err);
+
+    for (i=0; i<k && !err; i++) {
+        if (!isfinite(g[i])) {
+            err = E_NAN;
+        }
+    }
+
+    return err;
+}
+
+/* If no gradient function was given, see if we can differentiate
+   the criterion automatically: this requires that the AD value of
+   the criterion at the initial parameters matches the one obtained
+   by regular evaluation. If so, return the gradient callback.
+*/
+
+static BFGS_GRAD_FUNC user_gradient_func (umax *u)
+{
+    BFGS_GRAD_FUNC ret = NULL;
+    double x0, x1, *g;
+    int err = 0;
+
+    if (u->gg != NULL) {
+        return user_get_gradient;
+    } else if (u->gentype != GRETL_TYPE_DOUBLE ||
+               !libset_get_bool(USE_AUTODIFF)) {
+        return NULL;
+    }
+
+    g = malloc(u->ncoeff * sizeof *g);
+    if (g == NULL) {
+        return NULL;
+    }
+
+    x0 = user_get_criterion(u->b->val, u);
+    if (!na(x0)) {
+        x1 = genr_autodiff(u->gf, u->b, g, &err);
+        if (!err && fabs(x1 - x0) <= 1.0e-10 * (1 + fabs(x0))) {
+            ret = user_get_ad_gradient;
+        }
+    }
+
+    free(g);
+
+    return ret;
+}
+
 /* user-defined optimizer: get the hessian, if specified */
 
 static int user_get_hessian (double *b, gretl_matrix *H,
@@ -2061,6 +2437,7 @@ double user_BFGS (gretl_matrix *b,
                   int *err)
 {
     umax *u;
+    BFGS_GRAD_FUNC gradfunc;
     gretlopt opt = OPT_NONE;
     int maxit = BFGS_MAXITER_DEFAULT;
     int verbose, fcount = 0, gcount = 0;
@@ -2098,18 +2475,18 @@ double user_BFGS (gretl_matrix *b,
         opt |= OPT_I;
     }
 
+    gradfunc = user_gradient_func(u);
+
     if (bounds != NULL) {
         *err = BFGS_cmax(b->val, u->ncoeff,
                          maxit, tol, &fcount, &gcount,
                          user_get_criterion, C_OTHER,
-                         (u->gg == NULL)? NULL : user_get_gradient,
-                         u, bounds, opt, prn);
+                         gradfunc, u, bounds, opt, prn);
     } else {
         *err = BFGS_max(b->val, u->ncoeff,
                         maxit, tol, &fcount, &gcount,
                         user_get_criterion, C_OTHER,
-                        (u->gg == NULL)? NULL : user_get_gradient,
-                        u, NULL, opt, prn);
+                        gradfunc, u, NULL, opt, prn);
     }
 
     if (fcount > 0 && (verbose || !gretl_looping())) {
@@ -2178,7 +2555,7 @@ double user_NR (gretl_matrix *b,
                               crittol, gradtol,
                               &iters, C_OTHER,
                               user_get_criterion,
-                              (u->gg == NULL)? NULL : user_get_gradient,
+                              user_gradient_func(u),
                               (u->gh == NULL)? NULL : user_get_hessian,
                               u, opt, prn);
 
@@ -2272,6 +2649,521 @@ double deriv_free_optimize (MaxMethod method,
     return ret;
 }
 
+/* Multi-start optimization: a local maximizer (BFGS or Newton) is
+   run from each of a set of starting points, namely the incoming
+   parameter vector plus Sobol points within a user-specified box.
+   The local runs are farmed out as tasks (see gretl_task.c), so
+   where possible they proceed concurrently in forked processes.
+   Alternatively the box can be searched globally by differential
+   evolution, with the best point then polished by BFGS.
+*/
+
+enum {
+    MS_BFGS,
+    MS_NR,
+    MS_DE
+};
+
+#define MS_NSTARTS_DEFAULT 10
+#define DE_MAXGEN_DEFAULT 1000
+#define DE_F 0.8   /* differential weight */
+#define DE_CR 0.9  /* crossover probability */
+
+/* is criterion value @x better than @y? */
+
+static int ms_better (double x, double y, int minimize)
+{
+    if (na(x)) {
+        return 0;
+    } else if (na(y)) {
+        return 1;
+    } else {
+        return minimize ? x < y : x > y;
+    }
+}
+
+/* Run a local maximizer (or minimizer) starting from @b, which
+   is overwritten with the point reached. Returns the criterion
+   at that point, or NA if the local run failed.
+*/
+
+static double ms_local_max (umax *u, double *b, int method,
+                            BFGS_GRAD_FUNC gradfunc,
+                            gretlopt opt)
+{
+    int err;
+
+    if (method == MS_NR) {
+        int iters = 0;
+
+        err = newton_raphson_max(b, u->ncoeff, 100, 1.0e-7, 1.0e-7,
+                                 &iters, C_OTHER, user_get_criterion,
+                                 gradfunc, NULL, u, opt, NULL);
+    } else {
+        int fcount = 0, gcount = 0;
+
+        err = BFGS_max(b, u->ncoeff, BFGS_MAXITER_DEFAULT,
+                       libset_get_double(BFGS_TOLER),
+                       &fcount, &gcount, user_get_criterion,
+                       C_OTHER, gradfunc, u, NULL, opt, NULL);
+    }
+
+    if (err) {
+        /* a failed local run is not fatal */
+        gretl_error_clear();
+        return NADBL;
+    }
+
+    return user_get_criterion(b, u);
+}
+
+/* Write into @R the outcomes of local runs from each of the
+   starting points in the columns of @X0: row j of @R holds the
+   criterion value then the parameter values reached from start j.
+*/
+
+static int ms_run_starts (umax *u, const gretl_matrix *X0,
+                          int method, gretlopt opt,
+                          gretl_matrix *R)
+{
+    BFGS_GRAD_FUNC gradfunc;
+    int n = X0->rows;
+    int ns = X0->cols;
+    int *ids;
+    int i, j, err = 0;
+
+    ids = calloc(ns, sizeof *ids);
+    if (ids == NULL) {
+        return E_ALLOC;
+    }
+
+    /* note: this is checked at the incoming @b */
+    gradfunc = user_gradient_func(u);
+
+    for (j=0; j<ns && !err; j++) {
+        TaskRole role;
+
+        ids[j] = gretl_task_start(&role, &err);
+        if (!err && role != TASK_PARENT) {
+            gretl_matrix *r = gretl_matrix_alloc(1, n + 1);
+
+            if (r != NULL) {
+                memcpy(r->val + 1, X0->val + j*n, n * sizeof(double));
+                r->val[0] = ms_local_max(u, r->val + 1, method,
+                                         gradfunc, opt);
+            }
+            gretl_task_finish(ids[j], r, GRETL_TYPE_MATRIX,
+                              r == NULL ? E_ALLOC : 0);
+            /* note: not reached in a forked process */
+            gretl_matrix_free(r);
+        }
+    }
+
+    /* collect the results, in order of starting point */
+    for (j=0; j<ns; j++) {
+        gretl_matrix *r = NULL;
+        GretlType type = 0;
+        int terr = 0;
+
+        if (ids[j] > 0) {
+            r = gretl_task_await(ids[j], &type, &terr);
+        }
+        if (r != NULL && type == GRETL_TYPE_MATRIX && r->cols == n + 1) {
+            for (i=0; i<=n; i++) {
+                gretl_matrix_set(R, j, i, r->val[i]);
+            }
+        } else {
+            gretl_matrix_set(R, j, 0, NADBL);
+            for (i=0; i<n; i++) {
+                gretl_matrix_set(R, j, i+1, gretl_matrix_get(X0, i, j));
+            }
+        }
+        if (terr) {
+            gretl_error_clear();
+        }
+        if (type == GRETL_TYPE_MATRIX) {
+            gretl_matrix_free(r);
+        }
+    }
+
+    free(ids);
+
+    return err;
+}
+
+/* Differential evolution (the DE/rand/1/bin scheme of Storn and
+   Price) within the box @rng, starting from the population given
+   by the columns of @X0. On exit @R holds the final population,
+   one member per row as in ms_run_starts(), and the best member
+   has been polished by BFGS.
+*/
+
+static int ms_diffevol (umax *u, const gretl_matrix *X0,
+                        const gretl_matrix *rng, int maxgen,
+                        gretlopt opt, gretl_matrix *R)
+{
+    int minimize = (opt & OPT_I) ? 1 : 0;
+    int n = X0->rows;
+    int np = X0->cols;
+    double *x, *f, *trial;
+    double ft, lo, hi;
+    int a, b, c, jr;
+    int g, i, j, best = 0;
+    int err = 0;
+
+    x = malloc((np * n + np + n) * sizeof *x);
+    if (x == NULL) {
+        return E_ALLOC;
+    }
+
+    f = x + np * n;
+    trial = f + np;
+    memcpy(x, X0->val, np * n * sizeof *x);
+
+    for (j=0; j<np; j++) {
+        f[j] = user_get_criterion(x + j*n, u);
+        if (ms_better(f[j], f[best], minimize)) {
+            best = j;
+        }
+    }
+
+    for (g=0; g<maxgen; g++) {
+        double fmin, fmax;
+        int nna = 0;
+
+        for (j=0; j<np; j++) {
+            do {
+                a = gretl_rand_int_max(np);
+            } while (a == j);
+            do {
+                b = gretl_rand_int_max(np);
+            } while (b == j || b == a);
+            do {
+                c = gretl_rand_int_max(np);
+            } while (c == j || c == a || c == b);
+            jr = gretl_rand_int_max(n);
+            for (i=0; i<n; i++) {
+                if (i == jr || gretl_rand_01() < DE_CR) {
+                    trial[i] = x[a*n+i] + DE_F * (x[b*n+i] - x[c*n+i]);
+                    /* keep within the box */
+                    lo = gretl_matrix_get(rng, i, 0);
+                    hi = gretl_matrix_get(rng, i, 1);
+                    if (trial[i] < lo) {
+                        trial[i] = lo;
+                    } else if (trial[i] > hi) {
+                        trial[i] = hi;
+                    }
+                } else {
+                    trial[i] = x[j*n+i];
+                }
+            }
+            ft = user_get_criterion(trial, u);
+            if (!ms_better(f[j], ft, minimize)) {
+                memcpy(x + j*n, trial, n * sizeof *x);
+                f[j] = ft;
+                if (ms_better(ft, f[best], minimize)) {
+                    best = j;
+                }
+            }
+        }
+
+        /* stop when the population has collapsed */
+        fmin = fmax = f[0];
+        for (j=0; j<np; j++) {
+            if (na(f[j])) {
+                nna++;
+            } else if (f[j] < fmin) {
+                fmin = f[j];
+            } else if (f[j] > fmax) {
+                fmax = f[j];
+            }
+        }
+        if (nna == 0 && fmax - fmin <= 1.0e-10 * (1 + fabs(f[best]))) {
+            break;
+        }
+    }
+
+    if (na(f[best])) {
+        err = E_NAN;
+    } else {
+        /* polish the best point */
+        memcpy(trial, x + best*n, n * sizeof *x);
+        ft = ms_local_max(u, trial, MS_BFGS, user_gradient_func(u), opt);
+        if (ms_better(ft, f[best], minimize)) {
+            memcpy(x + best*n, trial, n * sizeof *x);
+            f[best] = ft;
+        }
+    }
+
+    for (j=0; j<np; j++) {
+        gretl_matrix_set(R, j, 0, f[j]);
+        for (i=0; i<n; i++) {
+            gretl_matrix_set(R, j, i+1, x[j*n+i]);
+        }
+    }
+
+    free(x);
+
+    return err;
+}
+
+static int ms_minimize;
+
+static int ms_row_compare (const void *a, const void *b)
+{
+    const double *fa = a;
+    const double *fb = b;
+
+    if (ms_better(*fa, *fb, ms_minimize)) {
+        return -1;
+    } else if (ms_better(*fb, *fa, ms_minimize)) {
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+/* Sort the rows of @R, best criterion value first; NAs go last */
+
+static gretl_matrix *ms_sort_results (const gretl_matrix *R,
+                                      int minimize, int *err)
+{
+    int n = R->cols;
+    int ns = R->rows;
+    gretl_matrix *S;
+    double *tmp;
+    int i, j;
+
+    S = gretl_matrix_alloc(ns, n);
+    tmp = malloc(ns * n * sizeof *tmp);
+    if (S == NULL || tmp == NULL) {
+        gretl_matrix_free(S);
+        free(tmp);
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    /* transcribe to row-major order for sorting */
+    for (j=0; j<ns; j++) {
+        for (i=0; i<n; i++) {
+            tmp[j*n+i] = gretl_matrix_get(R, j, i);
+        }
+    }
+
+    ms_minimize = minimize;
+    qsort(tmp, ns, n * sizeof *tmp, ms_row_compare);
+
+    for (j=0; j<ns; j++) {
+        for (i=0; i<n; i++) {
+            gretl_matrix_set(S, j, i, tmp[j*n+i]);
+        }
+    }
+
+    free(tmp);
+
+    return S;
+}
+
+static int ms_get_method (gretl_bundle *opts, int *err)
+{
+    const char *s = gretl_bundle_get_string(opts, "method", NULL);
+
+    if (s == NULL || !g_ascii_strcasecmp(s, "BFGS")) {
+        return MS_BFGS;
+    } else if (!g_ascii_strcasecmp(s, "NR")) {
+        return MS_NR;
+    } else if (!g_ascii_strcasecmp(s, "DE")) {
+        return MS_DE;
+    } else {
+        gretl_errmsg_sprintf(_("MSmax: unknown method '%s'"), s);
+        *err = E_INVARG;
+        return 0;
+    }
+}
+
+/* Assemble the starting points as the columns of an n x @ns
+   matrix: the first is @b, and the rest are the first @ns - 1
+   points of the Sobol sequence, mapped into the box @rng.
+*/
+
+static gretl_matrix *ms_starting_points (const gretl_matrix *b,
+                                         const gretl_matrix *rng,
+                                         int ns, int *err)
+{
+    gretl_matrix *X0, *U = NULL;
+    int n = b->rows * b->cols;
+    double lo, hi;
+    int i, j;
+
+    X0 = gretl_matrix_alloc(n, ns);
+    if (X0 == NULL) {
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    memcpy(X0->val, b->val, n * sizeof(double));
+
+    if (ns > 1) {
+        U = sobol_matrix(n, ns - 1, 0, err);
+        if (*err) {
+            gretl_matrix_free(X0);
+            return NULL;
+        }
+        for (j=1; j<ns; j++) {
+            for (i=0; i<n; i++) {
+                lo = gretl_matrix_get(rng, i, 0);
+                hi = gretl_matrix_get(rng, i, 1);
+                gretl_matrix_set(X0, i, j, lo + (hi - lo) *
+                                 gretl_matrix_get(U, i, j-1));
+            }
+        }
+        gretl_matrix_free(U);
+    }
+
+    return X0;
+}
+
+/**
+ * user_multistart:
+ * @b: parameter vector: on input, the first starting point; on
+ * output, the best point found.
+ * @fncall: call to the criterion function.
+ * @gradcall: call to gradient function, or NULL.
+ * @opts: bundle holding the options: "range" (required), an n x 2
+ * matrix of lower and upper limits for the starting points;
+ * optionally "nstarts", "method" and "maxiter".
+ * @out: bundle in which to record the results, or NULL.
+ * @dset: dataset.
+ * @minimize: if non-zero, minimize rather than maximize.
+ * @prn: printing struct.
+ * @err: location to receive error code.
+ *
+ * Multi-start or global optimization of a user-defined criterion.
+ * If @out is non-NULL the matrix "optima" is added to it, holding
+ * the criterion value and parameter vector reached from each
+ * starting point (or, under differential evolution, for each
+ * member of the final population), sorted with the best first.
+ *
+ * Returns: the best criterion value found.
+ */
+
+double user_multistart (gretl_matrix *b,
+                        const char *fncall,
+                        const char *gradcall,
+                        gretl_bundle *opts,
+                        gretl_bundle *out,
+                        DATASET *dset,
+                        int minimize,
+                        PRN *prn, int *err)
+{
+    gretl_matrix *rng, *X0 = NULL;
+    gretl_matrix *R = NULL, *S = NULL;
+    gretlopt opt = minimize ? OPT_I : OPT_NONE;
+    umax *u = NULL;
+    double ret = NADBL;
+    int method, ns, n;
+    int i;
+
+    n = gretl_vector_get_length(b);
+    if (n == 0) {
+        *err = E_DATA;
+        return ret;
+    }
+
+    rng = gretl_bundle_get_matrix(opts, "range", NULL);
+    if (rng == NULL || rng->rows != n || rng->cols != 2) {
+        gretl_errmsg_sprintf(_("MSmax: \"range\" must be a %d x 2 matrix"), n);
+        *err = E_INVARG;
+        return ret;
+    }
+    for (i=0; i<n; i++) {
+        if (!(gretl_matrix_get(rng, i, 0) <= gretl_matrix_get(rng, i, 1))) {
+            *err = E_INVARG;
+            return ret;
+        }
+    }
+
+    method = ms_get_method(opts, err);
+    if (*err) {
+        return ret;
+    }
+
+    ns = gretl_bundle_get_int_deflt(opts, "nstarts", method == MS_DE ?
+                                    MAX(20, 10 * n) : MS_NSTARTS_DEFAULT);
+    if (ns < 1 || (method == MS_DE && ns < 4)) {
+        *err = E_INVARG;
+        return ret;
+    }
+
+    u = umax_new(GRETL_TYPE_DOUBLE);
+    if (u == NULL) {
+        *err = E_ALLOC;
+        return ret;
+    }
+
+    u->ncoeff = n;
+    u->b = b;
+    u->prn = prn;
+
+    *err = user_gen_setup(u, fncall, gradcall, NULL, dset);
+    if (*err) {
+        goto bailout;
+    }
+
+    X0 = ms_starting_points(b, rng, ns, err);
+    if (!*err) {
+        R = gretl_matrix_alloc(ns, n + 1);
+        if (R == NULL) {
+            *err = E_ALLOC;
+        }
+    }
+
+    if (!*err) {
+        gretl_print_flush_stream(prn);
+        if (method == MS_DE) {
+            int maxgen = gretl_bundle_get_int_deflt(opts, "maxiter",
+                                                    DE_MAXGEN_DEFAULT);
+
+            *err = ms_diffevol(u, X0, rng, maxgen, opt, R);
+        } else {
+            *err = ms_run_starts(u, X0, method, opt, R);
+        }
+    }
+
+    if (!*err) {
+        S = ms_sort_results(R, minimize, err);
+    }
+
+    if (!*err) {
+        ret = gretl_matrix_get(S, 0, 0);
+        if (na(ret)) {
+            gretl_errmsg_set(_("MSmax: no local optimization succeeded"));
+            *err = E_NOCONV;
+        } else {
+            for (i=0; i<n; i++) {
+                b->val[i] = gretl_matrix_get(S, 0, i+1);
+            }
+        }
+    }
+
+    if (!*err && out != NULL) {
+        *err = gretl_bundle_donate_data(out, "optima", S,
+                                        GRETL_TYPE_MATRIX, 0);
+        if (!*err) {
+            S = NULL;
+        }
+    }
+
+ bailout:
+
+    gretl_matrix_free(X0);
+    gretl_matrix_free(R);
+    gretl_matrix_free(S);
+    umax_destroy(u);
+
+    return *err ? NADBL : ret;
+}
+
 #define JAC_DEBUG 0
 
 static int user_calc_fvec (int m, int n, double *x, double *fvec,
@@ -2665,7 +3557,8 @@ static int NR_invert_hessian (gretl_matrix *H, const gretl_matrix *Hcpy)
  * _not_ inverted; newton_raphson_max takes care of the inversion,
  * with a routine for fixing up the matrix if it's not positive
  * definite. If @hessfunc is NULL we fall back on a numerical
- * approximation to the Hessian.
+ * approximation to the Hessian, or, if @n exceeds %NR_DENSE_MAX,
+ * on trust_newton_max(), which avoids forming the Hessian.
  *
  * Returns: 0 on successful completion, non-zero error code
  * on error.
@@ -2694,6 +3587,13 @@ int newton_raphson_max (double *b, int n, int maxit,
     int iter = 0;
     int err = 0;
 
+    if (hessfunc == NULL && n > NR_DENSE_MAX) {
+        /* don't try to form the dense Hessian */
+        return trust_newton_max(b, n, maxit, crittol, gradtol,
+                                itercount, crittype, cfunc, gradfunc,
+                                NULL, data, opt, prn);
+    }
+
     b0 = malloc(2 * n * sizeof *b0);
     if (b0 == NULL) {
         return E_ALLOC;
@@ -2855,6 +3755,315 @@ int newton_raphson_max (double *b, int n, int maxit,
     return err;
 }
 
+/* Truncated Newton with a trust region, for problems too large for
+   the dense Hessian of newton_raphson_max(). The Newton step is
+   found by the conjugate gradient method of Steihaug (1983), which
+   needs only products of the Hessian with a vector.
+*/
+
+#define TRN_ETA 1.0e-4
+
+static double trn_dot (const double *x, const double *y, int n)
+{
+    double ret = 0.0;
+    int i;
+
+    for (i=0; i<n; i++) {
+        ret += x[i] * y[i];
+    }
+
+    return ret;
+}
+
+/* Compute in @Bv the product of @v with B = -H, where H is the
+   Hessian of the (sign-adjusted) criterion at @b: either via the
+   callback @hvfunc or by a forward difference of the gradient,
+   given the gradient @g at @b. @w should be workspace of length
+   2 * @n.
+*/
+
+static int trn_hessvec (double *b, const double *g,
+                        const double *v, double *Bv,
+                        double *w, int n,
+                        HESSVEC_FUNC hvfunc,
+                        BFGS_GRAD_FUNC gradfunc,
+                        BFGS_CRIT_FUNC cfunc,
+                        void *data, int minimize)
+{
+    double *bh = w;
+    double *gh = w + n;
+    double h, vnorm;
+    int i, err = 0;
+
+    if (hvfunc != NULL) {
+        err = hvfunc(b, v, Bv, n, data);
+        if (!err) {
+            for (i=0; i<n; i++) {
+                Bv[i] = minimize ? Bv[i] : -Bv[i];
+            }
+        }
+    } else {
+        vnorm = sqrt(trn_dot(v, v, n));
+        if (vnorm == 0) {
+            for (i=0; i<n; i++) {
+                Bv[i] = 0.0;
+            }
+            return 0;
+        }
+        h = sqrt(DBL_EPSILON) * (1.0 + sqrt(trn_dot(b, b, n))) / vnorm;
+        copy_plus(bh, b, h, v, n);
+        err = optim_gradcall(gradfunc, bh, gh, n, cfunc, data, minimize);
+        if (!err) {
+            for (i=0; i<n; i++) {
+                Bv[i] = (g[i] - gh[i]) / h;
+            }
+        }
+    }
+
+    for (i=0; i<n && !err; i++) {
+        if (!isfinite(Bv[i])) {
+            err = E_NAN;
+        }
+    }
+
+    return err;
+}
+
+/* the positive root of ||s + tau*d|| = delta */
+
+static double trn_boundary (const double *s, const double *d,
+                            double delta, int n)
+{
+    double a = trn_dot(d, d, n);
+    double b = 2 * trn_dot(s, d, n);
+    double c = trn_dot(s, s, n) - delta * delta;
+
+    return (-b + sqrt(b * b - 4 * a * c)) / (2 * a);
+}
+
+/* Steihaug's conjugate gradient iteration: approximately maximize
+   the quadratic model g's - s'Bs/2 subject to ||s|| <= @delta.
+   On output @s holds the step and @Bs the product B*s; @boundary
+   is set to 1 if the step reaches the edge of the trust region.
+   The workspace @ws should have length 5 * @n.
+*/
+
+static int trn_cg_step (double *b, const double *g, double *s,
+                        double *Bs, double *ws, int n,
+                        double delta, int *boundary,
+                        HESSVEC_FUNC hvfunc,
+                        BFGS_GRAD_FUNC gradfunc,
+                        BFGS_CRIT_FUNC cfunc,
+                        void *data, int minimize)
+{
+    double *r = ws;
+    double *d = r + n;
+    double *Bd = d + n;
+    double *w = Bd + n;
+    double rr, rr1, kappa, alpha, tol;
+    int i, j, err = 0;
+
+    for (i=0; i<n; i++) {
+        s[i] = Bs[i] = 0.0;
+        r[i] = d[i] = g[i];
+    }
+
+    rr = trn_dot(r, r, n);
+    tol = sqrt(rr) * MIN(0.5, pow(rr, 0.25));
+    *boundary = 0;
+
+    for (j=0; j<n; j++) {
+        err = trn_hessvec(b, g, d, Bd, w, n, hvfunc, gradfunc,
+                          cfunc, data, minimize);
+        if (err) {
+            break;
+        }
+        kappa = trn_dot(d, Bd, n);
+        if (kappa > 0) {
+            alpha = rr / kappa;
+            copy_plus(w, s, alpha, d, n);
+        }
+        if (kappa <= 0 || sqrt(trn_dot(w, w, n)) >= delta) {
+            /* negative curvature, or a step outside the region:
+               go to the boundary along @d */
+            alpha = trn_boundary(s, d, delta, n);
+            *boundary = 1;
+        }
+        for (i=0; i<n; i++) {
+            s[i] += alpha * d[i];
+            Bs[i] += alpha * Bd[i];
+        }
+        if (*boundary) {
+            break;
+        }
+        for (i=0; i<n; i++) {
+            r[i] -= alpha * Bd[i];
+        }
+        rr1 = trn_dot(r, r, n);
+        if (sqrt(rr1) < tol) {
+            break;
+        }
+        for (i=0; i<n; i++) {
+            d[i] = r[i] + (rr1 / rr) * d[i];
+        }
+        rr = rr1;
+    }
+
+    return err;
+}
+
+/**
+ * trust_newton_max:
+ * @b: array of adjustable coefficients.
+ * @n: number elements in array @b.
+ * @maxit: the maximum number of iterations to allow.
+ * @crittol: tolerance for terminating iteration, in terms of
+ * the change in the criterion.
+ * @gradtol: tolerance for terminating iteration, in terms of
+ * the gradient.
+ * @itercount: location to receive count of iterations.
+ * @crittype: code for type of the maximand/minimand: should
+ * be %C_LOGLIK, %C_GMM or %C_OTHER.  Used only in printing
+ * iteration info.
+ * @cfunc: pointer to function used to calculate maximand.
+ * @gradfunc: pointer to function used to calculate the
+ * gradient, or %NULL for default numerical calculation.
+ * @hvfunc: pointer to function used to calculate the product
+ * of the Hessian with a given vector, or %NULL.
+ * @data: pointer that will be passed as the last
+ * parameter to the callback functions @cfunc, @gradfunc
+ * and @hvfunc.
+ * @opt: may contain %OPT_V for verbose operation, %OPT_I
+ * to minimize rather than maximize.
+ * @prn: printing struct (or %NULL).
+ *
+ * A trust-region variant of Newton's method which avoids forming
+ * the Hessian: each step is obtained by conjugate gradient
+ * iterations that need only Hessian-vector products. These are
+ * supplied by @hvfunc, which should write into its third argument
+ * the Hessian (not negated) at its first argument times the vector
+ * given as its second argument; if @hvfunc is %NULL they are
+ * obtained by differencing the gradient. The storage required is
+ * of order @n. This is used by newton_raphson_max() when @n exceeds
+ * %NR_DENSE_MAX and no Hessian function is given.
+ *
+ * Returns: 0 on successful completion, non-zero error code
+ * on error.
+ */
+
+int trust_newton_max (double *b, int n, int maxit,
+                      double crittol, double gradtol,
+                      int *itercount, int crittype,
+                      BFGS_CRIT_FUNC cfunc,
+                      BFGS_GRAD_FUNC gradfunc,
+                      HESSVEC_FUNC hvfunc,
+                      void *data, gretlopt opt,
+                      PRN *prn)
+{
+    int verbose = (opt & OPT_V);
+    int minimize = (opt & OPT_I);
+    double *wspace, *g, *s, *Bs, *b1, *ws;
+    double f0, f1, gnorm = 0, snorm = 0;
+    double pred, rho, delta = 1.0;
+    int boundary, status = 0;
+    int iter = 0;
+    int err = 0;
+
+    wspace = malloc(9 * n * sizeof *wspace);
+    if (wspace == NULL) {
+        return E_ALLOC;
+    }
+
+    g = wspace;
+    s = g + n;
+    Bs = s + n;
+    b1 = Bs + n;
+    ws = b1 + n;
+
+    if (gradfunc == NULL) {
+        gradfunc = numeric_gradient;
+    }
+
+    optim_get_user_values(b, n, NULL, NULL, NULL, opt, prn);
+
+    f0 = f1 = optim_fncall(cfunc, b, data, minimize);
+    if (na(f0)) {
+        gretl_errmsg_set(_("Initial value of objective function is not finite"));
+        err = E_NAN;
+    } else {
+        err = optim_gradcall(gradfunc, b, g, n, cfunc, data, minimize);
+    }
+
+    gretl_iteration_push();
+
+    while (status == 0 && !err) {
+        gnorm = sqrt(trn_dot(g, g, n));
+        if (!isfinite(gnorm)) {
+            fprintf(stderr, "NA in gradient\n");
+            err = E_NAN;
+            break;
+        } else if (gnorm < gradtol) {
+            status = GRADTOL_MET;
+            break;
+        } else if (++iter > maxit) {
+            err = E_NOCONV;
+            break;
+        }
+
+        err = trn_cg_step(b, g, s, Bs, ws, n, delta, &boundary,
+                          hvfunc, gradfunc, cfunc, data, minimize);
+        if (err) {
+            break;
+        }
+
+        /* compare the actual and predicted changes */
+        pred = trn_dot(g, s, n) - 0.5 * trn_dot(s, Bs, n);
+        copy_plus(b1, b, 1.0, s, n);
+        f1 = optim_fncall(cfunc, b1, data, minimize);
+        rho = (na(f1) || pred <= 0) ? -1 : (f1 - f0) / pred;
+        snorm = sqrt(trn_dot(s, s, n));
+
+        if (rho < 0.25) {
+            delta = 0.25 * snorm;
+        } else if (rho > 0.75 && boundary) {
+            delta *= 2.0;
+        }
+
+        if (rho > TRN_ETA) {
+            copy_to(b, b1, n);
+            err = optim_gradcall(gradfunc, b, g, n, cfunc, data,
+                                 minimize);
+            if (verbose) {
+                print_iter_info(iter, f1, crittype, n, b, g,
+                                snorm, prn);
+            }
+            if (f1 - f0 < crittol) {
+                status = CRITTOL_MET;
+            }
+            f0 = f1;
+        } else if (delta < 1.0e-12 * (1.0 + sqrt(trn_dot(b, b, n)))) {
+            status = STEPMIN_MET;
+        }
+    }
+
+    gretl_iteration_pop();
+
+    if (verbose) {
+        print_iter_info(-1, f0, crittype, n, b, g, snorm, prn);
+        pputc(prn, '\n');
+    }
+
+    *itercount = iter;
+
+    if (!err && prn != NULL) {
+        print_NR_status(status, crittol, gradtol, gnorm, prn);
+    }
+
+    free(wspace);
+
+    return err;
+}
+
 static double simann_call (BFGS_CRIT_FUNC cfunc,
                            double *b, void *data,
                            int minimize)
@@ -20,6 +20,14 @@
 #ifndef GRETL_BFGS_H
 #define GRETL_BFGS_H
 
+/* above this number of parameters, BFGS_max() switches to the
+   limited-memory algorithm */
+#define BFGS_DENSE_MAX 4000
+
+/* above this number of parameters, newton_raphson_max() switches
+   to truncated Newton when no Hessian function is given */
+#define NR_DENSE_MAX 1000
+
 typedef enum {
     BHHH_MAX,
     BFGS_MAX,
@@ -36,6 +44,8 @@ typedef int (*BFGS_GRAD_FUNC) (double *, double *, int,
 typedef double (*BFGS_COMBO_FUNC) (double *, double *, int, void *);
 typedef const double *(*BFGS_LLT_FUNC) (const double *, int, void *);
 typedef int (*HESS_FUNC) (double *, gretl_matrix *, void *);
+typedef int (*HESSVEC_FUNC) (double *, const double *, double *,
+			     int, void *);
 typedef double (*ZFUNC) (double, void *);
 
 int BFGS_max (double *b, int n, int maxit, double reltol,
@@ -57,6 +67,14 @@ int newton_raphson_max (double *b, int n, int maxit,
 			HESS_FUNC hessfunc,
 			void *data, gretlopt opt, PRN *prn);
 
+int trust_newton_max (double *b, int n, int maxit,
+		      double crittol, double gradtol,
+		      int *itercount, int crittype,
+		      BFGS_CRIT_FUNC cfunc,
+		      BFGS_GRAD_FUNC gradfunc,
+		      HESSVEC_FUNC hvfunc,
+		      void *data, gretlopt opt, PRN *prn);
+
 int BFGS_numeric_gradient (double *b, double *g, int n,
 			   BFGS_CRIT_FUNC func, void *data);
 
@@ -109,6 +127,15 @@ double deriv_free_optimize (MaxMethod method,
 			    PRN *prn,
 			    int *err);
 
+double user_multistart (gretl_matrix *b,
+			const char *fncall,
+			const char *gradcall,
+			gretl_bundle *opts,
+			gretl_bundle *out,
+			DATASET *dset,
+			int minimize,
+			PRN *prn, int *err);
+
 gretl_matrix *user_fdjac (gretl_matrix *theta, const char *fncall,
 			  double eps, DATASET *dset, int *err);
 
@@ -137,4 +164,6 @@ int optimizer_get_matrix_name (const char *fncall, char *name);
 
 int numgrad_in_progress (void);
 
+void numgrad_set_reentrant (BFGS_CRIT_FUNC func, guint64 cost);
+
 #endif /* GRETL_BFGS_H */
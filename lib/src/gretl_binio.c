@@ -0,0 +1,1327 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* gretl_binio.c: binary serialization of matrices, bundles and
+   arrays, as an alternative to XML for sessions and for bwrite()
+   and bread(), and as the format of matrices written by mwrite()
+   with the ".bin" suffix. Unlike the MPI packer this format is
+   portable: all quantities are little-endian, and the type codes
+   below are fixed independently of the GretlType enumeration.
+
+   A file is a container of named members, laid out as follows.
+
+   header: the 8-byte magic string "gretlbin", 32-bit version,
+     32-bit number of members, 64-bit offset of the directory
+
+   members: for each, starting at a multiple of 8 bytes, the
+     name, the note (possibly empty), 32-bit type code and the
+     content
+
+   directory: the creator string (possibly empty) of the bundle
+     that was written, then for each member the name, 32-bit type
+     code, 64-bit offset of the member and 64-bit length
+
+   Strings are written as their 32-bit length followed by the
+   bytes, without a terminating NUL. Lists, series and arrays are
+   likewise preceded by their lengths, and matrices by their
+   dimensions, flags and dates. Runs of doubles (the values of
+   matrices and series) are padded to start at a multiple of 8
+   bytes from the start of the file.
+
+   Files are read by mapping them into memory: given the directory,
+   a single member can be found and read without looking at any of
+   the others, and the values of a matrix are transcribed from the
+   mapping into the matrix's storage with one memcpy.
+*/
+
+#include "libgretl.h"
+#include "gretl_array.h"
+#include "gretl_typemap.h"
+#include "gretl_binio.h"
+
+#define BIN_MAGIC "gretlbin"
+#define BIN_VERSION 1
+#define BIN_HDRLEN 24
+
+enum {
+    BIN_DOUBLE = 1,
+    BIN_INT,
+    BIN_UINT32,
+    BIN_UINT64,
+    BIN_STRING,
+    BIN_SERIES,
+    BIN_LIST,
+    BIN_MATRIX,
+    BIN_BUNDLE,
+    BIN_ARRAY
+};
+
+/* matrix flags */
+#define BIN_COMPLEX  1
+#define BIN_COLNAMES 2
+#define BIN_ROWNAMES 4
+
+static const struct {
+    GretlType type;  /* type of object */
+    GretlType etype; /* type of array element */
+    guint32 code;
+} bin_types[] = {
+    { GRETL_TYPE_DOUBLE, 0,                    BIN_DOUBLE },
+    { GRETL_TYPE_INT,    0,                    BIN_INT },
+    { GRETL_TYPE_UINT32, 0,                    BIN_UINT32 },
+    { GRETL_TYPE_UINT64, 0,                    BIN_UINT64 },
+    { GRETL_TYPE_STRING, GRETL_TYPE_STRINGS,   BIN_STRING },
+    { GRETL_TYPE_SERIES, 0,                    BIN_SERIES },
+    { GRETL_TYPE_LIST,   GRETL_TYPE_LISTS,     BIN_LIST },
+    { GRETL_TYPE_MATRIX, GRETL_TYPE_MATRICES,  BIN_MATRIX },
+    { GRETL_TYPE_BUNDLE, GRETL_TYPE_BUNDLES,   BIN_BUNDLE },
+    { GRETL_TYPE_ARRAY,  GRETL_TYPE_ARRAYS,    BIN_ARRAY }
+};
+
+#define N_BIN_TYPES (sizeof bin_types / sizeof bin_types[0])
+
+/* map from @type, or from array element type @etype if
+   @type is 0, to the code used in the file */
+
+static guint32 bin_code_for_type (GretlType type, GretlType etype)
+{
+    int i;
+
+    for (i=0; i<N_BIN_TYPES; i++) {
+        if ((type != 0 && type == bin_types[i].type) ||
+            (type == 0 && etype == bin_types[i].etype)) {
+            return bin_types[i].code;
+        }
+    }
+
+    return 0;
+}
+
+static GretlType bin_type_for_code (guint32 code, int element)
+{
+    int i;
+
+    for (i=0; i<N_BIN_TYPES; i++) {
+        if (code == bin_types[i].code) {
+            return element ? bin_types[i].etype : bin_types[i].type;
+        }
+    }
+
+    return 0;
+}
+
+/* writing */
+
+typedef struct bin_entry_ bin_entry;
+
+struct bin_entry_ {
+    char *name;      /* name of member */
+    guint32 code;    /* type code */
+    guint64 offset;  /* start of member */
+    guint64 size;    /* length of member */
+};
+
+struct gretl_bin_writer_ {
+    FILE *fp;        /* output stream */
+    guint64 pos;     /* bytes written */
+    GArray *dir;     /* directory entries */
+    char *creator;   /* creator of bundle written, if any */
+    int err;         /* sticky error code */
+};
+
+static int write_bundle (gretl_bin_writer *w, gretl_bundle *b);
+static int write_array (gretl_bin_writer *w, gretl_array *a);
+
+static void bw_put (gretl_bin_writer *w, const void *src, size_t n)
+{
+    if (!w->err && n > 0) {
+        if (fwrite(src, 1, n, w->fp) != n) {
+            w->err = E_FOPEN;
+        }
+        w->pos += n;
+    }
+}
+
+static void bw_put_u32 (gretl_bin_writer *w, guint32 u)
+{
+    u = GUINT32_TO_LE(u);
+    bw_put(w, &u, sizeof u);
+}
+
+static void bw_put_u64 (gretl_bin_writer *w, guint64 u)
+{
+    u = GUINT64_TO_LE(u);
+    bw_put(w, &u, sizeof u);
+}
+
+static void bw_put_double (gretl_bin_writer *w, double x)
+{
+    union { double x; guint64 u; } xu;
+
+    xu.x = x;
+    bw_put_u64(w, xu.u);
+}
+
+/* pad to a multiple of 8 bytes, ahead of an array of doubles */
+
+static void bw_align (gretl_bin_writer *w)
+{
+    static const char zeros[8];
+    size_t pad = (8 - w->pos % 8) % 8;
+
+    bw_put(w, zeros, pad);
+}
+
+static void bw_put_doubles (gretl_bin_writer *w, const double *x,
+                            size_t n)
+{
+    bw_align(w);
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+    bw_put(w, x, n * sizeof *x);
+#else
+    while (n-- > 0 && !w->err) {
+        bw_put_double(w, *x++);
+    }
+#endif
+}
+
+/* strings: length, not including the terminating NUL, then bytes;
+   NULL is written as an empty string */
+
+static void bw_put_string (gretl_bin_writer *w, const char *s)
+{
+    guint32 n = (s == NULL)? 0 : strlen(s);
+
+    bw_put_u32(w, n);
+    bw_put(w, s, n);
+}
+
+static void write_list (gretl_bin_writer *w, const int *list)
+{
+    int i;
+
+    bw_put_u32(w, list[0]);
+    for (i=1; i<=list[0]; i++) {
+        bw_put_u32(w, (guint32) list[i]);
+    }
+}
+
+static void write_names (gretl_bin_writer *w, const char **S, int n)
+{
+    int i;
+
+    for (i=0; i<n; i++) {
+        bw_put_string(w, S[i]);
+    }
+}
+
+static void write_matrix (gretl_bin_writer *w, const gretl_matrix *m)
+{
+    const char **cnames = gretl_matrix_get_colnames(m);
+    const char **rnames = gretl_matrix_get_rownames(m);
+    size_t n = (size_t) m->rows * m->cols;
+    guint32 flags = 0;
+
+    if (m->is_complex) {
+        flags |= BIN_COMPLEX;
+    }
+    if (cnames != NULL) {
+        flags |= BIN_COLNAMES;
+    }
+    if (rnames != NULL) {
+        flags |= BIN_ROWNAMES;
+    }
+
+    bw_put_u32(w, (guint32) m->rows);
+    bw_put_u32(w, (guint32) m->cols);
+    bw_put_u32(w, flags);
+    bw_put_u32(w, (guint32) gretl_matrix_get_t1(m));
+    bw_put_u32(w, (guint32) gretl_matrix_get_t2(m));
+    if (n > 0) {
+        bw_put_doubles(w, m->val, m->is_complex ? 2 * n : n);
+    }
+    if (cnames != NULL) {
+        write_names(w, cnames, m->cols);
+    }
+    if (rnames != NULL) {
+        write_names(w, rnames, m->rows);
+    }
+}
+
+/* write the content of an object of type @type */
+
+static int write_content (gretl_bin_writer *w, GretlType type,
+                          void *data, int size)
+{
+    int err = 0;
+
+    if (type == GRETL_TYPE_DOUBLE) {
+        bw_put_double(w, *(double *) data);
+    } else if (type == GRETL_TYPE_INT) {
+        bw_put_u32(w, (guint32) *(int *) data);
+    } else if (type == GRETL_TYPE_UINT32) {
+        bw_put_u32(w, *(guint32 *) data);
+    } else if (type == GRETL_TYPE_UINT64) {
+        bw_put_u64(w, *(guint64 *) data);
+    } else if (type == GRETL_TYPE_STRING) {
+        bw_put_string(w, data);
+    } else if (type == GRETL_TYPE_SERIES) {
+        bw_put_u32(w, size);
+        bw_put_doubles(w, data, size);
+    } else if (type == GRETL_TYPE_LIST) {
+        write_list(w, data);
+    } else if (type == GRETL_TYPE_MATRIX) {
+        write_matrix(w, data);
+    } else if (type == GRETL_TYPE_BUNDLE) {
+        err = write_bundle(w, data);
+    } else if (type == GRETL_TYPE_ARRAY) {
+        err = write_array(w, data);
+    } else {
+        err = E_TYPES;
+    }
+
+    return err ? err : w->err;
+}
+
+static int write_array (gretl_bin_writer *w, gretl_array *a)
+{
+    GretlType type = gretl_array_get_type(a);
+    GretlType etype = gretl_type_get_singular(type);
+    int i, n = gretl_array_get_length(a);
+    int err = 0;
+
+    bw_put_u32(w, bin_code_for_type(0, type));
+    bw_put_u32(w, n);
+
+    for (i=0; i<n && !err; i++) {
+        void *data = gretl_array_get_data(a, i);
+
+        /* flag for presence of the element */
+        bw_put_u32(w, data != NULL);
+        if (data != NULL) {
+            err = write_content(w, etype, data, 0);
+        }
+    }
+
+    return err;
+}
+
+static int write_bundle (gretl_bin_writer *w, gretl_bundle *b)
+{
+    gretl_array *keys = NULL;
+    int i, nk = gretl_bundle_get_n_keys(b);
+    int err = 0;
+
+    if (gretl_bundle_get_type(b) == BUNDLE_KALMAN) {
+        gretl_errmsg_set(_("Kalman bundles cannot be written in "
+                           "binary format"));
+        return E_TYPES;
+    }
+
+    if (nk > 0) {
+        keys = gretl_bundle_get_keys(b, &err);
+        if (err) {
+            return err;
+        }
+    }
+
+    bw_put_string(w, gretl_bundle_get_creator(b));
+    bw_put_u32(w, nk);
+
+    for (i=0; i<nk && !err; i++) {
+        const char *key = gretl_array_get_data(keys, i);
+        GretlType type = 0;
+        void *data;
+        int size = 0;
+
+        data = gretl_bundle_get_data(b, key, &type, &size, &err);
+        if (!err) {
+            bw_put_string(w, key);
+            bw_put_string(w, gretl_bundle_get_note(b, key));
+            bw_put_u32(w, bin_code_for_type(type, 0));
+            err = write_content(w, type, data, size);
+        }
+    }
+
+    gretl_array_destroy(keys);
+
+    return err;
+}
+
+/**
+ * gretl_bin_writer_new:
+ * @fname: full name of file to write.
+ * @err: location to receive error code.
+ *
+ * Opens @fname for writing objects in gretl's binary format,
+ * via gretl_bin_write_object().
+ *
+ * Returns: an allocated writer, to be passed to
+ * gretl_bin_writer_close() when done, or NULL on failure.
+ */
+
+gretl_bin_writer *gretl_bin_writer_new (const char *fname, int *err)
+{
+    gretl_bin_writer *w;
+
+    w = malloc(sizeof *w);
+    if (w == NULL) {
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    w->fp = gretl_fopen(fname, "wb");
+    if (w->fp == NULL) {
+        gretl_errmsg_sprintf(_("Couldn't write to %s"), fname);
+        *err = E_FOPEN;
+        free(w);
+        return NULL;
+    }
+
+    w->pos = 0;
+    w->dir = g_array_new(FALSE, FALSE, sizeof(bin_entry));
+    w->creator = NULL;
+    w->err = 0;
+
+    /* the count and directory offset are filled in on closing */
+    bw_put(w, BIN_MAGIC, 8);
+    bw_put_u32(w, BIN_VERSION);
+    bw_put_u32(w, 0);
+    bw_put_u64(w, 0);
+
+    return w;
+}
+
+/* write a member of the container and enter it in the directory */
+
+static int write_member (gretl_bin_writer *w, const char *name,
+                         const char *note, GretlType type,
+                         void *ptr, int size)
+{
+    bin_entry e;
+
+    bw_align(w);
+    e.name = gretl_strdup(name != NULL ? name : "");
+    e.code = bin_code_for_type(type, 0);
+    e.offset = w->pos;
+
+    bw_put_string(w, name);
+    bw_put_string(w, note);
+    bw_put_u32(w, e.code);
+    w->err = write_content(w, type, ptr, size);
+
+    e.size = w->pos - e.offset;
+    g_array_append_val(w->dir, e);
+
+    return w->err;
+}
+
+/**
+ * gretl_bin_write_object:
+ * @w: binary writer.
+ * @name: name of object.
+ * @type: type of object: matrix, bundle, array, string, list,
+ * or one of the scalar types.
+ * @ptr: pointer to the object.
+ *
+ * Appends the object at @ptr to the file associated with @w,
+ * as a member named @name.
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int gretl_bin_write_object (gretl_bin_writer *w, const char *name,
+                            GretlType type, void *ptr)
+{
+    if (bin_code_for_type(type, 0) == 0 || type == GRETL_TYPE_SERIES) {
+        /* a series needs its length */
+        return E_TYPES;
+    }
+
+    return write_member(w, name, NULL, type, ptr, 0);
+}
+
+/**
+ * gretl_bin_writer_close:
+ * @w: binary writer.
+ *
+ * Writes the directory of the file associated with @w, closes
+ * the file and frees the writer.
+ *
+ * Returns: 0 on success, or the first error code recorded
+ * while writing.
+ */
+
+int gretl_bin_writer_close (gretl_bin_writer *w)
+{
+    guint32 i, n = w->dir->len;
+    guint64 diroff;
+    int err;
+
+    bw_align(w);
+    diroff = w->pos;
+    bw_put_string(w, w->creator);
+
+    for (i=0; i<n; i++) {
+        bin_entry *e = &g_array_index(w->dir, bin_entry, i);
+
+        bw_put_string(w, e->name);
+        bw_put_u32(w, e->code);
+        bw_put_u64(w, e->offset);
+        bw_put_u64(w, e->size);
+        free(e->name);
+    }
+
+    if (!w->err && fseek(w->fp, 12, SEEK_SET) != 0) {
+        w->err = E_FOPEN;
+    }
+    bw_put_u32(w, n);
+    bw_put_u64(w, diroff);
+
+    err = w->err;
+    if (fclose(w->fp) != 0 && !err) {
+        err = E_FOPEN;
+    }
+
+    g_array_free(w->dir, TRUE);
+    free(w->creator);
+    free(w);
+
+    return err;
+}
+
+/* reading: from a buffer holding the mapped file */
+
+typedef struct bin_reader_ bin_reader;
+
+struct bin_reader_ {
+    const char *buf; /* file content */
+    gsize pos;       /* current read position */
+    gsize len;       /* total length */
+};
+
+static gretl_bundle *read_bundle (bin_reader *r, int *err);
+static gretl_array *read_array (bin_reader *r, int *err);
+
+static int br_get (bin_reader *r, void *targ, size_t n)
+{
+    if (n > r->len - r->pos) {
+        return E_DATA;
+    } else if (n > 0) {
+        memcpy(targ, r->buf + r->pos, n);
+        r->pos += n;
+    }
+    return 0;
+}
+
+static int br_get_u32 (bin_reader *r, guint32 *u)
+{
+    int err = br_get(r, u, sizeof *u);
+
+    *u = GUINT32_FROM_LE(*u);
+    return err;
+}
+
+static int br_get_int (bin_reader *r, int *k)
+{
+    guint32 u = 0;
+    int err = br_get_u32(r, &u);
+
+    *k = (gint32) u;
+    return err;
+}
+
+static int br_get_u64 (bin_reader *r, guint64 *u)
+{
+    int err = br_get(r, u, sizeof *u);
+
+    *u = GUINT64_FROM_LE(*u);
+    return err;
+}
+
+static int br_get_double (bin_reader *r, double *x)
+{
+    union { double x; guint64 u; } xu;
+    int err = br_get_u64(r, &xu.u);
+
+    *x = xu.x;
+    return err;
+}
+
+/* get a length, checking that it's plausible given that each
+   item takes at least @size bytes */
+
+static int br_get_length (bin_reader *r, int *n, size_t size)
+{
+    guint32 u = 0;
+    int err = br_get_u32(r, &u);
+
+    if (!err && (u > INT_MAX || u > (r->len - r->pos) / size)) {
+        err = E_DATA;
+    }
+    *n = u;
+
+    return err;
+}
+
+static int br_get_doubles (bin_reader *r, double *x, size_t n)
+{
+    r->pos += (8 - r->pos % 8) % 8;
+    if (r->pos > r->len || n > (r->len - r->pos) / sizeof *x) {
+        return E_DATA;
+    }
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+    return br_get(r, x, n * sizeof *x);
+#else
+    while (n-- > 0) {
+        br_get_double(r, x++);
+    }
+    return 0;
+#endif
+}
+
+static char *read_string (bin_reader *r, int *err)
+{
+    char *s = NULL;
+    int n = 0;
+
+    *err = br_get_length(r, &n, 1);
+    if (!*err) {
+        s = malloc(n + 1);
+        if (s == NULL) {
+            *err = E_ALLOC;
+        } else {
+            br_get(r, s, n);
+            s[n] = '\0';
+        }
+    }
+
+    return s;
+}
+
+static int *read_list (bin_reader *r, int *err)
+{
+    int *list = NULL;
+    int i, n = 0;
+
+    *err = br_get_length(r, &n, 4);
+    if (!*err) {
+        list = gretl_list_new(n);
+        if (list == NULL) {
+            *err = E_ALLOC;
+        }
+    }
+    for (i=1; i<=n && !*err; i++) {
+        *err = br_get_int(r, &list[i]);
+    }
+
+    return list;
+}
+
+static char **read_names (bin_reader *r, int n, int *err)
+{
+    char **S = strings_array_new(n);
+    int i;
+
+    if (S == NULL) {
+        *err = E_ALLOC;
+    }
+    for (i=0; i<n && !*err; i++) {
+        S[i] = read_string(r, err);
+    }
+    if (*err) {
+        strings_array_free(S, n);
+        S = NULL;
+    }
+
+    return S;
+}
+
+static gretl_matrix *read_matrix (bin_reader *r, int *err)
+{
+    gretl_matrix *m = NULL;
+    int rows = 0, cols = 0;
+    int t1 = 0, t2 = 0;
+    guint32 flags = 0;
+    size_t n;
+
+    *err = br_get_int(r, &rows);
+    if (!*err) *err = br_get_int(r, &cols);
+    if (!*err) *err = br_get_u32(r, &flags);
+    if (!*err) *err = br_get_int(r, &t1);
+    if (!*err) *err = br_get_int(r, &t2);
+    if (!*err && (rows < 0 || cols < 0)) {
+        *err = E_DATA;
+    }
+    if (*err) {
+        return NULL;
+    }
+
+    n = (size_t) rows * cols;
+    if (flags & BIN_COMPLEX) {
+        n *= 2;
+    }
+    if (n > (r->len - r->pos) / sizeof(double)) {
+        *err = E_DATA;
+        return NULL;
+    }
+
+    if (flags & BIN_COMPLEX) {
+        m = gretl_cmatrix_new(rows, cols);
+    } else {
+        m = gretl_matrix_alloc(rows, cols);
+    }
+    if (m == NULL) {
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    if (n > 0) {
+        *err = br_get_doubles(r, m->val, n);
+    }
+    if (!*err && t1 >= 0 && t2 >= t1) {
+        gretl_matrix_set_t1(m, t1);
+        gretl_matrix_set_t2(m, t2);
+    }
+    if (!*err && (flags & BIN_COLNAMES)) {
+        char **S = read_names(r, cols, err);
+
+        if (S != NULL) {
+            gretl_matrix_set_colnames(m, S);
+        }
+    }
+    if (!*err && (flags & BIN_ROWNAMES)) {
+        char **S = read_names(r, rows, err);
+
+        if (S != NULL) {
+            gretl_matrix_set_rownames(m, S);
+        }
+    }
+
+    if (*err) {
+        gretl_matrix_free(m);
+        m = NULL;
+    }
+
+    return m;
+}
+
+/* read the content of an object of type @type: scalar values
+   are written into @x, anything else is allocated */
+
+static void *read_content (bin_reader *r, GretlType type,
+                           double *x, int *size, int *err)
+{
+    void *data = NULL;
+
+    if (type == GRETL_TYPE_DOUBLE) {
+        *err = br_get_double(r, x);
+    } else if (type == GRETL_TYPE_INT) {
+        *err = br_get_int(r, (int *) x);
+    } else if (type == GRETL_TYPE_UINT32) {
+        *err = br_get_u32(r, (guint32 *) x);
+    } else if (type == GRETL_TYPE_UINT64) {
+        *err = br_get_u64(r, (guint64 *) x);
+    } else if (type == GRETL_TYPE_STRING) {
+        data = read_string(r, err);
+    } else if (type == GRETL_TYPE_SERIES) {
+        *err = br_get_length(r, size, sizeof(double));
+        if (!*err) {
+            data = malloc(*size * sizeof(double));
+            if (data == NULL) {
+                *err = E_ALLOC;
+            } else {
+                *err = br_get_doubles(r, data, *size);
+            }
+        }
+    } else if (type == GRETL_TYPE_LIST) {
+        data = read_list(r, err);
+    } else if (type == GRETL_TYPE_MATRIX) {
+        data = read_matrix(r, err);
+    } else if (type == GRETL_TYPE_BUNDLE) {
+        data = read_bundle(r, err);
+    } else if (type == GRETL_TYPE_ARRAY) {
+        data = read_array(r, err);
+    } else {
+        *err = E_DATA;
+    }
+
+    return data;
+}
+
+static gretl_array *read_array (bin_reader *r, int *err)
+{
+    gretl_array *a = NULL;
+    GretlType type, etype;
+    guint32 code = 0, present;
+    int i, n = 0;
+
+    *err = br_get_u32(r, &code);
+    if (!*err) {
+        *err = br_get_length(r, &n, 4);
+    }
+    if (*err) {
+        return NULL;
+    }
+
+    type = bin_type_for_code(code, 1);
+    etype = gretl_type_get_singular(type);
+    if (type == 0) {
+        *err = E_DATA;
+        return NULL;
+    }
+
+    a = gretl_array_new(type, n, err);
+
+    for (i=0; i<n && !*err; i++) {
+        void *data;
+
+        *err = br_get_u32(r, &present);
+        if (*err || !present) {
+            continue;
+        }
+        data = read_content(r, etype, NULL, NULL, err);
+        if (data != NULL) {
+            gretl_array_set_data(a, i, data);
+        }
+    }
+
+    if (*err && a != NULL) {
+        gretl_array_destroy(a);
+        a = NULL;
+    }
+
+    return a;
+}
+
+static gretl_bundle *read_bundle (bin_reader *r, int *err)
+{
+    gretl_bundle *b;
+    char *creator;
+    int i, nk = 0;
+
+    creator = read_string(r, err);
+    if (!*err) {
+        *err = br_get_length(r, &nk, 1);
+    }
+    if (*err) {
+        free(creator);
+        return NULL;
+    }
+
+    b = gretl_bundle_new();
+    if (b == NULL) {
+        *err = E_ALLOC;
+    } else if (*creator != '\0') {
+        gretl_bundle_set_creator(b, creator);
+    }
+    free(creator);
+
+    for (i=0; i<nk && !*err; i++) {
+        char *key = NULL, *note = NULL;
+        GretlType type = 0;
+        void *data = NULL;
+        guint32 code = 0;
+        double x[2];
+        int size = 0;
+
+        key = read_string(r, err);
+        if (!*err) note = read_string(r, err);
+        if (!*err) *err = br_get_u32(r, &code);
+        if (!*err) {
+            type = bin_type_for_code(code, 0);
+            data = read_content(r, type, x, &size, err);
+        }
+        if (!*err) {
+            if (gretl_is_scalar_type(type)) {
+                *err = gretl_bundle_set_data(b, key, x, type, 0);
+            } else {
+                *err = gretl_bundle_donate_data(b, key, data, type, size);
+            }
+        }
+        if (!*err && *note != '\0') {
+            gretl_bundle_set_note(b, key, note);
+        }
+        free(key);
+        free(note);
+    }
+
+    if (*err && b != NULL) {
+        gretl_bundle_destroy(b);
+        b = NULL;
+    }
+
+    return b;
+}
+
+/* Map @fname and check its header. On success, @r is set up for
+   reading the directory, @n holds the number of members, and the
+   creator string is written to @creator if that's non-NULL.
+*/
+
+static GMappedFile *bin_map_open (const char *fname, bin_reader *r,
+                                  guint32 *n, char **creator,
+                                  int *err)
+{
+    GMappedFile *mf;
+    GError *gerr = NULL;
+    guint32 version = 0;
+    guint64 diroff = 0;
+    char magic[8];
+    char *s = NULL;
+
+    mf = g_mapped_file_new(fname, FALSE, &gerr);
+    if (mf == NULL) {
+        gretl_errmsg_set(gerr->message);
+        g_error_free(gerr);
+        *err = E_FOPEN;
+        return NULL;
+    }
+
+    r->buf = g_mapped_file_get_contents(mf);
+    r->len = g_mapped_file_get_length(mf);
+    r->pos = 0;
+
+    *err = br_get(r, magic, 8);
+    if (!*err && memcmp(magic, BIN_MAGIC, 8)) {
+        *err = E_DATA;
+    }
+    if (!*err) *err = br_get_u32(r, &version);
+    if (!*err) *err = br_get_u32(r, n);
+    if (!*err) *err = br_get_u64(r, &diroff);
+    if (!*err && version > BIN_VERSION) {
+        gretl_errmsg_set(_("This file requires a newer version of gretl"));
+        *err = E_DATA;
+    } else if (!*err && (diroff < BIN_HDRLEN || diroff > r->len)) {
+        *err = E_DATA;
+    }
+    if (!*err) {
+        r->pos = diroff;
+        s = read_string(r, err);
+    }
+
+    if (*err) {
+        free(s);
+        g_mapped_file_unref(mf);
+        if (*err == E_DATA && *gretl_errmsg_get() == '\0') {
+            gretl_errmsg_sprintf(_("%s: not a valid gretl binary file"),
+                                 fname);
+        }
+        return NULL;
+    }
+
+    if (creator != NULL) {
+        *creator = s;
+    } else {
+        free(s);
+    }
+
+    return mf;
+}
+
+typedef int (*member_func) (const char *name, const char *note,
+                            GretlType type, void *ptr, double *x,
+                            int size, void *data);
+
+/* Read the members of the file mapped for @r, or the first one
+   named @name and/or having type code @code, if these are given,
+   and pass them to @func, which takes ownership of @ptr. Scalar
+   values are passed in @x.
+*/
+
+static int bin_foreach_member (bin_reader *r, guint32 n,
+                               const char *name, guint32 code,
+                               member_func func, void *data)
+{
+    guint32 i;
+    int found = 0;
+    int err = 0;
+
+    for (i=0; i<n && !err && !found; i++) {
+        char *ename, *mname = NULL, *note = NULL;
+        guint32 ecode = 0;
+        guint64 offset = 0, size = 0;
+        gsize dirpos;
+        GretlType type = 0;
+        void *ptr = NULL;
+        double x[2];
+        int len = 0;
+
+        ename = read_string(r, &err);
+        if (!err) err = br_get_u32(r, &ecode);
+        if (!err) err = br_get_u64(r, &offset);
+        if (!err) err = br_get_u64(r, &size);
+        if (!err && (offset > r->len || size > r->len - offset)) {
+            err = E_DATA;
+        }
+        if (err || (name != NULL && strcmp(ename, name)) ||
+            (code != 0 && ecode != code)) {
+            free(ename);
+            continue;
+        }
+        free(ename);
+
+        found = (name != NULL || code != 0);
+        dirpos = r->pos;
+        r->pos = offset;
+        mname = read_string(r, &err);
+        if (!err) note = read_string(r, &err);
+        if (!err) err = br_get_u32(r, &ecode);
+        if (!err) {
+            type = bin_type_for_code(ecode, 0);
+            ptr = read_content(r, type, x, &len, &err);
+        }
+        if (!err) {
+            err = func(mname, note, type, ptr, x, len, data);
+        }
+        free(mname);
+        free(note);
+        r->pos = dirpos;
+    }
+
+    if (!err && name != NULL && !found) {
+        gretl_errmsg_sprintf(_("%s: no such member"), name);
+        err = E_DATA;
+    }
+
+    return err;
+}
+
+struct objects_info {
+    bin_object_func func;
+    void *data;
+};
+
+static int pass_object (const char *name, const char *note,
+                        GretlType type, void *ptr, double *x,
+                        int size, void *data)
+{
+    struct objects_info *oi = data;
+
+    if (ptr == NULL) {
+        /* scalar value */
+        ptr = malloc(2 * sizeof *x);
+        if (ptr == NULL) {
+            return E_ALLOC;
+        }
+        memcpy(ptr, x, 2 * sizeof *x);
+    }
+
+    return oi->func(name, type, ptr, oi->data);
+}
+
+/**
+ * gretl_bin_read_objects:
+ * @fname: full name of file to read.
+ * @func: function to be called on each object read.
+ * @data: pointer to be passed to @func.
+ *
+ * Maps @fname, which should have been written by
+ * gretl_bin_writer_new() and gretl_bin_write_object(), into
+ * memory and calls @func on each of the objects it contains, in
+ * turn. @func takes ownership of the object; reading stops at the
+ * first non-zero return value.
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int gretl_bin_read_objects (const char *fname, bin_object_func func,
+                            void *data)
+{
+    struct objects_info oi = {func, data};
+    bin_reader r = {NULL, 0, 0};
+    GMappedFile *mf;
+    guint32 n = 0;
+    int err = 0;
+
+    mf = bin_map_open(fname, &r, &n, NULL, &err);
+    if (mf != NULL) {
+        err = bin_foreach_member(&r, n, NULL, 0, pass_object, &oi);
+        g_mapped_file_unref(mf);
+    }
+
+    return err;
+}
+
+static void bin_object_free (GretlType type, void *ptr)
+{
+    if (type == GRETL_TYPE_MATRIX) {
+        gretl_matrix_free(ptr);
+    } else if (type == GRETL_TYPE_BUNDLE) {
+        gretl_bundle_destroy(ptr);
+    } else if (type == GRETL_TYPE_ARRAY) {
+        gretl_array_destroy(ptr);
+    } else {
+        free(ptr);
+    }
+}
+
+static int grab_matrix (const char *name, const char *note,
+                        GretlType type, void *ptr, double *x,
+                        int size, void *data)
+{
+    gretl_matrix **pm = data;
+
+    if (type != GRETL_TYPE_MATRIX) {
+        bin_object_free(type, ptr);
+        gretl_errmsg_sprintf(_("%s: not a matrix"), name);
+        return E_TYPES;
+    }
+
+    *pm = ptr;
+    return 0;
+}
+
+/**
+ * gretl_bin_read_matrix:
+ * @fname: full name of file to read.
+ * @name: name of member, or NULL.
+ * @err: location to receive error code.
+ *
+ * Reads the matrix named @name, or the first matrix if @name is
+ * NULL, from @fname, which should have been written by mwrite(),
+ * bwrite() or gretl_bin_write_object(). The rest of the file is
+ * not read.
+ *
+ * Returns: the matrix, or NULL on failure.
+ */
+
+gretl_matrix *gretl_bin_read_matrix (const char *fname,
+                                     const char *name,
+                                     int *err)
+{
+    bin_reader r = {NULL, 0, 0};
+    gretl_matrix *m = NULL;
+    GMappedFile *mf;
+    guint32 n = 0;
+
+    mf = bin_map_open(fname, &r, &n, NULL, err);
+    if (mf != NULL) {
+        *err = bin_foreach_member(&r, n, name,
+                                  name == NULL ? BIN_MATRIX : 0,
+                                  grab_matrix, &m);
+        g_mapped_file_unref(mf);
+    }
+    if (!*err && m == NULL) {
+        gretl_errmsg_sprintf(_("%s: no matrix found"), fname);
+        *err = E_DATA;
+    }
+
+    return m;
+}
+
+/**
+ * gretl_is_bin_file:
+ * @fname: full name of file.
+ *
+ * Returns: 1 if @fname starts with the signature of gretl's
+ * binary format, otherwise 0.
+ */
+
+int gretl_is_bin_file (const char *fname)
+{
+    char magic[8];
+    FILE *fp;
+    int ret = 0;
+
+    fp = gretl_fopen(fname, "rb");
+    if (fp != NULL) {
+        ret = fread(magic, 1, 8, fp) == 8 &&
+            !memcmp(magic, BIN_MAGIC, 8);
+        fclose(fp);
+    }
+
+    return ret;
+}
+
+/**
+ * gretl_bin_writable:
+ * @type: type of object.
+ * @ptr: pointer to object.
+ *
+ * Returns: 1 if the object at @ptr can be written in binary
+ * format, otherwise 0. This is the case for all objects of the
+ * types supported except for bundles containing state-space
+ * (Kalman) bundles, which are handled by XML only.
+ */
+
+int gretl_bin_writable (GretlType type, void *ptr)
+{
+    int i, n, ok = 1;
+
+    if (bin_code_for_type(type, 0) == 0) {
+        return 0;
+    }
+
+    if (type == GRETL_TYPE_BUNDLE) {
+        gretl_bundle *b = ptr;
+        gretl_array *keys;
+        int err = 0;
+
+        if (gretl_bundle_get_type(b) == BUNDLE_KALMAN) {
+            return 0;
+        }
+        keys = gretl_bundle_get_keys(b, &err);
+        n = (keys == NULL)? 0 : gretl_array_get_length(keys);
+        for (i=0; i<n && ok; i++) {
+            const char *key = gretl_array_get_data(keys, i);
+            GretlType t = 0;
+            void *data = gretl_bundle_get_data(b, key, &t, NULL, &err);
+
+            ok = gretl_bin_writable(t, data);
+        }
+        gretl_array_destroy(keys);
+    } else if (type == GRETL_TYPE_ARRAY) {
+        GretlType etype = gretl_array_get_content_type(ptr);
+
+        if (etype == GRETL_TYPE_BUNDLE || etype == GRETL_TYPE_ARRAY) {
+            n = gretl_array_get_length(ptr);
+            for (i=0; i<n && ok; i++) {
+                void *data = gretl_array_get_data(ptr, i);
+
+                ok = data == NULL || gretl_bin_writable(etype, data);
+            }
+        }
+    }
+
+    return ok;
+}
+
+/**
+ * gretl_bundle_write_binary:
+ * @b: bundle.
+ * @fname: full name of file to write.
+ *
+ * Writes @b to @fname in gretl's binary format, with each of
+ * the members of @b as a member of the container.
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int gretl_bundle_write_binary (gretl_bundle *b, const char *fname)
+{
+    gretl_bin_writer *w;
+    gretl_array *keys = NULL;
+    int i, nk = gretl_bundle_get_n_keys(b);
+    int cerr, err = 0;
+
+    if (!gretl_bin_writable(GRETL_TYPE_BUNDLE, b)) {
+        gretl_errmsg_set(_("Kalman bundles cannot be written in "
+                           "binary format"));
+        return E_TYPES;
+    }
+
+    if (nk > 0) {
+        keys = gretl_bundle_get_keys(b, &err);
+        if (err) {
+            return err;
+        }
+    }
+
+    w = gretl_bin_writer_new(fname, &err);
+
+    if (w != NULL) {
+        w->creator = gretl_strdup(gretl_bundle_get_creator(b));
+        for (i=0; i<nk && !err; i++) {
+            const char *key = gretl_array_get_data(keys, i);
+            GretlType type = 0;
+            void *data;
+            int size = 0;
+
+            data = gretl_bundle_get_data(b, key, &type, &size, &err);
+            if (!err) {
+                err = write_member(w, key, gretl_bundle_get_note(b, key),
+                                   type, data, size);
+            }
+        }
+        cerr = gretl_bin_writer_close(w);
+        if (!err) {
+            err = cerr;
+        }
+    }
+
+    gretl_array_destroy(keys);
+
+    return err;
+}
+
+static int add_to_bundle (const char *name, const char *note,
+                          GretlType type, void *ptr, double *x,
+                          int size, void *data)
+{
+    gretl_bundle *b = data;
+    int err;
+
+    if (ptr == NULL) {
+        err = gretl_bundle_set_data(b, name, x, type, 0);
+    } else {
+        err = gretl_bundle_donate_data(b, name, ptr, type, size);
+    }
+    if (!err && *note != '\0') {
+        gretl_bundle_set_note(b, name, note);
+    }
+
+    return err;
+}
+
+/**
+ * gretl_bundle_read_binary:
+ * @fname: full name of file to read.
+ * @err: location to receive error code.
+ *
+ * Reads a bundle from @fname, which should have been written by
+ * gretl_bundle_write_binary(). Each member of the container
+ * becomes a member of the bundle.
+ *
+ * Returns: the bundle, or NULL on failure.
+ */
+
+gretl_bundle *gretl_bundle_read_binary (const char *fname, int *err)
+{
+    bin_reader r = {NULL, 0, 0};
+    gretl_bundle *b = NULL;
+    char *creator = NULL;
+    GMappedFile *mf;
+    guint32 n = 0;
+
+    mf = bin_map_open(fname, &r, &n, &creator, err);
+    if (mf == NULL) {
+        return NULL;
+    }
+
+    b = gretl_bundle_new();
+    if (b == NULL) {
+        *err = E_ALLOC;
+    } else {
+        if (*creator != '\0') {
+            gretl_bundle_set_creator(b, creator);
+        }
+        *err = bin_foreach_member(&r, n, NULL, 0, add_to_bundle, b);
+    }
+
+    g_mapped_file_unref(mf);
+    free(creator);
+
+    if (*err && b != NULL) {
+        gretl_bundle_destroy(b);
+        b = NULL;
+    }
+
+    return b;
+}
@@ -0,0 +1,51 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GRETL_BINIO_H
+#define GRETL_BINIO_H
+
+typedef struct gretl_bin_writer_ gretl_bin_writer;
+
+/* callback for reading: takes ownership of @ptr */
+typedef int (*bin_object_func) (const char *name, GretlType type,
+                                void *ptr, void *data);
+
+gretl_bin_writer *gretl_bin_writer_new (const char *fname, int *err);
+
+int gretl_bin_write_object (gretl_bin_writer *w, const char *name,
+                            GretlType type, void *ptr);
+
+int gretl_bin_writer_close (gretl_bin_writer *w);
+
+int gretl_bin_read_objects (const char *fname, bin_object_func func,
+                            void *data);
+
+gretl_matrix *gretl_bin_read_matrix (const char *fname,
+                                     const char *name,
+                                     int *err);
+
+int gretl_is_bin_file (const char *fname);
+
+int gretl_bin_writable (GretlType type, void *ptr);
+
+int gretl_bundle_write_binary (gretl_bundle *b, const char *fname);
+
+gretl_bundle *gretl_bundle_read_binary (const char *fname, int *err);
+
+#endif /* GRETL_BINIO_H */
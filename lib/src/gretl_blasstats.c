@@ -0,0 +1,200 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* gretl_blasstats.c: counts of the calls to the main BLAS and
+   LAPACK routines made via gretl_matrix.c, switched on via
+   "set blas_stats on". For each routine we record the number of
+   calls and the time spent, by the size of the call measured as
+   the (approximate) number of floating-point operations, in
+   decades. This shows whether a script spends its time in a few
+   large calls, where the choice of BLAS matters, or in very many
+   small ones, where call overhead dominates.
+*/
+
+#include "libgretl.h"
+#include "gretl_blasstats.h"
+
+#ifndef WIN32
+# include <time.h>
+#endif
+
+/* flop-count classes: < 1e3, 1e3 to 1e4, ..., >= 1e9 */
+#define N_SIZES 8
+
+typedef struct blascount_ blascount;
+
+struct blascount_ {
+    gint64 calls;
+    gint64 ns;
+};
+
+static const char *routine_names[BLAS_N_ROUTINES] = {
+    "dgemm", "dsyrk", "dpotrf", "dgeqrf", "dgesdd", "dgesvd"
+};
+
+static const char *size_names[N_SIZES] = {
+    "< 1e3", "1e3-1e4", "1e4-1e5", "1e5-1e6", "1e6-1e7",
+    "1e7-1e8", "1e8-1e9", ">= 1e9"
+};
+
+static int blastrack;
+static int have_stats;
+static blascount counts[BLAS_N_ROUTINES][N_SIZES];
+
+static gint64 now_ns (void)
+{
+#ifdef WIN32
+    return g_get_monotonic_time() * 1000;
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (gint64) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+int gretl_blasstats_on (void)
+{
+    return blastrack;
+}
+
+void gretl_blasstats_start (void)
+{
+    memset(counts, 0, sizeof counts);
+    blastrack = have_stats = 1;
+}
+
+void gretl_blasstats_stop (void)
+{
+    blastrack = 0;
+}
+
+/**
+ * gretl_blasstats_begin:
+ *
+ * To be called just before a BLAS or LAPACK routine.
+ *
+ * Returns: a timestamp to be passed to gretl_blasstats_end(),
+ * or 0 if call counting is not switched on.
+ */
+
+gint64 gretl_blasstats_begin (void)
+{
+    return blastrack ? now_ns() : 0;
+}
+
+/**
+ * gretl_blasstats_end:
+ * @r: the routine that was called.
+ * @flops: approximate number of floating-point operations.
+ * @t0: value returned by gretl_blasstats_begin().
+ *
+ * Records a call to @r. The calls may be made in OpenMP worker
+ * threads, hence the atomic updates.
+ */
+
+void gretl_blasstats_end (BlasRoutine r, double flops, gint64 t0)
+{
+    blascount *bc;
+    gint64 dt;
+    int i = 0;
+
+    if (t0 == 0 || !blastrack) {
+        return;
+    }
+
+    dt = now_ns() - t0;
+    while (i < N_SIZES - 1 && flops >= 1000) {
+        flops /= 10;
+        i++;
+    }
+    bc = &counts[r][i];
+
+#if defined(__GNUC__)
+    __atomic_add_fetch(&bc->calls, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&bc->ns, dt, __ATOMIC_RELAXED);
+#else
+    bc->calls += 1;
+    bc->ns += dt;
+#endif
+}
+
+/**
+ * gretl_blasstats_report:
+ * @prn: printing struct.
+ *
+ * Prints, for each routine called since counting was last
+ * switched on, the number of calls and the time spent by size
+ * of call; does nothing if there are no such figures or they
+ * have already been reported.
+ *
+ * Returns: 0.
+ */
+
+int gretl_blasstats_report (PRN *prn)
+{
+    int r, i, any = 0;
+
+    if (!have_stats) {
+        return 0;
+    }
+
+    pprintf(prn, "\n%s (%s", _("BLAS/LAPACK calls"), blas_variant_string());
+    if (blas_is_threaded()) {
+        pprintf(prn, ", %d threads", blas_get_num_threads());
+    }
+    pputs(prn, ")\n");
+
+    for (r=0; r<BLAS_N_ROUTINES; r++) {
+        gint64 calls = 0, ns = 0;
+
+        for (i=0; i<N_SIZES; i++) {
+            calls += counts[r][i].calls;
+            ns += counts[r][i].ns;
+        }
+        if (calls == 0) {
+            continue;
+        }
+        any = 1;
+        pprintf(prn, "\n%s: %" G_GINT64_FORMAT " %s, %.4f s\n",
+                routine_names[r], calls, _("calls"), ns / 1.0e9);
+        pprintf(prn, "  %-9s %12s %7s %12s %7s %10s\n", "flops",
+                _("calls"), "%", _("seconds"), "%", _("usec/call"));
+        for (i=0; i<N_SIZES; i++) {
+            blascount *bc = &counts[r][i];
+
+            if (bc->calls > 0) {
+                pprintf(prn, "  %-9s %12" G_GINT64_FORMAT " %6.1f%% "
+                        "%12.4f %6.1f%% %10.2f\n", size_names[i],
+                        bc->calls, 100.0 * bc->calls / calls,
+                        bc->ns / 1.0e9, ns > 0 ? 100.0 * bc->ns / ns : 0,
+                        bc->ns / 1.0e3 / bc->calls);
+            }
+        }
+    }
+
+    if (!any) {
+        pprintf(prn, "%s\n", _("no calls recorded"));
+    }
+    pputc(prn, '\n');
+
+    have_stats = 0;
+
+    return 0;
+}
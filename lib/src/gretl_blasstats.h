@@ -0,0 +1,45 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GRETL_BLASSTATS_H
+#define GRETL_BLASSTATS_H
+
+typedef enum {
+    BLAS_DGEMM,
+    BLAS_DSYRK,
+    BLAS_DPOTRF,
+    BLAS_DGEQRF,
+    BLAS_DGESDD,
+    BLAS_DGESVD,
+    BLAS_N_ROUTINES
+} BlasRoutine;
+
+int gretl_blasstats_on (void);
+
+void gretl_blasstats_start (void);
+
+void gretl_blasstats_stop (void);
+
+gint64 gretl_blasstats_begin (void);
+
+void gretl_blasstats_end (BlasRoutine r, double flops, gint64 t0);
+
+int gretl_blasstats_report (PRN *prn);
+
+#endif /* GRETL_BLASSTATS_H */
@@ -35,6 +35,9 @@
 #include "libset.h"
 #include "build.h"
 #include "gretl_bundle.h"
+#include "gretl_memstats.h"
+#include "gretl_binio.h"
+#include "gretl_strhash.h"
 
 #ifdef G_OS_WIN32
 # include "gretl_win32.h"
@@ -50,7 +53,7 @@
 
 struct gretl_bundle_ {
     BundleType type; /* see enum in gretl_bundle.h */
-    GHashTable *ht;  /* holds key/value pairs */
+    gretl_strhash *ht; /* holds key/value pairs */
     char *creator;   /* name of function that built the bundle */
     void *data;      /* holds pointer to struct for some uses */
 };
@@ -76,7 +79,7 @@ int gretl_bundle_get_n_keys (gretl_bundle *b)
     int n_items = 0;
 
     if (b != NULL && b->ht != NULL) {
-        n_items = g_hash_table_size(b->ht);
+        n_items = gretl_strhash_size(b->ht);
     }
 
     return n_items;
@@ -94,7 +97,7 @@ int gretl_bundle_get_n_members (gretl_bundle *b)
             nmemb += kalman_bundle_n_members(b);
         }
         if (b->ht != NULL) {
-            nmemb += g_hash_table_size(b->ht);
+            nmemb += gretl_strhash_size(b->ht);
         }
     }
 
@@ -119,7 +122,7 @@ GList *gretl_bundle_get_lists (gretl_bundle *b)
 {
     GList *list = NULL;
 
-    g_hash_table_foreach(b->ht, maybe_append_list, &list);
+    gretl_strhash_foreach(b->ht, maybe_append_list, &list);
 
     return list;
 }
@@ -130,7 +133,7 @@ int gretl_bundle_has_content (gretl_bundle *b)
 
     if (b != NULL && b->ht != NULL &&
         (b->type == BUNDLE_KALMAN ||
-         g_hash_table_size(b->ht) > 0)) {
+         gretl_strhash_size(b->ht) > 0)) {
         ret = 1;
     }
 
@@ -168,36 +171,20 @@ static int bundled_item_copy_in_data (bundled_item *item,
 
     switch (item->type) {
     case GRETL_TYPE_DOUBLE:
-        item->data = malloc(sizeof(double));
-        if (item->data != NULL) {
-            double *dp = item->data;
-
-            *dp = *(double *) ptr;
-        }
+        item->val.x = *(double *) ptr;
+        item->data = &item->val;
         break;
     case GRETL_TYPE_INT:
-        item->data = malloc(sizeof(int));
-        if (item->data != NULL) {
-            int *ip = item->data;
-
-            *ip = *(int *) ptr;
-        }
+        item->val.k = *(int *) ptr;
+        item->data = &item->val;
         break;
     case GRETL_TYPE_UINT32:
-        item->data = malloc(sizeof(uint32_t));
-        if (item->data != NULL) {
-            uint32_t *up = item->data;
-
-            *up = *(uint32_t *) ptr;
-        }
+        item->val.u32 = *(uint32_t *) ptr;
+        item->data = &item->val;
         break;
     case GRETL_TYPE_UINT64:
-        item->data = malloc(sizeof(uint64_t));
-        if (item->data != NULL) {
-            uint64_t *up = item->data;
-
-            *up = *(uint64_t *) ptr;
-        }
+        item->val.u64 = *(uint64_t *) ptr;
+        item->data = &item->val;
         break;
     case GRETL_TYPE_STRING:
         item->data = gretl_strdup((char *) ptr);
@@ -278,11 +265,29 @@ static void bundled_item_free_data (GretlType type, void *data)
         gretl_bundle_destroy((gretl_bundle *) data);
     } else if (type == GRETL_TYPE_ARRAY) {
         gretl_array_destroy((gretl_array *) data);
-    } else {
+    } else if (!bundled_scalar(type)) {
+        /* scalars are stored within the item itself */
         free(data);
     }
 }
 
+/* return a newly allocated copy of the value of a scalar item */
+
+static void *bundled_scalar_copy (bundled_item *item)
+{
+    size_t sz = item->type == GRETL_TYPE_DOUBLE ? sizeof(double) :
+        item->type == GRETL_TYPE_UINT64 ? sizeof(uint64_t) :
+        item->type == GRETL_TYPE_UINT32 ? sizeof(uint32_t) :
+        sizeof(int);
+    void *ret = malloc(sz);
+
+    if (ret != NULL) {
+        memcpy(ret, item->data, sz);
+    }
+
+    return ret;
+}
+
 /* Note: we come here only if the replacement type is the
    same as the original type, apart from the case of
    inter-conversion of the various scalar types.
@@ -394,13 +399,14 @@ void gretl_bundle_destroy (gretl_bundle *bundle)
 {
     if (bundle != NULL) {
         if (bundle->ht != NULL) {
-            g_hash_table_destroy(bundle->ht);
+            gretl_strhash_destroy(bundle->ht);
         }
         free(bundle->creator);
         if (bundle->type == BUNDLE_KALMAN) {
             kalman_free(bundle->data);
         }
         free(bundle);
+        gretl_memstats_object(GRETL_TYPE_BUNDLE, -1);
     }
 }
 
@@ -422,10 +428,8 @@ void gretl_bundle_void_content (gretl_bundle *bundle)
         bundle->creator = NULL;
     }
 
-    if (bundle->ht != NULL && g_hash_table_size(bundle->ht) > 0) {
-        g_hash_table_destroy(bundle->ht);
-        bundle->ht = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                           NULL, bundle_item_destroy);
+    if (bundle->ht != NULL) {
+        gretl_strhash_remove_all(bundle->ht);
     }
 
     if (bundle->type == BUNDLE_KALMAN) {
@@ -447,10 +451,10 @@ gretl_bundle *gretl_bundle_new (void)
 
     if (b != NULL) {
         b->type = BUNDLE_PLAIN;
-        b->ht = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                      NULL, bundle_item_destroy);
+        b->ht = gretl_strhash_new(bundle_item_destroy);
         b->creator = NULL;
         b->data = NULL;
+        gretl_memstats_object(GRETL_TYPE_BUNDLE, 1);
     }
 
     return b;
@@ -467,6 +471,10 @@ int gretl_is_bundle (const char *name)
  * get_bundle_by_name:
  * @name: the name to look up.
  *
+ * Note that a bundle function argument that is sharing its
+ * data with the calling function is first given its own copy,
+ * since the caller may modify the bundle.
+ *
  * Returns: pointer to a saved bundle, if found, else NULL.
  */
 
@@ -477,7 +485,7 @@ gretl_bundle *get_bundle_by_name (const char *name)
     if (name != NULL && *name != '\0') {
         user_var *u = get_user_var_of_type_by_name(name, GRETL_TYPE_BUNDLE);
 
-        if (u != NULL) {
+        if (u != NULL && user_var_unshare(u) == 0) {
             b = user_var_get_value(u);
         }
     }
@@ -487,7 +495,7 @@ gretl_bundle *get_bundle_by_name (const char *name)
 
 static int gretl_bundle_has_data (gretl_bundle *b, const char *key)
 {
-    gpointer p = g_hash_table_lookup(b->ht, key);
+    gpointer p = gretl_strhash_lookup(b->ht, key);
 
     return (p != NULL);
 }
@@ -521,7 +529,7 @@ static void *real_bundle_get_data (gretl_bundle *bundle,
 
     if (!myerr && ret == NULL && !private) {
         /* try for a regular bundle member */
-        gpointer p = g_hash_table_lookup(bundle->ht, key);
+        gpointer p = gretl_strhash_lookup(bundle->ht, key);
 
         if (p != NULL) {
             bundled_item *item = p;
@@ -654,33 +662,26 @@ void *gretl_bundle_steal_data (gretl_bundle *bundle, const char *key,
             *err = E_DATA;
         }
     } else {
-        gpointer p = g_hash_table_lookup(bundle->ht, key);
+        gpointer p = gretl_strhash_lookup(bundle->ht, key);
 
         if (p != NULL) {
-            GList *keys = g_hash_table_get_keys(bundle->ht);
             bundled_item *item = p;
-            gchar *keycpy = NULL;
 
-            ret = item->data;
+            if (bundled_scalar(item->type)) {
+                /* the value is stored within @item */
+                ret = bundled_scalar_copy(item);
+            } else {
+                ret = item->data;
+            }
             if (type != NULL) {
                 *type = item->type;
             }
             if (size != NULL) {
                 *size = item->size;
             }
-            while (keys) {
-                if (!strcmp(keys->data, key)) {
-                    keycpy = keys->data;
-                    break;
-                } else if (keys->next) {
-                    keys = keys->next;
-                } else {
-                    break;
-                }
-            }
-            g_hash_table_steal(bundle->ht, key);
-            g_free(keycpy);
-            g_list_free(keys);
+            gretl_strhash_steal(bundle->ht, key);
+            g_free(item->key);
+            free(item->note);
             free(item);
         } else if (err != NULL) {
             gretl_errmsg_sprintf("\"%s\": %s", key, _("no such item"));
@@ -731,7 +732,7 @@ GretlType gretl_bundle_get_member_type (gretl_bundle *bundle,
 
     if (!myerr && ret == GRETL_TYPE_NONE && !private) {
         /* try for a regular bundle member */
-        gpointer p = g_hash_table_lookup(bundle->ht, key);
+        gpointer p = gretl_strhash_lookup(bundle->ht, key);
 
         if (p != NULL) {
             bundled_item *item = p;
@@ -765,7 +766,7 @@ int gretl_bundle_has_key (gretl_bundle *bundle,
     int ret = 0;
 
     if (bundle != NULL && key != NULL) {
-        gpointer p = g_hash_table_lookup(bundle->ht, key);
+        gpointer p = gretl_strhash_lookup(bundle->ht, key);
 
         ret = (p != NULL);
     }
@@ -1360,7 +1361,7 @@ const char *gretl_bundle_get_note (gretl_bundle *bundle,
     const char *ret = NULL;
 
     if (bundle != NULL) {
-        gpointer p = g_hash_table_lookup(bundle->ht, key);
+        gpointer p = gretl_strhash_lookup(bundle->ht, key);
 
         if (p != NULL) {
             bundled_item *item = p;
@@ -1390,7 +1391,7 @@ const char *gretl_bundle_get_creator (gretl_bundle *bundle)
  * @bundle: bundle to access.
  *
  * Returns: the content of @bundle, which is in fact
- * a GHashTable object.
+ * a gretl_strhash table mapping keys to bundled_items.
  */
 
 void *gretl_bundle_get_content (gretl_bundle *bundle)
@@ -1441,25 +1442,24 @@ static int real_bundle_set_data (gretl_bundle *b, const char *key,
     }
 
     if (!done && !err) {
-        bundled_item *item = g_hash_table_lookup(b->ht, key);
-        int replace = 0;
-
-        if (item != NULL) {
-            replace = 1;
-            if (item->type == type) {
-                /* we can take a shortcut */
-                return bundled_item_replace_data(item, ptr, type, size, copy);
-            }
+        bundled_item *item = gretl_strhash_lookup(b->ht, key);
+
+        if (item != NULL && item->type == type) {
+            /* we can take a shortcut */
+            return bundled_item_replace_data(item, ptr, type, size, copy);
         }
 
         item = bundled_item_new(type, ptr, size, copy, note, &err);
 
         if (!err) {
             item->key = g_strdup(key);
-            if (replace) {
-                g_hash_table_replace(b->ht, item->key, item);
-            } else {
-                g_hash_table_insert(b->ht, item->key, item);
+            err = gretl_strhash_insert(b->ht, item->key, item);
+            if (err) {
+                if (!copy && !bundled_scalar(type)) {
+                    /* the data still belong to the caller */
+                    item->data = NULL;
+                }
+                bundle_item_destroy(item);
             }
         }
     }
@@ -1714,7 +1714,7 @@ int gretl_bundle_delete_data (gretl_bundle *bundle, const char *key)
     }
 
     if (!done && !err) {
-        done = g_hash_table_remove(bundle->ht, key);
+        done = gretl_strhash_remove(bundle->ht, key);
         if (!done) {
             err = E_DATA;
         }
@@ -1747,16 +1747,19 @@ int gretl_bundle_rekey_data (gretl_bundle *bundle,
     }
 
     if (bundle != NULL) {
-        item = g_hash_table_lookup(bundle->ht, oldkey);
+        item = gretl_strhash_lookup(bundle->ht, oldkey);
     }
 
     if (item == NULL) {
         err = E_DATA;
     } else {
-        g_hash_table_steal(bundle->ht, oldkey);
+        gretl_strhash_steal(bundle->ht, oldkey);
         g_free(item->key);
         item->key = g_strdup(newkey);
-        g_hash_table_insert(bundle->ht, item->key, item);
+        err = gretl_strhash_insert(bundle->ht, item->key, item);
+        if (err) {
+            bundle_item_destroy(item);
+        }
     }
 
     return err;
@@ -1782,7 +1785,7 @@ int gretl_bundle_set_note (gretl_bundle *bundle, const char *key,
     if (bundle == NULL) {
         err = E_UNKVAR;
     } else {
-        gpointer p = g_hash_table_lookup(bundle->ht, key);
+        gpointer p = gretl_strhash_lookup(bundle->ht, key);
 
         if (p == NULL) {
             err = E_DATA;
@@ -1882,7 +1885,7 @@ gretl_bundle *gretl_bundle_union (const gretl_bundle *bundle1,
     }
 
     if (!*err) {
-        g_hash_table_foreach(bundle2->ht, copy_new_bundled_item, b);
+        gretl_strhash_foreach(bundle2->ht, copy_new_bundled_item, b);
     }
 
     return b;
@@ -2124,7 +2127,7 @@ static void check_bundled_item (gpointer key, gpointer value, gpointer p)
     }
 
     /* look up @key (from input) in the template bundle */
-    targ = g_hash_table_lookup(bc->b->ht, (const char *) key);
+    targ = gretl_strhash_lookup(bc->b->ht, (const char *) key);
 
     if (targ == NULL) {
         /* extraneous key in input */
@@ -2237,7 +2240,7 @@ int gretl_bundle_extract_args (gretl_bundle *defaults,
         bchecker *bc = bchecker_new(defaults, &ret, err, ignore, prn);
 
         if (bc != NULL) {
-            g_hash_table_foreach(input->ht, check_bundled_item, bc);
+            gretl_strhash_foreach(input->ht, check_bundled_item, bc);
             bchecker_free(bc);
         }
     }
@@ -2253,7 +2256,7 @@ int gretl_bundle_append (gretl_bundle *bundle1,
                            "be a kalman bundle"));
         return E_DATA;
     } else {
-        g_hash_table_foreach(bundle2->ht, copy_new_bundled_item, bundle1);
+        gretl_strhash_foreach(bundle2->ht, copy_new_bundled_item, bundle1);
         return 0;
     }
 }
@@ -2283,7 +2286,7 @@ gretl_bundle *gretl_bundle_copy (const gretl_bundle *bundle, int *err)
             }
         }
         if (!*err) {
-            g_hash_table_foreach(bundle->ht, copy_bundled_item, bcpy);
+            gretl_strhash_foreach(bundle->ht, copy_bundled_item, bcpy);
         }
     }
 
@@ -2480,7 +2483,7 @@ static int real_bundle_print (gretl_bundle *bundle, int indent,
 
     if (indent > 0) {
         /* child, when printing tree */
-        int n_items = g_hash_table_size(bundle->ht);
+        int n_items = gretl_strhash_size(bundle->ht);
 
         if (bundle->type == BUNDLE_PLAIN && n_items == 0) {
             pputs(prn, "empty\n");
@@ -2494,7 +2497,7 @@ static int real_bundle_print (gretl_bundle *bundle, int indent,
             g_list_foreach(L, print_bundled_item, &bip);
         }
     } else {
-        int n_items = g_hash_table_size(bundle->ht);
+        int n_items = gretl_strhash_size(bundle->ht);
         user_var *u = get_user_var_by_data(bundle);
         const char *name = NULL;
 
@@ -2551,7 +2554,7 @@ static int print_bundle_tree (gretl_bundle *b, int level, PRN *prn)
 
     for (i=0; i<n; i++) {
         key = keys[i];
-        item = g_hash_table_lookup(b->ht, key);
+        item = gretl_strhash_lookup(b->ht, key);
         if (item->type == GRETL_TYPE_BUNDLE) {
             nmemb = gretl_bundle_get_n_members(item->data);
             bufspace(2*(level+1), prn);
@@ -2667,13 +2670,13 @@ static void write_item_constructor (gpointer value, gpointer p)
 
 gchar *gretl_bundle_write_constructor (gretl_bundle *bundle)
 {
-    int n_items = g_hash_table_size(bundle->ht);
+    int n_items = gretl_strhash_size(bundle->ht);
     gchar *ret = NULL;
 
     if (n_items == 0) {
 	return g_strdup("_()");
     } else {
-	GList *L = g_hash_table_get_values(bundle->ht);
+	GList *L = gretl_strhash_get_values(bundle->ht);
 	gsize sz = 4 + 8 * n_items;
 	GString *gs;
 
@@ -2873,7 +2876,7 @@ void gretl_bundle_serialize (gretl_bundle *b, const char *name,
     }
 
     if (b->ht != NULL) {
-        g_hash_table_foreach(b->ht, xml_put_bundled_item, prn);
+        gretl_strhash_foreach(b->ht, xml_put_bundled_item, prn);
     }
 
     pputs(prn, "</gretl-bundle>\n");
@@ -3100,6 +3103,10 @@ int gretl_bundle_write_to_file (gretl_bundle *b,
         return call_bundle_to_json(b, fullname, control, NULL);
     }
 
+    if (has_suffix(fname, ".bin")) {
+        return gretl_bundle_write_binary(b, fullname);
+    }
+
     if (has_suffix(fname, ".gz")) {
         prn = gretl_gzip_print_new(fullname, -1, &err);
     } else {
@@ -3225,6 +3232,8 @@ gretl_bundle *gretl_bundle_read_from_file (const char *fname,
         b = read_json_bundle(fullname, err);
     } else if (has_suffix(fname, ".shp")) {
         b = read_shapefile_bundle(fullname, err);
+    } else if (has_suffix(fname, ".bin")) {
+        b = gretl_bundle_read_binary(fullname, err);
     } else {
         *err = gretl_xml_open_doc_root(fullname, "gretl-bundle", &doc, &cur);
         if (!*err) {
@@ -3288,7 +3297,7 @@ gretl_array *gretl_bundle_get_keys (gretl_bundle *b, int *err)
     if (b == NULL || b->ht == NULL) {
         myerr = E_DATA;
     } else {
-        GList *keys = g_hash_table_get_keys(b->ht);
+        GList *keys = gretl_strhash_get_keys(b->ht);
         guint n;
 
         if (keys != NULL && (n = g_list_length(keys)) > 0) {
@@ -3328,7 +3337,7 @@ char **gretl_bundle_get_keys_raw (gretl_bundle *b, int *ns)
     *ns = 0;
 
     if (b != NULL && b->ht != NULL) {
-        GList *keys = g_hash_table_get_keys(b->ht);
+        GList *keys = gretl_strhash_get_keys(b->ht);
         guint n;
 
         if (keys != NULL && (n = g_list_length(keys)) > 0) {
@@ -3419,6 +3428,7 @@ gretl_bundle *get_sysinfo_bundle (int *err)
 				     GRETL_TYPE_STRING, 0);
             ival = avx_support();
             gretl_bundle_set_scalar(b, "avx", (double) ival);
+            gretl_bundle_set_string(b, "simd", gretl_matrix_simd_id());
 	    /* information pertaining to 'foreign' programs */
             fb = foreign_info();
             if (fb != NULL) {
@@ -3441,6 +3451,28 @@ gretl_bundle *get_sysinfo_bundle (int *err)
                                  GRETL_TYPE_MATRIX, 0);
     }
 
+    if (libset_get_bool(MATRIX_POOL)) {
+        gretl_matrix *pv = gretl_matrix_alloc(1, 3);
+
+        if (pv != NULL) {
+            char **S = malloc(3 * sizeof *S);
+            guint64 hits, misses;
+
+            gretl_matrix_pool_get_stats(&hits, &misses);
+            pv->val[0] = hits;
+            pv->val[1] = misses;
+            pv->val[2] = hits + misses > 0 ? hits / (double) (hits + misses) : 0;
+            S[0] = gretl_strdup("hits");
+            S[1] = gretl_strdup("misses");
+            S[2] = gretl_strdup("rate");
+            gretl_matrix_set_colnames(pv, S);
+            gretl_bundle_donate_data(sysinfo_bundle, "matrix_pool", pv,
+                                     GRETL_TYPE_MATRIX, 0);
+        }
+    } else if (gretl_bundle_has_key(sysinfo_bundle, "matrix_pool")) {
+        gretl_bundle_delete_data(sysinfo_bundle, "matrix_pool");
+    }
+
     return sysinfo_bundle;
 }
 
@@ -3705,7 +3737,7 @@ GList *gretl_bundle_get_sorted_items (gretl_bundle *b)
 {
     GList *blist;
 
-    blist = g_hash_table_get_values(b->ht);
+    blist = gretl_strhash_get_values(b->ht);
     blist = g_list_sort(blist, sort_bundled_items);
 
     return blist;
@@ -3714,7 +3746,7 @@ GList *gretl_bundle_get_sorted_items (gretl_bundle *b)
 int gretl_bundles_are_equal (gretl_bundle *b1,
 			     gretl_bundle *b2)
 {
-    GList *k1 = g_hash_table_get_keys(b1->ht);
+    GList *k1 = gretl_strhash_get_keys(b1->ht);
     void *v1, *v2;
     const char *s1;
     GretlType t1, t2;
@@ -3780,7 +3812,7 @@ int gretl_bundles_are_equal (gretl_bundle *b1,
     }
 
     if (ret) {
-	GList *k2 = g_hash_table_get_keys(b2->ht);
+	GList *k2 = gretl_strhash_get_keys(b2->ht);
 
 	while (k2 != NULL && ret) {
 	    if (!gretl_bundle_has_key(b1, k2->data)) {
@@ -45,6 +45,12 @@ struct bundled_item_ {
     gpointer data;
     char *note;
     char *key;
+    union {
+        double x;
+        int k;
+        guint32 u32;
+        guint64 u64;
+    } val; /* storage for scalar types: @data points here */
 };
 
 gretl_bundle *gretl_bundle_new (void);
@@ -35,54 +35,221 @@
 
 #define cna(z) (na(creal(z)) || na(cimag(z)))
 
-/* helper function for fftw-based real FFT functions */
+/* Cache of FFTW plans, keyed on transform length, number of
+   columns and kind of transform, so that repeated transforms of
+   equally long series do not pay the planning cost on each call.
+   Each plan transforms all the columns of a matrix at once, and
+   is made on its own aligned workspace. When the storage of the
+   matrices in question has the same alignment, the plan is run
+   directly on that storage via FFTW's new-array interface;
+   otherwise the data are passed through the workspace.
+
+   The cache is common to all threads. Since FFTW's planner is not
+   thread-safe, access to the cache and the making and destruction
+   of plans are serialized; a cached plan is marked as in use
+   between fft_plan_get() and fft_plan_release(), so that its
+   workspace has only one user at a time, while the transforms
+   themselves run concurrently.
+*/
+
+enum {
+    FFT_R2C,     /* real to half-complex */
+    FFT_C2R,     /* half-complex to real */
+    FFT_C2C_FWD, /* complex, forward */
+    FFT_C2C_BWD  /* complex, backward */
+};
+
+#define FFT_CACHE_SIZE 8
+#define FFT_CACHE_MAXDIM 1048576 /* max elements in a cached workspace */
+
+typedef struct fft_plan_ fft_plan;
+
+struct fft_plan_ {
+    int n;            /* length of transform */
+    int howmany;      /* number of columns */
+    int kind;         /* one of the enum values above */
+    int nz;           /* complex elements per column */
+    fftw_plan p;      /* the plan itself */
+    double complex *z; /* complex workspace */
+    void *x;          /* real, or complex output, workspace */
+    guint64 stamp;    /* last-used stamp, for replacement */
+    int busy;         /* currently in use? */
+};
 
-static int fft_allocate (double **ffx, double complex **ffz,
-                         gretl_matrix **ret, int r, int c,
-                         int inverse)
+static fft_plan fft_cache[FFT_CACHE_SIZE];
+static guint64 fft_clock;
+
+G_LOCK_DEFINE_STATIC(fft_cache);
+
+#define fft_is_real(k) (k == FFT_R2C || k == FFT_C2R)
+#define fft_aligned(v) (fftw_alignment_of((double *) v) == 0)
+
+static void fft_plan_clear (fft_plan *e)
 {
-    /* real workspace, per series */
-    *ffx = fftw_malloc(r * sizeof **ffx);
-    if (*ffx == NULL) {
-        return E_ALLOC;
+    if (e->p != NULL) {
+        fftw_destroy_plan(e->p);
     }
+    fftw_free(e->z);
+    fftw_free(e->x);
+    memset(e, 0, sizeof *e);
+}
+
+static int fft_plan_make (fft_plan *e, int n, int howmany, int kind)
+{
+    size_t xsize;
+    int nz;
 
-    /* complex workspace, per series */
-    *ffz = fftw_malloc((r/2 + 1 + r % 2) * sizeof **ffz);
-    if (*ffz == NULL) {
-        free(*ffx);
+    nz = fft_is_real(kind) ? n/2 + 1 : n;
+    xsize = fft_is_real(kind) ? sizeof(double) : sizeof(double complex);
+
+    e->z = fftw_malloc(nz * howmany * sizeof *e->z);
+    e->x = fftw_malloc(n * howmany * xsize);
+    if (e->z == NULL || e->x == NULL) {
+        fft_plan_clear(e);
         return E_ALLOC;
     }
 
-    /* matrix to hold output */
-    if (!inverse) {
-        *ret = gretl_cmatrix_new(r, c);
+    if (kind == FFT_R2C) {
+        e->p = fftw_plan_many_dft_r2c(1, &n, howmany, e->x, NULL, 1, n,
+                                      e->z, NULL, 1, nz, FFTW_ESTIMATE);
+    } else if (kind == FFT_C2R) {
+        e->p = fftw_plan_many_dft_c2r(1, &n, howmany, e->z, NULL, 1, nz,
+                                      e->x, NULL, 1, n, FFTW_ESTIMATE);
     } else {
-        *ret = gretl_matrix_alloc(r, c);
+        int sign = (kind == FFT_C2C_BWD)? FFTW_BACKWARD : FFTW_FORWARD;
+
+        e->p = fftw_plan_many_dft(1, &n, howmany, e->z, NULL, 1, n,
+                                  e->x, NULL, 1, n, sign, FFTW_ESTIMATE);
     }
-    if (*ret == NULL) {
-        free(*ffx);
-        free(*ffz);
-        return E_ALLOC;
+
+    if (e->p == NULL) {
+        fft_plan_clear(e);
+        return E_DATA;
     }
 
+    e->n = n;
+    e->howmany = howmany;
+    e->kind = kind;
+    e->nz = nz;
+
     return 0;
 }
 
+/* Retrieve a plan from the cache, or make one. In either case the
+   plan must be passed to fft_plan_release() after use. If the
+   workspace would be too big to be worth keeping, or if all the
+   suitable slots are in use by other threads, the plan is allocated
+   separately.
+*/
+
+static fft_plan *fft_plan_get (int n, int howmany, int kind, int *err)
+{
+    fft_plan *e = NULL;
+    int i;
+
+    G_LOCK(fft_cache);
+
+    for (i=0; i<FFT_CACHE_SIZE; i++) {
+        e = &fft_cache[i];
+        if (e->p != NULL && !e->busy && e->n == n &&
+            e->howmany == howmany && e->kind == kind) {
+            e->stamp = ++fft_clock;
+            e->busy = 1;
+            G_UNLOCK(fft_cache);
+            return e;
+        }
+    }
+
+    e = NULL;
+
+    if ((guint64) n * howmany <= FFT_CACHE_MAXDIM) {
+        /* use an empty slot, or else the least recently used
+           one that is free */
+        for (i=0; i<FFT_CACHE_SIZE; i++) {
+            if (fft_cache[i].busy) {
+                continue;
+            } else if (fft_cache[i].p == NULL) {
+                e = &fft_cache[i];
+                break;
+            } else if (e == NULL || fft_cache[i].stamp < e->stamp) {
+                e = &fft_cache[i];
+            }
+        }
+        if (e != NULL) {
+            fft_plan_clear(e);
+            *err = fft_plan_make(e, n, howmany, kind);
+            if (*err) {
+                e = NULL;
+            } else {
+                e->stamp = ++fft_clock;
+                e->busy = 1;
+            }
+            G_UNLOCK(fft_cache);
+            return e;
+        }
+    }
+
+    e = calloc(1, sizeof *e);
+    if (e == NULL) {
+        *err = E_ALLOC;
+    } else {
+        *err = fft_plan_make(e, n, howmany, kind);
+        if (*err) {
+            free(e);
+            e = NULL;
+        }
+    }
+
+    G_UNLOCK(fft_cache);
+
+    return e;
+}
+
+static void fft_plan_release (fft_plan *e)
+{
+    G_LOCK(fft_cache);
+    if (e < fft_cache || e >= fft_cache + FFT_CACHE_SIZE) {
+        fft_plan_clear(e);
+        free(e);
+    } else {
+        e->busy = 0;
+    }
+    G_UNLOCK(fft_cache);
+}
+
+/**
+ * gretl_fft_cleanup:
+ *
+ * Frees all cached FFTW plans and their workspace.
+ */
+
+void gretl_fft_cleanup (void)
+{
+    int i;
+
+    G_LOCK(fft_cache);
+    for (i=0; i<FFT_CACHE_SIZE; i++) {
+        fft_plan_clear(&fft_cache[i]);
+    }
+    fft_clock = 0;
+    G_UNLOCK(fft_cache);
+}
+
 /* FFT for real input -> complex output and
    FFTI for Hermetian input -> real output.
    Both old and new-style complex formats
-   are supported.
+   are supported. All columns are handled
+   by a single plan.
 */
 
 static gretl_matrix *real_matrix_fft (const gretl_matrix *y,
                                       int inverse, int *err)
 {
     gretl_matrix *ret = NULL;
-    fftw_plan p = NULL;
-    double *ffx = NULL;
-    double complex *ffz = NULL;
-    int r, c, m, odd;
+    fft_plan *e = NULL;
+    double complex *z;
+    double *x;
+    int r, c, m, nz;
     int i, j;
 
     if (y->rows < 2) {
@@ -93,56 +260,60 @@ static gretl_matrix *real_matrix_fft (const gretl_matrix *y,
     r = y->rows;
     c = y->cols;
     m = r / 2;
-    odd = r % 2;
 
-    *err = fft_allocate(&ffx, &ffz, &ret, r, c, inverse);
+    e = fft_plan_get(r, c, inverse ? FFT_C2R : FFT_R2C, err);
     if (*err) {
         return NULL;
     }
 
-    for (j=0; j<c; j++) {
-        /* load the data */
-        if (inverse) {
-            for (i=0; i<=m+odd; i++) {
-                ffz[i] = gretl_cmatrix_get(y, i, j);
-            }
-        } else {
-            /* going in the real -> complex direction */
-            for (i=0; i<r; i++) {
-                ffx[i] = gretl_matrix_get(y, i, j);
-            }
-        }
-
-        if (j == 0) {
-            /* make the plan just once */
-            if (inverse) {
-                p = fftw_plan_dft_c2r_1d(r, ffz, ffx, FFTW_ESTIMATE);
-            } else {
-                p = fftw_plan_dft_r2c_1d(r, ffx, ffz, FFTW_ESTIMATE);
-            }
-        }
+    nz = e->nz;
 
-        /* run the transform */
-        fftw_execute(p);
+    if (inverse) {
+        ret = gretl_matrix_alloc(r, c);
+    } else {
+        ret = gretl_cmatrix_new(r, c);
+    }
+    if (ret == NULL) {
+        *err = E_ALLOC;
+        fft_plan_release(e);
+        return NULL;
+    }
 
-        /* transcribe the result */
-        if (inverse) {
-            for (i=0; i<r; i++) {
-                gretl_matrix_set(ret, i, j, ffx[i] / r);
+    if (inverse) {
+        /* load the non-redundant half of each column */
+        for (j=0; j<c; j++) {
+            z = e->z + j * nz;
+            for (i=0; i<nz; i++) {
+                z[i] = gretl_cmatrix_get(y, i, j);
             }
+        }
+        x = fft_aligned(ret->val) ? ret->val : e->x;
+        fftw_execute_dft_c2r(e->p, e->z, x);
+        for (i=0; i<r*c; i++) {
+            ret->val[i] = x[i] / r;
+        }
+    } else {
+        /* going in the real -> complex direction */
+        if (fft_aligned(y->val)) {
+            x = y->val;
         } else {
-            for (i=0; i<=m+odd; i++) {
-                gretl_cmatrix_set(ret, i, j, ffz[i]);
+            x = e->x;
+            memcpy(x, y->val, r * c * sizeof *x);
+        }
+        fftw_execute_dft_r2c(e->p, x, e->z);
+        /* transcribe the result, filling in the redundant half */
+        for (j=0; j<c; j++) {
+            z = e->z + j * nz;
+            for (i=0; i<nz; i++) {
+                gretl_cmatrix_set(ret, i, j, z[i]);
             }
-            for (i=m; i>0; i--) {
-                gretl_cmatrix_set(ret, r-i, j, conj(ffz[i]));
+            for (i=1; i<r-m; i++) {
+                gretl_cmatrix_set(ret, r-i, j, conj(z[i]));
             }
         }
     }
 
-    fftw_destroy_plan(p);
-    fftw_free(ffz);
-    fftw_free(ffx);
+    fft_plan_release(e);
 
     return ret;
 }
@@ -378,6 +549,60 @@ static gretl_matrix *gretl_zgemm (const gretl_matrix *A,
     return C;
 }
 
+/* For small non-transposed products, as arise in (e.g.) the
+   frequency-domain recursions, the overhead of zgemm() dominates.
+   Here we form C = A * B natively instead, building each column
+   of C as a sum of the columns of A scaled by the elements of
+   the corresponding column of B.
+*/
+
+#define SMALL_ZGEMM_MAX 32
+
+static gretl_matrix *small_zgemm (const gretl_matrix *A,
+                                  const gretl_matrix *B,
+                                  int *err)
+{
+    gretl_matrix *C;
+    int m = A->rows;
+    int n = B->cols;
+    int k = A->cols;
+    int j, l;
+
+    if (k != B->rows) {
+        *err = E_NONCONF;
+        return NULL;
+    }
+
+    C = gretl_cmatrix_new(m, n);
+    if (C == NULL) {
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    for (j=0; j<n; j++) {
+        for (l=0; l<k; l++) {
+            gretl_zvec_scale(A->z + l * m, B->z[j*k + l],
+                             C->z + j * m, m, l > 0);
+        }
+    }
+
+    return C;
+}
+
+static gretl_matrix *cmatrix_gemm (const gretl_matrix *A,
+                                   char transa,
+                                   const gretl_matrix *B,
+                                   int *err)
+{
+    if (transa == 'N' && A->z != NULL && B->z != NULL &&
+        A->rows <= SMALL_ZGEMM_MAX && A->cols <= SMALL_ZGEMM_MAX &&
+        B->cols <= SMALL_ZGEMM_MAX) {
+        return small_zgemm(A, B, err);
+    } else {
+        return gretl_zgemm(A, transa, B, 'N', err);
+    }
+}
+
 static gretl_matrix *real_cmatrix_multiply (const gretl_matrix *A,
                                             const gretl_matrix *B,
                                             char transa, int *err)
@@ -389,19 +614,19 @@ static gretl_matrix *real_cmatrix_multiply (const gretl_matrix *A,
         if (transa == 'N' && (cscalar(A) || cscalar(B))) {
             return gretl_cmatrix_dot_op(A, B, '*', err);
         } else {
-            C = gretl_zgemm(A, transa, B, 'N', err);
+            C = cmatrix_gemm(A, transa, B, err);
         }
     } else if (A->is_complex) {
         /* case of real B */
         T = complex_from_real(B, err);
         if (T != NULL) {
-            C = gretl_zgemm(A, transa, T, 'N', err);
+            C = cmatrix_gemm(A, transa, T, err);
         }
     } else if (B->is_complex) {
         /* case of real A */
         T = complex_from_real(A, err);
         if (T != NULL) {
-            C = gretl_zgemm(T, transa, B, 'N', err);
+            C = cmatrix_gemm(T, transa, B, err);
         }
     } else {
         *err = E_TYPES;
@@ -1044,9 +1269,10 @@ static gretl_matrix *real_cmatrix_hdp (const gretl_matrix *A,
                                        int *err)
 {
     gretl_matrix *C = NULL;
-    double complex aij, bik;
+    const double complex *aj, *bk;
+    double complex *cz;
     int do_symmetric = 0;
-    int i, j, k, ndx;
+    int i, j, k;
     int r, p, q, ccols;
 
     if (!cmatrix_validate(A,0)) {
@@ -1076,28 +1302,30 @@ static gretl_matrix *real_cmatrix_hdp (const gretl_matrix *A,
         ccols = p * q;
     }
 
-    C = gretl_cmatrix_new0(r, ccols);
+    C = gretl_cmatrix_new(r, ccols);
 
     if (C == NULL) {
         *err = E_ALLOC;
         return NULL;
     }
 
-    for (i=0; i<r; i++) {
-        ndx = 0;
-        for (j=0; j<p; j++) {
-            aij = gretl_cmatrix_get(A, i, j);
-            if (do_symmetric) {
-                for (k=j; k<q; k++) {
-                    bik = gretl_cmatrix_get(A, i, k);
-                    gretl_cmatrix_set(C, i, ndx++, aij*conj(bik));
-                }
-            } else if (aij != 0.0) {
-                ndx = j * q;
-                for (k=0; k<q; k++) {
-                    bik = gretl_cmatrix_get(B, i, k);
-                    gretl_cmatrix_set(C, i, ndx + k, aij*bik);
+    /* work by columns, so that the inner loops run over
+       contiguous storage */
+    cz = C->z;
+    for (j=0; j<p; j++) {
+        aj = A->z + j * r;
+        if (do_symmetric) {
+            for (k=j; k<q; k++) {
+                bk = A->z + k * r;
+                for (i=0; i<r; i++) {
+                    cz[i] = aj[i] * conj(bk[i]);
                 }
+                cz += r;
+            }
+        } else {
+            for (k=0; k<q; k++) {
+                gretl_zvec_mul(aj, B->z + k * r, cz, r);
+                cz += r;
             }
         }
     }
@@ -1124,30 +1352,26 @@ static gretl_matrix *real_cmatrix_kron (const gretl_matrix *A,
     r = B->rows;
     s = B->cols;
 
-    K = gretl_cmatrix_new0(p*r, q*s);
+    K = gretl_cmatrix_new(p*r, q*s);
 
     if (K == NULL) {
         *err = E_ALLOC;
     } else {
-        double complex x, aij, bkl;
-        int i, j, k, l;
+        double complex aij;
+        int i, j, l;
         int ioff, joff;
-        int Ki, Kj;
 
         for (i=0; i<p; i++) {
             ioff = i * r;
             for (j=0; j<q; j++) {
-                /* block ij is an r * s matrix, a_{ij} * B */
+                /* block ij is an r * s matrix, a_{ij} * B,
+                   filled column by column */
                 aij = gretl_cmatrix_get(A, i, j);
                 joff = j * s;
-                for (k=0; k<r; k++) {
-                    Ki = ioff + k;
-                    for (l=0; l<s; l++) {
-                        bkl = gretl_cmatrix_get(B, k, l);
-                        Kj = joff + l;
-                        x = aij * bkl;
-                        gretl_cmatrix_set(K, Ki, Kj, x);
-                    }
+                for (l=0; l<s; l++) {
+                    gretl_zvec_scale(B->z + l * r, aij,
+                                     K->z + (joff + l) * K->rows + ioff,
+                                     r, 0);
                 }
             }
         }
@@ -1204,15 +1428,15 @@ gretl_matrix *gretl_cmatrix_kronecker (const gretl_matrix *A,
     return gretl_cmatrix_kronlike(A, B, 0, err);
 }
 
-/* Complex FFT (or inverse) via fftw */
+/* Complex FFT (or inverse) via fftw, transforming all columns
+   with a single cached plan */
 
 gretl_matrix *gretl_cmatrix_fft (const gretl_matrix *A,
                                  int inverse, int *err)
 {
     gretl_matrix *B = NULL;
-    double complex *tmp, *ptr;
-    fftw_plan p;
-    int sign;
+    double complex *zin, *zout;
+    fft_plan *e;
     int r, c, j;
 
     if (!cmatrix_validate(A, 0)) {
@@ -1220,26 +1444,30 @@ gretl_matrix *gretl_cmatrix_fft (const gretl_matrix *A,
         return NULL;
     }
 
-    B = gretl_matrix_copy(A);
+    r = A->rows;
+    c = A->cols;
+
+    e = fft_plan_get(r, c, inverse ? FFT_C2C_BWD : FFT_C2C_FWD, err);
+    if (*err) {
+        return NULL;
+    }
+
+    B = gretl_cmatrix_new(r, c);
     if (B == NULL) {
         *err = E_ALLOC;
+        fft_plan_release(e);
         return NULL;
     }
 
-    r = A->rows;
-    c = A->cols;
-
-    tmp = (double complex *) B->val;
-    sign = inverse ? FFTW_BACKWARD : FFTW_FORWARD;
-
-    ptr = tmp;
-    for (j=0; j<c; j++) {
-        p = fftw_plan_dft_1d(r, ptr, ptr, sign, FFTW_ESTIMATE);
-        fftw_execute(p);
-        fftw_destroy_plan(p);
-        /* advance pointer to next column */
-        ptr += r;
+    if (fft_aligned(A->z)) {
+        zin = A->z;
+    } else {
+        zin = e->z;
+        memcpy(zin, A->z, r * c * sizeof *zin);
     }
+    zout = fft_aligned(B->z) ? B->z : e->x;
+
+    fftw_execute_dft(e->p, zin, zout);
 
     if (inverse) {
         /* "FFTW computes an unnormalized transform: computing a
@@ -1249,10 +1477,14 @@ gretl_matrix *gretl_cmatrix_fft (const gretl_matrix *A,
             So should we do the following?
         */
         for (j=0; j<r*c; j++) {
-            tmp[j] /= r;
+            B->z[j] = zout[j] / r;
         }
+    } else if (zout != B->z) {
+        memcpy(B->z, zout, r * c * sizeof *zout);
     }
 
+    fft_plan_release(e);
+
     return B;
 }
 
@@ -2145,9 +2377,7 @@ static void vec_x_op_vec_y (double complex *z,
 
     switch (op) {
     case '*':
-        for (i=0; i<n; i++) {
-            z[i] = x[i] * y[i];
-        }
+        gretl_zvec_mul(x, y, z, n);
         break;
     case '/':
         for (i=0; i<n; i++) {
@@ -2193,9 +2423,7 @@ static void vec_x_op_y (double complex *z,
 
     switch (op) {
     case '*':
-        for (i=0; i<n; i++) {
-            z[i] = x[i] * y;
-        }
+        gretl_zvec_scale(x, y, z, n, 0);
         break;
     case '/':
         for (i=0; i<n; i++) {
@@ -2241,9 +2469,7 @@ static void x_op_vec_y (double complex *z,
 
     switch (op) {
     case '*':
-        for (i=0; i<n; i++) {
-            z[i] = x * y[i];
-        }
+        gretl_zvec_scale(y, x, z, n, 0);
         break;
     case '/':
         for (i=0; i<n; i++) {
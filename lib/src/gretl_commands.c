@@ -225,21 +225,22 @@ const char *gretl_command_word (int i)
 
 static GHashTable *ht;
 
-static void gretl_command_hash_init (void)
+static GHashTable *gretl_command_hash_init (void)
 {
+    GHashTable *h = g_hash_table_new(g_str_hash, g_str_equal);
     int i;
 
-    ht = g_hash_table_new(g_str_hash, g_str_equal);
-
     for (i=1; gretl_cmds[i].cword != NULL; i++) {
-	g_hash_table_insert(ht, (gpointer) gretl_cmds[i].cword,
+	g_hash_table_insert(h, (gpointer) gretl_cmds[i].cword,
 			    GINT_TO_POINTER(gretl_cmds[i].cnum));
     }
 
     for (i=0; gretl_cmd_aliases[i].cword != NULL; i++) {
-	g_hash_table_insert(ht, (gpointer) gretl_cmd_aliases[i].cword,
+	g_hash_table_insert(h, (gpointer) gretl_cmd_aliases[i].cword,
 			    GINT_TO_POINTER(gretl_cmd_aliases[i].cnum));
     }
+
+    return h;
 }
 
 int gretl_command_number (const char *s)
@@ -247,8 +248,9 @@ int gretl_command_number (const char *s)
     gpointer p;
     int ret = 0;
 
-    if (ht == NULL) {
-	gretl_command_hash_init();
+    if (g_once_init_enter(&ht)) {
+	/* guard against concurrent first use by two threads */
+	g_once_init_leave(&ht, gretl_command_hash_init());
     }
 
     p = g_hash_table_lookup(ht, s);
@@ -1631,7 +1631,8 @@ static int write_gretl_mpi_script (gretlopt opt, DATASET *dset)
             int nt = get_optval_int(MPI, OPT_T, &err);
 
             if (nt == -1) {
-                ; /* unlimited/auto */
+                /* auto: divide the cores among the processes per node */
+                fputs("set omp_num_threads default\n", fp);
             } else {
                 if (!err && (nt <= 0 || nt > 9999999)) {
                     err = E_DATA;
@@ -1867,8 +1868,14 @@ static gretl_matrix *make_coded_vec (int *list,
     return coded;
 }
 
+#ifdef USE_RLIB
+static int Rlib_send_data (const DATASET *dset, const int *list);
+#endif
+
 /* write out current dataset in R format, and, if this succeeds,
-   write appropriate R commands to @fp to source the data
+   write appropriate R commands to @fp to source the data; or
+   if we're using the R shared library (OPT_L), hand the data
+   over directly as an R data frame
 */
 
 static int write_data_for_R (const DATASET *dset,
@@ -1890,11 +1897,22 @@ static int write_data_for_R (const DATASET *dset,
     list = get_send_data_list(FOREIGN, dset, &err);
 
     if (!err) {
+        coded = make_coded_vec(list, dset);
+#ifdef USE_RLIB
+        if (opt & OPT_L) {
+            err = Rlib_send_data(dset, list);
+        } else {
+            gchar *Rdata = gretl_make_dotpath("Rdata.tmp");
+
+            err = write_data(Rdata, list, dset, OPT_R, NULL);
+            g_free(Rdata);
+        }
+#else
         gchar *Rdata = gretl_make_dotpath("Rdata.tmp");
 
-        coded = make_coded_vec(list, dset);
         err = write_data(Rdata, list, dset, OPT_R, NULL);
         g_free(Rdata);
+#endif
     }
 
     if (err) {
@@ -1903,7 +1921,7 @@ static int write_data_for_R (const DATASET *dset,
         return err;
     }
 
-    if (coded != NULL) {
+    if (coded != NULL && !(opt & OPT_L)) {
         gchar *tmp = gretl_make_dotpath("Rcoded.mat");
         int write_err;
 
@@ -1917,9 +1935,11 @@ static int write_data_for_R (const DATASET *dset,
         }
     }
 
-    fputs("# load data from gretl\n", fp);
-    fprintf(fp, "gretldata <- read.table(\"%sRdata.tmp\", header=TRUE)\n",
-            get_export_dotdir());
+    if (!(opt & OPT_L)) {
+        fputs("# load data from gretl\n", fp);
+        fprintf(fp, "gretldata <- read.table(\"%sRdata.tmp\", header=TRUE)\n",
+                get_export_dotdir());
+    }
 
     if (ts) {
         char *p, datestr[OBSLEN];
@@ -1948,7 +1968,15 @@ static int write_data_for_R (const DATASET *dset,
         fputs("attach(gretldata)\n", fp);
     }
 
-    if (coded != NULL) {
+    if (coded != NULL && (opt & OPT_L)) {
+        int i, n = gretl_vector_get_length(coded);
+
+        fputs("Coded <- c(", fp);
+        for (i=0; i<n; i++) {
+            fprintf(fp, "%d%s", (int) coded->val[i], i < n-1 ? "," : ")\n");
+        }
+        fputs("for (i in Coded) {gretldata[,i] <- as.factor(gretldata[,i])}\n", fp);
+    } else if (coded != NULL) {
         fputs("Coded <- gretl.loadmat(\"Rcoded.mat\")\n", fp);
         fputs("for (i in Coded) {gretldata[,i] <- as.factor(gretldata[,i])}\n", fp);
     }
@@ -2362,12 +2390,16 @@ SEXP *PR_NilValue;
 SEXP *PR_UnboundValue;
 SEXP *PR_NamesSymbol;
 SEXP *PR_DimNamesSymbol;
+SEXP *PR_NaString;
+double *PR_NaReal;
 
 SEXP VR_GlobalEnv;
 SEXP VR_NilValue;
 SEXP VR_UnboundValue;
 SEXP VR_NamesSymbol;
 SEXP VR_DimNamesSymbol;
+SEXP VR_NaString;
+double VR_NaReal;
 
 /* renamed, pointerized versions of the R functions we need */
 
@@ -2393,6 +2425,7 @@ static SEXP (*R_mkChar) (const char *);
 static SEXP (*R_mkNamed) (SEXPTYPE, const char **);
 static SEXP (*R_getAttrib) (SEXP, SEXP);
 static SEXP (*R_setAttrib) (SEXP, SEXP, SEXP);
+static void (*R_defineVar) (SEXP, SEXP, SEXP);
 
 static Rboolean (*R_isMatrix) (SEXP);
 static Rboolean (*R_isVector) (SEXP);
@@ -2486,6 +2519,7 @@ static int load_R_symbols (void)
     R_length        = dlget(Rhandle, "Rf_length", &err);
     R_getAttrib     = dlget(Rhandle, "Rf_getAttrib", &err);
     R_setAttrib     = dlget(Rhandle, "Rf_setAttrib", &err);
+    R_defineVar     = dlget(Rhandle, "Rf_defineVar", &err);
     R_PrintValue    = dlget(Rhandle, "Rf_PrintValue", &err);
     R_protect       = dlget(Rhandle, "Rf_protect", &err);
     R_ScalarReal    = dlget(Rhandle, "Rf_ScalarReal", &err);
@@ -2510,6 +2544,8 @@ static int load_R_symbols (void)
         PR_UnboundValue = (SEXP *) dlget(Rhandle, "R_UnboundValue", &err);
         PR_NamesSymbol  = (SEXP *) dlget(Rhandle, "R_NamesSymbol", &err);
         PR_DimNamesSymbol = (SEXP *) dlget(Rhandle, "R_DimNamesSymbol", &err);
+        PR_NaString     = (SEXP *) dlget(Rhandle, "R_NaString", &err);
+        PR_NaReal       = (double *) dlget(Rhandle, "R_NaReal", &err);
     }
 
     if (err) {
@@ -2816,6 +2852,8 @@ static int gretl_Rlib_init (void)
             VR_UnboundValue = *PR_UnboundValue;
             VR_NamesSymbol = *PR_NamesSymbol;
             VR_DimNamesSymbol = *PR_DimNamesSymbol;
+            VR_NaString = *PR_NaString;
+            VR_NaReal = *PR_NaReal;
             Rinit = 1;
         } else {
             close_plugin(Rhandle);
@@ -3116,6 +3154,110 @@ static SEXP make_R_matrix (const gretl_matrix *m, int *err)
     return ms;
 }
 
+/* Observation markers serve as R row.names only if they're
+   distinct over the current sample range.
+*/
+
+static int Rlib_markers_ok (const DATASET *dset)
+{
+    GHashTable *ht;
+    int t, ret = 1;
+
+    if (dset->S == NULL) {
+        return 0;
+    }
+
+    ht = g_hash_table_new(g_str_hash, g_str_equal);
+    for (t=dset->t1; t<=dset->t2 && ret; t++) {
+        if (g_hash_table_contains(ht, dset->S[t])) {
+            ret = 0;
+        } else {
+            g_hash_table_add(ht, dset->S[t]);
+        }
+    }
+    g_hash_table_destroy(ht);
+
+    return ret;
+}
+
+/* Build an R data frame holding the series in @list (or all
+   series bar the constant if @list is NULL) over the current
+   sample range, and bind it to "gretldata" in R's global
+   environment. This is the shared-library counterpart to
+   writing Rdata.tmp and having R parse it with read.table():
+   numeric columns go across as REALSXP vectors, string-valued
+   series as character vectors.
+*/
+
+static int Rlib_send_data (const DATASET *dset, const int *list)
+{
+    int *full = NULL;
+    int n = sample_size(dset);
+    SEXP df, names, rn, col;
+    const char *st;
+    double *x, xt;
+    int i, t, vi, k;
+
+    if (list == NULL) {
+        full = full_var_list(dset, NULL);
+        if (full == NULL) {
+            return E_ALLOC;
+        }
+        list = full;
+    }
+
+    k = list[0];
+    R_protect(df = R_allocVector(VECSXP, k));
+    R_protect(names = R_allocVector(STRSXP, k));
+
+    for (i=0; i<k; i++) {
+        vi = list[i+1];
+        R_STRING_PTR(names)[i] = R_mkChar(dset->varname[vi]);
+        if (is_string_valued(dset, vi)) {
+            col = R_allocVector(STRSXP, n);
+            R_SET_VECTOR_ELT(df, i, col);
+            for (t=0; t<n; t++) {
+                st = NULL;
+                if (!na(dset->Z[vi][dset->t1 + t])) {
+                    st = series_get_string_for_obs(dset, vi, dset->t1 + t);
+                }
+                R_STRING_PTR(col)[t] = st == NULL ? VR_NaString : R_mkChar(st);
+            }
+        } else {
+            col = R_allocVector(REALSXP, n);
+            R_SET_VECTOR_ELT(df, i, col);
+            x = R_REAL(col);
+            memcpy(x, dset->Z[vi] + dset->t1, n * sizeof *x);
+            for (t=0; t<n; t++) {
+                xt = x[t];
+                if (na(xt)) {
+                    x[t] = VR_NaReal;
+                }
+            }
+        }
+    }
+
+    R_setAttrib(df, VR_NamesSymbol, names);
+
+    if (Rlib_markers_ok(dset)) {
+        R_protect(rn = make_R_strings((const char **) dset->S + dset->t1, n));
+    } else {
+        R_protect(rn = R_allocVector(INTSXP, n));
+        for (t=0; t<n; t++) {
+            R_INT(rn)[t] = t + 1;
+        }
+    }
+    R_setAttrib(df, R_install("row.names"), rn);
+    R_setAttrib(df, R_install("class"), R_mkString("data.frame"));
+
+    R_defineVar(R_install("gretldata"), df, VR_GlobalEnv);
+    R_unprotect(3);
+
+    free(full);
+
+    return 0;
+}
+
 static SEXP make_R_bundle (gretl_bundle *b, int *err)
 {
     GretlType type;
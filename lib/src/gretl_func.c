@@ -38,6 +38,8 @@
 #include "gretl_mdconv.h"
 #include "gen_public.h"
 #include "addons_utils.h"
+#include "gretl_profile.h"
+#include "gretl_trace.h"
 
 #ifdef HAVE_MPI
 # include "gretl_mpi.h"
@@ -166,6 +168,25 @@ struct fncall_ {
     int n_lgen;      /* number of linegens */
 };
 
+/* cache of the return values of a "memoize" function, keyed by
+   the content of the arguments */
+
+struct fnmemo_ {
+    GHashTable *ht; /* GBytes key -> memo_val */
+    GQueue *keys;   /* keys in order of insertion */
+    int hits;
+    int misses;
+};
+
+struct memo_val_ {
+    GretlType type; /* scalar, matrix, string or bundle */
+    double x;       /* scalar value */
+    void *ptr;      /* other values */
+};
+
+typedef struct fnmemo_ fnmemo;
+typedef struct memo_val_ memo_val;
+
 /* structure representing a user-defined function */
 
 struct ufunc_ {
@@ -181,6 +202,8 @@ struct ufunc_ {
     int n_params;          /* number of parameters */
     fn_param *params;      /* parameter info array */
     int rettype;           /* return type (if any) */
+    int n_exec;            /* count of completed executions */
+    fnmemo *memo;          /* cache of return values, or NULL */
 };
 
 /* structure representing a function package */
@@ -255,6 +278,7 @@ struct fnpkg_ {
 struct fn_arg_ {
     char type;            /* argument type */
     char shifted;         /* level was shifted for execution */
+    char owned;           /* temporary value handed over by caller */
     char *upname;         /* name of supplied arg at caller level */
     user_var *uvar;       /* reference to "parent", if any */
     union {
@@ -269,13 +293,50 @@ struct fn_arg_ {
     } val;
 };
 
-static int n_ufuns;         /* number of user-defined functions in memory */
-static ufunc **ufuns;       /* array of pointers to user-defined functions */
-static ufunc *current_fdef; /* pointer to function currently being defined */
-static GList *callstack;    /* stack of function calls */
-static int n_pkgs;          /* number of loaded function packages */
-static fnpkg **pkgs;        /* array of pointers to loaded packages */
-static fnpkg *current_pkg;  /* pointer to package currently being edited */
+/* The user functions and packages in memory, along with the
+   state of function definition and execution. Ordinarily there
+   is one such table for the whole program, but a thread that
+   calls libgretl_thread_init() gets a table of its own; other
+   threads, OpenMP workers included, see the program-wide one,
+   and so agree with it on the current function depth.
+*/
+
+typedef struct ufunc_table_ ufunc_table;
+
+struct ufunc_table_ {
+    int n_ufuns;         /* number of user-defined functions in memory */
+    ufunc **ufuns;       /* array of pointers to user-defined functions */
+    ufunc *current_fdef; /* pointer to function currently being defined */
+    GList *callstack;    /* stack of function calls */
+    int n_pkgs;          /* number of loaded function packages */
+    fnpkg **pkgs;        /* array of pointers to loaded packages */
+    fnpkg *current_pkg;  /* pointer to package currently being edited */
+    int compiling;       /* boolean: are we compiling a function currently? */
+    int fn_executing;    /* depth of function call stack */
+    int compiling_python;
+    int allow_full_data;
+};
+
+static ufunc_table main_uft;
+static ufunc_table *thread_uft;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(thread_uft)
+#endif
+
+#define uft (thread_uft != NULL ? thread_uft : &main_uft)
+
+#define n_ufuns          (uft->n_ufuns)
+#define ufuns            (uft->ufuns)
+#define current_fdef     (uft->current_fdef)
+#define callstack        (uft->callstack)
+#define n_pkgs           (uft->n_pkgs)
+#define pkgs             (uft->pkgs)
+#define current_pkg      (uft->current_pkg)
+#define compiling        (uft->compiling)
+#define fn_executing     (uft->fn_executing)
+#define compiling_python (uft->compiling_python)
+#define allow_full_data  (uft->allow_full_data)
 
 static int function_package_record (fnpkg *pkg);
 static void function_package_free (fnpkg *pkg);
@@ -290,11 +351,8 @@ static int ufunc_get_structure (ufunc *u);
 static void print_callstack (ufunc *fun);
 #endif
 
-/* record of state, and communication of state with outside world */
-
-static int compiling;    /* boolean: are we compiling a function currently? */
-static int fn_executing; /* depth of function call stack */
-static int compiling_python;
+/* record of state, and communication of state with outside world:
+   see the ufunc_table above */
 #ifdef HAVE_MPI
 static char mpi_caller[FN_NAMELEN];
 #endif
@@ -304,6 +362,7 @@ static char mpi_caller[FN_NAMELEN];
 #define function_is_menu_only(f) (f->flags & UFUN_MENU_ONLY)
 #define function_must_assign(f)  (f->flags & UFUN_ASSIGN)
 #define function_is_recursive(f) (f->flags & UFUN_RECURSES)
+#define function_is_memoized(f) (f->flags & UFUN_MEMO)
 
 #define set_call_recursing(c)   (c->flags |= FC_RECURSING)
 #define is_recursing(c)         (c->flags & FC_RECURSING)
@@ -434,6 +493,7 @@ static int fn_arg_set_data (fn_arg *arg, const char *name,
 
     arg->type = type;
     arg->shifted = 0;
+    arg->owned = 0;
     arg->uvar = uvar;
     arg->upname = (name != NULL)? gretl_strdup(name) : NULL;
 
@@ -485,6 +545,7 @@ static int fncall_add_args_array (fncall *fc)
         for (i=0; i<np; i++) {
             fc->args[i].type = 0;
             fc->args[i].shifted = 0;
+            fc->args[i].owned = 0;
             fc->args[i].upname = NULL;
             fc->args[i].uvar = NULL;
         }
@@ -493,6 +554,21 @@ static int fncall_add_args_array (fncall *fc)
     return err;
 }
 
+/* free a temporary argument value that was handed over to @arg
+   but not (yet) passed on to the function as a local variable,
+   as may happen on error
+*/
+
+static void free_owned_arg (fn_arg *arg)
+{
+    if (arg->type == GRETL_TYPE_MATRIX) {
+        gretl_matrix_free(arg->val.m);
+    } else if (arg->type == GRETL_TYPE_BUNDLE) {
+        gretl_bundle_destroy(arg->val.b);
+    }
+    arg->owned = 0;
+}
+
 static void fncall_clear_args_array (fncall *fc)
 {
     int i, np = fc->fun->n_params;
@@ -500,6 +576,9 @@ static void fncall_clear_args_array (fncall *fc)
 
     for (i=0; i<np; i++) {
         arg = &fc->args[i];
+        if (arg->owned) {
+            free_owned_arg(arg);
+        }
         arg->type = 0;
         arg->shifted = 0;
         nullify_upname(arg);
@@ -519,6 +598,9 @@ static void fncall_destroy_args_array (fncall *fc)
 	    if (fc->args[i].upname != NULL) {
 		free(fc->args[i].upname);
 	    }
+	    if (fc->args[i].owned) {
+		free_owned_arg(&fc->args[i]);
+	    }
 	}
 	free(fc->args);
     }
@@ -584,6 +666,47 @@ int push_anon_function_arg (fncall *fc, GretlType type, void *value)
     return push_function_arg(fc, NULL, NULL, type, value);
 }
 
+/**
+ * push_temp_function_arg:
+ * @fc: pointer to function call.
+ * @type: type of argument to add.
+ * @value: pointer to value to add.
+ * @taken: location to receive 1 if @value was taken over, else 0.
+ *
+ * Like push_anon_function_arg(), for the case where @value is a
+ * temporary matrix or bundle that the caller would otherwise
+ * free. If the corresponding parameter is a non-const matrix or
+ * bundle, @fc takes ownership of @value, which then becomes the
+ * function-local variable without being copied; in that case the
+ * caller must no longer reference @value.
+ *
+ * Returns: 0 on success, non-zero on failure.
+ */
+
+int push_temp_function_arg (fncall *fc, GretlType type, void *value,
+                            int *taken)
+{
+    int i = (fc != NULL)? fc->argc : 0;
+    int err;
+
+    *taken = 0;
+    err = push_function_arg(fc, NULL, NULL, type, value);
+
+    if (!err && value != NULL &&
+        (type == GRETL_TYPE_MATRIX || type == GRETL_TYPE_BUNDLE)) {
+        fn_param *fp = &fc->fun->params[i];
+
+        if (!param_is_const(fp) && (fp->type == type ||
+            (fp->type == GRETL_TYPE_NUMERIC &&
+             type == GRETL_TYPE_MATRIX))) {
+            fc->args[i].owned = 1;
+            *taken = 1;
+        }
+    }
+
+    return err;
+}
+
 /**
  * set_anon_function_arg:
  * @fc: pointer to function call.
@@ -1445,6 +1568,10 @@ int user_function_index_by_name (const char *name,
 
 static int fname_idx;
 
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(fname_idx)
+#endif
+
 void function_names_init (void)
 {
     fname_idx = 0;
@@ -1813,6 +1940,46 @@ static fn_param *allocate_params (int n)
     return params;
 }
 
+#define MEMO_COMMENT "## memoize ##"
+
+static void memo_val_free (gpointer p)
+{
+    memo_val *mv = p;
+
+    if (mv->type == GRETL_TYPE_MATRIX) {
+        gretl_matrix_free(mv->ptr);
+    } else if (mv->type == GRETL_TYPE_BUNDLE) {
+        gretl_bundle_destroy(mv->ptr);
+    } else {
+        free(mv->ptr);
+    }
+    free(mv);
+}
+
+static void fnmemo_destroy (fnmemo *memo)
+{
+    if (memo != NULL) {
+        g_hash_table_destroy(memo->ht);
+        g_queue_free(memo->keys);
+        free(memo);
+    }
+}
+
+/* a script-defined function may be marked for memoization by a
+   special comment in its body */
+
+static void check_memo_comment (ufunc *fun)
+{
+    int i;
+
+    for (i=0; i<fun->n_lines; i++) {
+        if (strstr(fun->lines[i].s, MEMO_COMMENT)) {
+            fun->flags |= UFUN_MEMO;
+            break;
+        }
+    }
+}
+
 static ufunc *ufunc_new (void)
 {
     ufunc *fun = malloc(sizeof *fun);
@@ -1836,6 +2003,8 @@ static ufunc *ufunc_new (void)
     fun->params = NULL;
 
     fun->rettype = GRETL_TYPE_NONE;
+    fun->n_exec = 0;
+    fun->memo = NULL;
 
     return fun;
 }
@@ -1908,6 +2077,7 @@ static void clear_ufunc_data (ufunc *fun)
     destroy_ufunc_calls(fun);
 
     fun->rettype = GRETL_TYPE_NONE;
+    fun->n_exec = 0;
 }
 
 static void ufunc_free (ufunc *fun)
@@ -1917,6 +2087,7 @@ static void ufunc_free (ufunc *fun)
     free_params_array(fun->params, fun->n_params);
     /* destroy_ufunc_calls() handles attached genrs */
     destroy_ufunc_calls(fun);
+    fnmemo_destroy(fun->memo);
     free(fun);
 }
 
@@ -2604,6 +2775,9 @@ static int read_ufunc_from_xml (xmlNodePtr node, xmlDocPtr doc, fnpkg *pkg)
     if (gretl_xml_get_prop_as_bool(node, "must-assign")) {
         fun->flags |= UFUN_ASSIGN;
     }
+    if (gretl_xml_get_prop_as_bool(node, "memoize")) {
+        fun->flags |= UFUN_MEMO;
+    }
     if (gretl_xml_get_prop_as_string(node, "pkg-role", &tmp)) {
         fun->pkg_role = pkg_key_get_role(tmp);
         free(tmp);
@@ -2723,6 +2897,9 @@ static int write_function_xml (ufunc *fun, PRN *prn, int mpi)
     if (function_must_assign(fun)) {
         pputs(prn, " must-assign=\"1\"");
     }
+    if (function_is_memoized(fun)) {
+        pputs(prn, " memoize=\"1\"");
+    }
 
     if (fun->pkg_role) {
         pprintf(prn, " pkg-role=\"%s\"", package_role_get_key(fun->pkg_role));
@@ -3071,6 +3248,8 @@ static void check_special_comments (ufunc *fun)
             fun->flags |= UFUN_MENU_ONLY;
         } else if (strstr(fun->lines[i].s, "## must-assign ##")) {
             fun->flags |= UFUN_ASSIGN;
+        } else if (strstr(fun->lines[i].s, MEMO_COMMENT)) {
+            fun->flags |= UFUN_MEMO;
         }
     }
 }
@@ -4010,6 +4189,13 @@ static int pkg_set_funcs_attribute (fnpkg *pkg, const char *s,
                     break;
                 }
             }
+            for (j=0; j<pkg->n_priv && !match; j++) {
+                /* memoization is for private helpers too */
+                if (flag == UFUN_MEMO && !strcmp(S[i], pkg->priv[j]->name)) {
+                    pkg->priv[j]->flags |= flag;
+                    match = 1;
+                }
+            }
             if (!match) {
                 err = E_DATA;
             }
@@ -4323,6 +4509,8 @@ static int new_package_info_from_spec (fnpkg *pkg, const char *fname,
                 err = pkg_set_funcs_attribute(pkg, p, UFUN_MENU_ONLY);
             } else if (!strncmp(line, "must-assign", 11)) {
                 err = pkg_set_funcs_attribute(pkg, p, UFUN_ASSIGN);
+            } else if (!strncmp(line, "memoize", 7)) {
+                err = pkg_set_funcs_attribute(pkg, p, UFUN_MEMO);
             } else {
                 const char *key;
 		int found = 0;
@@ -6824,6 +7012,477 @@ int read_session_functions_file (const char *fname)
     return err;
 }
 
+/* Binary cache of function packages. Reading a gfn file entails
+   parsing the XML and then tokenizing each line of each function,
+   which adds up for large packages. So once a package has been
+   read from XML we write an image of its fnpkg struct and its
+   functions to a "gfnc" file alongside the gfn (or, if that's
+   not writable, in the user's dotdir), keyed by a checksum of the
+   content of the gfn and by the gretl version. When the package
+   is next read we use the image if it's current.
+*/
+
+#define GFNC_MAGIC "gretl-gfnc"
+#define GFNC_FORMAT 1
+
+typedef struct gfnc_reader_ gfnc_reader;
+
+struct gfnc_reader_ {
+    const char *buf; /* content of cache file */
+    gsize len;       /* its length */
+    gsize pos;       /* current read position */
+    int err;         /* error indicator, set on truncation */
+};
+
+static void gfnc_put_int (GByteArray *a, gint32 k)
+{
+    g_byte_array_append(a, (const guint8 *) &k, sizeof k);
+}
+
+static void gfnc_put_double (GByteArray *a, double x)
+{
+    g_byte_array_append(a, (const guint8 *) &x, sizeof x);
+}
+
+static void gfnc_put_string (GByteArray *a, const char *s)
+{
+    gint32 n = (s == NULL)? -1 : (gint32) strlen(s);
+
+    gfnc_put_int(a, n);
+    if (n > 0) {
+        g_byte_array_append(a, (const guint8 *) s, n);
+    }
+}
+
+static void gfnc_put_strings (GByteArray *a, char **S, int n)
+{
+    int i;
+
+    gfnc_put_int(a, S == NULL ? 0 : n);
+    for (i=0; S != NULL && i<n; i++) {
+        gfnc_put_string(a, S[i]);
+    }
+}
+
+static void gfnc_read_bytes (gfnc_reader *r, void *targ, gsize n)
+{
+    if (!r->err && r->pos + n <= r->len) {
+        memcpy(targ, r->buf + r->pos, n);
+        r->pos += n;
+    } else {
+        r->err = E_DATA;
+    }
+}
+
+static int gfnc_get_int (gfnc_reader *r)
+{
+    gint32 k = 0;
+
+    gfnc_read_bytes(r, &k, sizeof k);
+    return k;
+}
+
+static double gfnc_get_double (gfnc_reader *r)
+{
+    double x = NADBL;
+
+    gfnc_read_bytes(r, &x, sizeof x);
+    return x;
+}
+
+static char *gfnc_get_string (gfnc_reader *r)
+{
+    int n = gfnc_get_int(r);
+    char *s = NULL;
+
+    if (r->err || n < 0) {
+        return NULL;
+    } else if (r->pos + n > r->len) {
+        r->err = E_DATA;
+        return NULL;
+    }
+
+    s = malloc(n + 1);
+    if (s == NULL) {
+        r->err = E_ALLOC;
+    } else {
+        memcpy(s, r->buf + r->pos, n);
+        s[n] = '\0';
+        r->pos += n;
+    }
+
+    return s;
+}
+
+static char **gfnc_get_strings (gfnc_reader *r, int *ns)
+{
+    char **S = NULL;
+    int i, n = gfnc_get_int(r);
+
+    *ns = 0;
+    if (!r->err && n > 0) {
+        S = strings_array_new(n);
+        if (S == NULL) {
+            r->err = E_ALLOC;
+        }
+        for (i=0; i<n && !r->err; i++) {
+            S[i] = gfnc_get_string(r);
+        }
+        if (r->err) {
+            strings_array_free(S, n);
+            S = NULL;
+        } else {
+            *ns = n;
+        }
+    }
+
+    return S;
+}
+
+/* Returns the checksum of the content of @fname, or NULL on
+   failure. The point of reading the gfn in full is that it's
+   much quicker than parsing it.
+*/
+
+static gchar *gfn_checksum (const char *fname)
+{
+    gchar *sum = NULL;
+    gchar *buf = NULL;
+    gsize len = 0;
+
+    if (g_file_get_contents(fname, &buf, &len, NULL)) {
+        sum = g_compute_checksum_for_data(G_CHECKSUM_SHA256,
+                                          (const guchar *) buf, len);
+        g_free(buf);
+    }
+
+    return sum;
+}
+
+/* Returns the name of the cache file for @fname, either alongside
+   the gfn itself (@local = 1) or in the dotdir.
+*/
+
+static gchar *gfnc_filename (const char *fname, int local)
+{
+    gchar *ret;
+
+    if (local) {
+        ret = g_strdup_printf("%sc", fname);
+    } else {
+        gchar *base = g_path_get_basename(fname);
+        gchar *tmp = g_strdup_printf("%sc", base);
+
+        ret = gretl_make_dotpath(tmp);
+        g_free(tmp);
+        g_free(base);
+    }
+
+    return ret;
+}
+
+static void gfnc_put_function (GByteArray *a, ufunc *fun)
+{
+    fn_param *param;
+    fn_line *line;
+    int i;
+
+    gfnc_put_string(a, fun->name);
+    gfnc_put_int(a, fun->pkg_role);
+    gfnc_put_int(a, fun->flags);
+    gfnc_put_int(a, fun->rettype);
+    gfnc_put_int(a, fun->line_idx);
+
+    gfnc_put_int(a, fun->n_params);
+    for (i=0; i<fun->n_params; i++) {
+        param = &fun->params[i];
+        gfnc_put_string(a, param->name);
+        gfnc_put_int(a, param->type);
+        gfnc_put_string(a, param->descrip);
+        gfnc_put_strings(a, param->labels, param->nlabels);
+        gfnc_put_int(a, param->flags);
+        gfnc_put_double(a, param->deflt);
+        gfnc_put_double(a, param->min);
+        gfnc_put_double(a, param->max);
+        gfnc_put_double(a, param->step);
+    }
+
+    gfnc_put_int(a, fun->n_lines);
+    for (i=0; i<fun->n_lines; i++) {
+        line = &fun->lines[i];
+        gfnc_put_string(a, line->s);
+        gfnc_put_int(a, line->ci);
+        gfnc_put_int(a, line->next);
+        gfnc_put_int(a, line->idx);
+        gfnc_put_int(a, line->flags);
+    }
+}
+
+static ufunc *gfnc_get_function (gfnc_reader *r, fnpkg *pkg)
+{
+    ufunc *fun = ufunc_new();
+    char *name;
+    int i, n;
+
+    if (fun == NULL) {
+        r->err = E_ALLOC;
+        return NULL;
+    }
+
+    name = gfnc_get_string(r);
+    if (name != NULL) {
+        strncat(fun->name, name, FN_NAMELEN - 1);
+        free(name);
+    }
+    fun->pkg = pkg;
+    fun->pkg_role = gfnc_get_int(r);
+    fun->flags = gfnc_get_int(r);
+    fun->rettype = gfnc_get_int(r);
+    fun->line_idx = gfnc_get_int(r);
+
+    n = gfnc_get_int(r);
+    if (!r->err && n > 0) {
+        fun->params = allocate_params(n);
+        if (fun->params == NULL) {
+            r->err = E_ALLOC;
+        } else {
+            fun->n_params = n;
+        }
+    }
+    for (i=0; i<fun->n_params && !r->err; i++) {
+        fn_param *param = &fun->params[i];
+
+        param->name = gfnc_get_string(r);
+        param->type = gfnc_get_int(r);
+        param->descrip = gfnc_get_string(r);
+        param->labels = gfnc_get_strings(r, &param->nlabels);
+        param->flags = gfnc_get_int(r);
+        param->deflt = gfnc_get_double(r);
+        param->min = gfnc_get_double(r);
+        param->max = gfnc_get_double(r);
+        param->step = gfnc_get_double(r);
+    }
+
+    n = gfnc_get_int(r);
+    if (!r->err && n > 0) {
+        fun->lines = calloc(n, sizeof *fun->lines);
+        if (fun->lines == NULL) {
+            r->err = E_ALLOC;
+        } else {
+            fun->n_lines = n;
+        }
+    }
+    for (i=0; i<fun->n_lines && !r->err; i++) {
+        fn_line *line = &fun->lines[i];
+
+        line->s = gfnc_get_string(r);
+        line->ci = gfnc_get_int(r);
+        line->next = gfnc_get_int(r);
+        line->idx = gfnc_get_int(r);
+        line->flags = gfnc_get_int(r);
+        if (line->s == NULL && !r->err) {
+            r->err = E_DATA;
+        }
+    }
+
+    if (!r->err && fun->name[0] == '\0') {
+        r->err = E_DATA;
+    }
+    if (!r->err) {
+        r->err = attach_ufunc_to_package(fun, pkg);
+    }
+    if (r->err) {
+        ufunc_free(fun);
+        fun = NULL;
+    }
+
+    return fun;
+}
+
+/* Write the cache file for package @pkg, read from the gfn with
+   checksum @sum. Failure is not an error, just a missed chance
+   to speed things up next time.
+*/
+
+static void write_package_cache (fnpkg *pkg, const char *sum)
+{
+    GByteArray *a = g_byte_array_new();
+    gchar *cname;
+    int i, ok;
+
+    gfnc_put_string(a, GFNC_MAGIC);
+    gfnc_put_int(a, GFNC_FORMAT);
+    gfnc_put_string(a, GRETL_VERSION);
+    gfnc_put_int(a, NC);
+    gfnc_put_string(a, sum);
+
+    gfnc_put_string(a, pkg->name);
+    gfnc_put_string(a, pkg->author);
+    gfnc_put_string(a, pkg->email);
+    gfnc_put_string(a, pkg->version);
+    gfnc_put_string(a, pkg->date);
+    gfnc_put_string(a, pkg->descrip);
+    gfnc_put_string(a, pkg->help);
+    gfnc_put_string(a, pkg->gui_help);
+    gfnc_put_string(a, pkg->Rdeps);
+    gfnc_put_string(a, pkg->sample);
+    gfnc_put_string(a, pkg->help_fname);
+    gfnc_put_string(a, pkg->gui_help_fname);
+    gfnc_put_string(a, pkg->sample_fname);
+    gfnc_put_string(a, pkg->tags);
+    gfnc_put_string(a, pkg->label);
+    gfnc_put_string(a, pkg->mpath);
+    gfnc_put_string(a, pkg->provider);
+    gfnc_put_int(a, pkg->dreq);
+    gfnc_put_int(a, pkg->modelreq);
+    gfnc_put_int(a, pkg->minver);
+    gfnc_put_int(a, pkg->uses_subdir);
+    gfnc_put_int(a, pkg->data_access);
+    gfnc_put_strings(a, pkg->datafiles, pkg->n_files);
+    gfnc_put_strings(a, pkg->depends, pkg->n_depends);
+
+    gfnc_put_int(a, pkg->n_pub);
+    for (i=0; i<pkg->n_pub; i++) {
+        gfnc_put_function(a, pkg->pub[i]);
+    }
+    gfnc_put_int(a, pkg->n_priv);
+    for (i=0; i<pkg->n_priv; i++) {
+        gfnc_put_function(a, pkg->priv[i]);
+    }
+
+    /* note: g_file_set_contents() replaces the file atomically */
+    cname = gfnc_filename(pkg->fname, 1);
+    ok = g_file_set_contents(cname, (const gchar *) a->data, a->len, NULL);
+    g_free(cname);
+    if (!ok) {
+        cname = gfnc_filename(pkg->fname, 0);
+        g_file_set_contents(cname, (const gchar *) a->data, a->len, NULL);
+        g_free(cname);
+    }
+
+    g_byte_array_free(a, TRUE);
+}
+
+/* Check the header of the cache file content in @r against the
+   running gretl and the gfn checksum @sum.
+*/
+
+static int gfnc_header_ok (gfnc_reader *r, const char *sum)
+{
+    char *s;
+    int ok;
+
+    s = gfnc_get_string(r);
+    ok = s != NULL && !strcmp(s, GFNC_MAGIC);
+    free(s);
+    ok = ok && gfnc_get_int(r) == GFNC_FORMAT;
+    if (ok) {
+        s = gfnc_get_string(r);
+        ok = s != NULL && !strcmp(s, GRETL_VERSION);
+        free(s);
+    }
+    ok = ok && gfnc_get_int(r) == NC;
+    if (ok) {
+        s = gfnc_get_string(r);
+        ok = s != NULL && !strcmp(s, sum);
+        free(s);
+    }
+
+    return ok && !r->err;
+}
+
+static fnpkg *real_read_package_cache (gfnc_reader *r,
+                                       const char *fname,
+                                       const char *sum)
+{
+    fnpkg *pkg;
+    char *name;
+    int i, n;
+
+    if (!gfnc_header_ok(r, sum)) {
+        return NULL;
+    }
+
+    pkg = function_package_alloc(fname);
+    if (pkg == NULL) {
+        return NULL;
+    }
+
+    name = gfnc_get_string(r);
+    if (name != NULL) {
+        strncat(pkg->name, name, FN_NAMELEN - 1);
+        free(name);
+    }
+    pkg->author = gfnc_get_string(r);
+    pkg->email = gfnc_get_string(r);
+    pkg->version = gfnc_get_string(r);
+    pkg->date = gfnc_get_string(r);
+    pkg->descrip = gfnc_get_string(r);
+    pkg->help = gfnc_get_string(r);
+    pkg->gui_help = gfnc_get_string(r);
+    pkg->Rdeps = gfnc_get_string(r);
+    pkg->sample = gfnc_get_string(r);
+    pkg->help_fname = gfnc_get_string(r);
+    pkg->gui_help_fname = gfnc_get_string(r);
+    pkg->sample_fname = gfnc_get_string(r);
+    pkg->tags = gfnc_get_string(r);
+    pkg->label = gfnc_get_string(r);
+    pkg->mpath = gfnc_get_string(r);
+    pkg->provider = gfnc_get_string(r);
+    pkg->dreq = gfnc_get_int(r);
+    pkg->modelreq = gfnc_get_int(r);
+    pkg->minver = gfnc_get_int(r);
+    pkg->uses_subdir = gfnc_get_int(r);
+    pkg->data_access = gfnc_get_int(r);
+    pkg->datafiles = gfnc_get_strings(r, &pkg->n_files);
+    pkg->depends = gfnc_get_strings(r, &pkg->n_depends);
+
+    n = gfnc_get_int(r);
+    for (i=0; i<n && !r->err; i++) {
+        gfnc_get_function(r, pkg);
+    }
+    n = gfnc_get_int(r);
+    for (i=0; i<n && !r->err; i++) {
+        gfnc_get_function(r, pkg);
+    }
+
+    if (!r->err && (pkg->name[0] == '\0' || r->pos != r->len)) {
+        r->err = E_DATA;
+    }
+    if (r->err) {
+        function_package_free_full(pkg);
+        pkg = NULL;
+    }
+
+    return pkg;
+}
+
+/* Try reading the package in @fname from its cache file, given
+   the checksum @sum of the gfn. Returns NULL if there's no usable
+   cache.
+*/
+
+static fnpkg *read_package_cache (const char *fname, const char *sum)
+{
+    fnpkg *pkg = NULL;
+    int local;
+
+    for (local=1; local>=0 && pkg == NULL; local--) {
+        gchar *cname = gfnc_filename(fname, local);
+        gfnc_reader r = {0};
+        gchar *buf = NULL;
+
+        if (g_file_get_contents(cname, &buf, &r.len, NULL)) {
+            r.buf = buf;
+            pkg = real_read_package_cache(&r, fname, sum);
+            g_free(buf);
+        }
+        g_free(cname);
+    }
+
+    return pkg;
+}
+
 /* Parse an XML function package file and return an allocated
    package struct with the functions attached. Note that this
    function does not actually "load" the package (making it
@@ -6837,11 +7496,24 @@ static fnpkg *read_package_file (const char *fname,
     fnpkg *pkg = NULL;
     xmlDocPtr doc = NULL;
     xmlNodePtr node = NULL;
+    gchar *sum = NULL;
 
 #if PKG_DEBUG
     fprintf(stderr, "read_package_file: got '%s'\n", fname);
 #endif
 
+    if (get_funcs) {
+        /* try for a current binary image first */
+        sum = gfn_checksum(fname);
+        if (sum != NULL) {
+            pkg = read_package_cache(fname, sum);
+            if (pkg != NULL) {
+                g_free(sum);
+                return pkg;
+            }
+        }
+    }
+
     node = gretl_xml_get_gfn(fname, &doc, err);
     if (!*err) {
         pkg = real_read_package(doc, node, fname, get_funcs, err);
@@ -6851,6 +7523,11 @@ static fnpkg *read_package_file (const char *fname,
         xmlFreeDoc(doc);
     }
 
+    if (!*err && sum != NULL) {
+        write_package_cache(pkg, sum);
+    }
+    g_free(sum);
+
 #if PKG_DEBUG
     fprintf(stderr, "read_function_package: err = %d\n", *err);
 #endif
@@ -8599,6 +9276,9 @@ int gretl_function_append_line (ExecState *state)
             gretl_errmsg_sprintf(_("%s: unbalanced if/else/endif"), fun->name);
             err = E_PARSE;
         }
+        if (!err) {
+            check_memo_comment(fun);
+        }
 #if COMP_DEBUG
         fprintf(stderr, "finished compiling function %s\n", fun->name);
 #endif
@@ -9006,6 +9686,42 @@ static int process_series_arg (fncall *call, fn_param *fp,
     }
 }
 
+/* Can the non-const matrix, bundle or array argument in slot @i
+   of @call share its data with the caller on a copy-on-write
+   basis? Not if the same object is also being supplied in
+   pointer form, since the function could then modify it via
+   the pointer while it's still shared. And an argument that is
+   not a named variable in its own right may be a member or an
+   element of an object that is supplied in pointer form, as in
+   f(b.m, &b) or f(M[1], &M), which we can't detect; so in that
+   case we refuse to share if any argument is a pointer.
+*/
+
+static int arg_can_share (fncall *call, int i)
+{
+    fn_arg *ai = &call->args[i];
+    fn_arg *aj;
+    int j;
+
+    if (ai->type != GRETL_TYPE_MATRIX &&
+        ai->type != GRETL_TYPE_BUNDLE &&
+        !gretl_array_type(ai->type)) {
+        return 0;
+    }
+
+    for (j=0; j<call->argc; j++) {
+        aj = &call->args[j];
+        if (j != i && gretl_ref_type(aj->type)) {
+            if (ai->uvar == NULL || aj->uvar == ai->uvar ||
+                upnames_match(ai, aj)) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
 /* for matrix, bundle, array, string */
 
 static int process_object_arg (fncall *call, int i, fn_param *fp)
@@ -9015,6 +9731,21 @@ static int process_object_arg (fncall *call, int i, fn_param *fp)
     if (param_is_const(fp)) {
         /* we can pass it by reference */
         return localize_const_object(call, i, fp);
+    } else if (arg->owned) {
+        /* hand over the caller's temporary */
+        int err = donate_as_arg(fp->name, arg->type,
+                                arg_get_data(arg, 0));
+
+        if (!err) {
+            arg->owned = 0;
+        }
+        return err;
+    } else if (arg_can_share(call, i)) {
+        /* pass it by value, but defer copying until (unless)
+           the function modifies it
+        */
+        return arg_add_as_cow(fp->name, arg->type,
+                              arg_get_data(arg, 0));
     } else {
         /* pass it by value */
         return copy_as_arg(fp->name, arg->type,
@@ -10279,16 +11010,38 @@ static void set_func_error_message (int err, ufunc *u,
     }
 }
 
+/* The per-line genrs attached to @call are kept sorted by
+   line index, so we can find a given line's genr by bisection.
+   Returns the position of @idx in the array, or (if it's not
+   present) minus one minus the position at which it belongs.
+*/
+
+static int lgen_position (fncall *call, int idx)
+{
+    int lo = 0, hi = call->n_lgen - 1;
+
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+
+        if (call->lgen[mid].idx < idx) {
+            lo = mid + 1;
+        } else if (call->lgen[mid].idx > idx) {
+            hi = mid - 1;
+        } else {
+            return mid;
+        }
+    }
+
+    return -1 - lo;
+}
+
 static GENERATOR *fnline_get_genr (fncall *call, fn_line *line)
 {
     GENERATOR *genr = NULL;
-    int i;
+    int i = lgen_position(call, line->idx);
 
-    for (i=0; i<call->n_lgen; i++) {
-        if (call->lgen[i].idx == line->idx) {
-            genr = call->lgen[i].genr;
-            break;
-        }
+    if (i >= 0) {
+        genr = call->lgen[i].genr;
     }
 
 #if REC_DEBUG
@@ -10303,19 +11056,31 @@ static int fnline_set_genr (fncall *call, fn_line *line, GENERATOR *genr)
 {
     linegen *lgen;
     int n = call->n_lgen;
-    int err = 0;
+    int i, err = 0;
 
+    i = lgen_position(call, line->idx);
+    if (i >= 0) {
+        /* shouldn't happen, but replace the existing genr */
+        destroy_genr(call->lgen[i].genr);
+        call->lgen[i].genr = genr;
+        return 0;
+    }
+
+    i = -1 - i;
     lgen = realloc(call->lgen, (n + 1) * sizeof *lgen);
     if (lgen == NULL) {
         err = E_ALLOC;
     } else {
         call->lgen = lgen;
-        call->lgen[n].idx = line->idx;
-        call->lgen[n].genr = genr;
+        if (i < n) {
+            memmove(lgen + i + 1, lgen + i, (n - i) * sizeof *lgen);
+        }
+        call->lgen[i].idx = line->idx;
+        call->lgen[i].genr = genr;
         call->n_lgen = n + 1;
 #if REC_DEBUG
         fprintf(stderr, "++ adding genr %p for call %p line idx %d (n_lgen %d)\n",
-                (void *) *pgen, (void *) call, line->idx, call->n_lgen);
+                (void *) genr, (void *) call, line->idx, call->n_lgen);
 #endif
     }
 
@@ -10470,6 +11235,10 @@ int current_function_size (void)
 
 static gchar *return_line;
 
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(return_line)
+#endif
+
 /* to be called when a "return" statement occurs within a
    loop that's being called by a function
 */
@@ -10587,8 +11356,257 @@ static void restore_dataset_for_caller(ExecState *state,
     dset->t2 = orig_t2;
 }
 
+/* memoization: bounds on the number of cached values per function
+   and on the size of the argument content used as key */
+#define MEMO_MAX_ENTRIES 256
+#define MEMO_MAX_KEYLEN (1 << 20)
+
+#define memo_return_ok(t) (t == GRETL_TYPE_DOUBLE || \
+                           t == GRETL_TYPE_MATRIX || \
+                           t == GRETL_TYPE_STRING || \
+                           t == GRETL_TYPE_BUNDLE)
+
+static void memo_append (GByteArray *a, const void *p, guint n)
+{
+    g_byte_array_append(a, (const guint8 *) p, n);
+}
+
+/* Compose the cache key for @call from the content of its
+   arguments. Returns NULL if the call is not eligible for
+   memoization: if any argument is not a scalar, matrix or string,
+   or is passed in pointer form.
+*/
+
+static GBytes *memo_key (fncall *call)
+{
+    GByteArray *a = g_byte_array_new();
+    int i, ok = 1;
+
+    memo_append(a, &call->argc, sizeof call->argc);
+
+    for (i=0; i<call->argc && ok; i++) {
+        fn_arg *arg = &call->args[i];
+        int t = arg->type;
+
+        memo_append(a, &t, sizeof t);
+        if (gretl_ref_type(call->fun->params[i].type)) {
+            ok = 0;
+        } else if (t == GRETL_TYPE_NONE) {
+            ; /* omitted argument: the type suffices */
+        } else if (t == GRETL_TYPE_DOUBLE || t == GRETL_TYPE_INT ||
+                   t == GRETL_TYPE_OBS) {
+            memo_append(a, &arg->val.x, sizeof(double));
+        } else if (t == GRETL_TYPE_MATRIX) {
+            const gretl_matrix *m = arg->val.m;
+            int dim[3] = {-1, -1, 0};
+
+            if (m != NULL) {
+                dim[0] = m->rows;
+                dim[1] = m->cols;
+                dim[2] = m->is_complex;
+            }
+            memo_append(a, dim, sizeof dim);
+            if (m != NULL && m->rows * m->cols > 0) {
+                guint n = m->rows * m->cols * (m->is_complex ? 2 : 1);
+
+                if (n > MEMO_MAX_KEYLEN / sizeof(double)) {
+                    ok = 0;
+                } else {
+                    memo_append(a, m->val, n * sizeof(double));
+                }
+            }
+        } else if (t == GRETL_TYPE_STRING) {
+            const char *str = arg->val.str != NULL ? arg->val.str : "";
+
+            memo_append(a, str, strlen(str) + 1);
+        } else {
+            ok = 0;
+        }
+        if (a->len > MEMO_MAX_KEYLEN) {
+            ok = 0;
+        }
+    }
+
+    if (!ok) {
+        g_byte_array_free(a, TRUE);
+        return NULL;
+    }
+
+    return g_byte_array_free_to_bytes(a);
+}
+
+/* On a cache hit, write a copy of the stored value for @key into
+   @ret, in the form expected by the caller of the function, and
+   return 1; otherwise return 0.
+*/
+
+static int memo_lookup (ufunc *u, GBytes *key, void *ret)
+{
+    static double xret;
+    memo_val *mv;
+    int err = 0;
+
+    if (u->memo == NULL) {
+        u->memo = calloc(1, sizeof *u->memo);
+        if (u->memo == NULL) {
+            return 0;
+        }
+        u->memo->ht = g_hash_table_new_full(g_bytes_hash, g_bytes_equal,
+                                            (GDestroyNotify) g_bytes_unref,
+                                            memo_val_free);
+        u->memo->keys = g_queue_new();
+    }
+
+    mv = g_hash_table_lookup(u->memo->ht, key);
+    if (mv == NULL) {
+        u->memo->misses += 1;
+        return 0;
+    }
+
+    if (mv->type == GRETL_TYPE_DOUBLE) {
+        xret = mv->x;
+        *(double **) ret = &xret;
+    } else if (mv->type == GRETL_TYPE_MATRIX) {
+        gretl_matrix *m = gretl_matrix_copy(mv->ptr);
+
+        if (m == NULL) {
+            return 0;
+        }
+        *(gretl_matrix **) ret = m;
+    } else if (mv->type == GRETL_TYPE_STRING) {
+        char *str = gretl_strdup(mv->ptr);
+
+        if (str == NULL) {
+            return 0;
+        }
+        *(char **) ret = str;
+    } else {
+        gretl_bundle *b = gretl_bundle_copy(mv->ptr, &err);
+
+        if (err) {
+            return 0;
+        }
+        *(gretl_bundle **) ret = b;
+    }
+
+    u->memo->hits += 1;
+
+    return 1;
+}
+
+/* Store a copy of the value returned by a call to @u, as found in
+   @ret, under @key; if the cache is full we drop the oldest entry.
+*/
+
+static void memo_store (ufunc *u, GBytes *key, GretlType type, void *ret)
+{
+    memo_val *mv;
+    int err = 0;
+
+    if (u->memo == NULL || g_hash_table_contains(u->memo->ht, key)) {
+        return;
+    }
+
+    mv = calloc(1, sizeof *mv);
+    if (mv == NULL) {
+        return;
+    }
+
+    mv->type = type;
+    if (type == GRETL_TYPE_DOUBLE) {
+        mv->x = **(double **) ret;
+    } else if (type == GRETL_TYPE_MATRIX) {
+        mv->ptr = gretl_matrix_copy(*(gretl_matrix **) ret);
+    } else if (type == GRETL_TYPE_STRING) {
+        mv->ptr = gretl_strdup(*(char **) ret);
+    } else {
+        mv->ptr = gretl_bundle_copy(*(gretl_bundle **) ret, &err);
+    }
+
+    if (type != GRETL_TYPE_DOUBLE && mv->ptr == NULL) {
+        free(mv);
+        return;
+    }
+
+    if (g_queue_get_length(u->memo->keys) >= MEMO_MAX_ENTRIES) {
+        GBytes *oldest = g_queue_pop_head(u->memo->keys);
+
+        g_hash_table_remove(u->memo->ht, oldest);
+    }
+
+    g_hash_table_insert(u->memo->ht, g_bytes_ref(key), mv);
+    g_queue_push_tail(u->memo->keys, key);
+}
+
+static void memo_stats_set (gretl_bundle *b, int hits, int misses,
+                            int entries)
+{
+    gretl_bundle_set_int(b, "hits", hits);
+    gretl_bundle_set_int(b, "misses", misses);
+    gretl_bundle_set_int(b, "entries", entries);
+}
+
+/**
+ * memo_stats_bundle:
+ * @err: location to receive error code.
+ *
+ * Returns: a bundle holding the total numbers of cache hits and
+ * misses, and of cached values, for functions marked for
+ * memoization, plus a sub-bundle "functions" holding the same
+ * information for each such function, keyed by name.
+ */
+
+gretl_bundle *memo_stats_bundle (int *err)
+{
+    gretl_bundle *b = gretl_bundle_new();
+    gretl_bundle *fb = gretl_bundle_new();
+    int hits = 0, misses = 0, entries = 0;
+    int i;
+
+    if (b == NULL || fb == NULL) {
+        gretl_bundle_destroy(b);
+        gretl_bundle_destroy(fb);
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    for (i=0; i<n_ufuns; i++) {
+        ufunc *u = ufuns[i];
+
+        if (function_is_memoized(u)) {
+            gretl_bundle *ub = gretl_bundle_new();
+            fnmemo *memo = u->memo;
+            int h = 0, m = 0, n = 0;
+
+            if (memo != NULL) {
+                h = memo->hits;
+                m = memo->misses;
+                n = g_hash_table_size(memo->ht);
+            }
+            if (ub != NULL) {
+                memo_stats_set(ub, h, m, n);
+                gretl_bundle_donate_data(fb, u->name, ub,
+                                         GRETL_TYPE_BUNDLE, 0);
+            }
+            hits += h;
+            misses += m;
+            entries += n;
+        }
+    }
+
+    memo_stats_set(b, hits, misses, entries);
+    gretl_bundle_donate_data(b, "functions", fb, GRETL_TYPE_BUNDLE, 0);
+
+    return b;
+}
+
+/* number of completed calls after which we compile a function's
+   genrs even when not iterating */
+#define FN_COMPILE_CALLS 2
+
 #define do_if_check(c) (c == IF || c == ELIF || c == ELSE || c == ENDIF)
 #define may_have_genr(c) (c == IF || c == ELIF || c == GENR)
+#define is_if_cond(c) (c == IF || c == ELIF)
 
 int gretl_function_exec_full (fncall *call, int rtype, DATASET *dset,
                               void *ret, char **descrip,
@@ -10597,6 +11615,7 @@ int gretl_function_exec_full (fncall *call, int rtype, DATASET *dset,
     ufunc *u = call->fun;
     ExecState *state = NULL;
     GENERATOR *genr = NULL;
+    GBytes *memokey = NULL;
     CMD cmd = {0};
     void *ptr = NULL;
     int orig_n = 0;
@@ -10606,6 +11625,7 @@ int gretl_function_exec_full (fncall *call, int rtype, DATASET *dset,
     int redir_level = 0;
     int retline = -1;
     int gencomp = 0;
+    int ifcomp = 0;
     int n_saved = 0;
     int i, j, err = 0;
 
@@ -10634,11 +11654,24 @@ int gretl_function_exec_full (fncall *call, int rtype, DATASET *dset,
     indent0 = gretl_if_state_record();
 
     err = check_function_args(call, prn);
+    if (!err && function_is_memoized(u) && rtype == u->rettype &&
+        memo_return_ok(rtype) && ret != NULL) {
+        memokey = memo_key(call);
+        if (memokey != NULL && memo_lookup(u, memokey, ret)) {
+            /* got a cached return value */
+            g_bytes_unref(memokey);
+            maybe_destroy_fncall(&call);
+            return 0;
+        }
+    }
     if (!err) {
         err = allocate_function_args(call, dset);
     }
     if (err) {
         /* get out before allocating further storage */
+        if (memokey != NULL) {
+            g_bytes_unref(memokey);
+        }
         maybe_destroy_fncall(&call);
         return err;
     }
@@ -10653,23 +11686,40 @@ int gretl_function_exec_full (fncall *call, int rtype, DATASET *dset,
         start_fncall(call, dset, prn);
         started = 1;
         redir_level = print_redirection_level(prn);
+        gretl_profile_enter(u->name);
+        gretl_trace_function_begin(u->name, dset);
     }
 
-    /* when should we try to compile genrs, loops? */
+    /* when should we try to compile genrs, loops? Besides the case
+       of iteration, do so once a function has been called often
+       enough (FN_COMPILE_CALLS) that it's likely to be called again:
+       the compiled genrs are attached to the fncall, which persists
+       across calls, and their variable pointers are reset on exit.
+    */
 #if COMPILE_RECURSIVE
     /* as of 2024-05-08 this seems to be too risky */
-    gencomp = gretl_iterating() && !get_loop_renaming();
+    gencomp = (gretl_iterating() || u->n_exec >= FN_COMPILE_CALLS) &&
+        !get_loop_renaming();
 #else
     /* add clause to cut out functions that recurse */
-    gencomp = gretl_iterating() && !get_loop_renaming() &&
-	!function_is_recursive(u);
+    gencomp = (gretl_iterating() || u->n_exec >= FN_COMPILE_CALLS) &&
+        !get_loop_renaming() && !function_is_recursive(u);
 #endif
 
+    /* An if-condition has to be parsed in any case to be evaluated,
+       so it costs nothing to keep it in compiled form from the first
+       call on: subsequent executions of the line, on this call or a
+       later one, then skip straight to evaluation.
+    */
+    ifcomp = gencomp || (!get_loop_renaming() && !function_is_recursive(u));
+
     /* get function lines in sequence and check, parse, execute */
 
     for (i=0; i<u->n_lines && !err; i++) {
         fn_line *fline = &u->lines[i];
-        int this_gencomp = gencomp && !line_no_comp(fline);
+        int this_gencomp = is_if_cond(fline->ci) ? ifcomp : gencomp;
+
+        this_gencomp = this_gencomp && !line_no_comp(fline);
 
         if (gretl_echo_on()) {
             pprintf(prn, "? %s\n", fline->s);
@@ -10679,6 +11729,9 @@ int gretl_function_exec_full (fncall *call, int rtype, DATASET *dset,
         }
         strcpy(state->line, fline->s); /* needed? */
         call->line = fline;
+        if (gretl_profiling()) {
+            gretl_profile_line(fline->s, fline->idx);
+        }
 
         if (this_gencomp && may_have_genr(fline->ci)) {
             genr = fnline_get_genr(call, fline);
@@ -10698,12 +11751,16 @@ int gretl_function_exec_full (fncall *call, int rtype, DATASET *dset,
                 flow_control(state, NULL, NULL);
             } else if (genr != NULL) {
                 state->cmd->ci = fline->ci;
+                state->cmd->err = 0;
                 flow_control(state, dset, &genr);
+                err = state->cmd->err;
+                n_saved++;
             } else {
                 ptr = this_gencomp ? &genr : NULL;
                 err = maybe_exec_line(state, dset, ptr);
                 if (genr != NULL) {
                     fnline_set_genr(call, fline, genr);
+                    n_saved++;
                 } else if (ptr != NULL) {
                     fline->flags |= LINE_NOCOMP;
                 }
@@ -10801,6 +11858,17 @@ int gretl_function_exec_full (fncall *call, int rtype, DATASET *dset,
 
     function_assign_returns(call, rtype, dset, ret, descrip, stab, prn, &err);
 
+    if (memokey != NULL) {
+        if (!err) {
+            memo_store(u, memokey, rtype, ret);
+        }
+        g_bytes_unref(memokey);
+    }
+
+    if (!err && u->n_exec < FN_COMPILE_CALLS) {
+        u->n_exec++;
+    }
+
     if (gencomp || n_saved > 0) {
         reset_saved_uservars(call->fun, 0);
     }
@@ -10811,6 +11879,9 @@ int gretl_function_exec_full (fncall *call, int rtype, DATASET *dset,
     if (started) {
         int stoperr = stop_fncall(call, rtype, ret, dset, prn, redir_level);
 
+        gretl_profile_leave();
+        gretl_trace_function_end(u->name);
+
         if (stoperr && !err) {
             err = stoperr;
         }
@@ -10948,8 +12019,6 @@ int object_is_function_arg (const char *name)
     return 0;
 }
 
-static int allow_full_data;
-
 void allow_full_data_access (int s)
 {
     if (s > 0) {
@@ -11086,6 +12155,46 @@ void gretl_functions_cleanup (void)
     n_pkgs = 0;
 }
 
+/**
+ * gretl_functions_thread_init:
+ *
+ * Gives the calling thread an empty table of user functions and
+ * packages, and a function call stack, of its own in place of the
+ * program-wide ones. Called by libgretl_thread_init().
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int gretl_functions_thread_init (void)
+{
+    if (thread_uft == NULL) {
+        thread_uft = calloc(1, sizeof *thread_uft);
+        if (thread_uft == NULL) {
+            return E_ALLOC;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * gretl_functions_thread_cleanup:
+ *
+ * Frees the user functions and packages belonging to the calling
+ * thread, if it has a table of its own, and reverts the thread to
+ * the program-wide table.
+ */
+
+void gretl_functions_thread_cleanup (void)
+{
+    if (thread_uft != NULL) {
+        gretl_functions_cleanup();
+        g_list_free(callstack);
+        free(thread_uft);
+        thread_uft = NULL;
+    }
+}
+
 static void show_gfn_help (fnpkg *pkg, int gui_help,
                            int markup, PRN *prn)
 {
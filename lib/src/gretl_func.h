@@ -53,7 +53,8 @@ typedef enum {
     UFUN_USES_SET  = 1 << 3, /* includes the "set" command */
     UFUN_HAS_FLOW  = 1 << 4, /* includes flow-control (ifs, loops) */
     UFUN_RECURSES  = 1 << 5, /* includes a call to itself */
-    UFUN_ASSIGN    = 1 << 6  /* GUI usage: return must be assigned */
+    UFUN_ASSIGN    = 1 << 6, /* GUI usage: return must be assigned */
+    UFUN_MEMO      = 1 << 7  /* return values are cached ("memoize") */
 } UfunAttrs;
 
 #define NEEDS_TS    "needs-time-series-data"
@@ -302,6 +303,8 @@ int print_function_package_info (const char *fname, int gui_mode,
 
 int bundle_function_package_info (const char *fname, gretl_bundle *b);
 
+gretl_bundle *memo_stats_bundle (int *err);
+
 int print_function_package_code (const char *fname, int tabwidth,
 				 PRN *prn);
 
@@ -338,6 +341,10 @@ int package_needs_zipping (const char *fname,
 
 void gretl_functions_cleanup (void);
 
+int gretl_functions_thread_init (void);
+
+void gretl_functions_thread_cleanup (void);
+
 int push_function_arg (fncall *fc, const char *name,
 		       void *uvar, GretlType type,
 		       void *value);
@@ -345,6 +352,9 @@ int push_function_arg (fncall *fc, const char *name,
 int push_anon_function_arg (fncall *fc, GretlType type,
 			    void *value);
 
+int push_temp_function_arg (fncall *fc, GretlType type,
+			    void *value, int *taken);
+
 int set_anon_function_arg (fncall *fc, int i, GretlType type,
 			   void *value);
 
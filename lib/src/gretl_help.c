@@ -210,6 +210,137 @@ static int output_help_text (const char *cmd, FILE *fp,
     return ok;
 }
 
+/* Topic index for the CLI help files: for each file, a hash table
+   mapping topic words to the offset (plus 1) of the "# topic" line,
+   built the first time the file is consulted. It is read from the
+   companion file "<helpfile>.idx" written by doc/commands/helpidx
+   at build time if that is present and matches the help file in
+   size, otherwise it is put together by a single pass over the help
+   file itself. Tables are keyed by path, so a change of language
+   just brings in a fresh one.
+*/
+
+static GHashTable *help_indices;
+
+static unsigned get_u32 (const unsigned char *s)
+{
+    return s[0] | (s[1] << 8) | (s[2] << 16) | ((unsigned) s[3] << 24);
+}
+
+static GHashTable *read_help_index (const char *helpfile)
+{
+    GHashTable *ht = NULL;
+    char idxfile[FILENAME_MAX];
+    unsigned char *buf = NULL;
+    struct stat st;
+    long len = 0;
+    FILE *fp;
+
+    if (gretl_stat(helpfile, &st) != 0) {
+	return NULL;
+    }
+
+    sprintf(idxfile, "%s.idx", helpfile);
+    fp = gretl_fopen(idxfile, "rb");
+    if (fp == NULL) {
+	return NULL;
+    }
+
+    if (fseek(fp, 0, SEEK_END) == 0 && (len = ftell(fp)) > 16) {
+	rewind(fp);
+	buf = malloc(len);
+	if (buf != NULL && fread(buf, 1, len, fp) != (size_t) len) {
+	    free(buf);
+	    buf = NULL;
+	}
+    }
+    fclose(fp);
+
+    if (buf != NULL && !memcmp(buf, "gretlhix", 8) &&
+	get_u32(buf + 12) == (unsigned) st.st_size) {
+	unsigned i, n = get_u32(buf + 8);
+	unsigned char *s = buf + 16;
+	unsigned char *end = buf + len;
+	unsigned offset;
+	int wlen;
+
+	ht = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	for (i=0; i<n && ht != NULL; i++) {
+	    if (end - s < 5 || end - s - 5 < s[4]) {
+		/* truncated: don't trust it */
+		g_hash_table_destroy(ht);
+		ht = NULL;
+	    } else {
+		offset = get_u32(s);
+		wlen = s[4];
+		g_hash_table_insert(ht, g_strndup((char *) s + 5, wlen),
+				    GSIZE_TO_POINTER((gsize) offset + 1));
+		s += 5 + wlen;
+	    }
+	}
+    }
+
+    free(buf);
+
+    return ht;
+}
+
+static GHashTable *scan_help_index (FILE *fp)
+{
+    GHashTable *ht;
+    char word[16], line[HELPLEN];
+    int bol = 1;
+    long pos;
+
+    ht = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    while ((pos = ftell(fp)) >= 0 && fgets(line, sizeof line, fp) != NULL) {
+	if (bol && line[0] == '#' && line[1] == ' ' &&
+	    sscanf(line + 2, "%15s", word) == 1) {
+	    g_hash_table_insert(ht, g_strdup(word),
+				GSIZE_TO_POINTER((gsize) pos + 1));
+	}
+	bol = strchr(line, '\n') != NULL;
+    }
+
+    rewind(fp);
+
+    return ht;
+}
+
+/* Position @fp, which is open on @helpfile, at the start of the
+   entry for @word, if it can be found in the index; otherwise
+   leave it at the start of the file, for a linear search.
+*/
+
+static void help_seek (FILE *fp, const char *helpfile,
+		       const char *word)
+{
+    GHashTable *ht = NULL;
+    gpointer p;
+
+    if (help_indices == NULL) {
+	help_indices = g_hash_table_new_full(g_str_hash, g_str_equal,
+					     g_free, (GDestroyNotify)
+					     g_hash_table_destroy);
+    } else {
+	ht = g_hash_table_lookup(help_indices, helpfile);
+    }
+
+    if (ht == NULL) {
+	ht = read_help_index(helpfile);
+	if (ht == NULL) {
+	    ht = scan_help_index(fp);
+	}
+	g_hash_table_insert(help_indices, g_strdup(helpfile), ht);
+    }
+
+    p = g_hash_table_lookup(ht, word);
+    if (p != NULL && fseek(fp, GPOINTER_TO_SIZE(p) - 1, SEEK_SET) != 0) {
+	rewind(fp);
+    }
+}
+
 static void do_help_on_help (PRN *prn)
 {
     int i, j;
@@ -472,7 +603,8 @@ int cli_help (const char *hlpword, const char *param,
 	if (!gretl_in_gui_mode() && recode < 0) {
 	    recode = maybe_need_recode();
 	}
-	/* actually output the relevant help text */
+	/* go straight to the entry, then output the relevant text */
+	help_seek(fp, helpfile, param != NULL ? "set" : hlpword);
 	if (param != NULL) {
 	    ok = do_set_help(param, fp, recode, prn);
 	} else {
@@ -35,6 +35,9 @@
 #define TDEBUG 0    /* handling of time keys in "join" */
 #define JDEBUG 0    /* joining in general */
 
+#define JOIN_OMP_MIN 100000 /* minimum inner obs for parallel key lookup */
+#define JOIN_STREAM_MIN (4 << 20) /* minimum CSV size for prescreening */
+
 enum {
     JOIN_KEY,
     JOIN_F1,
@@ -76,11 +79,15 @@ typedef struct obskey_ obskey;
 struct joiner_ {
     int n_rows;     /* number of rows in data table */
     int n_keys;     /* number of keys used (0, 1 or 2) */
-    int n_unique;   /* number of unique primary key values on right */
+    int n_unique;   /* number of unique key values (or pairs) on right */
     jr_row *rows;   /* array of table rows */
     keynum *keys;   /* array of unique (primary) key values as doubles */
-    int *key_freq;  /* counts of occurrences of (primary) key values */
-    int *key_row;   /* record of starting row in joiner table for primary keys */
+    keynum *keys2;  /* matching secondary key values, if applicable */
+    int *key_freq;  /* counts of occurrences of key values */
+    int *key_row;   /* record of starting row in joiner table for keys */
+    int *htab;      /* hash table mapping keys to groups of rows */
+    int *ptab;      /* hash table of primary keys, if there are two keys */
+    int hmask;      /* size of hash tables, minus 1 */
     int *str_keys;  /* flags for string comparison of key(s) */
     const int *l_keyno; /* list of key columns in left-hand dataset */
     const int *r_keyno; /* list of key columns in right-hand dataset */
@@ -123,6 +130,8 @@ struct jr_matcher_ {
 typedef struct jr_matcher_ jr_matcher;
 
 #define KEYMISS -999
+#define JR_NOMATCH -1
+#define JR_NOMATCH2 -2
 
 #define is_wildstr(s) (strchr(s, '*') || strchr(s, '?'))
 
@@ -146,8 +155,11 @@ static void joiner_destroy (joiner *jr)
     if (jr != NULL) {
         free(jr->rows);
         free(jr->keys);
+        free(jr->keys2);
         free(jr->key_freq);
         free(jr->key_row);
+        free(jr->htab);
+        free(jr->ptab);
         free(jr);
     }
 }
@@ -168,8 +180,12 @@ static joiner *joiner_new (int nrows)
         jr->n_rows = nrows;
         jr->n_unique = 0;
         jr->keys = NULL;
+        jr->keys2 = NULL;
         jr->key_freq = NULL;
         jr->key_row = NULL;
+        jr->htab = NULL;
+        jr->ptab = NULL;
+        jr->hmask = 0;
         jr->l_keyno = NULL;
         jr->r_keyno = NULL;
     }
@@ -701,151 +717,263 @@ static joiner *build_joiner (joinspec *jspec,
     return jr;
 }
 
-/* qsort callback for sorting rows of the joiner struct */
+/* Hashing of key values: the keys are held as doubles, but they
+   are matched exactly, so we can hash their bit patterns, after
+   mapping -0 to 0. The mixing function is the finalizer of
+   splitmix64.
 
-static int compare_jr_rows (const void *a, const void *b)
-{
-    const jr_row *ra = a;
-    const jr_row *rb = b;
-    int ret;
+   Note that the binary search that this replaced compared primary
+   keys with an absolute tolerance of 1.0e-7, though not reliably,
+   since the test was applied only at the midpoint of each range.
+   Keys are normally integers (or string indices), for which the
+   two criteria agree; the exact criterion is stated in the
+   documentation of "join", with the advice to round computed keys.
+*/
 
-    ret = (ra->keyval > rb->keyval) - (ra->keyval < rb->keyval);
+static guint64 keynum_hash (keynum k)
+{
+    guint64 h;
 
-    if (ret == 0 && ra->n_keys > 1) {
-        ret = (ra->keyval2 > rb->keyval2) - (ra->keyval2 < rb->keyval2);
+    if (k == 0) {
+        k = 0.0;
     }
+    memcpy(&h, &k, sizeof h);
+    h ^= h >> 30;
+    h *= G_GUINT64_CONSTANT(0xbf58476d1ce4e5b9);
+    h ^= h >> 27;
+    h *= G_GUINT64_CONSTANT(0x94d049bb133111eb);
+    h ^= h >> 31;
 
-    if (ret == 0) {
-        /* ensure stable sort */
-        ret = a - b > 0 ? 1 : -1;
+    return h;
+}
+
+static guint64 joiner_key_hash (const joiner *jr, keynum k1, keynum k2)
+{
+    guint64 h = keynum_hash(k1);
+
+    if (jr->n_keys > 1) {
+        h ^= keynum_hash(k2) + G_GUINT64_CONSTANT(0x9e3779b97f4a7c15)
+            + (h << 6) + (h >> 2);
     }
 
-    return ret;
+    return h;
 }
 
-/* Sort the rows of the joiner struct, by either one or two keys, then
-   figure out how many unique (primary) key values we have and
-   construct (a) an array of frequency of occurrence of these values
-   and (b) an array which records the first row of the joiner on
-   which each of these values is found.
+#define JR_EMPTY -1
+
+/* Return the slot in @tab at which the key (@k1, @k2) is found,
+   or the empty slot at which it should be inserted. If @primary
+   is non-zero the secondary key is ignored.
 */
 
-static int joiner_sort (joiner *jr)
+static int joiner_probe (const joiner *jr, const int *tab,
+                         keynum k1, keynum k2, int primary)
 {
-    int matches = jr->n_rows;
-    int i, err = 0;
+    guint64 h;
+    int g, i;
 
-    /* If there are string keys, we begin by mapping from the string
-       indices on the right -- held in the keyval and/or keyval2
-       members of the each joiner row -- to the indices for the same
-       strings on the left. This enables us to avoid doing string
-       comparisons when running aggr_value() later; we can just
-       compare the indices of the strings. In addition, if on any
-       given row we get no match for the right-hand key string on the
-       left (signalled by a strmap value of -1) we can exploit this
-       information by shuffling such rows to the end of the joiner
-       rectangle and ignoring them when aggregating.
-    */
+    if (primary) {
+        h = keynum_hash(k1);
+    } else {
+        h = joiner_key_hash(jr, k1, k2);
+    }
 
-    if (jr->str_keys[0] || jr->str_keys[1]) {
-        series_table *stl, *str;
-        int *strmap;
-        int k, kmin, kmax, lkeyval, rkeyval;
+    i = (int) (h & jr->hmask);
 
-        kmin = jr->str_keys[0] ? 1 : 2;
-        kmax = jr->str_keys[1] ? 2 : 1;
+    while ((g = tab[i]) != JR_EMPTY) {
+        if (jr->keys[g] == k1 &&
+            (primary || jr->n_keys < 2 || jr->keys2[g] == k2)) {
+            break;
+        }
+        i = (i + 1) & jr->hmask;
+    }
 
-        for (k=kmin; k<=kmax; k++) {
-            stl = series_get_string_table(jr->l_dset, jr->l_keyno[k]);
-            str = series_get_string_table(jr->r_dset, jr->r_keyno[k]);
-            strmap = series_table_map(str, stl);
+    return i;
+}
 
-            if (strmap == NULL) {
-                err = E_ALLOC;
-                break;
-            }
+/* If there are string keys, we begin by mapping from the string
+   indices on the right -- held in the keyval and/or keyval2
+   members of the each joiner row -- to the indices for the same
+   strings on the left. This enables us to avoid doing string
+   comparisons when running aggr_value() later; we can just compare
+   the indices of the strings. In addition, if on any given row we
+   get no match for the right-hand key string on the left (signalled
+   by a strmap value of -1) we can drop that row from the joiner,
+   since it cannot contribute to the join.
+*/
 
-            for (i=0; i<jr->n_rows; i++) {
-                if (k == 1) {
-                    rkeyval = jr->rows[i].keyval;
-                } else if (jr->rows[i].keyval == INT_MAX) {
-                    continue;
-                } else {
-                    rkeyval = jr->rows[i].keyval2;
-                }
-                lkeyval = strmap[rkeyval];
+static int joiner_map_string_keys (joiner *jr)
+{
+    series_table *stl, *str;
+    int *strmap;
+    int k, kmin, kmax, lkeyval, rkeyval;
+    int i, j, err = 0;
+
+    kmin = jr->str_keys[0] ? 1 : 2;
+    kmax = jr->str_keys[1] ? 2 : 1;
+
+    for (k=kmin; k<=kmax; k++) {
+        stl = series_get_string_table(jr->l_dset, jr->l_keyno[k]);
+        str = series_get_string_table(jr->r_dset, jr->r_keyno[k]);
+        strmap = series_table_map(str, stl);
+
+        if (strmap == NULL) {
+            err = E_ALLOC;
+            break;
+        }
+
+        for (i=0; i<jr->n_rows; i++) {
+            if (isnan(jr->rows[i].keyval)) {
+                /* already dropped */
+                continue;
+            }
+            rkeyval = k == 1 ? jr->rows[i].keyval : jr->rows[i].keyval2;
+            lkeyval = strmap[rkeyval];
 #if JDEBUG > 1
-                fprintf(stderr, "k = %d, row %d, keyval: %d -> %d\n", k, i, rkeyval, lkeyval);
+            fprintf(stderr, "k = %d, row %d, keyval: %d -> %d\n", k, i, rkeyval, lkeyval);
 #endif
-                if (lkeyval > 0) {
-                    if (k == 1) {
-                        jr->rows[i].keyval = lkeyval;
-                    } else {
-                        jr->rows[i].keyval2 = lkeyval;
-                    }
+            if (lkeyval > 0) {
+                if (k == 1) {
+                    jr->rows[i].keyval = lkeyval;
                 } else {
-                    /* arrange for qsort to move row to end */
-                    jr->rows[i].keyval = G_MAXDOUBLE;
-                    matches--;
+                    jr->rows[i].keyval2 = lkeyval;
                 }
+            } else {
+                /* mark the row for removal */
+                jr->rows[i].keyval = NADBL;
             }
+        }
+
+        free(strmap);
+    }
 
-            free(strmap);
+    if (!err) {
+        /* squeeze out the unmatched rows, preserving order */
+        for (i=0, j=0; i<jr->n_rows; i++) {
+            if (!isnan(jr->rows[i].keyval)) {
+                if (j < i) {
+                    jr->rows[j] = jr->rows[i];
+                }
+                j++;
+            }
         }
+        jr->n_rows = j;
     }
 
-    if (err) {
-        return err;
+    return err;
+}
+
+/* Group the rows of the joiner struct by key value -- by the
+   composite of the primary and secondary keys if there are two
+   -- using a hash table, then rearrange the rows so that each
+   group is contiguous, with the rows in their original order
+   within each group. We record (a) the key values for each
+   group, (b) the number of rows in each group and (c) the
+   starting row of each group, and we keep the hash table for
+   matching the inner keys. In the two-key case we also build a
+   table of the distinct primary keys, so we can tell a missing
+   secondary match from a missing primary one.
+*/
+
+static int joiner_hash (joiner *jr)
+{
+    jr_row *rows;
+    int *grp, *next;
+    int n, nalloc;
+    int i, s, g;
+    int err = 0;
+
+    if (jr->str_keys[0] || jr->str_keys[1]) {
+        err = joiner_map_string_keys(jr);
+        if (err) {
+            return err;
+        }
+    }
+
+    n = jr->n_rows;
+    nalloc = n > 0 ? n : 1;
+
+    /* table of at least twice the number of rows */
+    jr->hmask = 1;
+    while (jr->hmask < 2 * n) {
+        jr->hmask <<= 1;
     }
+    jr->hmask -= 1;
+
+    jr->htab = malloc((jr->hmask + 1) * sizeof *jr->htab);
+    jr->keys = malloc(nalloc * sizeof *jr->keys);
+    jr->keys2 = malloc(nalloc * sizeof *jr->keys2);
+    jr->key_freq = calloc(nalloc, sizeof *jr->key_freq);
+    jr->key_row = malloc(nalloc * sizeof *jr->key_row);
+    grp = malloc(nalloc * sizeof *grp);
 
-    qsort(jr->rows, jr->n_rows, sizeof *jr->rows, compare_jr_rows);
+    if (jr->htab == NULL || jr->keys == NULL || jr->keys2 == NULL ||
+        jr->key_freq == NULL || jr->key_row == NULL || grp == NULL) {
+        free(grp);
+        return E_ALLOC;
+    }
 
-    if (matches < jr->n_rows) {
-        jr->n_rows = matches;
+    for (i=0; i<=jr->hmask; i++) {
+        jr->htab[i] = JR_EMPTY;
     }
 
-    jr->n_unique = 1;
-    for (i=1; i<jr->n_rows; i++) {
-        if (jr->rows[i].keyval != jr->rows[i-1].keyval) {
-            jr->n_unique += 1;
+    jr->n_unique = 0;
+
+    for (i=0; i<n; i++) {
+        jr_row *r = &jr->rows[i];
+
+        s = joiner_probe(jr, jr->htab, r->keyval, r->keyval2, 0);
+        g = jr->htab[s];
+        if (g == JR_EMPTY) {
+            /* a new key (combination) */
+            g = jr->n_unique++;
+            jr->htab[s] = g;
+            jr->keys[g] = r->keyval;
+            jr->keys2[g] = jr->n_keys > 1 ? r->keyval2 : 0;
         }
+        jr->key_freq[g] += 1;
+        grp[i] = g;
     }
 
-    jr->keys = malloc(jr->n_unique * sizeof *jr->keys);
-    jr->key_freq = malloc(jr->n_unique * sizeof *jr->key_freq);
-    jr->key_row = malloc(jr->n_unique * sizeof *jr->key_row);
+    /* starting rows, and a stable scatter of the rows into
+       contiguous groups */
+    rows = malloc(nalloc * sizeof *rows);
+    next = malloc(nalloc * sizeof *next);
 
-    if (jr->keys == NULL || jr->key_freq == NULL || jr->key_row == NULL) {
+    if (rows == NULL || next == NULL) {
+        free(rows);
         err = E_ALLOC;
     } else {
-        int j = 0, nj = 1;
-
-        for (i=0; i<jr->n_unique; i++) {
-            jr->key_freq[i] = 0;
+        s = 0;
+        for (g=0; g<jr->n_unique; g++) {
+            jr->key_row[g] = next[g] = s;
+            s += jr->key_freq[g];
         }
+        for (i=0; i<n; i++) {
+            rows[next[grp[i]]++] = jr->rows[i];
+        }
+        free(jr->rows);
+        jr->rows = rows;
+    }
 
-        jr->keys[0] = jr->rows[0].keyval;
-        jr->key_row[0] = 0;
+    free(next);
+    free(grp);
 
-        for (i=1; i<jr->n_rows; i++) {
-            if (jr->rows[i].keyval != jr->rows[i-1].keyval) {
-                /* finalize info for key j */
-                jr->keys[j] = jr->rows[i-1].keyval;
-                jr->key_freq[j] = nj;
-                /* and initialize for next key */
-                nj = 1;
-                if (j < jr->n_unique - 1) {
-                    jr->key_row[j+1] = i;
+    if (!err && jr->n_keys > 1) {
+        jr->ptab = malloc((jr->hmask + 1) * sizeof *jr->ptab);
+        if (jr->ptab == NULL) {
+            err = E_ALLOC;
+        } else {
+            for (i=0; i<=jr->hmask; i++) {
+                jr->ptab[i] = JR_EMPTY;
+            }
+            for (g=0; g<jr->n_unique; g++) {
+                s = joiner_probe(jr, jr->ptab, jr->keys[g], 0, 1);
+                if (jr->ptab[s] == JR_EMPTY) {
+                    jr->ptab[s] = g;
                 }
-                j++;
-            } else {
-                nj++;
             }
         }
-
-        /* make sure the last row is right */
-        jr->keys[j] = jr->rows[i-1].keyval;
-        jr->key_freq[j] = nj;
     }
 
     return err;
@@ -915,23 +1043,23 @@ static int seqval_out_of_bounds (joiner *jr, int seqmax)
     }
 }
 
-/* Do a binary search for the left-hand key value @targ in the sorted
-   array of unique right-hand key values, @vals; return the position
-   among @vals at which @targ matches, or -1 for no match.
+/* Look up the left-hand key value(s) @k1, @k2 in the joiner's hash
+   table; return the index of the matching group of right-hand rows,
+   JR_NOMATCH if there's no match, or JR_NOMATCH2 if the primary key
+   is matched but the secondary key is not.
 */
 
-static int binsearch (keynum targ, const keynum *vals, int n, int offset)
+static int joiner_lookup (const joiner *jr, keynum k1, keynum k2)
 {
-    int m = n/2;
+    int g = jr->htab[joiner_probe(jr, jr->htab, k1, k2, 0)];
 
-    if (fabs((targ) - (vals[m])) < 1.0e-7) {
-        return m + offset;
-    } else if (targ < vals[0] || targ > vals[n-1]) {
-        return -1;
-    } else if (targ < vals[m]) {
-        return binsearch(targ, vals, m, offset);
+    if (g != JR_EMPTY) {
+        return g;
+    } else if (jr->n_keys > 1 &&
+               jr->ptab[joiner_probe(jr, jr->ptab, k1, 0, 1)] != JR_EMPTY) {
+        return JR_NOMATCH2;
     } else {
-        return binsearch(targ, vals + m, n - m, offset + m);
+        return JR_NOMATCH;
     }
 }
 
@@ -1348,11 +1476,20 @@ static int get_all_inner_key_values (joiner *jr,
 		matcher_set_k2(matcher, j, k2);
             }
         }
+    }
 
-        if (!err && matcher->pos[j] != KEYMISS) {
-            /* look up position in outer keys array */
-            matcher->pos[j] = binsearch(matcher->k1[j], jr->keys,
-                                        jr->n_unique, 0);
+    if (!err) {
+        /* look up the groups of outer rows: the hash table is
+           read-only at this point, so this can be done in parallel
+        */
+#if defined(_OPENMP)
+#pragma omp parallel for if (n>JOIN_OMP_MIN)
+#endif
+        for (j=0; j<n; j++) {
+            if (matcher->pos[j] != KEYMISS) {
+                matcher->pos[j] = joiner_lookup(jr, matcher->k1[j],
+                                                matcher_get_k2(matcher, j));
+            }
         }
     }
 
@@ -1384,7 +1521,7 @@ static int aggregate_data (joiner *jr, const int *ikeyvars,
     double *xmatch = NULL;
     double *auxmatch = NULL;
     int revseq = 0;
-    int i, t, nmax;
+    int i, t, nmax, ns;
     int err = 0;
 
     /* find the greatest (primary) key frequency */
@@ -1420,6 +1557,7 @@ static int aggregate_data (joiner *jr, const int *ikeyvars,
     }
 
     err = get_all_inner_key_values(jr, ikeyvars, &matcher);
+    ns = dset->t2 - dset->t1 + 1;
 
     for (i=1; i<=targvars[0] && !err; i++) {
         /* loop across the series to be added/modified */
@@ -1461,13 +1599,28 @@ static int aggregate_data (joiner *jr, const int *ikeyvars,
             fprintf(stderr, " working on LHS obs %d (v=%d, value %g), s=%d\n",
                     t, lv, dset->Z[lv][t], s);
 #endif
+            if (s % 4096 == 0) {
+                err = gretl_progress("join", (double) (i-1) * ns + s,
+                                     (double) targvars[0] * ns);
+                if (err) {
+                    break;
+                }
+            }
             if (matcher.pos[s] == KEYMISS) {
                 dset->Z[lv][t] = NADBL;
                 continue;
-            } else if (matcher.pos[s] < 0) {
+            } else if (matcher.pos[s] == JR_NOMATCH) {
 		nomatch = 1;
 		zt = (jr->aggr == AGGR_COUNT)? 0 : NADBL;
                 continue;
+	    } else if (matcher.pos[s] == JR_NOMATCH2) {
+		/* primary key matched, secondary not */
+		if (jr->aggr == AGGR_COUNT) {
+		    zt = 0;
+		} else {
+		    nomatch = (jr->aggr != AGGR_MIDAS);
+		    zt = NADBL;
+		}
 	    } else {
 		zt = aggr_value(jr, &matcher, s, rv, revseq, xmatch,
 				auxmatch, &nomatch, &err);
@@ -2444,7 +2597,7 @@ static int join_import_gdt (const char *fname,
     }
 
     if (!err) {
-        err = gretl_read_gdt_subset(fname, jspec->dset, vlist, opt);
+        err = gretl_read_gdt_subset(fname, jspec->dset, vlist, NULL, opt);
     }
 
     if (!err && addvars > 0) {
@@ -2563,6 +2716,266 @@ static int determine_csv_matches (const char *fname,
     return err;
 }
 
+/* Apparatus for screening the rows of a large outer CSV file
+   before the main import: see join_csv_prescreen().
+*/
+
+struct jr_keyset_ {
+    keynum *vals;  /* hashed key values */
+    char *used;    /* slot occupancy flags */
+    int mask;      /* table size minus 1 */
+};
+
+typedef struct jr_keyset_ jr_keyset;
+
+static int keyset_slot (const jr_keyset *ks, keynum k)
+{
+    int i = (int) (keynum_hash(k) & ks->mask);
+
+    while (ks->used[i] && ks->vals[i] != k) {
+        i = (i + 1) & ks->mask;
+    }
+
+    return i;
+}
+
+static void keyset_free (jr_keyset *ks)
+{
+    free(ks->vals);
+    free(ks->used);
+    ks->vals = NULL;
+    ks->used = NULL;
+}
+
+/* Build a hash set of the non-missing values of the inner key
+   series @v over the current sample range.
+*/
+
+static int inner_keyset_init (jr_keyset *ks, const DATASET *dset, int v)
+{
+    int n = sample_size(dset);
+    int i, t;
+
+    ks->mask = 1;
+    while (ks->mask < 2 * n) {
+        ks->mask <<= 1;
+    }
+    ks->vals = malloc(ks->mask * sizeof *ks->vals);
+    ks->used = calloc(ks->mask, 1);
+    ks->mask -= 1;
+
+    if (ks->vals == NULL || ks->used == NULL) {
+        keyset_free(ks);
+        return E_ALLOC;
+    }
+
+    for (t=dset->t1; t<=dset->t2; t++) {
+        double x = dset->Z[v][t];
+
+        if (!na(x)) {
+            i = keyset_slot(ks, x);
+            ks->vals[i] = x;
+            ks->used[i] = 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Can we screen outer rows on the primary key? Only if it's an
+   ordinary numeric key, not a time key or a tconvert column.
+*/
+
+static int join_key_screenable (joinspec *jspec,
+                                const DATASET *l_dset,
+                                const int *ikeyvars,
+                                gretlopt opt)
+{
+    return ikeyvars != NULL && ikeyvars[0] > 0 &&
+        jspec->colnames[JOIN_KEY] != NULL &&
+        jspec->timecols == NULL && !(opt & OPT_K) &&
+        !is_string_valued(l_dset, ikeyvars[1]);
+}
+
+/* When importing a large CSV file subject to a filter and/or
+   matching on a numeric key, we start by reading just the columns
+   needed to evaluate the filter and the primary key. From these
+   we build a mask which selects the rows that pass the filter and
+   whose key is present on the left; the main import then stores
+   only the selected rows, so the full outer dataset is never held
+   in memory.
+
+   On return, @prefiltered is set to 1 if the filter has been
+   applied, in which case it should not be applied again. The
+   return value is the mask, or NULL if screening is not
+   applicable or would not exclude anything, or if no rows pass
+   the filter (signalled by @nkept = 0).
+*/
+
+static gretl_matrix *join_csv_prescreen (const char *fname,
+                                         joinspec *jspec,
+                                         jr_filter *filter,
+                                         const DATASET *l_dset,
+                                         const int *ikeyvars,
+                                         gretlopt opt,
+                                         int *prefiltered,
+                                         int *nkept,
+                                         PRN *prn,
+                                         int *err)
+{
+    joinspec pspec = {0};
+    jr_keyset ks = {0};
+    gretl_matrix *mask = NULL;
+    DATASET *pdset;
+    struct stat buf;
+    int keyscreen, kcol = 0;
+    int i, n, nc = 0;
+    int nf = 0;
+
+    *prefiltered = 0;
+    *nkept = -1;
+
+    if (gretl_stat(fname, &buf) != 0 || buf.st_size < JOIN_STREAM_MIN) {
+        return NULL;
+    }
+
+    keyscreen = join_key_screenable(jspec, l_dset, ikeyvars, opt);
+    if (filter == NULL && !keyscreen) {
+        return NULL;
+    }
+
+    pspec.ncols = jspec->ncols;
+    pspec.colnames = calloc(jspec->ncols, sizeof *pspec.colnames);
+    pspec.colnums = calloc(jspec->ncols, sizeof *pspec.colnums);
+    pspec.timecols = jspec->timecols;
+
+    if (pspec.colnames == NULL || pspec.colnums == NULL) {
+        *err = E_ALLOC;
+        goto bailout;
+    }
+
+    if (filter != NULL) {
+        pspec.colnames[JOIN_F1] = filter->vname1;
+        pspec.colnames[JOIN_F2] = filter->vname2;
+        pspec.colnames[JOIN_F3] = filter->vname3;
+    }
+    if (keyscreen) {
+        pspec.colnames[JOIN_KEY] = jspec->colnames[JOIN_KEY];
+    }
+
+    for (i=0; i<pspec.ncols; i++) {
+        if (pspec.colnames[i] != NULL) {
+            nc++;
+        }
+    }
+    if (nc == 0) {
+        /* nothing to read */
+        goto bailout;
+    }
+
+    *err = real_import_csv(fname, NULL, NULL, NULL, &pspec,
+                           NULL, NULL, OPT_NONE, NULL);
+    if (!*err) {
+        *err = check_for_missing_columns(&pspec);
+    }
+    if (*err) {
+        /* let the main import deal with (and report) the problem */
+        gretl_error_clear();
+        *err = 0;
+        goto bailout;
+    }
+
+    pdset = csvdata_get_dataset(pspec.c);
+    n = pdset->n;
+
+    if (keyscreen) {
+        kcol = pspec.colnums[JOIN_KEY];
+        if (is_string_valued(pdset, kcol)) {
+            /* leave the type mismatch to be reported later */
+            keyscreen = 0;
+        } else {
+            *err = inner_keyset_init(&ks, l_dset, ikeyvars[1]);
+        }
+    }
+
+    if (!*err && filter != NULL) {
+        *err = evaluate_filter(filter, pdset, &nf);
+        if (!*err && nf == 0) {
+            *prefiltered = 1;
+            *nkept = 0;
+            goto bailout;
+        }
+    }
+
+    if (!*err) {
+        mask = gretl_zero_matrix_new(n, 1);
+        if (mask == NULL) {
+            *err = E_ALLOC;
+        }
+    }
+
+    if (!*err) {
+        int first = -1, m = 0;
+
+        for (i=0; i<n; i++) {
+            if (filter != NULL && filter->val[i] == 0) {
+                continue;
+            }
+            if (first < 0) {
+                first = i;
+            }
+            if (keyscreen) {
+                double x = pdset->Z[kcol][i];
+
+                /* rows with a missing key are retained, so that
+                   they get flagged as an error later */
+                if (!na(x) && !ks.used[keyset_slot(&ks, x)]) {
+                    continue;
+                }
+            }
+            mask->val[i] = 1;
+            m++;
+        }
+
+        if (m == n) {
+            /* no screening achieved */
+            gretl_matrix_free(mask);
+            mask = NULL;
+        } else {
+            if (m == 0) {
+                /* keep a row to avoid an empty outer dataset */
+                mask->val[first] = 1;
+                m = 1;
+            }
+            *prefiltered = (filter != NULL);
+            *nkept = m;
+            if (prn != NULL) {
+                pprintf(prn, _("Prescreen: selected %d of %d rows\n"), m, n);
+            }
+        }
+    }
+
+ bailout:
+
+    if (filter != NULL) {
+        /* this pointed into @pdset */
+        filter->val = NULL;
+    }
+    keyset_free(&ks);
+    free(pspec.colnames);
+    free(pspec.colnums);
+    if (pspec.c != NULL) {
+        csvdata_free(pspec.c);
+    }
+
+    if (*err) {
+        gretl_matrix_free(mask);
+        mask = NULL;
+    }
+
+    return mask;
+}
+
 static int join_import_csv (const char *fname,
                             joinspec *jspec,
 			    DATASET *ldset,
@@ -3047,6 +3460,8 @@ int gretl_join_data (const char *fname,
     int any_wild = 0;
     int verbose = (opt & OPT_V);
     int str_keys[2] = {0};
+    gretl_matrix *rowmask = NULL;
+    int prefiltered = 0;
     int n_keys = 0;
     int err = 0;
 
@@ -3234,7 +3649,21 @@ int gretl_join_data (const char *fname,
             }
             err = join_import_gdt(fname, &jspec, gdt_opt, vprn);
         } else {
-            err = join_import_csv(fname, &jspec, dset, vprn);
+            int nkept = -1;
+
+            if (aggr != AGGR_MIDAS) {
+                rowmask = join_csv_prescreen(fname, &jspec, filter, dset,
+                                             ikeyvars, opt, &prefiltered,
+                                             &nkept, vprn, &err);
+            }
+            if (!err && nkept == 0) {
+                gretl_warnmsg_set(_("No matching data after filtering"));
+                goto bailout;
+            }
+            if (!err) {
+                jspec.rowmask = rowmask;
+                err = join_import_csv(fname, &jspec, dset, vprn);
+            }
         }
         if (!err) {
             outer_dset = outer_dataset(&jspec);
@@ -3292,8 +3721,8 @@ int gretl_join_data (const char *fname,
     */
 
     if (!err) {
-        jr = build_joiner(&jspec, dset, filter, aggr, seqval,
-                          &auto_keys, n_keys, &err);
+        jr = build_joiner(&jspec, dset, prefiltered ? NULL : filter,
+                          aggr, seqval, &auto_keys, n_keys, &err);
         if (!err && jr == NULL) {
             /* no matching data to join */
             goto bailout;
@@ -3304,7 +3733,7 @@ int gretl_join_data (const char *fname,
         pprintf(prn, _("Filter: %d rows were selected\n"), jr->n_rows);
     }
 
-    /* Step 7: transcribe more info and sort the "joiner" struct */
+    /* Step 7: transcribe more info and hash the "joiner" struct */
 
     if (!err) {
         jr->n_keys = n_keys;
@@ -3312,7 +3741,7 @@ int gretl_join_data (const char *fname,
         jr->l_keyno = ikeyvars;
         jr->r_keyno = okeyvars;
         if (jr->n_keys > 0) {
-            err = joiner_sort(jr);
+            err = joiner_hash(jr);
         }
 #if JDEBUG > 1
         if (!err) joiner_print(jr);
@@ -3423,6 +3852,7 @@ int gretl_join_data (const char *fname,
     clear_jspec(&jspec, jr);
     joiner_destroy(jr);
     jr_filter_destroy(filter);
+    gretl_matrix_free(rowmask);
     free(targvars);
 
     return err;
@@ -22,6 +22,8 @@
 #include "gretl_mt.h"
 #include "gretl_matrix.h"
 #include "gretl_cmatrix.h"
+#include "gretl_memstats.h"
+#include "gretl_blasstats.h"
 
 #include <errno.h>
 #include <assert.h>
@@ -40,7 +42,27 @@
 # include <omp.h>
 #endif
 
-#if defined(USE_AVX)
+/* call @call, a BLAS or LAPACK routine, recording it under @r
+   with a size of @flops if "set blas_stats" is on */
+#define BLAS_COUNTED(r, flops, call) \
+    do { \
+        gint64 bt_ = gretl_blasstats_begin(); \
+        call; \
+        gretl_blasstats_end(r, flops, bt_); \
+    } while (0)
+
+/* With GCC or clang on x86 we can build all the SIMD variants
+   via function target attributes and pick one at runtime; in
+   that case the kernels do not depend on AVX_CFLAGS.
+*/
+#if defined(HAVE_IMMINTRIN_H) && (defined(__x86_64__) || defined(__i386__)) \
+    && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+# define SIMD_X86_DISPATCH 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+# define SIMD_NEON 1
+#endif
+
+#if defined(USE_AVX) || defined(SIMD_X86_DISPATCH)
 # define USE_SIMD 1
 # if defined(HAVE_IMMINTRIN_H)
 #  include <immintrin.h>
@@ -49,6 +71,9 @@
 #  include <xmmintrin.h>
 #  include <emmintrin.h>
 # endif
+#elif defined(SIMD_NEON)
+# define USE_SIMD 1
+# include <arm_neon.h>
 #endif
 
 /**
@@ -110,6 +135,10 @@ static inline void *mval_realloc (void *ptr, size_t sz)
 
 #define mval_free(m) free(m)
 
+/* logical size of the data in @m, for memory accounting */
+#define mval_bytes(m) ((gint64) (m)->rows * (m)->cols * sizeof(double) * \
+		       ((m)->is_complex ? 2 : 1))
+
 #ifdef USE_SIMD
 # include "matrix_simd.c"
 #endif
@@ -145,7 +174,119 @@ int get_simd_mn_min (void)
     return simd_mn_min;
 }
 
-#define simd_add_sub(mn) (simd_mn_min > 0 && mn >= simd_mn_min)
+#ifdef USE_SIMD
+# define simd_add_sub(mn) (simd_mn_min > 0 && mn >= simd_mn_min && \
+                           get_simd_kernels() != NULL)
+# define simd_mul_ok(k) (k <= simd_k_max && get_simd_kernels() != NULL)
+#else
+# define simd_add_sub(mn) (simd_mn_min > 0 && mn >= simd_mn_min)
+#endif
+
+/**
+ * gretl_matrix_simd_id:
+ *
+ * Returns: a string identifying the set of SIMD kernels selected
+ * for the running CPU ("avx", "avx2", "avx512" or "neon"), or
+ * "none" if SIMD is not available.
+ */
+
+const char *gretl_matrix_simd_id (void)
+{
+#ifdef USE_SIMD
+    const simd_kernels *sk = get_simd_kernels();
+
+    return sk != NULL ? sk->id : "none";
+#else
+    return "none";
+#endif
+}
+
+/* Note on the complex-array functions below: the product is
+   formed by the textbook formula, (a+bi)(c+di) = (ac-bd) +
+   (ad+bc)i, without the recovery of infinite results that C99
+   prescribes for the "*" operator on complex values. That
+   recovery requires a test and possible library call for each
+   product, which defeats vectorization. NaNs propagate as usual.
+*/
+
+/**
+ * gretl_zvec_mul:
+ * @a: array of @n complex values.
+ * @b: array of @n complex values.
+ * @c: array to receive the @n elementwise products.
+ * @n: number of values.
+ *
+ * Sets @c to the elementwise product of @a and @b, using SIMD
+ * kernels where available. @c may coincide with @a or @b.
+ */
+
+void gretl_zvec_mul (const double _Complex *a,
+                     const double _Complex *b,
+                     double _Complex *c, int n)
+{
+    const double *ax = (const double *) a;
+    const double *bx = (const double *) b;
+    double *cx = (double *) c;
+    double re, im;
+    int i;
+
+#if defined(USE_SIMD)
+    if (simd_add_sub(2*n)) {
+        simdk->zmul(ax, bx, cx, n);
+        return;
+    }
+#endif
+
+    for (i=0; i<2*n; i+=2) {
+        re = ax[i] * bx[i] - ax[i+1] * bx[i+1];
+        im = ax[i] * bx[i+1] + ax[i+1] * bx[i];
+        cx[i] = re;
+        cx[i+1] = im;
+    }
+}
+
+/**
+ * gretl_zvec_scale:
+ * @a: array of @n complex values.
+ * @s: complex multiplier.
+ * @c: array of @n complex values.
+ * @n: number of values.
+ * @add: if non-zero, add to @c rather than overwriting it.
+ *
+ * Sets @c to @s times @a, or if @add is non-zero adds @s times
+ * @a to @c, using SIMD kernels where available.
+ */
+
+void gretl_zvec_scale (const double _Complex *a,
+                       double _Complex s,
+                       double _Complex *c,
+                       int n, int add)
+{
+    const double *ax = (const double *) a;
+    const double *sx = (const double *) &s;
+    double *cx = (double *) c;
+    double re, im;
+    int i;
+
+#if defined(USE_SIMD)
+    if (simd_add_sub(2*n)) {
+        simdk->zscale(ax, sx, cx, n, add);
+        return;
+    }
+#endif
+
+    for (i=0; i<2*n; i+=2) {
+        re = ax[i] * sx[0] - ax[i+1] * sx[1];
+        im = ax[i] * sx[1] + ax[i+1] * sx[0];
+        if (add) {
+            cx[i] += re;
+            cx[i+1] += im;
+        } else {
+            cx[i] = re;
+            cx[i+1] = im;
+        }
+    }
+}
 
 #define SVD_SMIN 1.0e-9
 
@@ -234,6 +375,7 @@ static void *lapack_malloc (size_t sz)
         void *chunk = realloc(lapack_mem_chunk, sz);
 
         if (chunk != NULL) {
+            gretl_memstats_add(MEM_LAPACK, sz - lapack_mem_sz);
             lapack_mem_chunk = mem = chunk;
             lapack_mem_sz = sz;
         }
@@ -259,6 +401,7 @@ static void *lapack_realloc (void *p, size_t sz)
 
 void lapack_mem_free (void)
 {
+    gretl_memstats_add(MEM_LAPACK, -(gint64) lapack_mem_sz);
     free(lapack_mem_chunk);
     lapack_mem_chunk = NULL;
     lapack_mem_sz = 0;
@@ -269,6 +412,250 @@ static void lapack_free (void *p)
     return;
 }
 
+/* Optional pooling of matrix storage. When switched on via "set
+   matrix_pool on", the data arrays of matrices of modest size are
+   taken from free lists bucketed by power-of-two size class, and
+   gretl_matrix_free() returns them to those lists instead of
+   handing them back to the system; headers are recycled likewise.
+   This cuts down on malloc/free traffic when many short-lived
+   matrices are created, as in genr evaluation within loops. As
+   with lapack_mem_chunk above the lists are thread-private, so no
+   locking is needed; and since every pooled block is an ordinary
+   heap block it may still be passed to free() or realloc().
+*/
+
+#define MPOOL_MIN_SHIFT 6  /* smallest class, 64 bytes */
+#define MPOOL_NCLASS   12  /* largest class, 128 KB */
+#define MPOOL_DEPTH     8  /* max blocks cached per class */
+#define MPOOL_NHDR     32  /* max headers cached */
+
+#define mpool_class_size(i) ((size_t) 1 << (MPOOL_MIN_SHIFT + i))
+
+typedef struct mpool_ mpool;
+
+struct mpool_ {
+    void *blocks[MPOOL_NCLASS][MPOOL_DEPTH];
+    int nblocks[MPOOL_NCLASS];
+    gretl_matrix *hdrs[MPOOL_NHDR];
+    int nhdrs;
+};
+
+static int mpool_on;
+static guint64 mpool_hits;
+static guint64 mpool_misses;
+
+static mpool *mpool_local;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(mpool_local)
+#endif
+
+static void mpool_drain (void)
+{
+    mpool *mp = mpool_local;
+    int i, j;
+
+    if (mp != NULL) {
+        for (i=0; i<MPOOL_NCLASS; i++) {
+            for (j=0; j<mp->nblocks[i]; j++) {
+                free(mp->blocks[i][j]);
+            }
+        }
+        for (i=0; i<mp->nhdrs; i++) {
+            free(mp->hdrs[i]);
+        }
+        free(mp);
+        mpool_local = NULL;
+    }
+}
+
+static mpool *get_mpool (void)
+{
+    if (!mpool_on) {
+        if (mpool_local != NULL) {
+            /* pooling has been switched off since this
+               thread's lists were populated */
+            mpool_drain();
+        }
+        return NULL;
+    }
+#if defined(_OPENMP) && defined(__APPLE__)
+    /* no TLS: confine pooling to the main thread */
+    if (omp_in_parallel()) {
+        return NULL;
+    }
+#endif
+    if (mpool_local == NULL) {
+        mpool_local = calloc(1, sizeof *mpool_local);
+    }
+
+    return mpool_local;
+}
+
+static inline void mpool_count (guint64 *n)
+{
+#if defined(_OPENMP)
+#pragma omp atomic
+#endif
+    *n += 1;
+}
+
+static int mpool_class (size_t sz)
+{
+    int i;
+
+    for (i=0; i<MPOOL_NCLASS; i++) {
+        if (sz <= mpool_class_size(i)) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+static void *mpool_block_alloc (int i)
+{
+    size_t sz = mpool_class_size(i);
+#ifdef HAVE_POSIX_MEMALIGN
+    void *p = NULL;
+
+    /* align to the cache line */
+    if (posix_memalign(&p, 64, sz)) {
+        p = NULL;
+    }
+    return p;
+#else
+    return malloc(sz);
+#endif
+}
+
+/* Get storage for @sz bytes of matrix data; on return @pooled
+   holds 1 + the size class if the block came from (or is to be
+   returned to) the pool, else 0.
+*/
+
+static double *mpool_get_val (size_t sz, int *pooled)
+{
+    mpool *mp = get_mpool();
+    void *p = NULL;
+    int i = -1;
+
+    /* allow for the padding applied by mval_malloc() */
+    sz = sz % 16 ? sz + 8 : sz;
+
+    if (mp != NULL) {
+        i = mpool_class(sz);
+    }
+
+    if (i < 0) {
+        *pooled = 0;
+        return mval_malloc(sz);
+    }
+
+    if (mp->nblocks[i] > 0) {
+        p = mp->blocks[i][--mp->nblocks[i]];
+        mpool_count(&mpool_hits);
+    } else {
+        p = mpool_block_alloc(i);
+        mpool_count(&mpool_misses);
+    }
+
+    *pooled = (p != NULL)? i + 1 : 0;
+
+    return p;
+}
+
+static void mpool_release_val (gretl_matrix *m)
+{
+    mpool *mp = NULL;
+    int i = m->pooled - 1;
+
+    if (i >= 0) {
+        mp = get_mpool();
+    }
+
+    if (mp != NULL && mp->nblocks[i] < MPOOL_DEPTH) {
+        mp->blocks[i][mp->nblocks[i]++] = m->val;
+    } else {
+        mval_free(m->val);
+    }
+
+    m->val = NULL;
+    m->pooled = 0;
+}
+
+static gretl_matrix *mpool_get_header (void)
+{
+    mpool *mp = get_mpool();
+
+    if (mp != NULL && mp->nhdrs > 0) {
+        return mp->hdrs[--mp->nhdrs];
+    } else {
+        return malloc(sizeof(gretl_matrix));
+    }
+}
+
+static void mpool_release_header (gretl_matrix *m)
+{
+    mpool *mp = get_mpool();
+
+    if (mp != NULL && mp->nhdrs < MPOOL_NHDR) {
+        mp->hdrs[mp->nhdrs++] = m;
+    } else {
+        free(m);
+    }
+}
+
+/**
+ * gretl_matrix_pool_set_enabled:
+ * @s: non-zero to switch pooling on, 0 to switch it off.
+ *
+ * Turns on or off the recycling of matrix storage by
+ * gretl_matrix_alloc() and gretl_matrix_free(). Switching
+ * pooling on resets the hit and miss counters; switching it
+ * off releases the cached storage.
+ */
+
+void gretl_matrix_pool_set_enabled (int s)
+{
+    if (s && !mpool_on) {
+        mpool_hits = mpool_misses = 0;
+    }
+    mpool_on = (s != 0);
+    if (!mpool_on) {
+        mpool_drain();
+    }
+}
+
+/**
+ * gretl_matrix_pool_get_stats:
+ * @hits: location to receive the number of allocations
+ * satisfied from the pool.
+ * @misses: location to receive the number of poolable
+ * allocations that had to go to the system.
+ *
+ * Retrieves the matrix pool counters, which are reset each
+ * time pooling is switched on.
+ */
+
+void gretl_matrix_pool_get_stats (guint64 *hits, guint64 *misses)
+{
+    *hits = mpool_hits;
+    *misses = mpool_misses;
+}
+
+/**
+ * gretl_matrix_pool_free:
+ *
+ * Cleanup function, called by libgretl_cleanup(). Frees
+ * any matrix storage held in the calling thread's pool.
+ */
+
+void gretl_matrix_pool_free (void)
+{
+    mpool_drain();
+}
+
 static void math_err_init (void)
 {
     errno = 0;
@@ -375,19 +762,20 @@ gretl_matrix *gretl_matrix_alloc (int rows, int cols)
 	vsize = rows * cols * sizeof *m->val;
     }
 
-    m = malloc(sizeof *m);
+    m = mpool_get_header();
     if (m == NULL) {
         set_gretl_matrix_err(E_ALLOC);
         return NULL;
     }
 
+    m->pooled = 0;
     if (vsize == 0) {
         m->val = NULL;
     } else {
-        m->val = mval_malloc(vsize);
+        m->val = mpool_get_val(vsize, &m->pooled);
         if (m->val == NULL) {
             set_gretl_matrix_err(E_ALLOC);
-            free(m);
+            mpool_release_header(m);
             return NULL;
         }
     }
@@ -398,6 +786,11 @@ gretl_matrix *gretl_matrix_alloc (int rows, int cols)
     m->z = NULL;
     m->info = NULL;
 
+    if (gretl_memstats_on()) {
+        gretl_memstats_add(MEM_MATRICES, vsize);
+        gretl_memstats_object(GRETL_TYPE_MATRIX, 1);
+    }
+
     return m;
 }
 
@@ -587,6 +980,7 @@ gretl_matrix_block *gretl_matrix_block_new (gretl_matrix **pm, ...)
         B->matrix[i]->val = NULL;
         B->matrix[i]->z = NULL;
         B->matrix[i]->is_complex = 0;
+        B->matrix[i]->pooled = 0;
     }
 
     /* second pass through arg list */
@@ -812,6 +1206,11 @@ gretl_matrix *gretl_matrix_reuse (gretl_matrix *m, int rows, int cols)
     int r = rows > 0 ? rows : m->rows;
     int c = cols > 0 ? cols : m->cols;
 
+    if (gretl_memstats_on()) {
+        gretl_memstats_add(MEM_MATRICES, ((gint64) r * c - (gint64)
+                                          m->rows * m->cols) * sizeof(double));
+    }
+
     m->rows = r;
     m->cols = c;
 
@@ -859,20 +1258,31 @@ int gretl_matrix_realloc (gretl_matrix *m, int rows, int cols)
 
     if (n == 0) {
         mval_free(m->val);
+        m->pooled = 0;
     } else {
+        size_t sz = n * sizeof *m->val;
+
         if (m->is_complex) {
-            x = mval_realloc(m->val, 2 * n * sizeof *m->val);
-        } else {
-            x = mval_realloc(m->val, n * sizeof *m->val);
+            sz *= 2;
         }
-        if (x == NULL) {
-            return E_ALLOC;
+        if (m->pooled && sz + 8 <= mpool_class_size(m->pooled - 1)) {
+            /* the pooled block is big enough already */
+            x = m->val;
+        } else {
+            x = mval_realloc(m->val, sz);
+            if (x == NULL) {
+                return E_ALLOC;
+            }
+            m->pooled = 0;
         }
     }
 
     oldrows = m->rows;
     oldcols = m->cols;
 
+    gretl_memstats_add(MEM_MATRICES, (gint64) n * sizeof(double) *
+                       (m->is_complex ? 2 : 1) - mval_bytes(m));
+
     m->val = x;
     m->rows = rows;
     m->cols = cols;
@@ -917,6 +1327,7 @@ gretl_matrix *gretl_matrix_init_full (gretl_matrix *m,
     m->val = val;
     m->info = NULL;
     m->is_complex = 0;
+    m->pooled = 0;
     m->z = NULL;
     return m;
 }
@@ -934,6 +1345,7 @@ gretl_matrix *gretl_matrix_init (gretl_matrix *m)
     m->val = NULL;
     m->info = NULL;
     m->is_complex = 0;
+    m->pooled = 0;
     m->z = NULL;
     return m;
 }
@@ -979,7 +1391,9 @@ int gretl_matrix_replace_content (gretl_matrix *targ,
         targ->rows = donor->rows;
         targ->cols = donor->cols;
         targ->val = donor->val;
+        targ->pooled = donor->pooled;
         donor->val = NULL;
+        donor->pooled = 0;
         gretl_matrix_set_complex(targ, donor->is_complex);
         return 0;
     }
@@ -1650,15 +2064,22 @@ void gretl_matrix_free (gretl_matrix *m)
         return;
     }
 
+    if (gretl_memstats_on()) {
+        if (m->val != NULL) {
+            gretl_memstats_add(MEM_MATRICES, -mval_bytes(m));
+        }
+        gretl_memstats_object(GRETL_TYPE_MATRIX, -1);
+    }
+
     if (m->val != NULL) {
-        mval_free(m->val);
+        mpool_release_val(m);
     }
 
     if (m->info != NULL) {
         gretl_matrix_destroy_info(m);
     }
 
-    free(m);
+    mpool_release_header(m);
 }
 
 /**
@@ -2503,7 +2924,7 @@ void gretl_matrix_multiply_by_scalar (gretl_matrix *m, double x)
 
 #if defined(USE_SIMD)
     if (simd_add_sub(n)) {
-        gretl_matrix_simd_scalar_mul(m->val, x, n);
+        simdk->scalar_mul(m->val, x, n);
         return;
     }
 #endif
@@ -3017,7 +3438,8 @@ gretl_matrix_add_to (gretl_matrix *targ, const gretl_matrix *src)
 
 #if defined(USE_SIMD)
     if (simd_add_sub(n)) {
-        return gretl_matrix_simd_add_to(targ, src, n);
+        simdk->add_to(targ->val, src->val, n);
+        return 0;
     }
 #endif
 
@@ -3073,7 +3495,8 @@ gretl_matrix_add (const gretl_matrix *a, const gretl_matrix *b,
 
 #if defined(USE_SIMD)
     if (simd_add_sub(n)) {
-        return gretl_matrix_simd_add(a->val, b->val, c->val, n);
+        simdk->add(a->val, b->val, c->val, n);
+        return 0;
     }
 #endif
 
@@ -3156,7 +3579,8 @@ gretl_matrix_subtract_from (gretl_matrix *targ, const gretl_matrix *src)
 
 #if defined(USE_SIMD)
     if (simd_add_sub(n)) {
-        return gretl_matrix_simd_subt_from(targ, src, n);
+        simdk->subt_from(targ->val, src->val, n);
+        return 0;
     }
 #endif
 
@@ -3213,7 +3637,8 @@ gretl_matrix_subtract (const gretl_matrix *a, const gretl_matrix *b,
 
 #if defined(USE_SIMD)
     if (simd_add_sub(n)) {
-        return gretl_matrix_simd_subtract(a->val, b->val, c->val, n);
+        simdk->subtract(a->val, b->val, c->val, n);
+        return 0;
     }
 #endif
 
@@ -3985,6 +4410,7 @@ double *gretl_matrix_steal_data (gretl_matrix *m)
         }
         vals = m->val;
         m->val = NULL;
+        m->pooled = 0;
         m->z = NULL;
     }
 
@@ -4326,7 +4752,8 @@ double gretl_vcv_log_determinant (const gretl_matrix *m, int *err)
         return det;
     }
 
-    dpotrf_(&uplo, &n, a->val, &n, &info);
+    BLAS_COUNTED(BLAS_DPOTRF, (double) n * n * n / 3,
+        dpotrf_(&uplo, &n, a->val, &n, &info));
 
     if (info != 0) {
         if (info > 0) {
@@ -4579,14 +5006,20 @@ double gretl_matrix_log_abs_determinant (gretl_matrix *a, int *err)
 
 static void matrix_grab_content (gretl_matrix *targ, gretl_matrix *src)
 {
+    if (targ->val != NULL) {
+        gretl_memstats_add(MEM_MATRICES, -mval_bytes(targ));
+    }
+
     targ->rows = src->rows;
     targ->cols = src->cols;
     targ->is_complex = src->is_complex;
 
     mval_free(targ->val);
     targ->val = src->val;
+    targ->pooled = src->pooled;
     targ->z = src->z;
     src->val = NULL;
+    src->pooled = 0;
     src->z = NULL;
 
     gretl_matrix_destroy_info(targ);
@@ -5084,7 +5517,8 @@ int gretl_cholesky_decomp_solve (gretl_matrix *a, gretl_matrix *b)
     n = a->cols;
     m = b->cols;
 
-    dpotrf_(&uplo, &n, a->val, &n, &info);
+    BLAS_COUNTED(BLAS_DPOTRF, (double) n * n * n / 3,
+        dpotrf_(&uplo, &n, a->val, &n, &info));
     if (info != 0) {
         fprintf(stderr, "gretl_cholesky_decomp_solve: "
                 "dpotrf failed with info = %d (n = %d)\n", (int) info, (int) n);
@@ -5188,6 +5622,170 @@ int gretl_cholesky_invert (gretl_matrix *a)
     return err;
 }
 
+/* Rank-one update (sign > 0) or downdate (sign < 0) of a triangular
+   factor T of order n, such that T'T (or TT') += sign * xx'. The
+   factor is addressed generically: element (k,i) of the "row" being
+   rotated lies at t[k*kstep + i*istep], which lets one routine serve
+   both the lower-triangular Cholesky L (kstep = n, istep = 1) and the
+   upper-triangular R of a QR decomposition (kstep = 1, istep = n).
+   The vector x is overwritten. Returns E_NOTPD if a downdate would
+   destroy positive definiteness, in which case T is left partially
+   modified: callers must work on a copy if they need to recover.
+*/
+
+static int triangular_rank1 (double *t, int n, int kstep, int istep,
+                             double *x, int sign)
+{
+    double d, r, c, s, tki;
+    int i, k;
+
+    for (k=0; k<n; k++) {
+        d = t[k*(kstep + istep)];
+        if (sign > 0) {
+            r = hypot(d, x[k]);
+        } else {
+            r = (d - x[k]) * (d + x[k]);
+            if (r <= 0.0 || d == 0.0) {
+                return E_NOTPD;
+            }
+            r = sqrt(r);
+        }
+        if (d == 0.0) {
+            /* can only happen for an update of a singular factor */
+            if (x[k] == 0.0) {
+                continue;
+            }
+            return E_SINGULAR;
+        }
+        c = r / d;
+        s = x[k] / d;
+        t[k*(kstep + istep)] = r;
+        for (i=k+1; i<n; i++) {
+            tki = t[k*kstep + i*istep];
+            tki = (tki + sign * s * x[i]) / c;
+            t[k*kstep + i*istep] = tki;
+            x[i] = c * x[i] - s * tki;
+        }
+    }
+
+    return 0;
+}
+
+static int factor_update (gretl_matrix *T, const gretl_matrix *X,
+                          int downdate, int upper)
+{
+    gretl_matrix *save = NULL;
+    double *x;
+    int n, nr, byrow;
+    int i, j, err = 0;
+
+    if (gretl_is_null_matrix(T) || gretl_is_null_matrix(X)) {
+        return E_DATA;
+    } else if (T->is_complex || X->is_complex) {
+        return E_CMPLX;
+    }
+
+    n = T->rows;
+    if (T->cols != n) {
+        return E_NONCONF;
+    }
+
+    /* A k-vector (row or column) is taken as a single observation;
+       otherwise each row of @X is an observation on k columns.
+    */
+    if (X->cols == n) {
+        byrow = 1;
+        nr = X->rows;
+    } else if (X->rows == n && X->cols == 1) {
+        byrow = 0;
+        nr = 1;
+    } else {
+        return E_NONCONF;
+    }
+
+    x = malloc(n * sizeof *x);
+    if (x == NULL) {
+        return E_ALLOC;
+    }
+
+    if (downdate) {
+        /* a failed downdate must not wreck @T */
+        save = gretl_matrix_copy(T);
+        if (save == NULL) {
+            free(x);
+            return E_ALLOC;
+        }
+    }
+
+    for (i=0; i<nr && !err; i++) {
+        for (j=0; j<n; j++) {
+            x[j] = byrow ? gretl_matrix_get(X, i, j) : X->val[j];
+        }
+        if (upper) {
+            err = triangular_rank1(T->val, n, 1, n, x, downdate ? -1 : 1);
+        } else {
+            err = triangular_rank1(T->val, n, n, 1, x, downdate ? -1 : 1);
+        }
+    }
+
+    if (err && save != NULL) {
+        memcpy(T->val, save->val, n * n * sizeof *T->val);
+    }
+
+    gretl_matrix_free(save);
+    free(x);
+
+    return err;
+}
+
+/**
+ * gretl_cholesky_update:
+ * @L: lower-triangular Cholesky factor of a p.d. matrix A = LL'.
+ * @X: k-vector, or matrix with k columns, where k is the order of @L.
+ * @downdate: if non-zero, remove rather than add the rows of @X.
+ *
+ * Updates @L in place so that on exit it is the Cholesky factor of
+ * A + X'X, or of A - X'X if @downdate is non-zero, at a cost of
+ * O(k^2) per row of @X rather than the O(k^3) of a fresh
+ * decomposition. If A is X'X for some data matrix, this amounts to
+ * appending or dropping observations, as in rolling-window or
+ * recursive least squares.
+ *
+ * Returns: 0 on success, or E_NOTPD if a downdate would leave a
+ * matrix that is not positive definite, in which case @L is
+ * unchanged.
+ */
+
+int gretl_cholesky_update (gretl_matrix *L, const gretl_matrix *X,
+                           int downdate)
+{
+    return factor_update(L, X, downdate, 0);
+}
+
+/**
+ * gretl_qr_R_update:
+ * @R: upper-triangular factor from the QR decomposition of a
+ * data matrix Z, as in Z = QR.
+ * @X: k-vector, or matrix with k columns, where k is the order of @R.
+ * @downdate: if non-zero, drop rather than append the rows of @X.
+ *
+ * Updates @R in place so that on exit it is the triangular factor
+ * of Z with the rows of @X appended (or removed, if @downdate is
+ * non-zero), in the sense that R'R = Z'Z. The orthogonal factor
+ * Q is not maintained, so least-squares solutions should be
+ * obtained via R'Rb = Z'y, updating Z'y alongside. On exit the
+ * diagonal of @R is positive. Cost is O(k^2) per row of @X.
+ *
+ * Returns: 0 on success, or E_NOTPD if a downdate would leave a
+ * rank-deficient factor, in which case @R is unchanged.
+ */
+
+int gretl_qr_R_update (gretl_matrix *R, const gretl_matrix *X,
+                       int downdate)
+{
+    return factor_update(R, X, downdate, 1);
+}
+
 /* translation to C of tsld1.f in the netlib toeplitz package,
    code as of 07/23/82; see http://www.netlib.org/toeplitz/
 
@@ -5427,6 +6025,332 @@ int get_blas_mnk_min (void)
     return blas_mnk_min;
 }
 
+static void gretl_dgemm (const gretl_matrix *a, int atr,
+                         const gretl_matrix *b, int btr,
+                         gretl_matrix *c, GretlMatrixMod cmod,
+                         int m, int n, int k);
+
+/* Time @reps repetitions of an s x s product, either via the
+   BLAS or via native code, returning elapsed microseconds.
+*/
+
+static gint64 time_square_dgemm (gretl_matrix *a, gretl_matrix *b,
+                                 gretl_matrix *c, int s, int reps,
+                                 int blas)
+{
+    gint64 t0 = gretl_monotonic_time();
+    int r;
+
+    for (r=0; r<reps; r++) {
+        if (blas) {
+            gretl_blas_dgemm(a, 0, b, 0, c, GRETL_MOD_NONE, s, s, s);
+        } else {
+            gretl_dgemm(a, 0, b, 0, c, GRETL_MOD_NONE, s, s, s);
+        }
+    }
+
+    return gretl_monotonic_time() - t0;
+}
+
+/**
+ * gretl_matrix_tune_blas_mnk_min:
+ *
+ * Times native versus BLAS matrix multiplication over a range
+ * of square problem sizes on the host machine and sets the
+ * crossover value governing use of the BLAS (see
+ * set_blas_mnk_min()) to the smallest m*n*k at which the BLAS
+ * was found to be faster at that size and the next one up. If
+ * the BLAS never wins the threshold is set to -1 (native code
+ * only).
+ *
+ * Returns: the value set.
+ */
+
+int gretl_matrix_tune_blas_mnk_min (void)
+{
+    static const int sizes[] = {8, 12, 16, 24, 32, 48, 64, 96, 128};
+    int wins[G_N_ELEMENTS(sizes)] = {0};
+    int ns = G_N_ELEMENTS(sizes);
+    int i, j, ret = -1;
+
+    for (i=0; i<ns; i++) {
+        int s = sizes[i];
+        /* aim for roughly 2e7 flops per timing */
+        int reps = 10000000 / (s * s * s) + 1;
+        gretl_matrix *a = gretl_matrix_alloc(s, s);
+        gretl_matrix *b = gretl_matrix_alloc(s, s);
+        gretl_matrix *c = gretl_matrix_alloc(s, s);
+        gint64 t_native, t_blas;
+
+        if (a == NULL || b == NULL || c == NULL) {
+            gretl_matrix_free(a);
+            gretl_matrix_free(b);
+            gretl_matrix_free(c);
+            break;
+        }
+        for (j=0; j<s*s; j++) {
+            a->val[j] = (j % 17) / 17.0 - 0.5;
+            b->val[j] = (j % 13) / 13.0 - 0.5;
+        }
+        /* warm up both paths before timing */
+        time_square_dgemm(a, b, c, s, 1, 0);
+        time_square_dgemm(a, b, c, s, 1, 1);
+        t_native = time_square_dgemm(a, b, c, s, reps, 0);
+        t_blas = time_square_dgemm(a, b, c, s, reps, 1);
+        wins[i] = t_blas < t_native;
+#if BLAS_DEBUG
+        fprintf(stderr, "tune: s=%d, native %d, blas %d\n", s,
+                (int) t_native, (int) t_blas);
+#endif
+        gretl_matrix_free(a);
+        gretl_matrix_free(b);
+        gretl_matrix_free(c);
+    }
+
+    for (i=0; i<ns; i++) {
+        if (wins[i] && (i == ns - 1 || wins[i+1])) {
+            ret = sizes[i] * sizes[i] * sizes[i];
+            break;
+        }
+    }
+
+    blas_mnk_min = ret;
+
+    return ret;
+}
+
+/* Fill @m with a deterministic pattern for timing purposes */
+
+static void tune_fill (gretl_matrix *m, int p)
+{
+    int i, n = m->rows * m->cols;
+
+    for (i=0; i<n; i++) {
+        m->val[i] = (i % p) / (double) p - 0.5;
+    }
+}
+
+/* Given a flag per problem size, in increasing order, return the
+   index of the first size at which the flag is set both there
+   and at the next size up, or -1 if there's no such size.
+*/
+
+static int tune_crossover (const int *wins, int n)
+{
+    int i;
+
+    for (i=0; i<n; i++) {
+        if (wins[i] && (i == n - 1 || wins[i+1])) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/* Time @reps repetitions of an m x k by k x n product via the
+   native code, returning elapsed microseconds.
+*/
+
+static gint64 time_native_dgemm (gretl_matrix *a, gretl_matrix *b,
+                                 gretl_matrix *c, int reps)
+{
+    gint64 t0 = gretl_monotonic_time();
+    int r;
+
+    for (r=0; r<reps; r++) {
+        gretl_dgemm(a, 0, b, 0, c, GRETL_MOD_NONE,
+                    a->rows, b->cols, a->cols);
+    }
+
+    return gretl_monotonic_time() - t0;
+}
+
+/**
+ * gretl_matrix_tune_omp_mnk_min:
+ *
+ * Times single-threaded versus OpenMP matrix multiplication in
+ * native code, for 64 x k by k x 64 products with k running from
+ * 2 to 512, and sets the threshold governing use of OpenMP (see
+ * set_omp_mnk_min()) to the smallest m*n*k at which OpenMP was
+ * faster at that size and the next one up, or -1 if it never
+ * wins. If OpenMP is not available, or only one thread is in
+ * use, the threshold is left unchanged.
+ *
+ * Returns: the resulting value of the threshold.
+ */
+
+int gretl_matrix_tune_omp_mnk_min (void)
+{
+#if defined(_OPENMP)
+    static const int ks[] = {2, 4, 8, 16, 32, 64, 128, 256, 512};
+    int wins[G_N_ELEMENTS(ks)] = {0};
+    int nk = G_N_ELEMENTS(ks);
+    int save_simd = simd_k_max;
+    int mn = 64;
+    int i, ret;
+
+    if (gretl_get_omp_threads() < 2) {
+        return get_omp_mnk_min();
+    }
+
+    /* don't let the SIMD kernel intercept small k */
+    simd_k_max = 0;
+
+    for (i=0; i<nk; i++) {
+        int k = ks[i];
+        int reps = 20000000 / (mn * mn * k) + 1;
+        gretl_matrix *a = gretl_matrix_alloc(mn, k);
+        gretl_matrix *b = gretl_matrix_alloc(k, mn);
+        gretl_matrix *c = gretl_matrix_alloc(mn, mn);
+        gint64 t_st, t_mt;
+
+        if (a == NULL || b == NULL || c == NULL) {
+            gretl_matrix_free(a);
+            gretl_matrix_free(b);
+            gretl_matrix_free(c);
+            break;
+        }
+        tune_fill(a, 17);
+        tune_fill(b, 13);
+        set_omp_mnk_min(-1);
+        time_native_dgemm(a, b, c, 1);
+        t_st = time_native_dgemm(a, b, c, reps);
+        set_omp_mnk_min(0);
+        time_native_dgemm(a, b, c, 1);
+        t_mt = time_native_dgemm(a, b, c, reps);
+        wins[i] = t_mt < t_st;
+#if BLAS_DEBUG
+        fprintf(stderr, "tune omp: k=%d, single %d, omp %d\n", k,
+                (int) t_st, (int) t_mt);
+#endif
+        gretl_matrix_free(a);
+        gretl_matrix_free(b);
+        gretl_matrix_free(c);
+    }
+
+    simd_k_max = save_simd;
+    i = tune_crossover(wins, nk);
+    ret = i < 0 ? -1 : mn * mn * ks[i];
+    set_omp_mnk_min(ret);
+
+    return ret;
+#else
+    return get_omp_mnk_min();
+#endif
+}
+
+/**
+ * gretl_matrix_tune_simd:
+ *
+ * Times the SIMD kernels against the plain C code and sets the
+ * thresholds governing their use: simd_mn_min (see
+ * set_simd_mn_min()) for element-wise addition and subtraction,
+ * to the smallest element count from 4 to 1024 at which SIMD
+ * was faster there and at the next count up; and simd_k_max (see
+ * set_simd_k_max()) for multiplication, to the largest inner
+ * dimension up to 32 such that SIMD won at that k and all the
+ * smaller ones tried. A value of -1 for simd_mn_min, or 0 for
+ * simd_k_max, means that SIMD is not used. If no SIMD kernels
+ * are available the thresholds are left unchanged.
+ *
+ * Returns: 0 if tuning was done, otherwise E_NOTIMP.
+ */
+
+int gretl_matrix_tune_simd (void)
+{
+#ifdef USE_SIMD
+    static const int ns[] = {4, 8, 16, 32, 64, 128, 256, 1024};
+    static const int ks[] = {1, 2, 3, 4, 6, 8, 12, 16, 24, 32};
+    int nwins[G_N_ELEMENTS(ns)] = {0};
+    int save_omp = get_omp_mnk_min();
+    int save_blas = blas_mnk_min;
+    int mn = 64;
+    int i, r;
+
+    if (get_simd_kernels() == NULL) {
+        return E_NOTIMP;
+    }
+
+    /* time the serial, native code paths only */
+    set_omp_mnk_min(-1);
+    blas_mnk_min = -1;
+
+    for (i=0; i<G_N_ELEMENTS(ns); i++) {
+        int n = ns[i];
+        int reps = 10000000 / n + 1;
+        gretl_matrix *a = gretl_matrix_alloc(n, 1);
+        gretl_matrix *b = gretl_matrix_alloc(n, 1);
+        gint64 t0, t_plain, t_simd;
+
+        if (a == NULL || b == NULL) {
+            gretl_matrix_free(a);
+            gretl_matrix_free(b);
+            break;
+        }
+        tune_fill(a, 17);
+        tune_fill(b, 13);
+        simd_mn_min = -1;
+        t0 = gretl_monotonic_time();
+        for (r=0; r<reps; r++) {
+            gretl_matrix_add_to(a, b);
+        }
+        t_plain = gretl_monotonic_time() - t0;
+        simd_mn_min = 1;
+        t0 = gretl_monotonic_time();
+        for (r=0; r<reps; r++) {
+            gretl_matrix_add_to(a, b);
+        }
+        t_simd = gretl_monotonic_time() - t0;
+        nwins[i] = t_simd < t_plain;
+        gretl_matrix_free(a);
+        gretl_matrix_free(b);
+    }
+
+    i = tune_crossover(nwins, G_N_ELEMENTS(ns));
+    simd_mn_min = i < 0 ? -1 : ns[i];
+
+    simd_k_max = 0;
+    for (i=0; i<G_N_ELEMENTS(ks); i++) {
+        int k = ks[i];
+        int reps = 20000000 / (mn * mn * k) + 1;
+        gretl_matrix *a = gretl_matrix_alloc(mn, k);
+        gretl_matrix *b = gretl_matrix_alloc(k, mn);
+        gretl_matrix *c = gretl_matrix_alloc(mn, mn);
+        gint64 t_plain, t_simd;
+        int save_k = simd_k_max;
+
+        if (a == NULL || b == NULL || c == NULL) {
+            gretl_matrix_free(a);
+            gretl_matrix_free(b);
+            gretl_matrix_free(c);
+            break;
+        }
+        tune_fill(a, 17);
+        tune_fill(b, 13);
+        simd_k_max = 0;
+        time_native_dgemm(a, b, c, 1);
+        t_plain = time_native_dgemm(a, b, c, reps);
+        simd_k_max = k;
+        t_simd = time_native_dgemm(a, b, c, reps);
+        gretl_matrix_free(a);
+        gretl_matrix_free(b);
+        gretl_matrix_free(c);
+        if (t_simd >= t_plain) {
+            simd_k_max = save_k;
+            break;
+        }
+    }
+
+    set_omp_mnk_min(save_omp);
+    blas_mnk_min = save_blas;
+
+    return 0;
+#else
+    return E_NOTIMP;
+#endif
+}
+
 static int use_blas (int m, int n, int k)
 {
 #if BLAS_DEBUG
@@ -5465,8 +6389,9 @@ static void gretl_blas_dsyrk (const gretl_matrix *a, int atr,
         beta = 1.0;
     }
 
-    dsyrk_(&uplo, &tr, &n, &k, &alpha, a->val, &lda,
-           &beta, c->val, &n);
+    BLAS_COUNTED(BLAS_DSYRK, (double) n * n * k,
+        dsyrk_(&uplo, &tr, &n, &k, &alpha, a->val, &lda,
+            &beta, c->val, &n));
 
 #if defined(_OPENMP)
     fpm = (guint64) n * n;
@@ -5793,9 +6718,10 @@ void gretl_blas_dgemm (const gretl_matrix *a, int atr,
         beta = 1.0;
     }
 
-    dgemm_(&TransA, &TransB, &m, &n, &k,
-           &alpha, a->val, &a->rows, b->val, &b->rows, &beta,
-           c->val, &c->rows);
+    BLAS_COUNTED(BLAS_DGEMM, 2.0 * m * n * k,
+        dgemm_(&TransA, &TransB, &m, &n, &k,
+            &alpha, a->val, &a->rows, b->val, &b->rows, &beta,
+            c->val, &c->rows));
 }
 
 void gretl_blas_dsymm (const gretl_matrix *a, int asecond,
@@ -5848,6 +6774,123 @@ void gretl_blas_dtrmm (const gretl_matrix *a,
            &alpha, a->val, &lda, b->val, &m);
 }
 
+/* Register-blocked kernel for small non-transposed products,
+   C = alpha*A*B + beta*C, with all of m, n and k no greater than
+   SMALL_GEMM_MAX. This is the case that dominates in (e.g.)
+   Kalman filter and GARCH recursions, where the matrices are too
+   small for the BLAS to pay its way. C is computed in blocks of
+   4 rows by 4 columns held in local accumulators; the inner
+   dimension is passed as a constant for the common values of k
+   so that the compiler can fully unroll the accumulation.
+*/
+
+#define SMALL_GEMM_MAX 48
+
+static inline void __attribute__((always_inline))
+small_dgemm_kern (const double * restrict A,
+                  const double * restrict B,
+                  double * restrict C,
+                  int m, int n, const int k,
+                  double alpha, int beta)
+{
+    double acc[4][4];
+    int i, j, l, ii, jj;
+    int ib, jb;
+
+    for (j=0; j<n; j+=4) {
+        jb = n - j < 4 ? n - j : 4;
+        for (i=0; i<m; i+=4) {
+            ib = m - i < 4 ? m - i : 4;
+            if (ib == 4 && jb == 4) {
+                /* full block: the fast path */
+                double c00=0, c10=0, c20=0, c30=0;
+                double c01=0, c11=0, c21=0, c31=0;
+                double c02=0, c12=0, c22=0, c32=0;
+                double c03=0, c13=0, c23=0, c33=0;
+                const double *a = A + i;
+                const double *b = B + j*k;
+
+                for (l=0; l<k; l++) {
+                    double a0 = a[0], a1 = a[1], a2 = a[2], a3 = a[3];
+                    double b0 = b[l], b1 = b[k+l];
+                    double b2 = b[2*k+l], b3 = b[3*k+l];
+
+                    c00 += a0*b0; c10 += a1*b0; c20 += a2*b0; c30 += a3*b0;
+                    c01 += a0*b1; c11 += a1*b1; c21 += a2*b1; c31 += a3*b1;
+                    c02 += a0*b2; c12 += a1*b2; c22 += a2*b2; c32 += a3*b2;
+                    c03 += a0*b3; c13 += a1*b3; c23 += a2*b3; c33 += a3*b3;
+                    a += m;
+                }
+                acc[0][0] = c00; acc[1][0] = c10; acc[2][0] = c20; acc[3][0] = c30;
+                acc[0][1] = c01; acc[1][1] = c11; acc[2][1] = c21; acc[3][1] = c31;
+                acc[0][2] = c02; acc[1][2] = c12; acc[2][2] = c22; acc[3][2] = c32;
+                acc[0][3] = c03; acc[1][3] = c13; acc[2][3] = c23; acc[3][3] = c33;
+            } else {
+                /* ragged edge block */
+                for (jj=0; jj<jb; jj++) {
+                    for (ii=0; ii<ib; ii++) {
+                        double x = 0.0;
+
+                        for (l=0; l<k; l++) {
+                            x += A[l*m+i+ii] * B[(j+jj)*k+l];
+                        }
+                        acc[ii][jj] = x;
+                    }
+                }
+            }
+            for (jj=0; jj<jb; jj++) {
+                double *cj = C + (j+jj)*m + i;
+
+                for (ii=0; ii<ib; ii++) {
+                    if (beta) {
+                        cj[ii] += alpha * acc[ii][jj];
+                    } else {
+                        cj[ii] = alpha * acc[ii][jj];
+                    }
+                }
+            }
+        }
+    }
+}
+
+static void small_dgemm (const gretl_matrix *a,
+                         const gretl_matrix *b,
+                         gretl_matrix *c,
+                         double alpha, int beta,
+                         int m, int n, int k)
+{
+    const double *A = a->val;
+    const double *B = b->val;
+    double *C = c->val;
+
+    switch (k) {
+    case 2:
+        small_dgemm_kern(A, B, C, m, n, 2, alpha, beta);
+        break;
+    case 3:
+        small_dgemm_kern(A, B, C, m, n, 3, alpha, beta);
+        break;
+    case 4:
+        small_dgemm_kern(A, B, C, m, n, 4, alpha, beta);
+        break;
+    case 5:
+        small_dgemm_kern(A, B, C, m, n, 5, alpha, beta);
+        break;
+    case 6:
+        small_dgemm_kern(A, B, C, m, n, 6, alpha, beta);
+        break;
+    case 8:
+        small_dgemm_kern(A, B, C, m, n, 8, alpha, beta);
+        break;
+    default:
+        small_dgemm_kern(A, B, C, m, n, k, alpha, beta);
+        break;
+    }
+}
+
+#define small_gemm_ok(m,n,k) (m <= SMALL_GEMM_MAX && n <= SMALL_GEMM_MAX \
+                              && k <= SMALL_GEMM_MAX && m >= 4 && n >= 4)
+
 /* below: a native C re-write of netlib BLAS dgemm.f: note that
    for gretl's purposes we do not support values of 'beta'
    other than 0 or 1
@@ -5879,12 +6922,17 @@ static void gretl_dgemm (const gretl_matrix *a, int atr,
     }
 
 #if defined(USE_SIMD)
-    if (k <= simd_k_max && !atr && !btr && !cmod) {
-        gretl_matrix_simd_mul(a, b, c);
+    if (simd_mul_ok(k) && !atr && !btr && !cmod) {
+        simdk->mul(a, b, c);
         return;
     }
 #endif
 
+    if (!atr && !btr && small_gemm_ok(m, n, k)) {
+        small_dgemm(a, b, c, alpha, beta, m, n, k);
+        return;
+    }
+
 #if defined(_OPENMP)
     fpm = (guint64) m * n * k;
     if (!gretl_use_openmp(fpm)) {
@@ -6067,12 +7115,17 @@ static void gretl_dgemm_single (const gretl_matrix *a, int atr,
     }
 
 #if defined(USE_SIMD)
-    if (k <= simd_k_max && !atr && !btr && !cmod) {
-        gretl_matrix_simd_mul(a, b, c);
+    if (simd_mul_ok(k) && !atr && !btr && !cmod) {
+        simdk->mul(a, b, c);
         return;
     }
 #endif
 
+    if (!atr && !btr && small_gemm_ok(m, n, k)) {
+        small_dgemm(a, b, c, alpha, beta, m, n, k);
+        return;
+    }
+
     if (!btr) {
         if (!atr) {
             /* C := alpha*A*B + beta*C */
@@ -6317,21 +7370,181 @@ int gretl_matrix_multiply_mod_single (const gretl_matrix *a,
     rrows = (btr)? b->cols : b->rows;
     rcols = (btr)? b->rows : b->cols;
 
-    if (lcols != rrows) {
-        fputs("gretl_matrix_multiply_mod: matrices not conformable\n", stderr);
+    if (lcols != rrows) {
+        fputs("gretl_matrix_multiply_mod: matrices not conformable\n", stderr);
+        fprintf(stderr, " Requested (%d x %d) * (%d x %d) = (%d x %d)\n",
+                lrows, lcols, rrows, rcols, c->rows, c->cols);
+        return E_NONCONF;
+    }
+
+    if (c->rows != lrows || c->cols != rcols) {
+        fputs("gretl_matrix_multiply_mod: matrices not conformable\n", stderr);
+        fprintf(stderr, " Requested (%d x %d) * (%d x %d) = (%d x %d)\n",
+                lrows, lcols, rrows, rcols, c->rows, c->cols);
+        return E_NONCONF;
+    }
+
+    gretl_dgemm_single(a, atr, b, btr, c, cmod, lrows, rcols, lcols);
+
+    return 0;
+}
+
+/* helpers for gretl_matrix_multiply_mod_float() */
+
+static void float_from_double (float *targ, const double *src,
+                               size_t n)
+{
+    size_t i;
+
+#if defined(_OPENMP)
+    if (gretl_use_openmp(n)) {
+#pragma omp parallel for private(i)
+        for (i=0; i<n; i++) {
+            targ[i] = (float) src[i];
+        }
+        return;
+    }
+#endif
+
+    for (i=0; i<n; i++) {
+        targ[i] = (float) src[i];
+    }
+}
+
+static void float_product_to_matrix (gretl_matrix *c, const float *fc,
+                                     int symm, GretlMatrixMod cmod)
+{
+    double sgn = (cmod == GRETL_MOD_DECREMENT)? -1.0 : 1.0;
+    int n = c->rows;
+    double x;
+    int i, j;
+
+    for (j=0; j<c->cols; j++) {
+        for (i=0; i<n; i++) {
+            /* ssyrk fills the upper triangle only */
+            x = (symm && i > j)? fc[i*n+j] : fc[j*n+i];
+            if (cmod == GRETL_MOD_NONE) {
+                c->val[j*n+i] = x;
+            } else {
+                c->val[j*n+i] += sgn * x;
+            }
+        }
+    }
+}
+
+/**
+ * gretl_matrix_multiply_mod_float:
+ * @a: left-hand matrix.
+ * @amod: modifier: %GRETL_MOD_NONE or %GRETL_MOD_TRANSPOSE.
+ * @b: right-hand matrix.
+ * @bmod: modifier: %GRETL_MOD_NONE or %GRETL_MOD_TRANSPOSE.
+ * @c: matrix to hold the product.
+ * @cmod: modifier: %GRETL_MOD_NONE, or %GRETL_MOD_CUMULATE to
+ * add the result to the existing value of @c, or
+ * %GRETL_MOD_DECREMENT to subtract from the existing value of @c.
+ *
+ * Works like gretl_matrix_multiply_mod(), except that the product
+ * is computed in single precision: copies of @a and @b are
+ * converted to float, multiplied via BLAS sgemm (or ssyrk, if @a
+ * and @b are the same matrix and just one of them is transposed),
+ * and the result is converted back on writing to @c. This halves
+ * the memory traffic of the product and doubles the SIMD width, at
+ * the cost of precision: the result has about 7 significant
+ * digits. Any cumulation into @c is done in double precision.
+ *
+ * Returns: 0 on success, non-zero error code on failure.
+ */
+
+int gretl_matrix_multiply_mod_float (const gretl_matrix *a,
+                                     GretlMatrixMod amod,
+                                     const gretl_matrix *b,
+                                     GretlMatrixMod bmod,
+                                     gretl_matrix *c,
+                                     GretlMatrixMod cmod)
+{
+    const int atr = (amod == GRETL_MOD_TRANSPOSE);
+    const int btr = (bmod == GRETL_MOD_TRANSPOSE);
+    float *fa, *fb, *fc;
+    size_t na, nb, nc;
+    float alpha = 1.0, beta = 0.0;
+    integer lrows, lcols;
+    integer rrows, rcols;
+    int symm;
+
+    if (gretl_is_null_matrix(a) ||
+        gretl_is_null_matrix(b) ||
+        gretl_is_null_matrix(c)) {
+        return E_DATA;
+    }
+
+    if (a->is_complex || b->is_complex || c->is_complex) {
+        return E_CMPLX;
+    }
+
+    if (a == c || b == c) {
+        fputs("gretl_matrix_multiply_mod_float:\n product matrix must be "
+              "distinct from both input matrices\n", stderr);
+        return 1;
+    }
+
+    if (a->rows == 1 && a->cols == 1) {
+        return matmul_mod_w_scalar(a->val[0], b, btr, c, cmod);
+    } else if (b->rows == 1 && b->cols == 1) {
+        return matmul_mod_w_scalar(b->val[0], a, atr, c, cmod);
+    }
+
+    lrows = (atr)? a->cols : a->rows;
+    lcols = (atr)? a->rows : a->cols;
+    rrows = (btr)? b->cols : b->rows;
+    rcols = (btr)? b->rows : b->cols;
+
+    if (lcols != rrows || c->rows != lrows || c->cols != rcols) {
+        fputs("gretl_matrix_multiply_mod_float: matrices not conformable\n",
+              stderr);
         fprintf(stderr, " Requested (%d x %d) * (%d x %d) = (%d x %d)\n",
-                lrows, lcols, rrows, rcols, c->rows, c->cols);
+                (int) lrows, (int) lcols, (int) rrows, (int) rcols,
+                c->rows, c->cols);
         return E_NONCONF;
     }
 
-    if (c->rows != lrows || c->cols != rcols) {
-        fputs("gretl_matrix_multiply_mod: matrices not conformable\n", stderr);
-        fprintf(stderr, " Requested (%d x %d) * (%d x %d) = (%d x %d)\n",
-                lrows, lcols, rrows, rcols, c->rows, c->cols);
-        return E_NONCONF;
+    symm = (a == b && atr != btr);
+
+    na = (size_t) a->rows * a->cols;
+    nb = symm ? 0 : (size_t) b->rows * b->cols;
+    nc = (size_t) c->rows * c->cols;
+
+    fa = malloc((na + nb + nc) * sizeof *fa);
+    if (fa == NULL) {
+        return E_ALLOC;
     }
 
-    gretl_dgemm_single(a, atr, b, btr, c, cmod, lrows, rcols, lcols);
+    fb = symm ? fa : fa + na;
+    fc = fa + na + nb;
+
+    float_from_double(fa, a->val, na);
+    if (!symm) {
+        float_from_double(fb, b->val, nb);
+    }
+
+    if (symm) {
+        char uplo = 'U';
+        char tr = (atr)? 'T' : 'N';
+        integer lda = a->rows;
+
+        ssyrk_(&uplo, &tr, &lrows, &lcols, &alpha, fa, &lda,
+               &beta, fc, &lrows);
+    } else {
+        char TransA = atr ? 'T' : 'N';
+        char TransB = btr ? 'T' : 'N';
+        integer lda = a->rows;
+        integer ldb = b->rows;
+
+        sgemm_(&TransA, &TransB, &lrows, &rcols, &lcols,
+               &alpha, fa, &lda, fb, &ldb, &beta, fc, &lrows);
+    }
+
+    float_product_to_matrix(c, fc, symm, cmod);
+    free(fa);
 
     return 0;
 }
@@ -6984,7 +8197,7 @@ double gretl_vector_dot_product (const gretl_vector *a,
     } else {
 #if USE_SIMD
         if (simd_add_sub(dima)) {
-            return gretl_vector_simd_dot_product(a, b);
+            return simdk->dot(a->val, b->val, dima);
         }
 #endif
         for (i=0; i<dima; i++) {
@@ -8466,7 +9679,8 @@ double gretl_symmetric_matrix_rcond (const gretl_matrix *m, int *err)
         goto bailout;
     }
 
-    dpotrf_(&uplo, &n, a->val, &n, &info);
+    BLAS_COUNTED(BLAS_DPOTRF, (double) n * n * n / 3,
+        dpotrf_(&uplo, &n, a->val, &n, &info));
 
     if (info != 0) {
         fprintf(stderr, "gretl_symmetric_matrix_rcond: "
@@ -8602,7 +9816,8 @@ int gretl_matrix_cholesky_decomp (gretl_matrix *a)
         return E_NONCONF;
     }
 
-    dpotrf_(&uplo, &n, a->val, &n, &info);
+    BLAS_COUNTED(BLAS_DPOTRF, (double) n * n * n / 3,
+        dpotrf_(&uplo, &n, a->val, &n, &info));
 
     if (info != 0) {
         fprintf(stderr, "gretl_matrix_cholesky_decomp: info = %d\n",
@@ -8650,7 +9865,8 @@ int cholesky_factor_of_inverse (gretl_matrix *a)
 #endif
 
     /* obtain Cholesky factor of @a */
-    dpotrf_(&uplo, &n, a->val, &n, &info);
+    BLAS_COUNTED(BLAS_DPOTRF, (double) n * n * n / 3,
+        dpotrf_(&uplo, &n, a->val, &n, &info));
 
     if (info == 0) {
         /* obtain inverse of @a */
@@ -8659,7 +9875,8 @@ int cholesky_factor_of_inverse (gretl_matrix *a)
 
     if (info == 0) {
         /* obtain Cholesky factor of inverse */
-        dpotrf_(&uplo, &n, a->val, &n, &info);
+        BLAS_COUNTED(BLAS_DPOTRF, (double) n * n * n / 3,
+            dpotrf_(&uplo, &n, a->val, &n, &info));
     }
 
     if (info == 0) {
@@ -9001,7 +10218,8 @@ int gretl_matrix_QR_decomp (gretl_matrix *M, gretl_matrix *R)
     }
 
     /* run actual QR factorization */
-    dgeqrf_(&m, &n, M->val, &lda, tau, work, &lwork, &info);
+    BLAS_COUNTED(BLAS_DGEQRF, 2.0 * m * n * n,
+        dgeqrf_(&m, &n, M->val, &lda, tau, work, &lwork, &info));
     if (info != 0) {
         fprintf(stderr, "dgeqrf: info = %d\n", (int) info);
         err = 1;
@@ -9667,7 +10885,8 @@ static int real_invert_symmetric_matrix (gretl_matrix *a,
     }
 #endif
 
-    dpotrf_(&uplo, &n, a->val, &n, &info);
+    BLAS_COUNTED(BLAS_DPOTRF, (double) n * n * n / 3,
+        dpotrf_(&uplo, &n, a->val, &n, &info));
 
     if (info != 0) {
         err = (info > 0)? E_NOTPD : E_DATA;
@@ -11028,11 +12247,13 @@ static int real_gretl_matrix_SVD (const gretl_matrix *x,
 
     /* actual computation */
     if (dnc) {
-        dgesdd_(&jobz, &m, &n, a->val, &lda, s->val, uval, &ldu,
-                vtval, &ldvt, work, &lwork, iwork, &info);
+        BLAS_COUNTED(BLAS_DGESDD, 4.0 * m * n * k,
+            dgesdd_(&jobz, &m, &n, a->val, &lda, s->val, uval, &ldu,
+                vtval, &ldvt, work, &lwork, iwork, &info));
     } else {
-        dgesvd_(&jobu, &jobvt, &m, &n, a->val, &lda, s->val, uval, &ldu,
-                vtval, &ldvt, work, &lwork, &info);
+        BLAS_COUNTED(BLAS_DGESVD, 4.0 * m * n * k,
+            dgesvd_(&jobu, &jobvt, &m, &n, a->val, &lda, s->val, uval, &ldu,
+                vtval, &ldvt, work, &lwork, &info));
     }
 
     if (info != 0) {
@@ -13768,29 +14989,37 @@ int gretl_matrix_columnwise_product (const gretl_matrix *A,
     return 0;
 }
 
+/* For larger problems we form the intermediate product via
+   dsymm, which references only the lower triangle of the
+   symmetric @X, then finish with an ordinary multiplication.
+*/
+
 static int alt_qform (const gretl_matrix *A, GretlMatrixMod amod,
                       const gretl_matrix *X, gretl_matrix *C,
                       GretlMatrixMod cmod)
 {
     gretl_matrix *Tmp;
-    int r = (amod)? A->cols : A->rows;
+    int m = (amod)? A->cols : A->rows;
+    int k = X->rows;
 
-    Tmp = gretl_matrix_alloc(r, X->cols);
+    if (amod == GRETL_MOD_TRANSPOSE) {
+        Tmp = gretl_matrix_alloc(k, m);
+    } else {
+        Tmp = gretl_matrix_alloc(m, k);
+    }
     if (Tmp == NULL) {
         return E_ALLOC;
     }
 
     if (amod == GRETL_MOD_TRANSPOSE) {
-        /* A' * X * A */
+        /* A' * (X * A) */
+        gretl_blas_dsymm(X, 0, A, 0, Tmp, GRETL_MOD_NONE, k, m);
         gretl_matrix_multiply_mod(A, GRETL_MOD_TRANSPOSE,
-                                  X, GRETL_MOD_NONE,
-                                  Tmp, GRETL_MOD_NONE);
-        gretl_matrix_multiply_mod(Tmp, GRETL_MOD_NONE,
-                                  A, GRETL_MOD_NONE,
+                                  Tmp, GRETL_MOD_NONE,
                                   C, cmod);
     } else {
-        /* A * X * A' */
-        gretl_matrix_multiply(A, X, Tmp);
+        /* (A * X) * A' */
+        gretl_blas_dsymm(X, 1, A, 0, Tmp, GRETL_MOD_NONE, m, k);
         gretl_matrix_multiply_mod(Tmp, GRETL_MOD_NONE,
                                   A, GRETL_MOD_TRANSPOSE,
                                   C, cmod);
@@ -13818,19 +15047,19 @@ static int alt_qform (const gretl_matrix *A, GretlMatrixMod amod,
  * A' * X * A (if amod = %GRETL_MOD_TRANSPOSE), with the result
  * written into @C.  The matrix @X must be symmetric, but this
  * is not checked, to save time.  If you are in doubt on this
- * point you can call gretl_matrix_is_symmetric() first.
+ * point you can call gretl_matrix_is_symmetric() first. Only
+ * the lower triangle of @X is referenced.
  *
  * Returns: 0 on success; non-zero error code on failure.
  */
 
-#define QFORM_SMALL 1.0e-21
-
 int gretl_matrix_qform (const gretl_matrix *A, GretlMatrixMod amod,
                         const gretl_matrix *X, gretl_matrix *C,
                         GretlMatrixMod cmod)
 {
     register int i, j, ii, jj;
     double xi, xj, xij, xx, cij;
+    double *w;
     int m, k;
     guint64 N;
 
@@ -13866,62 +15095,52 @@ int gretl_matrix_qform (const gretl_matrix *A, GretlMatrixMod amod,
         return alt_qform(A, amod, X, C, cmod);
     }
 
-    if (amod) {
-        for (i=0; i<m; i++) {
-            for (j=i; j<m; j++) {
-                xx = 0.0;
-                for (ii=0; ii<k; ii++) {
-                    xi = gretl_matrix_get(A,ii,i);
-                    if (fabs(xi) > QFORM_SMALL) {
-                        for (jj=0; jj<k; jj++) {
-                            xj = gretl_matrix_get(A,jj,j);
-                            xij = gretl_matrix_get(X,ii,jj);
-                            xx += xij * xi * xj;
-                        }
-                    }
-                }
-                if (cmod == GRETL_MOD_CUMULATE) {
-                    cij = gretl_matrix_get(C, i, j) + xx;
-                } else if (cmod == GRETL_MOD_DECREMENT) {
-                    cij = gretl_matrix_get(C, i, j) - xx;
-                } else {
-                    cij = xx;
-                }
-                gretl_matrix_set(C, i, j, cij);
-                if (j != i) {
-                    gretl_matrix_set(C, j, i, cij);
-                }
+    w = malloc(k * sizeof *w);
+    if (w == NULL) {
+        return E_ALLOC;
+    }
+
+    /* For each column i of A' (or row i of A), a_i, form w = X a_i
+       using the lower triangle of X only, then c_ij = a_j'w for
+       j >= i, filling in the upper triangle of C by symmetry.
+       This takes O(m*k^2 + m^2*k) operations.
+    */
+    for (i=0; i<m; i++) {
+        for (ii=0; ii<k; ii++) {
+            w[ii] = 0.0;
+        }
+        for (jj=0; jj<k; jj++) {
+            xj = (amod)? gretl_matrix_get(A,jj,i) : gretl_matrix_get(A,i,jj);
+            w[jj] += gretl_matrix_get(X,jj,jj) * xj;
+            for (ii=jj+1; ii<k; ii++) {
+                xi = (amod)? gretl_matrix_get(A,ii,i) : gretl_matrix_get(A,i,ii);
+                xij = gretl_matrix_get(X,ii,jj);
+                w[ii] += xij * xj;
+                w[jj] += xij * xi;
             }
         }
-    } else {
-        for (i=0; i<m; i++) {
-            for (j=i; j<m; j++) {
-                xx = 0.0;
-                for (ii=0; ii<k; ii++) {
-                    xi = gretl_matrix_get(A,i,ii);
-                    if (fabs(xi) > QFORM_SMALL) {
-                        for (jj=0; jj<k; jj++) {
-                            xj = gretl_matrix_get(A,j,jj);
-                            xij = gretl_matrix_get(X,ii,jj);
-                            xx += xij * xi * xj;
-                        }
-                    }
-                }
-                if (cmod == GRETL_MOD_CUMULATE) {
-                    cij = gretl_matrix_get(C, i, j) + xx;
-                } else if (cmod == GRETL_MOD_DECREMENT) {
-                    cij = gretl_matrix_get(C, i, j) - xx;
-                } else {
-                    cij = xx;
-                }
-                gretl_matrix_set(C, i, j, cij);
-                if (j != i) {
-                    gretl_matrix_set(C, j, i, cij);
-                }
+        for (j=i; j<m; j++) {
+            xx = 0.0;
+            for (ii=0; ii<k; ii++) {
+                xi = (amod)? gretl_matrix_get(A,ii,j) : gretl_matrix_get(A,j,ii);
+                xx += xi * w[ii];
+            }
+            if (cmod == GRETL_MOD_CUMULATE) {
+                cij = gretl_matrix_get(C, i, j) + xx;
+            } else if (cmod == GRETL_MOD_DECREMENT) {
+                cij = gretl_matrix_get(C, i, j) - xx;
+            } else {
+                cij = xx;
+            }
+            gretl_matrix_set(C, i, j, cij);
+            if (j != i) {
+                gretl_matrix_set(C, j, i, cij);
             }
         }
     }
 
+    free(w);
+
     return 0;
 }
 
@@ -14070,8 +15289,8 @@ int gretl_matrix_diag_qform (const gretl_matrix *A, GretlMatrixMod amod,
  * @err: pointer to receive error code.
  *
  * Computes the scalar product bXb', or b'Xb if @b is a column
- * vector. The content of @err is set to a non-zero code on
- * failure.
+ * vector. Only the lower triangle of @X is referenced. The
+ * content of @err is set to a non-zero code on failure.
  *
  * Returns: the scalar product, or #NADBL on failure.
  */
@@ -14095,16 +15314,19 @@ double gretl_scalar_qform (const gretl_vector *b,
         return NADBL;
     }
 
-    p = 0;
+    /* reference the lower triangle of @X only: the result is
+       sum_j b_j * (x_jj * b_j + 2 * sum_{i>j} x_ij * b_i)
+    */
     for (j=0; j<k; j++) {
-        tmp = 0.0;
-        for (i=0; i<k; i++) {
+        p = j * k + j;
+        tmp = 0.5 * X->val[p++] * b->val[j];
+        for (i=j+1; i<k; i++) {
             tmp += b->val[i] * X->val[p++];
         }
         ret += tmp * b->val[j];
     }
 
-    return ret;
+    return 2.0 * ret;
 }
 
 /**
@@ -15237,62 +16459,287 @@ static int inverse_compare_values (const void *a, const void *b)
     return ret;
 }
 
+/* Apparatus for gretl_sort_index(): a stable least-significant-digit
+   radix sort on 64-bit keys derived from doubles, with the digit
+   histograms and scatter steps split across threads when OpenMP is
+   available. Keys are processed from last to first, so that a
+   multi-key sort is obtained by repeated stable passes over the
+   one permutation index.
+*/
+
+#define RSORT_BITS 11
+#define RSORT_BINS (1 << RSORT_BITS)
+#define RSORT_MASK (RSORT_BINS - 1)
+#define RSORT_PASSES 6  /* 6 * 11 >= 64 */
+#define RSORT_SMALL 64  /* use insertion sort below this */
+
+/* Map @x to an unsigned integer that sorts in the same order,
+   with NaNs last (or first, if @desc is non-zero) and with the
+   two zeros treated as equal.
+*/
+
+static inline guint64 sortable_bits (double x, int desc)
+{
+    guint64 u;
+
+    if (isnan(x)) {
+        u = G_MAXUINT64;
+    } else {
+        if (x == 0) {
+            x = 0.0;
+        }
+        memcpy(&u, &x, sizeof u);
+        u = (u >> 63) ? ~u : u | ((guint64) 1 << 63);
+    }
+
+    return desc ? ~u : u;
+}
+
+static void insertion_sort_keys (guint64 *k, int *idx, int n)
+{
+    guint64 kt;
+    int i, j, it;
+
+    for (i=1; i<n; i++) {
+        kt = k[i];
+        it = idx[i];
+        for (j=i; j>0 && k[j-1] > kt; j--) {
+            k[j] = k[j-1];
+            idx[j] = idx[j-1];
+        }
+        k[j] = kt;
+        idx[j] = it;
+    }
+}
+
+/* Stable sort of @n (key, index) pairs on the keys, using @k2 and
+   @idx2 as workspace; @hist must have room for @nt * RSORT_BINS
+   ints. On return the sorted pairs are in @k and @idx.
+*/
+
+static void radix_sort_keys (guint64 *k, int *idx,
+                             guint64 *k2, int *idx2,
+                             int *hist, int n, int nt)
+{
+    guint64 *ks = k, *kd = k2, *kt;
+    int *is = idx, *id = idx2, *it;
+    int pass, shift, b, t;
+
+    for (pass=0; pass<RSORT_PASSES; pass++) {
+        int skip = 0;
+
+        shift = pass * RSORT_BITS;
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(t) if (nt > 1) num_threads(nt)
+#endif
+        for (t=0; t<nt; t++) {
+            int *h = hist + t * RSORT_BINS;
+            int lo = (int) ((guint64) n * t / nt);
+            int hi = (int) ((guint64) n * (t+1) / nt);
+            int i;
+
+            memset(h, 0, RSORT_BINS * sizeof *h);
+            for (i=lo; i<hi; i++) {
+                h[(ks[i] >> shift) & RSORT_MASK] += 1;
+            }
+        }
+
+        /* if every key has the same digit this pass is a no-op */
+        b = (ks[0] >> shift) & RSORT_MASK;
+        if (nt == 1) {
+            skip = (hist[b] == n);
+        } else {
+            int cnt = 0;
+
+            for (t=0; t<nt; t++) {
+                cnt += hist[t * RSORT_BINS + b];
+            }
+            skip = (cnt == n);
+        }
+        if (skip) {
+            continue;
+        }
+
+        /* turn the counts into starting offsets, bin-major and
+           then by thread, which preserves stability */
+        {
+            int pos = 0, c;
+
+            for (b=0; b<RSORT_BINS; b++) {
+                for (t=0; t<nt; t++) {
+                    c = hist[t * RSORT_BINS + b];
+                    hist[t * RSORT_BINS + b] = pos;
+                    pos += c;
+                }
+            }
+        }
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(t) if (nt > 1) num_threads(nt)
+#endif
+        for (t=0; t<nt; t++) {
+            int *h = hist + t * RSORT_BINS;
+            int lo = (int) ((guint64) n * t / nt);
+            int hi = (int) ((guint64) n * (t+1) / nt);
+            int i, j;
+
+            for (i=lo; i<hi; i++) {
+                j = h[(ks[i] >> shift) & RSORT_MASK]++;
+                kd[j] = ks[i];
+                id[j] = is[i];
+            }
+        }
+
+        kt = ks; ks = kd; kd = kt;
+        it = is; is = id; id = it;
+    }
+
+    if (ks != k) {
+        memcpy(k, ks, n * sizeof *k);
+        memcpy(idx, is, n * sizeof *idx);
+    }
+}
+
 /**
- * gretl_matrix_sort_by_column:
- * @m: matrix.
- * @k: column by which to sort.
+ * gretl_sort_index:
+ * @x: array of @nk pointers to arrays of length @n, the sort keys
+ * in order of precedence.
+ * @nk: number of keys.
+ * @n: number of elements to sort.
+ * @descending: if non-zero sort in descending order, otherwise
+ * ascending.
  * @err: location to receive error code.
  *
- * Produces a matrix which contains the rows of @m, re-
- * ordered by increasing value of the elements in column
- * @k.
- *
- * Returns: the generated matrix, or NULL on failure.
+ * Computes the permutation that sorts the elements 0 to @n - 1
+ * lexicographically by the given keys. The sort is stable, so
+ * elements whose keys are all equal keep their original relative
+ * order; NaNs are placed after all other values when sorting in
+ * ascending order, and before them for descending order. Numeric
+ * keys are handled by radix sorting, which is parallelized via
+ * OpenMP for large @n. The returned index can be used to reorder
+ * any number of arrays without re-sorting.
+ *
+ * Returns: newly allocated array of @n 0-based positions giving,
+ * for each place in sorted order, the original index of the
+ * element that belongs there, or NULL on failure.
  */
 
-gretl_matrix *gretl_matrix_sort_by_column (const gretl_matrix *m,
-                                           int k, int *err)
+int *gretl_sort_index (const double **x, int nk, int n,
+                       int descending, int *err)
 {
-    struct rsort {
-        double x;
-        int row;
-    } *rs;
-    gretl_matrix *a;
-    double x;
+    guint64 *k = NULL, *k2 = NULL;
+    int *idx = NULL, *idx2 = NULL;
+    int *hist = NULL;
+    int nt = 1;
     int i, j;
 
-    if (gretl_is_null_matrix(m) || k < 0 || k >= m->cols) {
-        *err = E_DATA;
+    if (x == NULL || nk < 1 || n < 0) {
+        *err = E_INVARG;
         return NULL;
     }
 
-    rs = malloc(m->rows * sizeof *rs);
-    if (rs == NULL) {
+    idx = malloc((n > 0 ? n : 1) * sizeof *idx);
+    k = malloc((n > 0 ? n : 1) * sizeof *k);
+    if (idx == NULL || k == NULL) {
         *err = E_ALLOC;
-        return NULL;
+        goto bailout;
+    }
+
+    for (i=0; i<n; i++) {
+        idx[i] = i;
+    }
+
+    if (n >= RSORT_SMALL) {
+#if defined(_OPENMP)
+        if (gretl_use_openmp((guint64) n * RSORT_PASSES)) {
+            nt = gretl_get_omp_threads();
+        }
+#endif
+        k2 = malloc(n * sizeof *k2);
+        idx2 = malloc(n * sizeof *idx2);
+        hist = malloc(nt * RSORT_BINS * sizeof *hist);
+        if (k2 == NULL || idx2 == NULL || hist == NULL) {
+            *err = E_ALLOC;
+            goto bailout;
+        }
     }
 
-    a = gretl_matrix_copy(m);
+    for (j=nk-1; j>=0; j--) {
+        const double *xj = x[j];
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(i) if (nt > 1) num_threads(nt)
+#endif
+        for (i=0; i<n; i++) {
+            k[i] = sortable_bits(xj[idx[i]], descending);
+        }
+        if (n < RSORT_SMALL) {
+            insertion_sort_keys(k, idx, n);
+        } else {
+            radix_sort_keys(k, idx, k2, idx2, hist, n, nt);
+        }
+    }
+
+ bailout:
+
+    free(k);
+    free(k2);
+    free(idx2);
+    free(hist);
+
+    if (*err) {
+        free(idx);
+        idx = NULL;
+    }
+
+    return idx;
+}
+
+/* Return a copy of @m with its rows (and row names, if any)
+   reordered according to @idx, as from gretl_sort_index()
+*/
+
+static gretl_matrix *matrix_permute_rows (const gretl_matrix *m,
+                                          const int *idx,
+                                          int *err)
+{
+    gretl_matrix *a = gretl_matrix_copy(m);
+    int i, j;
+
     if (a == NULL) {
-        free(rs);
         *err = E_ALLOC;
         return NULL;
     }
 
-    for (i=0; i<m->rows; i++) {
-        rs[i].x = gretl_matrix_get(m, i, k);
-        rs[i].row = i;
-    }
+#if defined(_OPENMP)
+    if (gretl_use_openmp((guint64) m->rows * m->cols)) {
+#pragma omp parallel for private(i, j)
+        for (j=0; j<m->cols; j++) {
+            const double *src = m->val + (size_t) j * m->rows;
+            double *targ = a->val + (size_t) j * m->rows;
 
-    qsort(rs, m->rows, sizeof *rs, compare_values);
+            for (i=0; i<m->rows; i++) {
+                targ[i] = src[idx[i]];
+            }
+        }
+        goto names;
+    }
+#endif
 
     for (j=0; j<m->cols; j++) {
+        const double *src = m->val + (size_t) j * m->rows;
+        double *targ = a->val + (size_t) j * m->rows;
+
         for (i=0; i<m->rows; i++) {
-            x = gretl_matrix_get(m, rs[i].row, j);
-            gretl_matrix_set(a, i, j, x);
+            targ[i] = src[idx[i]];
         }
     }
 
+#if defined(_OPENMP)
+ names:
+#endif
+
     if (a->info != NULL && a->info->rownames != NULL) {
         char **S = malloc(a->rows * sizeof *S);
 
@@ -15301,51 +16748,58 @@ gretl_matrix *gretl_matrix_sort_by_column (const gretl_matrix *m,
                 S[i] = a->info->rownames[i];
             }
             for (i=0; i<a->rows; i++) {
-                a->info->rownames[i] = S[rs[i].row];
+                a->info->rownames[i] = S[idx[i]];
             }
             free(S);
         }
     }
 
-    free(rs);
-
     return a;
 }
 
-struct rsortx {
-    double *x;
-    int n;
-    int row;
-};
+/**
+ * gretl_matrix_sort_by_column:
+ * @m: matrix.
+ * @k: column by which to sort.
+ * @err: location to receive error code.
+ *
+ * Produces a matrix which contains the rows of @m, re-
+ * ordered by increasing value of the elements in column
+ * @k.
+ *
+ * Returns: the generated matrix, or NULL on failure.
+ */
 
-static int compare_rsortx (const void *a, const void *b)
+gretl_matrix *gretl_matrix_sort_by_column (const gretl_matrix *m,
+                                           int k, int *err)
 {
-    const struct rsortx *rsa = (const struct rsortx *) a;
-    const struct rsortx *rsb = (const struct rsortx *) b;
-    int i, ret = 0;
+    gretl_matrix *a = NULL;
+    const double *x;
+    int *idx;
 
-    for (i=0; i<rsa->n; i++) {
-        ret = unstable_comp(rsa->x[i], rsb->x[i]);
-        if (ret != 0) {
-            break;
-        } else {
-            /* ensure stable sort and continue */
-            ret = a - b > 0 ? 1 : -1;
-        }
+    if (gretl_is_null_matrix(m) || k < 0 || k >= m->cols) {
+        *err = E_DATA;
+        return NULL;
     }
 
-    return ret;
+    x = m->val + (size_t) k * m->rows;
+    idx = gretl_sort_index(&x, 1, m->rows, 0, err);
+
+    if (idx != NULL) {
+        a = matrix_permute_rows(m, idx, err);
+        free(idx);
+    }
+
+    return a;
 }
 
 gretl_matrix *gretl_matrix_sort_by_columns (const gretl_matrix *m,
                                             int *cols, int *err)
 {
-    struct rsortx *rsx = NULL;
     gretl_matrix *a = NULL;
-    double *rvals = NULL;
-    double *rptr = NULL;
-    double x;
-    int ns, i, j;
+    const double **x;
+    int *idx;
+    int ns, i;
 
     if (gretl_is_null_matrix(m)) {
         *err = E_DATA;
@@ -15372,58 +16826,24 @@ gretl_matrix *gretl_matrix_sort_by_columns (const gretl_matrix *m,
         return NULL;
     }
 
-    rsx = malloc(m->rows * sizeof *rsx);
-    rvals = malloc(m->rows * ns * sizeof *rvals);
-    if (rsx == NULL || rvals == NULL) {
-        *err = E_ALLOC;
-        goto bailout;
-    }
-
-    a = gretl_matrix_copy(m);
-    if (a == NULL) {
+    x = malloc(ns * sizeof *x);
+    if (x == NULL) {
         *err = E_ALLOC;
-        goto bailout;
-    }
-
-    /* fill the rsortx structs */
-    rptr = rvals;
-    for (i=0; i<m->rows; i++) {
-        rsx[i].x = rptr;
-        for (j=0; j<ns; j++) {
-            rsx[i].x[j] = gretl_matrix_get(m, i, cols[j+1]);
-        }
-        rsx[i].n = ns;
-        rsx[i].row = i;
-        rptr += ns;
+        return NULL;
     }
 
-    qsort(rsx, m->rows, sizeof *rsx, compare_rsortx);
-
-    for (j=0; j<m->cols; j++) {
-        for (i=0; i<m->rows; i++) {
-            x = gretl_matrix_get(m, rsx[i].row, j);
-            gretl_matrix_set(a, i, j, x);
-        }
+    for (i=0; i<ns; i++) {
+        x[i] = m->val + (size_t) cols[i+1] * m->rows;
     }
 
-    if (a->info != NULL && a->info->rownames != NULL) {
-        char **S = malloc(a->rows * sizeof *S);
+    idx = gretl_sort_index(x, ns, m->rows, 0, err);
 
-        if (S != NULL) {
-            for (i=0; i<a->rows; i++) {
-                S[i] = a->info->rownames[i];
-            }
-            for (i=0; i<a->rows; i++) {
-                a->info->rownames[i] = S[rsx[i].row];
-            }
-            free(S);
-        }
+    if (idx != NULL) {
+        a = matrix_permute_rows(m, idx, err);
+        free(idx);
     }
 
- bailout:
-
-    free(rsx);
-    free(rvals);
+    free(x);
 
     return a;
 }
@@ -91,6 +91,7 @@ typedef struct gretl_matrix_ {
     double _Complex *z; /* was "complex" */
     int is_complex;
     /*< private >*/
+    int pooled;
     matrix_info *info;
 } gretl_matrix;
 
@@ -484,6 +485,13 @@ int gretl_matrix_multiply_mod_single (const gretl_matrix *a,
 				      gretl_matrix *c,
 				      GretlMatrixMod cmod);
 
+int gretl_matrix_multiply_mod_float (const gretl_matrix *a,
+				     GretlMatrixMod amod,
+				     const gretl_matrix *b,
+				     GretlMatrixMod bmod,
+				     gretl_matrix *c,
+				     GretlMatrixMod cmod);
+
 int gretl_matrix_multiply (const gretl_matrix *a,
 			   const gretl_matrix *b,
 			   gretl_matrix *c);
@@ -594,6 +602,12 @@ int gretl_cholesky_solve (const gretl_matrix *a, gretl_vector *b);
 
 int gretl_cholesky_invert (gretl_matrix *a);
 
+int gretl_cholesky_update (gretl_matrix *L, const gretl_matrix *X,
+			   int downdate);
+
+int gretl_qr_R_update (gretl_matrix *R, const gretl_matrix *X,
+		       int downdate);
+
 int cholesky_factor_of_inverse (gretl_matrix *a);
 
 gretl_vector *gretl_toeplitz_solve (const gretl_vector *c,
@@ -891,6 +905,9 @@ gretl_matrix *gretl_matrix_bool_sel(const gretl_matrix *A,
 				    const gretl_matrix *sel,
 				    int rowsel, int *err);
 
+int *gretl_sort_index (const double **x, int nk, int n,
+		       int descending, int *err);
+
 gretl_matrix *gretl_matrix_sort_by_column (const gretl_matrix *m,
 					   int k, int *err);
 
@@ -924,10 +941,22 @@ void gretl_matrix_destroy_info (gretl_matrix *m);
 
 void lapack_mem_free (void);
 
+void gretl_matrix_pool_set_enabled (int s);
+
+void gretl_matrix_pool_get_stats (guint64 *hits, guint64 *misses);
+
+void gretl_matrix_pool_free (void);
+
 void set_blas_mnk_min (int mnk);
 
 int get_blas_mnk_min (void);
 
+int gretl_matrix_tune_blas_mnk_min (void);
+
+int gretl_matrix_tune_omp_mnk_min (void);
+
+int gretl_matrix_tune_simd (void);
+
 void set_simd_k_max (int k);
 
 int get_simd_k_max (void);
@@ -936,6 +965,17 @@ void set_simd_mn_min (int mn);
 
 int get_simd_mn_min (void);
 
+const char *gretl_matrix_simd_id (void);
+
+void gretl_zvec_mul (const double _Complex *a,
+		     const double _Complex *b,
+		     double _Complex *c, int n);
+
+void gretl_zvec_scale (const double _Complex *a,
+		       double _Complex s,
+		       double _Complex *c,
+		       int n, int add);
+
 #ifdef  __cplusplus
 }
 #endif
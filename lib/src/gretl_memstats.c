@@ -0,0 +1,408 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* gretl_memstats.c: memory accounting by subsystem and object type,
+   switched on via "set memstats on" or "gretlcli --memstats".
+
+   Matrix storage and LAPACK workspace are counted as they are
+   allocated and freed, so their peaks include short-lived
+   temporaries; the dataset, saved bundles and saved models are
+   measured by walking them after each command. Figures for
+   matrices are "logical" sizes (rows times columns), which may
+   fall short of what the allocator actually holds. Matrices held
+   in bundles are included under both headings, so the subsystem
+   figures are not additive.
+*/
+
+#include "libgretl.h"
+#include "uservar.h"
+#include "objstack.h"
+#include "gretl_array.h"
+#include "gretl_strhash.h"
+#include "gretl_memstats.h"
+
+typedef struct memcount_ memcount;
+
+struct memcount_ {
+    gint64 cur;
+    gint64 peak;
+};
+
+/* object types whose live instances are counted */
+
+enum {
+    OBJ_MATRIX,
+    OBJ_BUNDLE,
+    OBJ_ARRAY,
+    OBJ_SERIES,
+    OBJ_MODEL,
+    OBJ_N
+};
+
+static const char *subsys_names[MEM_N_SUBSYS] = {
+    "dataset", "matrices", "bundles", "models", "lapack"
+};
+
+static const char *obj_names[OBJ_N] = {
+    "matrix", "bundle", "array", "series", "model"
+};
+
+static int memtrack;
+static int have_stats;
+static memcount mem_bytes[MEM_N_SUBSYS];
+static memcount mem_objs[OBJ_N];
+
+/* Matrices may be allocated and freed in OpenMP worker threads,
+   hence the atomic updates.
+*/
+
+#if defined(__GNUC__)
+
+static void count_add (memcount *mc, gint64 delta)
+{
+    gint64 cur = __atomic_add_fetch(&mc->cur, delta, __ATOMIC_RELAXED);
+    gint64 peak = __atomic_load_n(&mc->peak, __ATOMIC_RELAXED);
+
+    while (cur > peak &&
+           !__atomic_compare_exchange_n(&mc->peak, &peak, cur, 1,
+                                        __ATOMIC_RELAXED,
+                                        __ATOMIC_RELAXED)) {
+        ;
+    }
+}
+
+#else
+
+static void count_add (memcount *mc, gint64 delta)
+{
+    mc->cur += delta;
+    if (mc->cur > mc->peak) {
+        mc->peak = mc->cur;
+    }
+}
+
+#endif
+
+static void count_set (memcount *mc, gint64 val)
+{
+    mc->cur = val;
+    if (val > mc->peak) {
+        mc->peak = val;
+    }
+}
+
+/* Tracking may have started while objects were already live, in
+   which case their release can take the running count below
+   zero: report that as zero.
+*/
+
+static double count_get (const memcount *mc, int peak)
+{
+    gint64 val = peak ? mc->peak : mc->cur;
+
+    return val > 0 ? (double) val : 0.0;
+}
+
+int gretl_memstats_on (void)
+{
+    return memtrack;
+}
+
+void gretl_memstats_start (void)
+{
+    memset(mem_bytes, 0, sizeof mem_bytes);
+    memset(mem_objs, 0, sizeof mem_objs);
+    memtrack = have_stats = 1;
+}
+
+void gretl_memstats_stop (void)
+{
+    memtrack = 0;
+}
+
+/**
+ * gretl_memstats_add:
+ * @s: subsystem.
+ * @bytes: number of bytes allocated (or, if negative, freed).
+ *
+ * Records an allocation for @s, if memory accounting is on.
+ */
+
+void gretl_memstats_add (MemSubsystem s, gint64 bytes)
+{
+    if (memtrack && bytes != 0) {
+        count_add(&mem_bytes[s], bytes);
+    }
+}
+
+/**
+ * gretl_memstats_object:
+ * @type: type of object.
+ * @delta: 1 on creation of an object of type @type, -1 on
+ * its destruction.
+ *
+ * Updates the count of live objects of @type, if memory
+ * accounting is on; only matrices, bundles and arrays are
+ * counted this way.
+ */
+
+void gretl_memstats_object (GretlType type, int delta)
+{
+    if (!memtrack) {
+        return;
+    } else if (type == GRETL_TYPE_MATRIX) {
+        count_add(&mem_objs[OBJ_MATRIX], delta);
+    } else if (type == GRETL_TYPE_BUNDLE) {
+        count_add(&mem_objs[OBJ_BUNDLE], delta);
+    } else if (type == GRETL_TYPE_ARRAY) {
+        count_add(&mem_objs[OBJ_ARRAY], delta);
+    }
+}
+
+static gint64 array_mem_size (gretl_array *A);
+
+static gint64 bundle_mem_size (gretl_bundle *b)
+{
+    gretl_strhash *ht = gretl_bundle_get_content(b);
+    void *value;
+    guint pos = 0;
+    gint64 sz = 0;
+
+    if (ht == NULL) {
+        return 0;
+    }
+
+    while (gretl_strhash_iter_next(ht, &pos, NULL, &value)) {
+        bundled_item *item = value;
+
+        if (item->type == GRETL_TYPE_MATRIX) {
+            gretl_matrix *m = item->data;
+
+            sz += (gint64) m->rows * m->cols * sizeof(double) *
+                (m->is_complex ? 2 : 1);
+        } else if (item->type == GRETL_TYPE_SERIES) {
+            sz += (gint64) item->size * sizeof(double);
+        } else if (item->type == GRETL_TYPE_STRING) {
+            sz += strlen((char *) item->data) + 1;
+        } else if (item->type == GRETL_TYPE_LIST) {
+            sz += (((int *) item->data)[0] + 1) * sizeof(int);
+        } else if (item->type == GRETL_TYPE_BUNDLE) {
+            sz += bundle_mem_size(item->data);
+        } else if (item->type == GRETL_TYPE_ARRAY) {
+            sz += array_mem_size(item->data);
+        } else {
+            sz += sizeof(double);
+        }
+    }
+
+    return sz;
+}
+
+static gint64 array_mem_size (gretl_array *A)
+{
+    GretlType type = gretl_array_get_type(A);
+    int i, n = gretl_array_get_length(A);
+    gint64 sz = n * sizeof(void *);
+
+    for (i=0; i<n; i++) {
+        void *ptr = gretl_array_get_data(A, i);
+
+        if (ptr == NULL) {
+            continue;
+        } else if (type == GRETL_TYPE_MATRICES) {
+            gretl_matrix *m = ptr;
+
+            sz += (gint64) m->rows * m->cols * sizeof(double) *
+                (m->is_complex ? 2 : 1);
+        } else if (type == GRETL_TYPE_STRINGS) {
+            sz += strlen((char *) ptr) + 1;
+        } else if (type == GRETL_TYPE_LISTS) {
+            sz += (((int *) ptr)[0] + 1) * sizeof(int);
+        } else if (type == GRETL_TYPE_BUNDLES) {
+            sz += bundle_mem_size(ptr);
+        } else if (type == GRETL_TYPE_ARRAYS) {
+            sz += array_mem_size(ptr);
+        }
+    }
+
+    return sz;
+}
+
+static gint64 dataset_mem_size (const DATASET *dset)
+{
+    if (dset == NULL || dset->Z == NULL) {
+        return 0;
+    } else {
+        return (gint64) dset->v * dset->n * sizeof(double);
+    }
+}
+
+/**
+ * gretl_memstats_sample:
+ * @dset: pointer to dataset, or NULL.
+ *
+ * Measures the dataset, saved bundles and saved models, and
+ * updates their high-water marks. Called after each command
+ * when memory accounting is on.
+ */
+
+void gretl_memstats_sample (const DATASET *dset)
+{
+    GList *L, *list;
+    gint64 sz;
+    int n = 0;
+
+    if (!memtrack) {
+        return;
+    }
+
+    /* the full dataset is held as well, when sub-sampled */
+    sz = dataset_mem_size(dset);
+    if (dset != NULL && dataset_is_subsampled(dset)) {
+        sz += dataset_mem_size(fetch_full_dataset());
+    }
+    count_set(&mem_bytes[MEM_DATASET], sz);
+    count_set(&mem_objs[OBJ_SERIES], dset != NULL ? dset->v : 0);
+
+    sz = 0;
+    list = user_var_list_for_type(GRETL_TYPE_BUNDLE);
+    for (L = list; L != NULL; L = L->next) {
+        sz += bundle_mem_size(user_var_get_value(L->data));
+    }
+    g_list_free(list);
+    count_set(&mem_bytes[MEM_BUNDLES], sz);
+
+    sz = saved_models_mem_size(&n);
+    count_set(&mem_bytes[MEM_MODELS], sz);
+    count_set(&mem_objs[OBJ_MODEL], n);
+}
+
+static gretl_matrix *memstats_matrix (memcount *mc, const char **names,
+                                      int n)
+{
+    gretl_matrix *m = gretl_matrix_alloc(n, 2);
+    char **S;
+    int i;
+
+    if (m == NULL) {
+        return NULL;
+    }
+
+    for (i=0; i<n; i++) {
+        gretl_matrix_set(m, i, 0, count_get(&mc[i], 0));
+        gretl_matrix_set(m, i, 1, count_get(&mc[i], 1));
+    }
+
+    S = strings_array_new(2);
+    if (S != NULL) {
+        S[0] = gretl_strdup("current");
+        S[1] = gretl_strdup("peak");
+        gretl_matrix_set_colnames(m, S);
+    }
+    S = strings_array_new(n);
+    if (S != NULL) {
+        for (i=0; i<n; i++) {
+            S[i] = gretl_strdup(names[i]);
+        }
+        gretl_matrix_set_rownames(m, S);
+    }
+
+    return m;
+}
+
+/**
+ * gretl_memstats_bundle:
+ * @dset: pointer to dataset, or NULL.
+ * @err: location to receive error code.
+ *
+ * Returns: a bundle holding the scalar "tracking" (1 if memory
+ * accounting is on, else 0), and two matrices with columns
+ * "current" and "peak": "bytes", with a row per subsystem, and
+ * "objects", with the number of live objects per type.
+ */
+
+gretl_bundle *gretl_memstats_bundle (const DATASET *dset, int *err)
+{
+    gretl_bundle *b = gretl_bundle_new();
+    gretl_matrix *m;
+
+    if (b == NULL) {
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    gretl_memstats_sample(dset);
+    gretl_bundle_set_int(b, "tracking", memtrack);
+
+    m = memstats_matrix(mem_bytes, subsys_names, MEM_N_SUBSYS);
+    if (m != NULL) {
+        gretl_bundle_donate_data(b, "bytes", m, GRETL_TYPE_MATRIX, 0);
+    }
+    m = memstats_matrix(mem_objs, obj_names, OBJ_N);
+    if (m != NULL) {
+        gretl_bundle_donate_data(b, "objects", m, GRETL_TYPE_MATRIX, 0);
+    }
+
+    return b;
+}
+
+/**
+ * gretl_memstats_report:
+ * @dset: pointer to dataset, or NULL.
+ * @prn: printing struct.
+ *
+ * Prints the current and peak figures per subsystem and per
+ * object type recorded since memory accounting was last
+ * switched on; does nothing if there are no such figures
+ * or they have already been reported.
+ *
+ * Returns: 0.
+ */
+
+int gretl_memstats_report (const DATASET *dset, PRN *prn)
+{
+    const double MB = 1024.0 * 1024.0;
+    int i;
+
+    if (!have_stats) {
+        return 0;
+    }
+
+    gretl_memstats_sample(dset);
+
+    pprintf(prn, "\n%s\n\n", _("Memory usage"));
+    pprintf(prn, "  %-10s %12s %12s\n", "", _("current MB"), _("peak MB"));
+    for (i=0; i<MEM_N_SUBSYS; i++) {
+        pprintf(prn, "  %-10s %12.3f %12.3f\n", subsys_names[i],
+                count_get(&mem_bytes[i], 0) / MB,
+                count_get(&mem_bytes[i], 1) / MB);
+    }
+    pputc(prn, '\n');
+    pprintf(prn, "  %-10s %12s %12s\n", "", _("current"), _("peak"));
+    for (i=0; i<OBJ_N; i++) {
+        pprintf(prn, "  %-10s %12.0f %12.0f\n", obj_names[i],
+                count_get(&mem_objs[i], 0),
+                count_get(&mem_objs[i], 1));
+    }
+    pputc(prn, '\n');
+
+    have_stats = 0;
+
+    return 0;
+}
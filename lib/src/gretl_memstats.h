@@ -0,0 +1,48 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GRETL_MEMSTATS_H
+#define GRETL_MEMSTATS_H
+
+typedef enum {
+    MEM_DATASET,
+    MEM_MATRICES,
+    MEM_BUNDLES,
+    MEM_MODELS,
+    MEM_LAPACK,
+    MEM_N_SUBSYS
+} MemSubsystem;
+
+int gretl_memstats_on (void);
+
+void gretl_memstats_start (void);
+
+void gretl_memstats_stop (void);
+
+void gretl_memstats_add (MemSubsystem s, gint64 bytes);
+
+void gretl_memstats_object (GretlType type, int delta);
+
+void gretl_memstats_sample (const DATASET *dset);
+
+gretl_bundle *gretl_memstats_bundle (const DATASET *dset, int *err);
+
+int gretl_memstats_report (const DATASET *dset, PRN *prn);
+
+#endif /* GRETL_MEMSTATS_H */
@@ -62,6 +62,7 @@ static MPI_Op mpi_sum;
 static MPI_Op mpi_prod;
 static MPI_Op mpi_max;
 static MPI_Op mpi_min;
+static MPI_Info mpi_info_null;
 #else
 /* It seems that MPICH and MS-MPI just define these symbols
    as integer values in the header */
@@ -76,6 +77,7 @@ static MPI_Op mpi_min;
 # define mpi_prod       MPI_PROD
 # define mpi_max        MPI_MAX
 # define mpi_min        MPI_MIN
+# define mpi_info_null  MPI_INFO_NULL
 #endif
 
 enum {
@@ -94,7 +96,10 @@ enum {
     TAG_BMEMB_INFO,
     TAG_ARRAY_INFO,
     TAG_BUNDLE_SIZE,
-    TAG_U64_ARRAY
+    TAG_U64_ARRAY,
+    TAG_PACKED_BUF,
+    TAG_TASK_IDX,
+    TAG_TASK_DONE
 };
 
 #define MI_LEN 5 /* matrix info length */
@@ -123,6 +128,16 @@ static int (*mpi_probe) (int, int, MPI_Comm, MPI_Status *);
 static double (*mpi_wtime) (void);
 static int (*mpi_initialized) (int *);
 
+/* MPI-3 shared-memory functions: these are optional */
+static int (*mpi_comm_split_type) (MPI_Comm, int, int, MPI_Info,
+                                   MPI_Comm *);
+static int (*mpi_win_allocate_shared) (MPI_Aint, int, MPI_Info,
+                                       MPI_Comm, void *, MPI_Win *);
+static int (*mpi_win_shared_query) (MPI_Win, int, MPI_Aint *,
+                                    int *, void *);
+static int (*mpi_win_fence) (int, MPI_Win);
+static int (*mpi_win_free) (MPI_Win *);
+
 static int gretl_matrix_bcast (gretl_matrix **pm, int id, int root);
 static int gretl_array_bcast (gretl_array **pa, int id, int root);
 static int gretl_bundle_send (gretl_bundle *b, int dest);
@@ -153,6 +168,23 @@ static void *mpiget (void *handle, const char *name, int *err)
     return p;
 }
 
+/* as mpiget(), but for symbols that we can do without */
+
+static void *mpiget_opt (void *handle, const char *name, int *err)
+{
+#ifdef WIN32
+    void *p = GetProcAddress(handle, name);
+#else
+    void *p = dlsym(handle, name);
+#endif
+
+    if (p == NULL) {
+        *err += 1;
+    }
+
+    return p;
+}
+
 int gretl_MPI_init (void)
 {
     int err = 0;
@@ -190,6 +222,20 @@ int gretl_MPI_init (void)
     mpi_wtime        = mpiget(MPIhandle, "MPI_Wtime", &err);
     mpi_initialized  = mpiget(MPIhandle, "MPI_Initialized", &err);
 
+    if (!err) {
+        /* failure to find these is not an error */
+        int shmerr = 0;
+
+        mpi_comm_split_type = mpiget_opt(MPIhandle, "MPI_Comm_split_type", &shmerr);
+        mpi_win_allocate_shared = mpiget_opt(MPIhandle, "MPI_Win_allocate_shared", &shmerr);
+        mpi_win_shared_query = mpiget_opt(MPIhandle, "MPI_Win_shared_query", &shmerr);
+        mpi_win_fence    = mpiget_opt(MPIhandle, "MPI_Win_fence", &shmerr);
+        mpi_win_free     = mpiget_opt(MPIhandle, "MPI_Win_free", &shmerr);
+        if (shmerr) {
+            mpi_comm_split_type = NULL;
+        }
+    }
+
 #ifdef OMPI_MAJOR_VERSION
     if (!err) {
         mpi_comm_world = (MPI_Comm) mpiget(MPIhandle, "ompi_mpi_comm_world", &err);
@@ -203,6 +249,7 @@ int gretl_MPI_init (void)
         mpi_prod       = (MPI_Op) mpiget(MPIhandle, "ompi_mpi_op_prod", &err);
         mpi_max        = (MPI_Op) mpiget(MPIhandle, "ompi_mpi_op_max", &err);
         mpi_min        = (MPI_Op) mpiget(MPIhandle, "ompi_mpi_op_min", &err);
+        mpi_info_null  = (MPI_Info) mpiget(MPIhandle, "ompi_mpi_info_null", &err);
     }
 #endif
 
@@ -816,6 +863,62 @@ int gretl_scalar_mpi_reduce (double x,
     return ret;
 }
 
+/* Maximum number of elements passed in a single MPI call: the
+   count argument is an int, so larger objects are transferred in
+   chunks of this size.
+*/
+
+#define MPI_CHUNK (1 << 28)
+
+static int mpi_bcast_chunked (void *buf, size_t n, MPI_Datatype dt,
+                              size_t elsize, int root)
+{
+    char *p = buf;
+    int k, err = 0;
+
+    while (n > 0 && !err) {
+        k = n > MPI_CHUNK ? MPI_CHUNK : (int) n;
+        err = mpi_bcast(p, k, dt, root, mpi_comm_world);
+        p += k * elsize;
+        n -= k;
+    }
+
+    return err;
+}
+
+static int mpi_send_chunked (void *buf, size_t n, MPI_Datatype dt,
+                             size_t elsize, int dest, int tag)
+{
+    char *p = buf;
+    int k, err = 0;
+
+    while (n > 0 && !err) {
+        k = n > MPI_CHUNK ? MPI_CHUNK : (int) n;
+        err = mpi_send(p, k, dt, dest, tag, mpi_comm_world);
+        p += k * elsize;
+        n -= k;
+    }
+
+    return err;
+}
+
+static int mpi_recv_chunked (void *buf, size_t n, MPI_Datatype dt,
+                             size_t elsize, int source, int tag)
+{
+    char *p = buf;
+    int k, err = 0;
+
+    while (n > 0 && !err) {
+        k = n > MPI_CHUNK ? MPI_CHUNK : (int) n;
+        err = mpi_recv(p, k, dt, source, tag, mpi_comm_world,
+                       MPI_STATUS_IGNORE);
+        p += k * elsize;
+        n -= k;
+    }
+
+    return err;
+}
+
 static void maybe_date_matrix (gretl_matrix *m, int *minfo)
 {
     if (minfo[3] >= 0 && minfo[4] >= minfo[3]) {
@@ -858,53 +961,20 @@ static int gretl_matrix_bcast (gretl_matrix **pm, int id, int root)
 
     if (!err) {
         /* broadcast the matrix content */
-        int n = minfo[0] * minfo[1];
+        size_t n = (size_t) minfo[0] * minfo[1];
         int cmplx = minfo[2];
 
         if (n > 0 && cmplx) {
-            err = mpi_bcast(m->z, n, mpi_complex, root,
-                            mpi_comm_world);
+            err = mpi_bcast_chunked(m->z, n, mpi_complex,
+                                    sizeof *m->z, root);
         } else if (n > 0) {
-            err = mpi_bcast(m->val, n, mpi_double, root,
-                            mpi_comm_world);
-        }
-    }
-
-    if (err) {
-        gretl_mpi_error(&err);
-    }
-
-    return err;
-}
-
-static int gretl_series_bcast (double **px, int len,
-                               int id, int root)
-{
-    double *x = NULL;
-    int err = 0;
-
-    if (id == root) {
-        x = *px;
-        if (x == NULL) {
-            return E_DATA;
-        }
-    } else {
-        /* everyone else needs to allocate space */
-        x = malloc(len * sizeof *x);
-        if (x == NULL) {
-            return E_ALLOC;
+            err = mpi_bcast_chunked(m->val, n, mpi_double,
+                                    sizeof *m->val, root);
         }
     }
 
-    if (!err) {
-        /* broadcast the series */
-        err = mpi_bcast(x, len, mpi_double, root, mpi_comm_world);
-    }
-
     if (err) {
         gretl_mpi_error(&err);
-    } else if (id != root) {
-        *px = x;
     }
 
     return err;
@@ -1042,295 +1112,601 @@ static int gretl_uint64_bcast (guint64 *pu, int root)
     return err;
 }
 
-/* Compose a message indicating the type (and size, if
-   applicable) of a bundle member to be passed via MPI.
+/* Packing of bundles and arrays into a single contiguous buffer,
+   so that they can be transmitted as one (possibly chunked)
+   message rather than as a sequence of small messages, one or
+   more per member. The buffer is in the native binary format:
+   it's assumed that all processes run on homogeneous hardware.
+
+   Each packing function is called twice on a given object: first
+   with a NULL @buf, to compute the required size, then for real.
 */
 
-static int compose_msgbuf (char *buf, GretlType type,
-                           const char *key, int *size,
-                           void *data)
-{
-    int n = 0;
+typedef struct mpi_buf_ mpi_buf;
 
-    if (type == GRETL_TYPE_DOUBLE) {
-        n = sizeof(double);
-    } else if (type == GRETL_TYPE_INT) {
-        n = sizeof(int);
-    } else if (type == GRETL_TYPE_UINT32) {
-        n = sizeof(unsigned int);
-    } else if (type == GRETL_TYPE_UINT64) {
-        n = sizeof(guint64);
-    } else if (type == GRETL_TYPE_SERIES) {
-        n = *size;
-    } else if (type == GRETL_TYPE_STRING) {
-        char *s = data;
-        n = strlen(s) + 1;
-    } else if (type == GRETL_TYPE_LIST) {
-        int *list = data;
-        n = (list[0] + 1) * sizeof(int);
-    } else if (type == GRETL_TYPE_MATRIX ||
-               type == GRETL_TYPE_BUNDLE ||
-               type == GRETL_TYPE_ARRAY) {
-        n = 0;
-    } else {
-        return E_DATA;
+struct mpi_buf_ {
+    char *buf;    /* the data, or NULL when sizing */
+    size_t pos;   /* current read/write position */
+    size_t len;   /* total length (when reading) */
+};
+
+static int pack_bundle (mpi_buf *mb, gretl_bundle *b);
+static int pack_array (mpi_buf *mb, gretl_array *a);
+static gretl_bundle *unpack_bundle (mpi_buf *mb, int *err);
+static gretl_array *unpack_array (mpi_buf *mb, int *err);
+
+static void mb_put (mpi_buf *mb, const void *src, size_t n)
+{
+    if (mb->buf != NULL && n > 0) {
+        memcpy(mb->buf + mb->pos, src, n);
     }
+    mb->pos += n;
+}
 
-    sprintf(buf, "%d %s %d", type, key, n);
-    *size = n;
+static void mb_put_int (mpi_buf *mb, int k)
+{
+    mb_put(mb, &k, sizeof k);
+}
 
+static int mb_get (mpi_buf *mb, void *targ, size_t n)
+{
+    if (n > mb->len - mb->pos) {
+        return E_DATA;
+    } else if (n > 0) {
+        memcpy(targ, mb->buf + mb->pos, n);
+        mb->pos += n;
+    }
     return 0;
 }
 
-/* Parse the information sent in @buf by root, regarding a
-   bundle member.
-*/
+static int mb_get_int (mpi_buf *mb, int *k)
+{
+    return mb_get(mb, k, sizeof *k);
+}
+
+/* strings and keys: length including NUL, then bytes */
 
-static int parse_msgbuf (const char *buf, char *key,
-                         GretlType *type, int *size)
+static void pack_string (mpi_buf *mb, const char *s)
 {
-    int t;
+    int n = strlen(s) + 1;
 
-    if (sscanf(buf, "%d %s %d", &t, key, size) != 3) {
-        return E_DATA;
-    } else {
-        *type = t;
-        return 0;
-    }
+    mb_put_int(mb, n);
+    mb_put(mb, s, n);
 }
 
-static int gretl_bundle_bcast (gretl_bundle **pb,
-                               int id, int root)
+static char *unpack_string (mpi_buf *mb, int *err)
 {
-    gretl_bundle *b = NULL;
-    gretl_matrix *m = NULL;
-    gretl_array *a = NULL;
-    gretl_bundle *bsub = NULL;
-    gretl_array *keys = NULL;
-    double *x = NULL;
-    GretlType type;
-    char key[32];
-    void *data;
-    char msgbuf[64];
-    int msglen;
-    int size;
-    int i, nk;
-    int err = 0;
+    char *s = NULL;
+    int n = 0;
 
-    if (id == root) {
-        b = *pb;
-        nk = gretl_bundle_get_n_keys(b);
-        keys = gretl_bundle_get_keys(b, &err);
-        if (err) {
-            return err;
+    *err = mb_get_int(mb, &n);
+    if (!*err && (n <= 0 || n > mb->len - mb->pos)) {
+        *err = E_DATA;
+    }
+    if (!*err) {
+        s = malloc(n);
+        if (s == NULL) {
+            *err = E_ALLOC;
+        } else {
+            mb_get(mb, s, n);
+            s[n-1] = '\0';
         }
     }
 
-    /* broadcast the number of keys first */
-    err = mpi_bcast(&nk, 1, mpi_int, root, mpi_comm_world);
+    return s;
+}
 
-    if (!err && id != root) {
-        /* everyone but root needs to start a bundle */
-        b = gretl_bundle_new();
-        if (b == NULL) {
-            return E_ALLOC;
-        }
-    }
+static void pack_list (mpi_buf *mb, const int *list)
+{
+    mb_put_int(mb, list[0]);
+    mb_put(mb, list + 1, list[0] * sizeof *list);
+}
 
-    msglen = sizeof msgbuf;
+static int *unpack_list (mpi_buf *mb, int *err)
+{
+    int *list = NULL;
+    int n = 0;
 
-    for (i=0; i<nk && !err; i++) {
-        /* loop across bundle keys */
-        memset(msgbuf, 0, msglen);
-        size = 0;
-        data = NULL;
-        m = NULL;
-        a = NULL;
-        bsub = NULL;
-        x = NULL;
-
-        if (id == root) {
-            const char *rkey = gretl_array_get_data(keys, i);
-
-            data = gretl_bundle_get_data(b, rkey, &type, &size, &err);
-            if (!err) {
-                compose_msgbuf(msgbuf, type, rkey, &size, data);
-                if (type == GRETL_TYPE_MATRIX) {
-                    m = (gretl_matrix *) data;
-                } else if (type == GRETL_TYPE_ARRAY) {
-                    a = (gretl_array *) data;
-                } else if (type == GRETL_TYPE_BUNDLE) {
-                    bsub = (gretl_bundle *) data;
-                } else if (type == GRETL_TYPE_SERIES) {
-                    x = (double *) data;
-                }
-            }
-        }
-        if (!err) {
-            /* broadcast info on the bundle member */
-            err = mpi_bcast(msgbuf, msglen, mpi_byte, root, mpi_comm_world);
-        }
-        if (!err) {
-            err = parse_msgbuf(msgbuf, key, &type, &size);
-        }
-        if (err) {
-            break;
-        }
-        if (type == GRETL_TYPE_MATRIX) {
-            err = gretl_matrix_bcast(&m, id, root);
-            if (!err && id != root) {
-                err = gretl_bundle_donate_data(b, key, m, type, 0);
-            }
-        } else if (type == GRETL_TYPE_ARRAY) {
-            err = gretl_array_bcast(&a, id, root);
-            if (!err && id != root) {
-                err = gretl_bundle_donate_data(b, key, a, type, 0);
-            }
-        } else if (type == GRETL_TYPE_BUNDLE) {
-            err = gretl_bundle_bcast(&bsub, id, root);
-            if (!err && id != root) {
-                err = gretl_bundle_donate_data(b, key, bsub, type, 0);
-            }
-        } else if (type == GRETL_TYPE_SERIES) {
-            err = gretl_series_bcast(&x, size, id, root);
-            if (!err && id != root) {
-                err = gretl_bundle_donate_data(b, key, x, type, size);
-            }
+    *err = mb_get_int(mb, &n);
+    if (!*err && (n < 0 || n > (mb->len - mb->pos) / sizeof(int))) {
+        *err = E_DATA;
+    }
+    if (!*err) {
+        list = gretl_list_new(n);
+        if (list == NULL) {
+            *err = E_ALLOC;
         } else {
-            /* scalar, string or list */
-            if (id != root) {
-                data = calloc(size, 1);
-                if (data == NULL) {
-                    err = E_ALLOC;
-                }
-            }
-            err = mpi_bcast(data, size, mpi_byte, root, mpi_comm_world);
-            if (!err && id != root && data != NULL) {
-                if (gretl_is_scalar_type(type)) {
-                    err = gretl_bundle_set_data(b, key, data, type, 0);
-                    free(data);
-                } else {
-                    err = gretl_bundle_donate_data(b, key, data, type, 0);
-                }
-            }
+            mb_get(mb, list + 1, n * sizeof *list);
         }
     }
 
-    gretl_array_destroy(keys);
+    return list;
+}
 
-    mpi_barrier(mpi_comm_world);
+static void pack_matrix (mpi_buf *mb, const gretl_matrix *m)
+{
+    int minfo[MI_LEN] = {0};
+    size_t n;
 
-    if (err) {
-        gretl_mpi_error(&err);
-    } else if (id != root) {
-        *pb = b;
+    /* note: a null matrix is passed as 0 x 0 */
+    fill_matrix_info(minfo, m);
+    mb_put(mb, minfo, sizeof minfo);
+    n = (size_t) minfo[0] * minfo[1];
+    if (n > 0 && minfo[2]) {
+        mb_put(mb, m->z, n * sizeof *m->z);
+    } else if (n > 0) {
+        mb_put(mb, m->val, n * sizeof *m->val);
     }
-
-    return err;
 }
 
-static int gretl_array_bcast (gretl_array **pa, int id, int root)
+static gretl_matrix *unpack_matrix (mpi_buf *mb, int *err)
 {
-    gretl_array *a = NULL;
-    GretlType type = 0;
-    int nelem = 0;
-    int st[2];
-    int i, err = 0;
+    gretl_matrix *m = NULL;
+    int minfo[MI_LEN];
+    size_t n, bytes;
 
-    if (id == root) {
-        a = *pa;
-        st[0] = nelem = gretl_array_get_length(a);
-        st[1] = type = gretl_array_get_type(a);
+    *err = mb_get(mb, minfo, sizeof minfo);
+    if (*err) {
+        return NULL;
+    } else if (minfo[0] < 0 || minfo[1] < 0) {
+        *err = E_DATA;
+        return NULL;
+    }
+
+    n = (size_t) minfo[0] * minfo[1];
+    bytes = n * (minfo[2] ? sizeof(double complex) : sizeof(double));
+    if (bytes > mb->len - mb->pos) {
+        *err = E_DATA;
+        return NULL;
     }
 
-    /* broadcast the array size and type */
-    err = mpi_bcast(st, 2, mpi_int, root, mpi_comm_world);
+    if (minfo[2]) {
+        m = gretl_cmatrix_new(minfo[0], minfo[1]);
+    } else {
+        m = gretl_matrix_alloc(minfo[0], minfo[1]);
+    }
 
-    if (!err && id != root) {
-        /* everyone but root needs to allocate an array */
-        nelem = st[0];
-        type = st[1];
-        *pa = a = gretl_array_new(type, nelem, &err);
+    if (m == NULL) {
+        *err = E_ALLOC;
+    } else {
+        if (n > 0) {
+            mb_get(mb, minfo[2] ? (void *) m->z : (void *) m->val, bytes);
+        }
+        maybe_date_matrix(m, minfo);
     }
 
+    return m;
+}
+
+static int pack_array (mpi_buf *mb, gretl_array *a)
+{
+    GretlType type = gretl_array_get_type(a);
+    int nelem = gretl_array_get_length(a);
+    int i, err = 0;
+
+    mb_put_int(mb, type);
+    mb_put_int(mb, nelem);
+
     for (i=0; i<nelem && !err; i++) {
-        void *ptr, *data = NULL;
+        void *data = gretl_array_get_data(a, i);
 
-        if (id == root) {
-            data = gretl_array_get_data(a, i);
+        /* flag for presence of the element */
+        mb_put_int(mb, data != NULL);
+        if (data == NULL) {
+            continue;
         }
-        ptr = &data;
         if (type == GRETL_TYPE_MATRICES) {
-            err = gretl_matrix_bcast(ptr, id, root);
-            if (id != root) {
-                data = *(gretl_matrix **) ptr;
-            }
+            pack_matrix(mb, data);
         } else if (type == GRETL_TYPE_STRINGS) {
-            err = gretl_string_bcast(ptr, id, root);
-            if (id != root) {
-                data = *(char **) ptr;
-            }
+            pack_string(mb, data);
         } else if (type == GRETL_TYPE_BUNDLES) {
-            err = gretl_bundle_bcast(ptr, id, root);
-            if (id != root) {
-                data = *(gretl_bundle **) ptr;
-            }
+            err = pack_bundle(mb, data);
         } else if (type == GRETL_TYPE_LISTS) {
-            err = gretl_list_bcast(ptr, id, root);
-            if (id != root) {
-                data = *(int **) ptr;
-            }
+            pack_list(mb, data);
         } else if (type == GRETL_TYPE_ARRAYS) {
-            err = gretl_array_bcast(ptr, id, root);
-            if (id != root) {
-                data = *(gretl_array **) ptr;
-            }
+            err = pack_array(mb, data);
         } else {
-            /* ?? */
             err = E_TYPES;
         }
-        if (!err && id != root) {
-            gretl_array_set_data(a, i, data);
-        }
-    }
-
-    mpi_barrier(mpi_comm_world);
-
-    if (err) {
-        gretl_mpi_error(&err);
     }
 
     return err;
 }
 
-int gretl_mpi_barrier (void)
+static gretl_array *unpack_array (mpi_buf *mb, int *err)
 {
-    return mpi_barrier(mpi_comm_world) != MPI_SUCCESS;
-}
+    gretl_array *a = NULL;
+    GretlType type;
+    int t = 0, nelem = 0;
+    int i, present;
 
-/**
- * gretl_mpi_bcast:
- * @p: the location of the object to be broadcast.
- * @type: the type of the object to which @p points.
- * @root: the rank of the root process.
- *
- * Broadcasts the value referenced by @p to MPI_COMM_WORLD.
- * @type must be GRETL_TYPE_MATRIX, in which case
- * @p should be a (**gretl_matrix) pointer; GRETL_TYPE_BUNDLE,
- * in which case @p should be a (**gretl_bundle) pointer;
- * or GRETL_TYPE_DOUBLE, in which case @p should be a (*double)
- * pointer.
- *
- * Returns: 0 on successful completion, non-zero code otherwise.
- **/
+    *err = mb_get_int(mb, &t);
+    if (!*err) {
+        *err = mb_get_int(mb, &nelem);
+    }
+    if (!*err && nelem < 0) {
+        *err = E_DATA;
+    }
+    if (*err) {
+        return NULL;
+    }
 
-int gretl_mpi_bcast (void *p, GretlType type, int root)
-{
-    int id, err;
+    type = t;
+    a = gretl_array_new(type, nelem, err);
 
-    err = gretl_comm_check(root, &id, NULL);
-    if (err) {
-        return err;
+    for (i=0; i<nelem && !*err; i++) {
+        void *data = NULL;
+
+        *err = mb_get_int(mb, &present);
+        if (*err || !present) {
+            continue;
+        }
+        if (type == GRETL_TYPE_MATRICES) {
+            data = unpack_matrix(mb, err);
+        } else if (type == GRETL_TYPE_STRINGS) {
+            data = unpack_string(mb, err);
+        } else if (type == GRETL_TYPE_BUNDLES) {
+            data = unpack_bundle(mb, err);
+        } else if (type == GRETL_TYPE_LISTS) {
+            data = unpack_list(mb, err);
+        } else if (type == GRETL_TYPE_ARRAYS) {
+            data = unpack_array(mb, err);
+        } else {
+            *err = E_TYPES;
+        }
+        if (data != NULL) {
+            gretl_array_set_data(a, i, data);
+        }
+    }
+
+    if (*err && a != NULL) {
+        gretl_array_destroy(a);
+        a = NULL;
+    }
+
+    return a;
+}
+
+static int pack_bundle (mpi_buf *mb, gretl_bundle *b)
+{
+    gretl_array *keys = NULL;
+    int nk = gretl_bundle_get_n_keys(b);
+    int i, err = 0;
+
+    if (nk > 0) {
+        keys = gretl_bundle_get_keys(b, &err);
+        if (err) {
+            return err;
+        }
+    }
+
+    mb_put_int(mb, nk);
+
+    for (i=0; i<nk && !err; i++) {
+        const char *key = gretl_array_get_data(keys, i);
+        GretlType type;
+        void *data;
+        int size = 0;
+
+        data = gretl_bundle_get_data(b, key, &type, &size, &err);
+        if (err) {
+            break;
+        }
+        pack_string(mb, key);
+        mb_put_int(mb, type);
+        if (type == GRETL_TYPE_DOUBLE) {
+            mb_put(mb, data, sizeof(double));
+        } else if (type == GRETL_TYPE_INT) {
+            mb_put(mb, data, sizeof(int));
+        } else if (type == GRETL_TYPE_UINT32) {
+            mb_put(mb, data, sizeof(unsigned int));
+        } else if (type == GRETL_TYPE_UINT64) {
+            mb_put(mb, data, sizeof(guint64));
+        } else if (type == GRETL_TYPE_SERIES) {
+            mb_put_int(mb, size);
+            mb_put(mb, data, size * sizeof(double));
+        } else if (type == GRETL_TYPE_STRING) {
+            pack_string(mb, data);
+        } else if (type == GRETL_TYPE_LIST) {
+            pack_list(mb, data);
+        } else if (type == GRETL_TYPE_MATRIX) {
+            pack_matrix(mb, data);
+        } else if (type == GRETL_TYPE_BUNDLE) {
+            err = pack_bundle(mb, data);
+        } else if (type == GRETL_TYPE_ARRAY) {
+            err = pack_array(mb, data);
+        } else {
+            err = E_DATA;
+        }
+    }
+
+    gretl_array_destroy(keys);
+
+    return err;
+}
+
+static gretl_bundle *unpack_bundle (mpi_buf *mb, int *err)
+{
+    gretl_bundle *b = NULL;
+    int i, nk = 0;
+
+    *err = mb_get_int(mb, &nk);
+    if (*err) {
+        return NULL;
+    }
+
+    b = gretl_bundle_new();
+    if (b == NULL) {
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    for (i=0; i<nk && !*err; i++) {
+        GretlType type;
+        char *key = NULL;
+        void *data = NULL;
+        double x[2];
+        int t = 0, size = 0;
+
+        key = unpack_string(mb, err);
+        if (!*err) {
+            *err = mb_get_int(mb, &t);
+        }
+        if (*err) {
+            free(key);
+            break;
+        }
+        type = t;
+        if (type == GRETL_TYPE_DOUBLE) {
+            *err = mb_get(mb, x, sizeof(double));
+        } else if (type == GRETL_TYPE_INT) {
+            *err = mb_get(mb, x, sizeof(int));
+        } else if (type == GRETL_TYPE_UINT32) {
+            *err = mb_get(mb, x, sizeof(unsigned int));
+        } else if (type == GRETL_TYPE_UINT64) {
+            *err = mb_get(mb, x, sizeof(guint64));
+        } else if (type == GRETL_TYPE_SERIES) {
+            *err = mb_get_int(mb, &size);
+            if (!*err && (size < 0 ||
+                          size > (mb->len - mb->pos) / sizeof(double))) {
+                *err = E_DATA;
+            }
+            if (!*err) {
+                data = malloc(size * sizeof(double));
+                if (data == NULL) {
+                    *err = E_ALLOC;
+                } else {
+                    mb_get(mb, data, size * sizeof(double));
+                }
+            }
+        } else if (type == GRETL_TYPE_STRING) {
+            data = unpack_string(mb, err);
+        } else if (type == GRETL_TYPE_LIST) {
+            data = unpack_list(mb, err);
+        } else if (type == GRETL_TYPE_MATRIX) {
+            data = unpack_matrix(mb, err);
+        } else if (type == GRETL_TYPE_BUNDLE) {
+            data = unpack_bundle(mb, err);
+        } else if (type == GRETL_TYPE_ARRAY) {
+            data = unpack_array(mb, err);
+        } else {
+            *err = E_DATA;
+        }
+        if (!*err) {
+            if (gretl_is_scalar_type(type)) {
+                *err = gretl_bundle_set_data(b, key, x, type, 0);
+            } else {
+                *err = gretl_bundle_donate_data(b, key, data, type, size);
+            }
+        }
+        free(key);
+    }
+
+    if (*err) {
+        gretl_bundle_destroy(b);
+        b = NULL;
+    }
+
+    return b;
+}
+
+/* Pack bundle @b (if @a is NULL) or array @a into a newly allocated
+   buffer, the size of which is written to @len.
+*/
+
+static char *pack_object (gretl_bundle *b, gretl_array *a,
+                          size_t *len, int *err)
+{
+    mpi_buf mb = {NULL, 0, 0};
+
+    /* sizing pass */
+    *err = b != NULL ? pack_bundle(&mb, b) : pack_array(&mb, a);
+
+    if (!*err) {
+        *len = mb.pos;
+        mb.buf = malloc(*len);
+        if (mb.buf == NULL) {
+            *err = E_ALLOC;
+        } else {
+            mb.pos = 0;
+            *err = b != NULL ? pack_bundle(&mb, b) : pack_array(&mb, a);
+        }
+    }
+
+    if (*err) {
+        free(mb.buf);
+        mb.buf = NULL;
+    }
+
+    return mb.buf;
+}
+
+/* Broadcast a bundle (if @pb is non-NULL) or array as a single
+   packed buffer, preceded by its size.
+*/
+
+static int gretl_packed_bcast (gretl_bundle **pb, gretl_array **pa,
+                               int id, int root)
+{
+    mpi_buf mb = {NULL, 0, 0};
+    guint64 len = 0;
+    int err = 0;
+
+    if (id == root) {
+        size_t n = 0;
+
+        mb.buf = pack_object(pb != NULL ? *pb : NULL,
+                             pb != NULL ? NULL : *pa,
+                             &n, &err);
+        /* a length of zero signals failure on root */
+        len = err ? 0 : n;
+    }
+
+    if (mpi_bcast(&len, 1, mpi_uint64_t, root, mpi_comm_world)) {
+        err = E_EXTERNAL;
+    } else if (len == 0) {
+        err = err ? err : E_DATA;
+    }
+
+    if (!err && id != root) {
+        mb.buf = malloc(len);
+        if (mb.buf == NULL) {
+            return E_ALLOC;
+        }
+    }
+
+    if (!err) {
+        err = mpi_bcast_chunked(mb.buf, len, mpi_byte, 1, root);
+        if (err) {
+            gretl_mpi_error(&err);
+        }
+    }
+
+    if (!err && id != root) {
+        mb.len = len;
+        if (pb != NULL) {
+            *pb = unpack_bundle(&mb, &err);
+        } else {
+            *pa = unpack_array(&mb, &err);
+        }
+    }
+
+    free(mb.buf);
+
+    return err;
+}
+
+/* Send a bundle (if @b is non-NULL) or array to @dest as a single
+   packed buffer, preceded by its size under @tag.
+*/
+
+static int gretl_packed_send (gretl_bundle *b, gretl_array *a,
+                              int dest, int tag)
+{
+    char *buf;
+    guint64 len = 0;
+    size_t n = 0;
+    int err = 0;
+
+    buf = pack_object(b, a, &n, &err);
+    if (err) {
+        return err;
+    }
+
+    len = n;
+    err = mpi_send(&len, 1, mpi_uint64_t, dest, tag, mpi_comm_world);
+    if (!err) {
+        err = mpi_send_chunked(buf, len, mpi_byte, 1, dest,
+                               TAG_PACKED_BUF);
+    }
+
+    if (err) {
+        gretl_mpi_error(&err);
+    }
+
+    free(buf);
+
+    return err;
+}
+
+/* Receive a bundle (if @pb is non-NULL) or array from @source,
+   as sent by gretl_packed_send().
+*/
+
+static int gretl_packed_receive (gretl_bundle **pb, gretl_array **pa,
+                                 int source, int tag)
+{
+    mpi_buf mb = {NULL, 0, 0};
+    guint64 len = 0;
+    int err;
+
+    err = mpi_recv(&len, 1, mpi_uint64_t, source, tag,
+                   mpi_comm_world, MPI_STATUS_IGNORE);
+
+    if (!err) {
+        mb.buf = malloc(len);
+        if (mb.buf == NULL) {
+            return E_ALLOC;
+        }
+        err = mpi_recv_chunked(mb.buf, len, mpi_byte, 1, source,
+                               TAG_PACKED_BUF);
+    }
+
+    if (err) {
+        gretl_mpi_error(&err);
+    } else {
+        mb.len = len;
+        if (pb != NULL) {
+            *pb = unpack_bundle(&mb, &err);
+        } else {
+            *pa = unpack_array(&mb, &err);
+        }
+    }
+
+    free(mb.buf);
+
+    return err;
+}
+
+static int gretl_bundle_bcast (gretl_bundle **pb,
+                               int id, int root)
+{
+    return gretl_packed_bcast(pb, NULL, id, root);
+}
+
+static int gretl_array_bcast (gretl_array **pa, int id, int root)
+{
+    return gretl_packed_bcast(NULL, pa, id, root);
+}
+
+int gretl_mpi_barrier (void)
+{
+    return mpi_barrier(mpi_comm_world) != MPI_SUCCESS;
+}
+
+/**
+ * gretl_mpi_bcast:
+ * @p: the location of the object to be broadcast.
+ * @type: the type of the object to which @p points.
+ * @root: the rank of the root process.
+ *
+ * Broadcasts the value referenced by @p to MPI_COMM_WORLD.
+ * @type must be GRETL_TYPE_MATRIX, in which case
+ * @p should be a (**gretl_matrix) pointer; GRETL_TYPE_BUNDLE,
+ * in which case @p should be a (**gretl_bundle) pointer;
+ * or GRETL_TYPE_DOUBLE, in which case @p should be a (*double)
+ * pointer.
+ *
+ * Returns: 0 on successful completion, non-zero code otherwise.
+ **/
+
+int gretl_mpi_bcast (void *p, GretlType type, int root)
+{
+    int id, err;
+
+    err = gretl_comm_check(root, &id, NULL);
+    if (err) {
+        return err;
     }
 
     if (type == GRETL_TYPE_DOUBLE) {
@@ -1371,14 +1747,14 @@ int gretl_matrix_mpi_send (const gretl_matrix *m, int dest)
                    mpi_comm_world);
 
     if (!err) {
-        int n = m->rows * m->cols;
+        size_t n = (size_t) m->rows * m->cols;
 
         if (n > 0 && m->is_complex) {
-            err = mpi_send(m->z, n, mpi_complex, dest, TAG_CMATRIX_VAL,
-                           mpi_comm_world);
+            err = mpi_send_chunked(m->z, n, mpi_complex, sizeof *m->z,
+                                   dest, TAG_CMATRIX_VAL);
         } else if (n > 0) {
-            err = mpi_send(m->val, n, mpi_double, dest, TAG_MATRIX_VAL,
-                           mpi_comm_world);
+            err = mpi_send_chunked(m->val, n, mpi_double, sizeof *m->val,
+                                   dest, TAG_MATRIX_VAL);
         }
     }
 
@@ -1490,39 +1866,7 @@ static int gretl_int_send (int *pi, int dest)
 
 static int gretl_array_send (gretl_array *a, int dest)
 {
-    GretlType type = 0;
-    int nelem = 0;
-    int st[2];
-    int i, err = 0;
-
-    st[0] = nelem = gretl_array_get_length(a);
-    st[1] = type = gretl_array_get_type(a);
-
-    /* send the array size and type */
-    err = mpi_send(st, 2, mpi_int, dest, TAG_ARRAY_INFO,
-                   mpi_comm_world);
-
-    for (i=0; i<nelem && !err; i++) {
-        void *data = gretl_array_get_data(a, i);
-
-        if (type == GRETL_TYPE_MATRICES) {
-            err = gretl_matrix_mpi_send(data, dest);
-        } else if (type == GRETL_TYPE_STRINGS) {
-            err = gretl_string_send(data, dest);
-        } else if (type == GRETL_TYPE_BUNDLES) {
-            err = gretl_bundle_send(data, dest);
-        } else if (type == GRETL_TYPE_LISTS) {
-            err = gretl_list_send(data, dest);
-        } else if (type == GRETL_TYPE_ARRAYS) {
-            err = gretl_array_send(data, dest);
-        }
-    }
-
-    if (err) {
-        gretl_mpi_error(&err);
-    }
-
-    return err;
+    return gretl_packed_send(NULL, a, dest, TAG_ARRAY_INFO);
 }
 
 /**
@@ -1578,7 +1922,7 @@ gretl_matrix *gretl_matrix_mpi_receive (int source,
         int r = minfo[0];
         int c = minfo[1];
         int cmplx = minfo[2];
-        int n = r * c;
+        size_t n = (size_t) r * c;
 
         if (cmplx) {
             m = gretl_cmatrix_new(r, c);
@@ -1589,13 +1933,11 @@ gretl_matrix *gretl_matrix_mpi_receive (int source,
         if (m == NULL) {
             *err = E_ALLOC;
         } else if (n > 0 && cmplx) {
-            *err = mpi_recv(m->z, n, mpi_complex, source,
-                            TAG_CMATRIX_VAL, mpi_comm_world,
-                            MPI_STATUS_IGNORE);
+            *err = mpi_recv_chunked(m->z, n, mpi_complex, sizeof *m->z,
+                                    source, TAG_CMATRIX_VAL);
         } else if (n > 0) {
-            *err = mpi_recv(m->val, n, mpi_double, source,
-                            TAG_MATRIX_VAL, mpi_comm_world,
-                            MPI_STATUS_IGNORE);
+            *err = mpi_recv_chunked(m->val, n, mpi_double, sizeof *m->val,
+                                    source, TAG_MATRIX_VAL);
         }
         if (!*err) {
             maybe_date_matrix(m, minfo);
@@ -1626,7 +1968,7 @@ int gretl_matrix_mpi_fill (gretl_matrix **pm, int source)
         int r = minfo[0];
         int c = minfo[1];
         int cmplx = minfo[2];
-        int n = r * c;
+        size_t n = (size_t) r * c;
 
         if (m == NULL) {
             if (cmplx) {
@@ -1645,13 +1987,11 @@ int gretl_matrix_mpi_fill (gretl_matrix **pm, int source)
         }
         if (!err && n > 0) {
             if (cmplx) {
-                err = mpi_recv(m->z, n, mpi_complex, source,
-                               TAG_CMATRIX_VAL, mpi_comm_world,
-                               MPI_STATUS_IGNORE);
+                err = mpi_recv_chunked(m->z, n, mpi_complex, sizeof *m->z,
+                                       source, TAG_CMATRIX_VAL);
             } else {
-                err = mpi_recv(m->val, n, mpi_double, source,
-                               TAG_MATRIX_VAL, mpi_comm_world,
-                               MPI_STATUS_IGNORE);
+                err = mpi_recv_chunked(m->val, n, mpi_double, sizeof *m->val,
+                                       source, TAG_MATRIX_VAL);
             }
         }
         if (!err) {
@@ -1739,42 +2079,11 @@ static double gretl_int_receive (int source, int *err)
 static gretl_array *gretl_array_receive (int source, int *err)
 {
     gretl_array *a = NULL;
-    GretlType type = 0;
-    int nelem = 0;
-    int st[2];
-    int i;
 
-    /* get the array size and type */
-    *err = mpi_recv(st, 2, mpi_int, source, TAG_ARRAY_INFO,
-                    mpi_comm_world, MPI_STATUS_IGNORE);
-
-    if (!*err) {
-        nelem = st[0];
-        type = st[1];
-        a = gretl_array_new(type, nelem, err);
-    }
+    *err = gretl_packed_receive(NULL, &a, source, TAG_ARRAY_INFO);
 
-    for (i=0; i<nelem && !*err; i++) {
-        void *data = NULL;
-
-        if (type == GRETL_TYPE_MATRICES) {
-            data = gretl_matrix_mpi_receive(source, err);
-        } else if (type == GRETL_TYPE_STRINGS) {
-            data = gretl_string_receive(source, err);
-        } else if (type == GRETL_TYPE_BUNDLES) {
-            data = gretl_bundle_receive(source, err);
-        } else if (type == GRETL_TYPE_LISTS) {
-            data = gretl_list_receive(source, err);
-        } else if (type == GRETL_TYPE_ARRAYS) {
-            data = gretl_array_receive(source, err);
-        }
-        if (data != NULL) {
-            gretl_array_set_data(a, i, data);
-        }
-    }
-
-    return a;
-}
+    return a;
+}
 
 static GretlType type_from_status (MPI_Status *status)
 {
@@ -1865,196 +2174,16 @@ static void *mpi_receive_element (int source, GretlType etype,
     return ret;
 }
 
-/* "new"-style send/receive for bundles: we do everything
-   in memory */
-
-static int gretl_series_send (double *x, int n, int dest)
-{
-    int err;
-
-    err = mpi_send(&n, 1, mpi_int, dest, TAG_SERIES_LEN,
-                   mpi_comm_world);
-
-    if (!err) {
-        err = mpi_send(x, n, mpi_double, dest, TAG_SERIES_VAL,
-                       mpi_comm_world);
-    }
-
-    if (err) {
-        gretl_mpi_error(&err);
-    }
-
-    return err;
-}
-
-static double *gretl_series_receive (int source, int *err)
-{
-    double *x = NULL;
-    int n;
-
-    *err = mpi_recv(&n, 1, mpi_int, source, TAG_SERIES_LEN,
-                    mpi_comm_world, MPI_STATUS_IGNORE);
-
-    if (!*err) {
-        x = malloc(n * sizeof *x);
-        if (x == NULL) {
-            *err = E_ALLOC;
-            return NULL;
-        } else {
-            *err = mpi_recv(x, n, mpi_double, source,
-                            TAG_SERIES_VAL, mpi_comm_world,
-                            MPI_STATUS_IGNORE);
-        }
-    }
-
-    if (*err) {
-        gretl_mpi_error(err);
-    }
-
-    return x;
-}
-
 static int gretl_bundle_send (gretl_bundle *b, int dest)
 {
-    gretl_array *keys = NULL;
-    GretlType type;
-    void *data;
-    char msgbuf[64];
-    int msglen = sizeof msgbuf;
-    int size;
-    int i, nk;
-    int err = 0;
-
-    nk = gretl_bundle_get_n_keys(b);
-    if (nk > 0) {
-        keys = gretl_bundle_get_keys(b, &err);
-        if (err) {
-            return err;
-        }
-    }
-
-    /* send the number of keys first */
-    err = mpi_send(&nk, 1, mpi_int, dest, TAG_BUNDLE_SIZE,
-                   mpi_comm_world);
-
-    if (nk == 0) {
-        /* the bundle is empty */
-        return 0;
-    }
-
-    for (i=0; i<nk && !err; i++) {
-        /* loop across bundle keys */
-        const char *key = gretl_array_get_data(keys, i);
-
-        data = gretl_bundle_get_data(b, key, &type, &size, &err);
-        if (!err) {
-            /* send info on the bundle member */
-            compose_msgbuf(msgbuf, type, key, &size, data);
-            err = mpi_send(msgbuf, msglen, mpi_byte, dest,
-                           TAG_BMEMB_INFO, mpi_comm_world);
-        }
-        if (err) {
-            break;
-        }
-        if (type == GRETL_TYPE_MATRIX) {
-            err = gretl_matrix_mpi_send(data, dest);
-        } else if (type == GRETL_TYPE_ARRAY) {
-            err = gretl_array_send(data, dest);
-        } else if (type == GRETL_TYPE_BUNDLE) {
-            err = gretl_bundle_send(data, dest);
-        } else if (type == GRETL_TYPE_SERIES) {
-            err = gretl_series_send(data, size, dest);
-        } else if (type == GRETL_TYPE_STRING) {
-            err = gretl_string_send(data, dest);
-        } else if (type == GRETL_TYPE_LIST) {
-            err = gretl_list_send(data, dest);
-        } else if (type == GRETL_TYPE_DOUBLE) {
-            err = gretl_scalar_send(data, dest);
-        } else if (type == GRETL_TYPE_INT) {
-            err = gretl_int_send(data, dest);
-        }
-    }
-
-    gretl_array_destroy(keys);
-
-    if (err) {
-        gretl_mpi_error(&err);
-    }
-
-    return err;
+    return gretl_packed_send(b, NULL, dest, TAG_BUNDLE_SIZE);
 }
 
 gretl_bundle *gretl_bundle_receive (int source, int *err)
 {
     gretl_bundle *b = NULL;
-    char key[32];
-    char msgbuf[64];
-    int msglen = sizeof msgbuf;
-    int size;
-    int i, nk;
-
-    /* get the number of keys first */
-    *err = mpi_recv(&nk, 1, mpi_int, source, TAG_BUNDLE_SIZE,
-                    mpi_comm_world, MPI_STATUS_IGNORE);
 
-    if (!*err) {
-        b = gretl_bundle_new();
-        if (b == NULL) {
-            *err = E_ALLOC;
-            return NULL;
-        }
-    }
-
-    if (nk == 0) {
-        /* the bundle is empty */
-        return b;
-    }
-
-    for (i=0; i<nk && !*err; i++) {
-        /* loop across bundle keys */
-        GretlType type = 0;
-        void *data = NULL;
-        double x;
-
-        memset(msgbuf, 0, msglen);
-        size = 0;
-
-        /* get info on bundle member @i */
-        *err = mpi_recv(msgbuf, msglen, mpi_byte, source, TAG_BMEMB_INFO,
-                        mpi_comm_world, MPI_STATUS_IGNORE);
-        if (!*err) {
-            *err = parse_msgbuf(msgbuf, key, &type, &size);
-        }
-        if (*err) {
-            break;
-        }
-        if (type == GRETL_TYPE_DOUBLE) {
-            x = gretl_scalar_receive(source, err);
-            data = &x;
-        } else if (type == GRETL_TYPE_INT) {
-            x = gretl_int_receive(source, err);
-            data = &x;
-        } else if (type == GRETL_TYPE_MATRIX) {
-            data = gretl_matrix_mpi_receive(source, err);
-        } else if (type == GRETL_TYPE_ARRAY) {
-            data = gretl_array_receive(source, err);
-        } else if (type == GRETL_TYPE_BUNDLE) {
-            data = gretl_bundle_receive(source, err);
-        } else if (type == GRETL_TYPE_SERIES) {
-            data = gretl_series_receive(source, err);
-        } else if (type == GRETL_TYPE_LIST) {
-            data = gretl_list_receive(source, err);
-        } else if (type == GRETL_TYPE_STRING) {
-            data = gretl_string_receive(source, err);
-        }
-        if (!*err) {
-            *err = gretl_bundle_donate_data(b, key, data, type, size);
-        }
-    }
-
-    if (*err) {
-        gretl_mpi_error(err);
-    }
+    *err = gretl_packed_receive(&b, NULL, source, TAG_BUNDLE_SIZE);
 
     return b;
 }
@@ -2272,6 +2401,293 @@ int gretl_matrix_mpi_scatter (const gretl_matrix *m,
 
 /* MPI timer */
 
+/* Node-level sharing of read-only matrices via MPI-3 shared-memory
+   windows. When several ranks run on one node, a large matrix that
+   they all need to read can be held once per node rather than once
+   per rank. If the MPI implementation lacks the required facilities
+   we fall back to giving each rank its own copy, so callers need
+   not distinguish the two cases.
+*/
+
+struct node_win {
+    double *val;  /* shared data */
+    MPI_Win win;  /* the window that holds it */
+};
+
+static MPI_Comm node_comm;
+static int node_comm_state;    /* 0 = untried, 1 = OK, -1 = failed */
+static struct node_win *node_wins;
+static int n_node_wins;
+
+static int get_node_comm (void)
+{
+    if (node_comm_state == 0) {
+        node_comm_state = -1;
+        if (mpi_comm_split_type != NULL &&
+            mpi_comm_split_type(mpi_comm_world, MPI_COMM_TYPE_SHARED,
+                                0, mpi_info_null, &node_comm) == MPI_SUCCESS) {
+            node_comm_state = 1;
+        }
+    }
+
+    return node_comm_state > 0;
+}
+
+/**
+ * gretl_mpi_node_rank:
+ *
+ * Returns: the rank of the calling process among those running
+ * on the same node (shared-memory domain), or its rank in
+ * MPI_COMM_WORLD if node-level information is not available.
+ * This function is collective on its first call.
+ **/
+
+int gretl_mpi_node_rank (void)
+{
+    int id = 0;
+
+    if (get_node_comm()) {
+        mpi_comm_rank(node_comm, &id);
+    } else {
+        mpi_comm_rank(mpi_comm_world, &id);
+    }
+
+    return id;
+}
+
+/**
+ * gretl_mpi_node_size:
+ *
+ * Returns: the number of MPI processes running on the same node
+ * (shared-memory domain) as the caller, or 1 if node-level
+ * information is not available. This function is collective on
+ * its first call.
+ **/
+
+int gretl_mpi_node_size (void)
+{
+    int n = 1;
+
+    if (get_node_comm()) {
+        mpi_comm_size(node_comm, &n);
+    }
+
+    return n;
+}
+
+static int node_win_index (const gretl_matrix *m)
+{
+    int i;
+
+    if (m != NULL && m->val != NULL) {
+        for (i=0; i<n_node_wins; i++) {
+            if (node_wins[i].val == m->val) {
+                return i;
+            }
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * gretl_matrix_mpi_node_share:
+ * @m: source (real) matrix, required only on processes with
+ * node rank 0 (see gretl_mpi_node_rank()).
+ * @err: location to receive error code.
+ *
+ * Collective over MPI_COMM_WORLD. Each process receives a matrix
+ * with the content of @m as held by the process of node rank 0 on
+ * its node. Where possible the data are held in a single segment
+ * of memory shared by all the processes on the node; otherwise
+ * each process gets a private copy. In the shared case writing to
+ * the matrix affects all processes on the node: the result is
+ * intended for read-only use, and any modification must be made by
+ * one process followed by a call to gretl_matrix_mpi_node_sync().
+ * The matrix must be freed with gretl_matrix_mpi_node_free().
+ *
+ * Returns: the matrix, or NULL on failure.
+ **/
+
+gretl_matrix *gretl_matrix_mpi_node_share (const gretl_matrix *m,
+                                           int *err)
+{
+    gretl_matrix *ret = NULL;
+    int minfo[MI_LEN] = {0};
+    MPI_Comm comm = mpi_comm_world;
+    MPI_Aint bytes = 0;
+    MPI_Win win;
+    double *val = NULL;
+    size_t n;
+    int myshare, shared = 0;
+    int id = 0;
+
+    /* we need a common decision on sharing, across the world */
+    myshare = get_node_comm();
+    if (mpi_allreduce(&myshare, &shared, 1, mpi_int, mpi_min,
+                      mpi_comm_world) != MPI_SUCCESS) {
+        *err = E_EXTERNAL;
+        return NULL;
+    }
+
+    if (shared) {
+        comm = node_comm;
+    }
+    mpi_comm_rank(comm, &id);
+
+    if (id == 0) {
+        if (m == NULL || m->is_complex || fill_matrix_info(minfo, m)) {
+            /* signal failure to the others */
+            minfo[0] = -1;
+        }
+    }
+
+    *err = mpi_bcast(minfo, MI_LEN, mpi_int, 0, comm);
+    if (*err) {
+        gretl_mpi_error(err);
+        return NULL;
+    } else if (minfo[0] < 0) {
+        *err = E_DATA;
+        return NULL;
+    }
+
+    n = (size_t) minfo[0] * minfo[1];
+
+    if (!shared) {
+        /* fallback: give everyone a private copy */
+        ret = gretl_matrix_alloc(minfo[0], minfo[1]);
+        if (ret == NULL) {
+            *err = E_ALLOC;
+        } else if (id == 0) {
+            gretl_matrix_copy_values(ret, m);
+        }
+        if (!*err && n > 0) {
+            *err = mpi_bcast_chunked(ret->val, n, mpi_double,
+                                     sizeof(double), 0);
+        }
+        if (!*err) {
+            maybe_date_matrix(ret, minfo);
+        } else {
+            gretl_matrix_free(ret);
+            ret = NULL;
+        }
+        return ret;
+    }
+
+    if (id == 0) {
+        bytes = n * sizeof(double);
+    }
+
+    if (mpi_win_allocate_shared(bytes, sizeof(double), mpi_info_null,
+                                node_comm, &val, &win) != MPI_SUCCESS) {
+        *err = E_EXTERNAL;
+        return NULL;
+    }
+
+    if (id > 0) {
+        /* get the address of the node leader's segment */
+        int disp;
+
+        mpi_win_shared_query(win, 0, &bytes, &disp, &val);
+    }
+
+    mpi_win_fence(0, win);
+    if (id == 0 && n > 0) {
+        memcpy(val, m->val, n * sizeof(double));
+    }
+    mpi_win_fence(0, win);
+
+    ret = gretl_null_matrix_new();
+    if (ret == NULL) {
+        *err = E_ALLOC;
+    } else {
+        struct node_win *nw;
+
+        nw = realloc(node_wins, (n_node_wins + 1) * sizeof *nw);
+        if (nw == NULL) {
+            *err = E_ALLOC;
+        } else {
+            node_wins = nw;
+            node_wins[n_node_wins].val = val;
+            node_wins[n_node_wins].win = win;
+            n_node_wins++;
+            ret->rows = minfo[0];
+            ret->cols = minfo[1];
+            ret->val = val;
+            maybe_date_matrix(ret, minfo);
+        }
+    }
+
+    if (*err) {
+        gretl_matrix_free(ret);
+        ret = NULL;
+        mpi_win_free(&win);
+    }
+
+    return ret;
+}
+
+/**
+ * gretl_matrix_mpi_node_shared:
+ * @m: matrix obtained via gretl_matrix_mpi_node_share().
+ *
+ * Returns: 1 if @m is actually held in node-shared memory,
+ * 0 if it is a private copy.
+ **/
+
+int gretl_matrix_mpi_node_shared (const gretl_matrix *m)
+{
+    return node_win_index(m) >= 0;
+}
+
+/**
+ * gretl_matrix_mpi_node_sync:
+ * @m: matrix obtained via gretl_matrix_mpi_node_share().
+ *
+ * Collective over the processes on a node: ensures that a
+ * modification of @m by one of them is complete and visible to
+ * all the others.
+ *
+ * Returns: 0 on success, non-zero on failure.
+ **/
+
+int gretl_matrix_mpi_node_sync (gretl_matrix *m)
+{
+    int i = node_win_index(m);
+
+    if (i >= 0) {
+        return mpi_win_fence(0, node_wins[i].win) != MPI_SUCCESS;
+    } else {
+        /* private copy: nothing to synchronize */
+        return 0;
+    }
+}
+
+/**
+ * gretl_matrix_mpi_node_free:
+ * @m: matrix obtained via gretl_matrix_mpi_node_share().
+ *
+ * Frees @m. If @m is held in shared memory this is collective
+ * over the processes on the node.
+ **/
+
+void gretl_matrix_mpi_node_free (gretl_matrix *m)
+{
+    int i = node_win_index(m);
+
+    if (i >= 0) {
+        m->val = NULL;
+        m->rows = m->cols = 0;
+        mpi_win_free(&node_wins[i].win);
+        n_node_wins--;
+        if (i < n_node_wins) {
+            node_wins[i] = node_wins[n_node_wins];
+        }
+    }
+
+    gretl_matrix_free(m);
+}
+
 double gretl_mpi_time (void)
 {
     return mpi_wtime();
@@ -2279,6 +2695,254 @@ double gretl_mpi_time (void)
 
 /* end MPI timer */
 
+/* Dynamic load balancing: a task queue in which rank 0 deals out
+   the elements of an array one at a time to the other processes,
+   each of which asks for more work as soon as it has finished its
+   current task. This suits tasks of uneven or unpredictable cost,
+   for which a static division of the work leaves processes idle.
+*/
+
+#define TASK_STOP -1
+
+static void free_task_data (void *p, GretlType type)
+{
+    if (type == GRETL_TYPE_MATRIX) {
+        gretl_matrix_free(p);
+    } else if (type == GRETL_TYPE_BUNDLE) {
+        gretl_bundle_destroy(p);
+    } else if (type == GRETL_TYPE_ARRAY) {
+        gretl_array_destroy(p);
+    } else if (type == GRETL_TYPE_STRING || type == GRETL_TYPE_LIST) {
+        free(p);
+    }
+}
+
+/* send task @idx (or TASK_STOP) plus its input to worker @w */
+
+static int task_dispatch (gretl_array *items, GretlType itype,
+                          int idx, int w)
+{
+    int err;
+
+    err = mpi_send(&idx, 1, mpi_int, w, TAG_TASK_IDX, mpi_comm_world);
+    if (err) {
+        gretl_mpi_error(&err);
+    } else if (idx >= 0) {
+        err = gretl_mpi_send(gretl_array_get_data(items, idx), itype, w);
+    }
+
+    return err;
+}
+
+static int task_master (gretl_array *items, GretlType itype,
+                        gretl_array *ret, GretlType rtype,
+                        int n, int np)
+{
+    MPI_Status status;
+    GretlType type;
+    void *res;
+    int hdr[2];
+    int next = 0;
+    int active = 0;
+    int w, rerr;
+    int err = 0;
+
+    /* give each worker its first task (or none) */
+    for (w=1; w<np; w++) {
+        if (next < n && !err) {
+            err = task_dispatch(items, itype, next++, w);
+            active += (err == 0);
+        } else {
+            task_dispatch(NULL, itype, TASK_STOP, w);
+        }
+    }
+
+    /* then hand out the rest in order of completion */
+    while (active > 0) {
+        mpi_probe(MPI_ANY_SOURCE, TAG_TASK_DONE, mpi_comm_world, &status);
+        w = status.MPI_SOURCE;
+        rerr = mpi_recv(hdr, 2, mpi_int, w, TAG_TASK_DONE,
+                        mpi_comm_world, MPI_STATUS_IGNORE);
+        if (rerr) {
+            gretl_mpi_error(&rerr);
+        } else if (hdr[1] == 0) {
+            res = gretl_mpi_receive(w, &type, &rerr);
+            if (!rerr && type != rtype) {
+                free_task_data(res, type);
+                rerr = E_TYPES;
+            }
+            if (!rerr) {
+                rerr = gretl_array_set_element(ret, hdr[0], res, rtype, 0);
+                if (rerr) {
+                    free_task_data(res, rtype);
+                }
+            }
+        } else {
+            rerr = hdr[1];
+        }
+        if (rerr && !err) {
+            err = rerr;
+        }
+        active--;
+        if (next < n && !err) {
+            rerr = task_dispatch(items, itype, next++, w);
+            if (rerr) {
+                err = rerr;
+                task_dispatch(NULL, itype, TASK_STOP, w);
+            } else {
+                active++;
+            }
+        } else {
+            task_dispatch(NULL, itype, TASK_STOP, w);
+        }
+    }
+
+    return err;
+}
+
+static int task_worker (GretlType rtype, GretlMPITask task, void *ctx)
+{
+    GretlType itype;
+    void *item, *res;
+    int hdr[2];
+    int idx, terr;
+    int err = 0;
+
+    while (1) {
+        terr = mpi_recv(&idx, 1, mpi_int, 0, TAG_TASK_IDX,
+                        mpi_comm_world, MPI_STATUS_IGNORE);
+        if (terr) {
+            gretl_mpi_error(&terr);
+            return terr;
+        } else if (idx == TASK_STOP) {
+            break;
+        }
+        res = NULL;
+        item = gretl_mpi_receive(0, &itype, &terr);
+        if (!terr) {
+            res = task(item, itype, ctx, &terr);
+        }
+        if (!terr && res == NULL) {
+            terr = E_DATA;
+        }
+        hdr[0] = idx;
+        hdr[1] = terr;
+        mpi_send(hdr, 2, mpi_int, 0, TAG_TASK_DONE, mpi_comm_world);
+        if (!terr) {
+            terr = gretl_mpi_send(res, rtype, 0);
+        }
+        free_task_data(item, itype);
+        free_task_data(res, rtype);
+        if (terr && !err) {
+            err = terr;
+        }
+    }
+
+    return err;
+}
+
+/**
+ * gretl_mpi_task_queue:
+ * @items: array of task inputs, required only at rank 0.
+ * @rtype: the type of the value produced by @task: matrix,
+ * bundle, string, list or array.
+ * @task: function to be applied to each element of @items.
+ * @ctx: context pointer passed to @task.
+ * @err: location to receive error code.
+ *
+ * Collective over MPI_COMM_WORLD. Applies @task to each element
+ * of @items. If there is more than one process, rank 0 acts as
+ * dispatcher: it sends each of the other processes one element at
+ * a time, and sends the next pending element to whichever process
+ * reports completion first, so that the load is balanced however
+ * uneven the cost of the tasks. With a single process the tasks are
+ * executed in sequence at rank 0. On an error in any task no further
+ * tasks are started; the error is propagated to all processes.
+ *
+ * Returns: at rank 0, an array holding the results in the order of
+ * @items; at other ranks, NULL.
+ **/
+
+gretl_array *gretl_mpi_task_queue (gretl_array *items,
+                                   GretlType rtype,
+                                   GretlMPITask task,
+                                   void *ctx, int *err)
+{
+    gretl_array *ret = NULL;
+    GretlType itype = 0;
+    int id, np, n = 0;
+    int myerr = 0;
+
+    mpi_comm_rank(mpi_comm_world, &id);
+    mpi_comm_size(mpi_comm_world, &np);
+
+    if (id == 0) {
+        if (items == NULL) {
+            n = -1;
+        } else {
+            n = gretl_array_get_length(items);
+            itype = gretl_type_get_singular(gretl_array_get_type(items));
+        }
+    }
+
+    /* everyone needs to know the number of tasks */
+    *err = mpi_bcast(&n, 1, mpi_int, 0, mpi_comm_world);
+    if (*err) {
+        gretl_mpi_error(err);
+        return NULL;
+    } else if (n < 0) {
+        *err = E_DATA;
+        return NULL;
+    }
+
+    if (id == 0) {
+        ret = gretl_array_new(gretl_type_get_plural(rtype), n, &myerr);
+        if (myerr) {
+            /* release the workers without giving them any tasks */
+            n = 0;
+        }
+        if (np > 1) {
+            int terr = task_master(items, itype, ret, rtype, n, np);
+
+            if (!myerr) {
+                myerr = terr;
+            }
+        } else {
+            void *res;
+            int i;
+
+            for (i=0; i<n && !myerr; i++) {
+                res = task(gretl_array_get_data(items, i), itype,
+                           ctx, &myerr);
+                if (!myerr && res == NULL) {
+                    myerr = E_DATA;
+                }
+                if (!myerr) {
+                    myerr = gretl_array_set_element(ret, i, res, rtype, 0);
+                    if (myerr) {
+                        free_task_data(res, rtype);
+                    }
+                }
+            }
+        }
+    } else {
+        myerr = task_worker(rtype, task, ctx);
+    }
+
+    /* agree on the outcome */
+    mpi_allreduce(&myerr, err, 1, mpi_int, mpi_max, mpi_comm_world);
+    if (*err && myerr == 0) {
+        gretl_errmsg_set(_("Error in MPI task on another process"));
+    }
+
+    if (*err) {
+        gretl_array_destroy(ret);
+        ret = NULL;
+    }
+
+    return ret;
+}
+
 int gretl_mpi_rank (void)
 {
     int id = -1;
@@ -32,6 +32,9 @@ typedef enum {
     GRETL_MPI_VSPLIT
 } Gretl_MPI_Op;
 
+typedef void *(*GretlMPITask) (void *item, GretlType itype,
+			       void *ctx, int *err);
+
 int gretl_MPI_init (void);
 
 int gretl_mpi_initialized (void);
@@ -81,4 +84,22 @@ double gretl_mpi_time (void);
 
 int gretl_mpi_bcast_rng (guint64 *u, int root);
 
+int gretl_mpi_node_rank (void);
+
+int gretl_mpi_node_size (void);
+
+gretl_matrix *gretl_matrix_mpi_node_share (const gretl_matrix *m,
+					   int *err);
+
+int gretl_matrix_mpi_node_shared (const gretl_matrix *m);
+
+int gretl_matrix_mpi_node_sync (gretl_matrix *m);
+
+void gretl_matrix_mpi_node_free (gretl_matrix *m);
+
+gretl_array *gretl_mpi_task_queue (gretl_array *items,
+				   GretlType rtype,
+				   GretlMPITask task,
+				   void *ctx, int *err);
+
 #endif /* GRETL_MPI_H */
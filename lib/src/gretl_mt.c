@@ -40,6 +40,18 @@
 
 static int gretl_omp_threads;
 
+/* Non-zero in a thread that has an interpreter context of its own
+   (see libgretl_thread_init()): OpenMP regions entered by such a
+   thread are run by that thread alone, since the workers of a team
+   would see the program-wide settings and variables rather than
+   those of the thread that started them.
+*/
+static int thread_serial;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(thread_serial)
+#endif
+
 #if defined(_OPENMP) && !defined(__APPLE__)
 static int omp_mnk_min = 80000;
 #else
@@ -136,7 +148,7 @@ int gretl_n_physical_cores (void)
 
 int gretl_use_openmp (guint64 n)
 {
-    if (gretl_omp_threads < 2) {
+    if (gretl_omp_threads < 2 || thread_serial) {
 	return 0;
     } else if (omp_mnk_min >= 0 && n >= (guint64) omp_mnk_min) {
 	return 1;
@@ -179,8 +191,10 @@ int gretl_set_omp_threads (int n)
 	return E_DATA;
     } else {
 	gretl_omp_threads = n;
-	omp_set_num_threads(n); /* note: overrides env */
-	if (blas_is_threaded()) {
+	if (!thread_serial) {
+	    omp_set_num_threads(n); /* note: overrides env */
+	}
+	if (blas_is_threaded() && !libset_get_bool(DETERMINISTIC)) {
 	    blas_set_num_threads(n);
 	}
     }
@@ -191,6 +205,46 @@ int gretl_set_omp_threads (int n)
     return 0;
 }
 
+/* Called by libgretl_thread_init() with @s = 1, and by
+   libgretl_thread_cleanup() with @s = 0: see thread_serial above.
+   The OpenMP thread count set here belongs to the calling thread
+   only.
+*/
+
+void gretl_mt_thread_serial (int s)
+{
+    thread_serial = s;
+#if defined(_OPENMP)
+    if (s) {
+	omp_set_num_threads(1);
+    } else if (gretl_omp_threads > 0) {
+	omp_set_num_threads(gretl_omp_threads);
+    }
+#endif
+}
+
+/* Called via libset.c for "set deterministic": a threaded BLAS
+   may divide up its reductions in a way that depends on the number
+   of threads, so while this setting is on we restrict the BLAS to
+   a single thread. gretl's own OpenMP loops either assign each
+   result to a single thread or, as in the describe.c sums, use a
+   fixed blocking, so they can go on using several threads.
+*/
+
+void gretl_mt_set_deterministic (int s)
+{
+    static int blas_nt;
+
+    if (!blas_is_threaded()) {
+	return;
+    } else if (s) {
+	blas_nt = blas_get_num_threads();
+	blas_set_num_threads(1);
+    } else if (blas_nt > 0) {
+	blas_set_num_threads(blas_nt);
+    }
+}
+
 void num_threads_init (int blas_type)
 {
     int nc = gretl_n_physical_cores();
@@ -208,7 +262,7 @@ void num_threads_init (int blas_type)
 int gretl_get_omp_threads (void)
 {
 #if defined(_OPENMP)
-    return gretl_omp_threads;
+    return thread_serial ? 1 : gretl_omp_threads;
 #else
     gretl_warnmsg_set(_("gretl_get_omp_threads: OpenMP is not enabled"));
     return 0;
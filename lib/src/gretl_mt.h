@@ -26,6 +26,10 @@ int gretl_n_physical_cores (void);
 
 void num_threads_init (int blas_type);
 
+void gretl_mt_set_deterministic (int s);
+
+void gretl_mt_thread_serial (int s);
+
 int gretl_get_omp_threads (void);
 
 int gretl_set_omp_threads (int n);
@@ -23,6 +23,7 @@
 
 #include "libgretl.h"
 #include "libset.h"
+#include "gretl_normal.h"
 #include "../../cephes/libprob.h"
 
 #if defined(_OPENMP) && !defined(__APPLE__)
@@ -140,66 +141,69 @@ double invmills (double x)
  * or #NADBL on failure.
  */
 
+static const double genz_w3[] = {
+    .1713244923791705, .3607615730481384, .4679139345726904
+};
+
+static const double genz_x3[] = {
+    -.9324695142031522, -.6612093864662647, -.238619186083197
+};
+
+static const double genz_w6[] = {
+    .04717533638651177, .1069393259953183, .1600783285433464,
+    .2031674267230659, .2334925365383547, .2491470458134029
+};
+
+static const double genz_x6[] = {
+    -.9815606342467191, -.904117256370475, -.769902674194305,
+    -.5873179542866171, -.3678314989981802, -.1252334085114692
+};
+
+static const double genz_w10[] = {
+    .01761400713915212, .04060142980038694, .06267204833410906,
+    .08327674157670475, .1019301198172404, .1181945319615184,
+    .1316886384491766, .1420961093183821, .1491729864726037,
+    .1527533871307259
+};
+
+static const double genz_x10[] = {
+    -.9931285991850949, -.9639719272779138, -.9122344282513259,
+    -.8391169718222188, -.7463319064601508, -.636053680726515,
+    -.5108670019508271, -.3737060887154196, -.2277858511416451,
+    -.07652652113349733
+};
+
+/* Gauss-Legendre weights and abscissae for the quadrature
+   in genz04(), depending on the magnitude of rho */
+
+static int genz_nodes (double absrho, const double **w,
+		       const double **x)
+{
+    if (absrho < 0.3) {
+	*w = genz_w3;
+	*x = genz_x3;
+	return 3;
+    } else if (absrho < 0.75) {
+	*w = genz_w6;
+	*x = genz_x6;
+	return 6;
+    } else {
+	*w = genz_w10;
+	*x = genz_x10;
+	return 10;
+    }
+}
+
 static double genz04 (double rho, double limx, double limy)
 {
-    double w[10], x[10];
+    const double *w, *x;
     double absrho = fabs(rho);
     double h, k, hk, bvn, hs, asr;
     double a, b, as, d1, bs, c, d, tmp;
     double sn, xs, rs;
     int i, lg, j;
 
-    if (absrho < 0.3) {
-	w[0] = .1713244923791705;
-	w[1] = .3607615730481384;
-	w[2] = .4679139345726904;
-
-	x[0] = -.9324695142031522;
-	x[1] = -.6612093864662647;
-	x[2] = -.238619186083197;
-
-	lg = 3;
-    } else if (absrho < 0.75) {
-	w[0] = .04717533638651177;
-	w[1] = .1069393259953183;
-	w[2] = .1600783285433464;
-	w[3] = .2031674267230659;
-	w[4] = .2334925365383547;
-	w[5] = .2491470458134029;
-
-	x[0] = -.9815606342467191;
-	x[1] = -.904117256370475;
-	x[2] = -.769902674194305;
-	x[3] = -.5873179542866171;
-	x[4] = -.3678314989981802;
-	x[5] = -.1252334085114692;
-
-	lg = 6;
-    } else {
-	w[0] = .01761400713915212;
-	w[1] = .04060142980038694;
-	w[2] = .06267204833410906;
-	w[3] = .08327674157670475;
-	w[4] = .1019301198172404;
-	w[5] = .1181945319615184;
-	w[6] = .1316886384491766;
-	w[7] = .1420961093183821;
-	w[8] = .1491729864726037;
-	w[9] = .1527533871307259;
-
-	x[0] = -.9931285991850949;
-	x[1] = -.9639719272779138;
-	x[2] = -.9122344282513259;
-	x[3] = -.8391169718222188;
-	x[4] = -.7463319064601508;
-	x[5] = -.636053680726515;
-	x[6] = -.5108670019508271;
-	x[7] = -.3737060887154196;
-	x[8] = -.2277858511416451;
-	x[9] = -.07652652113349733;
-
-	lg = 10;
-    }
+    lg = genz_nodes(absrho, &w, &x);
 
     h = -limx;
     k = -limy;
@@ -396,6 +400,106 @@ double bvnorm_cdf (double rho, double a, double b)
 #endif
 }
 
+#if defined(_OPENMP) && !defined(__APPLE__)
+# define OMP_BVN_MIN 4096
+#endif
+
+#if GENZ_BVN
+
+/* genz04() for the case |rho| < 0.925, with the quantities that
+   depend on rho alone (in @sn and @den, with weights @wt) computed
+   in advance by the caller
+*/
+
+static double genz04_lowrho (double asr, const double *sn,
+			     const double *den, const double *wt,
+			     int nl, double limx, double limy)
+{
+    double h = -limx;
+    double k = -limy;
+    double hk = h * k;
+    double hs = (h * h + k * k) / 2;
+    double bvn = 0.0;
+    int l;
+
+    for (l=0; l<nl; l++) {
+	bvn += wt[l] * exp((sn[l] * hk - hs) / den[l]);
+    }
+    bvn = bvn * asr / (2 * M_2PI);
+    bvn += normal_cdf(-h) * normal_cdf(-k);
+
+    return (bvn < 0) ? 0 : bvn;
+}
+
+#endif
+
+/**
+ * bvnorm_cdf_array:
+ * @rho: correlation coefficient.
+ * @a: array of abscissa values, first Gaussian r.v.
+ * @ainc: increment between elements of @a, or 0 to use
+ * the single value *@a throughout.
+ * @b: array of abscissa values, second Gaussian r.v.
+ * @binc: increment between elements of @b, or 0 to use
+ * the single value *@b throughout.
+ * @P: array of length @n to hold the results.
+ * @n: number of points at which to evaluate.
+ *
+ * Vectorized version of bvnorm_cdf() for a common correlation
+ * coefficient. The quantities that depend on @rho alone are
+ * computed just once, and for large @n the work is shared among
+ * OpenMP threads. Elements of @P for which either abscissa is NaN
+ * are set to #NADBL.
+ */
+
+void bvnorm_cdf_array (double rho, const double *a, int ainc,
+		       const double *b, int binc,
+		       double *P, int n)
+{
+#if GENZ_BVN
+    double sn[20], den[20], wt[20];
+    double asr = 0.0;
+    int nl = 0;
+#endif
+    int i;
+
+#if GENZ_BVN
+    if (rho != 0.0 && fabs(rho) < 0.925) {
+	const double *w, *x;
+	int lg, j;
+
+	lg = genz_nodes(fabs(rho), &w, &x);
+	asr = asin(rho);
+	for (i=0; i<lg; i++) {
+	    for (j=0; j<=1; j++) {
+		sn[nl] = sin(asr * (1 + (2*j-1)*x[i]) / 2);
+		den[nl] = 1 - sn[nl] * sn[nl];
+		wt[nl] = w[i];
+		nl++;
+	    }
+	}
+    }
+#endif
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp parallel for if (n>OMP_BVN_MIN)
+#endif
+    for (i=0; i<n; i++) {
+	double ai = a[i * ainc];
+	double bi = b[i * binc];
+
+	if (isnan(ai) || isnan(bi)) {
+	    P[i] = NADBL;
+#if GENZ_BVN
+	} else if (nl > 0) {
+	    P[i] = genz04_lowrho(asr, sn, den, wt, nl, ai, bi);
+#endif
+	} else {
+	    P[i] = bvnorm_cdf(rho, ai, bi);
+	}
+    }
+}
+
 /* next: GHK apparatus with various helper functions */
 
 #define GHK_DEBUG 0
@@ -454,55 +558,270 @@ static void vector_subtract (gretl_matrix *targ,
     }
 }
 
+/* Should we enable OMP for GHK calculations? If so, the threshold
+   problem size that makes use of OMP worthwhile can be set via
+   "set omp_ghk_min": a positive value is compared against the
+   work count n * m^2 * r; -1 means never use OMP, and 0 (the
+   default) means that the cost per observation is timed on
+   the first few observations and OMP is used if the remaining
+   work should take more than GHK_OMP_USEC microseconds. In
+   the auto case the variant with derivatives, gretl_GHK2(),
+   just applies the fixed size threshold GHK2_OMP_MIN.
+*/
+#if defined(_OPENMP) && !defined(__APPLE__)
+# define GHK_OMP 1
+# define GHK_OMP_USEC 500.0
+# define GHK_TIMED_OBS 4
+# define GHK2_OMP_MIN 59
+#endif
+
+#if defined(_OPENMP) && _OPENMP >= 201307
+# define GHK_SIMD _Pragma("omp simd")
+#else
+# define GHK_SIMD
+#endif
+
+static int omp_ghk_min;
+
+int set_omp_ghk_min (int n)
+{
+    if (n < -1) {
+	return E_DATA;
+    } else {
+	omp_ghk_min = n;
+	return 0;
+    }
+}
+
+int get_omp_ghk_min (void)
+{
+    return omp_ghk_min;
+}
+
+/* per-thread workspace for the GHK recursion */
+
+typedef struct ghk_work_ ghk_work;
+
+struct ghk_work_ {
+    gretl_matrix_block *B;
+    gretl_matrix *Ai;  /* lower bounds, m x 1 */
+    gretl_matrix *Bi;  /* upper bounds, m x 1 */
+    gretl_matrix *TA;  /* r x 1 */
+    gretl_matrix *TB;  /* r x 1 */
+    gretl_matrix *WT;  /* weights, r x 1 */
+    gretl_matrix *X;   /* conditional means, r x 1 */
+    gretl_matrix *TT;  /* truncated draws, r x m */
+};
+
+struct ghk_context_ {
+    int m;            /* dimension of the multivariate normal */
+    int r;            /* number of draws */
+    gretl_matrix *Ut; /* the draws, transposed to r x m */
+    ghk_work *w;      /* array of workspaces */
+    int nw;           /* number of workspaces */
+    double usec;      /* timed cost per observation, or < 0 */
+};
+
+static int ghk_work_init (ghk_work *w, int m, int r)
+{
+    w->B = gretl_matrix_block_new(&w->Ai, m, 1,
+				  &w->Bi, m, 1,
+				  &w->TA, r, 1,
+				  &w->TB, r, 1,
+				  &w->WT, r, 1,
+				  &w->X,  r, 1,
+				  &w->TT, r, m,
+				  NULL);
+    return (w->B == NULL)? E_ALLOC : 0;
+}
+
+static int ghk_context_add_work (ghk_context *g, int nw)
+{
+    ghk_work *w;
+    int i, err = 0;
+
+    if (nw <= g->nw) {
+	return 0;
+    }
+
+    w = realloc(g->w, nw * sizeof *w);
+    if (w == NULL) {
+	return E_ALLOC;
+    }
+
+    g->w = w;
+    for (i=g->nw; i<nw && !err; i++) {
+	err = ghk_work_init(&w[i], g->m, g->r);
+	if (!err) {
+	    g->nw += 1;
+	}
+    }
+
+    return err;
+}
+
+/**
+ * ghk_context_new:
+ * @m: dimension of the multivariate normal.
+ * @r: number of draws.
+ * @U: m x r matrix of uniform variates, or NULL.
+ * @err: location to receive error code.
+ *
+ * Creates a context for repeated GHK evaluations, for example
+ * within the likelihood of a multivariate probit model. The draws
+ * are fixed at creation, taken from @U if this is non-NULL or
+ * otherwise generated from the uniform distribution, so that
+ * successive evaluations at different parameter values use common
+ * random numbers; the workspace is also allocated once and reused.
+ *
+ * Returns: allocated context, or NULL on failure.
+ */
+
+ghk_context *ghk_context_new (int m, int r, const gretl_matrix *U,
+			      int *err)
+{
+    ghk_context *g;
+    int i, j;
+
+    if (m < 1 || r < 1) {
+	*err = E_INVARG;
+	return NULL;
+    } else if (U != NULL && (U->rows != m || U->cols != r)) {
+	*err = E_NONCONF;
+	return NULL;
+    }
+
+    g = malloc(sizeof *g);
+    if (g == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    g->m = m;
+    g->r = r;
+    g->w = NULL;
+    g->nw = 0;
+    g->usec = -1;
+
+    g->Ut = gretl_matrix_alloc(r, m);
+    if (g->Ut == NULL) {
+	*err = E_ALLOC;
+	free(g);
+	return NULL;
+    }
+
+    if (U != NULL) {
+	for (j=0; j<m; j++) {
+	    for (i=0; i<r; i++) {
+		gretl_matrix_set(g->Ut, i, j, gretl_matrix_get(U, j, i));
+	    }
+	}
+    } else {
+	gretl_rand_uniform(g->Ut->val, 0, r * m - 1);
+    }
+
+    *err = ghk_context_add_work(g, 1);
+    if (*err) {
+	ghk_context_destroy(g);
+	g = NULL;
+    }
+
+    return g;
+}
+
+/**
+ * ghk_context_destroy:
+ * @g: GHK context.
+ *
+ * Frees all storage associated with @g.
+ */
+
+void ghk_context_destroy (ghk_context *g)
+{
+    if (g != NULL) {
+	int i;
+
+	for (i=0; i<g->nw; i++) {
+	    gretl_matrix_block_destroy(g->w[i].B);
+	}
+	free(g->w);
+	gretl_matrix_free(g->Ut);
+	free(g);
+    }
+}
+
 /*
-  C  Lower triangular Cholesky factor of \Sigma, m x m
-  A  Lower bound of rectangle, m x 1
-  B  Upper bound of rectangle, m x 1
-  U  Random variates, m x r
+  C   Lower triangular Cholesky factor of \Sigma, m x m
+  A   Lower bound of rectangle, m x 1
+  B   Upper bound of rectangle, m x 1
+  Ut  Random variates, r x m
+
+  The draws are held in columns of length r, so that the
+  conditional means for variate j can be accumulated across all
+  the draws in contiguous, vectorizable loops.
 */
 
-static double GHK_1 (const gretl_matrix *C, 
-		     const gretl_matrix *A, 
-		     const gretl_matrix *B, 
-		     const gretl_matrix *U,
-		     gretl_matrix *TA,
-		     gretl_matrix *TB,
-		     gretl_matrix *WGT,
-		     gretl_matrix *TT,
+static double GHK_1 (const gretl_matrix *C,
+		     const gretl_matrix *A,
+		     const gretl_matrix *B,
+		     const gretl_matrix *Ut,
+		     ghk_work *w,
 		     double huge)
 {
-    int m = C->rows; /* Dimension of the multivariate normal */
-    int r = U->cols; /* Number of repetitions */
-    double P, den = gretl_matrix_get(C, 0, 0);
-    double ui, x, z, cjk, tki;
+    int m = C->rows;  /* Dimension of the multivariate normal */
+    int r = Ut->rows; /* Number of repetitions */
+    double *TA = w->TA->val;
+    double *TB = w->TB->val;
+    double *WT = w->WT->val;
+    double *X = w->X->val;
+    const double *u, *tk;
+    double *tj;
+    double P, cjk, ta, tb;
+    double den = gretl_matrix_get(C, 0, 0);
     int i, j, k;
 
-    z = A->val[0];
-    TA->val[0] = (z == -huge) ? 0 : ndtr(z / den);
-    z = B->val[0];
-    TB->val[0] = (z == huge) ? 1 : ndtr(z / den);
-    
-    for (i=1; i<r; i++) {
-	TA->val[i] = TA->val[0];
-	TB->val[i] = TB->val[0];
+    ta = (A->val[0] == -huge) ? 0 : ndtr(A->val[0] / den);
+    tb = (B->val[0] == huge) ? 1 : ndtr(B->val[0] / den);
+
+    GHK_SIMD
+    for (i=0; i<r; i++) {
+	TA[i] = ta;
+	TB[i] = tb;
+	WT[i] = tb - ta;
     }
 
-    /* form WGT = TB - TA */
-    vector_diff(WGT, TB, TA);
-    gretl_matrix_zero(TT);
+    gretl_matrix_zero(w->TT);
+    tj = w->TT->val;
+    u = Ut->val;
 
     for (i=0; i<r; i++) {
-	ui = gretl_matrix_get(U, 0, i);
-	x = TB->val[i] - ui * (TB->val[i] - TA->val[i]);
-	gretl_matrix_set(TT, 0, i, ndtri(x));
+	tj[i] = ndtri(TB[i] - u[i] * (TB[i] - TA[i]));
     }
 
     for (j=1; j<m; j++) {
 	den = gretl_matrix_get(C, j, j);
+	tj = w->TT->val + j * r;
+	u = Ut->val + j * r;
+
+	/* conditional means, accumulated over the draws */
+	cjk = gretl_matrix_get(C, j, 0);
+	tk = w->TT->val;
+	GHK_SIMD
+	for (i=0; i<r; i++) {
+	    X[i] = cjk * tk[i];
+	}
+	for (k=1; k<j; k++) {
+	    cjk = gretl_matrix_get(C, j, k);
+	    tk = w->TT->val + k * r;
+	    GHK_SIMD
+	    for (i=0; i<r; i++) {
+		X[i] += cjk * tk[i];
+	    }
+	}
 
 	for (i=0; i<r; i++) {
-	    if (WGT->val[i] == 0) {
-		/* If WGT[i] ever comes to be zero, it cannot in
+	    if (WT[i] == 0) {
+		/* If WT[i] ever comes to be zero, it cannot in
 		   principle be modified by the code below; in fact,
 		   however, running through the computations
 		   regardless may produce a NaN (since 0 * NaN = NaN).
@@ -510,61 +829,219 @@ static double GHK_1 (const gretl_matrix *C,
 		*/
 		continue;
 	    }
-	    x = 0.0;
-	    for (k=0; k<j; k++) {
-		cjk = gretl_matrix_get(C, j, k);
-		tki = gretl_matrix_get(TT, k, i);
-		x += cjk * tki;
-	    }
 
 	    if (A->val[j] == -huge) {
-		TA->val[i] = 0.0;
+		TA[i] = 0.0;
 	    } else {
-		TA->val[i] = ndtr((A->val[j] - x) / den);
+		TA[i] = ndtr((A->val[j] - X[i]) / den);
 	    }
 
 	    if (B->val[j] == huge) {
-		TB->val[i] = 1.0;
+		TB[i] = 1.0;
 	    } else {
-		TB->val[i] = ndtr((B->val[j] - x) / den);
+		TB[i] = ndtr((B->val[j] - X[i]) / den);
 	    }
 
 	    /* component j draw */
-	    ui = gretl_matrix_get(U, j, i);
-	    x = TB->val[i] - ui * (TB->val[i] - TA->val[i]);
-	    gretl_matrix_set(TT, j, i, ndtri(x));
+	    tj[i] = ndtri(TB[i] - u[i] * (TB[i] - TA[i]));
 	}
 
 	/* accumulate weight */
-	vector_subtract(TB, TA);
+	GHK_SIMD
 	for (i=0; i<r; i++) {
-	    WGT->val[i] *= TB->val[i];
+	    WT[i] *= TB[i] - TA[i];
 	}
     }
 
     P = 0.0;
     for (i=0; i<r; i++) {
-	P += WGT->val[i];
+	P += WT[i];
     }
     P /= r;
 
     if (P < 0.0 || P > 1.0) {
 	fprintf(stderr, "*** ghk error: P = %g\n", P);
 	P = 0.0/0.0; /* force a NaN */
-    }	
+    }
 
     return P;
 }
 
-/* Should we enable OMP for GHK calculations? And if so,
-   what's the threshold problem size that makes use of
-   OMP worthwhile?
+/* Check the bounds for observation @t and, if they're OK,
+   compute its probability in @P.
 */
-#if defined(_OPENMP) && !defined(__APPLE__)
-# define GHK_OMP 1
-# define OMP_GHK_MIN 59
+
+static int ghk_obs (const ghk_context *g,
+		    const gretl_matrix *C,
+		    const gretl_matrix *A,
+		    const gretl_matrix *B,
+		    ghk_work *w, int t,
+		    double *P, double huge)
+{
+    double *a = w->Ai->val;
+    double *b = w->Bi->val;
+    int j;
+
+    for (j=0; j<g->m; j++) {
+	a[j] = gretl_matrix_get(A, t, j);
+	b[j] = gretl_matrix_get(B, t, j);
+
+	if (isnan(a[j]) || isnan(b[j])) {
+	    /* If there are any NaNs in A or B, there's no
+	       point in continuing
+	    */
+	    *P = 0.0/0.0; /* NaN */
+	    return 0;
+	} else if (b[j] < a[j]) {
+	    gretl_errmsg_sprintf("ghk: inconsistent bounds: B[%d,%d] < A[%d,%d]",
+				 t+1, j+1, t+1, j+1);
+	    return E_DATA;
+	} else if (b[j] == a[j]) {
+	    *P = 0.0;
+	    return 0;
+	}
+    }
+
+    *P = GHK_1(C, w->Ai, w->Bi, g->Ut, w, huge);
+
+    return 0;
+}
+
+#ifdef GHK_OMP
+
+/* Decide whether the evaluation of observations @t0 to @n-1
+   should be shared among threads. In "auto" mode this may
+   involve computing the first few observations serially, in
+   which case @t0 is advanced.
+*/
+
+static int ghk_use_omp (ghk_context *g,
+			const gretl_matrix *C,
+			const gretl_matrix *A,
+			const gretl_matrix *B,
+			gretl_matrix *P, int *t0,
+			double huge, int *err)
+{
+    int n = A->rows;
+
+    if (n < 2 || omp_get_max_threads() < 2 || omp_ghk_min < 0) {
+	return 0;
+    } else if (omp_ghk_min > 0) {
+	double work = (double) n * g->m * g->m * g->r;
+
+	return work > omp_ghk_min;
+    }
+
+    if (g->usec < 0) {
+	gint64 start = g_get_monotonic_time();
+	int t, nt = n < GHK_TIMED_OBS ? n : GHK_TIMED_OBS;
+
+	for (t=0; t<nt && !*err; t++) {
+	    *err = ghk_obs(g, C, A, B, &g->w[0], t, &P->val[t], huge);
+	}
+	if (*err) {
+	    return 0;
+	}
+	g->usec = (g_get_monotonic_time() - start) / (double) nt;
+	*t0 = nt;
+    }
+
+    return (n - *t0) * g->usec > GHK_OMP_USEC;
+}
+
+#endif
+
+/**
+ * ghk_context_eval:
+ * @g: GHK context.
+ * @C: Cholesky decomposition of covariance matrix, lower triangular,
+ * m x m.
+ * @A: Lower bounds, n x m.
+ * @B: Upper bounds, n x m.
+ * @P: n x 1 vector to receive the probabilities.
+ *
+ * Computes the GHK approximation to the multivariate normal
+ * distribution function using the draws stored in @g; see
+ * gretl_GHK() for details.
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int ghk_context_eval (ghk_context *g,
+		      const gretl_matrix *C,
+		      const gretl_matrix *A,
+		      const gretl_matrix *B,
+		      gretl_matrix *P)
+{
+    double huge;
+    int use_omp = 0;
+    int t0 = 0;
+    int n, t;
+    int err = 0;
+
+    if (gretl_is_null_matrix(C) ||
+	gretl_is_null_matrix(A) ||
+	gretl_is_null_matrix(B)) {
+	return E_DATA;
+    } else if (C->rows != g->m || C->cols != g->m ||
+	       A->cols != g->m || B->cols != g->m ||
+	       B->rows != A->rows) {
+	return E_NONCONF;
+    } else if (gretl_vector_get_length(P) != A->rows) {
+	return E_NONCONF;
+    }
+
+    huge = libset_get_double(CONV_HUGE);
+    n = A->rows;
+
+    set_cephes_hush(1);
+
+#ifdef GHK_OMP
+    use_omp = ghk_use_omp(g, C, A, B, P, &t0, huge, &err);
+    if (use_omp) {
+	err = ghk_context_add_work(g, omp_get_max_threads());
+	if (err) {
+	    /* we'll manage with what we have */
+	    use_omp = g->nw > 1;
+	    err = 0;
+	}
+    }
+#endif
+
+    if (!use_omp) {
+	for (t=t0; t<n && !err; t++) {
+	    err = ghk_obs(g, C, A, B, &g->w[0], t, &P->val[t], huge);
+	}
+    }
+
+#ifdef GHK_OMP
+    if (use_omp) {
+	int nw = g->nw;
+
+#pragma omp parallel num_threads(nw) private(t)
+	{
+	    ghk_work *w = &g->w[omp_get_thread_num()];
+	    int ierr = 0;
+
+#pragma omp for
+	    for (t=t0; t<n; t++) {
+		if (!ierr) {
+		    ierr = ghk_obs(g, C, A, B, w, t, &P->val[t], huge);
+		}
+	    }
+	    if (ierr) {
+#pragma omp critical
+		err = ierr;
+	    }
+	} /* end parallel section */
+    }
 #endif
 
+    set_cephes_hush(0);
+
+    return err;
+}
+
 /**
  * gretl_GHK:
  * @C: Cholesky decomposition of covariance matrix, lower triangular,
@@ -588,111 +1065,32 @@ gretl_matrix *gretl_GHK (const gretl_matrix *C,
 			 const gretl_matrix *U,
 			 int *err)
 {
-#ifdef GHK_OMP
-    unsigned sz = 0;
-#endif
-    gretl_matrix_block *Bk = NULL;
+    ghk_context *g;
     gretl_matrix *P = NULL;
-    gretl_matrix *Ai, *Bi;
-    gretl_matrix *TA, *TB;
-    gretl_matrix *WT, *TT;
-    double huge;
-    int m, n, r;
-    int ierr, ghk_err = 0;
-    int ABok, pzero;
-    int i, j;
 
     *err = ghk_input_check(C, A, B, U, NULL);
     if (*err) {
 	return NULL;
     }
 
-    huge = libset_get_double(CONV_HUGE);
-
-    m = C->rows;
-    n = A->rows;
-    r = U->cols;
-
-    P = gretl_matrix_alloc(n, 1);
-    if (P == NULL) {
-	*err = E_ALLOC;
+    g = ghk_context_new(C->rows, U->cols, U, err);
+    if (*err) {
 	return NULL;
     }
 
-#ifdef GHK_OMP
-    if (n >= 2) {
-	sz = n * m * r;
-    }
-#endif
-
-    set_cephes_hush(1);
-
-#ifdef GHK_OMP
-#pragma omp parallel if (sz>OMP_GHK_MIN) private(i,j,Bk,Ai,Bi,TA,TB,WT,TT,ABok,pzero,ierr)
-#endif
-    {
-	Bk = gretl_matrix_block_new(&Ai, m, 1,
-				    &Bi, m, 1,
-				    &TA, 1, r,
-				    &TB, 1, r,
-				    &WT, 1, r,
-				    &TT, m, r,
-				    NULL);
-	if (Bk == NULL) {
-	    ierr = E_ALLOC;
-	    goto calc_end;
-	} else {
-	    ierr = 0;
-	}
-
-#ifdef GHK_OMP
-#pragma omp for
-#endif
-	for (i=0; i<n; i++) {
-	    ABok = 1; pzero = 0;
-
-	    for (j=0; j<m && !ierr; j++) {
-		Ai->val[j] = gretl_matrix_get(A, i, j);
-		Bi->val[j] = gretl_matrix_get(B, i, j);
-		ABok = !(isnan(Ai->val[j]) || isnan(Bi->val[j]));
-
-		if (!ABok) {
-		    /* If there are any NaNs in A or B, there's no
-		       point in continuing
-		    */
-		    P->val[i] = 0.0/0.0; /* NaN */
-		    break;
-		} else if (Bi->val[j] < Ai->val[j]) {
-		    gretl_errmsg_sprintf("ghk: inconsistent bounds: B[%d,%d] < A[%d,%d]",
-					 i+1, j+1, i+1, j+1);
-		    ierr = E_DATA;
-		} else if (Bi->val[j] == Ai->val[j]) {
-		    P->val[i] = 0.0;
-		    pzero = 1;
-		    break;
-		}
-	    }
-	    if (!ierr && !pzero && ABok) {
-		P->val[i] = GHK_1(C, Ai, Bi, U, TA, TB, WT, TT, huge);
-	    }
-	}
-
-    calc_end:
-	if (ierr) {
-	    ghk_err = ierr;
+    P = gretl_matrix_alloc(A->rows, 1);
+    if (P == NULL) {
+	*err = E_ALLOC;
+    } else {
+	*err = ghk_context_eval(g, C, A, B, P);
+	if (*err) {
+	    gretl_matrix_free(P);
+	    P = NULL;
 	}
-
-	gretl_matrix_block_destroy(Bk);
-    } /* end (possibly) parallel section */
-
-    set_cephes_hush(0);
-
-    if (ghk_err) {
-	*err = ghk_err;
-	gretl_matrix_free(P);
-	P = NULL;
     }
 
+    ghk_context_destroy(g);
+
     return P;
 }
 
@@ -1012,7 +1410,7 @@ gretl_matrix *gretl_GHK2 (const gretl_matrix *C,
 			  int *err)
 {
 #ifdef GHK_OMP
-    unsigned sz = 0;
+    int use_omp = 0;
 #endif
     gretl_matrix_block *Bk;
     gretl_matrix_block *Bk2;
@@ -1048,8 +1446,14 @@ gretl_matrix *gretl_GHK2 (const gretl_matrix *C,
     gretl_matrix_zero(dP);
 
 #ifdef GHK_OMP
-    if (n >= 2) {
-	sz = n * m * r;
+    if (n >= 2 && omp_ghk_min >= 0) {
+	double work = (double) n * m * r;
+
+	if (omp_ghk_min > 0) {
+	    use_omp = work * m > omp_ghk_min;
+	} else {
+	    use_omp = work > GHK2_OMP_MIN;
+	}
     }
 #endif
 
@@ -1057,7 +1461,7 @@ gretl_matrix *gretl_GHK2 (const gretl_matrix *C,
     set_cephes_hush(1);
 
 #ifdef GHK_OMP
-#pragma omp parallel if (sz>OMP_GHK_MIN) private(i,j,t,a,b,uj,Bk,Bk2,dpj)
+#pragma omp parallel if (use_omp) private(i,j,t,a,b,uj,Bk,Bk2,dpj)
 #endif
     {
 	Bk = gretl_matrix_block_new(&a, 1, m,
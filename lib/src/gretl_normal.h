@@ -22,8 +22,14 @@
 
 double invmills (double x);
 
+typedef struct ghk_context_ ghk_context;
+
 double bvnorm_cdf (double rho, double a, double b);
 
+void bvnorm_cdf_array (double rho, const double *a, int ainc,
+		       const double *b, int binc,
+		       double *P, int n);
+
 gretl_matrix *gretl_GHK (const gretl_matrix *C,
 			 const gretl_matrix *A,
 			 const gretl_matrix *B,
@@ -37,4 +43,19 @@ gretl_matrix *gretl_GHK2 (const gretl_matrix *C,
 			  gretl_matrix *dP,
 			  int *err);
 
+ghk_context *ghk_context_new (int m, int r, const gretl_matrix *U,
+			      int *err);
+
+int ghk_context_eval (ghk_context *g,
+		      const gretl_matrix *C,
+		      const gretl_matrix *A,
+		      const gretl_matrix *B,
+		      gretl_matrix *P);
+
+void ghk_context_destroy (ghk_context *g);
+
+int set_omp_ghk_min (int n);
+
+int get_omp_ghk_min (void);
+
 #endif /* GRETL_NORMAL_H */
@@ -28,6 +28,7 @@
 #include "uservar.h"
 #include "gretl_string_table.h"
 #include "matrix_extra.h" /* for testing */
+#include "gretl_mt.h"
 
 /**
  * SECTION:gretl_panel
@@ -67,6 +68,9 @@ struct panelmod_t_ {
     int NT;               /* total observations used (based on pooled model) */
     int ntdum;            /* number of time dummies added */
     int *unit_obs;        /* array of number of observations per x-sect unit */
+    int *obsidx;          /* indices of usable observations, grouped by unit */
+    int *ustart;          /* offset of each unit's block in @obsidx */
+    gretl_matrix *usums;  /* per-unit sums of the pooled-model series */
     char *varying;        /* array to record properties of pooled-model regressors */
     int *vlist;           /* list of time-varying variables from pooled model */
     int balanced;         /* 1 if the model dataset is balanced, else 0 */
@@ -91,6 +95,8 @@ struct panelmod_t_ {
     MODEL *pooled;        /* reference model (pooled OLS) */
     MODEL *realmod;       /* fixed or random effects model */
     double *re_uhat;      /* "fixed" random-effects residuals */
+    int *alist;           /* list of absorbed factors, if any */
+    int adf;              /* degrees of freedom taken by @alist */
 };
 
 struct {
@@ -155,6 +161,60 @@ static int allocate_data_finders (panelmod_t *pan, int bign)
     return 0;
 }
 
+/* Compute, for each series in the pooled-model list, its sum over
+   the usable observations for each included unit. This is done
+   just once per model: the group means, within-groups and
+   quasi-demeaned datasets all take their unit means from here.
+*/
+
+static int panel_unit_sums (panelmod_t *pan, const DATASET *dset)
+{
+    const int *list = pan->pooled->list;
+    int j, nv = list[0];
+
+    if (pan->usums != NULL) {
+        /* already done */
+        return 0;
+    }
+
+    pan->usums = gretl_matrix_alloc(pan->effn, nv);
+    if (pan->usums == NULL) {
+        return E_ALLOC;
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) pan->NT * nv))
+#endif
+    for (j=0; j<nv; j++) {
+        const double *x = (list[j+1] == 0)? NULL : dset->Z[list[j+1]];
+        double *sj = pan->usums->val + (size_t) j * pan->effn;
+        int i, r, u = 0;
+
+        for (i=0; i<pan->nunits; i++) {
+            if (pan->unit_obs[i] == 0) {
+                continue;
+            }
+            sj[u] = 0.0;
+            for (r=pan->ustart[i]; r<pan->ustart[i+1]; r++) {
+                sj[u] += (x == NULL)? 1.0 : x[pan->obsidx[r]];
+            }
+            u++;
+        }
+    }
+
+    return 0;
+}
+
+/* Get the column of per-unit sums for series @v, which must be in
+   the pooled-model list */
+
+static const double *unit_sums (const panelmod_t *pan, int v)
+{
+    int pos = in_gretl_list(pan->pooled->list, v);
+
+    return pan->usums->val + (size_t) (pos - 1) * pan->effn;
+}
+
 #define small_index(p,t) ((p->big2small == NULL)? t : p->big2small[t])
 #define big_index(p,t)   ((p->small2big == NULL)? t : p->small2big[t])
 
@@ -169,6 +229,9 @@ static void panelmod_init (panelmod_t *pan)
     pan->NT = 0;
     pan->ntdum = 0;
     pan->unit_obs = NULL;
+    pan->obsidx = NULL;
+    pan->ustart = NULL;
+    pan->usums = NULL;
     pan->varying = NULL;
     pan->vlist = NULL;
     pan->opt = OPT_NONE;
@@ -197,11 +260,17 @@ static void panelmod_init (panelmod_t *pan)
     pan->pooled = NULL;
     pan->realmod = NULL;
     pan->re_uhat = NULL;
+
+    pan->alist = NULL;
+    pan->adf = 0;
 }
 
 static void panelmod_free (panelmod_t *pan)
 {
     free(pan->unit_obs);
+    free(pan->obsidx);
+    free(pan->ustart);
+    gretl_matrix_free(pan->usums);
     free(pan->varying);
     free(pan->vlist);
 
@@ -211,6 +280,7 @@ static void panelmod_free (panelmod_t *pan)
     free(pan->small2big);
     free(pan->big2small);
     free(pan->re_uhat);
+    free(pan->alist);
 
     free(pan->realmod);
 }
@@ -433,38 +503,234 @@ beck_katz_vcv (MODEL *pmod, panelmod_t *pan, const DATASET *dset,
     return err;
 }
 
-/* helper function for panel VCV clustered by period */
+/* Machinery for the cluster-robust "filling" W = sum_c g_c g_c',
+   where g_c is the score sum_{i in c} x_i e_i for cluster c. The
+   usable observations are recorded along with their cluster codes
+   and put into cluster order by a counting sort. The scores for a
+   block of clusters are then formed in parallel, one cluster per
+   row, and folded into W by a single rank-k update; so the data are
+   visited just once and the k x k work is done at BLAS-3 speed.
+*/
+
+#define CLUSTER_BLOCK_BYTES (1 << 21)
+
+typedef struct cluster_obs_ cluster_obs;
+
+struct cluster_obs_ {
+    int n;        /* number of observations recorded */
+    int M;        /* number of cluster codes */
+    int *srow;    /* data row per obs, or -1 for zero regressors */
+    int *cid;     /* cluster code per obs */
+    double *e;    /* residual per obs */
+};
+
+static int cluster_obs_init (cluster_obs *co, int nmax, int M)
+{
+    co->n = 0;
+    co->M = M;
+    co->srow = malloc(nmax * sizeof *co->srow);
+    co->cid = malloc(nmax * sizeof *co->cid);
+    co->e = malloc(nmax * sizeof *co->e);
+
+    if (co->srow == NULL || co->cid == NULL || co->e == NULL) {
+        return E_ALLOC;
+    }
+
+    return 0;
+}
+
+static void cluster_obs_free (cluster_obs *co)
+{
+    free(co->srow);
+    free(co->cid);
+    free(co->e);
+}
+
+static void cluster_obs_add (cluster_obs *co, int srow, int cid,
+                             double e)
+{
+    co->srow[co->n] = srow;
+    co->cid[co->n] = cid;
+    co->e[co->n] = e;
+    co->n += 1;
+}
+
+/* Record the usable observations on a panel model in unit-major
+   order, with cluster codes given by the period if @by_time is
+   non-zero, otherwise by the index of the (included) unit.
+*/
 
-static int *get_panel_tobs (panelmod_t *pan)
+static int panel_cluster_obs (MODEL *pmod, panelmod_t *pan,
+                              cluster_obs *co, int by_time)
 {
-    int *tobs = calloc(pan->T, sizeof *tobs);
+    int i, t, s, c = 0;
+    int err;
 
-    if (tobs != NULL) {
-        int i, t;
+    err = cluster_obs_init(co, pan->NT, by_time ? pan->T : pan->effn);
+    if (err) {
+        return err;
+    }
 
-        for (i=0; i<pan->nunits; i++) {
-            for (t=0; t<pan->T; t++) {
-                if (!panel_missing(pan, panel_index(i, t))) {
-                    tobs[t] += 1;
+    for (i=0; i<pan->nunits; i++) {
+        if (pan->unit_obs[i] == 0) {
+            continue;
+        }
+        for (t=0; t<pan->T; t++) {
+            s = panel_index(i, t);
+            if (!na(pmod->uhat[s])) {
+                cluster_obs_add(co, small_index(pan, s),
+                                by_time ? t : c, pmod->uhat[s]);
+            }
+        }
+        c++;
+    }
+
+    return 0;
+}
+
+/* Fill row r of @G, for r = 0 to G->rows - 1, with the score for
+   cluster c0 + r, given the observations in cluster order via
+   @order and the cluster start positions in @start.
+*/
+
+static void fill_cluster_scores (gretl_matrix *G, int c0,
+                                 const cluster_obs *co,
+                                 const int *start,
+                                 const int *order,
+                                 const MODEL *pmod,
+                                 const DATASET *dset)
+{
+    int mb = G->rows;
+    int k = G->cols;
+    int r;
+
+#if defined(_OPENMP)
+    guint64 fpm = (guint64) (start[c0+mb] - start[c0]) * k;
+#pragma omp parallel for if (mb > 1 && gretl_use_openmp(fpm))
+#endif
+    for (r=0; r<mb; r++) {
+        int c = c0 + r;
+        const double *x;
+        double g;
+        int j, o, p;
+
+        for (j=0; j<k; j++) {
+            x = dset->Z[pmod->list[j+2]];
+            g = 0.0;
+            for (p=start[c]; p<start[c+1]; p++) {
+                o = order[p];
+                if (co->srow[o] >= 0) {
+                    g += x[co->srow[o]] * co->e[o];
                 }
             }
+            gretl_matrix_set(G, r, j, g);
+        }
+    }
+}
+
+/* Put the observations recorded in @co into cluster order; on
+   return @start holds co->M + 1 offsets into @order. Returns the
+   number of non-empty clusters.
+*/
+
+static int cluster_obs_order (const cluster_obs *co, int *start,
+                              int *order)
+{
+    int c, p, n_c = 0;
+
+    for (c=0; c<=co->M; c++) {
+        start[c] = 0;
+    }
+    for (p=0; p<co->n; p++) {
+        start[co->cid[p] + 1] += 1;
+    }
+    for (c=0; c<co->M; c++) {
+        if (start[c+1] > 0) {
+            n_c++;
         }
+        start[c+1] += start[c];
+    }
+    for (p=0; p<co->n; p++) {
+        order[start[co->cid[p]]++] = p;
     }
+    /* shift the offsets back into place */
+    for (c=co->M; c>0; c--) {
+        start[c] = start[c-1];
+    }
+    start[0] = 0;
 
-    return tobs;
+    return n_c;
 }
 
-static void augment_clustered_W (const gretl_matrix *e,
-                                 const gretl_matrix *X,
-                                 gretl_matrix *eX,
-                                 gretl_matrix *W)
+/* Cumulate into @W the clustered outer product of scores for the
+   observations in @co; the number of non-empty clusters is written
+   to @n_c.
+*/
+
+static int cluster_scores_W (const cluster_obs *co,
+                             const MODEL *pmod,
+                             const DATASET *dset,
+                             gretl_matrix *W,
+                             int *n_c)
 {
-    gretl_matrix_multiply_mod(e, GRETL_MOD_TRANSPOSE,
-                              X, GRETL_MOD_NONE,
-                              eX, GRETL_MOD_NONE);
-    gretl_matrix_multiply_mod(eX, GRETL_MOD_TRANSPOSE,
-                              eX, GRETL_MOD_NONE,
-                              W, GRETL_MOD_CUMULATE);
+    gretl_matrix *G = NULL;
+    int *start, *order;
+    int k = pmod->ncoeff;
+    int c0, mb, B;
+    int err = 0;
+
+    start = malloc((co->M + 1) * sizeof *start);
+    order = malloc((co->n + 1) * sizeof *order);
+    B = CLUSTER_BLOCK_BYTES / (k * sizeof(double));
+    B = MIN(co->M, MAX(B, 16));
+    G = gretl_matrix_alloc(B, k);
+
+    if (start == NULL || order == NULL || G == NULL) {
+        err = E_ALLOC;
+        goto bailout;
+    }
+
+    *n_c = cluster_obs_order(co, start, order);
+
+    for (c0=0; c0<co->M; c0+=B) {
+        mb = MIN(B, co->M - c0);
+        G = gretl_matrix_reuse(G, mb, k);
+        fill_cluster_scores(G, c0, co, start, order, pmod, dset);
+        gretl_matrix_multiply_mod(G, GRETL_MOD_TRANSPOSE,
+                                  G, GRETL_MOD_NONE,
+                                  W, GRETL_MOD_CUMULATE);
+    }
+
+ bailout:
+
+    free(start);
+    free(order);
+    gretl_matrix_free(G);
+
+    return err;
+}
+
+/* Find the position of @x in the sorted vector of distinct cluster
+   values @cvals, or -1 if it's not present.
+*/
+
+static int cluster_code (const gretl_matrix *cvals, double x)
+{
+    int lo = 0, hi = gretl_vector_get_length(cvals) - 1;
+    int mid;
+
+    while (lo <= hi) {
+        mid = (lo + hi) / 2;
+        if (cvals->val[mid] < x) {
+            lo = mid + 1;
+        } else if (cvals->val[mid] > x) {
+            hi = mid - 1;
+        } else {
+            return mid;
+        }
+    }
+
+    return -1;
 }
 
 static void finalize_clustered_vcv (MODEL *pmod,
@@ -569,65 +835,19 @@ time_cluster_vcv (MODEL *pmod, panelmod_t *pan, const DATASET *dset,
                   const gretl_matrix *XX, gretl_matrix *W,
                   gretl_matrix *V, cluster_info *ci)
 {
-    gretl_vector *et = NULL;
-    gretl_matrix *Xt = NULL;
-    gretl_vector *eXt = NULL;
-    int *tobs = NULL;
-    int N = pan->effn;
-    int k = pmod->ncoeff;
+    cluster_obs co = {0};
     int idx = ci->target;
-    int i, j, v, s, t;
     int n_c = 0;
-    int err = 0;
-
-    tobs = get_panel_tobs(pan);
-    if (tobs == NULL) {
-        return E_ALLOC;
-    }
-
-    et  = gretl_column_vector_alloc(N);
-    Xt  = gretl_matrix_alloc(N, k);
-    eXt = gretl_vector_alloc(k);
+    int err;
 
-    if (et == NULL || Xt == NULL || eXt == NULL) {
-        err = E_ALLOC;
-        goto bailout;
+    err = panel_cluster_obs(pmod, pan, &co, 1);
+    if (!err) {
+        err = cluster_scores_W(&co, pmod, dset, W, &n_c);
     }
+    cluster_obs_free(&co);
 
-    for (t=0; t<pan->T; t++) {
-        int Nt = tobs[t]; /* # of units represented in period @t */
-        int p = 0;
-
-        if (Nt == 0) {
-            continue;
-        }
-
-        n_c++;
-        et = gretl_matrix_reuse(et, Nt, 1);
-        Xt = gretl_matrix_reuse(Xt, Nt, k);
-
-        for (i=0; i<pan->nunits; i++) {
-            s = panel_index(i, t);
-            if (na(pmod->uhat[s])) {
-                continue;
-            }
-            gretl_vector_set(et, p, pmod->uhat[s]);
-            s = small_index(pan, s);
-            for (j=0; j<k; j++) {
-                v = pmod->list[j+2];
-                if (s < 0) {
-                    gretl_matrix_set(Xt, p, j, 0);
-                } else {
-                    gretl_matrix_set(Xt, p, j, dset->Z[v][s]);
-                }
-            }
-            p++;
-            if (p == Nt) {
-                /* we're done with this period */
-                break;
-            }
-        }
-        augment_clustered_W(et, Xt, eXt, W);
+    if (err) {
+        return err;
     }
 
     finalize_clustered_vcv(pmod, pan, XX, W, V, pan->Tmax);
@@ -639,59 +859,7 @@ time_cluster_vcv (MODEL *pmod, panelmod_t *pan, const DATASET *dset,
 	ci->nc[idx] = n_c;
     }
 
- bailout:
-
-    gretl_matrix_free(et);
-    gretl_matrix_free(Xt);
-    gretl_matrix_free(eXt);
-    free(tobs);
-
-    return err;
-}
-
-static int panel_cval_count (MODEL *pmod, panelmod_t *pan,
-                             cluster_info *ci, int i,
-			     const double *cvar)
-{
-    double cvi = ci->cvals->val[i];
-    int s, t, cc = 0;
-
-    if (cvar != NULL) {
-	/* the pooled OLS case */
-	for (t=pmod->t1; t<=pmod->t2; t++) {
-	    if (!na(pmod->uhat[t]) && cvar[t] == cvi) {
-		cc++;
-	    }
-	}
-    } else {
-	/* other cases */
-	for (s=0; s<pmod->nobs; s++) {
-	    t = big_index(pan, s);
-	    if (!na(pmod->uhat[t]) && ci->cz[s] == cvi) {
-		cc++;
-	    }
-	}
-    }
-
-    return cc;
-}
-
-static int panel_cval_count_max (MODEL *pmod,
-                                 panelmod_t *pan,
-                                 cluster_info *ci,
-				 const double *cvar)
-{
-    int n = gretl_vector_get_length(ci->cvals);
-    int i, cc, cmax = 0;
-
-    for (i=0; i<n; i++) {
-        cc = panel_cval_count(pmod, pan, ci, i, cvar);
-        if (cc > cmax) {
-            cmax = cc;
-        }
-    }
-
-    return cmax;
+    return 0;
 }
 
 static int
@@ -699,83 +867,51 @@ generic_cluster_vcv (MODEL *pmod, panelmod_t *pan, const DATASET *dset,
                      const gretl_matrix *XX, gretl_matrix *W,
                      gretl_matrix *V, cluster_info *ci)
 {
-    const double *cvar = NULL;
-    gretl_vector *ei = NULL;
-    gretl_matrix *Xi = NULL;
-    gretl_vector *eXi = NULL;
-    int R, M = ci->cvals->rows;
-    int k = pmod->ncoeff;
+    cluster_obs co = {0};
+    int M = gretl_vector_get_length(ci->cvals);
     int idx = ci->target;
-    int i, j, v, t;
+    int c, s, t;
     int n_c = 0;
     int err = 0;
 
     if (ci->pooled) {
-	cvar = dset->Z[ci->dcid[idx]];
+	/* working with the full dataset */
+	const double *cvar = dset->Z[ci->dcid[idx]];
+
+	err = cluster_obs_init(&co, pmod->t2 - pmod->t1 + 1, M);
+	for (t=pmod->t1; t<=pmod->t2 && !err; t++) {
+	    if (!na(pmod->uhat[t])) {
+		c = cluster_code(ci->cvals, cvar[t]);
+		if (c >= 0) {
+		    cluster_obs_add(&co, t, c, pmod->uhat[t]);
+		}
+	    }
+	}
+    } else {
+	/* working with dataset from which NAs have been purged */
+	err = cluster_obs_init(&co, pmod->nobs, M);
+	for (s=0; s<pmod->nobs && !err; s++) {
+	    t = big_index(pan, s);
+	    if (!na(pmod->uhat[t])) {
+		c = cluster_code(ci->cvals, ci->cz[s]);
+		if (c >= 0) {
+		    cluster_obs_add(&co, s, c, pmod->uhat[t]);
+		}
+	    }
+	}
     }
 
-    R = panel_cval_count_max(pmod, pan, ci, cvar);
 #if CDEBUG
-    fprintf(stderr, "generic_cluster_vcv: M=%d, R=%d\n", M, R);
+    fprintf(stderr, "generic_cluster_vcv: M=%d, n=%d\n", M, co.n);
 #endif
-    ei  = gretl_column_vector_alloc(R);
-    Xi  = gretl_matrix_alloc(R, k);
-    eXi = gretl_vector_alloc(k);
 
-    if (ei == NULL || Xi == NULL || eXi == NULL) {
-        err = E_ALLOC;
-        goto bailout;
+    if (!err) {
+	err = cluster_scores_W(&co, pmod, dset, W, &n_c);
     }
+    cluster_obs_free(&co);
 
-    for (i=0; i<M; i++) {
-        double cvi = ci->cvals->val[i];
-        int Ni = panel_cval_count(pmod, pan, ci, i, cvar);
-        int s, p = 0;
-
-#if CDEBUG > 1
-        fprintf(stderr, "cvals[%d]=%g, count=%d\n", i, cvi, Ni);
-#endif
-        if (Ni == 0) {
-            continue;
-        }
-
-        ei = gretl_matrix_reuse(ei, Ni, -1);
-        Xi = gretl_matrix_reuse(Xi, Ni, -1);
-
-	if (ci->pooled) {
-	    /* working with the full dataset */
-	    for (t=pmod->t1; t<=pmod->t2; t++) {
-		if (!na(pmod->uhat[t]) && cvar[t] == cvi) {
-		    gretl_vector_set(ei, p, pmod->uhat[t]);
-		    for (j=0; j<k; j++) {
-			v = pmod->list[j+2];
-			gretl_matrix_set(Xi, p, j, dset->Z[v][t]);
-		    }
-		    p++;
-		}
-		if (p == Ni) {
-		    break;
-		}
-	    }
-	} else {
-	    /* working with dataset from which NAs have been purged */
-	    for (s=0; s<pmod->nobs; s++) {
-		t = big_index(pan, s);
-		if (!na(pmod->uhat[t]) && ci->cz[s] == cvi) {
-		    gretl_vector_set(ei, p, pmod->uhat[t]);
-		    for (j=0; j<k; j++) {
-			v = pmod->list[j+2];
-			gretl_matrix_set(Xi, p, j, dset->Z[v][s]);
-		    }
-		    p++;
-		}
-		if (p == Ni) {
-		    break;
-		}
-	    }
-	}
-        augment_clustered_W(ei, Xi, eXi, W);
-        n_c++;
+    if (err) {
+	return err;
     }
 
     finalize_clustered_vcv(pmod, pan, XX, W, V, n_c);
@@ -790,13 +926,7 @@ generic_cluster_vcv (MODEL *pmod, panelmod_t *pan, const DATASET *dset,
 	ci->nc[idx] = n_c;
     }
 
- bailout:
-
-    gretl_matrix_free(ei);
-    gretl_matrix_free(Xi);
-    gretl_matrix_free(eXi);
-
-    return err;
+    return 0;
 }
 
 static int
@@ -804,49 +934,36 @@ panel_white_vcv (MODEL *pmod, panelmod_t *pan, const DATASET *dset,
 		 const gretl_matrix *XX, gretl_matrix *W,
 		 gretl_matrix *V, cluster_info *ci)
 {
-    gretl_vector *ei = NULL;
-    gretl_matrix *Xi = NULL;
-    gretl_vector *eXi = NULL;
-    int k = pmod->ncoeff;
-    int i, v, s, t;
+    cluster_obs co = {0};
+    int s, t;
     int n_c = 0;
-    int err = 0;
-
-    ei  = gretl_column_vector_alloc(1);
-    Xi  = gretl_matrix_alloc(1, k);
-    eXi = gretl_vector_alloc(k);
-
-    if (ei == NULL || Xi == NULL || eXi == NULL) {
-        err = E_ALLOC;
-        goto bailout;
-    }
+    int err;
 
-    for (s=0; s<pmod->nobs; s++) {
+    /* each observation is its own cluster */
+    err = cluster_obs_init(&co, pmod->nobs, pmod->nobs);
+    for (s=0; s<pmod->nobs && !err; s++) {
 	t = big_index(pan, s);
 	if (!na(pmod->uhat[t])) {
-	    ei->val[0] = pmod->uhat[t];
-	    for (i=0; i<k; i++) {
-		v = pmod->list[i+2];
-		gretl_vector_set(Xi, i, dset->Z[v][s]);
-	    }
-	    augment_clustered_W(ei, Xi, eXi, W);
-	    n_c++;
+	    cluster_obs_add(&co, s, co.n, pmod->uhat[t]);
 	}
     }
 
+    if (!err) {
+	err = cluster_scores_W(&co, pmod, dset, W, &n_c);
+    }
+    cluster_obs_free(&co);
+
+    if (err) {
+	return err;
+    }
+
     finalize_clustered_vcv(pmod, pan, XX, W, V, n_c);
     if (!two_way(ci)) {
 	/* should we offer "plain White" (HC0) as an option? */
 	gretl_model_set_vcv_info(pmod, VCV_HC, 0);
     }
 
- bailout:
-
-    gretl_matrix_free(ei);
-    gretl_matrix_free(Xi);
-    gretl_matrix_free(eXi);
-
-    return err;
+    return 0;
 }
 
 /* HAC covariance matrix for pooled, fixed- or random-effects models,
@@ -860,56 +977,19 @@ unit_cluster_vcv (MODEL *pmod, panelmod_t *pan, const DATASET *dset,
 		  const gretl_matrix *XX, gretl_matrix *W,
 		  gretl_matrix *V, cluster_info *ci)
 {
-    gretl_vector *ei = NULL;
-    gretl_matrix *Xi = NULL;
-    gretl_vector *eXi = NULL;
-    int T = pan->Tmax;
-    int k = pmod->ncoeff;
+    cluster_obs co = {0};
     int idx = ci->target;
-    int i, j, v, s, t;
-    int err = 0;
-
-    ei  = gretl_column_vector_alloc(T);
-    Xi  = gretl_matrix_alloc(T, k);
-    eXi = gretl_vector_alloc(k);
+    int n_c = 0;
+    int err;
 
-    if (ei == NULL || Xi == NULL || eXi == NULL) {
-        err = E_ALLOC;
-        goto bailout;
+    err = panel_cluster_obs(pmod, pan, &co, 0);
+    if (!err) {
+        err = cluster_scores_W(&co, pmod, dset, W, &n_c);
     }
+    cluster_obs_free(&co);
 
-    for (i=0; i<pan->nunits; i++) {
-        int Ti = pan->unit_obs[i];
-        int p = 0;
-
-        if (Ti == 0) {
-            continue;
-        }
-
-        ei = gretl_matrix_reuse(ei, Ti, 1);
-        Xi = gretl_matrix_reuse(Xi, Ti, k);
-
-        for (t=0; t<pan->T; t++) {
-            s = panel_index(i, t);
-            if (na(pmod->uhat[s])) {
-                continue;
-            }
-            gretl_vector_set(ei, p, pmod->uhat[s]);
-            s = small_index(pan, s);
-            for (j=0; j<k; j++) {
-                v = pmod->list[j+2];
-                if (s < 0) {
-                    gretl_matrix_set(Xi, p, j, 0);
-                } else {
-                    gretl_matrix_set(Xi, p, j, dset->Z[v][s]);
-                }
-            }
-            if (++p == Ti) {
-                /* we're done with this unit */
-                break;
-            }
-        }
-        augment_clustered_W(ei, Xi, eXi, W);
+    if (err) {
+        return err;
     }
 
     finalize_clustered_vcv(pmod, pan, XX, W, V, pan->effn);
@@ -922,13 +1002,7 @@ unit_cluster_vcv (MODEL *pmod, panelmod_t *pan, const DATASET *dset,
 	ci->nc[idx] = pan->effn;
     }
 
- bailout:
-
-    gretl_matrix_free(ei);
-    gretl_matrix_free(Xi);
-    gretl_matrix_free(eXi);
-
-    return err;
+    return 0;
 }
 
 /* In response to "$time" or "$unit" appearing in the context of the
@@ -1419,95 +1493,62 @@ driscoll_kraay_vcv (MODEL *pmod, panelmod_t *pan, const DATASET *dset,
 {
     gretl_matrix_block *B;
     gretl_matrix *H = NULL;
-    gretl_matrix *ht = NULL;
-    gretl_matrix *htj = NULL;
     gretl_matrix *Wj = NULL;
     gretl_matrix *S = NULL;
+    cluster_obs co = {0};
+    int *start = NULL;
+    int *order = NULL;
     double bw; /* Bartlett weight */
-    int *tobs = NULL;
-    int k = pmod->ncoeff;
-    int i, j, m, vj, s, t;
+    double one = 1.0, zero = 0.0;
+    integer T = pan->T;
+    integer k = pmod->ncoeff;
+    integer mj;
+    int j, m;
     int n_c = 0;
     int err = 0;
 
-    tobs = get_panel_tobs(pan);
-    if (tobs == NULL) {
-        return E_ALLOC;
-    }
-
     B = gretl_matrix_block_new(&H, pan->T, k,
 			       &S, k, k,
-			       &ht, k, 1,
-			       &htj, k, 1,
 			       &Wj, k, k,
 			       NULL);
     if (B == NULL) {
-	free(tobs);
 	return E_ALLOC;
     }
 
-    gretl_matrix_zero(H);
-    gretl_matrix_zero(S);
+    err = panel_cluster_obs(pmod, pan, &co, 1);
+    if (!err) {
+	start = malloc((co.M + 1) * sizeof *start);
+	order = malloc((co.n + 1) * sizeof *order);
+	if (start == NULL || order == NULL) {
+	    err = E_ALLOC;
+	}
+    }
+    if (err) {
+	goto bailout;
+    }
 
     /* Maximum lag for Newey-West. Note: do "set hac_lag nw2"
        for agreement with Stata's xtscc */
     m = get_hac_lag(pan->Tmax);
 
-    /* build the H matrix */
-    for (t=0; t<pan->T; t++) {
-        int Nt = tobs[t]; /* # of units represented in period @t */
-        double eit, htj, hplus;
-        int p = 0;
-
-        if (Nt == 0) {
-            continue;
-        }
-	n_c++;
-        for (i=0; i<pan->nunits; i++) {
-            s = panel_index(i, t);
-            eit = pmod->uhat[s];
-            if (na(eit)) {
-                continue;
-            }
-            s = small_index(pan, s);
-            if (s >= 0) {
-                for (j=0; j<k; j++) {
-                    /* cumulate xit*eit into row @t of @H */
-                    vj = pmod->list[j+2];
-                    hplus = dset->Z[vj][s] * eit;
-                    htj = gretl_matrix_get(H, t, j);
-                    gretl_matrix_set(H, t, j, htj + hplus);
-                }
-            }
-            if (++p == Nt) {
-                /* we're done with this period */
-                break;
-            }
-        }
-    }
+    /* build the H matrix, whose row @t is the sum of the scores
+       x_it * e_it over the units observed in period @t
+    */
+    n_c = cluster_obs_order(&co, start, order);
+    fill_cluster_scores(H, 0, &co, start, order, pmod, dset);
 
     /* compute initial @S = Omega_0 */
-    for (t=0; t<pan->T; t++) {
-        for (i=0; i<k; i++) {
-            ht->val[i] = gretl_matrix_get(H, t, i);
-        }
-        gretl_matrix_multiply_mod(ht, GRETL_MOD_NONE,
-                                  ht, GRETL_MOD_TRANSPOSE,
-                                  S, GRETL_MOD_CUMULATE);
-    }
+    gretl_matrix_multiply_mod(H, GRETL_MOD_TRANSPOSE,
+			      H, GRETL_MOD_NONE,
+			      S, GRETL_MOD_NONE);
 
-    /* cumulate the weighted cross-lag terms */
-    for (j=1; j<=m; j++) {
-        gretl_matrix_zero(Wj);
-        for (t=j; t<pan->T; t++) {
-            for (i=0; i<k; i++) {
-                ht->val[i] = gretl_matrix_get(H, t, i);
-                htj->val[i] = gretl_matrix_get(H, t-j, i);
-            }
-            gretl_matrix_multiply_mod(ht, GRETL_MOD_NONE,
-                                      htj, GRETL_MOD_TRANSPOSE,
-                                      Wj, GRETL_MOD_CUMULATE);
-        }
+    /* cumulate the weighted cross-lag terms, each one formed as
+       H[j:T]' H[0:T-j] on row-offset views of @H
+    */
+    for (j=1; j<=m && j<T; j++) {
+	mj = T - j;
+	dgemm_("T", "N", &k, &k, &mj, &one, H->val + j, &T,
+	       H->val, &T, &zero, Wj->val, &k);
         /* add Barlett weight * (Wj + Wj') to @S */
         bw = 1.0 - j / (m + 1.0);
         gretl_matrix_add_self_transpose(Wj);
@@ -1520,8 +1561,12 @@ driscoll_kraay_vcv (MODEL *pmod, panelmod_t *pan, const DATASET *dset,
     gretl_model_set_hac_order(pmod, m);
     gretl_model_set_int(pmod, "DKT", n_c);
 
+ bailout:
+
     gretl_matrix_block_destroy(B);
-    free(tobs);
+    cluster_obs_free(&co);
+    free(start);
+    free(order);
 
     return err;
 }
@@ -1864,195 +1909,565 @@ static void panel_dwstat (MODEL *pmod, panelmod_t *pan)
         }
     }
 
-    if (dwnum > 0.0) {
-        pmod->dw = dwnum / pmod->ess;
-    }
-    if (na(pmod->rho) && rden > 0.0 && !na(rden)) {
-        pmod->rho = rnum / rden;
-    }
-    if (!na(pmod->rho) && (pmod->rho <= -1.0 || pmod->rho >= 1.0)) {
-        pmod->rho = NADBL;
+    if (dwnum > 0.0) {
+        pmod->dw = dwnum / pmod->ess;
+    }
+    if (na(pmod->rho) && rden > 0.0 && !na(rden)) {
+        pmod->rho = rnum / rden;
+    }
+    if (!na(pmod->rho) && (pmod->rho <= -1.0 || pmod->rho >= 1.0)) {
+        pmod->rho = NADBL;
+    }
+
+    if (pan->opt & OPT_U) {
+        /* make these stats available for random effects reporting */
+        pan->dw = pmod->dw;
+        pan->rho = pmod->rho;
+    }
+}
+
+/* Allocate the arrays needed to perform the Hausman test,
+   in its matrix formulation.
+*/
+
+static int matrix_hausman_allocate (panelmod_t *pan)
+{
+    int k = pan->vlist[0] - 2;
+    int err = 0;
+
+    /* array to hold differences between coefficient estimates */
+    pan->bdiff = gretl_vector_alloc(k);
+    if (pan->bdiff == NULL) {
+        err = E_ALLOC;
+    } else {
+        /* array to hold covariance matrix */
+        pan->Sigma = gretl_matrix_alloc(k, k);
+        if (pan->Sigma == NULL) {
+            gretl_matrix_free(pan->bdiff);
+            pan->bdiff = NULL;
+            err = E_ALLOC;
+        }
+    }
+
+    if (!err) {
+        pan->dfH = k;
+    }
+
+    return err;
+}
+
+static int *real_varying_list (panelmod_t *pan)
+{
+    int *vlist = gretl_list_copy(pan->vlist);
+    int i;
+
+    if (vlist != NULL) {
+        for (i=2; i<=vlist[0]; i++) {
+            if (vlist[i] == 0) {
+                gretl_list_delete_at_pos(vlist, i);
+                break;
+            }
+        }
+    }
+
+    return vlist;
+}
+
+/* Construct a version of the dataset from which the group means are
+   subtracted, for the "within" regression.  Nota bene: this auxiliary
+   dataset is not necessarily of full length: missing observations
+   are skipped.
+*/
+
+static DATASET *within_groups_dataset (const DATASET *dset,
+                                       panelmod_t *pan)
+{
+    DATASET *wset = NULL;
+    int *vlist = NULL;
+    int i, j, vj, nv;
+    int s, bigt;
+    int err = 0;
+
+    pan->balanced = 1;
+
+    for (i=0; i<pan->nunits; i++) {
+        if (pan->unit_obs[i] > 0) {
+            if (pan->unit_obs[i] != pan->Tmax) {
+                pan->balanced = 0;
+            }
+        }
+    }
+
+    if (pan->NT < dset->n) {
+	/* allow for panel obs book-keeping */
+        err = allocate_data_finders(pan, dset->n);
+        if (err) {
+            return NULL;
+        }
+    }
+
+    vlist = real_varying_list(pan);
+    if (vlist == NULL) {
+        return NULL;
+    }
+
+    nv = pan->vlist[0];
+
+#if PDEBUG
+    fprintf(stderr, "within_groups dataset: nvars=%d, nobs=%d\n",
+            pan->vlist[0], pan->NT);
+#endif
+
+    wset = create_auxiliary_dataset(nv, pan->NT, 0);
+    if (wset == NULL) {
+        free(vlist);
+        return NULL;
+    }
+
+    err = panel_unit_sums(pan, dset);
+    if (err) {
+        free(vlist);
+        destroy_dataset(wset);
+        return NULL;
+    }
+
+    for (j=1; j<=vlist[0]; j++) {
+        const double *xsum;
+        double xbar, gxbar = 0.0;
+        int allzero = 1;
+        int r, u = 0;
+
+        vj = vlist[j];
+        xsum = unit_sums(pan, vj);
+        s = 0;
+
+#if PDEBUG
+        strcpy(wset->varname[j], dset->varname[vj]);
+        fprintf(stderr, "de-meaning: working on list[%d], %s\n",
+                j, dset->varname[vj]);
+#endif
+
+        for (i=0; i<pan->nunits; i++) {
+            int Ti = pan->unit_obs[i];
+
+            if (Ti == 0) {
+                continue;
+            }
+
+            gxbar += xsum[u];
+            xbar = xsum[u++] / Ti;
+
+            for (r=pan->ustart[i]; r<pan->ustart[i+1]; r++) {
+                bigt = pan->obsidx[r];
+                wset->Z[j][s] = dset->Z[vj][bigt] - xbar;
+                if (wset->Z[j][s] != 0.0) {
+                    allzero = 0;
+                }
+                if (pan->small2big != NULL) {
+                    pan->small2big[s] = bigt;
+                    pan->big2small[bigt] = s;
+                }
+                s++;
+            }
+        } /* end loop over units */
+
+        gxbar /= pan->NT;
+
+        if (j == 1 && allzero) {
+            /* the dependent variable is not time-varying */
+            fprintf(stderr, "fixed effects: dependent var is time-invariant\n");
+        }
+
+        /* wZ = data - group mean + grand mean */
+        for (s=0; s<pan->NT; s++) {
+            wset->Z[j][s] += gxbar;
+        }
+    }
+
+    free(vlist);
+
+    return wset;
+}
+
+/* Support for absorbing fixed effects beyond the per-unit ones, as
+   requested via the --absorb option. The extra factors are swept
+   out of the within-groups data by the method of alternating
+   projections (Gaure, 2013): each sweep subtracts from a variable
+   its means by unit and by level of each factor in turn, until a
+   sweep no longer changes the data appreciably.
+*/
+
+#define ABSORB_TIME 0        /* list entry for "$time" */
+#define ABSORB_TOL 1.0e-20   /* relative squared change per sweep */
+#define ABSORB_MAXITER 10000
+
+typedef struct absorb_info_ absorb_info;
+
+struct absorb_info_ {
+    int nf;      /* number of factors, counting the units */
+    int NT;      /* number of observations */
+    int **code;  /* level codes, by factor and observation */
+    int **cnt;   /* observation counts, by factor and level */
+    int *G;      /* number of levels, by factor */
+};
+
+typedef struct absorb_val_ absorb_val;
+
+struct absorb_val_ {
+    double x;
+    int s;
+};
+
+static int compare_absorb_vals (const void *a, const void *b)
+{
+    const absorb_val *va = a;
+    const absorb_val *vb = b;
+
+    return (va->x > vb->x) - (va->x < vb->x);
+}
+
+/* Parse the argument to the --absorb option: one or more series
+   names, or "$time", separated by spaces or commas.
+*/
+
+static int absorb_setup (panelmod_t *pan, const DATASET *dset)
+{
+    const char *s = get_optval_string(PANEL, OPT_G);
+    char **S = NULL;
+    int i, vi, n = 0;
+    int err = 0;
+
+    if (s == NULL || *s == '\0') {
+        return E_DATA;
+    }
+
+    S = gretl_string_split(s, &n, " ,");
+    if (S == NULL) {
+        return E_ALLOC;
+    }
+
+    pan->alist = gretl_list_new(n);
+    if (pan->alist == NULL) {
+        err = E_ALLOC;
+    }
+
+    for (i=0; i<n && !err; i++) {
+        if (!strcmp(S[i], "$time")) {
+            vi = ABSORB_TIME;
+        } else {
+            vi = current_series_index(dset, S[i]);
+            if (vi == 0) {
+                err = E_DATA;
+            } else if (vi < 0) {
+                err = E_UNKVAR;
+            }
+        }
+        if (!err && in_gretl_list(pan->alist, vi)) {
+            gretl_errmsg_sprintf(_("%s: duplicated argument"), S[i]);
+            err = E_DATA;
+        }
+        if (!err) {
+            pan->alist[i+1] = vi;
+        }
+    }
+
+    strings_array_free(S, n);
+
+    if (err) {
+        free(pan->alist);
+        pan->alist = NULL;
     }
 
-    if (pan->opt & OPT_U) {
-        /* make these stats available for random effects reporting */
-        pan->dw = pmod->dw;
-        pan->rho = pmod->rho;
+    return err;
+}
+
+static void absorb_info_free (absorb_info *ai)
+{
+    int f;
+
+    for (f=0; f<ai->nf; f++) {
+        free(ai->code[f]);
+        free(ai->cnt[f]);
     }
+    free(ai->code);
+    free(ai->cnt);
+    free(ai->G);
 }
 
-/* Allocate the arrays needed to perform the Hausman test,
-   in its matrix formulation.
+/* Map the observations used in the within-groups regression onto
+   0-based level codes for absorbed factor @v. Returns the number
+   of distinct levels.
 */
 
-static int matrix_hausman_allocate (panelmod_t *pan)
+static int absorb_factor_codes (panelmod_t *pan, const DATASET *dset,
+                                int v, int *code, int *err)
 {
-    int k = pan->vlist[0] - 2;
-    int err = 0;
+    absorb_val *av;
+    int s, t, G = 0;
 
-    /* array to hold differences between coefficient estimates */
-    pan->bdiff = gretl_vector_alloc(k);
-    if (pan->bdiff == NULL) {
-        err = E_ALLOC;
-    } else {
-        /* array to hold covariance matrix */
-        pan->Sigma = gretl_matrix_alloc(k, k);
-        if (pan->Sigma == NULL) {
-            gretl_matrix_free(pan->bdiff);
-            pan->bdiff = NULL;
-            err = E_ALLOC;
+    av = malloc(pan->NT * sizeof *av);
+    if (av == NULL) {
+        *err = E_ALLOC;
+        return 0;
+    }
+
+    for (s=0; s<pan->NT && !*err; s++) {
+        t = big_index(pan, s);
+        if (v == ABSORB_TIME) {
+            av[s].x = (t - panidx.offset) % pan->T;
+        } else {
+            av[s].x = dset->Z[v][t];
+            if (na(av[s].x)) {
+                gretl_errmsg_sprintf(_("%s: missing values are not allowed "
+                                       "in absorbed factors"),
+                                     dset->varname[v]);
+                *err = E_MISSDATA;
+            }
         }
+        av[s].s = s;
     }
 
-    if (!err) {
-        pan->dfH = k;
+    if (!*err) {
+        qsort(av, pan->NT, sizeof *av, compare_absorb_vals);
+        for (s=0; s<pan->NT; s++) {
+            if (s > 0 && av[s].x != av[s-1].x) {
+                G++;
+            }
+            code[av[s].s] = G;
+        }
+        G++;
     }
 
-    return err;
+    free(av);
+
+    return G;
 }
 
-static int *real_varying_list (panelmod_t *pan)
+static int uf_find (int *parent, int i)
 {
-    int *vlist = gretl_list_copy(pan->vlist);
-    int i;
-
-    if (vlist != NULL) {
-        for (i=2; i<=vlist[0]; i++) {
-            if (vlist[i] == 0) {
-                gretl_list_delete_at_pos(vlist, i);
-                break;
-            }
-        }
+    while (parent[i] != i) {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
     }
 
-    return vlist;
+    return i;
 }
 
-/* Construct a version of the dataset from which the group means are
-   subtracted, for the "within" regression.  Nota bene: this auxiliary
-   dataset is not necessarily of full length: missing observations
-   are skipped.
+/* The absorbed effects are identified only up to one normalization
+   per connected component of the graph linking units and levels of
+   the first extra factor; further factors are taken to cost one
+   more redundancy each, as is standard (the count is exact for the
+   two-way case). Returns the degrees of freedom absorbed beyond
+   the per-unit effects.
 */
 
-static DATASET *within_groups_dataset (const DATASET *dset,
-                                       panelmod_t *pan)
+static int absorb_extra_df (const absorb_info *ai, int *err)
 {
-    DATASET *wset = NULL;
-    int *vlist = NULL;
-    int i, j, vj, nv;
-    int s, t, bigt;
-    int err = 0;
+    int n = ai->G[0] + ai->G[1];
+    int *parent;
+    int i, s, a, b;
+    int ncomp = 0, adf = 0;
 
-    pan->balanced = 1;
+    parent = malloc(n * sizeof *parent);
+    if (parent == NULL) {
+        *err = E_ALLOC;
+        return 0;
+    }
 
-    for (i=0; i<pan->nunits; i++) {
-        if (pan->unit_obs[i] > 0) {
-            if (pan->unit_obs[i] != pan->Tmax) {
-                pan->balanced = 0;
-            }
-        }
+    for (i=0; i<n; i++) {
+        parent[i] = i;
     }
 
-    if (pan->NT < dset->n) {
-	/* allow for panel obs book-keeping */
-        err = allocate_data_finders(pan, dset->n);
-        if (err) {
-            return NULL;
+    for (s=0; s<ai->NT; s++) {
+        a = uf_find(parent, ai->code[0][s]);
+        b = uf_find(parent, ai->G[0] + ai->code[1][s]);
+        if (a != b) {
+            parent[b] = a;
         }
     }
 
-    vlist = real_varying_list(pan);
-    if (vlist == NULL) {
-        return NULL;
+    for (i=0; i<n; i++) {
+        if (parent[i] == i) {
+            ncomp++;
+        }
     }
 
-    nv = pan->vlist[0];
-
-#if PDEBUG
-    fprintf(stderr, "within_groups dataset: nvars=%d, nobs=%d\n",
-            pan->vlist[0], pan->NT);
-#endif
+    free(parent);
 
-    wset = create_auxiliary_dataset(nv, pan->NT, 0);
-    if (wset == NULL) {
-        free(vlist);
-        return NULL;
+    for (i=1; i<ai->nf; i++) {
+        adf += ai->G[i];
     }
 
-    for (j=1; j<=vlist[0]; j++) {
-        double xbar, gxbar = 0.0;
-        int allzero = 1;
+    return adf - ncomp - (ai->nf - 2);
+}
 
-        vj = vlist[j];
-        gxbar = 0.0;
-        s = 0;
+static int absorb_info_fill (absorb_info *ai, panelmod_t *pan,
+                             const DATASET *dset)
+{
+    int nf = pan->alist[0] + 1;
+    int f, g, i, s, ti;
+    int err = 0;
 
-#if PDEBUG
-        strcpy(wset->varname[j], dset->varname[vj]);
-        fprintf(stderr, "de-meaning: working on list[%d], %s\n",
-                j, dset->varname[vj]);
-#endif
+    ai->NT = pan->NT;
+    ai->code = calloc(nf, sizeof *ai->code);
+    ai->cnt = calloc(nf, sizeof *ai->cnt);
+    ai->G = calloc(nf, sizeof *ai->G);
 
-        for (i=0; i<pan->nunits; i++) {
-            int Ti = pan->unit_obs[i];
-            int grpzero = 1;
-            int got = 0;
+    if (ai->code == NULL || ai->cnt == NULL || ai->G == NULL) {
+        return E_ALLOC;
+    }
 
-            if (Ti == 0) {
-                continue;
-            }
+    ai->nf = nf;
 
-            /* first pass: find the group mean */
-            xbar = 0.0;
-            for (t=0; t<pan->T; t++) {
-                bigt = panel_index(i, t);
-                if (!panel_missing(pan, bigt)) {
-                    xbar += dset->Z[vj][bigt];
+    for (f=0; f<nf && !err; f++) {
+        ai->code[f] = malloc(pan->NT * sizeof(int));
+        if (ai->code[f] == NULL) {
+            err = E_ALLOC;
+        } else if (f == 0) {
+            /* the units, which occupy contiguous blocks */
+            for (i=0, s=0, g=0; i<pan->nunits; i++) {
+                if (pan->unit_obs[i] > 0) {
+                    for (ti=0; ti<pan->unit_obs[i]; ti++) {
+                        ai->code[0][s++] = g;
+                    }
+                    g++;
                 }
             }
-
-            gxbar += xbar;
-            xbar /= Ti;
-
-            /* second pass: calculate de-meaned values */
-            got = 0;
-            for (t=0; t<pan->T && got<Ti; t++) {
-                bigt = panel_index(i, t);
-                if (!panel_missing(pan, bigt)) {
-                    wset->Z[j][s] = dset->Z[vj][bigt] - xbar;
-                    if (wset->Z[j][s] != 0.0) {
-                        grpzero = 0;
-                    }
-                    got++;
-                    if (pan->small2big != NULL) {
-                        pan->small2big[s] = bigt;
-                        pan->big2small[bigt] = s;
-                    }
-                    s++;
+            ai->G[0] = g;
+        } else {
+            ai->G[f] = absorb_factor_codes(pan, dset, pan->alist[f],
+                                           ai->code[f], &err);
+        }
+        if (!err) {
+            ai->cnt[f] = calloc(ai->G[f], sizeof(int));
+            if (ai->cnt[f] == NULL) {
+                err = E_ALLOC;
+            } else {
+                for (s=0; s<pan->NT; s++) {
+                    ai->cnt[f][ai->code[f][s]] += 1;
                 }
             }
+        }
+    }
 
-            if (!grpzero) {
-                allzero = 0;
-            }
-        } /* end loop over units */
+    return err;
+}
 
-        gxbar /= pan->NT;
+/* Subtract from @x its means by level of factor @f, using @sum as
+   workspace; returns the sum of squared changes.
+*/
 
-        if (j == 1 && allzero) {
-            /* the dependent variable is not time-varying */
-            fprintf(stderr, "fixed effects: dependent var is time-invariant\n");
+static double absorb_demean (const absorb_info *ai, int f,
+                             double *x, double *sum)
+{
+    const int *code = ai->code[f];
+    const int *cnt = ai->cnt[f];
+    double d, ss = 0.0;
+    int g, s;
+
+    for (g=0; g<ai->G[f]; g++) {
+        sum[g] = 0.0;
+    }
+    for (s=0; s<ai->NT; s++) {
+        sum[code[s]] += x[s];
+    }
+    for (g=0; g<ai->G[f]; g++) {
+        sum[g] /= cnt[g];
+    }
+    for (s=0; s<ai->NT; s++) {
+        d = sum[code[s]];
+        x[s] -= d;
+        ss += d * d;
+    }
+
+    return ss;
+}
+
+/* Sweep all the absorbed effects out of @x, preserving its overall
+   mean (which is then picked up by the constant).
+*/
+
+static int absorb_sweep (const absorb_info *ai, double *x,
+                         double *sum)
+{
+    double ss, ss0 = 0.0, xbar = 0.0;
+    int f, s, iter = 0;
+
+    for (s=0; s<ai->NT; s++) {
+        xbar += x[s];
+    }
+    xbar /= ai->NT;
+    for (s=0; s<ai->NT; s++) {
+        x[s] -= xbar;
+        ss0 += x[s] * x[s];
+    }
+
+    if (ss0 > 0) {
+        for (iter=0; iter<ABSORB_MAXITER; iter++) {
+            ss = 0.0;
+            for (f=0; f<ai->nf; f++) {
+                ss += absorb_demean(ai, f, x, sum);
+            }
+            if (ss <= ABSORB_TOL * ss0) {
+                break;
+            }
         }
+    }
 
-        /* wZ = data - group mean + grand mean */
-        for (s=0; s<pan->NT; s++) {
-            wset->Z[j][s] += gxbar;
+    for (s=0; s<ai->NT; s++) {
+        x[s] += xbar;
+    }
+
+    return (iter < ABSORB_MAXITER)? 0 : E_NOCONV;
+}
+
+/* Purge the within-groups dataset @wset of the effects of the
+   factors in pan->alist, in addition to the unit effects. The
+   variables are independent problems so they're handled in parallel,
+   each with its own workspace.
+*/
+
+static int absorb_fixed_effects (panelmod_t *pan, const DATASET *dset,
+                                 DATASET *wset)
+{
+    absorb_info ai = {0};
+    int j, nv = wset->v;
+    int Gmax = 0;
+    int err = 0;
+
+    err = absorb_info_fill(&ai, pan, dset);
+
+    if (!err) {
+        pan->adf = absorb_extra_df(&ai, &err);
+    }
+
+    if (!err) {
+        for (j=0; j<ai.nf; j++) {
+            if (ai.G[j] > Gmax) {
+                Gmax = ai.G[j];
+            }
+        }
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) pan->NT * nv))
+#endif
+        for (j=1; j<nv; j++) {
+            double *sum = malloc(Gmax * sizeof *sum);
+            int jerr;
+
+            jerr = (sum == NULL)? E_ALLOC : absorb_sweep(&ai, wset->Z[j], sum);
+            free(sum);
+            if (jerr) {
+#if defined(_OPENMP)
+#pragma omp critical (absorb_err)
+#endif
+                err = jerr;
+            }
         }
     }
 
-    free(vlist);
+    absorb_info_free(&ai);
 
-    return wset;
+    return err;
 }
 
 /* Construct a quasi-demeaned version of the dataset so we can apply
@@ -2075,7 +2490,7 @@ random_effects_dataset (const DATASET *dset,
     int hreg = (hlist != NULL);
     int v1 = relist[0];
     int v2 = 0;
-    int i, j, k, k2, t;
+    int i, j, k, k2, r;
     int vj, s, bigt, u;
     int err = 0;
 
@@ -2146,7 +2561,6 @@ random_effects_dataset (const DATASET *dset,
 
     for (i=0; i<pan->nunits; i++) {
         int Ti = pan->unit_obs[i];
-        int got = 0;
 
         if (Ti == 0) {
             continue;
@@ -2160,32 +2574,29 @@ random_effects_dataset (const DATASET *dset,
 
         pan->theta_bar += theta_i;
 
-        for (t=0; t<pan->T && got<Ti; t++) {
-            bigt = panel_index(i, t);
+        for (r=pan->ustart[i]; r<pan->ustart[i+1]; r++) {
+            bigt = pan->obsidx[r];
             k = 0;
             k2 = v1 - 1;
-            if (!panel_missing(pan, bigt)) {
-                for (j=0; j<v1; j++) {
-                    vj = pan->pooled->list[j+1];
-                    if (vj == 0) {
-                        rset->Z[0][s] -= theta_i;
-                    } else {
-                        k++;
-                        xbar = (k < gset->v)? gset->Z[k][u] : 1.0 / pan->Tmax;
-                        rset->Z[k][s] = dset->Z[vj][bigt] - theta_i * xbar;
-                        if (hreg && k2 < rset->v - 1 && var_is_varying(pan, vj)) {
-                            /* hausman-related term */
-                            rset->Z[++k2][s] = dset->Z[vj][bigt] - xbar;
-                        }
+            for (j=0; j<v1; j++) {
+                vj = pan->pooled->list[j+1];
+                if (vj == 0) {
+                    rset->Z[0][s] -= theta_i;
+                } else {
+                    k++;
+                    xbar = (k < gset->v)? gset->Z[k][u] : 1.0 / pan->Tmax;
+                    rset->Z[k][s] = dset->Z[vj][bigt] - theta_i * xbar;
+                    if (hreg && k2 < rset->v - 1 && var_is_varying(pan, vj)) {
+                        /* hausman-related term */
+                        rset->Z[++k2][s] = dset->Z[vj][bigt] - xbar;
                     }
                 }
-                got++;
-                if (pan->small2big != NULL) {
-                    pan->small2big[s] = bigt;
-                    pan->big2small[bigt] = s;
-                }
-                s++;
             }
+            if (pan->small2big != NULL) {
+                pan->small2big[s] = bigt;
+                pan->big2small[bigt] = s;
+            }
+            s++;
         }
         u++;
     }
@@ -2203,11 +2614,9 @@ static DATASET *group_means_dataset (panelmod_t *pan,
                                      const DATASET *dset)
 {
     DATASET *gset;
-    double x;
     int gn = pan->effn;
     int gv = pan->pooled->list[0];
-    int i, j, k;
-    int s, t, bigt;
+    int i, j, k, s;
 
     if (pan->balanced && pan->ntdum > 0) {
         gv -= pan->ntdum;
@@ -2218,6 +2627,10 @@ static DATASET *group_means_dataset (panelmod_t *pan,
             gv, gn);
 #endif
 
+    if (panel_unit_sums(pan, dset)) {
+        return NULL;
+    }
+
     gset = create_auxiliary_dataset(gv, gn, 0);
     if (gset == NULL) {
         return NULL;
@@ -2244,18 +2657,10 @@ static DATASET *group_means_dataset (panelmod_t *pan,
         for (i=0; i<pan->nunits; i++) {
             int Ti = pan->unit_obs[i];
 
-            if (Ti == 0) {
-                continue;
-            }
-
-            x = 0.0;
-            for (t=0; t<pan->T; t++) {
-                bigt = panel_index(i, t);
-                if (!panel_missing(pan, bigt)) {
-                    x += dset->Z[vj][bigt];
-                }
+            if (Ti > 0) {
+                gset->Z[k][s] = pan->usums->val[(size_t) (j-1) * gn + s] / Ti;
+                s++;
             }
-            gset->Z[k][s++] = x / Ti;
         }
         k++;
     }
@@ -2730,7 +3135,7 @@ static void regular_fixed_effects_F (panelmod_t *pan, MODEL *wmod)
     int k_pooled = pan->pooled->list[0];
     int k_fe = pan->vlist[0];
 
-    pan->Fdfn = pan->effn - 1;
+    pan->Fdfn = pan->effn - 1 + pan->adf;
     pan->Fdfd = wmod->dfd;
 
     if (k_pooled > k_fe) {
@@ -3502,6 +3907,15 @@ fixed_effects_model (panelmod_t *pan, DATASET *dset, PRN *prn)
         return femod;
     }
 
+    if (pan->alist != NULL) {
+        femod.errcode = absorb_fixed_effects(pan, dset, wset);
+        if (femod.errcode) {
+            destroy_dataset(wset);
+            free(felist);
+            return femod;
+        }
+    }
+
     felist[1] = 1;
     felist[2] = 0;
     for (i=3; i<=felist[0]; i++) {
@@ -3528,18 +3942,20 @@ fixed_effects_model (panelmod_t *pan, DATASET *dset, PRN *prn)
         fprintf(stderr, "femod.errcode = %d\n", femod.errcode);
     } else if ((pan->opt & OPT_F) && femod.list[0] < felist[0]) {
         femod.errcode = E_SINGULAR;
+    } else if (femod.dfd <= pan->effn - 1 + pan->adf) {
+        femod.errcode = E_DF;
     } else {
         if (!(pan->opt & OPT_N)) {
             /* we estimated a bunch of group means, and have to
                subtract degrees of freedom */
-            fixed_effects_df_correction(&femod, pan->effn - 1);
+            fixed_effects_df_correction(&femod, pan->effn - 1 + pan->adf);
         }
 #if PDEBUG > 1
         verbose_femod_print(&femod, wset, prn);
 #endif
         if (pan->opt & OPT_F) {
             /* estimating the FE model in its own right */
-            if (pan->opt & OPT_R) {
+            if ((pan->opt & OPT_R) && pan->alist == NULL) {
                 /* we have to do this before the pooled residual
                    array is "stolen" for the fixed-effects model
                 */
@@ -3742,6 +4158,34 @@ static void replace_re_residuals (MODEL *pmod, panelmod_t *pan)
 /* We use this to "finalize" models estimated via fixed effects
    and random effects */
 
+/* Note on the model the factors absorbed via --absorb and the
+   degrees of freedom they took, beyond those of the unit effects.
+*/
+
+static void record_absorbed_effects (MODEL *pmod, panelmod_t *pan,
+                                     const DATASET *dset)
+{
+    PRN *prn = gretl_print_new(GRETL_PRINT_BUFFER, NULL);
+    int i, vi;
+
+    if (prn == NULL) {
+        return;
+    }
+
+    for (i=1; i<=pan->alist[0]; i++) {
+        vi = pan->alist[i];
+        if (i > 1) {
+            pputc(prn, ' ');
+        }
+        pputs(prn, (vi == ABSORB_TIME)? "$time" : dset->varname[vi]);
+    }
+
+    gretl_model_set_string_as_data(pmod, "absorb",
+                                   gretl_print_steal_buffer(prn));
+    gretl_model_set_int(pmod, "absorb_df", pan->adf);
+    gretl_print_destroy(prn);
+}
+
 static int save_panel_model (MODEL *pmod, panelmod_t *pan,
                              const double **Z,
                              const DATASET *dset)
@@ -3762,7 +4206,12 @@ static int save_panel_model (MODEL *pmod, panelmod_t *pan,
         ulist = fe_units_list(pan);
         gretl_model_add_panel_varnames(pmod, dset, ulist);
         free(ulist);
-        panel_model_add_ahat(pmod, dset, pan);
+        if (pan->alist != NULL) {
+            /* the per-unit intercepts are not recovered */
+            record_absorbed_effects(pmod, pan, dset);
+        } else {
+            panel_model_add_ahat(pmod, dset, pan);
+        }
         save_fixed_effects_F(pan, pmod);
     } else {
         /* random effects */
@@ -3844,7 +4293,7 @@ static int within_variance (panelmod_t *pan,
             den = femod.nobs;
         } else {
             /* as per Greene: nT - n - K */
-            den = femod.nobs - pan->effn - (pan->vlist[0] - 2);
+            den = femod.nobs - pan->effn - pan->adf - (pan->vlist[0] - 2);
         }
 
         if (den == 0) {
@@ -4429,7 +4878,7 @@ static int finalize_hausman_test (panelmod_t *pan, int ci, PRN *prn)
 static int panel_obs_accounts (panelmod_t *pan)
 {
     int *uobs;
-    int i, t, bigt;
+    int i, s, t, bigt;
 
     uobs = malloc(pan->nunits * sizeof *uobs);
     if (uobs == NULL) {
@@ -4474,6 +4923,26 @@ static int panel_obs_accounts (panelmod_t *pan)
 
     pan->unit_obs = uobs;
 
+    /* record where each unit's usable observations are, so that
+       later passes over the data need not skip missing values
+    */
+    pan->obsidx = malloc(pan->NT * sizeof *pan->obsidx);
+    pan->ustart = malloc((pan->nunits + 1) * sizeof *pan->ustart);
+    if (pan->obsidx == NULL || pan->ustart == NULL) {
+        return E_ALLOC;
+    }
+
+    for (i=0, s=0; i<pan->nunits; i++) {
+        pan->ustart[i] = s;
+        for (t=0; t<pan->T && s<pan->ustart[i]+uobs[i]; t++) {
+            bigt = panel_index(i, t);
+            if (!panel_missing(pan, bigt)) {
+                pan->obsidx[s++] = bigt;
+            }
+        }
+    }
+    pan->ustart[i] = s;
+
     return 0;
 }
 
@@ -4581,7 +5050,11 @@ panelmod_setup (panelmod_t *pan, MODEL *pmod, const DATASET *dset,
 
     if (err && pan->unit_obs != NULL) {
         free(pan->unit_obs);
+        free(pan->obsidx);
+        free(pan->ustart);
         pan->unit_obs = NULL;
+        pan->obsidx = NULL;
+        pan->ustart = NULL;
     }
 
     return err;
@@ -4903,7 +5376,9 @@ static int save_pooled_model (MODEL *pmod, panelmod_t *pan,
  * matrix-difference variant of the Hausman test (random
  * effects only); %OPT_B for the "between" model; %OPT_P for
  * pooled OLS; and %OPT_D to include time dummies.
- * %OPT_C for clustered standard errors is also accepted.
+ * %OPT_C for clustered standard errors is also accepted, as is
+ * %OPT_G (fixed effects only) to absorb further factors named
+ * via the --absorb option.
  * If %OPT_U is given, either of the mutually incompatible options
  * %OPT_E and %OPT_X may be given to inflect the calculation of the
  * variance of the individual effects: %OPT_E means use Nerlove's
@@ -5011,6 +5486,9 @@ MODEL real_panel_model (const int *list, DATASET *dset,
     }
 
     err = panelmod_setup(&pan, &mod, dset, ntdum, pan_opt);
+    if (!err && (opt & OPT_G)) {
+        err = absorb_setup(&pan, dset);
+    }
     if (err) {
         goto bailout;
     }
@@ -6682,7 +7160,7 @@ static int pad_panel_dataset (const double *uid, int uv, int nunits,
 
         /* swap the padded arrays into Z */
         for (i=0; i<dset->v; i++) {
-            free(dset->Z[i]);
+            dataset_release_series(dset->Z[i]);
             dset->Z[i] = bigZ[i];
         }
 
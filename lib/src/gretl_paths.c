@@ -1754,13 +1754,16 @@ static void set_gretl_binbase (const char *path)
 }
 
 /* This should be called after we're fairly confident that we
-   have the dotdir setting right */
+   have the dotdir setting right. The x12arima and tramo working
+   directories are named here but not created until they're first
+   wanted: see make_extra_dot_dirs() below.
+*/
+
+static int extra_dot_dirs_pending;
 
 static int set_extra_dot_paths (void)
 {
     char dirname[MAXLEN+128];
-    size_t n;
-    int err = 0;
 
     /* the personal function package directory */
     *dirname = '\0';
@@ -1770,31 +1773,44 @@ static int set_extra_dot_paths (void)
     *paths.tramodir = '\0';
     *paths.x12adir = '\0';
 
-#if !defined(HAVE_TRAMO) && !defined(HAVE_X12A)
-    return 0;
+#ifdef HAVE_X12A
+    gretl_build_path(paths.x12adir, paths.dotdir, "x12arima", NULL);
+    extra_dot_dirs_pending = 1;
 #endif
 
-    *dirname = '\0';
-    strcpy(dirname, paths.dotdir);
-    n = strlen(dirname);
+#ifdef HAVE_TRAMO
+    gretl_build_path(paths.tramodir, paths.dotdir, "tramo", NULL);
+    extra_dot_dirs_pending = 1;
+#endif
 
-    if (n > 0 && (dirname[n-1] == '\\' || dirname[n-1] == '/')) {
-        dirname[n-1] = '\0';
+    return 0;
+}
+
+/* Create the x12arima and tramo working directories named by
+   set_extra_dot_paths(), on first use; a directory that can't
+   be created is blanked out.
+*/
+
+static void make_extra_dot_dirs (void)
+{
+    if (!extra_dot_dirs_pending) {
+        return;
     }
 
+    extra_dot_dirs_pending = 0;
+
 #ifdef HAVE_X12A
-    gretl_build_path(paths.x12adir, paths.dotdir, "x12arima", NULL);
-    err = gretl_mkdir(paths.x12adir);
-    if (err) {
+    if (gretl_mkdir(paths.x12adir)) {
         *paths.x12adir = '\0';
     }
 #endif
 
 #ifdef HAVE_TRAMO
-    gretl_build_path(paths.tramodir, paths.dotdir, "tramo", NULL);
+    char dirname[MAXLEN+128];
+
     if (gretl_mkdir(paths.tramodir)) {
         *paths.tramodir = '\0';
-        return 1;
+        return;
     }
 
     sprintf(dirname, "%s%coutput", paths.tramodir, SLASH);
@@ -1803,7 +1819,7 @@ static int set_extra_dot_paths (void)
     sprintf(dirname, "%s%cgraph", paths.tramodir, SLASH);
     if (gretl_mkdir(dirname)) {
         *paths.tramodir = '\0';
-        return 1;
+        return;
     }
 
     sprintf(dirname, "%s%cgraph%cacf", paths.tramodir, SLASH, SLASH);
@@ -1817,8 +1833,6 @@ static int set_extra_dot_paths (void)
     sprintf(dirname, "%s%cgraph%cspectra", paths.tramodir, SLASH, SLASH);
     gretl_mkdir(dirname);
 #endif
-
-    return err;
 }
 
 static void set_builtin_path_strings (int update)
@@ -2024,6 +2038,19 @@ const char *maybe_get_default_workdir (void)
 #endif
 }
 
+/* "Fast start" (gretlcli --fast-start): skip the checks on the
+   configuration file and on the writability of directories that
+   are made at startup, on the assumption that the setup is known
+   to be good.
+*/
+
+static int fast_start;
+
+void gretl_set_fast_start (void)
+{
+    fast_start = 1;
+}
+
 static int validate_writedir (const char *dirname)
 {
     int err = 0;
@@ -2038,7 +2065,7 @@ static int validate_writedir (const char *dirname)
         gretl_errmsg_sprintf( _("Couldn't create directory '%s'"), dirname);
     }
 
-    if (!err) {
+    if (!err && !fast_start) {
         /* ensure the directory is writable */
 #ifdef WIN32
 	long mypid = (long) GetCurrentProcessId();
@@ -2142,6 +2169,7 @@ const char *gretl_tramo (void)
 
 const char *gretl_tramo_dir (void)
 {
+    make_extra_dot_dirs();
     return paths.tramodir;
 }
 
@@ -2152,6 +2180,7 @@ const char *gretl_x12_arima (void)
 
 const char *gretl_x12_arima_dir (void)
 {
+    make_extra_dot_dirs();
     return paths.x12adir;
 }
 
@@ -3006,7 +3035,7 @@ int gretl_set_paths (ConfigPaths *cpaths)
     }
 
     set_builtin_path_strings(0);
-    set_gretl_tex_preamble();
+    libset_load_tuning();
 
     retval = (err0)? err0 : err1;
 
@@ -3443,23 +3472,32 @@ int cli_read_rc (void)
     FILE *fp;
     int err = 0;
 
-    get_gretl_rc_path(rcfile);
-    fp = gretl_fopen(rcfile, "r");
-
-    if (fp == NULL) {
-        err = E_FOPEN;
+    if (fast_start) {
+        /* go with the default settings */
+        fp = NULL;
+        handle_use_cwd(1, &cpaths);
     } else {
+        get_gretl_rc_path(rcfile);
+        fp = gretl_fopen(rcfile, "r");
+        if (fp == NULL) {
+            err = E_FOPEN;
+        }
+    }
+
+    if (fp != NULL) {
         get_gretl_config_from_file(fp, &cpaths, dbproxy,
                                    &use_proxy, &updated,
                                    &gptheme);
         fclose(fp);
     }
+    gretl_startup_mark("config file");
 
     if (err) {
         gretl_set_paths(&cpaths);
     } else {
         err = gretl_set_paths(&cpaths);
     }
+    gretl_startup_mark("paths");
 
     if (gptheme != NULL) {
         set_plotstyle(gptheme);
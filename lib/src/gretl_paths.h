@@ -125,6 +125,8 @@ int has_system_prefix (const char *fname, SearchType stype);
 
 void show_paths (void);
 
+void gretl_set_fast_start (void);
+
 int gretl_set_paths (ConfigPaths *paths);
 
 int gretl_update_paths (ConfigPaths *cpaths, gretlopt opt);
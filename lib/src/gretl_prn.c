@@ -63,6 +63,7 @@ struct PRN_ {
     PrnFormat format;  /* plain, TeX, RTF */
     gint8 fixed;       /* non-zero for fixed-size buffer */
     gint8 gbuf;        /* non-zero for buffer obtained via GLib */
+    gint8 null;        /* non-zero: output is discarded */
     guint8 nlcount;    /* count of trailing newlines */
     char delim;        /* CSV field delimiter */
     char *fname;       /* temp file name, or NULL */
@@ -218,6 +219,7 @@ static PRN *real_gretl_print_new (PrnType ptype,
     prn->format = GRETL_FORMAT_TXT;
     prn->fixed = 0;
     prn->gbuf = 0;
+    prn->null = 0;
     prn->nlcount = 0;
     prn->delim = ',';
     prn->fname = NULL;
@@ -252,6 +254,8 @@ static PRN *real_gretl_print_new (PrnType ptype,
 	prn->fp = stdout;
     } else if (ptype == GRETL_PRINT_STDERR) {
 	prn->fp = stderr;
+    } else if (ptype == GRETL_PRINT_NULL) {
+	prn->null = 1;
     } else if (ptype == GRETL_PRINT_BUFFER) {
 	if (buf != NULL) {
 	    prn->buf = buf;
@@ -292,7 +296,9 @@ static PRN *real_gretl_print_new (PrnType ptype,
  * is %GRETL_PRINT_BUFFER, output will go to an automatically
  * resized buffer; if @ptype is %GRETL_PRINT_STDOUT or
  * %GRETL_PRINT_STDERR output goes to %stdout or %stderr
- * respectively.
+ * respectively. If @ptype is %GRETL_PRINT_NULL output is
+ * discarded without being formatted, which is cheaper than
+ * printing to a buffer that is then thrown away.
  *
  * If you want a named file associated with the struct, use
  * #gretl_print_new_with_filename instead; if you want to
@@ -1013,6 +1019,23 @@ static int pprintf_init (PRN *prn)
     return ret;
 }
 
+/* Ensure there's room for at least @len more bytes in the
+   buffer of @prn, plus the usual margin. Growth is geometric,
+   so that building a long text piecemeal takes a number of
+   reallocations that is only logarithmic in its length.
+*/
+
+static int prn_buffer_reserve (PRN *prn, size_t len)
+{
+    size_t need = prn->blen + len + MINREM;
+
+    if (prn->bufsize >= need) {
+	return 0;
+    } else {
+	return realloc_prn_buffer(prn, MAX(need, 2 * prn->bufsize));
+    }
+}
+
 static int get_nl_count (const char *s)
 {
     int i, n = strlen(s) - 1;
@@ -1046,7 +1069,7 @@ int pprintf (PRN *prn, const char *format, ...)
     va_list args;
     int rem, plen = 0;
 
-    if (prn == NULL || prn->fixed) {
+    if (prn == NULL || prn->fixed || prn->null) {
 	return 0;
     }
 
@@ -1098,9 +1121,7 @@ int pprintf (PRN *prn, const char *format, ...)
 
     if (plen >= rem) {
 	/* buffer not big enough: try again */
-	size_t newsize = prn->bufsize + plen + 1024;
-
-	if (realloc_prn_buffer(prn, newsize)) {
+	if (prn_buffer_reserve(prn, plen)) {
 	    return -1;
 	}
 	rem = prn->bufsize - prn->blen - 1;
@@ -1123,7 +1144,7 @@ void pprintf2 (PRN *prn, const char *format, ...)
     va_list args;
     int rem, plen = 0;
 
-    if (prn == NULL || prn->fixed) {
+    if (prn == NULL || prn->fixed || prn->null) {
 	return;
     }
 
@@ -1157,9 +1178,7 @@ void pprintf2 (PRN *prn, const char *format, ...)
     va_end(args);
 
     if (plen >= rem) {
-	size_t newsize = prn->bufsize + plen + 1024;
-
-	if (realloc_prn_buffer(prn, newsize)) {
+	if (prn_buffer_reserve(prn, plen)) {
 	    return;
 	}
 	rem = prn->bufsize - prn->blen - 1;
@@ -1186,7 +1205,7 @@ int pputs (PRN *prn, const char *s)
 {
     int slen, rem;
 
-    if (prn == NULL || prn->fixed) {
+    if (prn == NULL || prn->fixed || prn->null) {
 	return 0;
     }
 
@@ -1208,8 +1227,8 @@ int pputs (PRN *prn, const char *s)
 
     rem = prn->bufsize - prn->blen;
 
-    while (rem < MINREM || rem <= slen) {
-	if (realloc_prn_buffer(prn, 0)) {
+    if (rem < MINREM || rem <= slen) {
+	if (prn_buffer_reserve(prn, slen)) {
 	    return -1;
 	}
 	rem = prn->bufsize - prn->blen;
@@ -1237,7 +1256,7 @@ int pputs (PRN *prn, const char *s)
 
 int pputc (PRN *prn, int c)
 {
-    if (prn == NULL || prn->fixed) {
+    if (prn == NULL || prn->fixed || prn->null) {
 	return 0;
     }
 
@@ -1274,6 +1293,154 @@ int pputc (PRN *prn, int c)
     return 1;
 }
 
+/* print @x into @s according to @fmt, which contains @nstar
+   placeholders to be filled by @wid and @prec */
+
+static int format_double (char *s, size_t len, const char *fmt,
+			  int nstar, int wid, int prec, double x)
+{
+    if (nstar == 2) {
+	return snprintf(s, len, fmt, wid, prec, x);
+    } else if (nstar == 1) {
+	return snprintf(s, len, fmt, (wid > 0)? wid : prec, x);
+    } else {
+	return snprintf(s, len, fmt, x);
+    }
+}
+
+#define DBLCHUNK 4096
+
+/**
+ * pprint_doubles:
+ * @prn: gretl printing struct.
+ * @fmt: printf-type format for a single double, possibly
+ * including surrounding text such as a separator.
+ * @wid: an integer width, or 0.
+ * @prec: an integer precision, or 0.
+ * @x: array of values to print.
+ * @n: number of values to print.
+ * @stride: spacing of successive values in @x, 1 if they
+ * are contiguous.
+ *
+ * Prints @n values from @x, each formatted via @fmt, which
+ * may contain up to two placeholders ("*"), to be filled by
+ * @wid and/or @prec in the manner of the C library's printf().
+ * This is equivalent to a loop of pprintf() calls but is much
+ * faster: when printing to a buffer it is grown at most once
+ * per call and the values are written straight into it, and
+ * otherwise the output is passed on in large chunks. The
+ * @stride argument allows for printing a row of a matrix,
+ * which is stored by columns.
+ *
+ * Returns: the number of bytes printed, or -1 on memory allocation
+ * failure.
+ */
+
+int pprint_doubles (PRN *prn, const char *fmt, int wid, int prec,
+		    const double *x, int n, int stride)
+{
+    char chunk[DBLCHUNK];
+    const char *p = fmt;
+    int nstar = 0;
+    int i, plen, tot = 0;
+
+    if (prn == NULL || prn->fixed || prn->null || n <= 0) {
+	return 0;
+    }
+
+    while ((p = strchr(p, '*')) != NULL) {
+	nstar++;
+	p++;
+    }
+
+    if (prn->fp == NULL && prn->fz == NULL) {
+	/* printing to buffer */
+	size_t rem;
+
+	if (prn->buf == NULL) {
+	    return 0;
+	}
+	prn->nlcount = get_nl_count(fmt);
+	for (i=0; i<n; i++) {
+	    rem = prn->bufsize - prn->blen;
+	    if (rem < MINREM && prn_buffer_reserve(prn, (n - i) * 16)) {
+		return -1;
+	    }
+	    rem = prn->bufsize - prn->blen;
+	    plen = format_double(prn->buf + prn->blen, rem, fmt,
+				 nstar, wid, prec, x[(size_t) i * stride]);
+	    if (plen >= (int) rem) {
+		/* an unusually wide field */
+		if (prn_buffer_reserve(prn, plen)) {
+		    return -1;
+		}
+		rem = prn->bufsize - prn->blen;
+		plen = format_double(prn->buf + prn->blen, rem, fmt,
+				     nstar, wid, prec, x[(size_t) i * stride]);
+	    }
+	    if (plen > 0) {
+		prn->blen += plen;
+		tot += plen;
+	    }
+	}
+	return tot;
+    }
+
+    /* printing to stream: accumulate the output in @chunk */
+    *chunk = '\0';
+    plen = 0;
+    for (i=0; i<n; i++) {
+	int k = format_double(chunk + plen, DBLCHUNK - plen, fmt,
+			      nstar, wid, prec, x[(size_t) i * stride]);
+
+	if (k >= DBLCHUNK - plen) {
+	    /* won't fit: flush and try again */
+	    chunk[plen] = '\0';
+	    pputs(prn, chunk);
+	    tot += plen;
+	    plen = 0;
+	    k = format_double(chunk, DBLCHUNK, fmt, nstar, wid,
+			      prec, x[(size_t) i * stride]);
+	    if (k >= DBLCHUNK) {
+		/* a single very wide field */
+		gchar *tmp = g_malloc(k + 1);
+
+		format_double(tmp, k + 1, fmt, nstar, wid, prec,
+			      x[(size_t) i * stride]);
+		pputs(prn, tmp);
+		g_free(tmp);
+		tot += k;
+		k = 0;
+	    }
+	}
+	if (k > 0) {
+	    plen += k;
+	}
+    }
+
+    if (plen > 0) {
+	pputs(prn, chunk);
+	tot += plen;
+    }
+
+    return tot;
+}
+
+/**
+ * gretl_print_is_null:
+ * @prn: gretl printing struct.
+ *
+ * Returns: 1 if output to @prn will be discarded, because
+ * @prn is NULL or was created with type %GRETL_PRINT_NULL,
+ * otherwise 0. This may be used to skip the preparation of
+ * output that would not be seen.
+ */
+
+int gretl_print_is_null (PRN *prn)
+{
+    return prn == NULL || prn->null;
+}
+
 /**
  * gretl_prn_newline:
  * @prn: gretl printing struct.
@@ -35,7 +35,8 @@ typedef enum {
     GRETL_PRINT_BUFFER,
     GRETL_PRINT_TEMPFILE,
     GRETL_PRINT_STREAM,
-    GRETL_PRINT_GZFILE
+    GRETL_PRINT_GZFILE,
+    GRETL_PRINT_NULL
 } PrnType;
 
 typedef enum {
@@ -122,6 +123,11 @@ int pputs (PRN *prn, const char *s);
 
 int pputc (PRN *prn, int c);
 
+int pprint_doubles (PRN *prn, const char *fmt, int wid, int prec,
+                    const double *x, int n, int stride);
+
+int gretl_print_is_null (PRN *prn);
+
 void gretl_print_ensure_vspace (PRN *prn);
 
 void gretl_prn_newline (PRN *prn);
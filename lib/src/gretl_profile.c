@@ -0,0 +1,542 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* gretl_profile.c: instrumented profiler for hansl scripts, switched
+   on via "set profile on" or "gretlcli --profile". Wall time is
+   attributed to script lines, user functions and built-in commands;
+   the report consists of a summary table plus a file holding call
+   stacks in the "collapsed" format read by flamegraph tools.
+*/
+
+#include "libgretl.h"
+#include "gretl_paths.h"
+#include "gretl_profile.h"
+
+#define PROF_LINELEN 48  /* max characters of a line shown */
+#define PROF_MAXLINES 25 /* max number of lines shown */
+
+#define STACKS_FILE "gretl_profile.folded"
+
+typedef struct prof_func_ prof_func;
+typedef struct prof_line_ prof_line;
+typedef struct prof_frame_ prof_frame;
+
+struct prof_func_ {
+    char *name;
+    int calls;
+    int active;   /* current depth of recursion */
+    gint64 total; /* inclusive time */
+    gint64 self;  /* exclusive time */
+};
+
+struct prof_line_ {
+    const char *where; /* function name, or "main" */
+    char *s;           /* text of line */
+    int lineno;        /* line number in function, or 0 */
+    int count;
+    gint64 total;
+    gint64 self;
+};
+
+struct prof_frame_ {
+    prof_func *fun;  /* NULL at top level */
+    prof_line *line; /* line in progress, if any */
+    gint64 t0;       /* time of entry */
+    gint64 child;    /* time spent in callees */
+    gint64 tline;    /* start of current line */
+    gint64 lchild;   /* time spent in callees on current line */
+};
+
+struct prof_cmd {
+    int count;
+    int active;
+    gint64 total;
+};
+
+static int profiling;
+static gint64 prof_elapsed;
+static GHashTable *prof_funcs;
+static GHashTable *prof_lines;
+static GHashTable *prof_stacks;
+static GArray *prof_frames;
+static GString *prof_key;
+static struct prof_cmd prof_cmds[NC];
+
+static void prof_func_free (gpointer p)
+{
+    prof_func *fun = p;
+
+    free(fun->name);
+    free(fun);
+}
+
+static void prof_line_free (gpointer p)
+{
+    prof_line *line = p;
+
+    free(line->s);
+    free(line);
+}
+
+static void profile_clear (void)
+{
+    if (prof_funcs != NULL) {
+        g_hash_table_destroy(prof_funcs);
+        g_hash_table_destroy(prof_lines);
+        g_hash_table_destroy(prof_stacks);
+        g_array_free(prof_frames, TRUE);
+        g_string_free(prof_key, TRUE);
+        prof_funcs = prof_lines = prof_stacks = NULL;
+        prof_frames = NULL;
+        prof_key = NULL;
+    }
+    memset(prof_cmds, 0, sizeof prof_cmds);
+    prof_elapsed = 0;
+}
+
+static prof_frame *top_frame (void)
+{
+    return &g_array_index(prof_frames, prof_frame,
+                          prof_frames->len - 1);
+}
+
+static void frame_close_line (prof_frame *f, gint64 now)
+{
+    if (f->line != NULL) {
+        gint64 dt = now - f->tline;
+
+        f->line->total += dt;
+        f->line->self += dt - f->lchild;
+        f->line = NULL;
+    }
+}
+
+/* add @t to the exclusive time recorded for the current call
+   stack, written as "main;f;g"
+*/
+
+static void add_stack_time (gint64 t)
+{
+    gint64 *pt;
+    guint i;
+
+    g_string_assign(prof_key, "main");
+    for (i=1; i<prof_frames->len; i++) {
+        prof_frame *f = &g_array_index(prof_frames, prof_frame, i);
+
+        g_string_append_c(prof_key, ';');
+        g_string_append(prof_key, f->fun->name);
+    }
+
+    pt = g_hash_table_lookup(prof_stacks, prof_key->str);
+    if (pt == NULL) {
+        pt = g_malloc0(sizeof *pt);
+        g_hash_table_insert(prof_stacks, g_strdup(prof_key->str), pt);
+    }
+    *pt += t;
+}
+
+int gretl_profiling (void)
+{
+    return profiling;
+}
+
+void gretl_profile_start (void)
+{
+    prof_frame root = {0};
+
+    profile_clear();
+
+    prof_funcs = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                       NULL, prof_func_free);
+    prof_lines = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                       g_free, prof_line_free);
+    prof_stacks = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                        g_free, g_free);
+    prof_frames = g_array_new(FALSE, FALSE, sizeof(prof_frame));
+    prof_key = g_string_sized_new(128);
+
+    root.t0 = g_get_monotonic_time();
+    g_array_append_val(prof_frames, root);
+    profiling = 1;
+}
+
+void gretl_profile_stop (void)
+{
+    prof_frame *f;
+    gint64 now;
+
+    if (!profiling) {
+        return;
+    }
+
+    /* unwind any function calls still in progress */
+    while (prof_frames->len > 1) {
+        gretl_profile_leave();
+    }
+
+    now = g_get_monotonic_time();
+    f = top_frame();
+    frame_close_line(f, now);
+    add_stack_time(now - f->t0 - f->child);
+    prof_elapsed = now - f->t0;
+    profiling = 0;
+}
+
+void gretl_profile_enter (const char *funname)
+{
+    prof_frame f = {0};
+    prof_func *fun;
+
+    if (!profiling) {
+        return;
+    }
+
+    fun = g_hash_table_lookup(prof_funcs, funname);
+    if (fun == NULL) {
+        fun = calloc(1, sizeof *fun);
+        fun->name = gretl_strdup(funname);
+        g_hash_table_insert(prof_funcs, fun->name, fun);
+    }
+    fun->calls += 1;
+    fun->active += 1;
+
+    f.fun = fun;
+    f.t0 = g_get_monotonic_time();
+    g_array_append_val(prof_frames, f);
+}
+
+void gretl_profile_leave (void)
+{
+    prof_frame *f;
+    gint64 now, dt;
+
+    if (!profiling || prof_frames->len < 2) {
+        return;
+    }
+
+    now = g_get_monotonic_time();
+    f = top_frame();
+    frame_close_line(f, now);
+    dt = now - f->t0;
+    f->fun->self += dt - f->child;
+    f->fun->active -= 1;
+    if (f->fun->active == 0) {
+        /* don't double-count recursive calls */
+        f->fun->total += dt;
+    }
+    add_stack_time(dt - f->child);
+    g_array_set_size(prof_frames, prof_frames->len - 1);
+
+    f = top_frame();
+    f->child += dt;
+    f->lchild += dt;
+}
+
+/* Mark the start of execution of line @s, with 1-based number
+   @lineno within the current function (or 0 if not known): this
+   completes the timing of the previous line in the same frame.
+*/
+
+void gretl_profile_line (const char *s, int lineno)
+{
+    const char *where;
+    prof_frame *f;
+    prof_line *line;
+    gint64 now;
+
+    if (!profiling) {
+        return;
+    }
+
+    s += strspn(s, " \t");
+    if (*s == '\0' || *s == '\n' || *s == '#') {
+        return;
+    }
+
+    now = g_get_monotonic_time();
+    f = top_frame();
+    frame_close_line(f, now);
+
+    where = f->fun != NULL ? f->fun->name : "main";
+    g_string_printf(prof_key, "%s:%d:%s", where, lineno, s);
+    line = g_hash_table_lookup(prof_lines, prof_key->str);
+    if (line == NULL) {
+        line = calloc(1, sizeof *line);
+        line->where = where;
+        line->s = gretl_strdup(s);
+        line->lineno = lineno;
+        tailstrip(line->s);
+        g_hash_table_insert(prof_lines, g_strdup(prof_key->str), line);
+    }
+
+    line->count += 1;
+    f->line = line;
+    f->tline = g_get_monotonic_time();
+    f->lchild = 0;
+}
+
+/* Call before executing command @ci; the return value should be
+   passed to gretl_profile_command_end().
+*/
+
+gint64 gretl_profile_command_start (int ci)
+{
+    if (!profiling || ci <= 0 || ci >= NC) {
+        return 0;
+    }
+
+    prof_cmds[ci].count += 1;
+    prof_cmds[ci].active += 1;
+
+    return g_get_monotonic_time();
+}
+
+void gretl_profile_command_end (int ci, gint64 t0)
+{
+    if (!profiling || t0 == 0 || ci <= 0 || ci >= NC) {
+        return;
+    }
+
+    prof_cmds[ci].active -= 1;
+    if (prof_cmds[ci].active == 0) {
+        prof_cmds[ci].total += g_get_monotonic_time() - t0;
+    }
+}
+
+/* reporting */
+
+static gint sort_funcs (gconstpointer a, gconstpointer b)
+{
+    const prof_func *fa = *(const prof_func **) a;
+    const prof_func *fb = *(const prof_func **) b;
+
+    return (fa->self < fb->self) - (fa->self > fb->self);
+}
+
+static gint sort_lines (gconstpointer a, gconstpointer b)
+{
+    const prof_line *la = *(const prof_line **) a;
+    const prof_line *lb = *(const prof_line **) b;
+
+    return (la->self < lb->self) - (la->self > lb->self);
+}
+
+static GPtrArray *hash_values_array (GHashTable *ht)
+{
+    GPtrArray *a = g_ptr_array_sized_new(g_hash_table_size(ht));
+    GHashTableIter iter;
+    gpointer val;
+
+    g_hash_table_iter_init(&iter, ht);
+    while (g_hash_table_iter_next(&iter, NULL, &val)) {
+        g_ptr_array_add(a, val);
+    }
+
+    return a;
+}
+
+static double secs (gint64 t)
+{
+    return t / 1.0e6;
+}
+
+static double pc (gint64 t)
+{
+    return prof_elapsed > 0 ? 100.0 * t / prof_elapsed : 0.0;
+}
+
+static void print_functions (PRN *prn)
+{
+    GPtrArray *a = hash_values_array(prof_funcs);
+    int w = 8;
+    guint i;
+
+    if (a->len == 0) {
+        g_ptr_array_free(a, TRUE);
+        return;
+    }
+
+    g_ptr_array_sort(a, sort_funcs);
+    for (i=0; i<a->len; i++) {
+        prof_func *fun = a->pdata[i];
+
+        w = MAX(w, (int) strlen(fun->name));
+    }
+
+    pprintf(prn, "%s\n\n", _("User functions, by self time"));
+    pprintf(prn, "  %-*s %8s %10s %10s %7s\n", w, _("function"),
+            _("calls"), _("total"), _("self"), "%");
+    for (i=0; i<a->len; i++) {
+        prof_func *fun = a->pdata[i];
+
+        pprintf(prn, "  %-*s %8d %10.4f %10.4f %7.2f\n", w, fun->name,
+                fun->calls, secs(fun->total), secs(fun->self),
+                pc(fun->self));
+    }
+    pputc(prn, '\n');
+
+    g_ptr_array_free(a, TRUE);
+}
+
+static void print_lines (PRN *prn)
+{
+    GPtrArray *a = hash_values_array(prof_lines);
+    char loc[VNAMELEN + 16];
+    char text[PROF_LINELEN + 4];
+    int n, w = 8;
+    guint i;
+
+    if (a->len == 0) {
+        g_ptr_array_free(a, TRUE);
+        return;
+    }
+
+    g_ptr_array_sort(a, sort_lines);
+    n = MIN(a->len, PROF_MAXLINES);
+    for (i=0; i<n; i++) {
+        prof_line *line = a->pdata[i];
+
+        w = MAX(w, (int) strlen(line->where) + 6);
+    }
+    w = MIN(w, (int) sizeof loc - 1);
+
+    pprintf(prn, "%s\n\n", _("Script lines, by self time"));
+    pprintf(prn, "  %-*s %9s %10s %10s %7s  %s\n", w, _("location"),
+            _("count"), _("total"), _("self"), "%", _("line"));
+    for (i=0; i<n; i++) {
+        prof_line *line = a->pdata[i];
+
+        if (line->lineno > 0) {
+            snprintf(loc, sizeof loc, "%s:%d", line->where, line->lineno);
+        } else {
+            snprintf(loc, sizeof loc, "%s", line->where);
+        }
+        if (strlen(line->s) > PROF_LINELEN) {
+            snprintf(text, sizeof text, "%.*s...", PROF_LINELEN - 3, line->s);
+        } else {
+            strcpy(text, line->s);
+        }
+        pprintf(prn, "  %-*s %9d %10.4f %10.4f %7.2f  %s\n", w, loc,
+                line->count, secs(line->total), secs(line->self),
+                pc(line->self), text);
+    }
+    if (a->len > n) {
+        pprintf(prn, "  (%d %s)\n", (int) (a->len - n), _("more lines not shown"));
+    }
+    pputc(prn, '\n');
+
+    g_ptr_array_free(a, TRUE);
+}
+
+static void print_commands (PRN *prn)
+{
+    int order[NC];
+    int i, j, k, n = 0;
+
+    for (i=1; i<NC; i++) {
+        if (prof_cmds[i].count > 0) {
+            /* insertion sort by total time */
+            for (j=n; j>0; j--) {
+                k = order[j-1];
+                if (prof_cmds[k].total >= prof_cmds[i].total) {
+                    break;
+                }
+                order[j] = k;
+            }
+            order[j] = i;
+            n++;
+        }
+    }
+
+    if (n == 0) {
+        return;
+    }
+
+    pprintf(prn, "%s\n\n", _("Commands, by total time"));
+    pprintf(prn, "  %-12s %9s %10s %7s\n", _("command"),
+            _("count"), _("total"), "%");
+    for (j=0; j<n; j++) {
+        i = order[j];
+        pprintf(prn, "  %-12s %9d %10.4f %7.2f\n", gretl_command_word(i),
+                prof_cmds[i].count, secs(prof_cmds[i].total),
+                pc(prof_cmds[i].total));
+    }
+    pputc(prn, '\n');
+}
+
+static int write_stacks_file (const char *fname)
+{
+    GHashTableIter iter;
+    gpointer key, val;
+    FILE *fp;
+
+    fp = gretl_fopen(fname, "w");
+    if (fp == NULL) {
+        gretl_errmsg_sprintf(_("Couldn't open %s for writing"), fname);
+        return E_FOPEN;
+    }
+
+    g_hash_table_iter_init(&iter, prof_stacks);
+    while (g_hash_table_iter_next(&iter, &key, &val)) {
+        gint64 t = *(gint64 *) val;
+
+        if (t > 0) {
+            fprintf(fp, "%s %" G_GINT64_FORMAT "\n", (char *) key, t);
+        }
+    }
+
+    fclose(fp);
+
+    return 0;
+}
+
+/* Print the results of the last profiling run, if any, and write
+   the collapsed call stacks (in microseconds) to STACKS_FILE in
+   the working directory; the data are then discarded.
+*/
+
+int gretl_profile_report (PRN *prn)
+{
+    char fname[MAXLEN];
+    int err;
+
+    if (profiling) {
+        gretl_profile_stop();
+    }
+    if (prof_funcs == NULL) {
+        return 0;
+    }
+
+    pprintf(prn, "\n%s: %.4f %s\n\n", _("Profile"), secs(prof_elapsed),
+            _("seconds"));
+    print_functions(prn);
+    print_lines(prn);
+    print_commands(prn);
+
+    gretl_build_path(fname, gretl_workdir(), STACKS_FILE, NULL);
+    err = write_stacks_file(fname);
+    if (!err) {
+        pprintf(prn, "%s %s\n", _("Call stacks written to"), fname);
+    }
+
+    profile_clear();
+
+    return err;
+}
@@ -0,0 +1,41 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GRETL_PROFILE_H
+#define GRETL_PROFILE_H
+
+int gretl_profiling (void);
+
+void gretl_profile_start (void);
+
+void gretl_profile_stop (void);
+
+int gretl_profile_report (PRN *prn);
+
+void gretl_profile_enter (const char *funname);
+
+void gretl_profile_leave (void);
+
+void gretl_profile_line (const char *s, int lineno);
+
+gint64 gretl_profile_command_start (int ci);
+
+void gretl_profile_command_end (int ci, gint64 t0);
+
+#endif /* GRETL_PROFILE_H */
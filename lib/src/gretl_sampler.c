@@ -24,6 +24,8 @@
 #include "uservar.h"
 #include "libset.h"
 #include "matrix_extra.h"
+#include "gretl_task.h"
+#include "gretl_mt.h"
 #include "gretl_sampler.h"
 
 /* file-scope globals */
@@ -35,6 +37,7 @@ static int gibbs_n_temps;
 static int gibbs_burnin;
 static int gibbs_N;
 static int gibbs_thin;
+static int gibbs_chains;
 static char *gibbs_output;
 
 typedef struct gibbs_var_info_ {
@@ -102,6 +105,7 @@ static void gibbs_destroy (void)
     gibbs_burnin = 0;
     gibbs_N = 0;
     gibbs_thin = 0;
+    gibbs_chains = 0;
 }
 
 static void gibbs_mark_as_temp (const char *s)
@@ -164,9 +168,11 @@ static int gibbs_get_lhs_info (const char **psrc,
     return 0;
 }
 
-/* Write the result from the compiled @genr into row @k of the matrix
-   @H, starting at column c = *pc. Pass back in @pc the column that was
-   reached.
+/* Write the result from the compiled @genr into column @k of the
+   matrix @H, starting at row r = *pc. Pass back in @pc the row that
+   was reached. @H holds one column per recorded iteration, so that
+   each iteration writes to contiguous memory; it's transposed once
+   the sampler is done.
 */
 
 static int gibbs_record_result (GENERATOR *genr,
@@ -181,7 +187,7 @@ static int gibbs_record_result (GENERATOR *genr,
     if (gt == GRETL_TYPE_DOUBLE) {
         double gx = genr_get_output_scalar(genr);
 
-        gretl_matrix_set(H, k, c++, gx);
+        gretl_matrix_set(H, c++, k, gx);
     } else {
         gretl_matrix *gm = genr_get_output_matrix(genr);
         int j, nvals;
@@ -194,7 +200,7 @@ static int gibbs_record_result (GENERATOR *genr,
                 err = E_DATA;
             } else {
                 for (j=0; j<nvals; j++) {
-                    gretl_matrix_set(H, k, c++, gm->val[j]);
+                    gretl_matrix_set(H, c++, k, gm->val[j]);
                 }
             }
         }
@@ -420,7 +426,7 @@ static gretl_matrix *do_run_sampler (char **init, int ni,
         goto bailout;
     }
 
-    ret = gretl_matrix_alloc(nrec, ncols);
+    ret = gretl_matrix_alloc(ncols, nrec);
     if (ret == NULL) {
         *err = E_ALLOC;
         goto bailout;
@@ -461,6 +467,15 @@ static gretl_matrix *do_run_sampler (char **init, int ni,
         pputs(prn, "iteration completed\n");
     }
 
+    if (!*err) {
+        gm = gretl_matrix_copy_transpose(ret);
+        gretl_matrix_free(ret);
+        ret = gm;
+        if (ret == NULL) {
+            *err = E_ALLOC;
+        }
+    }
+
  bailout:
 
     if (genrs != NULL) {
@@ -470,9 +485,323 @@ static gretl_matrix *do_run_sampler (char **init, int ni,
         free(genrs);
     }
 
+    if (*err) {
+        gretl_matrix_free(ret);
+        ret = NULL;
+    }
+
+    return ret;
+}
+
+/* Run an additional chain, on behalf of gretl_task: the recording
+   metadata are worked out afresh and then discarded, since they're
+   the same as for the first chain.
+*/
+
+static gretl_matrix *run_extra_chain (char **init, int ni,
+                                      char **iter, int ng,
+                                      const guint8 *record,
+                                      int nr, gretlopt opt,
+                                      DATASET *dset,
+                                      PRN *prn,
+                                      int *err)
+{
+    gretl_matrix *ret = NULL;
+    gibbs_var_info *gvi;
+    guint8 *rec;
+
+    rec = malloc(ng);
+    gvi = gibbs_info_alloc(nr);
+    if (rec == NULL || gvi == NULL) {
+        *err = E_ALLOC;
+    } else {
+        memcpy(rec, record, ng);
+        ret = do_run_sampler(init, ni, iter, ng, rec, gvi,
+                             opt | OPT_Q, dset, prn, err);
+    }
+
+    free(rec);
+    gibbs_info_destroy(gvi, nr);
+
+    return ret;
+}
+
+/* Run @nc chains of the sampler. Chains 2 to @nc are started first
+   as tasks (see gretl_task.c), each of which runs in its own process
+   with its own stream of random numbers where fork() is available;
+   then the calling process runs the first chain, which determines
+   the state of the workspace on exit, as in the single-chain case.
+   The draws from the chains are stacked by rows, in order.
+*/
+
+static gretl_matrix *run_gibbs_chains (int nc, char **init, int ni,
+                                       char **iter, int ng,
+                                       guint8 *record,
+                                       gibbs_var_info *gvi,
+                                       int nr, gretlopt opt,
+                                       DATASET *dset,
+                                       PRN *prn,
+                                       int *err)
+{
+    gretl_matrix **chain = NULL;
+    gretl_matrix *ret = NULL;
+    GretlType type;
+    int *ids = NULL;
+    int k, n, terr;
+
+    if (nc < 2) {
+        return do_run_sampler(init, ni, iter, ng, record, gvi,
+                              opt, dset, prn, err);
+    }
+
+    chain = calloc(nc, sizeof *chain);
+    ids = calloc(nc, sizeof *ids);
+    if (chain == NULL || ids == NULL) {
+        *err = E_ALLOC;
+        goto bailout;
+    }
+
+    gretl_print_flush_stream(prn);
+    for (k=1; k<nc && !*err; k++) {
+        TaskRole role = TASK_PARENT;
+
+        ids[k] = gretl_task_start(&role, err);
+        if (!*err && role != TASK_PARENT) {
+            gretl_matrix *Hk;
+
+            terr = 0;
+            Hk = run_extra_chain(init, ni, iter, ng, record, nr,
+                                 opt, dset, prn, &terr);
+            gretl_task_finish(ids[k], Hk, GRETL_TYPE_MATRIX, terr);
+            /* note: not reached in the TASK_FORKED case */
+            gretl_matrix_free(Hk);
+            if (terr) {
+                /* the error is reported on collecting the task */
+                gretl_error_clear();
+            }
+        }
+    }
+
+    if (!*err) {
+        chain[0] = do_run_sampler(init, ni, iter, ng, record, gvi,
+                                  opt, dset, prn, err);
+    }
+
+    /* collect the other chains, even on error */
+    for (k=1; k<nc; k++) {
+        if (ids[k] > 0) {
+            terr = 0;
+            chain[k] = gretl_task_await(ids[k], &type, &terr);
+            if (!terr && type != GRETL_TYPE_MATRIX) {
+                terr = E_TYPES;
+            }
+            if (terr && !*err) {
+                pprintf(prn, "gibbs: chain %d failed\n", k + 1);
+                *err = terr;
+            }
+        }
+    }
+    if (*err) {
+        goto bailout;
+    }
+
+    n = chain[0]->rows;
+    for (k=1; k<nc && !*err; k++) {
+        if (chain[k]->rows != n || chain[k]->cols != chain[0]->cols) {
+            gretl_errmsg_set("gibbs: chains do not conform");
+            *err = E_DATA;
+        }
+    }
+
+    if (!*err) {
+        ret = gretl_matrix_alloc(nc * n, chain[0]->cols);
+        if (ret == NULL) {
+            *err = E_ALLOC;
+        }
+    }
+
+    if (!*err) {
+        size_t csize = n * sizeof(double);
+        double *dest = ret->val;
+        int j;
+
+        for (j=0; j<ret->cols; j++) {
+            for (k=0; k<nc; k++) {
+                memcpy(dest, chain[k]->val + (size_t) j * n, csize);
+                dest += n;
+            }
+        }
+    }
+
+ bailout:
+
+    if (chain != NULL) {
+        for (k=0; k<nc; k++) {
+            gretl_matrix_free(chain[k]);
+        }
+        free(chain);
+    }
+    free(ids);
+
     return ret;
 }
 
+/* Split-chain potential scale reduction factor (R-hat) and effective
+   sample size for the draws in column @j of @H, which holds @nc
+   chains of @n draws each, stacked by rows. See Gelman et al.,
+   Bayesian Data Analysis, 3rd edition, section 11.4-5. Each chain is
+   split in half, so R-hat is informative even given a single chain.
+   The autocorrelations are summed following Geyer's initial monotone
+   sequence estimator.
+*/
+
+static void gibbs_convergence (const gretl_matrix *H, int j,
+                               int nc, int n,
+                               double *rhat, double *ess)
+{
+    const double *x = H->val + (size_t) j * H->rows;
+    int m = 2 * nc;
+    int h = n / 2;
+    double *mu, *xc;
+    double W = 0, B = 0;
+    double mbar = 0;
+    double vplus, rho, acov;
+    double P, Pprev, tau;
+    int c, i, t;
+
+    *rhat = *ess = NADBL;
+
+    if (h < 4) {
+        return;
+    }
+
+    mu = malloc(m * sizeof *mu);
+    if (mu == NULL) {
+        return;
+    }
+
+    for (c=0; c<m; c++) {
+        /* the two halves run from 0 and n - h within the chain */
+        xc = (double *) x + (c / 2) * n + (c % 2) * (n - h);
+        mu[c] = 0;
+        for (i=0; i<h; i++) {
+            mu[c] += xc[i];
+        }
+        mu[c] /= h;
+        mbar += mu[c];
+        for (i=0; i<h; i++) {
+            W += (xc[i] - mu[c]) * (xc[i] - mu[c]);
+        }
+    }
+    W /= m * (h - 1.0);
+    mbar /= m;
+    for (c=0; c<m; c++) {
+        B += (mu[c] - mbar) * (mu[c] - mbar);
+    }
+    B /= m - 1.0; /* this is B/h in BDA's notation */
+
+    if (W <= 0) {
+        free(mu);
+        return;
+    }
+
+    vplus = (h - 1.0) / h * W + B;
+    *rhat = sqrt(vplus / W);
+
+    /* sum autocorrelations in pairs, while the pair sums are
+       positive, imposing monotonicity
+    */
+    tau = -1;
+    Pprev = 2;
+    for (t=0; t<h-1; t+=2) {
+        P = 0;
+        for (i=0; i<2; i++) {
+            int s, lag = t + i;
+
+            acov = 0;
+            for (c=0; c<m; c++) {
+                xc = (double *) x + (c / 2) * n + (c % 2) * (n - h);
+                for (s=0; s<h-lag; s++) {
+                    acov += (xc[s] - mu[c]) * (xc[s+lag] - mu[c]);
+                }
+            }
+            acov /= (double) m * h;
+            rho = 1 - (W - acov) / vplus;
+            P += rho;
+        }
+        if (P <= 0) {
+            break;
+        } else if (P > Pprev) {
+            P = Pprev;
+        }
+        tau += 2 * P;
+        Pprev = P;
+    }
+
+    *ess = m * h / tau;
+
+    free(mu);
+}
+
+/* Compute R-hat and ESS for each column of @H and add them to the
+   output bundle @b (as row vectors), printing them unless @prn is
+   NULL.
+*/
+
+static int gibbs_diagnostics (gretl_matrix *H, int nc,
+                              gibbs_var_info *gvi, int nr,
+                              gretl_bundle *b, PRN *prn)
+{
+    gretl_matrix *R, *E;
+    int n = H->rows / nc;
+    int i, j, c;
+
+    R = gretl_matrix_alloc(1, H->cols);
+    E = gretl_matrix_alloc(1, H->cols);
+    if (R == NULL || E == NULL) {
+        gretl_matrix_free(R);
+        gretl_matrix_free(E);
+        return E_ALLOC;
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) H->rows * H->cols))
+#endif
+    for (j=0; j<H->cols; j++) {
+        gibbs_convergence(H, j, nc, n, &R->val[j], &E->val[j]);
+    }
+
+    if (prn != NULL) {
+        char vname[VNAMELEN + 16];
+
+        pprintf(prn, "convergence diagnostics (%d chain%s):\n\n",
+                nc, nc > 1 ? "s" : "");
+        pprintf(prn, "  %-16s %10s %10s\n", "", "R-hat", "ESS");
+        for (i=0; i<nr; i++) {
+            for (c=0; c<gvi[i].ncols; c++) {
+                j = gvi[i].startcol + c;
+                if (gvi[i].gt == GRETL_TYPE_DOUBLE) {
+                    strcpy(vname, gvi[i].name);
+                } else {
+                    sprintf(vname, "%s[%d]", gvi[i].name, c + 1);
+                }
+                if (na(R->val[j])) {
+                    pprintf(prn, "  %-16s %10s %10s\n", vname, "NA", "NA");
+                } else {
+                    pprintf(prn, "  %-16s %10.4f %10.1f\n", vname,
+                            R->val[j], E->val[j]);
+                }
+            }
+        }
+        pputc(prn, '\n');
+    }
+
+    gretl_bundle_donate_data(b, "Rhat", R, GRETL_TYPE_MATRIX, 0);
+    gretl_bundle_donate_data(b, "ESS", E, GRETL_TYPE_MATRIX, 0);
+
+    return 0;
+}
+
 static int parse_gibbs_params (const char *s)
 {
     const char *targ[] = {
@@ -596,6 +925,7 @@ static gretl_bundle *make_gibbs_bundle (gretl_matrix *H,
     gretl_bundle_set_int(b, "burnin", gibbs_burnin);
     gretl_bundle_set_int(b, "iterations", gibbs_N);
     gretl_bundle_set_int(b, "thinning", gibbs_thin);
+    gretl_bundle_set_int(b, "chains", gibbs_chains);
 
     for (i=0; i<nr; i++) {
         /* per-variable metadata */
@@ -639,11 +969,29 @@ int gibbs_execute (gretlopt opt, DATASET *dset, PRN *prn)
 	}
     }
 
+    gibbs_chains = 1;
+    if (opt & OPT_C) {
+	int nc = get_optval_int(GIBBS, OPT_C, &err);
+
+	if (!err && nc < 1) {
+	    err = E_INVARG;
+	}
+	if (err) {
+	    gibbs_destroy();
+	    return err;
+	} else {
+	    gibbs_chains = nc;
+	}
+    }
+
     quiet = (opt & OPT_Q)? 1 : 0;
 
     if (!quiet) {
         pprintf(prn, "gibbs: burnin = %d, N = %d, thinning = %d, output %s\n",
                 gibbs_burnin, gibbs_N, gibbs_thin, gibbs_output);
+        if (gibbs_chains > 1) {
+            pprintf(prn, "running %d chains\n", gibbs_chains);
+        }
     }
 
     for (i=0; i<gibbs_n_lines && !err; i++) {
@@ -689,13 +1037,13 @@ int gibbs_execute (gretlopt opt, DATASET *dset, PRN *prn)
     }
 
     if (!err) {
-        H = do_run_sampler(init, ni, iter, ng,
-                           record, gvi, opt, dset,
-                           prn, &err);
-        if (H != NULL) {
+        H = run_gibbs_chains(gibbs_chains, init, ni, iter, ng,
+                             record, gvi, nr, opt, dset,
+                             prn, &err);
+        if (!err) {
             GB = make_gibbs_bundle(H, gvi, nr, &err);
         }
-        if (GB != NULL) {
+        if (!err) {
             err = user_var_add_or_replace(gibbs_output,
                                           GRETL_TYPE_BUNDLE,
                                           GB);
@@ -707,6 +1055,8 @@ int gibbs_execute (gretlopt opt, DATASET *dset, PRN *prn)
                 pprintf(prn, "results matrix is %d x %d\n", H->rows, H->cols);
                 gibbs_param_info(gvi, nr, H, GB, prn);
             }
+            gibbs_diagnostics(H, gibbs_chains, gvi, nr, GB,
+                              quiet ? NULL : prn);
         }
     }
 
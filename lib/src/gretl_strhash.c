@@ -0,0 +1,498 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* gretl_strhash.c: a compact hash table mapping strings to pointers,
+   used for the members of bundles and for the look-up of user
+   variables by name. It takes the place of GHashTable in those
+   roles, where tables are typically small and looked up very
+   often.
+
+   The table uses open addressing with linear probing in a single
+   array of slots whose size is a power of 2. Each slot records the
+   32-bit hash of its key alongside the key and value pointers, so
+   that a probe compares strings only when the hashes agree, and
+   the table can be grown without hashing any key twice. Deletion
+   shifts subsequent entries back into the vacated slot, so no
+   "tombstones" are needed.
+
+   The table does not copy keys: each key must remain valid for as
+   long as it is in the table (typically it lives inside the value).
+   If a destroy function is given for values, it is called when a
+   value is replaced or removed, or when the table is emptied or
+   destroyed.
+*/
+
+#include "libgretl.h"
+#include "gretl_strhash.h"
+
+#define SH_MINSIZE 8
+
+typedef struct sh_slot_ sh_slot;
+
+struct sh_slot_ {
+    guint32 hash;      /* 0 marks an empty slot */
+    const char *key;
+    void *value;
+};
+
+struct gretl_strhash_ {
+    guint32 mask;      /* number of slots minus 1 */
+    guint32 n;         /* number of entries */
+    sh_slot *slots;
+    GDestroyNotify vfree;
+};
+
+/**
+ * gretl_strhash_hash:
+ * @key: string.
+ *
+ * Returns: the hash value used for @key by gretl_strhash
+ * tables (FNV-1a, adjusted to be non-zero), as needed by
+ * gretl_strhash_lookup_hashed().
+ */
+
+guint32 gretl_strhash_hash (const char *key)
+{
+    const unsigned char *s = (const unsigned char *) key;
+    guint32 h = 2166136261u;
+
+    while (*s) {
+        h ^= *s++;
+        h *= 16777619u;
+    }
+
+    return h == 0 ? 1 : h;
+}
+
+/**
+ * gretl_strhash_new:
+ * @value_destroy: function to free values, or NULL.
+ *
+ * Returns: a newly allocated, empty table, or NULL on failure.
+ */
+
+gretl_strhash *gretl_strhash_new (GDestroyNotify value_destroy)
+{
+    gretl_strhash *h = malloc(sizeof *h);
+
+    if (h != NULL) {
+        h->slots = calloc(SH_MINSIZE, sizeof *h->slots);
+        if (h->slots == NULL) {
+            free(h);
+            return NULL;
+        }
+        h->mask = SH_MINSIZE - 1;
+        h->n = 0;
+        h->vfree = value_destroy;
+    }
+
+    return h;
+}
+
+/**
+ * gretl_strhash_remove_all:
+ * @h: table.
+ *
+ * Removes all entries from @h, destroying their values if
+ * @h has a destroy function. The capacity of @h is retained.
+ */
+
+void gretl_strhash_remove_all (gretl_strhash *h)
+{
+    guint32 i;
+
+    if (h == NULL || h->n == 0) {
+        return;
+    }
+
+    if (h->vfree != NULL) {
+        for (i=0; i<=h->mask; i++) {
+            if (h->slots[i].hash != 0) {
+                h->vfree(h->slots[i].value);
+            }
+        }
+    }
+
+    memset(h->slots, 0, (h->mask + 1) * sizeof *h->slots);
+    h->n = 0;
+}
+
+/**
+ * gretl_strhash_destroy:
+ * @h: table.
+ *
+ * Frees @h, destroying its values if it has a destroy function.
+ */
+
+void gretl_strhash_destroy (gretl_strhash *h)
+{
+    if (h != NULL) {
+        gretl_strhash_remove_all(h);
+        free(h->slots);
+        free(h);
+    }
+}
+
+/**
+ * gretl_strhash_size:
+ * @h: table.
+ *
+ * Returns: the number of entries in @h.
+ */
+
+guint gretl_strhash_size (const gretl_strhash *h)
+{
+    return h == NULL ? 0 : h->n;
+}
+
+/* Returns the index of the slot holding @key, or of the empty
+   slot at which it would be inserted.
+*/
+
+static guint32 sh_find (const gretl_strhash *h, const char *key,
+                        guint32 hash)
+{
+    guint32 i = hash & h->mask;
+
+    while (h->slots[i].hash != 0) {
+        if (h->slots[i].hash == hash && !strcmp(h->slots[i].key, key)) {
+            break;
+        }
+        i = (i + 1) & h->mask;
+    }
+
+    return i;
+}
+
+/**
+ * gretl_strhash_lookup_hashed:
+ * @h: table.
+ * @key: string.
+ * @hash: the value of gretl_strhash_hash() for @key.
+ *
+ * Variant of gretl_strhash_lookup() for use when the hash of
+ * @key is already known.
+ *
+ * Returns: the value stored under @key, or NULL if not found.
+ */
+
+void *gretl_strhash_lookup_hashed (const gretl_strhash *h,
+                                   const char *key,
+                                   guint32 hash)
+{
+    if (h == NULL || h->n == 0) {
+        return NULL;
+    } else {
+        return h->slots[sh_find(h, key, hash)].value;
+    }
+}
+
+/**
+ * gretl_strhash_lookup:
+ * @h: table.
+ * @key: string.
+ *
+ * Returns: the value stored under @key, or NULL if not found.
+ */
+
+void *gretl_strhash_lookup (const gretl_strhash *h, const char *key)
+{
+    if (h == NULL || h->n == 0) {
+        return NULL;
+    } else {
+        return h->slots[sh_find(h, key, gretl_strhash_hash(key))].value;
+    }
+}
+
+static int sh_grow (gretl_strhash *h)
+{
+    guint32 oldsize = h->mask + 1;
+    guint32 newmask = 2 * oldsize - 1;
+    sh_slot *old = h->slots;
+    sh_slot *s;
+    guint32 i, j;
+
+    s = calloc(newmask + 1, sizeof *s);
+    if (s == NULL) {
+        return E_ALLOC;
+    }
+
+    for (i=0; i<oldsize; i++) {
+        if (old[i].hash != 0) {
+            j = old[i].hash & newmask;
+            while (s[j].hash != 0) {
+                j = (j + 1) & newmask;
+            }
+            s[j] = old[i];
+        }
+    }
+
+    free(old);
+    h->slots = s;
+    h->mask = newmask;
+
+    return 0;
+}
+
+/**
+ * gretl_strhash_insert:
+ * @h: table.
+ * @key: string, which must remain valid while it is in @h.
+ * @value: non-NULL value.
+ *
+ * Stores @value under @key. If @key is already present its
+ * previous value is replaced (and destroyed, if @h has a destroy
+ * function and the value differs), and @key takes the place of
+ * the previous key pointer.
+ *
+ * Returns: 0 on success, non-zero on error.
+ */
+
+int gretl_strhash_insert (gretl_strhash *h, const char *key,
+                          void *value)
+{
+    guint32 hash, i;
+
+    if (h == NULL || key == NULL || value == NULL) {
+        return E_DATA;
+    }
+
+    hash = gretl_strhash_hash(key);
+    i = sh_find(h, key, hash);
+
+    if (h->slots[i].hash != 0) {
+        /* replacement */
+        if (h->vfree != NULL && h->slots[i].value != value) {
+            h->vfree(h->slots[i].value);
+        }
+    } else {
+        /* keep the load factor at no more than 3/4 */
+        if (4 * (h->n + 1) > 3 * (h->mask + 1)) {
+            if (sh_grow(h)) {
+                return E_ALLOC;
+            }
+            i = sh_find(h, key, hash);
+        }
+        h->slots[i].hash = hash;
+        h->n += 1;
+    }
+
+    h->slots[i].key = key;
+    h->slots[i].value = value;
+
+    return 0;
+}
+
+/* Empty slot @i, then move back any entries in the cluster that
+   follows it which would no longer be reachable from their home
+   positions.
+*/
+
+static void sh_delete_slot (gretl_strhash *h, guint32 i)
+{
+    guint32 j = i, k;
+
+    while (1) {
+        j = (j + 1) & h->mask;
+        if (h->slots[j].hash == 0) {
+            break;
+        }
+        k = h->slots[j].hash & h->mask;
+        /* move slot j back to i unless its home k lies
+           cyclically in (i, j]
+        */
+        if ((j > i && (k <= i || k > j)) ||
+            (j < i && (k <= i && k > j))) {
+            h->slots[i] = h->slots[j];
+            i = j;
+        }
+    }
+
+    h->slots[i].hash = 0;
+    h->slots[i].key = NULL;
+    h->slots[i].value = NULL;
+    h->n -= 1;
+}
+
+/**
+ * gretl_strhash_steal:
+ * @h: table.
+ * @key: string.
+ *
+ * Removes the entry for @key from @h, without destroying
+ * its value.
+ *
+ * Returns: the value that was stored under @key, or NULL if
+ * not found.
+ */
+
+void *gretl_strhash_steal (gretl_strhash *h, const char *key)
+{
+    void *ret = NULL;
+
+    if (h != NULL && h->n > 0) {
+        guint32 i = sh_find(h, key, gretl_strhash_hash(key));
+
+        if (h->slots[i].hash != 0) {
+            ret = h->slots[i].value;
+            sh_delete_slot(h, i);
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * gretl_strhash_remove:
+ * @h: table.
+ * @key: string.
+ *
+ * Removes the entry for @key from @h, destroying its value
+ * if @h has a destroy function.
+ *
+ * Returns: 1 if @key was found, otherwise 0.
+ */
+
+int gretl_strhash_remove (gretl_strhash *h, const char *key)
+{
+    void *val = gretl_strhash_steal(h, key);
+
+    if (val != NULL && h->vfree != NULL) {
+        h->vfree(val);
+    }
+
+    return val != NULL;
+}
+
+/**
+ * gretl_strhash_iter_next:
+ * @h: table.
+ * @pos: iteration state, which should be set to 0 to start.
+ * @key: location to receive key, or NULL.
+ * @value: location to receive value, or NULL.
+ *
+ * Retrieves the next entry of @h. The table must not be
+ * modified in the course of iteration.
+ *
+ * Returns: 1 if an entry was retrieved, 0 when the entries
+ * are exhausted.
+ */
+
+int gretl_strhash_iter_next (const gretl_strhash *h, guint *pos,
+                             const char **key, void **value)
+{
+    guint32 i;
+
+    if (h == NULL) {
+        return 0;
+    }
+
+    for (i=*pos; i<=h->mask; i++) {
+        if (h->slots[i].hash != 0) {
+            if (key != NULL) {
+                *key = h->slots[i].key;
+            }
+            if (value != NULL) {
+                *value = h->slots[i].value;
+            }
+            *pos = i + 1;
+            return 1;
+        }
+    }
+
+    *pos = h->mask + 1;
+
+    return 0;
+}
+
+/**
+ * gretl_strhash_foreach:
+ * @h: table.
+ * @func: function to call for each entry, with arguments
+ * key, value and @data.
+ * @data: data to pass to @func.
+ *
+ * Calls @func for each entry in @h. The table must not be
+ * modified by @func.
+ */
+
+void gretl_strhash_foreach (const gretl_strhash *h, GHFunc func,
+                            gpointer data)
+{
+    guint32 i;
+
+    if (h == NULL) {
+        return;
+    }
+
+    for (i=0; i<=h->mask; i++) {
+        if (h->slots[i].hash != 0) {
+            func((gpointer) h->slots[i].key, h->slots[i].value, data);
+        }
+    }
+}
+
+/**
+ * gretl_strhash_get_keys:
+ * @h: table.
+ *
+ * Returns: a list of the keys in @h, which should be freed
+ * with g_list_free() (but the keys themselves belong to @h),
+ * or NULL if @h is empty.
+ */
+
+GList *gretl_strhash_get_keys (const gretl_strhash *h)
+{
+    GList *L = NULL;
+    guint32 i;
+
+    if (h != NULL) {
+        for (i=0; i<=h->mask; i++) {
+            if (h->slots[i].hash != 0) {
+                L = g_list_prepend(L, (gpointer) h->slots[i].key);
+            }
+        }
+    }
+
+    return L;
+}
+
+/**
+ * gretl_strhash_get_values:
+ * @h: table.
+ *
+ * Returns: a list of the values in @h, which should be freed
+ * with g_list_free(), or NULL if @h is empty.
+ */
+
+GList *gretl_strhash_get_values (const gretl_strhash *h)
+{
+    GList *L = NULL;
+    guint32 i;
+
+    if (h != NULL) {
+        for (i=0; i<=h->mask; i++) {
+            if (h->slots[i].hash != 0) {
+                L = g_list_prepend(L, h->slots[i].value);
+            }
+        }
+    }
+
+    return L;
+}
@@ -0,0 +1,65 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GRETL_STRHASH_H
+#define GRETL_STRHASH_H
+
+typedef struct gretl_strhash_ gretl_strhash;
+
+gretl_strhash *gretl_strhash_new (GDestroyNotify value_destroy);
+
+void gretl_strhash_destroy (gretl_strhash *h);
+
+void gretl_strhash_remove_all (gretl_strhash *h);
+
+guint gretl_strhash_size (const gretl_strhash *h);
+
+guint32 gretl_strhash_hash (const char *key);
+
+void *gretl_strhash_lookup (const gretl_strhash *h,
+                            const char *key);
+
+void *gretl_strhash_lookup_hashed (const gretl_strhash *h,
+                                   const char *key,
+                                   guint32 hash);
+
+int gretl_strhash_insert (gretl_strhash *h,
+                          const char *key,
+                          void *value);
+
+void *gretl_strhash_steal (gretl_strhash *h,
+                           const char *key);
+
+int gretl_strhash_remove (gretl_strhash *h,
+                          const char *key);
+
+int gretl_strhash_iter_next (const gretl_strhash *h,
+                             guint *pos,
+                             const char **key,
+                             void **value);
+
+void gretl_strhash_foreach (const gretl_strhash *h,
+                            GHFunc func,
+                            gpointer data);
+
+GList *gretl_strhash_get_keys (const gretl_strhash *h);
+
+GList *gretl_strhash_get_values (const gretl_strhash *h);
+
+#endif /* GRETL_STRHASH_H */
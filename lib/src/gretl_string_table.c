@@ -38,6 +38,7 @@ enum {
 
 struct series_table_ {
     int n_strs;       /* number of strings in table */
+    int n_alloc;      /* allocated length of @strs */
     char **strs;      /* saved strings */
     GHashTable *ht;   /* hash table for quick lookup */
     int flags;        /* status flags (above) */
@@ -47,6 +48,7 @@ struct gretl_string_table_ {
     int *cols_list;       /* list of included columns */
     series_table **cols;  /* per-column tables (see above) */
     char *extra;          /* extra information, if any */
+    int lastpos;          /* position of last column accessed */
 };
 
 #define st_quoted(t) (t->flags & ST_QUOTED)
@@ -61,6 +63,7 @@ static series_table *series_table_alloc (void)
     if (st != NULL) {
 	st->strs = NULL;
 	st->n_strs = 0;
+	st->n_alloc = 0;
 	st->ht = g_hash_table_new(g_str_hash, g_str_equal);
 	st->flags = 0;
     }
@@ -76,6 +79,7 @@ static gretl_string_table *gretl_string_table_alloc (void)
 	gst->cols_list = NULL;
 	gst->cols = NULL;
 	gst->extra = NULL;
+	gst->lastpos = 0;
     }
 
     return gst;
@@ -284,6 +288,58 @@ static char *get_unquoted (const char *s)
     return tmp;
 }
 
+/* Ensure that @st has room for at least @n strings. The array
+   is grown geometrically, so that building a table with many
+   distinct strings one at a time is not quadratic.
+*/
+
+static int series_table_reserve (series_table *st, int n)
+{
+    if (n > st->n_alloc) {
+	int newlen = st->n_alloc < 16 ? 16 : st->n_alloc;
+	char **strs;
+
+	while (newlen < n) {
+	    newlen *= 2;
+	}
+	strs = realloc(st->strs, newlen * sizeof *strs);
+	if (strs == NULL) {
+	    return E_ALLOC;
+	}
+	st->strs = strs;
+	st->n_alloc = newlen;
+    }
+
+    return 0;
+}
+
+/* Append (a copy of) @s, which is known not to be present
+   already, and index it. Returns the 1-based index of the new
+   string, or -1 on failure.
+*/
+
+static int series_table_append (series_table *st, const char *s)
+{
+    char *cpy;
+    int n;
+
+    if (series_table_reserve(st, st->n_strs + 1)) {
+	return -1;
+    }
+
+    cpy = gretl_strdup(s);
+    if (cpy == NULL) {
+	return -1;
+    }
+
+    n = st->n_strs + 1;
+    st->strs[n-1] = cpy;
+    st->n_strs = n;
+    g_hash_table_insert(st->ht, (gpointer) cpy, GINT_TO_POINTER(n));
+
+    return n;
+}
+
 /**
  * series_table_add_string:
  * @st: a gretl series table.
@@ -296,7 +352,7 @@ static char *get_unquoted (const char *s)
 int series_table_add_string (series_table *st, const char *s)
 {
     char *tmp = NULL;
-    int n, err;
+    int n;
 
     if (s == NULL) {
 	return -1;
@@ -308,18 +364,10 @@ int series_table_add_string (series_table *st, const char *s)
 
     if (tmp != NULL) {
 	st->flags |= ST_QUOTED;
-	err = strings_array_add(&st->strs, &st->n_strs, tmp);
+	n = series_table_append(st, tmp);
 	free(tmp);
     } else {
-	err = strings_array_add(&st->strs, &st->n_strs, s);
-    }
-
-    if (err) {
-	n = -1;
-    } else {
-	n = st->n_strs;
-	g_hash_table_insert(st->ht, (gpointer) st->strs[n-1],
-			    GINT_TO_POINTER(n));
+	n = series_table_append(st, s);
     }
 
     return n;
@@ -349,12 +397,9 @@ int series_table_add_strings (series_table *st,
 
     oldn = st->n_strs;
     newn = oldn + ns;
-    st->strs = strings_array_realloc_with_length(&st->strs,
-						 oldn, newn,
-						 0);
-    if (st->strs == NULL) {
-	err = E_ALLOC;
-    } else {
+    err = series_table_reserve(st, newn);
+
+    if (!err) {
 	st->n_strs = newn;
 	for (i=0, j=oldn; i<ns; i++, j++) {
 	    st->strs[j] = gretl_strdup(S[i]);
@@ -374,7 +419,7 @@ series_table *series_table_new (char **strs, int n_strs, int *err)
     if (st == NULL || strs == NULL) {
 	*err = E_ALLOC;
     } else {
-	st->n_strs = n_strs;
+	st->n_strs = st->n_alloc = n_strs;
 	st->strs = strs;
 	for (i=0; i<n_strs; i++) {
 	    if (st->strs[i] == NULL) {
@@ -406,7 +451,7 @@ series_table *series_table_copy (series_table *st)
 	    series_table_destroy(ret);
 	    ret = NULL;
 	} else {
-	    ret->n_strs = st->n_strs;
+	    ret->n_strs = ret->n_alloc = st->n_strs;
 	    ret->strs = S;
 	    for (i=0; i<ret->n_strs; i++) {
 		g_hash_table_insert(ret->ht, (gpointer) ret->strs[i],
@@ -484,10 +529,18 @@ gretl_string_table_index (gretl_string_table *gst, const char *s,
     }
 
     if (gst->cols_list != NULL) {
-	for (i=1; i<=gst->cols_list[0]; i++) {
-	    if (gst->cols_list[i] == col) {
-		st = gst->cols[i-1];
-		break;
+	/* when reading data, successive calls are very likely
+	   to hit the same column, so check that first */
+	i = gst->lastpos;
+	if (i > 0 && i <= gst->cols_list[0] && gst->cols_list[i] == col) {
+	    st = gst->cols[i-1];
+	} else {
+	    for (i=1; i<=gst->cols_list[0]; i++) {
+		if (gst->cols_list[i] == col) {
+		    st = gst->cols[i-1];
+		    gst->lastpos = i;
+		    break;
+		}
 	    }
 	}
     }
@@ -509,7 +562,13 @@ gretl_string_table_index (gretl_string_table *gst, const char *s,
     }
 
     if (idx == 0 && st != NULL) {
-	idx = series_table_add_string(st, s);
+	if (tmp != NULL) {
+	    /* already unquoted */
+	    st->flags |= ST_QUOTED;
+	    idx = series_table_append(st, tmp);
+	} else {
+	    idx = series_table_add_string(st, s);
+	}
     }
 
     free(tmp);
@@ -562,6 +621,25 @@ series_table *gretl_string_table_detach_col (gretl_string_table *gst,
     return st;
 }
 
+/* Access the table for column @col without disturbing the
+   state of @gst, so that an importer can fill the tables for
+   distinct columns concurrently.
+*/
+
+series_table *gretl_string_table_get_column (gretl_string_table *gst,
+					     int col)
+{
+    if (gst != NULL) {
+	int pos = in_gretl_list(gst->cols_list, col);
+
+	if (pos > 0) {
+	    return gst->cols[pos-1];
+	}
+    }
+
+    return NULL;
+}
+
 int in_string_table (gretl_string_table *gst, int id)
 {
     if (gst != NULL) {
@@ -42,6 +42,9 @@ int gretl_string_table_reset_column_id (gretl_string_table *gst,
 series_table *gretl_string_table_detach_col (gretl_string_table *gst,
 					     int col);
 
+series_table *gretl_string_table_get_column (gretl_string_table *gst,
+					     int col);
+
 int in_string_table (gretl_string_table *gst, int id);
 
 int *string_table_copy_list (gretl_string_table *gst);
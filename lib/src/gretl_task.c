@@ -0,0 +1,525 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* gretl_task.c: asynchronous calls to user functions, as in
+
+     t = spawn("fname", arg1, arg2)
+     ...
+     matrix m = await(t)
+
+   The state of the hansl interpreter is global to the process, so
+   as with the --parallel option to a progressive loop each task is
+   run in a process created via fork(). The number of tasks running
+   at any one time is limited to the size of the pool -- by default,
+   the number of physical cores -- by means of a pipe holding one
+   token per pool slot, in the manner of the "make" jobserver: the
+   child process for a task takes a token before calling the
+   function and gives it back when done, so that any slot that
+   falls idle is taken immediately by the next task waiting. Each
+   task is limited to its share of the cores for OpenMP and BLAS
+   purposes, so the machine is not oversubscribed.
+
+   A task writes its result (or error) to a bundle file in the
+   user's dotdir, from which it is retrieved by await(). Where
+   fork() is not available, in the GUI program, when profiling and
+   within a task, the function call is executed right away and its
+   result stored until it is awaited.
+*/
+
+#include "libgretl.h"
+#include "libset.h"
+#include "gretl_mt.h"
+#include "gretl_func.h"
+#include "gretl_bundle.h"
+#include "gretl_array.h"
+#include "gretl_profile.h"
+#include "gretl_trace.h"
+#include "random.h"
+#include "gretl_task.h"
+
+#ifndef WIN32
+# include <sys/wait.h>
+# include <signal.h>
+# include <fcntl.h>
+# include <errno.h>
+#endif
+
+/* maximum number of unfinished task processes, per pool slot */
+#define TASK_BACKLOG 4
+
+typedef struct task_ task;
+
+struct task_ {
+    int id;            /* identifier, as seen by the user */
+    int pid;           /* process ID, or 0 if not forked */
+    int exited;        /* forked process has been reaped? */
+    gretl_bundle *res; /* stored result, if not forked */
+};
+
+static task *tasks;
+static int n_tasks;
+static int next_task_id = 1;
+static int pool_size;
+static int in_task;
+static int owner_pid;
+static int forked_id; /* ID of the task run by this process, if any */
+
+#ifndef WIN32
+static int tokens[2] = {-1, -1};
+#endif
+
+/**
+ * gretl_task_pool_size:
+ *
+ * Returns: the maximum number of tasks that are run concurrently,
+ * namely the number of physical cores.
+ */
+
+int gretl_task_pool_size (void)
+{
+    if (pool_size == 0) {
+        pool_size = gretl_n_physical_cores();
+        if (pool_size < 1) {
+            pool_size = 1;
+        }
+    }
+
+    return pool_size;
+}
+
+static task *get_task_by_id (int id)
+{
+    int i;
+
+    for (i=0; i<n_tasks; i++) {
+        if (tasks[i].id == id) {
+            return &tasks[i];
+        }
+    }
+
+    return NULL;
+}
+
+static void remove_task (task *t)
+{
+    int i = t - tasks;
+
+    gretl_bundle_destroy(t->res);
+    if (i < n_tasks - 1) {
+        memmove(tasks + i, tasks + i + 1, (n_tasks - i - 1) * sizeof *tasks);
+    }
+    n_tasks--;
+}
+
+static task *add_task (int *err)
+{
+    task *tmp = realloc(tasks, (n_tasks + 1) * sizeof *tasks);
+    task *t;
+
+    if (tmp == NULL) {
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    tasks = tmp;
+    t = &tasks[n_tasks++];
+    t->id = next_task_id++;
+    t->pid = 0;
+    t->exited = 0;
+    t->res = NULL;
+
+    return t;
+}
+
+static void task_filename (char *fname, int id)
+{
+    sprintf(fname, "task_%d_%d.xml", owner_pid, id);
+}
+
+/* Put together and return the bundle that records the outcome of
+   a task: an error code and message, plus the return value of the
+   function if all went well.
+*/
+
+static gretl_bundle *task_result_bundle (void *data, GretlType type,
+                                         int err)
+{
+    gretl_bundle *b = gretl_bundle_new();
+
+    if (b == NULL) {
+        return NULL;
+    }
+
+    if (!err && data != NULL) {
+        err = gretl_bundle_set_data(b, "value", data, type, 0);
+    }
+    gretl_bundle_set_int(b, "err", err);
+    if (err) {
+        const char *msg = gretl_errmsg_get();
+
+        gretl_bundle_set_string(b, "errmsg", (msg != NULL && *msg != '\0') ?
+                                msg : errmsg_get_with_default(err));
+    }
+
+    return b;
+}
+
+#ifndef WIN32
+
+static int task_pool_init (void)
+{
+    int i, n = gretl_task_pool_size();
+
+    if (tokens[0] >= 0) {
+        return 0;
+    } else if (pipe(tokens) != 0) {
+        return E_EXTERNAL;
+    }
+
+    for (i=0; i<n; i++) {
+        if (write(tokens[1], "+", 1) != 1) {
+            close(tokens[0]);
+            close(tokens[1]);
+            tokens[0] = tokens[1] = -1;
+            return E_EXTERNAL;
+        }
+    }
+
+    return 0;
+}
+
+static void take_token (void)
+{
+    char c;
+
+    while (read(tokens[0], &c, 1) < 0 && errno == EINTR) {
+        ;
+    }
+}
+
+static void give_token (void)
+{
+    while (write(tokens[1], "+", 1) < 0 && errno == EINTR) {
+        ;
+    }
+}
+
+/* Wait for the process running task @t to exit. A task process
+   that gets as far as gretl_task_finish() gives back its token and
+   exits with status 0 or 1; otherwise the token is lost, so we put
+   it back.
+*/
+
+static void reap_task (task *t)
+{
+    int status = 0;
+
+    while (waitpid((pid_t) t->pid, &status, 0) < 0 && errno == EINTR) {
+        ;
+    }
+    if (!WIFEXITED(status) || WEXITSTATUS(status) > 1) {
+        give_token();
+    }
+    t->exited = 1;
+}
+
+/* Don't let the number of unfinished task processes grow without
+   limit: if need be, wait for the oldest one to exit.
+*/
+
+static void limit_backlog (void)
+{
+    int i, n = 0;
+
+    for (i=0; i<n_tasks; i++) {
+        if (tasks[i].pid > 0 && !tasks[i].exited) {
+            n++;
+        }
+    }
+
+    if (n >= TASK_BACKLOG * pool_size) {
+        for (i=0; i<n_tasks; i++) {
+            if (tasks[i].pid > 0 && !tasks[i].exited) {
+                reap_task(&tasks[i]);
+                break;
+            }
+        }
+    }
+}
+
+/* In a newly forked task process: limit this process to its share
+   of the cores and give it its own stream of random numbers.
+*/
+
+static void task_process_init (int id)
+{
+    int nt = gretl_n_physical_cores() / pool_size;
+    int fd = open("/dev/null", O_WRONLY);
+
+    if (fd >= 0) {
+        dup2(fd, STDOUT_FILENO);
+        close(fd);
+    }
+
+    if (nt < 1) {
+        nt = 1;
+    }
+#if defined(_OPENMP)
+    gretl_set_omp_threads(nt);
+#else
+    if (blas_is_threaded()) {
+        blas_set_num_threads(nt);
+    }
+#endif
+
+    gretl_rand_jump(id);
+    in_task = 1;
+    forked_id = id;
+}
+
+#endif /* !WIN32 */
+
+static int task_runs_inline (void)
+{
+#ifdef WIN32
+    return 1;
+#else
+    return in_task || gretl_in_gui_mode() || gretl_profiling() ||
+        gretl_tracing();
+#endif
+}
+
+/**
+ * gretl_task_start:
+ * @role: location to receive the role of the caller.
+ * @err: location to receive error code.
+ *
+ * Registers a new task and, if possible, forks a process to
+ * run it. On return @role is %TASK_PARENT if the caller should
+ * just carry on (the task is running elsewhere), %TASK_FORKED
+ * if the caller is the new process and should run the task, or
+ * %TASK_INLINE if the caller should run the task straight away.
+ * In the latter two cases the caller must then pass the result
+ * to gretl_task_finish().
+ *
+ * Returns: the ID of the task, or 0 on error.
+ */
+
+int gretl_task_start (TaskRole *role, int *err)
+{
+    task *t;
+
+    if (owner_pid == 0) {
+        owner_pid = (int) getpid();
+    }
+
+    t = add_task(err);
+    if (t == NULL) {
+        return 0;
+    }
+
+    *role = TASK_INLINE;
+
+#ifndef WIN32
+    if (!task_runs_inline() && task_pool_init() == 0) {
+        int id = t->id;
+        pid_t pid;
+
+        limit_backlog();
+        fflush(NULL);
+        pid = fork();
+        if (pid == 0) {
+            task_process_init(id);
+            take_token();
+            *role = TASK_FORKED;
+        } else if (pid > 0) {
+            t->pid = (int) pid;
+            *role = TASK_PARENT;
+        } else {
+            fprintf(stderr, "spawn: fork failed, running task %d inline\n", id);
+        }
+        return id;
+    }
+#endif
+
+    return t->id;
+}
+
+/**
+ * gretl_task_finish:
+ * @id: ID of task.
+ * @data: the value returned by the task's function, or NULL.
+ * @type: the type of @data.
+ * @err: error code from the task's function.
+ *
+ * Records the outcome of task @id, in response to %TASK_FORKED or
+ * %TASK_INLINE from gretl_task_start(). In the forked case this
+ * function does not return: the outcome is written to file and
+ * the process exits.
+ */
+
+void gretl_task_finish (int id, void *data, GretlType type, int err)
+{
+    gretl_bundle *b = task_result_bundle(data, type, err);
+    task *t;
+
+#ifndef WIN32
+    if (id == forked_id) {
+        char fname[64];
+        int ok = 0;
+
+        task_filename(fname, id);
+        if (b != NULL) {
+            ok = gretl_bundle_write_to_file(b, fname, 1) == 0;
+        }
+        give_token();
+        _exit(ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+#endif
+
+    t = get_task_by_id(id);
+    if (t != NULL) {
+        t->res = b;
+    } else {
+        gretl_bundle_destroy(b);
+    }
+}
+
+/**
+ * gretl_task_await:
+ * @id: ID of task.
+ * @type: location to receive the type of the return value.
+ * @err: location to receive error code.
+ *
+ * Waits for task @id to complete, and then forgets about it.
+ *
+ * Returns: the value returned by the task's function, which
+ * becomes the property of the caller, or NULL on failure.
+ */
+
+void *gretl_task_await (int id, GretlType *type, int *err)
+{
+    task *t = get_task_by_id(id);
+    gretl_bundle *b = NULL;
+    void *ret = NULL;
+    int terr;
+
+    if (t == NULL) {
+        gretl_errmsg_sprintf(_("await: no pending task with ID %d"), id);
+        *err = E_DATA;
+        return NULL;
+    }
+
+#ifndef WIN32
+    if (t->pid > 0) {
+        char fname[64];
+        gchar *path;
+
+        if (!t->exited) {
+            reap_task(t);
+        }
+        task_filename(fname, id);
+        path = gretl_make_dotpath(fname);
+        b = gretl_bundle_read_from_file(path, 0, err);
+        gretl_remove(path);
+        g_free(path);
+        if (*err) {
+            gretl_error_clear();
+            gretl_errmsg_sprintf(_("await: task %d failed"), id);
+            *err = E_EXTERNAL;
+        }
+    } else {
+        b = t->res;
+        t->res = NULL;
+    }
+#else
+    b = t->res;
+    t->res = NULL;
+#endif
+
+    remove_task(t);
+
+    if (b == NULL) {
+        if (!*err) {
+            *err = E_ALLOC;
+        }
+        return NULL;
+    }
+
+    terr = gretl_bundle_get_int(b, "err", NULL);
+    if (terr) {
+        const char *msg = gretl_bundle_get_string(b, "errmsg", NULL);
+
+        if (msg != NULL) {
+            gretl_errmsg_set(msg);
+        }
+        *err = terr;
+    } else {
+        ret = gretl_bundle_steal_data(b, "value", type, NULL, err);
+    }
+
+    gretl_bundle_destroy(b);
+
+    return ret;
+}
+
+/**
+ * gretl_tasks_cleanup:
+ *
+ * Terminates any task processes that are still running and
+ * frees the record of tasks not awaited.
+ */
+
+void gretl_tasks_cleanup (void)
+{
+    int i;
+
+#ifndef WIN32
+    if (in_task) {
+        return;
+    }
+    for (i=0; i<n_tasks; i++) {
+        if (tasks[i].pid > 0) {
+            char fname[64];
+            gchar *path;
+
+            if (!tasks[i].exited) {
+                kill((pid_t) tasks[i].pid, SIGKILL);
+                waitpid((pid_t) tasks[i].pid, NULL, 0);
+            }
+            task_filename(fname, tasks[i].id);
+            path = gretl_make_dotpath(fname);
+            gretl_remove(path);
+            g_free(path);
+        }
+    }
+    if (tokens[0] >= 0) {
+        close(tokens[0]);
+        close(tokens[1]);
+        tokens[0] = tokens[1] = -1;
+    }
+#endif
+
+    for (i=0; i<n_tasks; i++) {
+        gretl_bundle_destroy(tasks[i].res);
+    }
+    free(tasks);
+    tasks = NULL;
+    n_tasks = 0;
+}
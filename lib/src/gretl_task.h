@@ -0,0 +1,39 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GRETL_TASK_H
+#define GRETL_TASK_H
+
+typedef enum {
+    TASK_PARENT, /* task is running in another process */
+    TASK_FORKED, /* we're the process created to run the task */
+    TASK_INLINE  /* the task is to be run right away */
+} TaskRole;
+
+int gretl_task_pool_size (void);
+
+int gretl_task_start (TaskRole *role, int *err);
+
+void gretl_task_finish (int id, void *data, GretlType type, int err);
+
+void *gretl_task_await (int id, GretlType *type, int *err);
+
+void gretl_tasks_cleanup (void);
+
+#endif /* GRETL_TASK_H */
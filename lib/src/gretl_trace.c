@@ -0,0 +1,187 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* gretl_trace.c: timing trace of script execution, switched on via
+   "set trace <filename>" or "gretlcli --trace=<filename>". Each
+   command executed, each call to a user function and each batch of
+   TRACE_LOOP_BATCH loop iterations gives rise to a pair of begin
+   and end events in the Trace Event format of the Chrome browser,
+   which can be loaded into Perfetto or chrome://tracing. Events are
+   written as they occur, so a trace that is cut short by a crash
+   can still be read, given a closing bracket.
+*/
+
+#include "libgretl.h"
+#include "gretl_mt.h"
+#include "version.h"
+#include "gretl_trace.h"
+
+static FILE *trace_fp;
+static gint64 trace_t0;
+static int trace_nev;
+
+int gretl_tracing (void)
+{
+    return trace_fp != NULL;
+}
+
+static void trace_event_start (char ph, const char *cat,
+                               const char *name)
+{
+    gint64 ts = g_get_monotonic_time() - trace_t0;
+
+    if (trace_nev++ > 0) {
+        fputs(",\n", trace_fp);
+    }
+    fprintf(trace_fp, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"%c\","
+            "\"ts\":%" G_GINT64_FORMAT ",\"pid\":1,\"tid\":1",
+            name, cat, ph, ts);
+}
+
+/* arguments common to all "begin" events */
+
+static void trace_print_state (const DATASET *dset)
+{
+    fprintf(trace_fp, "\"threads\":%d", gretl_get_omp_threads());
+    if (dset != NULL && dset->Z != NULL) {
+        fprintf(trace_fp, ",\"nvars\":%d,\"nobs\":%d,\"sample\":%d",
+                dset->v, dset->n, dset->t2 - dset->t1 + 1);
+    }
+}
+
+/**
+ * gretl_trace_start:
+ * @fname: name of file to write.
+ *
+ * Starts a timing trace, to be written to @fname (relative to
+ * the working directory, if not an absolute path). Any trace
+ * already in progress is completed first.
+ *
+ * Returns: 0 on success, %E_FOPEN if @fname cannot be written.
+ */
+
+int gretl_trace_start (const char *fname)
+{
+    char outname[FILENAME_MAX];
+
+    gretl_trace_stop();
+
+    strcpy(outname, fname);
+    gretl_maybe_prepend_dir(outname);
+    trace_fp = gretl_fopen(outname, "w");
+    if (trace_fp == NULL) {
+        gretl_errmsg_sprintf(_("Couldn't write to %s"), outname);
+        return E_FOPEN;
+    }
+
+    trace_t0 = g_get_monotonic_time();
+    trace_nev = 0;
+    fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", trace_fp);
+    trace_event_start('M', "__metadata", "process_name");
+    fprintf(trace_fp, ",\"args\":{\"name\":\"gretl %s\"}}", GRETL_VERSION);
+
+    return 0;
+}
+
+/**
+ * gretl_trace_stop:
+ *
+ * Completes and closes the trace file, if a trace is in
+ * progress.
+ *
+ * Returns: 0 on success, %E_FOPEN on error writing the file.
+ */
+
+int gretl_trace_stop (void)
+{
+    int err = 0;
+
+    if (trace_fp != NULL) {
+        fputs("\n]}\n", trace_fp);
+        if (fclose(trace_fp) != 0) {
+            err = E_FOPEN;
+        }
+        trace_fp = NULL;
+    }
+
+    return err;
+}
+
+void gretl_trace_command_begin (int ci, const DATASET *dset)
+{
+    if (trace_fp != NULL) {
+        trace_event_start('B', "command", gretl_command_word(ci));
+        fprintf(trace_fp, ",\"args\":{\"ci\":%d,", ci);
+        trace_print_state(dset);
+        fputs("}}", trace_fp);
+    }
+}
+
+void gretl_trace_command_end (int ci, int err)
+{
+    if (trace_fp != NULL) {
+        trace_event_start('E', "command", gretl_command_word(ci));
+        if (err) {
+            fprintf(trace_fp, ",\"args\":{\"err\":%d}", err);
+        }
+        fputc('}', trace_fp);
+    }
+}
+
+void gretl_trace_function_begin (const char *funname,
+                                 const DATASET *dset)
+{
+    if (trace_fp != NULL) {
+        trace_event_start('B', "function", funname);
+        fputs(",\"args\":{", trace_fp);
+        trace_print_state(dset);
+        fputs("}}", trace_fp);
+    }
+}
+
+void gretl_trace_function_end (const char *funname)
+{
+    if (trace_fp != NULL) {
+        trace_event_start('E', "function", funname);
+        fputc('}', trace_fp);
+    }
+}
+
+/* @iter is the (1-based) index of the first iteration in the
+   batch */
+
+void gretl_trace_loop_begin (int iter, const DATASET *dset)
+{
+    if (trace_fp != NULL) {
+        trace_event_start('B', "loop", "loop");
+        fprintf(trace_fp, ",\"args\":{\"iter\":%d,", iter);
+        trace_print_state(dset);
+        fputs("}}", trace_fp);
+    }
+}
+
+/* @iter is the number of iterations completed so far */
+
+void gretl_trace_loop_end (int iter)
+{
+    if (trace_fp != NULL) {
+        trace_event_start('E', "loop", "loop");
+        fprintf(trace_fp, ",\"args\":{\"done\":%d}}", iter);
+    }
+}
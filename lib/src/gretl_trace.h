@@ -0,0 +1,45 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef GRETL_TRACE_H
+#define GRETL_TRACE_H
+
+/* number of loop iterations covered by one trace event */
+#define TRACE_LOOP_BATCH 100
+
+int gretl_tracing (void);
+
+int gretl_trace_start (const char *fname);
+
+int gretl_trace_stop (void);
+
+void gretl_trace_command_begin (int ci, const DATASET *dset);
+
+void gretl_trace_command_end (int ci, int err);
+
+void gretl_trace_function_begin (const char *funname,
+                                 const DATASET *dset);
+
+void gretl_trace_function_end (const char *funname);
+
+void gretl_trace_loop_begin (int iter, const DATASET *dset);
+
+void gretl_trace_loop_end (int iter);
+
+#endif /* GRETL_TRACE_H */
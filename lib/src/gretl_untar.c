@@ -28,6 +28,7 @@
 #define CONTTYPE '7'		/* reserved */
 
 #define BLOCKSIZE 512
+#define CHUNKBLOCKS 128 /* file content is read 64K at a time */
 
 struct tar_header
 {				/* byte offset */
@@ -82,8 +83,9 @@ static int getoct (char *p, int width)
 static int untar (gzFile in)
 {
     union tar_buffer buffer;
+    char *chunk = NULL;
     int getheader = 1;
-    int len, remaining = 0;
+    int len, want, remaining = 0;
     FILE *outfile = NULL;
     char fname[BLOCKSIZE];
     int verbose = 0;
@@ -91,15 +93,30 @@ static int untar (gzFile in)
     time_t tartime = (time_t) 0;
     int err = 0;
 
+    chunk = malloc(CHUNKBLOCKS * BLOCKSIZE);
+    if (chunk == NULL) {
+	return E_ALLOC;
+    }
+
     while (!err) {
-	len = gzread(in, &buffer, BLOCKSIZE);
+	if (getheader) {
+	    want = BLOCKSIZE;
+	    len = gzread(in, &buffer, want);
+	} else {
+	    /* read as many whole blocks of content as we can */
+	    want = (remaining + BLOCKSIZE - 1) / BLOCKSIZE;
+	    want = (want > CHUNKBLOCKS ? CHUNKBLOCKS : want) * BLOCKSIZE;
+	    len = gzread(in, chunk, want);
+	}
 
 	if (len < 0) {
 	    gretl_errmsg_set(gzerror(in, &err));
-	    return E_FOPEN;
-	} else if (len != BLOCKSIZE) {
+	    err = E_FOPEN;
+	    break;
+	} else if (len != want) {
 	    gretl_errmsg_set("gzread: incomplete block read");
-	    return E_DATA;
+	    err = E_DATA;
+	    break;
 	}
 
 	if (getheader == 1) {
@@ -144,12 +161,13 @@ static int untar (gzFile in)
 		break;
 	    }
 	} else {
-	    unsigned bytes = (remaining > BLOCKSIZE) ? BLOCKSIZE : remaining;
+	    unsigned bytes = (remaining > len) ? len : remaining;
 
 	    if (outfile != NULL) {
-		if (fwrite(&buffer, 1, bytes, outfile) != bytes) {
+		if (fwrite(chunk, 1, bytes, outfile) != bytes) {
 		    fprintf(stderr, "error writing to %s\n", fname);
 		    fclose(outfile);
+		    outfile = NULL;
 		    gretl_remove(fname);
 		    err = E_DATA;
 		    break;
@@ -171,6 +189,11 @@ static int untar (gzFile in)
 	}
     }
 
+    if (outfile != NULL) {
+	fclose(outfile);
+    }
+    free(chunk);
+
     return err;
 }
 
@@ -183,6 +206,7 @@ int gretl_untar (const char *fname)
 	gretl_errmsg_sprintf("Couldn't gzopen %s", fname);
 	err = E_FOPEN;
     } else {
+	gzbuffer(fz, 262144);
 	err = untar(fz);
 	gzclose(fz);
     }
@@ -31,6 +31,10 @@
 #include "gretl_xml.h"
 #include "forecast.h"
 #include "gretl_typemap.h"
+#include "gretl_cmatrix.h"
+#include "gretl_task.h"
+#include "gretl_trace.h"
+#include "dbread.h"
 
 #ifdef USE_CURL
 # include "gretl_www.h"
@@ -67,6 +71,8 @@
 #endif
 
 static void gretl_tests_cleanup (void);
+static int tests_thread_init (void);
+static void tests_thread_cleanup (void);
 
 /**
  * date_as_double:
@@ -2450,6 +2456,7 @@ static char blas_parallel[32];
 static char blas_version[32];
 
 static int blas_variant;
+static int blas_ldd_pending;
 
 #if !defined(WIN32)
 
@@ -2593,6 +2600,25 @@ static int detect_blas_via_ldd (void)
 
 #endif /* neither Windows nor Mac */
 
+/* When the BLAS in use can't be identified from its exported
+   symbols, blas_init() leaves it to be identified via ldd (or
+   otool), which costs a process spawn at every startup. So that's
+   put off until the variant is actually wanted, as in reporting.
+   A BLAS whose threading we can control is always found via its
+   symbols, so blas_is_threaded() doesn't need to wait for this.
+*/
+
+static int get_blas_variant (void)
+{
+#ifndef WIN32
+    if (blas_ldd_pending) {
+        blas_ldd_pending = 0;
+        blas_variant = detect_blas_via_ldd();
+    }
+#endif
+    return blas_variant;
+}
+
 static void (*OB_set_num_threads) (int);
 static int (*OB_get_num_threads) (void);
 static void (*BLIS_set_num_threads) (int);
@@ -2851,6 +2877,8 @@ static void libflame_utils (void *handle)
 
 int get_blas_details (char **s1, char **s2, char **s3)
 {
+    get_blas_variant();
+
     if (*blas_core == '\0' || *blas_parallel == '\0') {
         return 0;
     } else {
@@ -2884,17 +2912,19 @@ int get_stack_size (void)
 
 const char *blas_variant_string (void)
 {
-    if (blas_variant == BLAS_NETLIB) {
+    int v = get_blas_variant();
+
+    if (v == BLAS_NETLIB) {
         return "netlib";
-    } else if (blas_variant == BLAS_ATLAS) {
+    } else if (v == BLAS_ATLAS) {
         return "atlas";
-    } else if (blas_variant == BLAS_OPENBLAS) {
+    } else if (v == BLAS_OPENBLAS) {
         return "openblas";
-    } else if (blas_variant == BLAS_MKL) {
+    } else if (v == BLAS_MKL) {
         return "mkl";
-    } else if (blas_variant == BLAS_VECLIB) {
+    } else if (v == BLAS_VECLIB) {
         return "veclib";
-    } else if (blas_variant == BLAS_BLIS) {
+    } else if (v == BLAS_BLIS) {
         return "blis";
     } else {
         return "unknown";
@@ -2903,7 +2933,7 @@ const char *blas_variant_string (void)
 
 int blas_is_openblas (void)
 {
-    return blas_variant == BLAS_OPENBLAS;
+    return get_blas_variant() == BLAS_OPENBLAS;
 }
 
 /* for gretl_matrix.c, gretl_mt.c */
@@ -2998,7 +3028,8 @@ static void blas_init (void)
 # ifndef WIN32
  try_ldd:
     if (blas_variant == BLAS_UNKNOWN) {
-        blas_variant = detect_blas_via_ldd();
+        /* see get_blas_variant() */
+        blas_ldd_pending = 1;
     }
 # endif
 #endif /* not (__APPLE__ && PKGBUILD) */
@@ -3149,15 +3180,63 @@ int avx_support (void)
  * used. See also libgretl_cleanup(), and libgretl_mpi_init().
  **/
 
+/* Timing of the stages of program startup, as shown by gretlcli
+   --startup-times. The first call to gretl_startup_mark() fixes the
+   origin; a call with NULL @stage does only that.
+*/
+
+#define N_STARTUP_MARKS 16
+
+static const char *startup_stage[N_STARTUP_MARKS];
+static gint64 startup_usec[N_STARTUP_MARKS];
+static gint64 startup_t0;
+static int n_startup_marks;
+
+void gretl_startup_mark (const char *stage)
+{
+    gint64 now = g_get_monotonic_time();
+
+    if (startup_t0 == 0) {
+        startup_t0 = now;
+    }
+    if (stage != NULL && n_startup_marks < N_STARTUP_MARKS) {
+        startup_stage[n_startup_marks] = stage;
+        startup_usec[n_startup_marks] = now;
+        n_startup_marks++;
+    }
+}
+
+/* print the time taken by each stage recorded so far, in
+   milliseconds */
+
+void gretl_startup_report (FILE *fp)
+{
+    gint64 prev = startup_t0;
+    int i;
+
+    fputs("startup times (ms):\n", fp);
+    for (i=0; i<n_startup_marks; i++) {
+        fprintf(fp, "  %-16s %8.3f\n", startup_stage[i],
+                (startup_usec[i] - prev) / 1000.0);
+        prev = startup_usec[i];
+    }
+    fprintf(fp, "  %-16s %8.3f\n", "total",
+            (prev - startup_t0) / 1000.0);
+}
+
 void libgretl_init (void)
 {
+    gretl_startup_mark(NULL);
     libset_init();
+    gretl_startup_mark("libset");
     gretl_rand_init();
     gretl_xml_init();
     gretl_stopwatch_init();
+    gretl_startup_mark("rng, xml");
     if (!gretl_in_tool_mode()) {
         blas_init();
         num_threads_init(blas_variant);
+        gretl_startup_mark("blas, threads");
     }
 #if HAVE_GMP
     mpf_set_default_prec(get_mp_bits());
@@ -3320,6 +3399,124 @@ void libgretl_session_cleanup (int mode)
     }
 }
 
+/* Records whether the calling thread has an interpreter context
+   of its own, installed by libgretl_thread_init().
+*/
+
+static int thread_ctx;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(thread_ctx)
+#endif
+
+static void thread_context_free (void)
+{
+    gretl_objects_thread_cleanup();
+    uservar_thread_cleanup();
+    gretl_functions_thread_cleanup();
+    stored_options_thread_cleanup();
+    tests_thread_cleanup();
+    dataset_thread_cleanup();
+    libset_thread_cleanup();
+    gretl_rand_thread_cleanup();
+}
+
+/**
+ * libgretl_thread_init:
+ *
+ * In a multi-threaded program that uses libgretl, this function
+ * may be called by a thread other than the one that called
+ * libgretl_init(), before the thread executes any commands or
+ * evaluates any expressions, to give the thread an interpreter
+ * context of its own: user variables, saved objects and the last
+ * model, user-defined functions and packages, the function call
+ * stack, stored options, the current dataset, the record of the
+ * last test result and the program settings, the latter starting
+ * as a copy of those in force for the program as a whole. It also
+ * gets an RNG stream of its own, split off the global generator.
+ * Threads initialized in this way may run commands concurrently,
+ * provided they do not share a dataset or other objects.
+ *
+ * A thread that does not call this function sees the program-wide
+ * context. That would include the workers of an OpenMP team, so
+ * the parallel regions in libgretl are run by a thread that has
+ * a context of its own without any helpers: such a thread gets its
+ * concurrency from running alongside the others, and its
+ * computations see its own settings, variables and RNG stream
+ * throughout. Some state remains common to all threads in
+ * any case: the error and warning messages, settings that are not
+ * subject to function-level scoping (such as paths and the number
+ * of OpenMP threads), and loaded plugins. Private contexts rely
+ * on OpenMP thread-private storage, so in a build without OpenMP,
+ * or on macOS, calls into libgretl must still be serialized.
+ *
+ * See also libgretl_thread_cleanup().
+ *
+ * Returns: 0 on success, non-zero code on error.
+ **/
+
+int libgretl_thread_init (void)
+{
+    int err;
+
+    if (thread_ctx) {
+        return 0;
+    }
+
+    err = libset_thread_init();
+    if (!err) {
+        err = gretl_rand_thread_init();
+    }
+    if (!err) {
+        err = uservar_thread_init();
+    }
+    if (!err) {
+        err = gretl_functions_thread_init();
+    }
+    if (!err) {
+        err = gretl_objects_thread_init();
+    }
+    if (!err) {
+        err = stored_options_thread_init();
+    }
+    if (!err) {
+        err = tests_thread_init();
+    }
+
+    if (err) {
+        thread_context_free();
+    } else {
+        dataset_thread_init();
+        gretl_mt_thread_serial(1);
+        thread_ctx = 1;
+    }
+
+    return err;
+}
+
+/**
+ * libgretl_thread_cleanup:
+ *
+ * Frees the resources belonging to the calling thread: its
+ * private interpreter context, if one was set up by
+ * libgretl_thread_init(), and its scratch memory. This should be
+ * called before the thread exits. The program-wide context is
+ * left untouched.
+ **/
+
+void libgretl_thread_cleanup (void)
+{
+    if (thread_ctx) {
+        libgretl_session_cleanup(SESSION_CLEAR_ALL);
+        thread_context_free();
+        gretl_mt_thread_serial(0);
+        thread_ctx = 0;
+    }
+    lapack_mem_free();
+    gretl_matrix_pool_free();
+    genr_node_pool_free();
+}
+
 /**
  * libgretl_cleanup:
  *
@@ -3333,6 +3530,7 @@ void libgretl_session_cleanup (int mode)
 
 void libgretl_cleanup (void)
 {
+    gretl_tasks_cleanup();
     libgretl_session_cleanup(SESSION_CLEAR_ALL);
 
     gretl_functions_cleanup();
@@ -3340,6 +3538,10 @@ void libgretl_cleanup (void)
     gretl_command_hash_cleanup();
     gretl_function_hash_cleanup();
     lapack_mem_free();
+    gretl_matrix_pool_free();
+    genr_node_pool_free();
+    gretl_trace_stop();
+    gretl_fft_cleanup();
     forecast_matrix_cleanup();
     stored_options_cleanup();
     option_printing_cleanup();
@@ -3368,6 +3570,7 @@ void libgretl_cleanup (void)
 #endif
 
     gretl_script_dirs_cleanup();
+    native_db_cache_clear();
     gretl_xml_cleanup();
     blas_cleanup();
 }
@@ -3386,7 +3589,34 @@ enum {
 #define getcode(c) (c == GET_TEST_STAT || c == GET_TEST_PVAL || \
                     c == GET_TEST_LNL || c == GET_TEST_BRK)
 
-static GretlType last_test_type;
+/* The record of the last test result: as with other interpreter
+   state, a thread that calls libgretl_thread_init() gets a record
+   of its own, while other threads, OpenMP workers included, see
+   the program-wide one.
+*/
+
+typedef struct test_record_ test_record;
+
+struct test_record_ {
+    GretlType type;     /* scalar, matrix or none */
+    double val;         /* scalar test statistic */
+    double pv;          /* and its p-value */
+    double ll;          /* log-likelihood, if applicable */
+    double brk;         /* break point, if applicable */
+    gretl_matrix *vals; /* matrix of test statistics */
+    gretl_matrix *pvs;  /* and their p-values */
+};
+
+#define TEST_RECORD_INIT {GRETL_TYPE_NONE, NADBL, NADBL, NADBL, NADBL, NULL, NULL}
+
+static test_record main_test = TEST_RECORD_INIT;
+static test_record *thread_test;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(thread_test)
+#endif
+
+#define last_test (thread_test != NULL ? thread_test : &main_test)
 
 static double record_or_get_test_result (double teststat,
                                          double pval,
@@ -3394,27 +3624,24 @@ static double record_or_get_test_result (double teststat,
                                          double inbrk,
                                          int code)
 {
-    static double val = NADBL;
-    static double pv = NADBL;
-    static double ll = NADBL;
-    static double brk = NADBL;
+    test_record *tr = last_test;
     double ret = NADBL;
 
     if (code == SET_TEST_STAT) {
-        last_test_type = GRETL_TYPE_DOUBLE;
-        val = teststat;
-        pv = pval;
-        ll = lnl;
-        brk = inbrk;
-    } else if (getcode(code) && last_test_type == GRETL_TYPE_DOUBLE) {
+        tr->type = GRETL_TYPE_DOUBLE;
+        tr->val = teststat;
+        tr->pv = pval;
+        tr->ll = lnl;
+        tr->brk = inbrk;
+    } else if (getcode(code) && tr->type == GRETL_TYPE_DOUBLE) {
         if (code == GET_TEST_STAT) {
-            ret = val;
+            ret = tr->val;
         } else if (code == GET_TEST_PVAL) {
-            ret = pv;
+            ret = tr->pv;
         } else if (code == GET_TEST_LNL) {
-            ret = ll;
+            ret = tr->ll;
         } else if (code == GET_TEST_BRK) {
-            ret = brk;
+            ret = tr->brk;
         }
     }
 
@@ -3426,26 +3653,25 @@ record_or_get_test_matrix (gretl_matrix *tests,
                            gretl_matrix *pvals,
                            int code, int *err)
 {
-    static gretl_matrix *vals = NULL;
-    static gretl_matrix *pvs = NULL;
+    test_record *tr = last_test;
     gretl_matrix *ret = NULL;
 
     if (code == TESTS_CLEANUP) {
-        gretl_matrix_free(vals);
-        gretl_matrix_free(pvs);
-        vals = pvs = NULL;
-        last_test_type = GRETL_TYPE_NONE;
+        gretl_matrix_free(tr->vals);
+        gretl_matrix_free(tr->pvs);
+        tr->vals = tr->pvs = NULL;
+        tr->type = GRETL_TYPE_NONE;
         return NULL;
     }
 
     if (code == SET_TEST_STAT) {
-        last_test_type = GRETL_TYPE_MATRIX;
-        gretl_matrix_free(vals);
-        vals = tests;
-        gretl_matrix_free(pvs);
-        pvs = pvals;
+        tr->type = GRETL_TYPE_MATRIX;
+        gretl_matrix_free(tr->vals);
+        tr->vals = tests;
+        gretl_matrix_free(tr->pvs);
+        tr->pvs = pvals;
     } else if (getcode(code)) {
-        gretl_matrix *src = (code == GET_TEST_STAT)? vals : pvs;
+        gretl_matrix *src = (code == GET_TEST_STAT)? tr->vals : tr->pvs;
 
         if (src != NULL) {
             ret = gretl_matrix_copy(src);
@@ -3465,13 +3691,37 @@ static void gretl_tests_cleanup (void)
     record_or_get_test_matrix(NULL, NULL, TESTS_CLEANUP, NULL);
 }
 
+static int tests_thread_init (void)
+{
+    test_record tr0 = TEST_RECORD_INIT;
+
+    if (thread_test == NULL) {
+        thread_test = malloc(sizeof *thread_test);
+        if (thread_test == NULL) {
+            return E_ALLOC;
+        }
+        *thread_test = tr0;
+    }
+
+    return 0;
+}
+
+static void tests_thread_cleanup (void)
+{
+    if (thread_test != NULL) {
+        gretl_tests_cleanup();
+        free(thread_test);
+        thread_test = NULL;
+    }
+}
+
 /* Returns the type (scalar, matrix or none) of the last recorded
    test statistic/p-value pair.
 */
 
 int get_last_test_type (void)
 {
-    return last_test_type;
+    return last_test->type;
 }
 
 void record_test_result (double teststat, double pval)
@@ -49,6 +49,10 @@ enum {
 
 void libgretl_init (void);
 
+void gretl_startup_mark (const char *stage);
+
+void gretl_startup_report (FILE *fp);
+
 #ifdef HAVE_MPI
 int libgretl_mpi_init (int self, int np, int single_rng);
 #else
@@ -68,6 +72,10 @@ void libgretl_session_cleanup (int mode);
 
 void libgretl_cleanup (void);
 
+int libgretl_thread_init (void);
+
+void libgretl_thread_cleanup (void);
+
 double date_as_double (int t, int pd, double sd0);
 
 /* checks on variables */
@@ -51,6 +51,18 @@
 # define USE_XFERINFOFUNCTION
 #endif
 
+/* run batches of transfers concurrently if curl_multi_wait is available */
+#if LIBCURL_VERSION_NUM >= 0x071c00 /* 7.28.0 */
+# define USE_MULTI_WAIT
+#endif
+
+/* share the connection cache between handles if possible */
+#if LIBCURL_VERSION_NUM >= 0x073900 /* 7.57.0 */
+# define USE_SHARE_CONNECT
+#endif
+
+#define WWW_MAX_ACTIVE 8 /* max. concurrent transfers in a batch */
+
 typedef enum {
     LIST_DBS = 1,
     GRAB_IDX,
@@ -94,6 +106,15 @@ static const char *datacgi   = "/cgi-bin/gretldata.cgi";
 static int wproxy = 0;
 static char proxyhost[128] = {0};
 
+/* handles persisting across transfers, allowing reuse of
+   connections, DNS lookups and TLS sessions
+*/
+static CURLSH *wshare;
+static GMutex wshare_lock[CURL_LOCK_DATA_LAST];
+#ifdef USE_MULTI_WAIT
+static CURLM *wmulti;
+#endif
+
 #ifdef _WIN32
 static char certs_path[MAXLEN];
 #endif
@@ -119,6 +140,24 @@ struct urlinfo_ {
     char errbuf[CURL_ERROR_SIZE]; /* for use with CURLOPT_ERRORBUFFER */
 };
 
+static const char *www_user_agent (void)
+{
+    static char agent[32];
+
+    if (*agent == '\0') {
+#ifdef BUILD_DATE
+	sprintf(agent, "gretl-%s-%s", GRETL_VERSION, BUILD_DATE);
+#else
+	sprintf(agent, "gretl-%s", GRETL_VERSION);
+#endif
+#ifdef _WIN32
+	strcat(agent, "w");
+#endif
+    }
+
+    return agent;
+}
+
 static void urlinfo_init (urlinfo *u,
                           const char *hostname,
                           int saveopt,
@@ -157,16 +196,7 @@ static void urlinfo_init (urlinfo *u,
     u->errbuf[0] = '\0';
 
     gretl_error_clear();
-
-#ifdef BUILD_DATE
-    sprintf(u->agent, "gretl-%s-%s", GRETL_VERSION, BUILD_DATE);
-#else
-    sprintf(u->agent, "gretl-%s", GRETL_VERSION);
-#endif
-
-#ifdef _WIN32
-    strcat(u->agent, "w");
-#endif
+    strcpy(u->agent, www_user_agent());
 }
 
 static void urlinfo_set_url (urlinfo *u, const char *url)
@@ -472,6 +502,32 @@ static void certs_path_init (void)
 
 #endif /* _WIN32 */
 
+static void share_lock (CURL *handle, curl_lock_data data,
+                        curl_lock_access access, void *p)
+{
+    g_mutex_lock(&wshare_lock[data]);
+}
+
+static void share_unlock (CURL *handle, curl_lock_data data, void *p)
+{
+    g_mutex_unlock(&wshare_lock[data]);
+}
+
+static void share_init (void)
+{
+    wshare = curl_share_init();
+
+    if (wshare != NULL) {
+        curl_share_setopt(wshare, CURLSHOPT_LOCKFUNC, share_lock);
+        curl_share_setopt(wshare, CURLSHOPT_UNLOCKFUNC, share_unlock);
+        curl_share_setopt(wshare, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+        curl_share_setopt(wshare, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#ifdef USE_SHARE_CONNECT
+        curl_share_setopt(wshare, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+    }
+}
+
 static int gretl_curl_toggle (int on)
 {
     static int init_done;
@@ -487,11 +543,23 @@ static int gretl_curl_toggle (int on)
 #ifdef _WIN32
                 certs_path_init();
 #endif
+                share_init();
                 init_done = 1;
             }
         }
     } else if (init_done) {
+#ifdef USE_MULTI_WAIT
+        if (wmulti != NULL) {
+            curl_multi_cleanup(wmulti);
+            wmulti = NULL;
+        }
+#endif
+        if (wshare != NULL) {
+            curl_share_cleanup(wshare);
+            wshare = NULL;
+        }
         curl_global_cleanup();
+        init_done = 0;
     }
 
     return 0;
@@ -526,6 +594,10 @@ static int common_curl_setup (CURL **pcurl)
 	return err;
     }
 
+    if (wshare != NULL) {
+        curl_easy_setopt(*pcurl, CURLOPT_SHARE, wshare);
+    }
+
     /* Verbosity can be invoked by defining WDEBUG at
        compile time or via the environment at run time.
     */
@@ -722,6 +794,520 @@ static int retrieve_url (const char *hostname,
     return err;
 }
 
+/* On-disk cache for HTTP GET requests: the content of a resource is
+   stored along with the validators (ETag and/or Last-Modified) sent
+   by the server, and on subsequent requests these are sent back so
+   that the server can respond "304 Not Modified" in place of the
+   full content. Caching can be turned off by setting the environment
+   variable GRETL_HTTP_NOCACHE. Requests carrying a caller-supplied
+   header (which may hold credentials) are never cached, nor are
+   responses marked "no-store" or "private"; and the total size of
+   the cache is bounded, the least recently stored entries being
+   removed first.
+*/
+
+#define HTTP_CACHE_DIR "http_cache"
+#define HTTP_CACHE_MAX (64 * 1024 * 1024)
+
+typedef struct wcache_ wcache;
+
+struct wcache_ {
+    gchar *path;          /* path to cached content */
+    char etag[256];       /* validators for the cached copy */
+    char lastmod[64];
+    char new_etag[256];   /* validators received */
+    char new_lastmod[64];
+    int nostore;          /* the server forbids caching */
+};
+
+static int http_cache_wanted (void)
+{
+    return getenv("GRETL_HTTP_NOCACHE") == NULL;
+}
+
+static void get_header_value (const char *s, char *targ, int len)
+{
+    int n;
+
+    s += strspn(s, " \t");
+    n = strcspn(s, "\r\n");
+    while (n > 0 && (s[n-1] == ' ' || s[n-1] == '\t')) {
+        n--;
+    }
+    *targ = '\0';
+    if (n < len) {
+        strncat(targ, s, n);
+    }
+}
+
+static void http_cache_read_meta (wcache *wc)
+{
+    gchar *meta = g_strdup_printf("%s.meta", wc->path);
+    gchar *buf = NULL;
+
+    if (gretl_stat(wc->path, NULL) == 0 &&
+        g_file_get_contents(meta, &buf, NULL, NULL)) {
+        gchar **S = g_strsplit(buf, "\n", -1);
+        int i;
+
+        for (i=0; S[i] != NULL; i++) {
+            if (!strncmp(S[i], "ETag:", 5)) {
+                get_header_value(S[i] + 5, wc->etag, sizeof wc->etag);
+            } else if (!strncmp(S[i], "Last-Modified:", 14)) {
+                get_header_value(S[i] + 14, wc->lastmod, sizeof wc->lastmod);
+            }
+        }
+        g_strfreev(S);
+        g_free(buf);
+    }
+
+    g_free(meta);
+}
+
+/* Set up cache info for @url, adding conditional request headers
+   to @hlist if we have a cached copy.
+*/
+
+static wcache *http_cache_new (const char *url,
+                               struct curl_slist **hlist)
+{
+    wcache *wc = calloc(1, sizeof *wc);
+    gchar *sum, *hdr;
+
+    if (wc == NULL) {
+        return NULL;
+    }
+
+    sum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, url, -1);
+    wc->path = g_strdup_printf("%s%s%c%s", gretl_dotdir(),
+                               HTTP_CACHE_DIR, SLASH, sum);
+    g_free(sum);
+
+    http_cache_read_meta(wc);
+
+    if (*wc->etag != '\0') {
+        hdr = g_strdup_printf("If-None-Match: %s", wc->etag);
+        *hlist = curl_slist_append(*hlist, hdr);
+        g_free(hdr);
+    }
+    if (*wc->lastmod != '\0') {
+        hdr = g_strdup_printf("If-Modified-Since: %s", wc->lastmod);
+        *hlist = curl_slist_append(*hlist, hdr);
+        g_free(hdr);
+    }
+
+    return wc;
+}
+
+static void http_cache_free (wcache *wc)
+{
+    if (wc != NULL) {
+        g_free(wc->path);
+        free(wc);
+    }
+}
+
+typedef struct centry_ {
+    gchar *path;
+    time_t mtime;
+    size_t size;
+} centry;
+
+static int centry_compare (const void *a, const void *b)
+{
+    const centry *ca = a;
+    const centry *cb = b;
+
+    return (ca->mtime > cb->mtime) - (ca->mtime < cb->mtime);
+}
+
+/* If the content files in the cache directory @dir come to more
+   than HTTP_CACHE_MAX bytes, remove the oldest until they take
+   up no more than three quarters of that.
+*/
+
+static void http_cache_prune (const char *dir)
+{
+    GDir *gd = g_dir_open(dir, 0, NULL);
+    GArray *A;
+    const gchar *dname;
+    size_t total = 0;
+    guint i;
+
+    if (gd == NULL) {
+        return;
+    }
+
+    A = g_array_new(FALSE, FALSE, sizeof(centry));
+
+    while ((dname = g_dir_read_name(gd)) != NULL) {
+        struct stat sbuf;
+        centry ce;
+
+        if (g_str_has_suffix(dname, ".meta")) {
+            continue;
+        }
+        ce.path = g_build_filename(dir, dname, NULL);
+        if (gretl_stat(ce.path, &sbuf) == 0) {
+            ce.mtime = sbuf.st_mtime;
+            ce.size = sbuf.st_size;
+            total += ce.size;
+            g_array_append_val(A, ce);
+        } else {
+            g_free(ce.path);
+        }
+    }
+    g_dir_close(gd);
+
+    if (total > HTTP_CACHE_MAX) {
+        g_array_sort(A, centry_compare);
+        for (i=0; i<A->len && total > HTTP_CACHE_MAX / 4 * 3; i++) {
+            centry *ce = &g_array_index(A, centry, i);
+            gchar *meta = g_strdup_printf("%s.meta", ce->path);
+
+            gretl_remove(ce->path);
+            gretl_remove(meta);
+            g_free(meta);
+            total -= ce->size;
+        }
+    }
+
+    for (i=0; i<A->len; i++) {
+        g_free(g_array_index(A, centry, i).path);
+    }
+    g_array_free(A, TRUE);
+}
+
+/* Store freshly downloaded content, if the server supplied
+   validators for it and didn't forbid caching, or discard any
+   stale copy otherwise.
+*/
+
+static void http_cache_store (wcache *wc, const char *buf, size_t len)
+{
+    gchar *meta = g_strdup_printf("%s.meta", wc->path);
+
+    if (wc->nostore || len > HTTP_CACHE_MAX / 4 ||
+        (*wc->new_etag == '\0' && *wc->new_lastmod == '\0')) {
+        if (*wc->etag != '\0' || *wc->lastmod != '\0') {
+            gretl_remove(wc->path);
+            gretl_remove(meta);
+        }
+    } else {
+        gchar *dir = g_strdup_printf("%s%s", gretl_dotdir(), HTTP_CACHE_DIR);
+
+        if (gretl_mkdir(dir) == 0 &&
+            g_file_set_contents(wc->path, buf, len, NULL)) {
+            gchar *info = g_strdup_printf("ETag: %s\nLast-Modified: %s\n",
+                                          wc->new_etag, wc->new_lastmod);
+
+            g_file_set_contents(meta, info, -1, NULL);
+            g_free(info);
+            http_cache_prune(dir);
+        }
+        g_free(dir);
+    }
+
+    g_free(meta);
+}
+
+/* Retrieve cached content in response to "304 Not Modified" */
+
+static char *http_cache_fetch (wcache *wc, size_t *len)
+{
+    gchar *buf = NULL;
+    gsize n = 0;
+    char *ret = NULL;
+
+    if (g_file_get_contents(wc->path, &buf, &n, NULL)) {
+        ret = malloc(n + 1);
+        if (ret != NULL) {
+            memcpy(ret, buf, n);
+            ret[n] = '\0';
+            *len = n;
+        }
+        g_free(buf);
+    }
+
+    return ret;
+}
+
+/* A single transfer within a batch processed by www_fetch_batch() */
+
+typedef struct wxfer_ wxfer;
+
+struct wxfer_ {
+    const char *url;          /* the URL */
+    CURL *curl;               /* handle, while the transfer is active */
+    struct curl_slist *hlist; /* request headers */
+    wcache *wc;               /* cache info, or NULL */
+    char *buf;                /* content received */
+    size_t len;               /* bytes received */
+    size_t alloc;             /* bytes allocated at @buf */
+    long http_code;           /* HTTP status */
+    CURLcode res;             /* cURL status */
+    int err;                  /* error code */
+    char errbuf[CURL_ERROR_SIZE];
+};
+
+static size_t wxfer_write_func (void *data, size_t size,
+                                size_t nmemb, void *p)
+{
+    wxfer *x = (wxfer *) p;
+    size_t bgot = size * nmemb;
+
+    if (x->len + bgot + 1 > x->alloc) {
+        size_t newlen = (x->alloc > 0)? 2 * x->alloc : WBUFSIZE;
+        char *newbuf;
+
+        while (newlen < x->len + bgot + 1) {
+            newlen *= 2;
+        }
+        newbuf = realloc(x->buf, newlen);
+        if (newbuf == NULL) {
+            x->err = E_ALLOC;
+            return 0;
+        }
+        x->buf = newbuf;
+        x->alloc = newlen;
+    }
+
+    memcpy(x->buf + x->len, data, bgot);
+    x->len += bgot;
+    x->buf[x->len] = '\0';
+
+    return nmemb;
+}
+
+/* pick up cache validators from the response headers */
+
+static size_t wxfer_header_func (char *data, size_t size,
+                                 size_t nitems, void *p)
+{
+    wxfer *x = (wxfer *) p;
+    size_t n = size * nitems;
+    wcache *wc = x->wc;
+
+    if (wc == NULL || n < 6) {
+        ; /* nothing to do */
+    } else if (!strncmp(data, "HTTP/", 5)) {
+        /* start of a (possibly redirected) response */
+        *wc->new_etag = *wc->new_lastmod = '\0';
+        wc->nostore = 0;
+    } else if (n > 14 && !g_ascii_strncasecmp(data, "Cache-Control:", 14)) {
+        gchar *val = g_ascii_strdown(data + 14, n - 14);
+
+        if (strstr(val, "no-store") != NULL || strstr(val, "private") != NULL) {
+            wc->nostore = 1;
+        }
+        g_free(val);
+    } else if (n > 5 && !g_ascii_strncasecmp(data, "ETag:", 5)) {
+        get_header_value(data + 5, wc->new_etag, sizeof wc->new_etag);
+    } else if (n > 14 && !g_ascii_strncasecmp(data, "Last-Modified:", 14)) {
+        get_header_value(data + 14, wc->new_lastmod, sizeof wc->new_lastmod);
+    }
+
+    return n;
+}
+
+static int wxfer_start (wxfer *x, const char *header,
+                        int include, int nobody)
+{
+    CURL *curl = NULL;
+    int err;
+
+    err = common_curl_setup(&curl);
+    if (err) {
+        return err;
+    }
+
+    if (header != NULL) {
+        x->hlist = curl_slist_append(x->hlist, header);
+    }
+    if (header == NULL && !include && !nobody && http_cache_wanted()) {
+        x->wc = http_cache_new(x->url, &x->hlist);
+    }
+
+    curl_easy_setopt(curl, CURLOPT_URL, x->url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, wxfer_write_func);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, x);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, wxfer_header_func);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, x);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, www_user_agent());
+    curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, x->errbuf);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 20L);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 1L);
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, (char *) x);
+
+    if (include) {
+        curl_easy_setopt(curl, CURLOPT_HEADER, 1L);
+    }
+    if (nobody) {
+        curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    }
+    if (x->hlist != NULL) {
+        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, x->hlist);
+    }
+    if (wproxy && *proxyhost != '\0') {
+        curl_easy_setopt(curl, CURLOPT_PROXY, proxyhost);
+    }
+
+    x->curl = curl;
+
+    return 0;
+}
+
+static void wxfer_finish (wxfer *x, CURLcode res)
+{
+    curl_easy_getinfo(x->curl, CURLINFO_RESPONSE_CODE, &x->http_code);
+    x->res = res;
+
+    if (res != CURLE_OK) {
+        if (!x->err) {
+            x->err = E_DATA;
+        }
+    } else if (x->wc != NULL) {
+        if (x->http_code == 304) {
+            /* serve the cached copy */
+            free(x->buf);
+            x->buf = http_cache_fetch(x->wc, &x->len);
+            x->err = (x->buf == NULL)? E_DATA : 0;
+            x->http_code = 200;
+        } else if (x->http_code == 200) {
+            http_cache_store(x->wc, x->buf, x->len);
+        }
+    }
+
+    if (x->err && x->buf != NULL) {
+        free(x->buf);
+        x->buf = NULL;
+        x->len = 0;
+    }
+
+    curl_easy_cleanup(x->curl);
+    x->curl = NULL;
+    curl_slist_free_all(x->hlist);
+    x->hlist = NULL;
+    http_cache_free(x->wc);
+    x->wc = NULL;
+}
+
+#ifdef USE_MULTI_WAIT
+
+static CURLM *www_multi_handle (void)
+{
+    if (wmulti == NULL) {
+        wmulti = curl_multi_init();
+#if LIBCURL_VERSION_NUM >= 0x071e00 /* 7.30.0 */
+        if (wmulti != NULL) {
+            curl_multi_setopt(wmulti, CURLMOPT_MAX_TOTAL_CONNECTIONS,
+                              (long) WWW_MAX_ACTIVE);
+        }
+#endif
+#if LIBCURL_VERSION_NUM >= 0x072b00 /* 7.43.0 */
+        if (wmulti != NULL) {
+            curl_multi_setopt(wmulti, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+        }
+#endif
+    }
+
+    return wmulti;
+}
+
+#endif
+
+/* Carry out the @n GET requests in @X, running up to WWW_MAX_ACTIVE
+   of them concurrently. The return value is non-zero only if we
+   couldn't get going; failure of individual transfers is recorded
+   in the respective elements of @X.
+*/
+
+static int www_fetch_batch (wxfer *X, int n, const char *header,
+                            int include, int nobody)
+{
+#ifdef USE_MULTI_WAIT
+    CURLM *cm;
+    CURLMsg *msg;
+    wxfer *x;
+    int next = 0, active = 0;
+    int running, nq, i;
+    int err;
+
+    err = gretl_curl_toggle(1);
+    if (err) {
+        return err;
+    }
+
+    cm = www_multi_handle();
+    if (cm == NULL) {
+        gretl_errmsg_set("curl_multi_init failed");
+        return E_ALLOC;
+    }
+
+    while (!err && (next < n || active > 0)) {
+        while (next < n && active < WWW_MAX_ACTIVE && !err) {
+            err = wxfer_start(&X[next], header, include, nobody);
+            if (!err) {
+                curl_multi_add_handle(cm, X[next].curl);
+                active++;
+            }
+            next++;
+        }
+        curl_multi_perform(cm, &running);
+        while ((msg = curl_multi_info_read(cm, &nq)) != NULL) {
+            if (msg->msg == CURLMSG_DONE) {
+                CURL *curl = msg->easy_handle;
+
+                curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char **) &x);
+                curl_multi_remove_handle(cm, curl);
+                wxfer_finish(x, msg->data.result);
+                active--;
+            }
+        }
+        if (running > 0) {
+            curl_multi_wait(cm, NULL, 0, 1000, NULL);
+        }
+    }
+
+    if (err) {
+        /* clean up any transfers left hanging */
+        for (i=0; i<next; i++) {
+            if (X[i].curl != NULL) {
+                curl_multi_remove_handle(cm, X[i].curl);
+                wxfer_finish(&X[i], CURLE_ABORTED_BY_CALLBACK);
+            }
+        }
+    }
+
+    return err;
+#else
+    int i, err = 0;
+
+    for (i=0; i<n && !err; i++) {
+        err = wxfer_start(&X[i], header, include, nobody);
+        if (!err) {
+            wxfer_finish(&X[i], curl_easy_perform(X[i].curl));
+        }
+    }
+
+    return err;
+#endif
+}
+
+/* Get a message for a wxfer that has failed */
+
+static const char *wxfer_error (wxfer *x)
+{
+    if (x->res == CURLE_OK) {
+        return "download failed";
+    } else if (x->errbuf[0] != '\0') {
+        return x->errbuf;
+    } else {
+        return curl_easy_strerror(x->res);
+    }
+}
+
 /* public interfaces follow */
 
 int gretl_www_init (const char *proxy, int use_proxy)
@@ -1273,6 +1859,64 @@ int retrieve_remote_db_data (const char *dbname,
                         NULL, 0, getbuf);
 }
 
+/**
+ * retrieve_remote_db_data_multi:
+ * @dbname: name of gretl database to access.
+ * @varnames: array of names of series to retrieve.
+ * @n: number of elements in @varnames.
+ * @getbufs: array of @n pointers to receive allocated buffers
+ * containing the data.
+ *
+ * Retrieves the specified series from the gretl data server,
+ * running several requests concurrently. On return, elements
+ * of @getbufs are NULL for any series that could not be
+ * retrieved.
+ *
+ * Returns: 0 on success, non-zero if the transfers could not
+ * be started.
+ */
+
+int retrieve_remote_db_data_multi (const char *dbname,
+                                   const char **varnames,
+                                   int n, char **getbufs)
+{
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+    CGIOpt opt = GRAB_NBO_DATA;
+#else
+    CGIOpt opt = GRAB_DATA;
+#endif
+    char (*urls)[URLLEN];
+    wxfer *X;
+    int i, err = 0;
+
+    urls = malloc(n * sizeof *urls);
+    X = calloc(n, sizeof *X);
+
+    if (urls == NULL || X == NULL) {
+        err = E_ALLOC;
+    } else {
+        urlinfo u;
+
+        for (i=0; i<n; i++) {
+            urlinfo_init(&u, gretlhost, SAVE_TO_BUFFER, NULL, opt);
+            strcat(u.url, datacgi);
+            urlinfo_set_params(&u, opt, dbname, varnames[i], 0);
+            strcpy(urls[i], u.url);
+            X[i].url = urls[i];
+        }
+        err = www_fetch_batch(X, n, NULL, 0, 0);
+    }
+
+    for (i=0; i<n; i++) {
+        getbufs[i] = (err || X == NULL)? NULL : X[i].buf;
+    }
+
+    free(urls);
+    free(X);
+
+    return err;
+}
+
 /**
  * retrieve_manfile:
  * @fname: name of manual file to retrieve.
@@ -1407,6 +2051,9 @@ int retrieve_public_file (const char *uri, char *localname)
  * @len: location to receive length of data retreived (bytes).
  * @err: location to receive error code.
  *
+ * The content is retrieved via the on-disk HTTP cache if the
+ * server supplies validators for it.
+ *
  * Returns: allocated buffer containing the specified resource,
  * or NULL on failure.
  */
@@ -1420,13 +2067,23 @@ char *retrieve_public_file_as_buffer (const char *uri, size_t *len,
         *err = E_DATA;
         return NULL;
     } else {
-        urlinfo u;
-
-        urlinfo_init(&u, NULL, SAVE_TO_BUFFER, NULL, 0);
-        urlinfo_set_url(&u, uri);
-        *err = curl_get(&u);
-        urlinfo_finalize(&u, &buf, err);
-        *len = (*err)? 0 : u.datalen;
+        wxfer x = {0};
+
+        x.url = uri;
+        *err = www_fetch_batch(&x, 1, NULL, 0, 0);
+        if (!*err) {
+            if (x.err) {
+                gretl_errmsg_sprintf("cURL error %d (%s)", x.res,
+                                     wxfer_error(&x));
+                *err = x.err;
+            } else if (x.len == 0) {
+                free(x.buf);
+                *err = E_DATA;
+            } else {
+                buf = x.buf;
+            }
+        }
+        *len = (*err)? 0 : x.len;
     }
 
     if (*err) {
@@ -1486,7 +2143,9 @@ static size_t curl_bufwrite (void *buf, size_t sz, size_t nmemb, void *p)
  * @http_code: location to receive HTTP status code, or NULL.
  *
  * Somewhat flexible URI "grabber", allowing use of the POST
- * method with header and data to be sent to the host.
+ * method with header and data to be sent to the host. GET
+ * requests share the connection pool and on-disk cache used
+ * by gretl_curl_multi().
  *
  * Returns: 0 on success, non-zero code on error.
  */
@@ -1505,6 +2164,30 @@ int gretl_curl (const char *url, const char *header,
     CURLcode res;
     int err = 0;
 
+    if (postdata == NULL) {
+        /* a GET request: go via the connection pool and cache */
+        wxfer x = {0};
+
+        x.url = url;
+        err = www_fetch_batch(&x, 1, header, include, nobody);
+        if (err) {
+            return err;
+        }
+        if (http_code != NULL) {
+            *http_code = (int) x.http_code;
+        }
+        if (x.err) {
+            gretl_errmsg_sprintf("cURL error %d (%s)", x.res,
+                                 wxfer_error(&x));
+            if (errmsg != NULL) {
+                *errmsg = gretl_strdup(wxfer_error(&x));
+            }
+            return E_DATA;
+        }
+        *output = x.buf;
+        return 0;
+    }
+
     err = common_curl_setup(&curl);
     if (err) {
         return err;
@@ -1570,6 +2253,68 @@ int gretl_curl (const char *url, const char *header,
     return err;
 }
 
+/**
+ * gretl_curl_multi:
+ * @urls: array of complete URLs: protocol, host and path.
+ * @n: number of elements in @urls.
+ * @header: optional HTTP header to send with each request
+ * (or NULL).
+ * @include: if non-zero, include the received header with
+ * the body output.
+ * @nobody: if non-zero, don't include the body-part in the
+ * output.
+ * @output: array of @n pointers to receive the output.
+ * @http_codes: array of @n ints to receive HTTP status codes.
+ * @errmsgs: array of @n pointers to receive cURL error messages,
+ * or NULL.
+ *
+ * Batch version of gretl_curl() for GET requests, running up
+ * to eight transfers at a time and reusing connections. Elements
+ * of @output are NULL for transfers that failed, in which case the
+ * corresponding element of @errmsgs holds a message.
+ *
+ * Returns: the number of failed transfers, or minus an error code
+ * if the transfers could not be started.
+ */
+
+int gretl_curl_multi (const char **urls, int n,
+                      const char *header, int include,
+                      int nobody, char **output,
+                      int *http_codes, char **errmsgs)
+{
+    wxfer *X = calloc(n, sizeof *X);
+    int i, nfail = 0;
+    int err;
+
+    if (X == NULL) {
+        return -E_ALLOC;
+    }
+
+    for (i=0; i<n; i++) {
+        X[i].url = urls[i];
+    }
+
+    err = www_fetch_batch(X, n, header, include, nobody);
+
+    for (i=0; i<n; i++) {
+        output[i] = err ? NULL : X[i].buf;
+        http_codes[i] = (int) X[i].http_code;
+        if (errmsgs != NULL) {
+            errmsgs[i] = NULL;
+        }
+        if (!err && X[i].err) {
+            if (errmsgs != NULL) {
+                errmsgs[i] = gretl_strdup(wxfer_error(&X[i]));
+            }
+            nfail++;
+        }
+    }
+
+    free(X);
+
+    return err ? -err : nfail;
+}
+
 /**
  * try_http:
  * @s: string: filename or URL.
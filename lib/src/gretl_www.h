@@ -58,6 +58,10 @@ int retrieve_remote_db_data (const char *dbname,
 			     const char *varname,
 			     char **getbuf);
 
+int retrieve_remote_db_data_multi (const char *dbname,
+                                   const char **varnames,
+                                   int n, char **getbufs);
+
 int retrieve_manfile (const char *fname, const char *localname);
 
 int get_update_info (char **saver, int verbose);
@@ -80,6 +84,11 @@ int gretl_curl (const char *url, const char *header,
 		int nobody, char **output, char **errmsg,
                 int *http_code);
 
+int gretl_curl_multi (const char **urls, int n,
+                      const char *header, int include,
+                      int nobody, char **output,
+                      int *http_codes, char **errmsgs);
+
 int try_http (const char *s, char *fname, int *http);
 
 int curl_send_mail (const char *from_addr,
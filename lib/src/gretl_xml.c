@@ -29,6 +29,7 @@
 #include "swap_bytes.h"
 #include "gretl_zip.h"
 #include "libset.h"
+#include "gretl_mt.h"
 
 #ifdef HAVE_MPI
 # include "gretl_mpi.h"
@@ -43,6 +44,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 #include <errno.h>
+#include <libxml/xmlreader.h>
 
 #undef XML_DEBUG
 
@@ -2019,31 +2021,98 @@ static void gdt_swap_endianness (DATASET *dset)
     }
 }
 
-static int read_binary_header (FILE *fp, int order)
+/* Apparatus for reading a zipped gdtb file without unpacking it
+   into a temporary directory: data.xml is fed to the XML reader
+   straight out of the archive while data.bin is inflated into
+   memory in a separate thread -- or, if it's too big for that to
+   be sensible, inflated column by column straight into the
+   dataset once data.xml has been read. Set up by gdt_zsource_open();
+   while @gdt_zsrc is non-NULL, gdt_reader_open() and
+   read_binary_data() take their input from the archive.
+*/
+
+typedef struct gdt_zsource_ {
+    gretl_zip_member *xml;  /* stream for data.xml */
+    gretl_zip_fetch *bin;   /* pending extraction of data.bin */
+    gretl_zip_member *binz; /* or stream for a large data.bin */
+} gdt_zsource;
+
+static gdt_zsource *gdt_zsrc;
+
+/* the largest data.bin that we'll inflate into memory whole */
+#define ZBIN_FETCH_MAX (256 * 1024 * 1024)
+
+static int gdt_zsource_open (gdt_zsource *zs, const char *fname,
+			     int want_bin)
 {
-    char hdr[BIN_HDRLEN] = {0};
-    unsigned chk;
     int err = 0;
 
-    chk = fread(hdr, 1, BIN_HDRLEN, fp);
+    zs->xml = gretl_zip_member_open(fname, "data.xml", &err);
+    if (!err) {
+	if (want_bin) {
+	    int berr = 0;
+
+	    zs->binz = gretl_zip_member_open(fname, "data.bin", &berr);
+	    if (zs->binz == NULL ||
+		gretl_zip_member_size(zs->binz) <= ZBIN_FETCH_MAX) {
+		/* leave any error to be reported by the fetch */
+		gretl_zip_member_close(zs->binz);
+		zs->binz = NULL;
+		gretl_error_clear();
+		zs->bin = gretl_zip_fetch_start(fname, "data.bin");
+	    }
+	}
+	gdt_zsrc = zs;
+    } else {
+	/* let the unzip-to-disk fallback report any problem */
+	gretl_error_clear();
+    }
+
+    return err;
+}
+
+static void gdt_zsource_close (gdt_zsource *zs)
+{
+    if (zs->bin != NULL) {
+	guint32 len;
+	int err;
+
+	free(gretl_zip_fetch_finish(zs->bin, &len, &err));
+    }
+    gretl_zip_member_close(zs->binz);
+    gretl_zip_member_close(zs->xml);
+    gdt_zsrc = NULL;
+}
+
+static int zip_xml_read (void *context, char *buffer, int len)
+{
+    return gretl_zip_member_read(context, buffer, len);
+}
+
+static int zip_xml_close (void *context)
+{
+    /* the member is closed by gdt_zsource_close() */
+    return 0;
+}
+
+/* @hdr should hold BIN_HDRLEN bytes plus a terminating NUL */
 
-    if (chk != BIN_HDRLEN) {
+static int check_binary_header (const char *hdr, int order)
+{
+    int bin_order = 0;
+    int err = 0;
+
+    if (strncmp(hdr, "gretl-bin:", 10)) {
 	err = E_DATA;
+    } else if (!strcmp(hdr + 10, "little-endian")) {
+	bin_order = G_LITTLE_ENDIAN;
+    } else if (!strcmp(hdr + 10, "big-endian")) {
+	bin_order = G_BIG_ENDIAN;
     } else {
-	int bin_order = 0;
-
-	if (strncmp(hdr, "gretl-bin:", 10)) {
-	    err = E_DATA;
-	} else if (!strcmp(hdr + 10, "little-endian")) {
-	    bin_order = G_LITTLE_ENDIAN;
-	} else if (!strcmp(hdr + 10, "big-endian")) {
-	    bin_order = G_BIG_ENDIAN;
-	} else {
-	    err = E_DATA;
-	}
-	if (!err && bin_order != order) {
-	    err = E_DATA;
-	}
+	err = E_DATA;
+    }
+    if (!err && bin_order != order) {
+	err = E_DATA;
     }
 
     if (err) {
@@ -2053,6 +2122,18 @@ static int read_binary_header (FILE *fp, int order)
     return err;
 }
 
+static int read_binary_header (FILE *fp, int order)
+{
+    char hdr[BIN_HDRLEN + 1] = {0};
+
+    if (fread(hdr, 1, BIN_HDRLEN, fp) != BIN_HDRLEN) {
+	gretl_errmsg_set("Error reading binary data file");
+	return E_DATA;
+    }
+
+    return check_binary_header(hdr, order);
+}
+
 static void na_convert (double *x, int n)
 {
     int i;
@@ -2064,6 +2145,138 @@ static void na_convert (double *x, int n)
     }
 }
 
+/* Read exactly @len bytes from zip member @zm into @buf, in
+   pieces small enough for gretl_zip_member_read() */
+
+static int zip_read_exact (gretl_zip_member *zm, char *buf, size_t len)
+{
+    while (len > 0) {
+	int n = len > (1 << 24) ? (1 << 24) : (int) len;
+	int got = gretl_zip_member_read(zm, buf, n);
+
+	if (got <= 0) {
+	    return E_DATA;
+	}
+	buf += got;
+	len -= got;
+    }
+
+    return 0;
+}
+
+/* counterpart to read_binary_data() for a data.bin that is too
+   big to be extracted into memory whole: inflate it straight
+   into the columns of @dset */
+
+static int read_streamed_binary_data (DATASET *dset,
+				      int order,
+				      double gdtversion,
+				      int fullv,
+				      const int *vlist)
+{
+    gretl_zip_member *zm = gdt_zsrc->binz;
+    char hdr[BIN_HDRLEN + 1] = {0};
+    size_t colsize = dset->n * sizeof(double);
+    char *skip = NULL;
+    int i, k = 1;
+    int err;
+
+    gdt_zsrc->binz = NULL;
+
+    err = zip_read_exact(zm, hdr, BIN_HDRLEN);
+    if (err) {
+	gretl_errmsg_set("Error reading binary data file");
+    } else {
+	err = check_binary_header(hdr, order);
+    }
+
+    for (i=1; i<fullv && !err; i++) {
+	if (vlist == NULL || in_gretl_list(vlist, i)) {
+	    err = zip_read_exact(zm, (char *) dset->Z[k], colsize);
+	    if (!err && gdtversion < 1.4) {
+		na_convert(dset->Z[k], dset->n);
+	    }
+	    k++;
+	} else {
+	    if (skip == NULL) {
+		skip = malloc(colsize);
+		if (skip == NULL) {
+		    err = E_ALLOC;
+		    break;
+		}
+	    }
+	    err = zip_read_exact(zm, skip, colsize);
+	}
+    }
+
+    free(skip);
+    gretl_zip_member_close(zm);
+
+    if (!err && order != G_BYTE_ORDER) {
+	gdt_swap_endianness(dset);
+    }
+
+    return err;
+}
+
+/* counterpart to read_binary_data() for the case where the
+   content of data.bin has been extracted into memory */
+
+static int read_zipped_binary_data (DATASET *dset,
+				    int order,
+				    double gdtversion,
+				    int fullv,
+				    const int *vlist)
+{
+    char hdr[BIN_HDRLEN + 1] = {0};
+    size_t colsize = dset->n * sizeof(double);
+    guint32 len = 0;
+    char *buf, *p;
+    int i, k = 1;
+    int err = 0;
+
+    if (gdt_zsrc->binz != NULL) {
+	return read_streamed_binary_data(dset, order, gdtversion,
+					 fullv, vlist);
+    }
+
+    buf = gretl_zip_fetch_finish(gdt_zsrc->bin, &len, &err);
+    gdt_zsrc->bin = NULL;
+
+    if (err) {
+	gretl_errmsg_set("Error reading binary data file");
+	return err;
+    } else if (len < BIN_HDRLEN) {
+	err = E_DATA;
+    } else {
+	memcpy(hdr, buf, BIN_HDRLEN);
+	err = check_binary_header(hdr, order);
+    }
+
+    p = buf + BIN_HDRLEN;
+
+    for (i=1; i<fullv && !err; i++) {
+	if (p + colsize > buf + len) {
+	    err = E_DATA;
+	} else if (vlist == NULL || in_gretl_list(vlist, i)) {
+	    memcpy(dset->Z[k], p, colsize);
+	    if (gdtversion < 1.4) {
+		na_convert(dset->Z[k], dset->n);
+	    }
+	    k++;
+	}
+	p += colsize;
+    }
+
+    free(buf);
+
+    if (!err && order != G_BYTE_ORDER) {
+	gdt_swap_endianness(dset);
+    }
+
+    return err;
+}
+
 static int read_binary_data (const char *fname,
 			     DATASET *dset,
 			     int order,
@@ -2075,6 +2288,11 @@ static int read_binary_data (const char *fname,
     FILE *fp;
     int err = 0;
 
+    if (gdt_zsrc != NULL) {
+	return read_zipped_binary_data(dset, order, gdtversion,
+				       fullv, vlist);
+    }
+
     bname = switch_ext_new(fname, "bin");
     fp = gretl_fopen(bname, "rb");
 
@@ -2123,33 +2341,45 @@ static int read_binary_data (const char *fname,
    in the data it ought to be enough if 100 members pass the test.
 */
 
-static int p15_OK (const DATASET *dset, int v)
+/* Write @x into @s in the shortest "%.*g" form, with at least 15
+   significant digits, that reads back as exactly @x; return the
+   number of bytes written. Integer-valued data, which are common,
+   are handled without resort to the general formatter.
+*/
+
+static int gdt_format_value (char *s, double x)
 {
-    const double *x = dset->Z[v];
-    char s[32];
-    int t, i, n_ok = 0;
-    int ret = 1;
+    int n = 0;
 
-    for (t=dset->t1; t<=dset->t2; t++) {
-	if (!na(x[t])) {
-	    sprintf(s, "% .14e", x[t]);
-	    for (i=16; i>13; i--) {
-		if (s[i] != '0') {
-		    break;
-		}
-	    }
-	    if (i == 16) {
-		ret = 0;
-		break;
-	    }
-	    n_ok++;
+    if (fabs(x) < 1.0e15 && x == floor(x) && !(x == 0 && signbit(x))) {
+	gint64 k = (gint64) x;
+	char tmp[16];
+	int i = 0;
+
+	if (k < 0) {
+	    s[n++] = '-';
+	    k = -k;
 	}
-	if (n_ok > 100) {
-	    break;
+	do {
+	    tmp[i++] = '0' + k % 10;
+	    k /= 10;
+	} while (k > 0);
+	while (i > 0) {
+	    s[n++] = tmp[--i];
 	}
+	s[n] = '\0';
+	return n;
     }
 
-    return ret;
+    n = sprintf(s, "%.15g", x);
+    if (strtod(s, NULL) != x) {
+	n = sprintf(s, "%.16g", x);
+	if (strtod(s, NULL) != x) {
+	    n = sprintf(s, "%.17g", x);
+	}
+    }
+
+    return n;
 }
 
 /* apparatus from trimming string-values on gdt save,
@@ -2261,6 +2491,58 @@ static void strval_saver_restore (DATASET *dset,
     strval_saver_destroy(ss);
 }
 
+/* Format the <obs> element for observation @t into @s, which
+   must have room for GDT_ROWLEN(nvars) bytes. For a padding row
+   that is to be skipped, @s is left empty.
+*/
+
+#define GDT_ROWLEN(n) (32 * ((n) + 2) + 64)
+
+static void gdt_format_obs (const DATASET *dset,
+			    const int *storelist,
+			    int nvars, int t,
+			    int skip_padding,
+			    char *s)
+{
+    char buf[32];
+    int i, v;
+
+    if (skip_padding && row_is_padding(dset, t, dset->v)) {
+	*s = '\0';
+	return;
+    }
+
+    s += sprintf(s, "<obs");
+    if (dset->S != NULL &&
+	!gretl_xml_encode_to_buf(buf, dset->S[t], sizeof buf)) {
+	s += sprintf(s, " label=\"%s\"", buf);
+    }
+    *s++ = '>';
+    for (i=1; i<=nvars; i++) {
+	v = savenum(storelist, i);
+	if (na(dset->Z[v][t])) {
+	    strcpy(s, "NA");
+	    s += 2;
+	} else {
+	    s += gdt_format_value(s, dset->Z[v][t]);
+	}
+	*s++ = ' ';
+    }
+    if (skip_padding) {
+	int unit = 1 + t / dset->pd;
+	int time = t % dset->pd + 1;
+
+	s += sprintf(s, "%d %d ", unit, time);
+    }
+    strcpy(s, "</obs>\n");
+}
+
+/* The observations are formatted a chunk at a time, into a buffer
+   of up to 8 MB, with the rows of each chunk shared out among
+   threads if OpenMP is available; each chunk is then written in
+   sequence.
+*/
+
 static int gdt_write_observations (const DATASET *dset,
 				   const int *storelist,
 				   int skip_padding,
@@ -2269,12 +2551,10 @@ static int gdt_write_observations (const DATASET *dset,
                                    (double, double, int),
 				   PRN *prn)
 {
-    char buf[32], numstr[32];
-    char *p15 = NULL;
-    int gdt_digits = 17;
-    int i, v, t, nvars;
-    int T, t1, t2;
-    int err = 0;
+    char *chunk;
+    size_t rowlen;
+    int nvars, nrows;
+    int T, t, t1, t2;
 
     nvars = storelist != NULL ? storelist[0] : dset->v - 1;
 
@@ -2287,12 +2567,17 @@ static int gdt_write_observations (const DATASET *dset,
     }
     T = t2 - t1 + 1;
 
-    p15 = calloc(nvars, 1);
-    if (p15 != NULL) {
-	for (i=0; i<nvars; i++) {
-	    v = savenum(storelist, i+1);
-	    p15[i] = p15_OK(dset, v);
-	}
+    rowlen = GDT_ROWLEN(nvars);
+    nrows = (8 << 20) / rowlen;
+    if (nrows < 1) {
+	nrows = 1;
+    } else if (nrows > T) {
+	nrows = T;
+    }
+
+    chunk = malloc(nrows * rowlen);
+    if (chunk == NULL) {
+	return E_ALLOC;
     }
 
     pputs(prn, "<observations ");
@@ -2300,47 +2585,31 @@ static int gdt_write_observations (const DATASET *dset,
 	    (dset->S != NULL)? "true" : "false");
     pputs(prn, ">\n");
 
-    for (t=t1; t<=t2; t++) {
-	if (skip_padding && row_is_padding(dset, t, dset->v)) {
-	    continue;
-	}
-	pputs(prn, "<obs");
-	if (dset->S != NULL) {
-	    err = gretl_xml_encode_to_buf(buf, dset->S[t], sizeof buf);
-	    if (!err) {
-		pprintf(prn, " label=\"%s\"", buf);
-	    }
-	}
-	pputs(prn, ">");
-	for (i=1; i<=nvars; i++) {
-	    v = savenum(storelist, i);
-	    if (na(dset->Z[v][t])) {
-		strcpy(numstr, "NA ");
-	    } else if (p15 == NULL || p15[i-1] == 0) {
-		/* use full default precision if required */
-		sprintf(numstr, "%.*g ", gdt_digits, dset->Z[v][t]);
-	    } else {
-		sprintf(numstr, "%.15g ", dset->Z[v][t]);
-	    }
-	    pputs(prn, numstr);
+    for (t=t1; t<=t2; t+=nrows) {
+	int r, nr = MIN(nrows, t2 - t + 1);
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (nr > 1 && gretl_use_openmp((guint64) nr * nvars))
+#endif
+	for (r=0; r<nr; r++) {
+	    gdt_format_obs(dset, storelist, nvars, t + r,
+			   skip_padding, chunk + r * rowlen);
 	}
-	if (skip_padding) {
-	    int unit = 1 + t / dset->pd;
-	    int time = t % dset->pd + 1;
 
-	    sprintf(numstr, "%d %d ", unit, time);
-	    pputs(prn, numstr);
+	for (r=0; r<nr; r++) {
+	    if (chunk[r * rowlen] != '\0') {
+		pputs(prn, chunk + r * rowlen);
+	    }
 	}
-	pputs(prn, "</obs>\n");
 
-	if (show_progress != NULL && t && ((t - dset->t1) % 50 == 0)) {
-	    (*show_progress) (50, sample_size(dset), SP_NONE);
+	if (show_progress != NULL) {
+	    (*show_progress) (nr, sample_size(dset), SP_NONE);
 	}
     }
 
     pputs(prn, "</observations>\n");
 
-    free(p15);
+    free(chunk);
 
     return 0;
 }
@@ -2634,8 +2903,8 @@ static int real_write_gdt (const char *fname,
 
     /* write listing of observations */
     if (nvars > 0) {
-	gdt_write_observations(dset, storelist, skip_padding,
-			       full_range, show_progress, prn);
+	err = gdt_write_observations(dset, storelist, skip_padding,
+				     full_range, show_progress, prn);
     }
 
     /* maybe write string tables */
@@ -3242,178 +3511,148 @@ static int process_values (DATASET *dset,
     return err;
 }
 
-static int read_observations (xmlDocPtr doc, xmlNodePtr node,
-			      DATASET *dset, double dsize,
-			      int binary, double gdtversion,
-			      const char *fname)
-{
-    xmlNodePtr cur;
-    xmlChar *tmp;
-    int n, i, t;
-    int (*show_progress) (double, double, int) = NULL;
-    int progbar = 0;
-    int n_uflow = 0;
-    int err = 0;
-
-    tmp = xmlGetProp(node, (XUC) "count");
-    if (tmp == NULL) {
-	return E_DATA;
-    }
+/* Streaming access to gdt files. Rather than building a DOM tree
+   for the entire file, which for a big dataset takes several times
+   as much memory as the data themselves, we walk the file with
+   libxml2's xmlTextReader. The top-level elements other than
+   <observations> are small, so each of these is expanded into a
+   subtree and handed to the same node-based functions as before;
+   the <obs> elements are transcribed one at a time, and the reader
+   frees each one as it moves past it.
+*/
 
-    if (sscanf((char *) tmp, "%d", &n) == 1) {
-	if (dset->n > 0 && n != dset->n) {
-	    gretl_errmsg_set(_("Inconsistent record of number of observations"));
-	    err = E_DATA;
-	} else {
-	    dset->n = n;
-	}
-    } else {
-	gretl_errmsg_set(_("Failed to parse number of observations"));
-	err = E_DATA;
-    }
+static xmlTextReaderPtr gdt_reader_open (const char *fname,
+					 xmlNodePtr *proot,
+					 int *err)
+{
+    xmlTextReaderPtr reader;
+    int options, ret;
 
-    free(tmp);
-    if (err) {
-	return err;
-    }
+    LIBXML_TEST_VERSION;
 
-    if (dsize > 100000 && !binary) {
-	show_progress = get_plugin_function("show_progress");
-	if (show_progress != NULL) {
-	    progbar = 1;
-	}
-    }
+    options = XML_PARSE_HUGE | XML_PARSE_NOBLANKS;
+#if LIBXML_VERSION >= 21500
+    options |= XML_PARSE_UNZIP;
+#endif
 
-    tmp = xmlGetProp(node, (XUC) "labels");
-    if (tmp) {
-	if (!strcmp((char *) tmp, "true")) {
-	    if (dataset_allocate_obs_markers(dset)) {
-		return E_ALLOC;
-	    }
-	}
-	free(tmp);
+    if (gdt_zsrc != NULL) {
+	reader = xmlReaderForIO(zip_xml_read, zip_xml_close,
+				gdt_zsrc->xml, fname, NULL, options);
     } else {
-	return E_DATA;
+	reader = xmlReaderForFile(fname, NULL, options);
     }
-
-    if (dset->endobs[0] == '\0') {
-	sprintf(dset->endobs, "%d", dset->n);
+    if (reader == NULL) {
+	gretl_errmsg_sprintf(_("xmlReadFile failed on %s"), fname);
+	*err = 1;
+	return NULL;
     }
 
-    dset->t2 = dset->n - 1;
-
-    for (i=0; i<dset->v; i++) {
-	dset->Z[i] = malloc(dset->n * sizeof **dset->Z);
-	if (dset->Z[i] == NULL) {
-	    return E_ALLOC;
-	}
+    /* advance to the root element */
+    while ((ret = xmlTextReaderRead(reader)) == 1 &&
+	   xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT) {
+	;
     }
 
-    for (t=0; t<dset->n; t++) {
-	dset->Z[0][t] = 1.0;
+    if (ret != 1) {
+	gretl_errmsg_sprintf(_("%s: empty document"), fname);
+	*err = 1;
+    } else if (xmlStrcmp(xmlTextReaderConstName(reader), (XUC) "gretldata")) {
+	gretl_errmsg_sprintf(_("File of the wrong type, root node not %s"),
+			     "gretldata");
+	fprintf(stderr, "Unexpected root node '%s'\n",
+		(char *) xmlTextReaderConstName(reader));
+	*err = 1;
+    } else {
+	/* the root node, complete with its attributes, remains
+	   valid for the life of the reader */
+	*proot = xmlTextReaderCurrentNode(reader);
     }
 
-    if (binary) {
-	err = read_binary_data(fname, dset, binary, gdtversion,
-			       dset->v, NULL);
-	if (!dset->markers) {
-	    goto bailout;
-	}
+    if (*err) {
+	xmlFreeTextReader(reader);
+	reader = NULL;
     }
 
-    /* now get individual obs info: labels and values */
-    cur = node->xmlChildrenNode;
-    while (cur && xmlIsBlankNode(cur)) {
-	cur = cur->next;
-    }
+    return reader;
+}
 
-    if (cur == NULL) {
-	gretl_errmsg_set(_("Got no observations\n"));
-	return E_DATA;
-    }
+/* Position @reader on the next element at @depth within the
+   current parent. Returns 1 on success, 0 if the parent element
+   has ended, or -1 on a parse error. If @pending is non-zero
+   on input the current node has not yet been examined; it is
+   set to 1 on return if the reader has been left on such a
+   node, namely the first node beyond the parent.
+*/
 
-    if (progbar) {
-	(*show_progress)(0, dsize, SP_LOAD_INIT);
-    }
+static int gdt_next_element (xmlTextReaderPtr reader, int depth,
+			     int *pending)
+{
+    int ret;
 
-    t = 0;
-    while (cur != NULL) {
-        if (!xmlStrcmp(cur->name, (XUC) "obs")) {
-	    if (dset->markers) {
-		tmp = xmlGetProp(cur, (XUC) "label");
-		if (tmp) {
-		    transcribe_string(dset->S[t], (char *) tmp, OBSLEN);
-		    free(tmp);
-		} else {
-		    gretl_errmsg_sprintf(_("Case marker missing at obs %d"), t+1);
-		    return E_DATA;
-		}
-	    }
-	    if (!binary) {
-		tmp = xmlNodeListGetRawString(doc, cur->xmlChildrenNode, 1);
-		if (tmp) {
-		    err = process_values(dset, t, (char *) tmp, dset->v, NULL, &n_uflow);
-		    free(tmp);
-		} else if (dset->v > 1) {
-		    gretl_errmsg_sprintf(_("Values missing at observation %d"), t+1);
-		    err = E_DATA;
-		}
-	    }
-	    t++;
+    while (1) {
+	if (*pending) {
+	    *pending = 0;
+	} else if ((ret = xmlTextReaderRead(reader)) != 1) {
+	    return ret < 0 ? -1 : 0;
 	}
-
-	if (err) {
-	    break;
+	if (xmlTextReaderDepth(reader) < depth) {
+	    *pending = 1;
+	    return 0;
+	} else if (xmlTextReaderDepth(reader) == depth &&
+		   xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT) {
+	    return 1;
 	}
+    }
+}
 
-	cur = cur->next;
+/* Move @reader beyond the element it's on, including any
+   content, leaving it on an unexamined node. */
 
-	if (cur != NULL && t == dset->n) {
-	    /* got too many observations */
-	    t = dset->n + 1;
-	    break;
-	}
+static int gdt_skip_element (xmlTextReaderPtr reader, int *pending)
+{
+    int ret = xmlTextReaderNext(reader);
 
-	if (progbar && t > 0 && t % 50 == 0) {
-	    (*show_progress) (50, dset->n, SP_NONE);
-	}
-    }
+    *pending = (ret == 1);
 
- bailout:
+    return ret < 0 ? E_DATA : 0;
+}
 
-    if (progbar) {
-	(*show_progress)(0, dset->n, SP_FINISH);
-    }
+/* Get the complete subtree for the (small) element on which
+   @reader is positioned. */
 
-    if (!err && t != dset->n) {
-	gretl_errmsg_set(_("Number of observations does not match declaration"));
-	err = E_DATA;
-    }
+static xmlNodePtr gdt_expand_element (xmlTextReaderPtr reader, int *err)
+{
+    xmlNodePtr node = xmlTextReaderExpand(reader);
 
-    if (!err && n_uflow > 0) {
-	set_underflow_warning(n_uflow);
+    if (node == NULL) {
+	*err = E_DATA;
     }
 
-    return err;
+    return node;
 }
 
-static int read_observations_subset (xmlDocPtr doc,
-				     xmlNodePtr node,
-				     DATASET *dset,
-				     int binary,
-				     double gdtversion,
-				     const char *fname,
-				     int fullv,
-				     const int *vlist,
-				     gretlopt opt)
+/* Read the <observations> element on which @reader is positioned,
+   for all series (@vlist = NULL) or a selection; @fullv is the
+   number of series in the file, including the constant. Markers
+   are read only if @markers is non-zero. On return @reader is
+   beyond the element, as per gdt_skip_element().
+*/
+
+static int read_observations (xmlTextReaderPtr reader,
+			      DATASET *dset, double dsize,
+			      int binary, double gdtversion,
+			      const char *fname, int fullv,
+			      const int *vlist, int markers,
+			      int *pending)
 {
-    xmlNodePtr cur;
     xmlChar *tmp;
-    int n, i, t;
+    int n, i, t = 0;
+    int (*show_progress) (double, double, int) = NULL;
+    int progbar = 0;
     int n_uflow = 0;
-    int err = 0;
+    int ret = 1, err = 0;
 
-    tmp = xmlGetProp(node, (XUC) "count");
+    tmp = xmlTextReaderGetAttribute(reader, (XUC) "count");
     if (tmp == NULL) {
 	return E_DATA;
     }
@@ -3435,11 +3674,19 @@ static int read_observations_subset (xmlDocPtr doc,
 	return err;
     }
 
-    if (opt & OPT_M) {
-	tmp = xmlGetProp(node, (XUC) "labels");
+    if (dsize > 100000 && !binary) {
+	show_progress = get_plugin_function("show_progress");
+	if (show_progress != NULL) {
+	    progbar = 1;
+	}
+    }
+
+    if (markers) {
+	tmp = xmlTextReaderGetAttribute(reader, (XUC) "labels");
 	if (tmp) {
 	    if (!strcmp((char *) tmp, "true")) {
 		if (dataset_allocate_obs_markers(dset)) {
+		    free(tmp);
 		    return E_ALLOC;
 		}
 	    }
@@ -3469,63 +3716,75 @@ static int read_observations_subset (xmlDocPtr doc,
     if (binary) {
 	err = read_binary_data(fname, dset, binary, gdtversion,
 			       fullv, vlist);
-	if (!dset->markers) {
+	if (err || !dset->markers) {
+	    /* nothing more to get from the XML */
 	    goto bailout;
 	}
     }
 
-    /* now get individual obs info: labels and values */
-    cur = node->xmlChildrenNode;
-    while (cur && xmlIsBlankNode(cur)) {
-	cur = cur->next;
-    }
-
-    if (cur == NULL) {
-	gretl_errmsg_set(_("Got no observations\n"));
-	return E_DATA;
+    if (progbar) {
+	(*show_progress)(0, dsize, SP_LOAD_INIT);
     }
 
+    /* now get individual obs info: labels and values */
     t = 0;
-    while (cur != NULL) {
-        if (!xmlStrcmp(cur->name, (XUC) "obs")) {
-	    if (dset->markers) {
-		tmp = xmlGetProp(cur, (XUC) "label");
-		if (tmp) {
-		    transcribe_string(dset->S[t], (char *) tmp, OBSLEN);
-		    free(tmp);
-		} else {
-		    gretl_errmsg_sprintf(_("Case marker missing at obs %d"), t+1);
-		    return E_DATA;
-		}
+    while (!err && (ret = gdt_next_element(reader, 2, pending)) == 1) {
+	if (xmlStrcmp(xmlTextReaderConstName(reader), (XUC) "obs")) {
+	    err = gdt_skip_element(reader, pending);
+	    continue;
+	}
+	if (t == dset->n) {
+	    /* got too many observations */
+	    t = dset->n + 1;
+	    break;
+	}
+	if (dset->markers) {
+	    tmp = xmlTextReaderGetAttribute(reader, (XUC) "label");
+	    if (tmp) {
+		transcribe_string(dset->S[t], (char *) tmp, OBSLEN);
+		free(tmp);
+	    } else {
+		gretl_errmsg_sprintf(_("Case marker missing at obs %d"), t+1);
+		err = E_DATA;
+		break;
 	    }
-	    if (!binary) {
-		tmp = xmlNodeListGetRawString(doc, cur->xmlChildrenNode, 1);
-		if (tmp) {
-		    err = process_values(dset, t, (char *) tmp, fullv, vlist, &n_uflow);
-		    free(tmp);
-		} else if (dset->v > 1) {
-		    gretl_errmsg_sprintf(_("Values missing at observation %d"), t+1);
-		    err = E_DATA;
-		}
+	}
+	if (!binary) {
+	    tmp = xmlTextReaderReadString(reader);
+	    if (tmp != NULL && *tmp != '\0') {
+		err = process_values(dset, t, (char *) tmp, fullv, vlist, &n_uflow);
+	    } else if (dset->v > 1) {
+		gretl_errmsg_sprintf(_("Values missing at observation %d"), t+1);
+		err = E_DATA;
 	    }
-	    t++;
+	    free(tmp);
 	}
-
-	if (err) {
-	    break;
+	t++;
+	if (!err) {
+	    err = gdt_skip_element(reader, pending);
 	}
-
-	cur = cur->next;
-
-	if (cur != NULL && t == dset->n) {
-	    /* got too many observations */
-	    t = dset->n + 1;
-	    goto bailout;
+	if (progbar && t % 50 == 0) {
+	    (*show_progress) (50, dset->n, SP_NONE);
 	}
     }
 
+    if (!err && ret < 0) {
+	err = E_DATA;
+    } else if (!err && t == 0 && dset->n > 0) {
+	gretl_errmsg_set(_("Got no observations\n"));
+	err = E_DATA;
+    }
+
  bailout:
 
+    if (progbar) {
+	(*show_progress)(0, dset->n, SP_FINISH);
+    }
+
+    if (binary && !err && !dset->markers) {
+	err = gdt_skip_element(reader, pending);
+    }
+
     if (!err && t != dset->n) {
 	gretl_errmsg_set(_("Number of observations does not match declaration"));
 	err = E_DATA;
@@ -4052,9 +4311,10 @@ static int real_read_gdt (const char *fname, const char *srcname,
 			  DATASET *dset, gretlopt opt, PRN *prn)
 {
     DATASET *tmpset;
-    xmlDocPtr doc = NULL;
-    xmlNodePtr cur;
+    xmlTextReaderPtr reader = NULL;
+    xmlNodePtr cur = NULL;
     int gotvars = 0, err = 0;
+    int ret = 1, pending = 0;
     int caldata = 0, repad = 0;
     int sample[2] = {0};
     int readsmpl = 0;
@@ -4082,7 +4342,7 @@ static int real_read_gdt (const char *fname, const char *srcname,
 	goto bailout;
     }
 
-    err = gretl_xml_open_doc_root(fname, "gretldata", &doc, &cur);
+    reader = gdt_reader_open(fname, &cur, &err);
     if (err) {
 	goto bailout;
     }
@@ -4146,15 +4406,38 @@ static int real_read_gdt (const char *fname, const char *srcname,
     binary = gdt_binary_order(cur);
 
 #if GDT_DEBUG
-    fprintf(stderr, "starting to walk XML tree...\n");
+    fprintf(stderr, "starting to read XML elements...\n");
 #endif
 
-    /* Now walk the tree */
-    cur = cur->xmlChildrenNode;
-    while (cur != NULL && !err) {
+    /* Now walk the top-level elements */
+    while (!err && (ret = gdt_next_element(reader, 1, &pending)) == 1) {
+	const xmlChar *name = xmlTextReaderConstName(reader);
+
+	if (!xmlStrcmp(name, (XUC) "observations")) {
+	    if (!gotvars) {
+		gretl_errmsg_set(_("Variables information is missing"));
+		err = 1;
+	    } else {
+		double dsize = (opt & OPT_B)? (double) fsz : 0;
+
+		err = read_observations(reader, tmpset, dsize, binary,
+					gdtversion, fname, tmpset->v,
+					NULL, 1, &pending);
+		if (err) {
+		    fprintf(stderr, "error %d in read_observations\n", err);
+		}
+	    }
+	    continue;
+	}
+
+	cur = gdt_expand_element(reader, &err);
+	if (err) {
+	    break;
+	}
+
         if (!xmlStrcmp(cur->name, (XUC) "description")) {
 	    tmpset->descrip = (char *)
-		xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+		xmlNodeListGetString(cur->doc, cur->xmlChildrenNode, 1);
 	} else if (readsmpl && !xmlStrcmp(cur->name, (XUC) "sample")) {
 	    err = process_sample(cur, sample, tmpset);
 	    if (err) {
@@ -4169,25 +4452,12 @@ static int real_read_gdt (const char *fname, const char *srcname,
 	    } else {
 		gotvars = 1;
 	    }
-	} else if (!xmlStrcmp(cur->name, (XUC) "observations")) {
-	    if (!gotvars) {
-		gretl_errmsg_set(_("Variables information is missing"));
-		err = 1;
-	    } else {
-		double dsize = (opt & OPT_B)? (double) fsz : 0;
-
-		err = read_observations(doc, cur, tmpset, dsize,
-					binary, gdtversion, fname);
-		if (err) {
-		    fprintf(stderr, "error %d in read_observations\n", err);
-		}
-	    }
 	} else if (!xmlStrcmp(cur->name, (XUC) "string-tables")) {
 	    if (!gotvars) {
 		gretl_errmsg_set(_("Variables information is missing"));
 		err = E_DATA;
 	    } else {
-		err = process_string_tables(doc, cur, tmpset, 0);
+		err = process_string_tables(cur->doc, cur, tmpset, 0);
 		if (err) {
 		    fprintf(stderr, "error %d processing string tables\n", err);
 		}
@@ -4204,12 +4474,16 @@ static int real_read_gdt (const char *fname, const char *srcname,
 	    }
 	}
 	if (!err) {
-	    cur = cur->next;
+	    err = gdt_skip_element(reader, &pending);
 	}
     }
 
+    if (!err && ret < 0) {
+	err = E_DATA;
+    }
+
 #if GDT_DEBUG
-    fprintf(stderr, "done walking XML tree, err = %d\n", err);
+    fprintf(stderr, "done reading XML elements, err = %d\n", err);
 #endif
 
     if (!err && !gotvars) {
@@ -4240,8 +4514,8 @@ static int real_read_gdt (const char *fname, const char *srcname,
 	gretl_pop_c_numeric_locale();
     }
 
-    if (doc != NULL) {
-	xmlFreeDoc(doc);
+    if (reader != NULL) {
+	xmlFreeTextReader(reader);
     }
 
     if (dset != NULL) {
@@ -4296,9 +4570,10 @@ static int real_read_gdt_subset (const char *fname,
 				 gretlopt opt)
 {
     DATASET *tmpset;
-    xmlDocPtr doc = NULL;
-    xmlNodePtr cur;
+    xmlTextReaderPtr reader = NULL;
+    xmlNodePtr cur = NULL;
     double gdtversion = 1.0;
+    int ret = 1, pending = 0;
     int gotvars = 0, gotobs = 0;
     int caldata = 0;
     int in_c_locale = 0;
@@ -4314,7 +4589,7 @@ static int real_read_gdt_subset (const char *fname,
 	goto bailout;
     }
 
-    err = gretl_xml_open_doc_root(fname, "gretldata", &doc, &cur);
+    reader = gdt_reader_open(fname, &cur, &err);
     if (err) {
 	goto bailout;
     }
@@ -4360,45 +4635,57 @@ static int real_read_gdt_subset (const char *fname,
     binary = gdt_binary_order(cur);
 
 #if GDT_DEBUG
-    fprintf(stderr, "%s: starting to walk XML tree...\n", fname);
+    fprintf(stderr, "%s: starting to read XML elements...\n", fname);
 #endif
 
-    /* Now walk the tree */
-    cur = cur->xmlChildrenNode;
-    while (cur != NULL && !err) {
-        if (!xmlStrcmp(cur->name, (XUC) "variables")) {
-	    err = process_varlist_subset(cur, tmpset, &fullv, vlist);
-	    if (!err) {
-		gotvars = 1;
-	    }
-	} else if (!xmlStrcmp(cur->name, (XUC) "observations")) {
+    /* Now walk the top-level elements */
+    while (!err && (ret = gdt_next_element(reader, 1, &pending)) == 1) {
+	const xmlChar *name = xmlTextReaderConstName(reader);
+
+	if (!xmlStrcmp(name, (XUC) "observations")) {
 	    if (!gotvars) {
 		gretl_errmsg_set(_("Variables information is missing"));
 		err = E_DATA;
 	    } else {
-		err = read_observations_subset(doc, cur, tmpset,
-					       binary, gdtversion,
-					       fname, fullv, vlist,
-					       opt);
+		err = read_observations(reader, tmpset, 0, binary,
+					gdtversion, fname, fullv, vlist,
+					(opt & OPT_M) ? 1 : 0, &pending);
 	    }
 	    if (!err) {
 		gotobs = 1;
 	    }
-	} else if (!xmlStrcmp(cur->name, (XUC) "string-tables")) {
+	    continue;
+	}
+	if (!xmlStrcmp(name, (XUC) "variables")) {
+	    cur = gdt_expand_element(reader, &err);
+	    if (!err) {
+		err = process_varlist_subset(cur, tmpset, &fullv, vlist);
+	    }
+	    if (!err) {
+		gotvars = 1;
+	    }
+	} else if (!xmlStrcmp(name, (XUC) "string-tables")) {
 	    if (!gotvars) {
 		gretl_errmsg_set(_("Variables information is missing"));
 		err = 1;
 	    } else {
-		err = process_string_tables(doc, cur, tmpset, 1);
+		cur = gdt_expand_element(reader, &err);
+		if (!err) {
+		    err = process_string_tables(cur->doc, cur, tmpset, 1);
+		}
 	    }
 	}
 	if (!err) {
-	    cur = cur->next;
+	    err = gdt_skip_element(reader, &pending);
 	}
     }
 
+    if (!err && ret < 0) {
+	err = E_DATA;
+    }
+
 #if GDT_DEBUG
-    fprintf(stderr, "done walking XML tree...\n");
+    fprintf(stderr, "done reading XML elements...\n");
 #endif
 
     if (!err && !gotvars) {
@@ -4421,8 +4708,8 @@ static int real_read_gdt_subset (const char *fname,
 	gretl_pop_c_numeric_locale();
     }
 
-    if (doc != NULL) {
-	xmlFreeDoc(doc);
+    if (reader != NULL) {
+	xmlFreeTextReader(reader);
     }
 
     if (!err) {
@@ -4444,8 +4731,9 @@ static int real_read_gdt_varnames (const char *fname,
 				   int *nvars)
 {
     DATASET *tmpset;
-    xmlDocPtr doc = NULL;
-    xmlNodePtr cur;
+    xmlTextReaderPtr reader = NULL;
+    xmlNodePtr cur = NULL;
+    int pending = 0;
     int gotvars = 0;
     int caldata = 0;
     int in_c_locale = 0;
@@ -4459,7 +4747,7 @@ static int real_read_gdt_varnames (const char *fname,
 	goto bailout;
     }
 
-    err = gretl_xml_open_doc_root(fname, "gretldata", &doc, &cur);
+    reader = gdt_reader_open(fname, &cur, &err);
     if (err) {
 	goto bailout;
     }
@@ -4495,17 +4783,20 @@ static int real_read_gdt_varnames (const char *fname,
 	goto bailout;
     }
 
-    /* Now walk the tree */
-    cur = cur->xmlChildrenNode;
-    while (cur != NULL && !err) {
-        if (!xmlStrcmp(cur->name, (XUC) "variables")) {
-	    err = process_varlist(cur, tmpset, 1);
+    /* Look for the variables element: there's no need to read
+       any further than that */
+    while (!err && gdt_next_element(reader, 1, &pending) == 1) {
+        if (!xmlStrcmp(xmlTextReaderConstName(reader), (XUC) "variables")) {
+	    cur = gdt_expand_element(reader, &err);
+	    if (!err) {
+		err = process_varlist(cur, tmpset, 1);
+	    }
 	    if (!err) {
 		gotvars = 1;
 	    }
 	    break;
 	}
-	cur = cur->next;
+	err = gdt_skip_element(reader, &pending);
     }
 
     if (!err && !gotvars) {
@@ -4519,8 +4810,8 @@ static int real_read_gdt_varnames (const char *fname,
 	gretl_pop_c_numeric_locale();
     }
 
-    if (doc != NULL) {
-	xmlFreeDoc(doc);
+    if (reader != NULL) {
+	xmlFreeTextReader(reader);
     }
 
     if (!err) {
@@ -4553,9 +4844,11 @@ static int read_gbin (const char *fname, DATASET *dset,
 }
 
 static int read_gbin_subset (const char *fname, DATASET *dset,
-			     int *vlist, gretlopt opt)
+			     int *vlist, const char *obsrange,
+			     gretlopt opt)
 {
-    int (*reader) (const char *, DATASET *, int *, gretlopt);
+    int (*reader) (const char *, DATASET *, int *, const char *,
+		   gretlopt);
     int err = 0;
 
     reader = get_plugin_function("purebin_read_subset");
@@ -4563,7 +4856,7 @@ static int read_gbin_subset (const char *fname, DATASET *dset,
     if (reader == NULL) {
         err = 1;
     } else {
-	err = (*reader)(fname, dset, vlist, opt);
+	err = (*reader)(fname, dset, vlist, obsrange, opt);
     }
 
     return err;
@@ -4594,8 +4887,11 @@ static int is_purebin_file (const char *fname)
     if (fp != NULL) {
 	char buf[16];
 
+	/* allow for the extended form of the magic string,
+	   as written for formats other than version 1 */
 	if (fread(buf, 1, 14, fp) == 14 &&
-	    !strcmp(buf, "gretl-purebin")) {
+	    (!memcmp(buf, "gretl-purebin", 14) ||
+	     !memcmp(buf, "gretl-purebin+", 14))) {
 	    ret = 1;
 	}
 	fclose(fp);
@@ -4627,10 +4923,17 @@ int gretl_read_gdt (const char *fname, DATASET *dset,
 	return read_gbin(fname, dset, opt, prn);
     } else if (gdtb) {
 	/* zipfile with gdt + binary */
+	gdt_zsource zs = {0};
 	gchar *zdir;
 	int id = -1;
 	int err;
 
+	if (gdt_zsource_open(&zs, fname, 1) == 0) {
+	    err = real_read_gdt(fname, NULL, dset, opt, prn);
+	    gdt_zsource_close(&zs);
+	    return err;
+	}
+
 #ifdef HAVE_MPI
 	if (gretl_mpi_initialized()) {
 	    id = gretl_mpi_rank();
@@ -4669,50 +4972,75 @@ int gretl_read_gdt (const char *fname, DATASET *dset,
  * @fname: name of file to open for reading.
  * @dset: dataset struct.
  * @vlist: list of series to extract.
+ * @obsrange: range of observations to extract, or NULL
+ * for all (see dataset_obs_range_from_string()).
  * @opt: may include OPT_M to retrieve the observation
  * markers associated with the data, if any.
  *
  * Read specified series from native file into @dset,
- * which should be "empty" on input.
+ * which should be "empty" on input. In the case of a
+ * purebin .gdtb file, only the data actually selected
+ * are read from the file.
  *
  * Returns: 0 on successful completion, non-zero otherwise.
  */
 
 int gretl_read_gdt_subset (const char *fname, DATASET *dset,
-			   int *vlist, gretlopt opt)
+			   int *vlist, const char *obsrange,
+			   gretlopt opt)
 {
     int gdtb = has_suffix(fname, ".gdtb");
     int err = 0;
 
     if (gdtb && is_purebin_file(fname)) {
-	err = read_gbin_subset(fname, dset, vlist, opt);
+	return read_gbin_subset(fname, dset, vlist, obsrange, opt);
     } else if (gdtb) {
 	/* zipfile with gdt + binary */
+	gdt_zsource zs = {0};
 	gchar *zdir;
-	int err;
 
-	zdir = g_strdup_printf("%stmp-unzip", gretl_dotdir());
-	err = gretl_mkdir(zdir);
-
-	if (!err) {
-	    err = gretl_unzip_into(fname, zdir);
-	    if (err) {
-		gretl_errmsg_ensure("Problem opening data file");
-	    } else {
-		char xmlfile[FILENAME_MAX];
+	if (gdt_zsource_open(&zs, fname, 1) == 0) {
+	    err = real_read_gdt_subset(fname, dset, vlist, opt);
+	    gdt_zsource_close(&zs);
+	} else {
+	    zdir = g_strdup_printf("%stmp-unzip", gretl_dotdir());
+	    err = gretl_mkdir(zdir);
+	    if (!err) {
+		err = gretl_unzip_into(fname, zdir);
+		if (err) {
+		    gretl_errmsg_ensure("Problem opening data file");
+		} else {
+		    char xmlfile[FILENAME_MAX];
 
-		gretl_build_path(xmlfile, zdir, "data.xml", NULL);
-		err = real_read_gdt_subset(xmlfile, dset, vlist, opt);
+		    gretl_build_path(xmlfile, zdir, "data.xml", NULL);
+		    err = real_read_gdt_subset(xmlfile, dset, vlist, opt);
+		}
+		gretl_deltree(zdir);
 	    }
-	    gretl_deltree(zdir);
+	    g_free(zdir);
 	}
-
-	g_free(zdir);
     } else {
 	/* plain XML file */
 	err = real_read_gdt_subset(fname, dset, vlist, opt);
     }
 
+    if (!err && obsrange != NULL) {
+	/* the best we can do is to discard the excess rows */
+	err = dataset_obs_range_from_string(obsrange, dset,
+					    &dset->t1, &dset->t2);
+	if (!err && dataset_is_panel(dset)) {
+	    /* whole units are dropped: the time dimension is unchanged */
+	    double sd0 = dset->sd0;
+
+	    err = dataset_shrink_obs_range(dset);
+	    dset->sd0 = sd0;
+	    ntolabel(dset->stobs, 0, dset);
+	    ntolabel(dset->endobs, dset->n - 1, dset);
+	} else if (!err) {
+	    err = dataset_shrink_obs_range(dset);
+	}
+    }
+
 #if GDT_DEBUG
     fprintf(stderr, "gretl_read_gdt_subset: returning %d\n", err);
 #endif
@@ -4742,27 +5070,30 @@ int gretl_read_gdt_varnames (const char *fname,
 	err = read_gbin_varnames(fname, vnames, nvars);
     } else if (gdtb) {
 	/* zipfile with gdt + binary */
+	gdt_zsource zs = {0};
 	gchar *zdir;
-	int err;
 
-	zdir = g_strdup_printf("%stmp-unzip", gretl_dotdir());
-	err = gretl_mkdir(zdir);
-
-	if (!err) {
-	    err = gretl_unzip_into(fname, zdir);
-	    if (err) {
-		gretl_errmsg_ensure("Problem opening data file");
-	    } else {
-		char xmlfile[FILENAME_MAX];
+	if (gdt_zsource_open(&zs, fname, 0) == 0) {
+	    err = real_read_gdt_varnames(fname, vnames, nvars);
+	    gdt_zsource_close(&zs);
+	} else {
+	    zdir = g_strdup_printf("%stmp-unzip", gretl_dotdir());
+	    err = gretl_mkdir(zdir);
+	    if (!err) {
+		err = gretl_unzip_into(fname, zdir);
+		if (err) {
+		    gretl_errmsg_ensure("Problem opening data file");
+		} else {
+		    char xmlfile[FILENAME_MAX];
 
-		gretl_build_path(xmlfile, zdir, "data.xml", NULL);
-		err = real_read_gdt_varnames(xmlfile, vnames,
-					     nvars);
+		    gretl_build_path(xmlfile, zdir, "data.xml", NULL);
+		    err = real_read_gdt_varnames(xmlfile, vnames,
+						 nvars);
+		}
+		gretl_deltree(zdir);
 	    }
-	    gretl_deltree(zdir);
+	    g_free(zdir);
 	}
-
-	g_free(zdir);
     } else {
 	/* plain XML file */
 	err = real_read_gdt_varnames(fname, vnames, nvars);
@@ -4782,9 +5113,10 @@ int gretl_read_gdt_varnames (const char *fname,
 
 char *gretl_get_gdt_description (const char *fname, int *err)
 {
-    xmlDocPtr doc;
-    xmlNodePtr cur;
+    xmlTextReaderPtr reader;
+    xmlNodePtr cur = NULL;
     xmlChar *buf = NULL;
+    int pending = 0;
 
     gretl_error_clear();
 
@@ -4794,18 +5126,19 @@ char *gretl_get_gdt_description (const char *fname, int *err)
 	return NULL;
     }
 
-    *err = gretl_xml_open_doc_root(fname, "gretldata", &doc, &cur);
+    reader = gdt_reader_open(fname, &cur, err);
     if (*err) {
 	return NULL;
     }
 
-    cur = cur->xmlChildrenNode;
-    while (cur != NULL) {
-        if (!xmlStrcmp(cur->name, (XUC) "description")) {
-	    buf = xmlNodeListGetString(doc, cur->xmlChildrenNode, 1);
+    /* the description, if present, comes first */
+    while (gdt_next_element(reader, 1, &pending) == 1) {
+        if (!xmlStrcmp(xmlTextReaderConstName(reader), (XUC) "description")) {
+	    buf = xmlTextReaderReadString(reader);
 	    break;
-        }
-	cur = cur->next;
+        } else if (gdt_skip_element(reader, &pending)) {
+	    break;
+	}
     }
 
     if (buf == NULL) {
@@ -4813,46 +5146,51 @@ char *gretl_get_gdt_description (const char *fname, int *err)
 	*err = E_DATA;
     }
 
-    xmlFreeDoc(doc);
+    xmlFreeTextReader(reader);
 
     return (char *) buf;
 }
 
+/* Get the name of the root element of @fname: there's no need
+   to parse beyond its start tag. */
+
 static char *gretl_xml_get_doc_type (const char *fname, int *err)
 {
-    xmlDocPtr doc;
-    xmlNodePtr node;
-    int options;
-    char *ret = NULL;
+    xmlTextReaderPtr reader;
+    int options, ret;
+    char *rootname = NULL;
 
     options = XML_PARSE_HUGE;
 #if LIBXML_VERSION >= 21500
     options |= XML_PARSE_UNZIP;
 #endif
 
-    doc = xmlReadFile(fname, NULL, options);
+    reader = xmlReaderForFile(fname, NULL, options);
 
-    if (doc == NULL) {
+    if (reader == NULL) {
 	gretl_errmsg_sprintf(_("xmlReadFile failed on %s"), fname);
 	*err = E_DATA;
+	return NULL;
+    }
+
+    while ((ret = xmlTextReaderRead(reader)) == 1 &&
+	   xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT) {
+	;
+    }
+
+    if (ret != 1) {
+	gretl_errmsg_sprintf(_("%s: empty document"), fname);
+	*err = E_DATA;
     } else {
-	node = xmlDocGetRootElement(doc);
-	if (node == NULL) {
-	    gretl_errmsg_sprintf(_("%s: empty document"), fname);
-	    *err = E_DATA;
-	} else {
-	    ret = gretl_strdup((char *) node->name);
-	    if (ret == NULL) {
-		*err = E_ALLOC;
-	    }
+	rootname = gretl_strdup((char *) xmlTextReaderConstName(reader));
+	if (rootname == NULL) {
+	    *err = E_ALLOC;
 	}
     }
 
-    if (doc != NULL) {
-	xmlFreeDoc(doc);
-    }
+    xmlFreeTextReader(reader);
 
-    return ret;
+    return rootname;
 }
 
 /* This is called in response to the "include" command in the CLI
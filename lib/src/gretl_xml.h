@@ -179,7 +179,8 @@ int gretl_read_gdt (const char *fname, DATASET *dset,
 		    gretlopt opt, PRN *prn);
 
 int gretl_read_gdt_subset (const char *fname, DATASET *dset,
-			   int *vlist, gretlopt opt);
+			   int *vlist, const char *obsrange,
+			   gretlopt opt);
 
 int gretl_read_gdt_varnames (const char *fname,
 			     char ***vnames,
@@ -749,3 +749,438 @@ int package_make_zipfile (const char *gfnname,
 
     return err;
 }
+
+/* below: native read access to individual members of a zip
+   archive, so that (for example) the components of a zipped
+   gdtb file can be streamed into their readers without first
+   being unpacked to disk. Only "stored" and "deflated" members
+   of non-zip64 archives are handled; on anything else the
+   open function fails with E_NOTIMP and the caller can fall
+   back on gretl_unzip_into().
+*/
+
+#define ZIP_EOCD_SIG  0x06054b50
+#define ZIP_CDIR_SIG  0x02014b50
+#define ZIP_LOCAL_SIG 0x04034b50
+#define ZIP_EOCD_LEN  22
+#define ZIP_INBUF     65536
+
+struct gretl_zip_member_ {
+    FILE *fp;           /* handle on the archive */
+    int method;         /* 0 = stored, 8 = deflated */
+    guint32 csize;      /* compressed size */
+    guint32 usize;      /* uncompressed size */
+    guint32 cleft;      /* compressed bytes not yet read */
+    z_stream zs;        /* inflation state */
+    int zs_init;        /* is @zs initialized? */
+    int done;           /* reached end of member */
+    unsigned char *in;  /* input buffer for inflation */
+};
+
+static guint32 zip_get16 (const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static guint32 zip_get32 (const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((guint32) p[3] << 24);
+}
+
+/* find the end-of-central-directory record and read the offset
+   and size of the central directory */
+
+static int zip_find_cdir (FILE *fp, guint32 *cdoff, guint32 *cdsize,
+			  int *nentries)
+{
+    unsigned char *buf;
+    long fsize, start;
+    size_t len;
+    int i, err = E_DATA;
+
+    if (fseek(fp, 0, SEEK_END) != 0 || (fsize = ftell(fp)) < ZIP_EOCD_LEN) {
+	return E_DATA;
+    }
+
+    /* the record may be followed by a comment of up to 64K */
+    start = fsize - ZIP_EOCD_LEN - 65535;
+    if (start < 0) {
+	start = 0;
+    }
+    len = fsize - start;
+    buf = malloc(len);
+    if (buf == NULL) {
+	return E_ALLOC;
+    }
+
+    if (fseek(fp, start, SEEK_SET) == 0 && fread(buf, 1, len, fp) == len) {
+	for (i=len-ZIP_EOCD_LEN; i>=0; i--) {
+	    if (zip_get32(buf + i) == ZIP_EOCD_SIG) {
+		*nentries = zip_get16(buf + i + 10);
+		*cdsize = zip_get32(buf + i + 12);
+		*cdoff = zip_get32(buf + i + 16);
+		if (*cdoff == 0xffffffff || *nentries == 0xffff) {
+		    err = E_NOTIMP; /* zip64 */
+		} else {
+		    err = 0;
+		}
+		break;
+	    }
+	}
+    }
+
+    free(buf);
+
+    return err;
+}
+
+static int zip_locate_member (gretl_zip_member *zm, const char *name)
+{
+    unsigned char *cd, *p, lh[30];
+    guint32 cdoff, cdsize, lhoff = 0;
+    int i, n, nlen, found = 0;
+    int err;
+
+    err = zip_find_cdir(zm->fp, &cdoff, &cdsize, &n);
+    if (err) {
+	return err;
+    }
+
+    cd = malloc(cdsize);
+    if (cd == NULL) {
+	return E_ALLOC;
+    }
+    if (fseek(zm->fp, cdoff, SEEK_SET) != 0 ||
+	fread(cd, 1, cdsize, zm->fp) != cdsize) {
+	free(cd);
+	return E_DATA;
+    }
+
+    nlen = strlen(name);
+    p = cd;
+
+    for (i=0; i<n && !err; i++) {
+	if (p + 46 > cd + cdsize || zip_get32(p) != ZIP_CDIR_SIG) {
+	    err = E_DATA;
+	} else if (zip_get16(p + 28) == nlen &&
+		   p + 46 + nlen <= cd + cdsize &&
+		   !strncmp((char *) p + 46, name, nlen)) {
+	    zm->method = zip_get16(p + 10);
+	    zm->csize = zip_get32(p + 20);
+	    zm->usize = zip_get32(p + 24);
+	    lhoff = zip_get32(p + 42);
+	    found = 1;
+	    break;
+	} else {
+	    p += 46 + zip_get16(p + 28) + zip_get16(p + 30) + zip_get16(p + 32);
+	}
+    }
+
+    free(cd);
+
+    if (!err && !found) {
+	gretl_errmsg_sprintf(_("%s: not found"), name);
+	err = E_DATA;
+    } else if (!err && zm->method != 0 && zm->method != 8) {
+	err = E_NOTIMP;
+    } else if (!err && (zm->csize == 0xffffffff || lhoff == 0xffffffff)) {
+	err = E_NOTIMP;
+    }
+
+    if (!err) {
+	/* skip the local header to the start of the data */
+	if (fseek(zm->fp, lhoff, SEEK_SET) != 0 ||
+	    fread(lh, 1, 30, zm->fp) != 30 ||
+	    zip_get32(lh) != ZIP_LOCAL_SIG) {
+	    err = E_DATA;
+	} else if (fseek(zm->fp, zip_get16(lh + 26) + zip_get16(lh + 28),
+			 SEEK_CUR) != 0) {
+	    err = E_DATA;
+	}
+    }
+
+    return err;
+}
+
+/**
+ * gretl_zip_member_open:
+ * @fname: name of zip file.
+ * @name: name of the member to be read, including any
+ * internal path.
+ * @err: location to receive error code.
+ *
+ * Prepares the member @name of the zip archive @fname for
+ * reading via gretl_zip_member_read().
+ *
+ * Returns: allocated handle, or NULL on failure, in which
+ * case @err is set to E_NOTIMP if the archive or member is
+ * of a type not handled natively, otherwise to some other
+ * non-zero code.
+ */
+
+gretl_zip_member *gretl_zip_member_open (const char *fname,
+					 const char *name,
+					 int *err)
+{
+    gretl_zip_member *zm = calloc(1, sizeof *zm);
+
+    if (zm == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    zm->fp = gretl_fopen(fname, "rb");
+    if (zm->fp == NULL) {
+	*err = E_FOPEN;
+    } else {
+	*err = zip_locate_member(zm, name);
+    }
+
+    if (!*err) {
+	zm->cleft = zm->csize;
+	if (zm->method == 8) {
+	    zm->in = malloc(ZIP_INBUF);
+	    if (zm->in == NULL) {
+		*err = E_ALLOC;
+	    } else if (inflateInit2(&zm->zs, -MAX_WBITS) != Z_OK) {
+		*err = E_ALLOC;
+	    } else {
+		zm->zs_init = 1;
+	    }
+	}
+    }
+
+    if (*err) {
+	gretl_zip_member_close(zm);
+	zm = NULL;
+    }
+
+    return zm;
+}
+
+/**
+ * gretl_zip_member_size:
+ * @zm: zip member handle.
+ *
+ * Returns: the uncompressed size of the member, in bytes.
+ */
+
+guint32 gretl_zip_member_size (gretl_zip_member *zm)
+{
+    return zm->usize;
+}
+
+/**
+ * gretl_zip_member_read:
+ * @zm: zip member handle.
+ * @buf: location to receive data.
+ * @len: maximum number of bytes to write to @buf.
+ *
+ * Reads (and if need be inflates) up to @len bytes of the
+ * member's content into @buf.
+ *
+ * Returns: the number of bytes read, 0 at the end of the
+ * member, or -1 on error.
+ */
+
+int gretl_zip_member_read (gretl_zip_member *zm, char *buf, int len)
+{
+    int got = 0;
+
+    if (zm->done || len <= 0) {
+	return 0;
+    }
+
+    if (zm->method == 0) {
+	if (len > zm->cleft) {
+	    len = zm->cleft;
+	}
+	got = fread(buf, 1, len, zm->fp);
+	if (got < len) {
+	    return -1;
+	}
+	zm->cleft -= got;
+	zm->done = (zm->cleft == 0);
+	return got;
+    }
+
+    zm->zs.next_out = (Bytef *) buf;
+    zm->zs.avail_out = len;
+
+    while (zm->zs.avail_out > 0) {
+	int zret;
+
+	if (zm->zs.avail_in == 0 && zm->cleft > 0) {
+	    size_t n = zm->cleft < ZIP_INBUF ? zm->cleft : ZIP_INBUF;
+
+	    if (fread(zm->in, 1, n, zm->fp) != n) {
+		return -1;
+	    }
+	    zm->cleft -= n;
+	    zm->zs.next_in = zm->in;
+	    zm->zs.avail_in = n;
+	}
+	zret = inflate(&zm->zs, Z_NO_FLUSH);
+	if (zret == Z_STREAM_END) {
+	    zm->done = 1;
+	    break;
+	} else if (zret != Z_OK) {
+	    return -1;
+	} else if (zm->zs.avail_in == 0 && zm->cleft == 0) {
+	    /* truncated deflate stream */
+	    return -1;
+	}
+    }
+
+    got = len - zm->zs.avail_out;
+
+    return got;
+}
+
+/**
+ * gretl_zip_member_close:
+ * @zm: zip member handle.
+ *
+ * Frees @zm and closes the underlying archive.
+ */
+
+void gretl_zip_member_close (gretl_zip_member *zm)
+{
+    if (zm != NULL) {
+	if (zm->zs_init) {
+	    inflateEnd(&zm->zs);
+	}
+	if (zm->fp != NULL) {
+	    fclose(zm->fp);
+	}
+	free(zm->in);
+	free(zm);
+    }
+}
+
+/* Whole-member extraction into memory, run in a worker thread so
+   that several members of one archive can be inflated at once,
+   or one member inflated while another is being parsed.
+*/
+
+struct gretl_zip_fetch_ {
+    gchar *fname;
+    gchar *name;
+    GThread *thread;
+    char *buf;
+    size_t len;
+    int err;
+};
+
+/* gretl_zip_member_read() takes an int length, so a member of
+   2 GB or more must be read in pieces
+*/
+#define ZIP_FETCH_CHUNK (1 << 24)
+
+static gpointer zip_fetch_thread (gpointer data)
+{
+    gretl_zip_fetch *zf = data;
+    gretl_zip_member *zm;
+
+    zm = gretl_zip_member_open(zf->fname, zf->name, &zf->err);
+    if (zm != NULL) {
+	zf->len = zm->usize;
+	zf->buf = malloc(zf->len > 0 ? zf->len : 1);
+	if (zf->buf == NULL) {
+	    zf->err = E_ALLOC;
+	} else {
+	    size_t done = 0;
+
+	    while (done < zf->len) {
+		size_t n = zf->len - done;
+		int got;
+
+		if (n > ZIP_FETCH_CHUNK) {
+		    n = ZIP_FETCH_CHUNK;
+		}
+		got = gretl_zip_member_read(zm, zf->buf + done, (int) n);
+		if (got <= 0) {
+		    zf->err = E_DATA;
+		    break;
+		}
+		done += got;
+	    }
+	}
+	gretl_zip_member_close(zm);
+    }
+
+    return NULL;
+}
+
+/**
+ * gretl_zip_fetch_start:
+ * @fname: name of zip file.
+ * @name: name of member to extract.
+ *
+ * Starts inflating member @name of @fname into memory in a
+ * separate thread. The result should be retrieved via
+ * gretl_zip_fetch_finish().
+ *
+ * Returns: allocated handle, or NULL on failure.
+ */
+
+gretl_zip_fetch *gretl_zip_fetch_start (const char *fname,
+					const char *name)
+{
+    gretl_zip_fetch *zf = calloc(1, sizeof *zf);
+
+    if (zf != NULL) {
+	zf->fname = g_strdup(fname);
+	zf->name = g_strdup(name);
+	zf->thread = g_thread_try_new("zipfetch", zip_fetch_thread,
+				      zf, NULL);
+	if (zf->thread == NULL) {
+	    /* just do it in this thread */
+	    zip_fetch_thread(zf);
+	}
+    }
+
+    return zf;
+}
+
+/**
+ * gretl_zip_fetch_finish:
+ * @zf: handle obtained via gretl_zip_fetch_start().
+ * @len: location to receive the length of the member.
+ * @err: location to receive error code.
+ *
+ * Waits for the extraction started by gretl_zip_fetch_start()
+ * to complete and frees @zf.
+ *
+ * Returns: allocated buffer holding the member's content, or
+ * NULL on failure.
+ */
+
+char *gretl_zip_fetch_finish (gretl_zip_fetch *zf, guint32 *len,
+			      int *err)
+{
+    char *buf = NULL;
+
+    if (zf == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    if (zf->thread != NULL) {
+	g_thread_join(zf->thread);
+    }
+
+    *err = zf->err;
+    if (*err) {
+	free(zf->buf);
+    } else {
+	buf = zf->buf;
+	*len = zf->len;
+    }
+
+    g_free(zf->fname);
+    g_free(zf->name);
+    free(zf);
+
+    return buf;
+}
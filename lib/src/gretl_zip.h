@@ -40,4 +40,23 @@ int package_make_zipfile (const char *gfnname,
 			  gretlopt opt,
 			  PRN *prn);
 
+typedef struct gretl_zip_member_ gretl_zip_member;
+typedef struct gretl_zip_fetch_ gretl_zip_fetch;
+
+gretl_zip_member *gretl_zip_member_open (const char *fname,
+					 const char *name,
+					 int *err);
+
+guint32 gretl_zip_member_size (gretl_zip_member *zm);
+
+int gretl_zip_member_read (gretl_zip_member *zm, char *buf, int len);
+
+void gretl_zip_member_close (gretl_zip_member *zm);
+
+gretl_zip_fetch *gretl_zip_fetch_start (const char *fname,
+					const char *name);
+
+char *gretl_zip_fetch_finish (gretl_zip_fetch *zf, guint32 *len,
+			      int *err);
+
 #endif /* GRETL_ZIP_H */
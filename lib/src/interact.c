@@ -50,6 +50,9 @@
 #include "gretl_gridplot.h"
 #include "gretl_sampler.h"
 #include "gretl_untar.h"
+#include "gretl_profile.h"
+#include "gretl_memstats.h"
+#include "gretl_trace.h"
 #ifdef USE_CURL
 # include "gretl_www.h"
 #endif
@@ -1338,6 +1341,11 @@ static int do_pca (int *list, DATASET *dset, gretlopt opt, PRN *prn)
         return 0;
     }
 
+    err = option_prereq_missing(opt, OPT_I, OPT_K);
+    if (err) {
+        return err;
+    }
+
     if (list == NULL) {
         list = full_var_list(dset, NULL);
         freelist = 1;
@@ -1347,7 +1355,8 @@ static int do_pca (int *list, DATASET *dset, gretlopt opt, PRN *prn)
         VMatrix *cmat = NULL;
 
         /* adding OPT_N ensures a uniform sample for the correlation
-           or covariance matrix
+           or covariance matrix; with OPT_K the matrix itself is
+           skipped in favour of the SVD of the data
 	*/
         cmat = corrlist(PCA, list, dset, opt | OPT_N, &err);
         if (!err) {
@@ -1695,6 +1704,9 @@ static int run_script (const char *fname,
     while (fgets(state->line, MAXLINE - 1, fp) && !err) {
         err = get_line_continuation(state->line, fp, prn);
         if (!err) {
+            if (gretl_profiling()) {
+                gretl_profile_line(state->line, 0);
+            }
             err = maybe_exec_line(state, dset, NULL);
         }
     }
@@ -2111,24 +2123,34 @@ static void open_op_init (CMD *cmd, OpenOp *op)
     op->ftype = -1;
 }
 
-/* selection of series by name: applicable only for "open"
-   for native gretl data files
+/* selection of series by name, and of a range of observations:
+   applicable only for "open" for native gretl data files,
+   Parquet/Arrow files (which also support --filter) and Stata,
+   SPSS or EViews files (series only)
 */
 
 static int check_import_subsetting (CMD *cmd, OpenOp *op)
 {
-    if (cmd->ci != OPEN || (op->ftype != GRETL_XML_DATA &&
-			    op->ftype != GRETL_BINARY_DATA)) {
+    int native = (op->ftype == GRETL_XML_DATA ||
+		  op->ftype == GRETL_BINARY_DATA);
+    int statpkg = STATPKG_SUBSET(op->ftype);
+
+    if (cmd->ci != OPEN || !(native || statpkg || ARROW_IMPORT(op->ftype))) {
 	return E_BADOPT;
-    } else {
+    } else if (((native || statpkg) && (cmd->opt & OPT_G)) ||
+	       (!native && (cmd->opt & OPT_Z))) {
+	/* --filter is for Parquet/Arrow data, --obs for native data */
+	return E_BADOPT;
+    } else if (cmd->opt & OPT_E) {
 	const char *s = get_optval_string(OPEN, OPT_E);
 
 	if (get_array_by_name(s)) {
 	    /* protect array from deletion */
 	    cmd->opt |= OPT_P;
 	}
-	return 0;
     }
+
+    return 0;
 }
 
 static int no_suffix (const char *fname)
@@ -2221,7 +2243,7 @@ static int open_append_stage_1 (CMD *cmd,
 	if (op->ftype < 0) {
 	    op->ftype = detect_filetype(op->fname, OPT_P);
 	}
-	if (opt & OPT_E) {
+	if (opt & (OPT_E | OPT_G | OPT_Z)) {
 	    err = check_import_subsetting(cmd, op);
 	}
     }
@@ -2268,8 +2290,9 @@ static int open_append_stage_1 (CMD *cmd,
     return err;
 }
 
-/* respond to --select (select specific series) on OPEN
-   for native gdt or gdtb data files
+/* respond to --select (select specific series by name), --cols
+   (select series by ID number) and/or --obs (select a range of
+   observations) on OPEN for native gdt or gdtb data files
 */
 
 static int handle_gdt_selection (const char *fname,
@@ -2277,25 +2300,41 @@ static int handle_gdt_selection (const char *fname,
 				 gretlopt opt,
 				 PRN *prn)
 {
-    const char *s = get_optval_string(OPEN, OPT_E);
+    const char *obsrange = NULL;
     char **S_sel = NULL;
     char **S_ok = NULL;
-    int n_ok, n_sel = 0;
-    int err = 0;
+    int *list = NULL;
+    int n_ok = 0, n_sel = 0;
+    int i, j, k = 0;
+    int err;
 
-    if (s == NULL || *s == '\0') {
-	return E_BADOPT;
+    err = incompatible_options(opt, OPT_E | OPT_L);
+    if (err) {
+	return err;
     }
 
-    err = get_selected_import_names(s, OPEN, dset, &S_sel, &n_sel);
-    if (!err) {
-	err = gretl_read_gdt_varnames(fname, &S_ok, &n_ok);
+    if (opt & OPT_Z) {
+	obsrange = get_optval_string(OPEN, OPT_Z);
+	if (obsrange == NULL || *obsrange == '\0') {
+	    return E_BADOPT;
+	}
+    }
+
+    if (opt & OPT_E) {
+	const char *s = get_optval_string(OPEN, OPT_E);
+
+	if (s == NULL || *s == '\0') {
+	    return E_BADOPT;
+	}
+	err = get_selected_import_names(s, OPEN, dset, &S_sel, &n_sel);
     }
 
     if (!err) {
-	int *list = gretl_list_new(n_sel);
-	int i, j, k = 0;
+	err = gretl_read_gdt_varnames(fname, &S_ok, &n_ok);
+    }
 
+    if (!err && (opt & OPT_E)) {
+	list = gretl_list_new(n_sel);
 	for (j=0; j<n_sel; j++) {
 	    for (i=1; i<n_ok; i++) {
 		if (!strcmp(S_sel[j], S_ok[i])) {
@@ -2305,21 +2344,113 @@ static int handle_gdt_selection (const char *fname,
 	    }
 	}
 	if (k != n_sel) {
-	    pputs(prn, _("Invalid selection"));
-	    pputc(prn, '\n');
 	    err = E_DATA;
+	}
+    } else if (!err && (opt & OPT_L)) {
+	const char *s = get_optval_string(OPEN, OPT_L);
+
+	if (s == NULL || *s == '\0') {
+	    err = E_BADOPT;
 	} else {
-	    err = gretl_read_gdt_subset(fname, dset, list, opt);
+	    list = gretl_list_from_string(s, &err);
+	    if (!err && (list == NULL || list[0] == 0)) {
+		err = E_DATA;
+	    }
+	}
+	for (i=1; !err && i<=list[0]; i++) {
+	    if (list[i] < 1 || list[i] >= n_ok) {
+		err = E_DATA;
+	    }
+	}
+    } else if (!err) {
+	/* all series, in a restricted range */
+	list = gretl_consecutive_list_new(1, n_ok - 1);
+	if (list == NULL) {
+	    err = E_ALLOC;
 	}
-	free(list);
     }
 
+    if (err == E_DATA) {
+	pputs(prn, _("Invalid selection"));
+	pputc(prn, '\n');
+    } else if (!err) {
+	/* read the series in the order in which they're stored */
+	gretl_list_sort(list);
+	err = gretl_read_gdt_subset(fname, dset, list, obsrange, opt);
+    }
+
+    free(list);
     strings_array_free(S_ok, n_ok);
     strings_array_free(S_sel, n_sel);
 
     return err;
 }
 
+/* respond to --select (columns by name), --cols (columns by
+   number) and/or --filter (rows satisfying a condition) on OPEN
+   for Parquet or Arrow data files, or --select or --cols for
+   Stata, SPSS or EViews data files
+*/
+
+static int handle_column_selection (const char *fname,
+				    GretlFileType ftype,
+				    DATASET *dset,
+				    gretlopt opt,
+				    PRN *prn)
+{
+    const char *filter = NULL;
+    char **S_sel = NULL;
+    int *cols = NULL;
+    int n_sel = 0;
+    int err;
+
+    err = incompatible_options(opt, OPT_E | OPT_L);
+    if (err) {
+	return err;
+    }
+
+    if (opt & OPT_G) {
+	filter = get_optval_string(OPEN, OPT_G);
+	if (filter == NULL || *filter == '\0') {
+	    return E_BADOPT;
+	}
+    }
+
+    if (opt & OPT_E) {
+	const char *s = get_optval_string(OPEN, OPT_E);
+
+	if (s == NULL || *s == '\0') {
+	    return E_BADOPT;
+	}
+	err = get_selected_import_names(s, OPEN, dset, &S_sel, &n_sel);
+    } else if (opt & OPT_L) {
+	const char *s = get_optval_string(OPEN, OPT_L);
+
+	if (s == NULL || *s == '\0') {
+	    return E_BADOPT;
+	}
+	cols = gretl_list_from_string(s, &err);
+	if (!err && (cols == NULL || cols[0] == 0)) {
+	    err = E_DATA;
+	}
+    }
+
+    if (err) {
+	;
+    } else if (STATPKG_SUBSET(ftype)) {
+	err = import_other_subset(fname, ftype, dset, S_sel, n_sel, cols,
+				  opt, prn);
+    } else {
+	err = import_arrow(fname, dset, S_sel, n_sel, cols, filter,
+			   opt, prn);
+    }
+
+    free(cols);
+    strings_array_free(S_sel, n_sel);
+
+    return err;
+}
+
 static int lib_open_append (ExecState *s,
                             DATASET *dset,
                             char *newfile,
@@ -2368,7 +2499,7 @@ static int lib_open_append (ExecState *s,
     }
 
     if (op.ftype == GRETL_XML_DATA || op.ftype == GRETL_BINARY_DATA) {
-	if (opt & OPT_E) {
+	if (opt & (OPT_E | OPT_L | OPT_Z)) {
 	    err = handle_gdt_selection(op.fname, dset, opt, vprn);
 	} else {
 	    err = gretl_read_gdt(op.fname, dset, opt, vprn);
@@ -2378,6 +2509,10 @@ static int lib_open_append (ExecState *s,
     } else if (SPREADSHEET_IMPORT(op.ftype)) {
         err = import_spreadsheet(op.fname, op.ftype, cmd->list, cmd->parm2,
                                  dset, opt, vprn);
+    } else if (ARROW_IMPORT(op.ftype) && (opt & (OPT_E | OPT_G | OPT_L))) {
+        err = handle_column_selection(op.fname, op.ftype, dset, opt, vprn);
+    } else if (STATPKG_SUBSET(op.ftype) && (opt & (OPT_E | OPT_L))) {
+        err = handle_column_selection(op.fname, op.ftype, dset, opt, vprn);
     } else if (OTHER_IMPORT(op.ftype)) {
         err = import_other(op.fname, op.ftype, dset, opt, vprn);
     } else if (op.ftype == GRETL_ODBC) {
@@ -3368,7 +3503,7 @@ static void maybe_print_error_message (CMD *cmd, int err, PRN *prn)
     }
 }
 
-int gretl_cmd_exec (ExecState *s, DATASET *dset)
+static int real_cmd_exec (ExecState *s, DATASET *dset)
 {
     CMD *cmd = s->cmd;
     char *line = s->line;
@@ -3381,6 +3516,10 @@ int gretl_cmd_exec (ExecState *s, DATASET *dset)
     exec_state_prep(s);
     plot_ok = 0;
 
+    /* give the GUI, if any, a chance to show output so far and
+       to respond to the "Stop" button */
+    show_activity_callback();
+
     if (get_user_stop()) {
         /* the user called a halt to execution */
         return abort_execution(s);
@@ -3731,7 +3870,12 @@ int gretl_cmd_exec (ExecState *s, DATASET *dset)
         break;
 
     case PRINT:
-        if (cmd->opt & OPT_L) {
+        if (cmd->opt & OPT_Q) {
+            /* handled in progressive loops only */
+            gretl_errmsg_set(_("The --quantiles option is applicable "
+                               "only in a progressive loop"));
+            err = E_BADOPT;
+        } else if (cmd->opt & OPT_L) {
             err = printdata(NULL, cmd->param, dset, OPT_NONE, prn);
         } else if (cmd->param != NULL) {
             /* directly printing a string literal */
@@ -3885,8 +4029,13 @@ int gretl_cmd_exec (ExecState *s, DATASET *dset)
 
     case OLS:
     case WLS:
-        clear_model(model);
-        *model = lsq(cmd->list, dset, cmd->ci, cmd->opt);
+        if (gretl_looping_currently()) {
+            /* recycle the series-length arrays */
+            lsq_reuse(model, cmd->list, dset, cmd->ci, cmd->opt);
+        } else {
+            clear_model(model);
+            *model = lsq(cmd->list, dset, cmd->ci, cmd->opt);
+        }
         err = print_save_model(model, dset, cmd->opt, 0, prn, s);
         break;
 
@@ -4356,6 +4505,39 @@ int gretl_cmd_exec (ExecState *s, DATASET *dset)
     return err;
 }
 
+int gretl_cmd_exec (ExecState *s, DATASET *dset)
+{
+    int ci = s->cmd->ci;
+    int traced = gretl_tracing();
+    int err;
+
+    if (traced) {
+        gretl_trace_command_begin(ci, dset);
+    }
+
+    if (gretl_profiling()) {
+        /* record the time taken by this command */
+        gint64 t0 = gretl_profile_command_start(ci);
+
+        err = real_cmd_exec(s, dset);
+        gretl_profile_command_end(ci, t0);
+    } else {
+        err = real_cmd_exec(s, dset);
+    }
+
+    if (gretl_memstats_on()) {
+        /* update the high-water marks */
+        gretl_memstats_sample(dset);
+    }
+
+    if (traced) {
+        /* note: not if this command started the trace */
+        gretl_trace_command_end(ci, err);
+    }
+
+    return err;
+}
+
 /**
  * get_command_index:
  * @s: pointer to execution state
@@ -25,6 +25,7 @@
 #include "vartest.h"
 #include "matrix_extra.h"
 #include "libset.h"
+#include "gretl_mt.h"
 
 #define BDEBUG 0
 
@@ -51,6 +52,7 @@ struct irfboot_ {
     gretl_array *aresp; /* array variant of @resp */
     gretl_matrix *C0;   /* initial coefficient estimates (VECM only) */
     int *sample;        /* resampling array */
+    int *samples;       /* resampling arrays, all iterations (VAR only) */
     DATASET *dset;      /* dummy dataset for levels (VECM only) */
 };
 
@@ -76,6 +78,7 @@ static void irf_boot_free (irfboot *b)
     }
 
     free(b->sample);
+    free(b->samples);
     free(b);
 }
 
@@ -145,6 +148,7 @@ static irfboot *irf_boot_new (const GRETL_VAR *var,
     b->Et = NULL;
     b->C0 = NULL;
     b->sample = NULL;
+    b->samples = NULL;
     b->dset = NULL;
 
     b->nresp = nresp;
@@ -811,7 +815,9 @@ static void compute_VAR_dataset (irfboot *b, GRETL_VAR *var,
 }
 
 /* Resample the original VAR or VECM residuals, stored in
-   vbak->E, writing the new sample into b->rE.
+   vbak->E, writing the new sample into b->rE, following the
+   sampling array @sample or, if this is NULL, a fresh draw
+   into b->sample.
 
    Note the facility to "resample" _without_ actually changing the
    order, if BDEBUG > 1.  This is useful for checking that the IRF
@@ -820,7 +826,8 @@ static void compute_VAR_dataset (irfboot *b, GRETL_VAR *var,
    VAR/VECM.
 */
 
-static void irf_resample_resids (irfboot *b, const GRETL_VAR *vbak)
+static void irf_resample_resids (irfboot *b, const GRETL_VAR *vbak,
+				 const int *sample)
 {
     double eti;
     int i, t;
@@ -830,20 +837,227 @@ static void irf_resample_resids (irfboot *b, const GRETL_VAR *vbak)
     return;
 #endif
 
-    /* construct sampling array */
-    for (t=0; t<vbak->T; t++) {
-	b->sample[t] = gretl_rand_int_max(vbak->T);
+    if (sample == NULL) {
+	/* construct sampling array */
+	for (t=0; t<vbak->T; t++) {
+	    b->sample[t] = gretl_rand_int_max(vbak->T);
+	}
+	sample = b->sample;
     }
 
     /* draw from the original residuals */
     for (i=0; i<vbak->neqns; i++) {
 	for (t=0; t<vbak->T; t++) {
-	    eti = gretl_matrix_get(vbak->E, b->sample[t], i);
+	    eti = gretl_matrix_get(vbak->E, sample[t], i);
 	    gretl_matrix_set(b->rE, t, i, eti);
 	}
     }
 }
 
+/* VAR case: the replications are independent given their
+   sampling arrays, so we draw all of these up front -- in the
+   order in which the sequential code would draw them -- and then
+   farm the replications out to threads, each with its own copy
+   of the VAR data matrices and its own workspace. The results
+   for a given seed therefore don't depend on the number of
+   threads.
+*/
+
+typedef struct irfworker_ irfworker;
+
+struct irfworker_ {
+    irfboot b;   /* copy of the main struct, private workspace */
+    GRETL_VAR v; /* shallow copy of the VAR, private data */
+};
+
+static void irf_worker_free (irfworker *w)
+{
+    if (w != NULL) {
+	gretl_matrix_block_destroy(w->b.MB);
+	gretl_matrix_free(w->b.Xt);
+	gretl_matrix_free(w->b.Yt);
+	gretl_matrix_free(w->b.Et);
+	gretl_matrix_free(w->v.Y);
+	gretl_matrix_free(w->v.X);
+	gretl_matrix_free(w->v.B);
+	gretl_matrix_free(w->v.E);
+	gretl_matrix_free(w->v.S);
+	gretl_matrix_free(w->v.C);
+	gretl_matrix_free(w->v.A);
+	free(w);
+    }
+}
+
+static irfworker *irf_worker_new (const irfboot *b,
+				  const GRETL_VAR *var)
+{
+    irfworker *w = malloc(sizeof *w);
+    int n = var->neqns;
+    int np = n * levels_order(var);
+
+    if (w == NULL) {
+	return NULL;
+    }
+
+    /* share the response storage, but nothing else */
+    w->b = *b;
+    w->b.MB = gretl_matrix_block_new(&w->b.rtmp, np, n,
+				     &w->b.wk1,   n, n,
+				     &w->b.wk2,  np, n,
+				     &w->b.rE, var->T, n,
+				     NULL);
+    w->b.Xt = gretl_matrix_alloc(1, var->X->cols);
+    w->b.Yt = gretl_matrix_alloc(1, n);
+    w->b.Et = gretl_matrix_alloc(1, n);
+    w->b.sample = w->b.samples = NULL;
+    w->b.C0 = NULL;
+    w->b.dset = NULL;
+
+    w->v = *var;
+    w->v.Y = gretl_matrix_copy(var->Y);
+    w->v.X = gretl_matrix_copy(var->X);
+    w->v.B = gretl_matrix_copy(var->B);
+    w->v.E = gretl_matrix_copy(var->E);
+    w->v.S = gretl_matrix_copy(var->S);
+    w->v.C = gretl_matrix_copy(var->C);
+    w->v.A = gretl_matrix_copy(var->A);
+
+    if (w->b.MB == NULL || w->b.Xt == NULL || w->b.Yt == NULL ||
+	w->b.Et == NULL || w->v.Y == NULL || w->v.X == NULL ||
+	w->v.B == NULL || w->v.E == NULL || w->v.S == NULL ||
+	w->v.C == NULL || w->v.A == NULL) {
+	irf_worker_free(w);
+	w = NULL;
+    }
+
+    return w;
+}
+
+static int irf_VAR_round (irfboot *b, GRETL_VAR *var,
+			  const GRETL_VAR *vbak,
+			  int targ, int shock, int iter)
+{
+    irf_resample_resids(b, vbak, b->samples + (size_t) iter * vbak->T);
+    compute_VAR_dataset(b, var, vbak, iter);
+
+    return re_estimate_VAR(b, var, targ, shock, iter);
+}
+
+static int irf_VAR_bootstrap (irfboot *boot, GRETL_VAR *var,
+			      const GRETL_VAR *vbak,
+			      int targ, int shock)
+{
+    int *errs = NULL;
+    int T = vbak->T;
+    int scount = 0;
+    int iter, t;
+    int err = 0;
+
+    boot->samples = malloc((size_t) boot->iters * T * sizeof *boot->samples);
+    errs = calloc(boot->iters, sizeof *errs);
+    if (boot->samples == NULL || errs == NULL) {
+	free(errs);
+	return E_ALLOC;
+    }
+
+    for (iter=0; iter<boot->iters; iter++) {
+	for (t=0; t<T; t++) {
+	    boot->samples[(size_t) iter * T + t] = gretl_rand_int_max(T);
+	}
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel if (gretl_use_openmp((guint64) boot->iters * T * var->X->cols * var->neqns))
+#endif
+    {
+	irfworker *w = irf_worker_new(boot, var);
+	int i;
+
+	if (w == NULL) {
+#if defined(_OPENMP)
+#pragma omp critical
+#endif
+	    err = E_ALLOC;
+	}
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+	for (i=0; i<boot->iters; i++) {
+	    if (w != NULL) {
+		errs[i] = irf_VAR_round(&w->b, &w->v, vbak,
+					targ, shock, i);
+	    }
+	}
+	irf_worker_free(w);
+    }
+
+    /* Re-do any rounds that failed on account of collinearity,
+       in order, using fresh draws, as long as this doesn't become
+       a serious habit.
+    */
+    for (iter=0; iter<boot->iters && !err; iter++) {
+	while (errs[iter] && !err) {
+	    if (irf_fatal(errs[iter], boot, iter, scount)) {
+		err = errs[iter];
+	    } else {
+		scount++;
+		for (t=0; t<T; t++) {
+		    boot->samples[(size_t) iter * T + t] = gretl_rand_int_max(T);
+		}
+		errs[iter] = irf_VAR_round(boot, var, vbak, targ, shock, iter);
+	    }
+	}
+    }
+
+    if (err && scount / (double) boot->iters >= MAXSING) {
+	gretl_errmsg_set("Excessive collinearity in resampled datasets");
+    }
+
+    free(errs);
+
+    return err;
+}
+
+/* VECM case: the Johansen machinery is not set up for use in
+   several threads at once, so the replications are done in turn.
+*/
+
+static int irf_VECM_bootstrap (irfboot *boot, GRETL_VAR *var,
+			       const GRETL_VAR *vbak,
+			       int targ, int shock)
+{
+    int scount = 0;
+    int iter, err = 0;
+
+    for (iter=0; iter<boot->iters && !err; iter++) {
+#if BDEBUG
+	fprintf(stderr, "starting iteration %d\n", iter);
+#endif
+	irf_resample_resids(boot, vbak, NULL);
+	compute_VECM_dataset(boot, var, iter);
+	err = re_estimate_VECM(boot, var, targ, shock, iter, scount);
+#if BDEBUG
+	if (err) {
+	    fprintf(stderr, " got err = %d from re_estimate_VECM\n", err);
+	}
+#endif
+	if (err && !irf_fatal(err, boot, iter, scount)) {
+	    /* excessive collinearity: try again, unless this is
+	       becoming a serious habit
+	    */
+	    scount++;
+	    iter--;
+	    err = 0;
+	}
+    }
+
+    if (err && scount / (double) boot->iters >= MAXSING) {
+	gretl_errmsg_set("Excessive collinearity in resampled datasets");
+    }
+
+    return err;
+}
+
 static int irf_boot_quantiles (irfboot *b,
 			       gretl_matrix *R,
 			       double alpha,
@@ -1054,9 +1268,7 @@ gretl_matrix *irf_bootstrap (GRETL_VAR *var,
     gretl_matrix *R = NULL; /* the return value */
     GRETL_VAR *vbak = NULL;
     irfboot *boot = NULL;
-    int scount = 0;
     int nresp = 1;
-    int iter;
 
     if (targ < 0 && shock < 0) {
 	/* compute all */
@@ -1103,35 +1315,12 @@ gretl_matrix *irf_bootstrap (GRETL_VAR *var,
     gretl_matrix_print(boot->C0, "boot->C0");
 #endif
 
-    for (iter=0; iter<boot->iters && !*err; iter++) {
-#if BDEBUG
-	fprintf(stderr, "starting iteration %d\n", iter);
-#endif
-	irf_resample_resids(boot, vbak);
+    if (!*err) {
 	if (var->ci == VECM) {
-	    compute_VECM_dataset(boot, var, iter);
-	    *err = re_estimate_VECM(boot, var, targ, shock, iter, scount);
-#if BDEBUG
-	    if (*err) {
-		fprintf(stderr, " got err = %d from re_estimate_VECM\n", *err);
-	    }
-#endif
+	    *err = irf_VECM_bootstrap(boot, var, vbak, targ, shock);
 	} else {
-	    compute_VAR_dataset(boot, var, vbak, iter);
-	    *err = re_estimate_VAR(boot, var, targ, shock, iter);
+	    *err = irf_VAR_bootstrap(boot, var, vbak, targ, shock);
 	}
-	if (*err && !irf_fatal(*err, boot, iter, scount)) {
-	    /* excessive collinearity: try again, unless this is
-	       becoming a serious habit
-	    */
-	    scount++;
-	    iter--;
-	    *err = 0;
-	}
-    }
-
-    if (*err && scount / (double) boot->iters >= MAXSING) {
-	gretl_errmsg_set("Excessive collinearity in resampled datasets");
     }
 
     if (!*err) {
@@ -40,6 +40,7 @@ struct joinspec_ {
     char **mdsnames;
     char **tmpnames;
     int n_tmp;
+    const gretl_matrix *rowmask;
 };
 
 typedef struct joinspec_ joinspec;
@@ -27,6 +27,7 @@
 #include "libset.h"
 #include "gretl_bfgs.h"
 #include "gretl_typemap.h"
+#include "gretl_mt.h"
 #include "kalman.h"
 
 /**
@@ -144,6 +145,7 @@ struct kalman_ {
     int d;   /* (diffuse) time-step at which standard iterations start */
     int j;   /* (sequential) observable at which standard iters start */
     int TI;  /* flag for K->T is identity matrix */
+    int sst; /* start of final steady-state stretch, or -1 */
 
     int ifc; /* boolean: obs equation includes an implicit constant? */
     int dj_initted; /* flag for basic de Jong initialization done */
@@ -151,6 +153,7 @@ struct kalman_ {
     double qsum;    /* \sum_{t=1}^N q_t = v_t' F_t^{-1} v_t */
     double loglik;  /* log-likelihood */
     double s2;      /* = qsum / k */
+    double sstol;   /* tolerance for steady-state detection (0 = off) */
 
     /* continuously updated matrices */
     gretl_matrix *a0; /* r x 1: state vector, before updating */
@@ -533,6 +536,8 @@ static kalman *kalman_new_empty (int flags)
         K->b = NULL;
         K->d = 0;
         K->j = 0;
+        K->sst = -1;
+        K->sstol = 0.0;
 	K->smo_prep = SM_NONE;
 	K->dj_initted = 0;
     }
@@ -1979,6 +1984,31 @@ static int ensure_Finv (kalman *K)
     return K->Finv == NULL ? E_ALLOC : 0;
 }
 
+/* Check whether the matrix recursion that took @A to @B has
+   converged, element by element, to within relative tolerance @tol.
+*/
+
+static int kalman_matrix_converged (const gretl_matrix *A,
+                                    const gretl_matrix *B,
+                                    double tol)
+{
+    int i, n = A->rows * A->cols;
+
+    for (i=0; i<n; i++) {
+        if (fabs(B->val[i] - A->val[i]) > tol * (1.0 + fabs(A->val[i]))) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/* Steady-state detection is available, on request, only for
+   time-invariant filters: otherwise P_t need not converge.
+*/
+
+#define steady_state_ok(K) (K->sstol > 0 && !filter_is_varying(K))
+
 /**
  * kfilter_standard:
  * @K: pointer to Kalman struct.
@@ -1987,6 +2017,11 @@ static int ensure_Finv (kalman *K)
  * Generates a series of one-step ahead forecasts for y, based on
  * information in the kalman struct @K.
  *
+ * If a steady-state tolerance has been set and the filter is
+ * time-invariant, then once the recursion for P_t has converged
+ * P_t, F_t^{-1} and the gain are held fixed and only the state is
+ * updated, until a missing observation intervenes.
+ *
  * Returns: 0 on success, non-zero on error.
  */
 
@@ -1994,6 +2029,9 @@ int kfilter_standard (kalman *K, PRN *prn)
 {
     double ll0 = K->n * LN_2_PI;
     double sumldet = 0;
+    double ss_ldet = 0;
+    int ss_ok = steady_state_ok(K);
+    int steady = 0;
     int nt, err = 0;
 
     if (trace) {
@@ -2014,6 +2052,7 @@ int kfilter_standard (kalman *K, PRN *prn)
     K->qsum = K->loglik = 0.0;
     K->s2 = NADBL;
     K->okN = K->N;
+    K->sst = -1;
     set_kalman_running(K);
 
     for (K->t = 0; K->t < K->N && !err; K->t += 1) {
@@ -2043,33 +2082,41 @@ int kfilter_standard (kalman *K, PRN *prn)
             /* skip this observation */
             K->okN -= 1;
             handle_missing_obs(K);
+            steady = 0;
+            K->sst = -1;
             continue;
         }
 
-        /* calculate F_t = ZPZ' [+ VY] */
-        if (K->VY != NULL) {
-            fast_copy_values(K->Ft, K->VY);
-            gretl_matrix_qform(K->ZT, GRETL_MOD_TRANSPOSE, K->P0,
-                               K->Ft, GRETL_MOD_CUMULATE);
+        if (steady) {
+            /* F_t^{-1}, M_t and P_t are fixed */
+            ldet = ss_ldet;
+            qt = gretl_scalar_qform(K->vt, K->iFt, &err);
         } else {
-            gretl_matrix_qform(K->ZT, GRETL_MOD_TRANSPOSE, K->P0,
-                               K->Ft, GRETL_MOD_NONE);
-        }
+            /* calculate F_t = ZPZ' [+ VY] */
+            if (K->VY != NULL) {
+                fast_copy_values(K->Ft, K->VY);
+                gretl_matrix_qform(K->ZT, GRETL_MOD_TRANSPOSE, K->P0,
+                                   K->Ft, GRETL_MOD_CUMULATE);
+            } else {
+                gretl_matrix_qform(K->ZT, GRETL_MOD_TRANSPOSE, K->P0,
+                                   K->Ft, GRETL_MOD_NONE);
+            }
 
-        /* calculate M_t = TPZ' [+ HG'] */
-        gretl_matrix_multiply(K->P0, K->ZT, K->PZ);
-        gretl_matrix_multiply(K->T, K->PZ, K->Mt);
-        if (K->HG != NULL) {
-            gretl_matrix_add_to(K->Mt, K->HG);
-        }
+            /* calculate M_t = TPZ' [+ HG'] */
+            gretl_matrix_multiply(K->P0, K->ZT, K->PZ);
+            gretl_matrix_multiply(K->T, K->PZ, K->Mt);
+            if (K->HG != NULL) {
+                gretl_matrix_add_to(K->Mt, K->HG);
+            }
 
-        /* standard Kalman procedure */
-        fast_copy_values(K->iFt, K->Ft);
-        err = gretl_invert_symmetric_matrix2(K->iFt, &ldet);
-        if (err) {
-            fprintf(stderr, "kfilter_standard: failed to invert Ft\n");
-        } else {
-            qt = gretl_scalar_qform(K->vt, K->iFt, &err);
+            /* standard Kalman procedure */
+            fast_copy_values(K->iFt, K->Ft);
+            err = gretl_invert_symmetric_matrix2(K->iFt, &ldet);
+            if (err) {
+                fprintf(stderr, "kfilter_standard: failed to invert Ft\n");
+            } else {
+                qt = gretl_scalar_qform(K->vt, K->iFt, &err);
+            }
         }
 
         if (K->F != NULL) {
@@ -2102,10 +2149,12 @@ int kfilter_standard (kalman *K, PRN *prn)
         }
 
         /* Calculate gain K_t = M_t F_t^{-1}, and C matrix */
-        gretl_matrix_multiply(K->Mt, K->iFt, K->Kt);
-        gretl_matrix_multiply_mod(K->Kt, GRETL_MOD_NONE,
-                                  K->Mt, GRETL_MOD_TRANSPOSE,
-                                  K->Ct, GRETL_MOD_NONE);
+        if (!steady) {
+            gretl_matrix_multiply(K->Mt, K->iFt, K->Kt);
+            gretl_matrix_multiply_mod(K->Kt, GRETL_MOD_NONE,
+                                      K->Mt, GRETL_MOD_TRANSPOSE,
+                                      K->Ct, GRETL_MOD_NONE);
+        }
         if (!err && K->K != NULL) {
             /* record the gain */
             record_to_vec(K->K, K->Kt, K->t);
@@ -2122,11 +2171,18 @@ int kfilter_standard (kalman *K, PRN *prn)
         fast_copy_values(K->a0, K->a1);
 
         /* update var(state): P1 = TPT' + VS - C */
-        fast_copy_values(K->P1, K->VS);
-        gretl_matrix_qform(K->T, GRETL_MOD_NONE,
-                           K->P0, K->P1, GRETL_MOD_CUMULATE);
-        gretl_matrix_subtract_from(K->P1, K->Ct);
-        fast_copy_values(K->P0, K->P1);
+        if (!steady) {
+            fast_copy_values(K->P1, K->VS);
+            gretl_matrix_qform(K->T, GRETL_MOD_NONE,
+                               K->P0, K->P1, GRETL_MOD_CUMULATE);
+            gretl_matrix_subtract_from(K->P1, K->Ct);
+            if (ss_ok && kalman_matrix_converged(K->P0, K->P1, K->sstol)) {
+                steady = 1;
+                ss_ldet = ldet;
+                K->sst = K->t + 1;
+            }
+            fast_copy_values(K->P0, K->P1);
+        }
 
         /* record forecast errors if wanted */
         if (!err && K->V != NULL) {
@@ -2156,6 +2212,341 @@ int kfilter_standard (kalman *K, PRN *prn)
     return err;
 }
 
+/* Derivative of B'x_t with respect to a single parameter,
+   given the derivative @dBT of B'.
+*/
+
+static void kalman_do_dBx (kalman *K, const gretl_matrix *dBT,
+                           gretl_matrix *targ)
+{
+    double xjt;
+    int i, j;
+
+    for (i=0; i<K->n; i++) {
+        if (K->x == NULL) {
+            targ->val[i] = dBT->val[i];
+        } else {
+            targ->val[i] = 0;
+            for (j=0; j<K->k; j++) {
+                xjt = get_xjt(K, j);
+                if (!na(xjt)) {
+                    targ->val[i] += xjt * gretl_matrix_get(dBT, j, i);
+                }
+            }
+        }
+    }
+}
+
+/* Add A*B' + B*A' to @C */
+
+static void add_sym_product (const gretl_matrix *A,
+                             const gretl_matrix *B,
+                             gretl_matrix *C)
+{
+    gretl_matrix_multiply_mod(A, GRETL_MOD_NONE,
+                              B, GRETL_MOD_TRANSPOSE,
+                              C, GRETL_MOD_CUMULATE);
+    gretl_matrix_multiply_mod(B, GRETL_MOD_NONE,
+                              A, GRETL_MOD_TRANSPOSE,
+                              C, GRETL_MOD_CUMULATE);
+}
+
+/**
+ * kfilter_score:
+ * @K: pointer to Kalman struct.
+ * @D: array of @npar sets of derivatives of the system matrices.
+ * @npar: number of parameters.
+ * @g: array of length @npar to receive the score.
+ *
+ * Runs the filter as kfilter_standard() does and, alongside it,
+ * the forward recursions for the derivatives of the state and its
+ * MSE with respect to each of @npar parameters, so giving the
+ * gradient of the log-likelihood in a single pass. The i-th
+ * element of @D holds the derivatives of T, B', Z', the state
+ * variance and the initial MSE with respect to parameter i; any of
+ * these may be NULL, meaning that the matrix in question does not
+ * depend on the parameter. The initial state and the variance of
+ * the observation disturbance are taken to be parameter-free.
+ *
+ * This is supported only for time-invariant filters without
+ * cross-correlated disturbances.
+ *
+ * Returns: 0 on success, non-zero on error.
+ */
+
+int kfilter_score (kalman *K, const kalman_deriv *D,
+                   int npar, double *g)
+{
+    gretl_matrix_block *B = NULL;
+    gretl_matrix **da = NULL;
+    gretl_matrix **dP = NULL;
+    gretl_matrix *u, *dv, *dF, *dM, *dK, *W, *a1, *P1, *Wr;
+    double ll0 = K->n * LN_2_PI;
+    double *dqsum = NULL;
+    double *dldet = NULL;
+    double sumldet = 0;
+    double ldet = 0;
+    int r = K->r, n = K->n;
+    int i, j, nt, err = 0;
+
+    if (filter_is_varying(K) || K->HG != NULL) {
+        return E_NOTIMP;
+    }
+
+    B = gretl_matrix_block_new(&u, n, 1,
+                               &dv, n, 1,
+                               &dF, n, n,
+                               &dM, r, n,
+                               &dK, r, n,
+                               &W, n, n,
+                               &a1, r, 1,
+                               &P1, r, r,
+                               &Wr, r, r,
+                               NULL);
+    da = calloc(npar, sizeof *da);
+    dP = calloc(npar, sizeof *dP);
+    dqsum = calloc(2 * npar, sizeof *dqsum);
+    if (B == NULL || da == NULL || dP == NULL || dqsum == NULL) {
+        err = E_ALLOC;
+        goto bailout;
+    }
+    dldet = dqsum + npar;
+
+    for (i=0; i<npar && !err; i++) {
+        da[i] = gretl_zero_matrix_new(r, 1);
+        if (D[i].P != NULL) {
+            dP[i] = gretl_matrix_copy(D[i].P);
+        } else {
+            dP[i] = gretl_zero_matrix_new(r, r);
+        }
+        if (da[i] == NULL || dP[i] == NULL) {
+            err = E_ALLOC;
+        }
+    }
+    if (err) {
+        goto bailout;
+    }
+
+    K->qsum = K->loglik = 0.0;
+    K->s2 = NADBL;
+    K->okN = K->N;
+
+    for (K->t = 0; K->t < K->N && !err; K->t += 1) {
+        nt = compute_forecast_error(K);
+
+        if (nt == 0) {
+            /* missing: a1 = T a0, P1 = TPT' + VS, and likewise
+               for the derivatives */
+            K->okN -= 1;
+            for (i=0; i<npar; i++) {
+                const kalman_deriv *Di = &D[i];
+
+                gretl_matrix_multiply(K->T, da[i], a1);
+                if (Di->T != NULL) {
+                    gretl_matrix_multiply_mod(Di->T, GRETL_MOD_NONE,
+                                              K->a0, GRETL_MOD_NONE,
+                                              a1, GRETL_MOD_CUMULATE);
+                }
+                fast_copy_values(da[i], a1);
+                if (Di->VS != NULL) {
+                    fast_copy_values(P1, Di->VS);
+                } else {
+                    gretl_matrix_zero(P1);
+                }
+                gretl_matrix_qform(K->T, GRETL_MOD_NONE, dP[i],
+                                   P1, GRETL_MOD_CUMULATE);
+                if (Di->T != NULL) {
+                    /* dT P T' + T P dT' */
+                    gretl_matrix_multiply(Di->T, K->P0, Wr);
+                    add_sym_product(Wr, K->T, P1);
+                }
+                fast_copy_values(dP[i], P1);
+            }
+            handle_missing_obs(K);
+            continue;
+        }
+
+        /* F_t, M_t = T P Z, the gain and the likelihood terms */
+        if (K->VY != NULL) {
+            fast_copy_values(K->Ft, K->VY);
+            gretl_matrix_qform(K->ZT, GRETL_MOD_TRANSPOSE, K->P0,
+                               K->Ft, GRETL_MOD_CUMULATE);
+        } else {
+            gretl_matrix_qform(K->ZT, GRETL_MOD_TRANSPOSE, K->P0,
+                               K->Ft, GRETL_MOD_NONE);
+        }
+        gretl_matrix_multiply(K->P0, K->ZT, K->PZ);
+        gretl_matrix_multiply(K->T, K->PZ, K->Mt);
+        fast_copy_values(K->iFt, K->Ft);
+        err = gretl_invert_symmetric_matrix2(K->iFt, &ldet);
+        if (err) {
+            break;
+        }
+        sumldet += ldet;
+        gretl_matrix_multiply(K->iFt, K->vt, u);
+        for (j=0; j<n; j++) {
+            K->qsum += K->vt->val[j] * u->val[j];
+        }
+        gretl_matrix_multiply(K->Mt, K->iFt, K->Kt);
+
+        for (i=0; i<npar; i++) {
+            const kalman_deriv *Di = &D[i];
+            double dq = 0;
+
+            /* dv = -dB'x - dZ'a - Z'da */
+            if (Di->BT != NULL) {
+                kalman_do_dBx(K, Di->BT, dv);
+                gretl_matrix_multiply_by_scalar(dv, -1.0);
+            } else {
+                gretl_matrix_zero(dv);
+            }
+            if (Di->ZT != NULL) {
+                gretl_matrix_multiply_mod(Di->ZT, GRETL_MOD_TRANSPOSE,
+                                          K->a0, GRETL_MOD_NONE,
+                                          dv, GRETL_MOD_DECREMENT);
+            }
+            gretl_matrix_multiply_mod(K->ZT, GRETL_MOD_TRANSPOSE,
+                                      da[i], GRETL_MOD_NONE,
+                                      dv, GRETL_MOD_DECREMENT);
+
+            /* dF = dZ'PZ + Z'P dZ + Z'dP Z */
+            gretl_matrix_qform(K->ZT, GRETL_MOD_TRANSPOSE, dP[i],
+                               dF, GRETL_MOD_NONE);
+            if (Di->ZT != NULL) {
+                gretl_matrix_multiply_mod(Di->ZT, GRETL_MOD_TRANSPOSE,
+                                          K->PZ, GRETL_MOD_NONE,
+                                          W, GRETL_MOD_NONE);
+                gretl_matrix_add_to(dF, W);
+                gretl_matrix_add_transpose_to(dF, W);
+            }
+
+            /* dM = dT P Z + T dP Z + T P dZ */
+            gretl_matrix_multiply(dP[i], K->ZT, dK);
+            if (Di->ZT != NULL) {
+                gretl_matrix_multiply_mod(K->P0, GRETL_MOD_NONE,
+                                          Di->ZT, GRETL_MOD_NONE,
+                                          dK, GRETL_MOD_CUMULATE);
+            }
+            gretl_matrix_multiply(K->T, dK, dM);
+            if (Di->T != NULL) {
+                gretl_matrix_multiply_mod(Di->T, GRETL_MOD_NONE,
+                                          K->PZ, GRETL_MOD_NONE,
+                                          dM, GRETL_MOD_CUMULATE);
+            }
+
+            /* dq = 2 u'dv - u'dF u, dldet = tr(dF F^{-1}) */
+            for (j=0; j<n; j++) {
+                dq += 2 * u->val[j] * dv->val[j];
+            }
+            dq -= gretl_scalar_qform(u, dF, &err);
+            dqsum[i] += dq;
+            gretl_matrix_multiply(dF, K->iFt, W);
+            dldet[i] += gretl_matrix_trace(W);
+
+            /* dK = (dM - K dF) F^{-1} */
+            gretl_matrix_multiply(dM, K->iFt, dK);
+            gretl_matrix_multiply_mod(K->Kt, GRETL_MOD_NONE,
+                                      W, GRETL_MOD_NONE,
+                                      dK, GRETL_MOD_DECREMENT);
+
+            /* da1 = dT a + T da + dK v + K dv */
+            gretl_matrix_multiply(K->T, da[i], a1);
+            if (Di->T != NULL) {
+                gretl_matrix_multiply_mod(Di->T, GRETL_MOD_NONE,
+                                          K->a0, GRETL_MOD_NONE,
+                                          a1, GRETL_MOD_CUMULATE);
+            }
+            gretl_matrix_multiply_mod(dK, GRETL_MOD_NONE,
+                                      K->vt, GRETL_MOD_NONE,
+                                      a1, GRETL_MOD_CUMULATE);
+            gretl_matrix_multiply_mod(K->Kt, GRETL_MOD_NONE,
+                                      dv, GRETL_MOD_NONE,
+                                      a1, GRETL_MOD_CUMULATE);
+            fast_copy_values(da[i], a1);
+
+            /* dP1 = dT P T' + T P dT' + T dP T' + dVS - dK M' - K dM' */
+            if (Di->VS != NULL) {
+                fast_copy_values(P1, Di->VS);
+            } else {
+                gretl_matrix_zero(P1);
+            }
+            gretl_matrix_qform(K->T, GRETL_MOD_NONE, dP[i],
+                               P1, GRETL_MOD_CUMULATE);
+            if (Di->T != NULL) {
+                gretl_matrix_multiply(Di->T, K->P0, Wr);
+                add_sym_product(Wr, K->T, P1);
+            }
+            gretl_matrix_multiply_mod(dK, GRETL_MOD_NONE,
+                                      K->Mt, GRETL_MOD_TRANSPOSE,
+                                      P1, GRETL_MOD_DECREMENT);
+            gretl_matrix_multiply_mod(K->Kt, GRETL_MOD_NONE,
+                                      dM, GRETL_MOD_TRANSPOSE,
+                                      P1, GRETL_MOD_DECREMENT);
+            fast_copy_values(dP[i], P1);
+        }
+
+        /* and now the filter proper: a1 = T a0 + K v [+ mu] */
+        gretl_matrix_multiply(K->T, K->a0, a1);
+        if (K->mu != NULL) {
+            gretl_matrix_add_to(a1, K->mu);
+        }
+        gretl_matrix_multiply_mod(K->Kt, GRETL_MOD_NONE,
+                                  K->vt, GRETL_MOD_NONE,
+                                  a1, GRETL_MOD_CUMULATE);
+        fast_copy_values(K->a0, a1);
+        /* P1 = TPT' + VS - K M' */
+        fast_copy_values(P1, K->VS);
+        gretl_matrix_qform(K->T, GRETL_MOD_NONE, K->P0,
+                           P1, GRETL_MOD_CUMULATE);
+        gretl_matrix_multiply_mod(K->Kt, GRETL_MOD_NONE,
+                                  K->Mt, GRETL_MOD_TRANSPOSE,
+                                  P1, GRETL_MOD_DECREMENT);
+        fast_copy_values(K->P0, P1);
+        if (K->V != NULL) {
+            record_to_row(K->V, K->vt, K->t);
+        }
+    }
+
+    if (err || K->okN == 0) {
+        K->loglik = NADBL;
+        err = err ? err : E_NAN;
+    } else if (kalman_arma_ll(K)) {
+        /* concentrated with respect to the scale factor */
+        double ll1 = 1.0 + LN_2_PI + log(K->qsum / K->okN);
+
+        K->loglik = -0.5 * (K->okN * ll1 + sumldet);
+        for (i=0; i<npar; i++) {
+            g[i] = -0.5 * (K->okN * dqsum[i] / K->qsum + dldet[i]);
+        }
+    } else {
+        int d = kalman_diffuse(K) ? K->r : 0;
+
+        K->loglik = -0.5 * (K->okN * ll0 + sumldet + K->qsum);
+        K->s2 = K->qsum / (K->n * K->okN - d);
+        for (i=0; i<npar; i++) {
+            g[i] = -0.5 * (dldet[i] + dqsum[i]);
+        }
+    }
+    if (!err && na(K->loglik)) {
+        err = E_NAN;
+    }
+
+ bailout:
+
+    gretl_matrix_block_destroy(B);
+    if (da != NULL) {
+        for (i=0; i<npar; i++) {
+            gretl_matrix_free(da[i]);
+            gretl_matrix_free(dP[i]);
+        }
+        free(da);
+        free(dP);
+    }
+    free(dqsum);
+
+    return err;
+}
+
 struct K_input_mat {
     int sym;
     const char *name;
@@ -2404,6 +2795,403 @@ int kalman_bundle_filter (gretl_bundle *b, PRN *prn, int *errp)
     return kalman_filter(K, prn, errp);
 }
 
+/* Apparatus for kmfilter(): running a time-invariant filter on
+   several independent sets of observables at once. Since P_t, F_t
+   and the gain depend only on the system matrices and the pattern
+   of missing values, all the sets with no missing values share a
+   single covariance recursion and their states are updated jointly,
+   as matrices with one column per set. Each set with missing values
+   gets its own recursion; these are run in parallel, if OpenMP is
+   available, each thread using its own workspace.
+*/
+
+typedef struct kmulti_ws_ kmulti_ws;
+
+struct kmulti_ws_ {
+    gretl_matrix_block *Blk;
+    gretl_matrix *A0; /* r x m: states, before updating */
+    gretl_matrix *A1; /* r x m: states, after updating */
+    gretl_matrix *Vt; /* n x m: forecast errors */
+    gretl_matrix *Wt; /* n x m: F_t^{-1} times forecast errors */
+    gretl_matrix *P0;
+    gretl_matrix *P1;
+    gretl_matrix *Ft;
+    gretl_matrix *iFt;
+    gretl_matrix *PZ;
+    gretl_matrix *Mt;
+    gretl_matrix *Kt;
+    gretl_matrix *Ct;
+};
+
+static void kmulti_ws_free (kmulti_ws *ws)
+{
+    if (ws != NULL) {
+        gretl_matrix_block_destroy(ws->Blk);
+        free(ws);
+    }
+}
+
+static kmulti_ws *kmulti_ws_new (const kalman *K, int m)
+{
+    kmulti_ws *ws = malloc(sizeof *ws);
+    int r = K->r, n = K->n;
+
+    if (ws != NULL) {
+        ws->Blk = gretl_matrix_block_new(&ws->A0, r, m,
+                                         &ws->A1, r, m,
+                                         &ws->Vt, n, m,
+                                         &ws->Wt, n, m,
+                                         &ws->P0, r, r,
+                                         &ws->P1, r, r,
+                                         &ws->Ft, n, n,
+                                         &ws->iFt, n, n,
+                                         &ws->PZ, r, n,
+                                         &ws->Mt, r, n,
+                                         &ws->Kt, r, n,
+                                         &ws->Ct, r, r,
+                                         NULL);
+        if (ws->Blk == NULL) {
+            free(ws);
+            ws = NULL;
+        }
+    }
+
+    return ws;
+}
+
+/* a1 = T*a0 [+ mu], column by column */
+
+static void kmulti_state_step (const kalman *K, kmulti_ws *ws)
+{
+    int i, j;
+
+    gretl_matrix_multiply(K->T, ws->A0, ws->A1);
+    if (K->mu != NULL) {
+        for (j=0; j<ws->A1->cols; j++) {
+            for (i=0; i<K->r; i++) {
+                ws->A1->val[j*K->r+i] += K->mu->val[i];
+            }
+        }
+    }
+}
+
+/* Run the filter for the @m sets of observables whose (0-based)
+   indices are given by @sel, writing the log-likelihoods into @lnl
+   and the predicted states and forecast errors into @S and @E.
+   Only read access to @K is required, so this can be called from
+   several threads at once. Apart from a failure to invert F_t,
+   which marks the log-likelihoods as NA, this cannot fail.
+*/
+
+static void kmulti_run (const kalman *K, kmulti_ws *ws,
+                        const gretl_matrix *Y,
+                        const gretl_matrix *Bx,
+                        const int *sel, int m,
+                        gretl_matrix *lnl,
+                        gretl_matrix *S,
+                        gretl_matrix *E)
+{
+    double ll0 = K->n * LN_2_PI;
+    double ldet = 0, yti;
+    int ss_ok = K->sstol > 0;
+    int steady = 0;
+    int r = K->r, n = K->n;
+    int i, j, t, miss;
+    int err = 0;
+
+    for (j=0; j<m; j++) {
+        for (i=0; i<r; i++) {
+            gretl_matrix_set(ws->A0, i, j, K->a0->val[i]);
+        }
+        lnl->val[sel[j]] = 0.0;
+    }
+    fast_copy_values(ws->P0, K->P0);
+
+    for (t=0; t<K->N && !err; t++) {
+        miss = 0;
+        for (j=0; j<m; j++) {
+            for (i=0; i<r; i++) {
+                gretl_matrix_set(S, t, sel[j]*r + i,
+                                 gretl_matrix_get(ws->A0, i, j));
+            }
+            for (i=0; i<n; i++) {
+                yti = gretl_matrix_get(Y, t, sel[j]*n + i);
+                if (Bx != NULL) {
+                    yti -= gretl_matrix_get(Bx, t, i);
+                }
+                if (na(yti)) {
+                    miss = 1;
+                }
+                gretl_matrix_set(ws->Vt, i, j, yti);
+            }
+        }
+
+        if (miss) {
+            /* as in handle_missing_obs() */
+            kmulti_state_step(K, ws);
+            fast_copy_values(ws->A0, ws->A1);
+            fast_copy_values(ws->P1, K->VS);
+            gretl_matrix_qform(K->T, GRETL_MOD_NONE, ws->P0,
+                               ws->P1, GRETL_MOD_CUMULATE);
+            fast_copy_values(ws->P0, ws->P1);
+            for (j=0; j<m; j++) {
+                for (i=0; i<n; i++) {
+                    gretl_matrix_set(E, t, sel[j]*n + i, NADBL);
+                }
+            }
+            steady = 0;
+            continue;
+        }
+
+        /* v_t = y_t - B'x_t - Z'a_t, for all sets */
+        gretl_matrix_multiply_mod(K->ZT, GRETL_MOD_TRANSPOSE,
+                                  ws->A0, GRETL_MOD_NONE,
+                                  ws->Vt, GRETL_MOD_DECREMENT);
+
+        if (!steady) {
+            if (K->VY != NULL) {
+                fast_copy_values(ws->Ft, K->VY);
+                gretl_matrix_qform(K->ZT, GRETL_MOD_TRANSPOSE, ws->P0,
+                                   ws->Ft, GRETL_MOD_CUMULATE);
+            } else {
+                gretl_matrix_qform(K->ZT, GRETL_MOD_TRANSPOSE, ws->P0,
+                                   ws->Ft, GRETL_MOD_NONE);
+            }
+            gretl_matrix_multiply(ws->P0, K->ZT, ws->PZ);
+            gretl_matrix_multiply(K->T, ws->PZ, ws->Mt);
+            if (K->HG != NULL) {
+                gretl_matrix_add_to(ws->Mt, K->HG);
+            }
+            fast_copy_values(ws->iFt, ws->Ft);
+            err = gretl_invert_symmetric_matrix2(ws->iFt, &ldet);
+            if (err) {
+                break;
+            }
+            gretl_matrix_multiply(ws->Mt, ws->iFt, ws->Kt);
+            gretl_matrix_multiply_mod(ws->Kt, GRETL_MOD_NONE,
+                                      ws->Mt, GRETL_MOD_TRANSPOSE,
+                                      ws->Ct, GRETL_MOD_NONE);
+        }
+
+        /* log-likelihood contributions, per set */
+        gretl_matrix_multiply(ws->iFt, ws->Vt, ws->Wt);
+        for (j=0; j<m; j++) {
+            double qt = 0;
+
+            for (i=0; i<n; i++) {
+                qt += gretl_matrix_get(ws->Vt, i, j) *
+                    gretl_matrix_get(ws->Wt, i, j);
+                gretl_matrix_set(E, t, sel[j]*n + i,
+                                 gretl_matrix_get(ws->Vt, i, j));
+            }
+            lnl->val[sel[j]] -= 0.5 * (ll0 + ldet + qt);
+        }
+
+        /* A1 = T A0 + K_t V_t [+ mu] */
+        kmulti_state_step(K, ws);
+        gretl_matrix_multiply_mod(ws->Kt, GRETL_MOD_NONE,
+                                  ws->Vt, GRETL_MOD_NONE,
+                                  ws->A1, GRETL_MOD_CUMULATE);
+        fast_copy_values(ws->A0, ws->A1);
+
+        if (!steady) {
+            fast_copy_values(ws->P1, K->VS);
+            gretl_matrix_qform(K->T, GRETL_MOD_NONE, ws->P0,
+                               ws->P1, GRETL_MOD_CUMULATE);
+            gretl_matrix_subtract_from(ws->P1, ws->Ct);
+            if (ss_ok && kalman_matrix_converged(ws->P0, ws->P1, K->sstol)) {
+                steady = 1;
+            }
+            fast_copy_values(ws->P0, ws->P1);
+        }
+    }
+
+    for (j=0; j<m; j++) {
+        if (err || na(lnl->val[sel[j]])) {
+            lnl->val[sel[j]] = NADBL;
+        }
+    }
+}
+
+static int kmulti_check (kalman *K, const gretl_matrix *Y)
+{
+    if (filter_is_varying(K) || K->exact) {
+        gretl_errmsg_set(_("kmfilter: the model must be time-invariant "
+                           "and without exact diffuse initialization"));
+        return E_INVARG;
+    } else if (Y == NULL || Y->rows != K->N || Y->cols == 0 ||
+               Y->cols % K->n != 0) {
+        gretl_errmsg_sprintf(_("kmfilter: the data matrix should have %d rows "
+                               "and a multiple of %d columns"), K->N, K->n);
+        return E_NONCONF;
+    } else {
+        return 0;
+    }
+}
+
+/* Form B'x_t for all t: this is common to all the sets of
+   observables, and kalman_do_Bx() is not safe for use in
+   several threads at once.
+*/
+
+static gretl_matrix *kmulti_Bx (kalman *K, int *err)
+{
+    gretl_matrix *Bx = gretl_zero_matrix_new(K->N, K->n);
+
+    if (Bx == NULL) {
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    for (K->t = 0; K->t < K->N; K->t += 1) {
+        gretl_matrix_zero(K->vt);
+        kalman_do_Bx(K, K->vt, GRETL_MOD_NONE);
+        record_to_row(Bx, K->vt, K->t);
+    }
+
+    return Bx;
+}
+
+/**
+ * kalman_bundle_multi_filter:
+ * @b: Kalman bundle.
+ * @Y: N x (n*m) matrix holding m sets of n observables.
+ * @prn: printing apparatus (or NULL).
+ * @err: location to receive error code.
+ *
+ * Runs the (time-invariant) filter defined by @b on each of the
+ * sets of observables in @Y, without modifying @b.
+ *
+ * Returns: a bundle holding the log-likelihoods, m x 1, the
+ * one-step ahead predicted states, N x (r*m), and the forecast
+ * errors, N x (n*m), or NULL on failure.
+ */
+
+gretl_bundle *kalman_bundle_multi_filter (gretl_bundle *b,
+                                          const gretl_matrix *Y,
+                                          PRN *prn, int *err)
+{
+    kalman *K = gretl_bundle_get_private_data(b);
+    gretl_matrix *lnl = NULL;
+    gretl_matrix *S = NULL;
+    gretl_matrix *E = NULL;
+    gretl_matrix *Bx = NULL;
+    gretl_bundle *ret = NULL;
+    int *full = NULL, *part = NULL;
+    int nfull = 0, npart = 0;
+    int i, j, t, m, miss;
+
+    *err = kmulti_check(K, Y);
+    if (!*err) {
+        /* includes setting of K->a0 and K->P0 */
+        *err = kalman_bundle_recheck_matrices(K, prn);
+    }
+    if (*err) {
+        return NULL;
+    }
+
+    m = Y->cols / K->n;
+    lnl = gretl_matrix_alloc(m, 1);
+    S = gretl_matrix_alloc(K->N, K->r * m);
+    E = gretl_matrix_alloc(K->N, K->n * m);
+    full = malloc(m * sizeof *full);
+    part = malloc(m * sizeof *part);
+    if (lnl == NULL || S == NULL || E == NULL ||
+        full == NULL || part == NULL) {
+        *err = E_ALLOC;
+        goto bailout;
+    }
+
+    if (K->BT != NULL) {
+        Bx = kmulti_Bx(K, err);
+        if (*err) {
+            goto bailout;
+        }
+    }
+
+    /* sort the sets by presence of missing values */
+    for (j=0; j<m; j++) {
+        miss = 0;
+        for (t=0; t<K->N && !miss; t++) {
+            for (i=0; i<K->n && !miss; i++) {
+                miss = na(gretl_matrix_get(Y, t, j*K->n + i));
+                if (!miss && Bx != NULL) {
+                    miss = na(gretl_matrix_get(Bx, t, i));
+                }
+            }
+        }
+        if (miss) {
+            part[npart++] = j;
+        } else {
+            full[nfull++] = j;
+        }
+    }
+
+    if (nfull > 0) {
+        kmulti_ws *ws = kmulti_ws_new(K, nfull);
+
+        if (ws == NULL) {
+            *err = E_ALLOC;
+            goto bailout;
+        }
+        kmulti_run(K, ws, Y, Bx, full, nfull, lnl, S, E);
+        kmulti_ws_free(ws);
+    }
+
+    if (npart > 0) {
+        guint64 fpm = (guint64) npart * K->N * K->r * K->r * K->r;
+        int ws_err = 0;
+
+#if defined(_OPENMP)
+#pragma omp parallel if (npart > 1 && gretl_use_openmp(fpm))
+#endif
+        {
+            kmulti_ws *ws = kmulti_ws_new(K, 1);
+            int jj;
+
+            if (ws == NULL) {
+#if defined(_OPENMP)
+#pragma omp critical
+#endif
+                ws_err = E_ALLOC;
+            }
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+            for (jj=0; jj<npart; jj++) {
+                if (ws != NULL) {
+                    kmulti_run(K, ws, Y, Bx, part + jj, 1, lnl, S, E);
+                }
+            }
+            kmulti_ws_free(ws);
+        }
+        *err = ws_err;
+    }
+
+ bailout:
+
+    if (!*err) {
+        ret = gretl_bundle_new();
+        if (ret == NULL) {
+            *err = E_ALLOC;
+        }
+    }
+    if (!*err) {
+        gretl_bundle_donate_data(ret, "lnl", lnl, GRETL_TYPE_MATRIX, 0);
+        gretl_bundle_donate_data(ret, "state", S, GRETL_TYPE_MATRIX, 0);
+        gretl_bundle_donate_data(ret, "prederr", E, GRETL_TYPE_MATRIX, 0);
+    } else {
+        gretl_matrix_free(lnl);
+        gretl_matrix_free(S);
+        gretl_matrix_free(E);
+    }
+    gretl_matrix_free(Bx);
+    free(full);
+    free(part);
+
+    return ret;
+}
+
 /* write row @t of matrix @src into matrix @targ */
 
 static void load_from_row (gretl_matrix *targ,
@@ -3549,7 +4337,7 @@ static int output_matrix_slot (const char *s)
     return -1;
 }
 
-#define K_N_SCALARS 15
+#define K_N_SCALARS 17
 
 enum {
     Ks_t = 0,
@@ -3566,7 +4354,9 @@ enum {
     Ks_N,
     Ks_p,
     Ks_d,
-    Ks_j
+    Ks_j,
+    Ks_SSTOL,
+    Ks_SST
 };
 
 static const char *kalman_output_scalar_names[K_N_SCALARS] = {
@@ -3584,7 +4374,9 @@ static const char *kalman_output_scalar_names[K_N_SCALARS] = {
     "N",
     "p",
     "d",
-    "j"
+    "j",
+    "steady_tol",
+    "steady_t"
 };
 
 static double *kalman_output_scalar (kalman *K,
@@ -3660,6 +4452,12 @@ static double *kalman_output_scalar (kalman *K,
     case Ks_j:
         retval[idx] = K->j;
         break;
+    case Ks_SSTOL:
+        retval[idx] = K->sstol;
+        break;
+    case Ks_SST:
+        retval[idx] = K->sst + 1;
+        break;
     default:
         break;
     }
@@ -3847,7 +4645,8 @@ int maybe_set_kalman_element (void *kptr,
     }
 
     if (!strcmp(key, "diffuse") || !strcmp(key, "sequential") ||
-        !strcmp(key, "dejong") || !strcmp(key, "extra")) {
+        !strcmp(key, "dejong") || !strcmp(key, "extra") ||
+        !strcmp(key, "steady_tol")) {
         /* scalar config settings */
         if (vtype == GRETL_TYPE_DOUBLE) {
             double v = *(double *) vptr;
@@ -3858,6 +4657,12 @@ int maybe_set_kalman_element (void *kptr,
                 *err = kalman_set_code(K, K_SEQUEN, (int) v);
 	    } else if (!strcmp(key, "dejong")) {
 		*err = kalman_set_code(K, K_DEJONG, (int) v);
+            } else if (!strcmp(key, "steady_tol")) {
+                if (na(v) || v < 0 || v >= 1) {
+                    *err = E_INVARG;
+                } else {
+                    K->sstol = v;
+                }
             } else {
                 /* note: just for KFAS comparison */
                 K->flags |= KALMAN_EXTRA;
@@ -4345,6 +5150,7 @@ gretl_bundle *kalman_deserialize (void *p1, void *p2, int *err)
     char *tvcall = NULL;
     double s2 = NADBL;
     double lnl = NADBL;
+    double sstol = 0.0;
     int copy[5] = {0};
     int i, nmats = 0;
     int Kflags = 0;
@@ -4383,6 +5189,8 @@ gretl_bundle *kalman_deserialize (void *p1, void *p2, int *err)
                             s2 = x;
                         } else if (!strcmp(key, "lnl")) {
                             lnl = x;
+                        } else if (!strcmp(key, "steady_tol")) {
+                            sstol = x;
                         }
                     }
                 } else if (!xmlStrcmp(cur->name, (XUC) "string")) {
@@ -4429,6 +5237,7 @@ gretl_bundle *kalman_deserialize (void *p1, void *p2, int *err)
             K->vartype = vtype;
             K->s2 = s2;
             K->loglik = lnl;
+            K->sstol = sstol;
 
             for (i=0; i<K_MMAX; i++) {
                 if (Mopt[i] != NULL) {
@@ -4539,6 +5348,7 @@ gretl_bundle *kalman_bundle_copy (const gretl_bundle *src, int *err)
     Knew->s2 = K->s2;
     Knew->loglik = K->loglik;
     Knew->vartype = K->vartype;
+    Knew->sstol = K->sstol;
 
     if (K->flags & KALMAN_DIFFUSE) {
         Knew->flags |= KALMAN_DIFFUSE;
@@ -4980,6 +5790,19 @@ static int kfilter_sequential (kalman *K, PRN *prn)
                 fprintf(stderr, "t,i = %d,%d, rankPk = %d\n", t, i, rankPk);
             }
             load_from_row(Zi, Z, i);
+            if (d != 0 && na(gretl_matrix_get(K->y, t, i))) {
+                /* Outside of the exact diffuse phase a missing
+                   element contributes nothing to the update, and
+                   the smoother doesn't need its F or K, so we can
+                   skip the O(r^2) calculation of the gain.
+                */
+                gretl_matrix_set(F, t, i, K->smo_prep ? 0.0 : NADBL);
+                gretl_matrix_zero(Kti);
+                record_to_col(K->Kt, Kti, i);
+                gretl_matrix_set(V, t, i, NADBL);
+                K->okN -= 1;
+                continue;
+            }
             gretl_matrix_multiply_mod(Pti, GRETL_MOD_NONE,
                                       Zi, GRETL_MOD_TRANSPOSE,
                                       Kti, GRETL_MOD_NONE);
@@ -21,6 +21,19 @@
 #define KALMAN_H_
 
 typedef struct kalman_ kalman;
+typedef struct kalman_deriv_ kalman_deriv;
+
+/* derivatives of the system matrices with respect to a
+   single parameter, for use with kfilter_score()
+*/
+
+struct kalman_deriv_ {
+    gretl_matrix *T;  /* r x r: state transition matrix */
+    gretl_matrix *BT; /* k x n: B' */
+    gretl_matrix *ZT; /* r x n: Z' */
+    gretl_matrix *VS; /* r x r: state disturbance variance */
+    gretl_matrix *P;  /* r x r: initial MSE of the state */
+};
 
 kalman *kalman_new_minimal (gretl_matrix *M[], int copy[],
 			    int nmat, int dkvar, int *err);
@@ -38,6 +51,9 @@ kalman *kalman_new (gretl_matrix *a, gretl_matrix *P,
 
 int kfilter_standard (kalman *K, PRN *prn);
 
+int kfilter_score (kalman *K, const kalman_deriv *D,
+                   int npar, double *g);
+
 int is_kalman_bundle (gretl_bundle *b);
 
 gretl_matrix *kalman_smooth (kalman *K, gretlopt opt,
@@ -67,6 +83,10 @@ PRN *kalman_get_printer (const kalman *K);
 
 int kalman_bundle_filter (gretl_bundle *b, PRN *prn, int *errp);
 
+gretl_bundle *kalman_bundle_multi_filter (gretl_bundle *b,
+                                          const gretl_matrix *Y,
+                                          PRN *prn, int *err);
+
 int kalman_bundle_smooth (gretl_bundle *b, int dist, PRN *prn);
 
 gretl_matrix *kalman_bundle_simulate (gretl_bundle *b,
@@ -347,6 +347,12 @@ static int legacy_dist_variance (kalman *K,
 
 /* This iteration is in common between the state smoother
    (Anderson-Moore) and the disturbance smoother (Koopman).
+
+   @ss tracks the final steady-state stretch of the forward pass
+   (see kfilter_standard), within which K_t and F_t^{-1} are fixed:
+   on input it is negative outside of that stretch, 0 on entry to it,
+   1 once L has been formed and 2 once the recursion for N has also
+   converged, after which N is held fixed.
 */
 
 static void LrN_iteration (kalman *K,
@@ -355,14 +361,18 @@ static void LrN_iteration (kalman *K,
 			   gretl_matrix *r0,
 			   gretl_matrix *r1,
 			   gretl_matrix *N0,
-			   gretl_matrix *N1)
+			   gretl_matrix *N1,
+			   int *ss)
 {
-    if (K->t < K->N - 1) {
+    if (K->t < K->N - 1 && *ss < 1) {
 	/* L_t = T_t - K_t Z_t */
 	fast_copy_values(L, K->T);
 	gretl_matrix_multiply_mod(K->Kt, GRETL_MOD_NONE,
 				  K->ZT, GRETL_MOD_TRANSPOSE,
 				  L, GRETL_MOD_DECREMENT);
+	if (*ss == 0) {
+	    *ss = 1;
+	}
     }
 
     /* r_{t-1} = Z_t' F_t^{-1} v_t + L_t' r_t */
@@ -381,15 +391,31 @@ static void LrN_iteration (kalman *K,
     if (K->t == K->N - 1) {
 	gretl_matrix_qform(K->ZT, GRETL_MOD_NONE,
 			   K->iFt, N0, GRETL_MOD_NONE);
-    } else {
+    } else if (*ss < 2) {
 	gretl_matrix_qform(K->ZT, GRETL_MOD_NONE,
 			   K->iFt, N1, GRETL_MOD_NONE);
 	gretl_matrix_qform(L, GRETL_MOD_TRANSPOSE,
 			   N0, N1, GRETL_MOD_CUMULATE);
+	if (*ss == 1 && kalman_matrix_converged(N0, N1, K->sstol)) {
+	    *ss = 2;
+	}
 	fast_copy_values(N0, N1);
     }
 }
 
+/* Update the steady-state flag for LrN_iteration() on moving
+   to time-step K->t in the backward pass.
+*/
+
+static void smoother_steady_check (kalman *K, int *ss)
+{
+    if (K->sst < 0 || K->t < K->sst || K->t == K->N - 1) {
+	*ss = -1;
+    } else if (*ss < 0) {
+	*ss = 0;
+    }
+}
+
 /* Initial smoothed state: a + P*r0 */
 
 static void koopman_calc_a0 (kalman *K, gretl_matrix *r0)
@@ -422,6 +448,7 @@ static int legacy_koopman_smooth (kalman *K, int DKstyle)
     gretl_matrix *NH = NULL;
     gretl_matrix *Ut = NULL;
     int ft_min = 0;
+    int ss = -1;
     int t, err = 0;
 
     if (trace) {
@@ -496,7 +523,8 @@ static int legacy_koopman_smooth (kalman *K, int DKstyle)
 	}
 
 	/* compute r_{t-1}, N_{t-1} */
-	LrN_iteration(K, L, n1, r0, r1, N0, N1);
+	smoother_steady_check(K, &ss);
+	LrN_iteration(K, L, n1, r0, r1, N0, N1, &ss);
 
 	if (t == 0) {
 	    /* compute initial smoothed state */
@@ -579,6 +607,7 @@ static int anderson_moore_smooth (kalman *K)
 {
     gretl_matrix_block *B;
     gretl_matrix *r0, *r1, *N0, *N1, *n1, *L;
+    int ss = -1, Pfix;
     int t, err = 0;
 
     if (trace) {
@@ -615,7 +644,9 @@ static int anderson_moore_smooth (kalman *K)
         }
 
 	/* compute r_{t-1}, N_{t-1} */
-	LrN_iteration(K, L, n1, r0, r1, N0, N1);
+	smoother_steady_check(K, &ss);
+	Pfix = (ss == 2);
+	LrN_iteration(K, L, n1, r0, r1, N0, N1, &ss);
 
         /* a_{t|T} = a_{t|t-1} + P_{t|t-1} r_{t-1} */
         fast_copy_values(K->a1, K->a0);
@@ -624,10 +655,13 @@ static int anderson_moore_smooth (kalman *K)
                                   K->a1, GRETL_MOD_CUMULATE);
         record_to_row(K->A, K->a1, t);
 
-        /* P_{t|T} = P_{t|t-1} - P_{t|t-1} N_{t-1} P_{t|t-1} */
-        fast_copy_values(K->P1, K->P0);
-        gretl_matrix_qform(K->P0, GRETL_MOD_NONE, N0,
-                           K->P1, GRETL_MOD_DECREMENT);
+        /* P_{t|T} = P_{t|t-1} - P_{t|t-1} N_{t-1} P_{t|t-1}, which
+           is unchanged from step t+1 if N is already fixed */
+        if (!Pfix) {
+            fast_copy_values(K->P1, K->P0);
+            gretl_matrix_qform(K->P0, GRETL_MOD_NONE, N0,
+                               K->P1, GRETL_MOD_DECREMENT);
+        }
         record_to_vech(K->P, K->P1, K->r, t);
     }
 
@@ -28,6 +28,12 @@
 #include "gretl_string_table.h"
 #include "gretl_mt.h"
 #include "gretl_foreign.h"
+#include "gretl_profile.h"
+#include "gretl_memstats.h"
+#include "gretl_blasstats.h"
+#include "gretl_trace.h"
+#include "version.h"
+#include "gretl_normal.h"
 
 #ifdef HAVE_MPI
 # include "gretl_mpi.h"
@@ -37,6 +43,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <stdint.h>
+#include <signal.h>
 
 #include <glib.h>
 
@@ -127,10 +134,19 @@ static struct global_vars_ {
     gint8 R_lib;
     gint8 loglevel;
     gint8 logstamp;
+    gint8 matrix_pool;
+    gint8 jit;
+    gint8 profile;
+    gint8 rng_parallel;
+    gint8 memstats;
+    gint8 genr_stats;
+    gint8 blas_stats;
+    gint8 deterministic;
+    gint8 gnuplot_pipe;
     gint8 csv_digits;
     gint8 hac_missvals;
     int gmp_bits;
-} globals = {0, 0, 5, 0, 0, 1, 2, 0, UNSET_INT, HAC_ES, 256};
+} globals = {0, 0, 5, 0, 0, 1, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, UNSET_INT, HAC_ES, 256};
 
 /* globals for internal use */
 static int seed_is_set;
@@ -167,6 +183,8 @@ setvar setvars[] = {
     { MWRITE_G,     "mwrite_g", CAT_BEHAVE },
     { MPI_USE_SMT,  "mpi_use_smt", CAT_BEHAVE },
     { BS_ESCAPE,    "bs_escape", CAT_BEHAVE },
+    { USE_AUTODIFF, "autodiff", CAT_NUMERIC },
+    { BFGS_WARM,    "bfgs_warm", CAT_NUMERIC },
     { STATE_FLAG_MAX, NULL },
     /* small integers */
     { GRETL_OPTIM,  "optimizer", CAT_NUMERIC, offsetof(set_state,optim) },
@@ -223,6 +241,15 @@ setvar setvars[] = {
     { R_LIB,         "R_lib",       CAT_BEHAVE, offsetof(global_vars,R_lib) },
     { LOGLEVEL,      "loglevel",    CAT_BEHAVE, offsetof(global_vars,loglevel) },
     { LOGSTAMP,      "logstamp",    CAT_BEHAVE, offsetof(global_vars,logstamp) },
+    { MATRIX_POOL,   "matrix_pool", CAT_BEHAVE, offsetof(global_vars,matrix_pool) },
+    { GENR_JIT,      "jit",         CAT_BEHAVE, offsetof(global_vars,jit) },
+    { GRETL_PROFILE, "profile",     CAT_BEHAVE, offsetof(global_vars,profile) },
+    { RNG_PARALLEL,  "rng_parallel", CAT_RNG,   offsetof(global_vars,rng_parallel) },
+    { MEMSTATS,      "memstats",    CAT_BEHAVE, offsetof(global_vars,memstats) },
+    { GENR_STATS,    "genr_stats",  CAT_BEHAVE, offsetof(global_vars,genr_stats) },
+    { BLAS_STATS,    "blas_stats",  CAT_BEHAVE, offsetof(global_vars,blas_stats) },
+    { DETERMINISTIC, "deterministic", CAT_BEHAVE, offsetof(global_vars,deterministic) },
+    { GNUPLOT_PIPE,  "gnuplot_pipe", CAT_BEHAVE, offsetof(global_vars,gnuplot_pipe) },
     { CSV_DIGITS,    "csv_digits",  CAT_BEHAVE, offsetof(global_vars,csv_digits) },
     { HAC_MISSVALS,  "hac_missvals", CAT_BEHAVE, offsetof(global_vars,hac_missvals) },
     { NS_SMALL_INT_MAX, NULL },
@@ -231,6 +258,7 @@ setvar setvars[] = {
     /* delegated ints */
     { BLAS_MNK_MIN,  "blas_mnk_min", CAT_BEHAVE },
     { OMP_MNK_MIN,   "omp_mnk_min",  CAT_BEHAVE },
+    { OMP_GHK_MIN,   "omp_ghk_min",  CAT_BEHAVE },
     { OMP_N_THREADS, "omp_num_threads", CAT_SPECIAL },
     { SIMD_K_MAX,    "simd_k_max",  CAT_BEHAVE },
     { SIMD_MN_MIN,   "simd_mn_min", CAT_BEHAVE },
@@ -241,13 +269,19 @@ setvar setvars[] = {
     { VERBOSE,       "verbose",   CAT_SPECIAL },
     { SV_WORKDIR,    "workdir",   CAT_SPECIAL },
     { SV_LOGFILE,    "logfile",   CAT_SPECIAL },
+    { SV_TRACE,      "trace",     CAT_SPECIAL },
     { GRAPH_THEME,   "graph_theme", CAT_SPECIAL },
     { DISP_DIGITS,   "display_digits", CAT_SPECIAL },
-    { TEX_PLOT_OPTS, "tex_plot_opts", CAT_SPECIAL }
+    { TEX_PLOT_OPTS, "tex_plot_opts", CAT_SPECIAL },
+    { SV_PRELOAD,    "preload_plugins", CAT_SPECIAL }
 };
 
 #define libset_boolvar(k) (k < STATE_FLAG_MAX || k==R_FUNCTIONS || \
-			   k==R_LIB || k==LOGSTAMP)
+			   k==R_LIB || k==LOGSTAMP || k==MATRIX_POOL || \
+			   k==GENR_JIT || k==GRETL_PROFILE || \
+			   k==RNG_PARALLEL || k==MEMSTATS || \
+			   k==GENR_STATS || k==BLAS_STATS || \
+			   k==DETERMINISTIC || k==GNUPLOT_PIPE)
 #define libset_double(k) (k > STATE_INT_MAX && k < STATE_FLOAT_MAX)
 #define libset_int(k) ((k > STATE_FLAG_MAX && k < STATE_INT_MAX) || \
 		       (k > STATE_VARS_MAX && k < NS_INT_MAX))
@@ -273,8 +307,33 @@ setvar setvars[] = {
 			 k == LOGLEVEL || \
 			 k == HAC_MISSVALS)
 
-/* the current set of state variables */
-set_state *state;
+/* The current set of state variables is the top of a stack (see
+   push_program_state() below). Ordinarily there is one stack for
+   the whole program, but a thread that calls libset_thread_init()
+   gets a stack of its own; other threads see the program-wide
+   settings. OpenMP workers have no stack of their own, which is
+   why a thread with a stack runs its parallel regions alone (see
+   gretl_mt_thread_serial()).
+*/
+
+typedef struct set_stack_ set_stack;
+
+struct set_stack_ {
+    GPtrArray *states; /* allocated states */
+    int n;             /* number of allocated states */
+    int idx;           /* stack index of the current state */
+    set_state *cur;    /* the current state */
+};
+
+static set_stack main_stack = {NULL, 0, -1, NULL};
+static set_stack *thread_stack;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(thread_stack)
+#endif
+
+#define sstack (thread_stack != NULL ? thread_stack : &main_stack)
+#define state (sstack->cur)
 
 static const char *hac_lag_string (void);
 static int real_libset_read_script (const char *fname,
@@ -330,8 +389,9 @@ static setvar *get_setvar_by_name (const char *name)
 {
     setvar *ret = NULL;
 
-    if (svht == NULL) {
-	svht = libset_hash_init();
+    if (g_once_init_enter(&svht)) {
+	/* guard against concurrent first use by two threads */
+	g_once_init_leave(&svht, libset_hash_init());
     }
 
     ret = g_hash_table_lookup(svht, name);
@@ -562,7 +622,7 @@ static void state_vars_copy (set_state *sv)
 }
 
 static set_state default_state = {
-    ECHO_ON | MSGS_ON | WARNINGS | SKIP_MISSING, /* .flags */
+    ECHO_ON | MSGS_ON | WARNINGS | SKIP_MISSING | USE_AUTODIFF, /* .flags */
     OPTIM_AUTO,     /* .optim */
     NORM_PHILLIPS,  /* .vecm_norm */
     ML_UNSET,       /* .garch_vcv */
@@ -960,7 +1020,7 @@ static int negval_invalid (SetKey key)
 
     if (key > 0) {
 	if (key == BLAS_MNK_MIN || key == OMP_MNK_MIN ||
-	    key == SIMD_K_MAX || key == SIMD_MN_MIN) {
+	    key == OMP_GHK_MIN || key == SIMD_K_MAX || key == SIMD_MN_MIN) {
 	    /* these can all be set to -1 */
 	    ret = 0;
 	}
@@ -982,12 +1042,27 @@ static int libset_get_scalar (SetKey key, const char *arg,
     if (key == OMP_N_THREADS && !strcmp(arg, "default")) {
 #ifdef OPENMP_BUILD
         *pi = gretl_n_physical_cores();
+# ifdef HAVE_MPI
+        if (gretl_mpi_initialized()) {
+            /* share the cores among the MPI processes on this node */
+            *pi = *pi / gretl_mpi_node_size();
+            if (*pi < 1) {
+                *pi = 1;
+            }
+        }
+# endif
 #else
         *pi = 0;
 #endif
         return 0;
     }
 
+    if (key == BLAS_MNK_MIN && !strcmp(arg, "auto")) {
+        /* time native versus BLAS multiplication on this host */
+        *pi = gretl_matrix_tune_blas_mnk_min();
+        return 0;
+    }
+
     nstatus = libset_numeric_test(arg, pi, px);
 
     if (nstatus == NUMERIC_BAD) {
@@ -1271,6 +1346,10 @@ static int set_workdir (const char *s)
 static char *tex_plot_opts;
 static int tpo_depth = TPO_UNSET;
 
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(tex_plot_opts, tpo_depth)
+#endif
+
 static int set_tex_plot_opts (const char *arg)
 {
     int fd = gretl_function_depth();
@@ -1313,6 +1392,29 @@ const char *get_tex_plot_opts (void)
 
 /* end tex_plot_opts apparatus */
 
+/* "set preload_plugins": plugins are loaded process-wide, so
+   the record of what has been preloaded is global too */
+
+static gchar *preloaded;
+
+static int set_preload_plugins (const char *arg)
+{
+    int err = preload_plugins(arg);
+
+    if (!err) {
+	gchar *tmp = preloaded;
+
+	if (tmp == NULL) {
+	    preloaded = g_strdup(arg);
+	} else {
+	    preloaded = g_strdup_printf("%s,%s", tmp, arg);
+	    g_free(tmp);
+	}
+    }
+
+    return err;
+}
+
 static int set_logfile (const char *s)
 {
     int err = 0;
@@ -1505,6 +1607,8 @@ static int print_settings (PRN *prn, gretlopt opt)
 	pprintf(prn, " graph_theme = %s\n", get_plotstyle());
 	pprintf(prn, " tex_plot_opts = \"%s\"\n",
 		tex_plot_opts == NULL ? "null" : tex_plot_opts);
+	pprintf(prn, " preload_plugins = \"%s\"\n",
+		preloaded == NULL ? "" : preloaded);
     } else {
 	const char *dl = arg_from_delim(data_delim);
 
@@ -1516,6 +1620,9 @@ static int print_settings (PRN *prn, gretlopt opt)
 	pprintf(prn, "set graph_theme %s\n", get_plotstyle());
 	pprintf(prn, "set tex_plot_opts \"%s\"\n",
 		tex_plot_opts == NULL ? "null" : tex_plot_opts);
+	if (preloaded != NULL) {
+	    pprintf(prn, "set preload_plugins \"%s\"\n", preloaded);
+	}
     }
 
     print_vars_for_category(CAT_BEHAVE, prn, opt);
@@ -1625,6 +1732,9 @@ static int libset_query_settings (setvar *sv, PRN *prn)
     } else if (sv->key == TEX_PLOT_OPTS) {
 	pprintf(prn, "%s: string, currently \"%s\"\n", sv->name,
 		tex_plot_opts == NULL ? "null" : tex_plot_opts);
+    } else if (sv->key == SV_PRELOAD) {
+	pprintf(prn, "%s: string, currently \"%s\"\n", sv->name,
+		preloaded == NULL ? "" : preloaded);
     } else if (sv->key == VERBOSE) {
 	pprintf(prn, "%s: boolean (on/off), currently %s\n", sv->name,
 		(libset_get_bool(ECHO_ON) || libset_get_bool(MSGS_ON)) ?
@@ -1695,6 +1805,80 @@ static int check_set_bool (SetKey key, const char *name,
     }
 }
 
+/* "set profile off" prints the report on the profiling run */
+
+static int set_profiling (const char *arg, PRN *prn)
+{
+    int err;
+
+    if (gretl_function_depth() > 0) {
+	gretl_errmsg_sprintf("'%s': cannot be set inside a function",
+			     "profile");
+	return E_INVARG;
+    }
+
+    err = check_set_bool(GRETL_PROFILE, "profile", arg);
+    if (!err && !globals.profile) {
+	err = gretl_profile_report(prn);
+    }
+
+    return err;
+}
+
+/* "set memstats off" prints the memory accounting report */
+
+static int set_memstats (const char *arg, DATASET *dset, PRN *prn)
+{
+    int err = check_set_bool(MEMSTATS, "memstats", arg);
+
+    if (!err && !globals.memstats) {
+	err = gretl_memstats_report(dset, prn);
+    }
+
+    return err;
+}
+
+/* "set genr_stats off" prints the genr counters */
+
+static int set_genr_stats (const char *arg, PRN *prn)
+{
+    int err = check_set_bool(GENR_STATS, "genr_stats", arg);
+
+    if (!err && !globals.genr_stats) {
+	err = genr_stats_report(prn);
+    }
+
+    return err;
+}
+
+/* "set blas_stats off" prints the BLAS/LAPACK call counts */
+
+static int set_blas_stats (const char *arg, PRN *prn)
+{
+    int err = check_set_bool(BLAS_STATS, "blas_stats", arg);
+
+    if (!err && !globals.blas_stats) {
+	err = gretl_blasstats_report(prn);
+    }
+
+    return err;
+}
+
+/* "set trace <filename>" starts a timing trace, "set trace off"
+   completes it */
+
+static int set_trace (const char *s)
+{
+    if (gretl_function_depth() > 0) {
+	gretl_errmsg_set("set trace: cannot be done inside a function");
+	return E_DATA;
+    } else if (*s == '\0' || boolean_off(s)) {
+	return gretl_trace_stop();
+    } else {
+	return gretl_trace_start(s);
+    }
+}
+
 static int legacy_set_pcse (const char *arg)
 {
     int err = 0;
@@ -1807,6 +1991,8 @@ int execute_set (const char *setobj, const char *setarg,
 	    return set_workdir(setarg);
 	} else if (sv->key == SV_LOGFILE) {
 	    return set_logfile(setarg);
+	} else if (sv->key == SV_TRACE) {
+	    return set_trace(setarg);
 	} else if (sv->key == GRAPH_THEME) {
 	    return set_plotstyle(setarg);
 	} else if (sv->key == DISP_DIGITS) {
@@ -1815,12 +2001,24 @@ int execute_set (const char *setobj, const char *setarg,
 	    return set_verbosity(setarg);
 	} else if (sv->key == TEX_PLOT_OPTS) {
 	    return set_tex_plot_opts(setarg);
+	} else if (sv->key == SV_PRELOAD) {
+	    return set_preload_plugins(setarg);
+	} else if (sv->key == GRETL_PROFILE) {
+	    return set_profiling(setarg, prn);
+	} else if (sv->key == MEMSTATS) {
+	    return set_memstats(setarg, dset, prn);
+	} else if (sv->key == GENR_STATS) {
+	    return set_genr_stats(setarg, prn);
+	} else if (sv->key == BLAS_STATS) {
+	    return set_blas_stats(setarg, prn);
 	} else if (sv->key == OMP_MNK_MIN) {
 #if defined(_OPENMP)
 	    return set_omp_mnk_min(atoi(setarg));
 #else
 	    pprintf(prn, "Warning: openmp not supported\n");
 #endif
+	} else if (sv->key == OMP_GHK_MIN) {
+	    return set_omp_ghk_min(atoi(setarg));
 	}
 
 	if (libset_boolvar(sv->key)) {
@@ -1975,6 +2173,8 @@ int libset_get_int (SetKey key)
 	return gretl_get_omp_threads();
     } else if (key == OMP_MNK_MIN) {
 	return get_omp_mnk_min();
+    } else if (key == OMP_GHK_MIN) {
+	return get_omp_ghk_min();
     } else if (key == SIMD_K_MAX) {
 	return get_simd_k_max();
     } else if (key == SIMD_MN_MIN) {
@@ -2054,6 +2254,8 @@ int libset_set_int (SetKey key, int val)
 	set_simd_k_max(val);
     } else if (key == SIMD_MN_MIN) {
 	set_simd_mn_min(val);
+    } else if (key == OMP_GHK_MIN) {
+	err = set_omp_ghk_min(val);
     } else if (key == OMP_N_THREADS) {
 	err = gretl_set_omp_threads(val);
     } else {
@@ -2124,6 +2326,24 @@ int libset_get_bool (SetKey key)
 	return globals.R_lib;
     } else if (key == LOGSTAMP) {
 	return globals.logstamp;
+    } else if (key == MATRIX_POOL) {
+	return globals.matrix_pool;
+    } else if (key == GENR_JIT) {
+	return globals.jit;
+    } else if (key == GRETL_PROFILE) {
+	return globals.profile;
+    } else if (key == RNG_PARALLEL) {
+	return globals.rng_parallel;
+    } else if (key == MEMSTATS) {
+	return globals.memstats;
+    } else if (key == GENR_STATS) {
+	return globals.genr_stats;
+    } else if (key == BLAS_STATS) {
+	return globals.blas_stats;
+    } else if (key == DETERMINISTIC) {
+	return globals.deterministic;
+    } else if (key == GNUPLOT_PIPE) {
+	return globals.gnuplot_pipe;
     }
 
     if (check_for_state()) {
@@ -2256,6 +2476,62 @@ int libset_set_bool (SetKey key, int val)
     } else if (key == LOGSTAMP) {
 	globals.logstamp = val;
 	return 0;
+    } else if (key == MATRIX_POOL) {
+	globals.matrix_pool = val;
+	gretl_matrix_pool_set_enabled(val);
+	return 0;
+    } else if (key == GENR_JIT) {
+	if (val && get_plugin_function("genvm_jit_compile") == NULL) {
+	    gretl_error_clear();
+	    gretl_errmsg_sprintf(_("%s: not supported in this build of gretl"), "jit");
+	    return E_EXTERNAL;
+	}
+	globals.jit = val;
+	return 0;
+    } else if (key == GRETL_PROFILE) {
+	if (val && !globals.profile) {
+	    gretl_profile_start();
+	} else if (!val) {
+	    gretl_profile_stop();
+	}
+	globals.profile = val;
+	return 0;
+    } else if (key == RNG_PARALLEL) {
+	globals.rng_parallel = val;
+	gretl_rand_set_parallel(val);
+	return 0;
+    } else if (key == MEMSTATS) {
+	if (val && !globals.memstats) {
+	    gretl_memstats_start();
+	} else if (!val) {
+	    gretl_memstats_stop();
+	}
+	globals.memstats = val;
+	return 0;
+    } else if (key == GENR_STATS) {
+	globals.genr_stats = val;
+	genr_stats_set_enabled(val);
+	return 0;
+    } else if (key == BLAS_STATS) {
+	if (val && !globals.blas_stats) {
+	    gretl_blasstats_start();
+	} else if (!val) {
+	    gretl_blasstats_stop();
+	}
+	globals.blas_stats = val;
+	return 0;
+    } else if (key == DETERMINISTIC) {
+	if (val != globals.deterministic) {
+	    globals.deterministic = val;
+	    gretl_mt_set_deterministic(val);
+	}
+	return 0;
+    } else if (key == GNUPLOT_PIPE) {
+	if (!val) {
+	    gnuplot_pipe_close();
+	}
+	globals.gnuplot_pipe = val;
+	return 0;
     }
 
     if (val) {
@@ -2280,10 +2556,6 @@ int libset_set_bool (SetKey key, int val)
 
 #define PPDEBUG 0
 
-static int n_states;
-static GPtrArray *state_stack;
-static int state_idx = -1;
-
 #if PPDEBUG
 static void print_state_stack (int pop)
 {
@@ -2291,8 +2563,8 @@ static void print_state_stack (int pop)
     int i;
 
     fputs(pop ? "\nafter pop:\n" : "\nafter push:\n", stderr);
-    for (i=0; i<n_states; i++) {
-	sv = g_ptr_array_index(state_stack, i);
+    for (i=0; i<sstack->n; i++) {
+	sv = g_ptr_array_index(sstack->states, i);
 	fprintf(stderr, "%d: %p", i, (void *) sv);
 	fputs(sv == state ? " *\n" : "\n", stderr);
     }
@@ -2305,29 +2577,29 @@ int push_program_state (void)
     int err = 0;
 
 #if SVDEBUG
-    fprintf(stderr, "push_program_state: n_states = %d\n", n_states);
+    fprintf(stderr, "push_program_state: n = %d\n", sstack->n);
 #endif
 
-    if (n_states == 0) {
-	state_stack = g_ptr_array_new();
+    if (sstack->n == 0) {
+	sstack->states = g_ptr_array_new();
     }
 
-    state_idx++;
+    sstack->idx++;
 
-    if (state_idx < n_states) {
-	newstate = g_ptr_array_index(state_stack, state_idx);
+    if (sstack->idx < sstack->n) {
+	newstate = g_ptr_array_index(sstack->states, sstack->idx);
     } else {
 	newstate = malloc(sizeof *newstate);
 	if (newstate == NULL) {
 	    err = E_ALLOC;
 	} else {
-	    g_ptr_array_add(state_stack, newstate);
-	    n_states++;
+	    g_ptr_array_add(sstack->states, newstate);
+	    sstack->n++;
 	}
     }
 
     if (newstate != NULL) {
-	if (n_states == 1) {
+	if (sstack->n == 1) {
 	    state_vars_init(newstate);
 	} else {
 	    state_vars_copy(newstate);
@@ -2367,13 +2639,13 @@ int pop_program_state (void)
 {
     int err = 0;
 
-    if (n_states < 2) {
+    if (sstack->n < 2) {
 	err = 1;
     } else {
 	int fdp0, fdp = state->flags & FORCE_DECPOINT;
 
 	/* restore prior stack level */
-	state = g_ptr_array_index(state_stack, --state_idx);
+	state = g_ptr_array_index(sstack->states, --sstack->idx);
 
 	fdp0 = state->flags & FORCE_DECPOINT;
 	if (fdp0 != fdp) {
@@ -2414,25 +2686,31 @@ int libset_init (void)
 static char *looping;
 static int looplen;
 
-void libset_cleanup (void)
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(looping, looplen)
+#endif
+
+static void free_state_stack (set_stack *ss)
 {
     int i;
 
-#if PDEBUG
-    fprintf(stderr, "libset_cleanup called\n");
-#endif
+    for (i=0; i<ss->n; i++) {
+	free_state(g_ptr_array_index(ss->states, i));
+    }
 
-    for (i=0; i<n_states; i++) {
-	free_state(g_ptr_array_index(state_stack, i));
+    if (ss->states != NULL) {
+	g_ptr_array_free(ss->states, TRUE);
     }
+    ss->states = NULL;
+    ss->n = 0;
+    ss->idx = -1;
+    ss->cur = NULL;
+}
 
-    g_ptr_array_free(state_stack, TRUE);
-    state_stack = NULL;
-    n_states = 0;
-    state_idx = -1;
-
-    libset_hash_cleanup();
+/* free the settings-related items specific to the calling thread */
 
+static void libset_thread_items_cleanup (void)
+{
     free(tex_plot_opts);
     tex_plot_opts = NULL;
     tpo_depth = TPO_UNSET;
@@ -2442,6 +2720,80 @@ void libset_cleanup (void)
     looplen = 0;
 }
 
+void libset_cleanup (void)
+{
+#if PDEBUG
+    fprintf(stderr, "libset_cleanup called\n");
+#endif
+
+    free_state_stack(sstack);
+    libset_hash_cleanup();
+    libset_thread_items_cleanup();
+    g_free(preloaded);
+    preloaded = NULL;
+}
+
+/**
+ * libset_thread_init:
+ *
+ * Gives the calling thread a stack of program settings of its
+ * own, starting from a copy of the settings currently in force
+ * for the program as a whole. Thereafter "set" commands, and the
+ * pushing and popping of settings on function entry and exit, in
+ * this thread do not affect other threads. Called by
+ * libgretl_thread_init().
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int libset_thread_init (void)
+{
+    set_stack *ss;
+    set_state *sv;
+
+    if (thread_stack != NULL) {
+	return 0;
+    } else if (check_for_state()) {
+	return E_DATA;
+    }
+
+    ss = malloc(sizeof *ss);
+    sv = malloc(sizeof *sv);
+    if (ss == NULL || sv == NULL) {
+	free(ss);
+	free(sv);
+	return E_ALLOC;
+    }
+
+    state_vars_copy(sv);
+    ss->states = g_ptr_array_new();
+    g_ptr_array_add(ss->states, sv);
+    ss->n = 1;
+    ss->idx = 0;
+    ss->cur = sv;
+    thread_stack = ss;
+
+    return 0;
+}
+
+/**
+ * libset_thread_cleanup:
+ *
+ * Frees the settings stack set up by libset_thread_init() for
+ * the calling thread, which then reverts to the program-wide
+ * settings.
+ */
+
+void libset_thread_cleanup (void)
+{
+    if (thread_stack != NULL) {
+	free_state_stack(thread_stack);
+	free(thread_stack);
+	thread_stack = NULL;
+    }
+    libset_thread_items_cleanup();
+}
+
 /* switches for looping and batch mode: output: these depend on the
    state of the program calling libgretl, they are not user-settable
 */
@@ -2532,6 +2884,10 @@ int gretl_looping_currently (void)
 
 static int iter_depth;
 
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(iter_depth)
+#endif
+
 void gretl_iteration_push (void)
 {
     iter_depth++;
@@ -2664,18 +3020,33 @@ int show_activity_func_installed (void)
     return sfunc != NULL;
 }
 
+/* The callback is rate-limited, so it's OK to call this on each
+   iteration of a loop, however short: @sfunc is invoked at most
+   once per ACTIVITY_USEC microseconds.
+*/
+
+#define ACTIVITY_USEC 100000
+
 void show_activity_callback (void)
 {
+    static gint64 t_last;
+
     if (sfunc != NULL) {
-	(*sfunc)();
+	gint64 t = g_get_monotonic_time();
+
+	if (t - t_last >= ACTIVITY_USEC) {
+	    (*sfunc)();
+	    t_last = g_get_monotonic_time();
+	}
     }
 }
 
 /* Support for the GUI "Stop" button, to terminate execution
-   of a long-running script.
+   of a long-running script. The flag may also be set from a
+   signal handler, hence its type.
 */
 
-static int user_stop;
+static volatile sig_atomic_t user_stop;
 
 void set_user_stop (int s)
 {
@@ -2687,6 +3058,77 @@ int get_user_stop (void)
     return user_stop;
 }
 
+/* Support for progress reporting and cancellation of long-running
+   computations, for the benefit of the command-line program and
+   other users of libgretl: the main iteration loops of such
+   computations call gretl_progress(), which passes on the state
+   of progress to a callback, if one is installed, and tells the
+   caller whether to give up.
+*/
+
+#define PROGRESS_INTERVAL 200000 /* microseconds */
+
+static PROGRESS_FUNC pfunc;
+static void *pfunc_data;
+static gint64 ptime;
+
+/**
+ * set_progress_func:
+ * @func: callback, or NULL to remove the current one.
+ * @data: pointer to be passed to @func.
+ *
+ * Installs a callback to be notified of the progress of
+ * long-running computations. It receives a short description of
+ * the task, the amount of work done so far, the total amount (or
+ * 0 if this is not known) and @data; if it returns non-zero the
+ * computation is abandoned and execution stops as if set_user_stop()
+ * had been called.
+ */
+
+void set_progress_func (PROGRESS_FUNC func, void *data)
+{
+    pfunc = func;
+    pfunc_data = data;
+    ptime = 0;
+}
+
+/**
+ * gretl_progress:
+ * @task: short description of the computation.
+ * @done: amount of work done so far.
+ * @total: total amount of work, or 0 if not known.
+ *
+ * To be called from the main iteration loop of a long-running
+ * computation. The progress callback, if any, is invoked at the
+ * start and end of the task (@done equal to 0 or @total) and
+ * otherwise no more often than every 0.2 seconds.
+ *
+ * Returns: %E_STOP if the computation should be abandoned,
+ * otherwise 0.
+ */
+
+int gretl_progress (const char *task, double done, double total)
+{
+    if (user_stop) {
+	return E_STOP;
+    }
+
+    if (pfunc != NULL) {
+	gint64 now = g_get_monotonic_time();
+
+	if (done == 0 || (total > 0 && done >= total) ||
+	    now - ptime >= PROGRESS_INTERVAL) {
+	    ptime = now;
+	    if ((*pfunc)(task, done, total, pfunc_data)) {
+		user_stop = 1;
+		return E_STOP;
+	    }
+	}
+    }
+
+    return 0;
+}
+
 /* internal: set the value of a string-valued "setvar" */
 
 static int set_string_setvar (char *targ, const char *s, int len)
@@ -2859,3 +3301,96 @@ int libset_read_script (const char *fname)
 {
     return real_libset_read_script(fname, NULL);
 }
+
+/* Per-host persistence of the performance thresholds found by
+   libset_autotune(). These are kept in the dotdir, in a file
+   named for the host since the dotdir may be shared by machines
+   of different kinds, in the form of "set" commands.
+*/
+
+static gchar *tuning_filename (void)
+{
+    return g_strdup_printf("%stuning-%s.inp", gretl_dotdir(),
+			   g_get_host_name());
+}
+
+/**
+ * libset_autotune:
+ * @prn: printing struct.
+ *
+ * Runs short calibration kernels to find the crossover points
+ * at which matrix operations should be handed off to the BLAS,
+ * to OpenMP and to the SIMD kernels on the host machine, sets
+ * the corresponding thresholds, and saves them for loading by
+ * subsequent gretl sessions on the same host.
+ *
+ * Returns: 0 on success, non-zero code on failure to save the
+ * values found.
+ */
+
+int libset_autotune (PRN *prn)
+{
+    int simd_err, omp = 0;
+    gchar *fname;
+    PRN *fprn;
+    int err = 0;
+
+    pputs(prn, _("Timing calibration kernels, please wait...\n"));
+
+    gretl_matrix_tune_blas_mnk_min();
+#if defined(_OPENMP)
+    gretl_matrix_tune_omp_mnk_min();
+    omp = gretl_get_omp_threads() > 1;
+#endif
+    simd_err = gretl_matrix_tune_simd();
+
+    pprintf(prn, " blas_mnk_min = %d\n", get_blas_mnk_min());
+    if (omp) {
+	pprintf(prn, " omp_mnk_min = %d\n", get_omp_mnk_min());
+    }
+    if (!simd_err) {
+	pprintf(prn, " simd_k_max = %d\n", get_simd_k_max());
+	pprintf(prn, " simd_mn_min = %d\n", get_simd_mn_min());
+    }
+
+    fname = tuning_filename();
+    fprn = gretl_print_new_with_filename(fname, &err);
+
+    if (!err) {
+	pprintf(fprn, "# performance thresholds for %s (gretl %s)\n",
+		g_get_host_name(), GRETL_VERSION);
+	pprintf(fprn, "set blas_mnk_min %d\n", get_blas_mnk_min());
+	if (omp) {
+	    pprintf(fprn, "set omp_mnk_min %d\n", get_omp_mnk_min());
+	}
+	if (!simd_err) {
+	    pprintf(fprn, "set simd_k_max %d\n", get_simd_k_max());
+	    pprintf(fprn, "set simd_mn_min %d\n", get_simd_mn_min());
+	}
+	gretl_print_destroy(fprn);
+	pprintf(prn, _("Saved to %s\n"), fname);
+    }
+
+    g_free(fname);
+
+    return err;
+}
+
+/* Called once the user's dotdir is known: apply any thresholds
+   saved by libset_autotune() for this host.
+*/
+
+void libset_load_tuning (void)
+{
+    static int done;
+
+    if (!done) {
+	gchar *fname = tuning_filename();
+
+	if (gretl_stat(fname, NULL) == 0) {
+	    libset_read_script(fname);
+	}
+	g_free(fname);
+	done = 1;
+    }
+}
@@ -68,7 +68,9 @@ typedef enum {
     MWRITE_G        = 1 << 13, /* use %g format with mwrite() */
     MPI_USE_SMT     = 1 << 14, /* MPI: use hyperthreads by default */
     BS_ESCAPE       = 1 << 15, /* backslash escapes in string literals */
-    STATE_FLAG_MAX  = 1 << 16, /* separator */
+    USE_AUTODIFF    = 1 << 16, /* automatic gradients for BFGSmax etc. */
+    BFGS_WARM       = 1 << 17, /* warm-start BFGS from the previous run */
+    STATE_FLAG_MAX  = 1 << 18, /* separator */
     /* state small int (but non-boolean) vars */
     GRETL_OPTIM,
     VECM_NORM,
@@ -120,6 +122,15 @@ typedef enum {
     R_LIB,
     LOGLEVEL,
     LOGSTAMP,
+    MATRIX_POOL,
+    GENR_JIT,
+    GRETL_PROFILE,
+    RNG_PARALLEL,
+    MEMSTATS,
+    GENR_STATS,
+    BLAS_STATS,
+    DETERMINISTIC,
+    GNUPLOT_PIPE,
     CSV_DIGITS,
     HAC_MISSVALS,
     NS_SMALL_INT_MAX, /* separator */
@@ -127,6 +138,7 @@ typedef enum {
     NS_MAX, /* separator */
     BLAS_MNK_MIN,
     OMP_MNK_MIN,
+    OMP_GHK_MIN,
     OMP_N_THREADS,
     SIMD_K_MAX,
     SIMD_MN_MIN,
@@ -137,18 +149,24 @@ typedef enum {
     VERBOSE,
     SV_WORKDIR,
     SV_LOGFILE,
+    SV_TRACE,
     GRAPH_THEME,
     DISP_DIGITS,
     TEX_PLOT_OPTS,
+    SV_PRELOAD,
     SETVAR_MAX /* sentinel */
 } SetKey;
 
 typedef void (*SHOW_ACTIVITY_FUNC) (void);
+typedef int (*PROGRESS_FUNC) (const char *task, double done,
+			      double total, void *data);
 
 #define set_nls_toler(x) (libset_set_double(NLS_TOLER, x))
 
 int libset_init (void);
 void libset_cleanup (void);
+int libset_thread_init (void);
+void libset_thread_cleanup (void);
 
 int push_program_state (void);
 int pop_program_state (void);
@@ -253,11 +271,18 @@ int show_activity_func_installed (void);
 void set_user_stop (int s);
 int get_user_stop (void);
 
+void set_progress_func (PROGRESS_FUNC func, void *data);
+int gretl_progress (const char *task, double done, double total);
+
 void set_workdir_callback (int (*callback)(char *s));
 
 int libset_write_script (const char *fname);
 int libset_read_script (const char *fname);
 
+int libset_autotune (PRN *prn);
+
+void libset_load_tuning (void);
+
 #ifdef  __cplusplus
 }
 #endif
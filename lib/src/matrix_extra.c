@@ -23,6 +23,7 @@
 #include "gretl_cmatrix.h"
 #include "matrix_extra.h"
 #include "swap_bytes.h"
+#include "gretl_binio.h"
 
 #ifdef WIN32
 # include "gretl_win32.h"
@@ -1257,6 +1258,38 @@ static gretl_matrix *read_binary_matrix_file (FILE *fp, int *err)
     return A;
 }
 
+/**
+ * gretl_matrix_read_member:
+ * @fname: full name of file.
+ * @name: name of matrix.
+ * @err: location to receive error code.
+ *
+ * Reads the matrix named @name from @fname, which must be in
+ * gretl's binary format, as written by bwrite() or mwrite() with
+ * the ".bin" suffix. Only the directory of the file and the
+ * matrix itself are read.
+ *
+ * Returns: The matrix as read from file, or NULL.
+ */
+
+gretl_matrix *gretl_matrix_read_member (const char *fname,
+					const char *name,
+					int *err)
+{
+    char fullname[FILENAME_MAX];
+
+    strcpy(fullname, fname);
+    gretl_maybe_prepend_dir(fullname);
+
+    if (!gretl_is_bin_file(fullname)) {
+	gretl_errmsg_sprintf(_("%s: not a valid gretl binary file"), fname);
+	*err = E_DATA;
+	return NULL;
+    }
+
+    return gretl_bin_read_matrix(fullname, name, err);
+}
+
 #ifndef WIN32
 
 /* In reading matrices, accept "NA" and "." (Stata) for NaN? */
@@ -1338,7 +1371,11 @@ gretl_matrix *gretl_matrix_read_from_file (const char *fname,
 	return NULL;
     }
 
-    if (bin) {
+    if (bin && gretl_is_bin_file(fullname)) {
+	fclose(fp);
+	return gretl_bin_read_matrix(fullname, NULL, err);
+    } else if (bin) {
+	/* the original binary format */
 	return read_binary_matrix_file(fp, err);
     }
 
@@ -1711,7 +1748,7 @@ real_matrix_print_to_prn (const gretl_matrix *m,
     int mt1 = 0, mt2 = 0;
     int i, j;
 
-    if (prn == NULL) {
+    if (gretl_print_is_null(prn)) {
 	return;
     }
 
@@ -2022,7 +2059,7 @@ void gretl_matrix_print_with_format (const gretl_matrix *m,
 				     int wid, int prec,
 				     PRN *prn)
 {
-    if (prn == NULL) {
+    if (gretl_print_is_null(prn)) {
 	return;
     }
 
@@ -2075,6 +2112,13 @@ void gretl_matrix_print_with_format (const gretl_matrix *m,
 	    if (rownames != NULL) {
 		pprintf(prn, "%*s ", llen, rownames[i]);
 	    }
+	    if (!intcast && intcols == NULL) {
+		/* all-doubles row: print in bulk */
+		pprint_doubles(prn, xfmt, wid, prec, m->val + i,
+			       m->cols, m->rows);
+		pputc(prn, '\n');
+		continue;
+	    }
 	    for (j=0; j<m->cols; j++) {
 		x = gretl_matrix_get(m, i, j);
 		if (intcols != NULL) {
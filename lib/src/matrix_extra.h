@@ -102,6 +102,10 @@ int gretl_plotfit_matrices (const double *yvar, const double *xvar,
 gretl_matrix *gretl_matrix_read_from_file (const char *fname, 
 					   int import, int *err);
 
+gretl_matrix *gretl_matrix_read_member (const char *fname,
+					const char *name,
+					int *err);
+
 int gretl_matrix_write_to_file (gretl_matrix *A, const char *fname,
 				int use_dotdir);
 
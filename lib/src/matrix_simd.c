@@ -17,26 +17,75 @@
  *
  */
 
-/* All code here is conditional on AVX (128-bit SSE is not really
-   worth the bother when working with doubles)
+/* SIMD kernels for elementwise matrix arithmetic (real and
+   complex) and small matrix multiplication. On x86 (128-bit SSE
+   is not really worth the bother when working with doubles) we
+   supply AVX, AVX2/FMA and AVX-512 variants. When the compiler
+   supports per-function target attributes these are all built
+   regardless of the -m flags in force, and the variant to use is
+   selected at runtime by probing the CPU, so a single binary can
+   run on any x86_64 machine. On aarch64 we use NEON, which is
+   part of the base architecture.
 */
 
 #define SHOW_SIMD 0
 
-static int gretl_matrix_simd_add_to (gretl_matrix *a,
-				     const gretl_matrix *b,
-				     int n)
+#if defined(SIMD_X86_DISPATCH)
+# define TARGET_AVX    __attribute__((target("avx")))
+# define TARGET_AVX2   __attribute__((target("avx2,fma")))
+# define TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+# define TARGET_AVX
+#endif
+
+typedef struct simd_kernels_ simd_kernels;
+
+struct simd_kernels_ {
+    const char *id;
+    void (*add_to) (double *ax, const double *bx, int n);
+    void (*subt_from) (double *ax, const double *bx, int n);
+    void (*add) (const double *ax, const double *bx, double *cx, int n);
+    void (*subtract) (const double *ax, const double *bx, double *cx, int n);
+    void (*scalar_mul) (double *mx, double x, int n);
+    double (*dot) (const double *ax, const double *bx, int n);
+    void (*mul) (const gretl_matrix *A, const gretl_matrix *B,
+		 gretl_matrix *C);
+    /* complex kernels: the arrays hold @n complex values as
+       interleaved real and imaginary parts */
+    void (*zmul) (const double *ax, const double *bx, double *cx, int n);
+    void (*zscale) (const double *ax, const double *s, double *cx,
+		    int n, int add);
+};
+
+/* Complex product of the single values at @a and @b, written to
+   (or, if @add is non-zero, added to) @c: used for remainders.
+*/
+
+static inline void zmul_one (const double *a, const double *b,
+			     double *c, int add)
+{
+    double re = a[0]*b[0] - a[1]*b[1];
+    double im = a[0]*b[1] + a[1]*b[0];
+
+    if (add) {
+	c[0] += re;
+	c[1] += im;
+    } else {
+	c[0] = re;
+	c[1] = im;
+    }
+}
+
+#if defined(USE_AVX) || defined(SIMD_X86_DISPATCH)
+
+/* AVX: 4 doubles per register */
+
+TARGET_AVX
+static void avx_add_to (double *ax, const double *bx, int n)
 {
-    double *ax = a->val;
-    const double *bx = b->val;
     int i, imax = n / 4;
     int rem = n % 4;
 
-#if SHOW_SIMD
-    fprintf(stderr, "AVX: gretl_matrix_simd_add_to (%d x %d)\n",
-	    a->rows, a->cols);
-#endif
-
     for (i=0; i<imax; i++) {
 	/* add 4 doubles in parallel */
 	__m256d Ymm_A = _mm256_loadu_pd(ax);
@@ -51,24 +100,14 @@ static int gretl_matrix_simd_add_to (gretl_matrix *a,
     for (i=0; i<rem; i++) {
 	ax[i] += bx[i];
     }
-
-    return 0;
 }
 
-static int gretl_matrix_simd_subt_from (gretl_matrix *a,
-					const gretl_matrix *b,
-					int n)
+TARGET_AVX
+static void avx_subt_from (double *ax, const double *bx, int n)
 {
-    double *ax = a->val;
-    const double *bx = b->val;
     int i, imax = n / 4;
     int rem = n % 4;
 
-#if SHOW_SIMD
-    fprintf(stderr, "AVX: gretl_matrix_simd_subt_from (%d x %d, rem=%d)\n",
-	    a->rows, a->cols, rem);
-#endif
-
     for (i=0; i<imax; i++) {
 	/* subtract 4 doubles in parallel */
 	__m256d Ymm_A = _mm256_loadu_pd(ax);
@@ -83,22 +122,15 @@ static int gretl_matrix_simd_subt_from (gretl_matrix *a,
     for (i=0; i<rem; i++) {
 	ax[i] -= bx[i];
     }
-
-    return 0;
 }
 
-static int gretl_matrix_simd_add (const double *ax,
-				  const double *bx,
-				  double *cx,
-				  int n)
+TARGET_AVX
+static void avx_add (const double *ax, const double *bx,
+		     double *cx, int n)
 {
     int i, imax = n / 4;
     int rem = n % 4;
 
-#if SHOW_SIMD
-    fprintf(stderr, "AVX: gretl_matrix_simd_add (n = %d\n", n);
-#endif
-
     for (i=0; i<imax; i++) {
 	/* process 4 doubles in parallel */
 	__m256d Ymm_A = _mm256_loadu_pd(ax);
@@ -114,23 +146,15 @@ static int gretl_matrix_simd_add (const double *ax,
     for (i=0; i<rem; i++) {
 	cx[i] = ax[i] + bx[i];
     }
-
-    return 0;
 }
 
-static int gretl_matrix_simd_subtract (const double *ax,
-				       const double *bx,
-				       double *cx,
-				       int n)
+TARGET_AVX
+static void avx_subtract (const double *ax, const double *bx,
+			  double *cx, int n)
 {
     int i, imax = n / 4;
     int rem = n % 4;
 
-#if SHOW_SIMD
-    fprintf(stderr, "AVX: gretl_matrix_simd_subtract (n = %d, rem = %d)\n",
-	    n, rem);
-#endif
-
     for (i=0; i<imax; i++) {
 	/* process 4 doubles in parallel */
 	__m256d Ymm_A = _mm256_loadu_pd(ax);
@@ -146,15 +170,14 @@ static int gretl_matrix_simd_subtract (const double *ax,
     for (i=0; i<rem; i++) {
 	cx[i] = ax[i] - bx[i];
     }
-
-    return 0;
 }
 
 /* very fast but restrictive: both A and B must be 4 x 4 */
 
-static int gretl_matrix_avx_mul4 (const double *aval,
-				  const double *bval,
-				  double *cval)
+TARGET_AVX
+static void avx_mul4 (const double *aval,
+		      const double *bval,
+		      double *cval)
 {
     __m256d b1, b2, b3, b4;
     __m256d mul, col;
@@ -183,15 +206,14 @@ static int gretl_matrix_avx_mul4 (const double *aval,
 
 	_mm256_storeu_pd(&cval[4*j], col);
     }
-
-    return 0;
 }
 
 /* very fast but restrictive: both A and B must be 8 x 8 */
 
-static int gretl_matrix_avx_mul8 (const double *aval,
-				  const double *bval,
-				  double *cval)
+TARGET_AVX
+static void avx_mul8 (const double *aval,
+		      const double *bval,
+		      double *cval)
 {
     __m256d a1, a2, a3, a4, a5, a6, a7, a8;
     __m256d b1, b2, b3, b4, b5, b6, b7, b8;
@@ -241,8 +263,6 @@ static int gretl_matrix_avx_mul8 (const double *aval,
 	aval += 4;
 	cval += 4;
     }
-
-    return 0;
 }
 
 /* Note: this is probably usable only for k <= 8 (shortage of AVX
@@ -250,9 +270,10 @@ static int gretl_matrix_avx_mul8 (const double *aval,
    unconstrained.
 */
 
-static int gretl_matrix_simd_mul (const gretl_matrix *A,
-				  const gretl_matrix *B,
-				  gretl_matrix *C)
+TARGET_AVX
+static void avx_mul (const gretl_matrix *A,
+		     const gretl_matrix *B,
+		     gretl_matrix *C)
 {
     int m = A->rows;
     int n = B->cols;
@@ -263,16 +284,17 @@ static int gretl_matrix_simd_mul (const gretl_matrix *A,
     int hmax, hrem, i, j;
 
 #if SHOW_SIMD
-    fprintf(stderr, "AVX: gretl_matrix_simd_mul (MNK = %d, %d, %d)\n",
-	    m, n, k);
+    fprintf(stderr, "AVX: simd_mul (MNK = %d, %d, %d)\n", m, n, k);
 #endif
 
     if (m == 4 && n == 4 && k == 4) {
-	return gretl_matrix_avx_mul4(aval, bval, cval);
+	avx_mul4(aval, bval, cval);
+	return;
     }
 
     if (m == 8 && n == 8 && k == 8) {
-	return gretl_matrix_avx_mul8(aval, bval, cval);
+	avx_mul8(aval, bval, cval);
+	return;
     }
 
     hmax = m / 4;
@@ -350,8 +372,6 @@ static int gretl_matrix_simd_mul (const gretl_matrix *A,
 	    cval[m*j] = ccol;
 	}
     }
-
-    return 0;
 }
 
 /* See https://stackoverflow.com/questions/49941645,
@@ -359,6 +379,7 @@ static int gretl_matrix_simd_mul (const gretl_matrix *A,
    contents of an __m256d into a single double.
 */
 
+TARGET_AVX
 static inline double hsum_double_avx (__m256d v)
 {
     __m128d vlow  = _mm256_castpd256_pd128(v);
@@ -370,13 +391,10 @@ static inline double hsum_double_avx (__m256d v)
     return  _mm_cvtsd_f64(_mm_add_sd(vlow, high64));
 }
 
-double gretl_vector_simd_dot_product (const gretl_vector *a,
-				      const gretl_vector *b)
+TARGET_AVX
+static double avx_dot (const double *ax, const double *bx, int n)
 {
     __m256d Ymm_A, Ymm_B, Ymm_C;
-    const double *ax = a->val;
-    const double *bx = b->val;
-    int n = gretl_vector_get_length(a);
     int i, imax = n / 4;
     int rem = n % 4;
     double ret = 0.0;
@@ -398,7 +416,8 @@ double gretl_vector_simd_dot_product (const gretl_vector *a,
     return ret;
 }
 
-void gretl_matrix_simd_scalar_mul (double *mx, double x, int n)
+TARGET_AVX
+static void avx_scalar_mul (double *mx, double x, int n)
 {
     __m256d mxi, mul, res;
     int i, imax = n / 4;
@@ -418,3 +437,635 @@ void gretl_matrix_simd_scalar_mul (double *mx, double x, int n)
 	mx[i] *= x;
     }
 }
+
+/* Complex multiplication, 2 complex values per register: with
+   x = (a, b) and y = (c, d), x*y = (ac - bd, ad + bc), which we
+   get by multiplying x by (c, c) and the swapped x, (b, a), by
+   (d, d), then combining the two products via addsub.
+*/
+
+TARGET_AVX
+static void avx_zmul (const double *ax, const double *bx,
+		      double *cx, int n)
+{
+    __m256d x, y, t;
+    int i, imax = n / 2;
+
+    for (i=0; i<imax; i++) {
+	x = _mm256_loadu_pd(ax);
+	y = _mm256_loadu_pd(bx);
+	t = _mm256_mul_pd(_mm256_permute_pd(x, 0x5),
+			  _mm256_permute_pd(y, 0xf));
+	x = _mm256_mul_pd(x, _mm256_movedup_pd(y));
+	_mm256_storeu_pd(cx, _mm256_addsub_pd(x, t));
+	ax += 4;
+	bx += 4;
+	cx += 4;
+    }
+
+    if (n % 2) {
+	zmul_one(ax, bx, cx, 0);
+    }
+}
+
+/* complex @s times @ax, written to or added to @cx */
+
+TARGET_AVX
+static void avx_zscale (const double *ax, const double *s,
+			double *cx, int n, int add)
+{
+    __m256d sr = _mm256_broadcast_sd(s);
+    __m256d si = _mm256_broadcast_sd(s + 1);
+    __m256d x, t;
+    int i, imax = n / 2;
+
+    for (i=0; i<imax; i++) {
+	x = _mm256_loadu_pd(ax);
+	t = _mm256_mul_pd(_mm256_permute_pd(x, 0x5), si);
+	x = _mm256_addsub_pd(_mm256_mul_pd(x, sr), t);
+	if (add) {
+	    x = _mm256_add_pd(x, _mm256_loadu_pd(cx));
+	}
+	_mm256_storeu_pd(cx, x);
+	ax += 4;
+	cx += 4;
+    }
+
+    if (n % 2) {
+	zmul_one(ax, s, cx, add);
+    }
+}
+
+static const simd_kernels avx_kernels = {
+    "avx",
+    avx_add_to,
+    avx_subt_from,
+    avx_add,
+    avx_subtract,
+    avx_scalar_mul,
+    avx_dot,
+    avx_mul,
+    avx_zmul,
+    avx_zscale
+};
+
+#endif /* USE_AVX or SIMD_X86_DISPATCH */
+
+#if defined(SIMD_X86_DISPATCH)
+
+/* AVX2 plus FMA: the elementwise kernels are as for AVX, but
+   the multiplication and dot-product kernels can use fused
+   multiply-add.
+*/
+
+TARGET_AVX2
+static void avx2_mul (const gretl_matrix *A,
+		      const gretl_matrix *B,
+		      gretl_matrix *C)
+{
+    int m = A->rows;
+    int n = B->cols;
+    int k = A->cols;
+    const double *aval = A->val;
+    const double *bval = B->val;
+    double *cval = C->val;
+    int hmax = m / 4;
+    int hrem = m % 4;
+    int h, i, j;
+
+#if SHOW_SIMD
+    fprintf(stderr, "AVX2: simd_mul (MNK = %d, %d, %d)\n", m, n, k);
+#endif
+
+    if (m >= 4) {
+	__m256d a[k];
+	__m256d ccol;
+
+	for (h=0; h<hmax; h++) {
+	    for (j=0; j<k; j++) {
+		a[j] = _mm256_loadu_pd(aval + j*m);
+	    }
+	    for (j=0; j<n; j++) {
+		const double *bj = bval + j*k;
+
+		ccol = _mm256_mul_pd(_mm256_broadcast_sd(bj), a[0]);
+		for (i=1; i<k; i++) {
+		    ccol = _mm256_fmadd_pd(_mm256_broadcast_sd(bj + i),
+					   a[i], ccol);
+		}
+		_mm256_storeu_pd(&cval[m*j], ccol);
+	    }
+	    aval += 4;
+	    cval += 4;
+	}
+    }
+
+    if (hrem >= 2) {
+	__m128d a[k];
+	__m128d ccol;
+
+	for (j=0; j<k; j++) {
+	    a[j] = _mm_loadu_pd(aval + j*m);
+	}
+	for (j=0; j<n; j++) {
+	    ccol = _mm_mul_pd(_mm_set1_pd(bval[j*k]), a[0]);
+	    for (i=1; i<k; i++) {
+		ccol = _mm_fmadd_pd(_mm_set1_pd(bval[j*k + i]), a[i], ccol);
+	    }
+	    _mm_storeu_pd(&cval[m*j], ccol);
+	}
+	hrem -= 2;
+	aval += 2;
+	cval += 2;
+    }
+
+    if (hrem) {
+	double ccol;
+
+	for (j=0; j<n; j++) {
+	    ccol = 0.0;
+	    for (i=0; i<k; i++) {
+		ccol += bval[j*k + i] * aval[i*m];
+	    }
+	    cval[m*j] = ccol;
+	}
+    }
+}
+
+TARGET_AVX2
+static double avx2_dot (const double *ax, const double *bx, int n)
+{
+    __m256d acc = _mm256_setzero_pd();
+    __m128d vlow, vhigh;
+    int i, imax = n / 4;
+    int rem = n % 4;
+    double ret;
+
+    for (i=0; i<imax; i++) {
+	acc = _mm256_fmadd_pd(_mm256_loadu_pd(ax), _mm256_loadu_pd(bx), acc);
+	ax += 4;
+	bx += 4;
+    }
+
+    /* horizontal sum, done once at the end */
+    vlow  = _mm256_castpd256_pd128(acc);
+    vhigh = _mm256_extractf128_pd(acc, 1);
+    vlow  = _mm_add_pd(vlow, vhigh);
+    ret = _mm_cvtsd_f64(_mm_add_sd(vlow, _mm_unpackhi_pd(vlow, vlow)));
+
+    for (i=0; i<rem; i++) {
+	ret += ax[i] * bx[i];
+    }
+
+    return ret;
+}
+
+/* complex kernels as for AVX, with fmaddsub */
+
+TARGET_AVX2
+static void avx2_zmul (const double *ax, const double *bx,
+		       double *cx, int n)
+{
+    __m256d x, y, t;
+    int i, imax = n / 2;
+
+    for (i=0; i<imax; i++) {
+	x = _mm256_loadu_pd(ax);
+	y = _mm256_loadu_pd(bx);
+	t = _mm256_mul_pd(_mm256_permute_pd(x, 0x5),
+			  _mm256_permute_pd(y, 0xf));
+	_mm256_storeu_pd(cx, _mm256_fmaddsub_pd(x, _mm256_movedup_pd(y), t));
+	ax += 4;
+	bx += 4;
+	cx += 4;
+    }
+
+    if (n % 2) {
+	zmul_one(ax, bx, cx, 0);
+    }
+}
+
+TARGET_AVX2
+static void avx2_zscale (const double *ax, const double *s,
+			 double *cx, int n, int add)
+{
+    __m256d sr = _mm256_broadcast_sd(s);
+    __m256d si = _mm256_broadcast_sd(s + 1);
+    __m256d x, t;
+    int i, imax = n / 2;
+
+    for (i=0; i<imax; i++) {
+	x = _mm256_loadu_pd(ax);
+	t = _mm256_mul_pd(_mm256_permute_pd(x, 0x5), si);
+	x = _mm256_fmaddsub_pd(x, sr, t);
+	if (add) {
+	    x = _mm256_add_pd(x, _mm256_loadu_pd(cx));
+	}
+	_mm256_storeu_pd(cx, x);
+	ax += 4;
+	cx += 4;
+    }
+
+    if (n % 2) {
+	zmul_one(ax, s, cx, add);
+    }
+}
+
+static const simd_kernels avx2_kernels = {
+    "avx2",
+    avx_add_to,
+    avx_subt_from,
+    avx_add,
+    avx_subtract,
+    avx_scalar_mul,
+    avx2_dot,
+    avx2_mul,
+    avx2_zmul,
+    avx2_zscale
+};
+
+/* AVX-512: 8 doubles per register, with masked loads and stores
+   taking care of the remainder.
+*/
+
+TARGET_AVX512
+static void avx512_add_to (double *ax, const double *bx, int n)
+{
+    int i, imax = n / 8;
+    __mmask8 mask = (__mmask8) ((1 << (n % 8)) - 1);
+
+    for (i=0; i<imax; i++) {
+	_mm512_storeu_pd(ax, _mm512_add_pd(_mm512_loadu_pd(ax),
+					   _mm512_loadu_pd(bx)));
+	ax += 8;
+	bx += 8;
+    }
+    if (mask) {
+	__m512d A = _mm512_maskz_loadu_pd(mask, ax);
+	__m512d B = _mm512_maskz_loadu_pd(mask, bx);
+
+	_mm512_mask_storeu_pd(ax, mask, _mm512_add_pd(A, B));
+    }
+}
+
+TARGET_AVX512
+static void avx512_subt_from (double *ax, const double *bx, int n)
+{
+    int i, imax = n / 8;
+    __mmask8 mask = (__mmask8) ((1 << (n % 8)) - 1);
+
+    for (i=0; i<imax; i++) {
+	_mm512_storeu_pd(ax, _mm512_sub_pd(_mm512_loadu_pd(ax),
+					   _mm512_loadu_pd(bx)));
+	ax += 8;
+	bx += 8;
+    }
+    if (mask) {
+	__m512d A = _mm512_maskz_loadu_pd(mask, ax);
+	__m512d B = _mm512_maskz_loadu_pd(mask, bx);
+
+	_mm512_mask_storeu_pd(ax, mask, _mm512_sub_pd(A, B));
+    }
+}
+
+TARGET_AVX512
+static void avx512_add (const double *ax, const double *bx,
+			double *cx, int n)
+{
+    int i, imax = n / 8;
+    __mmask8 mask = (__mmask8) ((1 << (n % 8)) - 1);
+
+    for (i=0; i<imax; i++) {
+	_mm512_storeu_pd(cx, _mm512_add_pd(_mm512_loadu_pd(ax),
+					   _mm512_loadu_pd(bx)));
+	ax += 8;
+	bx += 8;
+	cx += 8;
+    }
+    if (mask) {
+	__m512d A = _mm512_maskz_loadu_pd(mask, ax);
+	__m512d B = _mm512_maskz_loadu_pd(mask, bx);
+
+	_mm512_mask_storeu_pd(cx, mask, _mm512_add_pd(A, B));
+    }
+}
+
+TARGET_AVX512
+static void avx512_subtract (const double *ax, const double *bx,
+			     double *cx, int n)
+{
+    int i, imax = n / 8;
+    __mmask8 mask = (__mmask8) ((1 << (n % 8)) - 1);
+
+    for (i=0; i<imax; i++) {
+	_mm512_storeu_pd(cx, _mm512_sub_pd(_mm512_loadu_pd(ax),
+					   _mm512_loadu_pd(bx)));
+	ax += 8;
+	bx += 8;
+	cx += 8;
+    }
+    if (mask) {
+	__m512d A = _mm512_maskz_loadu_pd(mask, ax);
+	__m512d B = _mm512_maskz_loadu_pd(mask, bx);
+
+	_mm512_mask_storeu_pd(cx, mask, _mm512_sub_pd(A, B));
+    }
+}
+
+TARGET_AVX512
+static void avx512_scalar_mul (double *mx, double x, int n)
+{
+    __m512d mul = _mm512_set1_pd(x);
+    int i, imax = n / 8;
+    __mmask8 mask = (__mmask8) ((1 << (n % 8)) - 1);
+
+    for (i=0; i<imax; i++) {
+	_mm512_storeu_pd(mx, _mm512_mul_pd(mul, _mm512_loadu_pd(mx)));
+	mx += 8;
+    }
+    if (mask) {
+	__m512d A = _mm512_maskz_loadu_pd(mask, mx);
+
+	_mm512_mask_storeu_pd(mx, mask, _mm512_mul_pd(mul, A));
+    }
+}
+
+TARGET_AVX512
+static double avx512_dot (const double *ax, const double *bx, int n)
+{
+    __m512d acc = _mm512_setzero_pd();
+    int i, imax = n / 8;
+    __mmask8 mask = (__mmask8) ((1 << (n % 8)) - 1);
+
+    for (i=0; i<imax; i++) {
+	acc = _mm512_fmadd_pd(_mm512_loadu_pd(ax), _mm512_loadu_pd(bx), acc);
+	ax += 8;
+	bx += 8;
+    }
+    if (mask) {
+	acc = _mm512_fmadd_pd(_mm512_maskz_loadu_pd(mask, ax),
+			      _mm512_maskz_loadu_pd(mask, bx), acc);
+    }
+
+    return _mm512_reduce_add_pd(acc);
+}
+
+static const simd_kernels avx512_kernels = {
+    "avx512",
+    avx512_add_to,
+    avx512_subt_from,
+    avx512_add,
+    avx512_subtract,
+    avx512_scalar_mul,
+    avx512_dot,
+    avx2_mul,
+    avx2_zmul,
+    avx2_zscale
+};
+
+#endif /* SIMD_X86_DISPATCH */
+
+#if defined(SIMD_NEON)
+
+/* NEON: 2 doubles per register */
+
+static void neon_add_to (double *ax, const double *bx, int n)
+{
+    int i, imax = n / 2;
+
+    for (i=0; i<imax; i++) {
+	vst1q_f64(ax, vaddq_f64(vld1q_f64(ax), vld1q_f64(bx)));
+	ax += 2;
+	bx += 2;
+    }
+    if (n % 2) {
+	ax[0] += bx[0];
+    }
+}
+
+static void neon_subt_from (double *ax, const double *bx, int n)
+{
+    int i, imax = n / 2;
+
+    for (i=0; i<imax; i++) {
+	vst1q_f64(ax, vsubq_f64(vld1q_f64(ax), vld1q_f64(bx)));
+	ax += 2;
+	bx += 2;
+    }
+    if (n % 2) {
+	ax[0] -= bx[0];
+    }
+}
+
+static void neon_add (const double *ax, const double *bx,
+		      double *cx, int n)
+{
+    int i, imax = n / 2;
+
+    for (i=0; i<imax; i++) {
+	vst1q_f64(cx, vaddq_f64(vld1q_f64(ax), vld1q_f64(bx)));
+	ax += 2;
+	bx += 2;
+	cx += 2;
+    }
+    if (n % 2) {
+	cx[0] = ax[0] + bx[0];
+    }
+}
+
+static void neon_subtract (const double *ax, const double *bx,
+			   double *cx, int n)
+{
+    int i, imax = n / 2;
+
+    for (i=0; i<imax; i++) {
+	vst1q_f64(cx, vsubq_f64(vld1q_f64(ax), vld1q_f64(bx)));
+	ax += 2;
+	bx += 2;
+	cx += 2;
+    }
+    if (n % 2) {
+	cx[0] = ax[0] - bx[0];
+    }
+}
+
+static void neon_scalar_mul (double *mx, double x, int n)
+{
+    float64x2_t mul = vdupq_n_f64(x);
+    int i, imax = n / 2;
+
+    for (i=0; i<imax; i++) {
+	vst1q_f64(mx, vmulq_f64(mul, vld1q_f64(mx)));
+	mx += 2;
+    }
+    if (n % 2) {
+	mx[0] *= x;
+    }
+}
+
+static double neon_dot (const double *ax, const double *bx, int n)
+{
+    float64x2_t acc = vdupq_n_f64(0.0);
+    int i, imax = n / 2;
+    double ret;
+
+    for (i=0; i<imax; i++) {
+	acc = vfmaq_f64(acc, vld1q_f64(ax), vld1q_f64(bx));
+	ax += 2;
+	bx += 2;
+    }
+    ret = vaddvq_f64(acc);
+    if (n % 2) {
+	ret += ax[0] * bx[0];
+    }
+
+    return ret;
+}
+
+/* C = A * B, processing two rows of A at a time */
+
+static void neon_mul (const gretl_matrix *A,
+		      const gretl_matrix *B,
+		      gretl_matrix *C)
+{
+    int m = A->rows;
+    int n = B->cols;
+    int k = A->cols;
+    const double *aval = A->val;
+    const double *bval = B->val;
+    double *cval = C->val;
+    int h, hmax = m / 2;
+    int i, j;
+
+    for (h=0; h<hmax; h++) {
+	float64x2_t a[k];
+	float64x2_t ccol;
+
+	for (j=0; j<k; j++) {
+	    a[j] = vld1q_f64(aval + j*m);
+	}
+	for (j=0; j<n; j++) {
+	    ccol = vdupq_n_f64(0.0);
+	    for (i=0; i<k; i++) {
+		ccol = vfmaq_n_f64(ccol, a[i], bval[j*k + i]);
+	    }
+	    vst1q_f64(&cval[m*j], ccol);
+	}
+	aval += 2;
+	cval += 2;
+    }
+
+    if (m % 2) {
+	double ccol;
+
+	for (j=0; j<n; j++) {
+	    ccol = 0.0;
+	    for (i=0; i<k; i++) {
+		ccol += bval[j*k + i] * aval[i*m];
+	    }
+	    cval[m*j] = ccol;
+	}
+    }
+}
+
+/* Complex multiplication, one complex value per register: with
+   x = (a, b) and y = (c, d) we form (ac, bc) and (bd, ad), and
+   combine them with signs (-1, 1).
+*/
+
+static inline float64x2_t neon_zmul1 (float64x2_t x, float64x2_t y)
+{
+    const float64x2_t sgn = {-1.0, 1.0};
+    float64x2_t t = vmulq_f64(x, vdupq_laneq_f64(y, 0));
+    float64x2_t u = vmulq_f64(vextq_f64(x, x, 1), vdupq_laneq_f64(y, 1));
+
+    return vfmaq_f64(t, u, sgn);
+}
+
+static void neon_zmul (const double *ax, const double *bx,
+		       double *cx, int n)
+{
+    int i;
+
+    for (i=0; i<n; i++) {
+	vst1q_f64(cx, neon_zmul1(vld1q_f64(ax), vld1q_f64(bx)));
+	ax += 2;
+	bx += 2;
+	cx += 2;
+    }
+}
+
+static void neon_zscale (const double *ax, const double *s,
+			 double *cx, int n, int add)
+{
+    float64x2_t y = vld1q_f64(s);
+    float64x2_t z;
+    int i;
+
+    for (i=0; i<n; i++) {
+	z = neon_zmul1(vld1q_f64(ax), y);
+	if (add) {
+	    z = vaddq_f64(z, vld1q_f64(cx));
+	}
+	vst1q_f64(cx, z);
+	ax += 2;
+	cx += 2;
+    }
+}
+
+static const simd_kernels neon_kernels = {
+    "neon",
+    neon_add_to,
+    neon_subt_from,
+    neon_add,
+    neon_subtract,
+    neon_scalar_mul,
+    neon_dot,
+    neon_mul,
+    neon_zmul,
+    neon_zscale
+};
+
+#endif /* SIMD_NEON */
+
+/* The kernel set in use: NULL if no SIMD support is available
+   on the running CPU, in which case callers fall back to plain
+   C loops.
+*/
+
+static const simd_kernels *simdk;
+static int simd_probed;
+
+static void simd_kernels_init (void)
+{
+#if defined(SIMD_X86_DISPATCH)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+	simdk = &avx512_kernels;
+    } else if (__builtin_cpu_supports("avx2") &&
+	       __builtin_cpu_supports("fma")) {
+	simdk = &avx2_kernels;
+    } else if (__builtin_cpu_supports("avx")) {
+	simdk = &avx_kernels;
+    }
+#elif defined(USE_AVX)
+    /* the build host was checked by configure */
+    simdk = &avx_kernels;
+#elif defined(SIMD_NEON)
+    simdk = &neon_kernels;
+#endif
+
+#if SHOW_SIMD
+    fprintf(stderr, "SIMD kernels: %s\n", simdk != NULL ? simdk->id : "none");
+#endif
+}
+
+static inline const simd_kernels *get_simd_kernels (void)
+{
+    if (!simd_probed) {
+	simd_kernels_init();
+	simd_probed = 1;
+    }
+
+    return simdk;
+}
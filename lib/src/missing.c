@@ -57,6 +57,106 @@ static int really_missing (int v, int t, const double **Z, int d)
     }
 }
 
+/* Scanning for missing values. NaNs and infinities share an
+   all-ones exponent, so we can test for "na" on the bit pattern;
+   written without an early exit, the loop over a block is
+   readily vectorized by the compiler.
+*/
+
+#define NA_EXP_BITS 0x7ff0000000000000ULL
+#define NA_BLOCK 512
+
+static int block_has_na (const double *x, int n)
+{
+    uint64_t u;
+    int i, hit = 0;
+
+    for (i=0; i<n; i++) {
+	memcpy(&u, x + i, sizeof u);
+	hit |= (u & NA_EXP_BITS) == NA_EXP_BITS;
+    }
+
+    return hit;
+}
+
+static int range_has_na (const double *x, int t1, int t2)
+{
+    int t, len;
+
+    for (t=t1; t<=t2; t+=NA_BLOCK) {
+	len = MIN(NA_BLOCK, t2 - t + 1);
+	if (block_has_na(x + t, len)) {
+	    return 1;
+	}
+    }
+
+    return 0;
+}
+
+/* Scan the series in @list (or series 1 to @k if @list is NULL)
+   over the range @t1 to @t2, one series at a time. If there are
+   no missing values, return NULL. Otherwise return an array of
+   length t2 - t1 + 1, holding 1 for observations at which at
+   least one of the series is missing and 0 elsewhere. If @dwt
+   is non-zero, observations at which series @dwt is 0 are not
+   counted as missing.
+*/
+
+static char *list_scan_missing (const int *list, int k,
+				int t1, int t2,
+				const double **Z,
+				int dwt, int *err)
+{
+    char *rm = NULL;
+    const double *x;
+    int i, vi, s, t, len;
+
+    for (i=1; i<=k; i++) {
+	vi = list == NULL ? i : list[i];
+	if (vi <= 0 || vi == LISTSEP) {
+	    continue;
+	}
+	x = Z[vi];
+	for (s=t1; s<=t2; s+=NA_BLOCK) {
+	    len = MIN(NA_BLOCK, t2 - s + 1);
+	    if (!block_has_na(x + s, len)) {
+		continue;
+	    }
+	    if (rm == NULL) {
+		rm = calloc(t2 - t1 + 1, 1);
+		if (rm == NULL) {
+		    *err = E_ALLOC;
+		    return NULL;
+		}
+	    }
+	    for (t=s; t<s+len; t++) {
+		if (na(x[t])) {
+		    rm[t-t1] = 1;
+		}
+	    }
+	}
+    }
+
+    if (rm != NULL && dwt > 0) {
+	/* observations that are dummied out don't count */
+	int any = 0;
+
+	for (t=t1; t<=t2; t++) {
+	    if (Z[dwt][t] == 0) {
+		rm[t-t1] = 0;
+	    } else if (rm[t-t1]) {
+		any = 1;
+	    }
+	}
+	if (!any) {
+	    free(rm);
+	    rm = NULL;
+	}
+    }
+
+    return rm;
+}
+
 int model_missing (const MODEL *pmod, int t)
 {
     if (pmod->missmask != NULL) {
@@ -150,54 +250,43 @@ int model_adjust_sample (MODEL *pmod, int n, const double **Z,
     int i, t, dwt = 0, t1min = pmod->t1, t2max = pmod->t2;
     int vi, missobs, ret = 0;
     int move_ends = 1;
+    char *rm;
+    int err = 0;
 
     if (gretl_model_get_int(pmod, "wt_dummy")) {
 	/* we have a weight variable which is a 0/1 dummy */
 	dwt = pmod->nwt;
     }
 
+    rm = list_scan_missing(pmod->list, pmod->list[0], pmod->t1,
+			   pmod->t2, Z, dwt, &err);
+    if (err) {
+	pmod->errcode = err;
+	return misst != NULL ? 0 : 1;
+    } else if (rm == NULL) {
+	/* no missing values */
+	return 0;
+    }
+
+#define rmiss(t) (rm[(t) - pmod->t1])
+
     /* advance start of sample range to skip missing obs */
-    for (t=t1min; t<t2max; t++) {
-	missobs = 0;
-	for (i=1; i<=pmod->list[0]; i++) {
-	    vi = pmod->list[i];
-	    if (vi > 0 && vi != LISTSEP) {
-		if (really_missing(vi, t, Z, dwt)) {
-		    missobs = 1;
-		    break;
-		}
-	    }
-	}
-	if (missobs) {
-	    t1min++;
-	} else {
-	    break;
-	}
+    while (t1min < t2max && rmiss(t1min)) {
+	t1min++;
     }
 
     /* retard end of sample range to skip missing obs */
-    for (t=t2max; t>t1min; t--) {
-	missobs = 0;
-	for (i=1; i<=pmod->list[0]; i++) {
-	    vi = pmod->list[i];
-	    if (vi > 0 && vi != LISTSEP) {
-		if (really_missing(vi, t, Z, dwt)) {
-		    missobs = 1;
-		    break;
-		}
-	    }
-	}
-	if (missobs) {
-	    t2max--;
-	} else {
-	    break;
-	}
+    while (t2max > t1min && rmiss(t2max)) {
+	t2max--;
     }
 
     if (misst != NULL) {
 	/* check for missing values within remaining range and
 	   flag an error in case any are found */
 	for (t=t1min; t<=t2max && !ret; t++) {
+	    if (!rmiss(t)) {
+		continue;
+	    }
 	    for (i=1; i<=pmod->list[0]; i++) {
 		vi = pmod->list[i];
 		if (vi > 0 && vi != LISTSEP) {
@@ -215,15 +304,7 @@ int model_adjust_sample (MODEL *pmod, int n, const double **Z,
 	   we do this only if misst == NULL */
 	missobs = 0;
 	for (t=t1min; t<=t2max; t++) {
-	    for (i=1; i<=pmod->list[0]; i++) {
-		vi = pmod->list[i];
-		if (vi > 0 || vi != LISTSEP) {
-		    if (really_missing(vi, t, Z, dwt)) {
-			missobs++;
-			break;
-		    }
-		}
-	    }
+	    missobs += rmiss(t);
 	}
 
 	if (missobs == t2max - t1min + 1) {
@@ -241,6 +322,10 @@ int model_adjust_sample (MODEL *pmod, int n, const double **Z,
 	}
     }
 
+#undef rmiss
+
+    free(rm);
+
     if (move_ends) {
 	pmod->t1 = t1min;
 	pmod->t2 = t2max;
@@ -300,6 +385,10 @@ int series_adjust_sample (const double *x, int *t1, int *t2)
     int t, t1min = *t1, t2max = *t2;
     int err = 0;
 
+    if (!range_has_na(x, t1min, t2max)) {
+	return 0;
+    }
+
     for (t=t1min; t<t2max; t++) {
 	if (na(x[t])) t1min++;
 	else break;
@@ -349,8 +438,9 @@ int series_adjust_sample (const double *x, int *t1, int *t2)
 int list_adjust_sample (const int *list, int *t1, int *t2,
 			const DATASET *dset, int *nmiss)
 {
-    int i, t, t1min = *t1, t2max = *t2;
-    int k, vi, missing, err = 0;
+    int t, t1min = *t1, t2max = *t2;
+    int k, err = 0;
+    char *rm;
 
     if (list != NULL) {
 	k = list[0];
@@ -359,66 +449,44 @@ int list_adjust_sample (const int *list, int *t1, int *t2,
 	k = dset->v - 1;
     }
 
-    /* advance start of sample range to skip missing obs? */
-    for (t=t1min; t<t2max; t++) {
-	missing = 0;
-	for (i=1; i<=k; i++) {
-	    vi = list == NULL ? i : list[i];
-	    if (vi > 0 && vi != LISTSEP) {
-		if (na(dset->Z[vi][t])) {
-		    missing = 1;
-		    break;
-		}
-	    }
-	}
-	if (missing) {
-	    t1min++;
-	} else {
-	    break;
-	}
+    if (nmiss != NULL) {
+	*nmiss = 0;
     }
 
-    /* retard end of sample range to skip missing obs? */
-    for (t=t2max; t>t1min; t--) {
-	missing = 0;
-	for (i=1; i<=k; i++) {
-	    vi = list == NULL ? i : list[i];
-	    if (vi > 0 && vi != LISTSEP) {
-		if (na(dset->Z[vi][t])) {
-		    missing = 1;
-		    break;
-		}
-	    }
-	}
-	if (missing) {
-	    t2max--;
-	} else {
-	    break;
-	}
+    rm = list_scan_missing(list, k, *t1, *t2, (const double **) dset->Z,
+			   0, &err);
+    if (rm == NULL) {
+	/* no missing values, or allocation failure */
+	return err;
     }
 
-    if (nmiss != NULL) {
-	*nmiss = 0;
+#define rmiss(t) (rm[(t) - *t1])
+
+    /* advance start of sample range to skip missing obs? */
+    while (t1min < t2max && rmiss(t1min)) {
+	t1min++;
+    }
+
+    /* retard end of sample range to skip missing obs? */
+    while (t2max > t1min && rmiss(t2max)) {
+	t2max--;
     }
 
     /* check for missing values within remaining range */
     for (t=t1min; t<=t2max && !err; t++) {
-	missing = 0;
-	for (i=1; i<=k; i++) {
-	    vi = list == NULL ? i : list[i];
-	    if (vi > 0 && vi != LISTSEP) {
-		if (na(dset->Z[vi][t])) {
-		    if (nmiss == NULL) {
-			err = E_MISSDATA;
-		    } else {
-			*nmiss += 1;
-		    }
-		    break;
-		}
+	if (rmiss(t)) {
+	    if (nmiss == NULL) {
+		err = E_MISSDATA;
+	    } else {
+		*nmiss += 1;
 	    }
 	}
     }
 
+#undef rmiss
+
+    free(rm);
+
     *t1 = t1min;
     *t2 = t2max;
 
@@ -2158,6 +2158,12 @@ static void print_model_heading (const MODEL *pmod,
 	    pprintf(prn, "%s: %d", _("Missing or incomplete observations dropped"),
 		    mc);
 	}
+	if (pmod->ci == POISSON && gretl_model_get_data(pmod, "absorb") != NULL) {
+	    const char *s = gretl_model_get_data(pmod, "absorb");
+
+	    gretl_prn_newline(prn);
+	    pprintf(prn, _("Absorbing fixed effects for %s"), s);
+	}
     } else {
 	/* panel data */
 	int effn = gretl_model_get_int(pmod, "n_included_units");
@@ -2195,6 +2201,12 @@ static void print_model_heading (const MODEL *pmod,
 			Tmin, Tmax);
 	    }
 	}
+	if (gretl_model_get_data(pmod, "absorb") != NULL) {
+	    const char *s = gretl_model_get_data(pmod, "absorb");
+
+	    gretl_prn_newline(prn);
+	    pprintf(prn, _("Absorbing fixed effects for %s"), s);
+	}
 	if (pmod->ci == DPANEL) {
 	    if (pmod->opt & OPT_L) {
 		gretl_prn_newline(prn);
@@ -3488,7 +3500,7 @@ int printmodel (MODEL *pmod, const DATASET *dset, gretlopt opt,
 {
     int gotnan = 0;
 
-    if (prn == NULL || (opt & OPT_Q)) {
+    if (gretl_print_is_null(prn) || (opt & OPT_Q)) {
 	return 0;
     }
 
@@ -19,6 +19,8 @@
 
 /* monte_carlo.c - loop procedures */
 
+#define FULL_XML_HEADERS
+
 #include "libgretl.h"
 #include "monte_carlo.h"
 #include "libset.h"
@@ -34,6 +36,11 @@
 #include "gretl_string_table.h"
 #include "gretl_typemap.h"
 #include "genr_optim.h"
+#include "gretl_mt.h"
+#include "usermat.h"
+#include "gretl_profile.h"
+#include "gretl_trace.h"
+#include "gretl_xml.h"
 
 #include <time.h>
 #include <unistd.h>
@@ -48,7 +55,8 @@ enum loop_types {
     INDEX_LOOP,
     DATED_LOOP,
     FOR_LOOP,
-    EACH_LOOP
+    EACH_LOOP,
+    BIND_LOOP
 };
 
 #define DEFAULT_NOBS 512
@@ -71,7 +79,9 @@ typedef enum {
     LOOP_RENAMING    = 1 << 4,
     LOOP_ERR_CAUGHT  = 1 << 5,
     LOOP_CONDITIONAL = 1 << 6,
-    LOOP_DECREMENT   = 1 << 7
+    LOOP_DECREMENT   = 1 << 7,
+    LOOP_PARALLEL    = 1 << 8,
+    LOOP_INVAR_DONE  = 1 << 9
 } LoopFlags;
 
 struct controller_ {
@@ -94,6 +104,8 @@ typedef enum {
     LOOP_LINE_PDONE   = 1 << 4, /* progressive loop command started */
     LOOP_LINE_NOCOMP  = 1 << 5, /* not compilable */
     LOOP_LINE_QUIET   = 1 << 6, /* non-printing model in progressive loop */
+    LOOP_LINE_INVAR   = 1 << 7, /* loop-invariant assignment */
+    LOOP_LINE_HOISTED = 1 << 8  /* value computed on the current run */
 } LoopLineFlags;
 
 /* local convenience typedef */
@@ -127,6 +139,11 @@ struct LOOPSET_ {
     char eachname[VNAMELEN];
     GretlType eachtype;
 
+    /* typed "foreach": variable bound to each element of a source */
+    char bindname[VNAMELEN];
+    char bindsrc[VNAMELEN];
+    GretlType bindtype;
+
     /* break, continue signals */
     char brk;
     char cont;
@@ -144,6 +161,7 @@ struct LOOPSET_ {
 
     /* subsidiary objects */
     loop_line *lines;      /* saved command info */
+    cmd_cache **ccache;    /* cached parses of command lines */
     char **eachstrs;       /* for use with "foreach" loop */
     model_record *mrecords;
     LOOPSET *parent;
@@ -171,10 +189,15 @@ struct LOOPSET_ {
 #define loop_set_has_cond(l)    (l->flags |= LOOP_CONDITIONAL)
 #define loop_decrement(l)       (l->flags & LOOP_DECREMENT)
 #define loop_set_decrement(l)   (l->flags |= LOOP_DECREMENT)
+#define loop_is_parallel(l)     (l->flags & LOOP_PARALLEL)
+#define loop_set_parallel(l)    (l->flags |= LOOP_PARALLEL)
+#define loop_invar_done(l)      (l->flags & LOOP_INVAR_DONE)
 
 #define loop_line_catch(ll)  (ll->flags & LOOP_LINE_CATCH)
 #define loop_line_nosub(ll)  (!(ll->flags & (LOOP_LINE_AT | LOOP_LINE_DOLLAR)))
 #define loop_line_quiet(ll)  (ll->flags & LOOP_LINE_QUIET)
+#define loop_line_invar(ll)  (ll->flags & LOOP_LINE_INVAR)
+#define loop_line_hoisted(ll) (ll->flags & LOOP_LINE_HOISTED)
 
 #define line_is_compiled(ll) (ll->ptr != NULL || ll->ci == ELSE || \
                               ll->ci == ENDIF || ll->ci == BREAK || \
@@ -469,6 +492,9 @@ static void set_loop_opts (LOOPSET *loop, gretlopt opt)
     if (opt & OPT_D) {
         loop_set_decrement(loop);
     }
+    if (opt & OPT_L) {
+        loop_set_parallel(loop);
+    }
 }
 
 #define plain_model_ci(c) (MODEL_COMMAND(c) && \
@@ -548,6 +574,9 @@ static void gretl_loop_init (LOOPSET *loop)
     *loop->eachname = '\0';
     loop->eachtype = 0;
     loop->eachstrs = NULL;
+    *loop->bindname = '\0';
+    *loop->bindsrc = '\0';
+    loop->bindtype = 0;
 
     controller_init(&loop->init);
     controller_init(&loop->test);
@@ -556,6 +585,7 @@ static void gretl_loop_init (LOOPSET *loop)
 
     loop->n_lines = 0;
     loop->lines = NULL;
+    loop->ccache = NULL;
     loop->n_models = 0;
     loop->mrecords = NULL;
 
@@ -631,6 +661,13 @@ void gretl_loop_destroy (LOOPSET *loop)
         free(loop->lines);
     }
 
+    if (loop->ccache != NULL) {
+        for (i=0; i<loop->n_lines; i++) {
+            cmd_cache_free(loop->ccache[i]);
+        }
+        free(loop->ccache);
+    }
+
     if (loop->mrecords != NULL) {
         free(loop->mrecords);
     }
@@ -1344,6 +1381,244 @@ static int set_alt_each_loop (LOOPSET *loop, DATASET *dset,
     return loop_attach_index_var(loop, ivar, dset);
 }
 
+/* Typed "foreach", as in
+
+     loop foreach matrix c in X
+
+   Here the loop variable is bound directly to each element of the
+   source in turn -- columns (or, for a scalar, elements) of a
+   matrix, members of a list (as a series) or elements of an array
+   -- so there's no $-substitution and the lines of the loop can be
+   compiled.
+*/
+
+static int parse_as_bind_loop (LOOPSET *loop, const char *s,
+                               int *done)
+{
+    char tword[16], vname[VNAMELEN], kw[4], src[VNAMELEN];
+    char fmt[32];
+    GretlType t;
+    int err = 0;
+
+    if (count_each_fields(s) != 4) {
+        return 0;
+    }
+
+    sprintf(fmt, "%%15s %%%ds %%3s %%%ds", VNAMELEN-1, VNAMELEN-1);
+    if (sscanf(s, fmt, tword, vname, kw, src) != 4 || strcmp(kw, "in")) {
+        return 0;
+    }
+
+    t = gretl_type_from_string(tword);
+    if (t != GRETL_TYPE_DOUBLE && t != GRETL_TYPE_MATRIX &&
+        t != GRETL_TYPE_SERIES && t != GRETL_TYPE_STRING &&
+        t != GRETL_TYPE_BUNDLE && t != GRETL_TYPE_LIST) {
+        return 0;
+    }
+
+    *done = 1;
+    err = check_identifier(vname);
+
+    if (!err && !strcmp(vname, src)) {
+        gretl_errmsg_sprintf(_("foreach: %s cannot be bound to its own "
+                               "elements"), vname);
+        err = E_INVARG;
+    }
+
+    if (!err) {
+        loop->type = BIND_LOOP;
+        loop->bindtype = t;
+        strcpy(loop->bindname, vname);
+        strcpy(loop->bindsrc, src);
+    }
+
+    return err;
+}
+
+/* Get the number of elements of the source for a typed "foreach",
+   checking that they're compatible with the type of the loop
+   variable.
+*/
+
+static int bind_source_length (LOOPSET *loop, user_var *src, int *err)
+{
+    GretlType t = loop->bindtype;
+    int n = 0;
+
+    if (src == NULL) {
+        gretl_errmsg_sprintf(_("%s: no such object"), loop->bindsrc);
+        *err = E_UNKVAR;
+    } else if (src->type == GRETL_TYPE_MATRIX &&
+               (t == GRETL_TYPE_MATRIX || t == GRETL_TYPE_DOUBLE)) {
+        gretl_matrix *m = src->ptr;
+
+        if (m->is_complex) {
+            *err = E_CMPLX;
+        } else {
+            n = (t == GRETL_TYPE_MATRIX)? m->cols : m->rows * m->cols;
+        }
+    } else if (src->type == GRETL_TYPE_LIST && t == GRETL_TYPE_SERIES) {
+        int *list = src->ptr;
+
+        n = list[0];
+    } else if (src->type == GRETL_TYPE_ARRAY &&
+               gretl_array_get_content_type(src->ptr) == t) {
+        n = gretl_array_get_length(src->ptr);
+    } else {
+        gretl_errmsg_sprintf(_("foreach: can't bind %s %s to the elements "
+                               "of %s"), gretl_type_get_name(t),
+                             loop->bindname, loop->bindsrc);
+        *err = E_TYPES;
+    }
+
+    return n;
+}
+
+/* Find the loop variable of a typed "foreach", creating it if
+   need be.
+*/
+
+static user_var *get_bind_var (LOOPSET *loop, DATASET *dset, int *err)
+{
+    GretlType t = loop->bindtype;
+    user_var *u = NULL;
+
+    if (t == GRETL_TYPE_SERIES) {
+        if (current_series_index(dset, loop->bindname) < 0) {
+            char genline[VNAMELEN + 16];
+
+            sprintf(genline, "%s=NA", loop->bindname);
+            *err = generate(genline, dset, GRETL_TYPE_SERIES, OPT_Q, NULL);
+        }
+        return NULL;
+    }
+
+    u = get_user_var_of_type_by_name(loop->bindname, t);
+
+    if (u == NULL) {
+        if (gretl_is_user_var(loop->bindname) ||
+            current_series_index(dset, loop->bindname) >= 0) {
+            gretl_errmsg_sprintf(_("foreach: %s is not a %s"), loop->bindname,
+                                 gretl_type_get_name(t));
+            *err = E_TYPES;
+        } else {
+            *err = user_var_add(loop->bindname, t, NULL);
+            if (!*err) {
+                u = get_user_var_of_type_by_name(loop->bindname, t);
+            }
+        }
+    }
+
+    return u;
+}
+
+static int bind_loop_setup (LOOPSET *loop, DATASET *dset)
+{
+    user_var *src = get_user_var_by_name(loop->bindsrc);
+    int n, err = 0;
+
+    if (loop->bindtype == GRETL_TYPE_SERIES && (dset == NULL || dset->n == 0)) {
+        return E_NODATA;
+    }
+
+    n = bind_source_length(loop, src, &err);
+    if (!err) {
+        get_bind_var(loop, dset, &err);
+    }
+    if (!err) {
+        loop->init.val = 1;
+        loop->final.val = n;
+        loop->itermax = n;
+    }
+
+    return err;
+}
+
+/* Bind the loop variable of a typed "foreach" to element @i
+   (0-based) of its source. The source is looked up afresh,
+   since it may have been modified in the body of the loop.
+*/
+
+static int bind_loop_element (LOOPSET *loop, DATASET *dset, int i)
+{
+    user_var *src = get_user_var_by_name(loop->bindsrc);
+    GretlType t = loop->bindtype;
+    user_var *u;
+    int n, err = 0;
+
+    n = bind_source_length(loop, src, &err);
+    if (!err && i >= n) {
+        gretl_errmsg_sprintf(_("Index value %d is out of bounds"), i + 1);
+        err = E_DATA;
+    }
+    if (!err) {
+        u = get_bind_var(loop, dset, &err);
+    }
+    if (err) {
+        return err;
+    }
+
+    if (t == GRETL_TYPE_SERIES) {
+        int *list = src->ptr;
+        int v = current_series_index(dset, loop->bindname);
+        int vi = list[i+1];
+
+        if (v < 0 || vi < 0 || vi >= dset->v) {
+            err = E_DATA;
+        } else if (vi != v) {
+            memcpy(dset->Z[v], dset->Z[vi], dset->n * sizeof(double));
+        }
+    } else if (src->type == GRETL_TYPE_MATRIX) {
+        gretl_matrix *X = src->ptr;
+
+        if (t == GRETL_TYPE_DOUBLE) {
+            uvar_set_scalar_fast(u, X->val[i]);
+        } else {
+            /* copy column @i, re-using storage when possible */
+            gretl_matrix *m = u->ptr;
+
+            if (m == NULL || m->is_complex || m->rows != X->rows ||
+                m->cols != 1) {
+                m = gretl_matrix_alloc(X->rows, 1);
+                if (m == NULL) {
+                    err = E_ALLOC;
+                } else {
+                    err = user_var_replace_value(u, m, t);
+                }
+            } else {
+                gretl_matrix_destroy_info(m);
+            }
+            if (!err) {
+                memcpy(m->val, X->val + i * X->rows,
+                       X->rows * sizeof(double));
+            }
+        }
+    } else {
+        void *data = gretl_array_get_data(src->ptr, i);
+        void *copy = NULL;
+
+        if (t == GRETL_TYPE_STRING) {
+            copy = gretl_strdup(data != NULL ? data : "");
+        } else if (t == GRETL_TYPE_MATRIX) {
+            copy = data != NULL ? gretl_matrix_copy(data) :
+                gretl_null_matrix_new();
+        } else if (t == GRETL_TYPE_BUNDLE) {
+            copy = data != NULL ? gretl_bundle_copy(data, &err) :
+                gretl_bundle_new();
+        } else if (t == GRETL_TYPE_LIST) {
+            copy = data != NULL ? gretl_list_copy(data) :
+                gretl_null_list();
+        }
+        if (copy == NULL) {
+            err = err ? err : E_ALLOC;
+        } else {
+            err = user_var_replace_value(u, copy, t);
+        }
+    }
+
+    return err;
+}
+
 static int
 parse_as_each_loop (LOOPSET *loop, DATASET *dset, char *s)
 {
@@ -1362,6 +1637,12 @@ parse_as_each_loop (LOOPSET *loop, DATASET *dset, char *s)
     fprintf(stderr, "parse_as_each_loop: s = '%s'\n", s);
 #endif
 
+    /* check for the typed form first */
+    err = parse_as_bind_loop(loop, s, &done);
+    if (err || done) {
+        return err;
+    }
+
     /* get the index variable name (as in "foreach i") */
     if (gretl_scan_varname(s, ivar) != 1) {
         return E_PARSE;
@@ -1691,6 +1972,11 @@ static int loop_condition (LOOPSET *loop, DATASET *dset, int *err)
         /* got "break" comand */
         loop->brk = 0;
         ok = 0;
+    } else if (loop->type == BIND_LOOP) {
+        if (loop->iter < loop->itermax) {
+            *err = bind_loop_element(loop, dset, loop->iter);
+            ok = (*err == 0);
+        }
     } else if (loop->type == COUNT_LOOP || indexed_loop(loop)) {
         if (loop->iter < loop->itermax) {
             ok = 1;
@@ -1982,6 +2268,10 @@ int gretl_loop_append_line_full (ExecState *s, DATASET *dset,
             err = E_BADOPT;
         }
 #endif
+        if ((opt & OPT_L) && !(opt & OPT_P)) {
+            gretl_errmsg_set(_("The --parallel option requires --progressive"));
+            err = E_BADOPT;
+        }
 
         if (!err) {
             newloop = start_new_loop(spec, loop, dset, opt,
@@ -2214,11 +2504,13 @@ static int loop_reattach_index_var (LOOPSET *loop, DATASET *dset)
 
 static int top_of_loop (LOOPSET *loop, DATASET *dset)
 {
-    int err = 0;
+    int j, err = 0;
 
     loop->iter = 0;
 
-    if (loop->eachname[0] != '\0') {
+    if (loop->type == BIND_LOOP) {
+        err = bind_loop_setup(loop, dset);
+    } else if (loop->eachname[0] != '\0') {
         err = loop_list_refresh(loop, dset);
     } else if (loop->type == INDEX_LOOP) {
         loop->init.val = controller_get_val(&loop->init, loop, dset, &err);
@@ -2253,6 +2545,9 @@ static int top_of_loop (LOOPSET *loop, DATASET *dset)
         /* initialization, in case this loop is being run more than
            once (i.e. it's embedded in an outer loop)
         */
+        for (j=0; j<loop->n_lines; j++) {
+            loop->lines[j].flags &= ~LOOP_LINE_HOISTED;
+        }
 #if HAVE_GMP
         if (loop_is_progressive(loop)) {
             progressive_loop_zero(loop);
@@ -2451,6 +2746,34 @@ static inline void cmd_info_to_loop (LOOPSET *loop, int j, CMD *cmd)
     }
 }
 
+/* Record the parse of a plain estimation command at line @j of
+   @loop, if it's suitable for reuse on subsequent iterations (see
+   cmd_cache_new() in tokenize.c). We don't do this in progressive
+   loops, which handle model commands specially, or for lines that
+   call for string substitution.
+*/
+
+static void maybe_cache_loop_cmd (LOOPSET *loop, int j, CMD *cmd,
+                                  const DATASET *dset)
+{
+    loop_line *ll = &loop->lines[j];
+
+    if (loop_is_progressive(loop) || !loop_line_nosub(ll)) {
+        return;
+    }
+
+    if (loop->ccache == NULL) {
+        loop->ccache = calloc(loop->n_lines, sizeof *loop->ccache);
+        if (loop->ccache == NULL) {
+            return;
+        }
+    }
+
+    /* replace any record that has been invalidated */
+    cmd_cache_free(loop->ccache[j]);
+    loop->ccache[j] = cmd_cache_new(cmd, dset);
+}
+
 /* We come here when the --force option has been applied to
    the "delete" command, trying to prevent deletion of the
    index variable for the loop: even --force can't allow that,
@@ -2664,6 +2987,169 @@ static int check_for_dollar_subst (loop_line *ll,
     return err;
 }
 
+/* Hoisting of loop-invariant statements. Once the lines of a loop
+   have been compiled (that is, after its first iteration) we look
+   for plain assignments to scalars or matrices whose right-hand
+   sides are "pure" functions of variables that are not modified
+   anywhere in the loop, and whose targets are not modified by any
+   other statement in the loop. Such a statement yields the same
+   value on every iteration, so after it has been executed once it
+   can be skipped for the remainder of the current run of the loop.
+   Until the analysis is done, LOOP_LINE_HOISTED records execution
+   of a compiled statement on the current run.
+*/
+
+static int line_has_address_op (const char *s)
+{
+    while ((s = strchr(s, '&')) != NULL) {
+        if (s[1] == '&') {
+            s += 2;
+        } else {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* commands known not to modify any user variable */
+
+static int loop_cmd_writes_nothing (loop_line *ll)
+{
+    int ci = ll->ci;
+
+    if (ci == PRINT || ci == PRINTF || ci == FUNCRET || plain_model_ci(ci)) {
+        return !line_has_address_op(ll->s);
+    } else {
+        return ci == ELSE || ci == ENDIF || ci == BREAK || ci == CONTINUE;
+    }
+}
+
+static int controller_get_writes (controller *clr, char ***pS, int *ns)
+{
+    if (clr->genr != NULL) {
+        return genr_get_writes(clr->genr, pS, ns);
+    } else {
+        return clr->expr != NULL;
+    }
+}
+
+/* Add to @pS the names of all the variables that may be modified
+   in the course of an iteration of @loop, including any sub-loops.
+   Return 1 if we can't be sure of identifying them all, else 0.
+*/
+
+static int loop_get_writes (LOOPSET *loop, char ***pS, int *ns)
+{
+    int j, ret = 0;
+
+    if (loop_is_renaming(loop)) {
+        return 1;
+    }
+
+    if (loop->idxname[0] != '\0') {
+        ret = strings_array_add(pS, ns, loop->idxname);
+    }
+    if (!ret && loop->eachname[0] != '\0') {
+        ret = strings_array_add(pS, ns, loop->eachname);
+    }
+    if (!ret && loop->bindname[0] != '\0') {
+        ret = strings_array_add(pS, ns, loop->bindname);
+    }
+    if (!ret) {
+        ret = controller_get_writes(&loop->test, pS, ns) ||
+            controller_get_writes(&loop->delta, pS, ns);
+    }
+
+    for (j=0; j<loop->n_lines && !ret; j++) {
+        loop_line *ll = &loop->lines[j];
+
+        if (ll->ci == LOOP) {
+            ret = ll->ptr == NULL || loop_get_writes(ll->ptr, pS, ns);
+        } else if (ll->ci == GENR || ll->ci == IF || ll->ci == ELIF) {
+            ret = ll->ptr == NULL || genr_get_writes(ll->ptr, pS, ns);
+        } else {
+            ret = !loop_cmd_writes_nothing(ll);
+        }
+    }
+
+    return ret;
+}
+
+static int count_name (char **S, int ns, const char *name)
+{
+    int i, n = 0;
+
+    for (i=0; i<ns; i++) {
+        if (!strcmp(S[i], name)) {
+            n++;
+        }
+    }
+
+    return n;
+}
+
+static int line_is_invariant (loop_line *ll, char **W, int nw)
+{
+    char **R = NULL;
+    char **T = NULL;
+    int nr = 0, nt = 0;
+    int i, ret = 0;
+
+    if (ll->ci != GENR || ll->ptr == NULL || loop_line_catch(ll) ||
+        !loop_line_nosub(ll)) {
+        return 0;
+    }
+
+    if (genr_get_invariant_inputs(ll->ptr, &R, &nr) &&
+        !genr_get_writes(ll->ptr, &T, &nt) && nt == 1 &&
+        count_name(W, nw, T[0]) == 1) {
+        /* the target is assigned by this statement only */
+        ret = 1;
+        for (i=0; i<nr && ret; i++) {
+            if (count_name(W, nw, R[i]) > 0) {
+                ret = 0;
+            }
+        }
+    }
+
+    strings_array_free(R, nr);
+    strings_array_free(T, nt);
+
+    return ret;
+}
+
+static void loop_find_invariants (LOOPSET *loop, PRN *prn)
+{
+    char **W = NULL;
+    int nw = 0;
+    int j;
+
+    loop->flags |= LOOP_INVAR_DONE;
+
+    if (loop_get_writes(loop, &W, &nw) == 0) {
+        for (j=0; j<loop->n_lines; j++) {
+            loop_line *ll = &loop->lines[j];
+
+            if (line_is_invariant(ll, W, nw)) {
+                ll->flags |= LOOP_LINE_INVAR;
+                if (loop_is_verbose(loop)) {
+                    pprintf(prn, _("loop: hoisted invariant statement '%s'\n"),
+                            ll->s);
+                }
+            } else {
+                ll->flags &= ~LOOP_LINE_HOISTED;
+            }
+        }
+    } else {
+        for (j=0; j<loop->n_lines; j++) {
+            loop->lines[j].flags &= ~LOOP_LINE_HOISTED;
+        }
+    }
+
+    strings_array_free(W, nw);
+}
+
 static int abort_loop_execution (ExecState *s)
 {
     *s->cmd->savename = '\0';
@@ -2693,7 +3179,9 @@ int gretl_loop_exec (ExecState *s, DATASET *dset)
     int gui_mode, echo;
     int show_activity = 0;
     int prev_messages;
+    int trace_batch = 0;
 #if HAVE_GMP
+    LOOP_WORKERS workers;
     int progressive;
 #endif
     int err = 0;
@@ -2725,6 +3213,7 @@ int gretl_loop_exec (ExecState *s, DATASET *dset)
     set_loop_on();
 #if HAVE_GMP
     progressive = loop_is_progressive(loop);
+    loop_workers_init(&workers);
 #endif
 
 #if LOOP_DEBUG
@@ -2733,6 +3222,15 @@ int gretl_loop_exec (ExecState *s, DATASET *dset)
 
     err = top_of_loop(loop, dset);
 
+#if HAVE_GMP
+    if (!err && progressive && loop_is_parallel(loop)) {
+        err = loop_workers_start(loop, &workers, &prn);
+        if (workers.self > 0) {
+            s->prn = prn;
+        }
+    }
+#endif
+
     if (!err) {
         if (loop_is_renaming(loop)) {
             loop_renaming = 1;
@@ -2749,12 +3247,21 @@ int gretl_loop_exec (ExecState *s, DATASET *dset)
 #if LOOP_DEBUG > 1
         fprintf(stderr, "*** top of loop: iter = %d\n", loop->iter);
 #endif
-        if (gui_mode && loop->iter % 10 == 0 && get_user_stop()) {
-            /* the user called a halt */
+        if (loop->iter % 10 == 0 && get_user_stop()) {
+            /* the user called a halt, or a signal was caught */
             err = abort_loop_execution(s);
             break;
         }
 
+        if (gretl_tracing() && !trace_batch) {
+            gretl_trace_loop_begin(loop->iter + 1, dset);
+            trace_batch = 1;
+        }
+
+        if (loop->iter == 1 && !loop_invar_done(loop)) {
+            loop_find_invariants(loop, prn);
+        }
+
         for (j=0; j<loop->n_lines && !err; j++) {
             /* execute commands on this iteration */
             loop_line *ll = &loop->lines[j];
@@ -2768,6 +3275,9 @@ int gretl_loop_exec (ExecState *s, DATASET *dset)
             }
 
             currline = ll->s;
+            if (gretl_profiling()) {
+                gretl_profile_line(currline, 0);
+            }
             if (compiled) {
                 /* just for "echo" purposes */
                 showline = currline;
@@ -2791,10 +3301,18 @@ int gretl_loop_exec (ExecState *s, DATASET *dset)
 
 	    /* deal with "compiled" cases */
 	    if (ci == GENR && compiled) {
-                if (echo && loop_is_verbose(loop)) {
-                    pprintf(prn, "? %s\n", showline);
+                if (loop_line_hoisted(ll)) {
+                    ; /* invariant value already computed */
+                } else {
+                    if (echo && loop_is_verbose(loop)) {
+                        pprintf(prn, "? %s\n", showline);
+                    }
+                    err = execute_genr(ll->ptr, dset, prn);
+                    if (!err && (loop_line_invar(ll) || !loop_invar_done(loop))) {
+                        /* record that the value is current */
+                        ll->flags |= LOOP_LINE_HOISTED;
+                    }
                 }
-                err = execute_genr(ll->ptr, dset, prn);
                 if (ll->next > 0) {
                     j = ll->next - 1;
                 }
@@ -2871,6 +3389,9 @@ int gretl_loop_exec (ExecState *s, DATASET *dset)
 			set_non_compilable(ll);
                         err = generate(cmd->vstart, dset, cmd->gtype,
                                        cmd->opt, prn);
+                    } else if (!err) {
+                        /* compiled and executed */
+                        ll->flags |= LOOP_LINE_HOISTED;
                     }
 		} else {
 		    /* string substitution or a "genr special" */
@@ -2913,8 +3434,17 @@ int gretl_loop_exec (ExecState *s, DATASET *dset)
                 }
             }
 
+            if (parse && !err && loop->ccache != NULL &&
+                cmd_restore_from_cache(cmd, loop->ccache[j], dset)) {
+                /* reuse the parse from a previous iteration */
+                parse = 0;
+            }
+
             if (parse && !err) {
                 err = parse_command_line(s, dset, NULL);
+                if (!err && plain_model_ci(cmd->ci)) {
+                    maybe_cache_loop_cmd(loop, j, cmd, dset);
+                }
 #if LOOP_DEBUG > 1
                 fprintf(stderr, "    after parse: '%s', ci=%s\n", line,
 			gretl_command_word(cmd->ci));
@@ -3013,16 +3543,34 @@ int gretl_loop_exec (ExecState *s, DATASET *dset)
 
         if (!err && !loop->brk) {
             loop->iter += 1;
-            if (show_activity && (loop->iter % 10 == 0)) {
+            if (show_activity) {
                 show_activity_callback();
             }
         }
 
+        if (trace_batch && loop->iter % TRACE_LOOP_BATCH == 0) {
+            gretl_trace_loop_end(loop->iter);
+            trace_batch = 0;
+        }
+
         if (err && inner_errline == NULL) {
             inner_errline = gretl_strdup(currline);
         }
     } /* end iterations of loop */
 
+    if (trace_batch) {
+        gretl_trace_loop_end(loop->iter);
+    }
+
+#if HAVE_GMP
+    if (workers.self > 0) {
+        /* we're a worker process: this doesn't return */
+        loop_worker_exit(loop, &workers, err ? err : loop->err);
+    } else if (workers.nw > 1) {
+        err = loop_workers_finish(loop, &workers, dset, err);
+    }
+#endif
+
     cmd->flags &= ~CMD_NOSUB;
 
     if (loop->brk) {
@@ -450,11 +450,13 @@ static int nls_genr_setup (nlspec *s)
 }
 
 /* If i == 0 we're calculating the function; if i > 0 we're calculating
-   a derivative.  Either way, we recalculate any auxiliary variables
-   first.
+   a derivative.  If @aux is non-zero we recalculate any auxiliary
+   variables first; this can be skipped when the parameter values are
+   unchanged since the last auxiliary pass, as when running through
+   the derivatives one after the other.
 */
 
-static int nls_auto_genr (nlspec *s, int i)
+static int nls_auto_genr (nlspec *s, int i, int aux)
 {
     int j;
 
@@ -477,7 +479,7 @@ static int nls_auto_genr (nlspec *s, int i)
 	return s->generr;
     }
 
-    for (j=0; j<s->naux; j++) {
+    for (j=0; j<s->naux && aux; j++) {
 #if NLS_DEBUG
 	fprintf(stderr, " generating aux var %d (%p):\n %s\n",
 		j, (void *) s->genrs[j], s->aux[j]);
@@ -527,12 +529,18 @@ static int nls_auto_genr (nlspec *s, int i)
 
 int nl_calculate_fvec (nlspec *s)
 {
-    return nls_auto_genr(s, 0);
+    return nls_auto_genr(s, 0, 1);
 }
 
+/* Calculate the derivative with respect to parameter @i. Since the
+   derivatives are always computed as a set, at a given vector of
+   parameter values, the auxiliary genrs need to be run only for the
+   first of them.
+*/
+
 static int nls_calculate_deriv (nlspec *s, int i)
 {
-    return nls_auto_genr(s, i + 1);
+    return nls_auto_genr(s, i + 1, i == 0);
 }
 
 /* end wrappers */
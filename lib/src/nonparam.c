@@ -18,6 +18,7 @@
  */
 
 #include "libgretl.h"
+#include "gretl_mt.h"
 
 /**
  * SECTION:nonparam
@@ -74,59 +75,35 @@ static double spearman_signif (double rho, int n)
     return 1.0;
 }
 
-enum {
-    RANK_X,
-    RANK_Y
-};
-
-/* m = number of sorted values (sz); n = number of raw values (either
-   x or y); in case of missing values in x and/or y we may have m < n.
+/* Write into @rz the ranks of the @m values in @z, with rank 1 for
+   the largest value and ties given the average of the ranks they
+   span; if there are any ties, set @ties to 1.
 */
 
-static void make_ranking (const double *sz, int m,
-			  const double *x, const double *y,
-			  int n, double *rz, int *ties,
-			  int which)
+static int make_ranking (const double *z, int m, double *rz,
+			 int *ties)
 {
-    const double *z;
-    int cases, k, i, j;
-    double avg, r = 1;
-
-    z = (which == RANK_X)? x : y;
+    int *order = malloc(m * sizeof *order);
+    int i, err;
 
-    for (i=0; i<m; i++) {
-	/* scan sorted z */
-	cases = k = 0;
-
-	if (i > 0 && sz[i] == sz[i-1]) {
-	    continue;
-	}
+    if (order == NULL) {
+	return E_ALLOC;
+    }
 
-	for (j=0; j<n; j++) {
-	    /* scan raw z for matches */
-	    if (!na(x[j]) && !na(y[j])) {
-		if (z[j] == sz[i]) {
-		    rz[k] = r;
-		    cases++;
-		}
-		k++;
-	    }
-	}
+    err = gretl_rank_values(z, m, 1, rz, order);
 
-	if (cases > 1) {
-	    avg = (r + r + cases - 1.0) / 2.0;
-	    for (j=0; j<m; j++) {
-		if (rz[j] == r) {
-		    rz[j] = avg;
-		}
-	    }
-	    if (ties != NULL) {
+    if (!err && ties != NULL) {
+	for (i=1; i<m; i++) {
+	    if (z[order[i]] == z[order[i-1]]) {
 		*ties = 1;
+		break;
 	    }
 	}
-
-	r += cases;
     }
+
+    free(order);
+
+    return err;
 }
 
 static int rankcorr_get_rankings (const double *x, const double *y, int n,
@@ -136,6 +113,7 @@ static int rankcorr_get_rankings (const double *x, const double *y, int n,
     double *sx = NULL, *sy = NULL;
     double *rx = NULL, *ry = NULL;
     int i, m = 0;
+    int err = 0;
 
     /* count non-missing pairs */
     for (i=0; i<n; i++) {
@@ -155,11 +133,8 @@ static int rankcorr_get_rankings (const double *x, const double *y, int n,
 
     if (sx == NULL || sy == NULL ||
 	rx == NULL || ry == NULL) {
-	free(sx);
-	free(sy);
-	free(rx);
-	free(ry);
-	return E_ALLOC;
+	err = E_ALLOC;
+	goto bailout;
     }
 
     /* copy non-missing x and y into sx, sy */
@@ -172,30 +147,29 @@ static int rankcorr_get_rankings (const double *x, const double *y, int n,
 	}
     }
 
-    /* get sorted series */
-    qsort(sx, m, sizeof *sx, gretl_inverse_compare_doubles);
-    qsort(sy, m, sizeof *sy, gretl_inverse_compare_doubles);
-
-    for (i=0; i<m; i++) {
-	rx[i] = ry[i] = 0.0;
+    err = make_ranking(sx, m, rx, ties);
+    if (!err) {
+	err = make_ranking(sy, m, ry, ties);
     }
 
-    /* make rankings by comparing "raw" x, y with sorted */
-    make_ranking(sx, m, x, y, n, rx, ties, RANK_X);
-    make_ranking(sy, m, x, y, n, ry, ties, RANK_Y);
-
-    /* save the ranks */
-    *rxout = rx;
-    *ryout = ry;
+ bailout:
 
-    if (pm != NULL) {
-	*pm = m;
+    if (err) {
+	free(rx);
+	free(ry);
+    } else {
+	/* save the ranks */
+	*rxout = rx;
+	*ryout = ry;
+	if (pm != NULL) {
+	    *pm = m;
+	}
     }
 
     free(sx);
     free(sy);
 
-    return 0;
+    return err;
 }
 
 static int real_spearman_rho (const double *x, const double *y, int n,
@@ -433,26 +407,97 @@ static int compare_pairs_x (const void *a, const void *b)
     return ret;
 }
 
-static int compare_pairs_y (const void *a, const void *b)
+/* Merge sort of @xy by y, with @tmp as workspace, returning the
+   number of pairs i < j in the incoming order for which y[j] < y[i]:
+   with @xy sorted by x (and y within x) beforehand these are just
+   the discordant pairs, as in Knight (JASA, 1966). The merges at
+   each pass are independent, and may be run on several threads.
+*/
+
+static gint64 kendall_merge_sort (struct xy_pair *xy,
+				  struct xy_pair *tmp,
+				  int n)
 {
-    const struct xy_pair *pa = a;
-    const struct xy_pair *pb = b;
+    gint64 swaps = 0;
+    int w, lo, mid, hi;
+    int i, j, k;
+
+    for (w=1; w<n; w*=2) {
+#if defined(_OPENMP)
+#pragma omp parallel for private(mid, hi, i, j, k) reduction(+:swaps) \
+    if (n / w > 2 && gretl_use_openmp((guint64) n))
+#endif
+	for (lo=0; lo<n-w; lo+=2*w) {
+	    mid = lo + w;
+	    hi = MIN(lo + 2*w, n);
+	    i = k = lo;
+	    j = mid;
+	    while (i < mid && j < hi) {
+		if (xy[j].y < xy[i].y) {
+		    swaps += mid - i;
+		    tmp[k++] = xy[j++];
+		} else {
+		    tmp[k++] = xy[i++];
+		}
+	    }
+	    while (i < mid) {
+		tmp[k++] = xy[i++];
+	    }
+	    while (j < hi) {
+		tmp[k++] = xy[j++];
+	    }
+	    memcpy(xy + lo, tmp + lo, (hi - lo) * sizeof *xy);
+	}
+    }
 
-    return (pa->y > pb->y) - (pa->y < pb->y);
+    return swaps;
+}
+
+/* Tally the runs of ties in x (if @y is 0) or y (if @y is 1) in
+   @xy, which must be sorted accordingly: for each run of length t
+   we add t(t-1), t(t-1)(t-2) and t(t-1)(2t+5) to @T, @T2 and @T25
+   respectively.
+*/
+
+static void kendall_ties (const struct xy_pair *xy, int n, int y,
+			  gint64 *T, gint64 *T2, gint64 *T25)
+{
+    gint64 t, tt1;
+    int i, j;
+
+    *T = *T2 = *T25 = 0;
+
+    for (i=0; i<n; i=j) {
+	for (j=i+1; j<n; j++) {
+	    if (y ? xy[j].y != xy[i].y : xy[j].x != xy[i].x) {
+		break;
+	    }
+	}
+	t = j - i;
+	if (t > 1) {
+	    tt1 = t * (t - 1);
+	    *T += tt1;
+	    *T2 += tt1 * (t - 2);
+	    *T25 += tt1 * (2 * t + 5);
+	}
+    }
 }
 
 static int real_kendall_tau (const double *x, const double *y,
 			     int n, struct xy_pair *xy, int nn,
 			     double *ptau, double *pz)
 {
+    struct xy_pair *tmp;
     double tau, nn1, s2, z;
-    int tt1, tx = 0, ty = 0;
-    int Tx = 0, Ty = 0;
-    int Tx2 = 0, Ty2 = 0;
-    int Tx25 = 0, Ty25 = 0;
-    int tie, N0, N1, S;
+    gint64 Tx, Ty, Tx2, Ty2, Tx25, Ty25;
+    gint64 N0, N1, S, Txy = 0;
     int i, j;
 
+    tmp = malloc(nn * sizeof *tmp);
+    if (tmp == NULL) {
+	return E_ALLOC;
+    }
+
     /* populate sorter */
     j = 0;
     for (i=0; i<n; i++) {
@@ -463,65 +508,37 @@ static int real_kendall_tau (const double *x, const double *y,
 	}
     }
 
-    /* sort pairs by x */
+    /* sort pairs by x, then y */
     qsort(xy, nn, sizeof *xy, compare_pairs_x);
 
-    /* make order counts */
-    N0 = N1 = 0;
-    for (i=0; i<nn; i++) {
+    /* ties in x, and joint ties in x and y */
+    kendall_ties(xy, nn, 0, &Tx, &Tx2, &Tx25);
+    for (i=0; i<nn; i=j) {
 	for (j=i+1; j<nn; j++) {
-	    if (xy[j].y == xy[i].y) {
-		Ty++;
-	    } else if (xy[j].x != xy[i].x) {
-		if (xy[j].y > xy[i].y) {
-		    N0++;
-		} else if (xy[j].y < xy[i].y) {
-		    N1++;
-		}
-	    }
-	}
-	if (i > 0) {
-	    /* account for ties in x */
-	    tie = (xy[i].x == xy[i-1].x);
-	    if (tie) {
-		tx++;
-	    }
-	    if (tx > 0 && (!tie || i == nn - 1)) {
-		tx++;
-		tt1 = tx * (tx - 1);
-		Tx += tt1;
-		Tx2 += tt1 * (tx - 2);
-		Tx25 += tt1 * (2 * tx + 5);
-		tx = 0;
+	    if (xy[j].x != xy[i].x || xy[j].y != xy[i].y) {
+		break;
 	    }
 	}
+	Txy += (gint64) (j - i) * (j - i - 1);
     }
 
-    if (Ty > 0) {
-	/* account for ties in y */
-	Ty = 0;
-	qsort(xy, nn, sizeof *xy, compare_pairs_y);
-	for (i=1; i<nn; i++) {
-	    tie = (xy[i].y == xy[i-1].y);
-	    if (tie) {
-		ty++;
-	    }
-	    if (ty > 0 && (!tie || i == nn - 1)) {
-		ty++;
-		tt1 = ty * (ty - 1);
-		Ty += tt1;
-		Ty2 += tt1 * (ty - 2);
-		Ty25 += tt1 * (2 * ty + 5);
-		ty = 0;
-	    }
-	}
-    }
+    /* discordant pairs, leaving @xy sorted by y */
+    N1 = kendall_merge_sort(xy, tmp, nn);
+    free(tmp);
+
+    /* ties in y */
+    kendall_ties(xy, nn, 1, &Ty, &Ty2, &Ty25);
+
+    /* concordant pairs: those tied in neither x nor y, less
+       the discordant ones (the T* values count each pair twice)
+    */
+    N0 = (gint64) nn * (nn - 1) / 2 - (Tx + Ty - Txy) / 2 - N1;
 
     S = N0 - N1;
 
 #if 0
-    fprintf(stderr, "N0 = %d, N1 = %d, S = %d\n", N0, N1, S);
-    fprintf(stderr, "Tx = %d, Ty = %d\n", Tx, Ty);
+    fprintf(stderr, "N0 = %d, N1 = %d, S = %d\n", (int) N0, (int) N1, (int) S);
+    fprintf(stderr, "Tx = %d, Ty = %d\n", (int) Tx, (int) Ty);
 #endif
 
     nn1 = nn * (nn - 1.0);
@@ -1086,6 +1103,44 @@ struct ranker {
     char c;
 };
 
+/* Put @r into ascending order of value and fill in the ranks, with
+   ties given the average of the ranks they span */
+
+static int sort_and_rank (struct ranker *r, int n)
+{
+    struct ranker *tmp = malloc(n * sizeof *tmp);
+    double *v = malloc(n * sizeof *v);
+    double *rk = malloc(n * sizeof *rk);
+    int *order = malloc(n * sizeof *order);
+    int i, err = 0;
+
+    if (n == 0) {
+	; /* nothing to do */
+    } else if (tmp == NULL || v == NULL || rk == NULL || order == NULL) {
+	err = E_ALLOC;
+    } else {
+	for (i=0; i<n; i++) {
+	    v[i] = r[i].val;
+	}
+	err = gretl_rank_values(v, n, 0, rk, order);
+    }
+
+    if (!err) {
+	memcpy(tmp, r, n * sizeof *r);
+	for (i=0; i<n; i++) {
+	    r[i] = tmp[order[i]];
+	    r[i].rank = rk[order[i]];
+	}
+    }
+
+    free(tmp);
+    free(v);
+    free(rk);
+    free(order);
+
+    return err;
+}
+
 /* Wilcoxon signed-rank test, with handling of zero-differences and
    non-zero ties, plus continuity correction, as in E. Cureton, "The
    Normal Approximation to the Signed-Rank Sampling Distribution when
@@ -1133,7 +1188,10 @@ int signed_rank_test (const double *x, const double *y,
 	}
     }
 
-    qsort(r, n, sizeof *r, gretl_compare_doubles);
+    if (sort_and_rank(r, n)) {
+	free(r);
+	return E_ALLOC;
+    }
 
     T = 0.0; /* non-zero ties correction */
     k = 0;   /* number of non-zero ties */
@@ -1144,15 +1202,11 @@ int signed_rank_test (const double *x, const double *y,
 	for (t=i+1; t<n && r[t].val == r[i].val; t++) {
 	    m++;
 	}
-
-	if (m == 0) {
-	    r[i].rank = Z + i + 1;
-	} else {
-	    double avg = (Z + i + 1 + Z + i + m + 1) / 2.0;
-
-	    for (t=0; t<=m; t++) {
-		r[i+t].rank = avg;
-	    }
+	for (t=0; t<=m; t++) {
+	    /* the zero differences take the lowest ranks */
+	    r[i+t].rank += Z;
+	}
+	if (m > 0) {
 	    i += m;
 	    T += pow((double) m, 3) - m;
 	    k++;
@@ -1294,23 +1348,9 @@ int rank_sum_test (const double *x, const double *y,
 	}
     }
 
-    qsort(r, n, sizeof *r, gretl_compare_doubles);
-
-    for (i=0; i<n; i++) {
-	int m = 1;
-
-	for (t=i+1; t<n && r[t].val == r[i].val; t++) {
-	    m++;
-	}
-
-	if (m == 1) {
-	    r[i].rank = i + 1;
-	} else {
-	    for (t=0; t<m; t++) {
-		r[i+t].rank = (i + 1 + i + m) / 2.0;
-	    }
-	    i += m - 1;
-	}
+    if (sort_and_rank(r, n)) {
+	free(r);
+	return E_ALLOC;
     }
 
     if (!quiet) {
@@ -1635,57 +1675,67 @@ static int next_ok_obs (const double *y, int i)
     return i;
 }
 
-static int loess_get_local_data (int i, int *pa,
+/* For each point i in the full sample, find the index of the
+   first of the n nearest neighbors of x[i] (counting only valid
+   y-values) and record it in @astart. Since x is sorted, this
+   index is non-decreasing in i, so a single left-to-right pass
+   suffices. The result doesn't depend on the weights, so it can
+   be reused across robustness iterations.
+*/
+
+static void loess_window_starts (const struct loess_info *lo,
+				 int amin, int *astart)
+{
+    const double *x = lo->x->val;
+    const double *y = lo->y->val;
+    int n = lo->n, n_ok = lo->n_ok;
+    int a = amin;
+    int b, i, m;
+
+    for (i=0; i<lo->N; i++) {
+	/* search rightward from a, so far as this is feasible */
+	while (n_ok > n) {
+	    /* find b, the next point that would be included if
+	       we move the neighbor set one place to the right:
+	       start at a+1 and proceed until we have n points
+	       with valid y-values
+	    */
+	    for (m=0, b=a+1; ; b++) {
+		if (!na(y[b]) && ++m == n) {
+		    break;
+		}
+	    }
+	    if (fabs(x[i] - x[a]) < fabs(x[i] - x[b])) {
+		/* the max distance increased: get out */
+		break;
+	    }
+	    /* shift one (valid) place to the right */
+	    a = next_ok_obs(y, a);
+	    n_ok--;
+	}
+	astart[i] = a;
+#if LDEBUG
+	fprintf(stderr, "i=%d: a=%d, n_ok=%d\n", i, a, n_ok);
+#endif
+    }
+}
+
+static int loess_get_local_data (int i, int a,
 				 struct loess_info *lo,
 				 int *xconst)
 {
     const double *x = lo->x->val;
     const double *y = lo->y->val;
     double xk, xk1, xds, h = 0;
-    int n = lo->n, n_ok = lo->n_ok;
+    int n = lo->n;
     int k_skip = -1;
-    int a, b, k, m, t;
+    int k, t;
     int err = 0;
 
     gretl_matrix_zero(lo->Xi);
     gretl_matrix_zero(lo->yi);
     gretl_matrix_zero(lo->wt);
 
-    a = *pa;
-
-#if LDEBUG
-    fprintf(stderr, "\ni=%d, a=%d, n_ok=%d\n", i, a, n_ok);
-#endif
-
-    /* First determine where we should start reading the
-       neighbors of xi: search rightward from a, so far as
-       this is feasible.
-    */
-
-    while (n_ok > n) {
-	/* find b, the next point that would be included if
-	   we move the neighbor set one place to the right:
-	   start at a+1 and proceed until we have n points
-	   with valid y-values
-	*/
-	for (m=0, b=a+1; ; b++) {
-	    if (!na(y[b]) && ++m == n) {
-		break;
-	    }
-	}
-	if (fabs(x[i] - x[a]) < fabs(x[i] - x[b])) {
-	    /* the max distance increased: get out */
-	    break;
-	}
-	/* shift one (valid) place to the right */
-	a = next_ok_obs(y, a);
-	n_ok--;
-    }
-
-    /* record status for next round */
-    *pa = a;
-    lo->n_ok = n_ok;
-
     /* Having found the starting index for the n nearest neighbors
        of xi, transcribe the relevant data into Xi and yi. As we
        go, check whether x is constant in this sub-sample.
@@ -1717,8 +1767,7 @@ static int loess_get_local_data (int i, int *pa,
     }
 
 #if LDEBUG
-    fprintf(stderr, " -> a=%d, n_ok=%d (xconst = %d)\n",
-	    a, n_ok, *xconst);
+    fprintf(stderr, "i=%d: xconst = %d\n", i, *xconst);
 #endif
 
     if (!err) {
@@ -1778,6 +1827,97 @@ static int loess_count_usable_obs (const gretl_matrix *y,
     return n_ok;
 }
 
+/* Sample size above which loess fits the local regressions
+   only at a subset of "vertices" and interpolates between
+   them; and the spacing of the vertices, as a fraction of the
+   size of the local neighborhood (cf. the "cell" parameter in
+   Cleveland's netlib loess).
+*/
+
+#define LOESS_INTERP_MIN 10000
+#define LOESS_CELL 0.2
+
+/* Select the indices of the points at which the local regressions
+   will actually be run: the first and last points plus every m-th
+   point in between, skipping forward past ties so that successive
+   vertices have distinct x-values. Returns the number of vertices.
+*/
+
+static int loess_vertices (const gretl_matrix *x, int n, int *vtx)
+{
+    const double *xv = x->val;
+    int N = gretl_vector_get_length(x);
+    int m = (int) (LOESS_CELL * n);
+    int i, nv = 0;
+
+    if (m < 1) {
+	m = 1;
+    }
+
+    vtx[nv++] = 0;
+    i = m;
+    while (i < N - 1) {
+	while (i < N - 1 && xv[i] == xv[vtx[nv-1]]) {
+	    i++;
+	}
+	if (i < N - 1) {
+	    vtx[nv++] = i;
+	}
+	i += m;
+    }
+    if (N > 1 && xv[N-1] > xv[vtx[nv-1]]) {
+	vtx[nv++] = N - 1;
+    }
+
+    return nv;
+}
+
+/* Fill in the fitted values at the non-vertex points by cubic
+   Hermite interpolation between the bracketing vertices, using
+   the slopes of the local polynomials at the vertices, or by
+   linear interpolation if @slope is NULL (local constant fits).
+*/
+
+static void loess_interpolate (const gretl_matrix *x, gretl_matrix *yh,
+			       const int *vtx, int nv, const double *slope)
+{
+    const double *xv = x->val;
+    int N = gretl_vector_get_length(x);
+    double ya, yb, xa, h, t;
+    int i, a, b, j = 0;
+
+    for (i=0; i<N; i++) {
+	if (j < nv - 1 && i == vtx[j+1]) {
+	    j++;
+	}
+	a = vtx[j];
+	if (i == a) {
+	    continue;
+	}
+	if (j == nv - 1) {
+	    /* tied with the last vertex */
+	    yh->val[i] = yh->val[a];
+	    continue;
+	}
+	b = vtx[j+1];
+	xa = xv[a];
+	h = xv[b] - xa;
+	t = (xv[i] - xa) / h;
+	ya = yh->val[a];
+	yb = yh->val[b];
+	if (slope == NULL) {
+	    yh->val[i] = ya + t * (yb - ya);
+	} else {
+	    double t2 = t * t, t3 = t2 * t;
+
+	    yh->val[i] = (2*t3 - 3*t2 + 1) * ya +
+		(t3 - 2*t2 + t) * h * slope[j] +
+		(3*t2 - 2*t3) * yb +
+		(t3 - t2) * h * slope[j+1];
+	}
+    }
+}
+
 /**
  * loess_fit:
  * @x: x-axis variable (must be pre-sorted).
@@ -1785,7 +1925,7 @@ static int loess_count_usable_obs (const gretl_matrix *y,
  * @d: order for polynomial fit (0 <= d <= 2).
  * @q: bandwidth (0 < q <= 1).
  * @opt: give %OPT_R for robust variant (with re-weighting based on
- * the first-stage residuals).
+ * the first-stage residuals), %OPT_I to force interpolation (see below).
  * @err: location to receive error code.
  *
  * Computes loess estimates based on William Cleveland, "Robust Locally
@@ -1798,6 +1938,12 @@ static int loess_count_usable_obs (const gretl_matrix *y,
  * error is flagged if this is not the case.  See also
  * sort_pairs_by_x().
  *
+ * For large samples (or if %OPT_I is given) the local regressions
+ * are run only at a subset of the points, spaced at about a fifth
+ * of the local neighborhood, and the fitted values at the other
+ * points are obtained by interpolation, as in Cleveland's netlib
+ * loess.
+ *
  * Returns: allocated vector containing the loess fitted values, or
  * %NULL on failure.
  */
@@ -1806,14 +1952,15 @@ gretl_matrix *loess_fit (const gretl_matrix *x, const gretl_matrix *y,
 			 int d, double q, gretlopt opt, int *err)
 {
     struct loess_info lo;
-    gretl_matrix_block *B;
-    gretl_matrix *Xi, *yi, *wt, *b;
     gretl_matrix *yh = NULL;
     gretl_matrix *rw = NULL;
+    int *astart = NULL;
+    int *vtx = NULL;
+    double *slope = NULL;
     int N = gretl_vector_get_length(y);
     int k, iters, Xic, amin = 0;
     int n_ok, robust = 0, loo = 0;
-    int i, n;
+    int n, nfit;
 
     if (d < 0 || d > 2 || q > 1.0) {
 	*err = E_DATA;
@@ -1850,19 +1997,10 @@ gretl_matrix *loess_fit (const gretl_matrix *x, const gretl_matrix *y,
        to compute the x-distance based weights */
     Xic = (d == 0)? 2 : d + 1;
 
-    B = gretl_matrix_block_new(&Xi, n, Xic,
-			       &yi, n, 1,
-			       &wt, n, 1,
-			       &b, d+1, 1,
-			       NULL);
-    if (B == NULL) {
-	*err = E_ALLOC;
-	return NULL;
-    }
-
     /* vector to hold the fitted values */
     yh = gretl_column_vector_alloc(N);
-    if (yh == NULL) {
+    astart = malloc(N * sizeof *astart);
+    if (yh == NULL || astart == NULL) {
 	*err = E_ALLOC;
 	goto bailout;
     }
@@ -1883,88 +2021,151 @@ gretl_matrix *loess_fit (const gretl_matrix *x, const gretl_matrix *y,
     /* fill out the convenience struct */
     lo.y = y;
     lo.x = x;
-    lo.Xi = Xi;
-    lo.yi = yi;
-    lo.wt = wt;
+    lo.Xi = lo.yi = lo.wt = NULL;
     lo.d = d;
     lo.n = n;
     lo.N = N;
+    lo.n_ok = n_ok;
     lo.loo = loo;
 
+    /* astart[i] is the index at which to start reading the
+       n nearest neighbors of x[i] */
+    loess_window_starts(&lo, amin, astart);
+
+    nfit = N;
+    if (!loo && ((opt & OPT_I) || N > LOESS_INTERP_MIN)) {
+	/* fit at the vertices only */
+	vtx = malloc(N * sizeof *vtx);
+	slope = malloc(N * sizeof *slope);
+	if (vtx == NULL || slope == NULL) {
+	    *err = E_ALLOC;
+	    goto bailout;
+	}
+	nfit = loess_vertices(x, n, vtx);
+    }
+
     for (k=0; k<iters && !*err; k++) {
 	/* iterations for robustness, if wanted */
-	int a = amin;
+	int terr = 0;
 
-	lo.n_ok = n_ok;
+#if defined(_OPENMP)
+#pragma omp parallel if (gretl_use_openmp((guint64) nfit * n * Xic))
+#endif
+	{
+	    struct loess_info li = lo;
+	    gretl_matrix_block *B;
+	    gretl_matrix *b = NULL;
+	    int i, j, xconst, ierr = 0;
+
+	    /* per-thread workspace */
+	    B = gretl_matrix_block_new(&li.Xi, n, Xic,
+				       &li.yi, n, 1,
+				       &li.wt, n, 1,
+				       &b, d+1, 1,
+				       NULL);
+	    if (B == NULL) {
+		ierr = E_ALLOC;
+	    }
 
-	for (i=0; i<N && !*err; i++) {
-	    /* iterate across points in full sample */
-	    double xi = x->val[i];
-	    int xconst = 0;
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+	    for (j=0; j<nfit; j++) {
+		/* iterate across points in full sample, or vertices */
+		double xi;
 
-	    /* a is the leftmost possible index for starting to
-	       read the n nearest neighbors of xi.
-	    */
-	    *err = loess_get_local_data(i, &a, &lo, &xconst);
-	    if (*err) {
-		break;
-	    }
+		if (ierr) {
+		    continue;
+		}
 
-	    if (k > 0) {
-		/* We have robustness weights, rw, based on the residuals
-		   from the last round, which should be used to adjust
-		   the wt as computed in loess_get_local_data().
-		*/
-		adjust_weights(rw, wt, a);
-	    }
+		i = (vtx != NULL)? vtx[j] : j;
+		xi = x->val[i];
 
-	    /* apply weights to the local data */
-	    weight_local_data(&lo);
+		ierr = loess_get_local_data(i, astart[i], &li, &xconst);
+		if (ierr) {
+		    continue;
+		}
 
-	    if (d == 0 || xconst) {
-		/* not using x in the regressions: mask the x column(s) */
-		gretl_matrix_reuse(Xi, -1, 1);
-		if (b->rows > 1) {
-		    gretl_matrix_reuse(b, 1, 1);
+		if (k > 0) {
+		    /* We have robustness weights, rw, based on the residuals
+		       from the last round, which should be used to adjust
+		       the wt as computed in loess_get_local_data().
+		    */
+		    adjust_weights(rw, li.wt, astart[i]);
 		}
-	    }
 
-	    /* run local WLS */
-	    *err = gretl_matrix_SVD_ols(yi, Xi, b, NULL, NULL, NULL);
+		/* apply weights to the local data */
+		weight_local_data(&li);
 
-	    if (!*err) {
-		/* yh: evaluate the polynomial at xi */
-		yh->val[i] = b->val[0];
-		if (b->rows > 1) {
-		    yh->val[i] += b->val[1] * xi;
-		    if (b->rows == 3) {
-			yh->val[i] += b->val[2] * xi * xi;
+		if (d == 0 || xconst) {
+		    /* not using x in the regressions: mask the x column(s) */
+		    gretl_matrix_reuse(li.Xi, -1, 1);
+		    if (b->rows > 1) {
+			gretl_matrix_reuse(b, 1, 1);
 		    }
 		}
-		if (robust && k < iters - 1) {
-		    /* save residual for robustness weights */
-		    if (na(y->val[i])) {
-			rw->val[i] = NADBL;
-		    } else {
-			rw->val[i] = y->val[i] - yh->val[i];
+
+		/* run local WLS */
+		ierr = gretl_matrix_SVD_ols(li.yi, li.Xi, b, NULL, NULL, NULL);
+
+		if (!ierr) {
+		    /* yh: evaluate the polynomial at xi */
+		    yh->val[i] = b->val[0];
+		    if (b->rows > 1) {
+			yh->val[i] += b->val[1] * xi;
+			if (b->rows == 3) {
+			    yh->val[i] += b->val[2] * xi * xi;
+			}
+		    }
+		    if (slope != NULL) {
+			/* derivative of the local polynomial at xi */
+			slope[j] = (b->rows > 1)? b->val[1] : 0.0;
+			if (b->rows == 3) {
+			    slope[j] += 2 * b->val[2] * xi;
+			}
 		    }
 		}
+
+		/* ensure matrices are at full size */
+		gretl_matrix_reuse(li.Xi, -1, Xic);
+		gretl_matrix_reuse(b, d+1, -1);
+	    } /* end loop over sample */
+
+	    if (ierr) {
+#if defined(_OPENMP)
+#pragma omp critical
+#endif
+		terr = ierr;
 	    }
+	    gretl_matrix_block_destroy(B);
+	}
 
-	    /* ensure matrices are at full size */
-	    gretl_matrix_reuse(Xi, -1, Xic);
-	    gretl_matrix_reuse(b, d+1, -1);
+	*err = terr;
 
-	} /* end loop over sample */
+	if (!*err && vtx != NULL) {
+	    loess_interpolate(x, yh, vtx, nfit, d > 0 ? slope : NULL);
+	}
 
 	if (!*err && robust && k < iters - 1) {
+	    /* save residuals for robustness weights */
+	    int i;
+
+	    for (i=0; i<N; i++) {
+		if (na(y->val[i])) {
+		    rw->val[i] = NADBL;
+		} else {
+		    rw->val[i] = y->val[i] - yh->val[i];
+		}
+	    }
 	    *err = make_robustness_weights(rw, N);
 	}
     } /* end robustness iterations */
 
  bailout:
 
-    gretl_matrix_block_destroy(B);
+    free(astart);
+    free(vtx);
+    free(slope);
     gretl_matrix_free(rw);
 
     if (*err) {
@@ -2001,3 +2202,572 @@ double kernel_bandwidth (const double *x, int n)
 
     return 0.9 * A * n5;
 }
+
+/* Permutation tests. The reference distribution of a statistic is
+   approximated by recomputing it on random permutations of the data:
+   for two samples the pooled observations are reassigned at random
+   to groups of the original sizes, while for a test of independence
+   the rows of the second sample are permuted relative to those of
+   the first. Rather than running a fixed, large number of
+   permutations we proceed in batches and stop as soon as the
+   p-value is pinned down: either its confidence interval lies
+   wholly on one side of the significance level, so the decision is
+   known, or its half-width falls below the requested precision (see
+   Gandy, JASA 2009, for the rationale). The permutations are drawn
+   serially, so the results do not depend on the number of threads;
+   the built-in statistics are then evaluated in parallel.
+*/
+
+#define PERM_BATCH 100
+#define PERM_MAXINTS (1 << 22) /* limit on stored permutation indices */
+#define PERM_Z 3.2905          /* bounds the risk of a wrong stop at 0.001 */
+
+typedef struct perm_info_ perm_info;
+
+struct perm_info_ {
+    int stat;             /* PermStat code */
+    int na, nb;           /* sizes of the two samples */
+    int n;                /* length of the permutation */
+    int m;                /* number of leading positions to shuffle */
+    double *z;            /* pooled, centered data (two-sample) */
+    double *u, *v;        /* standardized data (correlation) */
+    double tot, totq;     /* sum and sum of squares of @z */
+    const gretl_matrix *A;
+    const gretl_matrix *B;
+    gretl_matrix *Z;      /* pooled rows of @A and @B (two-sample) */
+    gretl_matrix *Ap;     /* workspace: first permuted sample */
+    gretl_matrix *Bp;     /* workspace: second permuted sample */
+    PermStatFunc func;
+    void *data;
+};
+
+/**
+ * perm_stat_from_string:
+ * @s: name of statistic.
+ *
+ * Returns: the #PermStat code for a built-in permutation test
+ * statistic named by @s, or 0 if @s is not recognized.
+ */
+
+int perm_stat_from_string (const char *s)
+{
+    if (s == NULL) {
+        return 0;
+    } else if (!strcmp(s, "mean")) {
+        return PERM_MEAN;
+    } else if (!strcmp(s, "median")) {
+        return PERM_MEDIAN;
+    } else if (!strcmp(s, "welch") || !strcmp(s, "t")) {
+        return PERM_WELCH;
+    } else if (!strcmp(s, "corr")) {
+        return PERM_CORR;
+    } else {
+        return 0;
+    }
+}
+
+static double sorted_median (double *x, int n)
+{
+    qsort(x, n, sizeof *x, gretl_compare_doubles);
+    return (n % 2)? x[n/2] : 0.5 * (x[n/2-1] + x[n/2]);
+}
+
+/* evaluate a built-in statistic for the permutation @idx; @work
+   is needed only for the median
+*/
+
+static double perm_builtin_stat (const perm_info *pi,
+                                 const int *idx,
+                                 double *work)
+{
+    double sa = 0, qa = 0;
+    double ma, mb, va, vb, x;
+    int na = pi->na, nb = pi->nb;
+    int i;
+
+    if (pi->stat == PERM_CORR) {
+        for (i=0; i<pi->n; i++) {
+            sa += pi->u[i] * pi->v[idx[i]];
+        }
+        return sa;
+    } else if (pi->stat == PERM_MEDIAN) {
+        for (i=0; i<pi->n; i++) {
+            work[i] = pi->z[idx[i]];
+        }
+        ma = sorted_median(work, na);
+        mb = sorted_median(work + na, nb);
+        return ma - mb;
+    }
+
+    for (i=0; i<na; i++) {
+        x = pi->z[idx[i]];
+        sa += x;
+        qa += x * x;
+    }
+    ma = sa / na;
+    mb = (pi->tot - sa) / nb;
+
+    if (pi->stat == PERM_MEAN) {
+        return ma - mb;
+    }
+
+    /* Welch t */
+    va = (qa - na * ma * ma) / (na - 1);
+    vb = (pi->totq - qa - nb * mb * mb) / (nb - 1);
+    x = va / na + vb / nb;
+
+    return x > 0 ? (ma - mb) / sqrt(x) : NADBL;
+}
+
+static void copy_perm_rows (gretl_matrix *targ, const gretl_matrix *src,
+                            const int *idx)
+{
+    int i, j;
+
+    for (j=0; j<src->cols; j++) {
+        for (i=0; i<targ->rows; i++) {
+            gretl_matrix_set(targ, i, j, gretl_matrix_get(src, idx[i], j));
+        }
+    }
+}
+
+static double perm_user_stat (perm_info *pi, const int *idx, int *err)
+{
+    if (pi->Z != NULL) {
+        /* two samples */
+        copy_perm_rows(pi->Ap, pi->Z, idx);
+        copy_perm_rows(pi->Bp, pi->Z, idx + pi->na);
+        return pi->func(pi->Ap, pi->Bp, pi->data, err);
+    } else {
+        /* independence */
+        copy_perm_rows(pi->Bp, pi->B, idx);
+        return pi->func(pi->A, pi->Bp, pi->data, err);
+    }
+}
+
+/* copy the non-missing elements of vector @m into @targ, if
+   non-NULL; return the number of such elements
+*/
+
+static int perm_ok_vals (const gretl_matrix *m, double *targ)
+{
+    int i, n = gretl_vector_get_length(m);
+    int k = 0;
+
+    for (i=0; i<n; i++) {
+        if (!na(m->val[i])) {
+            if (targ != NULL) {
+                targ[k] = m->val[i];
+            }
+            k++;
+        }
+    }
+
+    return k;
+}
+
+static int perm_builtin_setup (perm_info *pi)
+{
+    const gretl_matrix *a = pi->A;
+    const gretl_matrix *b = pi->B;
+    double xbar = 0;
+    int i;
+
+    if (gretl_vector_get_length(a) == 0 || gretl_vector_get_length(b) == 0) {
+        gretl_errmsg_set(_("permtest: the built-in statistics require "
+                           "vectors"));
+        return E_INVARG;
+    }
+
+    if (pi->stat == PERM_CORR) {
+        /* complete pairs only */
+        double ubar = 0, vbar = 0, su = 0, sv = 0;
+        int n = gretl_vector_get_length(a);
+        int k = 0;
+
+        if (gretl_vector_get_length(b) != n) {
+            return E_NONCONF;
+        }
+        pi->u = malloc(n * sizeof *pi->u);
+        pi->v = malloc(n * sizeof *pi->v);
+        if (pi->u == NULL || pi->v == NULL) {
+            return E_ALLOC;
+        }
+        for (i=0; i<n; i++) {
+            if (!na(a->val[i]) && !na(b->val[i])) {
+                pi->u[k] = a->val[i];
+                pi->v[k] = b->val[i];
+                ubar += a->val[i];
+                vbar += b->val[i];
+                k++;
+            }
+        }
+        if (k < 3) {
+            return E_TOOFEW;
+        }
+        ubar /= k;
+        vbar /= k;
+        for (i=0; i<k; i++) {
+            pi->u[i] -= ubar;
+            pi->v[i] -= vbar;
+            su += pi->u[i] * pi->u[i];
+            sv += pi->v[i] * pi->v[i];
+        }
+        if (su <= 0 || sv <= 0) {
+            return E_DATA;
+        }
+        su = sqrt(su);
+        sv = sqrt(sv);
+        for (i=0; i<k; i++) {
+            pi->u[i] /= su;
+            pi->v[i] /= sv;
+        }
+        pi->na = pi->nb = pi->n = pi->m = k;
+        return 0;
+    }
+
+    pi->na = perm_ok_vals(a, NULL);
+    pi->nb = perm_ok_vals(b, NULL);
+    if (pi->na < 2 || pi->nb < 2) {
+        return E_TOOFEW;
+    }
+    pi->n = pi->na + pi->nb;
+    pi->m = pi->na;
+    pi->z = malloc(pi->n * sizeof *pi->z);
+    if (pi->z == NULL) {
+        return E_ALLOC;
+    }
+    perm_ok_vals(a, pi->z);
+    perm_ok_vals(b, pi->z + pi->na);
+
+    /* center the data, for the sake of accuracy */
+    for (i=0; i<pi->n; i++) {
+        xbar += pi->z[i];
+    }
+    xbar /= pi->n;
+    pi->tot = pi->totq = 0;
+    for (i=0; i<pi->n; i++) {
+        pi->z[i] -= xbar;
+        pi->tot += pi->z[i];
+        pi->totq += pi->z[i] * pi->z[i];
+    }
+
+    return 0;
+}
+
+static int perm_user_setup (perm_info *pi, int indep)
+{
+    const gretl_matrix *a = pi->A;
+    const gretl_matrix *b = pi->B;
+    int err = 0;
+
+    if (gretl_is_null_matrix(a) || gretl_is_null_matrix(b)) {
+        return E_DATA;
+    }
+
+    if (indep) {
+        if (a->rows != b->rows) {
+            return E_NONCONF;
+        }
+        pi->na = pi->nb = pi->n = pi->m = b->rows;
+        pi->Bp = gretl_matrix_alloc(b->rows, b->cols);
+        if (pi->Bp == NULL) {
+            err = E_ALLOC;
+        }
+    } else {
+        if (a->cols != b->cols) {
+            return E_NONCONF;
+        }
+        pi->na = a->rows;
+        pi->nb = b->rows;
+        pi->n = a->rows + b->rows;
+        pi->m = a->rows;
+        pi->Z = gretl_matrix_row_concat(a, b, &err);
+        if (!err) {
+            pi->Ap = gretl_matrix_alloc(a->rows, a->cols);
+            pi->Bp = gretl_matrix_alloc(b->rows, b->cols);
+            if (pi->Ap == NULL || pi->Bp == NULL) {
+                err = E_ALLOC;
+            }
+        }
+    }
+
+    if (!err && pi->n < 3) {
+        err = E_TOOFEW;
+    }
+
+    return err;
+}
+
+static void perm_info_free (perm_info *pi)
+{
+    free(pi->z);
+    free(pi->u);
+    free(pi->v);
+    gretl_matrix_free(pi->Z);
+    gretl_matrix_free(pi->Ap);
+    gretl_matrix_free(pi->Bp);
+}
+
+static int perm_exceeds (double T, double T0, int side)
+{
+    double tol = 1.0e-10 * (1 + fabs(T0));
+
+    if (na(T)) {
+        /* be conservative */
+        return 1;
+    } else if (side > 0) {
+        return T >= T0 - tol;
+    } else if (side < 0) {
+        return T <= T0 + tol;
+    } else {
+        return fabs(T) >= fabs(T0) - tol;
+    }
+}
+
+static double perm_opt_scalar (gretl_bundle *opts, const char *key,
+                               double deflt, int *err)
+{
+    if (opts != NULL && gretl_bundle_has_key(opts, key)) {
+        return gretl_bundle_get_scalar(opts, key, err);
+    } else {
+        return deflt;
+    }
+}
+
+/**
+ * permutation_test:
+ * @a: first sample.
+ * @b: second sample.
+ * @stat: #PermStat code for the test statistic.
+ * @func: function to compute the statistic, if @stat is %PERM_USER.
+ * @data: data pointer passed to @func.
+ * @opts: optional bundle of settings, or NULL.
+ * @err: location to receive error code.
+ *
+ * Performs a permutation test for the given statistic. If @stat
+ * is %PERM_CORR, or @opts contains a non-zero integer "indep", the
+ * rows of @b are permuted relative to those of @a, to test their
+ * independence; otherwise the rows of @a and @b are pooled and
+ * reassigned at random to two groups of the original sizes, to
+ * test for a difference in distribution. For the built-in
+ * statistics @a and @b must be vectors, and missing values are
+ * skipped. Besides "indep", @opts may contain "maxperm", the
+ * maximum number of permutations (default 9999); "alpha", the
+ * significance level relative to which the test may be stopped
+ * early (default 0.05, 0 to disable); "eps", the precision at which
+ * the p-value is deemed to be determined (default 0.005); and
+ * "side", which selects a two-sided test based on absolute values
+ * (0, the default), or an upper (1) or lower (-1) tail test.
+ *
+ * Returns: a bundle holding the statistic, the p-value and the
+ * number of permutations performed, or NULL on failure.
+ */
+
+gretl_bundle *permutation_test (const gretl_matrix *a,
+                                const gretl_matrix *b,
+                                int stat, PermStatFunc func,
+                                void *data, gretl_bundle *opts,
+                                int *err)
+{
+    perm_info pi = {0};
+    gretl_bundle *ret = NULL;
+    double *T = NULL;
+    int *cur = NULL;
+    int *P = NULL;
+    double alpha, eps;
+    double T0 = NADBL;
+    double pv = 1, h = 0;
+    int maxperm, side, indep;
+    int nperm = 0, count = 0;
+    int stopped = 0;
+    int chunk, i, j;
+
+    if (a == NULL || b == NULL || stat < PERM_MEAN || stat > PERM_USER ||
+        (stat == PERM_USER && func == NULL)) {
+        *err = E_INVARG;
+        return NULL;
+    }
+
+    maxperm = (int) perm_opt_scalar(opts, "maxperm", 9999, err);
+    alpha = perm_opt_scalar(opts, "alpha", 0.05, err);
+    eps = perm_opt_scalar(opts, "eps", 0.005, err);
+    side = (int) perm_opt_scalar(opts, "side", 0, err);
+    indep = (int) perm_opt_scalar(opts, "indep", 0, err);
+    if (*err) {
+        return NULL;
+    } else if (maxperm < 1 || alpha < 0 || alpha >= 1 || eps < 0 ||
+               abs(side) > 1) {
+        *err = E_INVARG;
+        return NULL;
+    }
+
+    if (stat == PERM_CORR) {
+        indep = 1;
+    } else if (indep && stat != PERM_USER) {
+        gretl_errmsg_set(_("permtest: this statistic is for two samples"));
+        *err = E_INVARG;
+        return NULL;
+    }
+
+    pi.stat = stat;
+    pi.A = a;
+    pi.B = b;
+    pi.func = func;
+    pi.data = data;
+
+    if (stat == PERM_USER) {
+        *err = perm_user_setup(&pi, indep);
+    } else {
+        *err = perm_builtin_setup(&pi);
+    }
+    if (*err) {
+        goto bailout;
+    }
+
+    chunk = PERM_MAXINTS / pi.n;
+    chunk = chunk < 1 ? 1 : chunk > PERM_BATCH ? PERM_BATCH : chunk;
+    cur = malloc(pi.n * sizeof *cur);
+    P = malloc((size_t) chunk * pi.n * sizeof *P);
+    T = malloc(chunk * sizeof *T);
+    if (cur == NULL || P == NULL || T == NULL) {
+        *err = E_ALLOC;
+        goto bailout;
+    }
+
+    /* the observed statistic */
+    for (i=0; i<pi.n; i++) {
+        cur[i] = i;
+    }
+    if (stat == PERM_USER) {
+        T0 = perm_user_stat(&pi, cur, err);
+    } else {
+        double *work = (stat == PERM_MEDIAN)? malloc(pi.n * sizeof *work) : NULL;
+
+        if (stat == PERM_MEDIAN && work == NULL) {
+            *err = E_ALLOC;
+        } else {
+            T0 = perm_builtin_stat(&pi, cur, work);
+        }
+        free(work);
+    }
+    if (!*err && na(T0)) {
+        gretl_errmsg_set(_("permtest: the statistic is not defined "
+                           "for the given data"));
+        *err = E_DATA;
+    }
+
+    while (!*err && nperm < maxperm && !stopped) {
+        int nb = maxperm - nperm;
+        int done, nc;
+
+        if (nb > PERM_BATCH) {
+            nb = PERM_BATCH;
+        }
+
+        for (done=0; done<nb && !*err; done+=nc) {
+            nc = nb - done < chunk ? nb - done : chunk;
+
+            /* Fisher-Yates, applied to the last permutation. For two
+               samples only the leading @m = na positions need to be
+               shuffled, giving a random subset for the first group,
+               since the statistics do not depend on the order of the
+               observations within a group.
+            */
+            for (j=0; j<nc; j++) {
+                int *ix = P + (size_t) j * pi.n;
+
+                for (i=0; i<pi.m; i++) {
+                    int s = i + gretl_rand_int_max(pi.n - i);
+                    int tmp = cur[i];
+
+                    cur[i] = cur[s];
+                    cur[s] = tmp;
+                }
+                memcpy(ix, cur, pi.n * sizeof *ix);
+            }
+
+            if (stat == PERM_USER) {
+                /* callbacks are not thread-safe */
+                for (j=0; j<nc && !*err; j++) {
+                    T[j] = perm_user_stat(&pi, P + (size_t) j * pi.n, err);
+                }
+            } else {
+                int terr = 0;
+
+#if defined(_OPENMP)
+#pragma omp parallel if (gretl_use_openmp((guint64) nc * pi.n))
+#endif
+                {
+                    double *work = NULL;
+
+                    if (stat == PERM_MEDIAN) {
+                        work = malloc(pi.n * sizeof *work);
+                        if (work == NULL) {
+#if defined(_OPENMP)
+#pragma omp critical
+#endif
+                            terr = E_ALLOC;
+                        }
+                    }
+#if defined(_OPENMP)
+#pragma omp for
+#endif
+                    for (j=0; j<nc; j++) {
+                        if (stat != PERM_MEDIAN || work != NULL) {
+                            T[j] = perm_builtin_stat(&pi, P + (size_t) j * pi.n,
+                                                     work);
+                        }
+                    }
+                    free(work);
+                }
+                *err = terr;
+            }
+
+            for (j=0; j<nc && !*err; j++) {
+                count += perm_exceeds(T[j], T0, side);
+            }
+        }
+        if (*err) {
+            break;
+        }
+        nperm += nb;
+
+        /* can we stop now? */
+        pv = (count + 1.0) / (nperm + 1.0);
+        h = PERM_Z * sqrt(pv * (1 - pv) / (nperm + 1.0));
+        if (nperm < maxperm) {
+            if (h <= eps) {
+                stopped = 1;
+            } else if (alpha > 0 && (pv - h > alpha || pv + h < alpha)) {
+                stopped = 1;
+            }
+        }
+    }
+
+    if (!*err) {
+        ret = gretl_bundle_new();
+        if (ret == NULL) {
+            *err = E_ALLOC;
+        } else {
+            gretl_bundle_set_scalar(ret, "stat", T0);
+            gretl_bundle_set_scalar(ret, "pvalue", pv);
+            gretl_bundle_set_scalar(ret, "se", sqrt(pv * (1 - pv) / (nperm + 1.0)));
+            gretl_bundle_set_int(ret, "nperm", nperm);
+            gretl_bundle_set_int(ret, "count", count);
+            gretl_bundle_set_int(ret, "stopped", stopped);
+            gretl_bundle_set_int(ret, "side", side);
+            gretl_bundle_set_int(ret, "n1", pi.na);
+            gretl_bundle_set_int(ret, "n2", pi.nb);
+        }
+    }
+
+ bailout:
+
+    free(cur);
+    free(P);
+    free(T);
+    perm_info_free(&pi);
+
+    return ret;
+}
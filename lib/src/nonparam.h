@@ -68,4 +68,24 @@ gretl_matrix *loess_fit (const gretl_matrix *x,
 
 double kernel_bandwidth(const double *x, int n);
 
+typedef enum {
+    PERM_MEAN = 1,  /* difference of means */
+    PERM_MEDIAN,    /* difference of medians */
+    PERM_WELCH,     /* Welch t statistic */
+    PERM_CORR,      /* correlation, for a test of independence */
+    PERM_USER       /* caller-supplied statistic */
+} PermStat;
+
+typedef double (*PermStatFunc) (const gretl_matrix *a,
+				const gretl_matrix *b,
+				void *data, int *err);
+
+int perm_stat_from_string (const char *s);
+
+gretl_bundle *permutation_test (const gretl_matrix *a,
+				const gretl_matrix *b,
+				int stat, PermStatFunc func,
+				void *data, gretl_bundle *opts,
+				int *err);
+
 #endif /* NONPARAM_H */
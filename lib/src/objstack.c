@@ -37,13 +37,43 @@ struct stacker_ {
     void *ptr;
 };
 
-static stacker *ostack;
-static int n_obj;
-static int n_sys;
-static int n_vars;
+/* The stack of saved objects, with the "last model" and the
+   record of protected models (see below). Ordinarily there is
+   one such stack for the whole program, but a thread that calls
+   libgretl_thread_init() gets a stack of its own; other threads,
+   OpenMP workers included, see the program-wide one.
+*/
+
+typedef struct obj_table_ obj_table;
+
+struct obj_table_ {
+    stacker *ostack;
+    int n_obj;
+    int n_sys;
+    int n_vars;
+    stacker last_model;
+    stacker genr_model;
+    MODEL **protected_models;
+    int n_prot;
+};
+
+static obj_table main_objs;
+static obj_table *thread_objs;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(thread_objs)
+#endif
+
+#define objs (thread_objs != NULL ? thread_objs : &main_objs)
 
-static stacker last_model;
-static stacker genr_model;
+#define ostack           (objs->ostack)
+#define n_obj            (objs->n_obj)
+#define n_sys            (objs->n_sys)
+#define n_vars           (objs->n_vars)
+#define last_model       (objs->last_model)
+#define genr_model       (objs->genr_model)
+#define protected_models (objs->protected_models)
+#define n_prot           (objs->n_prot)
 
 static GretlObjType get_stacked_type_by_data (void *ptr)
 {
@@ -155,6 +185,10 @@ enum {
 
 static int unstack_replace;
 
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(unstack_replace)
+#endif
+
 static void gretl_object_unstack (void *ptr, int action)
 {
     int i, pos = -1;
@@ -233,9 +267,6 @@ static void gretl_object_destroy (void *ptr, GretlObjType type)
    "protected species" list.
 */
 
-static MODEL **protected_models;
-static int n_prot;
-
 int gretl_model_protect (MODEL *pmod)
 {
     MODEL **prmod;
@@ -1470,6 +1501,22 @@ last_model_get_irf_matrix (int targ, int shock, double alpha,
     return M;
 }
 
+gretl_matrix *
+last_model_get_var_paths (int h, int npaths, const DATASET *dset,
+			  int *err)
+{
+    stacker *smatch = find_smatch(NULL);
+    gretl_matrix *M = NULL;
+
+    if (smatch == NULL || smatch->type != GRETL_OBJ_VAR) {
+	*err = E_BADSTAT;
+    } else {
+	M = gretl_VAR_simulate_paths(smatch->ptr, h, npaths, dset, err);
+    }
+
+    return M;
+}
+
 gretl_matrix *last_model_get_boot_ci (int cnum,
 				      const DATASET *dset,
 				      int B,
@@ -1934,6 +1981,77 @@ int n_stacked_models (void)
     return n;
 }
 
+/* Approximate number of bytes held by a single-equation model:
+   the struct itself plus its principal arrays. */
+
+static gint64 model_mem_size (const MODEL *pmod)
+{
+    gint64 k = pmod->ncoeff;
+    gint64 n = pmod->full_n;
+    gint64 sz = sizeof *pmod;
+
+    if (pmod->coeff != NULL) sz += k * sizeof(double);
+    if (pmod->sderr != NULL) sz += k * sizeof(double);
+    if (pmod->uhat != NULL) sz += n * sizeof(double);
+    if (pmod->yhat != NULL) sz += n * sizeof(double);
+    if (pmod->xpx != NULL) sz += k * (k + 1) / 2 * sizeof(double);
+    if (pmod->vcv != NULL) sz += k * (k + 1) / 2 * sizeof(double);
+
+    return sz;
+}
+
+/**
+ * saved_models_mem_size:
+ * @nmod: location to receive the number of models counted.
+ *
+ * For the purposes of memory accounting: counts the models
+ * on the stack of saved objects plus the "last model", if
+ * that is not itself stacked. Systems and VARs contribute
+ * only the size of their top-level structs.
+ *
+ * Returns: the approximate number of bytes held by those models.
+ */
+
+gint64 saved_models_mem_size (int *nmod)
+{
+    gint64 sz = 0;
+    int last_stacked = 0;
+    int i, n = 0;
+
+    for (i=0; i<n_obj; i++) {
+	void *ptr = ostack[i].ptr;
+
+	if (ptr == NULL) {
+	    continue;
+	} else if (ptr == last_model.ptr) {
+	    last_stacked = 1;
+	}
+	if (ostack[i].type == GRETL_OBJ_EQN) {
+	    sz += model_mem_size(ptr);
+	} else if (ostack[i].type == GRETL_OBJ_VAR) {
+	    sz += sizeof(GRETL_VAR);
+	} else {
+	    sz += sizeof(equation_system);
+	}
+	n++;
+    }
+
+    if (!last_stacked && last_model.ptr != NULL) {
+	if (last_model.type == GRETL_OBJ_EQN) {
+	    sz += model_mem_size(last_model.ptr);
+	} else if (last_model.type == GRETL_OBJ_VAR) {
+	    sz += sizeof(GRETL_VAR);
+	} else {
+	    sz += sizeof(equation_system);
+	}
+	n++;
+    }
+
+    *nmod = n;
+
+    return sz;
+}
+
 void gretl_saved_objects_cleanup (void)
 {
     void *lmp = last_model.ptr;
@@ -1984,3 +2102,43 @@ void gretl_saved_objects_cleanup (void)
 	last_model.type = 0;
     }
 }
+
+/**
+ * gretl_objects_thread_init:
+ *
+ * Gives the calling thread an empty stack of saved objects of
+ * its own, in place of the program-wide one. Called by
+ * libgretl_thread_init().
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int gretl_objects_thread_init (void)
+{
+    if (thread_objs == NULL) {
+	thread_objs = calloc(1, sizeof *thread_objs);
+	if (thread_objs == NULL) {
+	    return E_ALLOC;
+	}
+    }
+
+    return 0;
+}
+
+/**
+ * gretl_objects_thread_cleanup:
+ *
+ * Frees the saved objects belonging to the calling thread, if
+ * it has a stack of its own, and reverts the thread to the
+ * program-wide stack.
+ */
+
+void gretl_objects_thread_cleanup (void)
+{
+    if (thread_objs != NULL) {
+	gretl_saved_objects_cleanup();
+	free(protected_models);
+	free(thread_objs);
+	thread_objs = NULL;
+    }
+}
@@ -141,6 +141,10 @@ gretl_matrix *
 last_model_get_irf_matrix (int targ, int shock, double alpha,
 			   const DATASET *dset, int *err);
 
+gretl_matrix *
+last_model_get_var_paths (int h, int npaths, const DATASET *dset,
+			  int *err);
+
 void *saved_object_get_array (const char *oname, int idx,
 			      const DATASET *dset,
 			      int *err);
@@ -194,10 +198,16 @@ int check_models_for_subsample (char *newmask, int *ndropped);
 
 int n_stacked_models (void);
 
+gint64 saved_models_mem_size (int *nmod);
+
 void set_gui_model_list_callback (GList *(*callback)(GList *));
 
 void gretl_saved_objects_cleanup (void);
 
+int gretl_objects_thread_init (void);
+
+void gretl_objects_thread_cleanup (void);
+
 #ifdef  __cplusplus
 }
 #endif
@@ -253,6 +253,7 @@ struct gretl_option gretl_opts[] = {
     { DPANEL,   OPT_V, "verbose", 0 },
     { DPANEL,   OPT_X, "dpdstyle", 0 },
     { DPANEL,   OPT_C, "collapse", 0 },
+    { DPANEL,   OPT_S, "sparse", 0 },
     { DUMMIFY,  OPT_F, "drop-first", 0 },
     { DUMMIFY,  OPT_L, "drop-last", 0 },
     { DURATION, OPT_B, "weibull", 0 },
@@ -309,6 +310,7 @@ struct gretl_option gretl_opts[] = {
     { GARCH,    OPT_R, "robust", 0 },
     { GARCH,    OPT_V, "verbose", 0 },
     { GARCH,    OPT_Z, "stdresid", 0 },
+    { GIBBS,    OPT_C, "chains", 2 },
     { GIBBS,    OPT_K, "keep", 0 },
     { GIBBS,    OPT_Q, "quiet", 0 },
     { GIBBS,    OPT_T, "thinning", 2 },
@@ -393,6 +395,7 @@ struct gretl_option gretl_opts[] = {
     { JOIN,     OPT_R, "frompkg", 2 },
     { KDPLOT,   OPT_O, "alt", 0 },
     { KDPLOT,   OPT_S, "scale", 2},
+    { KDPLOT,   OPT_X, "exact", 0 },
     { KPSS,     OPT_T, "trend", 0 },
     { KPSS,     OPT_D, "seasonals", 0 },
     { KPSS,     OPT_V, "verbose", 0 },
@@ -455,6 +458,7 @@ struct gretl_option gretl_opts[] = {
     { LOGIT,    OPT_S, "estrella", 0 },
     { LOGIT,    OPT_N, "no-qr", 0 },
     { LOOP,     OPT_D, "decr", 0 },
+    { LOOP,     OPT_L, "parallel", 0 },
     { LOOP,     OPT_P, "progressive", 0 },
     { LOOP,     OPT_V, "verbose", 0 },
     { MAHAL,    OPT_S, "save", 0 },
@@ -523,6 +527,7 @@ struct gretl_option gretl_opts[] = {
     { OPEN,     OPT_D, "drop-empty", 0 },
     { OPEN,     OPT_E, "select", 2 },
     { OPEN,     OPT_F, "fixed-cols", 2 },
+    { OPEN,     OPT_G, "filter", 2 },
     { OPEN,     OPT_O, "odbc", 0 },
     { OPEN,     OPT_P, "preserve", 0 },
     { OPEN,     OPT_R, "rowoffset", 2 },
@@ -531,11 +536,13 @@ struct gretl_option gretl_opts[] = {
     { OPEN,     OPT_W, "www", 0 },
     { OPEN,     OPT_L, "cols", 2 },
     { OPEN,     OPT_M, "rowmask", 2 },
+    { OPEN,     OPT_N, "mmap", 0 },
     { OPEN,     OPT_V, "verbose", 0 },
     { OPEN,     OPT_K, "frompkg", 2 },
     { OPEN,     OPT_H, "no-header", 0 },
     { OPEN,     OPT_I, "ignore-quotes", 0 },
     { OPEN,     OPT_U, "bundle", 2 },
+    { OPEN,     OPT_Z, "obs", 2 },
     { OUTFILE,  OPT_A, "append", 0 },
     { OUTFILE,  OPT_Q, "quiet", 0 },
     { OUTFILE,  OPT_D, "decpoint", 0 },
@@ -546,6 +553,7 @@ struct gretl_option gretl_opts[] = {
     { PANEL,    OPT_D, "time-dummies", 1 },
     { PANEL,    OPT_E, "nerlove", 0 },
     { PANEL,    OPT_F, "fixed-effects", 0 },
+    { PANEL,    OPT_G, "absorb", 2 },
     { PANEL,    OPT_I, "iterate", 0 },
     { PANEL,    OPT_M, "matrix-diff", 0 },
     { PANEL,    OPT_N, "no-df-corr", 0 },
@@ -565,6 +573,7 @@ struct gretl_option gretl_opts[] = {
     { PANPLOT,  OPT_Y, "single-yaxis", 0 },
     { PANSPEC,  OPT_M, "matrix-diff", 0 },
     { PANSPEC,  OPT_N, "nerlove", 0 },
+    { POISSON,  OPT_G, "absorb", 2 },
     { POISSON,  OPT_R, "robust", 0 },
     { POISSON,  OPT_C, "cluster", 2 },
     { POISSON,  OPT_V, "verbose", 0 },
@@ -572,6 +581,8 @@ struct gretl_option gretl_opts[] = {
     { PCA,      OPT_A, "save-all", 0 },
     { PCA,      OPT_O, "save", 1 },
     { PCA,      OPT_Q, "quiet", 0 },
+    { PCA,      OPT_K, "components", 2 },
+    { PCA,      OPT_I, "incremental", 0 },
     { PERGM,    OPT_O, "bartlett", 0 },
     { PERGM,    OPT_L, "log", 0 },
     { PERGM,    OPT_R, "radians", 0 },
@@ -591,6 +602,7 @@ struct gretl_option gretl_opts[] = {
     { PRINT,    OPT_Y, "tree", 0 },
     { PRINT,    OPT_R, "range", 2 },
     { PRINT,    OPT_X, "data-only", 0 },
+    { PRINT,    OPT_Q, "quantiles", 0 },
     { PROBIT,   OPT_P, "p-values", 0 },
     { PROBIT,   OPT_R, "robust", 0 },
     { PROBIT,   OPT_C, "cluster", 2 },
@@ -664,12 +676,14 @@ struct gretl_option gretl_opts[] = {
     { STDIZE,   OPT_C, "center-only", 0 },
     { STDIZE,   OPT_N, "no-df-corr", 0 },
     { STORE,    OPT_A, "matrix", 2 },
+    { STORE,    OPT_C, "compress", 1 },
     { STORE,    OPT_D, "database", 0 },
     { STORE,    OPT_E, "comment", 2 },
     { STORE,    OPT_F, "overwrite", 0 },
     { STORE,    OPT_G, "dat", 0 },
     { STORE,    OPT_I, "decimal-comma", 0 },
     { STORE,    OPT_J, "jmulti", 0 },
+    { STORE,    OPT_K, "mmap", 0 },
     { STORE,    OPT_L, "lcnames", 0 },
     { STORE,    OPT_M, "gnu-octave", 0 },
     { STORE,    OPT_N, "no-header", 0 },
@@ -1020,8 +1034,29 @@ struct stored_opt_ {
     int fd;       /* "function depth" at which registered */
 };
 
-static stored_opt *optinfo;
-static int n_stored_opts;
+/* The stored options: as with user variables, a thread that calls
+   libgretl_thread_init() gets a set of its own, while other
+   threads, OpenMP workers included, see the program-wide set.
+*/
+
+typedef struct opt_store_ opt_store;
+
+struct opt_store_ {
+    stored_opt *optinfo;
+    int n_stored_opts;
+};
+
+static opt_store main_opts;
+static opt_store *thread_opts;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(thread_opts)
+#endif
+
+#define ostore (thread_opts != NULL ? thread_opts : &main_opts)
+
+#define optinfo       (ostore->optinfo)
+#define n_stored_opts (ostore->n_stored_opts)
 
 static void clear_one_option (stored_opt *so)
 {
@@ -1103,6 +1138,45 @@ void stored_options_cleanup (void)
     n_stored_opts = 0;
 }
 
+/**
+ * stored_options_thread_init:
+ *
+ * Gives the calling thread an empty set of stored options of its
+ * own, in place of the program-wide set. Called by
+ * libgretl_thread_init().
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int stored_options_thread_init (void)
+{
+    if (thread_opts == NULL) {
+        thread_opts = calloc(1, sizeof *thread_opts);
+        if (thread_opts == NULL) {
+            return E_ALLOC;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * stored_options_thread_cleanup:
+ *
+ * Frees the stored options belonging to the calling thread, if it
+ * has a set of its own, and reverts the thread to the program-wide
+ * set.
+ */
+
+void stored_options_thread_cleanup (void)
+{
+    if (thread_opts != NULL) {
+        stored_options_cleanup();
+        free(thread_opts);
+        thread_opts = NULL;
+    }
+}
+
 /* scrub just those options set via "setopt" */
 
 void setopt_cleanup (void)
@@ -84,6 +84,10 @@ void clear_stored_options_for_command (int ci);
 
 void stored_options_cleanup (void);
 
+int stored_options_thread_init (void);
+
+void stored_options_thread_cleanup (void);
+
 void setopt_cleanup (void);
 
 void option_printing_cleanup (void);
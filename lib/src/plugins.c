@@ -99,7 +99,9 @@ enum {
     P_PUREBIN,
     P_BDSTEST,
     P_LPSOLVE,
-    P_STEPWISE
+    P_STEPWISE,
+    P_GENJIT,
+    P_ARROW
 } plugin_codes;
 
 struct plugin_info {
@@ -111,6 +113,7 @@ struct plugin_info {
 struct plugin_function_info {
     const char *name;   /* name of function */
     int index;          /* index of the plugin that supplies it */
+    void *addr;         /* address, once resolved */
 };
 
 struct plugin_info plugins[] = {
@@ -165,7 +168,9 @@ struct plugin_info plugins[] = {
     { P_PUREBIN,         "purebin",         NULL },
     { P_BDSTEST,         "bdstest",         NULL },
     { P_LPSOLVE,         "lpsolve",         NULL },
-    { P_STEPWISE,        "stepwise",        NULL }
+    { P_STEPWISE,        "stepwise",        NULL },
+    { P_GENJIT,          "genjit",          NULL },
+    { P_ARROW,           "arrow_io",        NULL }
 };
 
 struct plugin_function_info plugin_functions[] = {
@@ -175,8 +180,11 @@ struct plugin_function_info plugin_functions[] = {
     { "gnumeric_get_data", P_GNUMERIC_IMPORT },
     { "ods_get_data",      P_ODS_IMPORT },
     { "wf1_get_data",      P_EVIEWS_IMPORT },
+    { "wf1_get_data_subset", P_EVIEWS_IMPORT },
     { "dta_get_data",      P_STATA_IMPORT },
+    { "dta_get_data_subset", P_STATA_IMPORT },
     { "sav_get_data",      P_SPSS_IMPORT },
+    { "sav_get_data_subset", P_SPSS_IMPORT },
     { "xport_get_data",    P_SAS_IMPORT },
     { "jmulti_get_data",   P_JMULTI_IMPORT },
 
@@ -256,6 +264,7 @@ struct plugin_function_info plugin_functions[] = {
 
     /* Dickey-Fuller test p-values */
     { "mackinnon_pvalue",  P_URCDIST },
+    { "mackinnon_pvalues", P_URCDIST },
     { "dfgls_pvalue",      P_URCDIST },
 
     /* kernel density estimation */
@@ -340,10 +349,28 @@ struct plugin_function_info plugin_functions[] = {
     /* interface to lpsolve library */
     { "gretl_lpsolve", P_LPSOLVE},
 
+    /* native code for compiled genrs */
+    { "genvm_jit_compile", P_GENJIT},
+    { "genvm_jit_destroy", P_GENJIT},
+
+    /* Parquet and Arrow IPC data files */
+    { "arrow_get_data", P_ARROW},
+    { "arrow_export",   P_ARROW},
+
     /* sentinel */
     { NULL, 0 }
 };
 
+/* Plugins, once opened, stay open until plugins_cleanup() is
+   called, and the address of each plugin function is cached in
+   plugin_functions[] when first resolved; so after first use,
+   get_plugin_function() costs only a hash look-up. The lock
+   guards the opening of plugins and the resolution of symbols,
+   which may be requested from more than one thread.
+*/
+
+G_LOCK_DEFINE_STATIC(plugins);
+
 static GHashTable *gretl_plugin_hash_init (void)
 {
     GHashTable *ht;
@@ -351,22 +378,21 @@ static GHashTable *gretl_plugin_hash_init (void)
 
     ht = g_hash_table_new(g_str_hash, g_str_equal);
 
-    /* Record the plugin index of each plugin function
-       in a hash table under the key of the function
-       name, permitting quick look-up.
+    /* Record the plugin-function info for each plugin function
+       in a hash table under the key of the function name,
+       permitting quick look-up.
     */
     for (i=0; plugin_functions[i].name != NULL; i++) {
 	g_hash_table_insert(ht, (gpointer) plugin_functions[i].name,
-			    GINT_TO_POINTER(plugin_functions[i].index));
+			    &plugin_functions[i]);
     }
 
     return ht;
 }
 
-static int plugin_index_lookup (const char *name)
+static struct plugin_function_info *plugin_function_lookup (const char *name)
 {
     static GHashTable *pht;
-    gpointer ptr;
 
     if (name == NULL) {
 	/* cleanup signal */
@@ -374,17 +400,15 @@ static int plugin_index_lookup (const char *name)
 	    g_hash_table_destroy(pht);
 	    pht = NULL;
 	}
-	return 0;
+	return NULL;
     }
 
-    if (pht == NULL) {
+    if (g_once_init_enter(&pht)) {
 	/* construct hash table if not already done */
-	pht = gretl_plugin_hash_init();
+	g_once_init_leave(&pht, gretl_plugin_hash_init());
     }
 
-    ptr = g_hash_table_lookup(pht, name);
-
-    return ptr == NULL ? 0 : GPOINTER_TO_INT(ptr);
+    return g_hash_table_lookup(pht, name);
 }
 
 /**
@@ -508,8 +532,34 @@ void plugins_cleanup (void)
 	}
     }
 
+    /* forget the cached function addresses */
+    for (i=0; plugin_functions[i].name != NULL; i++) {
+	plugin_functions[i].addr = NULL;
+    }
+
     /* tear down the plugin look-up hash table */
-    plugin_index_lookup(NULL);
+    plugin_function_lookup(NULL);
+}
+
+/* Resolve the function described by @pf, with the lock held */
+
+static void *resolve_plugin_function (struct plugin_function_info *pf)
+{
+    void *funp = pf->addr;
+
+    if (funp == NULL) {
+	void *handle = get_plugin_handle_by_index(pf->index);
+
+	if (handle != NULL) {
+	    funp = get_function_address(handle, pf->name);
+	    g_atomic_pointer_set(&pf->addr, funp);
+	} else {
+	    fprintf(stderr, "%s: get_function_address failed\n",
+		    pf->name);
+	}
+    }
+
+    return funp;
 }
 
 /**
@@ -525,27 +575,25 @@ void plugins_cleanup (void)
 
 void *get_plugin_function (const char *funcname)
 {
-    int i = plugin_index_lookup(funcname);
+    struct plugin_function_info *pf = plugin_function_lookup(funcname);
     void *funp = NULL;
 
 #if !HAVE_GMP
-    if (i == P_MP_OLS) {
+    if (pf != NULL && pf->index == P_MP_OLS) {
 	gretl_errmsg_set("GMP is not supported in this build");
 	return NULL;
     }
 #endif
 
-    if (i > 0) {
-	void *handle = get_plugin_handle_by_index(i);
-
-	if (handle != NULL) {
-	    funp = get_function_address(handle, funcname);
-	} else {
-	    fprintf(stderr, "%s: get_function_address failed\n",
-		    funcname);
+    if (pf != NULL) {
+	funp = g_atomic_pointer_get(&pf->addr);
+	if (funp == NULL) {
+	    G_LOCK(plugins);
+	    funp = resolve_plugin_function(pf);
+	    G_UNLOCK(plugins);
 	}
     } else {
-	fprintf(stderr, "%s: plugin_index_lookup failed\n",
+	fprintf(stderr, "%s: plugin_function_lookup failed\n",
 		funcname);
     }
 
@@ -556,6 +604,63 @@ void *get_plugin_function (const char *funcname)
     return funp;
 }
 
+/**
+ * preload_plugins:
+ * @s: names of plugins, separated by commas or spaces.
+ *
+ * Opens each of the plugins named in @s, if it is not already
+ * open, and resolves all the functions that it offers, so that
+ * the first use of these functions incurs no loading cost. This
+ * is the effect of "set preload_plugins".
+ *
+ * Returns: 0 on success, non-zero code if any of the plugins is
+ * unknown or cannot be loaded.
+ */
+
+int preload_plugins (const char *s)
+{
+    int n = sizeof(plugins) / sizeof(plugins[0]);
+    gchar **S;
+    int i, j, k;
+    int err = 0;
+
+    if (s == NULL || *s == '\0') {
+	return E_ARGS;
+    }
+
+    S = g_strsplit_set(s, ", ", -1);
+
+    for (j=0; S[j] != NULL && !err; j++) {
+	if (*S[j] == '\0') {
+	    continue;
+	}
+	for (i=1; i<n; i++) {
+	    if (!strcmp(S[j], plugins[i].pname)) {
+		break;
+	    }
+	}
+	if (i == n) {
+	    gretl_errmsg_sprintf(_("Unknown plugin '%s'"), S[j]);
+	    err = E_INVARG;
+	    break;
+	}
+	G_LOCK(plugins);
+	if (get_plugin_handle_by_index(i) == NULL) {
+	    err = E_EXTERNAL;
+	}
+	for (k=0; plugin_functions[k].name != NULL && !err; k++) {
+	    if (plugin_functions[k].index == i) {
+		resolve_plugin_function(&plugin_functions[k]);
+	    }
+	}
+	G_UNLOCK(plugins);
+    }
+
+    g_strfreev(S);
+
+    return err;
+}
+
 /* For use with valgrind: if you want to trace memory leaks into
    plugin code you have to keep the plugins open at program
    termination. So you can define this as non-zero temporarily.
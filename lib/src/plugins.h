@@ -28,6 +28,8 @@ void *get_plugin_function (const char *funcname);
 
 void close_plugin (void *handle);
 
+int preload_plugins (const char *s);
+
 void plugins_cleanup (void);
 
 #endif /* PLUGINS_H */
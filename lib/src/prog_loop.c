@@ -143,6 +143,139 @@ static int loop_model_start (LOOP_MODEL *lmod, MODEL *pmod)
     return err;
 }
 
+/* The quantiles reported for "print --quantiles" */
+
+#define N_LOOP_QUANTILES 3
+
+static const double loop_quantiles[N_LOOP_QUANTILES] = {
+    0.05, 0.5, 0.95
+};
+
+static void p2_init (P2_QUANTILE *pq, double p)
+{
+    int i;
+
+    pq->n = 0;
+    for (i=0; i<5; i++) {
+        pq->q[i] = NADBL;
+        pq->pos[i] = i + 1;
+    }
+    pq->dpos[0] = 1;
+    pq->dpos[1] = 1 + 2*p;
+    pq->dpos[2] = 1 + 4*p;
+    pq->dpos[3] = 3 + 2*p;
+    pq->dpos[4] = 5;
+    pq->inc[0] = 0;
+    pq->inc[1] = p/2;
+    pq->inc[2] = p;
+    pq->inc[3] = (1 + p)/2;
+    pq->inc[4] = 1;
+}
+
+static void p2_update (P2_QUANTILE *pq, double x)
+{
+    double *q = pq->q;
+    double *n = pq->pos;
+    double d, qp;
+    int i, k;
+
+    if (pq->n < 5) {
+        /* insertion sort of the first five observations */
+        for (i=pq->n; i>0 && q[i-1] > x; i--) {
+            q[i] = q[i-1];
+        }
+        q[i] = x;
+        pq->n += 1;
+        return;
+    }
+
+    /* find the cell containing @x, adjusting the extreme
+       markers if need be */
+    if (x < q[0]) {
+        q[0] = x;
+        k = 0;
+    } else if (x >= q[4]) {
+        if (x > q[4]) {
+            q[4] = x;
+        }
+        k = 3;
+    } else {
+        for (k=0; k<3; k++) {
+            if (x < q[k+1]) {
+                break;
+            }
+        }
+    }
+
+    for (i=k+1; i<5; i++) {
+        n[i] += 1;
+    }
+    for (i=0; i<5; i++) {
+        pq->dpos[i] += pq->inc[i];
+    }
+
+    /* adjust the heights of the middle markers */
+    for (i=1; i<4; i++) {
+        d = pq->dpos[i] - n[i];
+        if ((d >= 1 && n[i+1] - n[i] > 1) ||
+            (d <= -1 && n[i-1] - n[i] < -1)) {
+            d = (d > 0)? 1 : -1;
+            /* piecewise-parabolic prediction */
+            qp = q[i] + d / (n[i+1] - n[i-1]) *
+                ((n[i] - n[i-1] + d) * (q[i+1] - q[i]) / (n[i+1] - n[i]) +
+                 (n[i+1] - n[i] - d) * (q[i] - q[i-1]) / (n[i] - n[i-1]));
+            if (q[i-1] < qp && qp < q[i+1]) {
+                q[i] = qp;
+            } else {
+                /* fall back to linear prediction */
+                int j = i + (int) d;
+
+                q[i] += d * (q[j] - q[i]) / (n[j] - n[i]);
+            }
+            n[i] += d;
+        }
+    }
+
+    pq->n += 1;
+}
+
+/* Retrieve the estimate of the quantile @p from @pq: while
+   there are fewer than five observations these are held in
+   sorted order, so we can interpolate between them.
+*/
+
+static double p2_get_quantile (const P2_QUANTILE *pq, double p)
+{
+    if (pq->n == 0) {
+        return NADBL;
+    } else if (pq->n < 5) {
+        double h = p * (pq->n - 1);
+        int i = (int) floor(h);
+
+        if (i >= pq->n - 1) {
+            return pq->q[pq->n - 1];
+        } else {
+            return pq->q[i] + (h - i) * (pq->q[i+1] - pq->q[i]);
+        }
+    } else {
+        return pq->q[2];
+    }
+}
+
+static double p2_get_min (const P2_QUANTILE *pq)
+{
+    return (pq->n > 0)? pq->q[0] : NADBL;
+}
+
+static double p2_get_max (const P2_QUANTILE *pq)
+{
+    if (pq->n == 0) {
+        return NADBL;
+    } else {
+        return pq->q[pq->n < 5 ? pq->n - 1 : 4];
+    }
+}
+
 static void loop_print_free (LOOP_PRINT *lprn)
 {
     int i;
@@ -159,6 +292,7 @@ static void loop_print_free (LOOP_PRINT *lprn)
     free(lprn->xbak);
     free(lprn->diff);
     free(lprn->na);
+    free(lprn->pq);
 }
 
 static void loop_print_zero (LOOP_PRINT *lprn, int started)
@@ -178,37 +312,22 @@ static void loop_print_zero (LOOP_PRINT *lprn, int started)
         lprn->xbak[i] = NADBL;
         lprn->diff[i] = 0;
         lprn->na[i] = 0;
+        if (lprn->pq != NULL) {
+            P2_QUANTILE *pq = lprn->pq + i * N_LOOP_QUANTILES;
+            int k;
+
+            for (k=0; k<N_LOOP_QUANTILES; k++) {
+                p2_init(&pq[k], loop_quantiles[k]);
+            }
+        }
     }
 }
 
-/* allocate and initialize @lprn, based on the number of
-   elements in @namestr */
+/* allocate storage for @lprn, whose names are already in place */
 
-static int loop_print_start (LOOP_PRINT *lprn, const char *namestr)
+static int loop_print_alloc (LOOP_PRINT *lprn, gretlopt opt)
 {
-    int i, nv;
-
-    if (namestr == NULL || *namestr == '\0') {
-        gretl_errmsg_set("'print' list is empty");
-        return E_DATA;
-    }
-
-    lprn->names = gretl_string_split(namestr, &lprn->nvars, NULL);
-    if (lprn->names == NULL) {
-        return E_ALLOC;
-    }
-
-    nv = lprn->nvars;
-
-    for (i=0; i<nv; i++) {
-        if (!gretl_is_scalar(lprn->names[i])) {
-            gretl_errmsg_sprintf(_("'%s': not a scalar"), lprn->names[i]);
-            strings_array_free(lprn->names, lprn->nvars);
-            lprn->names = NULL;
-            lprn->nvars = 0;
-            return E_DATA;
-        }
-    }
+    int nv = lprn->nvars;
 
     lprn->sum = malloc(nv * sizeof *lprn->sum);
     if (lprn->sum == NULL) goto cleanup;
@@ -225,6 +344,11 @@ static int loop_print_start (LOOP_PRINT *lprn, const char *namestr)
     lprn->na = malloc(nv);
     if (lprn->na == NULL) goto cleanup;
 
+    if (opt & OPT_Q) {
+        lprn->pq = malloc(nv * N_LOOP_QUANTILES * sizeof *lprn->pq);
+        if (lprn->pq == NULL) goto cleanup;
+    }
+
     loop_print_zero(lprn, 0);
 
     return 0;
@@ -250,6 +374,39 @@ static int loop_print_start (LOOP_PRINT *lprn, const char *namestr)
     return E_ALLOC;
 }
 
+/* allocate and initialize @lprn, based on the number of
+   elements in @namestr; OPT_Q in @opt calls for quantiles */
+
+static int loop_print_start (LOOP_PRINT *lprn, const char *namestr,
+                             gretlopt opt)
+{
+    int i, nv;
+
+    if (namestr == NULL || *namestr == '\0') {
+        gretl_errmsg_set("'print' list is empty");
+        return E_DATA;
+    }
+
+    lprn->names = gretl_string_split(namestr, &lprn->nvars, NULL);
+    if (lprn->names == NULL) {
+        return E_ALLOC;
+    }
+
+    nv = lprn->nvars;
+
+    for (i=0; i<nv; i++) {
+        if (!gretl_is_scalar(lprn->names[i])) {
+            gretl_errmsg_sprintf(_("'%s': not a scalar"), lprn->names[i]);
+            strings_array_free(lprn->names, lprn->nvars);
+            lprn->names = NULL;
+            lprn->nvars = 0;
+            return E_DATA;
+        }
+    }
+
+    return loop_print_alloc(lprn, opt);
+}
+
 static void loop_print_init (LOOP_PRINT *lprn, int lno)
 {
     lprn->lineno = lno;
@@ -260,6 +417,7 @@ static void loop_print_init (LOOP_PRINT *lprn, int lno)
     lprn->xbak = NULL;
     lprn->diff = NULL;
     lprn->na = NULL;
+    lprn->pq = NULL;
 }
 
 static LOOP_PRINT *get_loop_print_by_line (LOOPSET *loop, int lno, int *err)
@@ -532,7 +690,8 @@ static int loop_model_update (LOOP_MODEL *lmod, MODEL *pmod)
    allocation first.
 */
 
-static int loop_print_update (LOOPSET *loop, int j, const char *names)
+static int loop_print_update (LOOPSET *loop, int j, const char *names,
+                              gretlopt opt)
 {
     LOOP_PRINT *lprn;
     int err = 0;
@@ -541,7 +700,7 @@ static int loop_print_update (LOOPSET *loop, int j, const char *names)
 
     if (!err && lprn->names == NULL) {
         /* not started yet */
-        err = loop_print_start(lprn, names);
+        err = loop_print_start(lprn, names, opt);
         if (!err) {
             loop->lines[j].flags |= LOOP_LINE_PDONE;
         }
@@ -574,6 +733,14 @@ static int loop_print_update (LOOPSET *loop, int j, const char *names)
                 lprn->diff[i] = 1;
             }
             lprn->xbak[i] = x;
+            if (lprn->pq != NULL) {
+                P2_QUANTILE *pq = lprn->pq + i * N_LOOP_QUANTILES;
+                int k;
+
+                for (k=0; k<N_LOOP_QUANTILES; k++) {
+                    p2_update(&pq[k], x);
+                }
+            }
         }
 
         mpf_clear(m);
@@ -679,6 +846,45 @@ static void loop_model_print (LOOP_MODEL *lmod, const DATASET *dset,
     pputc(prn, '\n');
 }
 
+/* print the extrema and the (estimated) quantiles of the
+   variables in @lprn */
+
+static void loop_print_quantiles (LOOP_PRINT *lprn, int maxlen,
+                                  PRN *prn)
+{
+    const char *heads[] = {
+        N_("min"), "5%", N_("median"), "95%", N_("max")
+    };
+    P2_QUANTILE *pq;
+    double x;
+    int i, k, len;
+
+    bufspace(maxlen + 1, prn);
+    for (k=0; k<5; k++) {
+        len = get_utf_width(_(heads[k]), 14);
+        pprintf(prn, "%*s%s", len, _(heads[k]), k < 4 ? " " : "\n");
+    }
+
+    for (i=0; i<lprn->nvars; i++) {
+        pprintf(prn, "%*s", maxlen + 1, lprn->names[i]);
+        if (lprn->na[i]) {
+            for (k=0; k<5; k++) {
+                pprintf(prn, "%14s%s", "NA   ", k < 4 ? " " : "\n");
+            }
+            continue;
+        }
+        pq = lprn->pq + i * N_LOOP_QUANTILES;
+        pprintf(prn, "%#14g", p2_get_min(&pq[0]));
+        for (k=0; k<N_LOOP_QUANTILES; k++) {
+            x = p2_get_quantile(&pq[k], loop_quantiles[k]);
+            pprintf(prn, " %#14g", x);
+        }
+        pprintf(prn, " %#14g\n", p2_get_max(&pq[0]));
+    }
+
+    pputc(prn, '\n');
+}
+
 static void loop_print_print (LOOP_PRINT *lprn, PRN *prn)
 {
     bigval mean, m, sd;
@@ -743,6 +949,10 @@ static void loop_print_print (LOOP_PRINT *lprn, PRN *prn)
     mpf_clear(sd);
 
     pputc(prn, '\n');
+
+    if (lprn->pq != NULL) {
+        loop_print_quantiles(lprn, maxlen, prn);
+    }
 }
 
 static int loop_store_save (LOOP_STORE *lstore, PRN *prn)
@@ -880,23 +1090,58 @@ static int model_command_post_process (ExecState *s,
 
 #define loop_literal(ll) (ll->flags & LOOP_LINE_LIT)
 
+/* Look up the records for line @lno of @loop, if any: the
+   commands on some lines may never have been reached */
+
+static LOOP_MODEL *find_loop_model (LOOPSET *loop, int lno)
+{
+    int i;
+
+    for (i=0; i<loop->n_loop_models; i++) {
+        if (loop->lmodels[i].lineno == lno) {
+            return &loop->lmodels[i];
+        }
+    }
+
+    return NULL;
+}
+
+static LOOP_PRINT *find_loop_print (LOOPSET *loop, int lno)
+{
+    int i;
+
+    for (i=0; i<loop->n_prints; i++) {
+        if (loop->prns[i].lineno == lno) {
+            return &loop->prns[i];
+        }
+    }
+
+    return NULL;
+}
+
 static void progressive_loop_finalize (LOOPSET *loop,
                                        const DATASET *dset,
                                        PRN *prn)
 {
-    int i, j = 0, k = 0;
+    int i;
 
     for (i=0; i<loop->n_lines; i++) {
 	loop_line *ll = &loop->lines[i];
 
         if (plain_model_ci(ll->ci) && !loop_line_quiet(ll)) {
-            loop_model_print(&loop->lmodels[j], dset, prn);
-            loop_model_zero(&loop->lmodels[j], 1);
-            j++;
+            LOOP_MODEL *lmod = find_loop_model(loop, i);
+
+            if (lmod != NULL && lmod->nc > 0) {
+                loop_model_print(lmod, dset, prn);
+                loop_model_zero(lmod, 1);
+            }
         } else if (ll->ci == PRINT && !loop_literal(ll)) {
-            loop_print_print(&loop->prns[k], prn);
-            loop_print_zero(&loop->prns[k], 1);
-            k++;
+            LOOP_PRINT *lprn = find_loop_print(loop, i);
+
+            if (lprn != NULL && lprn->names != NULL) {
+                loop_print_print(lprn, prn);
+                loop_print_zero(lprn, 1);
+            }
         } else if (ll->ci == STORE) {
             loop_store_save(&loop->store, prn);
         }
@@ -918,9 +1163,9 @@ static int handle_prog_command (LOOPSET *loop, int j,
 
     if (cmd->ci == PRINT && !loop_literal(ll)) {
         if (prog_cmd_started(loop, j)) {
-            *err = loop_print_update(loop, j, NULL);
+            *err = loop_print_update(loop, j, NULL, OPT_NONE);
         } else {
-            *err = loop_print_update(loop, j, cmd->parm2);
+            *err = loop_print_update(loop, j, cmd->parm2, cmd->opt);
         }
         handled = 1;
     } else if (cmd->ci == STORE) {
@@ -940,3 +1185,732 @@ static int handle_prog_command (LOOPSET *loop, int j,
 
     return handled;
 }
+
+/* Support for the --parallel option to a progressive loop. The
+   iterations are split into contiguous blocks, one handled by the
+   main process and the others by worker processes created via
+   fork(). Each worker jumps to its own xoshiro256+ stream, runs its
+   block, then sends its progressive statistics and stored values
+   back to the main process via a pipe. The main process merges
+   these in order of iteration, so that for a given seed and number
+   of processes the results are reproducible. Note that apart from
+   the progressive results, changes made to the state of the
+   program by the workers are lost.
+*/
+
+static void loop_workers_init (LOOP_WORKERS *lw)
+{
+    lw->nw = 1;
+    lw->self = 0;
+    lw->iters = NULL;
+    lw->pids = NULL;
+    lw->fds = NULL;
+}
+
+static void loop_workers_free (LOOP_WORKERS *lw)
+{
+    free(lw->iters);
+    free(lw->pids);
+    free(lw->fds);
+    loop_workers_init(lw);
+}
+
+#ifndef WIN32
+
+#include <sys/wait.h>
+#include <signal.h>
+
+/* Does the "print" command in @line call for quantiles? Loop lines
+   are stored unparsed, so we go through its option flags as the
+   tokenizer would, passing over quoted strings and comments.
+*/
+
+static int print_line_wants_quantiles (const char *line)
+{
+    const char *s0 = line;
+    char word[32];
+    OptStatus status;
+    int n;
+
+    while (*line) {
+        if (*line == '"') {
+            line = strchr(line + 1, '"');
+            if (line == NULL) {
+                break;
+            }
+        } else if (*line == '#') {
+            break;
+        } else if (!strncmp(line, "--", 2) && line > s0 &&
+                   isspace((unsigned char) line[-1])) {
+            line += 2;
+            n = strcspn(line, " \t=");
+            if (n > 0 && n < (int) sizeof word) {
+                *word = '\0';
+                strncat(word, line, n);
+                if (valid_long_opt(PRINT, word, &status) == OPT_Q) {
+                    return 1;
+                }
+            }
+            line += n;
+            continue;
+        }
+        line++;
+    }
+
+    return 0;
+}
+
+static int n_loop_workers (LOOPSET *loop)
+{
+    int n = 1;
+
+    /* no workers when profiling or tracing, since their timings
+       would be lost */
+    if (loop->parent == NULL && !gretl_in_gui_mode() &&
+        !gretl_profiling() && !gretl_tracing() &&
+        (loop->type == COUNT_LOOP || loop->type == INDEX_LOOP)) {
+        int i;
+
+        /* the states of quantile estimators cannot be merged */
+        for (i=0; i<loop->n_lines; i++) {
+            if (loop->lines[i].ci == PRINT &&
+                print_line_wants_quantiles(loop->lines[i].s)) {
+                return 1;
+            }
+        }
+#if defined(_OPENMP)
+        n = gretl_get_omp_threads();
+#else
+        n = gretl_n_processors();
+#endif
+        if (n > loop->itermax) {
+            n = loop->itermax;
+        }
+    }
+
+    return n;
+}
+
+/* Set @loop to execute its iterations from @i0 up to, but not
+   including, @i1: see loop_condition()
+*/
+
+static void loop_set_range (LOOPSET *loop, int i0, int i1)
+{
+    if (i0 > 0) {
+        loop->iter = i0;
+        if (indexed_loop(loop)) {
+            /* loop_condition() will advance the index */
+            if (loop_decrement(loop)) {
+                loop->idxval = loop->init.val - i0 + 1;
+            } else {
+                loop->idxval = loop->init.val + i0 - 1;
+            }
+        }
+    }
+    loop->itermax = i1;
+}
+
+/* Start the worker processes for @loop, if applicable. In each
+   worker @prn is replaced by one that discards its output.
+*/
+
+static int loop_workers_start (LOOPSET *loop, LOOP_WORKERS *lw,
+                               PRN **pprn)
+{
+    int nw = n_loop_workers(loop);
+    int n = loop->itermax;
+    int k, err = 0;
+
+    if (nw < 2) {
+        return 0;
+    }
+
+    lw->iters = malloc((nw + 1) * sizeof *lw->iters);
+    lw->pids = calloc(nw, sizeof *lw->pids);
+    lw->fds = malloc(nw * sizeof *lw->fds);
+    if (lw->iters == NULL || lw->pids == NULL || lw->fds == NULL) {
+        loop_workers_free(lw);
+        return E_ALLOC;
+    }
+
+    for (k=0; k<=nw; k++) {
+        lw->iters[k] = (int) ((gint64) k * n / nw);
+    }
+
+    /* don't let the workers inherit pending output */
+    gretl_print_flush_stream(*pprn);
+    fflush(NULL);
+
+    for (k=1; k<nw && !err; k++) {
+        int fd[2];
+        pid_t pid;
+
+        if (pipe(fd) != 0) {
+            err = E_EXTERNAL;
+        } else if ((pid = fork()) < 0) {
+            close(fd[0]);
+            close(fd[1]);
+            err = E_EXTERNAL;
+        } else if (pid == 0) {
+            /* in worker @k */
+            int i;
+
+            close(fd[0]);
+            for (i=1; i<k; i++) {
+                close(lw->fds[i]);
+            }
+            lw->self = k;
+            lw->nw = nw;
+            lw->fds[0] = fd[1];
+            loop_set_range(loop, lw->iters[k], lw->iters[k+1]);
+            gretl_rand_jump(k);
+            /* the workers between them occupy the processors */
+            gretl_set_omp_threads(1);
+            *pprn = gretl_print_new(GRETL_PRINT_NULL, NULL);
+            return 0;
+        } else {
+            close(fd[1]);
+            lw->pids[k] = (int) pid;
+            lw->fds[k] = fd[0];
+        }
+    }
+
+    if (err) {
+        /* shut down any workers already started, and carry on
+           without them */
+        int i;
+
+        for (i=1; i<k-1; i++) {
+            kill((pid_t) lw->pids[i], SIGKILL);
+            waitpid((pid_t) lw->pids[i], NULL, 0);
+            close(lw->fds[i]);
+        }
+        loop_workers_free(lw);
+        fprintf(stderr, "loop: couldn't start worker processes\n");
+        return 0;
+    }
+
+    lw->nw = nw;
+    loop_set_range(loop, 0, lw->iters[1]);
+
+    return 0;
+}
+
+static void put_bigvals (FILE *fp, bigval *x, int n)
+{
+    int i;
+
+    for (i=0; i<n; i++) {
+        mpf_out_str(fp, 16, 0, x[i]);
+        fputc('\n', fp);
+    }
+}
+
+static void put_doubles (FILE *fp, const double *x, int n)
+{
+    int i;
+
+    for (i=0; i<n; i++) {
+        if (isnan(x[i])) {
+            fputs("NA\n", fp);
+        } else {
+            fprintf(fp, "%a\n", x[i]);
+        }
+    }
+}
+
+static void put_ints (FILE *fp, const int *x, int n)
+{
+    int i;
+
+    for (i=0; i<n; i++) {
+        fprintf(fp, "%d\n", x[i]);
+    }
+}
+
+/* Send @pmod in XML form, preceded by its length, so that the
+   main process can start a record for a model command that it
+   did not itself reach */
+
+static void put_model (FILE *fp, const MODEL *pmod)
+{
+    PRN *prn = gretl_print_new(GRETL_PRINT_BUFFER, NULL);
+    const char *buf = NULL;
+
+    if (prn != NULL) {
+        gretl_model_serialize(pmod, 0, prn);
+        buf = gretl_print_get_buffer(prn);
+    }
+
+    if (buf != NULL) {
+        fprintf(fp, "%d\n", (int) strlen(buf));
+        fputs(buf, fp);
+    } else {
+        fputs("0\n", fp);
+    }
+
+    gretl_print_destroy(prn);
+}
+
+/* Called by a worker process on completion of its iterations:
+   send the results back to the main process and exit.
+*/
+
+static void loop_worker_exit (LOOPSET *loop, LOOP_WORKERS *lw, int err)
+{
+    FILE *fp = fdopen(lw->fds[0], "w");
+    LOOP_STORE *lstore = &loop->store;
+    int i, j, t;
+
+    if (fp == NULL) {
+        _exit(EXIT_FAILURE);
+    }
+
+    fprintf(fp, "%d %d\n", err, loop->iter - lw->iters[lw->self]);
+    if (err) {
+        const char *msg = gretl_errmsg_get();
+
+        fprintf(fp, "%s\n", (msg != NULL && *msg != '\0')? msg : "?");
+        fclose(fp);
+        _exit(EXIT_SUCCESS);
+    }
+
+    fprintf(fp, "%d\n", loop->n_loop_models);
+    for (i=0; i<loop->n_loop_models; i++) {
+        LOOP_MODEL *lmod = &loop->lmodels[i];
+
+        fprintf(fp, "%d %d %d\n", lmod->lineno, lmod->nc, lmod->n);
+        if (lmod->nc > 0) {
+            put_model(fp, lmod->model0);
+            put_bigvals(fp, lmod->bigarray, 4 * lmod->nc);
+            put_doubles(fp, lmod->cbak, 2 * lmod->nc);
+            put_ints(fp, lmod->cdiff, 2 * lmod->nc);
+        }
+    }
+
+    fprintf(fp, "%d\n", loop->n_prints);
+    for (i=0; i<loop->n_prints; i++) {
+        LOOP_PRINT *lprn = &loop->prns[i];
+
+        fprintf(fp, "%d %d %d\n", lprn->lineno, lprn->nvars, lprn->n);
+        for (j=0; j<lprn->nvars; j++) {
+            fprintf(fp, "%s\n", lprn->names[j]);
+        }
+        put_bigvals(fp, lprn->sum, lprn->nvars);
+        put_bigvals(fp, lprn->ssq, lprn->nvars);
+        put_doubles(fp, lprn->xbak, lprn->nvars);
+        put_ints(fp, lprn->diff, lprn->nvars);
+        for (j=0; j<lprn->nvars; j++) {
+            fprintf(fp, "%d\n", lprn->na[j]);
+        }
+    }
+
+    fprintf(fp, "%d %d %d\n", lstore->lineno, lstore->nvars,
+            (lstore->dset == NULL)? 0 : lstore->n);
+    if (lstore->dset != NULL) {
+        for (t=0; t<lstore->n; t++) {
+            for (i=0; i<lstore->nvars; i++) {
+                put_doubles(fp, &lstore->dset->Z[i+1][t], 1);
+            }
+        }
+    }
+
+    fclose(fp);
+    _exit(EXIT_SUCCESS);
+}
+
+static int get_ints (FILE *fp, int *x, int n)
+{
+    int i;
+
+    for (i=0; i<n; i++) {
+        if (fscanf(fp, "%d", &x[i]) != 1) {
+            return E_DATA;
+        }
+    }
+
+    return 0;
+}
+
+static int get_doubles (FILE *fp, double *x, int n)
+{
+    char word[64];
+    int i;
+
+    for (i=0; i<n; i++) {
+        if (fscanf(fp, "%63s", word) != 1) {
+            return E_DATA;
+        }
+        x[i] = strcmp(word, "NA") ? strtod(word, NULL) : NADBL;
+    }
+
+    return 0;
+}
+
+/* read @n values and add them to the corresponding elements of @x */
+
+static int add_bigvals (FILE *fp, bigval *x, int n)
+{
+    mpf_t m;
+    int i, err = 0;
+
+    mpf_init(m);
+
+    for (i=0; i<n && !err; i++) {
+        if (mpf_inp_str(m, fp, 16) == 0) {
+            err = E_DATA;
+        } else {
+            mpf_add(x[i], x[i], m);
+        }
+    }
+
+    mpf_clear(m);
+
+    return err;
+}
+
+/* Record whether the values of a statistic varied across iterations,
+   given the last value and "diff" indicator from the main process
+   (@xbak, @diff) and those from a worker (@y, @ydiff).
+*/
+
+static void merge_diff (double *xbak, int *diff, double y, int ydiff)
+{
+    if (ydiff || (!na(*xbak) && !na(y) && realdiff(*xbak, y))) {
+        *diff = 1;
+    }
+    if (!na(y)) {
+        *xbak = y;
+    }
+}
+
+/* Read a model sent by put_model(). If @want is zero the
+   model is not needed and is just skipped. */
+
+static MODEL *get_model (FILE *fp, const DATASET *dset, int want,
+                         int *err)
+{
+    MODEL *pmod = NULL;
+    char *buf;
+    int len;
+
+    if (fscanf(fp, "%d", &len) != 1 || len <= 0 || fgetc(fp) != '\n') {
+        *err = E_DATA;
+        return NULL;
+    }
+
+    buf = malloc(len + 1);
+    if (buf == NULL) {
+        *err = E_ALLOC;
+    } else if (fread(buf, 1, len, fp) != (size_t) len) {
+        *err = E_DATA;
+    } else if (want) {
+        xmlDocPtr doc = NULL;
+        xmlNodePtr node = NULL;
+
+        buf[len] = '\0';
+        if (gretl_xml_read_buffer(buf, "gretl-model", &doc, &node)) {
+            *err = E_DATA;
+        } else {
+            pmod = gretl_model_from_XML(node, doc, dset, err);
+            xmlFreeDoc(doc);
+        }
+        if (pmod == NULL && !*err) {
+            *err = E_DATA;
+        }
+    }
+
+    free(buf);
+
+    return pmod;
+}
+
+static int merge_loop_model (LOOPSET *loop, const DATASET *dset,
+                             FILE *fp)
+{
+    LOOP_MODEL *lmod;
+    int lno, nc, n;
+    int i, err = 0;
+
+    if (fscanf(fp, "%d %d %d", &lno, &nc, &n) != 3 || nc == 0) {
+        return E_DATA;
+    }
+
+    lmod = find_loop_model(loop, lno);
+
+    if (lmod == NULL) {
+        /* a command the main process didn't reach: start a
+           record for it, based on the worker's model */
+        MODEL *pmod = get_model(fp, dset, 1, &err);
+
+        if (!err) {
+            lmod = get_loop_model_by_line(loop, lno, &err);
+        }
+        if (!err) {
+            err = loop_model_start(lmod, pmod);
+        }
+        gretl_model_free(pmod);
+    } else {
+        get_model(fp, dset, 0, &err);
+    }
+
+    if (err) {
+        return err;
+    } else if (lmod->nc != nc) {
+        return E_DATA;
+    } else {
+        double *cbak = malloc(2 * nc * sizeof *cbak);
+        int *cdiff = malloc(2 * nc * sizeof *cdiff);
+
+        if (cbak == NULL || cdiff == NULL) {
+            err = E_ALLOC;
+        }
+        if (!err) {
+            err = add_bigvals(fp, lmod->bigarray, 4 * nc);
+        }
+        if (!err) {
+            err = get_doubles(fp, cbak, 2 * nc);
+        }
+        if (!err) {
+            err = get_ints(fp, cdiff, 2 * nc);
+        }
+        if (!err) {
+            for (i=0; i<2*nc; i++) {
+                merge_diff(&lmod->cbak[i], &lmod->cdiff[i],
+                           cbak[i], cdiff[i]);
+            }
+            lmod->n += n;
+        }
+        free(cbak);
+        free(cdiff);
+    }
+
+    return err;
+}
+
+static int merge_loop_print (LOOPSET *loop, FILE *fp)
+{
+    LOOP_PRINT *lprn = NULL;
+    char **names = NULL;
+    char vname[VNAMELEN];
+    int lno, nv, n;
+    int i, err = 0;
+
+    if (fscanf(fp, "%d %d %d", &lno, &nv, &n) != 3 || nv <= 0) {
+        return E_DATA;
+    }
+
+    names = strings_array_new(nv);
+    if (names == NULL) {
+        return E_ALLOC;
+    }
+    for (i=0; i<nv && !err; i++) {
+        if (fscanf(fp, "%31s", vname) != 1) {
+            err = E_DATA;
+        } else if ((names[i] = gretl_strdup(vname)) == NULL) {
+            err = E_ALLOC;
+        }
+    }
+
+    if (!err) {
+        lprn = find_loop_print(loop, lno);
+        if (lprn == NULL || lprn->names == NULL) {
+            /* a command the main process didn't reach: start a
+               record for it, using the worker's names */
+            lprn = get_loop_print_by_line(loop, lno, &err);
+            if (!err) {
+                lprn->names = names;
+                lprn->nvars = nv;
+                names = NULL;
+                err = loop_print_alloc(lprn, OPT_NONE);
+            }
+            if (!err) {
+                loop->lines[lno].flags |= LOOP_LINE_PDONE;
+            }
+        } else if (lprn->nvars != nv) {
+            err = E_DATA;
+        }
+    }
+
+    strings_array_free(names, nv);
+
+    if (err) {
+        return err;
+    } else {
+        double *xbak = malloc(nv * sizeof *xbak);
+        int *diff = malloc(2 * nv * sizeof *diff);
+        int *nas = diff + nv;
+
+        if (xbak == NULL || diff == NULL) {
+            err = E_ALLOC;
+        }
+        if (!err) {
+            err = add_bigvals(fp, lprn->sum, nv);
+        }
+        if (!err) {
+            err = add_bigvals(fp, lprn->ssq, nv);
+        }
+        if (!err) {
+            err = get_doubles(fp, xbak, nv);
+        }
+        if (!err) {
+            err = get_ints(fp, diff, 2 * nv);
+        }
+        if (!err) {
+            for (i=0; i<nv; i++) {
+                merge_diff(&lprn->xbak[i], &lprn->diff[i],
+                           xbak[i], diff[i]);
+                if (nas[i]) {
+                    lprn->na[i] = 1;
+                }
+            }
+        }
+        free(xbak);
+        free(diff);
+    }
+
+    if (!err) {
+        lprn->n += n;
+    }
+
+    return err;
+}
+
+static int merge_loop_store (LOOPSET *loop, FILE *fp)
+{
+    LOOP_STORE *lstore = &loop->store;
+    int lno, nv, n;
+    int i, t, err = 0;
+
+    if (fscanf(fp, "%d %d %d", &lno, &nv, &n) != 3) {
+        return E_DATA;
+    } else if (n == 0) {
+        return 0;
+    } else if (lstore->dset == NULL || lstore->lineno != lno ||
+               lstore->nvars != nv) {
+        return E_DATA;
+    }
+
+    for (t=0; t<n && !err; t++) {
+        if (lstore->n >= lstore->dset->n) {
+            err = extend_loop_dataset(lstore);
+        }
+        for (i=0; i<nv && !err; i++) {
+            err = get_doubles(fp, &lstore->dset->Z[i+1][lstore->n], 1);
+        }
+        if (!err) {
+            lstore->n += 1;
+        }
+    }
+
+    return err;
+}
+
+/* Read and merge the results from worker @k */
+
+static int merge_worker_results (LOOPSET *loop, LOOP_WORKERS *lw,
+                                 const DATASET *dset, int k)
+{
+    FILE *fp = fdopen(lw->fds[k], "r");
+    int werr = 0, iters = 0;
+    int i, n, err = 0;
+
+    if (fp == NULL) {
+        close(lw->fds[k]);
+        return E_EXTERNAL;
+    }
+
+    if (fscanf(fp, "%d %d", &werr, &iters) != 2) {
+        err = E_DATA;
+    } else if (werr) {
+        char msg[MAXLEN];
+
+        if (fscanf(fp, " %511[^\n]", msg) == 1) {
+            gretl_errmsg_set(msg);
+        }
+        err = werr;
+    }
+
+    if (!err && fscanf(fp, "%d", &n) == 1) {
+        for (i=0; i<n && !err; i++) {
+            err = merge_loop_model(loop, dset, fp);
+        }
+    } else if (!err) {
+        err = E_DATA;
+    }
+
+    if (!err && fscanf(fp, "%d", &n) == 1) {
+        for (i=0; i<n && !err; i++) {
+            err = merge_loop_print(loop, fp);
+        }
+    } else if (!err) {
+        err = E_DATA;
+    }
+
+    if (!err) {
+        err = merge_loop_store(loop, fp);
+    }
+
+    if (!err) {
+        loop->iter += iters;
+    } else if (!werr) {
+        gretl_errmsg_sprintf("loop: failed to merge results from "
+                             "worker process %d", k);
+    }
+
+    fclose(fp);
+
+    return err;
+}
+
+/* Called by the main process on completion of its own share of
+   the iterations, with error code @err: collect the results from
+   the workers, in order, and wait for the workers to exit.
+*/
+
+static int loop_workers_finish (LOOPSET *loop, LOOP_WORKERS *lw,
+                                const DATASET *dset, int err)
+{
+    int k, kerr;
+
+    for (k=1; k<lw->nw; k++) {
+        if (err) {
+            /* just shut down */
+            kill((pid_t) lw->pids[k], SIGKILL);
+            close(lw->fds[k]);
+        } else {
+            kerr = merge_worker_results(loop, lw, dset, k);
+            if (kerr) {
+                err = kerr;
+            }
+        }
+        waitpid((pid_t) lw->pids[k], NULL, 0);
+    }
+
+    loop->itermax = lw->iters[lw->nw];
+    loop_workers_free(lw);
+
+    return err;
+}
+
+#else /* WIN32: no fork(), so we run serially */
+
+static int loop_workers_start (LOOPSET *loop, LOOP_WORKERS *lw,
+                               PRN **pprn)
+{
+    return 0;
+}
+
+static void loop_worker_exit (LOOPSET *loop, LOOP_WORKERS *lw, int err)
+{
+    return;
+}
+
+static int loop_workers_finish (LOOPSET *loop, LOOP_WORKERS *lw,
+                                const DATASET *dset, int err)
+{
+    return err;
+}
+
+#endif /* WIN32 or not */
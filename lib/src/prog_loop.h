@@ -21,6 +21,18 @@
    used only in "progressive" loops.
 */
 
+/* streaming estimator of a quantile via the P-squared algorithm
+   of Jain and Chlamtac (1985), using five markers and hence
+   constant memory */
+
+typedef struct {
+    int n;          /* number of observations */
+    double q[5];    /* marker heights */
+    double pos[5];  /* actual marker positions */
+    double dpos[5]; /* desired marker positions */
+    double inc[5];  /* increments in desired positions */
+} P2_QUANTILE;
+
 typedef struct {
     int lineno;    /* location: line number in loop */
     int n;         /* number of repetitions */
@@ -31,6 +43,7 @@ typedef struct {
     double *xbak;  /* previous values */
     int *diff;     /* indicator for difference */
     char *na;      /* indicator for NAs in calculation */
+    P2_QUANTILE *pq; /* quantile estimators (--quantiles), or NULL */
 } LOOP_PRINT;
 
 typedef struct {
@@ -59,6 +72,17 @@ typedef struct {
     DATASET *dset;  /* temporary data storage */
 } LOOP_STORE;
 
+/* apparatus for running a progressive loop in parallel, via
+   worker processes: see prog_loop.c */
+
+typedef struct {
+    int nw;       /* number of processes, including the main one */
+    int self;     /* 0 for the main process, else worker number */
+    int *iters;   /* starting iteration of each process, plus end */
+    int *pids;    /* IDs of worker processes (main process only) */
+    int *fds;     /* pipe file descriptors */
+} LOOP_WORKERS;
+
 static int extend_loop_dataset (LOOP_STORE *lstore);
 static void loop_model_free (LOOP_MODEL *lmod);
 static void loop_print_free (LOOP_PRINT *lprn);
@@ -23,6 +23,7 @@
 
 #include "libgretl.h"
 #include "libset.h"
+#include "gretl_mt.h"
 #include "../../cephes/libprob.h"
 
 #include <errno.h>
@@ -3577,6 +3578,225 @@ double gretl_get_pvalue (int dist, const double *parm, double x)
     return y;
 }
 
+/* Kernels for batch evaluation of CDFs, p-values and quantiles:
+   each wraps the same function that the scalar dispatchers above
+   call, so array and scalar results agree exactly.
+*/
+
+typedef double (*pdist_kernel) (const double *parm, double x);
+
+static double normal_cdf_k (const double *p, double x)
+{
+    return normal_cdf(x);
+}
+
+static double normal_pval_k (const double *p, double x)
+{
+    return normal_cdf_comp(x);
+}
+
+static double normal_inv_k (const double *p, double a)
+{
+    return normal_cdf_inverse(a);
+}
+
+static double normal_crit_k (const double *p, double a)
+{
+    return normal_critval(a);
+}
+
+static double student_cdf_k (const double *p, double x)
+{
+    return student_cdf(p[0], x);
+}
+
+static double student_pval_k (const double *p, double x)
+{
+    return student_cdf_comp(p[0], x);
+}
+
+static double student_inv_k (const double *p, double a)
+{
+    return student_cdf_inverse(p[0], a);
+}
+
+static double student_crit_k (const double *p, double a)
+{
+    return student_critval(p[0], a);
+}
+
+static double chisq_cdf_k (const double *p, double x)
+{
+    return chisq_cdf((int) p[0], x);
+}
+
+static double chisq_pval_k (const double *p, double x)
+{
+    return chisq_cdf_comp((int) p[0], x);
+}
+
+static double chisq_inv_k (const double *p, double a)
+{
+    return chisq_cdf_inverse((int) p[0], a);
+}
+
+static double chisq_crit_k (const double *p, double a)
+{
+    return chisq_critval((int) p[0], a);
+}
+
+static double snedecor_cdf_k (const double *p, double x)
+{
+    return snedecor_cdf((int) p[0], (int) p[1], x);
+}
+
+static double snedecor_pval_k (const double *p, double x)
+{
+    return snedecor_cdf_comp(p[0], p[1], x);
+}
+
+static double snedecor_inv_k (const double *p, double a)
+{
+    return snedecor_cdf_inverse(p[0], p[1], a);
+}
+
+static double snedecor_crit_k (const double *p, double a)
+{
+    return snedecor_critval((int) p[0], (int) p[1], a);
+}
+
+static double gamma_cdf_k (const double *p, double x)
+{
+    return gamma_cdf(p[0], p[1], x, 1);
+}
+
+static double gamma_pval_k (const double *p, double x)
+{
+    return gamma_cdf_comp(p[0], p[1], x, 1);
+}
+
+static double gamma_inv_k (const double *p, double a)
+{
+    return gamma_cdf_inverse(p[0], p[1], a);
+}
+
+static double gamma_crit_k (const double *p, double a)
+{
+    return gamma_cdf_inverse(p[0], p[1], 1-a);
+}
+
+static double beta_cdf_k (const double *p, double x)
+{
+    return beta_cdf(p[0], p[1], x);
+}
+
+struct pdist_kernel_info {
+    int dist;
+    PdistCalc calc;
+    pdist_kernel func;
+};
+
+static const struct pdist_kernel_info pdist_kernels[] = {
+    { D_NORMAL,   PD_CDF,    normal_cdf_k },
+    { D_NORMAL,   PD_PVAL,   normal_pval_k },
+    { D_NORMAL,   PD_INVCDF, normal_inv_k },
+    { D_NORMAL,   PD_CRIT,   normal_crit_k },
+    { D_STUDENT,  PD_CDF,    student_cdf_k },
+    { D_STUDENT,  PD_PVAL,   student_pval_k },
+    { D_STUDENT,  PD_INVCDF, student_inv_k },
+    { D_STUDENT,  PD_CRIT,   student_crit_k },
+    { D_CHISQ,    PD_CDF,    chisq_cdf_k },
+    { D_CHISQ,    PD_PVAL,   chisq_pval_k },
+    { D_CHISQ,    PD_INVCDF, chisq_inv_k },
+    { D_CHISQ,    PD_CRIT,   chisq_crit_k },
+    { D_SNEDECOR, PD_CDF,    snedecor_cdf_k },
+    { D_SNEDECOR, PD_PVAL,   snedecor_pval_k },
+    { D_SNEDECOR, PD_INVCDF, snedecor_inv_k },
+    { D_SNEDECOR, PD_CRIT,   snedecor_crit_k },
+    { D_GAMMA,    PD_CDF,    gamma_cdf_k },
+    { D_GAMMA,    PD_PVAL,   gamma_pval_k },
+    { D_GAMMA,    PD_INVCDF, gamma_inv_k },
+    { D_GAMMA,    PD_CRIT,   gamma_crit_k },
+    { D_BETA,     PD_CDF,    beta_cdf_k }
+};
+
+/* rough cost of one evaluation, in flops, for comparison with
+   the threshold for using OpenMP */
+#define PDIST_OMP_COST 200
+
+/**
+ * gretl_fill_pdist_array:
+ * @dist: distribution code.
+ * @calc: the calculation wanted: CDF, p-value (complement
+ * of the CDF), inverse CDF or critical value.
+ * @parm: array holding from zero to two parameter values,
+ * depending on the distribution.
+ * @x: see below.
+ * @n: number of elements in @x.
+ *
+ * On input, @x contains an array of abscissae (or probabilities,
+ * in the case of the inverse CDF and critical values); on output
+ * it contains the values obtained element-wise from
+ * gretl_get_cdf(), gretl_get_pvalue(), gretl_get_cdf_inverse()
+ * or gretl_get_critval(). Missing inputs give #NADBL. The
+ * parameters are checked, and the evaluation routine chosen,
+ * once for the whole array, and large arrays are split across
+ * OpenMP threads.
+ *
+ * This is supported for the normal, t, chi-square, F and gamma
+ * distributions, and for the beta CDF.
+ *
+ * Returns: 0 on success, or %E_NOTIMP if @dist and @calc are not
+ * supported, in which case @x is left unchanged.
+ */
+
+int gretl_fill_pdist_array (int dist, PdistCalc calc,
+                            const double *parm,
+                            double *x, int n)
+{
+    int nk = G_N_ELEMENTS(pdist_kernels);
+    pdist_kernel kfunc = NULL;
+    int i;
+
+    for (i=0; i<nk; i++) {
+        if (pdist_kernels[i].dist == dist &&
+            pdist_kernels[i].calc == calc) {
+            kfunc = pdist_kernels[i].func;
+            break;
+        }
+    }
+
+    if (kfunc == NULL) {
+        return E_NOTIMP;
+    }
+
+    if (pdist_check_input(dist, parm, 0) == E_MISSDATA) {
+        for (i=0; i<n; i++) {
+            x[i] = NADBL;
+        }
+        return 0;
+    }
+
+#if defined(_OPENMP)
+    if (!gretl_use_openmp((guint64) n * PDIST_OMP_COST)) {
+        goto st_mode;
+    }
+#pragma omp parallel for private(i)
+    for (i=0; i<n; i++) {
+        x[i] = na(x[i]) ? NADBL : kfunc(parm, x[i]);
+    }
+    return 0;
+
+ st_mode:
+#endif
+
+    for (i=0; i<n; i++) {
+        x[i] = na(x[i]) ? NADBL : kfunc(parm, x[i]);
+    }
+
+    return 0;
+}
+
 static int gretl_fill_random_array (double *x, int t1, int t2,
                                     int dist, const double *parm,
                                     const double *vecp1,
@@ -50,6 +50,13 @@ typedef enum {
     D_NORMAL2
 } DistCode;
 
+typedef enum {
+    PD_CDF,
+    PD_PVAL,
+    PD_INVCDF,
+    PD_CRIT
+} PdistCalc;
+
 double gammafun (double x);
 
 double lngamma (double x);
@@ -164,6 +171,10 @@ double gretl_get_cdf_inverse (int dist, const double *parm, double a);
 
 double gretl_get_critval (int dist, const double *parm, double a);
 
+int gretl_fill_pdist_array (int dist, PdistCalc calc,
+			    const double *parm,
+			    double *x, int n);
+
 int gretl_fill_random_series (double *x, int dist, 
 			      const double *parm,
 			      const double *vecp1, 
@@ -24,6 +24,7 @@
 #include "libset.h"
 #include "gretl_panel.h"
 #include "estim_private.h"
+#include "gretl_mt.h"
 
 #include "gretl_f2c.h"
 #include "clapack_double.h"
@@ -346,18 +347,25 @@ static gretl_matrix *make_data_X (const MODEL *pmod,
 
 /* Calculate W(t)-transpose * W(t-lag) */
 
-static void wtw (gretl_matrix *wt, const gretl_matrix *H,
-                 int t, int lag)
-{
-    int i, j, s = t - lag;
-    double hti, htj;
+/* Gamma(lag) = sum over t of H_t' H_{t-lag}: a single dgemm call
+   on row-offset views of @H, which is column-major with leading
+   dimension H->rows.
+*/
 
-    for (i=0; i<H->cols; i++) {
-        hti = gretl_matrix_get(H, t, i);
-        for (j=0; j<H->cols; j++) {
-            htj = gretl_matrix_get(H, s, j);
-            gretl_matrix_set(wt, i, j, hti * htj);
-        }
+static void hac_gamma (gretl_matrix *G, const gretl_matrix *H,
+                       int lag)
+{
+    integer T = H->rows;
+    integer k = H->cols;
+    integer m = T - lag;
+    double one = 1.0, zero = 0.0;
+    char ta = 'T', tb = 'N';
+
+    if (m <= 0) {
+        gretl_matrix_zero(G);
+    } else {
+        dgemm_(&ta, &tb, &k, &k, &m, &one, H->val + lag, &T,
+               H->val, &T, &zero, G->val, &k);
     }
 }
 
@@ -775,7 +783,6 @@ gretl_matrix *HAC_XOX (const gretl_matrix *X,
                        int *err)
 {
     gretl_matrix *XOX = NULL;
-    gretl_matrix *Wtj = NULL;
     gretl_matrix *Gj = NULL;
     gretl_matrix *H = NULL;
     gretl_matrix *A = NULL;
@@ -785,7 +792,7 @@ gretl_matrix *HAC_XOX (const gretl_matrix *X,
     int kern;
     int T = X->rows;
     int k = X->cols;
-    int p, j, t;
+    int p, j;
     double bt = 0;
 
     if (use_prior) {
@@ -826,9 +833,8 @@ gretl_matrix *HAC_XOX (const gretl_matrix *X,
 
     if (!*err) {
         XOX = gretl_zero_matrix_new(k, k);
-        Wtj = gretl_matrix_alloc(k, k);
         Gj = gretl_matrix_alloc(k, k);
-        if (XOX == NULL || Wtj == NULL || Gj == NULL) {
+        if (XOX == NULL || Gj == NULL) {
             *err = E_ALLOC;
         }
     }
@@ -860,12 +866,7 @@ gretl_matrix *HAC_XOX (const gretl_matrix *X,
 
         for (j=0; j<=p; j++) {
             /* cumulate running sum of Gamma-hat terms */
-            gretl_matrix_zero(Gj);
-            for (t=j; t<T; t++) {
-                /* W(t)-transpose * W(t-j) */
-                wtw(Wtj, H, t, j);
-                gretl_matrix_add_to(Gj, Wtj);
-            }
+            hac_gamma(Gj, H, j);
             if (j > 0) {
                 /* Gamma(j) = Gamma(j) + Gamma(j)-transpose */
                 gretl_matrix_add_self_transpose(Gj);
@@ -900,7 +901,6 @@ gretl_matrix *HAC_XOX (const gretl_matrix *X,
  bailout:
 
     gretl_matrix_free(H);
-    gretl_matrix_free(Wtj);
     gretl_matrix_free(Gj);
     gretl_matrix_free(A);
     gretl_matrix_free(w);
@@ -1986,6 +1986,460 @@ int gretl_qr_regress (MODEL *pmod, DATASET *dset, gretlopt opt)
     }
 }
 
+/* For a big sample, lapack_cholesky_regress() avoids forming the
+   full T x k matrix of regressors, which could in itself exhaust
+   memory: the data are transcribed from the dataset a block of
+   rows at a time and the cross-products X'X and X'y accumulated
+   block by block, via threaded BLAS where available. The fitted
+   values are then computed by block in a second pass over the
+   data.
+*/
+
+#define CHOL_STREAM_MIN (1 << 23) /* min. T * k for streaming */
+#define CHOL_BLOCK_BYTES (1 << 20) /* target size of a block of X */
+
+static double model_data_value (const MODEL *pmod, const DATASET *dset,
+                                int vi, int t, double rho, double pw1)
+{
+    double xt = dset->Z[vi][t];
+
+    if (pmod->nwt) {
+        xt *= sqrt(dset->Z[pmod->nwt][t]);
+    } else if (rho != 0.0) {
+        if (pw1 != 0.0 && t == pmod->t1) {
+            xt *= pw1;
+        } else {
+            xt -= rho * dset->Z[vi][t-1];
+        }
+    }
+
+    return xt;
+}
+
+/* Transcribe (transformed) data for up to X->rows usable
+   observations, starting at *pt, into @X and, if non-NULL, @y;
+   on return *pt is the observation at which to resume. Returns
+   the number of rows filled, with @X and @y resized to match if
+   this falls short of a full block.
+*/
+
+static int get_model_data_block (const MODEL *pmod, const DATASET *dset,
+                                  int *pt, gretl_matrix *X, gretl_matrix *y)
+{
+    double rho = gls_rho(pmod);
+    double pw1 = 0.0;
+    int k = X->cols;
+    int B = X->rows;
+    int i, t, r = 0;
+
+    if (rho != 0.0 && (pmod->opt & OPT_P)) {
+        pw1 = sqrt(1.0 - rho * rho);
+    }
+
+    for (t=*pt; t<=pmod->t2 && r<B; t++) {
+        if (model_missing(pmod, t) ||
+            (pmod->nwt && dset->Z[pmod->nwt][t] == 0.0)) {
+            continue;
+        }
+        for (i=0; i<k; i++) {
+            X->val[i*B + r] = model_data_value(pmod, dset, pmod->list[i+2],
+                                               t, rho, pw1);
+        }
+        if (y != NULL) {
+            y->val[r] = model_data_value(pmod, dset, pmod->list[1],
+                                         t, rho, pw1);
+        }
+        r++;
+    }
+
+    *pt = t;
+
+    if (r > 0 && r < B) {
+        /* close up the columns of a short block */
+        for (i=1; i<k; i++) {
+            memmove(X->val + i*r, X->val + i*B, r * sizeof(double));
+        }
+        gretl_matrix_reuse(X, r, k);
+        if (y != NULL) {
+            gretl_matrix_reuse(y, r, 1);
+        }
+    }
+
+    return r;
+}
+
+/* First pass: accumulate X'X in @XTX and X'y in @Xy, both of
+   which should be zeroed on input. @X and @y are workspace. */
+
+static int stream_XTX_Xy (const MODEL *pmod, const DATASET *dset,
+                          gretl_matrix *X, gretl_matrix *y,
+                          gretl_matrix *XTX, gretl_matrix *Xy)
+{
+    int B = X->rows, k = X->cols;
+    int t = pmod->t1;
+    int err = 0;
+
+    while (!err && get_model_data_block(pmod, dset, &t, X, y) > 0) {
+        err = gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+                                        X, GRETL_MOD_NONE,
+                                        XTX, GRETL_MOD_CUMULATE);
+        if (!err) {
+            err = gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+                                            y, GRETL_MOD_NONE,
+                                            Xy, GRETL_MOD_CUMULATE);
+        }
+        gretl_matrix_reuse(X, B, k);
+        gretl_matrix_reuse(y, B, 1);
+    }
+
+    return err;
+}
+
+/* Second pass: write the fitted values, X*b, into @yhat. */
+
+static int stream_fitted (const MODEL *pmod, const DATASET *dset,
+                          gretl_matrix *X, gretl_matrix *yb,
+                          const gretl_matrix *b, gretl_matrix *yhat)
+{
+    int B = X->rows, k = X->cols;
+    int t = pmod->t1;
+    int r, s = 0;
+    int err = 0;
+
+    while (!err && (r = get_model_data_block(pmod, dset, &t, X, NULL)) > 0) {
+        gretl_matrix_reuse(yb, r, 1);
+        err = gretl_matrix_multiply(X, b, yb);
+        if (!err) {
+            memcpy(yhat->val + s, yb->val, r * sizeof(double));
+            s += r;
+        }
+        gretl_matrix_reuse(X, B, k);
+        gretl_matrix_reuse(yb, B, 1);
+    }
+
+    return err;
+}
+
+/* Regressors that are mostly zero, such as dummies for the levels
+   of a discrete variable, are held in compressed sparse column
+   (CSC) form, and their contributions to X'X, X'y and the fitted
+   values are computed from their non-zero entries alone. The
+   remaining regressors are transcribed in the usual dense form.
+*/
+
+#define SPARSE_MAX_DENSITY 0.05 /* max. share of non-zero entries */
+#define SPARSE_MIN_COLS 16      /* min. number of sparse columns */
+
+typedef struct csc_matrix_ csc_matrix;
+typedef struct split_design_ split_design;
+
+struct csc_matrix_ {
+    int rows;    /* number of rows */
+    int cols;    /* number of columns */
+    int *colptr; /* start of each column in @rowidx and @val */
+    int *rowidx; /* row indices of the non-zero entries */
+    double *val; /* values of the non-zero entries */
+};
+
+struct split_design_ {
+    gretl_matrix *D; /* the dense regressors */
+    csc_matrix S;    /* the sparse regressors */
+    int *dpos;       /* positions of the dense regressors in the model */
+    int *spos;       /* positions of the sparse regressors */
+};
+
+static void split_design_free (split_design *sd)
+{
+    if (sd != NULL) {
+        gretl_matrix_free(sd->D);
+        free(sd->S.colptr);
+        free(sd->S.rowidx);
+        free(sd->S.val);
+        free(sd->dpos);
+        free(sd->spos);
+        free(sd);
+    }
+}
+
+/* If enough of the regressors in @pmod are sparse, build a split
+   representation of the regressor matrix, and transcribe the
+   dependent variable into @y. Returns NULL, with *err left at
+   zero, if the dense treatment should be used instead.
+*/
+
+static split_design *split_design_new (const MODEL *pmod,
+                                       const DATASET *dset,
+                                       gretl_matrix *y, int *err)
+{
+    split_design *sd = NULL;
+    int T = pmod->nobs;
+    int k = pmod->list[0] - 1;
+    int *nnz;
+    int i, s, t;
+    int ks = 0, kd = 0;
+    int nztot = 0;
+
+    if (pmod->nwt || gls_rho(pmod) != 0.0) {
+        /* transformed data: leave these to the dense code */
+        return NULL;
+    }
+
+    nnz = malloc(k * sizeof *nnz);
+    if (nnz == NULL) {
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    for (i=0; i<k; i++) {
+        const double *x = dset->Z[pmod->list[i+2]];
+
+        nnz[i] = 0;
+        for (t=pmod->t1; t<=pmod->t2; t++) {
+            if (!model_missing(pmod, t) && x[t] != 0.0) {
+                nnz[i] += 1;
+            }
+        }
+        if (nnz[i] <= SPARSE_MAX_DENSITY * T) {
+            nztot += nnz[i];
+            ks++;
+        }
+    }
+
+    if (ks < SPARSE_MIN_COLS) {
+        free(nnz);
+        return NULL;
+    }
+
+    kd = k - ks;
+    sd = calloc(1, sizeof *sd);
+    if (sd == NULL) {
+        free(nnz);
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    sd->S.rows = T;
+    sd->S.cols = ks;
+    sd->S.colptr = malloc((ks + 1) * sizeof *sd->S.colptr);
+    sd->S.rowidx = malloc(nztot * sizeof *sd->S.rowidx);
+    sd->S.val = malloc(nztot * sizeof *sd->S.val);
+    sd->spos = malloc(ks * sizeof *sd->spos);
+    if (kd > 0) {
+        sd->D = gretl_matrix_alloc(T, kd);
+        sd->dpos = malloc(kd * sizeof *sd->dpos);
+    }
+
+    if (sd->S.colptr == NULL || sd->S.rowidx == NULL ||
+        sd->S.val == NULL || sd->spos == NULL ||
+        (kd > 0 && (sd->D == NULL || sd->dpos == NULL))) {
+        split_design_free(sd);
+        free(nnz);
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    sd->S.colptr[0] = 0;
+    ks = kd = 0;
+
+    for (i=0; i<k; i++) {
+        const double *x = dset->Z[pmod->list[i+2]];
+        int sparse = nnz[i] <= SPARSE_MAX_DENSITY * T;
+        double *dcol = NULL;
+        int p = 0;
+
+        if (sparse) {
+            sd->spos[ks] = i;
+            p = sd->S.colptr[ks];
+        } else {
+            sd->dpos[kd] = i;
+            dcol = sd->D->val + (size_t) kd * T;
+        }
+        for (t=pmod->t1, s=0; t<=pmod->t2; t++) {
+            if (model_missing(pmod, t)) {
+                continue;
+            }
+            if (!sparse) {
+                dcol[s] = x[t];
+            } else if (x[t] != 0.0) {
+                sd->S.rowidx[p] = s;
+                sd->S.val[p++] = x[t];
+            }
+            s++;
+        }
+        if (sparse) {
+            sd->S.colptr[++ks] = p;
+        } else {
+            kd++;
+        }
+    }
+
+    for (t=pmod->t1, s=0; t<=pmod->t2; t++) {
+        if (!model_missing(pmod, t)) {
+            y->val[s++] = dset->Z[pmod->list[1]][t];
+        }
+    }
+
+    free(nnz);
+
+    return sd;
+}
+
+/* Form X'X and X'y from the split design @sd: the dense-dense block
+   by BLAS, the dense-sparse block column by column over the
+   non-zeros, and the sparse-sparse block row by row, via a
+   transposed (compressed row) copy of the sparse part, so that the
+   work is proportional to the sum over rows of the squared number
+   of non-zeros.
+*/
+
+static int split_XTX_Xy (const split_design *sd, const gretl_matrix *y,
+                         gretl_matrix *XTX, gretl_matrix *Xy)
+{
+    const csc_matrix *S = &sd->S;
+    int T = S->rows, ks = S->cols;
+    int kd = (sd->D == NULL)? 0 : sd->D->cols;
+    int nz = S->colptr[ks];
+    int *rowptr = NULL, *colidx = NULL;
+    double *rval = NULL;
+    int i, j, p, q, r;
+    int err = 0;
+
+    gretl_matrix_zero(XTX);
+
+    if (kd > 0) {
+        gretl_matrix *DD = gretl_matrix_alloc(kd, kd);
+        gretl_matrix *Dy = gretl_matrix_alloc(kd, 1);
+
+        if (DD == NULL || Dy == NULL) {
+            err = E_ALLOC;
+        } else {
+            gretl_matrix_multiply_mod(sd->D, GRETL_MOD_TRANSPOSE,
+                                      sd->D, GRETL_MOD_NONE,
+                                      DD, GRETL_MOD_NONE);
+            gretl_matrix_multiply_mod(sd->D, GRETL_MOD_TRANSPOSE,
+                                      y, GRETL_MOD_NONE,
+                                      Dy, GRETL_MOD_NONE);
+            for (i=0; i<kd; i++) {
+                for (j=0; j<kd; j++) {
+                    gretl_matrix_set(XTX, sd->dpos[i], sd->dpos[j],
+                                     gretl_matrix_get(DD, i, j));
+                }
+                Xy->val[sd->dpos[i]] = Dy->val[i];
+            }
+        }
+        gretl_matrix_free(DD);
+        gretl_matrix_free(Dy);
+        if (err) {
+            return err;
+        }
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(i,p) if (gretl_use_openmp((guint64) nz * (kd + 1)))
+#endif
+    for (j=0; j<ks; j++) {
+        int cj = sd->spos[j];
+        double sy = 0.0;
+
+        for (i=0; i<kd; i++) {
+            const double *d = sd->D->val + (size_t) i * T;
+            double x = 0.0;
+
+            for (p=S->colptr[j]; p<S->colptr[j+1]; p++) {
+                x += S->val[p] * d[S->rowidx[p]];
+            }
+            gretl_matrix_set(XTX, sd->dpos[i], cj, x);
+            gretl_matrix_set(XTX, cj, sd->dpos[i], x);
+        }
+        for (p=S->colptr[j]; p<S->colptr[j+1]; p++) {
+            sy += S->val[p] * y->val[S->rowidx[p]];
+        }
+        Xy->val[cj] = sy;
+    }
+
+    rowptr = calloc(T + 1, sizeof *rowptr);
+    colidx = malloc(nz * sizeof *colidx);
+    rval = malloc(nz * sizeof *rval);
+    if (rowptr == NULL || colidx == NULL || rval == NULL) {
+        err = E_ALLOC;
+        goto bailout;
+    }
+
+    /* transpose to compressed row form */
+    for (p=0; p<nz; p++) {
+        rowptr[S->rowidx[p] + 1] += 1;
+    }
+    for (r=0; r<T; r++) {
+        rowptr[r+1] += rowptr[r];
+    }
+    for (j=0; j<ks; j++) {
+        for (p=S->colptr[j]; p<S->colptr[j+1]; p++) {
+            q = rowptr[S->rowidx[p]]++;
+            colidx[q] = j;
+            rval[q] = S->val[p];
+        }
+    }
+    for (r=T; r>0; r--) {
+        rowptr[r] = rowptr[r-1];
+    }
+    rowptr[0] = 0;
+
+    for (r=0; r<T; r++) {
+        for (p=rowptr[r]; p<rowptr[r+1]; p++) {
+            int ci = sd->spos[colidx[p]];
+
+            for (q=p; q<rowptr[r+1]; q++) {
+                int cj = sd->spos[colidx[q]];
+                double x = gretl_matrix_get(XTX, ci, cj) + rval[p] * rval[q];
+
+                gretl_matrix_set(XTX, ci, cj, x);
+                if (cj != ci) {
+                    gretl_matrix_set(XTX, cj, ci, x);
+                }
+            }
+        }
+    }
+
+ bailout:
+
+    free(rowptr);
+    free(colidx);
+    free(rval);
+
+    return err;
+}
+
+/* Write the fitted values, X*b, into @yhat. */
+
+static void split_fitted (const split_design *sd, const gretl_matrix *b,
+                          gretl_matrix *yhat)
+{
+    const csc_matrix *S = &sd->S;
+    int T = S->rows;
+    int i, j, p, t;
+
+    gretl_matrix_zero(yhat);
+
+    if (sd->D != NULL) {
+        for (i=0; i<sd->D->cols; i++) {
+            const double *d = sd->D->val + (size_t) i * T;
+            double bi = b->val[sd->dpos[i]];
+
+            for (t=0; t<T; t++) {
+                yhat->val[t] += bi * d[t];
+            }
+        }
+    }
+
+    for (j=0; j<S->cols; j++) {
+        double bj = b->val[sd->spos[j]];
+
+        for (p=S->colptr[j]; p<S->colptr[j+1]; p++) {
+            yhat->val[S->rowidx[p]] += bj * S->val[p];
+        }
+    }
+}
+
 int lapack_cholesky_regress (MODEL *pmod, const DATASET *dset,
                              gretlopt opt)
 {
@@ -1994,30 +2448,68 @@ int lapack_cholesky_regress (MODEL *pmod, const DATASET *dset,
     gretl_matrix *X = NULL;
     gretl_matrix *b = NULL;
     gretl_matrix *XTX = NULL;
+    gretl_matrix *yb = NULL;
+    split_design *sd = NULL;
+    int stream = 0;
     int err = 0;
 
     T = pmod->nobs;        /* # of rows (observations) */
     k = pmod->list[0] - 1; /* # of cols (variables) */
 
     y = gretl_matrix_alloc(T, 1);
-    X = gretl_matrix_alloc(T, k);
-    b = gretl_matrix_alloc(k, 1);
-
-    if (y == NULL || X == NULL || b == NULL) {
+    if (y == NULL) {
         err = E_ALLOC;
         goto ch_cleanup;
     }
 
-    get_model_data(pmod, dset, X, y);
-
-    XTX = gretl_matrix_XTX_new(X);
-    if (XTX == NULL) {
-        err = E_ALLOC;
+    /* the robust VCV and DW p-value still need the full X */
+    if (!(opt & (OPT_R | OPT_I))) {
+        sd = split_design_new(pmod, dset, y, &err);
+        if (err) {
+            goto ch_cleanup;
+        }
+        stream = sd == NULL && (guint64) T * k >= CHOL_STREAM_MIN;
     }
-    if (!err) {
-        err = gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
-                                        y, GRETL_MOD_NONE,
-                                        b, GRETL_MOD_NONE);
+
+    if (sd != NULL) {
+        XTX = gretl_matrix_alloc(k, k);
+        b = gretl_matrix_alloc(k, 1);
+        if (XTX == NULL || b == NULL) {
+            err = E_ALLOC;
+            goto ch_cleanup;
+        }
+        err = split_XTX_Xy(sd, y, XTX, b);
+    } else if (stream) {
+        int B = MAX(CHOL_BLOCK_BYTES / (k * sizeof(double)), 64);
+
+        X = gretl_matrix_alloc(B, k);
+        yb = gretl_matrix_alloc(B, 1);
+        XTX = gretl_zero_matrix_new(k, k);
+        b = gretl_zero_matrix_new(k, 1);
+        if (X == NULL || yb == NULL || XTX == NULL || b == NULL) {
+            err = E_ALLOC;
+            goto ch_cleanup;
+        }
+        err = stream_XTX_Xy(pmod, dset, X, yb, XTX, b);
+    } else {
+        X = gretl_matrix_alloc(T, k);
+        b = gretl_matrix_alloc(k, 1);
+        if (X == NULL || b == NULL) {
+            err = E_ALLOC;
+            goto ch_cleanup;
+        }
+
+        get_model_data(pmod, dset, X, y);
+
+        XTX = gretl_matrix_XTX_new(X);
+        if (XTX == NULL) {
+            err = E_ALLOC;
+        }
+        if (!err) {
+            err = gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+                                            y, GRETL_MOD_NONE,
+                                            b, GRETL_MOD_NONE);
+        }
     }
     if (!err) {
         err = gretl_cholesky_decomp_solve(XTX, b);
@@ -2032,7 +2524,16 @@ int lapack_cholesky_regress (MODEL *pmod, const DATASET *dset,
     }
 
     /* write vector of fitted values into y */
-    gretl_matrix_multiply(X, b, y);
+    if (sd != NULL) {
+        split_fitted(sd, b, y);
+    } else if (stream) {
+        err = stream_fitted(pmod, dset, X, yb, b, y);
+        if (err) {
+            goto ch_cleanup;
+        }
+    } else {
+        gretl_matrix_multiply(X, b, y);
+    }
 
     /* OLS coefficients */
     pmod->coeff = gretl_matrix_steal_data(b);
@@ -2094,15 +2595,27 @@ int lapack_cholesky_regress (MODEL *pmod, const DATASET *dset,
 
     gretl_matrix_free(X);
     gretl_matrix_free(y);
+    gretl_matrix_free(yb);
     gretl_matrix_free(b);
     gretl_matrix_free(XTX);
+    split_design_free(sd);
 
     pmod->errcode = (err == E_NOTPD)? E_SINGULAR: err;
 
     return err;
 }
 
-int qr_tsls_vcv (MODEL *pmod, DATASET *dset, gretlopt opt)
+/* Covariance matrix for IV estimates, given the second-stage
+   regressors \hat{X}. If @G is non-NULL it should hold Q'\hat{X},
+   where Q is the orthonormal factor of the instrument matrix: since
+   \hat{X} = QG, the R factor of \hat{X} can be obtained from the
+   small matrix G. In that case the orthonormal factor of \hat{X}
+   is formed, as \hat{X} R^{-1}, only if an HCCME variant that
+   requires leverage values is wanted.
+*/
+
+int qr_tsls_vcv (MODEL *pmod, DATASET *dset, const gretl_matrix *G,
+                 gretlopt opt)
 {
     gretl_matrix *Q = NULL;
     gretl_matrix *R = NULL;
@@ -2111,7 +2624,11 @@ int qr_tsls_vcv (MODEL *pmod, DATASET *dset, gretlopt opt)
 
     k = pmod->list[0] - 1;
 
-    Q = make_data_X(pmod, dset, 0);
+    if (G != NULL) {
+        Q = gretl_matrix_copy(G);
+    } else {
+        Q = make_data_X(pmod, dset, 0);
+    }
     R = gretl_matrix_alloc(k, k);
     V = gretl_matrix_alloc(k, k);
 
@@ -2125,6 +2642,12 @@ int qr_tsls_vcv (MODEL *pmod, DATASET *dset, gretlopt opt)
         goto qr_cleanup;
     }
 
+    if (G != NULL) {
+        /* this Q is not that of \hat{X} */
+        gretl_matrix_free(Q);
+        Q = NULL;
+    }
+
     /* create (X'X)^{-1} */
     gretl_matrix_multiply_mod(R, GRETL_MOD_NONE,
                               R, GRETL_MOD_TRANSPOSE,
@@ -2147,7 +2670,21 @@ int qr_tsls_vcv (MODEL *pmod, DATASET *dset, gretlopt opt)
             err = qr_make_hac(pmod, dset, V);
         } else {
             pmod->opt |= OPT_R;
-            err = qr_make_hccme(pmod, dset, Q, V);
+            if (Q == NULL && libset_get_int(HC_VERSION) > 1) {
+                gretl_matrix *X = make_data_X(pmod, dset, 0);
+
+                Q = gretl_matrix_alloc(pmod->nobs, k);
+                if (X == NULL || Q == NULL) {
+                    err = E_ALLOC;
+                } else {
+                    /* R holds R^{-1} at this point */
+                    gretl_matrix_multiply(X, R, Q);
+                }
+                gretl_matrix_free(X);
+            }
+            if (!err) {
+                err = qr_make_hccme(pmod, dset, Q, V);
+            }
         }
     } else {
         qr_make_regular_vcv(pmod, V, OPT_NONE);
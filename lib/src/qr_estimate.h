@@ -25,7 +25,8 @@ int gretl_qr_regress (MODEL *pmod, DATASET *dset, gretlopt opt);
 int lapack_cholesky_regress (MODEL *pmod, const DATASET *dset,
 			     gretlopt opt);
 
-int qr_tsls_vcv (MODEL *pmod, DATASET *dset, gretlopt opt);
+int qr_tsls_vcv (MODEL *pmod, DATASET *dset, const gretl_matrix *G,
+		 gretlopt opt);
 
 int qr_matrix_hccme (const gretl_matrix *X,
 		     const gretl_matrix *h,
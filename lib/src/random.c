@@ -24,6 +24,8 @@
 #include <fcntl.h>
 #include <errno.h>
 
+#include "gretl_mt.h"
+
 #ifdef HAVE_MPI
 # include "gretl_mpi.h"
 #endif
@@ -57,6 +59,34 @@
 
 static uint64_t xor_seed;
 
+/* A thread that runs its own libgretl context (see
+   gretl_rand_thread_init() below) draws from a stream of its
+   own in place of the global state, and may reseed it.
+*/
+
+static gretl_rng *thread_rng;
+static uint64_t thread_seed;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(thread_rng, thread_seed)
+#endif
+
+/* The state to draw from: that of stream @r, or the default state
+   for the calling thread if @r is NULL. See gretl_rng_streams_init()
+   below.
+*/
+
+static inline uint64_t *rng_state (gretl_rng *r)
+{
+    if (r != NULL) {
+        return r->s;
+    } else if (thread_rng != NULL) {
+        return thread_rng->s;
+    } else {
+        return xor_state;
+    }
+}
+
 static inline double double_from_uint64 (uint64_t u)
 {
     /* Set the exponent to 0x3FF (for 1.0) and the sign bit to 0;
@@ -72,9 +102,9 @@ static inline double double_from_uint64 (uint64_t u)
     return ret - 1.0;
 }
 
-static uint32_t randi32 (void)
+static uint32_t randi32 (uint64_t *s)
 {
-    return (uint32_t) (xor_i64() >> 32);
+    return (uint32_t) (xor_i64_s(s) >> 32);
 }
 
 static uint64_t get_auto_seed (void)
@@ -171,6 +201,25 @@ void gretl_mpi_rand_init (int n, int self, int single_rng)
 
 #endif /* HAVE_MPI */
 
+/**
+ * gretl_rand_jump:
+ * @n: number of jumps.
+ *
+ * Advances the state of gretl's PRNG by @n times 2^128 drawings,
+ * so giving a stream of values that does not overlap with those
+ * from the current state. Used to equip parallel worker processes
+ * with their own streams, as in gretl_mpi_rand_init().
+ */
+
+void gretl_rand_jump (int n)
+{
+    int i;
+
+    for (i=0; i<n; i++) {
+        xor_jump_s(rng_state(NULL));
+    }
+}
+
 /**
  * gretl_rand_get_seed:
  *
@@ -179,7 +228,7 @@ void gretl_mpi_rand_init (int n, int self, int single_rng)
 
 uint64_t gretl_rand_get_seed (void)
 {
-    return xor_seed;
+    return thread_rng != NULL ? thread_seed : xor_seed;
 }
 
 /**
@@ -193,34 +242,89 @@ uint64_t gretl_rand_get_seed (void)
 
 void gretl_rand_set_seed (uint64_t seed)
 {
-    if (seed > 0) {
-        xor_seed = (uint64_t) seed;
-        set_xor_state(xor_seed);
+    if (seed == 0) {
+        seed = get_auto_seed();
+    }
+
+    if (thread_rng != NULL) {
+        thread_seed = seed;
+        set_xor_state_s(thread_rng->s, seed);
     } else {
-        xor_seed = get_auto_seed();
+        xor_seed = seed;
         set_xor_state(xor_seed);
     }
 }
 
+G_LOCK_DEFINE_STATIC(rng_threads);
+
 /**
- * gretl_rand_01:
+ * gretl_rand_thread_init:
+ *
+ * Equips the calling thread with an RNG stream of its own, which
+ * then takes the place of the global generator for all gretl_rand
+ * functions called from this thread with no explicit stream
+ * (including "set seed"). The stream is split off the global
+ * generator as by gretl_rng_streams_init(), so it does not overlap
+ * with any other, and for a given seed it depends only on the
+ * order in which threads are initialized. Called by
+ * libgretl_thread_init(); it should not be called by the thread
+ * that called libgretl_init().
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int gretl_rand_thread_init (void)
+{
+    int err = 0;
+
+    if (thread_rng == NULL) {
+        G_LOCK(rng_threads);
+        thread_rng = gretl_rng_streams_new(1, &err);
+        G_UNLOCK(rng_threads);
+        if (err) {
+            free(thread_rng);
+            thread_rng = NULL;
+        } else {
+            thread_seed = xor_seed;
+        }
+    }
+
+    return err;
+}
+
+/**
+ * gretl_rand_thread_cleanup:
+ *
+ * Frees the RNG stream of the calling thread, if any, which
+ * reverts to using the global generator.
+ */
+
+void gretl_rand_thread_cleanup (void)
+{
+    free(thread_rng);
+    thread_rng = NULL;
+}
+
+/**
+ * gretl_rand_01_r:
+ * @r: RNG stream, or NULL for the global stream.
  *
  * Returns: the next random double, equally distributed over
  * the range [0, 1).
  */
 
-double gretl_rand_01 (void)
+double gretl_rand_01_r (gretl_rng *r)
 {
-    return double_from_uint64(xor_i64());
+    return double_from_uint64(xor_i64_s(rng_state(r)));
 }
 
 #if !(HAVE_X86_32)
 
 /* 53 bits for mantissa + 1 bit sign */
 
-static uint64_t randi54 (void)
+static uint64_t randi54 (uint64_t *s)
 {
-    const uint64_t u = xor_i64();
+    const uint64_t u = xor_i64_s(s);
     const uint64_t mask = (1ULL << 54) - 1;
 
     return u & mask;
@@ -230,9 +334,9 @@ static uint64_t randi54 (void)
 
 /* generates a uniform random double on (0,1) with 53-bit resolution */
 
-static double randu53 (void)
+static double randu53 (uint64_t *s)
 {
-    const uint64_t u = xor_i64() >> 11;
+    const uint64_t u = xor_i64_s(s) >> 11;
 
     return (double) u * 0x1.0p-53;
 }
@@ -295,18 +399,12 @@ static void create_ziggurat_tables (void)
     initt = 0;
 }
 
-/**
- * gretl_one_snormal:
- *
- * Returns: a single drawing from the standard normal distribution.
- */
+/* One ziggurat drawing from state @s; the tables must already
+   have been created.
+*/
 
-double gretl_one_snormal (void)
+static inline double zig_snormal (uint64_t *s)
 {
-    if (initt) {
-	create_ziggurat_tables();
-    }
-
     while (1) {
 #if HAVE_X86_32
 	/* Specialized for x86 32-bit architecture: 53-bit mantissa,
@@ -318,18 +416,18 @@ double gretl_one_snormal (void)
 	int64_t rabs;
 	uint32_t *p = (uint32_t *) &rabs;
 
-	lo = randi32();
+	lo = randi32(s);
 	idx = lo & 0xFF;
-	hi = randi32();
+	hi = randi32(s);
 	si = hi & UMASK;
 	p[0] = lo;
 	p[1] = hi & 0x1FFFFF;
 	x = (si ? -rabs : rabs) * wi[idx];
 #else
-	const uint64_t r = randi54();
-	const int64_t rabs = r >> 1;
+	const uint64_t u = randi54(s);
+	const int64_t rabs = u >> 1;
 	const int idx = (int) (rabs & 0xFF);
-	const double x = ((r & 1) ? -rabs : rabs) * wi[idx];
+	const double x = ((u & 1) ? -rabs : rabs) * wi[idx];
 #endif
 
 	if (rabs < (int64_t) (ki[idx])) {
@@ -345,18 +443,130 @@ double gretl_one_snormal (void)
 	    double xx, yy;
 
 	    do {
-		xx = - ZIGGURAT_NOR_INV_R * log(randu53());
-		yy = - log(randu53());
+		xx = - ZIGGURAT_NOR_INV_R * log(randu53(s));
+		yy = - log(randu53(s));
             } while (yy+yy <= xx*xx);
 	    return (rabs & 0x100) ? -ZIGGURAT_NOR_R-xx : ZIGGURAT_NOR_R+xx;
-        } else if ((fi[idx-1] - fi[idx]) * randu53() + fi[idx] < exp(-0.5*x*x)) {
+        } else if ((fi[idx-1] - fi[idx]) * randu53(s) + fi[idx] < exp(-0.5*x*x)) {
 	    return x;
 	}
     }
 }
 
 /**
- * gretl_rand_normal:
+ * gretl_one_snormal_r:
+ * @r: RNG stream, or NULL for the global stream.
+ *
+ * Returns: a single drawing from the standard normal distribution.
+ */
+
+double gretl_one_snormal_r (gretl_rng *r)
+{
+    if (initt) {
+	create_ziggurat_tables();
+    }
+
+    return zig_snormal(rng_state(r));
+}
+
+/* Bulk fills of @n values for stream state @state. We work on a
+   local copy of the state, which the compiler can keep in
+   registers, and store it back at the end; the sequence of values
+   is the same as for one-at-a-time drawing.
+*/
+
+static void snormal_fill (uint64_t *state, double *a, int n)
+{
+    uint64_t s[4];
+    int i;
+
+    memcpy(s, state, sizeof s);
+    for (i=0; i<n; i++) {
+	a[i] = zig_snormal(s);
+    }
+    memcpy(state, s, sizeof s);
+}
+
+static void uniform_fill (uint64_t *state, double *a, int n)
+{
+    uint64_t s[4];
+    int i;
+
+    memcpy(s, state, sizeof s);
+    for (i=0; i<n; i++) {
+	a[i] = double_from_uint64(xor_i64_s(s));
+    }
+    memcpy(state, s, sizeof s);
+}
+
+static void gamma_fill (uint64_t *state, double *a, int n,
+			double shape, double scale);
+
+/* Optional parallel filling of large arrays from the global
+   generator: the array is cut into blocks of fixed size, and block
+   k is filled from stream k as set up by gretl_rng_streams_init().
+   The result depends on the seed but not on the number of threads;
+   it differs, however, from the sequence that serial drawing would
+   produce, which is why this is an option ("set rng_parallel on").
+*/
+
+#define RNG_BLOCK 65536
+
+enum {
+    FILL_NORMAL,
+    FILL_UNIFORM,
+    FILL_GAMMA
+};
+
+static int rand_parallel;
+
+void gretl_rand_set_parallel (int s)
+{
+    rand_parallel = (s != 0);
+}
+
+static int use_parallel_fill (gretl_rng *r, int n)
+{
+    return r == NULL && rand_parallel && n >= 2 * RNG_BLOCK;
+}
+
+static int parallel_fill (double *a, int n, int dist,
+			  double p1, double p2)
+{
+    gretl_rng *streams;
+    int nb = (n + RNG_BLOCK - 1) / RNG_BLOCK;
+    int b, err = 0;
+
+    streams = gretl_rng_streams_new(nb, &err);
+    if (err) {
+	free(streams);
+	return err;
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n))
+#endif
+    for (b=0; b<nb; b++) {
+	double *ab = a + (size_t) b * RNG_BLOCK;
+	int len = (b == nb - 1)? n - b * RNG_BLOCK : RNG_BLOCK;
+
+	if (dist == FILL_NORMAL) {
+	    snormal_fill(streams[b].s, ab, len);
+	} else if (dist == FILL_UNIFORM) {
+	    uniform_fill(streams[b].s, ab, len);
+	} else {
+	    gamma_fill(streams[b].s, ab, len, p1, p2);
+	}
+    }
+
+    free(streams);
+
+    return 0;
+}
+
+/**
+ * gretl_rand_normal_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array
  * @t1: start of the fill range
  * @t2: end of the fill range
@@ -367,17 +577,29 @@ double gretl_one_snormal (void)
  * normal distribution.
  */
 
-void gretl_rand_normal (double *a, int t1, int t2)
+void gretl_rand_normal_r (gretl_rng *r, double *a, int t1, int t2)
 {
-    int t;
+    int n = t2 - t1 + 1;
 
-    for (t=t1; t<=t2; t++) {
-	a[t] = gretl_one_snormal();
+    if (n <= 0) {
+	return;
+    }
+
+    if (initt) {
+	create_ziggurat_tables();
     }
+
+    if (use_parallel_fill(r, n) &&
+	parallel_fill(a + t1, n, FILL_NORMAL, 0, 0) == 0) {
+	return;
+    }
+
+    snormal_fill(rng_state(r), a + t1, n);
 }
 
 /**
- * gretl_rand_normal_full:
+ * gretl_rand_normal_full_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array
  * @t1: start of the fill range
  * @t2: end of the fill range
@@ -392,8 +614,8 @@ void gretl_rand_normal (double *a, int t1, int t2)
  * Returns: 0 on success, 1 on invalid input.
  */
 
-int gretl_rand_normal_full (double *a, int t1, int t2,
-			    double mean, double sd)
+int gretl_rand_normal_full_r (gretl_rng *r, double *a, int t1, int t2,
+			      double mean, double sd)
 {
     int t;
 
@@ -404,7 +626,7 @@ int gretl_rand_normal_full (double *a, int t1, int t2,
 	return E_INVARG;
     }
 
-    gretl_rand_normal(a, t1, t2);
+    gretl_rand_normal_r(r, a, t1, t2);
 
     if (mean != 0.0 || sd != 1.0) {
 	for (t=t1; t<=t2; t++) {
@@ -415,7 +637,8 @@ int gretl_rand_normal_full (double *a, int t1, int t2,
     return 0;
 }
 
-static uint32_t rand_int_range (uint32_t begin, uint32_t end)
+static uint32_t rand_int_range (uint64_t *s, uint32_t begin,
+				uint32_t end)
 {
     uint32_t dist = end - begin;
     uint32_t rval = 0;
@@ -437,7 +660,7 @@ static uint32_t rand_int_range (uint32_t begin, uint32_t end)
 	}
 
         do {
-            rval = randi32();
+            rval = randi32(s);
         } while (rval > maxval);
 
 	rval %= dist;
@@ -447,7 +670,8 @@ static uint32_t rand_int_range (uint32_t begin, uint32_t end)
 }
 
 /**
- * gretl_rand_uniform_minmax:
+ * gretl_rand_uniform_minmax_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -461,8 +685,8 @@ static uint32_t rand_int_range (uint32_t begin, uint32_t end)
  * Returns: 0 on success, 1 on invalid input.
  */
 
-int gretl_rand_uniform_minmax (double *a, int t1, int t2,
-			       double min, double max)
+int gretl_rand_uniform_minmax_r (gretl_rng *r, double *a, int t1,
+				 int t2, double min, double max)
 {
     int t;
 
@@ -474,14 +698,15 @@ int gretl_rand_uniform_minmax (double *a, int t1, int t2,
     }
 
     for (t=t1; t<=t2; t++) {
-        a[t] = double_from_uint64(xor_i64()) * (max - min) + min;
+        a[t] = double_from_uint64(xor_i64_s(rng_state(r))) * (max - min) + min;
     }
 
     return 0;
 }
 
 /**
- * gretl_rand_int_minmax:
+ * gretl_rand_int_minmax_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array.
  * @n: length of array.
  * @min: lower closed bound of range.
@@ -493,7 +718,8 @@ int gretl_rand_uniform_minmax (double *a, int t1, int t2,
  * Returns: 0 on success, 1 on invalid input.
  */
 
-int gretl_rand_int_minmax (int *a, int n, int min, int max)
+int gretl_rand_int_minmax_r (gretl_rng *r, int *a, int n, int min,
+			     int max)
 {
     int i, err = 0;
 
@@ -513,7 +739,7 @@ int gretl_rand_int_minmax (int *a, int n, int min, int max)
 	}
 
 	for (i=0; i<n; i++) {
-	    a[i] = rand_int_range(min, max + 1) - offset;
+	    a[i] = rand_int_range(rng_state(r), min, max + 1) - offset;
 	}
     }
 
@@ -539,7 +765,8 @@ static int already_selected (double *a, int n, double val,
 }
 
 /**
- * gretl_rand_uniform_int_minmax:
+ * gretl_rand_uniform_int_minmax_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -554,9 +781,9 @@ static int already_selected (double *a, int n, double val,
  * Returns: 0 on success, 1 on invalid input.
  */
 
-int gretl_rand_uniform_int_minmax (double *a, int t1, int t2,
-				   int min, int max,
-				   gretlopt opt)
+int gretl_rand_uniform_int_minmax_r (gretl_rng *r, double *a, int t1,
+				     int t2, int min, int max,
+				     gretlopt opt)
 {
     int t, err = 0;
 
@@ -577,10 +804,10 @@ int gretl_rand_uniform_int_minmax (double *a, int t1, int t2,
 	}
 
 	for (t=t1; t<=t2; t++) {
-	    x = rand_int_range(min, max + 1);
+	    x = rand_int_range(rng_state(r), min, max + 1);
 	    if (opt & OPT_O) {
 		while (already_selected(a, i, x, offset)) {
-		    x = rand_int_range(min, max + 1);
+		    x = rand_int_range(rng_state(r), min, max + 1);
 		}
 	    }
 	    a[t] = x - offset;
@@ -592,7 +819,8 @@ int gretl_rand_uniform_int_minmax (double *a, int t1, int t2,
 }
 
 /**
- * gretl_rand_uniform:
+ * gretl_rand_uniform_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array
  * @t1: start of the fill range
  * @t2: end of the fill range
@@ -602,21 +830,38 @@ int gretl_rand_uniform_int_minmax (double *a, int t1, int t2,
  * Twister.
  */
 
-void gretl_rand_uniform (double *a, int t1, int t2)
+void gretl_rand_uniform_r (gretl_rng *r, double *a, int t1, int t2)
 {
-    int t;
+    int n = t2 - t1 + 1;
 
-    for (t=t1; t<=t2; t++) {
-        a[t] = double_from_uint64(xor_i64());
+    if (n <= 0) {
+	return;
     }
+
+    if (use_parallel_fill(r, n) &&
+	parallel_fill(a + t1, n, FILL_UNIFORM, 0, 0) == 0) {
+	return;
+    }
+
+    uniform_fill(rng_state(r), a + t1, n);
 }
 
-static double gretl_rand_uniform_one (void)
+static double gretl_rand_uniform_one (gretl_rng *r)
 {
-    return double_from_uint64(xor_i64());
+    return double_from_uint64(xor_i64_s(rng_state(r)));
 }
 
-double gretl_rand_gamma_one (double shape, double scale)
+/**
+ * gretl_rand_gamma_one_r:
+ * @r: RNG stream, or NULL for the global stream.
+ * @shape: shape parameter.
+ * @scale: scale parameter.
+ *
+ * Returns: a single drawing from the specified gamma distribution,
+ * or #NADBL if either parameter is out of bounds.
+ */
+
+double gretl_rand_gamma_one_r (gretl_rng *r, double shape, double scale)
 {
     double k = shape;
     double d, c, x, v, u, dv;
@@ -633,11 +878,11 @@ double gretl_rand_gamma_one (double shape, double scale)
     c = 1.0 / sqrt(9*d);
 
     while (1) {
-	x = gretl_one_snormal();
+	x = gretl_one_snormal_r(r);
 	v = pow(1 + c*x, 3);
 	if (v > 0.0) {
 	    dv = d * v;
-	    u = gretl_rand_01();
+	    u = gretl_rand_01_r(r);
 	    /* apply squeeze */
 	    if (u < 1 - 0.0331 * pow(x, 4) ||
 		log(u) < 0.5*x*x + d*(1-v+log(v))) {
@@ -646,7 +891,7 @@ double gretl_rand_gamma_one (double shape, double scale)
 	}
     }
     if (shape < 1) {
-	u = gretl_rand_01();
+	u = gretl_rand_01_r(r);
 	dv *= pow(u, 1/shape);
     }
 
@@ -666,7 +911,8 @@ double gretl_rand_gamma_one (double shape, double scale)
 */
 
 /**
- * gretl_rand_gamma:
+ * gretl_rand_gamma_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -679,17 +925,43 @@ double gretl_rand_gamma_one (double shape, double scale)
  * Returns: 0 on success, non-zero on error.
  */
 
-int gretl_rand_gamma (double *a, int t1, int t2,
-		      double shape, double scale)
+int gretl_rand_gamma_r (gretl_rng *r, double *a, int t1, int t2,
+			double shape, double scale)
 {
-    double k = shape;
-    double d, c, x, v, u, dv;
-    int t;
+    int n = t2 - t1 + 1;
 
     if (shape <= 0 || scale <= 0) {
 	return E_DATA;
+    } else if (n <= 0) {
+	return 0;
+    }
+
+    if (initt) {
+	create_ziggurat_tables();
+    }
+
+    if (use_parallel_fill(r, n) &&
+	parallel_fill(a + t1, n, FILL_GAMMA, shape, scale) == 0) {
+	return 0;
     }
 
+    gamma_fill(rng_state(r), a + t1, n, shape, scale);
+
+    return 0;
+}
+
+/* the gamma loop for state @state, working on a local copy as in
+   snormal_fill()
+*/
+
+static void gamma_fill (uint64_t *state, double *a, int n,
+			double shape, double scale)
+{
+    uint64_t s[4];
+    double k = shape;
+    double d, c, x, v, u, dv;
+    int t;
+
     if (shape < 1) {
 	k = shape + 1.0;
     }
@@ -697,13 +969,15 @@ int gretl_rand_gamma (double *a, int t1, int t2,
     d = k - 1.0/3;
     c = 1.0 / sqrt(9*d);
 
-    for (t=t1; t<=t2; t++) {
+    memcpy(s, state, sizeof s);
+
+    for (t=0; t<n; t++) {
 	while (1) {
-	    x = gretl_one_snormal();
+	    x = zig_snormal(s);
 	    v = pow(1 + c*x, 3);
 	    if (v > 0.0) {
 		dv = d * v;
-		u = gretl_rand_01();
+		u = double_from_uint64(xor_i64_s(s));
 		/* apply squeeze */
 		if (u < 1 - 0.0331 * pow(x, 4) ||
 		    log(u) < 0.5*x*x + d*(1-v+log(v))) {
@@ -712,17 +986,18 @@ int gretl_rand_gamma (double *a, int t1, int t2,
 	    }
 	}
 	if (shape < 1) {
-	    u = gretl_rand_01();
+	    u = double_from_uint64(xor_i64_s(s));
 	    dv *= pow(u, 1/shape);
 	}
 	a[t] = dv * scale;
     }
 
-    return 0;
+    memcpy(state, s, sizeof s);
 }
 
 /**
- * gretl_rand_chisq:
+ * gretl_rand_chisq_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -735,13 +1010,14 @@ int gretl_rand_gamma (double *a, int t1, int t2,
  * Returns: 0 on success, non-zero on error.
  */
 
-int gretl_rand_chisq (double *a, int t1, int t2, int v)
+int gretl_rand_chisq_r (gretl_rng *r, double *a, int t1, int t2, int v)
 {
-    return gretl_rand_gamma(a, t1, t2, 0.5*v, 2);
+    return gretl_rand_gamma_r(r, a, t1, t2, 0.5*v, 2);
 }
 
 /**
- * gretl_rand_student:
+ * gretl_rand_student_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -755,7 +1031,8 @@ int gretl_rand_chisq (double *a, int t1, int t2, int v)
  * Returns: 0 on success, non-zero on error.
  */
 
-int gretl_rand_student (double *a, int t1, int t2, double v)
+int gretl_rand_student_r (gretl_rng *r, double *a, int t1, int t2,
+			  double v)
 {
     double *X2 = NULL;
     int T = t2 - t1 + 1;
@@ -770,8 +1047,8 @@ int gretl_rand_student (double *a, int t1, int t2, double v)
 	return E_ALLOC;
     }
 
-    gretl_rand_normal(a, t1, t2);
-    gretl_rand_gamma(X2, 0, T-1, 0.5*v, 2);
+    gretl_rand_normal_r(r, a, t1, t2);
+    gretl_rand_gamma_r(r, X2, 0, T-1, 0.5*v, 2);
 
     for (t=0; t<T; t++) {
 	a[t + t1] /= sqrt(X2[t] / v);
@@ -783,7 +1060,8 @@ int gretl_rand_student (double *a, int t1, int t2, double v)
 }
 
 /**
- * gretl_rand_F:
+ * gretl_rand_F_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -798,7 +1076,8 @@ int gretl_rand_student (double *a, int t1, int t2, double v)
  * Returns: 0 on success, non-zero on error.
  */
 
-int gretl_rand_F (double *a, int t1, int t2, int v1, int v2)
+int gretl_rand_F_r (gretl_rng *r, double *a, int t1, int t2, int v1,
+		    int v2)
 {
     double *b = NULL;
     int T = t2 - t1 + 1;
@@ -813,8 +1092,8 @@ int gretl_rand_F (double *a, int t1, int t2, int v1, int v2)
 	return E_ALLOC;
     }
 
-    gretl_rand_chisq(a, t1, t2, v1);
-    gretl_rand_chisq(b, 0, T-1, v2);
+    gretl_rand_chisq_r(r, a, t1, t2, v1);
+    gretl_rand_chisq_r(r, b, 0, T-1, v2);
 
     for (t=0; t<T; t++) {
 	s = t + t1;
@@ -827,7 +1106,8 @@ int gretl_rand_F (double *a, int t1, int t2, int v1, int v2)
 }
 
 /**
- * gretl_rand_binomial:
+ * gretl_rand_binomial_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -840,7 +1120,8 @@ int gretl_rand_F (double *a, int t1, int t2, int v1, int v2)
  * Returns: 0 on success, non-zero on error.
  */
 
-int gretl_rand_binomial (double *a, int t1, int t2, int n, double p)
+int gretl_rand_binomial_r (gretl_rng *r, double *a, int t1, int t2,
+			   int n, double p)
 {
     int t;
 
@@ -866,7 +1147,7 @@ int gretl_rand_binomial (double *a, int t1, int t2, int n, double p)
 
 	for (t=t1; t<=t2; t++) {
 	    a[t] = 0.0;
-	    gretl_rand_uniform(b, 0, n - 1);
+	    gretl_rand_uniform_r(r, b, 0, n - 1);
 	    for (i=0; i<n; i++) {
 		if (b[i] <= p) {
 		    a[t] += 1;
@@ -880,7 +1161,7 @@ int gretl_rand_binomial (double *a, int t1, int t2, int n, double p)
     return 0;
 }
 
-static double gretl_rand_binomial_one (int n, double p,
+static double gretl_rand_binomial_one (gretl_rng *r, int n, double p,
 				       double *b)
 {
     double ret;
@@ -897,7 +1178,7 @@ static double gretl_rand_binomial_one (int n, double p,
 	int i;
 
 	ret = 0.0;
-	gretl_rand_uniform(b, 0, n - 1);
+	gretl_rand_uniform_r(r, b, 0, n - 1);
 	for (i=0; i<n; i++) {
 	    if (b[i] <= p) {
 		ret += 1;
@@ -910,20 +1191,20 @@ static double gretl_rand_binomial_one (int n, double p,
 
 /* Poisson rv with mean m */
 
-static double genpois (const double m)
+static double genpois (gretl_rng *r, const double m)
 {
     double x;
 
     if (m > 200) {
-	x = (m + 0.5) + sqrt(m) * gretl_one_snormal();
+	x = (m + 0.5) + sqrt(m) * gretl_one_snormal_r(r);
 	x = floor(x);
     } else {
 	int y = 0;
 
-	x = exp(m) * gretl_rand_01();
+	x = exp(m) * gretl_rand_01_r(r);
 	while (x > 1) {
 	    y++;
-	    x *= gretl_rand_01();
+	    x *= gretl_rand_01_r(r);
 	}
 	x = (double) y;
     }
@@ -932,7 +1213,8 @@ static double genpois (const double m)
 }
 
 /**
- * gretl_rand_poisson:
+ * gretl_rand_poisson_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -947,15 +1229,15 @@ static double genpois (const double m)
  * Returns: 0 on success, non-zero on error.
  */
 
-int gretl_rand_poisson (double *a, int t1, int t2, const double *m,
-			int vec)
+int gretl_rand_poisson_r (gretl_rng *r, double *a, int t1, int t2,
+			  const double *m, int vec)
 {
     double mt;
     int t;
 
     for (t=t1; t<=t2; t++) {
 	mt = (vec)? m[t] : *m;
-	a[t] = (mt <= 0)? NADBL : genpois(mt);
+	a[t] = (mt <= 0)? NADBL : genpois(r, mt);
     }
 
     return 0;
@@ -964,7 +1246,8 @@ int gretl_rand_poisson (double *a, int t1, int t2, const double *m,
 /* f(x; k, \lambda) = (k/\lambda) (x/\lambda)^{k-1} e^{-(x/\lambda)^k} */
 
 /**
- * gretl_rand_weibull:
+ * gretl_rand_weibull_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -978,8 +1261,8 @@ int gretl_rand_poisson (double *a, int t1, int t2, const double *m,
  * bounds.
  */
 
-int gretl_rand_weibull (double *a, int t1, int t2, double shape,
-			double scale)
+int gretl_rand_weibull_r (gretl_rng *r, double *a, int t1, int t2,
+			  double shape, double scale)
 {
     int err = 0;
 
@@ -990,9 +1273,9 @@ int gretl_rand_weibull (double *a, int t1, int t2, double shape,
 	int t;
 
 	for (t=t1; t<=t2; t++) {
-	    u = gretl_rand_01();
+	    u = gretl_rand_01_r(r);
 	    while (u == 0.0) {
-		u = gretl_rand_01();
+		u = gretl_rand_01_r(r);
 	    }
 	    a[t] = scale * pow(-log(u), kinv);
 	}
@@ -1002,7 +1285,8 @@ int gretl_rand_weibull (double *a, int t1, int t2, double shape,
 }
 
 /**
- * gretl_rand_exponential:
+ * gretl_rand_exponential_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -1015,7 +1299,8 @@ int gretl_rand_weibull (double *a, int t1, int t2, double shape,
  * bounds.
  */
 
-int gretl_rand_exponential (double *a, int t1, int t2, double mu)
+int gretl_rand_exponential_r (gretl_rng *r, double *a, int t1, int t2,
+			      double mu)
 {
     int err = 0;
 
@@ -1026,9 +1311,9 @@ int gretl_rand_exponential (double *a, int t1, int t2, double mu)
 	int t;
 
 	for (t=t1; t<=t2; t++) {
-	    u = gretl_rand_01();
+	    u = gretl_rand_01_r(r);
 	    while (u == 0.0) {
-		u = gretl_rand_01();
+		u = gretl_rand_01_r(r);
 	    }
 	    a[t] = -mu * log(u);
 	}
@@ -1038,7 +1323,8 @@ int gretl_rand_exponential (double *a, int t1, int t2, double mu)
 }
 
 /**
- * gretl_rand_logistic:
+ * gretl_rand_logistic_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -1052,8 +1338,8 @@ int gretl_rand_exponential (double *a, int t1, int t2, double mu)
  * bounds.
  */
 
-int gretl_rand_logistic (double *a, int t1, int t2,
-			 double loc, double scale)
+int gretl_rand_logistic_r (gretl_rng *r, double *a, int t1, int t2,
+			   double loc, double scale)
 {
     int err = 0;
 
@@ -1064,9 +1350,9 @@ int gretl_rand_logistic (double *a, int t1, int t2,
 	int t;
 
 	for (t=t1; t<=t2; t++) {
-	    u = gretl_rand_01();
+	    u = gretl_rand_01_r(r);
 	    while (u == 0.0) {
-		u = gretl_rand_01();
+		u = gretl_rand_01_r(r);
 	    }
 	    a[t] = loc + scale * log(u / (1 - u));
 	}
@@ -1076,7 +1362,8 @@ int gretl_rand_logistic (double *a, int t1, int t2,
 }
 
 /**
- * gretl_rand_GED:
+ * gretl_rand_GED_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -1089,7 +1376,8 @@ int gretl_rand_logistic (double *a, int t1, int t2,
  * Returns: 0 on success, non-zero if @nu is out of bounds.
  */
 
-int gretl_rand_GED (double *a, int t1, int t2, double nu)
+int gretl_rand_GED_r (gretl_rng *r, double *a, int t1, int t2,
+		      double nu)
 {
     int err, t;
     double p, scale;
@@ -1100,12 +1388,12 @@ int gretl_rand_GED (double *a, int t1, int t2, double nu)
 
     p = 1.0/nu;
     scale = pow(0.5, p) * sqrt(gammafun(p) / gammafun(3.0*p));
-    err = gretl_rand_gamma(a, t1, t2, p, 2);
+    err = gretl_rand_gamma_r(r, a, t1, t2, p, 2);
 
     if (!err) {
 	for (t=t1; t<=t2; t++) {
 	    a[t] = scale * pow(a[t], p);
-	    if (gretl_rand_01() < 0.5) {
+	    if (gretl_rand_01_r(r) < 0.5) {
 		a[t] = -a[t];
 	    }
 	}
@@ -1115,7 +1403,8 @@ int gretl_rand_GED (double *a, int t1, int t2, double nu)
 }
 
 /**
- * gretl_rand_laplace:
+ * gretl_rand_laplace_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -1128,8 +1417,8 @@ int gretl_rand_GED (double *a, int t1, int t2, double nu)
  * Returns: 0 on success, non-zero if @b is out of bounds.
  */
 
-int gretl_rand_laplace (double *a, int t1, int t2,
-			double mu, double b)
+int gretl_rand_laplace_r (gretl_rng *r, double *a, int t1, int t2,
+			  double mu, double b)
 {
     int t, sgn;
     double U;
@@ -1139,7 +1428,7 @@ int gretl_rand_laplace (double *a, int t1, int t2,
     }
 
     /* uniform on [0,1) */
-    gretl_rand_uniform(a, t1, t2);
+    gretl_rand_uniform_r(r, a, t1, t2);
 
     for (t=t1; t<=t2; t++) {
 	/* convert to (-1/2,1/2] */
@@ -1152,7 +1441,8 @@ int gretl_rand_laplace (double *a, int t1, int t2,
 }
 
 /**
- * gretl_rand_beta:
+ * gretl_rand_beta_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @x: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -1169,8 +1459,8 @@ int gretl_rand_laplace (double *a, int t1, int t2,
  * Returns: 0 on success, non-zero if @s1 or @s2 are out of bounds.
  */
 
-int gretl_rand_beta (double *x, int t1, int t2,
-		     double s1, double s2)
+int gretl_rand_beta_r (gretl_rng *r, double *x, int t1, int t2,
+		       double s1, double s2)
 {
     double aln4 = 1.3862944;
     double a, b, s, u, v, y, z;
@@ -1205,8 +1495,8 @@ int gretl_rand_beta (double *x, int t1, int t2,
     /* generation */
     for (t=t1; t<=t2; t++) {
 	while (1) {
-	    u = gretl_rand_uniform_one();
-	    v = gretl_rand_uniform_one();
+	    u = gretl_rand_uniform_one(r);
+	    v = gretl_rand_uniform_one(r);
 	    s = u * u * v;
 	    if (u < DBL_MIN || s <= 0) continue;
 	    if (u < u0) {
@@ -1231,7 +1521,8 @@ int gretl_rand_beta (double *x, int t1, int t2,
 }
 
 /**
- * gretl_rand_beta_binomial:
+ * gretl_rand_beta_binomial_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @x: target array.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -1247,12 +1538,12 @@ int gretl_rand_beta (double *x, int t1, int t2,
  * Returns: 0 on success, non-zero if @n, @s1 or @s2 are out of bounds.
  */
 
-int gretl_rand_beta_binomial (double *x, int t1, int t2,
-			      int n, double s1, double s2)
+int gretl_rand_beta_binomial_r (gretl_rng *r, double *x, int t1, int t2,
+				int n, double s1, double s2)
 {
     int t, err;
 
-    err = gretl_rand_beta(x, t1, t2, s1, s2);
+    err = gretl_rand_beta_r(r, x, t1, t2, s1, s2);
 
     if (!err) {
 	double *b = malloc(n * sizeof *b);
@@ -1261,7 +1552,7 @@ int gretl_rand_beta_binomial (double *x, int t1, int t2,
 	    return E_ALLOC;
 	} else {
 	    for (t=t1; t<=t2; t++) {
-		x[t] = gretl_rand_binomial_one(n, x[t], b);
+		x[t] = gretl_rand_binomial_one(r, n, x[t], b);
 	    }
 	    free(b);
 	}
@@ -1273,7 +1564,8 @@ int gretl_rand_beta_binomial (double *x, int t1, int t2,
 #define DEBUG 0
 
 /**
- * gretl_rand_discrete:
+ * gretl_rand_discrete_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @x: target vector.
  * @t1: start of the fill range.
  * @t2: end of the fill range.
@@ -1286,8 +1578,8 @@ int gretl_rand_beta_binomial (double *x, int t1, int t2,
  * Returns: 0 on success, non-zero if @p is not a proper probability vector.
  */
 
-int gretl_rand_discrete (double *x, int t1, int t2,
-                         const gretl_vector *p)
+int gretl_rand_discrete_r (gretl_rng *r, double *x, int t1, int t2,
+			   const gretl_vector *p)
 {
     gretl_matrix *S = NULL;
     gretl_matrix *sS = NULL;
@@ -1337,11 +1629,12 @@ int gretl_rand_discrete (double *x, int t1, int t2,
     /* build a matrix with @nr uniform rvs sorted ascendingly
        in column 2 and the corresponding row index in column 1
     */
-    S = gretl_random_matrix_new(nr, 2, D_UNIFORM);
+    S = gretl_matrix_alloc(nr, 2);
     if (S == NULL) {
         err = E_ALLOC;
         goto bailout;
     } else {
+        gretl_rand_uniform_r(r, S->val, 0, 2 * nr - 1);
         for (i=0; i<nr; i++) {
             S->val[i] = i;
         }
@@ -1385,7 +1678,8 @@ int gretl_rand_discrete (double *x, int t1, int t2,
 }
 
 /**
- * gretl_rand_dirichlet:
+ * gretl_rand_dirichlet_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @a: parameter vector, length k.
  * @n: number of rows (replications) in return matrix.
  * @err: location to receive error code.
@@ -1394,8 +1688,9 @@ int gretl_rand_discrete (double *x, int t1, int t2,
  * @n drawings from the Dirichlet distribution of order k.
  */
 
-gretl_matrix *gretl_rand_dirichlet (const gretl_vector *a,
-				    int n, int *err)
+gretl_matrix *gretl_rand_dirichlet_r (gretl_rng *r,
+				      const gretl_vector *a, int n,
+				      int *err)
 {
     int k = gretl_vector_get_length(a);
     gretl_matrix *D = NULL;
@@ -1415,7 +1710,7 @@ gretl_matrix *gretl_rand_dirichlet (const gretl_vector *a,
 	int i, j;
 
 	for (j=0; j<k && !*err; j++) {
-	    *err = gretl_rand_gamma(D->val, t1, t2, a->val[j], 1.0);
+	    *err = gretl_rand_gamma_r(r, D->val, t1, t2, a->val[j], 1.0);
 	    t1 += n;
 	    t2 += n;
 	}
@@ -1440,28 +1735,260 @@ gretl_matrix *gretl_rand_dirichlet (const gretl_vector *a,
 }
 
 /**
- * gretl_rand_int_max:
+ * gretl_rand_int_max_r:
+ * @r: RNG stream, or NULL for the global stream.
  * @max: the maximum value (open)
  *
  * Returns: a pseudo-random unsigned int in the interval
  * [0, max-1].
  */
 
-uint32_t gretl_rand_int_max (unsigned int max)
+uint32_t gretl_rand_int_max_r (gretl_rng *r, unsigned int max)
 {
-    return rand_int_range(0, max);
+    return rand_int_range(rng_state(r), 0, max);
 }
 
 /**
- * gretl_rand_int:
+ * gretl_rand_int_r:
+ * @r: RNG stream, or NULL for the global stream.
  *
  * Returns: a pseudo-random unsigned int on the interval
  * [0, 2^32-1].
  */
 
+uint32_t gretl_rand_int_r (gretl_rng *r)
+{
+    return randi32(rng_state(r));
+}
+
+/* The generators above, drawing from the global stream: each
+   is equivalent to its "_r" counterpart with a NULL stream.
+*/
+
+double gretl_rand_01 (void)
+{
+    return gretl_rand_01_r(NULL);
+}
+
+double gretl_one_snormal (void)
+{
+    return gretl_one_snormal_r(NULL);
+}
+
+void gretl_rand_normal (double *a, int t1, int t2)
+{
+    gretl_rand_normal_r(NULL, a, t1, t2);
+}
+
+int gretl_rand_normal_full (double *a, int t1, int t2,
+			    double mean, double sd)
+{
+    return gretl_rand_normal_full_r(NULL, a, t1, t2, mean, sd);
+}
+
+int gretl_rand_uniform_minmax (double *a, int t1, int t2,
+			       double min, double max)
+{
+    return gretl_rand_uniform_minmax_r(NULL, a, t1, t2, min, max);
+}
+
+int gretl_rand_int_minmax (int *a, int n, int min, int max)
+{
+    return gretl_rand_int_minmax_r(NULL, a, n, min, max);
+}
+
+int gretl_rand_uniform_int_minmax (double *a, int t1, int t2,
+				   int min, int max,
+				   gretlopt opt)
+{
+    return gretl_rand_uniform_int_minmax_r(NULL, a, t1, t2, min, max, opt);
+}
+
+void gretl_rand_uniform (double *a, int t1, int t2)
+{
+    gretl_rand_uniform_r(NULL, a, t1, t2);
+}
+
+double gretl_rand_gamma_one (double shape, double scale)
+{
+    return gretl_rand_gamma_one_r(NULL, shape, scale);
+}
+
+int gretl_rand_gamma (double *a, int t1, int t2,
+		      double shape, double scale)
+{
+    return gretl_rand_gamma_r(NULL, a, t1, t2, shape, scale);
+}
+
+int gretl_rand_chisq (double *a, int t1, int t2, int v)
+{
+    return gretl_rand_chisq_r(NULL, a, t1, t2, v);
+}
+
+int gretl_rand_student (double *a, int t1, int t2, double v)
+{
+    return gretl_rand_student_r(NULL, a, t1, t2, v);
+}
+
+int gretl_rand_F (double *a, int t1, int t2, int v1, int v2)
+{
+    return gretl_rand_F_r(NULL, a, t1, t2, v1, v2);
+}
+
+int gretl_rand_binomial (double *a, int t1, int t2, int n, double p)
+{
+    return gretl_rand_binomial_r(NULL, a, t1, t2, n, p);
+}
+
+int gretl_rand_poisson (double *a, int t1, int t2, const double *m,
+			int vec)
+{
+    return gretl_rand_poisson_r(NULL, a, t1, t2, m, vec);
+}
+
+int gretl_rand_weibull (double *a, int t1, int t2, double shape,
+			double scale)
+{
+    return gretl_rand_weibull_r(NULL, a, t1, t2, shape, scale);
+}
+
+int gretl_rand_exponential (double *a, int t1, int t2, double mu)
+{
+    return gretl_rand_exponential_r(NULL, a, t1, t2, mu);
+}
+
+int gretl_rand_logistic (double *a, int t1, int t2,
+			 double loc, double scale)
+{
+    return gretl_rand_logistic_r(NULL, a, t1, t2, loc, scale);
+}
+
+int gretl_rand_GED (double *a, int t1, int t2, double nu)
+{
+    return gretl_rand_GED_r(NULL, a, t1, t2, nu);
+}
+
+int gretl_rand_laplace (double *a, int t1, int t2,
+			double mu, double b)
+{
+    return gretl_rand_laplace_r(NULL, a, t1, t2, mu, b);
+}
+
+int gretl_rand_beta (double *x, int t1, int t2,
+		     double s1, double s2)
+{
+    return gretl_rand_beta_r(NULL, x, t1, t2, s1, s2);
+}
+
+int gretl_rand_beta_binomial (double *x, int t1, int t2,
+			      int n, double s1, double s2)
+{
+    return gretl_rand_beta_binomial_r(NULL, x, t1, t2, n, s1, s2);
+}
+
+int gretl_rand_discrete (double *x, int t1, int t2,
+                         const gretl_vector *p)
+{
+    return gretl_rand_discrete_r(NULL, x, t1, t2, p);
+}
+
+gretl_matrix *gretl_rand_dirichlet (const gretl_vector *a,
+				    int n, int *err)
+{
+    return gretl_rand_dirichlet_r(NULL, a, n, err);
+}
+
+uint32_t gretl_rand_int_max (unsigned int max)
+{
+    return gretl_rand_int_max_r(NULL, max);
+}
+
 uint32_t gretl_rand_int (void)
 {
-    return randi32();
+    return gretl_rand_int_r(NULL);
+}
+
+/**
+ * gretl_rng_streams_init:
+ * @r: array of at least @n RNG streams.
+ * @n: number of streams to initialize.
+ *
+ * Equips @r with @n streams for use in parallel code, one per
+ * thread or task, each of which can be passed to the "_r"
+ * variants of the gretl_rand functions. Stream i (0-based)
+ * starts where the global generator would be after i + 1
+ * jumps of 2^128 drawings, so the streams don't overlap, and
+ * the assignment is fully determined by the current state of
+ * the global generator (hence by the seed). The global
+ * generator itself is then advanced by a long jump of 2^192
+ * drawings, so that it doesn't overlap with the streams, and a
+ * further call gives a fresh set of streams. In a thread with
+ * its own stream (see gretl_rand_thread_init()) that stream
+ * plays the part of the global generator.
+ *
+ * This function must be called outside of any parallel region.
+ * Once it has been called the streams are independent of each
+ * other and of the global state, and a given stream must be
+ * used by only one thread at a time.
+ *
+ * Returns: 0 on success, non-zero code on invalid input.
+ */
+
+int gretl_rng_streams_init (gretl_rng *r, int n)
+{
+    uint64_t s[4];
+    int i;
+
+    if (r == NULL || n < 0) {
+	return E_INVARG;
+    }
+
+    if (initt) {
+	/* make sure the normal generator is ready before
+	   any threads get hold of it
+	*/
+	create_ziggurat_tables();
+    }
+
+    memcpy(s, rng_state(NULL), sizeof s);
+    for (i=0; i<n; i++) {
+	xor_jump_s(s);
+	memcpy(r[i].s, s, sizeof s);
+    }
+    xor_long_jump_s(rng_state(NULL));
+
+    return 0;
+}
+
+/**
+ * gretl_rng_streams_new:
+ * @n: number of streams.
+ * @err: location to receive error code.
+ *
+ * Allocates and initializes an array of @n RNG streams, as
+ * described for gretl_rng_streams_init(). The array should be
+ * freed using free() when no longer needed.
+ *
+ * Returns: the array of streams, or NULL on failure.
+ */
+
+gretl_rng *gretl_rng_streams_new (int n, int *err)
+{
+    gretl_rng *r;
+
+    if (n <= 0) {
+	*err = E_INVARG;
+	return NULL;
+    }
+
+    r = malloc(n * sizeof *r);
+    if (r == NULL) {
+	*err = E_ALLOC;
+    } else {
+	*err = gretl_rng_streams_init(r, n);
+    }
+
+    return r;
 }
 
 static double halton (int i, int base)
@@ -1576,6 +2103,294 @@ gretl_matrix *halton_matrix (int m, int r, int offset, int *err)
     return H;
 }
 
+/* Sobol sequences: we use the primitive polynomials over GF(2) in
+   order of degree, and within degree in order of their coefficient
+   pattern, as in Joe and Kuo (2008). The initial direction numbers
+   for the first 21 dimensions are those of Joe and Kuo; beyond that
+   they are filled out with odd integers from a fixed pseudo-random
+   sequence, so the result is deterministic.
+*/
+
+#define SOBOL_BITS 32
+#define SOBOL_MAXDIM 1111
+
+static const unsigned char sobol_minit[20][7] = {
+    {1},
+    {1, 3},
+    {1, 3, 1},
+    {1, 1, 1},
+    {1, 1, 3, 3},
+    {1, 3, 5, 13},
+    {1, 1, 5, 5, 17},
+    {1, 1, 5, 5, 5},
+    {1, 1, 7, 11, 19},
+    {1, 1, 5, 1, 1},
+    {1, 1, 1, 3, 11},
+    {1, 3, 5, 5, 31},
+    {1, 3, 3, 9, 7, 49},
+    {1, 1, 1, 15, 21, 21},
+    {1, 3, 1, 13, 27, 49},
+    {1, 1, 1, 15, 7, 5},
+    {1, 3, 1, 15, 13, 25},
+    {1, 1, 5, 5, 19, 61},
+    {1, 3, 7, 11, 23, 15, 103},
+    {1, 3, 7, 13, 13, 15, 69}
+};
+
+/* x^e mod @p, for @p a polynomial of degree @s over GF(2) */
+
+static uint64_t gf2_powmod (uint64_t e, uint64_t p, int s)
+{
+    uint64_t top = (uint64_t) 1 << s;
+    uint64_t r = 1, b = 2;
+    uint64_t x, y, z;
+
+    while (e > 0) {
+	if (e & 1) {
+	    /* r = r * b mod p */
+	    for (x=r, y=b, z=0; y; y>>=1) {
+		if (y & 1) z ^= x;
+		x <<= 1;
+		if (x & top) x ^= p;
+	    }
+	    r = z;
+	}
+	/* b = b * b mod p */
+	for (x=b, y=b, z=0; y; y>>=1) {
+	    if (y & 1) z ^= x;
+	    x <<= 1;
+	    if (x & top) x ^= p;
+	}
+	b = z;
+	e >>= 1;
+    }
+
+    return r;
+}
+
+/* Is @p, of degree @s, primitive? That is, is the order of x
+   modulo @p equal to 2^s - 1?
+*/
+
+static int gf2_primitive (uint64_t p, int s)
+{
+    uint64_t N = ((uint64_t) 1 << s) - 1;
+    uint64_t m = N, q;
+
+    if (s == 1) {
+	return 1;
+    } else if (gf2_powmod(N, p, s) != 1) {
+	return 0;
+    }
+
+    for (q=3; m > 1; q+=2) {
+	if (q * q > m) {
+	    q = m;
+	}
+	if (m % q == 0) {
+	    if (gf2_powmod(N / q, p, s) == 1) {
+		return 0;
+	    }
+	    while (m % q == 0) {
+		m /= q;
+	    }
+	}
+    }
+
+    return 1;
+}
+
+/* Fill @V with the direction numbers for @d dimensions, each
+   row holding SOBOL_BITS values, most significant first.
+*/
+
+static void sobol_directions (uint32_t *V, int d)
+{
+    uint64_t lcg = 0x2545f4914f6cdd1dULL;
+    uint32_t *v = V;
+    uint32_t m[SOBOL_BITS];
+    unsigned a = 0;
+    int s = 1;
+    int i, j, k;
+
+    /* the first dimension is van der Corput in base 2 */
+    for (k=0; k<SOBOL_BITS; k++) {
+	v[k] = (uint32_t) 1 << (SOBOL_BITS - 1 - k);
+    }
+
+    for (j=1; j<d; j++) {
+	/* find the next primitive polynomial, of degree s with
+	   interior coefficients a */
+	while (1) {
+	    if (a >= (1u << (s - 1))) {
+		s++;
+		a = 0;
+	    }
+	    if (gf2_primitive(((uint64_t) 1 << s) | (a << 1) | 1, s)) {
+		break;
+	    }
+	    a++;
+	}
+	for (k=0; k<s; k++) {
+	    if (j <= 20) {
+		m[k] = sobol_minit[j-1][k];
+	    } else {
+		/* an odd integer less than 2^(k+1) */
+		lcg = lcg * 6364136223846793005ULL + 1442695040888963407ULL;
+		m[k] = ((uint32_t) (lcg >> 32) & ((2u << k) - 1)) | 1;
+	    }
+	}
+	v = V + j * SOBOL_BITS;
+	for (k=0; k<SOBOL_BITS; k++) {
+	    if (k < s) {
+		v[k] = m[k] << (SOBOL_BITS - 1 - k);
+	    } else {
+		v[k] = v[k-s] ^ (v[k-s] >> s);
+		for (i=1; i<s; i++) {
+		    if ((a >> (s - 1 - i)) & 1) {
+			v[k] ^= v[k-i];
+		    }
+		}
+	    }
+	}
+	a++;
+    }
+}
+
+static int parity32 (uint32_t x)
+{
+    x ^= x >> 16;
+    x ^= x >> 8;
+    x ^= x >> 4;
+    x ^= x >> 2;
+    x ^= x >> 1;
+    return x & 1;
+}
+
+/* Randomize the direction numbers @v for one dimension via a
+   random lower-triangular binary matrix with unit diagonal
+   (Matousek's linear matrix scramble).
+*/
+
+static void sobol_scramble (uint32_t *v)
+{
+    uint32_t L[SOBOL_BITS];
+    uint32_t vk;
+    int i, k;
+
+    for (i=0; i<SOBOL_BITS; i++) {
+	uint32_t hm = ~(uint32_t) 0 << (SOBOL_BITS - 1 - i);
+
+	L[i] = (gretl_rand_int() & hm) | ((uint32_t) 1 << (SOBOL_BITS - 1 - i));
+    }
+
+    for (k=0; k<SOBOL_BITS; k++) {
+	vk = 0;
+	for (i=0; i<SOBOL_BITS; i++) {
+	    if (parity32(L[i] & v[k])) {
+		vk |= (uint32_t) 1 << (SOBOL_BITS - 1 - i);
+	    }
+	}
+	v[k] = vk;
+    }
+}
+
+/**
+ * sobol_matrix:
+ * @m: number of rows (dimensions).
+ * @r: number of columns (points).
+ * @scramble: if non-zero, randomize the sequences.
+ * @err: location to receive error code.
+ *
+ * Generates the first @r points of the @m-dimensional Sobol
+ * sequence, using Gray-code ordering so that each point costs
+ * one XOR per dimension. In the plain case the initial point,
+ * which is identically zero, is skipped. If @scramble is
+ * non-zero the direction numbers are subjected to a random
+ * linear scramble and the points to a random digital shift,
+ * using gretl's RNG; the sequence then starts from its
+ * (randomized) initial point and all values lie strictly
+ * between 0 and 1.
+ *
+ * Returns: an @m x @r matrix, with the points in its columns,
+ * or NULL on failure.
+ */
+
+gretl_matrix *sobol_matrix (int m, int r, int scramble, int *err)
+{
+    const double scale = 1.0 / 4294967296.0;
+    gretl_matrix *S = NULL;
+    uint32_t *V = NULL;
+    uint32_t *x = NULL;
+    uint32_t n, g, c;
+    int i, j;
+
+    if (m <= 0 || r <= 0) {
+	*err = E_INVARG;
+    } else if (m > SOBOL_MAXDIM) {
+	gretl_errmsg_sprintf(_("sobol: the maximum dimension is %d"),
+			     SOBOL_MAXDIM);
+	*err = E_INVARG;
+    }
+
+    if (*err) {
+	return NULL;
+    }
+
+    S = gretl_matrix_alloc(m, r);
+    V = malloc(m * SOBOL_BITS * sizeof *V);
+    x = calloc(m, sizeof *x);
+
+    if (S == NULL || V == NULL || x == NULL) {
+	*err = E_ALLOC;
+	goto bailout;
+    }
+
+    sobol_directions(V, m);
+
+    if (scramble) {
+	for (i=0; i<m; i++) {
+	    sobol_scramble(V + i * SOBOL_BITS);
+	    x[i] = gretl_rand_int();
+	}
+    }
+
+    for (n=0, j=0; j<r; n++) {
+	if (n > 0) {
+	    /* Gray code: flip the bit given by the position
+	       of the lowest zero bit of n - 1 */
+	    for (c=0, g=n-1; g & 1; g>>=1) {
+		c++;
+	    }
+	    for (i=0; i<m; i++) {
+		x[i] ^= V[i * SOBOL_BITS + c];
+	    }
+	} else if (!scramble) {
+	    continue;
+	}
+	for (i=0; i<m; i++) {
+	    if (scramble) {
+		gretl_matrix_set(S, i, j, (x[i] + 0.5) * scale);
+	    } else {
+		gretl_matrix_set(S, i, j, x[i] * scale);
+	    }
+	}
+	j++;
+    }
+
+ bailout:
+
+    free(V);
+    free(x);
+
+    if (*err) {
+	gretl_matrix_free(S);
+	S = NULL;
+    }
+
+    return S;
+}
+
 static int wishart_workspace (gretl_matrix **pW,
 			      gretl_matrix **pB,
 			      double **pZ,
@@ -24,6 +24,8 @@ void gretl_rand_init (void);
 
 void gretl_mpi_rand_init (int n, int self, int single_rng);
 
+void gretl_rand_jump (int n);
+
 void gretl_rand_set_seed (uint64_t seed);
 
 uint32_t gretl_rand_int (void);
@@ -93,6 +95,8 @@ gretl_matrix *gretl_rand_dirichlet (const gretl_vector *a,
 
 gretl_matrix *halton_matrix (int m, int r, int offset, int *err);
 
+gretl_matrix *sobol_matrix (int m, int r, int scramble, int *err);
+
 gretl_matrix *inverse_wishart_matrix (const gretl_matrix *S,
 				      int v, int *err);
 
@@ -103,5 +107,95 @@ uint64_t gretl_rand_get_seed (void);
 
 char *gretl_rand_hex_string (int len, int *err);
 
+/* RNG streams for use in parallel code */
+
+typedef struct gretl_rng_ gretl_rng;
+
+struct gretl_rng_ {
+    uint64_t s[4];
+};
+
+void gretl_rand_set_parallel (int s);
+
+int gretl_rng_streams_init (gretl_rng *r, int n);
+
+gretl_rng *gretl_rng_streams_new (int n, int *err);
+
+int gretl_rand_thread_init (void);
+
+void gretl_rand_thread_cleanup (void);
+
+double gretl_rand_01_r (gretl_rng *r);
+
+double gretl_one_snormal_r (gretl_rng *r);
+
+void gretl_rand_normal_r (gretl_rng *r, double *a, int t1, int t2);
+
+int gretl_rand_normal_full_r (gretl_rng *r, double *a, int t1, int t2,
+			      double mean, double sd);
+
+int gretl_rand_uniform_minmax_r (gretl_rng *r, double *a, int t1,
+				 int t2, double min, double max);
+
+int gretl_rand_int_minmax_r (gretl_rng *r, int *a, int n, int min,
+			     int max);
+
+int gretl_rand_uniform_int_minmax_r (gretl_rng *r, double *a, int t1,
+				     int t2, int min, int max,
+				     gretlopt opt);
+
+void gretl_rand_uniform_r (gretl_rng *r, double *a, int t1, int t2);
+
+double gretl_rand_gamma_one_r (gretl_rng *r, double shape, double scale);
+
+int gretl_rand_gamma_r (gretl_rng *r, double *a, int t1, int t2,
+			double shape, double scale);
+
+int gretl_rand_chisq_r (gretl_rng *r, double *a, int t1, int t2, int v);
+
+int gretl_rand_student_r (gretl_rng *r, double *a, int t1, int t2,
+			  double v);
+
+int gretl_rand_F_r (gretl_rng *r, double *a, int t1, int t2, int v1,
+		    int v2);
+
+int gretl_rand_binomial_r (gretl_rng *r, double *a, int t1, int t2,
+			   int n, double p);
+
+int gretl_rand_poisson_r (gretl_rng *r, double *a, int t1, int t2,
+			  const double *m, int vec);
+
+int gretl_rand_weibull_r (gretl_rng *r, double *a, int t1, int t2,
+			  double shape, double scale);
+
+int gretl_rand_exponential_r (gretl_rng *r, double *a, int t1, int t2,
+			      double mu);
+
+int gretl_rand_logistic_r (gretl_rng *r, double *a, int t1, int t2,
+			   double loc, double scale);
+
+int gretl_rand_GED_r (gretl_rng *r, double *a, int t1, int t2,
+		      double nu);
+
+int gretl_rand_laplace_r (gretl_rng *r, double *a, int t1, int t2,
+			  double mu, double b);
+
+int gretl_rand_beta_r (gretl_rng *r, double *x, int t1, int t2,
+		       double s1, double s2);
+
+int gretl_rand_beta_binomial_r (gretl_rng *r, double *x, int t1, int t2,
+				int n, double s1, double s2);
+
+int gretl_rand_discrete_r (gretl_rng *r, double *x, int t1, int t2,
+			   const gretl_vector *p);
+
+gretl_matrix *gretl_rand_dirichlet_r (gretl_rng *r,
+				      const gretl_vector *a, int n,
+				      int *err);
+
+uint32_t gretl_rand_int_max_r (gretl_rng *r, unsigned int max);
+
+uint32_t gretl_rand_int_r (gretl_rng *r);
+
 #endif /* RANDOM_H */
 
@@ -257,6 +257,74 @@ static char *make_submask (int n)
     return mask;
 }
 
+/* Masks hold one byte per observation. Where a stretch of a mask
+   contains only 0s and 1s we can process it eight bytes at a time:
+   the sum of the bytes in such a word is obtained by multiplying
+   by SUBMASK_ONES and taking the top byte.
+*/
+
+#define SUBMASK_ONES 0x0101010101010101ULL
+
+#define word_is_binary(w) (((w) & ~SUBMASK_ONES) == 0)
+#define binary_word_sum(w) ((int) (((w) * SUBMASK_ONES) >> 56))
+
+/* Count the elements of @mask, of length @n, that equal 1 */
+
+static int submask_count (const char *mask, int n)
+{
+    uint64_t w;
+    int i, j, k = 0;
+
+    for (i=0; i+8<=n; i+=8) {
+	memcpy(&w, mask + i, 8);
+	if (word_is_binary(w)) {
+	    k += binary_word_sum(w);
+	} else {
+	    for (j=i; j<i+8; j++) {
+		k += (mask[j] == 1);
+	    }
+	}
+    }
+    for (; i<n; i++) {
+	k += (mask[i] == 1);
+    }
+
+    return k;
+}
+
+/* Build an index of length @ns mapping the observations of a
+   subsample onto the full dataset, given the mask: selected
+   observations get their full-data index and panel padding
+   rows get -1.
+*/
+
+static int *submask_index (const char *mask, int n, int ns)
+{
+    int *idx = malloc(ns * sizeof *idx);
+    int s, t;
+
+    if (idx != NULL) {
+	for (t=0, s=0; t<n && s<ns; t++) {
+	    if (mask == NULL || mask[t] == 1) {
+		idx[s++] = t;
+	    } else if (mask[t] == 'p') {
+		idx[s++] = -1;
+	    }
+	}
+	for (; s<ns; s++) {
+	    idx[s] = -1;
+	}
+    }
+
+    return idx;
+}
+
+/* Copying between a dataset and its subsample is done one series
+   at a time, in parallel if the volume of data warrants it.
+*/
+
+#define SUBSAMPLE_OMP_MIN 1000000
+
 #if 0
 
 static void debug_print_submask (char *mask, char *msg)
@@ -366,7 +434,7 @@ static void sync_datainfo_members (const DATASET *dset)
 		fullset->v - dset->v);
 #endif
 	for (i=dset->v; i<fullset->v; i++) {
-	    free(fullset->Z[i]);
+	    dataset_release_series(fullset->Z[i]);
 	    fullset->Z[i] = NULL;
 	}
 	fullset->v = dset->v;
@@ -542,24 +610,52 @@ static int resample_sync_dataset (DATASET *dset)
 static void
 update_full_data_values (const DATASET *dset)
 {
-    int i, s, t;
+    int nv = MIN(fullset->v, dset->v);
+    int *idx;
+    int i;
 
 #if SUBDEBUG
     fprintf(stderr, "update_full_data_values: fullset->Z=%p, dset->Z=%p, dset=%p\n",
 	    (void *) fullset->Z, (void *) dset->Z, (void *) dset);
 #endif
 
-    for (i=1; i<fullset->v && i<dset->v; i++) {
-	s = 0;
-	for (t=0; t<fullset->n; t++) {
-	    if (dset->submask[t] == 1) {
-		fullset->Z[i][t] = dset->Z[i][s++];
-	    } else if (dset->submask[t] == 'p') {
-		/* skip panel padding (?) */
-		s++;
+    idx = submask_index(dset->submask, fullset->n, dset->n);
+
+    if (idx == NULL) {
+	/* fallback: scan the mask for each series */
+	int s, t;
+
+	for (i=1; i<nv; i++) {
+	    s = 0;
+	    for (t=0; t<fullset->n; t++) {
+		if (dset->submask[t] == 1) {
+		    fullset->Z[i][t] = dset->Z[i][s++];
+		} else if (dset->submask[t] == 'p') {
+		    /* skip panel padding (?) */
+		    s++;
+		}
 	    }
 	}
+	return;
     }
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp parallel for schedule(static) \
+    if ((double) nv * dset->n > SUBSAMPLE_OMP_MIN)
+#endif
+    for (i=1; i<nv; i++) {
+	const double *src = dset->Z[i];
+	double *targ = fullset->Z[i];
+	int s;
+
+	for (s=0; s<dset->n; s++) {
+	    if (idx[s] >= 0) {
+		targ[idx[s]] = src[s];
+	    }
+	}
+    }
+
+    free(idx);
 }
 
 static int update_case_markers (const DATASET *dset)
@@ -927,7 +1023,8 @@ static int and_masks (char **pmask, const char *orig, int *err)
     int origlen = submask_length(orig) - 1;
     int masklen = submask_length(mask) - 1;
     char *alt = NULL;
-    int i, sn = 0;
+    uint64_t w1, w2;
+    int i = 0, j, sn = 0;
 
     if (masklen < origlen) {
         alt = expand_mask(mask, orig, err);
@@ -936,7 +1033,28 @@ static int and_masks (char **pmask, const char *orig, int *err)
         }
     }
 
-    for (i=0; i<origlen && !*err; i++) {
+    if (*err) {
+	return 0;
+    }
+
+    for (i=0; i+8<=origlen; i+=8) {
+	memcpy(&w1, mask + i, 8);
+	memcpy(&w2, orig + i, 8);
+	if (word_is_binary(w1) && word_is_binary(w2)) {
+	    w1 &= w2;
+	    memcpy(mask + i, &w1, 8);
+	    sn += binary_word_sum(w1);
+	    continue;
+	}
+	for (j=i; j<i+8; j++) {
+	    if (mask[j] == 1 && orig[j] == 1) {
+		sn++;
+	    } else {
+		mask[j] = 0;
+	    }
+	}
+    }
+    for (; i<origlen; i++) {
 	if (mask[i] == 1 && orig[i] == 1) {
 	    sn++;
 	} else {
@@ -1234,15 +1352,7 @@ static int mask_from_dummy (const char *s, const DATASET *dset,
 static int
 count_selected_cases (const char *mask, const DATASET *dset)
 {
-    int i, n = 0;
-
-    for (i=0; i<dset->n; i++) {
-	if (mask[i] == 1) {
-	    n++;
-	}
-    }
-
-    return n;
+    return submask_count(mask, dset->n);
 }
 
 /* panel: how many distinct cross-sectional units are included
@@ -1435,6 +1545,7 @@ static void
 copy_data_to_subsample (DATASET *subset, const DATASET *dset,
 			int maxv, const char *mask)
 {
+    int *idx;
     int i, t, s;
 
 #if SUBDEBUG
@@ -1442,19 +1553,38 @@ copy_data_to_subsample (DATASET *subset, const DATASET *dset,
 	    (void *) subset, (void *) dset);
 #endif
 
+    idx = submask_index(mask, dset->n, subset->n);
+
     /* copy data values */
-    for (i=1; i<maxv; i++) {
-	s = 0;
-	for (t=0; t<dset->n; t++) {
-	    if (mask == NULL) {
-		subset->Z[i][s++] = dset->Z[i][t];
-	    } else if (mask[t] == 1) {
-		subset->Z[i][s++] = dset->Z[i][t];
-	    } else if (mask[t] == 'p') {
-		/* panel padding */
-		subset->Z[i][s++] = NADBL;
+    if (idx == NULL) {
+	/* fallback: scan the mask for each series */
+	for (i=1; i<maxv; i++) {
+	    s = 0;
+	    for (t=0; t<dset->n; t++) {
+		if (mask == NULL) {
+		    subset->Z[i][s++] = dset->Z[i][t];
+		} else if (mask[t] == 1) {
+		    subset->Z[i][s++] = dset->Z[i][t];
+		} else if (mask[t] == 'p') {
+		    /* panel padding */
+		    subset->Z[i][s++] = NADBL;
+		}
+	    }
+	}
+    } else {
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp parallel for private(s) schedule(static) \
+    if ((double) maxv * subset->n > SUBSAMPLE_OMP_MIN)
+#endif
+	for (i=1; i<maxv; i++) {
+	    const double *src = dset->Z[i];
+	    double *targ = subset->Z[i];
+
+	    for (s=0; s<subset->n; s++) {
+		targ[s] = idx[s] < 0 ? NADBL : src[idx[s]];
 	    }
 	}
+	free(idx);
     }
 
     /* copy observation markers, if any */
@@ -1281,10 +1281,17 @@ static void landscape_modify_line (char *line)
 
 void gretl_tex_preamble (PRN *prn, int fmt)
 {
+    static int checked;
     char *lang = getenv("LANG");
     FILE *fp = NULL;
     int userfile = 0;
 
+    if (!checked) {
+	/* look for a user preamble file on first use */
+	set_gretl_tex_preamble();
+	checked = 1;
+    }
+
     if (*tex_preamble_file != '\0') {
 	fp = gretl_fopen(tex_preamble_file, "r");
 	if (fp != NULL) {
@@ -2813,8 +2813,9 @@ static int try_auxlist_term (CMD *cmd, cmd_token *tok, int scount)
 	/* we must be in first sublist */
 	return 0;
     }
-    if (tok->type == TOK_CBSTR || (tok->type == TOK_NAME &&
-				   get_matrix_by_name(tok->s))) {
+    if (tok->type == TOK_CBSTR ||
+	(tok->type == TOK_NAME &&
+	 get_user_var_of_type_by_name(tok->s, GRETL_TYPE_MATRIX))) {
 	/* not a regular "int list" term */
 	return 1;
     } else {
@@ -4374,3 +4375,207 @@ int parse_gui_command (char *line, CMD *cmd, DATASET *dset)
 
     return err;
 }
+
+/* Caching of parsed commands, for use in loops. A plain estimation
+   command inside a loop would otherwise be tokenized and assembled
+   afresh on each iteration, although in the common case -- where its
+   arguments are just the names of series, integers, semicolons and
+   option flags -- the result depends only on the mapping from series
+   names to ID numbers. For such commands we record the assembled
+   fields of the CMD on first parse and restore them on subsequent
+   iterations, for as long as the dataset and its name mapping (as
+   tracked by dataset_names_generation()) are unchanged.
+*/
+
+struct cmd_cache_ {
+    const DATASET *dset; /* dataset in force when cached */
+    guint32 gen;         /* names generation when cached */
+    int ci;
+    int ciflags;
+    gretlopt opt;
+    GretlType gtype;
+    int order;
+    int auxint;
+    char *param;
+    char *parm2;
+    char *vstart;
+    int *list;
+    int *auxlist;
+};
+
+static int cmd_is_cacheable (const CMD *c, const DATASET *dset)
+{
+    gretlopt sopt = OPT_NONE;
+    const cmd_token *tok;
+    int i;
+
+    if (dset == NULL || c->err || c->context || c->cstart > 0 ||
+	cmd_subst(c) || *c->savename != '\0') {
+	return 0;
+    }
+
+    /* options supplied via "setopt" must be picked up afresh */
+    maybe_get_stored_options(c->ci, &sopt);
+    if (sopt != OPT_NONE) {
+	return 0;
+    }
+
+    for (i=1; i<c->ntoks; i++) {
+	tok = &c->toks[i];
+	if (tok->type == TOK_NAME) {
+	    if (current_series_index(dset, tok->s) < 0) {
+		return 0;
+	    }
+	} else if (tok->type != TOK_INT && tok->type != TOK_SEMIC &&
+		   tok->type != TOK_OPT && tok->type != TOK_SOPT &&
+		   tok->type != TOK_OPTDASH) {
+	    return 0;
+	}
+    }
+
+    return 1;
+}
+
+void cmd_cache_free (cmd_cache *cc)
+{
+    if (cc != NULL) {
+	free(cc->param);
+	free(cc->parm2);
+	free(cc->vstart);
+	free(cc->list);
+	free(cc->auxlist);
+	free(cc);
+    }
+}
+
+/**
+ * cmd_cache_new:
+ * @cmd: command that has just been parsed successfully.
+ * @dset: dataset against which it was parsed.
+ *
+ * Returns: a record of the assembled content of @cmd, for
+ * use with cmd_restore_from_cache(), or NULL if @cmd is not
+ * suitable for caching (or on failure).
+ */
+
+cmd_cache *cmd_cache_new (const CMD *cmd, const DATASET *dset)
+{
+    cmd_cache *cc;
+    int err = 0;
+
+    if (!cmd_is_cacheable(cmd, dset)) {
+	return NULL;
+    }
+
+    cc = calloc(1, sizeof *cc);
+    if (cc == NULL) {
+	return NULL;
+    }
+
+    cc->dset = dset;
+    cc->gen = dataset_names_generation();
+    cc->ci = cmd->ci;
+    cc->ciflags = cmd->ciflags;
+    cc->opt = cmd->opt;
+    cc->gtype = cmd->gtype;
+    cc->order = cmd->order;
+    cc->auxint = cmd->auxint;
+
+    if (cmd->param != NULL) {
+	cc->param = gretl_strdup(cmd->param);
+	err = cc->param == NULL;
+    }
+    if (!err && cmd->parm2 != NULL) {
+	cc->parm2 = gretl_strdup(cmd->parm2);
+	err = cc->parm2 == NULL;
+    }
+    if (!err && cmd->vstart != NULL) {
+	cc->vstart = gretl_strdup(cmd->vstart);
+	err = cc->vstart == NULL;
+    }
+    if (!err && cmd->list != NULL) {
+	cc->list = gretl_list_copy(cmd->list);
+	err = cc->list == NULL;
+    }
+    if (!err && cmd->auxlist != NULL) {
+	cc->auxlist = gretl_list_copy(cmd->auxlist);
+	err = cc->auxlist == NULL;
+    }
+
+    if (err) {
+	cmd_cache_free(cc);
+	cc = NULL;
+    }
+
+    return cc;
+}
+
+/**
+ * cmd_restore_from_cache:
+ * @cmd: command struct to fill out.
+ * @cc: cached record, from cmd_cache_new().
+ * @dset: current dataset.
+ *
+ * Takes the place of parse_command_line() for a line whose
+ * parse has been cached, provided the record is still valid.
+ *
+ * Returns: 1 if @cmd was restored from @cc, 0 if the line must
+ * be parsed in the regular way.
+ */
+
+int cmd_restore_from_cache (CMD *cmd, const cmd_cache *cc,
+			    const DATASET *dset)
+{
+    gretlopt sopt = OPT_NONE;
+
+    if (cc == NULL || cc->dset != dset ||
+	cc->gen != dataset_names_generation() ||
+	gretl_if_state_false()) {
+	return 0;
+    }
+
+    maybe_get_stored_options(cc->ci, &sopt);
+    if (sopt != OPT_NONE) {
+	return 0;
+    }
+
+    gretl_cmd_clear(cmd);
+    gretl_error_clear();
+
+    if (cc->param != NULL) {
+	cmd->param = gretl_strdup(cc->param);
+    }
+    if (cc->parm2 != NULL) {
+	cmd->parm2 = gretl_strdup(cc->parm2);
+    }
+    if (cc->vstart != NULL) {
+	cmd->vstart = gretl_strdup(cc->vstart);
+    }
+    if (cc->list != NULL) {
+	cmd->list = gretl_list_copy(cc->list);
+    }
+    if (cc->auxlist != NULL) {
+	cmd->auxlist = gretl_list_copy(cc->auxlist);
+    }
+
+    if ((cc->param != NULL && cmd->param == NULL) ||
+	(cc->parm2 != NULL && cmd->parm2 == NULL) ||
+	(cc->vstart != NULL && cmd->vstart == NULL) ||
+	(cc->list != NULL && cmd->list == NULL) ||
+	(cc->auxlist != NULL && cmd->auxlist == NULL)) {
+	/* allocation failed: fall back on parsing */
+	gretl_cmd_clear(cmd);
+	return 0;
+    }
+
+    cmd->ci = cc->ci;
+    cmd->ciflags = cc->ciflags;
+    cmd->opt = cc->opt;
+    cmd->gtype = cc->gtype;
+    cmd->order = cc->order;
+    cmd->auxint = cc->auxint;
+    cmd->flags &= ~CMD_SUBST;
+    get_or_set_errline(NULL, 1);
+
+    return 1;
+}
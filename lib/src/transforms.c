@@ -21,6 +21,7 @@
 #include "uservar.h"
 #include "gretl_func.h"
 #include "matrix_extra.h"
+#include "gretl_mt.h"
 
 #define TRDEBUG 0
 
@@ -322,6 +323,10 @@ static double *testvec (int n)
     static int nx;
     int t;
 
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(x, nx)
+#endif
+
     if (n == 0) {
 	/* clean up */
 	free(x);
@@ -391,9 +396,12 @@ static int get_lag (int v, int lag, double *xlag,
     return 0;
 }
 
-/* write log of variable v into logvec */
+/* write log of variable v into logvec, flagging via @miss
+   any invalid input values
+*/
 
-static int get_log (int v, double *logvec, const DATASET *dset)
+static int get_log (int v, double *logvec, const DATASET *dset,
+		    int *miss)
 {
     double xx;
     int t, err = 0;
@@ -402,7 +410,7 @@ static int get_log (int v, double *logvec, const DATASET *dset)
 	xx = dset->Z[v][t];
 	if (na(xx) || xx <= 0.0) {
 	    logvec[t] = NADBL;
-	    set_gretl_warning(W_GENMISS);
+	    *miss = 1;
 	} else {
 	    logvec[t] = log(xx);
 	}
@@ -751,39 +759,24 @@ static int get_lag_ID (int srcv, int lag, const DATASET *dset)
     return -1;
 }
 
-/* get_transform: create specified transformation of variable v if
-   this variable does not already exist.
-
-   The dummies resulting from DUMMIFY are automatically marked as
-   discrete.
-
-   origv is the number of variables in the dataset prior to the
-   current round of adding.
-
-   Return the ID number of the transformed var, or -1 on error.
+/* compute_transform: write into @vx, which should be filled
+   with NAs on input, the specified transformation of series @v.
+   This does not touch the dataset so it's OK to call it from
+   multiple threads at once, provided the @vx's are distinct.
+   If some of the generated values are missing owing to invalid
+   input, @miss is set to 1.
 */
 
-static int get_transform (int ci, int v, int aux, double x,
-			  DATASET *dset, int startlen, int origv,
-			  int *idxvec)
+static int compute_transform (int ci, int v, int aux, double x,
+			      double *vx, const DATASET *dset,
+			      int *idxvec, int *miss)
 {
-    char vname[VNAMELEN] = {0};
-    char label[MAXLABEL] = {0};
-    int vno = -1, err = 0;
-    int len, lag = 0;
-    const char *srcname;
-    double *vx;
-
-    vx = testvec(dset->n);
-    if (vx == NULL) {
-	return -1;
-    }
+    int err = 0;
 
     if (ci == LAGS) {
-	lag = aux;
-	err = get_lag(v, lag, vx, dset);
+	err = get_lag(v, aux, vx, dset);
     } else if (ci == LOGS) {
-	err = get_log(v, vx, dset);
+	err = get_log(v, vx, dset, miss);
     } else if (ci == DIFF || ci == LDIFF || ci == SDIFF) {
 	err = get_diff(v, vx, ci, dset);
     } else if (ci == ORTHDEV) {
@@ -802,8 +795,34 @@ static int get_transform (int ci, int v, int aux, double x,
 	err = get_resampled(v, vx, dset, idxvec);
     }
 
-    if (err) {
-	return -1;
+    return err;
+}
+
+/* register_transform: given the values @vx of the specified
+   transformation of variable v, add it to the dataset under a
+   suitable name if this variable does not already exist.
+
+   The dummies resulting from DUMMIFY are automatically marked as
+   discrete.
+
+   origv is the number of variables in the dataset prior to the
+   current round of adding.
+
+   Return the ID number of the transformed var, or -1 on error.
+*/
+
+static int register_transform (int ci, int v, int aux, double x,
+			       const double *vx, DATASET *dset,
+			       int startlen, int origv)
+{
+    char vname[VNAMELEN] = {0};
+    char label[MAXLABEL] = {0};
+    int vno = -1, err = 0;
+    int len, lag = 0;
+    const char *srcname;
+
+    if (ci == LAGS) {
+	lag = aux;
     }
 
     if (ci == LAGS && (vno = get_lag_ID(v, aux, dset)) > 0) {
@@ -891,6 +910,177 @@ static int get_transform (int ci, int v, int aux, double x,
     return vno;
 }
 
+/* get_transform: create specified transformation of variable v if
+   this variable does not already exist. See register_transform()
+   for the meaning of @origv and the return value.
+*/
+
+static int get_transform (int ci, int v, int aux, double x,
+			  DATASET *dset, int startlen, int origv,
+			  int *idxvec)
+{
+    double *vx;
+    int miss = 0;
+
+    vx = testvec(dset->n);
+    if (vx == NULL) {
+	return -1;
+    }
+
+    if (compute_transform(ci, v, aux, x, vx, dset, idxvec, &miss)) {
+	return -1;
+    }
+
+    if (miss) {
+	set_gretl_warning(W_GENMISS);
+    }
+
+    return register_transform(ci, v, aux, x, vx, dset, startlen, origv);
+}
+
+/* Apparatus for generating transformations of the series in a
+   list. The values are computed first, in parallel if OpenMP is
+   available and the job is big enough, then the results are
+   registered in the dataset serially and in the order given, so
+   that the naming, and the handling of name collisions, is just
+   as if get_transform() had been called for each job in turn.
+*/
+
+typedef struct tr_job_ tr_job;
+
+struct tr_job_ {
+    int ci;       /* the transformation */
+    int v;        /* ID of source series */
+    int aux;      /* lag order, second series or df correction */
+    int startlen; /* starting length for naming */
+    int origv;    /* see get_transform(), or -1 for current dset->v */
+    int err;      /* error code from computation */
+    int ret;      /* ID of result, or -1 on failure */
+};
+
+/* maximum number of transformations computed at once */
+#define TR_BLOCK 64
+
+static void set_tr_job (tr_job *job, int ci, int v, int aux,
+			int startlen, int origv)
+{
+    job->ci = ci;
+    job->v = v;
+    job->aux = aux;
+    job->startlen = startlen;
+    job->origv = origv;
+    job->err = 0;
+    job->ret = -1;
+}
+
+static void tr_job_compute (tr_job *job, double *vx,
+			    const DATASET *dset, int *miss)
+{
+    int t;
+
+    for (t=0; t<dset->n; t++) {
+	vx[t] = NADBL;
+    }
+    job->err = compute_transform(job->ci, job->v, job->aux, 0.0,
+				 vx, dset, NULL, miss);
+}
+
+static int tr_job_register (tr_job *job, const double *vx,
+			    DATASET *dset)
+{
+    int origv = job->origv < 0 ? dset->v : job->origv;
+
+    return register_transform(job->ci, job->v, job->aux, 0.0, vx,
+			      dset, job->startlen, origv);
+}
+
+/* Process @njobs transformations. If @stop is non-zero we quit
+   on the first failure, leaving the remaining jobs with a
+   return value of -1.
+*/
+
+static void transforms_apply (tr_job *jobs, int njobs, int stop,
+			      DATASET *dset)
+{
+    double *X = NULL;
+    char *touched = NULL;
+    int v0 = dset->v;
+    int nb = 0, miss = 0;
+    int i, j, m;
+
+#if defined(_OPENMP)
+    if (njobs > 1 && gretl_use_openmp((guint64) njobs * dset->n)) {
+	nb = njobs < TR_BLOCK ? njobs : TR_BLOCK;
+	X = malloc((size_t) nb * dset->n * sizeof *X);
+	touched = calloc(v0, 1);
+	if (X == NULL || touched == NULL) {
+	    /* fall back to serial processing */
+	    free(X);
+	    free(touched);
+	    nb = 0;
+	}
+    }
+#endif
+
+    if (nb == 0) {
+	for (i=0; i<njobs; i++) {
+	    tr_job *job = &jobs[i];
+	    int origv = job->origv < 0 ? dset->v : job->origv;
+
+	    job->ret = get_transform(job->ci, job->v, job->aux, 0.0, dset,
+				     job->startlen, origv, NULL);
+	    if (job->ret < 0 && stop) {
+		break;
+	    }
+	}
+	return;
+    }
+
+    for (i=0; i<njobs; i+=nb) {
+	m = (njobs - i < nb)? njobs - i : nb;
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(j) reduction(|:miss)
+#endif
+	for (j=0; j<m; j++) {
+	    tr_job_compute(&jobs[i+j], X + (size_t) j * dset->n,
+			   dset, &miss);
+	}
+
+	for (j=0; j<m; j++) {
+	    tr_job *job = &jobs[i+j];
+	    double *vx = X + (size_t) j * dset->n;
+
+	    if (touched[job->v] ||
+		(job->ci == SQUARE && touched[job->aux])) {
+		/* the source has been updated by an earlier job in
+		   this batch: recompute
+		*/
+		tr_job_compute(job, vx, dset, &miss);
+	    }
+	    if (!job->err) {
+		job->ret = tr_job_register(job, vx, dset);
+		if (job->ret > 0 && job->ret < v0) {
+		    /* a pre-existing series which may have been revised */
+		    touched[job->ret] = 1;
+		}
+	    }
+	    if (job->ret < 0 && stop) {
+		goto finish;
+	    }
+	}
+    }
+
+ finish:
+
+    if (miss) {
+	set_gretl_warning(W_GENMISS);
+    }
+
+    free(X);
+    free(touched);
+}
+
 /**
  * laggenr:
  * @v: ID number in dataset of source variable.
@@ -1045,6 +1235,51 @@ int diffgenr (int v, int ci, DATASET *dset)
 			 VNAMELEN - 3, dset->v, NULL);
 }
 
+/**
+ * transform_values:
+ * @ci: LAGS, LOGS, DIFF, LDIFF or SDIFF.
+ * @v: ID number in dataset of source variable.
+ * @lag: lag order, if @ci is LAGS (otherwise ignored).
+ * @targ: array of length dset->n to be filled.
+ * @vname: location to receive the name that laggenr(),
+ * loggenr() or diffgenr() would give the result, or NULL.
+ * @dset: dataset struct.
+ *
+ * Writes into @targ the specified transformation of variable
+ * @v, with the same values that laggenr(), loggenr() or
+ * diffgenr() would produce, but without adding a series to
+ * the dataset. This is for callers that want the values only
+ * as a column of a regression.
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int transform_values (int ci, int v, int lag, double *targ,
+		      char *vname, const DATASET *dset)
+{
+    int t, miss = 0;
+
+    if (ci != LAGS && ci != LOGS && ci != DIFF &&
+	ci != LDIFF && ci != SDIFF) {
+	return E_DATA;
+    } else if (ci == SDIFF && !dataset_is_seasonal(dset)) {
+	return E_PDWRONG;
+    } else if (ci == LAGS && (v == 0 || lag > dset->n || -lag > dset->n)) {
+	return E_DATA;
+    }
+
+    for (t=0; t<dset->n; t++) {
+	targ[t] = NADBL;
+    }
+
+    if (vname != NULL) {
+	make_transform_varname(vname, dset->varname[v], ci, lag,
+			       VNAMELEN - 3);
+    }
+
+    return compute_transform(ci, v, lag, 0.0, targ, dset, NULL, &miss);
+}
+
 /**
  * xpxgenr:
  * @vi: ID number in dataset of first source variable.
@@ -1290,7 +1525,8 @@ transform_preprocess_list (int *list, const DATASET *dset, int f)
 int list_loggenr (int *list, DATASET *dset)
 {
     int origv = dset->v;
-    int tnum, i, j, v;
+    tr_job *jobs;
+    int i, j, n;
     int startlen;
     int l0 = 0;
     int err;
@@ -1300,21 +1536,32 @@ int list_loggenr (int *list, DATASET *dset)
 	return err;
     }
 
+    n = list[0];
+    jobs = malloc(n * sizeof *jobs);
+    if (jobs == NULL) {
+	destroy_mangled_names();
+	return E_ALLOC;
+    }
+
     startlen = get_starting_length(list, dset, 2);
 
+    for (i=0; i<n; i++) {
+	set_tr_job(&jobs[i], LOGS, list[i+1], 0, startlen, origv);
+    }
+
+    transforms_apply(jobs, n, 0, dset);
+
     j = 1;
-    for (i=1; i<=list[0]; i++) {
-	v = list[i];
-	tnum = get_transform(LOGS, v, 0, 0.0, dset, startlen,
-			     origv, NULL);
-	if (tnum > 0) {
-	    list[j++] = tnum;
+    for (i=0; i<n; i++) {
+	if (jobs[i].ret > 0) {
+	    list[j++] = jobs[i].ret;
 	    l0++;
 	}
     }
 
     list[0] = l0;
 
+    free(jobs);
     destroy_mangled_names();
 
     return (l0 > 0)? 0 : E_LOGS;
@@ -1335,7 +1582,8 @@ int list_loggenr (int *list, DATASET *dset)
 int list_stdgenr (int *list, DATASET *dset, gretlopt opt)
 {
     int origv = dset->v;
-    int tnum, i, j, v;
+    tr_job *jobs;
+    int i, j, n;
     int startlen;
     int dfc = 1;
     int l0 = 0;
@@ -1346,6 +1594,13 @@ int list_stdgenr (int *list, DATASET *dset, gretlopt opt)
 	return err;
     }
 
+    n = list[0];
+    jobs = malloc(n * sizeof *jobs);
+    if (jobs == NULL) {
+	destroy_mangled_names();
+	return E_ALLOC;
+    }
+
     if (opt & OPT_C) {
 	dfc = -1;
     } else if (opt & OPT_N) {
@@ -1354,19 +1609,23 @@ int list_stdgenr (int *list, DATASET *dset, gretlopt opt)
 
     startlen = get_starting_length(list, dset, 2);
 
+    for (i=0; i<n; i++) {
+	set_tr_job(&jobs[i], STDIZE, list[i+1], dfc, startlen, origv);
+    }
+
+    transforms_apply(jobs, n, 0, dset);
+
     j = 1;
-    for (i=1; i<=list[0]; i++) {
-	v = list[i];
-	tnum = get_transform(STDIZE, v, dfc, 0.0, dset, startlen,
-			     origv, NULL);
-	if (tnum > 0) {
-	    list[j++] = tnum;
+    for (i=0; i<n; i++) {
+	if (jobs[i].ret > 0) {
+	    list[j++] = jobs[i].ret;
 	    l0++;
 	}
     }
 
     list[0] = l0;
 
+    free(jobs);
     destroy_mangled_names();
 
     return (l0 > 0)? 0 : E_DATA;
@@ -1462,7 +1721,8 @@ int list_laggenr (int **plist, int lmin, int lmax,
     int origv = dset->v;
     int *list = *plist;
     int *laglist = NULL;
-    int l, i, j, v, lv;
+    tr_job *jobs = NULL;
+    int l, i, j, k, v, lv;
     int startlen, l0 = 0;
     int skip_first = 0;
     int veclen = 0;
@@ -1536,19 +1796,26 @@ int list_laggenr (int **plist, int lmin, int lmax,
 	laglist = make_lags_list(list, n_terms);
     }
 
-    if (laglist == NULL) {
+    if (laglist != NULL) {
+	int nmax = (lmax >= lmin)? (lmax - lmin + 1) * list[0] : 1;
+
+	jobs = malloc(nmax * sizeof *jobs);
+    }
+
+    if (laglist == NULL || jobs == NULL) {
+	free(laglist);
 	destroy_mangled_names();
 	return E_ALLOC;
     }
 
     startlen = get_starting_length(list, dset, (lmax > 9)? 3 : 2);
 
-    j = 1;
+    k = 0;
 
     if (compfac > 0) {
 	/* MIDAS high-frequency lags, by lags */
 	int hfpmax = n_terms + skip_first;
-	int mp, hfp = 0;
+	int hfp = 0;
 
 	for (l=lmin; l<=lmax; l++) {
 	    for (i=1; i<=list[0]; i++) {
@@ -1558,17 +1825,7 @@ int list_laggenr (int **plist, int lmin, int lmax,
 		} else if (hfp > hfpmax) {
 		    break;
 		}
-		v = list[i];
-		lv = get_transform(LAGS, v, l, 0.0, dset,
-				   startlen, origv, NULL);
-		if (lv > 0) {
-		    mp = series_get_midas_period(dset, v);
-		    series_set_midas_period(dset, lv, mp);
-		    mp = series_get_midas_freq(dset, v);
-		    series_set_midas_freq(dset, lv, mp);
-		    laglist[j++] = lv;
-		    l0++;
-		}
+		set_tr_job(&jobs[k++], LAGS, list[i], l, startlen, origv);
 	    }
 	}
     } else if (opt & OPT_L) {
@@ -1578,33 +1835,37 @@ int list_laggenr (int **plist, int lmin, int lmax,
 		continue;
 	    }
 	    for (i=1; i<=list[0]; i++) {
-		v = list[i];
-		lv = get_transform(LAGS, v, l, 0.0, dset,
-				   startlen, origv, NULL);
-		if (lv > 0) {
-		    laglist[j++] = lv;
-		    l0++;
-		}
+		set_tr_job(&jobs[k++], LAGS, list[i], l, startlen, origv);
 	    }
 	}
     } else {
 	/* order by variable */
 	for (i=1; i<=list[0]; i++) {
-	    v = list[i];
 	    for (l=lmin; l<=lmax; l++) {
 		if (!lag_wanted(l, lvec, veclen)) {
 		    continue;
 		}
-		lv = get_transform(LAGS, v, l, 0.0, dset,
-				   startlen, origv, NULL);
-		if (lv > 0) {
-		    laglist[j++] = lv;
-		    l0++;
-		}
+		set_tr_job(&jobs[k++], LAGS, list[i], l, startlen, origv);
 	    }
 	}
     }
 
+    transforms_apply(jobs, k, 0, dset);
+
+    for (i=0, j=1; i<k; i++) {
+	lv = jobs[i].ret;
+	if (lv > 0) {
+	    if (compfac > 0) {
+		v = jobs[i].v;
+		series_set_midas_period(dset, lv, series_get_midas_period(dset, v));
+		series_set_midas_freq(dset, lv, series_get_midas_freq(dset, v));
+	    }
+	    laglist[j++] = lv;
+	    l0++;
+	}
+    }
+
+    free(jobs);
     destroy_mangled_names();
 
     laglist[0] = l0;
@@ -1652,8 +1913,9 @@ int default_lag_order (const DATASET *dset)
 int list_diffgenr (int *list, int ci, DATASET *dset)
 {
     int origv = dset->v;
-    int i, v, startlen;
-    int tnum, l0 = 0;
+    tr_job *jobs;
+    int i, n, startlen;
+    int l0 = 0;
     int err;
 
     if (list[0] == 0) {
@@ -1673,22 +1935,33 @@ int list_diffgenr (int *list, int ci, DATASET *dset)
 	return err;
     }
 
+    n = list[0];
+    jobs = malloc(n * sizeof *jobs);
+    if (jobs == NULL) {
+	destroy_mangled_names();
+	return E_ALLOC;
+    }
+
     startlen = get_starting_length(list, dset, (ci == DIFF)? 2 : 3);
 
-    for (i=1; i<=list[0] && !err; i++) {
-	v = list[i];
-	tnum = get_transform(ci, v, 0, 0.0, dset,
-			     startlen, origv, NULL);
-	if (tnum < 0) {
+    for (i=0; i<n; i++) {
+	set_tr_job(&jobs[i], ci, list[i+1], 0, startlen, origv);
+    }
+
+    transforms_apply(jobs, n, 1, dset);
+
+    for (i=0; i<n && !err; i++) {
+	if (jobs[i].ret < 0) {
 	    err = 1;
 	} else {
-	    list[i] = tnum;
+	    list[i+1] = jobs[i].ret;
 	    l0++;
 	}
     }
 
     list[0] = l0;
 
+    free(jobs);
     destroy_mangled_names();
 
     return err;
@@ -1891,7 +2164,8 @@ int list_xpxgenr (int **plist, DATASET *dset, gretlopt opt)
     int origv = dset->v;
     int *list = *plist;
     int *xpxlist = NULL;
-    int tnum, i, j, k, vi, vj;
+    tr_job *jobs;
+    int i, j, k, n, vi;
     int startlen, l0;
     int f, err;
 
@@ -1916,36 +2190,48 @@ int list_xpxgenr (int **plist, DATASET *dset, gretlopt opt)
 	xpxlist = list;
     }
 
+    jobs = malloc((l0 + (l0 * l0 - l0) / 2) * sizeof *jobs);
+    if (jobs == NULL) {
+	if (opt & OPT_O) {
+	    free(xpxlist);
+	}
+	destroy_mangled_names();
+	return E_ALLOC;
+    }
+
     startlen = get_starting_length(list, dset, 3);
-    xpxlist[0] = 0;
 
-    k = 1;
+    n = 0;
     for (i=1; i<=l0; i++) {
 	vi = list[i];
 	/* don't square dummies, but compute interactions with other series
 	   if needed
 	*/
 	if (!gretl_isdummy(dset->t1, dset->t2, dset->Z[vi])) {
-	    tnum = get_transform(SQUARE, vi, vi, 0.0, dset,
-				 startlen, origv, NULL);
-	    if (tnum > 0) {
-		xpxlist[k++] = tnum;
-		xpxlist[0] += 1;
-	    }
+	    set_tr_job(&jobs[n++], SQUARE, vi, vi, startlen, origv);
 	}
 
 	if (opt & OPT_O) {
 	    for (j=i+1; j<=l0; j++) {
-		vj = list[j];
-		tnum = xpxgenr(vi, vj, dset);
-		if (tnum > 0) {
-		    xpxlist[k++] = tnum;
-		    xpxlist[0] += 1;
-		}
+		/* as per xpxgenr() */
+		set_tr_job(&jobs[n++], SQUARE, vi, list[j],
+			   VNAMELEN - 3, -1);
 	    }
 	}
     }
 
+    transforms_apply(jobs, n, 0, dset);
+
+    xpxlist[0] = 0;
+    k = 1;
+    for (i=0; i<n; i++) {
+	if (jobs[i].ret > 0) {
+	    xpxlist[k++] = jobs[i].ret;
+	    xpxlist[0] += 1;
+	}
+    }
+
+    free(jobs);
     destroy_mangled_names();
 
     if (opt & OPT_O) {
@@ -28,6 +28,9 @@ int is_standard_diff (int v, const DATASET *dset, int *parent);
 
 int diffgenr (int v, int ci, DATASET *dset);
 
+int transform_values (int ci, int v, int lag, double *targ,
+		      char *vname, const DATASET *dset);
+
 int laggenr (int v, int lag, DATASET *dset);
 
 int loggenr (int v, DATASET *dset);
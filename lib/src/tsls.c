@@ -32,7 +32,8 @@
 struct iv_info_ {
     MODEL *pmod;      /* pointer to the model to be returned */
     gretl_matrix *Q;  /* matrix for creating "hat" variables */
-    gretl_matrix *g;  /* auxiliary matrix */
+    gretl_matrix *R;  /* R factor of the instrument matrix */
+    gretl_matrix *G;  /* Q'X, for the endogenous regressors X */
     char *missmask;   /* missing observations mask */
     int *reglist;     /* full list of regressors */
     int *instlist;    /* list of instruments */
@@ -52,7 +53,7 @@ static iv_info *iv_info_new (MODEL *pmod)
 
     if (ivi != NULL) {
 	ivi->pmod = pmod;
-	ivi->Q = ivi->g = NULL;
+	ivi->Q = ivi->R = ivi->G = NULL;
 	ivi->missmask = NULL;
 	ivi->reglist = NULL;
 	ivi->instlist = NULL;
@@ -74,7 +75,8 @@ static void iv_info_destroy (iv_info *ivi)
     }
 
     gretl_matrix_free(ivi->Q);
-    gretl_matrix_free(ivi->g);
+    gretl_matrix_free(ivi->R);
+    gretl_matrix_free(ivi->G);
 
     free(ivi->missmask);
     free(ivi->reglist);
@@ -947,7 +949,7 @@ static int tsls_hausman_test (iv_info *ivi, gretlopt opt, DATASET *dset)
 }
 
 /* form matrix of instruments and perform QR decomposition
-   of this matrix; attach return Q to @ivi; return 0 on
+   of this matrix; attach Q and R to @ivi; return 0 on
    success, error code on error.
 */
 
@@ -1038,75 +1040,141 @@ static int tsls_add_Q (iv_info *ivi, const DATASET *dset)
 
  bailout:
 
-    gretl_matrix_free(R);
-
     if (err) {
+        gretl_matrix_free(R);
         free(dlist);
         gretl_matrix_free(ivi->Q);
         ivi->Q = NULL;
     } else {
+        ivi->R = R;
         ivi->idroplist = dlist;
     }
 
     return err;
 }
 
-static int tsls_form_xhat (iv_info *ivi, DATASET *dset,
-			   int v0, int v1)
+/* Form the first-stage fitted values for all the endogenous
+   regressors at once: with X the matrix of endogenous regressors,
+   G = Q'X and \hat{X} = QG, each a single matrix product. The
+   fitted values are written into the series starting at ID @v1.
+   G is retained on @ivi: along with the R factor of the instruments
+   it gives Q'\hat{X} for the second stage, without reference to
+   the data (see tsls_second_stage_G).
+*/
+
+static int tsls_form_xhat (iv_info *ivi, DATASET *dset, int v1)
 {
     const char *mask = ivi->missmask;
-    const double *x = dset->Z[v0];
-    double *xhat = dset->Z[v1];
+    gretl_matrix *X = NULL;
+    gretl_matrix *Xhat = NULL;
+    int m = ivi->endolist[0];
     int k = gretl_matrix_cols(ivi->Q);
-    int allzero = 1;
-    int i, t, s = 0;
+    int i, j, t, s;
     int err = 0;
 
 #if TDEBUG > 1
-    fprintf(stderr, "tsls_form_xhat: v0=%d, v1=%d, t1=%d, t2=%d, mask=%p\n",
-            v0, v1, dset->t1, dset->t2, (void *) mask);
+    fprintf(stderr, "tsls_form_xhat: v1=%d, t1=%d, t2=%d, mask=%p\n",
+            v1, dset->t1, dset->t2, (void *) mask);
 #endif
 
-    /* form g = Q'x */
-    for (i=0; i<k; i++) {
-        ivi->g->val[i] = 0.0;
+    X = gretl_matrix_data_subset_masked(ivi->endolist, dset,
+                                        dset->t1, dset->t2,
+                                        mask, &err);
+    if (err) {
+        return err;
+    }
+
+    ivi->G = gretl_matrix_alloc(k, m);
+    Xhat = gretl_matrix_alloc(X->rows, m);
+    if (ivi->G == NULL || Xhat == NULL) {
+        err = E_ALLOC;
+        goto bailout;
+    }
+
+    /* G = Q'X and \hat{X} = QG = QQ'X */
+    gretl_matrix_multiply_mod(ivi->Q, GRETL_MOD_TRANSPOSE,
+                              X, GRETL_MOD_NONE,
+                              ivi->G, GRETL_MOD_NONE);
+    gretl_matrix_multiply(ivi->Q, ivi->G, Xhat);
+
+    for (j=0; j<m && !err; j++) {
+        double *xhat = dset->Z[v1+j];
+        int allzero = 1;
+
         s = 0;
         for (t=dset->t1; t<=dset->t2; t++) {
             if (mask != NULL && mask[t - dset->t1]) {
-                continue;
+                xhat[t] = NADBL;
+            } else {
+                xhat[t] = gretl_matrix_get(Xhat, s++, j);
+                if (xhat[t] != 0) {
+                    allzero = 0;
+                }
             }
-            ivi->g->val[i] += gretl_matrix_get(ivi->Q, s++, i) * x[t];
+        }
+        i = ivi->endolist[j+1];
+        if (allzero) {
+            gretl_errmsg_sprintf(_("The first-stage fitted values for %s are all zero"),
+                                 dset->varname[i]);
+            err = E_DATA;
+        } else {
+            /* name the fitted series according to the original */
+            strcpy(dset->varname[v1+j], "h_");
+            strncat(dset->varname[v1+j], dset->varname[i], VNAMELEN - 3);
         }
     }
 
-    /* form \hat{x} = Qg = QQ'x */
-    s = 0;
-    for (t=dset->t1; t<=dset->t2; t++) {
-        if (mask != NULL && mask[t - dset->t1]) {
-            xhat[t] = NADBL;
-            continue;
-        }
-        xhat[t] = 0.0;
-        for (i=0; i<k; i++) {
-            xhat[t] += gretl_matrix_get(ivi->Q, s, i) * ivi->g->val[i];
-        }
-        if (xhat[t] != 0) {
-            allzero = 0;
-        }
-        s++;
+ bailout:
+
+    gretl_matrix_free(X);
+    gretl_matrix_free(Xhat);
+
+    return err;
+}
+
+/* Assemble Q'\hat{X}, where Q is the orthonormal factor of the
+   instrument matrix and \hat{X} the second-stage regressors of
+   @pmod. For a fitted series this is the matching column of
+   ivi->G; an exogenous regressor is itself an instrument, so its
+   column is the matching column of the R factor of the instruments.
+   Since \hat{X} = Q (Q'\hat{X}), the result has the same R factor
+   as \hat{X} itself, at a cost independent of the sample size.
+   Returns NULL if any regressor can't be matched.
+*/
+
+static gretl_matrix *tsls_second_stage_G (iv_info *ivi,
+                                          const MODEL *pmod,
+                                          int hat0)
+{
+    gretl_matrix *G;
+    const double *src;
+    int k = pmod->list[0] - 1;
+    int nz = ivi->R->rows;
+    int i, v, pos;
+
+    if (nz < k) {
+        return NULL;
     }
 
-    if (allzero) {
-        gretl_errmsg_sprintf(_("The first-stage fitted values for %s are all zero"),
-                             dset->varname[v0]);
-        err = E_DATA;
-    } else {
-        /* name the fitted series according to the original */
-        strcpy(dset->varname[v1], "h_");
-        strncat(dset->varname[v1], dset->varname[v0], VNAMELEN - 3);
+    G = gretl_matrix_alloc(nz, k);
+    if (G == NULL) {
+        return NULL;
     }
 
-    return err;
+    for (i=0; i<k; i++) {
+        v = pmod->list[i+2];
+        if (ivi->G != NULL && v >= hat0 && v - hat0 < ivi->G->cols) {
+            src = ivi->G->val + (v - hat0) * nz;
+        } else if ((pos = in_gretl_list(ivi->instlist, v)) > 0) {
+            src = ivi->R->val + (pos - 1) * nz;
+        } else {
+            gretl_matrix_free(G);
+            return NULL;
+        }
+        memcpy(G->val + i * nz, src, nz * sizeof *src);
+    }
+
+    return G;
 }
 
 static void tsls_residuals (iv_info *ivi, gretlopt opt,
@@ -1864,42 +1932,26 @@ MODEL tsls (const int *list, DATASET *dset, gretlopt opt)
     fprintf(stderr, "nreg = %d, OverIdRank = %d\n", nreg, ivi->overid);
 #endif
 
-    /* allocate storage for fitted vars (etc.), if needed */
+    /* Deal with the variables for which instruments are needed:
+       form the fitted values as QQ'X for the matrix X of variables
+       in endolist, add them to the data array, dset->Z, and
+       substitute them into the second-stage regression list.
+    */
     if (nendo > 0) {
         err = dataset_add_series(dset, nendo);
         if (!err) {
-            ivi->g = gretl_vector_alloc(ivi->Q->cols);
-            if (ivi->g == NULL) {
-                err = E_ALLOC;
-            }
+            err = tsls_form_xhat(ivi, dset, orig_nvar);
         }
         if (err) {
             goto bailout;
         }
-    }
+        for (i=0; i<nendo; i++) {
+            int v0 = ivi->endolist[i+1];
+            int v1 = orig_nvar + i;
 
-    /* Deal with the variables for which instruments are needed: loop
-       across the list of variables to be instrumented (endolist),
-       form the fitted values as QQ'x_i, and add these fitted values
-       into the data array, dset->Z.
-    */
-
-    for (i=0; i<nendo; i++) {
-        int v0 = ivi->endolist[i+1];
-        int v1 = orig_nvar + i;
-
-        /* form xhat_i = QQ'x_i */
-        err = tsls_form_xhat(ivi, dset, v0, v1);
-        if (err) {
-            goto bailout;
+            replace_list_element(ivi->s2list, v0, v1);
+            ivi->hatlist[i+1] = v1;
         }
-
-        /* substitute v1 into the right place in the second-stage
-           regression list */
-        replace_list_element(ivi->s2list, v0, v1);
-
-        /* and update hatlist */
-        ivi->hatlist[i+1] = v1;
     }
 
     /* second-stage regression */
@@ -1948,7 +2000,10 @@ MODEL tsls (const int *list, DATASET *dset, gretlopt opt)
 
     if (opt & OPT_R) {
         /* robust standard errors called for */
-        qr_tsls_vcv(&tsls, dset, opt);
+        gretl_matrix *G = tsls_second_stage_G(ivi, &tsls, orig_nvar);
+
+        qr_tsls_vcv(&tsls, dset, G, opt);
+        gretl_matrix_free(G);
         if (tsls.errcode) {
             fprintf(stderr, "qr_tsls_vcv: err = %d\n", tsls.errcode);
             goto bailout;
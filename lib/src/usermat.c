@@ -30,8 +30,6 @@
 
 /* mspec convenience macros */
 
-#define mspec_get_offset(m) (m->lsel.range[0])
-#define mspec_get_n_elem(m) (m->lsel.range[1])
 
 #define mspec_set_offset(m,o) (m->lsel.range[0] = o)
 #define mspec_set_n_elem(m,n) (m->lsel.range[1] = n)
@@ -65,7 +63,10 @@
  * get_matrix_by_name:
  * @name: name of the matrix.
  *
- * Looks up a user-defined matrix by name.
+ * Looks up a user-defined matrix by name. Since the caller
+ * may modify the matrix, a function argument that is sharing
+ * its data with the calling function is first given its own
+ * copy.
  *
  * Returns: pointer to matrix, or %NULL if not found.
  */
@@ -78,7 +79,7 @@ gretl_matrix *get_matrix_by_name (const char *name)
 	user_var *u;
 
 	u = get_user_var_of_type_by_name(name, GRETL_TYPE_MATRIX);
-	if (u != NULL) {
+	if (u != NULL && user_var_unshare(u) == 0) {
 	    ret = user_var_get_value(u);
 	}
     }
@@ -745,6 +746,59 @@ static int contig_cols (matrix_subspec *spec,
     }
 }
 
+/* Determine the dimensions of the submatrix of @M selected by
+   @spec, which should already have been checked, and ensure that
+   the row and column slices are in place for a non-contiguous
+   selection. Returns E_DATA for selections that are not a simple
+   block (dummy constants, single elements, and the degenerate
+   exclusions on a 1 x 1 matrix), which callers should handle by
+   other means.
+*/
+
+int mspec_get_dims (matrix_subspec *spec, const gretl_matrix *M,
+		    int *r, int *c)
+{
+    int err = 0;
+
+    if (is_sel_dummy(spec->ltype) || spec->ltype == SEL_ELEMENT) {
+	return E_DATA;
+    }
+
+    if (spec->ltype == SEL_CONTIG) {
+	int nelem = mspec_get_n_elem(spec);
+
+	if (mspec_get_offset(spec) < 0) {
+	    return E_DATA;
+	} else if (M->cols > 1 && M->rows > 1) {
+	    *c = contig_cols(spec, M);
+	    *r = nelem / *c;
+	} else if (M->rows == 1) {
+	    *r = 1;
+	    *c = nelem;
+	} else {
+	    *r = nelem;
+	    *c = 1;
+	}
+	return 0;
+    }
+
+    if (M->rows == 1 && M->cols == 1 &&
+	(spec->ltype == SEL_EXCL || spec->rtype == SEL_EXCL)) {
+	return E_DATA;
+    }
+
+    if (spec->rslice == NULL && spec->cslice == NULL) {
+	err = get_slices(spec, M);
+    }
+
+    if (!err) {
+	*r = (spec->rslice == NULL)? M->rows : spec->rslice[0];
+	*c = (spec->cslice == NULL)? M->cols : spec->cslice[0];
+    }
+
+    return err;
+}
+
 static void transcribe_cols_8 (gretl_matrix *M,
 			       const gretl_matrix *S,
 			       const int *cslice,
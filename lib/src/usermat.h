@@ -70,8 +70,14 @@ struct matrix_subspec_ {
 
 #define mspec_get_element(m) (m->lsel.range[0])
 
+#define mspec_get_offset(m) (m->lsel.range[0])
+#define mspec_get_n_elem(m) (m->lsel.range[1])
+
 matrix_subspec *matrix_subspec_new (void);
 
+int mspec_get_dims (matrix_subspec *spec, const gretl_matrix *M,
+                    int *r, int *c);
+
 GList *get_named_matrix_list (void);
 
 gretl_matrix *get_matrix_by_name (const char *name);
@@ -30,6 +30,8 @@
 #include "uservar.h"
 #include "uservar_priv.h"
 #include "gretl_cmatrix.h"
+#include "gretl_binio.h"
+#include "gretl_strhash.h"
 
 #ifdef WIN32
 # include "gretl_win32.h"
@@ -45,10 +47,43 @@
 #define LEVEL_AUTO -1
 #define LEV_PRIVATE -1
 
-static user_var **uvars;
-static int n_vars;
-static int n_alloc;
-static int scalar_imin;
+/* The table of user variables. Ordinarily there is one table for
+   the whole program, but a thread that calls libgretl_thread_init()
+   gets a table of its own; other threads, OpenMP workers included,
+   see the program-wide table (compare the settings stack in
+   libset.c).
+*/
+
+typedef struct uvar_table_ uvar_table;
+
+struct uvar_table_ {
+    user_var **uvars;
+    int n_vars;
+    int n_alloc;
+    int scalar_imin;
+    gretl_strhash *uvh0;       /* for use at "main" exec level */
+    gretl_strhash *uvh1;       /* for use within functions */
+    gretl_strhash *uvars_hash; /* pointer to one or other of the above */
+    int previous_d;            /* record of previous "function depth" */
+};
+
+static uvar_table main_uvt = {NULL, 0, 0, 0, NULL, NULL, NULL, -1};
+static uvar_table *thread_uvt;
+
+#if defined(_OPENMP) && !defined(__APPLE__)
+#pragma omp threadprivate(thread_uvt)
+#endif
+
+#define uvt (thread_uvt != NULL ? thread_uvt : &main_uvt)
+
+#define uvars       (uvt->uvars)
+#define n_vars      (uvt->n_vars)
+#define n_alloc     (uvt->n_alloc)
+#define scalar_imin (uvt->scalar_imin)
+#define uvh0        (uvt->uvh0)
+#define uvh1        (uvt->uvh1)
+#define uvars_hash  (uvt->uvars_hash)
+#define previous_d  (uvt->previous_d)
 
 /* callback for the benefit of the edit scalars window
    in the gretl GUI */
@@ -64,6 +99,7 @@ static USER_VAR_FUNC user_var_callback;
 
 #define var_is_private(u) ((u->flags & UV_PRIVATE) || *u->name == '$' || *u->name == '_')
 #define var_is_shell(u)   (u->flags & UV_SHELL)
+#define var_is_cow(u)     (u->flags & UV_COW)
 
 static double *na_ptr (void)
 {
@@ -77,7 +113,7 @@ static double *na_ptr (void)
 }
 
 static user_var *user_var_new (const char *name, GretlType type,
-                               void *value, int *err)
+                               void *value, int shell, int *err)
 {
     user_var *u;
 
@@ -104,7 +140,7 @@ static user_var *user_var_new (const char *name, GretlType type,
 
             if (m == NULL) {
                 u->ptr = gretl_null_matrix_new();
-            } else if (get_user_var_by_data(m) != NULL) {
+            } else if (!shell && get_user_var_by_data(m) != NULL) {
                 /* this check should be redundant? */
                 u->ptr = gretl_matrix_copy(m);
             } else {
@@ -178,10 +214,29 @@ static void uvar_free_value (user_var *u)
     }
 }
 
-static GHashTable *uvh0;       /* for use at "main" exec level */
-static GHashTable *uvh1;       /* for use within functions */
-static GHashTable *uvars_hash; /* pointer to one or other of the above */
-static int previous_d = -1;    /* record of previous "function depth" */
+/* Make a private copy of the value of a variable that is
+   sharing its caller's data (see arg_add_as_cow() below).
+*/
+
+static void *uvar_copy_value (user_var *u, int *err)
+{
+    void *ret = NULL;
+
+    if (u->type == GRETL_TYPE_MATRIX) {
+        ret = gretl_matrix_copy(u->ptr);
+        if (ret == NULL) {
+            *err = E_ALLOC;
+        }
+    } else if (u->type == GRETL_TYPE_BUNDLE) {
+        ret = gretl_bundle_copy(u->ptr, err);
+    } else if (u->type == GRETL_TYPE_ARRAY) {
+        ret = gretl_array_copy(u->ptr, err);
+    } else {
+        *err = E_TYPES;
+    }
+
+    return ret;
+}
 
 void set_previous_depth (int d)
 {
@@ -204,7 +259,7 @@ void switch_uservar_hash (int level)
     if (level == 0) {
         uvars_hash = uvh0;
         if (uvh1 != NULL) {
-            g_hash_table_remove_all(uvh1);
+            gretl_strhash_remove_all(uvh1);
         }
     } else {
         uvars_hash = uvh1;
@@ -217,7 +272,7 @@ static void uvar_hash_destroy (void)
 #if HDEBUG
         fprintf(stderr, "uvar_hash_destroy: destroying uvh0\n");
 #endif
-        g_hash_table_destroy(uvh0);
+        gretl_strhash_destroy(uvh0);
         uvh0 = NULL;
     }
 
@@ -225,7 +280,7 @@ static void uvar_hash_destroy (void)
 #if HDEBUG
         fprintf(stderr, "uvar_hash_destroy: destroying uvh1\n");
 #endif
-        g_hash_table_destroy(uvh1);
+        gretl_strhash_destroy(uvh1);
         uvh1 = NULL;
     }
 
@@ -243,12 +298,12 @@ static void user_var_destroy (user_var *u)
 
     if (uvars_hash != NULL) {
 # if HDEBUG > 1
-        if (g_hash_table_remove(uvars_hash, u->name)) {
+        if (gretl_strhash_remove(uvars_hash, u->name)) {
             fprintf(stderr, "removed '%s' from hash table at %p\n",
                     u->name, (void *) uvars_hash);
         }
 # else
-        g_hash_table_remove(uvars_hash, u->name);
+        gretl_strhash_remove(uvars_hash, u->name);
 # endif
     }
 
@@ -302,7 +357,7 @@ static int real_user_var_add (const char *name,
     user_var *u;
     int err = 0;
 
-    u = user_var_new(name, type, value, &err);
+    u = user_var_new(name, type, value, (opt & OPT_S) ? 1 : 0, &err);
 
     if (u == NULL) {
         fprintf(stderr, "real_user_var_add: name='%s', value=%p, u=NULL\n",
@@ -574,7 +629,7 @@ user_var *get_user_var_of_type_by_name (const char *name,
         if (d == 0) {
             /* we're now at "main" level */
             if (uvh0 == NULL) {
-                uvh0 = g_hash_table_new(g_str_hash, g_str_equal);
+                uvh0 = gretl_strhash_new(NULL);
 #if HDEBUG
                 fprintf(stderr, "uvh0: d=0, allocated at %p\n", uvh0);
 #endif
@@ -584,19 +639,19 @@ user_var *get_user_var_of_type_by_name (const char *name,
                 fprintf(stderr, "d=0, prev=%d: clear uvh1 at %p\n",
                         prev_d, uvh1);
 #endif
-                g_hash_table_remove_all(uvh1);
+                gretl_strhash_remove_all(uvh1);
             }
             uvars_hash = uvh0;
         } else if (!use_uvh1()) {
             /* exec'ing a function, hash table not wanted */
             if (prev_d > 0 && uvh1 != NULL) {
-                g_hash_table_remove_all(uvh1);
+                gretl_strhash_remove_all(uvh1);
             }
             uvars_hash = NULL;
         } else {
             /* exec'ing a function, hash table wanted */
             if (uvh1 == NULL) {
-                uvh1 = g_hash_table_new(g_str_hash, g_str_equal);
+                uvh1 = gretl_strhash_new(NULL);
 #if HDEBUG
                 fprintf(stderr, "uvh1: d=%d, prev=%d, allocated at %p\n",
                         d, prev_d, uvh1);
@@ -606,7 +661,7 @@ user_var *get_user_var_of_type_by_name (const char *name,
                 fprintf(stderr, "d=%d, prev=%d: clear uvh1 at %p\n",
                         d, prev_d, uvh1);
 #endif
-                g_hash_table_remove_all(uvh1);
+                gretl_strhash_remove_all(uvh1);
             }
             uvars_hash = uvh1;
         }
@@ -615,7 +670,7 @@ user_var *get_user_var_of_type_by_name (const char *name,
 
     if (uvars_hash != NULL) {
         /* first resort: try a hash look-up */
-        u = g_hash_table_lookup(uvars_hash, name);
+        u = gretl_strhash_lookup(uvars_hash, name);
         /* but verify type, if specified */
         if (u != NULL && type != GRETL_TYPE_ANY && u->type != type) {
             u = NULL;
@@ -636,7 +691,7 @@ user_var *get_user_var_of_type_by_name (const char *name,
                 !strcmp(uvars[i]->name, name)) {
                 u = uvars[i];
                 if (uvars_hash != NULL) {
-                    g_hash_table_insert(uvars_hash, u->name, u);
+                    gretl_strhash_insert(uvars_hash, u->name, u);
                 }
                 break;
             }
@@ -706,7 +761,7 @@ const char *uservar_name_complete (const char *s)
     const char *ret = NULL;
 
     if (uvars_hash != NULL) {
-        GList *hk = g_hash_table_get_keys(uvars_hash);
+        GList *hk = gretl_strhash_get_keys(uvars_hash);
         int n = strlen(s);
 
         while (hk != NULL) {
@@ -896,8 +951,12 @@ int user_var_localize (const char *origname,
     if (u == NULL) {
         err = E_DATA;
     } else {
-        user_var_set_name(u, localname);
-        u->level += 1;
+        /* the callee may modify the object */
+        err = user_var_unshare(u);
+        if (!err) {
+            user_var_set_name(u, localname);
+            u->level += 1;
+        }
     }
 
     return err;
@@ -974,7 +1033,10 @@ int user_var_replace_value (user_var *uvar, void *value,
     }
 
     if (!err && value != uvar->ptr) {
-        if (uvar->ptr != NULL) {
+        if (var_is_cow(uvar)) {
+            /* the old value belongs to the caller */
+            uvar->flags &= ~(UV_COW | UV_SHELL);
+        } else if (uvar->ptr != NULL) {
             uvar_free_value(uvar);
         }
         uvar->ptr = value;
@@ -983,6 +1045,34 @@ int user_var_replace_value (user_var *uvar, void *value,
     return err;
 }
 
+/**
+ * user_var_unshare:
+ * @uvar: user variable.
+ *
+ * If @uvar is a function argument that is sharing its data
+ * with the caller (see arg_add_as_cow()), gives it a private
+ * copy of the data, so that it can be modified; otherwise
+ * does nothing.
+ *
+ * Returns: 0 on success, non-zero on error.
+ */
+
+int user_var_unshare (user_var *uvar)
+{
+    int err = 0;
+
+    if (uvar != NULL && var_is_cow(uvar)) {
+        void *ptr = uvar_copy_value(uvar, &err);
+
+        if (!err) {
+            uvar->ptr = ptr;
+            uvar->flags &= ~(UV_COW | UV_SHELL);
+        }
+    }
+
+    return err;
+}
+
 /**
  * user_var_set_pointer:
  * @uvar: user variable.
@@ -1098,7 +1188,15 @@ void *user_var_steal_value (user_var *uvar)
     void *ret = NULL;
 
     if (uvar != NULL) {
-        ret = uvar->ptr;
+        if (var_is_cow(uvar)) {
+            /* the caller keeps the original */
+            int err = 0;
+
+            ret = uvar_copy_value(uvar, &err);
+            uvar->flags &= ~(UV_COW | UV_SHELL);
+        } else {
+            ret = uvar->ptr;
+        }
         uvar->ptr = NULL;
     }
 
@@ -1114,7 +1212,14 @@ void *user_var_unstack_value (user_var *uvar)
 
     for (i=0; i<n_vars; i++) {
         if (uvar == uvars[i]) {
-            ret = uvar->ptr;
+            if (var_is_cow(uvar)) {
+                int err = 0;
+
+                ret = uvar_copy_value(uvar, &err);
+                uvar->flags &= ~(UV_COW | UV_SHELL);
+            } else {
+                ret = uvar->ptr;
+            }
             uvars[i]->ptr = NULL;
             user_var_destroy(uvars[i]);
             for (j=i; j<n_vars-1; j++) {
@@ -1212,6 +1317,35 @@ int arg_add_as_shell (const char *name, GretlType type,
     return real_user_var_add(name, type, value, OPT_S | OPT_A, NULL);
 }
 
+/**
+ * arg_add_as_cow:
+ * @name: name of function parameter.
+ * @type: type of the argument (matrix, bundle or array).
+ * @value: the caller's object.
+ *
+ * Makes @value available under @name within a function
+ * without copying it, as for a "const" argument, but on a
+ * copy-on-write basis: if the function tries to modify the
+ * object a private copy is made first (see user_var_unshare()),
+ * so the caller's object is never altered.
+ *
+ * Returns: 0 on success, non-zero on error.
+ */
+
+int arg_add_as_cow (const char *name, GretlType type,
+                    void *value)
+{
+    user_var *u = NULL;
+    int err;
+
+    err = real_user_var_add(name, type, value, OPT_S | OPT_A, &u);
+    if (!err && u != NULL) {
+        u->flags |= UV_COW;
+    }
+
+    return err;
+}
+
 /**
  * copy_matrix_as:
  * @m: the original matrix.
@@ -1308,6 +1442,20 @@ int copy_as_arg (const char *param_name, GretlType type, void *value)
     return err;
 }
 
+/* Like copy_as_arg(), but for the case where @value is a temporary
+   matrix or bundle which the caller has handed over: the new
+   function-local variable takes ownership of it.
+*/
+
+int donate_as_arg (const char *param_name, GretlType type, void *value)
+{
+    if (type != GRETL_TYPE_MATRIX && type != GRETL_TYPE_BUNDLE) {
+        return E_TYPES;
+    }
+
+    return real_user_var_add(param_name, type, value, OPT_A, NULL);
+}
+
 int *copy_list_as_arg (const char *param_name, int *list,
                        int *err)
 {
@@ -1323,7 +1471,7 @@ int *copy_list_as_arg (const char *param_name, int *list,
 
 void destroy_user_vars (void)
 {
-    int i, j;
+    int i;
 
 #if HDEBUG
     fprintf(stderr, "destroy_user_vars, uvars_hash = %p (uvh0 %p, uvh1 %p)\n",
@@ -1335,11 +1483,7 @@ void destroy_user_vars (void)
             break;
         }
         user_var_destroy(uvars[i]);
-        for (j=i; j<n_vars-1; j++) {
-            uvars[j] = uvars[j+1];
-        }
-        uvars[n_vars-1] = NULL;
-        i--;
+        uvars[i] = NULL;
     }
 
     if (uvh0 != NULL || uvh1 != NULL) {
@@ -1353,6 +1497,47 @@ void destroy_user_vars (void)
     n_alloc = 0;
 }
 
+/**
+ * uservar_thread_init:
+ *
+ * Gives the calling thread an empty table of user variables of
+ * its own, in place of the program-wide one. Called by
+ * libgretl_thread_init().
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int uservar_thread_init (void)
+{
+    if (thread_uvt == NULL) {
+        thread_uvt = calloc(1, sizeof *thread_uvt);
+        if (thread_uvt == NULL) {
+            return E_ALLOC;
+        }
+        /* now refers to the thread's table */
+        set_previous_depth(-1);
+    }
+
+    return 0;
+}
+
+/**
+ * uservar_thread_cleanup:
+ *
+ * Destroys the user variables belonging to the calling thread,
+ * if it has a table of its own, and reverts the thread to the
+ * program-wide table.
+ */
+
+void uservar_thread_cleanup (void)
+{
+    if (thread_uvt != NULL) {
+        destroy_user_vars();
+        free(thread_uvt);
+        thread_uvt = NULL;
+    }
+}
+
 static int uvar_levels_match (user_var *u, int level)
 {
     int ret = 0;
@@ -1378,28 +1563,24 @@ static int real_destroy_user_vars_at_level (int level, int type,
             gretl_type_get_name(type), imin);
 #endif
 
+    /* Compact the stack in a single pass: the survivors are moved
+       down (in order) over the slots of destroyed variables.
+    */
     for (i=imin; i<n_vars; i++) {
         if (uvars[i] == NULL) {
             break;
         }
-        if (type > 0 && uvars[i]->type != type) {
-            /* preserve this variable */
-            nv++;
-            continue;
-        }
-        if (uvar_levels_match(uvars[i], level)) {
+        if ((type == 0 || uvars[i]->type == type) &&
+            uvar_levels_match(uvars[i], level)) {
             user_var_destroy(uvars[i]);
-            /* shuffle the remainder down one place */
-            for (j=i; j<n_vars-1; j++) {
-                uvars[j] = uvars[j+1];
-            }
-            uvars[n_vars-1] = NULL;
-            i--;
         } else {
             /* preserving */
-            nv++;
+            uvars[nv++] = uvars[i];
         }
     }
+    for (j=nv; j<i; j++) {
+        uvars[j] = NULL;
+    }
 
     set_nvars(nv, "real_destroy_user_vars_at_level");
 
@@ -2294,17 +2475,76 @@ struct uvar_file_ {
     const char *typestr;
     xml_write_func write_func;
     xml_read_func read_func;
+    int binary;
 };
 
 typedef struct uvar_file_ uvar_file;
 
+/* Matrices and bundles are saved in gretl's binary format (see
+   gretl_binio.c), which is much quicker to write and to restore
+   than XML when the objects are large. XML is still read, for
+   sessions saved by earlier versions, and is written for bundles
+   if any of them can't be represented in binary.
+*/
+
 static uvar_file uvar_files[] = {
-    { GRETL_TYPE_DOUBLE, "scalars",  write_user_scalars,  read_user_scalars },
-    { GRETL_TYPE_MATRIX, "matrices", write_user_matrices, read_user_matrices },
-    { GRETL_TYPE_LIST,   "lists",    write_user_lists,    read_user_lists },
-    { GRETL_TYPE_BUNDLE, "bundles",  write_user_bundles,  read_user_bundles }
+    { GRETL_TYPE_DOUBLE, "scalars",  write_user_scalars,  read_user_scalars,  0 },
+    { GRETL_TYPE_MATRIX, "matrices", write_user_matrices, read_user_matrices, 1 },
+    { GRETL_TYPE_LIST,   "lists",    write_user_lists,    read_user_lists,    0 },
+    { GRETL_TYPE_BUNDLE, "bundles",  write_user_bundles,  read_user_bundles,  1 }
 };
 
+static int user_vars_binary_ok (GretlType type)
+{
+    int i;
+
+    for (i=0; i<n_vars; i++) {
+        if (uvars[i]->type == type &&
+            !gretl_bin_writable(type, uvars[i]->ptr)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int write_user_vars_binary (GretlType type, const char *path)
+{
+    gretl_bin_writer *w;
+    int i, err = 0;
+
+    w = gretl_bin_writer_new(path, &err);
+
+    for (i=0; i<n_vars && !err; i++) {
+        if (uvars[i]->type == type) {
+            err = gretl_bin_write_object(w, uvars[i]->name, type,
+                                         uvars[i]->ptr);
+        }
+    }
+
+    if (w != NULL) {
+        int cerr = gretl_bin_writer_close(w);
+
+        if (!err) {
+            err = cerr;
+        }
+    }
+
+    return err;
+}
+
+static int read_user_var_binary (const char *name, GretlType type,
+                                 void *ptr, void *data)
+{
+    GretlType *ptype = data;
+
+    if (type != *ptype) {
+        return E_DATA;
+    }
+
+    return user_var_add(name, type, ptr);
+}
+
 int serialize_user_vars (const char *dirname)
 {
     GretlType type;
@@ -2326,6 +2566,18 @@ int serialize_user_vars (const char *dirname)
             int errp = 0;
 
             typestr = uvar_files[i].typestr;
+            if (uvar_files[i].binary && user_vars_binary_ok(type)) {
+                sprintf(path, "%s%c%s.xml", dirname, SLASH, typestr);
+                gretl_remove(path);
+                sprintf(path, "%s%c%s.bin", dirname, SLASH, typestr);
+                if (write_user_vars_binary(type, path)) {
+                    err++;
+                }
+                continue;
+            } else if (uvar_files[i].binary) {
+                sprintf(path, "%s%c%s.bin", dirname, SLASH, typestr);
+                gretl_remove(path);
+            }
             sprintf(path, "%s%c%s.xml", dirname, SLASH, typestr);
             write_func = uvar_files[i].write_func;
             prn = gretl_print_new_with_filename(path, &errp);
@@ -2376,6 +2628,24 @@ int deserialize_user_vars (const char *dirname)
         int err_i = 0;
 
         typestr = uvar_files[i].typestr;
+
+        if (uvar_files[i].binary) {
+            sprintf(path, "%s%c%s.bin", dirname, SLASH, typestr);
+            if (gretl_file_exists(path)) {
+                GretlType type = uvar_files[i].type;
+
+                err_i = gretl_bin_read_objects(path, read_user_var_binary,
+                                               &type);
+                if (err_i) {
+                    n_failed++;
+                    if (!err) {
+                        err = err_i;
+                    }
+                }
+                continue;
+            }
+        }
+
         sprintf(path, "%s%c%s.xml", dirname, SLASH, typestr);
 
 #if UDEBUG
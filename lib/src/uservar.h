@@ -30,7 +30,8 @@ typedef enum {
     UV_SHELL   = 1 << 1,
     UV_MAIN    = 1 << 2,
     UV_NODECL  = 1 << 3,
-    UV_NOREPL  = 1 << 4
+    UV_NOREPL  = 1 << 4,
+    UV_COW     = 1 << 5
 } UVFlags;
 
 typedef int (*USER_VAR_FUNC) (const char *, GretlType, int);
@@ -116,10 +117,19 @@ void switch_uservar_hash (int level);
 int copy_as_arg (const char *param_name, GretlType type, 
 		 void *value);
 
+int donate_as_arg (const char *param_name, GretlType type,
+		   void *value);
+
 int arg_add_as_shell (const char *name,
 		      GretlType type,
 		      void *value);
 
+int arg_add_as_cow (const char *name,
+		    GretlType type,
+		    void *value);
+
+int user_var_unshare (user_var *uvar);
+
 int *copy_list_as_arg (const char *param_name, int *list,
 		       int *err);
 
@@ -133,6 +143,10 @@ int user_matrix_replace_matrix_by_name (const char *name,
 
 void destroy_user_vars (void);
 
+int uservar_thread_init (void);
+
+void uservar_thread_cleanup (void);
+
 int destroy_user_vars_at_level (int level);
 
 int destroy_private_matrices (void);
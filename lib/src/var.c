@@ -29,6 +29,7 @@
 #include "gretl_xml.h"
 #include "matrix_extra.h"
 #include "system.h"
+#include "gretl_mt.h"
 
 #define VDEBUG 0
 
@@ -1395,6 +1396,195 @@ gretl_VAR_get_forecast_matrix (GRETL_VAR *var, int t1, int t2,
     return var->F;
 }
 
+/* Simulated forecast paths: since the system is linear, each path
+   is the dynamic point forecast plus the response, via the
+   companion form, to its own sequence of shocks. The deviations
+   from the point forecast for a block of paths are advanced
+   together by one product per step, and the blocks are shared
+   out among threads.
+*/
+
+#define VAR_PATH_BLOCK 256
+
+static int VAR_paths_block (const gretl_matrix *At,
+			    const gretl_matrix *C,
+			    const gretl_matrix *Z,
+			    const gretl_matrix *F,
+			    gretl_matrix *P,
+			    int j0, int nb)
+{
+    gretl_matrix_block *B;
+    gretl_matrix *S, *D;
+    gretl_matrix zs;
+    double *col, *pcol;
+    int n = At->rows;
+    int np = At->cols;
+    int nsh = np - n;
+    int h = P->rows;
+    int M = Z->cols / h;
+    int i, j, s;
+
+    B = gretl_matrix_block_new(&S, np, nb, &D, n, nb, NULL);
+    if (B == NULL) {
+	return E_ALLOC;
+    }
+
+    gretl_matrix_zero(S);
+    gretl_matrix_init_full(&zs, n, nb, NULL);
+
+    for (s=0; s<h; s++) {
+	/* D = At * S + C * Z_s */
+	zs.val = Z->val + (size_t) n * (s * M + j0);
+	gretl_matrix_multiply(At, S, D);
+	gretl_matrix_multiply_mod(C, GRETL_MOD_NONE,
+				  &zs, GRETL_MOD_NONE,
+				  D, GRETL_MOD_CUMULATE);
+	for (j=0; j<nb; j++) {
+	    col = S->val + (size_t) j * np;
+	    if (nsh > 0) {
+		memmove(col + n, col, nsh * sizeof *col);
+	    }
+	    memcpy(col, D->val + (size_t) j * n, n * sizeof *col);
+	    pcol = P->val + (size_t) (j0 + j) * n * h;
+	    for (i=0; i<n; i++) {
+		pcol[s + i * h] = gretl_matrix_get(F, s, i) + col[i];
+	    }
+	}
+    }
+
+    gretl_matrix_block_destroy(B);
+
+    return 0;
+}
+
+/**
+ * gretl_VAR_simulate_paths:
+ * @var: pointer to VAR or VECM struct.
+ * @h: forecast horizon.
+ * @npaths: number of paths to simulate.
+ * @dset: dataset struct.
+ * @err: location to receive error code.
+ *
+ * Simulates @npaths out-of-sample paths of length @h for the
+ * endogenous variables of @var, starting from the end of the
+ * estimation sample, with shocks drawn from the multivariate
+ * normal distribution with the estimated cross-equation
+ * covariance matrix. The dataset must extend at least @h
+ * periods beyond the estimation sample, so that the values of
+ * any exogenous terms are known; it is not modified.
+ *
+ * Returns: a newly allocated @h x (n * @npaths) matrix, where
+ * n is the number of equations, holding path j in columns
+ * (j-1)*n + 1 to j*n (1-based), or NULL on error.
+ */
+
+gretl_matrix *gretl_VAR_simulate_paths (GRETL_VAR *var, int h,
+					int npaths,
+					const DATASET *dset,
+					int *err)
+{
+    gretl_matrix *F, *Fsave;
+    gretl_matrix *At = NULL;
+    gretl_matrix *C = NULL;
+    gretl_matrix *Z = NULL;
+    gretl_matrix *P = NULL;
+    int n = var->neqns;
+    int t1 = var->t2 + 1;
+    int t2 = var->t2 + h;
+    int nblocks, np, i, j;
+
+    if (h <= 0 || npaths <= 0) {
+	*err = E_INVARG;
+	return NULL;
+    } else if (var->A == NULL || var->S == NULL) {
+	*err = E_BADSTAT;
+	return NULL;
+    } else if (t2 >= dset->n) {
+	gretl_errmsg_sprintf(_("The dataset must extend %d periods beyond "
+			       "the estimation sample"), h);
+	*err = E_DATA;
+	return NULL;
+    }
+
+    /* the dynamic point forecast, leaving any attached
+       forecast in place
+    */
+    Fsave = var->F;
+    var->F = NULL;
+    if (var->ci == VECM) {
+	*err = VECM_add_forecast(var, t1, t2, dset, OPT_NONE);
+    } else {
+	*err = VAR_add_forecast(var, t1, t2, dset, OPT_NONE);
+    }
+    F = var->F;
+    var->F = Fsave;
+
+    for (i=0; i<n*h && !*err; i++) {
+	if (na(F->val[i])) {
+	    *err = E_MISSDATA;
+	}
+    }
+
+    if (!*err) {
+	np = var->A->cols;
+	At = gretl_matrix_alloc(n, np);
+	C = gretl_matrix_copy(var->S);
+	Z = gretl_matrix_alloc(n, h * npaths);
+	P = gretl_matrix_alloc(h, n * npaths);
+	if (At == NULL || C == NULL || Z == NULL || P == NULL) {
+	    *err = E_ALLOC;
+	}
+    }
+
+    if (!*err) {
+	*err = gretl_matrix_cholesky_decomp(C);
+    }
+
+    if (!*err) {
+	for (j=0; j<np; j++) {
+	    for (i=0; i<n; i++) {
+		gretl_matrix_set(At, i, j, gretl_matrix_get(var->A, i, j));
+	    }
+	}
+	/* draw all the shocks up front, so that for a given seed
+	   the result doesn't depend on the number of threads
+	*/
+	gretl_rand_normal(Z->val, 0, n * h * npaths - 1);
+	nblocks = (npaths + VAR_PATH_BLOCK - 1) / VAR_PATH_BLOCK;
+
+#if defined(_OPENMP)
+#pragma omp parallel for private(j) if (nblocks > 1 && gretl_use_openmp((guint64) npaths * h * n * np))
+#endif
+	for (j=0; j<nblocks; j++) {
+	    int j0 = j * VAR_PATH_BLOCK;
+	    int nb = MIN(VAR_PATH_BLOCK, npaths - j0);
+	    int berr = VAR_paths_block(At, C, Z, F, P, j0, nb);
+
+	    if (berr) {
+#if defined(_OPENMP)
+#pragma omp critical
+#endif
+		*err = berr;
+	    }
+	}
+    }
+
+    gretl_matrix_free(F);
+    gretl_matrix_free(At);
+    gretl_matrix_free(C);
+    gretl_matrix_free(Z);
+
+    if (*err) {
+	gretl_matrix_free(P);
+	P = NULL;
+    } else {
+	gretl_matrix_set_t1(P, t1);
+	gretl_matrix_set_t2(P, t2);
+    }
+
+    return P;
+}
+
 static void VAR_dw_rho (MODEL *pmod)
 {
     double ut, u1;
@@ -1794,35 +1984,57 @@ void copy_north_west (gretl_matrix *targ,
     }
 }
 
+/* Compute impulse responses by running the VAR recursion on the
+   top n rows of the companion matrix @A (only these rows are
+   accessed, so @A may be either the full companion matrix or just
+   its top part). The current response matrix and its p - 1
+   predecessors are stacked in @rtmp; this avoids forming products
+   with the full companion matrix, which is costly when the VAR is
+   large.
+*/
+
 static int real_point_responses (const gretl_matrix *A,
 				 const gretl_matrix *C,
 				 gretl_matrix *resp,
 				 int targ, int shock)
 {
-    gretl_matrix *rtmp;
-    gretl_matrix *ctmp;
-    double rij;
+    gretl_matrix_block *B;
+    gretl_matrix *At, *rtmp, *rnew;
+    double rij, *col;
     int n = C->rows;
     int np = A->cols;
+    int nsh = np - n;
     int i, j, k, t;
 
     /* workspace */
-    rtmp = gretl_matrix_alloc(np, n);
-    ctmp = gretl_zero_matrix_new(np, n);
-    if (rtmp == NULL || ctmp == NULL) {
-	gretl_matrix_free(rtmp);
-	gretl_matrix_free(ctmp);
+    B = gretl_matrix_block_new(&At, n, np,
+			       &rtmp, np, n,
+			       &rnew, n, n,
+			       NULL);
+    if (B == NULL) {
 	return E_ALLOC;
     }
 
+    for (j=0; j<np; j++) {
+	for (i=0; i<n; i++) {
+	    gretl_matrix_set(At, i, j, gretl_matrix_get(A, i, j));
+	}
+    }
+
     for (t=0; t<resp->rows; t++) {
         if (t == 0) {
             /* initial estimated responses */
 	    copy_north_west(rtmp, C, 0);
         } else {
             /* calculate further estimated responses */
-            gretl_matrix_multiply(A, rtmp, ctmp);
-            gretl_matrix_copy_values(rtmp, ctmp);
+            gretl_matrix_multiply(At, rtmp, rnew);
+	    for (j=0; j<n; j++) {
+		col = rtmp->val + j * np;
+		if (nsh > 0) {
+		    memmove(col + n, col, nsh * sizeof *col);
+		}
+		memcpy(col, rnew->val + j * n, n * sizeof *col);
+	    }
         }
         if (resp->cols == 1) {
             resp->val[t] = gretl_matrix_get(rtmp, targ, shock);
@@ -1850,8 +2062,7 @@ static int real_point_responses (const gretl_matrix *A,
         }
     }
 
-    gretl_matrix_free(rtmp);
-    gretl_matrix_free(ctmp);
+    gretl_matrix_block_destroy(B);
 
     return 0;
 }
@@ -1865,7 +2076,6 @@ gretl_matrix *vma_rep (gretl_matrix *A, gretl_matrix *C,
 {
     gretl_matrix *resp = NULL;
     gretl_matrix *realC = C;
-    gretl_matrix *realA = A;
     int neqns, dim;
 
     if (horizon <= 0) {
@@ -1873,9 +2083,17 @@ gretl_matrix *vma_rep (gretl_matrix *A, gretl_matrix *C,
 	return NULL;
     }
 
+    /* the incoming @A should be the top @neqns rows of
+       the companion matrix
+    */
     neqns = A->rows;
     dim = A->cols;
 
+    if (dim % neqns != 0) {
+	*err = E_NONCONF;
+	return NULL;
+    }
+
     if (realC == NULL) {
 	/* manufacture "plain" @C for convenience */
 	realC = gretl_identity_matrix_new(neqns);
@@ -1884,13 +2102,6 @@ gretl_matrix *vma_rep (gretl_matrix *A, gretl_matrix *C,
 	}
     }
 
-    if (!*err && dim > neqns) {
-	/* the incoming @A is just the top @neqns rows
-	   of the companion matrix
-	*/
-	realA = companionize(A, err);
-    }
-
     if (!*err) {
 	int nresp = neqns * neqns;
 
@@ -1901,9 +2112,9 @@ gretl_matrix *vma_rep (gretl_matrix *A, gretl_matrix *C,
 	} else {
 	    if (neqns == 1) {
 		/* "all" means "first" in this case */
-		*err = real_point_responses(realA, realC, resp, 0, 0);
+		*err = real_point_responses(A, realC, resp, 0, 0);
 	    } else {
-		*err = real_point_responses(realA, realC, resp, -1, -1);
+		*err = real_point_responses(A, realC, resp, -1, -1);
 	    }
 	}
     }
@@ -1911,9 +2122,6 @@ gretl_matrix *vma_rep (gretl_matrix *A, gretl_matrix *C,
     if (realC != C) {
 	gretl_matrix_free(realC);
     }
-    if (realA != A) {
-	gretl_matrix_free(realA);
-    }
     if (*err && resp != NULL) {
         gretl_matrix_free(resp);
         resp = NULL;
@@ -2047,164 +2255,193 @@ gretl_VAR_get_impulse_response (GRETL_VAR *var,
     return ret;
 }
 
+/* The forecast error variance at horizon t is the sum over s <= t
+   of Psi_s S Psi_s', where the Psi_s are the (non-orthogonalized)
+   VMA coefficient matrices.
+*/
+
 static gretl_matrix *
 gretl_VAR_get_fcast_se (GRETL_VAR *var, int periods)
 {
-    int k = var->neqns * levels_order(var);
-    gretl_matrix *vtmp = NULL;
-    gretl_matrix *vt = NULL;
+    int n = var->neqns;
+    gretl_matrix *Id = NULL;
+    gretl_matrix *R = NULL;
     gretl_matrix *se = NULL;
-    double vti;
-    int i, t;
+    double x, vti;
+    int i, j, l, t;
+    int err = 0;
 
     if (periods <= 0) {
         fprintf(stderr, "Invalid number of periods\n");
         return NULL;
     }
 
-    se = gretl_zero_matrix_new(periods, var->neqns);
-    vt = gretl_matrix_alloc(k, k);
-    vtmp = gretl_matrix_alloc(k, k);
+    se = gretl_zero_matrix_new(periods, n);
+    Id = gretl_identity_matrix_new(n);
+    R = gretl_matrix_alloc(periods, n * n);
 
-    if (se == NULL || vt == NULL || vtmp == NULL) {
-        gretl_matrix_free(se);
-        gretl_matrix_free(vt);
-        gretl_matrix_free(vtmp);
-        return NULL;
+    if (se == NULL || Id == NULL || R == NULL) {
+        err = E_ALLOC;
+    } else if (n == 1) {
+	err = real_point_responses(var->A, Id, R, 0, 0);
+    } else {
+	err = real_point_responses(var->A, Id, R, -1, -1);
     }
 
-    for (t=0; t<periods; t++) {
-        if (t == 0) {
-            /* initial variance */
-            copy_north_west(vt, var->S, 0);
-        } else {
-            /* calculate further variances */
-            gretl_matrix_copy_values(vtmp, vt);
-            gretl_matrix_qform(var->A, GRETL_MOD_NONE,
-                               vtmp, vt, GRETL_MOD_NONE);
-            copy_north_west(vt, var->S, 1);
-        }
-        for (i=0; i<var->neqns; i++) {
-            vti = gretl_matrix_get(vt, i, i);
-            gretl_matrix_set(se, t, i, sqrt(vti));
+    for (t=0; t<periods && !err; t++) {
+	/* row i of Psi_t is in columns i*n to i*n + n - 1 of R */
+        for (i=0; i<n; i++) {
+	    const double *psi = R->val + i * n * periods + t;
+
+	    vti = 0.0;
+	    for (j=0; j<n; j++) {
+		x = 0.0;
+		for (l=0; l<n; l++) {
+		    x += gretl_matrix_get(var->S, j, l) * psi[l * periods];
+		}
+		vti += psi[j * periods] * x;
+	    }
+	    if (t > 0) {
+		vti += gretl_matrix_get(se, t-1, i);
+	    }
+            gretl_matrix_set(se, t, i, vti);
         }
     }
 
-    gretl_matrix_free(vt);
-    gretl_matrix_free(vtmp);
+    if (!err) {
+	for (i=0; i<periods*n; i++) {
+	    se->val[i] = sqrt(se->val[i]);
+	}
+    }
+
+    gretl_matrix_free(Id);
+    gretl_matrix_free(R);
+
+    if (err) {
+	gretl_matrix_free(se);
+	se = NULL;
+    }
 
     return se;
 }
 
-gretl_matrix *
-gretl_VAR_get_fcast_decomp (const GRETL_VAR *var,
-                            int targ, int periods,
-                            int *err)
+/* Fill out the forecast error variance decomposition @vd for a
+   given target variable, given the responses of that variable to
+   each of the n shocks in columns @c0 to @c0 + n - 1 of @R.
+   The variance at horizon t is the cumulated sum of squared
+   responses up to t.
+*/
+
+static void fcast_decomp_from_responses (const gretl_matrix *R,
+					 int c0, int n,
+					 gretl_matrix *vd)
 {
-    int n = var->neqns;
-    int k = n * levels_order(var);
-    gretl_matrix_block *B;
-    gretl_matrix *idx, *vtmp;
-    gretl_matrix *cic, *vt;
-    gretl_matrix *vd = NULL;
-    gretl_matrix *C = var->C;
+    double rti, vi, vtot;
     int i, t;
 
-    *err = 0;
-
-    if (targ >= n) {
-        fprintf(stderr, "Target variable out of bounds\n");
-        *err = E_DATA;
+    for (t=0; t<vd->rows; t++) {
+	vtot = 0.0;
+	for (i=0; i<n; i++) {
+	    rti = gretl_matrix_get(R, t, c0 + i);
+	    vi = rti * rti;
+	    if (t > 0) {
+		vi += gretl_matrix_get(vd, t-1, i);
+	    }
+	    gretl_matrix_set(vd, t, i, vi);
+	    vtot += vi;
+	}
+	gretl_matrix_set(vd, t, n, vtot);
     }
 
-    if (!*err && periods <= 0) {
-        fprintf(stderr, "Invalid number of periods\n");
-        *err = E_DATA;
+    for (t=0; t<vd->rows; t++) {
+	vtot = gretl_matrix_get(vd, t, n);
+        /* normalize variance contributions as % shares */
+	for (i=0; i<n; i++) {
+	    vi = gretl_matrix_get(vd, t, i);
+	    gretl_matrix_set(vd, t, i, 100.0 * vi / vtot);
+	}
+	gretl_matrix_set(vd, t, n, sqrt(vtot));
     }
+}
 
-    if (!*err && var->ord != NULL) {
-        C = reorder_responses(var, err);
-    }
+/* Compute impulse responses for use in forecast variance
+   decomposition: for all shocks and either one target
+   (@targ >= 0) or all targets.
+*/
 
-    if (*err) {
-	return NULL;
+static gretl_matrix *fcast_decomp_responses (const GRETL_VAR *var,
+					     int targ, int periods,
+					     int *err)
+{
+    gretl_matrix *R = NULL;
+    gretl_matrix *C = var->C;
+    int n = var->neqns;
+
+    if (var->ord != NULL) {
+        C = reorder_responses(var, err);
+	if (*err) {
+	    return NULL;
+	}
     }
 
-    B = gretl_matrix_block_new(&idx, n, n,
-                               &cic, n, n,
-                               &vt,  k, k,
-                               &vtmp, k, k,
-                               NULL);
-    if (B == NULL) {
-        *err = E_ALLOC;
-        goto bailout;
+    R = gretl_matrix_alloc(periods, targ >= 0 ? n : n * n);
+    if (R == NULL) {
+	*err = E_ALLOC;
+    } else {
+	if (n == 1) {
+	    *err = real_point_responses(var->A, C, R, 0, 0);
+	} else {
+	    *err = real_point_responses(var->A, C, R, targ, -1);
+	}
+	if (*err) {
+	    gretl_matrix_free(R);
+	    R = NULL;
+	}
     }
 
-    vd = gretl_zero_matrix_new(periods, n + 1);
-    if (vd == NULL) {
-        *err = E_ALLOC;
-        goto bailout;
+    if (C != var->C) {
+        gretl_matrix_free(C);
     }
 
-    gretl_matrix_zero(idx);
+    return R;
+}
 
-    for (i=0; i<n && !*err; i++) {
-        double vti;
+gretl_matrix *
+gretl_VAR_get_fcast_decomp (const GRETL_VAR *var,
+                            int targ, int periods,
+                            int *err)
+{
+    int n = var->neqns;
+    gretl_matrix *vd = NULL;
+    gretl_matrix *R = NULL;
 
-        /* adjust index matrix */
-        if (i > 0) {
-            gretl_matrix_set(idx, i-1, i-1, 0.0);
-        }
-        gretl_matrix_set(idx, i, i, 1.0);
+    *err = 0;
 
-        for (t=0; t<periods && !*err; t++) {
-            if (t == 0) {
-                /* calculate initial variances */
-                *err = gretl_matrix_qform(C, GRETL_MOD_NONE,
-                                          idx, cic, GRETL_MOD_NONE);
-                copy_north_west(vt, cic, 0);
-            } else {
-                /* calculate further variances */
-                gretl_matrix_copy_values(vtmp, vt);
-                *err = gretl_matrix_qform(var->A, GRETL_MOD_NONE,
-                                          vtmp, vt, GRETL_MOD_NONE);
-                copy_north_west(vt, cic, 1);
-            }
-            if (!*err) {
-                vti = gretl_matrix_get(vt, targ, targ);
-                gretl_matrix_set(vd, t, i, vti);
-            }
-        }
+    if (targ >= n) {
+        fprintf(stderr, "Target variable out of bounds\n");
+        *err = E_DATA;
     }
 
-    for (t=0; t<periods && !*err; t++) {
-        double vi, vtot = 0.0;
-
-        for (i=0; i<n; i++) {
-            vtot += gretl_matrix_get(vd, t, i);
-        }
-        /* normalize variance contributions as % shares */
-        for (i=0; i<n; i++) {
-            vi = gretl_matrix_get(vd, t, i);
-            gretl_matrix_set(vd, t, i, 100.0 * vi / vtot);
-        }
-
-        gretl_matrix_set(vd, t, var->neqns, sqrt(vtot));
+    if (!*err && periods <= 0) {
+        fprintf(stderr, "Invalid number of periods\n");
+        *err = E_DATA;
     }
 
- bailout:
-
-    gretl_matrix_block_destroy(B);
-
-    if (C != var->C) {
-        gretl_matrix_free(C);
+    if (!*err) {
+	R = fcast_decomp_responses(var, targ, periods, err);
     }
 
-    if (*err && vd != NULL) {
-        gretl_matrix_free(vd);
-        vd = NULL;
+    if (!*err) {
+	vd = gretl_matrix_alloc(periods, n + 1);
+	if (vd == NULL) {
+	    *err = E_ALLOC;
+	} else {
+	    fcast_decomp_from_responses(R, 0, n, vd);
+	}
     }
 
+    gretl_matrix_free(R);
+
     return vd;
 }
 
@@ -2215,7 +2452,7 @@ gretl_VAR_get_FEVD_matrix (const GRETL_VAR *var,
                            const DATASET *dset,
                            int *err)
 {
-    gretl_matrix *vd, *V;
+    gretl_matrix *vd, *V, *R;
     double vjk;
     int h = horizon;
     int n = var->neqns;
@@ -2226,6 +2463,12 @@ gretl_VAR_get_FEVD_matrix (const GRETL_VAR *var,
         h = default_VAR_horizon(dset);
     }
 
+    if (targ >= n) {
+        fprintf(stderr, "Target variable out of bounds\n");
+        *err = E_DATA;
+        return NULL;
+    }
+
     if (targ < 0) {
         /* do the whole thing */
         k = n * n;
@@ -2238,27 +2481,37 @@ gretl_VAR_get_FEVD_matrix (const GRETL_VAR *var,
         imax = targ + 1;
     }
 
+    /* the responses are computed once, for all targets wanted */
+    R = fcast_decomp_responses(var, targ, h, err);
+    if (*err) {
+        return NULL;
+    }
+
     V = gretl_matrix_alloc(h, k);
-    if (V == NULL) {
+    vd = gretl_matrix_alloc(h, n + 1);
+    if (V == NULL || vd == NULL) {
+        gretl_matrix_free(R);
+        gretl_matrix_free(V);
+        gretl_matrix_free(vd);
         *err = E_ALLOC;
         return NULL;
     }
 
     kk = 0;
-    for (i=imin; i<imax && !*err; i++) {
-        vd = gretl_VAR_get_fcast_decomp(var, i, h, err);
-        if (!*err) {
-            for (k=0; k<n; k++) {
-                for (j=0; j<h; j++) {
-                    vjk = gretl_matrix_get(vd, j, k);
-                    gretl_matrix_set(V, j, kk, vjk / 100.0);
-                }
-                kk++;
+    for (i=imin; i<imax; i++) {
+        fcast_decomp_from_responses(R, targ < 0 ? i * n : 0, n, vd);
+        for (k=0; k<n; k++) {
+            for (j=0; j<h; j++) {
+                vjk = gretl_matrix_get(vd, j, k);
+                gretl_matrix_set(V, j, kk, vjk / 100.0);
             }
-            gretl_matrix_free(vd);
+            kk++;
         }
     }
 
+    gretl_matrix_free(R);
+    gretl_matrix_free(vd);
+
     /* If @shock is specific, not all, we now proceed to carve
        out the columns of @V that are actually wanted. This is
        not as efficient as it might be -- we're computing more
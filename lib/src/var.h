@@ -106,6 +106,11 @@ gretl_VAR_get_forecast_matrix (GRETL_VAR *var, int t1, int t2,
 			       DATASET *dset, gretlopt opt,
 			       int *err);
 
+gretl_matrix *gretl_VAR_simulate_paths (GRETL_VAR *var, int h,
+					int npaths,
+					const DATASET *dset,
+					int *err);
+
 const gretl_matrix *
 gretl_VAR_get_residual_matrix (const GRETL_VAR *var);
 
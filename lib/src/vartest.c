@@ -724,6 +724,123 @@ static int lagsel_get_min_lag (int p, int *err)
     return m;
 }
 
+/* Lag selection via a single Cholesky decomposition. With the
+   columns of the maximal-order X arranged so that the deterministic
+   and exogenous terms come first, followed by all first lags, then
+   all second lags, and so on, the regressors for order j form the
+   leading block of X. If X'X = LL' and C = L^{-1} X'Y, the residual
+   SSCP for the regression on the first k columns of X is then
+   Y'Y - C_k'C_k, where C_k holds the first k rows of C. So we can
+   get the residual covariance matrices for all orders without
+   re-estimating anything.
+*/
+
+static gretl_matrix *lagsel_cholesky_C (const GRETL_VAR *var, int *err)
+{
+    gretl_matrix *X = NULL;
+    gretl_matrix *XTX = NULL;
+    gretl_matrix *C = NULL;
+    int T = var->T;
+    int n = var->neqns;
+    int p = var->order;
+    int k = var->ncoeff;
+    int ic = var->ifc;
+    size_t csize = T * sizeof(double);
+    double x;
+    int i, j, r, s, col = 0;
+
+    X = gretl_matrix_alloc(T, k);
+    XTX = gretl_matrix_alloc(k, k);
+    C = gretl_matrix_alloc(k, n);
+
+    if (X == NULL || XTX == NULL || C == NULL) {
+	*err = E_ALLOC;
+	goto bailout;
+    }
+
+    /* non-lag columns first */
+    for (j=0; j<k; j++) {
+	if (j < ic || j >= ic + n * p) {
+	    memcpy(X->val + T * col++, var->X->val + T * j, csize);
+	}
+    }
+    /* then the lags, ordered by lag */
+    for (j=0; j<p; j++) {
+	for (i=0; i<n; i++) {
+	    memcpy(X->val + T * col++, var->X->val + T * (ic + i*p + j),
+		   csize);
+	}
+    }
+
+    gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+			      X, GRETL_MOD_NONE,
+			      XTX, GRETL_MOD_NONE);
+    gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+			      var->Y, GRETL_MOD_NONE,
+			      C, GRETL_MOD_NONE);
+
+    *err = gretl_matrix_cholesky_decomp(XTX);
+
+    if (!*err) {
+	/* forward substitution: C = L^{-1} X'Y */
+	for (i=0; i<n; i++) {
+	    for (r=0; r<k; r++) {
+		x = gretl_matrix_get(C, r, i);
+		for (s=0; s<r; s++) {
+		    x -= gretl_matrix_get(XTX, r, s) * gretl_matrix_get(C, s, i);
+		}
+		gretl_matrix_set(C, r, i, x / gretl_matrix_get(XTX, r, r));
+	    }
+	}
+    }
+
+ bailout:
+
+    gretl_matrix_free(X);
+    gretl_matrix_free(XTX);
+
+    if (*err) {
+	gretl_matrix_free(C);
+	C = NULL;
+    }
+
+    return C;
+}
+
+/* Subtract from @S the contributions of rows *pr to @k - 1 of @C,
+   so that @S becomes the residual SSCP for the regression on the
+   first @k columns of the reordered X, and return the log-determinant
+   of the corresponding covariance matrix.
+*/
+
+static double lagsel_cholesky_ldet (const gretl_matrix *C,
+				    gretl_matrix *S,
+				    gretl_matrix *Sj,
+				    int *pr, int k, int T,
+				    int *err)
+{
+    int n = S->rows;
+    double x;
+    int i, j, r;
+
+    for (r=*pr; r<k; r++) {
+	for (i=0; i<n; i++) {
+	    for (j=0; j<=i; j++) {
+		x = gretl_matrix_get(S, i, j);
+		x -= gretl_matrix_get(C, r, i) * gretl_matrix_get(C, r, j);
+		gretl_matrix_set(S, i, j, x);
+		gretl_matrix_set(S, j, i, x);
+	    }
+	}
+    }
+    *pr = k;
+
+    gretl_matrix_copy_values(Sj, S);
+    gretl_matrix_divide_by_scalar(Sj, T);
+
+    return gretl_vcv_log_determinant(Sj, err);
+}
+
 /* apparatus for selecting the optimal lag length for a VAR */
 
 int VAR_do_lagsel (GRETL_VAR *var, const DATASET *dset,
@@ -732,6 +849,9 @@ int VAR_do_lagsel (GRETL_VAR *var, const DATASET *dset,
 {
     gretl_matrix *selmat = NULL;
     gretl_matrix *E = NULL;
+    gretl_matrix *C = NULL;
+    gretl_matrix *S = NULL;
+    gretl_matrix *Sj = NULL;
     int p = var->order;
     int r = p - 1;
     int T = var->T;
@@ -744,7 +864,7 @@ int VAR_do_lagsel (GRETL_VAR *var, const DATASET *dset,
     int cols0, minlag = 1;
     int nrows, ncols;
     int use_QR = 0;
-    int j, m = 0;
+    int j, crow = 0, m = 0;
     int err = 0;
 
     /* number of cols in X that are not Y lags */
@@ -775,12 +895,30 @@ int VAR_do_lagsel (GRETL_VAR *var, const DATASET *dset,
 
     if (getenv("VAR_USE_QR") != NULL) {
 	use_QR = 1;
+    } else if (var->lags == NULL) {
+	int cerr = 0;
+
+	C = lagsel_cholesky_C(var, &cerr);
+	if (C != NULL) {
+	    S = gretl_matrix_alloc(n, n);
+	    Sj = gretl_matrix_alloc(n, n);
+	    if (S == NULL || Sj == NULL) {
+		err = E_ALLOC;
+		goto bailout;
+	    }
+	    gretl_matrix_multiply_mod(var->Y, GRETL_MOD_TRANSPOSE,
+				      var->Y, GRETL_MOD_NONE,
+				      S, GRETL_MOD_NONE);
+	}
+	/* otherwise fall back on estimation order by order */
     }
 
     for (j=minlag; j<p && !err; j++) {
 	int jxcols = cols0 + j * n;
 
-	if (jxcols == 0) {
+	if (C != NULL) {
+	    ldet = lagsel_cholesky_ldet(C, S, Sj, &crow, jxcols, T, &err);
+	} else if (jxcols == 0) {
 	    gretl_matrix_copy_values(E, var->Y);
 	} else {
 	    VAR_fill_X(var, j, dset);
@@ -795,7 +933,7 @@ int VAR_do_lagsel (GRETL_VAR *var, const DATASET *dset,
 	    }
 	}
 
-	if (!err) {
+	if (!err && C == NULL) {
 	    ldet = gretl_VAR_ldet(var, E, &err);
 	}
 
@@ -868,6 +1006,9 @@ int VAR_do_lagsel (GRETL_VAR *var, const DATASET *dset,
 
     gretl_matrix_free(selmat);
     gretl_matrix_free(E);
+    gretl_matrix_free(C);
+    gretl_matrix_free(S);
+    gretl_matrix_free(Sj);
 
     return err;
 }
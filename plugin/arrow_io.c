@@ -0,0 +1,1437 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Reading and writing of columnar data in the Apache Parquet
+   and Arrow IPC ("feather" version 2) formats, via the GLib
+   bindings for the Arrow C++ libraries.
+*/
+
+#include "libgretl.h"
+#include "gretl_string_table.h"
+#include "csvdata.h"
+#include "gretl_mt.h"
+
+#include <arrow-glib/arrow-glib.h>
+#include <parquet-glib/parquet-glib.h>
+
+#define ADEBUG 0
+
+/* types of column, from gretl's point of view */
+
+enum {
+    COL_UNSUPPORTED,
+    COL_NUMERIC,
+    COL_DATE,
+    COL_STRING
+};
+
+/* comparisons available in a row filter */
+
+typedef enum {
+    PRED_LT,
+    PRED_LE,
+    PRED_GT,
+    PRED_GE,
+    PRED_EQ,
+    PRED_NE
+} PredOp;
+
+typedef struct arrow_pred_ arrow_pred;
+typedef struct col_strings_ col_strings;
+
+/* one term in a row filter of the form "x > 0 && y != 2" */
+
+struct arrow_pred_ {
+    int field;     /* index of the column in the file's schema */
+    int kind;      /* COL_NUMERIC or COL_DATE */
+    PredOp op;     /* the comparison */
+    double val;    /* the value to compare against */
+};
+
+/* accumulator for the distinct values of a string column */
+
+struct col_strings_ {
+    GHashTable *ht; /* value -> 1-based code */
+    char **S;       /* the values, in order of appearance */
+    int ns;         /* the number of values */
+};
+
+/* the Unix epoch (the origin for Arrow dates) as a gretl
+   epoch day */
+static guint32 unix_epoch_day;
+
+static int arrow_error (GError *gerr, PRN *prn)
+{
+    if (gerr != NULL) {
+	gretl_errmsg_set(gerr->message);
+	pprintf(prn, "arrow: %s\n", gerr->message);
+	g_error_free(gerr);
+    }
+
+    return E_DATA;
+}
+
+static int data_type_kind (GArrowDataType *dt)
+{
+    if (GARROW_IS_DOUBLE_DATA_TYPE(dt) ||
+	GARROW_IS_FLOAT_DATA_TYPE(dt) ||
+	GARROW_IS_INT8_DATA_TYPE(dt) ||
+	GARROW_IS_INT16_DATA_TYPE(dt) ||
+	GARROW_IS_INT32_DATA_TYPE(dt) ||
+	GARROW_IS_INT64_DATA_TYPE(dt) ||
+	GARROW_IS_UINT8_DATA_TYPE(dt) ||
+	GARROW_IS_UINT16_DATA_TYPE(dt) ||
+	GARROW_IS_UINT32_DATA_TYPE(dt) ||
+	GARROW_IS_UINT64_DATA_TYPE(dt) ||
+	GARROW_IS_BOOLEAN_DATA_TYPE(dt)) {
+	return COL_NUMERIC;
+    } else if (GARROW_IS_DATE32_DATA_TYPE(dt)) {
+	return COL_DATE;
+    } else if (GARROW_IS_STRING_DATA_TYPE(dt) ||
+	       GARROW_IS_LARGE_STRING_DATA_TYPE(dt)) {
+	return COL_STRING;
+    } else if (GARROW_IS_DICTIONARY_DATA_TYPE(dt)) {
+	GArrowDictionaryDataType *ddt = GARROW_DICTIONARY_DATA_TYPE(dt);
+	GArrowDataType *vt;
+	int ret;
+
+	vt = garrow_dictionary_data_type_get_value_data_type(ddt);
+	ret = GARROW_IS_STRING_DATA_TYPE(vt) ? COL_STRING : COL_UNSUPPORTED;
+	g_object_unref(vt);
+	return ret;
+    } else {
+	return COL_UNSUPPORTED;
+    }
+}
+
+static int schema_field_kind (GArrowSchema *schema, int i)
+{
+    GArrowField *field = garrow_schema_get_field(schema, i);
+    GArrowDataType *dt = garrow_field_get_data_type(field);
+    int ret = data_type_kind(dt);
+
+    g_object_unref(dt);
+    g_object_unref(field);
+
+    return ret;
+}
+
+static gchar *schema_field_name (GArrowSchema *schema, int i)
+{
+    GArrowField *field = garrow_schema_get_field(schema, i);
+    gchar *ret = g_strdup(garrow_field_get_name(field));
+
+    g_object_unref(field);
+
+    return ret;
+}
+
+/* Get the value at row @i of integer-type array @a as a double
+   (also serving for the indices of a dictionary array). */
+
+static double integer_array_value (GArrowArray *a, gint64 i)
+{
+    if (GARROW_IS_INT32_ARRAY(a)) {
+	return garrow_int32_array_get_value(GARROW_INT32_ARRAY(a), i);
+    } else if (GARROW_IS_INT64_ARRAY(a)) {
+	return (double) garrow_int64_array_get_value(GARROW_INT64_ARRAY(a), i);
+    } else if (GARROW_IS_INT16_ARRAY(a)) {
+	return garrow_int16_array_get_value(GARROW_INT16_ARRAY(a), i);
+    } else if (GARROW_IS_INT8_ARRAY(a)) {
+	return garrow_int8_array_get_value(GARROW_INT8_ARRAY(a), i);
+    } else if (GARROW_IS_UINT8_ARRAY(a)) {
+	return garrow_uint8_array_get_value(GARROW_UINT8_ARRAY(a), i);
+    } else if (GARROW_IS_UINT16_ARRAY(a)) {
+	return garrow_uint16_array_get_value(GARROW_UINT16_ARRAY(a), i);
+    } else if (GARROW_IS_UINT32_ARRAY(a)) {
+	return garrow_uint32_array_get_value(GARROW_UINT32_ARRAY(a), i);
+    } else if (GARROW_IS_UINT64_ARRAY(a)) {
+	return (double) garrow_uint64_array_get_value(GARROW_UINT64_ARRAY(a), i);
+    } else if (GARROW_IS_BOOLEAN_ARRAY(a)) {
+	return garrow_boolean_array_get_value(GARROW_BOOLEAN_ARRAY(a), i);
+    } else {
+	return NADBL;
+    }
+}
+
+static inline double date32_to_ymd (gint32 d)
+{
+    int err = 0;
+
+    return ymd_basic_from_epoch_day(unix_epoch_day + d, 0, &err);
+}
+
+/* Return the 1-based code for string @s in column @cs, adding
+   @s to the column's values if it's not already present. */
+
+static double col_strings_code (col_strings *cs, const char *s)
+{
+    gpointer p;
+
+    if (s == NULL || *s == '\0') {
+	return NADBL;
+    }
+
+    p = g_hash_table_lookup(cs->ht, s);
+    if (p == NULL) {
+	if (strings_array_add(&cs->S, &cs->ns, s)) {
+	    return NADBL;
+	}
+	p = GINT_TO_POINTER(cs->ns);
+	g_hash_table_insert(cs->ht, cs->S[cs->ns-1], p);
+    }
+
+    return (double) GPOINTER_TO_INT(p);
+}
+
+static gchar *string_array_value (GArrowArray *a, gint64 i)
+{
+    if (GARROW_IS_LARGE_STRING_ARRAY(a)) {
+	return garrow_large_string_array_get_string(GARROW_LARGE_STRING_ARRAY(a), i);
+    } else {
+	return garrow_string_array_get_string(GARROW_STRING_ARRAY(a), i);
+    }
+}
+
+/* Transcribe the values of string-type array @a into @x, as codes
+   into @cs, skipping rows for which @mask is 0 (if @mask is
+   non-NULL). A dictionary array has its dictionary mapped onto
+   @cs first.
+*/
+
+static gint64 string_array_to_codes (GArrowArray *a, double *x,
+				     const char *mask,
+				     col_strings *cs)
+{
+    gint64 i, n = garrow_array_get_length(a);
+    gint64 m = 0;
+    gchar *s;
+
+    if (GARROW_IS_DICTIONARY_ARRAY(a)) {
+	GArrowDictionaryArray *da = GARROW_DICTIONARY_ARRAY(a);
+	GArrowArray *idx = garrow_dictionary_array_get_indices(da);
+	GArrowArray *dict = garrow_dictionary_array_get_dictionary(da);
+	gint64 k, nd = garrow_array_get_length(dict);
+	double *map = malloc(nd * sizeof *map);
+
+	if (map != NULL) {
+	    for (k=0; k<nd; k++) {
+		s = string_array_value(dict, k);
+		map[k] = col_strings_code(cs, s);
+		g_free(s);
+	    }
+	    for (i=0; i<n; i++) {
+		if (mask == NULL || mask[i]) {
+		    if (garrow_array_is_null(a, i)) {
+			x[m++] = NADBL;
+		    } else {
+			k = (gint64) integer_array_value(idx, i);
+			x[m++] = (k >= 0 && k < nd) ? map[k] : NADBL;
+		    }
+		}
+	    }
+	    free(map);
+	}
+	g_object_unref(idx);
+	g_object_unref(dict);
+    } else {
+	for (i=0; i<n; i++) {
+	    if (mask == NULL || mask[i]) {
+		if (garrow_array_is_null(a, i)) {
+		    x[m++] = NADBL;
+		} else {
+		    s = string_array_value(a, i);
+		    x[m++] = col_strings_code(cs, s);
+		    g_free(s);
+		}
+	    }
+	}
+    }
+
+    return m;
+}
+
+#define transcribe_values(atype, ctype, a) \
+    do {							\
+	gint64 len;						\
+	const ctype *v = garrow_##atype##_array_get_values(a, &len); \
+	for (i=0; i<n; i++) {					\
+	    if (mask == NULL || mask[i]) {			\
+		x[m++] = (nulls && garrow_array_is_null(arr, i)) ? \
+		    NADBL : (double) v[i];			\
+	    }							\
+	}							\
+    } while (0)
+
+/* Transcribe the values of numeric or date array @arr into @x,
+   skipping rows for which @mask is 0. Returns the number of
+   values written. */
+
+static gint64 numeric_array_to_doubles (GArrowArray *arr, double *x,
+					const char *mask)
+{
+    gint64 i, n = garrow_array_get_length(arr);
+    int nulls = garrow_array_get_n_nulls(arr) > 0;
+    gint64 m = 0;
+
+    if (GARROW_IS_DOUBLE_ARRAY(arr)) {
+	transcribe_values(double, gdouble, GARROW_DOUBLE_ARRAY(arr));
+    } else if (GARROW_IS_FLOAT_ARRAY(arr)) {
+	transcribe_values(float, gfloat, GARROW_FLOAT_ARRAY(arr));
+    } else if (GARROW_IS_INT32_ARRAY(arr)) {
+	transcribe_values(int32, gint32, GARROW_INT32_ARRAY(arr));
+    } else if (GARROW_IS_INT64_ARRAY(arr)) {
+	transcribe_values(int64, gint64, GARROW_INT64_ARRAY(arr));
+    } else if (GARROW_IS_INT16_ARRAY(arr)) {
+	transcribe_values(int16, gint16, GARROW_INT16_ARRAY(arr));
+    } else if (GARROW_IS_INT8_ARRAY(arr)) {
+	transcribe_values(int8, gint8, GARROW_INT8_ARRAY(arr));
+    } else if (GARROW_IS_UINT8_ARRAY(arr)) {
+	transcribe_values(uint8, guint8, GARROW_UINT8_ARRAY(arr));
+    } else if (GARROW_IS_UINT16_ARRAY(arr)) {
+	transcribe_values(uint16, guint16, GARROW_UINT16_ARRAY(arr));
+    } else if (GARROW_IS_UINT32_ARRAY(arr)) {
+	transcribe_values(uint32, guint32, GARROW_UINT32_ARRAY(arr));
+    } else if (GARROW_IS_UINT64_ARRAY(arr)) {
+	transcribe_values(uint64, guint64, GARROW_UINT64_ARRAY(arr));
+    } else if (GARROW_IS_DATE32_ARRAY(arr)) {
+	GArrowDate32Array *da = GARROW_DATE32_ARRAY(arr);
+
+	for (i=0; i<n; i++) {
+	    if (mask == NULL || mask[i]) {
+		x[m++] = (nulls && garrow_array_is_null(arr, i)) ? NADBL :
+		    date32_to_ymd(garrow_date32_array_get_value(da, i));
+	    }
+	}
+    } else {
+	/* boolean */
+	for (i=0; i<n; i++) {
+	    if (mask == NULL || mask[i]) {
+		x[m++] = (nulls && garrow_array_is_null(arr, i)) ? NADBL :
+		    integer_array_value(arr, i);
+	    }
+	}
+    }
+
+    /* NaNs are missing values for gretl */
+    for (i=0; i<m; i++) {
+	if (isnan(x[i])) {
+	    x[i] = NADBL;
+	}
+    }
+
+    return m;
+}
+
+/* Transcribe the (possibly chunked) column @ca into @x, skipping
+   rows for which @mask is 0. Returns the number of rows written. */
+
+static gint64 column_to_doubles (GArrowChunkedArray *ca, int kind,
+				 double *x, const char *mask,
+				 col_strings *cs)
+{
+    guint i, nc = garrow_chunked_array_get_n_chunks(ca);
+    gint64 m = 0;
+
+    for (i=0; i<nc; i++) {
+	GArrowArray *a = garrow_chunked_array_get_chunk(ca, i);
+
+	if (kind == COL_STRING) {
+	    m += string_array_to_codes(a, x + m, mask, cs);
+	} else {
+	    m += numeric_array_to_doubles(a, x + m, mask);
+	}
+	if (mask != NULL) {
+	    mask += garrow_array_get_length(a);
+	}
+	g_object_unref(a);
+    }
+
+    return m;
+}
+
+static GArrowChunkedArray *table_column_by_name (GArrowTable *table,
+						 const char *name)
+{
+    GArrowSchema *schema = garrow_table_get_schema(table);
+    gint i = garrow_schema_get_field_index(schema, name);
+
+    g_object_unref(schema);
+
+    return i < 0 ? NULL : garrow_table_get_column_data(table, i);
+}
+
+/* Parsing and evaluation of row filters */
+
+static int parse_pred_op (const char **ps, PredOp *op)
+{
+    const char *s = *ps;
+    int err = 0;
+
+    if (!strncmp(s, "<=", 2)) {
+	*op = PRED_LE;
+	s += 2;
+    } else if (!strncmp(s, ">=", 2)) {
+	*op = PRED_GE;
+	s += 2;
+    } else if (!strncmp(s, "==", 2)) {
+	*op = PRED_EQ;
+	s += 2;
+    } else if (!strncmp(s, "!=", 2)) {
+	*op = PRED_NE;
+	s += 2;
+    } else if (*s == '<') {
+	*op = PRED_LT;
+	s++;
+    } else if (*s == '>') {
+	*op = PRED_GT;
+	s++;
+    } else if (*s == '=') {
+	*op = PRED_EQ;
+	s++;
+    } else {
+	err = E_PARSE;
+    }
+
+    *ps = s;
+
+    return err;
+}
+
+/* Parse a filter of the form "term && term ...", where each term
+   takes the form "name op value", with op one of the comparison
+   operators and value numeric. The columns named must be numeric
+   or dates; in the latter case @value should be given in the
+   ISO 8601 basic form YYYYMMDD. */
+
+static arrow_pred *parse_row_filter (const char *s,
+				     GArrowSchema *schema,
+				     int *npred, int *err)
+{
+    arrow_pred *preds = NULL;
+    char name[VNAMELEN*2];
+    int n = 0;
+
+    while (*s && !*err) {
+	arrow_pred *tmp;
+	char *endp;
+	int len;
+
+	s += strspn(s, " ");
+	len = strcspn(s, "<>=! ");
+	if (len == 0 || len >= (int) sizeof name) {
+	    *err = E_PARSE;
+	    break;
+	}
+	*name = '\0';
+	strncat(name, s, len);
+	s += len;
+	s += strspn(s, " ");
+
+	tmp = realloc(preds, (n + 1) * sizeof *preds);
+	if (tmp == NULL) {
+	    *err = E_ALLOC;
+	    break;
+	}
+	preds = tmp;
+
+	preds[n].field = garrow_schema_get_field_index(schema, name);
+	if (preds[n].field < 0) {
+	    gretl_errmsg_sprintf(_("Column '%s' not found"), name);
+	    *err = E_DATA;
+	    break;
+	}
+	preds[n].kind = schema_field_kind(schema, preds[n].field);
+	if (preds[n].kind != COL_NUMERIC && preds[n].kind != COL_DATE) {
+	    gretl_errmsg_sprintf("filter: column '%s' is not numeric", name);
+	    *err = E_TYPES;
+	    break;
+	}
+
+	*err = parse_pred_op(&s, &preds[n].op);
+	if (!*err) {
+	    preds[n].val = g_ascii_strtod(s, &endp);
+	    if (endp == s) {
+		*err = E_PARSE;
+	    } else {
+		s = endp;
+	    }
+	}
+	n++;
+
+	s += strspn(s, " ");
+	if (!strncmp(s, "&&", 2)) {
+	    s += 2;
+	} else if (*s != '\0') {
+	    *err = E_PARSE;
+	}
+    }
+
+    if (!*err && n == 0) {
+	*err = E_PARSE;
+    }
+
+    if (*err) {
+	if (*err == E_PARSE) {
+	    gretl_errmsg_sprintf(_("Invalid option '--%s'"), "filter");
+	}
+	free(preds);
+	preds = NULL;
+    } else {
+	*npred = n;
+    }
+
+    return preds;
+}
+
+static int pred_holds (const arrow_pred *p, double x)
+{
+    if (na(x)) {
+	return 0;
+    }
+
+    switch (p->op) {
+    case PRED_LT: return x < p->val;
+    case PRED_LE: return x <= p->val;
+    case PRED_GT: return x > p->val;
+    case PRED_GE: return x >= p->val;
+    case PRED_EQ: return x == p->val;
+    case PRED_NE: return x != p->val;
+    }
+
+    return 0;
+}
+
+/* Can any value in the range [@vmin, @vmax] satisfy @p? */
+
+static int pred_may_hold (const arrow_pred *p, double vmin, double vmax)
+{
+    switch (p->op) {
+    case PRED_LT: return vmin < p->val;
+    case PRED_LE: return vmin <= p->val;
+    case PRED_GT: return vmax > p->val;
+    case PRED_GE: return vmax >= p->val;
+    case PRED_EQ: return vmin <= p->val && vmax >= p->val;
+    case PRED_NE: return !(vmin == p->val && vmax == p->val);
+    }
+
+    return 1;
+}
+
+/* Get the min and max recorded in Parquet column-chunk statistics,
+   if available. */
+
+static int get_stats_range (GParquetStatistics *st,
+			    double *vmin, double *vmax)
+{
+    if (!gparquet_statistics_has_min_max(st)) {
+	return 0;
+    } else if (GPARQUET_IS_DOUBLE_STATISTICS(st)) {
+	*vmin = gparquet_double_statistics_get_min(GPARQUET_DOUBLE_STATISTICS(st));
+	*vmax = gparquet_double_statistics_get_max(GPARQUET_DOUBLE_STATISTICS(st));
+    } else if (GPARQUET_IS_FLOAT_STATISTICS(st)) {
+	*vmin = gparquet_float_statistics_get_min(GPARQUET_FLOAT_STATISTICS(st));
+	*vmax = gparquet_float_statistics_get_max(GPARQUET_FLOAT_STATISTICS(st));
+    } else if (GPARQUET_IS_INT32_STATISTICS(st)) {
+	*vmin = gparquet_int32_statistics_get_min(GPARQUET_INT32_STATISTICS(st));
+	*vmax = gparquet_int32_statistics_get_max(GPARQUET_INT32_STATISTICS(st));
+    } else if (GPARQUET_IS_INT64_STATISTICS(st)) {
+	*vmin = gparquet_int64_statistics_get_min(GPARQUET_INT64_STATISTICS(st));
+	*vmax = gparquet_int64_statistics_get_max(GPARQUET_INT64_STATISTICS(st));
+    } else {
+	return 0;
+    }
+
+    return !isnan(*vmin) && !isnan(*vmax);
+}
+
+/* Use the statistics stored for row group @rg to determine whether
+   it can be skipped altogether: that's the case if any term of the
+   (conjunctive) filter cannot be satisfied by any row. This relies
+   on a flat schema, in which Parquet leaf columns correspond one to
+   one with the fields of the Arrow schema. */
+
+static int row_group_excluded (GParquetFileMetadata *meta, int rg,
+			       const arrow_pred *preds, int npred)
+{
+    GParquetRowGroupMetadata *rgm;
+    int j, ret = 0;
+
+    rgm = gparquet_file_metadata_get_row_group(meta, rg, NULL);
+    if (rgm == NULL) {
+	return 0;
+    }
+
+    for (j=0; j<npred && !ret; j++) {
+	GParquetColumnChunkMetadata *cm;
+	GParquetStatistics *st;
+	double vmin, vmax;
+
+	if (preds[j].kind != COL_NUMERIC) {
+	    /* dates are stored as days, not YYYYMMDD */
+	    continue;
+	}
+	cm = gparquet_row_group_metadata_get_column_chunk(rgm, preds[j].field,
+							  NULL);
+	if (cm == NULL) {
+	    continue;
+	}
+	st = gparquet_column_chunk_metadata_get_statistics(cm);
+	if (st != NULL) {
+	    if (get_stats_range(st, &vmin, &vmax) &&
+		!pred_may_hold(&preds[j], vmin, vmax)) {
+		ret = 1;
+	    }
+	    g_object_unref(st);
+	}
+	g_object_unref(cm);
+    }
+
+    g_object_unref(rgm);
+
+    return ret;
+}
+
+/* Construct the mask of rows in @table that pass the filter,
+   recording the number that do so in @nkeep. If all rows
+   pass, the mask is not needed and NULL is returned. */
+
+static char *table_row_mask (GArrowTable *table, GArrowSchema *schema,
+			     const arrow_pred *preds, int npred,
+			     gint64 *nkeep, int *err)
+{
+    gint64 t, n = garrow_table_get_n_rows(table);
+    char *mask = NULL;
+    double *x = NULL;
+    int j;
+
+    *nkeep = n;
+    if (npred == 0 || n == 0) {
+	return NULL;
+    }
+
+    mask = malloc(n);
+    x = malloc(n * sizeof *x);
+    if (mask == NULL || x == NULL) {
+	*err = E_ALLOC;
+	goto bailout;
+    }
+
+    memset(mask, 1, n);
+
+    for (j=0; j<npred; j++) {
+	gchar *name = schema_field_name(schema, preds[j].field);
+	GArrowChunkedArray *ca = table_column_by_name(table, name);
+
+	g_free(name);
+	if (ca == NULL) {
+	    *err = E_DATA;
+	    goto bailout;
+	}
+	column_to_doubles(ca, preds[j].kind, x, NULL, NULL);
+	g_object_unref(ca);
+	for (t=0; t<n; t++) {
+	    if (mask[t] && !pred_holds(&preds[j], x[t])) {
+		mask[t] = 0;
+	    }
+	}
+    }
+
+    *nkeep = 0;
+    for (t=0; t<n; t++) {
+	*nkeep += mask[t];
+    }
+
+ bailout:
+
+    free(x);
+    if (*err) {
+	free(mask);
+	mask = NULL;
+    }
+
+    return mask;
+}
+
+/* Determine which fields of @schema to import, based on
+   selection by name (@S) or by 1-based index (@cols), or all
+   importable fields if neither is given. */
+
+static int *select_fields (GArrowSchema *schema, char **S, int ns,
+			   const int *cols, PRN *prn, int *err)
+{
+    int i, k, nf = garrow_schema_n_fields(schema);
+    int *list = NULL;
+
+    if (S != NULL) {
+	list = gretl_list_new(ns);
+	for (i=0; i<ns && !*err; i++) {
+	    list[i+1] = garrow_schema_get_field_index(schema, S[i]);
+	    if (list[i+1] < 0) {
+		gretl_errmsg_sprintf(_("Column '%s' not found"), S[i]);
+		*err = E_DATA;
+	    }
+	}
+    } else if (cols != NULL) {
+	list = gretl_list_new(cols[0]);
+	for (i=1; i<=cols[0] && !*err; i++) {
+	    if (cols[i] < 1 || cols[i] > nf) {
+		gretl_errmsg_sprintf(_("Column %d not found"), cols[i]);
+		*err = E_DATA;
+	    } else {
+		list[i] = cols[i] - 1;
+	    }
+	}
+    } else {
+	list = gretl_null_list();
+	for (i=0; i<nf && list != NULL; i++) {
+	    if (schema_field_kind(schema, i) != COL_UNSUPPORTED) {
+		list = gretl_list_append_term(&list, i);
+	    } else {
+		gchar *name = schema_field_name(schema, i);
+
+		pprintf(prn, "arrow: skipping column '%s' (unsupported type)\n",
+			name);
+		g_free(name);
+	    }
+	}
+    }
+
+    if (list == NULL && !*err) {
+	*err = E_ALLOC;
+    }
+
+    for (i=1; i<=list[0] && !*err; i++) {
+	k = list[i];
+	if (schema_field_kind(schema, k) == COL_UNSUPPORTED) {
+	    gchar *name = schema_field_name(schema, k);
+
+	    gretl_errmsg_sprintf("arrow: column '%s' is of unsupported type",
+				 name);
+	    g_free(name);
+	    *err = E_DATA;
+	}
+    }
+
+    if (!*err && list[0] == 0) {
+	gretl_errmsg_set(_("No data were found"));
+	*err = E_DATA;
+    }
+
+    if (*err) {
+	free(list);
+	list = NULL;
+    }
+
+    return list;
+}
+
+/* Read the Parquet file @fname into an array of tables, one per
+   row group that survives filtering via @preds, projected onto
+   the fields in @flist plus those referenced by @preds. */
+
+static GPtrArray *read_parquet_tables (const char *fname,
+				       GArrowSchema **pschema,
+				       char **S, int ns,
+				       const int *cols,
+				       const char *filter,
+				       int **pflist,
+				       arrow_pred **ppreds,
+				       int *npred,
+				       PRN *prn, int *err)
+{
+    GParquetArrowFileReader *reader;
+    GParquetFileMetadata *meta = NULL;
+    GArrowSchema *schema;
+    GPtrArray *tables = NULL;
+    GError *gerr = NULL;
+    gint *idx = NULL;
+    int *flist = NULL;
+    arrow_pred *preds = NULL;
+    int i, j, rg, nrg, nidx = 0;
+    int skipped = 0;
+
+    reader = gparquet_arrow_file_reader_new_path(fname, &gerr);
+    if (reader == NULL) {
+	*err = arrow_error(gerr, prn);
+	return NULL;
+    }
+
+    /* let Arrow decode the column chunks in parallel */
+    gparquet_arrow_file_reader_set_use_threads(reader, TRUE);
+
+    schema = gparquet_arrow_file_reader_get_schema(reader, &gerr);
+    if (schema == NULL) {
+	*err = arrow_error(gerr, prn);
+	g_object_unref(reader);
+	return NULL;
+    }
+
+    flist = select_fields(schema, S, ns, cols, prn, err);
+    if (!*err && filter != NULL) {
+	preds = parse_row_filter(filter, schema, npred, err);
+    }
+
+    if (!*err) {
+	/* the columns to read: those selected plus those needed
+	   for filtering */
+	idx = malloc((flist[0] + *npred) * sizeof *idx);
+	if (idx == NULL) {
+	    *err = E_ALLOC;
+	} else {
+	    for (i=1; i<=flist[0]; i++) {
+		idx[nidx++] = flist[i];
+	    }
+	    for (j=0; j<*npred; j++) {
+		if (!in_gretl_list(flist, preds[j].field)) {
+		    idx[nidx++] = preds[j].field;
+		}
+	    }
+	}
+    }
+
+    if (!*err && *npred > 0) {
+	meta = gparquet_arrow_file_reader_get_metadata(reader);
+	if (meta != NULL &&
+	    gparquet_file_metadata_get_n_columns(meta) !=
+	    (gint) garrow_schema_n_fields(schema)) {
+	    /* not a flat schema: don't try to use statistics */
+	    g_object_unref(meta);
+	    meta = NULL;
+	}
+    }
+
+    if (!*err) {
+	tables = g_ptr_array_new_with_free_func(g_object_unref);
+	nrg = gparquet_arrow_file_reader_get_n_row_groups(reader);
+	for (rg=0; rg<nrg && !*err; rg++) {
+	    GArrowTable *table;
+
+	    if (meta != NULL && row_group_excluded(meta, rg, preds, *npred)) {
+		skipped++;
+		continue;
+	    }
+	    table = gparquet_arrow_file_reader_read_row_group(reader, rg, idx,
+							      nidx, &gerr);
+	    if (table == NULL) {
+		*err = arrow_error(gerr, prn);
+	    } else {
+		g_ptr_array_add(tables, table);
+	    }
+	}
+	if (skipped > 0) {
+	    pprintf(prn, "arrow: skipped %d of %d row groups based on "
+		    "statistics\n", skipped, nrg);
+	}
+    }
+
+    if (meta != NULL) {
+	g_object_unref(meta);
+    }
+    g_object_unref(reader);
+    free(idx);
+
+    if (*err) {
+	if (tables != NULL) {
+	    g_ptr_array_free(tables, TRUE);
+	    tables = NULL;
+	}
+	g_object_unref(schema);
+	free(flist);
+	free(preds);
+    } else {
+	*pschema = schema;
+	*pflist = flist;
+	*ppreds = preds;
+    }
+
+    return tables;
+}
+
+/* Read the Arrow IPC file @fname into an array of tables, one
+   per record batch. The IPC format carries no statistics, so
+   filtering is done row by row, later. */
+
+static GPtrArray *read_ipc_tables (const char *fname,
+				   GArrowSchema **pschema,
+				   char **S, int ns,
+				   const int *cols,
+				   const char *filter,
+				   int **pflist,
+				   arrow_pred **ppreds,
+				   int *npred,
+				   PRN *prn, int *err)
+{
+    GArrowMemoryMappedInputStream *input;
+    GArrowRecordBatchFileReader *reader = NULL;
+    GArrowSchema *schema = NULL;
+    GPtrArray *tables = NULL;
+    GError *gerr = NULL;
+    int *flist = NULL;
+    arrow_pred *preds = NULL;
+    guint i, nb;
+
+    input = garrow_memory_mapped_input_stream_new(fname, &gerr);
+    if (input != NULL) {
+	reader = garrow_record_batch_file_reader_new(GARROW_SEEKABLE_INPUT_STREAM(input),
+						     &gerr);
+    }
+    if (reader == NULL) {
+	*err = arrow_error(gerr, prn);
+	goto bailout;
+    }
+
+    schema = garrow_record_batch_file_reader_get_schema(reader);
+    flist = select_fields(schema, S, ns, cols, prn, err);
+    if (!*err && filter != NULL) {
+	preds = parse_row_filter(filter, schema, npred, err);
+    }
+
+    if (!*err) {
+	tables = g_ptr_array_new_with_free_func(g_object_unref);
+	nb = garrow_record_batch_file_reader_get_n_record_batches(reader);
+	for (i=0; i<nb && !*err; i++) {
+	    GArrowRecordBatch *batch;
+	    GArrowTable *table = NULL;
+
+	    batch = garrow_record_batch_file_reader_read_record_batch(reader, i,
+								      &gerr);
+	    if (batch != NULL) {
+		table = garrow_table_new_record_batches(schema, &batch, 1, &gerr);
+		g_object_unref(batch);
+	    }
+	    if (table == NULL) {
+		*err = arrow_error(gerr, prn);
+	    } else {
+		g_ptr_array_add(tables, table);
+	    }
+	}
+    }
+
+ bailout:
+
+    if (reader != NULL) {
+	g_object_unref(reader);
+    }
+    if (input != NULL) {
+	g_object_unref(input);
+    }
+
+    if (*err) {
+	if (tables != NULL) {
+	    g_ptr_array_free(tables, TRUE);
+	    tables = NULL;
+	}
+	if (schema != NULL) {
+	    g_object_unref(schema);
+	}
+	free(flist);
+	free(preds);
+    } else {
+	*pschema = schema;
+	*pflist = flist;
+	*ppreds = preds;
+    }
+
+    return tables;
+}
+
+static int is_parquet_file (const char *fname)
+{
+    FILE *fp = gretl_fopen(fname, "rb");
+    int ret = 0;
+
+    if (fp != NULL) {
+	char buf[5] = {0};
+
+	if (fread(buf, 1, 4, fp) == 4 && !strcmp(buf, "PAR1")) {
+	    ret = 1;
+	}
+	fclose(fp);
+    }
+
+    return ret;
+}
+
+/* If the first column imported holds strings or dates and is
+   named as for observation labels, use it for observation markers and
+   check them for date information. Returns 1 if this is done. */
+
+static int arrow_maybe_obs_labels (DATASET *dset, int kind, PRN *prn)
+{
+    char **S = NULL;
+    int reversed = 0;
+    int t, ns = 0;
+
+    if (dset->v < 3 || !import_obs_label(dset->varname[1]) ||
+	(kind != COL_STRING && kind != COL_DATE)) {
+	return 0;
+    }
+
+    if (kind == COL_STRING) {
+	S = series_get_string_vals(dset, 1, &ns, 0);
+	if (S == NULL) {
+	    return 0;
+	}
+    }
+
+    if (dataset_allocate_obs_markers(dset)) {
+	return 0;
+    }
+
+    for (t=0; t<dset->n; t++) {
+	double x = dset->Z[1][t];
+
+	if (na(x)) {
+	    *dset->S[t] = '\0';
+	} else if (kind == COL_STRING) {
+	    strncat(dset->S[t], S[(int) x - 1], OBSLEN - 1);
+	} else {
+	    int ymd = (int) x;
+
+	    sprintf(dset->S[t], "%04d-%02d-%02d", ymd / 10000,
+		    (ymd / 100) % 100, ymd % 100);
+	}
+    }
+
+    /* the labels are now redundant as a series */
+    dataset_drop_variable(1, dset);
+
+    if (test_markers_for_dates(dset, &reversed, NULL, prn) > 0) {
+	pputs(prn, _("taking date information from row labels\n\n"));
+	if (dset->markers != DAILY_DATE_STRINGS) {
+	    dataset_destroy_obs_markers(dset);
+	}
+	if (reversed) {
+	    reverse_data(dset, prn);
+	}
+	if (dset->pd != 1 || strcmp(dset->stobs, "1")) {
+	    dset->structure = TIME_SERIES;
+	}
+    }
+
+    return 1;
+}
+
+/**
+ * arrow_get_data:
+ * @fname: name of Parquet or Arrow IPC file.
+ * @dset: dataset to receive the data.
+ * @S: array of names of columns to read, or NULL.
+ * @ns: the number of elements in @S.
+ * @cols: list of (1-based) column numbers to read, or NULL.
+ * @filter: conjunction of comparisons determining the rows to
+ * read, or NULL.
+ * @opt: options for merge_or_replace_data().
+ * @prn: gretl printer.
+ *
+ * Imports data from a columnar file. Only the columns selected
+ * are read and, in the case of Parquet, row groups whose stored
+ * statistics preclude a match with @filter are skipped. The
+ * decoding of the retained columns into the dataset is done in
+ * parallel. String columns, including dictionary-encoded ones,
+ * become string-valued series.
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int arrow_get_data (const char *fname, DATASET *dset,
+		    char **S, int ns, const int *cols,
+		    const char *filter, gretlopt opt,
+		    PRN *prn)
+{
+    GArrowSchema *schema = NULL;
+    GPtrArray *tables;
+    DATASET *newset = NULL;
+    arrow_pred *preds = NULL;
+    col_strings *cs = NULL;
+    char **masks = NULL;
+    gint64 *offsets = NULL;
+    gchar **names = NULL;
+    int *flist = NULL;
+    int *kinds = NULL;
+    int ntab, npred = 0;
+    int i, j, nv, merge;
+    gint64 n = 0;
+    int err = 0;
+
+    if (unix_epoch_day == 0) {
+	unix_epoch_day = epoch_day_from_ymd(1970, 1, 1);
+    }
+
+    if (is_parquet_file(fname)) {
+	tables = read_parquet_tables(fname, &schema, S, ns, cols, filter,
+				     &flist, &preds, &npred, prn, &err);
+    } else {
+	tables = read_ipc_tables(fname, &schema, S, ns, cols, filter,
+				 &flist, &preds, &npred, prn, &err);
+    }
+
+    if (err) {
+	return err;
+    }
+
+    ntab = tables->len;
+    nv = flist[0];
+
+    masks = calloc(ntab, sizeof *masks);
+    offsets = calloc(ntab + 1, sizeof *offsets);
+    names = calloc(nv, sizeof *names);
+    kinds = calloc(nv, sizeof *kinds);
+    cs = calloc(nv, sizeof *cs);
+    if (masks == NULL || offsets == NULL || names == NULL ||
+	kinds == NULL || cs == NULL) {
+	err = E_ALLOC;
+	goto bailout;
+    }
+
+    /* apply the row filter, and work out where the rows of each
+       table go in the dataset */
+    for (i=0; i<ntab && !err; i++) {
+	gint64 nkeep;
+
+	masks[i] = table_row_mask(g_ptr_array_index(tables, i), schema,
+				  preds, npred, &nkeep, &err);
+	offsets[i+1] = offsets[i] + nkeep;
+    }
+    n = offsets[ntab];
+
+    if (!err && n == 0) {
+	gretl_errmsg_set(_("No data were found"));
+	err = E_DATA;
+    }
+
+    if (!err) {
+	newset = create_new_dataset(nv + 1, n, 0);
+	if (newset == NULL) {
+	    err = E_ALLOC;
+	}
+    }
+
+    for (j=0; j<nv && !err; j++) {
+	names[j] = schema_field_name(schema, flist[j+1]);
+	kinds[j] = schema_field_kind(schema, flist[j+1]);
+	if (gretl_normalize_varname(newset->varname[j+1], names[j], 0, j+1)) {
+	    series_set_label(newset, j+1, names[j]);
+	}
+	if (kinds[j] == COL_STRING) {
+	    cs[j].ht = g_hash_table_new(g_str_hash, g_str_equal);
+	}
+    }
+
+    if (!err) {
+	/* decode the columns into the dataset, in parallel */
+#if defined(_OPENMP)
+#pragma omp parallel for private(i) if (gretl_use_openmp((guint64) n * nv))
+#endif
+	for (j=0; j<nv; j++) {
+	    for (i=0; i<ntab; i++) {
+		GArrowTable *table = g_ptr_array_index(tables, i);
+		GArrowChunkedArray *ca = table_column_by_name(table, names[j]);
+
+		if (ca != NULL) {
+		    column_to_doubles(ca, kinds[j], newset->Z[j+1] + offsets[i],
+				      masks[i], &cs[j]);
+		    g_object_unref(ca);
+		}
+	    }
+	}
+    }
+
+    /* attach the string values */
+    for (j=0; j<nv && !err; j++) {
+	if (kinds[j] == COL_STRING && cs[j].ns > 0) {
+	    err = series_set_string_vals_direct(newset, j+1, cs[j].S, cs[j].ns);
+	    cs[j].S = NULL;
+	} else if (kinds[j] == COL_DATE) {
+	    series_set_discrete(newset, j+1, 1);
+	}
+    }
+
+    if (!err) {
+	arrow_maybe_obs_labels(newset, kinds[0], prn);
+    }
+
+ bailout:
+
+    g_ptr_array_free(tables, TRUE);
+    g_object_unref(schema);
+    for (i=0; masks != NULL && i<ntab; i++) {
+	free(masks[i]);
+    }
+    for (j=0; j<nv; j++) {
+	if (names != NULL) {
+	    g_free(names[j]);
+	}
+	if (cs != NULL && cs[j].ht != NULL) {
+	    g_hash_table_destroy(cs[j].ht);
+	    strings_array_free(cs[j].S, cs[j].ns);
+	}
+    }
+    free(masks);
+    free(offsets);
+    free(names);
+    free(kinds);
+    free(cs);
+    free(flist);
+    free(preds);
+
+    if (err) {
+	destroy_dataset(newset);
+	return err;
+    }
+
+    merge = (dset->Z != NULL);
+
+    if (fix_varname_duplicates(newset)) {
+	pputs(prn, _("warning: some variable names were duplicated\n"));
+    }
+
+    err = merge_or_replace_data(dset, &newset, get_merge_opts(opt), prn);
+
+    if (!err && !merge) {
+	dataset_add_import_info(dset, fname, is_parquet_file(fname) ?
+				GRETL_PARQUET : GRETL_ARROW);
+    }
+
+    return err;
+}
+
+/* Build the Arrow array holding the sample range of series @v:
+   a dictionary array in the case of a string-valued series,
+   otherwise an array of doubles in which NAs are nulls. */
+
+static GArrowArray *series_to_arrow_array (const DATASET *dset, int v,
+					   GError **gerr)
+{
+    int t, T = dset->t2 - dset->t1 + 1;
+    const double *x = dset->Z[v] + dset->t1;
+    gboolean *ok = malloc(T * sizeof *ok);
+    GArrowArray *ret = NULL;
+    char **S;
+    int ns;
+
+    if (ok == NULL) {
+	return NULL;
+    }
+
+    for (t=0; t<T; t++) {
+	ok[t] = !na(x[t]);
+    }
+
+    S = series_get_string_vals(dset, v, &ns, 0);
+
+    if (S != NULL) {
+	GArrowInt32ArrayBuilder *ib = garrow_int32_array_builder_new();
+	GArrowStringArrayBuilder *sb = garrow_string_array_builder_new();
+	GArrowArray *idx = NULL, *dict = NULL;
+	gint32 *k = malloc(T * sizeof *k);
+	gboolean done = k != NULL;
+	int i;
+
+	for (t=0; t<T && done; t++) {
+	    k[t] = ok[t] ? (gint32) x[t] - 1 : 0;
+	}
+	if (done) {
+	    done = garrow_int32_array_builder_append_values(ib, k, T, ok, T, gerr);
+	}
+	for (i=0; i<ns && done; i++) {
+	    done = garrow_string_array_builder_append_string(sb, S[i], gerr);
+	}
+	if (done) {
+	    idx = garrow_array_builder_finish(GARROW_ARRAY_BUILDER(ib), gerr);
+	    dict = garrow_array_builder_finish(GARROW_ARRAY_BUILDER(sb), gerr);
+	}
+	if (idx != NULL && dict != NULL) {
+	    GArrowDataType *it = GARROW_DATA_TYPE(garrow_int32_data_type_new());
+	    GArrowDataType *st = GARROW_DATA_TYPE(garrow_string_data_type_new());
+	    GArrowDictionaryDataType *dt;
+
+	    dt = garrow_dictionary_data_type_new(it, st, FALSE);
+	    ret = GARROW_ARRAY(garrow_dictionary_array_new(GARROW_DATA_TYPE(dt),
+							   idx, dict, gerr));
+	    g_object_unref(dt);
+	    g_object_unref(st);
+	    g_object_unref(it);
+	}
+	if (idx != NULL) g_object_unref(idx);
+	if (dict != NULL) g_object_unref(dict);
+	g_object_unref(ib);
+	g_object_unref(sb);
+	free(k);
+    } else {
+	GArrowDoubleArrayBuilder *db = garrow_double_array_builder_new();
+
+	if (garrow_double_array_builder_append_values(db, x, T, ok, T, gerr)) {
+	    ret = garrow_array_builder_finish(GARROW_ARRAY_BUILDER(db), gerr);
+	}
+	g_object_unref(db);
+    }
+
+    free(ok);
+
+    return ret;
+}
+
+/* For time-series data or data with observation markers, build
+   a column of observation labels, which arrow_get_data() will
+   recognize on import. */
+
+static GArrowArray *obs_labels_array (const DATASET *dset, GError **gerr)
+{
+    GArrowStringArrayBuilder *sb = garrow_string_array_builder_new();
+    GArrowArray *ret = NULL;
+    char obs[OBSLEN];
+    gboolean done = TRUE;
+    int t;
+
+    for (t=dset->t1; t<=dset->t2 && done; t++) {
+	if (dset->S != NULL) {
+	    done = garrow_string_array_builder_append_string(sb, dset->S[t], gerr);
+	} else {
+	    ntolabel(obs, t, dset);
+	    done = garrow_string_array_builder_append_string(sb, obs, gerr);
+	}
+    }
+
+    if (done) {
+	ret = garrow_array_builder_finish(GARROW_ARRAY_BUILDER(sb), gerr);
+    }
+    g_object_unref(sb);
+
+    return ret;
+}
+
+/**
+ * arrow_export:
+ * @fname: name of file to write.
+ * @list: list of series to write.
+ * @opt: not used at present.
+ * @dset: dataset struct.
+ *
+ * Writes the series in @list, over the current sample range,
+ * as a Parquet file if @fname has suffix ".parquet", otherwise
+ * as an Arrow IPC file. String-valued series are written as
+ * dictionary-encoded strings, and NAs as nulls.
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+int arrow_export (const char *fname, const int *list,
+		  gretlopt opt, const DATASET *dset)
+{
+    GArrowArray **arrays;
+    GArrowSchema *schema = NULL;
+    GArrowTable *table = NULL;
+    GList *fields = NULL;
+    GError *gerr = NULL;
+    int labels = dset->S != NULL || dataset_is_time_series(dset);
+    int i, k, nc = list[0] + labels;
+    int err = 0;
+
+    arrays = calloc(nc, sizeof *arrays);
+    if (arrays == NULL) {
+	return E_ALLOC;
+    }
+
+    for (i=0, k=0; i<nc && !err; i++) {
+	const char *name;
+
+	if (labels && i == 0) {
+	    arrays[k] = obs_labels_array(dset, &gerr);
+	    name = "obs";
+	} else {
+	    int v = list[i + 1 - labels];
+
+	    arrays[k] = series_to_arrow_array(dset, v, &gerr);
+	    name = dset->varname[v];
+	}
+	if (arrays[k] == NULL) {
+	    err = gerr != NULL ? arrow_error(gerr, NULL) : E_ALLOC;
+	} else {
+	    GArrowDataType *dt = garrow_array_get_value_data_type(arrays[k]);
+
+	    fields = g_list_append(fields, garrow_field_new(name, dt));
+	    g_object_unref(dt);
+	    k++;
+	}
+    }
+
+    if (!err) {
+	schema = garrow_schema_new(fields);
+	table = garrow_table_new_arrays(schema, arrays, nc, &gerr);
+	if (table == NULL) {
+	    err = arrow_error(gerr, NULL);
+	}
+    }
+
+    if (!err && has_suffix(fname, ".parquet")) {
+	GParquetArrowFileWriter *writer;
+
+	writer = gparquet_arrow_file_writer_new_path(schema, fname, NULL, &gerr);
+	if (writer == NULL ||
+	    !gparquet_arrow_file_writer_write_table(writer, table,
+						    1024 * 1024, &gerr) ||
+	    !gparquet_arrow_file_writer_close(writer, &gerr)) {
+	    err = arrow_error(gerr, NULL);
+	}
+	if (writer != NULL) {
+	    g_object_unref(writer);
+	}
+    } else if (!err) {
+	GArrowFileOutputStream *out;
+	GArrowRecordBatchFileWriter *writer = NULL;
+
+	out = garrow_file_output_stream_new(fname, FALSE, &gerr);
+	if (out != NULL) {
+	    writer = garrow_record_batch_file_writer_new(GARROW_OUTPUT_STREAM(out),
+							 schema, &gerr);
+	}
+	if (writer == NULL ||
+	    !garrow_record_batch_writer_write_table(GARROW_RECORD_BATCH_WRITER(writer),
+						    table, &gerr) ||
+	    !garrow_record_batch_writer_close(GARROW_RECORD_BATCH_WRITER(writer),
+					      &gerr) ||
+	    !garrow_file_close(GARROW_FILE(out), &gerr)) {
+	    err = arrow_error(gerr, NULL);
+	}
+	if (writer != NULL) {
+	    g_object_unref(writer);
+	}
+	if (out != NULL) {
+	    g_object_unref(out);
+	}
+    }
+
+    for (i=0; i<nc; i++) {
+	if (arrays[i] != NULL) {
+	    g_object_unref(arrays[i]);
+	}
+    }
+    free(arrays);
+    g_list_free_full(fields, g_object_unref);
+    if (table != NULL) {
+	g_object_unref(table);
+    }
+    if (schema != NULL) {
+	g_object_unref(schema);
+    }
+
+    return err;
+}
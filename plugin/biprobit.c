@@ -24,9 +24,20 @@
 #include "gretl_normal.h"
 #include "libset.h"
 #include "missing_private.h"
+#include "gretl_mt.h"
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
 
 #define BIPDEBUG 0
 
+/* The loglikelihood and the rho-term of the Hessian are summed
+   over fixed chunks of observations, and the partial sums added
+   in order, so the results don't depend on the number of threads.
+*/
+#define BP_CHUNK 4096
+
 typedef struct bp_container_ bp_container;
 
 struct bp_container_ {
@@ -48,6 +59,12 @@ struct bp_container_ {
 
     int *s1;	     	     /* first dependent var */
     int *s2;		     /* second dependent var */
+    int *ord;                /* obs with s1 == s2 first, then the rest */
+    int neq;                 /* number of obs with s1 == s2 */
+    double *wa;              /* workspace: signed indices, eq. 1 */
+    double *wb;              /* workspace: signed indices, eq. 2 */
+    double *wp;              /* workspace: bivariate probabilities */
+    double *psum;            /* partial sums by chunk */
 
     gretl_matrix *reg1;	     /* first eq. regressors */
     gretl_matrix *reg2;	     /* second eq. regressors */
@@ -87,6 +104,11 @@ static void bp_container_destroy (bp_container *bp)
 
     free(bp->s1);
     free(bp->s2);
+    free(bp->ord);
+    free(bp->wa);
+    free(bp->wb);
+    free(bp->wp);
+    free(bp->psum);
 
     gretl_matrix_free(bp->reg1);
     gretl_matrix_free(bp->reg2);
@@ -124,6 +146,10 @@ static bp_container *bp_container_new (const int *list)
     bp->X2list = NULL;
     bp->s1 = NULL;
     bp->s2 = NULL;
+    bp->ord = NULL;
+    bp->neq = 0;
+    bp->wa = bp->wb = bp->wp = NULL;
+    bp->psum = NULL;
     bp->reg1 = NULL;
     bp->reg2 = NULL;
     bp->fitted1 = NULL;
@@ -419,6 +445,49 @@ static int biprobit_first_pass (bp_container *bp, MODEL *olsmod,
   then the rest (matrices, etc.)
 */
 
+static int bp_chunks (int n)
+{
+    return (n + BP_CHUNK - 1) / BP_CHUNK;
+}
+
+/* The bivariate probabilities are evaluated at rho for the
+   observations where the two outcomes agree and at -rho for the
+   others. So that they can be computed in two batches, record
+   once and for all the observations of the first kind followed
+   by those of the second, and allocate the workspace.
+*/
+
+static int bp_make_order (bp_container *bp)
+{
+    int n = bp->nobs;
+    int i, j, k;
+
+    bp->ord = malloc(n * sizeof *bp->ord);
+    bp->wa = malloc(n * sizeof *bp->wa);
+    bp->wb = malloc(n * sizeof *bp->wb);
+    bp->wp = malloc(n * sizeof *bp->wp);
+    bp->psum = malloc(bp_chunks(n) * sizeof *bp->psum);
+
+    if (bp->ord == NULL || bp->wa == NULL || bp->wb == NULL ||
+	bp->wp == NULL || bp->psum == NULL) {
+	return E_ALLOC;
+    }
+
+    for (i=0, j=0; i<n; i++) {
+	if (bp->s1[i] == bp->s2[i]) {
+	    bp->ord[j++] = i;
+	}
+    }
+    bp->neq = j;
+    for (i=0, k=j; i<n; i++) {
+	if (bp->s1[i] != bp->s2[i]) {
+	    bp->ord[k++] = i;
+	}
+    }
+
+    return 0;
+}
+
 static int bp_container_fill (bp_container *bp, MODEL *olsmod,
 			      DATASET *dset, PRN *prn)
 {
@@ -452,6 +521,10 @@ static int bp_container_fill (bp_container *bp, MODEL *olsmod,
 	}
     }
 
+    if (!err) {
+	err = bp_make_order(bp);
+    }
+
     if (!err) {
 	bp->B = gretl_matrix_block_new(&bp->H11, bp->k1, bp->k1,
 				       &bp->H12, bp->k1, bp->k2,
@@ -576,12 +649,40 @@ static int biprob_prelim (const double *theta, bp_container *bp)
     return err;
 }
 
+/* Fill bp->wa and bp->wb with the signed indices, in the order
+   given by bp->ord, and bp->wp with the corresponding bivariate
+   normal probabilities, by means of two vectorized calls to
+   bvnorm_cdf_array().
+*/
+
+static void biprob_probs (bp_container *bp, double rho)
+{
+    const double *f1 = bp->fitted1->val;
+    const double *f2 = bp->fitted2->val;
+    int n = bp->nobs;
+    int k;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * bp->npar))
+#endif
+    for (k=0; k<n; k++) {
+	int i = bp->ord[k];
+
+	bp->wa[k] = bp->s1[i] ? f1[i] : -f1[i];
+	bp->wb[k] = bp->s2[i] ? f2[i] : -f2[i];
+    }
+
+    bvnorm_cdf_array(rho, bp->wa, 1, bp->wb, 1, bp->wp, bp->neq);
+    bvnorm_cdf_array(-rho, bp->wa + bp->neq, 1, bp->wb + bp->neq, 1,
+		     bp->wp + bp->neq, n - bp->neq);
+}
+
 static double biprob_loglik (const double *theta, void *ptr)
 {
     bp_container *bp = (bp_container *) ptr;
-    double rho, llt, a, b, P;
+    int nc = bp_chunks(bp->nobs);
     double ll = NADBL;
-    int i, eqt, err;
+    int c, err;
 
     err = biprob_prelim(theta, bp);
 
@@ -589,20 +690,26 @@ static double biprob_loglik (const double *theta, void *ptr)
 	return ll;
     }
 
-    ll = 0.0;
-    rho = tanh(bp->arho);
-
-    for (i=0; i<bp->nobs; i++) {
-	a = gretl_vector_get(bp->fitted1, i);
-	b = gretl_vector_get(bp->fitted2, i);
+    biprob_probs(bp, tanh(bp->arho));
 
-	a = bp->s1[i] ? a : -a;
-	b = bp->s2[i] ? b : -b;
-	eqt = (bp->s1[i] == bp->s2[i]);
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) bp->nobs * bp->npar))
+#endif
+    for (c=0; c<nc; c++) {
+	int t1 = c * BP_CHUNK;
+	int t2 = MIN(t1 + BP_CHUNK, bp->nobs);
+	double llc = 0.0;
+	int k;
+
+	for (k=t1; k<t2; k++) {
+	    llc += log(bp->wp[k]);
+	}
+	bp->psum[c] = llc;
+    }
 
-	P = bvnorm_cdf((eqt ? rho : -rho), a, b);
-	llt = log(P);
-	ll += llt;
+    ll = 0.0;
+    for (c=0; c<nc; c++) {
+	ll += bp->psum[c];
     }
 
     bp->ll = ll;
@@ -610,14 +717,96 @@ static double biprob_loglik (const double *theta, void *ptr)
     return ll;
 }
 
+/* Form X'diag(w)Z in @targ, using @W as workspace */
+
+static void bp_XWZ (const gretl_matrix *X, const double *w,
+		    const gretl_matrix *Z, gretl_matrix *W,
+		    gretl_matrix *targ)
+{
+    int n = Z->rows;
+    int i;
+
+    gretl_matrix_reuse(W, n, Z->cols);
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * Z->cols))
+#endif
+    for (i=0; i<Z->cols; i++) {
+	const double *zi = Z->val + (size_t) i * n;
+	double *wi = W->val + (size_t) i * n;
+	int t;
+
+	for (t=0; t<n; t++) {
+	    wi[t] = w[t] * zi[t];
+	}
+    }
+
+    gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+			      W, GRETL_MOD_NONE,
+			      targ, GRETL_MOD_NONE);
+}
+
+/* Form X'v in @g, one column of X per thread */
+
+static void bp_Xtv (const gretl_matrix *X, const double *v,
+		    double *g)
+{
+    int n = X->rows;
+    int i;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * X->cols))
+#endif
+    for (i=0; i<X->cols; i++) {
+	const double *xi = X->val + (size_t) i * n;
+	double gi = 0.0;
+	int t;
+
+	for (t=0; t<n; t++) {
+	    gi += xi[t] * v[t];
+	}
+	g[i] = gi;
+    }
+}
+
+/* Per-observation derivatives of the loglikelihood with respect
+   to the two indices and atanh(rho); the second and third are
+   written into @d2 and @da, and the first is returned.
+*/
+
+static double biprob_derivs (bp_container *bp, int k, double ca,
+			     double sa, double *d2, double *da)
+{
+    int i = bp->ord[k];
+    int eqt = (k < bp->neq);
+    double a = bp->wa[k];
+    double b = bp->wb[k];
+    double P = bp->wp[k];
+    double ssa = eqt ? sa : -sa;
+    double u_ba = (ca*b - ssa*a);
+    double u_ab = (ca*a - ssa*b);
+    double f = ca/M_2PI * exp(-0.5* (a*a + u_ba*u_ba));
+    double d1;
+
+    d1 = exp(-0.5*a*a) * normal_cdf(u_ba) / (P * SQRT_2_PI);
+    *d2 = exp(-0.5*b*b) * normal_cdf(u_ab) / (P * SQRT_2_PI);
+    *da = f / (P*ca*ca);
+
+    d1 = bp->s1[i] ? d1 : -d1;
+    *d2 = bp->s2[i] ? *d2 : -*d2;
+    *da = eqt ? *da : -*da;
+
+    return d1;
+}
+
 static int biprob_score (double *theta, double *s, int npar, BFGS_CRIT_FUNC ll,
 			 void *ptr)
 {
     bp_container *bp = (bp_container *) ptr;
-    double ca, sa, ssa;
-    double a, b, P, f, d1, d2, da, tmp, u_ab, u_ba;
-    int i, j, eqt;
-    int err;
+    gretl_matrix *G = bp->score;
+    double ca, sa;
+    int n = bp->nobs;
+    int i, k, err;
 
     err = biprob_prelim(theta, bp);
 
@@ -627,51 +816,41 @@ static int biprob_score (double *theta, double *s, int npar, BFGS_CRIT_FUNC ll,
 
     ca = cosh(bp->arho);
     sa = sinh(bp->arho);
-    gretl_matrix_zero(bp->sscore);
+    biprob_probs(bp, sa/ca);
 
-    for (i=0; i<bp->nobs; i++) {
-	a = gretl_vector_get(bp->fitted1, i);
-	b = gretl_vector_get(bp->fitted2, i);
-
-	a = bp->s1[i] ? a : -a;
-	b = bp->s2[i] ? b : -b;
-	eqt = (bp->s1[i] == bp->s2[i]);
-	ssa = eqt ? sa : -sa;
-
-	P = bvnorm_cdf(ssa/ca, a, b);
-
-	/* score */
-
-	u_ba = (ca*b - ssa*a);
-	u_ab = (ca*a - ssa*b);
-	f = ca/M_2PI * exp(-0.5* (a*a + u_ba*u_ba));
-
-	d1 = exp(-0.5*a*a) * normal_cdf(u_ba) / (P * SQRT_2_PI);
-	d2 = exp(-0.5*b*b) * normal_cdf(u_ab) / (P * SQRT_2_PI);
-	da = f / (P*ca*ca);
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * bp->npar))
+#endif
+    for (k=0; k<n; k++) {
+	int t = bp->ord[k];
+	double d1, d2, da;
+	int j;
 
-	d1 = bp->s1[i] ? d1 : -d1;
-	d2 = bp->s2[i] ? d2 : -d2;
-	da = eqt ? da : -da;
+	d1 = biprob_derivs(bp, k, ca, sa, &d2, &da);
 
 	for (j=0; j<bp->k1; j++) {
-	    tmp = gretl_matrix_get(bp->reg1, i, j) * d1;
-	    gretl_matrix_set(bp->score, i, j, tmp);
-	    tmp += gretl_vector_get(bp->sscore, j);
-	    gretl_vector_set(bp->sscore, j, tmp);
+	    gretl_matrix_set(G, t, j, gretl_matrix_get(bp->reg1, t, j) * d1);
 	}
-
 	for (j=0; j<bp->k2; j++) {
-	    tmp = gretl_matrix_get(bp->reg2, i, j) * d2;
-	    gretl_matrix_set(bp->score, i, bp->k1 + j, tmp);
-	    tmp += gretl_vector_get(bp->sscore, bp->k1 + j);
-	    gretl_vector_set(bp->sscore, bp->k1 + j, tmp);
+	    gretl_matrix_set(G, t, bp->k1 + j,
+			     gretl_matrix_get(bp->reg2, t, j) * d2);
 	}
+	gretl_matrix_set(G, t, bp->npar - 1, da);
+    }
 
-	gretl_matrix_set(bp->score, i, bp->npar - 1, da);
-	tmp = da + gretl_vector_get(bp->sscore, bp->npar - 1);
-	gretl_vector_set(bp->sscore, bp->npar - 1, tmp);
+    /* the gradient: sum the score matrix by columns */
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * bp->npar))
+#endif
+    for (i=0; i<bp->npar; i++) {
+	const double *gi = G->val + (size_t) i * n;
+	double si = 0.0;
+	int t;
 
+	for (t=0; t<n; t++) {
+	    si += gi[t];
+	}
+	bp->sscore->val[i] = si;
     }
 
     if (s != NULL) {
@@ -695,22 +874,28 @@ static int biprob_score (double *theta, double *s, int npar, BFGS_CRIT_FUNC ll,
    In practice, we just compute explicitly the difference between
    the OPG and the actual Hessian, and then reconstruct H from
    there.
+
+   The per-observation weights are computed first (in parallel),
+   then the blocks are formed as weighted cross-products.
  */
 
+enum {
+    BW11, BW12, BW13, BW22, BW23, BW_N
+};
+
 int biprobit_hessian (double *theta, gretl_matrix *H, void *ptr)
 {
     bp_container *bp = (bp_container *) ptr;
-    double a, b, P, f, d1, d2, da, tmp, u_ab, u_ba;
-    double ca, sa, ssa, rho, x;
-    double h11 = 0;
-    double h12 = 0;
-    double h13 = 0;
-    double h22 = 0;
-    double h23 = 0;
+    gretl_matrix *W = NULL;
+    double *wbuf = NULL;
+    double *w[BW_N];
+    double ca, sa, tmp;
     double h33 = 0;
     int k1 = bp->k1;
     int k2 = bp->k2;
-    int t, i, j, eqt;
+    int n = bp->nobs;
+    int nc = bp_chunks(n);
+    int i, j, c;
     int err;
 
     err = biprob_prelim(theta, bp);
@@ -720,7 +905,6 @@ int biprobit_hessian (double *theta, gretl_matrix *H, void *ptr)
 	sa = sinh(bp->arho);
 
 	gretl_matrix_zero(bp->sscore);
-	gretl_matrix_block_zero(bp->B);
 
 	/* first, put the OPG matrix into H */
 	err = gretl_matrix_multiply_mod(bp->score, GRETL_MOD_TRANSPOSE,
@@ -732,87 +916,85 @@ int biprobit_hessian (double *theta, gretl_matrix *H, void *ptr)
 	return err;
     }
 
-    for (t=0; t<bp->nobs; t++) {
-
-	/* Warning: it is important to handle properly the four
-	   cases (00, 01, 10, 11) and the associated sign switches;
-	   this may be very tricky. The code below should be bug-free
-	   from this point of view, but you never know. Kudos to
-	   Claudia Pigini for going through this with incredible
-	   perseverance.
-	*/
-
-	a = gretl_vector_get(bp->fitted1, t);
-	b = gretl_vector_get(bp->fitted2, t);
-
-	a = bp->s1[t] ? a : -a;
-	b = bp->s2[t] ? b : -b;
-	eqt = (bp->s1[t] == bp->s2[t]);
-	ssa = eqt ? sa : -sa;
-	rho = ssa/ca;
-	P = bvnorm_cdf(rho, a, b);
+    wbuf = malloc(BW_N * n * sizeof *wbuf);
+    W = gretl_matrix_alloc(n, (k1 > k2)? k1 : k2);
+    if (wbuf == NULL || W == NULL) {
+	free(wbuf);
+	gretl_matrix_free(W);
+	return E_ALLOC;
+    }
 
-	/* score (for atan(rho) we use the precomputed one) */
+    for (i=0; i<BW_N; i++) {
+	w[i] = wbuf + i * n;
+    }
 
-	u_ba = (ca*b - ssa*a);
-	u_ab = (ca*a - ssa*b);
+    biprob_probs(bp, sa/ca);
 
-	d1 = exp(-0.5*a*a) * normal_cdf(u_ba) / (P * SQRT_2_PI);
-	d2 = exp(-0.5*b*b) * normal_cdf(u_ab) / (P * SQRT_2_PI);
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * bp->npar))
+#endif
+    for (c=0; c<nc; c++) {
+	int k1c = c * BP_CHUNK;
+	int k2c = MIN(k1c + BP_CHUNK, n);
+	double a, b, P, f, d1, d2, da, u_ab, u_ba;
+	double ssa, uu, hc = 0.0;
+	int k, t, eqt;
+
+	for (k=k1c; k<k2c; k++) {
+
+	    /* Warning: it is important to handle properly the four
+	       cases (00, 01, 10, 11) and the associated sign switches;
+	       this may be very tricky. The code below should be bug-free
+	       from this point of view, but you never know. Kudos to
+	       Claudia Pigini for going through this with incredible
+	       perseverance.
+	    */
 
-	f = ca/M_2PI * exp(-0.5* (a*a + u_ba*u_ba));
+	    t = bp->ord[k];
+	    a = bp->wa[k];
+	    b = bp->wb[k];
+	    P = bp->wp[k];
+	    eqt = (k < bp->neq);
+	    ssa = eqt ? sa : -sa;
 
-	da = gretl_matrix_get(bp->score,t, k1+k2);
+	    /* score (for atan(rho) we use the precomputed one) */
 
-	/* hessian + opg */
+	    u_ba = (ca*b - ssa*a);
+	    u_ab = (ca*a - ssa*b);
 
-	h11 = -(a * d1 + sa*ca*da);
-	h12 = (eqt ? f/P : -f/P);
-	h13 = (bp->s1[t] ? -da * (ca * u_ab) : da * (ca * u_ab));
-	h22 = -(b*d2 + sa*ca*da);
-	h23 = (bp->s2[t] ? -da * (ca * u_ba) : da * (ca * u_ba));
+	    d1 = exp(-0.5*a*a) * normal_cdf(u_ba) / (P * SQRT_2_PI);
+	    d2 = exp(-0.5*b*b) * normal_cdf(u_ab) / (P * SQRT_2_PI);
 
-	tmp = (eqt ? u_ba*u_ab : -u_ba*u_ab);
-	tmp = da * (ca * tmp - sa) /ca;
-	h33 += tmp;
+	    f = ca/M_2PI * exp(-0.5* (a*a + u_ba*u_ba));
 
-	for (i=0; i<bp->k1; i++) {
-	    x = gretl_matrix_get(bp->reg1, t, i);
+	    da = gretl_matrix_get(bp->score, t, k1+k2);
 
-	    for (j=i; j<bp->k1; j++) {
-		tmp = gretl_matrix_get(bp->H11, i, j);
-		tmp += h11 * x * gretl_matrix_get(bp->reg1, t, j);
-		gretl_matrix_set(bp->H11, i, j, tmp);
-		gretl_matrix_set(bp->H11, j, i, tmp);
-	    }
+	    /* hessian + opg */
 
-	    for (j=0; j<bp->k2; j++) {
-		tmp = gretl_matrix_get(bp->H12, i, j);
-		tmp += h12 * x * gretl_matrix_get(bp->reg2, t, j);
-		gretl_matrix_set(bp->H12, i, j, tmp);
-	    }
+	    w[BW11][t] = -(a * d1 + sa*ca*da);
+	    w[BW12][t] = (eqt ? f/P : -f/P);
+	    w[BW13][t] = (bp->s1[t] ? -da * (ca * u_ab) : da * (ca * u_ab));
+	    w[BW22][t] = -(b*d2 + sa*ca*da);
+	    w[BW23][t] = (bp->s2[t] ? -da * (ca * u_ba) : da * (ca * u_ba));
 
-	    tmp = gretl_matrix_get(bp->H13, i, 0);
-	    tmp += h13 * x;
-	    gretl_matrix_set(bp->H13, i, 0, tmp);
+	    uu = (eqt ? u_ba*u_ab : -u_ba*u_ab);
+	    hc += da * (ca * uu - sa) /ca;
 	}
+	bp->psum[c] = hc;
+    }
 
-	for (i=0; i<bp->k2; i++) {
-	    x = gretl_matrix_get(bp->reg2, t, i);
-
-	    for (j=i; j<bp->k2; j++) {
-		tmp = gretl_matrix_get(bp->H22, i, j);
-		tmp += h22 * x * gretl_matrix_get(bp->reg2, t, j);
-		gretl_matrix_set(bp->H22, i, j, tmp);
-		gretl_matrix_set(bp->H22, j, i, tmp);
-	    }
+    for (c=0; c<nc; c++) {
+	h33 += bp->psum[c];
+    }
 
-	    tmp = gretl_matrix_get(bp->H23, i, 0);
-	    tmp += h23 * x;
-	    gretl_matrix_set(bp->H23, i, 0, tmp);
-	}
+    bp_XWZ(bp->reg1, w[BW11], bp->reg1, W, bp->H11);
+    bp_XWZ(bp->reg1, w[BW12], bp->reg2, W, bp->H12);
+    bp_XWZ(bp->reg2, w[BW22], bp->reg2, W, bp->H22);
+    bp_Xtv(bp->reg1, w[BW13], bp->H13->val);
+    bp_Xtv(bp->reg2, w[BW23], bp->H23->val);
 
-    }
+    free(wbuf);
+    gretl_matrix_free(W);
 
 #if 0
     gretl_matrix_print(bp->H11, "H11");
@@ -25,6 +25,12 @@
 #include "version.h"
 #include "matrix_extra.h"
 #include "uservar.h"
+#include "gretl_mt.h"
+#include "libset.h"
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
 
 #define ADEBUG 0
 #define WRITE_MATRICES 0
@@ -38,18 +44,25 @@ enum {
     DPD_SYSTEM   = 1 << 3,
     DPD_DPDSTYLE = 1 << 4,
     DPD_REDO     = 1 << 5,
-    DPD_COLLAPSE = 1 << 6
+    DPD_COLLAPSE = 1 << 6,
+    DPD_SPARSE   = 1 << 7
 };
 
+/* beyond this many elements (instruments times observations)
+   the full instrument matrix is held in sparse form */
+#define DPD_ZT_MAX (1 << 25)
+
 #define gmm_sys(d)   (d->flags & DPD_SYSTEM)
 #define dpd_style(d) (d->flags & DPD_DPDSTYLE)
 #define collapse(d)  (d->flags & DPD_COLLAPSE)
+#define zsparse(d)   (d->flags & DPD_SPARSE)
 
 #define LEVEL_ONLY 2
 
 typedef struct dpmod_ dpmod;
 typedef struct unit_info_ unit_info;
 typedef struct diag_info_ diag_info;
+typedef struct zsparse_ zsparse;
 
 struct unit_info_ {
     int t1;      /* first usable obs in differences for unit */
@@ -71,6 +84,20 @@ struct diag_info_ {
     int collapse; /* "collapse" the instruments? */
 };
 
+/* Compressed-column storage for the transpose of the full
+   instrument matrix, one column per observation. Given the
+   block-diagonal structure of GMM-style instruments most of
+   the dense version is zeros.
+*/
+
+struct zsparse_ {
+    int rows;     /* number of instruments */
+    int cols;     /* number of observations */
+    size_t *cp;   /* column pointers (cols + 1) */
+    int *ri;      /* row indices of nonzero elements */
+    double *x;    /* nonzero values */
+};
+
 struct dpmod_ {
     int flags;            /* option flags */
     int step;             /* what step are we on? (1 or 2) */
@@ -117,6 +144,7 @@ struct dpmod_ {
     gretl_matrix *Acpy;   /* back-up of A matrix */
     gretl_matrix *V;      /* covariance matrix */
     gretl_matrix *ZT;     /* transpose of full instrument matrix */
+    zsparse *ZS;          /* sparse alternative to ZT */
     gretl_matrix *Zi;     /* per-unit instrument matrix */
     gretl_matrix *Y;      /* transformed dependent var */
     gretl_matrix *X;      /* lagged differences of y, indep vars, etc. */
@@ -149,6 +177,35 @@ struct dpmod_ {
 static void dpanel_residuals (dpmod *dpd);
 static int dpd_process_list (dpmod *dpd, int *list, const int *ylags);
 
+static void zsparse_free (zsparse *zs)
+{
+    if (zs != NULL) {
+	free(zs->cp);
+	free(zs->ri);
+	free(zs->x);
+	free(zs);
+    }
+}
+
+static zsparse *zsparse_new (int rows, int cols)
+{
+    zsparse *zs = malloc(sizeof *zs);
+
+    if (zs != NULL) {
+	zs->rows = rows;
+	zs->cols = cols;
+	zs->cp = calloc(cols + 1, sizeof *zs->cp);
+	zs->ri = NULL;
+	zs->x = NULL;
+	if (zs->cp == NULL) {
+	    free(zs);
+	    zs = NULL;
+	}
+    }
+
+    return zs;
+}
+
 static void dpmod_free (dpmod *dpd)
 {
     if (dpd == NULL) {
@@ -158,6 +215,8 @@ static void dpmod_free (dpmod *dpd)
     gretl_matrix_block_destroy(dpd->B1);
     gretl_matrix_block_destroy(dpd->B2);
 
+    gretl_matrix_free(dpd->ZT);
+    zsparse_free(dpd->ZS);
     gretl_matrix_free(dpd->V);
 
     free(dpd->xlist);
@@ -178,7 +237,6 @@ static int dpd_allocate_matrices (dpmod *dpd)
     dpd->B1 = gretl_matrix_block_new(&dpd->beta,  dpd->k, 1,
 				     &dpd->vbeta, dpd->k, dpd->k,
 				     &dpd->uhat,  dpd->totobs, 1,
-				     &dpd->ZT,    dpd->nz, dpd->totobs,
 				     &dpd->H,     T, T,
 				     &dpd->A,     dpd->nz, dpd->nz,
 				     &dpd->Acpy,  dpd->nz, dpd->nz,
@@ -203,6 +261,22 @@ static int dpd_allocate_matrices (dpmod *dpd)
 	return E_ALLOC;
     }
 
+    if ((guint64) dpd->nz * dpd->totobs > DPD_ZT_MAX) {
+	dpd->flags |= DPD_SPARSE;
+    }
+
+    if (zsparse(dpd)) {
+	dpd->ZS = zsparse_new(dpd->nz, dpd->totobs);
+	if (dpd->ZS == NULL) {
+	    return E_ALLOC;
+	}
+    } else {
+	dpd->ZT = gretl_matrix_alloc(dpd->nz, dpd->totobs);
+	if (dpd->ZT == NULL) {
+	    return E_ALLOC;
+	}
+    }
+
     return 0;
 }
 
@@ -226,6 +300,162 @@ static int dpd_add_unit_info (dpmod *dpd)
     return err;
 }
 
+/* Accessors for the full instrument matrix, Z', which is held
+   either as a dense matrix (dpd->ZT) or in sparse form (dpd->ZS)
+*/
+
+/* C = Z'B, or C = (Z'B)' if @mod is GRETL_MOD_TRANSPOSE, where @B
+   has one row per observation */
+
+static void dpd_ZT_multiply (dpmod *dpd, const gretl_matrix *B,
+			     gretl_matrix *C, GretlMatrixMod mod)
+{
+    const zsparse *zs = dpd->ZS;
+    double bsj, *cj;
+    size_t p;
+    int j, s;
+
+    if (dpd->ZT != NULL) {
+	if (mod == GRETL_MOD_TRANSPOSE) {
+	    gretl_matrix_multiply_mod(B, GRETL_MOD_TRANSPOSE,
+				      dpd->ZT, GRETL_MOD_TRANSPOSE,
+				      C, GRETL_MOD_NONE);
+	} else {
+	    gretl_matrix_multiply(dpd->ZT, B, C);
+	}
+	return;
+    }
+
+    gretl_matrix_zero(C);
+
+    for (j=0; j<B->cols; j++) {
+	cj = (mod == GRETL_MOD_TRANSPOSE)? C->val + j : C->val + j * C->rows;
+	for (s=0; s<zs->cols; s++) {
+	    bsj = gretl_matrix_get(B, s, j);
+	    if (bsj == 0.0) {
+		continue;
+	    }
+	    if (mod == GRETL_MOD_TRANSPOSE) {
+		for (p=zs->cp[s]; p<zs->cp[s+1]; p++) {
+		    cj[zs->ri[p] * C->rows] += zs->x[p] * bsj;
+		}
+	    } else {
+		for (p=zs->cp[s]; p<zs->cp[s+1]; p++) {
+		    cj[zs->ri[p]] += zs->x[p] * bsj;
+		}
+	    }
+	}
+    }
+}
+
+/* fill @Zi (@ni x nz) with the instruments for the @ni
+   observations starting at @s0 */
+
+static void dpd_get_Zi (dpmod *dpd, int s0, int ni, gretl_matrix *Zi)
+{
+    const zsparse *zs = dpd->ZS;
+    size_t p;
+    int i;
+
+    if (dpd->ZT != NULL) {
+	gretl_matrix_extract_matrix(Zi, dpd->ZT, 0, s0,
+				    GRETL_MOD_TRANSPOSE);
+	return;
+    }
+
+    gretl_matrix_zero(Zi);
+
+    for (i=0; i<ni; i++) {
+	for (p=zs->cp[s0+i]; p<zs->cp[s0+i+1]; p++) {
+	    gretl_matrix_set(Zi, i, zs->ri[p], zs->x[p]);
+	}
+    }
+}
+
+/* y += a * (instruments for observation @s) */
+
+static void dpd_ZT_col_axpy (dpmod *dpd, int s, double a, double *y)
+{
+    const zsparse *zs = dpd->ZS;
+    size_t p;
+    int j;
+
+    if (dpd->ZT != NULL) {
+	for (j=0; j<dpd->nz; j++) {
+	    y[j] += a * gretl_matrix_get(dpd->ZT, j, s);
+	}
+    } else {
+	for (p=zs->cp[s]; p<zs->cp[s+1]; p++) {
+	    y[zs->ri[p]] += a * zs->x[p];
+	}
+    }
+}
+
+/* remove the instruments flagged in @mask */
+
+static int dpd_ZT_cut_rows (dpmod *dpd, const char *mask)
+{
+    zsparse *zs = dpd->ZS;
+    size_t p, p0, q = 0;
+    int *rmap;
+    int i, k, s;
+
+    if (dpd->ZT != NULL) {
+	return gretl_matrix_cut_rows(dpd->ZT, mask);
+    }
+
+    rmap = malloc(zs->rows * sizeof *rmap);
+    if (rmap == NULL) {
+	return E_ALLOC;
+    }
+
+    for (i=0, k=0; i<zs->rows; i++) {
+	rmap[i] = mask[i] ? -1 : k++;
+    }
+
+    p0 = zs->cp[0];
+    for (s=0; s<zs->cols; s++) {
+	for (p=p0; p<zs->cp[s+1]; p++) {
+	    if (rmap[zs->ri[p]] >= 0) {
+		zs->ri[q] = rmap[zs->ri[p]];
+		zs->x[q++] = zs->x[p];
+	    }
+	}
+	p0 = zs->cp[s+1];
+	zs->cp[s+1] = q;
+    }
+    zs->rows = k;
+
+    free(rmap);
+
+    return 0;
+}
+
+/* dense copy of Z', for saving to the model */
+
+static gretl_matrix *dpd_ZT_copy (dpmod *dpd)
+{
+    const zsparse *zs = dpd->ZS;
+    gretl_matrix *Z;
+    size_t p;
+    int s;
+
+    if (dpd->ZT != NULL) {
+	return gretl_matrix_copy(dpd->ZT);
+    }
+
+    Z = gretl_zero_matrix_new(zs->rows, zs->cols);
+    if (Z != NULL) {
+	for (s=0; s<zs->cols; s++) {
+	    for (p=zs->cp[s]; p<zs->cp[s+1]; p++) {
+		gretl_matrix_set(Z, zs->ri[p], s, zs->x[p]);
+	    }
+	}
+    }
+
+    return Z;
+}
+
 static int dpd_flags_from_opt (gretlopt opt)
 {
     /* apply Windmeijer correction unless OPT_A is given */
@@ -251,6 +481,10 @@ static int dpd_flags_from_opt (gretlopt opt)
 	/* "collapse" all block-diagonal instruments as per Roodman */
 	f |= DPD_COLLAPSE;
     }
+    if (opt & OPT_S) {
+	/* hold the instrument matrix in sparse form */
+	f |= DPD_SPARSE;
+    }
 
     return f;
 }
@@ -275,6 +509,8 @@ static dpmod *dpmod_new (int *list, const int *ylags,
 
     /* set pointer members to NULL just in case */
     dpd->B1 = dpd->B2 = NULL;
+    dpd->ZT = NULL;
+    dpd->ZS = NULL;
     dpd->V = NULL;
     dpd->ui = NULL;
     dpd->used = NULL;
@@ -717,7 +953,7 @@ static int dpd_overid_test (dpmod *dpd)
     int err = 0;
 
     ZTE = gretl_matrix_reuse(dpd->L1, dpd->nz, 1);
-    gretl_matrix_multiply(dpd->ZT, dpd->uhat, ZTE);
+    dpd_ZT_multiply(dpd, dpd->uhat, ZTE, GRETL_MOD_NONE);
 
     gretl_matrix_divide_by_scalar(dpd->A, dpd->effN);
     test = gretl_scalar_qform(ZTE, dpd->A, &err);
@@ -927,10 +1163,6 @@ static int dpd_ar_test (dpmod *dpd)
 		    x = gretl_matrix_get(dpd->X, s, j);
 		    gretl_matrix_set(Xi, k, j, x);
 		}
-		for (j=0; j<nz; j++) {
-		    x = gretl_matrix_get(dpd->ZT, j, s);
-		    gretl_matrix_set(Zi, k, j, x);
-		}
 		k++;
 		s++;
 	    }
@@ -943,6 +1175,7 @@ static int dpd_ar_test (dpmod *dpd)
 	}
 
 	nlags += nlags_i;
+	dpd_get_Zi(dpd, s - k, k, Zi);
 
 	/* d0 += w_i' * u_i */
 	uw = gretl_matrix_dot_product(wi, GRETL_MOD_TRANSPOSE,
@@ -975,10 +1208,7 @@ static int dpd_ar_test (dpmod *dpd)
 				      ZU, GRETL_MOD_NONE);
 	    for (t=0; t<unit->nlev; t++) {
 		/* catch the levels terms */
-		for (j=0; j<nz; j++) {
-		    x = gretl_matrix_get(dpd->ZT, j, s);
-		    ZU->val[j] += x * dpd->uhat->val[s];
-		}
+		dpd_ZT_col_axpy(dpd, s, dpd->uhat->val[s], ZU->val);
 		s++;
 	    }
 	    gretl_matrix_multiply_by_scalar(ZU, uw);
@@ -1083,8 +1313,7 @@ static int windmeijer_correct (dpmod *dpd, const gretl_matrix *uhat1,
     gretl_matrix *dWj; /* one component of the above */
     gretl_matrix *ui;  /* per-unit residuals */
     gretl_matrix *xij; /* per-unit X_j values */
-    gretl_matrix *mT;  /* workspace follows */
-    gretl_matrix *km;
+    gretl_matrix *km;  /* workspace follows */
     gretl_matrix *k1;
     gretl_matrix *R1;
     gretl_matrix *Zui;
@@ -1101,7 +1330,6 @@ static int windmeijer_correct (dpmod *dpd, const gretl_matrix *uhat1,
 			       &dWj, dpd->nz, dpd->nz,
 			       &ui,  dpd->max_ni, 1,
 			       &xij, dpd->max_ni, 1,
-			       &mT,  dpd->nz, dpd->totobs,
 			       &km,  dpd->k, dpd->nz,
 			       &k1,  dpd->k, 1,
 			       &Zui, dpd->nz, 1,
@@ -1119,8 +1347,8 @@ static int windmeijer_correct (dpmod *dpd, const gretl_matrix *uhat1,
     gretl_matrix_multiply_by_scalar(dpd->kmtmp, -1.0 / dpd->effN);
 
     /* form W^{-1}Z'v_2 */
-    gretl_matrix_multiply(dpd->A, dpd->ZT, mT);
-    gretl_matrix_multiply(mT, dpd->uhat, R1);
+    dpd_ZT_multiply(dpd, dpd->uhat, Zui, GRETL_MOD_NONE);
+    gretl_matrix_multiply(dpd->A, Zui, R1);
 
     for (j=0; j<dpd->k; j++) { /* loop across the X's */
 	int s = 0;
@@ -1150,8 +1378,7 @@ static int windmeijer_correct (dpmod *dpd, const gretl_matrix *uhat1,
 					GRETL_MOD_NONE);
 
 	    /* extract Zi */
-	    gretl_matrix_extract_matrix(dpd->Zi, dpd->ZT, 0, s - ni,
-					GRETL_MOD_TRANSPOSE);
+	    dpd_get_Zi(dpd, s - ni, ni, dpd->Zi);
 
 	    gretl_matrix_multiply_mod(dpd->Zi, GRETL_MOD_TRANSPOSE,
 				      ui, GRETL_MOD_NONE,
@@ -1280,8 +1507,7 @@ static int dpd_variance_1 (dpmod *dpd)
 	/* get per-unit instruments matrix, Zi */
 	gretl_matrix_reuse(dpd->Zi, ni, dpd->nz);
 	gretl_matrix_reuse(ui, ni, 1);
-	gretl_matrix_extract_matrix(dpd->Zi, dpd->ZT, 0, c,
-				    GRETL_MOD_TRANSPOSE);
+	dpd_get_Zi(dpd, c, ni, dpd->Zi);
 	c += ni;
 
 	/* load residuals into the ui vector */
@@ -1543,8 +1769,8 @@ static int dpd_finalize_model (MODEL *pmod,
 		gretl_model_set_matrix_as_data(pmod, "wgtmat", A);
 	    }
 	}
-	if (keep_extra && dpd->ZT != NULL) {
-	    gretl_matrix *Z = gretl_matrix_copy(dpd->ZT);
+	if (keep_extra && (dpd->ZT != NULL || dpd->ZS != NULL)) {
+	    gretl_matrix *Z = dpd_ZT_copy(dpd);
 
 	    gretl_model_set_matrix_as_data(pmod, "GMMinst", Z);
 	}
@@ -1588,14 +1814,19 @@ static int dpd_finalize_model (MODEL *pmod,
    should just have their nz dimension changed.
 */
 
-static void dpd_shrink_matrices (dpmod *dpd, const char *mask)
+static int dpd_shrink_matrices (dpmod *dpd, const char *mask)
 {
+    int err;
+
 #if IVDEBUG
     fprintf(stderr, "dpanel: dpd_shrink_matrices: cut nz from %d to %d\n",
 	    dpd->nz, dpd->A->rows);
 #endif
 
-    gretl_matrix_cut_rows(dpd->ZT, mask);
+    err = dpd_ZT_cut_rows(dpd, mask);
+    if (err) {
+	return err;
+    }
     dpd->nz = dpd->A->rows;
 
     gretl_matrix_reuse(dpd->Acpy,  dpd->nz, dpd->nz);
@@ -1604,6 +1835,8 @@ static void dpd_shrink_matrices (dpmod *dpd, const char *mask)
     gretl_matrix_reuse(dpd->XZA,   -1, dpd->nz);
     gretl_matrix_reuse(dpd->XZ,    -1, dpd->nz);
     gretl_matrix_reuse(dpd->ZY,    dpd->nz, -1);
+
+    return 0;
 }
 
 static int dpd_step_2_A (dpmod *dpd)
@@ -1757,7 +1990,7 @@ static int dpd_invert_A_N (dpmod *dpd)
 	    err = gretl_invert_symmetric_matrix(dpd->A);
 	    if (!err) {
 		/* OK, now register effects of reducing nz */
-		dpd_shrink_matrices(dpd, mask);
+		err = dpd_shrink_matrices(dpd, mask);
 	    } else {
 		fprintf(stderr, "inverting dpd->A failed on second pass\n");
 	    }
@@ -1784,10 +2017,8 @@ static int dpd_step_1 (dpmod *dpd, gretlopt opt)
 	/* construct additional moment matrices: we waited
 	   until we knew what size these should really be
 	*/
-	gretl_matrix_multiply(dpd->ZT, dpd->Y, dpd->ZY);
-	gretl_matrix_multiply_mod(dpd->X, GRETL_MOD_TRANSPOSE,
-				  dpd->ZT, GRETL_MOD_TRANSPOSE,
-				  dpd->XZ, GRETL_MOD_NONE);
+	dpd_ZT_multiply(dpd, dpd->Y, dpd->ZY, GRETL_MOD_NONE);
+	dpd_ZT_multiply(dpd, dpd->X, dpd->XZ, GRETL_MOD_TRANSPOSE);
     }
 
 #if ADEBUG > 1
@@ -2562,12 +2793,12 @@ static void build_unit_D_matrix (dpmod *dpd, int *goodobs, gretl_matrix *D)
 }
 
 static void build_unit_H_matrix (dpmod *dpd, int *goodobs,
-				 gretl_matrix *D)
+				 gretl_matrix *D, gretl_matrix *H)
 {
     build_unit_D_matrix(dpd, goodobs, D);
     gretl_matrix_multiply_mod(D, GRETL_MOD_TRANSPOSE,
 			      D, GRETL_MOD_NONE,
-			      dpd->H, GRETL_MOD_NONE);
+			      H, GRETL_MOD_NONE);
 }
 
 static void make_dpdstyle_H (gretl_matrix *H, int nd)
@@ -3051,7 +3282,7 @@ static int trim_zero_inst (dpmod *dpd, PRN *prn)
 		pprintf(prn, _("%d redundant instruments dropped, leaving %d\n"),
 			dpd->nz - dpd->A->rows, dpd->A->rows);
 	    }
-	    dpd_shrink_matrices(dpd, mask);
+	    err = dpd_shrink_matrices(dpd, mask);
 	}
 	free(mask);
     }
@@ -3067,34 +3298,196 @@ static int trim_zero_inst (dpmod *dpd, PRN *prn)
     return err;
 }
 
-/* allocate temporary storage needed by do_units() */
+/* Per-thread workspace for do_units(): each thread handles a
+   contiguous range of panel units.
+*/
+
+typedef struct unit_ws_ unit_ws;
+
+struct unit_ws_ {
+    gretl_matrix *D;   /* for building H (not needed if dpdstyle) */
+    gretl_matrix *H;   /* per-unit H matrix */
+    gretl_matrix *Yi;  /* per-unit dependent variable */
+    gretl_matrix *Xi;  /* per-unit regressors */
+    gretl_matrix *Zi;  /* per-unit instruments */
+    gretl_matrix *A;   /* cumulates \sum Z_i H_i Z_i' */
+    int *cp;           /* column pointers for Zi, compressed */
+    int *zr;           /* row indices of nonzeros in Zi */
+    double *zx;        /* nonzero values in Zi */
+    size_t nnz;        /* stacked nonzeros (sparse case) */
+    size_t nmax;       /* allocated size of sr and sx */
+    int *sr;           /* stacked row indices */
+    double *sx;        /* stacked values */
+};
 
-static int make_units_workspace (dpmod *dpd, gretl_matrix **D,
-				 gretl_matrix **Yi, gretl_matrix **Xi)
+static void free_units_workspace (dpmod *dpd, unit_ws *ws, int i)
 {
-    int err = 0;
+    gretl_matrix_free(ws->D);
+    gretl_matrix_free(ws->Yi);
+    gretl_matrix_free(ws->Xi);
+    free(ws->cp);
+    free(ws->zr);
+    free(ws->zx);
+    free(ws->sr);
+    free(ws->sx);
+
+    if (i > 0) {
+	/* not borrowed from @dpd */
+	if (ws->H != dpd->H) {
+	    gretl_matrix_free(ws->H);
+	}
+	gretl_matrix_free(ws->Zi);
+	gretl_matrix_free(ws->A);
+    }
+}
 
-    if (dpd_style(dpd)) {
+/* allocate temporary storage needed by do_units(): the first
+   workspace borrows H, Zi and A from @dpd
+*/
+
+static int make_units_workspace (dpmod *dpd, unit_ws *ws, int i)
+{
+    int n = dpd->max_ni;
+
+    if (!dpd_style(dpd)) {
 	/* Ox/DPD-style H matrix: D matrix is not needed */
-	*D = NULL;
+	ws->D = gretl_matrix_alloc(dpd->T, n);
+    }
+
+    ws->Yi = gretl_matrix_alloc(1, n);
+    ws->Xi = gretl_matrix_alloc(dpd->k, n);
+    ws->cp = malloc((n + 1) * sizeof *ws->cp);
+    ws->zr = malloc(dpd->nz * n * sizeof *ws->zr);
+    ws->zx = malloc(dpd->nz * n * sizeof *ws->zx);
+
+    if (i == 0) {
+	ws->H = dpd->H;
+	ws->Zi = dpd->Zi;
+	ws->A = dpd->A;
     } else {
-	*D = gretl_matrix_alloc(dpd->T, dpd->max_ni);
-	if (*D == NULL) {
-	    return E_ALLOC;
+	ws->H = dpd_style(dpd) ? dpd->H : gretl_matrix_alloc(n, n);
+	ws->Zi = gretl_matrix_alloc(dpd->nz, n);
+	ws->A = gretl_zero_matrix_new(dpd->nz, dpd->nz);
+    }
+
+    if ((!dpd_style(dpd) && ws->D == NULL) ||
+	ws->Yi == NULL || ws->Xi == NULL || ws->cp == NULL ||
+	ws->zr == NULL || ws->zx == NULL || ws->H == NULL ||
+	ws->Zi == NULL || ws->A == NULL) {
+	return E_ALLOC;
+    }
+
+    return 0;
+}
+
+/* Record the nonzero elements of the per-unit instrument
+   matrix, column by column.
+*/
+
+static void compress_Zi (unit_ws *ws)
+{
+    const double *zj = ws->Zi->val;
+    int r = ws->Zi->rows;
+    int i, j, k = 0;
+
+    for (j=0; j<ws->Zi->cols; j++) {
+	ws->cp[j] = k;
+	for (i=0; i<r; i++) {
+	    if (zj[i] != 0.0) {
+		ws->zr[k] = i;
+		ws->zx[k++] = zj[i];
+	    }
 	}
+	zj += r;
     }
 
-    *Yi = gretl_matrix_alloc(1, dpd->max_ni);
-    *Xi = gretl_matrix_alloc(dpd->k, dpd->max_ni);
+    ws->cp[j] = k;
+}
 
-    if (*Yi == NULL || *Xi == NULL) {
-	gretl_matrix_free(*D);
-	gretl_matrix_free(*Yi);
-	gretl_matrix_free(*Xi);
-	err = E_ALLOC;
+/* A += Z_i H_i Z_i', based on the compressed form of Z_i: the
+   cost depends only on the nonzero elements of Z_i and H_i,
+   which is much less than that of the dense calculation given
+   the block-diagonal structure of GMM-style instruments.
+*/
+
+static void sparse_ZHZ_cumulate (unit_ws *ws)
+{
+    const int *cp = ws->cp;
+    const int *zr = ws->zr;
+    const double *zx = ws->zx;
+    int n = ws->Zi->cols;
+    int nz = ws->A->rows;
+    double h, zh, *Ab;
+    int a, b, c, d;
+
+    for (d=0; d<n; d++) {
+	if (cp[d] == cp[d+1]) {
+	    continue;
+	}
+	for (c=0; c<n; c++) {
+	    h = gretl_matrix_get(ws->H, c, d);
+	    if (h == 0.0 || cp[c] == cp[c+1]) {
+		continue;
+	    }
+	    for (b=cp[d]; b<cp[d+1]; b++) {
+		Ab = ws->A->val + (size_t) zr[b] * nz;
+		zh = h * zx[b];
+		for (a=cp[c]; a<cp[c+1]; a++) {
+		    Ab[zr[a]] += zx[a] * zh;
+		}
+	    }
+	}
     }
+}
 
-    return err;
+/* Write column @k of the per-unit instruments into column @s
+   of the full instrument matrix (or, in the sparse case, onto
+   the workspace stack).
+*/
+
+static int stack_Z_column (dpmod *dpd, unit_ws *ws, int k, int s)
+{
+    int p, p0 = ws->cp[k], p1 = ws->cp[k+1];
+
+    if (dpd->ZT != NULL) {
+	double *zs = dpd->ZT->val + (size_t) s * dpd->nz;
+
+	memset(zs, 0, dpd->nz * sizeof *zs);
+	for (p=p0; p<p1; p++) {
+	    zs[ws->zr[p]] = ws->zx[p];
+	}
+    } else {
+	size_t need = ws->nnz + p1 - p0;
+
+	if (need > ws->nmax) {
+	    size_t nmax = 2 * ws->nmax;
+	    int *sr;
+	    double *sx;
+
+	    if (nmax < need) {
+		nmax = need + 1024;
+	    }
+	    sr = realloc(ws->sr, nmax * sizeof *sr);
+	    if (sr == NULL) {
+		return E_ALLOC;
+	    }
+	    ws->sr = sr;
+	    sx = realloc(ws->sx, nmax * sizeof *sx);
+	    if (sx == NULL) {
+		return E_ALLOC;
+	    }
+	    ws->sx = sx;
+	    ws->nmax = nmax;
+	}
+	for (p=p0; p<p1; p++) {
+	    ws->sr[ws->nnz] = ws->zr[p];
+	    ws->sx[ws->nnz++] = ws->zx[p];
+	}
+	/* just the count for now */
+	dpd->ZS->cp[s+1] = p1 - p0;
+    }
+
+    return 0;
 }
 
 /* Stack the per-unit data matrices from unit @unum for future use,
@@ -3102,28 +3495,25 @@ static int make_units_workspace (dpmod *dpd, gretl_matrix **D,
    observations in differences and in levels.
 */
 
-static void stack_unit_data (dpmod *dpd,
-			     const gretl_matrix *Yi,
-			     const gretl_matrix *Xi,
-			     const gretl_matrix *Zi,
-			     int *goodobs, int unum,
-			     int *row)
+static int stack_unit_data (dpmod *dpd, unit_ws *ws,
+			    int *goodobs, int unum,
+			    int *row)
 {
     unit_info *unit = &dpd->ui[unum];
+    const gretl_matrix *Yi = ws->Yi;
+    const gretl_matrix *Xi = ws->Xi;
     double x;
     int i, j, k, s = *row;
+    int err = 0;
 
-    for (i=2; i<=goodobs[0]; i++) {
+    for (i=2; i<=goodobs[0] && !err; i++) {
 	k = goodobs[i] - dpd->dcolskip;
 	gretl_vector_set(dpd->Y, s, Yi->val[k]);
 	for (j=0; j<Xi->rows; j++) {
 	    x = gretl_matrix_get(Xi, j, k);
 	    gretl_matrix_set(dpd->X, s, j, x);
 	}
-	for (j=0; j<dpd->nz; j++) {
-	    x = gretl_matrix_get(Zi, j, k);
-	    gretl_matrix_set(dpd->ZT, j, s, x);
-	}
+	err = stack_Z_column(dpd, ws, k, s);
 	s++;
     }
 
@@ -3136,7 +3526,7 @@ static void stack_unit_data (dpmod *dpd,
     unit->nobs = (goodobs[0] > 0)? (goodobs[0] - 1) : 0;
 
     if (gmm_sys(dpd)) {
-	for (i=1; i<=goodobs[0]; i++) {
+	for (i=1; i<=goodobs[0] && !err; i++) {
 	    k = goodobs[i] + dpd->lcol0;
 	    if (k >= Yi->cols) {
 		fprintf(stderr, "*** stack_unit_data: reading off "
@@ -3149,10 +3539,7 @@ static void stack_unit_data (dpmod *dpd,
 		x = gretl_matrix_get(Xi, j, k);
 		gretl_matrix_set(dpd->X, s, j, x);
 	    }
-	    for (j=0; j<dpd->nz; j++) {
-		x = gretl_matrix_get(Zi, j, k);
-		gretl_matrix_set(dpd->ZT, j, s, x);
-	    }
+	    err = stack_Z_column(dpd, ws, k, s);
 	    s++;
 	}
 
@@ -3161,16 +3548,109 @@ static void stack_unit_data (dpmod *dpd,
 	unit->nobs += unit->nlev;
     }
 
-#if WRITE_MATRICES
-    gretl_matrix_write_to_file(dpd->ZT, "dpdZT.bin", 0);
+    *row = s;
+
+    return err;
+}
+
+/* Process the panel units from @i0 up to (but not including)
+   @i1, using the workspace @ws. The stacked data for unit i
+   start at row @rowpos[i].
+*/
+
+static int do_unit_range (dpmod *dpd, const DATASET *dset,
+			  int **Goodobs, const int *rowpos,
+			  unit_ws *ws, int i0, int i1)
+{
+#if DPDEBUG
+    char istr[32];
 #endif
+    int i, t, Yrow;
+    int err = 0;
 
-    *row = s;
+    for (i=i0; i<i1 && !err; i++) {
+	int *goodobs = Goodobs[i];
+	int Ti = goodobs[0] - 1;
+
+	if (Ti == 0) {
+	    continue;
+	}
+
+	if (i0 == 0) {
+	    /* the first range stands in for all of them */
+	    err = gretl_progress("dpanel", (double) i * dpd->N / i1, dpd->N);
+	    if (err) {
+		break;
+	    }
+	}
+
+	t = data_index(dpd, i);
+	err = build_Y(dpd, goodobs, dset, t, ws->Yi);
+	if (err) {
+	    break;
+	}
+	build_X(dpd, goodobs, dset, t, ws->Xi);
+	build_Z(dpd, goodobs, dset, t, ws->Zi, i);
+#if DPDEBUG
+	sprintf(istr, "do_units: Y[%d]", i);
+	gretl_matrix_print(ws->Yi, istr);
+	sprintf(istr, "do_units: X[%d]", i);
+	gretl_matrix_print(ws->Xi, istr);
+	sprintf(istr, "do_units: Z[%d]", i);
+	gretl_matrix_print(ws->Zi, istr);
+#endif
+	if (ws->D != NULL) {
+	    build_unit_H_matrix(dpd, goodobs, ws->D, ws->H);
+	}
+	compress_Zi(ws);
+	sparse_ZHZ_cumulate(ws);
+	/* stack the individual data matrices for future use */
+	Yrow = rowpos[i];
+	err = stack_unit_data(dpd, ws, goodobs, i, &Yrow);
+    }
+
+    return err;
+}
+
+/* Complete the sparse instrument matrix: convert the column
+   counts to pointers and gather the nonzeros from the thread
+   workspaces, which hold consecutive ranges of columns.
+*/
+
+static int zsparse_gather (zsparse *zs, unit_ws *ws, int nt)
+{
+    size_t nnz;
+    int i, s;
+
+    for (s=0; s<zs->cols; s++) {
+	zs->cp[s+1] += zs->cp[s];
+    }
+
+    nnz = zs->cp[zs->cols];
+    zs->ri = malloc((nnz + 1) * sizeof *zs->ri);
+    zs->x = malloc((nnz + 1) * sizeof *zs->x);
+    if (zs->ri == NULL || zs->x == NULL) {
+	return E_ALLOC;
+    }
+
+    nnz = 0;
+    for (i=0; i<nt; i++) {
+	if (ws[i].nnz > 0) {
+	    memcpy(zs->ri + nnz, ws[i].sr, ws[i].nnz * sizeof *zs->ri);
+	    memcpy(zs->x + nnz, ws[i].sx, ws[i].nnz * sizeof *zs->x);
+	    nnz += ws[i].nnz;
+	}
+    }
+
+    return 0;
 }
 
 /* Main driver for system GMM: the core is a loop across
    the panel units to build the data and instrument matrices
-   and cumulate A = \sum_i Z_i H_i Z_i'.
+   and cumulate A = \sum_i Z_i H_i Z_i'. The units are
+   independent so this is done on multiple threads if
+   warranted, each thread working through a contiguous
+   range of units and cumulating its own share of A.
 
    At this point we have already done the observations
    accounts, which are recorded in the Goodobs lists.
@@ -3179,25 +3659,38 @@ static void stack_unit_data (dpmod *dpd,
 static int do_units (dpmod *dpd, const DATASET *dset,
 		     int **Goodobs)
 {
-#if DPDEBUG
-    char istr[32];
-#endif
-    gretl_matrix *D = NULL;
-    gretl_matrix *Yi = NULL;
-    gretl_matrix *Xi = NULL;
-    gretl_matrix *Zi = NULL;
-    int i, t, Yrow;
+    unit_ws *ws = NULL;
+    int *rowpos = NULL;
+    int i, nt = 1;
     int err = 0;
 
-    err = make_units_workspace(dpd, &D, &Yi, &Xi);
-    if (err) {
-	return err;
+#if defined(_OPENMP)
+    if (dpd->effN > 1 && gretl_use_openmp((guint64) dpd->totobs * dpd->nz)) {
+	nt = gretl_get_omp_threads();
+	if (nt > dpd->effN) {
+	    nt = dpd->effN;
+	}
+    }
+#endif
+
+    ws = calloc(nt, sizeof *ws);
+    rowpos = malloc((dpd->N + 1) * sizeof *rowpos);
+    if (ws == NULL || rowpos == NULL) {
+	free(ws);
+	free(rowpos);
+	return E_ALLOC;
     }
 
-    Zi = dpd->Zi;
-    gretl_matrix_reuse(Zi, dpd->nz, dpd->max_ni);
+    gretl_matrix_reuse(dpd->Zi, dpd->nz, dpd->max_ni);
+
+    for (i=0; i<nt && !err; i++) {
+	err = make_units_workspace(dpd, &ws[i], i);
+    }
+    if (err) {
+	goto bailout;
+    }
 
-    if (D == NULL) {
+    if (dpd_style(dpd)) {
 	/* the H matrix will not vary by unit */
 	int tau = dpd->t2max - dpd->t1min + 1;
 
@@ -3213,47 +3706,54 @@ static int do_units (dpmod *dpd, const DATASET *dset,
     gretl_matrix_zero(dpd->A);
     gretl_matrix_zero(dpd->ZY);
 
-    /* initialize data stacker */
-    Yrow = 0;
+    /* record the starting row of each unit's stacked data */
+    rowpos[0] = 0;
+    for (i=0; i<dpd->N; i++) {
+	int ng = Goodobs[i][0];
+	int ni = 0;
+
+	if (ng != 1) {
+	    ni = (ng > 1)? ng - 1 : 0;
+	    if (gmm_sys(dpd)) {
+		ni += ng;
+	    }
+	}
+	rowpos[i+1] = rowpos[i] + ni;
+    }
 
 #if DPDEBUG
     /* this should not be necessary if stack_unit_data() is
        working correctly */
     gretl_matrix_zero(dpd->Y);
     gretl_matrix_zero(dpd->X);
-    gretl_matrix_zero(dpd->ZT);
+    if (dpd->ZT != NULL) {
+	gretl_matrix_zero(dpd->ZT);
+    }
 #endif
 
-    for (i=0; i<dpd->N; i++) {
-	int *goodobs = Goodobs[i];
-	int Ti = goodobs[0] - 1;
-
-	if (Ti == 0) {
-	    continue;
-	}
-
-	t = data_index(dpd, i);
-	err = build_Y(dpd, goodobs, dset, t, Yi);
-	if (err) {
-	    break;
-	}
-	build_X(dpd, goodobs, dset, t, Xi);
-	build_Z(dpd, goodobs, dset, t, Zi, i);
-#if DPDEBUG
-	sprintf(istr, "do_units: Y[%d]", i);
-	gretl_matrix_print(Yi, istr);
-	sprintf(istr, "do_units: X[%d]", i);
-	gretl_matrix_print(Xi, istr);
-	sprintf(istr, "do_units: Z[%d]", i);
-	gretl_matrix_print(Zi, istr);
+#if defined(_OPENMP)
+#pragma omp parallel for num_threads(nt) if (nt > 1)
 #endif
-	if (D != NULL) {
-	    build_unit_H_matrix(dpd, goodobs, D);
+    for (i=0; i<nt; i++) {
+	int i0 = (int) ((guint64) dpd->N * i / nt);
+	int i1 = (int) ((guint64) dpd->N * (i + 1) / nt);
+	int ierr;
+
+	ierr = do_unit_range(dpd, dset, Goodobs, rowpos, &ws[i], i0, i1);
+	if (ierr) {
+#if defined(_OPENMP)
+#pragma omp critical (dpd_units_err)
+#endif
+	    err = ierr;
 	}
-	gretl_matrix_qform(Zi, GRETL_MOD_NONE,
-			   dpd->H, dpd->A, GRETL_MOD_CUMULATE);
-	/* stack the individual data matrices for future use */
-	stack_unit_data(dpd, Yi, Xi, Zi, goodobs, i, &Yrow);
+    }
+
+    for (i=1; i<nt && !err; i++) {
+	gretl_matrix_add_to(dpd->A, ws[i].A);
+    }
+
+    if (!err && dpd->ZS != NULL) {
+	err = zsparse_gather(dpd->ZS, ws, nt);
     }
 
 #if DPDEBUG
@@ -3265,11 +3765,18 @@ static int do_units (dpmod *dpd, const DATASET *dset,
 #if WRITE_MATRICES
     gretl_matrix_write_to_file(dpd->Y, "dpdY.bin", 0);
     gretl_matrix_write_to_file(dpd->X, "dpdX.bin", 0);
+    if (dpd->ZT != NULL) {
+	gretl_matrix_write_to_file(dpd->ZT, "dpdZT.bin", 0);
+    }
 #endif
 
-    gretl_matrix_free(D);
-    gretl_matrix_free(Yi);
-    gretl_matrix_free(Xi);
+ bailout:
+
+    for (i=0; i<nt; i++) {
+	free_units_workspace(dpd, &ws[i], i);
+    }
+    free(ws);
+    free(rowpos);
 
     return err;
 }
@@ -145,31 +145,40 @@ static int wf1_read_history (FILE *fp, unsigned pos,
     return 0;
 }
 
-#if EVDEBUG
+/* Record of an EViews series as found in the workfile's
+   directory of objects: enough to locate its data and history
+   without reading them.
+*/
 
-static void print_bytes (FILE *fp, unsigned pos, int n)
-{
-    unsigned char u;
-    int i;
+typedef struct wf1_series_ wf1_series;
 
-    fprintf(stderr, "%d bytes at 0x%x: ", n, pos);
-    fseek(fp, pos, SEEK_SET);
+struct wf1_series_ {
+    char name[32];    /* name of the series */
+    unsigned datpos;  /* stream position of data record */
+    unsigned size;    /* size of the data block, in bytes */
+    unsigned histpos; /* stream position of history, or 0 */
+    int wanted;       /* to be imported? */
+};
 
-    for (i=0; i<n; i++) {
-	fread(&u, sizeof u, 1, fp);
-	fprintf(stderr, " %03d", (int) u);
-    }	
-    fputc('\n', stderr);
+#define WF1_OBJLEN 70
+
+/* little-endian integers from a directory record in memory */
+
+static int rec_short (const unsigned char *rec, int pos)
+{
+    return rec[pos] | (rec[pos+1] << 8);
 }
 
-#endif
+static unsigned rec_unsigned (const unsigned char *rec, int pos)
+{
+    return (unsigned) rec[pos] | ((unsigned) rec[pos+1] << 8) |
+	((unsigned) rec[pos+2] << 16) | ((unsigned) rec[pos+3] << 24);
+}
 
-static int wf1_read_values (FILE *fp, int ftype, 
-			    unsigned pos, unsigned sz,
-			    DATASET *dset, int i, int k)
+static int wf1_read_values (FILE *fp, unsigned pos, unsigned sz,
+			    DATASET *dset, int i)
 {
-    double x;
-    unsigned xpos;
+    double *x = dset->Z[i];
     int t, nobs = 0;
     int err = 0;
 
@@ -179,10 +188,9 @@ static int wf1_read_values (FILE *fp, int ftype,
 	return 1;
     }
 
-    fprintf(stderr, "got nobs = %d\n", nobs);
     if (nobs != dset->n) {
-	fputs("problem: this does not match the specification "
-	      " for the dataset\n", stderr);
+	fprintf(stderr, "%s: got nobs = %d; this does not match the "
+		"specification for the dataset\n", dset->varname[i], nobs);
     }
 
     if (sz != nobs * sizeof(double)) {
@@ -195,160 +203,195 @@ static int wf1_read_values (FILE *fp, int ftype,
 	/* give up */
 	return 1;
 #endif
-    }    
-
-#if EVDEBUG
-    fprintf(stderr, "following ints:");
-    for (t=0; t<4; t++) {
-	fprintf(stderr, " %d", read_int(fp, &err));
     }
-    fprintf(stderr, ", %d", read_short(fp, &err));
-    fputc('\n', stderr);
-#endif
-
-    xpos = pos + 22;
 
     if (nobs > dset->n) {
 	/* don't overflow the Z array */
 	nobs = dset->n;
     }
 
-#if EVDEBUG
-    if (k != 11) {
-	print_bytes(fp, xpos, 8);
+    /* the doubles are contiguous, following a 22-byte header */
+    fseek(fp, pos + 22, SEEK_SET);
+    if (fread(x, sizeof *x, nobs, fp) != nobs) {
+	wf1_error(&err);
+	return err;
     }
-#endif
 
-    fseek(fp, xpos, SEEK_SET);
-    fprintf(stderr, "reading doubles at 0x%x (%d)\n", xpos, (int) xpos);
-    for (t=0; t<nobs && !err; t++) {
-	x = read_double(fp, &err);
-	if (!err) {
-	    dset->Z[i][t] = x;
+    for (t=0; t<nobs; t++) {
+#if WORDS_BIGENDIAN
+	reverse_double(x[t]);
+#endif
+	if (x[t] == WF1_NA) {
+	    x[t] = NADBL;
 	}
     }
 
-    return err;
+    return 0;
 }
 
-static int read_wf1_variables (FILE *fp, int ftype, unsigned pos, 
-			       DATASET *dset, int *nvread, 
-			       PRN *prn)
+/* Pass through the directory of objects in the workfile, starting
+   at @pos, recording the name and data location of each series
+   that we're able to read. Nothing is read from the data records
+   themselves at this stage.
+*/
+
+static wf1_series *wf1_read_directory (FILE *fp, unsigned pos, int nv,
+				       int *nser, PRN *prn, int *err)
 {
-    int nv = dset->v + 1; /* allow for "RESID" */
+    wf1_series *ser;
+    unsigned char rec[WF1_OBJLEN];
     char vname[32];
-    short code = 0;
-    unsigned u, sz;
-    int i, k, j = 0;
-    int obj = 1;
-    int err = 0;
+    int code, k, i, j = 0;
+
+    ser = calloc(nv, sizeof *ser);
+    if (ser == NULL) {
+	*err = E_ALLOC;
+	return NULL;
+    }
 
     fseek(fp, pos + 62, SEEK_SET);
-    code = read_short(fp, &err);
+    code = read_short(fp, err);
     if (code == 0) {
 	fprintf(stderr, "Did not get sensible code: skipping 32 bytes\n");
 	pos += 32;
     }
 
-    for (i=0; i<nv && !err; i++, pos += 70) {
-	int discard = 0;
+    for (i=0; i<nv && !*err; i++, pos += WF1_OBJLEN) {
+	fseek(fp, pos, SEEK_SET);
+	if (fread(rec, 1, WF1_OBJLEN, fp) != WF1_OBJLEN) {
+	    wf1_error(err);
+	    break;
+	}
 
-	/* read the 'code' for the 'object' (should be 44 for a regular
+	/* the 'code' for the 'object' (should be 44 for a regular
 	   variable?) */
-	fseek(fp, pos + 62, SEEK_SET);
-	code = read_short(fp, &err);
-	if (code != 44) {
-	    discard = 1;
-	}
+	code = rec_short(rec, 62);
 
-	/* grab the object name */
-	fseek(fp, pos + 22, SEEK_SET);
-	*vname = '\0';
-	if (fscanf(fp, "%31s", vname) != 1) {
-	    err = E_DATA;
+	/* the object name, starting at byte 22 */
+	memcpy(vname, rec + 22, 31);
+	vname[31] = '\0';
+	if (sscanf(vname, "%31s", ser[j].name) != 1) {
+	    *err = E_DATA;
 	    break;
 	}
-	    
-	if (!strcmp(vname, "C") || !strcmp(vname, "RESID")) {
-	    discard = 1;
-	}
 
-	fprintf(stderr, "\n*** object %d (type %d), '%s', at 0x%x (%d)\n", obj++, 
-		(int) code, vname, pos, (int) pos);
+#if EVDEBUG
+	fprintf(stderr, "\n*** object %d (type %d), '%s', at 0x%x (%d)\n",
+		i + 1, code, ser[j].name, pos, (int) pos);
+#endif
 
-	if (discard) {
-	    fprintf(stderr, "Discarding '%s'\n", vname);
+	if (code != 44 || !strcmp(ser[j].name, "C") ||
+	    !strcmp(ser[j].name, "RESID")) {
+#if EVDEBUG
+	    fprintf(stderr, "Discarding '%s'\n", ser[j].name);
+#endif
 	    continue;
 	}
 
 	/* storage type code? */
-	fseek(fp, pos + 4, SEEK_SET);
-	k = read_short(fp, &err);
+	k = rec_short(rec, 4);
 	if (k != 11) {
-#if EVDEBUG
-	    fprintf(stderr, "unknown data storage method %d\n", (int) k);
-#else
-	    pputs(prn, "unknown data storage method, skipping\n");
+	    pprintf(prn, "%s: unknown data storage method, skipping\n",
+		    ser[j].name);
 	    continue;
-#endif
 	}
 
-	dset->varname[++j][0] = 0;
-	strncat(dset->varname[j], vname, VNAMELEN - 1);
-
-	fseek(fp, pos + 6, SEEK_SET);
-	sz = read_unsigned(fp, &err);
-	fprintf(stderr, "data record size: %d\n", (int) sz);
-	fseek(fp, pos + 10, SEEK_SET);
-	sz = read_unsigned(fp, &err);
-	fprintf(stderr, "data block size: %d\n", (int) sz);
+	/* data block size, and stream positions for the data
+	   and history */
+	ser[j].size = rec_unsigned(rec, 10);
+	ser[j].datpos = rec_unsigned(rec, 14);
+	ser[j].histpos = rec_unsigned(rec, 54);
 
-#if EVDEBUG
-	fprintf(stderr, "first 6 bytes as shorts:");
-	fseek(fp, pos, SEEK_SET);
-	for (k=0; k<3; k++) {
-	    fprintf(stderr, " %d", read_short(fp, &err));
-	}
-	fputc('\n', stderr);
-	fprintf(stderr, "last 6 bytes as shorts:");
-	fseek(fp, pos + 64, SEEK_SET);
-	for (k=0; k<3; k++) {
-	    fprintf(stderr, " %d", read_short(fp, &err));
-	}
-	fputc('\n', stderr);
-#endif
-
-	/* get stream position for the data */
-	fseek(fp, pos + 14, SEEK_SET);
-	u = read_unsigned(fp, &err);
-	if (u > 0) {
-	    /* follow up at the pos given above, if non-zero */
-	    fprintf(stderr, "data record at 0x%x (%d)\n", u, (int) u);
-	    err = wf1_read_values(fp, ftype, u, sz, dset, j, k);
-	} else {
-	    fputs("Couldn't find the data: skipping this variable\n", stderr);
+	if (ser[j].datpos == 0) {
+	    fprintf(stderr, "%s: couldn't find the data, skipping\n",
+		    ser[j].name);
 	    continue;
 	}
 
-	if (!err) {
-	    /* stream position for history */
-	    fseek(fp, pos + 54, SEEK_SET);
-	    u = read_unsigned(fp, &err);
-	    if (u > 0) {
-		fprintf(stderr, "Reading history block at 0x%x\n", (unsigned) u);
-		wf1_read_history(fp, u, dset, j);
+	ser[j++].wanted = 1;
+    }
+
+    *nser = j;
+
+    if (!*err && j == 0) {
+	pputs(prn, _("No variables were read\n"));
+	*err = E_DATA;
+    }
+
+    if (*err) {
+	free(ser);
+	ser = NULL;
+    }
+
+    return ser;
+}
+
+/* Mark for import only the series selected by name (@S, of length
+   @ns) or by position among the readable series (the gretl list
+   @cols); return the number selected or -1 on error.
+*/
+
+static int wf1_apply_selection (wf1_series *ser, int nser,
+				char **S, int ns, const int *cols)
+{
+    int i, k, nsel = 0;
+
+    for (i=0; i<nser; i++) {
+	ser[i].wanted = 0;
+    }
+
+    if (S != NULL) {
+	for (k=0; k<ns; k++) {
+	    for (i=0; i<nser; i++) {
+		if (!strcmp(ser[i].name, S[k])) {
+		    break;
+		}
 	    }
+	    if (i == nser) {
+		gretl_errmsg_sprintf(_("Variable '%s' not found"), S[k]);
+		return -1;
+	    }
+	    ser[i].wanted = 1;
+	}
+    } else if (cols != NULL) {
+	for (k=1; k<=cols[0]; k++) {
+	    if (cols[k] < 1 || cols[k] > nser) {
+		gretl_errmsg_sprintf(_("Variable %d not found"), cols[k]);
+		return -1;
+	    }
+	    ser[cols[k]-1].wanted = 1;
 	}
     }
 
-    *nvread = j;
+    for (i=0; i<nser; i++) {
+	nsel += ser[i].wanted;
+    }
 
-    fprintf(stderr, "actual number of variables read = %d\n", *nvread);
+    return nsel;
+}
 
-    if (*nvread == 0) {
-	pputs(prn, _("No variables were read\n"));
-	err = E_DATA;
-    } 
+/* Read the data (and history, if any) for the wanted series:
+   we seek directly to each one, skipping the rest.
+*/
+
+static int read_wf1_variables (FILE *fp, const wf1_series *ser,
+			       int nser, DATASET *dset)
+{
+    int i, j = 0;
+    int err = 0;
+
+    for (i=0; i<nser && !err; i++) {
+	if (!ser[i].wanted) {
+	    continue;
+	}
+	j++;
+	dset->varname[j][0] = 0;
+	strncat(dset->varname[j], ser[i].name, VNAMELEN - 1);
+	err = wf1_read_values(fp, ser[i].datpos, ser[i].size, dset, j);
+	if (!err && ser[i].histpos > 0) {
+	    wf1_read_history(fp, ser[i].histpos, dset, j);
+	}
+    }
 
     return err;
 }
@@ -492,13 +535,15 @@ static int wf1_check_file_type (FILE *fp)
     return ftype;
 }
 
-int wf1_get_data (const char *fname, DATASET *dset,
-		  gretlopt opt, PRN *prn)
+static int real_wf1_get_data (const char *fname, DATASET *dset,
+			      char **S, int ns, const int *cols,
+			      gretlopt opt, PRN *prn)
 {
     FILE *fp;
     DATASET *newset = NULL;
+    wf1_series *ser = NULL;
     unsigned offset;
-    int nvread, ftype;
+    int nser = 0, ftype;
     int err = 0;
 
     fp = gretl_fopen(fname, "rb");
@@ -533,25 +578,44 @@ int wf1_get_data (const char *fname, DATASET *dset,
 	return err;
     }
 
+    /* allow for "RESID" in the directory */
+    ser = wf1_read_directory(fp, offset, newset->v + 1, &nser,
+			     prn, &err);
+
+    if (!err && (S != NULL || cols != NULL)) {
+	int nsel = wf1_apply_selection(ser, nser, S, ns, cols);
+
+	if (nsel <= 0) {
+	    err = E_DATA;
+	} else {
+	    newset->v = nsel + 1;
+	}
+    } else if (!err) {
+	newset->v = nser + 1;
+    }
+
+    if (err) {
+	free_datainfo(newset);
+	free(ser);
+	fclose(fp);
+	return err;
+    }
+
     err = start_new_Z(newset, 0);
     if (err) {
 	pputs(prn, _("Out of memory\n"));
 	free_datainfo(newset);
+	free(ser);
 	fclose(fp);
 	return E_ALLOC;
-    }	
+    }
 
-    err = read_wf1_variables(fp, ftype, offset, newset, &nvread, prn);
+    err = read_wf1_variables(fp, ser, nser, newset);
 
     if (err) {
 	destroy_dataset(newset);
     } else {
 	int merge = (dset->Z != NULL);
-	int nvtarg = newset->v - 1;
-
-	if (nvread < nvtarg) {
-	    dataset_drop_last_variables(newset, nvtarg - nvread);
-	}
 
 	if (fix_varname_duplicates(newset)) {
 	    pputs(prn, _("warning: some variable names were duplicated\n"));
@@ -565,7 +629,27 @@ int wf1_get_data (const char *fname, DATASET *dset,
 	}
     }
 
+    free(ser);
     fclose(fp);
 
     return err;
-}  
+}
+
+int wf1_get_data (const char *fname, DATASET *dset,
+		  gretlopt opt, PRN *prn)
+{
+    return real_wf1_get_data(fname, dset, NULL, 0, NULL, opt, prn);
+}
+
+/* Import only the series selected by name (@S, of length @ns) or
+   by position (the gretl list @cols); exactly one of @S and @cols
+   should be non-NULL. Only the directory of the workfile is
+   scanned in full; the data for unselected series are skipped.
+*/
+
+int wf1_get_data_subset (const char *fname, DATASET *dset,
+			 char **S, int ns, const int *cols,
+			 gretlopt opt, PRN *prn)
+{
+    return real_wf1_get_data(fname, dset, S, ns, cols, opt, prn);
+}
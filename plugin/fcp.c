@@ -281,6 +281,83 @@ get_yhat (const double **X, int n, int t, const double *a)
     return yhat;
 }
 
+/* Variance recursions for the commonest orders, with the lags
+   unrolled. Each fills h over t1 to t2 and accumulates the sums
+   of log(h) and e^2/h in the same pass, in sums[0] and sums[1]
+   respectively. The suffix gives the number of ARCH terms
+   followed by the number of GARCH terms.
+*/
+
+static void garch_ht_11 (double *h, const double *e2, int t1, int t2,
+			 double a0, const double *alpha,
+			 const double *beta, double *sums)
+{
+    double a1 = alpha[0], b1 = beta[0];
+    double ht, h1 = h[t1-1];
+    double slh = 0.0, se2h = 0.0;
+    int t;
+
+    for (t=t1; t<=t2; t++) {
+	ht = a0 + a1 * e2[t-1] + b1 * h1;
+	if (ht <= 0.0) {
+	    ht = SMALL_HT;
+	}
+	h[t] = h1 = ht;
+	slh += log(ht);
+	se2h += e2[t] / ht;
+    }
+
+    sums[0] = slh;
+    sums[1] = se2h;
+}
+
+static void garch_ht_12 (double *h, const double *e2, int t1, int t2,
+			 double a0, const double *alpha,
+			 const double *beta, double *sums)
+{
+    double a1 = alpha[0], b1 = beta[0], b2 = beta[1];
+    double ht, h1 = h[t1-1], h2 = h[t1-2];
+    double slh = 0.0, se2h = 0.0;
+    int t;
+
+    for (t=t1; t<=t2; t++) {
+	ht = a0 + a1 * e2[t-1] + b1 * h1 + b2 * h2;
+	if (ht <= 0.0) {
+	    ht = SMALL_HT;
+	}
+	h2 = h1;
+	h[t] = h1 = ht;
+	slh += log(ht);
+	se2h += e2[t] / ht;
+    }
+
+    sums[0] = slh;
+    sums[1] = se2h;
+}
+
+static void garch_ht_21 (double *h, const double *e2, int t1, int t2,
+			 double a0, const double *alpha,
+			 const double *beta, double *sums)
+{
+    double a1 = alpha[0], a2 = alpha[1], b1 = beta[0];
+    double ht, h1 = h[t1-1];
+    double slh = 0.0, se2h = 0.0;
+    int t;
+
+    for (t=t1; t<=t2; t++) {
+	ht = a0 + a1 * e2[t-1] + a2 * e2[t-2] + b1 * h1;
+	if (ht <= 0.0) {
+	    ht = SMALL_HT;
+	}
+	h[t] = h1 = ht;
+	slh += log(ht);
+	se2h += e2[t] / ht;
+    }
+
+    sums[0] = slh;
+    sums[1] = se2h;
+}
+
 /* Compute the GARCH log-likelihood.  Params are passed in f->theta;
    e, e2 and ht are computed here (e2 holds squared residuals).
 */
@@ -294,8 +371,8 @@ static double garch_ll (fcpinfo *f)
     int nc = f->nc;
     int i, t, lag;
     int n = t2 - t1 + 1;
-    double uncvar, ll;
-    double scale2, hts;
+    double uncvar, ll, ht;
+    double sums[2];
 
     const double *alpha = f->theta + nc + 1;
     const double *beta = alpha + q;
@@ -338,31 +415,39 @@ static double garch_ll (fcpinfo *f)
 	f->e2[t] = f->h[t] = uncvar;
     }
 
-    for (t=t1; t<=t2; t++) {
-	f->h[t] = f->theta[nc];
-	for (i=1; i<=q; i++) {
-	    f->h[t] += f->e2[t-i] * alpha[i-1];
-	}
-	for (i=1; i<=p; i++) {
-	    f->h[t] += f->h[t-i] * beta[i-1];
-	}
-	/* arbitrary */
-	if (f->h[t] <= 0.0) {
-	    f->h[t] = SMALL_HT;
+    if (q == 1 && p == 1) {
+	garch_ht_11(f->h, f->e2, t1, t2, f->theta[nc], alpha, beta, sums);
+    } else if (q == 1 && p == 2) {
+	garch_ht_12(f->h, f->e2, t1, t2, f->theta[nc], alpha, beta, sums);
+    } else if (q == 2 && p == 1) {
+	garch_ht_21(f->h, f->e2, t1, t2, f->theta[nc], alpha, beta, sums);
+    } else {
+	sums[0] = sums[1] = 0.0;
+	for (t=t1; t<=t2; t++) {
+	    ht = f->theta[nc];
+	    for (i=1; i<=q; i++) {
+		ht += f->e2[t-i] * alpha[i-1];
+	    }
+	    for (i=1; i<=p; i++) {
+		ht += f->h[t-i] * beta[i-1];
+	    }
+	    /* arbitrary */
+	    if (ht <= 0.0) {
+		ht = SMALL_HT;
+	    }
+	    f->h[t] = ht;
+	    sums[0] += log(ht);
+	    sums[1] += f->e2[t] / ht;
 	}
     }
 
-    ll = 0.0;
-    scale2 = f->scale * f->scale;
-
 #if FDEBUG
-    fprintf(stderr, " re-scaled uncvar = %g\n", uncvar * scale2);
+    fprintf(stderr, " re-scaled uncvar = %g\n", uncvar * f->scale * f->scale);
 #endif
 
-    for (t=t1; t<=t2; t++) {
-	hts = f->h[t] * scale2;
-	ll -= 0.5 * log(hts) + 0.5 * f->e2[t] / f->h[t] + LN_SQRT_2_PI;
-    }
+    /* the scale factor enters only via a constant term */
+    ll = -0.5 * (sums[0] + sums[1]);
+    ll -= n * (log(f->scale) + LN_SQRT_2_PI);
 
     return ll;
 }
@@ -21,6 +21,11 @@
 #include "gretl_matrix.h"
 #include "system.h"
 #include "sysml.h"
+#include "gretl_mt.h"
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
 
 #define FDEBUG 0
 
@@ -39,17 +44,24 @@ struct fiml_system_ {
 
     gretl_matrix *uhat;   /* structural-form residuals, all equations */
     gretl_matrix *sigma;  /* cross-equation covariance matrix */
-    gretl_matrix *psi;    /* Cholesky decomp of sigma-inverse */
-    gretl_matrix *Stmp;   /* workspace */
+    gretl_matrix *Stmp;   /* sigma-inverse */
 
     gretl_matrix *G;      /* Gamma matrix: coeffs for endogenous vars */
     gretl_matrix *B;      /* coeffs for exogenous and predetermined vars */
     gretl_matrix *Gtmp;   /* workspace */
 
-    gretl_vector *arty;   /* stacked gn-vector: LHS of artificial regression */
-    gretl_matrix *artx;   /* stacked matrix of transformed indep vars: RHS */
+    gretl_matrix *Y;      /* data on endogenous vars */
+    gretl_matrix *W;      /* data on exogenous and predetermined vars */
+    gretl_matrix *YG;     /* endog vars times Gamma */
+    gretl_matrix *Xbar;   /* per-equation regressors, instrumented */
+    gretl_matrix *US;     /* residuals times sigma-inverse */
+    gretl_matrix *XSX;    /* normal matrix of artificial regression */
+    gretl_matrix *Xa;     /* workspace for solution, maybe augmented */
+    gretl_matrix *ba;     /* workspace for solution, maybe augmented */
     gretl_matrix *artb;   /* coefficient vector from artificial regression */
     gretl_matrix *btmp;   /* workspace */
+    int *xeq;             /* equation to which each regressor belongs */
+    int *xsrc;            /* column of W (>= 0) or WB2 (< 0) per regressor */
 
     gretl_matrix *WB1;    /* exog vars times coeffs */
     gretl_matrix *WB2;    /* exog vars times coeffs, times Gamma-inverse */
@@ -61,17 +73,24 @@ static void fiml_system_destroy (fiml_system *fsys)
 {
     gretl_matrix_free(fsys->uhat);
     gretl_matrix_free(fsys->sigma);
-    gretl_matrix_free(fsys->psi);
     gretl_matrix_free(fsys->Stmp);
 
     gretl_matrix_free(fsys->G);
     gretl_matrix_free(fsys->B);
     gretl_matrix_free(fsys->Gtmp);
 
-    gretl_vector_free(fsys->arty);
-    gretl_matrix_free(fsys->artx);
+    gretl_matrix_free(fsys->Y);
+    gretl_matrix_free(fsys->W);
+    gretl_matrix_free(fsys->YG);
+    gretl_matrix_free(fsys->Xbar);
+    gretl_matrix_free(fsys->US);
+    gretl_matrix_free(fsys->XSX);
+    gretl_matrix_free(fsys->Xa);
+    gretl_vector_free(fsys->ba);
     gretl_vector_free(fsys->artb);
     gretl_vector_free(fsys->btmp);
+    free(fsys->xeq);
+    free(fsys->xsrc);
 
     gretl_matrix_free(fsys->WB1);
     gretl_matrix_free(fsys->WB2);
@@ -79,11 +98,71 @@ static void fiml_system_destroy (fiml_system *fsys)
     free(fsys);
 }
 
-static fiml_system *fiml_system_new (equation_system *sys, int *err)
+static int on_exo_list (const int *exlist, int v);
+
+static int endo_var_number (const int *enlist, int v);
+
+/* record the equation to which each regressor belongs, and where
+   its data are to be found: in W if it's exogenous, otherwise in
+   the instrumented endogenous variables, WB2
+*/
+
+static void fiml_map_regressors (fiml_system *fsys)
+{
+    const int *enlist = system_get_endog_vars(fsys->sys);
+    const int *exlist = system_get_instr_vars(fsys->sys);
+    int i, j, v, k = 0;
+
+    for (i=0; i<fsys->g; i++) {
+	const int *list = system_get_list(fsys->sys, i);
+
+	for (j=2; j<=list[0]; j++) {
+	    fsys->xeq[k] = i;
+	    if (on_exo_list(exlist, list[j])) {
+		for (v=1; v<=exlist[0]; v++) {
+		    if (exlist[v] == list[j]) {
+			fsys->xsrc[k] = v - 1;
+			break;
+		    }
+		}
+	    } else {
+		fsys->xsrc[k] = -1 - endo_var_number(enlist, list[j]);
+	    }
+	    k++;
+	}
+    }
+}
+
+/* copy the data on the endogenous and exogenous variables into
+   matrix form, once and for all
+*/
+
+static void fiml_fill_data (fiml_system *fsys, const DATASET *dset,
+			    int t1)
+{
+    const int *enlist = system_get_endog_vars(fsys->sys);
+    const int *exlist = system_get_instr_vars(fsys->sys);
+    size_t sz = fsys->n * sizeof(double);
+    int i;
+
+    for (i=0; i<fsys->nendo; i++) {
+	memcpy(fsys->Y->val + (size_t) i * fsys->n,
+	       dset->Z[enlist[i + 1]] + t1, sz);
+    }
+    for (i=0; i<fsys->nexo; i++) {
+	memcpy(fsys->W->val + (size_t) i * fsys->n,
+	       dset->Z[exlist[i + 1]] + t1, sz);
+    }
+}
+
+static fiml_system *fiml_system_new (equation_system *sys,
+				     const DATASET *dset,
+				     int *err)
 {
     fiml_system *fsys;
     int *endog_vars;
     int *exog_vars;
+    int nr = 0;
 
     endog_vars = system_get_endog_vars(sys);
     exog_vars = system_get_instr_vars(sys);
@@ -112,17 +191,24 @@ static fiml_system *fiml_system_new (equation_system *sys, int *err)
 
     fsys->uhat = NULL;
     fsys->sigma = NULL;
-    fsys->psi = NULL;
     fsys->Stmp = NULL;
 
     fsys->G = NULL;
     fsys->B = NULL;
     fsys->Gtmp = NULL;
 
-    fsys->arty = NULL;
-    fsys->artx = NULL;
+    fsys->Y = NULL;
+    fsys->W = NULL;
+    fsys->YG = NULL;
+    fsys->Xbar = NULL;
+    fsys->US = NULL;
+    fsys->XSX = NULL;
+    fsys->Xa = NULL;
+    fsys->ba = NULL;
     fsys->artb = NULL;
     fsys->btmp = NULL;
+    fsys->xeq = NULL;
+    fsys->xsrc = NULL;
 
     fsys->WB1 = NULL;
     fsys->WB2 = NULL;
@@ -131,25 +217,42 @@ static fiml_system *fiml_system_new (equation_system *sys, int *err)
 
     fsys->uhat = gretl_matrix_alloc(fsys->n, fsys->g);
     fsys->sigma = gretl_matrix_alloc(fsys->g, fsys->g);
-    fsys->psi = gretl_matrix_alloc(fsys->g, fsys->g);
     fsys->Stmp = gretl_matrix_alloc(fsys->g, fsys->g);
 
     fsys->G = gretl_matrix_alloc(fsys->nendo, fsys->nendo);
     fsys->B = gretl_matrix_alloc(fsys->nexo, fsys->nendo);
     fsys->Gtmp = gretl_matrix_alloc(fsys->nendo, fsys->nendo);
 
-    fsys->arty = gretl_column_vector_alloc(fsys->gn);
-    fsys->artx = gretl_matrix_alloc(fsys->gn, fsys->totk);
+    if ((sys->flags & SYSTEM_RESTRICT) && sys->R != NULL) {
+	nr = sys->R->rows;
+    }
+
+    fsys->Y = gretl_matrix_alloc(fsys->n, fsys->nendo);
+    fsys->W = gretl_matrix_alloc(fsys->n, fsys->nexo);
+    fsys->YG = gretl_matrix_alloc(fsys->n, fsys->nendo);
+    fsys->Xbar = gretl_matrix_alloc(fsys->n, fsys->totk);
+    fsys->US = gretl_matrix_alloc(fsys->n, fsys->g);
+    fsys->XSX = gretl_matrix_alloc(fsys->totk, fsys->totk);
+    fsys->Xa = gretl_matrix_alloc(fsys->totk + nr, fsys->totk + nr);
+    fsys->ba = gretl_column_vector_alloc(fsys->totk + nr);
     fsys->artb = gretl_column_vector_alloc(fsys->totk);
     fsys->btmp = gretl_column_vector_alloc(fsys->totk);
 
     fsys->WB1 = gretl_matrix_alloc(fsys->n, fsys->nendo);
     fsys->WB2 = gretl_matrix_alloc(fsys->n, fsys->nendo);
 
-    if (get_gretl_matrix_err()) {
+    fsys->xeq = malloc(fsys->totk * sizeof *fsys->xeq);
+    fsys->xsrc = malloc(fsys->totk * sizeof *fsys->xsrc);
+
+    if (get_gretl_matrix_err() || fsys->xeq == NULL ||
+	fsys->xsrc == NULL) {
 	fiml_system_destroy(fsys);
-	fsys = NULL;
-    }	
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    fiml_map_regressors(fsys);
+    fiml_fill_data(fsys, dset, dset->t1);
 
     return fsys;
 }
@@ -238,32 +341,22 @@ static int fiml_overid_test (fiml_system *fsys, DATASET *dset)
 
 /* calculate FIML residuals as YG - WB */
 
-static void fiml_form_uhat (fiml_system *fsys, 
-			    const DATASET *dset, 
-			    int t1)
+static void fiml_form_uhat (fiml_system *fsys)
 {
-    const int *enlist = system_get_endog_vars(fsys->sys);
-    const int *exlist = system_get_instr_vars(fsys->sys);
-    double bij, gij;
-    double y, x;
-    int i, j, t;
+    int n = fsys->n;
+    int j;
 
-    for (j=0; j<fsys->nendo; j++) {
-	for (t=0; t<fsys->n; t++) {
-	    y = 0.0;
-	    for (i=0; i<fsys->nendo; i++) {
-		gij = gretl_matrix_get(fsys->G, i, j);
-		y += dset->Z[enlist[i + 1]][t + t1] * gij;
-	    }
-	    x = 0.0;
-	    for (i=0; i<fsys->nexo; i++) {
-		bij = gretl_matrix_get(fsys->B, i, j);
-		x += dset->Z[exlist[i + 1]][t + t1] * bij;
-	    } 
-	    gretl_matrix_set(fsys->WB1, t, j, x);
-	    if (j < fsys->g) {
-		gretl_matrix_set(fsys->uhat, t, j, y - x);
-	    }	
+    gretl_matrix_multiply(fsys->Y, fsys->G, fsys->YG);
+    gretl_matrix_multiply(fsys->W, fsys->B, fsys->WB1);
+
+    for (j=0; j<fsys->g; j++) {
+	const double *yg = fsys->YG->val + (size_t) j * n;
+	const double *wb = fsys->WB1->val + (size_t) j * n;
+	double *u = fsys->uhat->val + (size_t) j * n;
+	int t;
+
+	for (t=0; t<n; t++) {
+	    u[t] = yg[t] - wb[t];
 	}
     }
 
@@ -273,18 +366,15 @@ static void fiml_form_uhat (fiml_system *fsys,
 }
 
 /* use the full residuals matrix to form the cross-equation covariance
-   matrix; then invert this and do a Cholesky decomposition to find
-   psi-transpose
+   matrix, and invert it
 */ 
 
-static int 
-fiml_form_sigma_and_psi (fiml_system *fsys, const DATASET *dset, 
-			 int t1)
+static int fiml_form_sigma (fiml_system *fsys)
 {
     int err;
 
     /* YG - WB */
-    fiml_form_uhat(fsys, dset, t1);
+    fiml_form_uhat(fsys);
 
     /* Davidson and MacKinnon, ETM, equation (12.81) */
 
@@ -299,22 +389,12 @@ fiml_form_sigma_and_psi (fiml_system *fsys, const DATASET *dset,
 #endif
 
     if (!err) {
-	gretl_matrix_copy_values(fsys->psi, fsys->sigma);
-	err = gretl_invert_symmetric_matrix(fsys->psi);
+	gretl_matrix_copy_values(fsys->Stmp, fsys->sigma);
+	err = gretl_invert_symmetric_matrix(fsys->Stmp);
     }
 
 #if FDEBUG
-    gretl_matrix_print(fsys->psi, "Sigma-inverse");
-#endif
-
-    if (!err) {
-	err = gretl_matrix_cholesky_decomp(fsys->psi);
-	/* we actually want the transpose of psi (ETM, under eq (12.86) */
-	gretl_square_matrix_transpose(fsys->psi);
-    }
-
-#if FDEBUG
-    gretl_matrix_print(fsys->psi, "fiml Psi-transpose");
+    gretl_matrix_print(fsys->Stmp, "Sigma-inverse");
 #endif
 
     return err;
@@ -364,33 +444,6 @@ fiml_transcribe_results (fiml_system *fsys, const DATASET *dset,
     fsys->sys->iters = iters;
 }
 
-/* form the LHS stacked vector for the artificial regression */
-
-static void fiml_form_depvar (fiml_system *fsys)
-{
-    double u, p, x;
-    int i, j, k, t;
-
-    k = 0;
-    for (i=0; i<fsys->g; i++) { 
-	/* loop across equations */
-	for (t=0; t<fsys->n; t++) { 
-	    /* loop across observations */
-	    x = 0.0;
-	    for (j=0; j<fsys->g; j++) {
-		p = gretl_matrix_get(fsys->psi, i, j);
-		u = gretl_matrix_get(fsys->uhat, t, j);
-		x += p * u;
-	    }
-	    gretl_vector_set(fsys->arty, k++, x);
-	}
-    }
-
-#if FDEBUG > 1
-    gretl_matrix_print(fsys->arty, "fiml artificial Y");
-#endif
-}
-
 static int on_exo_list (const int *exlist, int v)
 {
     int i;
@@ -413,60 +466,143 @@ static int endo_var_number (const int *enlist, int v)
     return -1;
 }
 
-/* form the RHS matrix for the artificial regression */
+/* Form the normal equations for the artificial regression of
+   Davidson and MacKinnon (ETM, equation 12.86) without constructing
+   the stacked gn-vector and (gn x totk) matrix: since the stacked
+   data are (Psi' kron I) times the per-equation data, and Psi Psi'
+   is sigma-inverse, block (i,j) of the normal matrix is s^{ij}
+   Xbar_i'Xbar_j and segment i of the right-hand side is Xbar_i'
+   times column i of U sigma-inverse. Here Xbar_i holds the
+   regressors for equation i, with the endogenous ones replaced by
+   the restricted reduced form. The Xbar columns and the right-hand
+   side are computed one regressor per thread.
+*/
 
-static void 
-fiml_form_indepvars (fiml_system *fsys, const DATASET *dset, 
-		     int t1)
+static int fiml_normal_equations (fiml_system *fsys)
 {
-    const int *enlist = system_get_endog_vars(fsys->sys);
-    const int *exlist = system_get_instr_vars(fsys->sys);
-    int i, j, k, t;
-    int xrow, xcol = 0;
-    double p, xjt;
+    int n = fsys->n;
+    int k = fsys->totk;
+    int c, err;
 
-    gretl_matrix_zero(fsys->artx);
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * k))
+#endif
+    for (c=0; c<k; c++) {
+	const gretl_matrix *src = fsys->W;
+	int s = fsys->xsrc[c];
 
-    for (i=0; i<fsys->g; i++) { 
-	/* loop across equations */
-	const int *list = system_get_list(fsys->sys, i);
+	if (s < 0) {
+	    src = fsys->WB2;
+	    s = -1 - s;
+	}
+	memcpy(fsys->Xbar->val + (size_t) c * n,
+	       src->val + (size_t) s * n, n * sizeof(double));
+    }
 
-	for (j=2; j<=list[0]; j++) { 
-	    /* loop across RHS vars */
-	    const double *xj = NULL;
-	    int vj = 0;
+    err = gretl_matrix_multiply(fsys->uhat, fsys->Stmp, fsys->US);
 
-	    if (on_exo_list(exlist, list[j])) {
-		/* the variable is exogenous or predetermined */
-		xj = dset->Z[list[j]] + t1;
-	    } else {
-		/* RHS endogenous variable */
-		vj = endo_var_number(enlist, list[j]);
-	    }
+    if (!err) {
+	err = gretl_matrix_multiply_mod(fsys->Xbar, GRETL_MOD_TRANSPOSE,
+					fsys->Xbar, GRETL_MOD_NONE,
+					fsys->XSX, GRETL_MOD_NONE);
+    }
 
-	    for (t=0; t<fsys->n; t++) { 
-		/* loop across obs */
-		for (k=0; k<fsys->g; k++) { 
-		    /* loop across vertical blocks */
-		    xrow = k * fsys->n + t;
-		    p = gretl_matrix_get(fsys->psi, k, i);
-		    if (p != 0.0) {
-			if (xj != NULL) {
-			    xjt = xj[t];
-			} else {
-			    xjt = gretl_matrix_get(fsys->WB2, t, vj);
-			}
-			gretl_matrix_set(fsys->artx, xrow, xcol, xjt * p);
-		    }
-		}
-	    }
-	    xcol++;
+    if (err) {
+	return err;
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * k))
+#endif
+    for (c=0; c<k; c++) {
+	int jc = fsys->xeq[c];
+	const double *xc = fsys->Xbar->val + (size_t) c * n;
+	const double *uc = fsys->US->val + (size_t) jc * n;
+	double x = 0.0;
+	int r, t;
+
+	for (r=0; r<k; r++) {
+	    x = gretl_matrix_get(fsys->Stmp, fsys->xeq[r], jc);
+	    fsys->XSX->val[(size_t) c * k + r] *= x;
 	}
+	x = 0.0;
+	for (t=0; t<n; t++) {
+	    x += xc[t] * uc[t];
+	}
+	fsys->artb->val[c] = x;
     }
 
 #if FDEBUG > 1
-    gretl_matrix_print(fsys->artx, "fiml artificial X");
+    gretl_matrix_print(fsys->XSX, "fiml normal matrix");
+    gretl_matrix_print(fsys->artb, "fiml X'y");
 #endif
+
+    return 0;
+}
+
+/* Copy the normal matrix into @A, augmenting it with the restriction
+   matrix @R, if present, as [XSX R'; R 0].
+*/
+
+static void fiml_augmented_matrix (fiml_system *fsys, gretl_matrix *A,
+				   const gretl_matrix *R)
+{
+    int k = fsys->totk;
+    int nr = (R != NULL)? R->rows : 0;
+    int i, j;
+
+    A->rows = A->cols = k + nr;
+
+    for (j=0; j<k; j++) {
+	for (i=0; i<k; i++) {
+	    gretl_matrix_set(A, i, j, gretl_matrix_get(fsys->XSX, i, j));
+	}
+	for (i=0; i<nr; i++) {
+	    gretl_matrix_set(A, k + i, j, gretl_matrix_get(R, i, j));
+	    gretl_matrix_set(A, j, k + i, gretl_matrix_get(R, i, j));
+	}
+    }
+    for (j=k; j<k+nr; j++) {
+	for (i=k; i<k+nr; i++) {
+	    gretl_matrix_set(A, i, j, 0.0);
+	}
+    }
+}
+
+/* solve the normal equations of the artificial regression for the
+   gradients, in fsys->artb, subject to R * b = 0 if @R is non-NULL
+*/
+
+static int fiml_solve (fiml_system *fsys, const gretl_matrix *R)
+{
+    int k = fsys->totk;
+    int i, err;
+
+    fiml_augmented_matrix(fsys, fsys->Xa, R);
+    fsys->ba->rows = fsys->Xa->rows;
+    for (i=0; i<fsys->ba->rows; i++) {
+	fsys->ba->val[i] = (i < k)? fsys->artb->val[i] : 0.0;
+    }
+
+    if (R == NULL) {
+	err = gretl_cholesky_decomp_solve(fsys->Xa, fsys->ba);
+	if (err) {
+	    /* fall back to the LU solver */
+	    fiml_augmented_matrix(fsys, fsys->Xa, R);
+	    for (i=0; i<k; i++) {
+		fsys->ba->val[i] = fsys->artb->val[i];
+	    }
+	    err = gretl_LU_solve(fsys->Xa, fsys->ba);
+	}
+    } else {
+	err = gretl_LU_solve(fsys->Xa, fsys->ba);
+    }
+
+    if (!err) {
+	memcpy(fsys->artb->val, fsys->ba->val, k * sizeof(double));
+    }
+
+    return err;
 }
 
 #if FDEBUG
@@ -670,23 +806,22 @@ static void fiml_B_update (fiml_system *fsys)
 
 /* calculate log-likelihood for FIML system */
 
-static int fiml_ll (fiml_system *fsys, const DATASET *dset,
-		    int t1)
+static int fiml_ll (fiml_system *fsys)
 {
     double tr;
     double ldetG;
     double ldetS;
-    int i, j, t;
+    int i, n;
     int err = 0;
 
     fsys->ll = 0.0;
 
-    /* form \hat{\Sigma} (ETM, equation 12.81); invert and
-       Cholesky-decompose to get \Psi while we're at it 
+    /* form \hat{\Sigma} (ETM, equation 12.81) and invert it while
+       we're at it
     */
-    err = fiml_form_sigma_and_psi(fsys, dset, t1);
+    err = fiml_form_sigma(fsys);
     if (err) {
-	fputs("fiml_form_sigma_and_psi: failed\n", stderr);
+	fputs("fiml_form_sigma: failed\n", stderr);
 	return err;
     }
 
@@ -710,29 +845,16 @@ static int fiml_ll (fiml_system *fsys, const DATASET *dset,
     fsys->ll -= (fsys->n / 2.0) * ldetS;
     fsys->ll += fsys->n * ldetG;
 
-    gretl_matrix_copy_values(fsys->Stmp, fsys->sigma);
-    err = gretl_invert_symmetric_matrix(fsys->Stmp);   
-    if (err) {
-	return err;
-    }
-
+    /* the trace of sigma-inverse times U'U, where U'U is just
+       n times sigma
+    */
+    n = fsys->g * fsys->g;
     tr = 0.0;
-    for (i=0; i<fsys->g; i++) {
-	double epe, eti, etj, sij;
-
-	for (j=0; j<fsys->g; j++) {
-	    epe = 0.0;
-	    for (t=0; t<fsys->n; t++) {
-		eti = gretl_matrix_get(fsys->uhat, t, i);
-		etj = gretl_matrix_get(fsys->uhat, t, j);
-		epe += eti * etj;
-	    }
-	    sij = gretl_matrix_get(fsys->Stmp, i, j);
-	    tr += sij * epe;
-	}
+    for (i=0; i<n; i++) {
+	tr += fsys->Stmp->val[i] * fsys->sigma->val[i];
     }
 
-    fsys->ll -= 0.5 * tr;
+    fsys->ll -= 0.5 * fsys->n * tr;
 
     return 0;
 }
@@ -742,8 +864,7 @@ static int fiml_ll (fiml_system *fsys, const DATASET *dset,
    MacKinnon, ETM, equation (12.70)
 */
 
-static int fiml_endog_rhs (fiml_system *fsys, const DATASET *dset,
-			   int t1)
+static int fiml_endog_rhs (fiml_system *fsys)
 {
     int err;
 
@@ -780,8 +901,7 @@ static void copy_estimates_to_btmp (fiml_system *fsys)
 */
 
 static int
-fiml_adjust_estimates (fiml_system *fsys, const DATASET *dset,
-		       int t1, double *instep)
+fiml_adjust_estimates (fiml_system *fsys, double *instep)
 {
     MODEL *pmod;
     double llbak = fsys->ll;
@@ -818,7 +938,7 @@ fiml_adjust_estimates (fiml_system *fsys, const DATASET *dset,
 	fiml_B_update(fsys);
 
 	/* has the likelihood improved? */
-	err = fiml_ll(fsys, dset, t1);
+	err = fiml_ll(fsys);
 	if (!err) {
 	    if (fsys->ll > llbak) {
 		improved = 1;
@@ -833,46 +953,86 @@ fiml_adjust_estimates (fiml_system *fsys, const DATASET *dset,
     return err;
 }
 
+/* zero the variances and covariances of parameters that are set to
+   definite values by the restrictions, that is, those for which a row
+   of @R has just one non-zero element
+*/
+
+static void fiml_zero_exact (gretl_matrix *vcv, const gretl_matrix *R)
+{
+    int i, j, p, nz;
+
+    for (i=0; i<R->rows; i++) {
+	nz = 0;
+	p = -1;
+	for (j=0; j<R->cols && nz<2; j++) {
+	    if (gretl_matrix_get(R, i, j) != 0.0) {
+		p = j;
+		nz++;
+	    }
+	}
+	if (nz == 1) {
+	    for (j=0; j<vcv->rows; j++) {
+		gretl_matrix_set(vcv, j, p, 0.0);
+		gretl_matrix_set(vcv, p, j, 0.0);
+	    }
+	}
+    }
+}
+
 /* get standard errors for FIML estimates from the covariance
-   matrix of the artificial OLS regression
+   matrix of the artificial OLS regression, that is, the inverse
+   of its normal matrix (or the top-left block of the inverse of
+   the augmented matrix, given restrictions)
 */
 
 static int 
 fiml_get_std_errs (fiml_system *fsys, const gretl_matrix *R)
 {
     gretl_matrix *vcv;
-    int ldv = fsys->totk;
-    int err;
-
-    if (R != NULL) {
-	ldv += R->rows;
-    }
+    int k = fsys->totk;
+    int i, j, err;
 
-    vcv = gretl_matrix_alloc(ldv, ldv);
+    vcv = gretl_matrix_alloc(k, k);
     if (vcv == NULL) {
 	return E_ALLOC;
     }
 
     /* These are "GLS-type" standard errors: see Calzolari
        and Panattoni */
-    
+
+    fiml_augmented_matrix(fsys, fsys->Xa, R);
+
     if (R != NULL) {
-	err = gretl_matrix_restricted_ols(fsys->arty, fsys->artx, R, NULL,
-					  fsys->artb, vcv, NULL, NULL);
+	err = gretl_invert_general_matrix(fsys->Xa);
     } else {
-	err = gretl_matrix_SVD_ols(fsys->arty, fsys->artx, fsys->artb, 
-				   vcv, NULL, NULL);
+	err = gretl_invert_symmetric_matrix(fsys->Xa);
+	if (err) {
+	    fiml_augmented_matrix(fsys, fsys->Xa, R);
+	    err = gretl_invert_general_matrix(fsys->Xa);
+	}
+    }
+
+    if (!err) {
+	for (j=0; j<k; j++) {
+	    for (i=0; i<k; i++) {
+		gretl_matrix_set(vcv, i, j, gretl_matrix_get(fsys->Xa, i, j));
+	    }
+	}
+	if (R != NULL) {
+	    fiml_zero_exact(vcv, R);
+	}
     }
 
     if (!err) {
 	MODEL *pmod;
-	int i, j, k = 0;
+	int p = 0;
 
 	for (i=0; i<fsys->g; i++) {
 	    pmod = system_get_model(fsys->sys, i);
 	    for (j=0; j<pmod->ncoeff; j++) {
-		pmod->sderr[j] = sqrt(gretl_matrix_get(vcv, k, k));
-		k++;
+		pmod->sderr[j] = sqrt(gretl_matrix_get(vcv, p, p));
+		p++;
 	    }
 	}
     }
@@ -921,7 +1081,7 @@ int fiml_driver (equation_system *sys, DATASET *dset,
     int iters = 0;
     int err = 0;
 
-    fsys = fiml_system_new(sys, &err);
+    fsys = fiml_system_new(sys, dset, &err);
     if (err) {
 	return err;
     }
@@ -942,7 +1102,7 @@ int fiml_driver (equation_system *sys, DATASET *dset,
     fiml_B_init(fsys, dset);
 
     /* initial loglikelihood */
-    err = fiml_ll(fsys, dset, t1);
+    err = fiml_ll(fsys);
     if (err) {
 	fputs("fiml_ll: failed\n", stderr);
 	goto bailout;
@@ -960,41 +1120,26 @@ int fiml_driver (equation_system *sys, DATASET *dset,
     while (crit > tol && iters < FIML_ITER_MAX) {
 	double step;
 
-	/* form LHS vector for artificial regression */
-	fiml_form_depvar(fsys);
-
 	/* instrument the RHS endog vars */
-	err = fiml_endog_rhs(fsys, dset, t1);
+	err = fiml_endog_rhs(fsys);
 	if (err) {
 	    fputs("fiml_endog_rhs: failed\n", stderr);
 	    break;
 	}	
 
-	/* form RHS matrix for artificial regression */
-	fiml_form_indepvars(fsys, dset, t1);
-
 	/* run artificial regression (ETM, equation 12.86) */
-	if (R != NULL) {
-	    err = gretl_matrix_restricted_ols(fsys->arty, fsys->artx, 
-					      R, NULL, fsys->artb, 
-					      NULL, NULL, NULL);
-	} else {
-#if 0
-	    err = gretl_matrix_svd_ols(fsys->arty, fsys->artx, 
-				       fsys->artb, NULL, NULL, NULL);
-#else
-	    err = gretl_matrix_ols(fsys->arty, fsys->artx, 
-				   fsys->artb, NULL, NULL, NULL);
-#endif
+	err = fiml_normal_equations(fsys);
+	if (!err) {
+	    err = fiml_solve(fsys, R);
 	}
 
 	if (err) {
-	    fputs("gretl_matrix_ols: failed\n", stderr);
+	    fputs("fiml_solve: failed\n", stderr);
 	    break;
 	}
 
 	/* adjust param estimates based on gradients in fsys->artb */
-	err = fiml_adjust_estimates(fsys, dset, t1, &step);
+	err = fiml_adjust_estimates(fsys, &step);
 	if (err) {
 	    break;
 	}
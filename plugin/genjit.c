@@ -0,0 +1,433 @@
+/*
+ *  gretl -- Gnu Regression, Econometrics and Time-series Library
+ *  Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/* Translation of the bytecode for compiled scalar genrs into native
+   code via LLVM's MCJIT, for use when "set jit on" is given. Each
+   program becomes a function of its register array: instructions
+   read their operands from, and write their results to, registers,
+   with values held in SSA form as long as they are known within the
+   current basic block. The NA tests follow na() in missing.h and
+   operators other than the four basic ones are handed back to
+   libgretl via callbacks, so the results agree exactly with those
+   of the bytecode interpreter.
+*/
+
+#include "libgretl.h"
+#include "version.h"
+#include "genvm.h"
+
+#include <llvm-c/Core.h>
+#include <llvm-c/Analysis.h>
+#include <llvm-c/ExecutionEngine.h>
+#include <llvm-c/Target.h>
+
+#define JDEBUG 0
+
+typedef struct jit_state_ jit_state;
+
+struct jit_state_ {
+    LLVMContextRef ctx;
+    LLVMExecutionEngineRef ee;
+};
+
+typedef struct {
+    LLVMBuilderRef b;
+    LLVMTypeRef dbl;
+    LLVMTypeRef i32;
+    LLVMTypeRef i64;
+    LLVMTypeRef ptr;         /* generic pointer (i8*) */
+    LLVMValueRef reg;        /* the register array */
+    LLVMValueRef pp;         /* the parser pointer */
+    LLVMValueRef natest;     /* the NA-testing flag */
+    LLVMTypeRef fabs_type;
+    LLVMValueRef fabs;
+    LLVMTypeRef f1_type;     /* double (double) */
+    LLVMTypeRef calc_type;   /* double (double, double, int, void *) */
+    LLVMTypeRef apply_type;  /* double (double, int, void *) */
+    LLVMValueRef *cache;     /* register values known in current block */
+    int nreg;
+} jit_builder;
+
+static void jit_state_destroy (jit_state *js)
+{
+    if (js != NULL) {
+	if (js->ee != NULL) {
+	    /* this also disposes of the module */
+	    LLVMDisposeExecutionEngine(js->ee);
+	}
+	if (js->ctx != NULL) {
+	    LLVMContextDispose(js->ctx);
+	}
+	free(js);
+    }
+}
+
+static LLVMValueRef reg_addr (jit_builder *jb, int i)
+{
+    LLVMValueRef idx = LLVMConstInt(jb->i64, i, 0);
+
+    return LLVMBuildGEP2(jb->b, jb->dbl, jb->reg, &idx, 1, "");
+}
+
+static LLVMValueRef get_reg (jit_builder *jb, int i)
+{
+    if (jb->cache[i] == NULL) {
+	jb->cache[i] = LLVMBuildLoad2(jb->b, jb->dbl, reg_addr(jb, i), "");
+    }
+
+    return jb->cache[i];
+}
+
+static void set_reg (jit_builder *jb, int i, LLVMValueRef v)
+{
+    LLVMBuildStore(jb->b, v, reg_addr(jb, i));
+    jb->cache[i] = v;
+}
+
+static void clear_cache (jit_builder *jb)
+{
+    memset(jb->cache, 0, jb->nreg * sizeof *jb->cache);
+}
+
+/* na(x): NaN or infinite */
+
+static LLVMValueRef build_na (jit_builder *jb, LLVMValueRef x)
+{
+    LLVMValueRef inf = LLVMConstReal(jb->dbl, HUGE_VAL);
+    LLVMValueRef ax, c1, c2;
+
+    c1 = LLVMBuildFCmp(jb->b, LLVMRealUNO, x, x, "");
+    ax = LLVMBuildCall2(jb->b, jb->fabs_type, jb->fabs, &x, 1, "");
+    c2 = LLVMBuildFCmp(jb->b, LLVMRealOEQ, ax, inf, "");
+
+    return LLVMBuildOr(jb->b, c1, c2, "");
+}
+
+static LLVMValueRef build_either_na (jit_builder *jb, LLVMValueRef x,
+				     LLVMValueRef y)
+{
+    return LLVMBuildOr(jb->b, build_na(jb, x), build_na(jb, y), "");
+}
+
+static LLVMValueRef const_ptr (jit_builder *jb, LLVMTypeRef ftype,
+			       void *addr)
+{
+    LLVMValueRef a = LLVMConstInt(jb->i64, (unsigned long long) (size_t) addr, 0);
+
+    return LLVMConstIntToPtr(a, LLVMPointerType(ftype, 0));
+}
+
+static LLVMValueRef build_arith (jit_builder *jb, int op,
+				 LLVMValueRef x, LLVMValueRef y)
+{
+    LLVMValueRef nan = LLVMConstReal(jb->dbl, NADBL);
+    LLVMValueRef zero = LLVMConstReal(jb->dbl, 0.0);
+    LLVMValueRef nax = build_either_na(jb, x, y);
+    LLVMValueRef z;
+
+    if (op == VM_ADD) {
+	z = LLVMBuildFAdd(jb->b, x, y, "");
+    } else if (op == VM_SUB) {
+	z = LLVMBuildFSub(jb->b, x, y, "");
+    } else if (op == VM_DIV) {
+	z = LLVMBuildFDiv(jb->b, x, y, "");
+    } else {
+	/* multiplication: for scalars 0 times anything is 0,
+	   unless we're testing for NAs */
+	LLVMValueRef xz = LLVMBuildFCmp(jb->b, LLVMRealOEQ, x, zero, "");
+	LLVMValueRef yz = LLVMBuildFCmp(jb->b, LLVMRealOEQ, y, zero, "");
+	LLVMValueRef anyz = LLVMBuildOr(jb->b, xz, yz, "");
+	LLVMValueRef nt = LLVMBuildICmp(jb->b, LLVMIntNE, jb->natest,
+					LLVMConstInt(jb->i32, 0, 0), "");
+	LLVMValueRef zval, pval;
+
+	zval = LLVMBuildSelect(jb->b, LLVMBuildAnd(jb->b, nt, nax, ""),
+			       nan, zero, "");
+	pval = LLVMBuildSelect(jb->b, nax, nan,
+			       LLVMBuildFMul(jb->b, x, y, ""), "");
+	return LLVMBuildSelect(jb->b, anyz, zval, pval, "");
+    }
+
+    return LLVMBuildSelect(jb->b, nax, nan, z, "");
+}
+
+static int build_program (jit_builder *jb, LLVMValueRef fn,
+			  LLVMContextRef ctx, const genvm_inst *prog,
+			  int n, const genvm_jit_helpers *h)
+{
+    LLVMBasicBlockRef *blk;
+    LLVMValueRef x, y, z, args[4];
+    const genvm_inst *in;
+    int i, pc;
+
+    /* blocks at entry, at jump targets and at the end */
+    blk = calloc(n + 1, sizeof *blk);
+    if (blk == NULL) {
+	return E_ALLOC;
+    }
+    blk[0] = LLVMAppendBasicBlockInContext(ctx, fn, "entry");
+    for (i=0; i<n; i++) {
+	in = &prog[i];
+	if ((in->op == VM_SKIPF || in->op == VM_SKIPT) && blk[in->b] == NULL) {
+	    blk[in->b] = LLVMAppendBasicBlockInContext(ctx, fn, "");
+	}
+    }
+    if (blk[n] == NULL) {
+	blk[n] = LLVMAppendBasicBlockInContext(ctx, fn, "");
+    }
+
+    LLVMPositionBuilderAtEnd(jb->b, blk[0]);
+
+    for (pc=0; pc<n; pc++) {
+	in = &prog[pc];
+	if (pc > 0 && blk[pc] != NULL) {
+	    /* fall through into a jump target */
+	    LLVMBuildBr(jb->b, blk[pc]);
+	    LLVMPositionBuilderAtEnd(jb->b, blk[pc]);
+	    clear_cache(jb);
+	}
+	switch (in->op) {
+	case VM_LOAD:
+	    /* done by the caller, but the value may have been cached
+	       from before the load */
+	    jb->cache[in->dst] = NULL;
+	    break;
+	case VM_ADD:
+	case VM_SUB:
+	case VM_MUL:
+	case VM_DIV:
+	    x = get_reg(jb, in->a);
+	    y = get_reg(jb, in->b);
+	    set_reg(jb, in->dst, build_arith(jb, in->op, x, y));
+	    break;
+	case VM_CALC:
+	    args[0] = get_reg(jb, in->a);
+	    args[1] = get_reg(jb, in->b);
+	    args[2] = LLVMConstInt(jb->i32, in->f, 0);
+	    args[3] = jb->pp;
+	    z = LLVMBuildCall2(jb->b, jb->calc_type,
+			       const_ptr(jb, jb->calc_type, (void *) h->calc),
+			       args, 4, "");
+	    set_reg(jb, in->dst, z);
+	    break;
+	case VM_FUNC:
+	    args[0] = get_reg(jb, in->a);
+	    if (in->ptr != NULL) {
+		z = LLVMBuildCall2(jb->b, jb->f1_type,
+				   const_ptr(jb, jb->f1_type, in->ptr),
+				   args, 1, "");
+	    } else {
+		args[1] = LLVMConstInt(jb->i32, in->f, 0);
+		args[2] = jb->pp;
+		z = LLVMBuildCall2(jb->b, jb->apply_type,
+				   const_ptr(jb, jb->apply_type, (void *) h->apply),
+				   args, 3, "");
+	    }
+	    set_reg(jb, in->dst, z);
+	    break;
+	case VM_SKIPF:
+	case VM_SKIPT: {
+	    LLVMValueRef zero = LLVMConstReal(jb->dbl, 0.0);
+	    LLVMBasicBlockRef jump, next;
+	    LLVMValueRef c;
+
+	    x = get_reg(jb, in->a);
+	    if (in->op == VM_SKIPF) {
+		c = LLVMBuildFCmp(jb->b, LLVMRealOEQ, x, zero, "");
+	    } else {
+		c = LLVMBuildAnd(jb->b, LLVMBuildNot(jb->b, build_na(jb, x), ""),
+				 LLVMBuildFCmp(jb->b, LLVMRealONE, x, zero, ""), "");
+	    }
+	    jump = LLVMAppendBasicBlockInContext(ctx, fn, "");
+	    next = LLVMAppendBasicBlockInContext(ctx, fn, "");
+	    LLVMBuildCondBr(jb->b, c, jump, next);
+	    LLVMPositionBuilderAtEnd(jb->b, jump);
+	    LLVMBuildStore(jb->b, x, reg_addr(jb, in->dst));
+	    LLVMBuildBr(jb->b, blk[in->b]);
+	    LLVMPositionBuilderAtEnd(jb->b, next);
+	    /* @x remains valid here, since @jump does not return */
+	    break;
+	}
+	default:
+	    free(blk);
+	    return E_DATA;
+	}
+    }
+
+    LLVMBuildBr(jb->b, blk[n]);
+    LLVMPositionBuilderAtEnd(jb->b, blk[n]);
+    LLVMBuildRetVoid(jb->b);
+
+    free(blk);
+
+    return 0;
+}
+
+/**
+ * genvm_jit_compile:
+ * @prog: bytecode program.
+ * @n: number of instructions in @prog.
+ * @nreg: number of registers used by @prog.
+ * @h: callbacks for operations done by libgretl.
+ * @pf: location to receive the native function.
+ * @pjit: location to receive a pointer to the apparatus that
+ * must be kept alive while the function is in use, and passed
+ * to genvm_jit_destroy() when it is no longer needed.
+ *
+ * Returns: 0 on success, non-zero code on error.
+ */
+
+/* LLVM's target initialization is done once, for all threads */
+
+G_LOCK_DEFINE_STATIC(jit_init);
+
+int genvm_jit_compile (const genvm_inst *prog, int n, int nreg,
+		       const genvm_jit_helpers *h,
+		       genvm_native *pf, void **pjit)
+{
+    static int initted;
+    struct LLVMMCJITCompilerOptions opts;
+    LLVMTypeRef ftype, ptypes[4];
+    LLVMModuleRef mod;
+    LLVMValueRef fn;
+    jit_builder jb = {0};
+    jit_state *js;
+    char *msg = NULL;
+    uint64_t addr;
+    int err = 0;
+
+    *pf = NULL;
+    *pjit = NULL;
+
+    G_LOCK(jit_init);
+    if (!initted) {
+	LLVMLinkInMCJIT();
+	if (LLVMInitializeNativeTarget() ||
+	    LLVMInitializeNativeAsmPrinter()) {
+	    err = E_EXTERNAL;
+	} else {
+	    initted = 1;
+	}
+    }
+    G_UNLOCK(jit_init);
+
+    if (err) {
+	return err;
+    }
+
+    js = calloc(1, sizeof *js);
+    jb.cache = calloc(nreg, sizeof *jb.cache);
+    if (js == NULL || jb.cache == NULL) {
+	free(js);
+	free(jb.cache);
+	return E_ALLOC;
+    }
+    jb.nreg = nreg;
+
+    js->ctx = LLVMContextCreate();
+    mod = LLVMModuleCreateWithNameInContext("genjit", js->ctx);
+    jb.b = LLVMCreateBuilderInContext(js->ctx);
+    jb.dbl = LLVMDoubleTypeInContext(js->ctx);
+    jb.i32 = LLVMInt32TypeInContext(js->ctx);
+    jb.i64 = LLVMInt64TypeInContext(js->ctx);
+    jb.ptr = LLVMPointerType(LLVMInt8TypeInContext(js->ctx), 0);
+
+    jb.f1_type = LLVMFunctionType(jb.dbl, &jb.dbl, 1, 0);
+    jb.fabs_type = jb.f1_type;
+    jb.fabs = LLVMAddFunction(mod, "llvm.fabs.f64", jb.fabs_type);
+    ptypes[0] = ptypes[1] = jb.dbl;
+    ptypes[2] = jb.i32;
+    ptypes[3] = jb.ptr;
+    jb.calc_type = LLVMFunctionType(jb.dbl, ptypes, 4, 0);
+    ptypes[1] = jb.i32;
+    ptypes[2] = jb.ptr;
+    jb.apply_type = LLVMFunctionType(jb.dbl, ptypes, 3, 0);
+
+    /* void fn (double *reg, void *p, int natest) */
+    ptypes[0] = LLVMPointerType(jb.dbl, 0);
+    ptypes[1] = jb.ptr;
+    ptypes[2] = jb.i32;
+    ftype = LLVMFunctionType(LLVMVoidTypeInContext(js->ctx), ptypes, 3, 0);
+    fn = LLVMAddFunction(mod, "genjit_fn", ftype);
+    jb.reg = LLVMGetParam(fn, 0);
+    jb.pp = LLVMGetParam(fn, 1);
+    jb.natest = LLVMGetParam(fn, 2);
+
+    err = build_program(&jb, fn, js->ctx, prog, n, h);
+    LLVMDisposeBuilder(jb.b);
+    free(jb.cache);
+
+    if (!err && LLVMVerifyModule(mod, LLVMReturnStatusAction, &msg)) {
+	fprintf(stderr, "genvm_jit_compile: %s\n", msg);
+	err = E_DATA;
+    }
+    if (msg != NULL) {
+	LLVMDisposeMessage(msg);
+	msg = NULL;
+    }
+
+#if JDEBUG
+    if (!err) {
+	LLVMDumpModule(mod);
+    }
+#endif
+
+    if (!err) {
+	LLVMInitializeMCJITCompilerOptions(&opts, sizeof opts);
+	opts.OptLevel = 2;
+	if (LLVMCreateMCJITCompilerForModule(&js->ee, mod, &opts,
+					     sizeof opts, &msg)) {
+	    fprintf(stderr, "genvm_jit_compile: %s\n", msg);
+	    LLVMDisposeMessage(msg);
+	    js->ee = NULL;
+	    err = E_EXTERNAL;
+	}
+    }
+
+    if (!err) {
+	addr = LLVMGetFunctionAddress(js->ee, "genjit_fn");
+	if (addr == 0) {
+	    err = E_EXTERNAL;
+	}
+    }
+
+    if (err) {
+	if (js->ee == NULL) {
+	    LLVMDisposeModule(mod);
+	}
+	jit_state_destroy(js);
+    } else {
+	*pf = (genvm_native) (size_t) addr;
+	*pjit = js;
+    }
+
+    return err;
+}
+
+/**
+ * genvm_jit_destroy:
+ * @jit: pointer obtained via genvm_jit_compile().
+ *
+ * Frees the native code and associated resources.
+ */
+
+void genvm_jit_destroy (void *jit)
+{
+    jit_state_destroy(jit);
+}
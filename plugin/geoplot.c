@@ -196,10 +196,6 @@ static gretl_matrix *ring2matrix (gretl_array *ring, int *err)
 
 static void lambert_azimuthal (double *px, double *py)
 {
-    static double sphivec[2];
-    static double cphivec[2];
-    static double lam0[2];
-    static int filled;
     double lat = *py, lon = *px;
     double phi = lat * d2r;
     double sphi = sin(phi);
@@ -208,18 +204,18 @@ static void lambert_azimuthal (double *px, double *py)
     double ldiff, cldiff;
     double sphi0, cphi0;
     double k;
-    int i = proj == EPSG3035 ? 1 : 0;
 
-    if (!filled) {
-	sphivec[0] = s45; sphivec[1] = s52;
-	cphivec[0] = c45; cphivec[1] = c52;
-	lam0[0] = lm100; lam0[1] = l10;
-	filled = 1;
+    /* note: no static state here, since this may be called
+       from several threads at once */
+    if (proj == EPSG3035) {
+	sphi0 = s52;
+	cphi0 = c52;
+	ldiff = lam - l10;
+    } else {
+	sphi0 = s45;
+	cphi0 = c45;
+	ldiff = lam - lm100;
     }
-
-    sphi0 = sphivec[i];
-    cphi0 = cphivec[i];
-    ldiff = lam - lam0[i];
     cldiff = cos(ldiff);
     k = Radius * sqrt(2.0 / (1 + sphi0*sphi + cphi0*cphi*cldiff));
     *px = k * cphi * sin(ldiff);
@@ -883,6 +879,724 @@ gretl_bundle *shp_get_bundle (const char *shpname, int *err)
     return ret;
 }
 
+/* Cache of simplified geometry for large shapefiles. The first
+   time a given shapefile is plotted under a given projection we
+   read and project all its polygons (the projection in parallel,
+   if OpenMP is available), simplify them via Douglas-Peucker at
+   several tolerances, and save the results in a binary file under
+   the user's dotdir. Subsequent plots then read only the level of
+   detail that suits the size of the map, skipping libshp and the
+   projection entirely.
+*/
+
+#define GEO_CACHE_DIR "geo_cache"
+#define GEO_CACHE_MIN (1 << 20) /* minimum size of .shp to cache */
+#define GEO_CACHE_MAGIC 0x31656f67 /* "geo1" */
+#define GEO_NLEV 5     /* 4 simplified levels plus full detail */
+#define GEO_BLOCK 512  /* shapes read per parallel block */
+
+typedef struct geo_header_ geo_header;
+typedef struct geo_shape_ geo_shape;
+
+struct geo_header_ {
+    guint32 magic;
+    gint32 nent;              /* number of entities */
+    gint32 nlev;              /* number of levels of detail */
+    gint32 pad;
+    double bbox[4];           /* xmin, ymin, xmax, ymax */
+    gint64 offset[GEO_NLEV+1]; /* start of each level, plus end */
+};
+
+/* one entity at one level of detail */
+
+struct geo_shape_ {
+    int nparts;  /* number of rings */
+    int *nv;     /* vertex count per ring */
+    int ntot;    /* total vertices */
+    double *xy;  /* interleaved projected coordinates */
+};
+
+static void geo_shape_clear (geo_shape *s)
+{
+    free(s->nv);
+    free(s->xy);
+    s->nv = NULL;
+    s->xy = NULL;
+    s->nparts = s->ntot = 0;
+}
+
+static void project_xy (double *px, double *py)
+{
+    if (proj == EPSG3857) {
+	mercator(px, py);
+    } else if (proj >= EPSG2163) {
+	lambert_azimuthal(px, py);
+    }
+}
+
+/* Convert @obj to a full-detail projected shape, @s */
+
+static int shape_from_object (SHPObject *obj, geo_shape *s)
+{
+    int j, part;
+
+    s->ntot = obj->nVertices;
+    s->nparts = obj->nParts > 0 ? obj->nParts : 1;
+    s->nv = malloc(s->nparts * sizeof *s->nv);
+    s->xy = malloc(2 * (s->ntot + 1) * sizeof *s->xy);
+    if (s->nv == NULL || s->xy == NULL) {
+	geo_shape_clear(s);
+	return E_ALLOC;
+    }
+
+    for (part=0; part<s->nparts; part++) {
+	int p1 = (obj->nParts > 0)? obj->PartStart[part] : 0;
+	int p2 = (part < obj->nParts - 1)? obj->PartStart[part+1] : s->ntot;
+
+	s->nv[part] = p2 - p1;
+    }
+
+    for (j=0; j<s->ntot; j++) {
+	double x = obj->fX[j];
+	double y = obj->fY[j];
+
+	project_xy(&x, &y);
+	s->xy[2*j] = x;
+	s->xy[2*j+1] = y;
+    }
+
+    return 0;
+}
+
+/* squared distance of point @p from the segment @a, @b */
+
+static double seg_dist2 (const double *p, const double *a,
+			 const double *b)
+{
+    double dx = b[0] - a[0];
+    double dy = b[1] - a[1];
+    double d2 = dx*dx + dy*dy;
+    double t = 0;
+
+    if (d2 > 0) {
+	t = ((p[0] - a[0])*dx + (p[1] - a[1])*dy) / d2;
+	t = t < 0 ? 0 : t > 1 ? 1 : t;
+    }
+    dx = a[0] + t*dx - p[0];
+    dy = a[1] + t*dy - p[1];
+
+    return dx*dx + dy*dy;
+}
+
+/* Douglas-Peucker: flag in @keep the vertices of the ring @xy
+   (of length @n) that must be retained at tolerance @tol, using
+   @stk as an explicit stack of index pairs. Returns the number
+   of vertices retained.
+*/
+
+static int douglas_peucker (const double *xy, int n, double tol,
+			    char *keep, int *stk)
+{
+    double tol2 = tol * tol;
+    int i, a, b, top = 0;
+    int nkeep = 2;
+
+    memset(keep, 0, n);
+    keep[0] = keep[n-1] = 1;
+    stk[top++] = 0;
+    stk[top++] = n - 1;
+
+    while (top > 0) {
+	double d2, dmax = 0;
+	int imax = -1;
+
+	b = stk[--top];
+	a = stk[--top];
+	for (i=a+1; i<b; i++) {
+	    d2 = seg_dist2(xy + 2*i, xy + 2*a, xy + 2*b);
+	    if (d2 > dmax) {
+		dmax = d2;
+		imax = i;
+	    }
+	}
+	if (imax > 0 && dmax > tol2) {
+	    keep[imax] = 1;
+	    nkeep++;
+	    stk[top++] = a;
+	    stk[top++] = imax;
+	    stk[top++] = imax;
+	    stk[top++] = b;
+	}
+    }
+
+    return nkeep;
+}
+
+/* Fill @s with a simplification of the full-detail shape @f at
+   tolerance @tol. A ring that would collapse to fewer than four
+   vertices (that is, less than a triangle) is kept as is.
+*/
+
+static int simplify_shape (const geo_shape *f, geo_shape *s,
+			   double tol)
+{
+    const double *fxy = f->xy;
+    char *keep = NULL;
+    int *stk = NULL;
+    int nmax = 0;
+    int part, i, k = 0;
+
+    for (part=0; part<f->nparts; part++) {
+	if (f->nv[part] > nmax) {
+	    nmax = f->nv[part];
+	}
+    }
+
+    s->nparts = f->nparts;
+    s->nv = malloc(f->nparts * sizeof *s->nv);
+    s->xy = malloc(2 * (f->ntot + 1) * sizeof *s->xy);
+    keep = malloc(nmax + 1);
+    stk = malloc(2 * (nmax + 1) * sizeof *stk);
+
+    if (s->nv == NULL || s->xy == NULL || keep == NULL || stk == NULL) {
+	geo_shape_clear(s);
+	free(keep);
+	free(stk);
+	return E_ALLOC;
+    }
+
+    for (part=0; part<f->nparts; part++) {
+	int n = f->nv[part];
+	int nk = 0;
+
+	if (n < 4 || douglas_peucker(fxy, n, tol, keep, stk) < 4) {
+	    memcpy(s->xy + 2*k, fxy, 2 * n * sizeof *fxy);
+	    nk = n;
+	} else {
+	    for (i=0; i<n; i++) {
+		if (keep[i]) {
+		    s->xy[2*(k+nk)] = fxy[2*i];
+		    s->xy[2*(k+nk)+1] = fxy[2*i+1];
+		    nk++;
+		}
+	    }
+	}
+	s->nv[part] = nk;
+	k += nk;
+	fxy += 2 * n;
+    }
+
+    s->ntot = k;
+    free(keep);
+    free(stk);
+
+    return 0;
+}
+
+/* Size in bytes of the cache record for @s: the ring count and
+   vertex counts are padded to a multiple of 8 bytes so that the
+   coordinates are aligned for reading in place.
+*/
+
+static size_t geo_record_size (const geo_shape *s)
+{
+    int nint = 1 + s->nparts;
+
+    nint += nint % 2;
+    return nint * sizeof(gint32) + 2 * s->ntot * sizeof(double);
+}
+
+static int write_geo_level (geo_shape *S, int nent, FILE *fp)
+{
+    gint32 ibuf[2] = {0};
+    int i, j, err = 0;
+
+    for (i=0; i<nent && !err; i++) {
+	geo_shape *s = &S[i];
+	gint32 np = s->nparts;
+
+	fwrite(&np, sizeof np, 1, fp);
+	for (j=0; j<s->nparts; j++) {
+	    ibuf[0] = s->nv[j];
+	    fwrite(ibuf, sizeof(gint32), 1, fp);
+	}
+	if ((1 + s->nparts) % 2) {
+	    ibuf[0] = 0;
+	    fwrite(ibuf, sizeof(gint32), 1, fp);
+	}
+	if (fwrite(s->xy, sizeof(double), 2 * s->ntot, fp) != 2 * s->ntot) {
+	    err = E_FOPEN;
+	}
+    }
+
+    return err;
+}
+
+/* Serialize the shapes in @S into a newly allocated block of
+   memory, in the same form as written to the cache.
+*/
+
+static char *geo_level_blob (geo_shape *S, int nent, size_t *psz)
+{
+    size_t sz = 0;
+    char *blob, *p;
+    int i, j;
+
+    for (i=0; i<nent; i++) {
+	sz += geo_record_size(&S[i]);
+    }
+
+    blob = p = calloc(sz > 0 ? sz : 1, 1);
+    if (blob == NULL) {
+	return NULL;
+    }
+
+    for (i=0; i<nent; i++) {
+	gint32 *ip = (gint32 *) p;
+	size_t rsz = geo_record_size(&S[i]);
+
+	ip[0] = S[i].nparts;
+	for (j=0; j<S[i].nparts; j++) {
+	    ip[j+1] = S[i].nv[j];
+	}
+	memcpy(p + rsz - 2 * S[i].ntot * sizeof(double), S[i].xy,
+	       2 * S[i].ntot * sizeof(double));
+	p += rsz;
+    }
+
+    *psz = sz;
+
+    return blob;
+}
+
+static gchar *geo_cache_path (const char *shpname)
+{
+    struct stat buf;
+    gchar *key, *sum, *ret;
+
+    if (gretl_stat(shpname, &buf) != 0 || buf.st_size < GEO_CACHE_MIN) {
+	return NULL;
+    }
+
+    key = g_strdup_printf("%s:%" G_GINT64_FORMAT ":%" G_GINT64_FORMAT ":%d",
+			  shpname, (gint64) buf.st_size,
+			  (gint64) buf.st_mtime, proj);
+    sum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, key, -1);
+    ret = g_strdup_printf("%s%s%c%s", gretl_dotdir(), GEO_CACHE_DIR,
+			  SLASH, sum);
+    g_free(key);
+    g_free(sum);
+
+    return ret;
+}
+
+/* Choose the coarsest level of detail at which the simplification
+   tolerance is no more than half a pixel, given the plot height
+   and the extent of the area shown.
+*/
+
+static int geo_cache_level (mapinfo *mi, const geo_header *h)
+{
+    double span = MAX(h->bbox[2] - h->bbox[0], h->bbox[3] - h->bbox[1]);
+    double vspan = span, tol = span / 1000;
+    int height = 600;
+    int lev;
+
+    if (gretl_bundle_has_key(mi->opts, "height")) {
+	int ht = gretl_bundle_get_scalar(mi->opts, "height", NULL);
+
+	if (ht > 0) {
+	    height = ht;
+	}
+    }
+
+    if (proj <= EPSG3857) {
+	/* explicit ranges are in the units of the data */
+	const gretl_matrix *mx, *my, *mxy;
+
+	mxy = gretl_bundle_get_matrix(mi->opts, "mxy__", NULL);
+	mx = gretl_bundle_get_matrix(mi->opts, "xrange", NULL);
+	my = gretl_bundle_get_matrix(mi->opts, "yrange", NULL);
+	if (mxy != NULL) {
+	    vspan = MAX(fabs(mxy->val[1] - mxy->val[0]),
+			fabs(mxy->val[3] - mxy->val[2]));
+	} else if (mx != NULL && my != NULL && proj != EPSG3857) {
+	    vspan = MAX(fabs(mx->val[1] - mx->val[0]),
+			fabs(my->val[1] - my->val[0]));
+	}
+	if (vspan <= 0 || vspan > span) {
+	    vspan = span;
+	}
+    }
+
+    for (lev=0; lev<GEO_NLEV-1; lev++) {
+	if (tol <= 0.5 * vspan / height) {
+	    break;
+	}
+	tol /= 4;
+    }
+
+    return lev;
+}
+
+static double geo_level_tol (const geo_header *h, int lev)
+{
+    double span = MAX(h->bbox[2] - h->bbox[0], h->bbox[3] - h->bbox[1]);
+
+    return lev == GEO_NLEV - 1 ? 0 : span / (1000 * pow(4, lev));
+}
+
+/* Read and project all the shapes in @shpname at full detail */
+
+static geo_shape *read_full_shapes (const char *shpname,
+				    geo_header *h, int *err)
+{
+    SHPObject *obj[GEO_BLOCK];
+    geo_shape *S = NULL;
+    SHPHandle SHP;
+    double gmin[4], gmax[4];
+    int n_shapetype, nent;
+    int i, b, nb;
+
+    SHP = SHPOpen(shpname, "rb");
+    if (SHP == NULL) {
+	*err = E_FOPEN;
+	return NULL;
+    }
+
+    SHPGetInfo(SHP, &nent, &n_shapetype, gmin, gmax);
+    SHPSetFastModeReadObject(SHP, FALSE);
+
+    S = calloc(nent > 0 ? nent : 1, sizeof *S);
+    if (S == NULL) {
+	SHPClose(SHP);
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    for (b=0; b<nent && !*err; b+=GEO_BLOCK) {
+	nb = MIN(GEO_BLOCK, nent - b);
+	/* reading is serial ... */
+	for (i=0; i<nb && !*err; i++) {
+	    obj[i] = SHPReadObject(SHP, b + i);
+	    if (obj[i] == NULL) {
+		fprintf(stderr, "Unable to read shape %d, terminating.\n", b + i);
+		*err = E_DATA;
+	    } else if (obj[i]->nParts > 0 && obj[i]->PartStart[0] != 0) {
+		fprintf(stderr, "PartStart[0] = %d, not zero as expected.\n",
+			obj[i]->PartStart[0]);
+		SHPDestroyObject(obj[i]);
+		obj[i] = NULL;
+		*err = E_DATA;
+	    }
+	}
+	nb = i;
+	/* ... but projection can be done in parallel */
+#if defined(_OPENMP)
+	#pragma omp parallel for if (nb > 1 && !*err)
+#endif
+	for (i=0; i<nb; i++) {
+	    if (obj[i] != NULL) {
+		if (!*err && shape_from_object(obj[i], &S[b+i])) {
+		    *err = E_ALLOC;
+		}
+		SHPDestroyObject(obj[i]);
+	    }
+	}
+    }
+
+    SHPClose(SHP);
+
+    if (!*err) {
+	double *bb = h->bbox;
+
+	bb[0] = bb[1] = GEOHUGE;
+	bb[2] = bb[3] = -GEOHUGE;
+	for (i=0; i<nent; i++) {
+	    for (b=0; b<S[i].ntot; b++) {
+		record_extrema(S[i].xy[2*b], S[i].xy[2*b+1], bb, bb + 2);
+	    }
+	}
+	h->magic = GEO_CACHE_MAGIC;
+	h->nent = nent;
+	h->nlev = GEO_NLEV;
+	h->pad = 0;
+    } else {
+	for (i=0; i<nent; i++) {
+	    geo_shape_clear(&S[i]);
+	}
+	free(S);
+	S = NULL;
+    }
+
+    return S;
+}
+
+/* Build the geometry cache for @shpname, writing it to @cpath if
+   possible, and return the serialized shapes at the level of
+   detail appropriate for @mi.
+*/
+
+static char *geo_cache_build (const char *shpname, const char *cpath,
+			      mapinfo *mi, geo_header *h, int *err)
+{
+    geo_shape *F, *S = NULL;
+    gchar *tmpname = NULL;
+    gchar *dir = NULL;
+    FILE *fp = NULL;
+    char *blob = NULL;
+    size_t sz;
+    int i, lev, want;
+
+    F = read_full_shapes(shpname, h, err);
+    if (F == NULL) {
+	return NULL;
+    }
+
+    want = geo_cache_level(mi, h);
+
+    dir = g_strdup_printf("%s%s", gretl_dotdir(), GEO_CACHE_DIR);
+    if (gretl_mkdir(dir) == 0) {
+	tmpname = g_strdup_printf("%s.tmp", cpath);
+	fp = gretl_fopen(tmpname, "wb");
+    }
+    g_free(dir);
+
+    if (fp != NULL) {
+	/* placeholder header, rewritten below */
+	fwrite(h, sizeof *h, 1, fp);
+    }
+
+    for (lev=0; lev<GEO_NLEV && !*err; lev++) {
+	double tol = geo_level_tol(h, lev);
+
+	if (tol > 0) {
+	    S = calloc(h->nent > 0 ? h->nent : 1, sizeof *S);
+	    if (S == NULL) {
+		*err = E_ALLOC;
+		break;
+	    }
+#if defined(_OPENMP)
+	    #pragma omp parallel for if (h->nent > 1)
+#endif
+	    for (i=0; i<h->nent; i++) {
+		if (simplify_shape(&F[i], &S[i], tol)) {
+		    *err = E_ALLOC;
+		}
+	    }
+	} else {
+	    S = F;
+	}
+	if (!*err && lev == want) {
+	    blob = geo_level_blob(S, h->nent, &sz);
+	    if (blob == NULL) {
+		*err = E_ALLOC;
+	    }
+	}
+	if (!*err && fp != NULL) {
+	    h->offset[lev] = ftell(fp);
+	    if (write_geo_level(S, h->nent, fp)) {
+		fclose(fp);
+		gretl_remove(tmpname);
+		fp = NULL;
+	    }
+	}
+	if (S != F) {
+	    for (i=0; i<h->nent; i++) {
+		geo_shape_clear(&S[i]);
+	    }
+	    free(S);
+	}
+    }
+
+    if (fp != NULL) {
+	int ok = !*err;
+
+	h->offset[GEO_NLEV] = ftell(fp);
+	if (ok) {
+	    rewind(fp);
+	    ok = fwrite(h, sizeof *h, 1, fp) == 1;
+	}
+	if (fclose(fp) != 0) {
+	    ok = 0;
+	}
+	if (ok) {
+	    gretl_rename(tmpname, cpath);
+	} else {
+	    gretl_remove(tmpname);
+	}
+    }
+
+    for (i=0; i<h->nent; i++) {
+	geo_shape_clear(&F[i]);
+    }
+    free(F);
+    g_free(tmpname);
+
+    if (*err) {
+	free(blob);
+	blob = NULL;
+    }
+
+    return blob;
+}
+
+/* Read from the cache file @cpath, if it exists and is valid, the
+   serialized shapes at the level of detail appropriate for @mi.
+*/
+
+static char *geo_cache_read (const char *cpath, mapinfo *mi,
+			     int nent, geo_header *h)
+{
+    char *blob = NULL;
+    FILE *fp;
+    int lev;
+
+    fp = gretl_fopen(cpath, "rb");
+    if (fp == NULL) {
+	return NULL;
+    }
+
+    if (fread(h, sizeof *h, 1, fp) == 1 &&
+	h->magic == GEO_CACHE_MAGIC && h->nlev == GEO_NLEV &&
+	h->nent == nent) {
+	size_t sz;
+
+	lev = geo_cache_level(mi, h);
+	sz = h->offset[lev+1] - h->offset[lev];
+	blob = malloc(sz > 0 ? sz : 1);
+	if (blob != NULL) {
+	    if (fseek(fp, h->offset[lev], SEEK_SET) != 0 ||
+		fread(blob, 1, sz, fp) != sz) {
+		free(blob);
+		blob = NULL;
+	    }
+	}
+    }
+
+    fclose(fp);
+
+    return blob;
+}
+
+/* Write the gnuplot data file @datname from serialized shapes,
+   in the same form as shp2dat() below.
+*/
+
+static gretl_matrix *geo_blob2dat (const char *blob,
+				   const geo_header *h,
+				   const char *datname,
+				   const gretl_matrix *zvec,
+				   const gretl_matrix *mask,
+				   int get_extrema)
+{
+    double gmin[2], gmax[2];
+    const char *p = blob;
+    FILE *fp;
+    int i, j, k;
+
+    gmin[0] = h->bbox[0];
+    gmin[1] = h->bbox[1];
+    gmax[0] = h->bbox[2];
+    gmax[1] = h->bbox[3];
+    if (get_extrema) {
+	gmin[0] = gmin[1] = GEOHUGE;
+	gmax[0] = gmax[1] = -GEOHUGE;
+    }
+
+    fp = gretl_fopen(datname, "wb");
+    if (fp == NULL) {
+	return NULL;
+    }
+
+    setvbuf(fp, NULL, _IOFBF, 1 << 16);
+
+    for (i=0; i<h->nent; i++) {
+	const gint32 *ip = (const gint32 *) p;
+	int nparts = ip[0];
+	int nint = 1 + nparts + (1 + nparts) % 2;
+	const double *xy = (const double *) (p + nint * sizeof(gint32));
+	double z = 0;
+	int ntot = 0;
+
+	for (j=0; j<nparts; j++) {
+	    ntot += ip[j+1];
+	}
+	p += nint * sizeof(gint32) + 2 * ntot * sizeof(double);
+
+	if (skip_object(i, zvec, mask, &z)) {
+	    continue;
+	}
+
+	for (j=0; j<nparts; j++) {
+	    if (j > 0) {
+		fputc('\n', fp);
+	    }
+	    for (k=0; k<ip[j+1]; k++, xy += 2) {
+		if (zvec != NULL) {
+		    print_xyz(xy[0], xy[1], z, fp);
+		} else {
+		    fprintf(fp, "%.8g %.8g\n", xy[0], xy[1]);
+		}
+		if (get_extrema) {
+		    record_extrema(xy[0], xy[1], gmin, gmax);
+		}
+	    }
+	}
+
+	if (i < h->nent - 1) {
+	    fputs("# end of entity\n\n", fp);
+	}
+    }
+
+    fputc('\n', fp);
+    fclose(fp);
+
+    return make_bbox(gmin, gmax);
+}
+
+/* Try the cached-geometry route for @shpname: on success, write
+   the data file and return the bounding box. A NULL return with
+   *err = 0 means that the caller should proceed in the regular
+   manner (the shapefile is too small to bother with the cache,
+   or the cache could not be built).
+*/
+
+static gretl_matrix *shp2dat_cached (const char *shpname,
+				     const char *datname,
+				     mapinfo *mi,
+				     const gretl_matrix *zvec,
+				     const gretl_matrix *mask,
+				     int nent, int nskip, int *err)
+{
+    gretl_matrix *bbox = NULL;
+    geo_header h = {0};
+    gchar *cpath;
+    char *blob;
+
+    cpath = geo_cache_path(shpname);
+    if (cpath == NULL) {
+	return NULL;
+    }
+
+    blob = geo_cache_read(cpath, mi, nent, &h);
+    if (blob == NULL) {
+	blob = geo_cache_build(shpname, cpath, mi, &h, err);
+    }
+
+    if (blob != NULL) {
+	bbox = geo_blob2dat(blob, &h, datname, zvec, mask, nskip > 0);
+	if (bbox == NULL) {
+	    *err = E_FOPEN;
+	}
+	free(blob);
+    }
+
+    g_free(cpath);
+
+    return bbox;
+}
+
 /* Writes the coordinates content of the shapefile
    identified by @shpname to the gnuplot-compatible
    plain text data file @datname. Returns the bounding
@@ -890,10 +1604,11 @@ gretl_bundle *shp_get_bundle (const char *shpname, int *err)
 */
 
 static gretl_matrix *shp2dat (const char *shpname,
-			      const char *datname,
+			      mapinfo *mi,
 			      const gretl_matrix *zvec,
 			      const gretl_matrix *mask)
 {
+    const char *datname = mi->datfile;
     gretl_matrix *bbox = NULL;
     SHPHandle SHP;
     FILE *fp;
@@ -930,6 +1645,14 @@ static gretl_matrix *shp2dat (const char *shpname,
 	}
     }
 
+    /* if the shapefile is large, try for cached geometry */
+    bbox = shp2dat_cached(shpname, datname, mi, zvec, mask,
+			  n_entities, nskip, &err);
+    if (bbox != NULL || err) {
+	SHPClose(SHP);
+	return bbox;
+    }
+
     if (nskip > 0 || proj > WGS84) {
 	for (i=0; i<2; i++) {
 	    gmin[i] = GEOHUGE;
@@ -1222,7 +1945,7 @@ static gretl_matrix *map2dat (mapinfo *mi,
     gretl_push_c_numeric_locale();
 
     if (has_suffix(infile, ".shp")) {
-	ret = shp2dat(infile, mi->datfile, mi->zvec, mask);
+	ret = shp2dat(infile, mi, mi->zvec, mask);
     } else {
 	/* Regular GeoJSON procedure, either reading from
 	   @infile or working from pre-loaded @map bundle.
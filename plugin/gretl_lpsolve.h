@@ -53,12 +53,19 @@ enum { LE = 1, GE, EQ };
 #define RUNNING        8
 #define PRESOLVED      9
 
+/* simplex types */
+#define SIMPLEX_PRIMAL_PRIMAL  5
+#define SIMPLEX_DUAL_PRIMAL    6
+#define SIMPLEX_PRIMAL_DUAL    9
+#define SIMPLEX_DUAL_DUAL     10
+
 #ifdef PRELINKED
 
 /* Declarations we need for the gretl lpsolve plugin */
 
 lprec *make_lp (int rows, int columns);
 lprec *read_lp (FILE *fp, int verbose, char *lp_name);
+lprec *copy_lp (lprec *lp);
 unsigned char set_add_rowmode (lprec *lp, unsigned char s);
 void delete_lp (lprec *lp);
 void set_verbose (lprec *lp, int verbose);
@@ -66,6 +73,8 @@ void set_maxim (lprec *lp);
 void set_minim (lprec *lp);
 unsigned char set_lp_name (lprec *lp, char *s);
 unsigned char set_obj_fn (lprec *lp, REAL *row);
+unsigned char set_rh_vec (lprec *lp, REAL *rh);
+void set_simplextype (lprec *lp, int simplextype);
 unsigned char add_constraint (lprec *lp, REAL *row,
 			      int constr_type, REAL rh);
 unsigned char set_col_name (lprec *lp, int col, char *name);
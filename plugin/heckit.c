@@ -24,11 +24,22 @@
 #include "missing_private.h"
 #include "gretl_bfgs.h"
 #include "gretl_normal.h"
+#include "gretl_mt.h"
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
 
 #define HDEBUG 0
 #define VCV_DEBUG 0
 #define INITH_OPG 1
 
+/* The loglikelihood and the sums in the Hessian are accumulated
+   over fixed chunks of observations, and the partial sums added in
+   order, so the results don't depend on the number of threads.
+*/
+#define H_CHUNK 4096
+
 typedef struct h_container_ h_container;
 
 struct h_container_ {
@@ -76,6 +87,8 @@ struct h_container_ {
     char *probmask;	     /* mask NAs for initial probit */
     char *fullmask;	     /* mask NAs */
     char *uncmask;	     /* mask NAs and (d==0) */
+    int *uidx;               /* row in uncensored data, or -1 */
+    double *psum;            /* partial sums by chunk */
 
     gretl_matrix *H;         /* analytical Hessian */
     gretl_matrix_block *BH;  /* workspace for the analytical Hessian */
@@ -112,6 +125,8 @@ static void h_container_destroy (h_container *HC)
     free(HC->probmask);
     free(HC->fullmask);
     free(HC->uncmask);
+    free(HC->uidx);
+    free(HC->psum);
 
     gretl_matrix_free(HC->H);
     gretl_matrix_block_destroy(HC->B);
@@ -163,6 +178,8 @@ static h_container *h_container_new (const int *list)
     HC->probmask = NULL;
     HC->fullmask = NULL;
     HC->uncmask = NULL;
+    HC->uidx = NULL;
+    HC->psum = NULL;
 
     return HC;
 }
@@ -367,6 +384,11 @@ static int h_make_data_lists (h_container *HC,
     return 0;
 }
 
+static int h_chunks (int n)
+{
+    return (n + H_CHUNK - 1) / H_CHUNK;
+}
+
 static int h_container_fill (h_container *HC, const int *Xl,
 			     const int *Zl, DATASET *dset,
 			     MODEL *probmod, MODEL *olsmod)
@@ -531,6 +553,23 @@ static int h_container_fill (h_container *HC, const int *Xl,
 
     }
 
+    if (!err) {
+	/* record where each selected observation lives in the
+	   uncensored data, so the per-observation loops don't
+	   have to keep count */
+	int j = 0;
+
+	HC->uidx = malloc(HC->ntot * sizeof *HC->uidx);
+	HC->psum = malloc(3 * h_chunks(HC->ntot) * sizeof *HC->psum);
+	if (HC->uidx == NULL || HC->psum == NULL) {
+	    err = E_ALLOC;
+	} else {
+	    for (i=0; i<HC->ntot; i++) {
+		HC->uidx[i] = (HC->d->val[i] == 1.0)? j++ : -1;
+	    }
+	}
+    }
+
     if (!err){
 	/* workspace for the analytical Hessian */
         HC->BH = gretl_matrix_block_new(&HC->H11, HC->kmain, HC->kmain,
@@ -599,25 +638,80 @@ static int h_common_setup (h_container *HC, const double *param,
     return err;
 }
 
+/* Loglikelihood contribution of observations @t1 to @t2 - 1,
+   writing their rows of the score matrix as we go
+*/
+
+static double h_loglik_chunk (h_container *HC, int t1, int t2,
+			      double ca, double sa, double lnsig)
+{
+    const double *ndx = HC->ndx->val;
+    const double *u = HC->u->val;
+    gretl_matrix *G = HC->score;
+    int kmain = HC->kmain;
+    int npar = kmain + HC->ksel + 2;
+    double ll = 0.0;
+    double ndxt, ut, x, P, mills, tmp;
+    int i, j, k;
+
+    for (i=t1; i<t2; i++) {
+	j = HC->uidx[i];
+	ndxt = ndx[i];
+	if (j >= 0) {
+	    /* selected */
+	    ut = u[j];
+	    x = ca * (ndxt + HC->rho*ut);
+	    P = normal_cdf(x);
+	    mills = invmills(-x);
+	    ll += log(P) - (LN_SQRT_2_PI + 0.5*ut*ut + lnsig);
+
+	    /* score for beta */
+	    tmp = (ut - sa*mills)/HC->sigma;
+	    for (k=0; k<kmain; k++) {
+		gretl_matrix_set(G, i, k, tmp * gretl_matrix_get(HC->reg, j, k));
+	    }
+	    /* score for gamma */
+	    tmp = ca*mills;
+	    for (k=0; k<HC->ksel; k++) {
+		gretl_matrix_set(G, i, kmain+k,
+				 tmp * gretl_matrix_get(HC->selreg, i, k));
+	    }
+	    /* score for sigma and arho */
+	    gretl_matrix_set(G, i, npar-2, (ut * (ut - sa*mills) - 1) / HC->sigma);
+	    gretl_matrix_set(G, i, npar-1, mills * ca * (ut + HC->rho*ndxt));
+	} else {
+	    P = normal_cdf(-ndxt);
+	    mills = -invmills(ndxt);
+	    ll += log(P);
+
+	    for (k=0; k<kmain; k++) {
+		gretl_matrix_set(G, i, k, 0.0);
+	    }
+	    for (k=0; k<HC->ksel; k++) {
+		gretl_matrix_set(G, i, kmain+k,
+				 mills * gretl_matrix_get(HC->selreg, i, k));
+	    }
+	    gretl_matrix_set(G, i, npar-2, 0.0);
+	    gretl_matrix_set(G, i, npar-1, 0.0);
+	}
+    }
+
+    return ll;
+}
+
 static double h_loglik (const double *param, void *ptr)
 {
     h_container *HC = (h_container *) ptr;
-    double ll0 = 0, ll1 = 0, ll2 = 0;
-    double ca, sa, ndxt, ut = 0;
-    double P, mills, tmp, psum;
-    double lnsig, x, ll = NADBL;
-    int sel, k, kmax, npar;
-    int i, j, jj;
-    int err;
+    const gretl_matrix *G = HC->score;
+    int nc = h_chunks(HC->ntot);
+    double ca, sa, lnsig, ll;
+    int c, k, err;
 
     err = h_common_setup(HC, param, &ca, &sa);
     if (err) {
 	return NADBL;
     }
 
-    kmax = HC->kmain + HC->ksel;
-    npar = kmax + 2;
-
     lnsig = log(HC->sigma);
 
 #if HDEBUG > 1
@@ -626,72 +720,38 @@ static double h_loglik (const double *param, void *ptr)
     fprintf(stderr, "sigma = %12.6f, rho = %12.6f\n", HC->sigma, HC->rho);
 #endif
 
-    gretl_matrix_zero(HC->score);
-    gretl_matrix_zero(HC->sscore);
-
-    /* i goes through all obs, while j keeps track of the uncensored
-       ones */
-    j = 0;
-    for (i=0; i<HC->ntot; i++) {
-	sel = (gretl_vector_get(HC->d, i) == 1.0);
-	ndxt = gretl_vector_get(HC->ndx, i);
-	if (sel) {
-	    ut = gretl_vector_get(HC->u, j);
-	    x = ca * (ndxt + HC->rho*ut);
-	    ll1 -= LN_SQRT_2_PI + 0.5*ut*ut + lnsig;
-	    P = normal_cdf(x);
-	    mills = invmills(-x);
-	    ll2 += log(P);
-	} else {
-	    P = normal_cdf(-ndxt);
-	    mills = -invmills(ndxt);
-	    ll0 += log(P);
-	}
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) HC->ntot * G->cols))
+#endif
+    for (c=0; c<nc; c++) {
+	int t1 = c * H_CHUNK;
+	int t2 = MIN(t1 + H_CHUNK, HC->ntot);
 
-	/* score for beta */
-	if (sel) {
-	    tmp = (ut - sa*mills)/HC->sigma;
-	    for (k=0; k<HC->kmain; k++) {
-		x = tmp * gretl_matrix_get(HC->reg, j, k);
-		gretl_matrix_set(HC->score, i, k, x);
-		psum = x + gretl_vector_get(HC->sscore, k);
-		gretl_vector_set(HC->sscore, k, psum);
-	    }
-	}
+	HC->psum[c] = h_loglik_chunk(HC, t1, t2, ca, sa, lnsig);
+    }
 
-	/* score for gamma */
-	tmp = sel ? ca*mills : mills;
-	for (k=0; k<HC->ksel; k++) {
-	    jj = HC->kmain + k;
-	    x = tmp * gretl_matrix_get(HC->selreg, i, k);
-	    gretl_matrix_set(HC->score, i, jj, x);
-	    psum = x + gretl_vector_get(HC->sscore, HC->kmain+k);
-	    gretl_vector_set(HC->sscore, jj, psum);
-	}
+    ll = 0.0;
+    for (c=0; c<nc; c++) {
+	ll += HC->psum[c];
+    }
 
-	/* score for sigma and arho */
-	if (sel) {
-	    x = (ut * (ut - sa*mills) - 1) / HC->sigma;
-	    gretl_matrix_set(HC->score, i, npar-2, x);
-	    psum = x + gretl_vector_get(HC->sscore, npar-2);
-	    gretl_vector_set(HC->sscore, npar-2, psum);
-
-	    x = mills * ca * (ut + HC->rho*ndxt);
-	    gretl_matrix_set(HC->score, i, npar-1, x);
-	    psum = x + gretl_vector_get(HC->sscore, npar-1);
-	    gretl_vector_set(HC->sscore, npar-1, psum);
-	}
+    /* the gradient: sum the score matrix by columns */
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) HC->ntot * G->cols))
+#endif
+    for (k=0; k<G->cols; k++) {
+	const double *gk = G->val + (size_t) k * G->rows;
+	double sk = 0.0;
+	int i;
 
-	if (sel) {
-	    j++;
+	for (i=0; i<G->rows; i++) {
+	    sk += gk[i];
 	}
+	HC->sscore->val[k] = sk;
     }
 
-    ll = ll0 + ll1 + ll2;
-
 #if HDEBUG
-    fprintf(stderr, "ll0 = %g, ll1 = %g, ll2 = %g: ll = %g (ntot = %d)\n",
-	    ll0, ll1, ll2, ll, HC->ntot);
+    fprintf(stderr, "ll = %g (ntot = %d)\n", ll, HC->ntot);
 #endif
 
     return ll;
@@ -710,137 +770,188 @@ static int heckit_score (double *theta, double *s, int npar,
     return 0;
 }
 
-#define h(i,j) h[4*(i-1)+j-1]
+/* Per-observation second-derivative weights for the analytical
+   Hessian: the first six are defined on the selected observations
+   only, the last on all of them.
+*/
 
-/* analytical Hessian */
+enum {
+    HW11, HW12, HW13, HW14, HW23, HW24, HW22, HW_N
+};
 
-int heckit_hessian (double *theta, gretl_matrix *H, void *ptr)
+/* Compute the Hessian weights for observations @t1 to @t2 - 1,
+   and return in @c the sums of the terms involving sigma and
+   arho only.
+*/
+
+static void h_hessian_chunk (h_container *HC, double **w,
+			     int t1, int t2, double ca, double sa,
+			     double *c)
 {
-    h_container *HC = (h_container *) ptr;
+    const double *ndx = HC->ndx->val;
+    const double *u = HC->u->val;
+    double invs = 1/HC->sigma;
+    double invs2 = invs*invs;
+    double sa2 = sa*sa;
+    double ca2 = ca*ca;
     double mills, dmills, x, z;
-    double ca, sa, sa2, ca2, invs, invs2;
-    double ndxt, ut, tmp = 0;
-    double h[16] = {0.0};
-    double c33 = 0;
-    double c34 = 0;
-    double c44 = 0;
-    int i, ii, j, jj, k, m, sel;
-    int kmax, npar;
-    int err;
-
-    err = h_common_setup(HC, theta, &ca, &sa);
-    if (err) {
-	return err;
-    }
-
-    kmax = HC->kmain + HC->ksel;
-    npar = kmax + 2;
-
-    invs = 1/HC->sigma;
-    invs2 = invs*invs;
-
-    sa2 = sa*sa;
-    ca2 = ca*ca;
-
-    /* i goes through all obs, while j keeps track of the uncensored
-       ones */
+    double ndxt, ut, h14;
+    int i, j;
 
-    gretl_matrix_zero(HC->H11);
-    gretl_matrix_zero(HC->H12);
-    gretl_matrix_zero(HC->H13);
-    gretl_matrix_zero(HC->H22);
+    c[0] = c[1] = c[2] = 0.0;
 
-    j = 0;
-    for (i=0; i<HC->ntot; i++) {
-	sel = (gretl_vector_get(HC->d, i) == 1.0);
-	ndxt = gretl_vector_get(HC->ndx, i);
-	if (sel) {
-	    ut = gretl_vector_get(HC->u, j);
+    for (i=t1; i<t2; i++) {
+	j = HC->uidx[i];
+	ndxt = ndx[i];
+	if (j >= 0) {
+	    ut = u[j];
 	    x = ca * ndxt + sa * ut;
 	    z = sa * ndxt + ca * ut;
 	    mills = invmills(-x);
 	    dmills = -mills*(x + mills);
 
-	    h(1,1) = invs2 * (sa2*dmills - 1);
-	    h(1,3) = ut*h(1,1) - invs2*(ut - sa*mills);
-	    h(1,4) = -invs * (ca*mills + sa*dmills*z);
-	    h(1,2) = -ca * sa * invs * dmills;
-	    h(2,2) = dmills * ca2;
-
-	    /* h23 = -invs * ca * sa * dmills * ut; */
-	    h(2,3) = h(1,2) * ut;
-	    h(2,4) = (dmills*ca*z + mills*sa);
-	    h(3,3) = invs2 * (-3*ut*ut + 2*ut*sa*mills + sa2*ut*ut*dmills +1);
-
-	    /* h34 = -invs*ut*(ca*mills + sa*dmills*z); */
-	    h(3,4) = h(1,4) * ut;
-	    h(4,4) = dmills*z*z + mills*x;
+	    w[HW11][j] = invs2 * (sa2*dmills - 1);
+	    w[HW12][j] = -ca * sa * invs * dmills;
+	    w[HW13][j] = ut*w[HW11][j] - invs2*(ut - sa*mills);
+	    w[HW14][j] = h14 = -invs * (ca*mills + sa*dmills*z);
+	    w[HW23][j] = w[HW12][j] * ut;
+	    w[HW24][j] = dmills*ca*z + mills*sa;
+	    w[HW22][i] = dmills * ca2;
+
+	    c[0] += invs2 * (-3*ut*ut + 2*ut*sa*mills + sa2*ut*ut*dmills + 1);
+	    c[1] += h14 * ut;
+	    c[2] += dmills*z*z + mills*x;
 	} else {
 	    mills = -invmills(ndxt);
 	    dmills = -mills*(ndxt + mills);
-	    for (ii=0; ii<16; ii++) {
-		h[ii] = 0.0;
-	    }
-	    h(2,2) = dmills;
+	    w[HW22][i] = dmills;
 	}
+    }
+}
 
-	if (sel) {
-	    for (m=0; m<HC->kmain; m++) {
-		x = gretl_matrix_get(HC->reg, j, m);
+/* Form X'diag(w)Z in @targ, using @W as workspace */
 
-		for (k=0; k<=m; k++) {
-		    tmp = gretl_matrix_get(HC->H11, m, k);
-		    tmp += h(1,1) * x * gretl_matrix_get(HC->reg, j, k);
-		    gretl_matrix_set(HC->H11, m, k, tmp);
-		    gretl_matrix_set(HC->H11, k, m, tmp);
-		}
+static void h_XWZ (const gretl_matrix *X, const double *w,
+		   const gretl_matrix *Z, gretl_matrix *W,
+		   gretl_matrix *targ)
+{
+    int n = Z->rows;
+    int i;
 
-		for (k=0; k<HC->ksel; k++) {
-		    tmp = gretl_matrix_get(HC->H12, m, k);
-		    tmp += h(1,2) * x * gretl_matrix_get(HC->selreg, i, k);
-		    gretl_matrix_set(HC->H12, m, k, tmp);
-		}
+    gretl_matrix_reuse(W, n, Z->cols);
 
-		tmp = gretl_matrix_get(HC->H13, m, 0);
-		tmp += h(1,3) * x;
-		gretl_matrix_set(HC->H13, m, 0, tmp);
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * Z->cols))
+#endif
+    for (i=0; i<Z->cols; i++) {
+	const double *zi = Z->val + (size_t) i * n;
+	double *wi = W->val + (size_t) i * n;
+	int t;
 
-		tmp = gretl_matrix_get(HC->H13, m, 1);
-		tmp += h(1,4) * x;
-		gretl_matrix_set(HC->H13, m, 1, tmp);
-	    }
+	for (t=0; t<n; t++) {
+	    wi[t] = w[t] * zi[t];
 	}
+    }
 
-	for (m=0; m<HC->ksel; m++) {
-	    x = gretl_matrix_get(HC->selreg, i, m);
+    gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+			      W, GRETL_MOD_NONE,
+			      targ, GRETL_MOD_NONE);
+}
 
-	    for (k=0; k<=m; k++) {
-		tmp = gretl_matrix_get(HC->H22, m, k);
-		tmp += h(2,2) * x * gretl_matrix_get(HC->selreg, i, k);
-		gretl_matrix_set(HC->H22, m, k, tmp);
-		gretl_matrix_set(HC->H22, k, m, tmp);
-	    }
+/* Form X'v in @g, one column of X per thread */
 
-	    if (sel) {
-		ii = HC->kmain + m;
-		tmp = gretl_matrix_get(HC->H13, ii, 0);
-		tmp += h(2,3) * x;
-		gretl_matrix_set(HC->H13, ii, 0, tmp);
+static void h_Xtv (const gretl_matrix *X, const double *v,
+		   double *g)
+{
+    int n = X->rows;
+    int i;
 
-		tmp = gretl_matrix_get(HC->H13, ii, 1);
-		tmp += h(2,4) * x;
-		gretl_matrix_set(HC->H13, ii, 1, tmp);
-	    }
-	}
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * X->cols))
+#endif
+    for (i=0; i<X->cols; i++) {
+	const double *xi = X->val + (size_t) i * n;
+	double gi = 0.0;
+	int t;
 
-	if (sel) {
-	    c33 += h(3,3);
-	    c34 += h(3,4);
-	    c44 += h(4,4);
-	    j++;
+	for (t=0; t<n; t++) {
+	    gi += xi[t] * v[t];
 	}
+	g[i] = gi;
+    }
+}
+
+/* analytical Hessian */
+
+int heckit_hessian (double *theta, gretl_matrix *H, void *ptr)
+{
+    h_container *HC = (h_container *) ptr;
+    gretl_matrix *W = NULL;
+    double *wbuf = NULL;
+    double *w[HW_N];
+    double ca, sa, tmp;
+    double c33 = 0;
+    double c34 = 0;
+    double c44 = 0;
+    int kmain = HC->kmain;
+    int ksel = HC->ksel;
+    int nunc = HC->nunc;
+    int ntot = HC->ntot;
+    int nc = h_chunks(ntot);
+    int i, ii, j, jj, c;
+    int kmax, npar;
+    int err;
+
+    err = h_common_setup(HC, theta, &ca, &sa);
+    if (err) {
+	return err;
     }
 
+    kmax = kmain + ksel;
+    npar = kmax + 2;
+
+    wbuf = malloc(((HW_N - 1) * nunc + ntot) * sizeof *wbuf);
+    W = gretl_matrix_alloc(ntot, (kmain > ksel)? kmain : ksel);
+    if (wbuf == NULL || W == NULL) {
+	free(wbuf);
+	gretl_matrix_free(W);
+	return E_ALLOC;
+    }
+
+    for (i=0; i<HW22; i++) {
+	w[i] = wbuf + i * nunc;
+    }
+    w[HW22] = wbuf + HW22 * nunc;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) ntot * npar))
+#endif
+    for (c=0; c<nc; c++) {
+	int t1 = c * H_CHUNK;
+	int t2 = MIN(t1 + H_CHUNK, ntot);
+
+	h_hessian_chunk(HC, w, t1, t2, ca, sa, HC->psum + 3*c);
+    }
+
+    for (c=0; c<nc; c++) {
+	c33 += HC->psum[3*c];
+	c34 += HC->psum[3*c+1];
+	c44 += HC->psum[3*c+2];
+    }
+
+    /* the data matrices for the selected observations, reg and
+       selreg_u, are aligned by row */
+    h_XWZ(HC->reg, w[HW11], HC->reg, W, HC->H11);
+    h_XWZ(HC->reg, w[HW12], HC->selreg_u, W, HC->H12);
+    h_XWZ(HC->selreg, w[HW22], HC->selreg, W, HC->H22);
+    h_Xtv(HC->reg, w[HW13], HC->H13->val);
+    h_Xtv(HC->reg, w[HW14], HC->H13->val + kmax);
+    h_Xtv(HC->selreg_u, w[HW23], HC->H13->val + kmain);
+    h_Xtv(HC->selreg_u, w[HW24], HC->H13->val + kmax + kmain);
+
+    free(wbuf);
+    gretl_matrix_free(W);
+
 #if 0
     gretl_matrix_print(HC->H11, "H11");
     gretl_matrix_print(HC->H12, "H12");
@@ -850,15 +961,15 @@ int heckit_hessian (double *theta, gretl_matrix *H, void *ptr)
 
     /* fill H up (and flip sign while we're at it) */
 
-    for (i=0; i<HC->kmain; i++) {
-	for (j=i; j<HC->kmain; j++) {
+    for (i=0; i<kmain; i++) {
+	for (j=i; j<kmain; j++) {
 	    tmp = -gretl_matrix_get(HC->H11, i, j);
 	    gretl_matrix_set(H, i, j, tmp);
 	    gretl_matrix_set(H, j, i, tmp);
 	}
 
-	for (j=0; j<HC->ksel; j++) {
-	    jj = HC->kmain + j;
+	for (j=0; j<ksel; j++) {
+	    jj = kmain + j;
 	    tmp = -gretl_matrix_get(HC->H12, i, j);
 	    gretl_matrix_set(H, i, jj, tmp);
 	    gretl_matrix_set(H, jj, i, tmp);
@@ -866,10 +977,10 @@ int heckit_hessian (double *theta, gretl_matrix *H, void *ptr)
 	}
     }
 
-    for (i=0; i<HC->ksel; i++) {
-	ii = HC->kmain + i;
-	for (j=i; j<HC->ksel; j++) {
-	    jj = HC->kmain + j;
+    for (i=0; i<ksel; i++) {
+	ii = kmain + i;
+	for (j=i; j<ksel; j++) {
+	    jj = kmain + j;
 	    tmp = -gretl_matrix_get(HC->H22, i, j);
 	    gretl_matrix_set(H, ii, jj, tmp);
 	    gretl_matrix_set(H, jj, ii, tmp);
@@ -909,8 +1020,6 @@ static int heckit_hessian_inverse (double *theta, gretl_matrix *H,
     return err;
 }
 
-#undef h
-
 /*
    What we should do here is not entirely clear: we set yhat to the
    linear predictor, computed over uncensored AND censored
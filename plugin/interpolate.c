@@ -300,9 +300,13 @@ static int ar1_mle (struct gls_info *G, double s, double *rho,
 	theta[i+2] = G->b->val[i];
     }
 
+    /* ar1_loglik() only reads from @G, so the numerical
+       gradient can be computed in parallel */
+    numgrad_set_reentrant(ar1_loglik, (guint64) G->CX->rows * k);
     err = BFGS_max(theta, nt, 300, 1.0e-10,
 		   &fc, &gc, ar1_loglik, C_LOGLIK,
 		   NULL, G, NULL, OPT_NONE, NULL);
+    numgrad_set_reentrant(NULL, 0);
 
     if (err) {
 	if (err == E_NOCONV) {
@@ -17,11 +17,13 @@
  *
  */
 
-/* parsing of JSON buffer using the json-glib library */
+/* parsing of JSON buffer using the json-glib library, supplemented
+   by a pull lexer for speed on large buffers */
 
 #include "libgretl.h"
 #include "version.h"
 #include "gretl_typemap.h"
+#include "gretl_strhash.h"
 
 #include <glib/gprintf.h>
 #include <glib-object.h>
@@ -34,8 +36,6 @@
 	                 t == G_TYPE_BOOLEAN || \
 			 t == G_TYPE_INT64)
 
-#define numeric_type(t) (t == G_TYPE_DOUBLE || t == G_TYPE_INT64)
-
 #define non_empty_array(a) (a != NULL && json_array_get_length(a) > 0)
 #define null_json_node(n) (n == NULL || json_node_is_null(n))
 
@@ -151,6 +151,456 @@ static JsonNode *get_root_for_data (const char *data,
     return ret;
 }
 
+/* A minimal pull lexer for a JSON buffer held in memory. This allows
+   json_get_bundle() and json_get_string() to work through the input
+   in a single pass without first building a json-glib tree for the
+   whole document, which is very costly for large buffers.
+*/
+
+typedef struct jlex_ jlex;
+
+struct jlex_ {
+    const char *buf; /* start of the JSON buffer */
+    const char *p;   /* current read position */
+    GString *str;    /* workspace for decoded strings */
+    int err;         /* error code */
+};
+
+enum {
+    JL_NONE,
+    JL_OBJECT,
+    JL_ARRAY,
+    JL_STRING,
+    JL_NUMBER,
+    JL_BOOLEAN,
+    JL_NULL
+};
+
+#define jl_digit(c) (c >= '0' && c <= '9')
+#define jl_space(c) (c == ' ' || c == '\n' || c == '\r' || c == '\t')
+
+#define na_string(s) (!strcmp(s, ".") || !strcmp(s, "NA") || !strcmp(s, "nan"))
+
+static void jl_init (jlex *jl, const char *data)
+{
+    jl->buf = jl->p = data;
+    jl->str = g_string_sized_new(64);
+    jl->err = 0;
+}
+
+static void jl_free (jlex *jl)
+{
+    g_string_free(jl->str, TRUE);
+}
+
+static int jl_fail (jlex *jl, const char *msg)
+{
+    if (!jl->err) {
+	gretl_errmsg_sprintf("Couldn't parse JSON input: %s at byte %ld",
+			     msg, (long) (jl->p - jl->buf));
+	jl->err = E_DATA;
+    }
+
+    return jl->err;
+}
+
+/* skip white space and return the next character */
+
+static int jl_peek (jlex *jl)
+{
+    const char *p = jl->p;
+
+    while (jl_space(*p)) {
+	p++;
+    }
+    jl->p = p;
+
+    return *p;
+}
+
+/* determine the kind of value starting at the current position */
+
+static int jl_kind (jlex *jl)
+{
+    int c = jl_peek(jl);
+
+    if (c == '{') {
+	return JL_OBJECT;
+    } else if (c == '[') {
+	return JL_ARRAY;
+    } else if (c == '"') {
+	return JL_STRING;
+    } else if (c == '-' || jl_digit(c)) {
+	return JL_NUMBER;
+    } else if (c == 't' || c == 'f') {
+	return JL_BOOLEAN;
+    } else if (c == 'n') {
+	return JL_NULL;
+    } else {
+	return JL_NONE;
+    }
+}
+
+/* consume the opening bracket @c of an object or array */
+
+static int jl_open (jlex *jl, int c)
+{
+    if (jl_peek(jl) != c) {
+	return jl_fail(jl, c == '{' ? "expected object" : "expected array");
+    }
+    jl->p += 1;
+
+    return 0;
+}
+
+/* Advance to item @i of the object or array whose closing bracket
+   is @c. Returns 1 if there is such an item, or 0 if we've hit the
+   end of the container (in which case the closing bracket is
+   consumed) or an error.
+*/
+
+static int jl_next (jlex *jl, int c, int i)
+{
+    int d = jl_peek(jl);
+
+    if (d == c) {
+	jl->p += 1;
+	return 0;
+    } else if (i > 0) {
+	if (d != ',') {
+	    jl_fail(jl, "expected ',' or closing bracket");
+	    return 0;
+	}
+	jl->p += 1;
+	d = jl_peek(jl);
+	if (d == c) {
+	    jl_fail(jl, "trailing comma");
+	    return 0;
+	}
+    }
+    if (d == '\0') {
+	jl_fail(jl, "unexpected end of input");
+	return 0;
+    }
+
+    return 1;
+}
+
+static int jl_hex4 (const char *s, gunichar *pu)
+{
+    gunichar u = 0;
+    int i, h;
+
+    for (i=0; i<4; i++) {
+	h = g_ascii_xdigit_value(s[i]);
+	if (h < 0) {
+	    return E_DATA;
+	}
+	u = (u << 4) | h;
+    }
+    *pu = u;
+
+    return 0;
+}
+
+/* Decode the string starting at the current position. The return
+   value points into the lexer's workspace, so it's valid only until
+   the next call.
+*/
+
+static const char *jl_string (jlex *jl)
+{
+    const char *p, *q;
+    gunichar u, u2;
+
+    if (jl_peek(jl) != '"') {
+	jl_fail(jl, "expected string");
+	return NULL;
+    }
+
+    g_string_truncate(jl->str, 0);
+    p = jl->p + 1;
+
+    while (1) {
+	for (q=p; *q != '"' && *q != '\\' && *q != '\0'; q++) ;
+	g_string_append_len(jl->str, p, q - p);
+	if (*q == '"') {
+	    jl->p = q + 1;
+	    return jl->str->str;
+	} else if (*q == '\0') {
+	    jl->p = q;
+	    jl_fail(jl, "unterminated string");
+	    return NULL;
+	}
+	/* handle backslash escape */
+	q++;
+	switch (*q) {
+	case '"':
+	case '\\':
+	case '/':
+	    g_string_append_c(jl->str, *q);
+	    break;
+	case 'b':
+	    g_string_append_c(jl->str, '\b');
+	    break;
+	case 'f':
+	    g_string_append_c(jl->str, '\f');
+	    break;
+	case 'n':
+	    g_string_append_c(jl->str, '\n');
+	    break;
+	case 'r':
+	    g_string_append_c(jl->str, '\r');
+	    break;
+	case 't':
+	    g_string_append_c(jl->str, '\t');
+	    break;
+	case 'u':
+	    if (jl_hex4(q + 1, &u)) {
+		jl->p = q;
+		jl_fail(jl, "invalid unicode escape");
+		return NULL;
+	    }
+	    q += 4;
+	    if (u >= 0xD800 && u < 0xDC00 && q[1] == '\\' && q[2] == 'u' &&
+		!jl_hex4(q + 3, &u2) && u2 >= 0xDC00 && u2 < 0xE000) {
+		/* UTF-16 surrogate pair */
+		u = 0x10000 + ((u - 0xD800) << 10) + (u2 - 0xDC00);
+		q += 6;
+	    }
+	    g_string_append_unichar(jl->str, u);
+	    break;
+	default:
+	    jl->p = q;
+	    jl_fail(jl, "invalid escape in string");
+	    return NULL;
+	}
+	p = q + 1;
+    }
+}
+
+static int jl_skip_string (jlex *jl)
+{
+    const char *p = jl->p + 1;
+
+    while (*p != '"') {
+	if (*p == '\\' && p[1] != '\0') {
+	    p++;
+	} else if (*p == '\0') {
+	    jl->p = p;
+	    return jl_fail(jl, "unterminated string");
+	}
+	p++;
+    }
+    jl->p = p + 1;
+
+    return 0;
+}
+
+/* Check the syntax of the number starting at the current position and
+   advance past it. Returns the start of the number and sets @integral
+   to indicate whether it has no fractional part or exponent.
+*/
+
+static const char *jl_scan_number (jlex *jl, int *integral)
+{
+    const char *s = jl->p;
+    const char *p = s;
+
+    *integral = 1;
+
+    if (*p == '-') {
+	p++;
+    }
+    if (*p == '0') {
+	p++;
+    } else if (jl_digit(*p)) {
+	while (jl_digit(*p)) p++;
+    } else {
+	goto bad;
+    }
+    if (*p == '.') {
+	*integral = 0;
+	p++;
+	if (!jl_digit(*p)) {
+	    goto bad;
+	}
+	while (jl_digit(*p)) p++;
+    }
+    if (*p == 'e' || *p == 'E') {
+	*integral = 0;
+	p++;
+	if (*p == '+' || *p == '-') {
+	    p++;
+	}
+	if (!jl_digit(*p)) {
+	    goto bad;
+	}
+	while (jl_digit(*p)) p++;
+    }
+
+    jl->p = p;
+    return s;
+
+ bad:
+    jl->p = p;
+    jl_fail(jl, "invalid number");
+    return NULL;
+}
+
+/* Read a number: we assume that the C numeric locale is in force. */
+
+static double jl_number (jlex *jl)
+{
+    const char *s;
+    int integral;
+
+    s = jl_scan_number(jl, &integral);
+
+    if (s == NULL) {
+	return NADBL;
+    } else if (integral && jl->p - s < 16) {
+	/* exactly representable: avoid strtod */
+	const char *p = (*s == '-')? s + 1 : s;
+	gint64 k = 0;
+
+	while (p < jl->p) {
+	    k = 10 * k + (*p++ - '0');
+	}
+	return (*s == '-')? (double) -k : (double) k;
+    } else {
+	return strtod(s, NULL);
+    }
+}
+
+static int jl_literal (jlex *jl, const char *word)
+{
+    int n = strlen(word);
+
+    if (strncmp(jl->p, word, n)) {
+	return jl_fail(jl, "invalid literal");
+    }
+    jl->p += n;
+
+    return 0;
+}
+
+/* Skip over the value starting at the current position. Within
+   an object or array we check only that brackets are balanced.
+*/
+
+static int jl_skip (jlex *jl)
+{
+    int c = jl_peek(jl);
+    int integral;
+
+    if (c == '{' || c == '[') {
+	const char *p = jl->p + 1;
+	int depth = 1;
+
+	while (depth > 0) {
+	    c = *p;
+	    if (c == '"') {
+		jl->p = p;
+		if (jl_skip_string(jl)) {
+		    return jl->err;
+		}
+		p = jl->p;
+		continue;
+	    } else if (c == '{' || c == '[') {
+		depth++;
+	    } else if (c == '}' || c == ']') {
+		depth--;
+	    } else if (c == '\0') {
+		jl->p = p;
+		return jl_fail(jl, "unexpected end of input");
+	    }
+	    p++;
+	}
+	jl->p = p;
+    } else if (c == '"') {
+	jl_skip_string(jl);
+    } else if (c == '-' || jl_digit(c)) {
+	jl_scan_number(jl, &integral);
+    } else if (c == 't') {
+	jl_literal(jl, "true");
+    } else if (c == 'f') {
+	jl_literal(jl, "false");
+    } else if (c == 'n') {
+	jl_literal(jl, "null");
+    } else {
+	jl_fail(jl, "expected a value");
+    }
+
+    return jl->err;
+}
+
+/* Read an object member name and the following colon */
+
+static const char *jl_key (jlex *jl)
+{
+    const char *s = jl_string(jl);
+
+    if (s != NULL) {
+	if (jl_peek(jl) == ':') {
+	    jl->p += 1;
+	} else {
+	    jl_fail(jl, "expected ':'");
+	    s = NULL;
+	}
+    }
+
+    return s;
+}
+
+/* Look ahead, without consuming any input, for a string-valued
+   member named @key in the object at the current position. If
+   found, returns the decoded string value.
+*/
+
+static const char *jl_lookup_string (jlex *jl, const char *key)
+{
+    const char *save = jl->p;
+    const char *ret = NULL;
+    const char *s;
+    int i;
+
+    jl_open(jl, '{');
+    for (i=0; !jl->err && jl_next(jl, '}', i); i++) {
+	if ((s = jl_key(jl)) == NULL) {
+	    break;
+	} else if (!strcmp(s, key) && jl_kind(jl) == JL_STRING) {
+	    ret = jl_string(jl);
+	    break;
+	}
+	jl_skip(jl);
+    }
+    jl->p = save;
+
+    return ret;
+}
+
+/* Look ahead to count the elements of the array at the current
+   position.
+*/
+
+static int jl_count_elements (jlex *jl)
+{
+    const char *save = jl->p;
+    int i = 0;
+
+    if (!jl_open(jl, '[')) {
+	for (i=0; jl_next(jl, ']', i); i++) {
+	    if (jl_skip(jl)) {
+		break;
+	    }
+	}
+    }
+    jl->p = save;
+
+    return i;
+}
+
 static int output_json_node_value (JsonNode *node,
 				   PRN *prn)
 {
@@ -338,6 +788,255 @@ static int real_json_get (JsonNode *match,
     return err;
 }
 
+/* Support for json_get_string(): in the common case where the JsonPath
+   is just a chain of member names, element indices and wildcards we
+   find the matching nodes using the pull lexer and hand only those
+   to json-glib, rather than building a tree for the entire buffer.
+*/
+
+enum {
+    JP_MEMBER,
+    JP_ELEMENT,
+    JP_ANY_MEMBER,
+    JP_ANY_ELEMENT
+};
+
+typedef struct jpstep_ jpstep;
+
+struct jpstep_ {
+    int type;    /* one of the JP_* values above */
+    int idx;     /* element index, for JP_ELEMENT */
+    gchar *name; /* member name, for JP_MEMBER */
+};
+
+struct jpscan {
+    jpstep *steps; /* the parsed path */
+    int nsteps;    /* the number of steps */
+    int wild;      /* does the path include a wildcard? */
+    int done;      /* flag for early termination */
+    GArray *spans; /* offsets of the matching nodes */
+};
+
+static void free_path_steps (jpstep *steps, int n)
+{
+    int i;
+
+    for (i=0; i<n; i++) {
+	g_free(steps[i].name);
+    }
+    g_free(steps);
+}
+
+/* Parse @path into steps if it takes one of the simple forms we can
+   handle here, such as "$.a.b[0]" or "$['a'][*].c", otherwise return
+   NULL, in which case the caller falls back on json-glib.
+*/
+
+static jpstep *parse_simple_path (const char *path, int *pn,
+				  int *wild)
+{
+    jpstep *steps;
+    const char *s = path;
+    const char *q;
+    char *endp;
+    int n = 0, ok = 1;
+    int len;
+
+    if (*s != '$' || s[1] == '\0') {
+	return NULL;
+    }
+
+    steps = g_new0(jpstep, strlen(s));
+    s++;
+
+    while (*s && ok) {
+	if (*s == '.') {
+	    s++;
+	    if (*s == '*') {
+		steps[n].type = JP_ANY_MEMBER;
+		*wild = 1;
+		s++;
+	    } else if ((len = strcspn(s, ".[")) > 0) {
+		steps[n].type = JP_MEMBER;
+		steps[n].name = g_strndup(s, len);
+		s += len;
+	    } else {
+		/* includes recursive descent, ".." */
+		ok = 0;
+	    }
+	} else if (*s == '[') {
+	    s++;
+	    if (*s == '*' && s[1] == ']') {
+		steps[n].type = JP_ANY_ELEMENT;
+		*wild = 1;
+		s += 2;
+	    } else if (jl_digit(*s)) {
+		steps[n].type = JP_ELEMENT;
+		steps[n].idx = (int) strtol(s, &endp, 10);
+		ok = (*endp == ']');
+		s = endp + 1;
+	    } else if (*s == '\'' || *s == '"') {
+		q = strchr(s + 1, *s);
+		if (q == NULL || q[1] != ']') {
+		    ok = 0;
+		} else {
+		    steps[n].type = JP_MEMBER;
+		    steps[n].name = g_strndup(s + 1, q - s - 1);
+		    s = q + 2;
+		}
+	    } else {
+		/* slice, negative index, filter... */
+		ok = 0;
+	    }
+	} else {
+	    ok = 0;
+	}
+	n++;
+    }
+
+    if (!ok) {
+	free_path_steps(steps, n);
+	steps = NULL;
+    } else {
+	*pn = n;
+    }
+
+    return steps;
+}
+
+/* Process the value at the current position against step @k of the
+   path, recording the extent of the value if the path is complete.
+*/
+
+static int jp_scan_value (jlex *jl, struct jpscan *js, int k)
+{
+    jpstep *step;
+    const char *s;
+    int kind, i;
+
+    if (k == js->nsteps) {
+	const char *start;
+	gsize span[2];
+
+	jl_peek(jl);
+	start = jl->p;
+	if (!jl_skip(jl)) {
+	    span[0] = start - jl->buf;
+	    span[1] = jl->p - start;
+	    g_array_append_vals(js->spans, span, 2);
+	    /* with no wildcards there can be only one match */
+	    js->done = !js->wild;
+	}
+	return jl->err;
+    }
+
+    step = &js->steps[k];
+    kind = jl_kind(jl);
+
+    if (kind == JL_OBJECT && (step->type == JP_MEMBER ||
+			      step->type == JP_ANY_MEMBER)) {
+	jl_open(jl, '{');
+	for (i=0; !js->done && jl_next(jl, '}', i); i++) {
+	    if ((s = jl_key(jl)) == NULL) {
+		break;
+	    } else if (step->type == JP_ANY_MEMBER || !strcmp(s, step->name)) {
+		jp_scan_value(jl, js, k + 1);
+	    } else {
+		jl_skip(jl);
+	    }
+	    if (jl->err) {
+		break;
+	    }
+	}
+    } else if (kind == JL_ARRAY && (step->type == JP_ELEMENT ||
+				    step->type == JP_ANY_ELEMENT)) {
+	jl_open(jl, '[');
+	for (i=0; !js->done && jl_next(jl, ']', i); i++) {
+	    if (step->type == JP_ANY_ELEMENT || i == step->idx) {
+		jp_scan_value(jl, js, k + 1);
+	    } else {
+		jl_skip(jl);
+	    }
+	    if (jl->err) {
+		break;
+	    }
+	}
+    } else {
+	jl_skip(jl);
+    }
+
+    return jl->err;
+}
+
+/* Counterpart to get_root_for_data() for a simple path: returns an
+   array node holding copies of the matching nodes, as would be
+   obtained from json_path_match(), but only the matching portions
+   of @data are handed to the json-glib parser.
+*/
+
+static JsonNode *get_root_via_scan (const char *data,
+				    jpstep *steps, int nsteps,
+				    int wild, int *err)
+{
+    struct jpscan js = {steps, nsteps, wild, 0, NULL};
+    JsonParser *parser = NULL;
+    JsonArray *array;
+    JsonNode *ret = NULL;
+    GError *gerr = NULL;
+    gsize *span;
+    guint i, n;
+    jlex jl;
+
+    js.spans = g_array_new(FALSE, FALSE, sizeof(gsize));
+    jl_init(&jl, data);
+
+    if (jl_kind(&jl) == JL_NONE) {
+	gretl_errmsg_set("jsonget: got null root node");
+	*err = E_DATA;
+    } else {
+	*err = jp_scan_value(&jl, &js, 0);
+	if (!*err && !js.done && jl_peek(&jl) != '\0') {
+	    *err = jl_fail(&jl, "unexpected trailing content");
+	}
+    }
+
+    if (!*err) {
+	n = js.spans->len / 2;
+	array = json_array_sized_new(n);
+	parser = json_parser_new();
+	for (i=0; i<n && !*err; i++) {
+	    span = &g_array_index(js.spans, gsize, 2*i);
+	    json_parser_load_from_data(parser, data + span[0], span[1], &gerr);
+	    if (gerr != NULL) {
+		gretl_errmsg_sprintf("Couldn't parse JSON input: %s",
+				     gerr->message);
+		g_error_free(gerr);
+		*err = E_DATA;
+	    } else {
+		JsonNode *node = json_parser_steal_root(parser);
+
+		if (node == NULL) {
+		    json_array_add_null_element(array);
+		} else {
+		    json_array_add_element(array, node);
+		}
+	    }
+	}
+	g_object_unref(parser);
+	ret = json_node_new(JSON_NODE_ARRAY);
+	json_node_take_array(ret, array);
+	if (*err) {
+	    json_node_free(ret);
+	    ret = NULL;
+	}
+    }
+
+    g_array_free(js.spans, TRUE);
+    jl_free(&jl);
+
+    return ret;
+}
+
 /*
   @data: JSON buffer.
   @path: the JsonPath to the target info.
@@ -357,6 +1056,9 @@ char *json_get_string (const char *data, const char *path,
 {
     JsonNode *root;
     JsonParser *parser = NULL;
+    jpstep *steps;
+    int nsteps = 0;
+    int wild = 0;
     int allow_empty;
     char *ret = NULL;
     int n = 0;
@@ -370,7 +1072,14 @@ char *json_get_string (const char *data, const char *path,
     }
 
     allow_empty = n_objects != NULL;
-    root = get_root_for_data(data, path, &parser, allow_empty, err);
+    steps = parse_simple_path(path, &nsteps, &wild);
+
+    if (steps != NULL) {
+	root = get_root_via_scan(data, steps, nsteps, wild, err);
+	free_path_steps(steps, nsteps);
+    } else {
+	root = get_root_for_data(data, path, &parser, allow_empty, err);
+    }
 
     if (!*err) {
 	PRN *prn = gretl_print_new(GRETL_PRINT_BUFFER, err);
@@ -498,11 +1207,13 @@ static int jb_make_pathbits (jbundle *jb, const char *path)
     return err;
 }
 
-static int jb_do_object (JsonReader *reader, jbundle *jb,
+static int jb_do_object (jlex *jl, jbundle *jb,
 			 gretl_array *a);
-static int jb_do_array (JsonReader *reader, jbundle *jb,
+static int jb_do_array (jlex *jl, jbundle *jb,
+			const char *name,
 			gretl_array *a);
-static int jb_do_value (JsonReader *reader, jbundle *jb,
+static int jb_do_value (jlex *jl, jbundle *jb,
+			const char *name,
 			gretl_array *a, int i);
 
 /* Check whether a given JSON element is wanted in the context of
@@ -511,15 +1222,13 @@ static int jb_do_value (JsonReader *reader, jbundle *jb,
    and the current node has a name, we need to check for a match.
 */
 
-static int is_wanted (jbundle *jb, JsonReader *reader)
+static int is_wanted (jbundle *jb, const char *name)
 {
     int i = jb->level - 1;
     int ret = 1;
 
     if (jb->a != NULL && i < jb->nlev) {
 	/* there's a relevant path spec */
-	const gchar *name = json_reader_get_member_name(reader);
-
 	if (name != NULL) {
 	    int j, n = g_strv_length(jb->a[i]);
 
@@ -588,48 +1297,80 @@ static int jb_add_bundle (jbundle *jb, const char *name,
    accepting a null value and a short list of string values.
 */
 
-static double get_matrix_element (JsonReader *reader, int *err)
+static double get_matrix_element (jlex *jl)
 {
-    JsonNode *node = json_reader_get_value(reader);
-    GType type = json_node_get_value_type(node);
+    int kind = jl_kind(jl);
     double x = NADBL;
 
-    if (json_node_is_null(node)) {
-        fprintf(stderr, "  json_is_null_node\n");
-	; /* OK: NA? */
-    } else if (numeric_type(type)) {
-	x = json_reader_get_double_value(reader);
-    } else if (type == G_TYPE_STRING) {
-	const gchar *s = json_node_get_string(node);
+    if (kind == JL_NUMBER) {
+	x = jl_number(jl);
+    } else if (kind == JL_NULL) {
+	jl_literal(jl, "null"); /* OK: NA? */
+    } else if (kind == JL_STRING) {
+	const char *s = jl_string(jl);
 
-	if (!strcmp(s, ".") ||
-	    !strcmp(s, "NA") ||
-	    !strcmp(s, "nan")) {
-	    ; /* OK: NA? */
-	} else {
-	    *err = E_TYPES;
+	if (s != NULL && !na_string(s)) {
+	    jl->err = E_TYPES;
 	}
+    } else if (kind == JL_BOOLEAN) {
+	jl->err = E_TYPES;
     } else {
-	*err = E_TYPES;
+	jl->err = E_DATA;
     }
 
     return x;
 }
 
+/* Read the JSON array at the current position directly into @val,
+   which has room for @n elements.
+*/
+
+static int jb_read_numeric_array (jlex *jl, double *val, int n)
+{
+    int i;
+
+    if (jl_open(jl, '[')) {
+	return jl->err;
+    }
+
+    for (i=0; jl_next(jl, ']', i); i++) {
+	if (i == n) {
+	    break;
+	}
+	val[i] = get_matrix_element(jl);
+	if (jl->err) {
+	    return jl->err;
+	}
+    }
+
+    if (!jl->err && i != n) {
+	gretl_errmsg_set("JSON matrix: 'data' array wrongly sized");
+	jl->err = E_DATA;
+    }
+
+    return jl->err;
+}
+
 /* Add a gretl matrix to the current bundle (if @a is NULL) or array (if
    @a is non-NULL). This also handles the case of a gretl series, but
-   only if the target is a bundle.
+   only if the target is a bundle. Since the "data" member may come
+   ahead of the dimensions we skip it on a first pass over the object,
+   then come back and read the values straight into the target.
 */
 
-static int jb_add_matrix (JsonReader *reader,
+static int jb_add_matrix (jlex *jl,
 			  GretlType type,
 			  jbundle *jb,
 			  const char *key,
 			  gretl_array *a, int ai)
 {
     const char *keys[] = {"size", "rows", "cols"};
+    const char *data = NULL;
+    const char *endpos;
+    const char *s;
     int imin = 1, imax = 3;
-    int i, sz[3] = {0};
+    int i, k, sz[3] = {0};
+    int got[3] = {0};
     int is_complex = 0;
     int err = 0;
 
@@ -643,33 +1384,50 @@ static int jb_add_matrix (JsonReader *reader,
 	}
     }
 
-    for (i=imin; i<imax && !err; i++) {
-	if (!json_reader_read_member(reader, keys[i])) {
-	    gretl_errmsg_sprintf("JSON matrix: couldn't read '%s'", keys[i]);
-	    err = E_DATA;
-	} else {
-	    sz[i] = (int) json_reader_get_int_value(reader);
+    jl_open(jl, '{');
+    for (k=0; !jl->err && jl_next(jl, '}', k); k++) {
+	if ((s = jl_key(jl)) == NULL) {
+	    break;
+	} else if (!strcmp(s, "data")) {
+	    data = jl->p;
+	    jl_skip(jl);
+	    continue;
+	} else if (jl_kind(jl) == JL_NUMBER) {
+	    if (type == GRETL_TYPE_MATRIX && !strcmp(s, "complex")) {
+		is_complex = (int) jl_number(jl);
+		continue;
+	    }
+	    for (i=imin; i<imax; i++) {
+		if (!strcmp(s, keys[i])) {
+		    sz[i] = (int) jl_number(jl);
+		    got[i] = 1;
+		    break;
+		}
+	    }
+	    if (i < imax) {
+		continue;
+	    }
 	}
-	json_reader_end_member(reader);
+	jl_skip(jl);
     }
 
-    if (err) {
-	return err;
+    if (jl->err) {
+	return jl->err;
     }
 
-    if (type == GRETL_TYPE_MATRIX) {
-	if (json_reader_read_member(reader, "complex")) {
-	    is_complex = json_reader_get_int_value(reader);
+    for (i=imin; i<imax && !err; i++) {
+	if (!got[i]) {
+	    gretl_errmsg_sprintf("JSON matrix: couldn't read '%s'", keys[i]);
+	    err = E_DATA;
 	}
-	json_reader_end_member(reader);
     }
 
-    if (!json_reader_read_member(reader, "data") ||
-	!json_reader_is_array(reader)) {
+    if (!err && data == NULL) {
 	gretl_errmsg_set("matrix: couldn't find 'data' array");
 	err = E_DATA;
-    } else {
-	int nelem = json_reader_count_elements(reader);
+    }
+
+    if (!err) {
 	int n = (type == GRETL_TYPE_SERIES)? sz[0] : sz[1] * sz[2];
 	gretl_matrix *m = NULL;
 	double *val = NULL;
@@ -679,10 +1437,7 @@ static int jb_add_matrix (JsonReader *reader,
 	    n *= 2;
 	}
 
-	if (nelem != n) {
-	    gretl_errmsg_set("JSON matrix: 'data' array wrongly sized");
-	    err = E_DATA;
-	} else if (type == GRETL_TYPE_SERIES) {
+	if (type == GRETL_TYPE_SERIES) {
 	    val = malloc(n * sizeof *val);
 	    ptr = val;
 	} else {
@@ -699,14 +1454,10 @@ static int jb_add_matrix (JsonReader *reader,
 	if (ptr == NULL) {
 	    err = E_ALLOC;
 	} else {
-	    for (i=0; i<n && !err; i++) {
-		if (!json_reader_read_element(reader, i)) {
-		    err = E_DATA;
-		} else {
-		    val[i] = get_matrix_element(reader, &err);
-		}
-		json_reader_end_element(reader);
-	    }
+	    endpos = jl->p;
+	    jl->p = data;
+	    err = jb_read_numeric_array(jl, val, n);
+	    jl->p = endpos;
 	    if (!err) {
 		if (a != NULL) {
 		    err = gretl_array_set_matrix(a, ai, ptr, 0);
@@ -721,7 +1472,6 @@ static int jb_add_matrix (JsonReader *reader,
 	    }
 	}
     }
-    json_reader_end_member(reader);
 
     return err;
 }
@@ -730,45 +1480,61 @@ static int jb_add_matrix (JsonReader *reader,
    @a is non-NULL).
 */
 
-static int jb_add_list (JsonReader *reader,
+static int jb_add_list (jlex *jl,
 			jbundle *jb,
 			const char *key,
 			gretl_array *a, int ai)
 {
+    int *list = NULL;
+    const char *s;
+    int i, k, n = 0;
     int err = 0;
 
-    if (!json_reader_read_member(reader, "data") ||
-	!json_reader_is_array(reader)) {
-	gretl_errmsg_set("list: couldn't find 'data' array");
-	err = E_DATA;
-    } else {
-	int i, n = json_reader_count_elements(reader);
-	int *list = malloc(n * sizeof *list);
-
-	if (list != NULL) {
-	    for (i=0; i<n && !err; i++) {
-		if (!json_reader_read_element(reader, i)) {
+    jl_open(jl, '{');
+    for (k=0; !err && !jl->err && jl_next(jl, '}', k); k++) {
+	if ((s = jl_key(jl)) == NULL) {
+	    break;
+	} else if (list != NULL || strcmp(s, "data") ||
+		   jl_kind(jl) != JL_ARRAY) {
+	    jl_skip(jl);
+	    continue;
+	}
+	n = jl_count_elements(jl);
+	list = malloc(n * sizeof *list);
+	if (list == NULL) {
+	    err = E_ALLOC;
+	    break;
+	}
+	jl_open(jl, '[');
+	for (i=0; !err && jl_next(jl, ']', i); i++) {
+	    if (jl_kind(jl) != JL_NUMBER) {
+		err = E_DATA;
+	    } else {
+		list[i] = (int) jl_number(jl);
+		if (i == 0 && list[i] != n - 1) {
+		    gretl_errmsg_set("malformed gretl_list");
 		    err = E_DATA;
-		} else {
-		    list[i] = (int) json_reader_get_int_value(reader);
-		    if (i == 0 && list[i] != n - 1) {
-			gretl_errmsg_set("malformed gretl_list");
-			err = E_DATA;
-		    }
 		}
-		json_reader_end_element(reader);
-	    }
-	    if (err) {
-		free(list);
-	    } else if (a != NULL) {
-		err = gretl_array_set_list(a, ai, list, 0);
-	    } else {
-		err = gretl_bundle_donate_data(jb->bcurr, key, list,
-					       GRETL_TYPE_LIST, 0);
 	    }
 	}
     }
-    json_reader_end_member(reader);
+
+    if (!err) {
+	err = jl->err;
+    }
+    if (!err && list == NULL) {
+	gretl_errmsg_set("list: couldn't find 'data' array");
+	err = E_DATA;
+    }
+
+    if (err) {
+	free(list);
+    } else if (a != NULL) {
+	err = gretl_array_set_list(a, ai, list, 0);
+    } else {
+	err = gretl_bundle_donate_data(jb->bcurr, key, list,
+				       GRETL_TYPE_LIST, 0);
+    }
 
     return err;
 }
@@ -778,12 +1544,12 @@ static int jb_add_list (JsonReader *reader,
    probably numeric and should be made into a matrix.
 */
 
-static int add_array_as_matrix (JsonReader *reader,
+static int add_array_as_matrix (jlex *jl,
 				jbundle *jb,
 				const char *key,
 				gretl_array *a, int ai)
 {
-    int i, n = json_reader_count_elements(reader);
+    int n = jl_count_elements(jl);
     gretl_matrix *m = NULL;
     int err = 0;
 
@@ -792,15 +1558,7 @@ static int add_array_as_matrix (JsonReader *reader,
 	return E_ALLOC;
     }
 
-    for (i=0; i<n && !err; i++) {
-	if (!json_reader_read_element(reader, i) ||
-	    !json_reader_is_value(reader)) {
-	    err = E_DATA;
-	} else {
-	    m->val[i] = get_matrix_element(reader, &err);
-	}
-	json_reader_end_element(reader);
-    }
+    err = jb_read_numeric_array(jl, m->val, n);
 
     if (!err) {
 	if (a != NULL) {
@@ -822,162 +1580,144 @@ static int do_gretl_objects;
    list. This keys off the "type" string in the object.
 */
 
-static int is_gretl_object (JsonReader *reader,
-			    GretlType *type)
+static int is_gretl_object (jlex *jl, GretlType *type)
 {
-    *type = 0;
+    const char *s = jl_lookup_string(jl, "type");
 
-    if (json_reader_read_member(reader, "type")) {
-	const gchar *s = json_reader_get_string_value(reader);
+    *type = 0;
 
-	if (s != NULL) {
-	    if (!strcmp(s, "gretl_matrix")) {
-		*type = GRETL_TYPE_MATRIX;
-	    } else if (!strcmp(s, "gretl_series")) {
-		*type = GRETL_TYPE_SERIES;
-	    } else if (!strcmp(s, "gretl_list")) {
-		*type = GRETL_TYPE_LIST;
-	    }
+    if (s != NULL) {
+	if (!strcmp(s, "gretl_matrix")) {
+	    *type = GRETL_TYPE_MATRIX;
+	} else if (!strcmp(s, "gretl_series")) {
+	    *type = GRETL_TYPE_SERIES;
+	} else if (!strcmp(s, "gretl_list")) {
+	    *type = GRETL_TYPE_LIST;
 	}
     }
-    json_reader_end_member(reader);
 
     return *type;
 }
 
 /* Try to determine if a JSON array is numeric, and therefore should be
-   turned into a gretl matrix.
+   turned into a gretl matrix. We look ahead only as far as the first
+   element that settles the question.
 */
 
-static int array_is_matrix (JsonReader *reader)
+static int array_is_matrix (jlex *jl)
 {
-    int i, n = json_reader_count_elements(reader);
-    int cant_be = 0;
+    const char *save = jl->p;
+    const char *s;
+    int i, kind;
     int ret = 0;
 
-    for (i=0; i<n && !cant_be && !ret; i++) {
-	if (json_reader_read_element(reader, i)) {
-	    if (json_reader_is_value(reader)) {
-		JsonNode *node = json_reader_get_value(reader);
-		GType type = json_node_get_value_type(node);
-
-		if (numeric_type(type)) {
-		    ret = 1;
-		} else if (json_node_is_null(node)) {
-		    ; /* could be? */
-		} else if (type == G_TYPE_STRING) {
-		    const char *s = json_node_get_string(node);
-
-		    if (!strcmp(s, ".") ||
-			!strcmp(s, "NA") ||
-			!strcmp(s, "nan")) {
-			; /* could be? */
-		    } else {
-			cant_be = 1;
-		    }
-		} else {
-		    cant_be = 1;
-		}
-	    } else {
-		cant_be = 1;
+    jl_open(jl, '[');
+    for (i=0; !jl->err && jl_next(jl, ']', i); i++) {
+	kind = jl_kind(jl);
+	if (kind == JL_NUMBER) {
+	    ret = 1;
+	    break;
+	} else if (kind == JL_NULL) {
+	    ; /* could be? */
+	} else if (kind == JL_STRING) {
+	    s = jl_string(jl);
+	    if (s == NULL || !na_string(s)) {
+		break;
 	    }
+	    continue; /* could be? */
 	} else {
-	    cant_be = 1;
+	    break;
 	}
-	json_reader_end_element(reader);
+	jl_skip(jl);
     }
+    jl->p = save;
 
     return ret;
 }
 
 /* Process JSON object -> gretl bundle */
 
-static int jb_do_object (JsonReader *reader, jbundle *jb,
+static int jb_do_object (jlex *jl, jbundle *jb,
 			 gretl_array *a)
 {
-    gchar **S = NULL;
-    int i, n;
+    const char *s;
+    gchar *name;
+    int i, kind;
     int err = 0;
 
-    n = json_reader_count_members(reader);
-    S = json_reader_list_members(reader);
-
 #if JB_DEBUG
-    if (a == NULL) {
-	const gchar *name = json_reader_get_member_name(reader);
-	fprintf(stderr, "level %d: got object, name '%s', %d member(s)\n",
-		jb->level, name == NULL ? "NULL" : name, n);
-    } else {
-	fprintf(stderr, "level %d: got object (array element), %d member(s)\n",
-		jb->level, n);
-    }
-# if JB_DEBUG > 1
-    for (i=0; i<n; i++) {
-	fprintf(stderr, "  %s\n", S[i]);
-    }
-# endif
+    fprintf(stderr, "level %d: got object%s\n", jb->level,
+	    a == NULL ? "" : " (array element)");
 #endif
 
-    for (i=0; i<n && !err; i++) {
-	if (!json_reader_read_member(reader, S[i])) {
-	    gretl_errmsg_sprintf("JSON object: couldn't read element '%s'", S[i]);
-	    err = E_DATA;
-	    json_reader_end_member(reader);
+    jl_open(jl, '{');
+
+    for (i=0; !err && jl_next(jl, '}', i); i++) {
+	if ((s = jl_key(jl)) == NULL) {
 	    break;
 	}
-	if (json_reader_is_object(reader)) {
+	name = g_strdup(s);
+	kind = jl_kind(jl);
+	if (kind == JL_OBJECT) {
 	    GretlType otype = 0;
 
-	    if (do_gretl_objects && is_gretl_object(reader, &otype)) {
+	    if (do_gretl_objects && is_gretl_object(jl, &otype)) {
 		if (otype == GRETL_TYPE_LIST) {
-		    err = jb_add_list(reader, jb, S[i], NULL, 0);
+		    err = jb_add_list(jl, jb, name, NULL, 0);
 		} else {
-		    err = jb_add_matrix(reader, otype, jb, S[i], NULL, 0);
+		    err = jb_add_matrix(jl, otype, jb, name, NULL, 0);
 		}
 	    } else {
 		int lsave = jb->level;
 
 		jb->level += 1;
-		if (is_wanted(jb, reader)) {
+		if (is_wanted(jb, name)) {
 		    gretl_bundle *bsave = jb->bcurr;
 
-		    err = jb_add_bundle(jb, S[i], NULL, 0);
+		    err = jb_add_bundle(jb, name, NULL, 0);
 		    if (!err) {
-			err = jb_do_object(reader, jb, NULL);
+			err = jb_do_object(jl, jb, NULL);
 		    }
 		    jb->bcurr = bsave;
+		} else {
+		    jl_skip(jl);
 		}
 		jb->level = lsave;
 	    }
-	} else if (json_reader_is_array(reader)) {
-	    if (array_is_matrix(reader)) {
-		err = add_array_as_matrix(reader, jb, S[i], NULL, 0);
+	} else if (kind == JL_ARRAY) {
+	    if (array_is_matrix(jl)) {
+		err = add_array_as_matrix(jl, jb, name, NULL, 0);
 	    } else {
 		int lsave = jb->level;
 
 		jb->level += 1;
-		if (is_wanted(jb, reader)) {
-		    err = jb_do_array(reader, jb, NULL);
+		if (is_wanted(jb, name)) {
+		    err = jb_do_array(jl, jb, name, NULL);
+		} else {
+		    jl_skip(jl);
 		}
 		jb->level = lsave;
 	    }
-	} else if (json_reader_is_value(reader)) {
+	} else if (kind != JL_NONE) {
 	    int lsave = jb->level;
 
 	    jb->level += 1;
-	    if (is_wanted(jb, reader)) {
-		err = jb_do_value(reader, jb, NULL, 0);
+	    if (is_wanted(jb, name)) {
+		err = jb_do_value(jl, jb, name, NULL, 0);
+	    } else {
+		jl_skip(jl);
 	    }
 	    jb->level = lsave;
 	} else {
-	    fprintf(stderr, "JSON object: weird unhandled case!\n");
+	    jl_fail(jl, "expected a value");
+	}
+	g_free(name);
+	if (!err) {
+	    err = jl->err;
 	}
-	json_reader_end_member(reader);
     }
 
-    g_strfreev(S);
-
-    return err;
+    return err ? err : jl->err;
 }
 
 /* Switch the type of the array @a from its original value to @targ, but
@@ -1007,16 +1747,19 @@ static int jb_transmute_array (gretl_array *a,
    bundles, or arrays.
 */
 
-static int jb_do_array (JsonReader *reader, jbundle *jb,
+static int jb_do_array (jlex *jl, jbundle *jb,
+			const char *name,
 			gretl_array *a0)
 {
     GretlType atype;
-    const gchar *name;
     gretl_array *a;
-    int i, n, err = 0;
+    int i, n, kind;
+    int err = 0;
 
-    n = json_reader_count_elements(reader);
-    name = json_reader_get_member_name(reader);
+    n = jl_count_elements(jl);
+    if (jl->err) {
+	return jl->err;
+    }
 
 #if JB_DEBUG
     fprintf(stderr, "level %d: got array, name '%s', %d element(s)\n",
@@ -1032,27 +1775,22 @@ static int jb_do_array (JsonReader *reader, jbundle *jb,
 
     atype = GRETL_TYPE_ANY; /* generic default */
     a = gretl_array_new(atype, n, &err);
+    if (err) {
+	return err;
+    }
 
-    for (i=0; i<n && !err; i++) {
-	if (!json_reader_read_element(reader, i)) {
-	    gretl_errmsg_set("JSON array: couldn't read element");
-	    err = E_DATA;
-	    json_reader_end_element(reader);
-	    break;
-	}
-	if (json_reader_is_value(reader)) {
-	    err = jb_do_value(reader, jb, a, i);
-	    if (!err) {
-		atype = gretl_array_get_type(a);
-	    }
-	} else if (json_reader_is_object(reader)) {
+    jl_open(jl, '[');
+
+    for (i=0; !err && jl_next(jl, ']', i); i++) {
+	kind = jl_kind(jl);
+	if (kind == JL_OBJECT) {
 	    GretlType otype = 0;
 
-	    if (do_gretl_objects && is_gretl_object(reader, &otype)) {
+	    if (do_gretl_objects && is_gretl_object(jl, &otype)) {
 		if (otype == GRETL_TYPE_LIST) {
-		    err = jb_add_list(reader, jb, NULL, a, i);
+		    err = jb_add_list(jl, jb, NULL, a, i);
 		} else {
-		    err = jb_add_matrix(reader, otype, jb, NULL, a, i);
+		    err = jb_add_matrix(jl, otype, jb, NULL, a, i);
 		}
 	    } else {
 		if (atype != GRETL_TYPE_BUNDLES) {
@@ -1067,15 +1805,15 @@ static int jb_do_array (JsonReader *reader, jbundle *jb,
 			int lsave = jb->level;
 
 			jb->level += 1;
-			err = jb_do_object(reader, jb, a);
+			err = jb_do_object(jl, jb, a);
 			jb->level = lsave;
 		    }
 		    jb->bcurr = bsave;
 		}
 	    }
-	} else if (json_reader_is_array(reader)) {
-	    if (array_is_matrix(reader)) {
-		err = add_array_as_matrix(reader, jb, NULL, a, i);
+	} else if (kind == JL_ARRAY) {
+	    if (array_is_matrix(jl)) {
+		err = add_array_as_matrix(jl, jb, NULL, a, i);
 	    } else {
 		if (atype != GRETL_TYPE_ARRAYS) {
 		    /* try switching to arrays */
@@ -1090,24 +1828,37 @@ static int jb_do_array (JsonReader *reader, jbundle *jb,
 			a = NULL;
 			err = 0;
 			gretl_error_clear();
-			goto end_element;
+			jl_skip(jl);
+			for (i++; jl_next(jl, ']', i); i++) {
+			    jl_skip(jl);
+			}
+			break;
 		    }
 		}
 		if (!err) {
 		    int lsave = jb->level;
 
 		    jb->level += 1;
-		    err = jb_do_array(reader, jb, a);
+		    err = jb_do_array(jl, jb, NULL, a);
 		    jb->level = lsave;
 		}
 	    }
+	} else if (kind != JL_NONE) {
+	    err = jb_do_value(jl, jb, NULL, a, i);
+	    if (!err) {
+		atype = gretl_array_get_type(a);
+	    }
 	} else {
 	    gretl_errmsg_set("JSON array: unrecognized type");
 	    err = E_DATA;
 	}
+	if (!err) {
+	    err = jl->err;
+	}
+    }
 
-    end_element:
-	json_reader_end_element(reader);
+    if (!err) {
+	err = jl->err;
     }
 
     if (err) {
@@ -1154,91 +1905,79 @@ static void bundle_set_missing (jbundle *jb, const gchar *key)
    values to strings.
 */
 
-static int jb_do_value (JsonReader *reader, jbundle *jb,
+static int jb_do_value (jlex *jl, jbundle *jb,
+			const char *name,
 			gretl_array *a, int i)
 {
-    JsonNode *node = json_reader_get_value(reader);
-    const gchar *name, *typename;
+    int kind = jl_kind(jl);
     char tmp[32];
-    GType type;
     int err = 0;
 
-    name = json_reader_get_member_name(reader);
-    type = json_node_get_value_type(node);
-    typename = g_type_name(type);
-
 #if JB_DEBUG
-    fprintf(stderr, "  got value: name='%s', type %s (%ld)\n",
-	    name, typename, type);
+    fprintf(stderr, "  got value: name='%s', kind %d\n", name, kind);
 #endif
 
     if (a == NULL && (name == NULL || name[0] == '\0')) {
 	name = "anon";
     }
 
-    if (type == G_TYPE_INT64) {
-	int k = (int) json_reader_get_int_value(reader);
+    if (kind == JL_NUMBER) {
+	double x = jl_number(jl);
 
-	if (a != NULL) {
-	    sprintf(tmp, "%d", k);
-	    err = gretl_array_set_string(a, i, tmp, 1);
-	} else {
-	    gretl_bundle_set_scalar(jb->bcurr, name, (double) k);
-	}
-    } else if (type == G_TYPE_DOUBLE) {
-	gdouble x = json_reader_get_double_value(reader);
-
-	if (a != NULL) {
+	if (jl->err) {
+	    ; /* malformed */
+	} else if (a != NULL) {
 	    sprintf(tmp, "%.15g", x);
 	    err = gretl_array_set_string(a, i, tmp, 1);
 	} else {
 	    gretl_bundle_set_scalar(jb->bcurr, name, x);
 	}
-    } else if (type == G_TYPE_STRING) {
-	const gchar *s = json_reader_get_string_value(reader);
+    } else if (kind == JL_STRING) {
+	const char *s = jl_string(jl);
 
-	if (a != NULL) {
+	if (s == NULL) {
+	    ; /* malformed */
+	} else if (a != NULL) {
 	    err = gretl_array_set_string(a, i, (char *) s, 1);
 	} else {
 	    gretl_bundle_set_string(jb->bcurr, name, s);
 	}
-    } else if (type == G_TYPE_BOOLEAN) {
-	int k = (int) json_reader_get_boolean_value(reader);
+    } else if (kind == JL_BOOLEAN) {
+	int k = (*jl->p == 't');
 
-	if (a != NULL) {
+	if (jl_literal(jl, k ? "true" : "false")) {
+	    ; /* malformed */
+	} else if (a != NULL) {
 	    sprintf(tmp, "%d", k);
 	    err = gretl_array_set_string(a, i, tmp, 1);
 	} else {
 	    gretl_bundle_set_int(jb->bcurr, name, k);
 	}
-    } else if (type == G_TYPE_INVALID) {
+    } else if (kind == JL_NULL) {
 	/* try null JSON object -> empty string */
-	if (a != NULL) {
+	if (jl_literal(jl, "null")) {
+	    ; /* malformed */
+	} else if (a != NULL) {
 	    err = gretl_array_set_string(a, i, "", 1);
 	} else {
             bundle_set_missing(jb, name);
-	    // gretl_bundle_set_string(jb->bcurr, name, "");
 	}
     } else {
-	gretl_errmsg_sprintf("Unhandled JSON value of type %s\n",
-			     typename);
+	gretl_errmsg_set("Unhandled JSON value");
 	err = E_DATA;
     }
 
-    return err;
+    return err ? err : jl->err;
 }
 
-static void maybe_enable_gretl_objects (JsonReader *reader)
+static void maybe_enable_gretl_objects (jlex *jl)
 {
-    if (json_reader_read_member(reader, "type")) {
-	const gchar *s = json_reader_get_string_value(reader);
+    const char *s = jl_lookup_string(jl, "type");
 
-	if (s != NULL && !strcmp(s, "gretl_bundle")) {
-	    /* enable search for "gretl_matrix", etc. */
-	    do_gretl_objects = 1;
-	}
+    if (s != NULL && !strcmp(s, "gretl_bundle")) {
+	/* enable search for "gretl_matrix", etc. */
+	do_gretl_objects = 1;
     }
-    json_reader_end_member(reader);
 }
 
 /* end code subserving json_get_bundle() */
@@ -1252,6 +1991,9 @@ static void maybe_enable_gretl_objects (JsonReader *reader)
 
   On success, returns an allocated gretl_bundle whose
   structure mirrors that of the root JSON object.
+
+  The buffer is decoded in a single pass, without building an
+  intermediate json-glib tree.
 */
 
 gretl_bundle *json_get_bundle (const char *data,
@@ -1261,9 +2003,8 @@ gretl_bundle *json_get_bundle (const char *data,
 {
     gretl_bundle *ret = NULL;
     jbundle jb = {0};
-    JsonNode *root;
-    JsonParser *parser = NULL;
-    JsonReader *reader;
+    jlex jl;
+    int kind;
 
     if (data == NULL) {
 	gretl_errmsg_set("json_get_bundle: no data supplied");
@@ -1271,8 +2012,12 @@ gretl_bundle *json_get_bundle (const char *data,
 	return NULL;
     }
 
-    root = get_root_for_data(data, NULL, &parser, 1, err);
-    if (*err) {
+    jl_init(&jl, data);
+    kind = jl_kind(&jl);
+    if (kind == JL_NONE || kind == JL_NULL) {
+	gretl_errmsg_set("jsonget: got null root node");
+	jl_free(&jl);
+	*err = E_DATA;
 	return NULL;
     }
 
@@ -1285,6 +2030,7 @@ gretl_bundle *json_get_bundle (const char *data,
 	}
 	*err = jb_make_pathbits(&jb, path);
 	if (*err) {
+	    jl_free(&jl);
 	    return NULL;
 	}
     }
@@ -1292,22 +2038,24 @@ gretl_bundle *json_get_bundle (const char *data,
     jb.strvars = strvars;
     jb.bcurr = jb.b0 = gretl_bundle_new();
 
-    reader = json_reader_new(root);
     gretl_push_c_numeric_locale();
 
-    if (json_reader_is_object(reader)) {
-	maybe_enable_gretl_objects(reader);
-	*err = jb_do_object(reader, &jb, NULL);
-    } else if (json_reader_is_array(reader)) {
-	*err = jb_do_array(reader, &jb, NULL);
-    } else if (json_reader_is_value(reader)) {
-	*err = jb_do_value(reader, &jb, NULL, 0);
+    if (kind == JL_OBJECT) {
+	maybe_enable_gretl_objects(&jl);
+	*err = jb_do_object(&jl, &jb, NULL);
+    } else if (kind == JL_ARRAY) {
+	*err = jb_do_array(&jl, &jb, NULL, NULL);
+    } else {
+	*err = jb_do_value(&jl, &jb, NULL, NULL, 0);
+    }
+
+    if (!*err && jl_peek(&jl) != '\0') {
+	*err = jl_fail(&jl, "unexpected trailing content");
     }
 
     gretl_pop_c_numeric_locale();
-    g_object_unref(reader);
+    jl_free(&jl);
 
-    json_deallocate(root, parser);
     if (jb.a != NULL) {
 	free_pathbits(jb.a, jb.nlev);
     }
@@ -1441,10 +2189,10 @@ static void gretl_array_to_json (gretl_array *a,
 	if (type == GRETL_TYPE_STRINGS) {
 	    json_builder_add_string_value(jb, data);
 	} else if (type == GRETL_TYPE_BUNDLES) {
-	    GHashTable *ht = gretl_bundle_get_content(data);
+	    gretl_strhash *ht = gretl_bundle_get_content(data);
 
 	    json_builder_begin_object(jb);
-	    g_hash_table_foreach(ht, bundled_item_to_json, jb);
+	    gretl_strhash_foreach(ht, bundled_item_to_json, jb);
 	    json_builder_end_object(jb);
 	} else if (type == GRETL_TYPE_ARRAYS) {
 	    json_builder_begin_array(jb);
@@ -1617,10 +2365,10 @@ static void bundled_item_to_json (gpointer keyp,
 	       item->type == GRETL_TYPE_SERIES) {
 	matrix_to_json(item->data, item->type, item->size, jb);
     } else if (item->type == GRETL_TYPE_BUNDLE) {
-	GHashTable *ht = gretl_bundle_get_content(item->data);
+	gretl_strhash *ht = gretl_bundle_get_content(item->data);
 
 	json_builder_begin_object(jb);
-	g_hash_table_foreach(ht, bundled_item_to_json, jb);
+	gretl_strhash_foreach(ht, bundled_item_to_json, jb);
 	json_builder_end_object(jb);
     } else if (item->type == GRETL_TYPE_ARRAY) {
 	json_builder_begin_array(jb);
@@ -1633,13 +2381,13 @@ static void bundled_item_to_json (gpointer keyp,
 
 static JsonBuilder *real_bundle_to_json (gretl_bundle *b)
 {
-    GHashTable *ht;
+    gretl_strhash *ht;
     JsonBuilder *jb;
 
     jb = json_builder_new();
     jb = json_builder_begin_object(jb);
     ht = gretl_bundle_get_content(b);
-    g_hash_table_foreach(ht, bundled_item_to_json, jb);
+    gretl_strhash_foreach(ht, bundled_item_to_json, jb);
     jb = json_builder_end_object(jb);
 
     return jb;
@@ -31,14 +31,43 @@ struct kalman_helper_ {
     gretl_matrix *Q_; /* ditto */
     gretl_matrix *P_; /* ditto */
 
+    /* apparatus for the analytical score */
+    kalman_deriv *D;
+    gretl_matrix_block *dBk;
+    gretl_matrix *arow; /* 1 x r0 */
+    gretl_matrix *mcol; /* r x 1 */
+    gretl_matrix *dT0;  /* r0 x r0 */
+    gretl_matrix *dP0;  /* r0 x r0 */
+    gretl_matrix *dC;   /* r0 x r0 */
+    gretl_matrix *dR;   /* right-hand sides for dP0 */
+    double *b1;
+
     arma_info *kainfo;
 };
 
 static int kalman_do_ma_check = 1;
 
+static void kalman_deriv_free (khelper *kh)
+{
+    int i;
+
+    if (kh->D != NULL) {
+        for (i=0; i<kh->kainfo->nc; i++) {
+            gretl_matrix_free(kh->D[i].T);
+            gretl_matrix_free(kh->D[i].BT);
+            gretl_matrix_free(kh->D[i].ZT);
+            gretl_matrix_free(kh->D[i].P);
+        }
+        free(kh->D);
+    }
+    gretl_matrix_block_destroy(kh->dBk);
+    free(kh->b1);
+}
+
 static void kalman_helper_free (khelper *kh)
 {
     if (kh != NULL) {
+        kalman_deriv_free(kh);
         gretl_matrix_block_destroy(kh->Bk);
         gretl_matrix_free(kh->avar2);
         gretl_matrix_free(kh->vQ);
@@ -66,6 +95,10 @@ static khelper *kalman_helper_new (arma_info *ainfo,
 
     kh->avar2 = kh->vQ = NULL;
     kh->T_ = kh->Q_ = kh->P_ = NULL;
+    kh->D = NULL;
+    kh->dBk = NULL;
+    kh->b1 = NULL;
+    kh->kainfo = ainfo;
 
     kh->Bk = gretl_matrix_block_new(&kh->a, r, 1,
 				    &kh->P, r, r,
@@ -106,8 +139,6 @@ static khelper *kalman_helper_new (arma_info *ainfo,
     if (err) {
         kalman_helper_free(kh);
         kh = NULL;
-    } else {
-        kh->kainfo = ainfo;
     }
 
     return kh;
@@ -507,6 +538,222 @@ static int rewrite_kalman_matrices (kalman *K, const double *b, int i)
     return err;
 }
 
+/* Analytical score. Each of T, Z and B is affine in any single
+   ARMA parameter (the seasonal forms are products of a "plain" and
+   a seasonal coefficient), so its derivative can be obtained exactly
+   as the change in response to a unit increment. The derivative of
+   P_{1|0} then solves the Lyapunov equation
+
+   dP - T dP T' = dT P T' + T P dT'
+
+   which we handle via the same vec (or vech) apparatus that is used
+   for P itself in write_kalman_matrices(), but with all the AR terms
+   as right-hand sides of a single system.
+*/
+
+static int kalman_deriv_init (khelper *kh, int r, int k)
+{
+    arma_info *ainfo = kh->kainfo;
+    int nar = ainfo->np + ainfo->P;
+    int nma = ainfo->nq + ainfo->Q;
+    int r0 = ainfo->r0;
+    int m = arma_using_vech(ainfo) ? r0 * (r0 + 1) / 2 : r0 * r0;
+    int i, j, err = 0;
+
+    kh->D = calloc(ainfo->nc, sizeof *kh->D);
+    kh->b1 = malloc(ainfo->nc * sizeof *kh->b1);
+    kh->dBk = gretl_matrix_block_new(&kh->arow, 1, r0,
+                                     &kh->mcol, r, 1,
+                                     &kh->dT0, r0, r0,
+                                     &kh->dP0, r0, r0,
+                                     &kh->dC, r0, r0,
+                                     &kh->dR, m, nar > 0 ? nar : 1,
+                                     NULL);
+    if (kh->D == NULL || kh->b1 == NULL || kh->dBk == NULL) {
+        return E_ALLOC;
+    }
+
+    for (i=0; i<ainfo->nc && !err; i++) {
+        kalman_deriv *Di = &kh->D[i];
+
+        j = i - ainfo->ifc;
+        if (j >= 0 && j < nar) {
+            Di->T = gretl_zero_matrix_new(r, r);
+            Di->P = gretl_zero_matrix_new(r, r);
+            err = (Di->T == NULL || Di->P == NULL);
+        } else if (j >= nar && j < nar + nma) {
+            Di->ZT = gretl_zero_matrix_new(r, 1);
+            if (arima_levels(ainfo)) {
+                Di->T = gretl_zero_matrix_new(r, r);
+            }
+            err = (Di->ZT == NULL || (arima_levels(ainfo) && Di->T == NULL));
+        } else {
+            /* const or coefficient on regressor: fixed */
+            Di->BT = gretl_zero_matrix_new(k, 1);
+            if (Di->BT == NULL) {
+                err = 1;
+            } else {
+                Di->BT->val[j < 0 ? 0 : j - nar - nma + 1] = 1.0;
+            }
+        }
+    }
+
+    return err ? E_ALLOC : 0;
+}
+
+/* write the first row of the ARMA transition matrix into @row */
+
+static void arma_ar_row (arma_info *ainfo, const double *b,
+                         gretl_matrix *row)
+{
+    const double *phi = b + ainfo->ifc;
+    const double *Phi = phi + ainfo->np;
+    int i, k = 0;
+
+    gretl_matrix_zero(row);
+
+    if (ainfo->P > 0) {
+        write_big_phi(phi, Phi, ainfo, row);
+    } else {
+        for (i=0; i<ainfo->p; i++) {
+            if (AR_included(ainfo, i)) {
+                row->val[i] = phi[k++];
+            }
+        }
+    }
+}
+
+/* write the MA coefficients into elements 1 to qmax of @col */
+
+static void arma_ma_col (arma_info *ainfo, const double *b,
+                         gretl_matrix *col)
+{
+    const double *theta = b + ainfo->ifc + ainfo->np + ainfo->P;
+    const double *Theta = theta + ainfo->nq;
+    int i, k = 0;
+
+    gretl_matrix_zero(col);
+
+    if (ainfo->Q > 0) {
+        write_big_theta(theta, Theta, ainfo, col, NULL);
+    } else {
+        for (i=0; i<ainfo->q; i++) {
+            if (MA_included(ainfo, i)) {
+                col->val[i+1] = theta[k++];
+            }
+        }
+    }
+}
+
+static int write_kalman_derivs (khelper *kh, const double *b)
+{
+    arma_info *ainfo = kh->kainfo;
+    gretl_matrix *T = (kh->T_ != NULL)? kh->T_ : kh->T;
+    gretl_matrix *P = (kh->P_ != NULL)? kh->P_ : kh->P;
+    int nar = ainfo->np + ainfo->P;
+    int nma = ainfo->nq + ainfo->Q;
+    int r0 = ainfo->r0;
+    int i, j, c, err = 0;
+
+    memcpy(kh->b1, b, ainfo->nc * sizeof *b);
+
+    for (j=0; j<nar; j++) {
+        kalman_deriv *Dj = &kh->D[ainfo->ifc + j];
+
+        /* dT: the change in the first row of T */
+        kh->b1[ainfo->ifc + j] += 1.0;
+        arma_ar_row(ainfo, kh->b1, kh->arow);
+        kh->b1[ainfo->ifc + j] = b[ainfo->ifc + j];
+        gretl_matrix_zero(kh->dT0);
+        for (c=0; c<r0; c++) {
+            kh->dT0->val[c*r0] = kh->arow->val[c] - gretl_matrix_get(T, 0, c);
+            gretl_matrix_set(Dj->T, 0, c, kh->dT0->val[c*r0]);
+        }
+        /* right-hand side for dP: dT P T' + T P dT' */
+        gretl_matrix_multiply(kh->dT0, P, kh->dP0);
+        gretl_matrix_multiply_mod(kh->dP0, GRETL_MOD_NONE,
+                                  T, GRETL_MOD_TRANSPOSE,
+                                  kh->dC, GRETL_MOD_NONE);
+        for (c=0; c<r0; c++) {
+            for (i=c; i<r0; i++) {
+                double x = gretl_matrix_get(kh->dC, i, c) +
+                    gretl_matrix_get(kh->dC, c, i);
+
+                gretl_matrix_set(kh->dC, i, c, x);
+                gretl_matrix_set(kh->dC, c, i, x);
+            }
+        }
+        if (arma_using_vech(ainfo)) {
+            gretl_matrix_vectorize_h(kh->vQ, kh->dC);
+        } else {
+            gretl_matrix_vectorize(kh->vQ, kh->dC);
+        }
+        for (i=0; i<kh->dR->rows; i++) {
+            gretl_matrix_set(kh->dR, i, j, kh->vQ->val[i]);
+        }
+    }
+
+    if (nar > 0) {
+        gretl_matrix_kronecker_product(T, T, kh->avar);
+        gretl_matrix_I_minus(kh->avar);
+        if (arma_using_vech(ainfo)) {
+            condense_state_vcv(kh->avar2, kh->avar, r0);
+            err = gretl_LU_solve(kh->avar2, kh->dR);
+        } else {
+            err = gretl_LU_solve(kh->avar, kh->dR);
+        }
+        for (j=0; j<nar && !err; j++) {
+            for (i=0; i<kh->dR->rows; i++) {
+                kh->vQ->val[i] = gretl_matrix_get(kh->dR, i, j);
+            }
+            if (arma_using_vech(ainfo)) {
+                gretl_matrix_unvectorize_h(kh->dP0, kh->vQ);
+            } else {
+                gretl_matrix_unvectorize(kh->dP0, kh->vQ);
+            }
+            gretl_matrix_inscribe_matrix(kh->D[ainfo->ifc + j].P, kh->dP0,
+                                         0, 0, GRETL_MOD_NONE);
+        }
+    }
+
+    for (j=0; j<nma && !err; j++) {
+        kalman_deriv *Dj = &kh->D[ainfo->ifc + nar + j];
+        int qmax = ainfo->q + ainfo->pd * ainfo->Q;
+
+        kh->b1[ainfo->ifc + nar + j] += 1.0;
+        arma_ma_col(ainfo, kh->b1, Dj->ZT);
+        kh->b1[ainfo->ifc + nar + j] = b[ainfo->ifc + nar + j];
+        for (i=1; i<=qmax; i++) {
+            Dj->ZT->val[i] -= kh->Z->val[i];
+            if (Dj->T != NULL) {
+                /* ARIMA via levels: T carries theta too */
+                gretl_matrix_set(Dj->T, r0, i, Dj->ZT->val[i]);
+            }
+        }
+    }
+
+    return err;
+}
+
+/* gradient callback for BFGS */
+
+static int kalman_arma_score (double *b, double *g, int n,
+                              BFGS_CRIT_FUNC ll, void *data)
+{
+    kalman *K = (kalman *) data;
+    khelper *kh = kalman_get_data(K);
+    int err = rewrite_kalman_matrices(K, b, KALMAN_ALL);
+
+    if (!err) {
+        err = write_kalman_derivs(kh, b);
+    }
+    if (!err) {
+        err = kfilter_score(K, kh->D, n, g);
+    }
+
+    return err;
+}
+
 /* used only in obtaining the OPG, if wanted */
 
 static const double *kalman_arma_llt_callback (const double *b, int i,
@@ -763,6 +1010,11 @@ static int kalman_arma (const double *coeff,
         goto bailout;
     }
 
+    err = kalman_deriv_init(kh, r, k);
+    if (err) {
+        goto bailout;
+    }
+
     kalman_matrices_init(ainfo, kh, dset->Z[ainfo->yno]);
 
     K = kalman_new(kh->a, kh->P, kh->T, kh->B, kh->Z, kh->Q,
@@ -791,7 +1043,7 @@ static int kalman_arma (const double *coeff,
         err = BFGS_max(b, ainfo->nc, maxit, toler,
                        &ainfo->fncount, &ainfo->grcount,
                        kalman_arma_ll, C_LOGLIK,
-                       NULL, K, NULL, opt | OPT_A,
+                       kalman_arma_score, K, NULL, opt | OPT_A,
                        ainfo->prn);
 
         if (save_lbfgs == 0 && (opt & OPT_L)) {
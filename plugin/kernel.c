@@ -20,6 +20,7 @@
 #include "libgretl.h"
 #include "version.h"
 #include "nonparam.h"
+#include "gretl_cmatrix.h"
 
 #define KDEBUG 0
 
@@ -30,6 +31,20 @@
 #define ROOT5  2.23606797749979     /* sqrt(5) */
 #define EPMULT 0.3354101966249685   /* 3 over (4 * sqrt(5)) */
 
+/* Above KD_BINNED_MIN observations the density is by default
+   computed from linearly binned data (see Wand and Jones, Kernel
+   Smoothing, Appendix D) rather than by summing over all the data
+   at each evaluation point. The bins are KD_BIN_RES times finer
+   than the bandwidth, which keeps the approximation error well
+   below what's visible in a plot; the Gaussian kernel is truncated
+   at KD_GAUSS_CUT standard deviations.
+*/
+
+#define KD_BINNED_MIN 10000
+#define KD_BIN_RES    32
+#define KD_MAXBINS    4194304
+#define KD_GAUSS_CUT  8.0
+
 enum {
     GAUSSIAN_KERNEL,
     EPANECHNIKOV_KERNEL
@@ -48,6 +63,7 @@ struct kernel_info_ {
     double xmin;
     double xmax;
     double xstep;
+    int binned;      /* use binned approximation? */
 };
 
 static double ep_pdf (double z)
@@ -94,15 +110,222 @@ static double kernel (kernel_info *kinfo, double x0, int j)
     return den;
 }
 
+static double kernel_weight (int type, double z)
+{
+    if (type == GAUSSIAN_KERNEL) {
+	return normal_pdf(z);
+    } else {
+	return ep_pdf(z);
+    }
+}
+
+/* Circular convolution of the bin counts @c (length @M) with the
+   symmetric kernel weights @w (w[0] to w[L]) via FFT, writing the
+   first @M terms of the result into @g.
+*/
+
+static int fft_convolve (const double *c, const double *w,
+			 int M, int L, double *g)
+{
+    gretl_matrix *A, *F = NULL;
+    gretl_matrix *G = NULL, *y = NULL;
+    int P = 2;
+    int i, err = 0;
+
+    while (P < M + L) {
+	P *= 2;
+    }
+
+    A = gretl_zero_matrix_new(P, 2);
+    if (A == NULL) {
+	return E_ALLOC;
+    }
+
+    memcpy(A->val, c, M * sizeof *c);
+    A->val[P] = w[0];
+    for (i=1; i<=L; i++) {
+	A->val[P+i] = A->val[2*P-i] = w[i];
+    }
+
+    F = gretl_matrix_fft(A, &err);
+
+    if (!err) {
+	G = gretl_cmatrix_new(P, 1);
+	if (G == NULL) {
+	    err = E_ALLOC;
+	}
+    }
+
+    if (!err) {
+	/* multiply the transforms, keeping the product exactly
+	   Hermitian so that its inverse comes out real
+	*/
+	for (i=0; i<=P/2; i++) {
+	    G->z[i] = F->z[i] * F->z[P+i];
+	}
+	G->z[0] = creal(G->z[0]);
+	G->z[P/2] = creal(G->z[P/2]);
+	for (i=1; i<P/2; i++) {
+	    G->z[P-i] = conj(G->z[i]);
+	}
+	y = gretl_matrix_ffti(G, &err);
+    }
+
+    if (!err) {
+	memcpy(g, y->val, M * sizeof *g);
+    }
+
+    gretl_matrix_free(A);
+    gretl_matrix_free(F);
+    gretl_matrix_free(G);
+    gretl_matrix_free(y);
+
+    return err;
+}
+
+/* Approximate the density at the kn + 1 evaluation points using
+   linear binning of the (sorted) data on a grid that refines the
+   evaluation grid by an integer factor, so that each evaluation
+   point coincides with a grid point. The resulting discrete
+   convolution is done directly if it's cheap enough, otherwise
+   by FFT.
+*/
+
+static int binned_density (kernel_info *kinfo, int j, double *f)
+{
+    const double *x = kinfo->x;
+    double cut, delta, p, h;
+    double *c, *w, *g = NULL;
+    int n = kinfo->n;
+    int kn = kinfo->kn;
+    int r, M, L, P;
+    int i, l, t, err = 0;
+
+    h = (kinfo->hvec != NULL)? kinfo->hvec[j] : kinfo->h;
+    cut = (kinfo->type == GAUSSIAN_KERNEL)? KD_GAUSS_CUT : ROOT5;
+
+    r = (int) ceil(KD_BIN_RES * kinfo->xstep / h);
+    if (r < 1) {
+	r = 1;
+    } else if ((double) kn * r + 1 > KD_MAXBINS) {
+	r = (KD_MAXBINS - 1) / kn;
+    }
+    M = kn * r + 1;
+    delta = kinfo->xstep / r;
+    L = (int) ceil(cut * h / delta);
+    if (L > M - 1) {
+	L = M - 1;
+    }
+
+    c = calloc(M, sizeof *c);
+    w = malloc((L + 1) * sizeof *w);
+    if (c == NULL || w == NULL) {
+	free(c);
+	free(w);
+	return E_ALLOC;
+    }
+
+    /* share each observation between its two neighboring
+       grid points */
+    for (i=0; i<n; i++) {
+	p = (x[i] - kinfo->xmin) / delta;
+	l = (int) floor(p);
+	if (l < 0) {
+	    c[0] += 1.0;
+	} else if (l >= M - 1) {
+	    c[M-1] += 1.0;
+	} else {
+	    c[l] += l + 1 - p;
+	    c[l+1] += p - l;
+	}
+    }
+
+    for (l=0; l<=L; l++) {
+	w[l] = kernel_weight(kinfo->type, l * delta / h);
+    }
+
+    P = 2;
+    while (P < M + L) {
+	P *= 2;
+    }
+
+    if ((double) (kn + 1) * (2 * L + 1) < 4.0 * P * log2(P)) {
+	int l0, lmin, lmax;
+	double s;
+
+	for (t=0; t<=kn; t++) {
+	    l0 = t * r;
+	    lmin = (l0 > L)? l0 - L : 0;
+	    lmax = (l0 + L < M)? l0 + L : M - 1;
+	    s = 0.0;
+	    for (l=lmin; l<=lmax; l++) {
+		s += c[l] * w[abs(l - l0)];
+	    }
+	    f[t] = s / (h * n);
+	}
+    } else {
+	g = malloc(M * sizeof *g);
+	if (g == NULL) {
+	    err = E_ALLOC;
+	} else {
+	    err = fft_convolve(c, w, M, L, g);
+	}
+	if (!err) {
+	    for (t=0; t<=kn; t++) {
+		/* zap tiny negative round-off in the tails */
+		f[t] = (g[t*r] > 0)? g[t*r] / (h * n) : 0.0;
+	    }
+	}
+	free(g);
+    }
+
+    free(c);
+    free(w);
+
+    return err;
+}
+
+/* Fill @f with the estimated density at the kn + 1 evaluation
+   points, for the data in kinfo->x and bandwidth @j.
+*/
+
+static int density_values (kernel_info *kinfo, int j, double *f)
+{
+    if (kinfo->binned) {
+	return binned_density(kinfo, j, f);
+    } else {
+	double xt = kinfo->xmin;
+	int t;
+
+	for (t=0; t<=kinfo->kn; t++) {
+	    f[t] = kernel(kinfo, xt, j);
+	    xt += kinfo->xstep;
+	}
+	return 0;
+    }
+}
+
 static int density_plot (kernel_info *kinfo, const char *vname)
 {
     FILE *fp;
     gchar *tmp = NULL;
-    double xt, xdt;
+    double *f, xt;
     int t, err = 0;
 
+    f = malloc((kinfo->kn + 1) * sizeof *f);
+    if (f == NULL) {
+	return E_ALLOC;
+    }
+
+    err = density_values(kinfo, 0, f);
+    if (err) {
+	free(f);
+	return err;
+    }
+
     fp = open_plot_input_file(PLOT_KERNEL, 0, &err);
     if (err) {
+	free(f);
 	return err;
     }
 
@@ -127,14 +350,15 @@ static int density_plot (kernel_info *kinfo, const char *vname)
 
     xt = kinfo->xmin;
     for (t=0; t<=kinfo->kn; t++) {
-	xdt = kernel(kinfo, xt, 0);
-	fprintf(fp, "%g %g\n", xt, xdt);
+	fprintf(fp, "%g %g\n", xt, f[t]);
 	xt += kinfo->xstep;
     }
     fputs("e\n", fp);
 
     gretl_pop_c_numeric_locale();
 
+    free(f);
+
     return finalize_plot_input_file(fp);
 }
 
@@ -142,7 +366,7 @@ static gretl_matrix *density_matrix (kernel_info *kinfo,
 				     int *err)
 {
     gretl_matrix *m;
-    double xt, xdt;
+    double xt;
     int t;
 
     m = gretl_matrix_alloc(kinfo->kn + 1, 2);
@@ -153,12 +377,16 @@ static gretl_matrix *density_matrix (kernel_info *kinfo,
 
     xt = kinfo->xmin;
     for (t=0; t<=kinfo->kn; t++) {
-	xdt = kernel(kinfo, xt, 0);
 	gretl_matrix_set(m, t, 0, xt);
-	gretl_matrix_set(m, t, 1, xdt);
 	xt += kinfo->xstep;
     }
 
+    *err = density_values(kinfo, 0, m->val + m->rows);
+    if (*err) {
+	gretl_matrix_free(m);
+	m = NULL;
+    }
+
     return m;
 }
 
@@ -166,7 +394,7 @@ static gretl_matrix *multi_density_matrix (kernel_info *kinfo,
 					   int *err)
 {
     gretl_matrix *m;
-    double xt, xdtj;
+    double xt;
     int nc = kinfo->X->cols;
     int t, j;
 
@@ -179,14 +407,19 @@ static gretl_matrix *multi_density_matrix (kernel_info *kinfo,
     xt = kinfo->xmin;
     for (t=0; t<=kinfo->kn; t++) {
 	gretl_matrix_set(m, t, 0, xt);
-	for (j=0; j<nc; j++) {
-	    kinfo->x = kinfo->X->val + j * kinfo->n;
-	    xdtj = kernel(kinfo, xt, j);
-	    gretl_matrix_set(m, t, j+1, xdtj);
-	}
 	xt += kinfo->xstep;
     }
 
+    for (j=0; j<nc && !*err; j++) {
+	kinfo->x = kinfo->X->val + j * kinfo->n;
+	*err = density_values(kinfo, j, m->val + (j+1) * m->rows);
+    }
+
+    if (*err) {
+	gretl_matrix_free(m);
+	m = NULL;
+    }
+
     return m;
 }
 
@@ -261,6 +494,7 @@ static int set_kernel_params (kernel_info *kinfo,
 
     kinfo->type = (opt & OPT_O)? EPANECHNIKOV_KERNEL :
 	GAUSSIAN_KERNEL;
+    kinfo->binned = kinfo->n >= KD_BINNED_MIN && !(opt & OPT_X);
 
     return err;
 }
@@ -375,6 +609,7 @@ gretl_matrix *multiple_kd_matrix (const gretl_matrix *X,
     kinfo.xstep = (kinfo.xmax - kinfo.xmin) / kinfo.kn;
     kinfo.type = (opt & OPT_O)? EPANECHNIKOV_KERNEL :
 	GAUSSIAN_KERNEL;
+    kinfo.binned = kinfo.n >= KD_BINNED_MIN && !(opt & OPT_X);
 
     if (!*err) {
 	m = multi_density_matrix(&kinfo, err);
@@ -22,8 +22,13 @@
 */
 
 #include "libgretl.h"
+#include "gretl_mt.h"
 #include "version.h"
 
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
 #if defined(PKGBUILD)
 # define PRELINKED
 #elif defined(WIN32)
@@ -41,6 +46,7 @@
 
 static lprec *(*make_lp) (int rows, int columns);
 static lprec *(*read_lp) (FILE *fp, int verbose, char *lp_name);
+static lprec *(*copy_lp) (lprec *lp);
 static unsigned char (*set_add_rowmode) (lprec *lp, unsigned char s);
 static void (*delete_lp) (lprec *lp);
 static void (*set_verbose) (lprec *lp, int verbose);
@@ -48,6 +54,8 @@ static void (*set_maxim) (lprec *lp);
 static void (*set_minim) (lprec *lp);
 static unsigned char (*set_lp_name) (lprec *lp, char *s);
 static unsigned char (*set_obj_fn) (lprec *lp, REAL *row);
+static unsigned char (*set_rh_vec) (lprec *lp, REAL *rh);
+static void (*set_simplextype) (lprec *lp, int simplextype);
 static unsigned char (*add_constraint) (lprec *lp, REAL *row,
 					int constr_type, REAL rh);
 static unsigned char (*set_col_name) (lprec *lp, int col, char *name);
@@ -109,6 +117,7 @@ static int gretl_lpsolve_init (void)
     } else {
 	make_lp             = lpget(lphandle, "make_lp", &err);
 	read_lp             = lpget(lphandle, "read_lp", &err);
+	copy_lp             = lpget(lphandle, "copy_lp", &err);
 	set_add_rowmode     = lpget(lphandle, "set_add_rowmode", &err);
 	set_lp_name         = lpget(lphandle, "set_lp_name", &err);
 	delete_lp           = lpget(lphandle, "delete_lp", &err);
@@ -116,6 +125,8 @@ static int gretl_lpsolve_init (void)
 	set_maxim           = lpget(lphandle, "set_maxim", &err);
 	set_minim           = lpget(lphandle, "set_minim", &err);
 	set_obj_fn          = lpget(lphandle, "set_obj_fn", &err);
+	set_rh_vec          = lpget(lphandle, "set_rh_vec", &err);
+	set_simplextype     = lpget(lphandle, "set_simplextype", &err);
 	add_constraint      = lpget(lphandle, "add_constraint", &err);
 	set_col_name        = lpget(lphandle, "set_col_name", &err);
 	set_row_name        = lpget(lphandle, "set_row_name", &err);
@@ -627,6 +638,276 @@ static int maybe_catch_solve (lprec *lp, gretlopt opt,
     return retval;
 }
 
+/* Batch mode: the specs bundle may hold a matrix "rhs", with one
+   column of right-hand side values per problem, and/or a matrix
+   "objectives", with one row of objective coefficients per problem.
+   The model is built once; each problem is then solved after
+   changing only the relevant vector, which lets lpsolve start
+   from the basis of the previous solution. The problems are
+   split into contiguous blocks handled by separate threads, each
+   working on its own copy of the model.
+*/
+
+struct lp_batch {
+    const gretl_matrix *R;  /* right-hand sides, or NULL */
+    const gretl_matrix *O;  /* objectives, or NULL */
+    int np;                 /* number of problems */
+    int nr;                 /* number of constraints */
+    int nc;                 /* number of variables */
+    gretl_matrix *obj;      /* optimized objective values */
+    gretl_matrix *stat;     /* solver status codes */
+    gretl_matrix *VV;       /* variable values */
+    gretl_matrix *VC;       /* constraint values */
+    gretl_matrix *SP;       /* shadow prices */
+};
+
+static int lp_batch_setup (gretl_bundle *b, lprec *lp,
+			   struct lp_batch *lb)
+{
+    int np = 0;
+
+    lb->R = gretl_bundle_get_matrix(b, "rhs", NULL);
+    lb->O = gretl_bundle_get_matrix(b, "objectives", NULL);
+    lb->nr = get_Nrows(lp);
+    lb->nc = get_Ncolumns(lp);
+
+    if (lb->R != NULL) {
+	if (lb->R->rows != lb->nr) {
+	    gretl_errmsg_set(_("lpsolve: rhs must have a row per constraint"));
+	    return E_NONCONF;
+	}
+	np = lb->R->cols;
+    }
+    if (lb->O != NULL) {
+	if (lb->O->cols != lb->nc) {
+	    gretl_errmsg_set(_("lpsolve: objectives must have a column per variable"));
+	    return E_NONCONF;
+	} else if (np > 0 && lb->O->rows != np) {
+	    gretl_errmsg_set(_("lpsolve: rhs and objectives do not match"));
+	    return E_NONCONF;
+	}
+	np = lb->O->rows;
+    }
+    if (np == 0) {
+	return E_DATA;
+    }
+
+    lb->np = np;
+    lb->obj = gretl_matrix_alloc(np, 1);
+    lb->stat = gretl_matrix_alloc(np, 1);
+    lb->VV = gretl_matrix_alloc(lb->nc, np);
+    lb->VC = gretl_matrix_alloc(lb->nr, np);
+    lb->SP = gretl_matrix_alloc(lb->nr, np);
+
+    if (lb->obj == NULL || lb->stat == NULL || lb->VV == NULL ||
+	lb->VC == NULL || lb->SP == NULL) {
+	return E_ALLOC;
+    }
+
+    return 0;
+}
+
+static void lp_batch_free (struct lp_batch *lb)
+{
+    gretl_matrix_free(lb->obj);
+    gretl_matrix_free(lb->stat);
+    gretl_matrix_free(lb->VV);
+    gretl_matrix_free(lb->VC);
+    gretl_matrix_free(lb->SP);
+}
+
+/* Solve problems @j1 to @j2 - 1 of the batch, using @lp,
+   which is not shared with any other thread. */
+
+static int lp_batch_solve_range (lprec *lp, struct lp_batch *lb,
+				 int j1, int j2)
+{
+    int nr = lb->nr, nc = lb->nc;
+    int psize = 1 + nr + nc;
+    double *vec = malloc((nr + nc + 1) * sizeof *vec);
+    double *prim = malloc(psize * sizeof *prim);
+    double *dual = malloc(psize * sizeof *dual);
+    int i, j, ret;
+
+    if (vec == NULL || prim == NULL || dual == NULL) {
+	free(vec);
+	free(prim);
+	free(dual);
+	return E_ALLOC;
+    }
+
+    /* with only the RHS changing, the previous optimal basis stays
+       dual feasible; with only the objective changing it stays
+       primal feasible */
+    if (lb->O == NULL) {
+	set_simplextype(lp, SIMPLEX_DUAL_DUAL);
+    } else if (lb->R == NULL) {
+	set_simplextype(lp, SIMPLEX_PRIMAL_PRIMAL);
+    }
+
+    for (j=j1; j<j2; j++) {
+	vec[0] = 0;
+	if (lb->R != NULL) {
+	    for (i=0; i<nr; i++) {
+		vec[i+1] = gretl_matrix_get(lb->R, i, j);
+	    }
+	    set_rh_vec(lp, vec);
+	}
+	if (lb->O != NULL) {
+	    for (i=0; i<nc; i++) {
+		vec[i+1] = gretl_matrix_get(lb->O, j, i);
+	    }
+	    set_obj_fn(lp, vec);
+	}
+	ret = solve(lp);
+	lb->stat->val[j] = ret;
+	if (ret == OPTIMAL || ret == SUBOPTIMAL) {
+	    lb->obj->val[j] = get_objective(lp);
+	    get_primal_solution(lp, prim);
+	    for (i=0; i<nr; i++) {
+		gretl_matrix_set(lb->VC, i, j, prim[i+1]);
+	    }
+	    for (i=0; i<nc; i++) {
+		gretl_matrix_set(lb->VV, i, j, prim[nr+i+1]);
+	    }
+	    if (get_dual_solution(lp, dual)) {
+		for (i=0; i<nr; i++) {
+		    gretl_matrix_set(lb->SP, i, j, dual[i+1]);
+		}
+	    } else {
+		for (i=0; i<nr; i++) {
+		    gretl_matrix_set(lb->SP, i, j, NADBL);
+		}
+	    }
+	} else {
+	    lb->obj->val[j] = NADBL;
+	    for (i=0; i<nr; i++) {
+		gretl_matrix_set(lb->VC, i, j, NADBL);
+		gretl_matrix_set(lb->SP, i, j, NADBL);
+	    }
+	    for (i=0; i<nc; i++) {
+		gretl_matrix_set(lb->VV, i, j, NADBL);
+	    }
+	}
+    }
+
+    free(vec);
+    free(prim);
+    free(dual);
+
+    return 0;
+}
+
+#if defined(_OPENMP)
+
+/* the number of threads to use for @np problems of @nr
+   constraints in @nc variables */
+
+static int lp_batch_threads (int np, int nr, int nc)
+{
+    int nt = gretl_get_omp_threads();
+
+    if (nt < 2 || np < 2 * nt ||
+	!gretl_use_openmp((guint64) np * nr * nc)) {
+	return 1;
+    }
+
+    return nt;
+}
+
+#endif
+
+static int lp_batch_solve (lprec *lp, struct lp_batch *lb)
+{
+    int err = 0;
+#if defined(_OPENMP)
+    int nt = lp_batch_threads(lb->np, lb->nr, lb->nc);
+
+    if (nt > 1) {
+	int t;
+
+#pragma omp parallel for num_threads(nt) private(t)
+	for (t=0; t<nt; t++) {
+	    int j1 = (int) ((gint64) lb->np * t / nt);
+	    int j2 = (int) ((gint64) lb->np * (t+1) / nt);
+	    lprec *lpt = copy_lp(lp);
+	    int myerr;
+
+	    if (lpt == NULL) {
+		myerr = E_ALLOC;
+	    } else {
+		myerr = lp_batch_solve_range(lpt, lb, j1, j2);
+		delete_lp(lpt);
+	    }
+	    if (myerr) {
+#pragma omp critical (lp_batch_err)
+		err = myerr;
+	    }
+	}
+	return err;
+    }
+#endif
+
+    err = lp_batch_solve_range(lp, lb, 0, lb->np);
+
+    return err;
+}
+
+static void lp_batch_set_names (struct lp_batch *lb,
+				const char **cnames,
+				const char **rnames,
+				lprec *lp)
+{
+    char **S;
+
+    if (cnames != NULL) {
+	S = strings_array_dup((char **) cnames, lb->nc);
+    } else {
+	S = get_lp_colnames(lp, lb->nc);
+    }
+    gretl_matrix_set_rownames(lb->VV, S);
+
+    if (rnames != NULL) {
+	S = strings_array_dup((char **) rnames, lb->nr);
+	gretl_matrix_set_rownames(lb->VC, S);
+	S = strings_array_dup((char **) rnames, lb->nr);
+	gretl_matrix_set_rownames(lb->SP, S);
+    } else {
+	S = get_lp_rownames(lp, lb->nr);
+	gretl_matrix_set_rownames(lb->VC, S);
+	S = get_lp_rownames(lp, lb->nr);
+	gretl_matrix_set_rownames(lb->SP, S);
+    }
+}
+
+static int lp_batch_run (lprec *lp, gretl_bundle *b,
+			 gretl_bundle *ret,
+			 const char **cnames,
+			 const char **rnames)
+{
+    struct lp_batch lb = {0};
+    int err;
+
+    err = lp_batch_setup(b, lp, &lb);
+
+    if (!err) {
+	err = lp_batch_solve(lp, &lb);
+    }
+
+    if (!err) {
+	lp_batch_set_names(&lb, cnames, rnames, lp);
+	gretl_bundle_donate_data(ret, "objective", lb.obj, GRETL_TYPE_MATRIX, 0);
+	gretl_bundle_donate_data(ret, "status", lb.stat, GRETL_TYPE_MATRIX, 0);
+	gretl_bundle_donate_data(ret, "variable_values", lb.VV, GRETL_TYPE_MATRIX, 0);
+	gretl_bundle_donate_data(ret, "constraint_values", lb.VC, GRETL_TYPE_MATRIX, 0);
+	gretl_bundle_donate_data(ret, "shadow_prices", lb.SP, GRETL_TYPE_MATRIX, 0);
+    } else {
+	lp_batch_free(&lb);
+    }
+
+    return err;
+}
+
 /* driver function */
 
 gretl_bundle *gretl_lpsolve (gretl_bundle *b, PRN *prn, int *err)
@@ -686,16 +967,28 @@ gretl_bundle *gretl_lpsolve (gretl_bundle *b, PRN *prn, int *err)
 	} else {
 	    set_verbose(lp, CRITICAL);
 	}	
-	*err = maybe_catch_solve(lp, opt, prn);
-	if (*err) {
-	    gretl_errmsg_set(_("lpsolve: solution failed"));
-	} else {
+	if (gretl_bundle_has_key(b, "rhs") ||
+	    gretl_bundle_has_key(b, "objectives")) {
+	    set_verbose(lp, NEUTRAL);
 	    ret = gretl_bundle_new();
-	    *err = get_lp_model_data(lp, ret, cnames, rnames,
-				     opt, vprn);
+	    *err = lp_batch_run(lp, b, ret, cnames, rnames);
+	} else {
+	    *err = maybe_catch_solve(lp, opt, prn);
+	    if (*err) {
+		gretl_errmsg_set(_("lpsolve: solution failed"));
+	    } else {
+		ret = gretl_bundle_new();
+		*err = get_lp_model_data(lp, ret, cnames, rnames,
+					 opt, vprn);
+	    }
 	}
     }
 
+    if (*err && ret != NULL) {
+	gretl_bundle_destroy(ret);
+	ret = NULL;
+    }
+
     if (lp != NULL) {
 	delete_lp(lp);
     }
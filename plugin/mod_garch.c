@@ -158,38 +158,78 @@ static void garch_container_destroy (garch_container *DH)
     free(DH);
 }
 
-/* *ARCH log-likelihood for Gaussian innovations */
+/* Conditional variances and *ARCH log-likelihood for Gaussian
+   innovations, computed in a single pass for use when derivatives
+   are not wanted. The commonest orders have their lags unrolled.
+   On entry e2 and the pre-sample values of h must be filled in.
+*/
 
-static double normal_ll (const garch_container *DH)
+static double normal_ll (const double *par, garch_container *DH)
 {
-    double e2t, ht, ll = 0.0;
-    int t;
+    const double *alpha = par + DH->ncm + 1;
+    const double *beta = alpha + DH->q;
+    const double *e2 = DH->e2;
+    double omega = par[DH->ncm];
+    double *h = DH->h;
+    double ht, h1, h2, ll = 0.0;
+    int t1 = DH->t1;
+    int t2 = DH->t2;
+    int p = DH->p;
+    int q = DH->q;
+    int i, t;
 
-    for (t=DH->t1; t<=DH->t2; t++) {
-	e2t = DH->e2[t];
-	ht = DH->h[t];
-	if (na(e2t) || na(ht)) {
-	    return NADBL;
+    if (q == 1 && p == 1) {
+	double a1 = alpha[0], b1 = beta[0];
+
+	h1 = h[t1-1];
+	for (t=t1; t<=t2; t++) {
+	    h[t] = ht = omega + a1 * e2[t-1] + b1 * h1;
+	    ll -= log(ht) + e2[t] / ht;
+	    h1 = ht;
+	}
+    } else if (q == 1 && p == 2) {
+	double a1 = alpha[0], b1 = beta[0], b2 = beta[1];
+
+	h1 = h[t1-1];
+	h2 = h[t1-2];
+	for (t=t1; t<=t2; t++) {
+	    h[t] = ht = omega + a1 * e2[t-1] + b1 * h1 + b2 * h2;
+	    ll -= log(ht) + e2[t] / ht;
+	    h2 = h1;
+	    h1 = ht;
 	}
-	ll -= log(ht) + e2t / ht;
+    } else if (q == 2 && p == 1) {
+	double a1 = alpha[0], a2 = alpha[1], b1 = beta[0];
+
+	h1 = h[t1-1];
+	for (t=t1; t<=t2; t++) {
+	    h[t] = ht = omega + a1 * e2[t-1] + a2 * e2[t-2] + b1 * h1;
+	    ll -= log(ht) + e2[t] / ht;
+	    h1 = ht;
+	}
+    } else {
+	for (t=t1; t<=t2; t++) {
+	    ht = omega;
+	    for (i=1; i<=q; i++) {
+		ht += e2[t-i] * alpha[i-1];
+	    }
+	    for (i=1; i<=p; i++) {
+		ht += h[t-i] * beta[i-1];
+	    }
+	    h[t] = ht;
+	    ll -= log(ht) + e2[t] / ht;
+	}
+    }
+
+    if (na(ll)) {
+	return NADBL;
     }
 
     ll *= 0.5;
-    ll -= (DH->t2 - DH->t1 + 1) * LN_SQRT_2_PI;
+    ll -= (t2 - t1 + 1) * LN_SQRT_2_PI;
 
     return ll;
-} 
-
-static void normal_score (const garch_container *DH)
-{
-    double ut;
-    int t;
-
-    for (t=DH->t1; t<=DH->t2; t++) {
-	DH->blockglue[0][t] = ut = -DH->e[t] / DH->h[t];
-	DH->blockglue[1][t] = 0.5 * (ut * ut - 1.0 / DH->h[t]);
-    }
-} 
+}
 
 static int params_in_bounds (const double *par, int ncm, int k)
 {
@@ -207,9 +247,14 @@ static int params_in_bounds (const double *par, int ncm, int k)
     return ok;
 }
 
-/* Compute the GARCH quantities */
+/* Compute the GARCH quantities: if @deriv is zero we stop after
+   the residuals and the pre-sample variances, leaving the in-sample
+   variances to normal_ll(); otherwise we also fill out h and the
+   derivatives of e and h with respect to the parameters.
+*/
 
-static int garch_etht (const double *par, garch_container *DH)
+static int garch_etht (const double *par, garch_container *DH,
+		       int deriv)
 {
     double **dedq = DH->score_e;
     double **dhdq = DH->score_h;
@@ -248,12 +293,6 @@ static int garch_etht (const double *par, garch_container *DH)
 	}
     }
 
-    for (t=t0; t<t1; t++) {
-	for (i=0; i<DH->k; i++) {
-	    dedq[i][t] = 0.0;
-	}
-    }
-	
     /* h0 and derivatives */
 
     if (DH->init == INIT_VAR_OLS) {
@@ -276,6 +315,16 @@ static int garch_etht (const double *par, garch_container *DH)
 	DH->h[t] = DH->e2[t] = h0;
     }
 
+    if (!deriv) {
+	return 0;
+    }
+
+    for (t=t0; t<t1; t++) {
+	for (i=0; i<DH->k; i++) {
+	    dedq[i][t] = 0.0;
+	}
+    }
+
     if (DH->init == INIT_VAR_OLS) {
 	for (t=t0; t<t1; t++) {
 	    for (i=0; i<DH->k; i++) {
@@ -421,29 +470,46 @@ static double garch_loglik (const double *theta, void *ptr)
     double ll = NADBL;
     int err;
 
-    err = garch_etht(theta, DH);
+    err = garch_etht(theta, DH, 0);
     if (!err) {
-	ll = normal_ll(DH);
+	ll = normal_ll(theta, DH);
     }
 
     return ll;
 }
 
-static int score_fill_matrices (const double *theta, garch_container *DH)
+/* Fill out the per-observation score matrix G, and also cumulate
+   the score vector into @s if it is non-NULL. The derivatives of
+   the loglikelihood wrt e and h are used on the fly; they are
+   stored in blockglue for reference.
+*/
+
+static int score_fill_matrices (const double *theta, garch_container *DH,
+				double *s)
 {
+    double ut, vt, gti;
     int i, t, err;
 
-    err = garch_etht(theta, DH);
+    err = garch_etht(theta, DH, 1);
     if (err) {
 	return err;
     }
 
-    normal_score(DH);
+    if (s != NULL) {
+	for (i=0; i<DH->k; i++) {
+	    s[i] = 0.0;
+	}
+    }
 
     for (t=DH->t1; t<=DH->t2; t++) {
+	DH->blockglue[0][t] = ut = -DH->e[t] / DH->h[t];
+	DH->blockglue[1][t] = vt = 0.5 * (ut * ut - 1.0 / DH->h[t]);
 	for (i=0; i<DH->k; i++) {
-	    DH->G[i][t] = DH->score_e[i][t] * DH->blockglue[0][t] + 
-		DH->score_h[i][t] * DH->blockglue[1][t];
+	    gti = DH->score_e[i][t] * ut + DH->score_h[i][t] * vt;
+	    DH->G[i][t] = gti;
+	    if (s != NULL) {
+		s[i] += gti;
+	    }
 	}
     }
 
@@ -453,24 +519,7 @@ static int score_fill_matrices (const double *theta, garch_container *DH)
 static int garch_score (double *theta, double *s, int npar, BFGS_CRIT_FUNC ll, 
 			void *ptr)
 {
-    garch_container *DH = (garch_container *) ptr;
-    double tmp;
-    int t, i, err;
-
-    err = score_fill_matrices(theta, DH);
-    if (err) {
-	return err;
-    }
-
-    for (i=0; i<npar; i++) {
-	tmp = 0.0;
-	for (t=DH->t1;t<=DH->t2; t++) {
-	    tmp += DH->G[i][t];
-	}
-	s[i] = tmp;
-    }
-
-    return err;
+    return score_fill_matrices(theta, (garch_container *) ptr, s);
 }
 
 static gretl_matrix *garch_iinfo (garch_container *DH, int *err)
@@ -790,6 +839,11 @@ int garch_estimate_mod (const double *y, const double **X,
     test_score(DH, theta);
 #endif
 
+    if (!err) {
+	/* the covariance matrix needs the derivatives at theta */
+	err = score_fill_matrices(theta, DH, NULL);
+    }
+
     if (!err) {
 	err = garch_covariance_matrix(vopt, theta, DH, V);
     }
@@ -18,6 +18,7 @@
  */
 
 #include "libgretl.h"
+#include "libset.h"
 #include "version.h"
 #include "dbread.h"
 
@@ -283,212 +284,265 @@ static void sql_diagnose_stmt (SQLHSTMT stmt)
 	    state, sqlerr, buf, (int) msglen);
 }
 
-static int odbc_read_rows (ODBC_info *odinfo,
-			   SQLHSTMT stmt,
-			   int totcols,
-			   SQLLEN *colbytes,
-			   long *grabint,
-			   double *grabx,
-			   char **grabstr,
-			   DATE_STRUCT *grabd,
-			   double *xt,
-			   DATE_STRUCT **dv,
-			   int *nrows,
-			   int *obsgot,
-			   char **strvals,
-			   PRN *prn)
+/* Rows are fetched in blocks, using column-wise binding: each
+   result column is bound to an array of @block elements, along
+   with an array of length/indicator values. Numeric data columns
+   are bound directly into the relevant rows of odinfo->X (and
+   re-bound for each block); other columns go into buffers from
+   which they are then processed.
+*/
+
+#define ODBC_STRSZ 16
+#define ODBC_BLOCK_ROWS 1024
+#define ODBC_BLOCK_BYTES (4 << 20)
+#define ODBC_PROGRESS_MIN (1 << 20)
+
+typedef struct odbc_col_ odbc_col;
+
+struct odbc_col_ {
+    int ctype;     /* GRETL_TYPE_{INT,STRING,DATE,DOUBLE} */
+    int width;     /* bytes per element */
+    int direct;    /* bound directly into odinfo->X? */
+    char *buf;     /* bound buffer, if not direct */
+    SQLLEN *ind;   /* lengths/indicators */
+};
+
+static void odbc_cols_free (odbc_col *cols, int n)
 {
-    char obsbit[OBSLEN];
-    SQLRETURN ret;
-    int verbose = (prn != NULL);
-    int i, j, k, p, q, v;
-    int t = 0, err = 0;
+    int i;
 
-    ret = SQLFetch(stmt);
-    if (ret != SQL_SUCCESS) {
-	fprintf(stderr, "%s\n", sql_status(ret));
-        if (ret == SQL_SUCCESS_WITH_INFO) {
-	    sql_diagnose_stmt(stmt);
+    if (cols != NULL) {
+	for (i=0; i<n; i++) {
+	    free(cols[i].buf);
+	    free(cols[i].ind);
 	}
+	free(cols);
     }
+}
 
-    while ((ret == SQL_SUCCESS || ret == SQL_SUCCESS_WITH_INFO) && !err) {
-	j = k = p = q = v = 0;
-	if (verbose) {
-	    pprintf(prn, "Fetch, row %d: ", t);
-	}
-	for (i=0; i<totcols && !err; i++) {
-	    if (verbose) {
-		pprintf(prn, "col %d: ", i);
-	    }
-	    if (i < odinfo->obscols) {
-		/* looking for obs identifier chunk(s) */
-		*obsbit = '\0';
-		if (colbytes[i] == SQL_NULL_DATA) {
-		    if (verbose) {
-			pputs(prn, "null data");
-		    }
-		    continue; /* error? */
-		}
-		if (verbose) {
-		    pprintf(prn, "%d bytes", (int) colbytes[i]);
-		}
-		if (odinfo->coltypes[i] == GRETL_TYPE_INT) {
-		    sprintf(obsbit, odinfo->fmts[i], (int) grabint[j++]);
-		} else if (odinfo->coltypes[i] == GRETL_TYPE_STRING) {
-		    sprintf(obsbit, odinfo->fmts[i], grabstr[k++]);
-		} else if (odinfo->coltypes[i] == GRETL_TYPE_DATE) {
-		    obsbit_from_sql_date(obsbit, &grabd[q++]);
-		} else if (odinfo->coltypes[i] == GRETL_TYPE_DOUBLE) {
-		    sprintf(obsbit, odinfo->fmts[i], grabx[p++]);
-		}
-		if (odinfo->S != NULL && *obsbit != '\0') {
-		    if (strlen(odinfo->S[t]) + strlen(obsbit) > OBSLEN - 1) {
-			fprintf(stderr, "Overflow in observation string!\n");
-		    } else {
-			strcat(odinfo->S[t], obsbit);
-		    }
-		}
-		if (verbose && i == odinfo->obscols - 1 && odinfo->S != NULL) {
-		    /* finished composing obs string, report it */
-		    pprintf(prn, " (obs '%s')", odinfo->S[t]);
-		}
-	    } else {
-		/* now looking for actual data */
-		if (colbytes[i] == SQL_NULL_DATA) {
-		    if (verbose) {
-			pputs(prn, "no data");
-		    }
-		    odinfo->X[v][t] = NADBL;
-		} else if (strvals != NULL && strvals[v] != NULL) {
-		    odinfo->X[v][t] = strval_to_double(odinfo, strvals[v],
-						       t+1, v+1, &err);
-		    if (verbose) {
-			pprintf(prn, "string '%s' -> %g", strvals[v],
-				odinfo->X[v][t]);
-		    }
-		} else if (dv != NULL && dv[v] != NULL) {
-		    odinfo->X[v][t] = date_to_double(odinfo, dv[v],
-						     t+1, v+1, &err);
-		    if (verbose) {
-			pprintf(prn, "date -> %g", odinfo->X[v][t]);
-		    }
-		} else {
-		    odinfo->X[v][t] = xt[v];
-		    if (verbose) {
-			pprintf(prn, "value %g", xt[v]);
-		    }
-		}
-		v++;
-	    }
-	    if (verbose && i < totcols-1) pputs(prn, "; ");
-	} /* end loop across columns */
+/* Work out the number of rows to fetch per block, given the
+   total width of a row in bytes, and allocate the buffers.
+*/
 
-	if (verbose) {
-	    pputc(prn, '\n');
-	}
-	t++;
+static int odbc_cols_allocate (odbc_col *cols, int n, int *block)
+{
+    int i, rowbytes = 0;
+    int b = ODBC_BLOCK_ROWS;
 
-	/* try getting next row */
-	ret = SQLFetch(stmt);
-	if (ret == SQL_SUCCESS && t >= *nrows) {
-	    err = expand_catchment(odinfo, nrows);
+    for (i=0; i<n; i++) {
+	rowbytes += cols[i].width + sizeof(SQLLEN);
+    }
+
+    if (rowbytes * b > ODBC_BLOCK_BYTES) {
+	b = ODBC_BLOCK_BYTES / rowbytes;
+	if (b < 1) {
+	    b = 1;
 	}
-    } /* end loop across rows */
+    }
 
-    if (ret != SQL_SUCCESS && ret != SQL_SUCCESS_WITH_INFO &&
-	ret != SQL_NO_DATA && !err) {
-	err = E_DATA;
+    for (i=0; i<n; i++) {
+	cols[i].ind = calloc(b, sizeof(SQLLEN));
+	if (cols[i].ind == NULL) {
+	    return E_ALLOC;
+	}
+	if (!cols[i].direct) {
+	    cols[i].buf = calloc(b, cols[i].width);
+	    if (cols[i].buf == NULL) {
+		return E_ALLOC;
+	    }
+	}
     }
 
-    *obsgot = t;
+    *block = b;
 
-    return err;
+    return 0;
 }
 
-#define ODBC_STRSZ 16
+static SQLSMALLINT odbc_c_type (int ctype)
+{
+    if (ctype == GRETL_TYPE_INT) {
+	return SQL_C_LONG;
+    } else if (ctype == GRETL_TYPE_STRING) {
+	return SQL_C_CHAR;
+    } else if (ctype == GRETL_TYPE_DATE) {
+	return SQL_C_TYPE_DATE;
+    } else {
+	return SQL_C_DOUBLE;
+    }
+}
+
+/* Compose the observation identifier for row @r of the current
+   block from the obs columns, if any, and write it to S[t].
+*/
 
-static char **allocate_string_grabbers (ODBC_info *odinfo,
-					int *nstrs,
-					int *err)
+static void odbc_compose_obs (ODBC_info *odinfo, odbc_col *cols,
+			      int r, int t, PRN *prn)
 {
-    char **G = NULL;
-    int i, n = 0;
+    char obsbit[OBSLEN];
+    int i;
 
     for (i=0; i<odinfo->obscols; i++) {
-	if (odinfo->coltypes[i] == GRETL_TYPE_STRING ||
-	    odinfo->coltypes[i] == GRETL_TYPE_DATE) {
-	    n++;
-	}
-    }
+	odbc_col *col = &cols[i];
+	char *p = col->buf + r * col->width;
 
-    if (n > 0) {
-	G = strings_array_new_with_length(n, ODBC_STRSZ);
-	if (G == NULL) {
-	    *err = E_ALLOC;
-	} else {
-	    *nstrs = n;
+	*obsbit = '\0';
+	if (col->ind[r] == SQL_NULL_DATA) {
+	    if (prn != NULL) {
+		pprintf(prn, "col %d: null data; ", i);
+	    }
+	    continue; /* error? */
+	}
+	if (col->ctype == GRETL_TYPE_INT) {
+	    SQLINTEGER k;
+
+	    memcpy(&k, p, sizeof k);
+	    sprintf(obsbit, odinfo->fmts[i], (int) k);
+	} else if (col->ctype == GRETL_TYPE_STRING) {
+	    sprintf(obsbit, odinfo->fmts[i], p);
+	} else if (col->ctype == GRETL_TYPE_DATE) {
+	    obsbit_from_sql_date(obsbit, (DATE_STRUCT *) p);
+	} else if (col->ctype == GRETL_TYPE_DOUBLE) {
+	    double x;
+
+	    memcpy(&x, p, sizeof x);
+	    sprintf(obsbit, odinfo->fmts[i], x);
+	}
+	if (odinfo->S != NULL && *obsbit != '\0') {
+	    if (strlen(odinfo->S[t]) + strlen(obsbit) > OBSLEN - 1) {
+		fprintf(stderr, "Overflow in observation string!\n");
+	    } else {
+		strcat(odinfo->S[t], obsbit);
+	    }
 	}
     }
 
-    return G;
+    if (prn != NULL && odinfo->S != NULL) {
+	pprintf(prn, "(obs '%s') ", odinfo->S[t]);
+    }
 }
 
-/* Allocate a char *object of size @len to hold a
-   string value provided by ODBC. If the array to hold
-   such objects has not yet been allocated if must be
-   be created first.
-*/
-
-static char *get_str_bind_target (char ***pS, int len, int nv,
-				  int j, int *err)
+static int odbc_read_rows (ODBC_info *odinfo,
+			   SQLHSTMT stmt,
+			   odbc_col *cols,
+			   int totcols,
+			   int block,
+			   double expected,
+			   int *nrows,
+			   int *obsgot,
+			   PRN *prn)
 {
-    char *ret = NULL;
+    int (*show_progress) (double, double, int) = NULL;
+    SQLULEN nfetched = 0;
+    SQLRETURN ret;
+    double rowbytes = 0;
+    int verbose = (prn != NULL);
+    int i, r, s, v;
+    int t = 0, err = 0;
 
-    if (*pS == NULL) {
-	/* starting from scratch */
-	*pS = strings_array_new(nv);
-	if (*pS == NULL) {
-	    *err = E_ALLOC;
-	}
+    ret = SQLSetStmtAttr(stmt, SQL_ATTR_ROWS_FETCHED_PTR, &nfetched, 0);
+    if (OD_error(ret)) {
+	gretl_errmsg_set("Error in SQLSetStmtAttr");
+	return E_DATA;
     }
 
-    if (*pS != NULL) {
-	(*pS)[j] = calloc(len + 1, 1);
-	if ((*pS)[j] == NULL) {
-	    *err = E_ALLOC;
-	} else {
-	    ret = (*pS)[j];
+    if (expected > ODBC_PROGRESS_MIN && gretl_in_gui_mode()) {
+	show_progress = get_plugin_function("show_progress");
+	if (show_progress != NULL) {
+	    for (i=0; i<totcols; i++) {
+		rowbytes += cols[i].width;
+	    }
+	    show_progress(0, expected, SP_LOAD_INIT);
 	}
     }
 
-    return ret;
-}
+    while (!err) {
+	while (t + block > *nrows && !err) {
+	    err = expand_catchment(odinfo, nrows);
+	}
+	for (i=odinfo->obscols; i<totcols && !err; i++) {
+	    if (cols[i].direct) {
+		/* numeric data: straight into X */
+		v = i - odinfo->obscols;
+		ret = SQLBindCol(stmt, i+1, SQL_C_DOUBLE, odinfo->X[v] + t,
+				 sizeof(double), cols[i].ind);
+		if (OD_error(ret)) {
+		    gretl_errmsg_set("Error in SQLBindCol");
+		    err = E_DATA;
+		}
+	    }
+	}
+	if (err) {
+	    break;
+	}
 
-static DATE_STRUCT *get_date_bind_target (DATE_STRUCT ***pds,
-					  int nv, int j,
-					  int *err)
-{
-    DATE_STRUCT *ret = NULL;
+	ret = SQLFetch(stmt);
+	if (ret == SQL_NO_DATA) {
+	    break;
+	} else if (ret != SQL_SUCCESS) {
+	    fprintf(stderr, "%s\n", sql_status(ret));
+	    if (ret == SQL_SUCCESS_WITH_INFO) {
+		sql_diagnose_stmt(stmt);
+	    } else {
+		err = E_DATA;
+		break;
+	    }
+	}
+
+	for (r=0; r<(int) nfetched && !err; r++, t++) {
+	    if (verbose) {
+		pprintf(prn, "Fetch, row %d: ", t);
+	    }
+	    if (odinfo->obscols > 0) {
+		odbc_compose_obs(odinfo, cols, r, t, prn);
+	    }
+	    for (i=odinfo->obscols; i<totcols && !err; i++) {
+		odbc_col *col = &cols[i];
+
+		v = i - odinfo->obscols;
+		if (col->ind[r] == SQL_NULL_DATA) {
+		    odinfo->X[v][t] = NADBL;
+		} else if (col->ctype == GRETL_TYPE_STRING) {
+		    char *sv = col->buf + r * col->width;
+
+		    odinfo->X[v][t] = strval_to_double(odinfo, sv, t+1,
+						       v+1, &err);
+		} else if (col->ctype == GRETL_TYPE_DATE) {
+		    DATE_STRUCT *dv = (DATE_STRUCT *) col->buf + r;
+
+		    odinfo->X[v][t] = date_to_double(odinfo, dv, t+1,
+						     v+1, &err);
+		}
+		if (verbose) {
+		    pprintf(prn, "col %d: %g; ", i, odinfo->X[v][t]);
+		}
+	    }
+	    if (verbose) {
+		pputc(prn, '\n');
+	    }
+	}
+
+	if (show_progress != NULL && !err) {
+	    s = show_progress(t * rowbytes, expected, SP_TOTAL);
+	    if (s == SP_RETURN_CANCELED) {
+		err = E_CANCEL;
+	    }
+	}
 
-    if (*pds == NULL) {
-	/* starting from scratch */
-	*pds = calloc(nv, sizeof *pds);
-	if (*pds == NULL) {
-	    *err = E_ALLOC;
+	if (nfetched < (SQLULEN) block) {
+	    /* the result set is exhausted */
+	    break;
 	}
     }
 
-    if (*pds != NULL) {
-	(*pds)[j] = calloc(1, sizeof **pds);
-	if ((*pds)[j] == NULL) {
-	    *err = E_ALLOC;
-	} else {
-	    ret = (*pds)[j];
-	}
+    if (show_progress != NULL) {
+	show_progress(0, expected, SP_FINISH);
     }
 
-    return ret;
+    SQLSetStmtAttr(stmt, SQL_ATTR_ROWS_FETCHED_PTR, NULL, 0);
+
+    *obsgot = t;
+
+    return err;
 }
 
 static gchar *sql_datatype_name (SQLSMALLINT dt, int *free_it)
@@ -594,19 +648,14 @@ int gretl_odbc_get_data (ODBC_info *odinfo, gretlopt opt, PRN *inprn)
     unsigned char msg[512];
     SQLINTEGER OD_err;
     SQLSMALLINT mlen, ncols, dt;
-    double *xt = NULL;
-    SQLLEN *colbytes = NULL;
     SQLLEN sqlnrows;
-    long grabint[ODBC_OBSCOLS];
-    double grabx[ODBC_OBSCOLS];
-    DATE_STRUCT grabd[ODBC_OBSCOLS];
-    DATE_STRUCT **dv = NULL;
-    char **grabstr = NULL;
-    char **strvals = NULL;
+    SQLULEN asize;
+    odbc_col *cols = NULL;
     int *svlist = NULL;
     int totcols, nrows = 0;
-    int nstrs = 0;
-    int i, j, k, p, q;
+    int block = 1;
+    double expected = 0;
+    int i, j;
     int T = 0, err = 0;
     PRN *prn;
 
@@ -621,29 +670,29 @@ int gretl_odbc_get_data (ODBC_info *odinfo, gretlopt opt, PRN *inprn)
        actual data columns */
     totcols = odinfo->obscols + odinfo->nvars;
 
-    xt = malloc(odinfo->nvars * sizeof *xt);
-    if (xt == NULL) {
-	return E_ALLOC;
-    }
-
-    colbytes = malloc(totcols * sizeof *colbytes);
-    if (colbytes == NULL) {
-	free(xt);
+    cols = calloc(totcols, sizeof *cols);
+    if (cols == NULL) {
 	return E_ALLOC;
     }
 
-    grabstr = allocate_string_grabbers(odinfo, &nstrs, &err);
-    if (err) {
-	free(xt);
-	free(colbytes);
-	return err;
+    /* auxiliary (obs) columns */
+    for (i=0; i<odinfo->obscols; i++) {
+	cols[i].ctype = odinfo->coltypes[i];
+	if (cols[i].ctype == GRETL_TYPE_INT) {
+	    cols[i].width = sizeof(SQLINTEGER);
+	} else if (cols[i].ctype == GRETL_TYPE_STRING) {
+	    cols[i].width = ODBC_STRSZ;
+	} else if (cols[i].ctype == GRETL_TYPE_DATE) {
+	    cols[i].width = sizeof(DATE_STRUCT);
+	} else {
+	    cols[i].ctype = GRETL_TYPE_DOUBLE;
+	    cols[i].width = sizeof(double);
+	}
     }
 
     dbc = gretl_odbc_connect_to_dsn(odinfo, &OD_env, prn, &err);
     if (err) {
-	free(xt);
-	free(colbytes);
-	strings_array_free(grabstr, nstrs);
+	free(cols);
 	return err;
     }
 
@@ -657,26 +706,6 @@ int gretl_odbc_get_data (ODBC_info *odinfo, gretlopt opt, PRN *inprn)
 	goto bailout;
     }
 
-    j = k = p = q = 0;
-
-    /* bind auxiliary (obs) columns */
-    for (i=0; i<odinfo->obscols; i++) {
-	colbytes[i] = 0;
-	if (odinfo->coltypes[i] == GRETL_TYPE_INT) {
-	    SQLBindCol(stmt, i+1, SQL_C_LONG, &grabint[j++], 0,
-		       &colbytes[i]);
-	} else if (odinfo->coltypes[i] == GRETL_TYPE_STRING) {
-	    SQLBindCol(stmt, i+1, SQL_C_CHAR, grabstr[k++], ODBC_STRSZ,
-		       &colbytes[i]);
-	} else if (odinfo->coltypes[i] == GRETL_TYPE_DATE) {
-	    SQLBindCol(stmt, i+1, SQL_C_TYPE_DATE, &grabd[q++], 10,
-		       &colbytes[i]);
-	} else if (odinfo->coltypes[i] == GRETL_TYPE_DOUBLE) {
-	    SQLBindCol(stmt, i+1, SQL_C_DOUBLE, &grabx[p++], sizeof(double),
-		       &colbytes[i]);
-	}
-    }
-
     ret = SQLExecDirect(stmt, (SQLCHAR *) odinfo->query, SQL_NTS);
     if (OD_error(ret)) {
 	gretl_errmsg_set("Error in SQLExecDirect");
@@ -709,54 +738,74 @@ int gretl_odbc_get_data (ODBC_info *odinfo, gretlopt opt, PRN *inprn)
 	goto bailout;
     }
 
-    /* Are we going to need a string table? */
-    j = 1;
+    /* show and process column info; and are we going to
+       need a string table? */
     for (i=odinfo->obscols; i<ncols && !err; i++) {
-	dt = get_col_info(stmt, i+1, NULL, prn, &err);
-	if (!err && IS_SQL_STRING_TYPE(dt)) {
-	    pprintf(prn, "string table: adding ID %d\n", j);
-	    svlist = gretl_list_append_term(&svlist, j);
+	int len = 0;
+
+	dt = get_col_info(stmt, i+1, &len, prn, &err);
+	if (err) {
+	    break;
+	}
+	j = i - odinfo->obscols;
+	if (IS_SQL_STRING_TYPE(dt)) {
+	    pprintf(prn, "string table: adding ID %d\n", j+1);
+	    svlist = gretl_list_append_term(&svlist, j+1);
+	    cols[i].ctype = GRETL_TYPE_STRING;
+	    cols[i].width = len + 1;
+	} else if (IS_SQL_DATE(dt)) {
+	    cols[i].ctype = GRETL_TYPE_DATE;
+	    cols[i].width = sizeof(DATE_STRUCT);
+	} else {
+	    /* should be numerical data */
+	    cols[i].ctype = GRETL_TYPE_DOUBLE;
+	    cols[i].width = sizeof(double);
+	    cols[i].direct = 1;
 	}
-	j++;
     }
+
     if (!err && svlist != NULL) {
 	odinfo->gst = gretl_string_table_new(svlist);
 	if (odinfo->gst == NULL) {
 	    err = E_ALLOC;
-	    goto bailout;
 	}
     }
 
-    /* show and process column info */
-    for (i=0; i<ncols && !err; i++) {
-	int len = 0;
+    if (!err) {
+	err = odbc_cols_allocate(cols, totcols, &block);
+    }
 
-	dt = get_col_info(stmt, i+1, &len, prn, &err);
-	if (!err && i >= odinfo->obscols) {
-	    /* bind data columns */
-	    colbytes[i] = 0;
-	    j = i - odinfo->obscols;
-	    if (IS_SQL_STRING_TYPE(dt)) {
-		char *sval = get_str_bind_target(&strvals, len+1, odinfo->nvars, j, &err);
-
-		if (!err) {
-		    pprintf(prn, "  binding col %d to strvals[%d] (len = %d)\n",
-			    i+1, j, len);
-		    SQLBindCol(stmt, i+1, SQL_C_CHAR, sval, len+1, &colbytes[i]);
-		}
-	    } else if (IS_SQL_DATE(dt)) {
-		DATE_STRUCT *ds = get_date_bind_target(&dv, odinfo->nvars, j, &err);
+    if (err) {
+	goto bailout;
+    }
 
-		if (!err) {
-		    pprintf(prn, "  binding col %d to dv[%d]\n", i+1, j);
-		    SQLBindCol(stmt, i+1, SQL_C_TYPE_DATE, ds, sizeof *ds,
-			       &colbytes[i]);
-		}
-	    } else {
-		/* should be numerical data */
-		pprintf(prn, "  binding col %d to xt[%d]\n", i+1, j);
-		SQLBindCol(stmt, i+1, SQL_C_DOUBLE, &xt[j], sizeof(double),
-			   &colbytes[i]);
+    /* request block fetching, then check how many rows per
+       block the driver is actually willing to supply */
+    ret = SQLSetStmtAttr(stmt, SQL_ATTR_ROW_BIND_TYPE,
+			 (SQLPOINTER) SQL_BIND_BY_COLUMN, 0);
+    if (!OD_error(ret)) {
+	ret = SQLSetStmtAttr(stmt, SQL_ATTR_ROW_ARRAY_SIZE,
+			     (SQLPOINTER) (SQLULEN) block, 0);
+    }
+    if (OD_error(ret)) {
+	block = 1;
+    } else if (ret == SQL_SUCCESS_WITH_INFO) {
+	asize = 0;
+	SQLGetStmtAttr(stmt, SQL_ATTR_ROW_ARRAY_SIZE, &asize, 0, NULL);
+	if (asize > 0 && asize < (SQLULEN) block) {
+	    block = (int) asize;
+	}
+    }
+    pprintf(prn, "Fetching up to %d rows per block\n", block);
+
+    /* bind the columns that are not bound directly into X */
+    for (i=0; i<ncols && !err; i++) {
+	if (!cols[i].direct) {
+	    ret = SQLBindCol(stmt, i+1, odbc_c_type(cols[i].ctype),
+			     cols[i].buf, cols[i].width, cols[i].ind);
+	    if (OD_error(ret)) {
+		gretl_errmsg_set("Error in SQLBindCol");
+		err = E_DATA;
 	    }
 	}
     }
@@ -781,14 +830,18 @@ int gretl_odbc_get_data (ODBC_info *odinfo, gretlopt opt, PRN *inprn)
     nrows = sqlnrows;
     pprintf(prn, "Number of rows (from SQLRowCount): %d\n", nrows);
 
-    if (!err) {
-	if (nrows <= 0) {
-	    nrows = ODBC_INIT_ROWS;
-	}
-	odinfo->X = doubles_array_new(odinfo->nvars, nrows);
-	if (odinfo->X == NULL) {
-	    err = E_ALLOC;
+    if (nrows > 0) {
+	/* rough size of the transfer, for a progress bar */
+	for (i=0; i<totcols; i++) {
+	    expected += (double) nrows * cols[i].width;
 	}
+    } else {
+	nrows = ODBC_INIT_ROWS;
+    }
+
+    odinfo->X = doubles_array_new(odinfo->nvars, nrows);
+    if (odinfo->X == NULL) {
+	err = E_ALLOC;
     }
 
     if (!err && odinfo->fmts != NULL) {
@@ -800,9 +853,8 @@ int gretl_odbc_get_data (ODBC_info *odinfo, gretlopt opt, PRN *inprn)
 
     if (!err) {
 	/* get the actual data */
-	err = odbc_read_rows(odinfo, stmt, totcols, colbytes,
-			     grabint, grabx, grabstr, grabd,
-			     xt, dv, &nrows, &T, strvals, prn);
+	err = odbc_read_rows(odinfo, stmt, cols, totcols, block,
+			     expected, &nrows, &T, prn);
     }
 
  bailout:
@@ -824,19 +876,8 @@ int gretl_odbc_get_data (ODBC_info *odinfo, gretlopt opt, PRN *inprn)
 	odinfo->nrows = T;
     }
 
-    free(xt);
-    free(colbytes);
+    odbc_cols_free(cols, totcols);
     free(svlist);
-    strings_array_free(grabstr, nstrs);
-    if (strvals != NULL) {
-	strings_array_free(strvals, odinfo->nvars);
-    }
-    if (dv != NULL) {
-	for (i=0; i<odinfo->nvars; i++) {
-	    free(dv[i]);
-	}
-	free(dv);
-    }
 
     if (stmt != NULL) {
 	ret = SQLFreeHandle(SQL_HANDLE_STMT, stmt);
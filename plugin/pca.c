@@ -20,6 +20,11 @@
 #include "libgretl.h"
 #include "version.h"
 #include "gretl_matrix.h"
+#include "gretl_mt.h"
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
 
 #include <gtk/gtk.h>
 
@@ -185,6 +190,12 @@ static gretlopt pca_flag_dialog (VMatrix *cmat, int *nsave)
     }
 }
 
+/* The sum of all the eigenvalues, that is, the trace of the
+   correlation or covariance matrix. When only the leading
+   components have been computed the trace is obtained from the
+   sums of squared deviations.
+*/
+
 static double eigen_sum (VMatrix *cmat,
                          const gretl_matrix *E,
                          int n)
@@ -194,6 +205,10 @@ static double eigen_sum (VMatrix *cmat,
 
     if (cmat->ci == CORR) {
 	esum = cmat->dim;
+    } else if (n < cmat->dim) {
+	for (i=0; i<cmat->dim; i++) {
+	    esum += cmat->ssx[i] / (cmat->nmax - 1);
+	}
     } else {
 	for (i=0; i<n; i++) {
 	    esum += E->val[i];
@@ -214,7 +229,7 @@ static int pca_save_bundle (VMatrix *cmat,
     char **cnames = NULL;
     char **rnames = NULL;
     char pcname[16];
-    int n = cmat->dim;
+    int n = gretl_vector_get_length(E);
     int i;
 
     b = gretl_bundle_new();
@@ -251,10 +266,12 @@ static int pca_save_bundle (VMatrix *cmat,
 
     /* loadings */
     cnames = strings_array_new(n);
-    rnames = strings_array_new(n);
+    rnames = strings_array_new(cmat->dim);
     for (i=0; i<n; i++) {
         sprintf(pcname, "PC%d", i + 1);
         cnames[i] = gretl_strdup(pcname);
+    }
+    for (i=0; i<cmat->dim; i++) {
         rnames[i] = gretl_strdup(cmat->names[i]);
     }
     gretl_matrix_set_colnames(C, cnames);
@@ -275,7 +292,7 @@ static void pca_print (VMatrix *cmat, gretl_matrix *E,
     double cum, esum;
     char pcname[16];
     int nl, namelen = 8;
-    int n = cmat->dim;
+    int n = gretl_vector_get_length(E);
     int done, todo;
     int i, j;
 
@@ -301,12 +318,15 @@ static void pca_print (VMatrix *cmat, gretl_matrix *E,
 	cum += E->val[i] / esum;
 	pprintf(prn, "%5d%13.4f%13.4f%13.4f\n", i + 1,
 		E->val[i], E->val[i] / esum, cum);
+    }
+    pputc(prn, '\n');
+
+    for (i=0; i<cmat->dim; i++) {
 	nl = strlen(cmat->names[i]);
 	if (nl > namelen) {
 	    namelen = nl;
 	}
     }
-    pputc(prn, '\n');
 
     pprintf(prn, "%s\n\n", _("Eigenvectors (component loadings)"));
 
@@ -324,7 +344,7 @@ static void pca_print (VMatrix *cmat, gretl_matrix *E,
 	}
 	pputc(prn, '\n');
 
-	for (i=0; i<n; i++) {
+	for (i=0; i<cmat->dim; i++) {
 	    pprintf(prn, "%-*s", namelen + 1, cmat->names[i]);
 	    for (j=0; j<ncols; j++) {
 		pprintf(prn, "%9.3f", gretl_matrix_get(C, i, done + j));
@@ -375,22 +395,18 @@ static int standardize (double *sy, const double *y,
 
 static int auto_nsave (VMatrix *cmat, const gretl_matrix *E)
 {
+    int n = gretl_vector_get_length(E);
     int ret = 0;
     int i = 0;
 
     if (cmat->ci == CORR) {
-        for (i=0; E->val[i] > 1.0; i++) {
+        for (i=0; i<n && E->val[i] > 1.0; i++) {
             ret++;
         }
     } else {
-        int n = gretl_vector_get_length(E);
-        double ebar = 0;
+        double ebar = eigen_sum(cmat, E, n) / cmat->dim;
 
-        for (i=0; i<n; i++) {
-            ebar += E->val[i];
-        }
-        ebar /= n;
-        for (i=0; E->val[i] > ebar; i++) {
+        for (i=0; i<n && E->val[i] > ebar; i++) {
             ret++;
         }
     }
@@ -415,13 +431,14 @@ static int pca_save_components (VMatrix *cmat,
     char *mask = NULL;
     int n, m = 0, v = dset->v;
     int k = cmat->dim;
+    int nc = gretl_vector_get_length(E);
     int i, j, s, t, vi;
     int err = 0;
 
     if (save_all) {
-	m = k;
+	m = nc;
     } else if (nsave > 0) {
-	m = nsave > k ? k : nsave;
+	m = nsave > nc ? nc : nsave;
     } else {
         m = auto_nsave(cmat, E);
     }
@@ -505,12 +522,309 @@ static int pca_save_components (VMatrix *cmat,
     return err;
 }
 
+/* Principal components via the SVD of the data, for when only the
+   leading components are wanted: there's then no need to form the
+   k x k correlation or covariance matrix, which may be huge. We use
+   the randomized SVD of Halko, Martinsson and Tropp (SIAM Review,
+   2011), with a few power iterations; or, given the --incremental
+   option, a single pass through the data in blocks of rows, updating
+   a truncated SVD as we go (Ross, Lim, Lin and Yang, IJCV 2008), so
+   that the standardized data are never held in memory all at once.
+*/
+
+#define PCA_OVERSAMPLE 10
+#define PCA_POWER_ITERS 2
+#define PCA_BLOCK 512
+
+/* Record the observations to be used (those without missing
+   values), and the scale factors for the centred data.
+*/
+
+static int *pca_data_rows (VMatrix *cmat, const DATASET *dset,
+			   double **pscale, int *err)
+{
+    int k = cmat->dim;
+    int n = cmat->nmax;
+    double *scale;
+    int *rows;
+    int i, s, t;
+
+    rows = malloc(n * sizeof *rows);
+    scale = malloc(k * sizeof *scale);
+    if (rows == NULL || scale == NULL) {
+	free(rows);
+	free(scale);
+	*err = E_ALLOC;
+	return NULL;
+    }
+
+    s = 0;
+    for (t=cmat->t1; t<=cmat->t2 && s<n; t++) {
+	int ok = 1;
+
+	for (i=0; i<k && ok; i++) {
+	    ok = !na(dset->Z[cmat->list[i+1]][t]);
+	}
+	if (ok) {
+	    rows[s++] = t;
+	}
+    }
+
+    for (i=0; i<k; i++) {
+	if (cmat->ci == CORR) {
+	    scale[i] = 1.0 / sqrt(cmat->ssx[i] / (n - 1));
+	} else {
+	    scale[i] = 1.0;
+	}
+    }
+
+    *pscale = scale;
+
+    return rows;
+}
+
+/* Write the standardized (or centred) data for observations
+   @rows[@r0] to @rows[@r0 + @nr - 1] into @M, starting at column
+   @c0. If @trans is non-zero the variables go in the rows of @M,
+   otherwise in the columns.
+*/
+
+static void pca_fill_data (VMatrix *cmat, const DATASET *dset,
+			   const int *rows, const double *scale,
+			   int r0, int nr, gretl_matrix *M,
+			   int c0, int trans)
+{
+    int k = cmat->dim;
+    int i;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) nr * k))
+#endif
+    for (i=0; i<k; i++) {
+	const double *x = dset->Z[cmat->list[i+1]];
+	double xbar = cmat->xbar[i];
+	double si = scale[i];
+	int s;
+
+	for (s=0; s<nr; s++) {
+	    double z = (x[rows[r0 + s]] - xbar) * si;
+
+	    if (trans) {
+		gretl_matrix_set(M, i, c0 + s, z);
+	    } else {
+		gretl_matrix_set(M, s, c0 + i, z);
+	    }
+	}
+    }
+}
+
+/* Randomized SVD of the n x k data matrix A: find an orthonormal
+   basis Q for the range of A * Omega, where Omega is k x l with
+   standard normal entries, refine it by power iteration, and then
+   get the right singular vectors of A from the thin SVD of A'Q.
+*/
+
+static int pca_randomized (VMatrix *cmat, const DATASET *dset,
+			   int l, gretl_matrix **pV,
+			   gretl_matrix **ps)
+{
+    gretl_matrix *A = NULL;
+    gretl_matrix *Y = NULL;
+    gretl_matrix *Zt = NULL;
+    double *scale = NULL;
+    int *rows = NULL;
+    int n = cmat->nmax;
+    int k = cmat->dim;
+    int i, err = 0;
+
+    rows = pca_data_rows(cmat, dset, &scale, &err);
+    if (err) {
+	return err;
+    }
+
+    A = gretl_matrix_alloc(n, k);
+    Y = gretl_matrix_alloc(n, l);
+    Zt = gretl_random_matrix_new(k, l, D_NORMAL);
+    if (A == NULL || Y == NULL || Zt == NULL) {
+	err = E_ALLOC;
+	goto bailout;
+    }
+
+    pca_fill_data(cmat, dset, rows, scale, 0, n, A, 0, 0);
+
+    /* Y = A * Omega, orthonormalized */
+    err = gretl_matrix_multiply(A, Zt, Y);
+    if (!err) {
+	err = gretl_matrix_QR_decomp(Y, NULL);
+    }
+
+    for (i=0; i<PCA_POWER_ITERS && !err; i++) {
+	err = gretl_matrix_multiply_mod(A, GRETL_MOD_TRANSPOSE,
+					Y, GRETL_MOD_NONE,
+					Zt, GRETL_MOD_NONE);
+	if (!err) {
+	    err = gretl_matrix_QR_decomp(Zt, NULL);
+	}
+	if (!err) {
+	    err = gretl_matrix_multiply(A, Zt, Y);
+	}
+	if (!err) {
+	    err = gretl_matrix_QR_decomp(Y, NULL);
+	}
+    }
+
+    if (!err) {
+	/* B' = A'Q, whose left singular vectors are what we want */
+	err = gretl_matrix_multiply_mod(A, GRETL_MOD_TRANSPOSE,
+					Y, GRETL_MOD_NONE,
+					Zt, GRETL_MOD_NONE);
+    }
+    if (!err) {
+	err = gretl_matrix_SVD(Zt, pV, ps, NULL, 0);
+    }
+
+ bailout:
+
+    gretl_matrix_free(A);
+    gretl_matrix_free(Y);
+    gretl_matrix_free(Zt);
+    free(rows);
+    free(scale);
+
+    return err;
+}
+
+/* Incremental SVD: the current estimate of the leading right
+   singular vectors, V, scaled by the singular values, is joined
+   by the next block of data (transposed) and the SVD of the result
+   is truncated to rank @l.
+*/
+
+static int pca_incremental (VMatrix *cmat, const DATASET *dset,
+			    int l, gretl_matrix **pV,
+			    gretl_matrix **ps)
+{
+    gretl_matrix *M = NULL;
+    gretl_matrix *V = NULL;
+    gretl_matrix *sv = NULL;
+    double *scale = NULL;
+    int *rows = NULL;
+    int n = cmat->nmax;
+    int k = cmat->dim;
+    int r = 0, r0 = 0;
+    int i, j, err = 0;
+
+    rows = pca_data_rows(cmat, dset, &scale, &err);
+    if (err) {
+	return err;
+    }
+
+    M = gretl_matrix_alloc(k, l + PCA_BLOCK);
+    if (M == NULL) {
+	err = E_ALLOC;
+    }
+
+    while (r0 < n && !err) {
+	int nr = (n - r0 > PCA_BLOCK)? PCA_BLOCK : n - r0;
+
+	M->cols = r + nr;
+	for (j=0; j<r; j++) {
+	    for (i=0; i<k; i++) {
+		gretl_matrix_set(M, i, j, gretl_matrix_get(V, i, j) *
+				 sv->val[j]);
+	    }
+	}
+	pca_fill_data(cmat, dset, rows, scale, r0, nr, M, r, 1);
+	r0 += nr;
+
+	gretl_matrix_free(V);
+	gretl_matrix_free(sv);
+	V = sv = NULL;
+	err = gretl_matrix_SVD(M, &V, &sv, NULL, 0);
+
+	if (!err && V->cols > l) {
+	    /* truncate */
+	    V->cols = l;
+	    gretl_matrix_reuse(sv, l, 1);
+	}
+	if (!err) {
+	    r = V->cols;
+	}
+    }
+
+    gretl_matrix_free(M);
+    free(rows);
+    free(scale);
+
+    if (err) {
+	gretl_matrix_free(V);
+	gretl_matrix_free(sv);
+    } else {
+	*pV = V;
+	*ps = sv;
+    }
+
+    return err;
+}
+
+/* Compute the first @nc components, writing the loadings into @pC
+   and the eigenvalues of the correlation or covariance matrix into
+   @pE.
+*/
+
+static int pca_from_data (VMatrix *cmat, const DATASET *dset,
+			  int nc, gretlopt opt,
+			  gretl_matrix **pC,
+			  gretl_matrix **pE)
+{
+    gretl_matrix *V = NULL;
+    gretl_matrix *sv = NULL;
+    int n = cmat->nmax;
+    int k = cmat->dim;
+    int l, i, err = 0;
+
+    if (nc < 1 || nc > k || nc > n) {
+	gretl_errmsg_sprintf(_("Invalid number of components, %d"), nc);
+	return E_INVARG;
+    }
+
+    l = nc + PCA_OVERSAMPLE;
+    if (l > k) l = k;
+    if (l > n) l = n;
+
+    if (opt & OPT_I) {
+	err = pca_incremental(cmat, dset, l, &V, &sv);
+    } else {
+	err = pca_randomized(cmat, dset, l, &V, &sv);
+    }
+
+    if (!err) {
+	V->cols = nc;
+	gretl_matrix_reuse(sv, nc, 1);
+	for (i=0; i<nc; i++) {
+	    sv->val[i] = sv->val[i] * sv->val[i] / (n - 1);
+	}
+	*pC = V;
+	*pE = sv;
+    } else {
+	gretl_matrix_free(V);
+	gretl_matrix_free(sv);
+    }
+
+    return err;
+}
+
 /* The incoming options here:
 
    CLI: the option may be OPT_O (save the first @nsave components) or
    OPT_A (save all the components); OPT_Q suppresses printing of the
    results.
 
+   In addition OPT_K gives the number of components to compute from
+   the SVD of the data (in which case the correlation or covariance
+   matrix will not have been computed) and OPT_I requests the
+   incremental variant of this.
+
    GUI: no option (simply display the results) or OPT_D. The latter
    means that we should not display the results, but should put up a
    dialog box allowing the user to decide what to save.
@@ -525,9 +839,9 @@ static int pca_save_components (VMatrix *cmat,
 int pca_from_cmatrix (VMatrix *cmat, DATASET *dset,
 		      gretlopt opt, PRN *prn)
 {
-    gretl_matrix *C;
+    gretl_matrix *C = NULL;
     gretl_matrix *evals = NULL;
-    gretlopt saveopt = opt;
+    gretlopt saveopt = opt & (OPT_O | OPT_A);
     int k = cmat->dim;
     int nsave = 0;
     int i, j, idx;
@@ -548,6 +862,18 @@ int pca_from_cmatrix (VMatrix *cmat, DATASET *dset,
 	}
     }
 
+    if (opt & OPT_K) {
+	int nc = get_optval_int(PCA, OPT_K, &err);
+
+	if (!err) {
+	    err = pca_from_data(cmat, dset, nc, opt, &C, &evals);
+	}
+	if (err) {
+	    return err;
+	}
+	goto finish;
+    }
+
     C = gretl_matrix_alloc(k, k);
 
     if (C == NULL) {
@@ -573,6 +899,8 @@ int pca_from_cmatrix (VMatrix *cmat, DATASET *dset,
     gretl_matrix_print(evals, "eigenvalues");
 #endif
 
+ finish:
+
     if (!err && saveopt) {
         err = pca_save_components(cmat, evals, C, dset, nsave,
 				  saveopt);
@@ -24,25 +24,29 @@
 #include "matrix_extra.h"
 #include "libset.h"
 #include "gretl_bfgs.h"
+#include "gretl_mt.h"
 #include "../../cephes/libprob.h"
 
-#include <errno.h>
+#ifdef _OPENMP
+# include <omp.h>
+#endif
 
 #define PDEBUG 0
 
 /* initialize NegBin via Poisson estimates? */
 #define POISSON_INIT 1
 
-typedef struct count_info_ count_info;
+/* The loglikelihood and its derivatives are accumulated over fixed
+   chunks of observations, and the partial sums added in order, so
+   the results don't depend on the number of threads.
+*/
+#define COUNT_CHUNK 4096
 
-enum {
-    SCORE_UPDATE_MU = 1
-};
+typedef struct count_info_ count_info;
 
 struct count_info_ {
     int ci;                /* POISSON or NEGBIN */
     int nbtype;            /* NEGBIN only: 1 or 2 */
-    int flags;             /* NEGBIN only: control info */
     int k;                 /* number of covariates (including constant) */
     int n;                 /* number of observations */
     double ll;             /* loglikelihood */
@@ -58,6 +62,12 @@ struct count_info_ {
     gretl_matrix *HX;      /* workspace */
     gretl_matrix *V;       /* covariance matrix */
     gretl_matrix *G;       /* score matrix */
+    gretl_matrix *d1;      /* dl/d(X\beta), by observation */
+    gretl_matrix *w;       /* NEGBIN: -d2l/d(X\beta)^2 */
+    gretl_matrix *da;      /* NEGBIN: dl/d\alpha */
+    gretl_matrix *dab;     /* NEGBIN: d2l/d(X\beta)d\alpha */
+    double daa;            /* NEGBIN: d2l/d\alpha^2, summed */
+    double *psum;          /* partial sums by chunk */
     double *theta;         /* for NEGBIN */
     PRN *prn;              /* verbose printer */
 };
@@ -68,9 +78,15 @@ static int poisson_hessian (double *theta, gretl_matrix *H,
 static void negbin_free (count_info *cinfo)
 {
     free(cinfo->theta);
+    free(cinfo->psum);
     gretl_matrix_free(cinfo->offset);
 }
 
+static int count_chunks (int n)
+{
+    return (n + COUNT_CHUNK - 1) / COUNT_CHUNK;
+}
+
 static int cinfo_allocate (count_info *cinfo,
 			   gretl_matrix_block **pB)
 {
@@ -86,6 +102,7 @@ static int cinfo_allocate (count_info *cinfo,
 				   &cinfo->mu, n, 1,
 				   &cinfo->HX, n, k,
 				   &cinfo->V, k, k,
+				   &cinfo->d1, n, 1,
 				   NULL);
     } else {
 	int np = k + 1;
@@ -94,15 +111,79 @@ static int cinfo_allocate (count_info *cinfo,
 				   &cinfo->X, n, k,
 				   &cinfo->b, k, 1,
 				   &cinfo->mu, n, 1,
+				   &cinfo->HX, n, k,
+				   &cinfo->V, k, k,
 				   &cinfo->G, n, np,
+				   &cinfo->d1, n, 1,
+				   &cinfo->w, n, 1,
+				   &cinfo->da, n, 1,
+				   &cinfo->dab, n, 1,
 				   NULL);
     }
 
     if (B == NULL) {
 	return E_ALLOC;
-    } else {
-	*pB = B;
-	return 0;
+    }
+
+    cinfo->psum = malloc(2 * count_chunks(n) * sizeof *cinfo->psum);
+    if (cinfo->psum == NULL) {
+	gretl_matrix_block_destroy(B);
+	return E_ALLOC;
+    }
+
+    *pB = B;
+
+    return 0;
+}
+
+/* Form X'WX in @H, with W = diag(@w), using @HX as workspace:
+   this is the Hessian kernel shared by all the count models.
+*/
+
+static void count_XWX (const gretl_matrix *X, const double *w,
+		       gretl_matrix *HX, gretl_matrix *H)
+{
+    int n = X->rows;
+    int i;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * X->cols))
+#endif
+    for (i=0; i<X->cols; i++) {
+	const double *xi = X->val + (size_t) i * n;
+	double *hi = HX->val + (size_t) i * n;
+	int t;
+
+	for (t=0; t<n; t++) {
+	    hi[t] = w[t] * xi[t];
+	}
+    }
+
+    gretl_matrix_multiply_mod(X, GRETL_MOD_TRANSPOSE,
+			      HX, GRETL_MOD_NONE,
+			      H, GRETL_MOD_NONE);
+}
+
+/* Form X'v in @g, one column of X per thread */
+
+static void count_Xtv (const gretl_matrix *X, const double *v,
+		       double *g)
+{
+    int n = X->rows;
+    int i;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * X->cols))
+#endif
+    for (i=0; i<X->cols; i++) {
+	const double *xi = X->val + (size_t) i * n;
+	double gi = 0.0;
+	int t;
+
+	for (t=0; t<n; t++) {
+	    gi += xi[t] * v[t];
+	}
+	g[i] = gi;
     }
 }
 
@@ -204,7 +285,6 @@ static int negbin_init (count_info *cinfo,
 
     cinfo->ci = NEGBIN;
     cinfo->nbtype = (opt & OPT_M)? 1 : 2;
-    cinfo->flags = 0;
     cinfo->k = k;
     cinfo->n = pmod->nobs;
 
@@ -247,71 +327,165 @@ static int negbin_init (count_info *cinfo,
     return 0;
 }
 
-static int negbin_update_mu (count_info *cinfo, const double *theta)
+/* \sum_{j=0}^{y-1} (j/(1+\alpha j))^2, from the second derivative
+   of the NegBin2 loglikelihood with respect to alpha: for large
+   counts we use the closed form in terms of the digamma and
+   trigamma functions in place of the O(y) loop.
+*/
+
+static double nb2_jsum (double y, double a)
 {
-    double *mu = cinfo->mu->val;
-    int i, t, err = 0;
+    double s = 0.0;
 
-    for (i=0; i<cinfo->k; i++) {
-	cinfo->b->val[i] = theta[i];
+    if (y > 100 && a * y > 1) {
+	double c = 1/a;
+
+	s = y - 2 * c * (digamma(y + c) - digamma(c)) +
+	    c * c * (trigamma(c) - trigamma(y + c));
+	s *= c * c;
+    } else {
+	double r;
+	int j;
+
+	for (j=1; j<y; j++) {
+	    r = j / (1 + a*j);
+	    s += r * r;
+	}
     }
 
-    gretl_matrix_multiply(cinfo->X, cinfo->b, cinfo->mu);
+    return s;
+}
 
-    for (t=0; t<cinfo->n && !err; t++) {
-	mu[t] = exp(mu[t]);
-	if (mu[t] == 0) {
-	    err = E_NAN;
-	} else if (cinfo->offset != NULL) {
-	    mu[t] *= cinfo->offset->val[t];
+/* For observations @t1 to @t2, convert the index in mu to the
+   conditional mean and compute the loglikelihood contributions
+   along with their first and second derivatives with respect to
+   the index and alpha, in a single pass. The loglikelihood is
+   returned and the sum of the second derivatives with respect to
+   alpha written to @saa.
+*/
+
+static double negbin_chunk (count_info *cinfo, double alpha,
+			    int t1, int t2, double *saa)
+{
+    const double *y = cinfo->y->val;
+    const double *off = NULL;
+    double *mu = cinfo->mu->val;
+    double *d1 = cinfo->d1->val;
+    double *w = cinfo->w->val;
+    double *da = cinfo->da->val;
+    double *dab = cinfo->dab->val;
+    double a2 = alpha * alpha;
+    double ll = 0.0, aa = 0.0;
+    int t;
+
+    if (cinfo->offset != NULL) {
+	off = cinfo->offset->val;
+    }
+
+    if (cinfo->nbtype == 1) {
+	/* psi = mu/alpha varies by observation */
+	double a1 = 1 + alpha;
+	double la1 = log1p(alpha);
+	double lrat = log(alpha) - la1;
+	double psi, pD, p2T;
+
+	for (t=t1; t<t2; t++) {
+	    mu[t] = exp(mu[t]);
+	    if (off != NULL) {
+		mu[t] *= off[t];
+	    }
+	    if (mu[t] == 0) {
+		return NADBL;
+	    }
+	    psi = mu[t] / alpha;
+	    ll += lngamma(y[t] + psi) - lngamma(psi) - lngamma(y[t] + 1.0);
+	    ll += y[t] * lrat - psi * la1;
+	    pD = psi * (digamma(y[t] + psi) - digamma(psi) - la1);
+	    p2T = psi * psi * (trigamma(y[t] + psi) - trigamma(psi));
+	    d1[t] = pD;
+	    w[t] = -(pD + p2T);
+	    da[t] = (y[t]/a1 - psi*alpha/a1 - pD) / alpha;
+	    dab[t] = -(pD + p2T)/alpha - psi/a1;
+	    aa += (2*pD + p2T)/a2 + 2*psi/(alpha*a1) + psi/(a1*a1)
+		- y[t] * (1 + 2*alpha) / (a2*a1*a1);
+	}
+    } else {
+	/* psi = 1/alpha is the same for all obs */
+	double psi = 1/alpha;
+	double lgpsi = lngamma(psi);
+	double dgpsi = digamma(psi);
+	double amin3 = psi / a2;
+	double am1, am2, mpp, rat;
+
+	for (t=t1; t<t2; t++) {
+	    mu[t] = exp(mu[t]);
+	    if (off != NULL) {
+		mu[t] *= off[t];
+	    }
+	    if (mu[t] == 0) {
+		return NADBL;
+	    }
+	    am1 = 1 + alpha * mu[t];
+	    am2 = am1 * am1;
+	    mpp = mu[t] + psi;
+	    rat = psi/mpp;
+	    ll += lngamma(y[t] + psi) - lgpsi - lngamma(y[t] + 1.0);
+	    ll += psi * log(rat) + y[t] * log(1-rat);
+	    d1[t] = (y[t] - mu[t]) / am1;
+	    w[t] = mu[t] * (1 + alpha*y[t]) / am2;
+	    da[t] = -(digamma(psi + y[t]) - dgpsi - log(1 + mu[t]/psi)
+		      - (y[t] - mu[t])/mpp) / a2;
+	    dab[t] = -mu[t] * (y[t] - mu[t]) / am2;
+	    aa -= nb2_jsum(y[t], alpha) + 2 * amin3 * log(am1)
+		- 2 * mu[t] / (a2 * am1) - (y[t] + psi) * mu[t] * mu[t] / am2;
 	}
     }
 
-    return err;
+    *saa = aa;
+
+    return ll;
 }
 
+/* Everything the Newton iterations need is computed here, in a
+   pass over the data threaded by chunks of observations; the
+   score and Hessian functions below just assemble the results.
+*/
+
 static double negbin_loglik (const double *theta, void *data)
 {
     count_info *cinfo = (count_info *) data;
     double alpha = theta[cinfo->k];
-    double *mu = cinfo->mu->val;
-    double *y = cinfo->y->val;
-    double psi = 0, lgpsi = 0;
-    double mpp, rat, llt;
-    int t, err = 0;
+    double *psum = cinfo->psum;
+    int nc = count_chunks(cinfo->n);
+    int c, i;
 
     if (alpha <= 0) {
 	return NADBL;
     }
 
-    err = negbin_update_mu(cinfo, theta);
-    if (err) {
-	return NADBL;
+    for (i=0; i<cinfo->k; i++) {
+	cinfo->b->val[i] = theta[i];
     }
 
-    cinfo->ll = 0.0;
-    errno = 0;
+    gretl_matrix_multiply(cinfo->X, cinfo->b, cinfo->mu);
 
-    if (cinfo->nbtype == 2) {
-	/* in NegBin2 psi is the same for all obs, so it can
-	   be dealt with outside the loop */
-	psi = 1/alpha;
-	lgpsi = lngamma(psi);
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) cinfo->n * cinfo->k))
+#endif
+    for (c=0; c<nc; c++) {
+	int t1 = c * COUNT_CHUNK;
+	int t2 = MIN(t1 + COUNT_CHUNK, cinfo->n);
+
+	psum[c] = negbin_chunk(cinfo, alpha, t1, t2, &psum[nc+c]);
     }
 
-    for (t=0; t<cinfo->n; t++) {
-	if (cinfo->nbtype == 1) {
-	    psi = mu[t]/alpha;
-	    lgpsi = lngamma(psi);
-	}
-	mpp = mu[t] + psi;
-	rat = psi/mpp;
-	llt = lngamma(y[t] + psi) - lgpsi - lngamma(y[t] + 1.0);
-	llt += psi * log(rat) + y[t] * log(1-rat);
-	cinfo->ll += llt;
+    cinfo->ll = cinfo->daa = 0.0;
+    for (c=0; c<nc; c++) {
+	cinfo->ll += psum[c];
+	cinfo->daa += psum[nc+c];
     }
 
-    if (errno || get_cephes_errno()) {
+    if (na(cinfo->ll)) {
 	cinfo->ll = NADBL;
     }
 
@@ -322,157 +496,90 @@ static int negbin_score (double *theta, double *g, int np,
 			 BFGS_CRIT_FUNC ll, void *data)
 {
     count_info *cinfo = (count_info *) data;
-    double dpsi_dmu, dmu_dbi, dpsi_da = 0;
-    double dl_dpsi, dl_dmu, dl_da;
-    const double *y = cinfo->y->val;
-    const double *mu = cinfo->mu->val;
-    double alpha = theta[cinfo->k];
-    double a2 = alpha * alpha;
-    double psi = 0, dgpsi = 0;
-    double mpp, gti;
-    int i, t, err = 0;
-
-    if (cinfo->flags == SCORE_UPDATE_MU) {
-	negbin_update_mu(cinfo, theta);
-    }
-
-    if (g != NULL) {
-	for (i=0; i<np; i++) {
-	    g[i] = 0.0;
-	}
-    }
+    const double *da = cinfo->da->val;
+    int t;
 
-    if (cinfo->nbtype == 1) {
-	dpsi_dmu = 1/alpha;
-    } else {
-	psi = 1/alpha;
-	dpsi_dmu = 0;
-	dgpsi = digamma(psi);
-	dpsi_da = -1/a2;
-    }
+    count_Xtv(cinfo->X, cinfo->d1->val, g);
 
+    g[cinfo->k] = 0.0;
     for (t=0; t<cinfo->n; t++) {
-	if (cinfo->nbtype == 1) {
-	    psi = mu[t]/alpha;
-	    dgpsi = digamma(psi);
-	    dpsi_da = -mu[t]/a2;
-	}
-	mpp = mu[t] + psi;
-	dl_dpsi = digamma(psi + y[t]) - dgpsi
-	    - log(1 + mu[t]/psi) - (y[t] - mu[t])/mpp;
-	dl_da = dl_dpsi * dpsi_da;
-	dl_dmu = y[t]/mu[t] - (psi + y[t])/mpp;
-	for (i=0; i<np; i++) {
-	    if (i < cinfo->k) {
-		dmu_dbi = mu[t] * gretl_matrix_get(cinfo->X, t, i);
-		gti = (dl_dpsi * dpsi_dmu + dl_dmu) * dmu_dbi;
-	    } else {
-		gti = dl_da;
-	    }
-	    gretl_matrix_set(cinfo->G, t, i, gti);
-	    if (g != NULL) {
-		g[i] += gti;
-	    }
-	}
+	g[cinfo->k] += da[t];
     }
 
-    return err;
+    return 0;
 }
 
-static int negbin2_hessian (double *theta, gretl_matrix *H,
-			    void *data)
+/* Write into @H the negative of the Hessian, for both NegBin1 and
+   NegBin2, from the derivatives computed by negbin_loglik(). */
+
+static int negbin_hessian (double *theta, gretl_matrix *H,
+			   void *data)
 {
     count_info *cinfo = (count_info *) data;
-    double *mu = cinfo->mu->val;
-    double *y = cinfo->y->val;
-    double a = theta[cinfo->k];
-    double am1, am2;
-    double amin2, amin3;
-    double hrs, xtr, xts;
     int k = cinfo->k;
-    int t, r, s, j;
-    int err = 0;
-
-    gretl_matrix_zero(H);
+    double *hk = H->val + (size_t) k * H->rows;
+    int i, j;
 
-    amin2 = pow(a, -2);
-    amin3 = pow(a, -3);
+    count_XWX(cinfo->X, cinfo->w->val, cinfo->HX, cinfo->V);
 
-    for (t=0; t<cinfo->n; t++) {
-	am1 = 1 + a * mu[t];
-	am2 = am1 * am1;
-	/* beta/beta terms */
-	for (r=0; r<k; r++) {
-	    xtr = gretl_matrix_get(cinfo->X, t, r);
-	    for (s=0; s<=r; s++) {
-		xts = gretl_matrix_get(cinfo->X, t, s);
-		hrs = gretl_matrix_get(H, r, s);
-		hrs += (mu[t] * (1+a*y[t]) * xtr * xts) / am2;
-		gretl_matrix_set(H, r, s, hrs);
-		if (r != s) {
-		    gretl_matrix_set(H, s, r, hrs);
-		}
-	    }
-	}
-	/* beta/alpha terms */
-	for (r=0; r<k; r++) {
-	    xtr = gretl_matrix_get(cinfo->X, t, r);
-	    hrs = gretl_matrix_get(H, r, k);
-	    hrs += (mu[t] * (y[t] - mu[t]) * xtr) / am2;
-	    gretl_matrix_set(H, r, cinfo->k, hrs);
-	    gretl_matrix_set(H, cinfo->k, r, hrs);
-	}
-	/* alpha/alpha term */
-	hrs = gretl_matrix_get(H, k, k);
-	for (j=0; j<y[t]; j++) {
-	    hrs += pow(j/(1+a*j), 2);
+    for (j=0; j<k; j++) {
+	for (i=0; i<k; i++) {
+	    gretl_matrix_set(H, i, j, gretl_matrix_get(cinfo->V, i, j));
 	}
-	hrs += 2 * amin3 * log(am1);
-	hrs -= (2 * amin2 * mu[t]) / am1;
-	hrs -= ((y[t] + 1/a) * mu[t] * mu[t]) / am2;
-	gretl_matrix_set(H, k, k, hrs);
     }
 
-    return err;
+    /* beta/alpha terms, then alpha/alpha */
+    count_Xtv(cinfo->X, cinfo->dab->val, hk);
+    for (i=0; i<k; i++) {
+	hk[i] = -hk[i];
+	gretl_matrix_set(H, k, i, hk[i]);
+    }
+    hk[k] = -cinfo->daa;
+
+    return 0;
 }
 
-static gretl_matrix *negbin_init_H (count_info *cinfo)
+/* Fill the per-observation score matrix, for OPG or QML */
+
+static void negbin_fill_G (count_info *cinfo)
 {
-    gretl_matrix *H = NULL;
-    int err;
+    const double *d1 = cinfo->d1->val;
+    int n = cinfo->n;
+    int k = cinfo->k;
+    int i;
 
-    cinfo->flags = SCORE_UPDATE_MU;
-    err = negbin_score(cinfo->theta, NULL, cinfo->k + 1,
-		       NULL, cinfo);
-    cinfo->flags = 0;
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * k))
+#endif
+    for (i=0; i<=k; i++) {
+	double *gi = cinfo->G->val + (size_t) i * n;
+	int t;
 
-    if (!err) {
-	H = gretl_matrix_GG_inverse(cinfo->G, &err);
-    }
+	if (i < k) {
+	    const double *xi = cinfo->X->val + (size_t) i * n;
 
-    return H;
+	    for (t=0; t<n; t++) {
+		gi[t] = d1[t] * xi[t];
+	    }
+	} else {
+	    memcpy(gi, cinfo->da->val, n * sizeof *gi);
+	}
+    }
 }
 
 static gretl_matrix *negbin_hessian_inverse (count_info *cinfo,
 					     int *err)
 {
-    gretl_matrix *H = NULL;
+    gretl_matrix *H;
     int np = cinfo->k + 1;
 
-    if (cinfo->nbtype == 2) {
-	H = gretl_matrix_alloc(np, np);
-	if (H == NULL) {
-	    *err = E_ALLOC;
-	} else {
-	    negbin2_hessian(cinfo->theta, H, cinfo);
-	    *err = gretl_invert_symmetric_matrix(H);
-	}
+    H = gretl_matrix_alloc(np, np);
+
+    if (H == NULL) {
+	*err = E_ALLOC;
     } else {
-	cinfo->flags = SCORE_UPDATE_MU;
-	H = hessian_inverse_from_score(cinfo->theta, np,
-				       negbin_score, NULL,
-				       cinfo, err);
-	cinfo->flags = 0;
+	negbin_hessian(cinfo->theta, H, cinfo);
+	*err = gretl_invert_symmetric_matrix(H);
     }
 
     return H;
@@ -484,6 +591,13 @@ static int negbin_model_add_vcv (MODEL *pmod, count_info *cinfo,
     gretl_matrix *H = NULL;
     int err = 0;
 
+    /* make sure the derivatives are those at the estimates */
+    if (na(negbin_loglik(cinfo->theta, cinfo))) {
+	return E_NAN;
+    }
+
+    negbin_fill_G(cinfo);
+
     if (opt & OPT_G) {
 	err = gretl_model_add_OPG_vcv(pmod, cinfo->G, NULL);
     } else {
@@ -544,20 +658,14 @@ static int negbin_fill_hatvars (MODEL *pmod, count_info *cinfo)
 
 static int
 transcribe_negbin_results (MODEL *pmod, count_info *cinfo,
-			   const DATASET *dset, int fncount,
-			   int grcount, gretlopt opt)
+			   const DATASET *dset, int iters,
+			   gretlopt opt)
 {
     int nc = cinfo->k + 1;
     int i, err = 0;
 
     pmod->ci = cinfo->ci;
-
-    if (grcount > 0) {
-	gretl_model_set_int(pmod, "fncount", fncount);
-	gretl_model_set_int(pmod, "grcount", grcount);
-    } else {
-	gretl_model_set_int(pmod, "iters", fncount);
-    }
+    gretl_model_set_int(pmod, "iters", iters);
 
     if (cinfo->offvar) {
 	gretl_model_set_int(pmod, "offset_var", cinfo->offvar);
@@ -612,38 +720,25 @@ static int do_negbin (MODEL *pmod, int offvar, double omean,
     gretlopt maxopt = (opt & OPT_V) | OPT_U;
     gretl_matrix_block *B = NULL;
     count_info cinfo = {0};
-    double toler;
+    double crittol = 1.0e-7;
+    double gradtol = 1.0e-7;
     int maxit = 100;
-    int fncount = 0;
-    int grcount = 0;
+    int iters = 0;
     int err = 0;
 
     err = negbin_init(&cinfo, &B, pmod, dset, offvar, omean, opt, prn);
 
-    if (!err && cinfo.nbtype == 2) {
-	void *hfunc = negbin2_hessian;
-	double crittol = 1.0e-7;
-	double gradtol = 1.0e-7;
-
+    if (!err) {
 	err = newton_raphson_max(cinfo.theta, cinfo.k + 1, maxit,
-				 crittol, gradtol, &fncount,
+				 crittol, gradtol, &iters,
 				 C_LOGLIK, negbin_loglik,
-				 negbin_score, hfunc,
+				 negbin_score, negbin_hessian,
 				 &cinfo, maxopt, cinfo.prn);
-    } else if (!err) {
-	gretl_matrix *H = negbin_init_H(&cinfo);
-
-	BFGS_defaults(&maxit, &toler, NEGBIN);
-	err = BFGS_max(cinfo.theta, cinfo.k + 1, maxit, toler,
-		       &fncount, &grcount, negbin_loglik, C_LOGLIK,
-		       negbin_score, &cinfo, H, maxopt,
-		       cinfo.prn);
-	gretl_matrix_free(H);
     }
 
     if (!err) {
 	err = transcribe_negbin_results(pmod, &cinfo, dset,
-					fncount, grcount, opt);
+					iters, opt);
     }
 
     gretl_matrix_block_destroy(B);
@@ -837,6 +932,38 @@ static int transcribe_poisson_results (MODEL *pmod,
     return err;
 }
 
+/* Remove observation @t from the estimation sample of @pmod */
+
+static int count_drop_obs (MODEL *pmod, const DATASET *dset, int t)
+{
+    pmod->uhat[t] = pmod->yhat[t] = NADBL;
+    if (pmod->missmask == NULL) {
+	model_add_missmask(pmod, dset->n);
+    }
+    if (pmod->missmask == NULL) {
+	return E_ALLOC;
+    }
+    pmod->missmask[t] = '1';
+    pmod->nobs -= 1;
+    pmod->dfd -= 1;
+
+    return 0;
+}
+
+/* recalculate dep. var. statistics after dropping observations */
+
+static void count_depvar_stats (MODEL *pmod, const DATASET *dset)
+{
+    const double *y = dset->Z[pmod->list[1]];
+    double v;
+
+    pmod->ybar = gretl_restricted_mean(pmod->t1, pmod->t2, y,
+				       pmod->uhat, OP_NEQ, NADBL);
+    v = gretl_restricted_variance(pmod->t1, pmod->t2, y,
+				  pmod->uhat, OP_NEQ, NADBL);
+    pmod->sdy = sqrt(v);
+}
+
 /* Check the offset series (if present) and retrieve its mean
    if the series is OK. Here we allow for the possibility
    that the offset variable has fewer valid observations than
@@ -858,17 +985,7 @@ static int get_offset_info (MODEL *pmod, DATASET *dset,
 	} else if (x[t] < 0.0) {
 	    err = E_DATA;
 	} else if (na(x[t])) {
-	    pmod->uhat[t] = pmod->yhat[t] = NADBL;
-	    if (pmod->missmask == NULL) {
-		model_add_missmask(pmod, dset->n);
-	    }
-	    if (pmod->missmask == NULL) {
-		err = E_ALLOC;
-	    } else {
-		pmod->missmask[t] = '1';
-	    }
-	    pmod->nobs -= 1;
-	    pmod->dfd -= 1;
+	    err = count_drop_obs(pmod, dset, t);
 	    ndrop++;
 	} else {
 	    omean += x[t];
@@ -881,15 +998,7 @@ static int get_offset_info (MODEL *pmod, DATASET *dset,
     }
 
     if (!err && ndrop > 0) {
-	/* recalculate dep. var. statistics */
-	const double *y = dset->Z[pmod->list[1]];
-	double v;
-
-	pmod->ybar = gretl_restricted_mean(pmod->t1, pmod->t2, y,
-					   pmod->uhat, OP_NEQ, NADBL);
-	v = gretl_restricted_variance(pmod->t1, pmod->t2, y,
-				      pmod->uhat, OP_NEQ, NADBL);
-	pmod->sdy = sqrt(v);
+	count_depvar_stats(pmod, dset);
     }
 
     if (!err) {
@@ -904,7 +1013,7 @@ static int get_offset_info (MODEL *pmod, DATASET *dset,
     return err;
 }
 
-static void poisson_update_mu (count_info *cinfo, const double *theta)
+static void poisson_update_index (count_info *cinfo, const double *theta)
 {
     int i;
 
@@ -921,80 +1030,83 @@ static void poisson_update_mu (count_info *cinfo, const double *theta)
     } else {
 	gretl_matrix_multiply(cinfo->X, cinfo->b, cinfo->Xb);
     }
-
-    for (i=0; i<cinfo->n; i++) {
-	cinfo->mu->val[i] = exp(cinfo->Xb->val[i]);
-    }
 }
 
-static double poisson_loglik (const double *theta, void *data)
+/* Given the index in Xb, fill mu and the residuals y - mu for
+   observations @t1 to @t2 and return their loglikelihood */
+
+static double poisson_chunk (count_info *cinfo, int t1, int t2)
 {
-    count_info *cinfo = (count_info *) data;
-    double *y  = cinfo->y->val;
-    double *Xb = cinfo->Xb->val;
+    const double *y = cinfo->y->val;
+    const double *Xb = cinfo->Xb->val;
     double *mu = cinfo->mu->val;
-    double llt;
+    double *d1 = cinfo->d1->val;
+    double ll = 0.0;
     int t;
 
-    poisson_update_mu(cinfo, theta);
-    cinfo->ll = 0.0;
-    errno = 0;
+    for (t=t1; t<t2; t++) {
+	mu[t] = exp(Xb[t]);
+	d1[t] = y[t] - mu[t];
+	ll += -mu[t] + y[t] * Xb[t] - lngamma(y[t] + 1);
+    }
 
-    for (t=0; t<cinfo->n; t++) {
-	llt = -mu[t] + y[t] * Xb[t] - lngamma(y[t] + 1);
-	cinfo->ll += llt;
+    return ll;
+}
+
+static double poisson_ll_pass (count_info *cinfo)
+{
+    int nc = count_chunks(cinfo->n);
+    int c;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) cinfo->n * cinfo->k))
+#endif
+    for (c=0; c<nc; c++) {
+	int t1 = c * COUNT_CHUNK;
+	int t2 = MIN(t1 + COUNT_CHUNK, cinfo->n);
+
+	cinfo->psum[c] = poisson_chunk(cinfo, t1, t2);
+    }
+
+    cinfo->ll = 0.0;
+    for (c=0; c<nc; c++) {
+	cinfo->ll += cinfo->psum[c];
     }
 
-    if (errno) {
+    if (na(cinfo->ll)) {
 	cinfo->ll = NADBL;
     }
 
     return cinfo->ll;
 }
 
+static double poisson_loglik (const double *theta, void *data)
+{
+    count_info *cinfo = (count_info *) data;
+
+    poisson_update_index(cinfo, theta);
+
+    return poisson_ll_pass(cinfo);
+}
+
 static int poisson_score (double *theta, double *g, int np,
 			  BFGS_CRIT_FUNC ll, void *data)
 {
     count_info *cinfo = (count_info *) data;
-    double *y  = cinfo->y->val;
-    double *mu = cinfo->mu->val;
-    double dev;
-    int i, t, err = 0;
-
-    for (i=0; i<np; i++) {
-	g[i] = 0.0;
-    }
 
-    for (t=0; t<cinfo->n; t++) {
-	dev = y[t] - mu[t];
-	for (i=0; i<np; i++) {
-	    g[i] += dev * gretl_matrix_get(cinfo->X, t, i);
-	}
-    }
+    count_Xtv(cinfo->X, cinfo->d1->val, g);
 
-    return err;
+    return 0;
 }
 
 static int poisson_hessian (double *theta, gretl_matrix *H,
 			    void *data)
 {
     count_info *cinfo = (count_info *) data;
-    double *mu = cinfo->mu->val;
-    double hxti;
-    int i, t, err = 0;
-
-    for (t=0; t<cinfo->n; t++) {
-	for (i=0; i<cinfo->k; i++) {
-	    hxti = gretl_matrix_get(cinfo->X, t, i);
-	    gretl_matrix_set(cinfo->HX, t, i, mu[t] * hxti);
-	}
-    }
 
-    gretl_matrix_multiply_mod(cinfo->X, GRETL_MOD_TRANSPOSE,
-			      cinfo->HX, GRETL_MOD_NONE,
-			      H, GRETL_MOD_NONE);
+    count_XWX(cinfo->X, cinfo->mu->val, cinfo->HX, H);
 
-    return err;
+    return 0;
 }
 
 static int do_poisson (MODEL *pmod, int offvar, double omean,
@@ -1067,6 +1179,723 @@ static int do_poisson (MODEL *pmod, int offvar, double omean,
 
     gretl_matrix_block_destroy(B);
     gretl_matrix_free(cinfo.logoff);
+    free(cinfo.psum);
+
+    return err;
+}
+
+/* Poisson pseudo-ML with absorbed fixed effects (PPML-HDFE), as
+   used for gravity models of trade: see Correia, Guimaraes and
+   Zylkin (2020). The effects are never estimated explicitly: each
+   IRLS iteration sweeps them out of the working dependent variable
+   and the regressors by weighted alternating projections, then
+   solves the weighted least squares problem for the slopes with the
+   same X'WX kernel as the Newton iterations above.
+*/
+
+#define PPML_TOL 1.0e-8      /* relative change in deviance */
+#define PPML_MAXITER 500
+#define SWEEP_TOL 1.0e-20    /* relative squared change per sweep */
+#define SWEEP_MAXITER 10000
+
+typedef struct ppml_info_ ppml_info;
+
+struct ppml_info_ {
+    int *flist;        /* list of absorbed factors */
+    int n;             /* number of observations */
+    int **code;        /* level codes, by factor and observation */
+    int *G;            /* number of levels, by factor */
+    double **wsum;     /* sums of weights, by factor and level */
+    int Gmax;          /* largest number of levels */
+    gretl_matrix *Xt;  /* demeaned regressors and working variable */
+    double *z;         /* working dependent variable */
+};
+
+typedef struct ppml_val_ ppml_val;
+
+struct ppml_val_ {
+    double x;
+    int s;
+};
+
+static int compare_ppml_vals (const void *a, const void *b)
+{
+    const ppml_val *va = a;
+    const ppml_val *vb = b;
+
+    return (va->x > vb->x) - (va->x < vb->x);
+}
+
+static void ppml_info_free (ppml_info *pi)
+{
+    int f, nf = (pi->flist != NULL)? pi->flist[0] : 0;
+
+    for (f=0; f<nf; f++) {
+	if (pi->code != NULL) {
+	    free(pi->code[f]);
+	}
+	if (pi->wsum != NULL) {
+	    free(pi->wsum[f]);
+	}
+    }
+    free(pi->code);
+    free(pi->wsum);
+    free(pi->G);
+    free(pi->flist);
+    free(pi->z);
+    gretl_matrix_free(pi->Xt);
+}
+
+/* Parse the argument to the --absorb option: one or more series
+   names, separated by spaces or commas.
+*/
+
+static int ppml_factor_list (ppml_info *pi, const DATASET *dset)
+{
+    const char *s = get_optval_string(POISSON, OPT_G);
+    char **S = NULL;
+    int i, vi, n = 0;
+    int err = 0;
+
+    if (s == NULL || *s == '\0') {
+	return E_DATA;
+    }
+
+    S = gretl_string_split(s, &n, " ,");
+    if (S == NULL) {
+	return E_ALLOC;
+    }
+
+    pi->flist = gretl_list_new(n);
+    if (pi->flist == NULL) {
+	err = E_ALLOC;
+    }
+
+    for (i=0; i<n && !err; i++) {
+	vi = current_series_index(dset, S[i]);
+	if (vi == 0) {
+	    err = E_DATA;
+	} else if (vi < 0) {
+	    err = E_UNKVAR;
+	} else if (in_gretl_list(pi->flist, vi)) {
+	    gretl_errmsg_sprintf(_("%s: duplicated argument"), S[i]);
+	    err = E_DATA;
+	} else {
+	    pi->flist[i+1] = vi;
+	}
+    }
+
+    strings_array_free(S, n);
+
+    return err;
+}
+
+/* Map the observations in the current sample of @pmod onto 0-based
+   level codes for each absorbed factor, and count the levels.
+*/
+
+static int ppml_fill_codes (ppml_info *pi, const MODEL *pmod,
+			    const DATASET *dset)
+{
+    ppml_val *av;
+    const double *x;
+    int f, g, s, t, vi;
+    int err = 0;
+
+    pi->n = pmod->nobs;
+    av = malloc(pi->n * sizeof *av);
+    if (av == NULL) {
+	return E_ALLOC;
+    }
+
+    for (f=0; f<pi->flist[0] && !err; f++) {
+	vi = pi->flist[f+1];
+	x = dset->Z[vi];
+	for (t=pmod->t1, s=0; t<=pmod->t2 && !err; t++) {
+	    if (na(pmod->uhat[t])) {
+		continue;
+	    } else if (na(x[t])) {
+		gretl_errmsg_sprintf(_("%s: missing values are not allowed "
+				       "in absorbed factors"),
+				     dset->varname[vi]);
+		err = E_MISSDATA;
+	    } else {
+		av[s].x = x[t];
+		av[s].s = s;
+		s++;
+	    }
+	}
+	if (!err) {
+	    qsort(av, pi->n, sizeof *av, compare_ppml_vals);
+	    for (s=0, g=0; s<pi->n; s++) {
+		if (s > 0 && av[s].x != av[s-1].x) {
+		    g++;
+		}
+		pi->code[f][av[s].s] = g;
+	    }
+	    pi->G[f] = g + 1;
+	}
+    }
+
+    free(av);
+
+    return err;
+}
+
+/* Drop the observations belonging to levels of an absorbed factor
+   on which the dependent variable is always zero: their effects
+   would head off to minus infinity, and they carry no information
+   on the slopes. Dropping some may expose others, so we repeat
+   until the sample is stable; the codes are left matching it.
+*/
+
+static int ppml_drop_separated (ppml_info *pi, MODEL *pmod,
+				const DATASET *dset)
+{
+    const double *y = dset->Z[pmod->list[1]];
+    double *ysum = NULL;
+    int f, s, t, nd;
+    int ndrop = 0;
+    int err = 0;
+
+    while (!err) {
+	err = ppml_fill_codes(pi, pmod, dset);
+	if (err) {
+	    break;
+	}
+	/* mark the observations to drop via pi->z */
+	for (s=0; s<pi->n; s++) {
+	    pi->z[s] = 0;
+	}
+	for (f=0; f<pi->flist[0] && !err; f++) {
+	    ysum = calloc(pi->G[f], sizeof *ysum);
+	    if (ysum == NULL) {
+		err = E_ALLOC;
+		break;
+	    }
+	    for (t=pmod->t1, s=0; t<=pmod->t2; t++) {
+		if (!na(pmod->uhat[t])) {
+		    ysum[pi->code[f][s++]] += y[t];
+		}
+	    }
+	    for (s=0; s<pi->n; s++) {
+		if (ysum[pi->code[f][s]] == 0) {
+		    pi->z[s] = 1;
+		}
+	    }
+	    free(ysum);
+	}
+	nd = 0;
+	for (t=pmod->t1, s=0; t<=pmod->t2 && !err; t++) {
+	    if (!na(pmod->uhat[t])) {
+		if (pi->z[s++] == 1) {
+		    err = count_drop_obs(pmod, dset, t);
+		    nd++;
+		}
+	    }
+	}
+	if (nd == 0) {
+	    break;
+	}
+	ndrop += nd;
+    }
+
+    if (!err && ndrop > 0) {
+	if (pmod->nobs <= pmod->ncoeff) {
+	    err = E_DF;
+	} else {
+	    count_depvar_stats(pmod, dset);
+	}
+    }
+
+    return err;
+}
+
+static int ppml_setup (ppml_info *pi, MODEL *pmod,
+		       const DATASET *dset)
+{
+    int f, i, nf;
+    int err;
+
+    err = ppml_factor_list(pi, dset);
+    if (err) {
+	return err;
+    }
+
+    /* the constant is subsumed by the absorbed effects */
+    for (i=2; i<=pmod->list[0]; i++) {
+	if (pmod->list[i] == 0) {
+	    gretl_list_delete_at_pos(pmod->list, i);
+	    pmod->ncoeff -= 1;
+	    pmod->dfn -= 1;
+	    pmod->dfd += 1;
+	    pmod->ifc = 0;
+	    break;
+	}
+    }
+
+    if (pmod->ncoeff == 0) {
+	return E_NOVARS;
+    }
+
+    nf = pi->flist[0];
+    pi->code = calloc(nf, sizeof *pi->code);
+    pi->wsum = calloc(nf, sizeof *pi->wsum);
+    pi->G = calloc(nf, sizeof *pi->G);
+    pi->z = malloc(pmod->nobs * sizeof *pi->z);
+    if (pi->code == NULL || pi->wsum == NULL ||
+	pi->G == NULL || pi->z == NULL) {
+	return E_ALLOC;
+    }
+
+    for (f=0; f<nf; f++) {
+	pi->code[f] = malloc(pmod->nobs * sizeof(int));
+	if (pi->code[f] == NULL) {
+	    return E_ALLOC;
+	}
+    }
+
+    err = ppml_drop_separated(pi, pmod, dset);
+
+    for (f=0; f<nf && !err; f++) {
+	pi->wsum[f] = malloc(pi->G[f] * sizeof(double));
+	if (pi->wsum[f] == NULL) {
+	    err = E_ALLOC;
+	} else if (pi->G[f] > pi->Gmax) {
+	    pi->Gmax = pi->G[f];
+	}
+    }
+
+    if (!err) {
+	pi->Xt = gretl_matrix_alloc(pi->n, pmod->ncoeff + 1);
+	if (pi->Xt == NULL) {
+	    err = E_ALLOC;
+	}
+    }
+
+    return err;
+}
+
+/* The number of absorbed effects, less one normalization per
+   factor after the first */
+
+static int ppml_absorbed_df (const ppml_info *pi)
+{
+    int f, adf = 0;
+
+    for (f=0; f<pi->flist[0]; f++) {
+	adf += pi->G[f] - (f > 0);
+    }
+
+    return adf;
+}
+
+/* Subtract from @x its weighted means by level of factor @f, using
+   @sum as workspace; returns the weighted sum of squared changes.
+*/
+
+static double ppml_demean (const ppml_info *pi, int f,
+			   const double *w, double *x,
+			   double *sum)
+{
+    const int *code = pi->code[f];
+    const double *wsum = pi->wsum[f];
+    double d, ss = 0.0;
+    int g, s;
+
+    for (g=0; g<pi->G[f]; g++) {
+	sum[g] = 0.0;
+    }
+    for (s=0; s<pi->n; s++) {
+	sum[code[s]] += w[s] * x[s];
+    }
+    for (g=0; g<pi->G[f]; g++) {
+	sum[g] /= wsum[g];
+    }
+    for (s=0; s<pi->n; s++) {
+	d = sum[code[s]];
+	x[s] -= d;
+	ss += w[s] * d * d;
+    }
+
+    return ss;
+}
+
+static int ppml_sweep (const ppml_info *pi, const double *w,
+		       double *x, double *sum)
+{
+    double ss, ss0 = 0.0;
+    int f, s, iter = 0;
+
+    for (s=0; s<pi->n; s++) {
+	ss0 += w[s] * x[s] * x[s];
+    }
+
+    if (ss0 > 0) {
+	for (iter=0; iter<SWEEP_MAXITER; iter++) {
+	    ss = 0.0;
+	    for (f=0; f<pi->flist[0]; f++) {
+		ss += ppml_demean(pi, f, w, x, sum);
+	    }
+	    if (ss <= SWEEP_TOL * ss0) {
+		break;
+	    }
+	}
+    }
+
+    return (iter < SWEEP_MAXITER)? 0 : E_NOCONV;
+}
+
+/* Load the regressors and the working dependent variable into
+   pi->Xt and sweep the absorbed effects out of them, given the
+   weights @w. The columns are independent problems so they're
+   handled in parallel, each with its own workspace.
+*/
+
+static int ppml_demean_all (ppml_info *pi, const gretl_matrix *X,
+			    const double *w)
+{
+    int f, g, s, j;
+    int n = pi->n;
+    int k = X->cols;
+    int err = 0;
+
+    for (f=0; f<pi->flist[0]; f++) {
+	for (g=0; g<pi->G[f]; g++) {
+	    pi->wsum[f][g] = 0.0;
+	}
+	for (s=0; s<n; s++) {
+	    pi->wsum[f][pi->code[f][s]] += w[s];
+	}
+    }
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * (k+1)))
+#endif
+    for (j=0; j<=k; j++) {
+	double *xj = pi->Xt->val + (size_t) j * n;
+	double *sum = malloc(pi->Gmax * sizeof *sum);
+	int jerr;
+
+	if (j < k) {
+	    memcpy(xj, X->val + (size_t) j * n, n * sizeof *xj);
+	} else {
+	    memcpy(xj, pi->z, n * sizeof *xj);
+	}
+	jerr = (sum == NULL)? E_ALLOC : ppml_sweep(pi, w, xj, sum);
+	free(sum);
+	if (jerr) {
+#if defined(_OPENMP)
+#pragma omp critical (ppml_err)
+#endif
+	    err = jerr;
+	}
+    }
+
+    return err;
+}
+
+/* Given the current mu, form the working dependent variable, sweep
+   out the absorbed effects, and solve for the slopes in cinfo->b.
+*/
+
+static int ppml_wls (count_info *cinfo, ppml_info *pi)
+{
+    const double *y = cinfo->y->val;
+    const double *lo = NULL;
+    const double *eta = cinfo->Xb->val;
+    const double *mu = cinfo->mu->val;
+    double *zt;
+    int n = cinfo->n;
+    int k = cinfo->k;
+    int t, err;
+
+    if (cinfo->logoff != NULL) {
+	lo = cinfo->logoff->val;
+    }
+
+    for (t=0; t<n; t++) {
+	pi->z[t] = eta[t] + (y[t] - mu[t]) / mu[t];
+	if (lo != NULL) {
+	    pi->z[t] -= lo[t];
+	}
+    }
+
+    err = ppml_demean_all(pi, cinfo->X, mu);
+    if (err) {
+	return err;
+    }
+
+    zt = pi->Xt->val + (size_t) k * n;
+    for (t=0; t<n; t++) {
+	cinfo->d1->val[t] = mu[t] * zt[t];
+    }
+
+    gretl_matrix_reuse(pi->Xt, n, k);
+    count_XWX(pi->Xt, mu, cinfo->HX, cinfo->V);
+    count_Xtv(pi->Xt, cinfo->d1->val, cinfo->b->val);
+    gretl_matrix_reuse(pi->Xt, n, k+1);
+
+    return gretl_cholesky_decomp_solve(cinfo->V, cinfo->b);
+}
+
+/* Update the index and mu for observations @t1 to @t2: the fitted
+   index is the working variable less the residual from the demeaned
+   regression. Returns the contribution to the deviance.
+*/
+
+static double ppml_update_chunk (count_info *cinfo, ppml_info *pi,
+				 int t1, int t2)
+{
+    const double *y = cinfo->y->val;
+    const double *Xt = pi->Xt->val;
+    const double *b = cinfo->b->val;
+    double *eta = cinfo->Xb->val;
+    double *mu = cinfo->mu->val;
+    size_t n = pi->n;
+    int k = cinfo->k;
+    double e, dev = 0.0;
+    int i, t;
+
+    for (t=t1; t<t2; t++) {
+	e = Xt[k*n + t];
+	for (i=0; i<k; i++) {
+	    e -= Xt[i*n + t] * b[i];
+	}
+	eta[t] = pi->z[t] - e;
+	if (cinfo->logoff != NULL) {
+	    eta[t] += cinfo->logoff->val[t];
+	}
+	mu[t] = exp(eta[t]);
+	if (y[t] > 0) {
+	    dev += y[t] * log(y[t] / mu[t]);
+	}
+	dev -= y[t] - mu[t];
+    }
+
+    return 2 * dev;
+}
+
+static int ppml_irls (count_info *cinfo, ppml_info *pi, int *iters)
+{
+    const double *y = cinfo->y->val;
+    double *eta = cinfo->Xb->val;
+    double *mu = cinfo->mu->val;
+    double dev, dev0 = NADBL;
+    double ybar = 0.0;
+    int n = cinfo->n;
+    int nc = count_chunks(n);
+    int c, t, iter;
+    int err = 0;
+
+    for (t=0; t<n; t++) {
+	ybar += y[t];
+    }
+    ybar /= n;
+
+    for (t=0; t<n; t++) {
+	mu[t] = (y[t] + ybar) / 2;
+	eta[t] = log(mu[t]);
+    }
+
+    for (iter=1; iter<=PPML_MAXITER; iter++) {
+	err = ppml_wls(cinfo, pi);
+	if (err) {
+	    break;
+	}
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) n * cinfo->k))
+#endif
+	for (c=0; c<nc; c++) {
+	    int t1 = c * COUNT_CHUNK;
+	    int t2 = MIN(t1 + COUNT_CHUNK, n);
+
+	    cinfo->psum[c] = ppml_update_chunk(cinfo, pi, t1, t2);
+	}
+	dev = 0.0;
+	for (c=0; c<nc; c++) {
+	    dev += cinfo->psum[c];
+	}
+	if (na(dev)) {
+	    err = E_NAN;
+	    break;
+	}
+	if (cinfo->prn != NULL) {
+	    pprintf(cinfo->prn, "Iteration %d: deviance = %.12g\n", iter, dev);
+	}
+	if (!na(dev0) && fabs(dev - dev0) / MAX(MIN(dev, dev0), 0.1) < PPML_TOL) {
+	    break;
+	}
+	dev0 = dev;
+    }
+
+    if (!err && iter > PPML_MAXITER) {
+	err = E_NOCONV;
+    }
+
+    *iters = iter;
+
+    return err;
+}
+
+static char *ppml_factor_string (const ppml_info *pi,
+				 const DATASET *dset)
+{
+    PRN *prn = gretl_print_new(GRETL_PRINT_BUFFER, NULL);
+    char *s;
+    int i;
+
+    if (prn == NULL) {
+	return NULL;
+    }
+
+    for (i=1; i<=pi->flist[0]; i++) {
+	if (i > 1) {
+	    pputc(prn, ' ');
+	}
+	pputs(prn, dset->varname[pi->flist[i]]);
+    }
+
+    s = gretl_print_steal_buffer(prn);
+    gretl_print_destroy(prn);
+
+    return s;
+}
+
+/* Transcribe the PPML results: the covariance matrix is based on the
+   demeaned regressors at the final weights, and the absorbed effects
+   are counted in the degrees of freedom and information criteria.
+*/
+
+static int transcribe_ppml_results (MODEL *pmod, count_info *cinfo,
+				    ppml_info *pi, const DATASET *dset,
+				    int iters, gretlopt opt)
+{
+    const double *mu = cinfo->mu->val;
+    double *y = cinfo->y->val;
+    int adf = ppml_absorbed_df(pi);
+    int n = cinfo->n;
+    int k = cinfo->k;
+    int i, s, t, err = 0;
+
+    pmod->ci = POISSON;
+    gretl_model_set_int(pmod, "iters", iters);
+
+    for (i=0; i<k; i++) {
+	pmod->coeff[i] = cinfo->b->val[i];
+    }
+
+    if (cinfo->offvar) {
+	gretl_model_set_int(pmod, "offset_var", cinfo->offvar);
+    }
+
+    pmod->dfd = n - k - adf;
+    if (pmod->dfd <= 0) {
+	return E_DF;
+    }
+
+    pmod->ess = 0.0;
+
+    for (t=pmod->t1, s=0; t<=pmod->t2; t++) {
+	if (na(pmod->uhat[t])) {
+	    continue;
+	}
+	pmod->yhat[t] = mu[s];
+	pmod->uhat[t] = y[s] - mu[s];
+	pmod->ess += pmod->uhat[t] * pmod->uhat[t];
+	s++;
+    }
+
+    pmod->sigma = sqrt(pmod->ess / pmod->dfd);
+
+    /* loglikelihood and residuals at the estimates */
+    poisson_ll_pass(cinfo);
+
+    /* Hessian (and score, if wanted) at the final weights */
+    err = ppml_demean_all(pi, cinfo->X, mu);
+
+    if (!err) {
+	gretl_matrix_reuse(pi->Xt, n, k);
+	count_XWX(pi->Xt, mu, cinfo->HX, cinfo->V);
+	err = gretl_invert_symmetric_matrix(cinfo->V);
+    }
+
+    if (!err && (opt & OPT_R)) {
+	/* per-observation scores, in HX */
+	for (i=0; i<k; i++) {
+	    const double *xi = pi->Xt->val + (size_t) i * n;
+	    double *gi = cinfo->HX->val + (size_t) i * n;
+
+	    for (s=0; s<n; s++) {
+		gi[s] = xi[s] * cinfo->d1->val[s];
+	    }
+	}
+	err = gretl_model_add_QML_vcv(pmod, POISSON, cinfo->V,
+				      cinfo->HX, dset, opt, NULL);
+    } else if (!err) {
+	err = gretl_model_add_hessian_vcv(pmod, cinfo->V);
+    }
+
+    if (!err) {
+	pmod->lnL = cinfo->ll;
+	add_pseudoR2(pmod, cinfo);
+	mle_criteria(pmod, adf);
+	pmod->fstt = NADBL;
+	pmod->chisq = wald_omit_chisq(NULL, pmod);
+	gretl_model_set_string_as_data(pmod, "absorb",
+				       ppml_factor_string(pi, dset));
+	gretl_model_set_int(pmod, "absorb_df", adf);
+    }
+
+    return err;
+}
+
+static int do_ppml (MODEL *pmod, int offvar, double omean,
+		    DATASET *dset, gretlopt opt, PRN *prn)
+{
+    count_info cinfo = {0};
+    ppml_info pi = {0};
+    gretl_matrix_block *B = NULL;
+    int iters = 0;
+    int err = 0;
+
+    err = ppml_setup(&pi, pmod, dset);
+
+    if (!err) {
+	cinfo.ci = POISSON;
+	cinfo.n = pmod->nobs;
+	cinfo.k = pmod->ncoeff;
+	cinfo.offvar = offvar;
+	cinfo.omean = omean;
+	cinfo.prn = prn;
+	err = cinfo_allocate(&cinfo, &B);
+    }
+
+    if (!err && offvar > 0) {
+	cinfo.logoff = gretl_matrix_alloc(cinfo.n, 1);
+	if (cinfo.logoff == NULL) {
+	    err = E_ALLOC;
+	}
+    }
+
+    if (!err) {
+	cinfo_add_data(&cinfo, pmod, dset);
+	err = ppml_irls(&cinfo, &pi, &iters);
+    }
+
+    if (!err) {
+	err = transcribe_ppml_results(pmod, &cinfo, &pi, dset,
+				      iters, opt);
+    }
+
+    if (err) {
+	pmod->errcode = err;
+    }
+
+    gretl_matrix_block_destroy(B);
+    gretl_matrix_free(cinfo.logoff);
+    free(cinfo.psum);
+    ppml_info_free(&pi);
 
     return err;
 }
@@ -1095,7 +1924,10 @@ int count_data_estimate (MODEL *pmod, int ci, int offvar,
 	opt |= OPT_R;
     }
 
-    if (ci == NEGBIN) {
+    if (ci == POISSON && (opt & OPT_G)) {
+	/* PPML with absorbed fixed effects */
+	err = do_ppml(pmod, offvar, omean, dset, opt, vprn);
+    } else if (ci == NEGBIN) {
 #if POISSON_INIT
 	/* use auxiliary poisson to initialize the estimates */
 	err = do_poisson(pmod, offvar, omean, dset, OPT_A, NULL);
@@ -20,6 +20,14 @@
 #include "libgretl.h"
 #include "version.h"
 #include "varinfo_priv.h"
+#include "gretl_mt.h"
+
+#ifdef HAVE_ZSTD
+# include <zstd.h>
+#endif
+#ifdef HAVE_LZ4
+# include <lz4.h>
+#endif
 
 /* Writing and reading of gretl-native "pure binary" data files,
    developed in December 2020 as an alterative to the original
@@ -28,7 +36,46 @@
 
 #define PBDEBUG 0
 
-#define GBIN_VERSION 1 /* allow for future extension */
+#if defined(_WIN64)
+# define ftell64(a)     _ftelli64(a)
+# define fseek64(a,b,c) _fseeki64(a,b,c)
+#elif defined(WIN32)
+# define ftell64(a)     ftell(a)
+# define fseek64(a,b,c) fseek(a,b,c)
+#else
+# define ftell64(a)     ftello(a)
+# define fseek64(a,b,c) fseeko(a,b,c)
+#endif
+
+#define GBIN_VERSION 1
+
+/* Version 2, written only on request, pads the file so that
+   the numerical payload starts on an 8-byte boundary, allowing
+   it to be mapped into memory directly (see map_purebin_data()
+   below). Later versions are padded likewise.
+*/
+#define GBIN_ALIGNED_VERSION 2
+
+/* Version 3, written only on request, holds the numerical
+   payload in compressed blocks (see write_chunked_payload()
+   below)
+*/
+#define GBIN_CHUNKED_VERSION 3
+
+/* Version 4 is as version 3, but blocks of integer-valued data
+   may be held in narrow integer types or as bits before
+   compression (see gbin_int_filter() below)
+*/
+#define GBIN_TYPED_VERSION 4
+
+/* Files in any format other than version 1 start with an
+   extended magic string, which is not nul-terminated, so that
+   readers predating the later formats reject them rather than
+   misreading the payload
+*/
+#define GBIN_MAGIC     "gretl-purebin"
+#define GBIN_MAGIC_EXT "gretl-purebin+"
+#define GBIN_MAGIC_LEN 14
 
 typedef struct gbin_header_ gbin_header;
 
@@ -402,7 +449,9 @@ static int read_purebin_basics (const char *fname,
     }
 
     /* check magic bytes */
-    if (fread(buf, 1, 14, fp) != 14 || strcmp(buf, "gretl-purebin")) {
+    if (fread(buf, 1, GBIN_MAGIC_LEN, fp) != GBIN_MAGIC_LEN ||
+	(memcmp(buf, GBIN_MAGIC, GBIN_MAGIC_LEN) &&
+	 memcmp(buf, GBIN_MAGIC_EXT, GBIN_MAGIC_LEN))) {
 	pputs(prn, "not gretl-purebin\n");
 	err = E_DATA;
     }
@@ -420,6 +469,12 @@ static int read_purebin_basics (const char *fname,
 	err = check_byte_order(gh, prn);
     }
 
+    /* and for a format we don't know about */
+    if (!err && gh->gbin_version > GBIN_TYPED_VERSION) {
+	pprintf(prn, "unsupported purebin version %d\n", gh->gbin_version);
+	err = E_DATA;
+    }
+
     if (err) {
 	fclose(fp);
     } else {
@@ -436,19 +491,27 @@ static int read_purebin_basics (const char *fname,
 static int read_purebin_tail (DATASET *bset,
 			      gbin_header *gh,
 			      const int *sel,
+			      int t1,
 			      FILE *fp)
 {
     int i, j, err = 0;
-    char c;
+    char c, *S;
 
-    /* observation markers? */
+    /* observation markers? (keeping just those in the range
+       starting at @t1, if we're reading a subset of rows)
+    */
     if (!err && bset->S != NULL) {
-	for (i=0; i<bset->n; i++) {
+	for (i=0; i<gh->nobs; i++) {
+	    S = (i >= t1 && i < t1 + bset->n) ? bset->S[i-t1] : NULL;
 	    j = 0;
 	    while ((c = fgetc(fp)) != '\0') {
-		bset->S[i][j++] = c;
+		if (S != NULL) {
+		    S[j++] = c;
+		}
+	    }
+	    if (S != NULL) {
+		S[j] = '\0';
 	    }
-	    bset->S[i][j] = '\0';
 	}
     }
 
@@ -475,6 +538,798 @@ static int read_purebin_tail (DATASET *bset,
     return err;
 }
 
+/* Position @fp at the start of the numerical payload, skipping
+   any padding written to align it.
+*/
+
+static int seek_to_payload (gbin_header *gh, FILE *fp)
+{
+    if (gh->gbin_version > GBIN_VERSION) {
+	long pad = ftell(fp) % sizeof(double);
+
+	if (pad > 0 && fseek(fp, sizeof(double) - pad, SEEK_CUR) != 0) {
+	    return E_DATA;
+	}
+    }
+
+    return 0;
+}
+
+/* Point the (as yet unallocated) data columns of @bset
+   directly into a private mapping of the file, positioned by
+   @fp at the start of the numerical payload, and advance @fp
+   past the payload. The pages are shared with the page cache
+   until a series is modified, at which point it is copied on
+   write. Returns 1 if the mapping succeeded, 0 if the caller
+   should fall back on reading the data.
+*/
+
+static int map_purebin_data (const char *fname, DATASET *bset,
+			     FILE *fp, PRN *prn)
+{
+    GMappedFile *mf;
+    GError *gerr = NULL;
+    size_t slen = bset->n * sizeof(double);
+    long offset = ftell(fp);
+    const char *buf;
+    int i, nc = bset->v - 1;
+
+    if (nc == 0 || offset < 0 || offset % sizeof(double) != 0) {
+	return 0;
+    }
+
+    mf = g_mapped_file_new(fname, TRUE, &gerr);
+    if (mf == NULL) {
+	pprintf(prn, "gdtb: couldn't map file: %s\n", gerr->message);
+	g_error_free(gerr);
+	return 0;
+    }
+
+    if (g_mapped_file_get_length(mf) < offset + nc * slen ||
+	dataset_register_series_map(mf, nc) != 0) {
+	g_mapped_file_unref(mf);
+	return 0;
+    }
+
+    buf = g_mapped_file_get_contents(mf) + offset;
+    for (i=1; i<=nc; i++) {
+	bset->Z[i] = (double *) (buf + (i-1) * slen);
+	fseek(fp, slen, SEEK_CUR);
+    }
+
+    return 1;
+}
+
+/* Chunked, compressed payload (version 3)
+
+   In place of the raw payload, a version 3 file holds a small
+   header giving the number of observations per block and the
+   number of blocks per series, followed by an index with one
+   entry per block of each series, followed by the compressed
+   blocks themselves (all the blocks for series 1, then all for
+   series 2, and so on), followed by the trailing metadata as
+   in the uncompressed format. Each block is compressed
+   independently, after a filter that rearranges its bytes to
+   make the values more compressible, so the blocks can be
+   decompressed in parallel and a range of observations can be
+   extracted by decompressing only the blocks that cover it.
+*/
+
+#define GBIN_BLOCK_LEN 65536
+
+enum {
+    GBIN_CODEC_NONE,
+    GBIN_CODEC_ZLIB,
+    GBIN_CODEC_ZSTD,
+    GBIN_CODEC_LZ4
+};
+
+enum {
+    GBIN_FILTER_NONE,
+    GBIN_FILTER_SHUFFLE, /* transpose the bytes of the doubles */
+    GBIN_FILTER_DELTA,   /* XOR with predecessor, then shuffle */
+    GBIN_FILTER_BITS,    /* 0/1 values, packed 8 to a byte */
+    GBIN_FILTER_INT8,    /* small integers, one byte each */
+    GBIN_FILTER_INT32    /* integers, four bytes each */
+};
+
+/* codes for missing values in the narrow integer filters */
+#define GBIN_NA8  INT8_MIN
+#define GBIN_NA32 INT32_MIN
+
+typedef struct gbin_chunk_header_ gbin_chunk_header;
+typedef struct gbin_block_ gbin_block;
+
+struct gbin_chunk_header_ {
+    gint32 block_len;   /* observations per block */
+    gint32 nblocks;     /* blocks per series */
+    gint64 tail_offset; /* location of the trailing metadata */
+};
+
+struct gbin_block_ {
+    gint64 offset;  /* location of the compressed data */
+    guint32 csize;  /* size of the compressed data in bytes */
+    guint8 codec;   /* GBIN_CODEC_* */
+    guint8 filter;  /* GBIN_FILTER_* */
+    guint8 pad[2];
+};
+
+/* Parse the parameter to the --compress option for "store".
+   The default is the best codec we have available.
+*/
+
+static int gbin_get_codec (int *err)
+{
+    const char *s = get_optval_string(STORE, OPT_C);
+
+    if (s == NULL || *s == '\0') {
+#ifdef HAVE_ZSTD
+	return GBIN_CODEC_ZSTD;
+#else
+	return GBIN_CODEC_ZLIB;
+#endif
+    } else if (!strcmp(s, "zlib")) {
+	return GBIN_CODEC_ZLIB;
+    } else if (!strcmp(s, "zstd")) {
+#ifdef HAVE_ZSTD
+	return GBIN_CODEC_ZSTD;
+#endif
+    } else if (!strcmp(s, "lz4")) {
+#ifdef HAVE_LZ4
+	return GBIN_CODEC_LZ4;
+#endif
+    } else {
+	gretl_errmsg_sprintf(_("%s: invalid option argument"), s);
+	*err = E_INVARG;
+	return GBIN_CODEC_NONE;
+    }
+
+    gretl_errmsg_sprintf("gdtb: %s compression is not supported "
+			 "in this build", s);
+    *err = E_NOTIMP;
+
+    return GBIN_CODEC_NONE;
+}
+
+static size_t gbin_compress_bound (int codec, size_t n)
+{
+#ifdef HAVE_ZSTD
+    if (codec == GBIN_CODEC_ZSTD) {
+	return ZSTD_compressBound(n);
+    }
+#endif
+#ifdef HAVE_LZ4
+    if (codec == GBIN_CODEC_LZ4) {
+	return LZ4_compressBound((int) n);
+    }
+#endif
+    return compressBound(n);
+}
+
+/* Compress @n bytes from @src into @dst, which has room for
+   @cap bytes; on success write the compressed size into
+   @csize and return 0.
+*/
+
+static int gbin_compress (int codec, const void *src, size_t n,
+			  void *dst, size_t cap, size_t *csize)
+{
+    if (codec == GBIN_CODEC_ZLIB) {
+	uLongf len = cap;
+
+	if (compress2(dst, &len, src, n, 6) != Z_OK) {
+	    return E_DATA;
+	}
+	*csize = len;
+#ifdef HAVE_ZSTD
+    } else if (codec == GBIN_CODEC_ZSTD) {
+	size_t len = ZSTD_compress(dst, cap, src, n, 3);
+
+	if (ZSTD_isError(len)) {
+	    return E_DATA;
+	}
+	*csize = len;
+#endif
+#ifdef HAVE_LZ4
+    } else if (codec == GBIN_CODEC_LZ4) {
+	int len = LZ4_compress_default(src, dst, (int) n, (int) cap);
+
+	if (len <= 0) {
+	    return E_DATA;
+	}
+	*csize = len;
+#endif
+    } else {
+	return E_DATA;
+    }
+
+    return 0;
+}
+
+/* Decompress @csize bytes from @src into @dst, which should
+   receive exactly @n bytes.
+*/
+
+static int gbin_decompress (int codec, const void *src, size_t csize,
+			    void *dst, size_t n)
+{
+    if (codec == GBIN_CODEC_NONE) {
+	if (csize != n) {
+	    return E_DATA;
+	}
+	memcpy(dst, src, n);
+    } else if (codec == GBIN_CODEC_ZLIB) {
+	uLongf len = n;
+
+	if (uncompress(dst, &len, src, csize) != Z_OK || len != n) {
+	    return E_DATA;
+	}
+#ifdef HAVE_ZSTD
+    } else if (codec == GBIN_CODEC_ZSTD) {
+	if (ZSTD_decompress(dst, n, src, csize) != n) {
+	    return E_DATA;
+	}
+#endif
+#ifdef HAVE_LZ4
+    } else if (codec == GBIN_CODEC_LZ4) {
+	if (LZ4_decompress_safe(src, dst, (int) csize, (int) n) != (int) n) {
+	    return E_DATA;
+	}
+#endif
+    } else {
+	/* a codec not supported in this build */
+	return E_NOTIMP;
+    }
+
+    return 0;
+}
+
+/* The number of bytes taken by @n values under @filter */
+
+static size_t gbin_filtered_size (int filter, int n)
+{
+    if (filter == GBIN_FILTER_BITS) {
+	return (n + 7) / 8;
+    } else if (filter == GBIN_FILTER_INT8) {
+	return n;
+    } else if (filter == GBIN_FILTER_INT32) {
+	return n * sizeof(gint32);
+    } else {
+	return n * sizeof(double);
+    }
+}
+
+/* Check whether the @n values in @x can be stored losslessly
+   in one of the narrow types: dummies, small integers (such as
+   the codes of string-valued series) and larger integers, with
+   missing values allowed for the latter two. Returns the
+   appropriate filter, or GBIN_FILTER_NONE.
+*/
+
+static int gbin_int_filter (const double *x, int n)
+{
+    int bits = 1, nmiss = 0;
+    double xmin = 0, xmax = 0;
+    int i;
+
+    for (i=0; i<n; i++) {
+	if (isnan(x[i])) {
+	    nmiss++;
+	    continue;
+	} else if (!isfinite(x[i]) || x[i] != floor(x[i]) ||
+		   (x[i] == 0 && signbit(x[i]))) {
+	    return GBIN_FILTER_NONE;
+	}
+	if (x[i] < xmin) {
+	    xmin = x[i];
+	} else if (x[i] > xmax) {
+	    xmax = x[i];
+	}
+	if (bits && x[i] != 0 && x[i] != 1) {
+	    bits = 0;
+	}
+    }
+
+    if (nmiss == n) {
+	return GBIN_FILTER_INT8;
+    } else if (bits && nmiss == 0) {
+	return GBIN_FILTER_BITS;
+    } else if (xmin > GBIN_NA8 && xmax <= INT8_MAX) {
+	return GBIN_FILTER_INT8;
+    } else if (xmin > GBIN_NA32 && xmax <= INT32_MAX) {
+	return GBIN_FILTER_INT32;
+    } else {
+	return GBIN_FILTER_NONE;
+    }
+}
+
+/* Apply @filter to the @n values in @x, writing the
+   resulting bytes to @buf.
+*/
+
+static void gbin_filter (int filter, const double *x, int n,
+			 unsigned char *buf)
+{
+    const guint64 *u = (const guint64 *) x;
+    guint64 prev = 0, v;
+    int i, j;
+
+    if (filter == GBIN_FILTER_NONE) {
+	memcpy(buf, x, n * sizeof(double));
+	return;
+    } else if (filter == GBIN_FILTER_BITS) {
+	memset(buf, 0, gbin_filtered_size(filter, n));
+	for (i=0; i<n; i++) {
+	    if (x[i] != 0) {
+		buf[i/8] |= 1 << (i % 8);
+	    }
+	}
+	return;
+    } else if (filter == GBIN_FILTER_INT8) {
+	gint8 *b8 = (gint8 *) buf;
+
+	for (i=0; i<n; i++) {
+	    b8[i] = isnan(x[i]) ? GBIN_NA8 : (gint8) x[i];
+	}
+	return;
+    } else if (filter == GBIN_FILTER_INT32) {
+	gint32 k;
+
+	for (i=0; i<n; i++) {
+	    k = isnan(x[i]) ? GBIN_NA32 : (gint32) x[i];
+	    memcpy(buf + i * sizeof k, &k, sizeof k);
+	}
+	return;
+    }
+
+    for (i=0; i<n; i++) {
+	v = u[i];
+	if (filter == GBIN_FILTER_DELTA) {
+	    v ^= prev;
+	    prev = u[i];
+	}
+	for (j=0; j<8; j++) {
+	    buf[j*n + i] = (unsigned char) (v >> (8*j));
+	}
+    }
+}
+
+/* Reverse gbin_filter(), writing @n values into @x */
+
+static void gbin_unfilter (int filter, const unsigned char *buf,
+			   int n, double *x)
+{
+    guint64 *u = (guint64 *) x;
+    guint64 prev = 0, v;
+    int i, j;
+
+    if (filter == GBIN_FILTER_NONE) {
+	memcpy(x, buf, n * sizeof(double));
+	return;
+    } else if (filter == GBIN_FILTER_BITS) {
+	for (i=0; i<n; i++) {
+	    x[i] = (buf[i/8] >> (i % 8)) & 1;
+	}
+	return;
+    } else if (filter == GBIN_FILTER_INT8) {
+	const gint8 *b8 = (const gint8 *) buf;
+
+	for (i=0; i<n; i++) {
+	    x[i] = b8[i] == GBIN_NA8 ? NADBL : b8[i];
+	}
+	return;
+    } else if (filter == GBIN_FILTER_INT32) {
+	gint32 k;
+
+	for (i=0; i<n; i++) {
+	    memcpy(&k, buf + i * sizeof k, sizeof k);
+	    x[i] = k == GBIN_NA32 ? NADBL : k;
+	}
+	return;
+    }
+
+    for (i=0; i<n; i++) {
+	v = 0;
+	for (j=0; j<8; j++) {
+	    v |= (guint64) buf[j*n + i] << (8*j);
+	}
+	if (filter == GBIN_FILTER_DELTA) {
+	    v ^= prev;
+	    prev = v;
+	}
+	u[i] = v;
+    }
+}
+
+/* Compress one block of @n values starting at @x, trying the
+   XOR-delta filter as well as the plain shuffle if @delta is
+   non-zero, and keeping whichever gives the smaller result.
+   If compression doesn't pay, the raw values are kept. On
+   success *pbuf holds the bytes to write.
+*/
+
+static int compress_block (const double *x, int n, int codec,
+			   int delta, gbin_block *blk,
+			   unsigned char **pbuf)
+{
+    size_t raw = n * sizeof(double);
+    size_t cap = gbin_compress_bound(codec, raw);
+    unsigned char *tmp = malloc(raw);
+    unsigned char *out = malloc(cap);
+    unsigned char *alt = NULL;
+    size_t csize = 0, asize = 0;
+    int ifilter;
+    int err = 0;
+
+    if (tmp == NULL || out == NULL) {
+	err = E_ALLOC;
+	goto bailout;
+    }
+
+    ifilter = gbin_int_filter(x, n);
+
+    if (ifilter != GBIN_FILTER_NONE) {
+	/* integer data: narrow first, then compress */
+	size_t nb = gbin_filtered_size(ifilter, n);
+
+	gbin_filter(ifilter, x, n, tmp);
+	err = gbin_compress(codec, tmp, nb, out, cap, &csize);
+	if (!err) {
+	    blk->filter = ifilter;
+	    if (csize < nb) {
+		blk->codec = codec;
+	    } else {
+		memcpy(out, tmp, nb);
+		csize = nb;
+		blk->codec = GBIN_CODEC_NONE;
+	    }
+	    blk->csize = csize;
+	}
+	goto bailout;
+    }
+
+    gbin_filter(GBIN_FILTER_SHUFFLE, x, n, tmp);
+    err = gbin_compress(codec, tmp, raw, out, cap, &csize);
+    blk->filter = GBIN_FILTER_SHUFFLE;
+
+    if (!err && delta && n > 1) {
+	alt = malloc(cap);
+	if (alt != NULL) {
+	    gbin_filter(GBIN_FILTER_DELTA, x, n, tmp);
+	    if (gbin_compress(codec, tmp, raw, alt, cap, &asize) == 0 &&
+		asize < csize) {
+		free(out);
+		out = alt;
+		alt = NULL;
+		csize = asize;
+		blk->filter = GBIN_FILTER_DELTA;
+	    }
+	}
+    }
+
+    if (!err) {
+	if (csize < raw) {
+	    blk->codec = codec;
+	} else {
+	    /* incompressible: store the values as they are */
+	    memcpy(out, x, raw);
+	    csize = raw;
+	    blk->codec = GBIN_CODEC_NONE;
+	    blk->filter = GBIN_FILTER_NONE;
+	}
+	blk->csize = csize;
+    }
+
+ bailout:
+
+    free(tmp);
+    free(alt);
+    if (err) {
+	free(out);
+    } else {
+	*pbuf = out;
+    }
+
+    return err;
+}
+
+/* Write the numerical payload in chunked form, compressing the
+   blocks of each series in parallel. @fp is positioned at the
+   start of the payload; on return it's positioned at the start
+   of the trailing metadata.
+*/
+
+static int write_chunked_payload (const DATASET *dset,
+				  const int *list,
+				  int nv, int nobs,
+				  int codec, FILE *fp)
+{
+    gbin_chunk_header ch = {0};
+    gbin_block *idx = NULL;
+    unsigned char **bufs = NULL;
+    int delta = dataset_is_time_series(dset) ||
+	dataset_is_panel(dset);
+    gint64 start, pos;
+    int i, b, nb, vi;
+    int err = 0;
+
+    ch.block_len = GBIN_BLOCK_LEN;
+    ch.nblocks = nb = (nobs + GBIN_BLOCK_LEN - 1) / GBIN_BLOCK_LEN;
+
+    idx = calloc((size_t) nv * nb, sizeof *idx);
+    bufs = calloc(nb, sizeof *bufs);
+    if (idx == NULL || bufs == NULL) {
+	free(idx);
+	free(bufs);
+	return E_ALLOC;
+    }
+
+    /* leave room for the chunk header and index, which we'll
+       write when we know the block locations */
+    start = ftell64(fp);
+    pos = start + sizeof ch + (gint64) nv * nb * sizeof *idx;
+    if (fseek64(fp, pos, SEEK_SET) != 0) {
+	err = E_FOPEN;
+    }
+
+    for (i=0; i<nv && !err; i++) {
+	gbin_block *blk = idx + (size_t) i * nb;
+	const double *x;
+
+	vi = list != NULL ? list[i+1] : i+1;
+	x = dset->Z[vi] + dset->t1;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (nb > 1 && gretl_use_openmp((guint64) nobs))
+#endif
+	for (b=0; b<nb; b++) {
+	    int n = (b < nb - 1) ? GBIN_BLOCK_LEN : nobs - b * GBIN_BLOCK_LEN;
+	    int berr;
+
+	    berr = compress_block(x + (gint64) b * GBIN_BLOCK_LEN, n, codec,
+				  delta, &blk[b], &bufs[b]);
+	    if (berr) {
+#if defined(_OPENMP)
+#pragma omp critical (gbin_err)
+#endif
+		err = berr;
+	    }
+	}
+
+	for (b=0; b<nb; b++) {
+	    if (!err) {
+		blk[b].offset = pos;
+		if (fwrite(bufs[b], 1, blk[b].csize, fp) != blk[b].csize) {
+		    err = E_FOPEN;
+		}
+		pos += blk[b].csize;
+	    }
+	    free(bufs[b]);
+	    bufs[b] = NULL;
+	}
+    }
+
+    if (!err) {
+	ch.tail_offset = pos;
+	if (fseek64(fp, start, SEEK_SET) != 0 ||
+	    fwrite(&ch, sizeof ch, 1, fp) != 1 ||
+	    fwrite(idx, sizeof *idx, (size_t) nv * nb, fp) != (size_t) nv * nb ||
+	    fseek64(fp, pos, SEEK_SET) != 0) {
+	    err = E_FOPEN;
+	}
+    }
+
+    free(idx);
+    free(bufs);
+
+    return err;
+}
+
+/* A unit of work for reading a chunked payload: decompress
+   one block into (part of) one series.
+*/
+
+typedef struct {
+    const unsigned char *src; /* compressed data */
+    const gbin_block *blk;    /* block info */
+    double *dst;              /* target series */
+    int bt1;                  /* first obs in block */
+    int n;                    /* number of obs in block */
+} gbin_task;
+
+static int run_gbin_task (gbin_task *task, int t1, int t2)
+{
+    const gbin_block *blk = task->blk;
+    size_t raw = task->n * sizeof(double);
+    size_t fsize = gbin_filtered_size(blk->filter, task->n);
+    int s1 = task->bt1 > t1 ? task->bt1 : t1;
+    int s2 = task->bt1 + task->n - 1;
+    unsigned char *tmp = NULL;
+    double *x = NULL;
+    int err = 0;
+
+    if (s2 > t2) {
+	s2 = t2;
+    }
+
+    if (blk->filter > GBIN_FILTER_INT32) {
+	return E_DATA;
+    } else if (blk->codec == GBIN_CODEC_NONE && blk->filter == GBIN_FILTER_NONE) {
+	/* stored raw */
+	if (blk->csize != raw) {
+	    return E_DATA;
+	}
+	memcpy(task->dst + s1 - t1, task->src + (s1 - task->bt1) * sizeof(double),
+	       (s2 - s1 + 1) * sizeof(double));
+	return 0;
+    }
+
+    tmp = malloc(raw);
+    if (tmp == NULL) {
+	return E_ALLOC;
+    }
+
+    err = gbin_decompress(blk->codec, task->src, blk->csize, tmp, fsize);
+
+    if (!err) {
+	if (s1 == task->bt1 && s2 == task->bt1 + task->n - 1) {
+	    /* the whole block is wanted: write it in place */
+	    gbin_unfilter(blk->filter, tmp, task->n, task->dst + s1 - t1);
+	} else {
+	    x = malloc(raw);
+	    if (x == NULL) {
+		err = E_ALLOC;
+	    } else {
+		gbin_unfilter(blk->filter, tmp, task->n, x);
+		memcpy(task->dst + s1 - t1, x + s1 - task->bt1,
+		       (s2 - s1 + 1) * sizeof(double));
+		free(x);
+	    }
+	}
+    }
+
+    free(tmp);
+
+    return err;
+}
+
+/* Read a chunked payload into the series of @bset. If @sel is
+   non-NULL it maps from series in the file to series in @bset
+   (with 0 for series not wanted), and @t1 gives the first
+   observation wanted. The compressed data for the blocks
+   required are read in one pass, then decompressed in parallel.
+   On return @fp is positioned at the trailing metadata.
+*/
+
+static int read_chunked_payload (DATASET *bset, gbin_header *gh,
+				 const int *sel, int t1, FILE *fp,
+				 PRN *prn)
+{
+    gbin_chunk_header ch;
+    gbin_block *idx = NULL;
+    gbin_task *tasks = NULL;
+    unsigned char *buf = NULL;
+    int t2 = t1 + bset->n - 1;
+    int nv = gh->nvars - 1;
+    int b1, b2, nb, ntasks = 0;
+    size_t bufsize = 0, used = 0;
+    int i, b, k;
+    int err = 0;
+
+    if (fread(&ch, sizeof ch, 1, fp) != 1 || ch.block_len <= 0 ||
+	ch.nblocks != (gh->nobs + ch.block_len - 1) / ch.block_len) {
+	pputs(prn, "gdtb: invalid chunk header\n");
+	return E_DATA;
+    }
+
+    nb = ch.nblocks;
+    idx = malloc((size_t) nv * nb * sizeof *idx);
+    if (idx == NULL) {
+	return E_ALLOC;
+    }
+    if (fread(idx, sizeof *idx, (size_t) nv * nb, fp) != (size_t) nv * nb) {
+	pputs(prn, "gdtb: couldn't read block index\n");
+	err = E_DATA;
+	goto bailout;
+    }
+
+    /* the blocks covering the observations wanted */
+    b1 = t1 / ch.block_len;
+    b2 = t2 / ch.block_len;
+
+    /* size the buffer for the compressed data */
+    for (i=1; i<=nv; i++) {
+	if (sel == NULL || sel[i]) {
+	    const gbin_block *blk = idx + (size_t) (i-1) * nb;
+
+	    for (b=b1; b<=b2 && !err; b++) {
+		if (blk[b].offset + blk[b].csize > ch.tail_offset ||
+		    (b > b1 && blk[b].offset < blk[b-1].offset)) {
+		    err = E_DATA;
+		}
+	    }
+	    bufsize += blk[b2].offset + blk[b2].csize - blk[b1].offset;
+	    ntasks += b2 - b1 + 1;
+	}
+    }
+
+    if (err) {
+	pputs(prn, "gdtb: invalid block index\n");
+	goto bailout;
+    }
+
+    buf = malloc(bufsize > 0 ? bufsize : 1);
+    tasks = malloc(ntasks * sizeof *tasks);
+    if (buf == NULL || tasks == NULL) {
+	err = E_ALLOC;
+	goto bailout;
+    }
+
+    /* read the compressed data, series by series, and set up
+       the decompression tasks */
+    ntasks = 0;
+    for (i=1, k=1; i<=nv && !err; i++) {
+	const gbin_block *blk = idx + (size_t) (i-1) * nb;
+	size_t span;
+
+	if (sel != NULL && !sel[i]) {
+	    continue;
+	}
+	span = blk[b2].offset + blk[b2].csize - blk[b1].offset;
+	if (fseek64(fp, blk[b1].offset, SEEK_SET) != 0 ||
+	    fread(buf + used, 1, span, fp) != span) {
+	    gretl_errmsg_sprintf(_("failed reading variable %d"), i);
+	    err = E_DATA;
+	    break;
+	}
+	for (b=b1; b<=b2; b++) {
+	    gbin_task *task = &tasks[ntasks++];
+
+	    task->src = buf + used + (blk[b].offset - blk[b1].offset);
+	    task->blk = &blk[b];
+	    task->dst = bset->Z[k];
+	    task->bt1 = b * ch.block_len;
+	    task->n = (b < nb - 1) ? ch.block_len : gh->nobs - task->bt1;
+	}
+	used += span;
+	k++;
+    }
+
+    if (!err) {
+#if defined(_OPENMP)
+#pragma omp parallel for if (ntasks > 1 && gretl_use_openmp((guint64) ntasks * ch.block_len))
+#endif
+	for (i=0; i<ntasks; i++) {
+	    int terr = err ? 0 : run_gbin_task(&tasks[i], t1, t2);
+
+	    if (terr) {
+#if defined(_OPENMP)
+#pragma omp critical (gbin_err)
+#endif
+		err = terr;
+	    }
+	}
+	if (err == E_NOTIMP) {
+	    gretl_errmsg_set("gdtb: this file uses a compression method "
+			     "not supported in this build");
+	} else if (err) {
+	    gretl_errmsg_set("gdtb: corrupted compressed data");
+	}
+    }
+
+    if (!err && fseek64(fp, ch.tail_offset, SEEK_SET) != 0) {
+	err = E_DATA;
+    }
+
+ bailout:
+
+    free(idx);
+    free(tasks);
+    free(buf);
+
+    return err;
+}
+
 static void gh_to_bset_transcribe (gbin_header *gh, DATASET *bset)
 {
     bset->structure = gh->structure;
@@ -490,6 +1345,7 @@ int purebin_read_data (const char *fname, DATASET *dset,
     gbin_header gh = {0};
     FILE *fp = NULL;
     DATASET *bset = NULL;
+    int chunked, mapped = 0;
     int i, j;
     char c;
     size_t sz;
@@ -500,13 +1356,22 @@ int purebin_read_data (const char *fname, DATASET *dset,
 	return err;
     }
 
+    chunked = gh.gbin_version >= GBIN_CHUNKED_VERSION;
+
 #if PBDEBUG
     fprintf(stderr, "purebin read: gh.nvars=%d, gh.nobs=%d\n",
 	    gh.nvars, gh.nobs);
 #endif
 
-    /* allocate dataset */
-    bset = create_new_dataset(gh.nvars, gh.nobs, gh.markers);
+    /* allocate dataset: if we're going to try mapping the file,
+       defer allocation of the data columns
+    */
+    if (opt & OPT_N) {
+	bset = create_auxiliary_dataset(gh.nvars, gh.nobs,
+					gh.markers ? (OPT_B | OPT_M) : OPT_B);
+    } else {
+	bset = create_new_dataset(gh.nvars, gh.nobs, gh.markers);
+    }
     if (bset == NULL) {
 	pputs(prn, "gbin: create_new_dataset failed\n");
 	err = E_ALLOC;
@@ -529,8 +1394,25 @@ int purebin_read_data (const char *fname, DATASET *dset,
 	varinfo_read(bset, i, fp);
     }
 
+    err = seek_to_payload(&gh, fp);
+    if (!err && (opt & OPT_N)) {
+	bset->auxiliary = 0;
+	if (!chunked) {
+	    mapped = map_purebin_data(fname, bset, fp, prn);
+	}
+	for (i=1; i<bset->v && !mapped && !err; i++) {
+	    bset->Z[i] = malloc(bset->n * sizeof(double));
+	    if (bset->Z[i] == NULL) {
+		err = E_ALLOC;
+	    }
+	}
+    }
+
     /* numerical values */
-    for (i=1; i<bset->v && !err; i++) {
+    if (!err && chunked) {
+	err = read_chunked_payload(bset, &gh, NULL, 0, fp, prn);
+    }
+    for (i=1; i<bset->v && !chunked && !mapped && !err; i++) {
 	sz = fread(bset->Z[i], sizeof(double), bset->n, fp);
 	if (sz != (size_t) bset->n) {
 	    pprintf(prn, _("failed reading variable %d\n"), i);
@@ -539,7 +1421,9 @@ int purebin_read_data (const char *fname, DATASET *dset,
     }
 
     /* read remaining metadata */
-    err = read_purebin_tail(bset, &gh, NULL, fp);
+    if (!err) {
+	err = read_purebin_tail(bset, &gh, NULL, 0, fp);
+    }
 
     /* added 2021-06-21 */
     if (dated_daily_data(bset) || dated_weekly_data(bset)) {
@@ -583,20 +1467,68 @@ static int *make_selection_array (int nv, int *vlist)
     return sel;
 }
 
-/* Support reading a subset of the series contained in
-   the data file identified by @fname.
+/* Given the string @s specifying a range of observations,
+   determine its 0-based limits in terms of the full dataset
+   described by @gh, and adjust the starting date in @gh to
+   match.
+*/
+
+static int purebin_obs_range (const char *s, gbin_header *gh,
+			      int *t1, int *t2)
+{
+    DATASET *hset = datainfo_new();
+    int err;
+
+    if (hset == NULL) {
+	return E_ALLOC;
+    }
+
+    hset->n = gh->nobs;
+    hset->t2 = gh->nobs - 1;
+    gh_to_bset_transcribe(gh, hset);
+    if (dated_daily_data(hset) || dated_weekly_data(hset)) {
+	strcpy(hset->stobs, "0000-00-00");
+    }
+    ntolabel(hset->stobs, 0, hset);
+    ntolabel(hset->endobs, hset->n - 1, hset);
+
+    err = dataset_obs_range_from_string(s, hset, t1, t2);
+
+    if (!err && *t1 > 0 && dataset_is_time_series(hset)) {
+	/* record the new starting date */
+	char stobs[OBSLEN];
+
+	ntolabel(stobs, *t1, hset);
+	gh->sd0 = get_date_x(hset->pd, stobs);
+    }
+
+    free(hset);
+
+    return err;
+}
+
+/* Support reading a subset of the series contained in the
+   data file identified by @fname, optionally restricted to
+   the range of observations given by @obsrange. Since the
+   numerical payload consists of a fixed-size block of
+   doubles per series, the location of each selected stretch
+   of data can be computed and read directly, and nothing is
+   allocated for the series (or observations) not selected.
 */
 
 int purebin_read_subset (const char *fname, DATASET *dset,
-			 int *vlist, gretlopt opt)
+			 int *vlist, const char *obsrange,
+			 gretlopt opt)
 {
     gbin_header gh = {0};
     FILE *fp = NULL;
     DATASET *bset = NULL;
     int *sel = NULL;
     int i, j, k, nv;
+    int t1 = 0, t2;
+    gint64 offset, slen;
     char c;
-    size_t sz, slen;
+    size_t sz;
     int err;
 
     err = read_purebin_basics(fname, &gh, &fp, NULL);
@@ -605,9 +1537,17 @@ int purebin_read_subset (const char *fname, DATASET *dset,
     }
 
     nv = vlist[0];
+    t2 = gh.nobs - 1;
+
+    if (obsrange != NULL) {
+	err = purebin_obs_range(obsrange, &gh, &t1, &t2);
+	if (err) {
+	    goto bailout;
+	}
+    }
 
     /* allocate dataset */
-    bset = create_new_dataset(nv + 1, gh.nobs, gh.markers);
+    bset = create_new_dataset(nv + 1, t2 - t1 + 1, gh.markers);
     if (bset == NULL) {
 	gretl_errmsg_set("gdtb: create_new_dataset failed");
 	err = E_ALLOC;
@@ -641,24 +1581,49 @@ int purebin_read_subset (const char *fname, DATASET *dset,
 	}
     }
 
-    slen = bset->n * sizeof(double);
+    err = seek_to_payload(&gh, fp);
+    offset = ftell64(fp);
+    slen = (gint64) gh.nobs * sizeof(double);
 
     /* numerical values */
+    if (!err && gh.gbin_version >= GBIN_CHUNKED_VERSION) {
+	/* decompress just the blocks we need */
+	err = read_chunked_payload(bset, &gh, sel, t1, fp, NULL);
+	goto read_tail;
+    }
     for (i=1, k=1; i<gh.nvars && !err; i++) {
 	if (sel[i]) {
-	    sz = fread(bset->Z[k++], sizeof(double), bset->n, fp);
+	    if (fseek64(fp, offset + (i-1) * slen + t1 * sizeof(double),
+			SEEK_SET) == 0) {
+		sz = fread(bset->Z[k++], sizeof(double), bset->n, fp);
+	    } else {
+		sz = 0;
+	    }
 	    if (sz != (size_t) bset->n) {
 		gretl_errmsg_sprintf(_("failed reading variable %d"), i);
 		err = E_DATA;
 	    }
-	} else if (fseek(fp, slen, SEEK_CUR) != 0) {
-	    gretl_errmsg_sprintf(_("failed reading variable %d"), i);
-	    err = E_DATA;
 	}
     }
 
     /* read remaining metadata */
-    err = read_purebin_tail(bset, &gh, sel, fp);
+    if (!err && fseek64(fp, offset + (gh.nvars - 1) * slen, SEEK_SET) != 0) {
+	err = E_DATA;
+    }
+
+ read_tail:
+
+    if (!err) {
+	err = read_purebin_tail(bset, &gh, sel, t1, fp);
+    }
+
+    if (!err) {
+	if (dated_daily_data(bset) || dated_weekly_data(bset)) {
+	    strcpy(bset->stobs, "0000-00-00");
+	}
+	ntolabel(bset->stobs, 0, bset);
+	ntolabel(bset->endobs, bset->n - 1, bset);
+    }
 
     free(sel);
 
@@ -716,15 +1681,33 @@ int purebin_write_data (const char *fname,
 			gretlopt opt)
 {
     gbin_header gh = {0};
-    const char magic[] = "gretl-purebin";
+    gchar *tmpname = NULL;
     FILE *fp;
     double *x;
+    int codec = GBIN_CODEC_NONE;
     int nobs, nv;
     int i, t, vi;
     int err = 0;
 
-    fp = gretl_fopen(fname, "wb");
+    if (opt & OPT_C) {
+	codec = gbin_get_codec(&err);
+	if (err) {
+	    return err;
+	}
+    }
+
+    if (dataset_series_maps_active()) {
+	/* @fname may be mapped into memory as the storage for
+	   series: write to a new file and rename it into place,
+	   so as not to pull the rug out from under the mapping
+	*/
+	tmpname = g_strdup_printf("%s.tmp", fname);
+	fp = gretl_fopen(tmpname, "wb");
+    } else {
+	fp = gretl_fopen(fname, "wb");
+    }
     if (fp == NULL) {
+	g_free(tmpname);
 	return E_FOPEN;
     }
 
@@ -732,7 +1715,13 @@ int purebin_write_data (const char *fname,
     nobs = sample_size(dset);
 
     /* fill out header struct */
-    gh.gbin_version = GBIN_VERSION;
+    if (codec) {
+	gh.gbin_version = GBIN_TYPED_VERSION;
+    } else if (opt & OPT_K) {
+	gh.gbin_version = GBIN_ALIGNED_VERSION;
+    } else {
+	gh.gbin_version = GBIN_VERSION;
+    }
 #if G_BYTE_ORDER == G_BIG_ENDIAN
     gh.bigendian = 1;
 #endif
@@ -756,8 +1745,11 @@ int purebin_write_data (const char *fname,
     gh.panel_sd0 = (float) dset->panel_sd0;
 
     /* write header */
-    fwrite(magic, 1, strlen(magic), fp);
-    fputc(0, fp);
+    if (gh.gbin_version > GBIN_VERSION) {
+	fwrite(GBIN_MAGIC_EXT, 1, GBIN_MAGIC_LEN, fp);
+    } else {
+	fwrite(GBIN_MAGIC, 1, GBIN_MAGIC_LEN, fp);
+    }
     fwrite(&gh, sizeof gh, 1, fp);
 
     /* variable names */
@@ -773,13 +1765,29 @@ int purebin_write_data (const char *fname,
 	varinfo_write(dset, vi, fp);
     }
 
+    /* align the numerical values for mapping */
+    while (gh.gbin_version > GBIN_VERSION &&
+	   ftell(fp) % sizeof(double) != 0) {
+	fputc(0, fp);
+    }
+
     /* numerical values */
-    for (i=1; i<=nv; i++) {
+    if (codec) {
+	err = write_chunked_payload(dset, list, nv, nobs, codec, fp);
+    }
+    for (i=1; i<=nv && !codec; i++) {
 	vi = list != NULL ? list[i] : i;
 	x = dset->Z[vi] + dset->t1;
 	fwrite(x, sizeof *x, nobs, fp);
     }
 
+    if (err) {
+	fclose(fp);
+	gretl_remove(tmpname != NULL ? tmpname : fname);
+	g_free(tmpname);
+	return err;
+    }
+
     /* observation markers? */
     if (dset->S != NULL) {
 	for (t=dset->t1; t<=dset->t2; t++) {
@@ -810,5 +1818,13 @@ int purebin_write_data (const char *fname,
 
     fclose(fp);
 
+    if (tmpname != NULL) {
+	if (gretl_rename(tmpname, fname) != 0) {
+	    gretl_remove(tmpname);
+	    err = E_FOPEN;
+	}
+	g_free(tmpname);
+    }
+
     return err;
 }
@@ -28,9 +28,14 @@
 #include "usermat.h"
 #include "matrix_extra.h"
 #include "libset.h"
+#include "gretl_mt.h"
 
 #include <errno.h>
 
+#ifdef _OPENMP
+# include <omp.h>
+#endif
+
 #define QDEBUG 0
 
 /* Frisch-Newton algorithm: we use this if we're not computing
@@ -83,6 +88,15 @@ extern int rqbr_ (int n,         /* number of observations */
 /* machine precision to the 2/3 */
 #define calc_eps23 (pow(2.22045e-16, 2/3.0))
 
+/* Portnoy-Koenker preprocessing for F-N: the minimum number of
+   observations, the factor applied to the subsample size in setting
+   the width of the band of retained observations, and the maximum
+   number of fixups before the subsample is enlarged
+*/
+#define RQ_PFN_MIN 100000
+#define RQ_PFN_MFAC 0.8
+#define RQ_PFN_FIXUPS 3
+
 /* wrapper struct for use with Barrodale-Roberts */
 
 struct br_info {
@@ -793,6 +807,235 @@ static int rq_call_FN (integer *n, integer *p, gretl_matrix *XT,
 		  rq->callback);
 }
 
+/* Portnoy and Koenker (1997), "The Gaussian hare and the Laplacian
+   tortoise", Statistical Science 12, 279-300; after rq.fit.pfn in
+   the R package quantreg. A preliminary fit on a subsample of size
+   m = ((p+1)n)^{2/3} is used to find the observations whose
+   residuals will almost surely be negative or positive at the
+   solution; these are replaced by two "globbed" observations (sums)
+   and the reduced problem is solved. We then check the signs of
+   the full set of residuals: any observations wrongly globbed are
+   put back and the reduced problem re-solved. The result is the
+   exact solution for the full sample. We use a systematic
+   subsample rather than a random one so as not to disturb the
+   user's RNG state.
+*/
+
+static int rq_fn_preprocess (gretl_matrix *XT, gretl_matrix *y,
+			     struct fn_info *rq, double tau)
+{
+    struct fn_info sub = {0};
+    gretl_matrix *XTs = NULL;
+    gretl_matrix *ys = NULL;
+    gretl_matrix *V = NULL;
+    double *r, *band, *ratio;
+    char *glob = NULL;
+    double *b = rq->coeff;
+    double klo, khi, M;
+    integer n = rq->n;
+    integer p = rq->p;
+    integer ns;
+    int m, i, j, t;
+    int optimal = 0;
+    int err = 0;
+
+    r = malloc(3 * n * sizeof *r);
+    glob = calloc(n, 1);
+    if (r == NULL || glob == NULL) {
+	free(r);
+	free(glob);
+	return E_ALLOC;
+    }
+    band = r + n;
+    ratio = band + n;
+
+    m = (int) round(pow((p + 1.0) * n, 2/3.0));
+
+    while (!optimal && !err) {
+	int nfix = 0;
+
+	if (m >= n / 2) {
+	    /* preprocessing won't pay off */
+	    err = rq_call_FN(&n, &p, XT, y, rq, tau);
+	    break;
+	}
+
+	/* preliminary fit on a systematic subsample */
+	XTs = gretl_matrix_alloc(p, n);
+	ys = gretl_matrix_alloc(n, 1);
+	if (XTs == NULL || ys == NULL) {
+	    err = E_ALLOC;
+	    break;
+	}
+	gretl_matrix_reuse(XTs, p, m);
+	gretl_matrix_reuse(ys, m, 1);
+	for (j=0; j<m; j++) {
+	    t = (int) (((double) j * n) / m);
+	    for (i=0; i<p; i++) {
+		gretl_matrix_set(XTs, i, j, gretl_matrix_get(XT, i, t));
+	    }
+	    ys->val[j] = y->val[t];
+	}
+	ns = m;
+	err = fn_info_alloc(&sub, n, p, tau, OPT_R);
+	if (!err) {
+	    sub.callback = rq->callback;
+	    err = rq_call_FN(&ns, &p, XTs, ys, &sub, tau);
+	}
+	if (!err) {
+	    V = get_XTX_inverse(XTs, &err);
+	}
+	if (err) {
+	    break;
+	}
+
+	/* residuals, scaled by the "bandwidth" of each observation */
+#if defined(_OPENMP)
+#pragma omp parallel for private(i, j) if (gretl_use_openmp((guint64) n * p * p))
+#endif
+	for (t=0; t<n; t++) {
+	    double xi, bt = 0, rt = y->val[t];
+
+	    for (i=0; i<p; i++) {
+		xi = gretl_matrix_get(XT, i, t);
+		rt -= xi * sub.coeff[i];
+		for (j=0; j<p; j++) {
+		    bt += xi * gretl_matrix_get(V, i, j) *
+			gretl_matrix_get(XT, j, t);
+		}
+	    }
+	    r[t] = rt;
+	    band[t] = bt > 0 ? sqrt(bt) : 0;
+	    ratio[t] = rt / (band[t] > 1.0e-6 ? band[t] : 1.0e-6);
+	}
+	gretl_matrix_free(V);
+	V = NULL;
+
+	M = RQ_PFN_MFAC * m;
+	klo = gretl_array_quantile(ratio, n, max(1.0/n, tau - M/(2*n)));
+	khi = gretl_array_quantile(ratio, n, min(tau + M/(2*n), (n-1.0)/n));
+
+	/* mark observations for globbing: 1 = below, 2 = above */
+	for (t=0; t<n; t++) {
+	    if (!na(klo) && r[t] < band[t] * klo) {
+		glob[t] = 1;
+	    } else if (!na(khi) && r[t] > band[t] * khi) {
+		glob[t] = 2;
+	    } else {
+		glob[t] = 0;
+	    }
+	}
+
+	while (nfix < RQ_PFN_FIXUPS && !err) {
+	    int nbad = 0, lo = 0, hi = 0;
+
+	    /* compose the reduced problem */
+	    ns = 0;
+	    for (t=0; t<n; t++) {
+		if (glob[t] == 0) {
+		    for (i=0; i<p; i++) {
+			gretl_matrix_set(XTs, i, ns, gretl_matrix_get(XT, i, t));
+		    }
+		    ys->val[ns++] = y->val[t];
+		} else if (glob[t] == 1) {
+		    lo = 1;
+		} else {
+		    hi = 1;
+		}
+	    }
+	    gretl_matrix_reuse(XTs, p, ns + lo + hi);
+	    gretl_matrix_reuse(ys, ns + lo + hi, 1);
+	    for (j=1; j<=2; j++) {
+		if ((j == 1 && lo) || (j == 2 && hi)) {
+		    double ysum = 0;
+
+		    for (i=0; i<p; i++) {
+			gretl_matrix_set(XTs, i, ns, 0.0);
+		    }
+		    for (t=0; t<n; t++) {
+			if (glob[t] == j) {
+			    for (i=0; i<p; i++) {
+				XTs->val[ns*p+i] += gretl_matrix_get(XT, i, t);
+			    }
+			    ysum += y->val[t];
+			}
+		    }
+		    ys->val[ns++] = ysum;
+		}
+	    }
+
+	    err = rq_call_FN(&ns, &p, XTs, ys, &sub, tau);
+	    if (err) {
+		break;
+	    }
+
+	    /* check the signs of the globbed residuals */
+	    for (t=0; t<n; t++) {
+		double rt = y->val[t];
+
+		for (i=0; i<p; i++) {
+		    rt -= gretl_matrix_get(XT, i, t) * sub.coeff[i];
+		}
+		r[t] = rt;
+		if ((glob[t] == 1 && rt > 0) || (glob[t] == 2 && rt < 0)) {
+		    glob[t] = 0;
+		    nbad++;
+		}
+	    }
+
+	    if (nbad == 0) {
+		optimal = 1;
+	    } else if (nbad > 0.1 * M) {
+		/* too many fixups: try a bigger subsample */
+		break;
+	    } else {
+		nfix++;
+	    }
+	}
+
+	if (optimal) {
+	    /* transcribe the full-sample results */
+	    for (i=0; i<p; i++) {
+		b[i] = sub.coeff[i];
+	    }
+	    for (t=0; t<n; t++) {
+		rq->resid[t] = r[t];
+	    }
+	    rq->info = 0;
+	} else if (!err) {
+	    m *= 2;
+	}
+	gretl_matrix_free(XTs);
+	gretl_matrix_free(ys);
+	XTs = ys = NULL;
+	fn_info_free(&sub);
+	sub.rspace = NULL;
+    }
+
+    gretl_matrix_free(XTs);
+    gretl_matrix_free(ys);
+    gretl_matrix_free(V);
+    fn_info_free(&sub);
+    free(r);
+    free(glob);
+
+    return err;
+}
+
+/* Solve for the coefficients and residuals at @tau, using the
+   Portnoy-Koenker preprocessing if the sample is large */
+
+static int rq_fn_solve (integer *n, integer *p, gretl_matrix *XT,
+			gretl_matrix *y, struct fn_info *rq,
+			double tau)
+{
+    if (*n >= RQ_PFN_MIN && *n == rq->n) {
+	return rq_fn_preprocess(XT, y, rq, tau);
+    } else {
+	return rq_call_FN(n, p, XT, y, rq, tau);
+    }
+}
+
 static int rq_write_variance (const gretl_matrix *V,
 			      MODEL *pmod, double *se)
 {
@@ -962,7 +1205,7 @@ static int rq_fn_nid_VCV (MODEL *pmod, gretl_matrix *y,
 	goto bailout;
     }
 
-    err = rq_call_FN(&n, &p, XT, y, rq, tau + h);
+    err = rq_fn_solve(&n, &p, XT, y, rq, tau + h);
     if (err) {
 	fprintf(stderr, "tau + h: info = %d\n", rq->info);
 	goto bailout;
@@ -973,7 +1216,7 @@ static int rq_fn_nid_VCV (MODEL *pmod, gretl_matrix *y,
 	p1->val[i] = rq->coeff[i];
     }
 
-    err = rq_call_FN(&n, &p, XT, y, rq, tau - h);
+    err = rq_fn_solve(&n, &p, XT, y, rq, tau - h);
     if (err) {
 	fprintf(stderr, "tau - h: info = %d\n", rq->info);
 	goto bailout;
@@ -1105,6 +1348,128 @@ write_tbeta_block_fn (gretl_matrix *tbeta, int nt, double *x,
     return 0;
 }
 
+#if defined(_OPENMP)
+
+/* the number of threads to use for estimation over a set of
+   @ntau quantiles, each requiring work of order @n * @p */
+
+static int rq_tau_threads (int n, int p, int ntau)
+{
+    int nt = gretl_get_omp_threads();
+
+    if (nt < 2 || ntau < 2 ||
+	!gretl_use_openmp((guint64) n * p * ntau)) {
+	return 1;
+    }
+
+    return nt > ntau ? ntau : nt;
+}
+
+#endif
+
+/* With multiple tau values in the robust case, check the
+   Hall-Sheather bandwidths up front: this way we get a
+   proper error message, and no error can arise on this
+   account when the tau values are handled in parallel.
+*/
+
+static int check_hs_bandwidths (const gretl_vector *tauvec,
+				int n, gretlopt opt)
+{
+    int i, err = 0;
+
+    if (opt & OPT_R) {
+	int ntau = gretl_vector_get_length(tauvec);
+
+	for (i=0; i<ntau && !err; i++) {
+	    hs_bandwidth(tauvec->val[i], n, &err);
+	}
+    }
+
+    return err;
+}
+
+/* Barrodale-Roberts estimation with confidence intervals for the
+   @i-th of @ntau values of tau, writing the results into @tbeta
+*/
+
+static int rq_br_multi_tau (gretl_matrix *y, gretl_matrix *X,
+			    const gretl_vector *tauvec, int i,
+			    gretlopt opt, struct br_info *rq,
+			    gretl_matrix *tbeta)
+{
+    int ntau = gretl_vector_get_length(tauvec);
+    double tau = tauvec->val[i];
+    int err;
+
+    rq->tau = tau;
+
+    /* preliminary calculations relating to confidence intervals */
+    if (opt & OPT_R) {
+	err = make_nid_qn(y, X, rq);
+    } else {
+	err = make_iid_qn(X, rq->qn);
+    }
+    if (!err) {
+	err = real_br_calc(y, X, tau, rq, 1);
+    }
+    if (!err) {
+	err = rq_interpolate_intervals(rq);
+    }
+    if (!err) {
+	err = write_tbeta_block_br(tbeta, ntau, rq->coeff, rq->ci, i);
+    }
+
+    return err;
+}
+
+#if defined(_OPENMP)
+
+/* B-R estimation for multiple tau values, in parallel */
+
+static int rq_fit_br_parallel (gretl_matrix *y, gretl_matrix *X,
+			       const gretl_vector *tauvec,
+			       double alpha, gretlopt opt,
+			       gretl_matrix *tbeta, int *warning,
+			       int nt)
+{
+    int ntau = gretl_vector_get_length(tauvec);
+    int n = y->rows;
+    int p = X->cols;
+    int i, err = 0;
+
+#pragma omp parallel num_threads(nt) private(i)
+    {
+	struct br_info rq = {0};
+	int myerr;
+
+	myerr = br_info_alloc(&rq, n, p, tauvec->val[0], alpha, opt);
+	rq.callback = NULL;
+
+#pragma omp for schedule(dynamic, 1)
+	for (i=0; i<ntau; i++) {
+	    if (!myerr) {
+		myerr = rq_br_multi_tau(y, X, tauvec, i, opt, &rq, tbeta);
+	    }
+	}
+
+#pragma omp critical (rq_br_err)
+	{
+	    if (myerr) {
+		err = myerr;
+	    }
+	    if (rq.warning) {
+		*warning = 1;
+	    }
+	}
+	br_info_free(&rq);
+    }
+
+    return err;
+}
+
+#endif
+
 /* Sub-driver for Barrodale-Roberts estimation, with confidence
    intervals.
 */
@@ -1113,12 +1478,14 @@ static int rq_fit_br (gretl_matrix *y, gretl_matrix *X,
 		      const gretl_vector *tauvec, gretlopt opt,
 		      MODEL *pmod)
 {
-    struct br_info rq;
+    struct br_info rq = {0};
     gretl_matrix *tbeta = NULL;
     integer n = y->rows;
     integer p = X->cols;
     double tau, alpha = 0;
+    int warning = 0;
     int i, ntau;
+    int nt = 1;
     int err = 0;
 
     err = get_ci_alpha(&alpha);
@@ -1129,61 +1496,66 @@ static int rq_fit_br (gretl_matrix *y, gretl_matrix *X,
     ntau = gretl_vector_get_length(tauvec);
     tau = gretl_vector_get(tauvec, 0);
 
-    err = br_info_alloc(&rq, n, p, tau, alpha, opt);
-
-    if (!err && ntau > 1) {
+    if (ntau > 1) {
+	err = check_hs_bandwidths(tauvec, n, opt);
+	if (err) {
+	    return err;
+	}
 	tbeta = gretl_zero_matrix_new(p * ntau, 3);
 	if (tbeta == NULL) {
-	    err = E_ALLOC;
+	    return E_ALLOC;
 	}
 #if QDEBUG
 	fprintf(stderr, "p = %d, ntau = %d, alpha = %g\n", p, ntau, alpha);
 	fprintf(stderr, "tbeta = %d x %d\n", tbeta->rows, tbeta->cols);
+#endif
+#if defined(_OPENMP)
+	nt = rq_tau_threads(n, p, ntau);
 #endif
     }
 
-    for (i=0; i<ntau && !err; i++) {
-	tau = rq.tau = gretl_vector_get(tauvec, i);
-
-#if QDEBUG
-	fprintf(stderr, "rq_fit_br: i = %d, tau = %g\n", i, tau);
+    if (nt > 1) {
+#if defined(_OPENMP)
+	err = rq_fit_br_parallel(y, X, tauvec, alpha, opt, tbeta,
+				 &warning, nt);
 #endif
-
-	/* preliminary calculations relating to confidence intervals */
-	if (opt & OPT_R) {
-	    /* robust variant */
-	    err = make_nid_qn(y, X, &rq);
-	} else {
-	    /* assuming iid errors */
-	    err = make_iid_qn(X, rq.qn);
-	}
-
-	if (!err) {
-	    /* get the actual estimates */
-	    err = real_br_calc(y, X, tau, &rq, 1);
-	}
-
-	if (!err) {
-	    /* post-process confidence intervals */
-	    err = rq_interpolate_intervals(&rq);
-	}
-
-	if (!err) {
-	    if (ntau == 1) {
+    } else {
+	err = br_info_alloc(&rq, n, p, tau, alpha, opt);
+	if (ntau > 1) {
+	    for (i=0; i<ntau && !err; i++) {
+		err = rq_br_multi_tau(y, X, tauvec, i, opt, &rq, tbeta);
+	    }
+	} else if (!err) {
+	    /* preliminary calculations relating to confidence intervals */
+	    if (opt & OPT_R) {
+		/* robust variant */
+		err = make_nid_qn(y, X, &rq);
+	    } else {
+		/* assuming iid errors */
+		err = make_iid_qn(X, rq.qn);
+	    }
+	    if (!err) {
+		/* get the actual estimates */
+		err = real_br_calc(y, X, tau, &rq, 1);
+	    }
+	    if (!err) {
+		/* post-process confidence intervals */
+		err = rq_interpolate_intervals(&rq);
+	    }
+	    if (!err) {
 		/* done: put intervals onto the model */
 		err = rq_attach_intervals(pmod, &rq, alpha, opt);
 		if (!err) {
 		    rq_transcribe_results(pmod, y, tau, rq.coeff,
 					  rq.resid, RQ_STAGE_2);
 		}
-	    } else {
-		/* using multiple tau values */
-		err = write_tbeta_block_br(tbeta, ntau, rq.coeff, rq.ci, i);
 	    }
 	}
+	warning = rq.warning;
+	br_info_free(&rq);
     }
 
-    if (!err && rq.warning) {
+    if (!err && warning) {
 	gretl_model_set_int(pmod, "nonunique", 1);
     }
 
@@ -1196,11 +1568,101 @@ static int rq_fit_br (gretl_matrix *y, gretl_matrix *X,
 	}
     }
 
-    br_info_free(&rq);
+    return err;
+}
+
+/* F-N estimation for the @i-th of @ntau values of tau, writing
+   coefficients and standard errors into @tbeta */
+
+static int rq_fn_multi_tau (gretl_matrix *y, gretl_matrix *XT,
+			    const gretl_vector *tauvec, int i,
+			    gretlopt opt, struct fn_info *rq,
+			    double *se, gretl_matrix *tbeta,
+			    MODEL *pmod)
+{
+    integer n = y->rows;
+    integer p = XT->rows;
+    int ntau = gretl_vector_get_length(tauvec);
+    double tau = tauvec->val[i];
+    int err;
+
+#if QDEBUG
+    fprintf(stderr, "rq_fn_multi_tau: i = %d, tau = %g\n", i, tau);
+#endif
+
+    rq->tau = tau;
+    err = rq_fn_solve(&n, &p, XT, y, rq, tau);
+    if (err) {
+	fprintf(stderr, "rqfn gave info = %d\n", rq->info);
+    } else {
+	/* write coeffs for this tau value */
+	write_tbeta_block_fn(tbeta, ntau, rq->coeff, p, i, 0);
+	/* compute covariance matrix */
+	if (opt & OPT_R) {
+	    err = rq_fn_nid_VCV(pmod, y, XT, tau, rq, se);
+	} else {
+	    err = rq_fn_iid_VCV(pmod, y, XT, tau, rq, se);
+	}
+    }
+
+    if (!err) {
+	/* write std errs for this tau */
+	write_tbeta_block_fn(tbeta, ntau, se, p, i, 1);
+    }
 
     return err;
 }
 
+#if defined(_OPENMP)
+
+/* F-N estimation for multiple tau values, in parallel: each
+   thread has its own workspace, and writes its own rows of
+   @tbeta
+*/
+
+static int rq_fit_fn_parallel (gretl_matrix *y, gretl_matrix *XT,
+			       const gretl_vector *tauvec,
+			       gretlopt opt, gretl_matrix *tbeta,
+			       MODEL *pmod, int nt)
+{
+    int ntau = gretl_vector_get_length(tauvec);
+    int n = y->rows;
+    int p = XT->rows;
+    int i, err = 0;
+
+#pragma omp parallel num_threads(nt) private(i)
+    {
+	struct fn_info rq = {0};
+	double *se = malloc(p * sizeof *se);
+	int myerr = fn_info_alloc(&rq, n, p, tauvec->val[0], opt);
+
+	if (!myerr && se == NULL) {
+	    myerr = E_ALLOC;
+	}
+	/* no GUI activity callbacks from worker threads */
+	rq.callback = NULL;
+
+#pragma omp for schedule(dynamic, 1)
+	for (i=0; i<ntau; i++) {
+	    if (!myerr) {
+		myerr = rq_fn_multi_tau(y, XT, tauvec, i, opt, &rq,
+					se, tbeta, pmod);
+	    }
+	}
+
+	if (myerr) {
+#pragma omp critical (rq_fn_err)
+	    err = myerr;
+	}
+	fn_info_free(&rq);
+	free(se);
+    }
+
+    return err;
+}
+
+#endif
+
 /* sub-driver for Frisch-Newton interior point variant */
 
 static int rq_fit_fn (gretl_matrix *y, gretl_matrix *XT,
@@ -1214,61 +1676,64 @@ static int rq_fit_fn (gretl_matrix *y, gretl_matrix *XT,
     integer p = XT->rows;
     double tau;
     int i, ntau;
+    int nt = 1;
     int err = 0;
 
     ntau = gretl_vector_get_length(tauvec);
     tau = gretl_vector_get(tauvec, 0);
 
-    err = fn_info_alloc(&rq, n, p, tau, opt);
-    if (err) {
-	return err;
-    }
-
     if (ntau > 1) {
+	err = check_hs_bandwidths(tauvec, n, opt);
+	if (err) {
+	    return err;
+	}
 	tbeta = gretl_zero_matrix_new(p * ntau, 2);
-	se = malloc(p * sizeof *se);
-	if (tbeta == NULL || se == NULL) {
-	    err = E_ALLOC;
+	if (tbeta == NULL) {
+	    return E_ALLOC;
 	}
+#if defined(_OPENMP)
+	nt = rq_tau_threads(n, p, ntau);
+#endif
     }
 
-    for (i=0; i<ntau && !err; i++) {
-	tau = rq.tau = gretl_vector_get(tauvec, i);
-
-#if QDEBUG
-	fprintf(stderr, "rq_fit_fn: i = %d, tau = %g\n", i, tau);
+    if (nt > 1) {
+#if defined(_OPENMP)
+	err = rq_fit_fn_parallel(y, XT, tauvec, opt, tbeta, pmod, nt);
 #endif
-
-	/* get coefficients and residuals */
-	err = rq_call_FN(&n, &p, XT, y, &rq, tau);
+    } else {
+	err = fn_info_alloc(&rq, n, p, tau, opt);
 	if (err) {
-	    fprintf(stderr, "rqfn gave info = %d\n", rq.info);
+	    gretl_matrix_free(tbeta);
+	    return err;
 	}
-
-	if (!err) {
-	    if (ntau == 1) {
+	if (ntau > 1) {
+	    se = malloc(p * sizeof *se);
+	    if (se == NULL) {
+		err = E_ALLOC;
+	    }
+	    for (i=0; i<ntau && !err; i++) {
+		err = rq_fn_multi_tau(y, XT, tauvec, i, opt, &rq,
+				      se, tbeta, pmod);
+	    }
+	} else {
+	    /* get coefficients and residuals */
+	    err = rq_fn_solve(&n, &p, XT, y, &rq, tau);
+	    if (err) {
+		fprintf(stderr, "rqfn gave info = %d\n", rq.info);
+	    } else {
 		/* save coeffs, residuals, etc., before computing VCV */
 		rq_transcribe_results(pmod, y, tau, rq.coeff, rq.resid,
 				      RQ_STAGE_1);
-	    } else {
-		/* write coeffs for this tau value */
-		write_tbeta_block_fn(tbeta, ntau, rq.coeff, p, i, 0);
-	    }
-	}
-
-	if (!err) {
-	    /* compute covariance matrix */
-	    if (opt & OPT_R) {
-		err = rq_fn_nid_VCV(pmod, y, XT, tau, &rq, se);
-	    } else {
-		err = rq_fn_iid_VCV(pmod, y, XT, tau, &rq, se);
+		/* compute covariance matrix */
+		if (opt & OPT_R) {
+		    err = rq_fn_nid_VCV(pmod, y, XT, tau, &rq, NULL);
+		} else {
+		    err = rq_fn_iid_VCV(pmod, y, XT, tau, &rq, NULL);
+		}
 	    }
 	}
-
-	if (!err && ntau > 1) {
-	    /* write std errs for this tau */
-	    write_tbeta_block_fn(tbeta, ntau, se, p, i, 1);
-	}
+	fn_info_free(&rq);
+	free(se);
     }
 
     if (tbeta != NULL) {
@@ -1280,9 +1745,6 @@ static int rq_fit_fn (gretl_matrix *y, gretl_matrix *XT,
 	}
     }
 
-    fn_info_free(&rq);
-    free(se);
-
     return err;
 }
 
@@ -1512,18 +1974,87 @@ static int *good_observations_array (MODEL *pmod)
 
 /* obtain bootstrap estimates of LAD covariance matrix */
 
+/* Workspace for bootstrap replications on @nt threads: thread 0
+   uses the caller's @y, @X and @rq, the others get their own.
+*/
+
+struct lad_boot_ws {
+    int nt;
+    gretl_matrix **y;
+    gretl_matrix **X;
+    struct br_info *rq;
+};
+
+static void lad_boot_ws_free (struct lad_boot_ws *ws)
+{
+    int i;
+
+    for (i=1; i<ws->nt; i++) {
+	gretl_matrix_free(ws->y[i]);
+	gretl_matrix_free(ws->X[i]);
+	br_info_free(&ws->rq[i]);
+    }
+    free(ws->y);
+    free(ws->X);
+    free(ws->rq);
+}
+
+static int lad_boot_ws_init (struct lad_boot_ws *ws, int nt,
+			     gretl_matrix *y, gretl_matrix *X,
+			     struct br_info *rq)
+{
+    int i, err = 0;
+
+    ws->y = calloc(nt, sizeof *ws->y);
+    ws->X = calloc(nt, sizeof *ws->X);
+    ws->rq = calloc(nt, sizeof *ws->rq);
+    ws->nt = 0;
+
+    if (ws->y == NULL || ws->X == NULL || ws->rq == NULL) {
+	free(ws->y);
+	free(ws->X);
+	free(ws->rq);
+	return E_ALLOC;
+    }
+
+    ws->nt = nt;
+    ws->y[0] = y;
+    ws->X[0] = X;
+    ws->rq[0] = *rq;
+
+    for (i=1; i<nt && !err; i++) {
+	ws->y[i] = gretl_matrix_alloc(y->rows, 1);
+	ws->X[i] = gretl_matrix_alloc(X->rows, X->cols);
+	if (ws->y[i] == NULL || ws->X[i] == NULL) {
+	    err = E_ALLOC;
+	} else {
+	    err = br_info_alloc(&ws->rq[i], X->rows, X->cols,
+				0.5, 0.0, OPT_L);
+	    ws->rq[i].callback = NULL;
+	}
+    }
+
+    if (err) {
+	lad_boot_ws_free(ws);
+    }
+
+    return err;
+}
+
 static int lad_bootstrap_vcv (MODEL *pmod, DATASET *dset,
 			      gretl_matrix *y, gretl_matrix *X,
 			      struct br_info *rq)
 {
+    struct lad_boot_ws ws = {0};
     double **coeffs = NULL;
     double *meanb = NULL;
     int *sample = NULL;
     int *goodobs = NULL;
     double xi, xj;
-    int i, j, k;
+    int i, j, k, b, nb;
     int nc = pmod->ncoeff;
     int nvcv, n = pmod->nobs;
+    int nt = 1;
     int err = 0;
 
     /* note: new_vcv sets all entries to zero */
@@ -1538,8 +2069,18 @@ static int lad_bootstrap_vcv (MODEL *pmod, DATASET *dset,
     /* a scalar for each coefficient mean */
     meanb = malloc(nc * sizeof *meanb);
 
-    /* resampling array of length pmod->nobs */
-    sample = malloc(n * sizeof *sample);
+#if defined(_OPENMP)
+    /* replications are run in batches of @nt, one per thread */
+    if (gretl_use_openmp((guint64) n * nc * ITERS)) {
+	nt = gretl_get_omp_threads();
+    }
+    if (nt > 1 && lad_boot_ws_init(&ws, nt, y, X, rq)) {
+	nt = 1;
+    }
+#endif
+
+    /* resampling arrays of length pmod->nobs */
+    sample = malloc(nt * n * sizeof *sample);
 
     if (coeffs == NULL || meanb == NULL || sample == NULL) {
 	err = E_ALLOC;
@@ -1555,27 +2096,57 @@ static int lad_bootstrap_vcv (MODEL *pmod, DATASET *dset,
 	}
     }
 
-    for (k=0; k<ITERS && !err; k++) {
-	/* create random sample index array */
-	for (i=0; i<n; i++) {
-	    j = gretl_rand_int_max(n);
-	    if (goodobs != NULL) {
-		sample[i] = goodobs[j];
-	    } else {
-		sample[i] = pmod->t1 + j;
+    for (k=0; k<ITERS && !err; k+=nb) {
+	nb = (ITERS - k < nt)? ITERS - k : nt;
+
+	/* create random sample index arrays: these are drawn in
+	   sequence, so the results don't depend on the number of
+	   threads */
+	for (b=0; b<nb; b++) {
+	    int *s = sample + b * n;
+
+	    for (i=0; i<n; i++) {
+		j = gretl_rand_int_max(n);
+		if (goodobs != NULL) {
+		    s[i] = goodobs[j];
+		} else {
+		    s[i] = pmod->t1 + j;
+		}
 	    }
 	}
 
-	rq_refill_matrices(pmod, dset, y, X, sample);
-
-	/* re-estimate LAD model */
-	err = real_br_calc(y, X, 0.5, rq, 0);
+	if (nb == 1) {
+	    rq_refill_matrices(pmod, dset, y, X, sample);
+	    /* re-estimate LAD model */
+	    err = real_br_calc(y, X, 0.5, rq, 0);
+	    if (!err) {
+		for (i=0; i<nc; i++) {
+		    coeffs[i][k] = rq->coeff[i];
+		}
+	    }
+	    continue;
+	}
 
-	if (!err) {
-	    for (i=0; i<nc; i++) {
-		coeffs[i][k] = rq->coeff[i];
+#if defined(_OPENMP)
+#pragma omp parallel for num_threads(nb) private(b, i)
+	for (b=0; b<nb; b++) {
+	    int tid = omp_get_thread_num();
+	    struct br_info *trq = &ws.rq[tid];
+	    int berr;
+
+	    rq_refill_matrices(pmod, dset, ws.y[tid], ws.X[tid],
+			       sample + b * n);
+	    berr = real_br_calc(ws.y[tid], ws.X[tid], 0.5, trq, 0);
+	    if (berr) {
+#pragma omp critical (lad_boot_err)
+		err = berr;
+	    } else {
+		for (i=0; i<nc; i++) {
+		    coeffs[i][k+b] = trq->coeff[i];
+		}
 	    }
 	}
+#endif
     }
 
     /* find means of coeff estimates */
@@ -1611,6 +2182,9 @@ static int lad_bootstrap_vcv (MODEL *pmod, DATASET *dset,
 
  bailout:
 
+    if (ws.nt > 1) {
+	lad_boot_ws_free(&ws);
+    }
     free(sample);
     free(meanb);
     doubles_array_free(coeffs, nc);
@@ -34,6 +34,12 @@
 #include "libgretl.h"
 #include "matrix_extra.h"
 #include "version.h"
+#include "gretl_mt.h"
+#include "libset.h"
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
 
 #ifdef HAVE_MPI
 # include "gretl_mpi.h"
@@ -54,6 +60,8 @@ double admm_abstol;
 
 #define CCD_MAX_ITER 100000
 #define CCD_TOLER_DEFAULT 1.0e-7
+#define CCD_CBLOCK 64
+#define XV_PAR_MAXBYTES (1024 * 1024 * 1024)
 #define BIG_LAMBDA 9.9e35
 
 #define RHO_DEBUG 0
@@ -360,25 +368,29 @@ static int regls_set_Xty (regls_info *ri)
     return err;
 }
 
+/* Shuffle the rows of @X and @y. @X may be NULL, in which case
+   only @y is shuffled, but the same random permutation is used.
+*/
+
 static int randomize_rows (gretl_matrix *X, gretl_matrix *y)
 {
     gretl_vector *vp;
     double x, tmp;
     int i, j, src;
 
-    vp = gretl_matrix_alloc(X->rows, 1);
+    vp = gretl_matrix_alloc(y->rows, 1);
     if (vp == NULL) {
 	return E_ALLOC;
     }
 
-    fill_permutation_vector(vp, X->rows);
+    fill_permutation_vector(vp, y->rows);
 
-    for (i=0; i<X->rows; i++) {
+    for (i=0; i<y->rows; i++) {
 	src = vp->val[i] - 1;
 	if (src == i) {
 	    continue;
 	}
-	for (j=0; j<X->cols; j++) {
+	for (j=0; X != NULL && j<X->cols; j++) {
 	    tmp = gretl_matrix_get(X, i, j);
 	    x = gretl_matrix_get(X, src, j);
 	    gretl_matrix_set(X, i, j, x);
@@ -799,6 +811,9 @@ static int ccd_scale (gretl_matrix *x, double *y,
     for (i=0; i<n; i++) {
 	y[i] *= v;
     }
+#if defined(_OPENMP)
+#pragma omp parallel for private(i, xj) if (gretl_use_openmp((guint64) n * x->cols))
+#endif
     for (j=0; j<x->cols; j++) {
 	xj = x->val + j * n;
 	for (i=0; i<n; i++) {
@@ -853,6 +868,9 @@ static int ccd_iteration (double alpha, const gretl_matrix *X, double *g,
     int j, k, l, m, nlp = 0;
     int nx = X->cols;
     int bad_R2 = 0;
+#if defined(_OPENMP)
+    int par = 0;
+#endif
     int err = 0;
 
 #if 0
@@ -872,14 +890,26 @@ static int ccd_iteration (double alpha, const gretl_matrix *X, double *g,
     fprintf(stderr, "nlp = %d\n", *pnlp);
 #endif
 
-    C = gretl_matrix_alloc(nx, nx);
+    /* @C holds one column per variable in the active set: we start
+       small and add columns as needed, which matters when @nx is
+       large and the solution path is sparse
+    */
+    C = gretl_matrix_alloc(nx, nx < CCD_CBLOCK ? nx : CCD_CBLOCK);
     a = malloc(nx * sizeof *a);
     da = malloc(nx * sizeof *da);
     mm = malloc(nx * sizeof *mm);
     if (C == NULL || a == NULL || da == NULL || mm == NULL) {
 	fprintf(stderr, "ccd: allocation failure (nx = %d)\n", nx);
+	gretl_matrix_free(C);
+	free(a);
+	free(da);
+	free(mm);
 	return E_ALLOC;
     }
+#if defined(_OPENMP)
+    /* thread the computation of new columns of @C? */
+    par = gretl_use_openmp((guint64) X->rows * nx);
+#endif
     /* "zero" @a and @mm */
     for (j=0; j<nx; j++) {
 	a[j] = 0.0;
@@ -889,6 +919,16 @@ static int ccd_iteration (double alpha, const gretl_matrix *X, double *g,
     omb = 1.0 - alpha; /* = 0 for lasso */
 
     for (m=0; m<nlam; m++) {
+#if defined(_OPENMP)
+	if (!omp_in_parallel())
+#endif
+	{
+	    /* not when running folds in parallel */
+	    err = gretl_progress("regls", m, nlam);
+	    if (err) {
+		goto getout;
+	    }
+	}
 	alm = ulam[m];
 	dem = alm*omb;
 	ab = alm*alpha;
@@ -905,6 +945,14 @@ static int ccd_iteration (double alpha, const gretl_matrix *X, double *g,
 		if (a[k] != ak) {
 		    if (mm[k] < 0) {
 			if (nin >= nx) goto check_conv;
+			if (nin == C->cols) {
+			    err = gretl_matrix_realloc(C, nx, nin * 2 < nx ?
+						       nin * 2 : nx);
+			    if (err) goto getout;
+			}
+#if defined(_OPENMP)
+#pragma omp parallel for private(cij) if (par)
+#endif
 			for (j=0; j<nx; j++) {
 			    if (mm[j] >= 0) {
 				cij = gretl_matrix_get(C, k, mm[j]);
@@ -961,6 +1009,9 @@ static int ccd_iteration (double alpha, const gretl_matrix *X, double *g,
 	}
 	if (dlx < thr) {
 	    range_set_sub(da, a, ia, nin, 1);
+#if defined(_OPENMP)
+#pragma omp parallel for if (par && gretl_use_openmp((guint64) nx * nin))
+#endif
 	    for (j=0; j<nx; j++) {
 		if (mm[j] < 0) {
 		    g[j] -= dot_prod_vm(da, C, j, nin);
@@ -2317,74 +2368,85 @@ static int admm_do_fold (regls_info *ri,
     return err;
 }
 
-static int ccd_do_fold (regls_info *ri,
-			gretl_matrix *X,
-			gretl_matrix *y,
-			gretl_matrix *X_out,
-			gretl_matrix *y_out,
-			const gretl_matrix *lam,
-			gretl_matrix *XVC,
-			int fold)
-{
-    static gretl_matrix_block *MB;
-    static gretl_matrix *Xty, *xv;
-    static gretl_matrix *B;
-    static gretl_matrix *u;
-    static gretl_matrix *b;
-    static int *ia, *nnz;
-    int maxit = CCD_MAX_ITER;
-    int nlp = 0, lmu = 0;
-    int nlam, nout;
-    int k, j;
-    int err = 0;
+/* workspace for estimation on a single cross-validation fold */
 
-    if (X == NULL) {
-	/* cleanup signal */
-	gretl_matrix_block_destroy(MB);
-	MB = NULL;
-	free(ia);
-	ia = NULL;
-	return 0;
+typedef struct ccd_fold_ws_ {
+    gretl_matrix_block *MB;
+    gretl_matrix *Xty, *xv;
+    gretl_matrix *B;
+    gretl_matrix *u;
+    gretl_matrix *b;
+    int *ia, *nnz;
+} ccd_fold_ws;
+
+static void ccd_fold_ws_free (ccd_fold_ws *ws)
+{
+    if (ws != NULL) {
+	gretl_matrix_block_destroy(ws->MB);
+	free(ws->ia);
+	free(ws);
     }
+}
 
-    /* dimensions */
-    nlam = gretl_vector_get_length(lam);
-    nout = X_out->rows;
-    k = X->cols;
+static ccd_fold_ws *ccd_fold_ws_new (int k, int nlam, int nout)
+{
+    ccd_fold_ws *ws = calloc(1, sizeof *ws);
 
-    if (MB == NULL) {
-	MB = gretl_matrix_block_new(&xv, k, 1, &Xty, k, 1,
-				    &B, k, nlam, &u, nout, 1,
-				    &b, k, 1, NULL);
-	ia = calloc(k + nlam, sizeof *ia);
-	if (MB == NULL || ia == NULL) {
-	    return E_ALLOC;
+    if (ws != NULL) {
+	ws->MB = gretl_matrix_block_new(&ws->xv, k, 1, &ws->Xty, k, 1,
+					&ws->B, k, nlam, &ws->u, nout, 1,
+					&ws->b, k, 1, NULL);
+	ws->ia = calloc(k + nlam, sizeof *ws->ia);
+	if (ws->MB == NULL || ws->ia == NULL) {
+	    ccd_fold_ws_free(ws);
+	    ws = NULL;
+	} else {
+	    ws->nnz = ws->ia + k;
 	}
-	nnz = ia + k;
     }
-    gretl_matrix_zero(B);
+
+    return ws;
+}
+
+static int ccd_fold_estimate (regls_info *ri,
+			      gretl_matrix *X,
+			      gretl_matrix *y,
+			      const gretl_matrix *X_out,
+			      const gretl_matrix *y_out,
+			      const gretl_matrix *lam,
+			      gretl_matrix *XVC,
+			      int fold,
+			      ccd_fold_ws *ws)
+{
+    int maxit = CCD_MAX_ITER;
+    int nlp = 0, lmu = 0;
+    int nlam = gretl_vector_get_length(lam);
+    int k = X->cols;
+    int j, err;
+
+    gretl_matrix_zero(ws->B);
 
 #if LAMBDA_DEBUG
-    gretl_matrix_print(lam, "lam, in ccd_do_fold");
+    gretl_matrix_print(lam, "lam, in ccd_fold_estimate");
 #endif
 
     /* scale the estimation subset by sqrt(1/n) */
-    ccd_scale(X, y->val, Xty->val, xv->val);
+    ccd_scale(X, y->val, ws->Xty->val, ws->xv->val);
 
-    err = ccd_iteration(ri->alpha, X, Xty->val, nlam, lam->val,
-			ccd_toler, maxit, xv->val, &lmu, B,
-			ia, nnz, NULL, &nlp);
+    err = ccd_iteration(ri->alpha, X, ws->Xty->val, nlam, lam->val,
+			ccd_toler, maxit, ws->xv->val, &lmu, ws->B,
+			ws->ia, ws->nnz, NULL, &nlp);
 
     if (err) {
-	fprintf(stderr, "ccd_do_fold: ccd_iteration returned %d\n", err);
+	fprintf(stderr, "ccd_fold_estimate: ccd_iteration returned %d\n", err);
     } else {
 	/* record out-of-sample criteria */
 	size_t bsize = k * sizeof(double);
 	double score;
 
 	for (j=0; j<nlam; j++) {
-	    memcpy(b->val, B->val + j*k, bsize);
-	    score = xv_score(ri, X_out, y_out, b, u);
+	    memcpy(ws->b->val, ws->B->val + j*k, bsize);
+	    score = xv_score(ri, X_out, y_out, ws->b, ws->u);
 	    gretl_matrix_set(XVC, j, fold, score);
 	}
     }
@@ -2392,6 +2454,36 @@ static int ccd_do_fold (regls_info *ri,
     return err;
 }
 
+static int ccd_do_fold (regls_info *ri,
+			gretl_matrix *X,
+			gretl_matrix *y,
+			gretl_matrix *X_out,
+			gretl_matrix *y_out,
+			const gretl_matrix *lam,
+			gretl_matrix *XVC,
+			int fold)
+{
+    static ccd_fold_ws *ws;
+
+    if (X == NULL) {
+	/* cleanup signal */
+	ccd_fold_ws_free(ws);
+	ws = NULL;
+	return 0;
+    }
+
+    if (ws == NULL) {
+	ws = ccd_fold_ws_new(X->cols, gretl_vector_get_length(lam),
+			     X_out->rows);
+	if (ws == NULL) {
+	    return E_ALLOC;
+	}
+    }
+
+    return ccd_fold_estimate(ri, X, y, X_out, y_out, lam, XVC,
+			     fold, ws);
+}
+
 static int svd_do_fold (regls_info *ri,
 			gretl_matrix *X,
 			gretl_matrix *y,
@@ -2501,6 +2593,90 @@ static void prepare_xv_data (const gretl_matrix *X,
     }
 }
 
+#if defined(_OPENMP)
+
+/* Decide whether to run the CCD cross-validation folds in parallel,
+   and if so on how many threads. Each thread needs its own copy of
+   the fold data, so we do this only if the required storage is
+   moderate; otherwise the folds are handled in sequence, with the
+   threading happening inside ccd_iteration().
+*/
+
+static int ccd_xv_threads (regls_info *ri, int fsize, int csize)
+{
+    int nt = gretl_get_omp_threads();
+    guint64 bytes;
+
+    if (nt < 2 || ri->nf < 2 ||
+	!gretl_use_openmp((guint64) ri->n * ri->k)) {
+	return 0;
+    }
+
+    if (nt > ri->nf) {
+	nt = ri->nf;
+    }
+    bytes = (guint64) (csize + fsize) * (ri->k + 1);
+    bytes += (guint64) ri->k * (ri->nlam + 3);
+    bytes *= nt * sizeof(double);
+
+    return bytes > XV_PAR_MAXBYTES ? 0 : nt;
+}
+
+/* Run the CCD folds in parallel: each thread handles whole folds,
+   with a private copy of the fold data and its own workspace. The
+   folds share the lambda sequence, and each column of @XVC is
+   written by one thread only.
+*/
+
+static int ccd_xv_parallel (regls_info *ri,
+			    const gretl_matrix *lam,
+			    gretl_matrix *XVC,
+			    int fsize, int csize,
+			    int nt)
+{
+    int f, err = 0;
+
+#pragma omp parallel num_threads(nt) private(f)
+    {
+	gretl_matrix_block *XY;
+	gretl_matrix *Xe, *Xf;
+	gretl_matrix *ye, *yf;
+	ccd_fold_ws *ws = NULL;
+	int myerr = 0;
+
+	XY = gretl_matrix_block_new(&Xe, csize, ri->k,
+				    &Xf, fsize, ri->k,
+				    &ye, csize, 1,
+				    &yf, fsize, 1, NULL);
+	if (XY != NULL) {
+	    ws = ccd_fold_ws_new(ri->k, ri->nlam, fsize);
+	}
+	if (ws == NULL) {
+	    myerr = E_ALLOC;
+	}
+
+#pragma omp for schedule(dynamic, 1)
+	for (f=0; f<ri->nf; f++) {
+	    if (!myerr) {
+		prepare_xv_data(ri->X, ri->y, Xe, ye, Xf, yf, f);
+		myerr = ccd_fold_estimate(ri, Xe, ye, Xf, yf, lam,
+					  XVC, f, ws);
+	    }
+	}
+
+	if (myerr) {
+#pragma omp critical (regls_xv_err)
+	    err = myerr;
+	}
+	ccd_fold_ws_free(ws);
+	gretl_matrix_block_destroy(XY);
+    }
+
+    return err;
+}
+
+#endif /* _OPENMP */
+
 /* Given @XVC holding criterion values per lambda (rows) and per fold
    (columns), compose a matrix holding the means, plus standard errors
    if wanted.
@@ -2697,13 +2873,14 @@ static gretl_matrix *make_xv_lambda (regls_info *ri,
 static int regls_xv (regls_info *ri)
 {
     PRN *prn = ri->prn;
-    gretl_matrix_block *XY;
+    gretl_matrix_block *XY = NULL;
     gretl_matrix *Xe, *Xf;
     gretl_matrix *ye, *yf;
     gretl_matrix *lam = NULL;
     gretl_matrix *XVC = NULL;
     double lmax;
     int f, fsize, csize;
+    int nt = 0;
     int err = 0;
 
     /* the size of each fold */
@@ -2718,12 +2895,20 @@ static int regls_xv (regls_info *ri)
 	gretl_flush(prn);
     }
 
-    XY = gretl_matrix_block_new(&Xe, csize, ri->k,
-				&Xf, fsize, ri->k,
-				&ye, csize, 1,
-				&yf, fsize, 1, NULL);
-    if (XY == NULL) {
-	return E_ALLOC;
+#if defined(_OPENMP)
+    if (ri->ccd) {
+	nt = ccd_xv_threads(ri, fsize, csize);
+    }
+#endif
+
+    if (nt == 0) {
+	XY = gretl_matrix_block_new(&Xe, csize, ri->k,
+				    &Xf, fsize, ri->k,
+				    &ye, csize, 1,
+				    &yf, fsize, 1, NULL);
+	if (XY == NULL) {
+	    return E_ALLOC;
+	}
     }
 
     lmax = get_xvalidation_lmax(ri, csize);
@@ -2748,7 +2933,21 @@ static int regls_xv (regls_info *ri)
 	}
     }
 
-    for (f=0; f<ri->nf && !err; f++) {
+#if defined(_OPENMP)
+    if (!err && nt > 0) {
+	if (ri->verbose) {
+	    pprintf(prn, "regls_xv: running folds on %d threads\n", nt);
+	    gretl_flush(prn);
+	}
+	err = ccd_xv_parallel(ri, lam, XVC, fsize, csize, nt);
+    }
+#endif
+
+    for (f=0; f<ri->nf && nt == 0 && !err; f++) {
+	err = gretl_progress("regls folds", f, ri->nf);
+	if (err) {
+	    break;
+	}
 	prepare_xv_data(ri->X, ri->y, Xe, ye, Xf, yf, f);
 	if (ri->ccd) {
 	    err = ccd_do_fold(ri, Xe, ye, Xf, yf, lam, XVC, f);
@@ -2848,7 +3047,16 @@ static int real_regls_xv_mpi (regls_info *ri)
 	}
 	gretl_mpi_bcast(&seed, GRETL_TYPE_UINT64, 0);
 	gretl_rand_set_seed(seed);
-	randomize_rows(ri->X, ri->y);
+	if (gretl_matrix_mpi_node_shared(ri->X)) {
+	    /* X is shared on the node: just one process should
+	       permute its rows, but all must permute y */
+	    int leader = gretl_mpi_node_rank() == 0;
+
+	    randomize_rows(leader ? ri->X : NULL, ri->y);
+	    gretl_matrix_mpi_node_sync(ri->X);
+	} else {
+	    randomize_rows(ri->X, ri->y);
+	}
     }
 
     /* The matrix @XVC will be used to store the cross-validation
@@ -3022,13 +3230,23 @@ int regls_xv_mpi (PRN *prn)
 {
     regls_info *ri = NULL;
     gretl_bundle *bun = NULL;
+    gretl_matrix *X0 = NULL;
     gretl_matrix *X;
-    gretl_matrix *y;
+    gretl_matrix *y = NULL;
     int err = 0;
 
-    /* read matrices deposited by parent process */
-    X = gretl_matrix_read_from_file("regls_X.bin", 1, &err);
-    y = gretl_matrix_read_from_file("regls_y.bin", 1, &err);
+    /* Read matrices deposited by parent process. Since X is not
+       modified during cross validation, only one process per node
+       reads it, and it's shared on the node if possible.
+    */
+    if (gretl_mpi_node_rank() == 0) {
+	X0 = gretl_matrix_read_from_file("regls_X.bin", 1, &err);
+    }
+    X = gretl_matrix_mpi_node_share(X0, &err);
+    gretl_matrix_free(X0);
+    if (!err) {
+	y = gretl_matrix_read_from_file("regls_y.bin", 1, &err);
+    }
 
     if (!err) {
 	bun = gretl_bundle_read_from_file("regls_bun.xml", 1, &err);
@@ -3049,7 +3267,7 @@ int regls_xv_mpi (PRN *prn)
 	}
     }
 
-    gretl_matrix_free(X);
+    gretl_matrix_mpi_node_free(X);
     gretl_matrix_free(y);
     gretl_bundle_destroy(bun);
     regls_info_free(ri);
@@ -57,13 +57,18 @@ struct reprob_container_ {
     gretl_matrix *ndx;       /* index function */
     gretl_matrix *nodes;     /* Gauss-Hermite quadrature nodes */
     gretl_matrix *wts;       /* Gauss-Hermite quadrature weights */
+    gretl_matrix *U;         /* adapted nodes (by individual and qpoints) */
+    gretl_matrix *W;         /* adapted weights (ditto) */
     gretl_matrix *P;         /* probabilities (by individual and qpoints) */
     gretl_matrix *lik;       /* probabilities (by individual) */
     gretl_vector *beta;      /* parameters (excluding log of variance 
 				of individual effect) */
-    gretl_matrix *qi;        /* storage for score caculation */
+    double *mu;              /* modes of the individual effects */
 };
 
+#define REP_MODE_MAXIT 50
+#define REP_MODE_TOL 1.0e-9
+
 reprob_container *rep_container_new (const int *list)
 {
     reprob_container *C = malloc(sizeof *C);
@@ -76,7 +81,7 @@ reprob_container *rep_container_new (const int *list)
 	C->N = 0;
 	C->nobs = 0;
 	C->parallel = 0;
-	C->qi = NULL;
+	C->mu = NULL;
 
 	C->unit_obs = NULL;
 	C->unit_start = NULL;
@@ -98,7 +103,7 @@ static void rep_container_destroy (reprob_container *C)
 	gretl_matrix_free(C->X);
 	gretl_matrix_free(C->R);
 	gretl_matrix_block_destroy(C->B);
-	gretl_matrix_free(C->qi);
+	free(C->mu);
 	free(C);
     }
 }
@@ -241,8 +246,9 @@ static int rep_container_fill (reprob_container *C,
     C->y = malloc(C->nobs * sizeof *C->y);
     C->X = gretl_matrix_alloc(C->nobs, k);
     C->R = gretl_matrix_alloc(C->nobs, C->qp);
+    C->mu = calloc(C->N, sizeof *C->mu);
 
-    if (C->y == NULL || C->X == NULL || C->R == NULL) {
+    if (C->y == NULL || C->X == NULL || C->R == NULL || C->mu == NULL) {
 	return E_ALLOC;
     }
 
@@ -252,6 +258,8 @@ static int rep_container_fill (reprob_container *C,
     }
 
     C->B = gretl_matrix_block_new(&C->ndx, C->nobs, 1,
+				  &C->U, C->N, C->qp,
+				  &C->W, C->N, C->qp,
 				  &C->P, C->N, C->qp,
 				  &C->lik, C->N, 1,
 				  &C->beta, k, 1,
@@ -297,13 +305,6 @@ static int rep_container_fill (reprob_container *C,
     }
 #endif
 
-    if (!C->parallel) {
-	C->qi = gretl_matrix_alloc(1, C->qp);
-	if (C->qi == NULL) {
-	    err = E_ALLOC;
-	}
-    }
-
     return err;
 }
 
@@ -320,34 +321,86 @@ static void update_ndx (reprob_container *C, const double *theta)
     C->scale = exp(theta[C->npar-1]/2.0);
 }
 
-static double quick_dot_product (const double *x,
-				 const double *y,
-				 int n)
-{
-    double ret = 0.0;
-    int i;
+/* Adaptive quadrature (Liu and Pierce, 1994): the nodes for unit
+   @i are centred on the mode of the integrand, taken as a function
+   of the standardized individual effect u, and scaled by the
+   curvature of its log at the mode. Since the integrand then
+   looks much like the normal density on which the quadrature
+   rule is based, few nodes give an accurate approximation.
+   Newton's method converges quickly here as the log of the
+   integrand is strictly concave; we start from the mode found
+   on the previous call.
+*/
 
-    for (i=0; i<n; i++) {
-	ret += x[i] * y[i];
+static void reprobit_adapt_unit (reprob_container *C, int i)
+{
+    int Ti = C->unit_obs[i];
+    int t0 = C->unit_start[i];
+    double sigma = C->scale;
+    double u = C->mu[i];
+    double g, h, x, lam, step;
+    double tau, z, uij;
+    int sign, iter, j, t;
+
+    for (iter=0; ; iter++) {
+	g = -u;
+	h = -1.0;
+	for (t=0; t<Ti; t++) {
+	    sign = C->y[t0+t] ? 1 : -1;
+	    x = sign * (C->ndx->val[t0+t] + sigma * u);
+	    lam = invmills(-x);
+	    g += sign * sigma * lam;
+	    h -= sigma * sigma * lam * (x + lam);
+	}
+	step = g / h;
+	if (fabs(step) < REP_MODE_TOL || iter == REP_MODE_MAXIT) {
+	    break;
+	}
+	u -= step;
     }
 
-    return ret;
+    C->mu[i] = u;
+    tau = 1.0 / sqrt(-h);
+
+    for (j=0; j<C->qp; j++) {
+	z = C->nodes->val[j];
+	uij = u + tau * z;
+	gretl_matrix_set(C->U, i, j, uij);
+	gretl_matrix_set(C->W, i, j, C->wts->val[j] * tau *
+			 exp((z*z - uij*uij) / 2.0));
+    }
 }
 
+/* Note: the score is computed using the nodes and weights set
+   on the last call to reprobit_ll(), that is, as the derivative
+   of the quadrature approximation with the nodes held fixed.
+*/
+
 static int reprobit_score (double *theta, double *g, int npar, 
 			   BFGS_CRIT_FUNC ll, void *p)
 {
     reprob_container *C = (reprob_container *) p;
     gretl_matrix *Q = C->P; /* re-use existing storage */
-    const double *nodes = C->nodes->val;
+    double *wspace;
     int i, j, k, t;
-    int done = 0;
-    int err = 0;
+    int nt = 1;
 
     k = C->npar - 1;
     update_ndx(C, theta);
 
-    /* form the Q and R matrices */
+#if defined(_OPENMP)
+    if (C->parallel) {
+	nt = gretl_get_omp_threads();
+    }
+#endif
+
+    /* per-thread workspace: qi, plus a partial gradient */
+    wspace = calloc(nt * (C->qp + C->npar), sizeof *wspace);
+    if (wspace == NULL) {
+	return E_ALLOC;
+    }
+
+    /* form the Q and R matrices, and the likelihood per unit */
 
 #if defined(_OPENMP)
 #pragma omp parallel for private(i, j, t) if (C->parallel)
@@ -356,10 +409,11 @@ static int reprobit_score (double *theta, double *g, int npar,
 	int Ti = C->unit_obs[i];
 	int t0 = C->unit_start[i];
 	double x, qij, node, ndxi;
+	double li = 0.0;
 	int sign;
 
 	for (j=0; j<C->qp; j++) {
-	    node = C->scale * nodes[j];
+	    node = C->scale * gretl_matrix_get(C->U, i, j);
 	    qij = 1.0;
 	    for (t=0; t<Ti; t++) {
 		ndxi = C->ndx->val[t0+t];
@@ -370,76 +424,29 @@ static int reprobit_score (double *theta, double *g, int npar,
 		gretl_matrix_set(C->R, t0+t, j, x);
 	    }
 	    gretl_matrix_set(Q, i, j, qij);
+	    li += qij * gretl_matrix_get(C->W, i, j);
 	}
+	C->lik->val[i] = li;
     }
 
-    gretl_matrix_multiply(Q, C->wts, C->lik);
-
-    for (i=0; i<C->npar; i++) {
-	g[i] = 0.0;
-    }
+    /* each thread cumulates its own share of the gradient */
 
 #if defined(_OPENMP)
-    if (C->parallel) {
-	double *qi, *all_qi = NULL;
-	
-#pragma omp parallel private(i, j, t, qi)
-	{
-	    int nt = omp_get_num_threads();
-	    int tid = omp_get_thread_num();
-
-	    if (tid == 0) {
-		/* master: allocate workspace for all */
-		all_qi = malloc(nt * C->qp * sizeof *all_qi);
-		if (all_qi == NULL) {
-		    err = E_ALLOC;
-		}
-	    }
+#pragma omp parallel private(i, j, t) num_threads(nt) if (C->parallel)
+#endif
+    {
+	int tid = 0;
+	double *qi, *gi;
 
-#pragma omp barrier	    
-	    qi = err ? NULL : all_qi + tid * C->qp;
+#if defined(_OPENMP)
+	tid = omp_get_thread_num();
+#endif
+	qi = wspace + tid * (C->qp + C->npar);
+	gi = qi + C->qp;
 
+#if defined(_OPENMP)
 #pragma omp for
-	    for (i=0; i<C->N; i++) {
-		int ii, Ti = C->unit_obs[i];
-		int t0 = C->unit_start[i];
-		double x, qij, rtj;
-
-		if (qi == NULL) {
-		    continue;
-		}
-
-		for (ii=0; ii<=k; ii++) {
-		    for (j=0; j<C->qp; j++) {
-			x = qi[j] = 0.0;
-			qij = gretl_matrix_get(Q, i, j);
-			if (ii == k) {
-			    x = C->scale * nodes[j];
-			}
-			for (t=0; t<Ti; t++) {
-			    if (ii < k) {
-				x = gretl_matrix_get(C->X, t0+t, ii);
-			    }
-			    rtj = gretl_matrix_get(C->R, t0+t, j);
-			    qi[j] += x * rtj * qij;
-			}
-			qi[j] /= C->lik->val[i];
-		    }
-		    x = quick_dot_product(qi, C->wts->val, C->qp);
-#pragma omp atomic		
-		    g[ii] += x;
-		}
-	    }
-	}
-	free(all_qi);
-	done = 1;
-    }
-#endif /* _OPENMP */
-
-    if (!done) {
-	/* single-threaded variant */
-	double *qi = C->qi->val;
-	
+#endif
 	for (i=0; i<C->N; i++) {
 	    int ii, Ti = C->unit_obs[i];
 	    int t0 = C->unit_start[i];
@@ -450,7 +457,7 @@ static int reprobit_score (double *theta, double *g, int npar,
 		    x = qi[j] = 0.0;
 		    qij = gretl_matrix_get(Q, i, j);
 		    if (ii == k) {
-			x = C->scale * nodes[j];
+			x = C->scale * gretl_matrix_get(C->U, i, j);
 		    }
 		    for (t=0; t<Ti; t++) {
 			if (ii < k) {
@@ -459,16 +466,30 @@ static int reprobit_score (double *theta, double *g, int npar,
 			rtj = gretl_matrix_get(C->R, t0+t, j);
 			qi[j] += x * rtj * qij;
 		    }
-		    qi[j] /= C->lik->val[i];
+		    qi[j] *= gretl_matrix_get(C->W, i, j);
+		}
+		x = 0.0;
+		for (j=0; j<C->qp; j++) {
+		    x += qi[j];
 		}
-		g[ii] += quick_dot_product(qi, C->wts->val, C->qp);
+		gi[ii] += x / C->lik->val[i];
 	    }
 	}
     }
 
+    /* sum the partial gradients */
+    for (i=0; i<C->npar; i++) {
+	g[i] = 0.0;
+	for (j=0; j<nt; j++) {
+	    g[i] += wspace[j * (C->qp + C->npar) + C->qp + i];
+	}
+    }
+
     g[k] /= 2;
+
+    free(wspace);
     
-    return err;
+    return 0;
 }
 
 static double reprobit_ll (const double *theta, void *p)
@@ -476,7 +497,6 @@ static double reprobit_ll (const double *theta, void *p)
     reprob_container *C = (reprob_container *) p;
     double x, pij, node;
     int i, j, t;
-    int err = 0;
 
     if (theta[C->npar-1] < -9.0) {
 	fprintf(stderr, "reprobit_ll: scale too small\n");
@@ -492,9 +512,12 @@ static double reprobit_ll (const double *theta, void *p)
     for (i=0; i<C->N; i++) {
 	int Ti = C->unit_obs[i];
 	int t0 = C->unit_start[i];
+	double li = 0.0;
+
+	reprobit_adapt_unit(C, i);
 
 	for (j=0; j<C->qp; j++) {
-	    node = gretl_vector_get(C->nodes, j);
+	    node = gretl_matrix_get(C->U, i, j);
 	    pij = 1.0;
 	    for (t=0; t<Ti; t++) {
 		x = C->ndx->val[t0+t] + C->scale * node;
@@ -505,11 +528,11 @@ static double reprobit_ll (const double *theta, void *p)
 		}
 	    }
 	    gretl_matrix_set(C->P, i, j, pij);
+	    li += pij * gretl_matrix_get(C->W, i, j);
 	}
+	C->lik->val[i] = li;
     }
 
-    err = gretl_matrix_multiply(C->P, C->wts, C->lik);
-
 #if 0
     if (1) {
 	/* for analysing the behavior of f(x) */
@@ -522,13 +545,9 @@ static double reprobit_ll (const double *theta, void *p)
     }
 #endif
 
-    if (!err) {
-	C->ll = 0.0;
-	for (i=0; i<C->N; i++) {
-	    C->ll += log(C->lik->val[i]);
-	}
-    } else {
-	C->ll = NADBL;
+    C->ll = 0.0;
+    for (i=0; i<C->N; i++) {
+	C->ll += log(C->lik->val[i]);
     }
 
     return C->ll;
@@ -673,7 +692,7 @@ MODEL reprobit_estimate (const int *list, DATASET *dset,
 	/* do the actual reprobit stuff */
 	reprob_container *C;
 	double *theta = NULL;
-	int quadpoints = 32;
+	int quadpoints = 12;
 	int maxit = libset_get_int(BFGS_MAXITER);
 	int fcount = 0;
 	gretlopt maxopt;
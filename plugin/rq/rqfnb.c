@@ -98,11 +98,11 @@ static int lpfnb_ (integer *n, integer *p, double *a, double *c__,
     integer a_dim1 = *p, ada_dim1 = *p;
     integer a_offset = 1 + a_dim1, ada_offset = 1 + ada_dim1;
     double d1, d2;
-    static double g;
-    static integer i;
-    static double mu, gap;
-    static double dsdw, dxdz;
-    static double deltad, deltap;
+    double g;
+    integer i;
+    double mu, gap;
+    double dsdw, dxdz;
+    double deltad, deltap;
     int main_iters = 0;
     int err = 0;
 
@@ -399,9 +399,12 @@ static int get_nobs (FILE *fp, struct SAS_fileinfo *finfo)
 		    finfo->maxclen = finfo->vars[i].size;
 		}
 	    }
-	    finfo->obsize += vsize;
 	}
 
+	/* the values are packed end to end, at the offsets
+	   given by their NAMESTR records */
+	finfo->obsize = finfo->maxvsize;
+
 	fprintf(stderr, "max length of character data = %d\n", finfo->maxclen);
 	finfo->nobs = bytes / finfo->obsize;
 	fprintf(stderr, "nobs = %d/%d = %d?\n", bytes, finfo->obsize, 
@@ -411,14 +414,38 @@ static int get_nobs (FILE *fp, struct SAS_fileinfo *finfo)
     return (finfo->nobs == 0)? E_DATA : 0;
 }
 
+#define XPT_BLOCK_BYTES (4 * 1024 * 1024) /* target size of obs blocks */
+
+/* check for an observation record consisting entirely of blanks,
+   as used to pad out the last 80-byte record of the file */
+
+static int xpt_blank_record (const char *rec, int size)
+{
+    int i;
+
+    for (i=0; i<size; i++) {
+	if (rec[i] != ' ') {
+	    return 0;
+	}
+    }
+
+    return 1;
+}
+
+/* Observations are read in blocks of roughly XPT_BLOCK_BYTES
+   and each block is decoded one variable at a time: numeric
+   columns (IBM to IEEE conversion) in parallel, character
+   columns serially since they share the string table.
+*/
+
 static int SAS_read_data (FILE *fp, struct SAS_fileinfo *finfo,
-			  DATASET *dset, gretl_string_table *st, 
+			  DATASET *dset, gretl_string_table *st,
 			  PRN *prn)
 {
     char *buf = NULL, *cbuf = NULL;
-    char c8[8];
-    double x;
-    int pos, vsize, i, t;
+    int obsize = finfo->obsize;
+    int nblock, nb, got;
+    int i, t;
 
     if (finfo->maxclen > 0) {
 	cbuf = malloc(finfo->maxclen + 1);
@@ -427,7 +454,14 @@ static int SAS_read_data (FILE *fp, struct SAS_fileinfo *finfo,
 	}
     }
 
-    buf = malloc(finfo->maxvsize);
+    nblock = XPT_BLOCK_BYTES / obsize;
+    if (nblock < 1) {
+	nblock = 1;
+    } else if (nblock > finfo->nobs) {
+	nblock = finfo->nobs;
+    }
+
+    buf = malloc((size_t) nblock * obsize);
     if (buf == NULL) {
 	free(cbuf);
 	return E_ALLOC;
@@ -438,30 +472,61 @@ static int SAS_read_data (FILE *fp, struct SAS_fileinfo *finfo,
 	series_set_label(dset, i+1, finfo->vars[i].label);
     }
 
-    for (t=0; t<finfo->nobs; t++) {
-	for (i=0; i<finfo->nvars; i++) {
-	    pos = finfo->vars[i].pos;
-	    vsize = pos + finfo->vars[i].size;
-	    if (fread(buf, 1, vsize, fp) != vsize) {
-		break;
+    for (t=0; t<finfo->nobs; t+=got) {
+	nb = finfo->nobs - t;
+	if (nb > nblock) {
+	    nb = nblock;
+	}
+	got = fread(buf, obsize, nb, fp);
+	if (t + got == finfo->nobs) {
+	    /* don't take trailing padding for data */
+	    while (got > 0 && xpt_blank_record(buf + (got-1) * obsize, obsize)) {
+		got--;
 	    }
+	}
+	if (got == 0) {
+	    break;
+	}
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) got * finfo->nvars))
+#endif
+	for (i=0; i<finfo->nvars; i++) {
 	    if (finfo->vars[i].type == XPT_NUMERIC) {
-		memcpy(c8, buf + pos, 8);
-		x = read_xpt(c8);
-		dset->Z[i+1][t] = x;
-	    } else if (st != NULL) {
+		const char *src = buf + finfo->vars[i].pos;
+		double *x = dset->Z[i+1] + t;
+		int b;
+
+		for (b=0; b<got; b++) {
+		    x[b] = read_xpt(src + b * obsize);
+		}
+	    }
+	}
+
+	for (i=0; i<finfo->nvars && st != NULL; i++) {
+	    if (finfo->vars[i].type != XPT_NUMERIC) {
 		/* character data */
-		*cbuf = '\0';
-		strncat(cbuf, buf + pos, finfo->vars[i].size);
-		tailstrip(cbuf);
-		if (*cbuf) {
-		    dset->Z[i+1][t] = gretl_string_table_index(st, cbuf, i+1, 
-							       1, prn);
-		} else {
-		    dset->Z[i+1][t] = 0.0;
+		const char *src = buf + finfo->vars[i].pos;
+		double *x = dset->Z[i+1] + t;
+		int b;
+
+		for (b=0; b<got; b++) {
+		    *cbuf = '\0';
+		    strncat(cbuf, src + b * obsize, finfo->vars[i].size);
+		    tailstrip(cbuf);
+		    if (*cbuf) {
+			x[b] = gretl_string_table_index(st, cbuf, i+1, 1, prn);
+		    } else {
+			x[b] = 0.0;
+		    }
 		}
 	    }
 	}
+
+	if (got < nb) {
+	    t += got;
+	    break;
+	}
     }
 
     if (t > 0) {
@@ -670,6 +735,12 @@ int xport_get_data (const char *fname, DATASET *dset,
 	err = SAS_read_data(fp, &finfo, newset, st, prn);
     }
 
+    if (!err && finfo.nobs_read > 0 && finfo.nobs_read < newset->n) {
+	/* drop rows that turned out to be padding */
+	newset->t2 = finfo.nobs_read - 1;
+	err = dataset_shrink_obs_range(newset);
+    }
+
     if (err) {
 	destroy_dataset(newset);
 	if (st != NULL) {
@@ -55,6 +55,8 @@ enum {
 };
 
 #define MAX_SHORT_STRING 8
+#define SAV_BUFLEN 8192  /* doubles per read of compressed data */
+#define SAV_BLOCK_BYTES (4 * 1024 * 1024) /* target size of case blocks */
 #define SYSMIS (-DBL_MAX)
 #define MAX_CASESIZE (INT_MAX / sizeof(double) / 2)
 #define MAX_CASES (INT_MAX / 2)
@@ -134,6 +136,11 @@ struct sav_extension {
     double *ptr; /* current location in buffer */
     double *end; /* end of buffer marker */
 
+    /* values represented by compression codes 1 to 251, plus
+       255 (system-missing), in file byte order */
+    double codes[256];
+    int codes_ok;
+
     /* compression instruction octet and pointer */
     unsigned char x[sizeof(double)];
     unsigned char *y;
@@ -1430,7 +1437,7 @@ static int buffer_input (struct sav_extension *ext, FILE *fp)
 {
     size_t amt;
 
-    amt = fread(ext->buf, sizeof *ext->buf, 128, fp);
+    amt = fread(ext->buf, sizeof *ext->buf, SAV_BUFLEN, fp);
 
     if (ferror(fp)) {
 	sav_error("Error reading file: %s", strerror(errno));
@@ -1456,12 +1463,29 @@ static int read_compressed_data (spss_data *sdat, struct sysfile_header *hdr,
     int err = 0, done = 0;
 
     if (ext->buf == NULL) {
-	ext->buf = malloc(128 * sizeof *ext->buf);
+	ext->buf = malloc(SAV_BUFLEN * sizeof *ext->buf);
 	if (ext->buf == NULL) {
 	    return E_ALLOC;
 	}
     }
 
+    if (!ext->codes_ok) {
+	/* Codes 1 through 251 inclusive indicate a value of
+	   (BYTE - BIAS), where BYTE is the byte's value and
+	   BIAS is the compression bias (generally 100.0);
+	   code 255 denotes the system-missing value
+	*/
+	int i;
+
+	for (i=0; i<256; i++) {
+	    ext->codes[i] = (i == 255)? ext->sysmis : i - hdr->bias;
+	    if (sdat->swapends) {
+		reverse_double(ext->codes[i]);
+	    }
+	}
+	ext->codes_ok = 1;
+    }
+
     while (!err) {
 	for (; p < p_end && !err; p++) {
 	    switch (*p) {
@@ -1489,24 +1513,10 @@ static int read_compressed_data (spss_data *sdat, struct sysfile_header *hdr,
 		/* Code 254: a string that is all blanks */
 		memset(tmp++, ' ', sizeof *tmp);
 		break;
-	    case 255:
-		/* Code 255: denotes the system-missing value */
-		*tmp = ext->sysmis;
-		if (sdat->swapends) {
-		    reverse_double(*tmp);
-		}
-		tmp++;
-		break;
 	    default:
-		/* Codes 1 through 251 inclusive indicate a value of
-		   (BYTE - BIAS), where BYTE is the byte's value and
-		   BIAS is the compression bias (generally 100.0)
-		*/
-		*tmp = *p - hdr->bias;
-		if (sdat->swapends) {
-		    reverse_double(*tmp);
-		}
-		tmp++;
+		/* Codes 1 through 251: compressed numeric value;
+		   code 255: system-missing value (see above) */
+		*tmp++ = ext->codes[*p];
 		break;
 	    }
 
@@ -1556,80 +1566,99 @@ static int value_is_missing (spss_data *sdat, spss_var *v, double x)
     }
 }
 
-/* Read values for all variables at observation t */
+/* Read up to @nb complete cases into @tmp (which has room for
+   @nb * sdat->nvars values), writing the number actually read
+   into @got.
+*/
 
-static int sav_read_observation (spss_data *sdat,
-				 struct sysfile_header *hdr,
-				 double *tmp,
-				 DATASET *dset,
-				 int t)
+static int sav_read_block (spss_data *sdat,
+			   struct sysfile_header *hdr,
+			   double *tmp, int nb, int *got)
 {
-    spss_var *v;
-    double xit;
-    int i, j, err = 0;
+    int b, err = 0;
+
+    *got = 0;
 
     if (hdr->compressed) {
-	err = read_compressed_data(sdat, hdr, tmp);
+	for (b=0; b<nb && !err; b++) {
+	    err = read_compressed_data(sdat, hdr, tmp + b * sdat->nvars);
+	    if (!err) {
+		*got += 1;
+	    }
+	}
     } else {
-	size_t amt = fread(tmp, sizeof *tmp, sdat->nvars, sdat->fp);
+	size_t want = (size_t) nb * sdat->nvars;
+	size_t amt = fread(tmp, sizeof *tmp, want, sdat->fp);
 
-	if (amt != sdat->nvars) {
-	    if (ferror(sdat->fp)) {
-		err = sav_error("Reading SPSS file: %s", strerror(errno));
-	    } else if (amt != 0) {
-		err = sav_error("Partial record at end of SPSS file");
-	    }
+	if (amt != want && ferror(sdat->fp)) {
+	    err = sav_error("Reading SPSS file: %s", strerror(errno));
+	} else if (amt % sdat->nvars != 0) {
+	    err = sav_error("Partial record at end of SPSS file");
+	} else {
+	    *got = amt / sdat->nvars;
 	}
     }
 
-    j = 1;
+    return err;
+}
 
-    for (i=0; i<sdat->nvars && !err; i++) {
-	v = &sdat->vars[i];
+/* Transcribe the values of variable @v for the @nb cases in @tmp
+   into the dataset, starting at observation @t0. Distinct
+   variables write to distinct series and (for strings) to
+   distinct columns of the string table, so this can be run
+   in parallel across variables.
+*/
 
-	if (v->offset == -1) {
-	    continue;
-	}
+static void sav_transcribe_var (spss_data *sdat, spss_var *v,
+				const double *tmp, int nb,
+				DATASET *dset, int t0)
+{
+    int nv = sdat->nvars;
+    int j = v->gretl_index;
+    double *x = dset->Z[j] + t0;
+    double xit;
+    int b;
 
-	if (v->type == SPSS_NUMERIC) {
-	    xit = tmp[v->offset];
+    if (v->type == SPSS_NUMERIC) {
+	const double *src = tmp + v->offset;
+
+	for (b=0; b<nb; b++) {
+	    xit = src[b * nv];
 	    if (sdat->swapends) {
 		reverse_double(xit);
 	    }
-	    if (value_is_missing(sdat, v, xit)) {
-		dset->Z[j][t] = NADBL;
-	    } else {
-		dset->Z[j][t] = xit;
-	    }
-	} else {
-	    /* variable is of string type */
-	    char raw[256], cval[256];
-	    int ix, len;
-
-	    len = (v->width < 256)? v->width : 255;
-	    memcpy(raw, &tmp[v->offset], len);
+	    x[b] = value_is_missing(sdat, v, xit) ? NADBL : xit;
+	}
+    } else {
+	/* variable is of string type */
+	series_table *st = gretl_string_table_get_column(sdat->st, j);
+	char raw[256], cval[256];
+	int len = (v->width < 256)? v->width : 255;
+	double ix;
+
+	for (b=0; b<nb; b++) {
+	    memcpy(raw, &tmp[b * nv + v->offset], len);
 	    raw[len] = '\0';
 	    tailstrip(raw);
 	    recode_sav_string(cval, raw, sdat->encoding, 255);
 #if SPSS_DEBUG
-	    fprintf(stderr, "string val Z[%d][%d] = '%s'\n", j, t, cval);
+	    fprintf(stderr, "string val Z[%d][%d] = '%s'\n", j, t0 + b, cval);
 #endif
-	    ix = gretl_string_table_index(sdat->st, cval, j, 0, NULL);
-	    if (ix > 0) {
-		dset->Z[j][t] = ix;
+	    ix = series_table_get_value(st, cval);
+	    if (na(ix)) {
+		int k = series_table_add_string(st, cval);
+
+		ix = (k > 0)? k : NADBL;
+	    }
+	    x[b] = ix;
+	    if (!na(ix)) {
 		v->n_ok_obs += 1;
-		if (t == 0) {
+		if (t0 + b == 0) {
 		    series_set_discrete(dset, j, 1);
 		}
-	    } else {
-		dset->Z[j][t] = NADBL;
-
 	    }
 	}
-	j++;
     }
-
-    return err;
 }
 
 static int do_drop_empty (spss_data *sdat)
@@ -1647,24 +1676,44 @@ static int do_drop_empty (spss_data *sdat)
     return 0;
 }
 
+/* Cases are read in blocks of roughly SAV_BLOCK_BYTES, and each
+   block is then transcribed into the dataset one variable at a
+   time, so that the per-variable work (byte-swapping, checking
+   for missing values, recoding strings) runs over contiguous
+   stretches of the target series.
+*/
+
 static int read_sav_data (spss_data *sdat, struct sysfile_header *hdr,
 			  DATASET *dset, PRN *prn)
 {
     double *tmp = NULL;
+    int *vidx = NULL;
     char label[MAXLABEL];
-    int i, j, t, err = 0;
+    int i, j, k, t, nsel = 0;
+    int nblock, nb, got;
+    int err = 0;
 
-    /* temporary storage for one complete observation */
-    tmp = malloc(sdat->nvars * sizeof *tmp);
-    if (tmp == NULL) {
-	err = E_ALLOC;
+    nblock = SAV_BLOCK_BYTES / (sdat->nvars * sizeof *tmp);
+    if (nblock < 1) {
+	nblock = 1;
+    } else if (nblock > sdat->nobs) {
+	nblock = sdat->nobs > 0 ? sdat->nobs : 1;
+    }
+
+    /* temporary storage for a block of complete observations */
+    tmp = malloc((size_t) nblock * sdat->nvars * sizeof *tmp);
+    vidx = malloc(sdat->nvars * sizeof *vidx);
+    if (tmp == NULL || vidx == NULL) {
+	free(tmp);
+	free(vidx);
+	return E_ALLOC;
     }
 
     /* transcribe varnames and labels; also mark as discrete any vars
        for which we got 'value labels' */
-    j = 1;
     for (i=0; i<sdat->nvars; i++) {
-	if (!CONTD(sdat, i)) {
+	j = sdat->vars[i].gretl_index;
+	if (!CONTD(sdat, i) && j > 0) {
 	    recode_sav_string(dset->varname[j], sdat->vars[i].name,
 			      sdat->encoding, VNAMELEN - 1);
 	    recode_sav_string(label, sdat->vars[i].label,
@@ -1673,24 +1722,40 @@ static int read_sav_data (spss_data *sdat, struct sysfile_header *hdr,
 	    if (has_value_labels(sdat, i)) {
 		series_set_discrete(dset, j, 1);
 	    }
-	    j++;
+	    vidx[nsel++] = i;
 	}
     }
 
     /* retrieve actual data values */
-    for (t=0; t<sdat->nobs && !err; t++) {
-	err = sav_read_observation(sdat, hdr, tmp, dset, t);
+    for (t=0; t<sdat->nobs && !err; t+=got) {
+	nb = sdat->nobs - t;
+	if (nb > nblock) {
+	    nb = nblock;
+	}
+	err = sav_read_block(sdat, hdr, tmp, nb, &got);
 	if (err) {
-	    fprintf(stderr, "sav_read_case: err = %d at i = %d\n", err, i);
+	    fprintf(stderr, "sav_read_block: err = %d at t = %d\n", err, t);
+	    break;
+	}
+#if defined(_OPENMP)
+#pragma omp parallel for if (nsel > 1 && gretl_use_openmp((guint64) got * nsel))
+#endif
+	for (k=0; k<nsel; k++) {
+	    sav_transcribe_var(sdat, &sdat->vars[vidx[k]], tmp, got, dset, t);
+	}
+	if (got < nb) {
+	    /* premature end of data */
+	    break;
 	}
     }
 
     free(tmp);
+    free(vidx);
 
     /* count valid observations, to determine 'empty' variables */
-    j = 1;
     for (i=0; i<sdat->nvars; i++) {
-	if (!CONTD(sdat, i)) {
+	j = sdat->vars[i].gretl_index;
+	if (!CONTD(sdat, i) && j > 0) {
 	    if (sdat->vars[i].n_ok_obs == 0) {
 		fprintf(stderr, "var %d: no valid observations\n", j);
 		if (sdat->opt & OPT_D) {
@@ -1698,7 +1763,6 @@ static int read_sav_data (spss_data *sdat, struct sysfile_header *hdr,
 		    sdat->vars[i].gretl_index = -1;
 		}
 	    }
-	    j++;
 	}
     }
 
@@ -1729,6 +1793,7 @@ static void spss_data_init (spss_data *sdat, FILE *fp)
     sdat->labelsets = NULL;
 
     sdat->ext.buf = sdat->ext.ptr = sdat->ext.end = NULL;
+    sdat->ext.codes_ok = 0;
     sdat->ext.sysmis = -DBL_MAX;
     sdat->ext.highest = DBL_MAX;
     sdat->ext.lowest = second_lowest_double_val();
@@ -1771,7 +1836,8 @@ static void free_spss_data (spss_data *sdat)
 }
 
 /* eliminate any elements of @list which represent variables
-   that have been dropped because they have no valid values
+   that have been dropped because they have no valid values,
+   or that were not selected for import
 */
 
 static void prune_labellist (spss_data *sdat, int *list)
@@ -1779,7 +1845,7 @@ static void prune_labellist (spss_data *sdat, int *list)
     int i;
 
     for (i=list[0]; i>0; i--) {
-	if (in_gretl_list(sdat->droplist, list[i] - 1)) {
+	if (sdat->vars[list[i] - 1].gretl_index < 0) {
 	    gretl_list_delete_at_pos(list, i);
 	}
     }
@@ -1802,11 +1868,9 @@ static void print_labelsets (spss_data *sdat, PRN *prn)
 	int *vlist = lset->varlist;
 	spss_var *v;
 
-	if (sdat->droplist != NULL) {
-	    prune_labellist(sdat, vlist);
-	    if (vlist[0] == 0) {
-		continue;
-	    }
+	prune_labellist(sdat, vlist);
+	if (vlist[0] == 0) {
+	    continue;
 	}
 
 	pputc(prn, '\n');
@@ -1876,7 +1940,7 @@ static int maybe_add_string_table (spss_data *sdat)
     int err = 0;
 
     for (i=0; i<sdat->nvars; i++) {
-	if (sdat->vars[i].type > 0) {
+	if (sdat->vars[i].type > 0 && sdat->vars[i].gretl_index > 0) {
 	    sdat->max_sv = i;
 	    nsv++;
 	}
@@ -1892,7 +1956,7 @@ static int maybe_add_string_table (spss_data *sdat)
 	    err = E_ALLOC;
 	} else {
 	    for (i=0; i<sdat->nvars; i++) {
-		if (sdat->vars[i].type > 0) {
+		if (sdat->vars[i].type > 0 && sdat->vars[i].gretl_index > 0) {
 		    list[j++] = sdat->vars[i].gretl_index;
 		}
 	    }
@@ -1920,8 +1984,9 @@ static int prepare_gretl_dataset (spss_data *sdat,
     }
 
     for (i=0; i<sdat->nvars && !err; i++) {
-	if (CONTD(sdat, i)) {
-	    /* not a real variable (string continuation) */
+	if (CONTD(sdat, i) || sdat->vars[i].gretl_index < 0) {
+	    /* not a real variable (string continuation), or
+	       not selected */
 	    nvars--;
 	}
     }
@@ -1947,8 +2012,88 @@ static int prepare_gretl_dataset (spss_data *sdat,
     return err;
 }
 
-int sav_get_data (const char *fname, DATASET *dset,
-		  gretlopt opt, PRN *prn)
+/* Selection of variables to import, by name or by (1-based)
+   position in the file; see sav_get_data_subset().
+*/
+
+typedef struct sav_select_ sav_select;
+
+struct sav_select_ {
+    char **S;         /* names of selected variables, or NULL */
+    int ns;           /* number of elements in @S */
+    const int *cols;  /* list of selected positions, or NULL */
+};
+
+/* Mark the variables not wanted under @sel with a gretl_index
+   of -1 and renumber the others consecutively, in file order.
+*/
+
+static int apply_sav_selection (spss_data *sdat, const sav_select *sel)
+{
+    char vname[VNAMELEN];
+    char *wanted;
+    int i, k, nreal = 0;
+    int err = 0;
+
+    wanted = calloc(sdat->nvars, 1);
+    if (wanted == NULL) {
+	return E_ALLOC;
+    }
+
+    if (sel->S != NULL) {
+	for (k=0; k<sel->ns && !err; k++) {
+	    for (i=0; i<sdat->nvars; i++) {
+		if (CONTD(sdat, i)) {
+		    continue;
+		}
+		recode_sav_string(vname, sdat->vars[i].name,
+				  sdat->encoding, VNAMELEN - 1);
+		if (!strcmp(vname, sel->S[k])) {
+		    wanted[i] = 1;
+		    break;
+		}
+	    }
+	    if (i == sdat->nvars) {
+		gretl_errmsg_sprintf(_("Variable '%s' not found"), sel->S[k]);
+		err = E_DATA;
+	    }
+	}
+    } else if (sel->cols != NULL) {
+	for (i=0; i<sdat->nvars; i++) {
+	    if (!CONTD(sdat, i)) {
+		nreal++;
+		wanted[i] = in_gretl_list(sel->cols, nreal) > 0;
+	    }
+	}
+	for (k=1; k<=sel->cols[0] && !err; k++) {
+	    if (sel->cols[k] < 1 || sel->cols[k] > nreal) {
+		gretl_errmsg_sprintf(_("Variable %d not found"), sel->cols[k]);
+		err = E_DATA;
+	    }
+	}
+    }
+
+    if (!err) {
+	int gidx = 0;
+
+	for (i=0; i<sdat->nvars; i++) {
+	    if (!CONTD(sdat, i)) {
+		sdat->vars[i].gretl_index = wanted[i] ? ++gidx : -1;
+	    }
+	}
+	if (gidx == 0) {
+	    err = E_DATA;
+	}
+    }
+
+    free(wanted);
+
+    return err;
+}
+
+static int real_sav_get_data (const char *fname, DATASET *dset,
+			      const sav_select *sel, gretlopt opt,
+			      PRN *prn)
 {
     spss_data sdat;
     struct sysfile_header hdr;
@@ -1996,6 +2141,10 @@ int sav_get_data (const char *fname, DATASET *dset,
 	err = read_sav_other_records(&sdat);
     }
 
+    if (!err && sel != NULL) {
+	err = apply_sav_selection(&sdat, sel);
+    }
+
     if (!err) {
 	err = prepare_gretl_dataset(&sdat, &newset, prn);
     }
@@ -2037,3 +2186,27 @@ int sav_get_data (const char *fname, DATASET *dset,
 
     return err;
 }
+
+int sav_get_data (const char *fname, DATASET *dset,
+		  gretlopt opt, PRN *prn)
+{
+    return real_sav_get_data(fname, dset, NULL, opt, prn);
+}
+
+/* Import only the variables selected by name (@S, of length
+   @ns) or by position (the gretl list @cols); exactly one of
+   @S and @cols should be non-NULL.
+*/
+
+int sav_get_data_subset (const char *fname, DATASET *dset,
+			 char **S, int ns, const int *cols,
+			 gretlopt opt, PRN *prn)
+{
+    sav_select sel;
+
+    sel.S = S;
+    sel.ns = ns;
+    sel.cols = cols;
+
+    return real_sav_get_data(fname, dset, &sel, opt, prn);
+}
@@ -568,35 +568,32 @@ static int check_new_variable_types (FILE *fp, int *types,
 /* mechanism for handling (coding) non-numeric variables */
 
 static gretl_string_table *
-dta_make_string_table (int *types, int nvar, int ncols)
+dta_make_string_table (int *types, const int *vmap, int nvar)
 {
     gretl_string_table *st;
     int *list;
-    int i, j;
+    int i, sv;
 
-    list = gretl_list_new(ncols);
+    list = gretl_null_list();
     if (list == NULL) {
         return NULL;
     }
 
-    j = 1;
-
-    if (stata_13) {
-        for (i=0; i<nvar && j<=list[0]; i++) {
-            if (types[i] <= STATA_STRF_MAX ||
-                types[i] == STATA_13_STRL) {
-                list[j++] = i + 1;
-            }
+    for (i=0; i<nvar && list != NULL; i++) {
+        if (vmap[i] == 0) {
+            continue;
         }
-    } else {
-        for (i=0; i<nvar && j<=list[0]; i++) {
-            if (!stata_type_float(types[i]) &&
+        if (stata_13) {
+            sv = types[i] <= STATA_STRF_MAX || types[i] == STATA_13_STRL;
+        } else {
+            sv = !stata_type_float(types[i]) &&
                 !stata_type_double(types[i]) &&
                 !stata_type_long(types[i]) &&
                 !stata_type_int(types[i]) &&
-                !stata_type_byte(types[i])) {
-                list[j++] = i + 1;
-            }
+                !stata_type_byte(types[i]);
+        }
+        if (sv) {
+            list = gretl_list_append_term(&list, vmap[i]);
         }
     }
 
@@ -604,7 +601,12 @@ dta_make_string_table (int *types, int nvar, int ncols)
     printlist(list, "dta_make_string_table");
 #endif
 
-    st = gretl_string_table_new(list);
+    if (list == NULL || list[0] == 0) {
+        /* no string-valued variables selected */
+        st = NULL;
+    } else {
+        st = gretl_string_table_new(list);
+    }
 
     free(list);
 
@@ -1076,7 +1078,7 @@ static int process_value_labels (FILE *fp, DATASET *dset, int j,
 }
 
 static int process_stata_varname (FILE *fp, char *buf, int namelen,
-                                  DATASET *dset, int v, PRN *vprn)
+                                  char *vname, int v, PRN *vprn)
 {
     int err = 0;
 
@@ -1111,8 +1113,8 @@ static int process_stata_varname (FILE *fp, char *buf, int namelen,
     }
 
     if (!err) {
-	dset->varname[v][0] = '\0';
-        strncat(dset->varname[v], buf, VNAMELEN - 1);
+	*vname = '\0';
+        strncat(vname, buf, VNAMELEN - 1);
     }
 
     return err;
@@ -1267,60 +1269,321 @@ static void maybe_fix_varlabel_pos (FILE *fp, dta_table *dtab)
     }
 }
 
-static int find_strl_value (char *buf, int bufsize,
-                            int vnum, int obs, FILE *fp)
+static void set_discreteness_from_types (DATASET *dset,
+                                         const int *types,
+                                         const int *vmap,
+                                         int nvar, int newtypes)
 {
-    char test[4];
-    guint32 v, len;
-    guint64 o;
-    int err = 0;
+    int i;
 
-    stata_read_string(fp, 3, test, &err);
-    test[3] = '\0';
-    if (!err && strcmp(test, "GSO")) {
-        fprintf(stderr, "empty or bad strls block\n");
-        err = E_DATA;
+    for (i=0; i<nvar; i++) {
+        int discrete = 0;
+        int t = types[i];
+
+        if (vmap[i] == 0) {
+            continue;
+        }
+        if (newtypes) {
+            if (t != STATA_13_FLOAT && t != STATA_13_DOUBLE &&
+                t != STATA_13_LONG) {
+                discrete = 1;
+            }
+        } else {
+            if (!stata_type_float(t) && !stata_type_double(t) &&
+                !stata_type_long(t)) {
+                discrete = 1;
+            }
+        }
+        if (discrete) {
+            series_set_discrete(dset, vmap[i], 1);
+        }
     }
+}
 
-    while (!err) {
-        v = stata_read_uint32(fp, &err);
-        o = stata_read_uint64(fp, &err);
-        /* next is 't', 'binary vs ASCII' -- not needed? */
-        stata_read_byte(fp, &err);
-        len = stata_read_uint32(fp, &err);
-        if (!err) {
-            if (v == vnum && o == obs) {
-                /* found what we're looking for */
-                err = stata_read_buffer(buf, bufsize, len, fp);
-                break;
-            } else {
-                /* try for the next GSO */
-                err = stata_seek(fp, len, SEEK_CUR);
-                stata_read_string(fp, 3, test, &err);
-                test[3] = '\0';
-                if (strcmp(test, "GSO")) {
-                    if (strcmp(test, "</s")) {
-                        fprintf(stderr, "broken strls zone?\n");
-                    }
+/* Selection of variables to import, by name or by (1-based)
+   position in the file; see dta_get_data_subset().
+*/
+
+typedef struct dta_select_ dta_select;
+
+struct dta_select_ {
+    char **S;         /* names of selected variables, or NULL */
+    int ns;           /* number of elements in @S */
+    const int *cols;  /* list of selected positions, or NULL */
+};
+
+/* Build a map from the variables in the file to the series
+   of the dataset under construction: on output vmap[i] holds
+   the ID number of the series for file variable i, or 0 if
+   the variable is not wanted. Selected variables are kept
+   in the order in which they're stored.
+*/
+
+static int *dta_make_vmap (char **vnames, int nvar,
+                           const dta_select *sel,
+                           int *nsel, int *err)
+{
+    int *vmap = calloc(nvar, sizeof *vmap);
+    int i, k;
+
+    if (vmap == NULL) {
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    if (sel == NULL) {
+        for (i=0; i<nvar; i++) {
+            vmap[i] = 1;
+        }
+    } else if (sel->S != NULL) {
+        for (k=0; k<sel->ns && !*err; k++) {
+            for (i=0; i<nvar; i++) {
+                if (!strcmp(vnames[i], sel->S[k])) {
+                    vmap[i] = 1;
                     break;
                 }
             }
+            if (i == nvar) {
+                gretl_errmsg_sprintf(_("Variable '%s' not found"), sel->S[k]);
+                *err = E_DATA;
+            }
+        }
+    } else if (sel->cols != NULL) {
+        for (k=1; k<=sel->cols[0] && !*err; k++) {
+            i = sel->cols[k];
+            if (i < 1 || i > nvar) {
+                gretl_errmsg_sprintf(_("Variable %d not found"), i);
+                *err = E_DATA;
+            } else {
+                vmap[i-1] = 1;
+            }
         }
     }
 
-    return err;
+    if (*err) {
+        free(vmap);
+        return NULL;
+    }
+
+    *nsel = 0;
+    for (i=0; i<nvar; i++) {
+        if (vmap[i]) {
+            vmap[i] = ++(*nsel);
+        }
+    }
+
+    return vmap;
 }
 
-static int get_strl_data (char *buf, int bufsize,
-                          dta_table *dtab, FILE *fp)
+/* Allocate the data array for the @nsel selected variables
+   and transcribe their names.
+*/
+
+static int dta_dataset_setup (DATASET *dset, char **vnames,
+                              const int *vmap, int nvar,
+                              int nsel)
 {
-    char vobytes[8];
-    int err = 0;
+    int i, err;
 
-    *buf = *vobytes = '\0';
-    stata_read_string(fp, 8, vobytes, &err);
+    dset->v = nsel + 1;
+    err = start_new_Z(dset, 0);
 
     if (!err) {
+        for (i=0; i<nvar; i++) {
+            if (vmap[i] > 0) {
+                strcpy(dset->varname[vmap[i]], vnames[i]);
+            }
+        }
+    }
+
+    return err;
+}
+
+/* Reading the data block. Observations are stored as fixed-length
+   records, so rather than reading values one at a time we fread
+   blocks of records and decode the selected variables column by
+   column, byte-swapping as needed. Values of strL variables are
+   resolved afterwards, in a single pass through the strls block.
+*/
+
+#define DTA_CHUNK_BYTES (8 << 20)
+
+enum {
+    DTA_FLOAT,
+    DTA_DOUBLE,
+    DTA_LONG,
+    DTA_INT,
+    DTA_BYTE,
+    DTA_STRF,
+    DTA_STRL
+};
+
+typedef struct dta_column_ dta_column;
+
+struct dta_column_ {
+    int v;          /* ID number of target series */
+    int kind;       /* one of the DTA_* codes above */
+    int width;      /* bytes per value */
+    int offset;     /* byte offset within record */
+    guint64 *refs;  /* strL references, or NULL */
+};
+
+/* Get the kind of Stata storage type @t, and its width in bytes */
+
+static int dta_type_kind (int t, int soffset, int *width)
+{
+    if (stata_13) {
+        if (t == STATA_13_FLOAT) {
+            *width = 4;
+            return DTA_FLOAT;
+        } else if (t == STATA_13_DOUBLE) {
+            *width = 8;
+            return DTA_DOUBLE;
+        } else if (t == STATA_13_LONG) {
+            *width = 4;
+            return DTA_LONG;
+        } else if (t == STATA_13_INT) {
+            *width = 2;
+            return DTA_INT;
+        } else if (t == STATA_13_BYTE) {
+            *width = 1;
+            return DTA_BYTE;
+        } else if (t == STATA_13_STRL) {
+            *width = 8;
+            return DTA_STRL;
+        }
+    } else if (stata_type_float(t)) {
+        *width = 4;
+        return DTA_FLOAT;
+    } else if (stata_type_double(t)) {
+        *width = 8;
+        return DTA_DOUBLE;
+    } else if (stata_type_long(t)) {
+        *width = 4;
+        return DTA_LONG;
+    } else if (stata_type_int(t)) {
+        *width = 2;
+        return DTA_INT;
+    } else if (stata_type_byte(t)) {
+        *width = 1;
+        return DTA_BYTE;
+    } else {
+        t -= soffset;
+    }
+
+    /* fixed-length string */
+    *width = t;
+    return DTA_STRF;
+}
+
+/* Decode the values of numeric column @col from the @nr records
+   in @buf into @x.
+*/
+
+static void dta_decode_numeric (const unsigned char *buf, int nr,
+                                int reclen, const dta_column *col,
+                                double *x)
+{
+    const unsigned char *p = buf + col->offset;
+    int r;
+
+    if (col->kind == DTA_DOUBLE) {
+        guint64 u;
+        double d;
+
+        for (r=0; r<nr; r++, p+=reclen) {
+            memcpy(&u, p, 8);
+            if (swapends) {
+                u = GUINT64_SWAP_LE_BE(u);
+            }
+            memcpy(&d, &u, 8);
+            x[r] = STATA_DOUBLE_NA(d) ? NADBL : d;
+        }
+    } else if (col->kind == DTA_FLOAT) {
+        guint32 u;
+        float f;
+
+        for (r=0; r<nr; r++, p+=reclen) {
+            memcpy(&u, p, 4);
+            if (swapends) {
+                u = GUINT32_SWAP_LE_BE(u);
+            }
+            memcpy(&f, &u, 4);
+            x[r] = STATA_FLOAT_NA(f) ? NADBL : (double) f;
+        }
+    } else if (col->kind == DTA_LONG) {
+        guint32 u;
+        gint32 i;
+
+        for (r=0; r<nr; r++, p+=reclen) {
+            memcpy(&u, p, 4);
+            if (swapends) {
+                u = GUINT32_SWAP_LE_BE(u);
+            }
+            i = (gint32) u;
+            x[r] = STATA_LONG_NA(i) ? NADBL : (double) i;
+        }
+    } else if (col->kind == DTA_INT) {
+        guint16 u;
+        gint16 i;
+
+        for (r=0; r<nr; r++, p+=reclen) {
+            memcpy(&u, p, 2);
+            if (swapends) {
+                u = GUINT16_SWAP_LE_BE(u);
+            }
+            i = (gint16) u;
+            x[r] = STATA_INT_NA(i) ? NADBL : (double) i;
+        }
+    } else if (col->kind == DTA_BYTE) {
+        signed char b;
+
+        for (r=0; r<nr; r++, p+=reclen) {
+            b = (signed char) *p;
+            x[r] = STATA_BYTE_NA(b, stata_version) ? NADBL : (double) b;
+        }
+    }
+}
+
+/* Copy a fixed-length string of @len bytes from @src, truncating
+   it if need be, as per stata_read_buffer().
+*/
+
+static void dta_copy_string (char *buf, int bufsize,
+                             const unsigned char *src, int len)
+{
+    int n = bufsize - 1;
+
+    if (len > n) {
+        memcpy(buf, src, n);
+        buf[n] = '\0';
+        if (stata_version > 13) {
+            /* beware broken UTF-8! */
+            int pos = n - 1;
+
+            while (!g_utf8_validate(buf, -1, NULL)) {
+                buf[pos--] = '\0';
+            }
+        }
+    } else {
+        memcpy(buf, src, len);
+        buf[len] = '\0';
+    }
+}
+
+/* Record the (variable, observation) references of strL column
+   @col for the @nr records in @buf, starting at observation @t0.
+   The two parts are packed into a single 64-bit key, with zero
+   indicating an empty string.
+*/
+
+static int dta_get_strl_refs (const unsigned char *buf, int nr,
+                              int reclen, dta_column *col, int t0)
+{
+    const unsigned char *p = buf + col->offset;
+    int r;
+
+    for (r=0; r<nr; r++, p+=reclen) {
         gint64 o = 0;
         guint16 v;
 #if WORDS_BIGENDIAN
@@ -1329,79 +1592,244 @@ static int get_strl_data (char *buf, int bufsize,
         char *targ = (char *) &o;
 #endif
 
-        memcpy(&v, vobytes, 2);
-        memcpy(targ, vobytes + 2, 6);
+        memcpy(&v, p, 2);
+        memcpy(targ, p + 2, 6);
 
         if (o > INT_MAX) {
             fprintf(stderr, "strL: obs reference too big!\n");
-            err = E_DATA;
-        } else if (v == 0 && o == 0) {
-            ; /* empty string */
-        } else {
-            gint64 thispos = ftell64(fp);
+            return E_DATA;
+        }
+        col->refs[t0+r] = ((guint64) v << 48) | (guint64) o;
+    }
 
-            err = stata_seek(fp, dtab->strl_pos, SEEK_SET);
-            if (!err) {
-                err = find_strl_value(buf, bufsize, (int) v, (int) o, fp);
+    return 0;
+}
+
+/* Read the strls block once, picking up the strings that are
+   referenced by the selected strL variables, then attach them
+   to the relevant observations.
+*/
+
+static int dta_resolve_strls (FILE *fp, DATASET *dset,
+                              dta_column *cols, int ncols,
+                              gretl_string_table *st,
+                              dta_table *dtab, PRN *prn)
+{
+    GHashTable *ht;
+    gpointer okey;
+    const char *sv;
+    char test[4];
+    char buf[256];
+    gpointer oval;
+    guint32 v, len;
+    guint64 o, key;
+    int nwant, j, t;
+    int err = 0;
+
+    ht = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                               NULL, g_free);
+
+    for (j=0; j<ncols; j++) {
+        if (cols[j].refs != NULL) {
+            for (t=0; t<dset->n; t++) {
+                if (cols[j].refs[t] != 0) {
+                    g_hash_table_insert(ht, &cols[j].refs[t], NULL);
+                }
             }
-            if (!err) {
-                /* get back in position */
-                err = stata_seek(fp, thispos, SEEK_SET);
+        }
+    }
+
+    nwant = g_hash_table_size(ht);
+
+    if (nwant > 0) {
+        err = stata_seek(fp, dtab->strl_pos, SEEK_SET);
+        if (!err) {
+            stata_read_string(fp, 3, test, &err);
+            test[3] = '\0';
+            if (!err && strcmp(test, "GSO")) {
+                fprintf(stderr, "empty or bad strls block\n");
+                err = E_DATA;
+            }
+        }
+    }
+
+    while (!err && nwant > 0) {
+        v = stata_read_uint32(fp, &err);
+        o = stata_read_uint64(fp, &err);
+        /* next is 't', 'binary vs ASCII' -- not needed? */
+        stata_read_byte(fp, &err);
+        len = stata_read_uint32(fp, &err);
+        if (err) {
+            break;
+        }
+        key = ((guint64) v << 48) | o;
+        if (g_hash_table_lookup_extended(ht, &key, &okey, &oval)) {
+            err = stata_read_buffer(buf, sizeof buf, len, fp);
+            if (!err && oval == NULL) {
+                g_hash_table_insert(ht, okey, g_strdup(buf));
+                nwant--;
+            }
+        } else {
+            err = stata_seek(fp, len, SEEK_CUR);
+        }
+        if (!err && nwant > 0) {
+            stata_read_string(fp, 3, test, &err);
+            test[3] = '\0';
+            if (strcmp(test, "GSO")) {
+                if (strcmp(test, "</s")) {
+                    fprintf(stderr, "broken strls zone?\n");
+                }
+                break;
+            }
+        }
+    }
+
+    for (j=0; j<ncols && !err; j++) {
+        if (cols[j].refs != NULL) {
+            for (t=0; t<dset->n; t++) {
+                if (cols[j].refs[t] != 0) {
+                    sv = g_hash_table_lookup(ht, &cols[j].refs[t]);
+                    if (sv != NULL && *sv != '\0') {
+                        strcpy(buf, sv);
+                        process_string_value(buf, st, dset, cols[j].v,
+                                             t, prn);
+                    }
+                }
             }
         }
     }
 
+    g_hash_table_destroy(ht);
+
     return err;
 }
 
-static void set_discreteness_from_types (DATASET *dset,
-                                         const int *types,
-                                         int newtypes)
+/* Read the data block, which @fp should be positioned to start,
+   for the variables selected via @vmap.
+*/
+
+static int read_dta_records (FILE *fp, DATASET *dset,
+                             const int *types, const int *vmap,
+                             int nvar, int soffset,
+                             gretl_string_table *st,
+                             dta_table *dtab, PRN *prn)
 {
-    int i;
+    dta_column *cols;
+    unsigned char *buf = NULL;
+    char sbuf[256];
+    int reclen = 0, ncols = 0;
+    int nstrl = 0, chunk = 0;
+    int i, j, r, t, nr;
+    int err = 0;
 
-    for (i=1; i<dset->v; i++) {
-        int discrete = 0;
-        int t = types[i-1];
+    cols = malloc(nvar * sizeof *cols);
+    if (cols == NULL) {
+        return E_ALLOC;
+    }
 
-        if (newtypes) {
-            if (t != STATA_13_FLOAT && t != STATA_13_DOUBLE &&
-                t != STATA_13_LONG) {
-                discrete = 1;
-            }
-        } else {
-            if (!stata_type_float(t) && !stata_type_double(t) &&
-                !stata_type_long(t)) {
-                discrete = 1;
+    for (i=0; i<nvar && !err; i++) {
+        int width, kind = dta_type_kind(types[i], soffset, &width);
+
+        if (vmap[i] > 0) {
+            dta_column *col = &cols[ncols++];
+
+            col->v = vmap[i];
+            col->kind = kind;
+            col->width = width;
+            col->offset = reclen;
+            col->refs = NULL;
+            if (kind == DTA_STRL) {
+                col->refs = calloc(dset->n, sizeof *col->refs);
+                if (col->refs == NULL) {
+                    err = E_ALLOC;
+                }
+                nstrl++;
             }
         }
-        if (discrete) {
-            series_set_discrete(dset, i, 1);
+        reclen += width;
+    }
+
+    if (!err && reclen <= 0) {
+        err = E_DATA;
+    }
+
+    if (!err && dset->n > 0) {
+        chunk = DTA_CHUNK_BYTES / reclen;
+        if (chunk < 1) {
+            chunk = 1;
+        } else if (chunk > dset->n) {
+            chunk = dset->n;
+        }
+        buf = malloc((size_t) chunk * reclen);
+        if (buf == NULL) {
+            err = E_ALLOC;
         }
     }
+
+    for (t=0; t<dset->n && !err; t+=nr) {
+        nr = MIN(chunk, dset->n - t);
+        if (fread(buf, reclen, nr, fp) != (size_t) nr) {
+            bin_error(&err, "read_dta_records");
+            break;
+        }
+        for (j=0; j<ncols && !err; j++) {
+            dta_column *col = &cols[j];
+
+            if (col->kind == DTA_STRF) {
+                const unsigned char *p = buf + col->offset;
+
+                for (r=0; r<nr; r++, p+=reclen) {
+                    dta_copy_string(sbuf, sizeof sbuf, p, col->width);
+                    if (*sbuf != '\0') {
+                        process_string_value(sbuf, st, dset, col->v,
+                                             t + r, prn);
+                    }
+                }
+            } else if (col->kind == DTA_STRL) {
+                err = dta_get_strl_refs(buf, nr, reclen, col, t);
+            } else {
+                dta_decode_numeric(buf, nr, reclen, col,
+                                   dset->Z[col->v] + t);
+            }
+        }
+    }
+
+    if (!err && nstrl > 0) {
+        err = dta_resolve_strls(fp, dset, cols, ncols, st, dtab, prn);
+    }
+
+    for (j=0; j<ncols; j++) {
+        free(cols[j].refs);
+    }
+    free(cols);
+    free(buf);
+
+    return err;
 }
 
 /* main reader for dta format 117+ */
 
 static int read_dta_117_data (FILE *fp, DATASET *dset,
                               gretl_string_table **pst,
-                              dta_table *dtab, PRN *prn,
-                              PRN *vprn)
+                              dta_table *dtab,
+                              const dta_select *sel,
+                              PRN *prn, PRN *vprn)
 {
-    int i, j, t;
+    int i, j;
     int namelen = 32;
     int fmtlen = 49;
     int vlabellen = 81;
-    int nvar = dset->v - 1;
-    int nsv = 0;
+    int nvar = dtab->nvar;
+    int nsv = 0, nsel = 0;
     int pd = 0, tvar = -1;
     char label[322]; /* dataset label */
     char aname[130]; /* variable names */
     char c60[60];    /* misc strings */
+    char **vnames = NULL;
     int *types = NULL;
+    int *vmap = NULL;
     int *lvars = NULL;
     char **lnames = NULL;
-    char buf[256];
     int st_err = 0;
     int err = 0;
 
@@ -1445,17 +1873,15 @@ static int read_dta_117_data (FILE *fp, DATASET *dset,
         return err;
     }
 
-    if (*label != '\0') {
-        save_dataset_info(dset, label, c60);
-    }
-
     /** read variable descriptors **/
 
     /* types */
 
     types = malloc(nvar * sizeof *types);
-    if (types == NULL) {
-        return E_ALLOC;
+    vnames = strings_array_new_with_length(nvar, VNAMELEN);
+    if (types == NULL || vnames == NULL) {
+        err = E_ALLOC;
+        goto bailout;
     }
 
     err = stata_seek(fp, dtab->vtype_pos, SEEK_SET);
@@ -1464,42 +1890,57 @@ static int read_dta_117_data (FILE *fp, DATASET *dset,
         err = check_new_variable_types(fp, types, nvar, &nsv, vprn);
     }
 
-    if (err) {
-        free(types);
-        return err;
-    }
-
-    if (nsv > 0) {
-        /* we have 1 or more non-numeric variables */
-        *pst = dta_make_string_table(types, nvar, nsv);
+    if (!err) {
+        err = stata_seek(fp, dtab->vname_pos, SEEK_SET);
     }
 
-    err = stata_seek(fp, dtab->vname_pos, SEEK_SET);
-
     /* variable names */
     for (i=0; i<nvar && !err; i++) {
         err = process_stata_varname(fp, aname, namelen,
-                                    dset, i+1, vprn);
+                                    vnames[i], i+1, vprn);
+    }
+
+    if (!err) {
+        vmap = dta_make_vmap(vnames, nvar, sel, &nsel, &err);
+    }
+
+    if (!err) {
+        if (nsel < nvar) {
+            pprintf(vprn, "importing %d of %d variables\n", nsel, nvar);
+        }
+        err = dta_dataset_setup(dset, vnames, vmap, nvar, nsel);
+    }
+
+    if (err) {
+        goto bailout;
+    }
+
+    if (*label != '\0') {
+        save_dataset_info(dset, label, c60);
+    }
+
+    if (nsv > 0) {
+        /* we have 1 or more non-numeric variables */
+        *pst = dta_make_string_table(types, vmap, nvar);
     }
 
 #if HDR_DEBUG
     fprintf(stderr, "dtab->vfmt_pos = %d\n", (int) dtab->vfmt_pos);
 #endif
 
-    if (!err && dtab->vfmt_pos > 0) {
+    if (dtab->vfmt_pos > 0) {
         /* format list (use it to extract time-series info?) */
         err = stata_seek(fp, dtab->vfmt_pos, SEEK_SET);
         for (i=0; i<nvar && !err; i++){
             stata_read_string(fp, fmtlen, c60, &err);
-            if (!err && types[i] >= STATA_13_DOUBLE) {
-                process_stata_format(c60, i+1, &pd, &tvar, vprn);
+            if (!err && types[i] >= STATA_13_DOUBLE && vmap[i] > 0) {
+                process_stata_format(c60, vmap[i], &pd, &tvar, vprn);
             }
         }
     }
 
     if (err) {
-        free(types);
-        return err;
+        goto bailout;
     }
 
 #if HDR_DEBUG
@@ -1513,9 +1954,10 @@ static int read_dta_117_data (FILE *fp, DATASET *dset,
     */
     for (i=0; i<nvar && !err; i++) {
         stata_read_string(fp, namelen + 1, aname, &err);
-        if (!err && *aname != '\0' && !st_err) {
-            pprintf(vprn, "variable %d: value-label name = '%s'\n", i+1, aname);
-            st_err = push_label_info(&lvars, &lnames, i+1, aname);
+        if (!err && *aname != '\0' && vmap[i] > 0 && !st_err) {
+            pprintf(vprn, "variable %d: value-label name = '%s'\n",
+                    vmap[i], aname);
+            st_err = push_label_info(&lvars, &lnames, vmap[i], aname);
         }
     }
 
@@ -1533,15 +1975,14 @@ static int read_dta_117_data (FILE *fp, DATASET *dset,
         err = stata_seek(fp, dtab->varlabel_pos, SEEK_SET);
         for (i=0; i<nvar && !err; i++) {
             stata_read_string(fp, vlabellen, label, &err);
-            if (*label != '\0') {
-                process_stata_varlabel(label, dset, i+1, vprn);
+            if (*label != '\0' && vmap[i] > 0) {
+                process_stata_varlabel(label, dset, vmap[i], vprn);
             }
         }
     }
 
     if (err) {
-        free(types);
-        return err;
+        goto bailout;
     }
 
 #if HDR_DEBUG
@@ -1551,40 +1992,9 @@ static int read_dta_117_data (FILE *fp, DATASET *dset,
     err = stata_seek(fp, dtab->data_pos, SEEK_SET);
 
     /* actual data values */
-    for (t=0; t<dset->n && !err; t++) {
-        for (i=0; i<nvar && !err; i++) {
-            int ix, v = i + 1;
-            int typ = types[i];
-
-            dset->Z[v][t] = NADBL;
-
-            if (typ == STATA_13_FLOAT) {
-                dset->Z[v][t] = (double) stata_read_float(fp, &err);
-            } else if (typ == STATA_13_DOUBLE) {
-                dset->Z[v][t] = stata_read_double(fp, &err);
-            } else if (typ == STATA_13_LONG) {
-                ix = stata_read_int32(fp, 0, &err);
-                dset->Z[v][t] = (ix == NA_INT)? NADBL : (double) ix;
-            } else if (typ == STATA_13_INT) {
-                ix = stata_read_short(fp, 0, &err);
-                dset->Z[v][t] = (ix == NA_INT)? NADBL : (double) ix;
-            } else if (typ == STATA_13_BYTE) {
-                ix = stata_read_signed_byte(fp, 0, &err);
-                dset->Z[v][t] = (ix == NA_INT)? NADBL : (double) ix;
-            } else if (typ <= STATA_STRF_MAX) {
-                /* fixed length string */
-                err = stata_read_buffer(buf, sizeof buf, typ, fp);
-                if (!err && *buf != '\0') {
-                    process_string_value(buf, *pst, dset, v, t, prn);
-                }
-            } else if (typ == STATA_13_STRL) {
-                /* arbitrarily long string! */
-                err = get_strl_data(buf, sizeof buf, dtab, fp);
-                if (!err && *buf != '\0') {
-                    process_string_value(buf, *pst, dset, v, t, prn);
-                }
-            }
-        }
+    if (!err) {
+        err = read_dta_records(fp, dset, types, vmap, nvar, 0,
+                               *pst, dtab, prn);
     }
 
     if (!err && tvar > 0) {
@@ -1634,10 +2044,14 @@ static int read_dta_117_data (FILE *fp, DATASET *dset,
     }
 
     if (!err) {
-        set_discreteness_from_types(dset, types, 1);
+        set_discreteness_from_types(dset, types, vmap, nvar, 1);
     }
 
+ bailout:
+
     free(types);
+    free(vmap);
+    strings_array_free(vnames, nvar);
 
     if (lvars != NULL) {
         strings_array_free(lnames, lvars[0]);
@@ -1655,19 +2069,20 @@ static int read_dta_117_data (FILE *fp, DATASET *dset,
 
 static int read_old_dta_data (FILE *fp, DATASET *dset,
                               gretl_string_table **pst,
-                              int namelen, PRN *prn,
-                              PRN *vprn)
+                              int nvar, int namelen,
+                              const dta_select *sel,
+                              PRN *prn, PRN *vprn)
 {
-    int i, j, t, clen;
+    int i, j, clen;
     int labellen, fmtlen;
-    int nvar = dset->v - 1;
-    int nsv = 0;
+    int nsv = 0, nsel = 0;
     int soffset, pd = 0, tvar = -1;
-    char label[81], c50[50], aname[33];
+    char label[81], stamp[19], c50[50], aname[33];
+    char **vnames = NULL;
     int *types = NULL;
+    int *vmap = NULL;
     int *lvars = NULL;
     char **lnames = NULL;
-    char strbuf[256];
     int st_err = 0;
     int err = 0;
 
@@ -1682,37 +2097,51 @@ static int read_old_dta_data (FILE *fp, DATASET *dset,
     pprintf(vprn, "dataset label: '%s'\n", label);
 
     /* timestamp: fixed length, NUL-terminated */
-    stata_read_string(fp, 18, c50, &err);
-    pprintf(vprn, "timestamp: '%s'\n", c50);
-
-    if (*label != '\0' || *c50 != '\0') {
-        save_dataset_info(dset, label, c50);
-    }
+    stata_read_string(fp, 18, stamp, &err);
+    stamp[18] = '\0';
+    pprintf(vprn, "timestamp: '%s'\n", stamp);
 
     /** read variable descriptors **/
 
     /* types */
 
     types = malloc(nvar * sizeof *types);
-    if (types == NULL) {
-        return E_ALLOC;
+    vnames = strings_array_new_with_length(nvar, VNAMELEN);
+    if (types == NULL || vnames == NULL) {
+        err = E_ALLOC;
+        goto bailout;
     }
 
     err = check_old_variable_types(fp, types, nvar, &nsv, vprn);
+
+    /* variable names */
+    for (i=0; i<nvar && !err; i++) {
+        err = process_stata_varname(fp, aname, namelen,
+                                    vnames[i], i+1, vprn);
+    }
+
+    if (!err) {
+        vmap = dta_make_vmap(vnames, nvar, sel, &nsel, &err);
+    }
+
+    if (!err) {
+        if (nsel < nvar) {
+            pprintf(vprn, "importing %d of %d variables\n", nsel, nvar);
+        }
+        err = dta_dataset_setup(dset, vnames, vmap, nvar, nsel);
+    }
+
     if (err) {
-        free(types);
-        return err;
+        goto bailout;
     }
 
-    if (nsv > 0) {
-        /* we have 1 or more non-numeric variables */
-        *pst = dta_make_string_table(types, nvar, nsv);
+    if (*label != '\0' || *stamp != '\0') {
+        save_dataset_info(dset, label, stamp);
     }
 
-    /* variable names */
-    for (i=0; i<nvar && !err; i++) {
-        err = process_stata_varname(fp, aname, namelen,
-                                    dset, i+1, vprn);
+    if (nsv > 0) {
+        /* we have 1 or more non-numeric variables */
+        *pst = dta_make_string_table(types, vmap, nvar);
     }
 
     /* sortlist -- not relevant */
@@ -1723,8 +2152,8 @@ static int read_old_dta_data (FILE *fp, DATASET *dset,
     /* format list (use it to extract time-series info?) */
     for (i=0; i<nvar && !err; i++){
         stata_read_string(fp, fmtlen, c50, &err);
-        if (!err) {
-            process_stata_format(c50, i+1, &pd, &tvar, vprn);
+        if (!err && vmap[i] > 0) {
+            process_stata_format(c50, vmap[i], &pd, &tvar, vprn);
         }
     }
 
@@ -1733,17 +2162,18 @@ static int read_old_dta_data (FILE *fp, DATASET *dset,
     */
     for (i=0; i<nvar && !err; i++) {
         stata_read_string(fp, namelen + 1, aname, &err);
-        if (*aname != '\0' && !st_err) {
-            pprintf(vprn, "variable %d: value-label name = '%s'\n", i+1, aname);
-            st_err = push_label_info(&lvars, &lnames, i+1, aname);
+        if (*aname != '\0' && vmap[i] > 0 && !st_err) {
+            pprintf(vprn, "variable %d: value-label name = '%s'\n",
+                    vmap[i], aname);
+            st_err = push_label_info(&lvars, &lnames, vmap[i], aname);
         }
     }
 
     /* variable descriptive labels */
     for (i=0; i<nvar && !err; i++) {
         stata_read_string(fp, labellen, label, &err);
-        if (*label != '\0') {
-            process_stata_varlabel(label, dset, i+1, vprn);
+        if (*label != '\0' && vmap[i] > 0) {
+            process_stata_varlabel(label, dset, vmap[i], vprn);
         }
     }
 
@@ -1774,45 +2204,9 @@ static int read_old_dta_data (FILE *fp, DATASET *dset,
     }
 
     /* actual data values */
-    for (t=0; t<dset->n && !err; t++) {
-        for (i=0; i<nvar && !err; i++) {
-            int ix, v = i + 1;
-
-            dset->Z[v][t] = NADBL;
-
-            if (stata_type_float(types[i])) {
-                dset->Z[v][t] = stata_read_float(fp, &err);
-            } else if (stata_type_double(types[i])) {
-                dset->Z[v][t] = stata_read_double(fp, &err);
-            } else if (stata_type_long(types[i])) {
-                ix = stata_read_int32(fp, 0, &err);
-                dset->Z[v][t] = (ix == NA_INT)? NADBL : ix;
-            } else if (stata_type_int(types[i])) {
-                ix = stata_read_short(fp, 0, &err);
-                dset->Z[v][t] = (ix == NA_INT)? NADBL : ix;
-            } else if (stata_type_byte(types[i])) {
-                ix = stata_read_signed_byte(fp, 0, &err);
-                dset->Z[v][t] = (ix == NA_INT)? NADBL : ix;
-            } else {
-                /* a string variable */
-                clen = types[i] - soffset;
-#if STRDEBUG > 1
-                fprintf(stderr, "string: clen = %d\n", clen);
-#endif
-                if (clen > 255) {
-                    /* release <= 115: the max is supposed to be 244 */
-                    clen = 255;
-                }
-                stata_read_string(fp, clen, strbuf, &err);
-                strbuf[clen] = '\0';
-#if STRDEBUG > 1
-                fprintf(stderr, "Z[%d][%d] -> '%s'\n", v, t, strbuf);
-#endif
-                if (!err && *strbuf != '\0') {
-                    process_string_value(strbuf, *pst, dset, v, t, prn);
-                }
-            }
-        }
+    if (!err) {
+        err = read_dta_records(fp, dset, types, vmap, nvar, soffset,
+                               *pst, NULL, prn);
     }
 
     if (!err && tvar > 0) {
@@ -1844,10 +2238,14 @@ static int read_old_dta_data (FILE *fp, DATASET *dset,
     }
 
     if (!err) {
-        set_discreteness_from_types(dset, types, 0);
+        set_discreteness_from_types(dset, types, vmap, nvar, 0);
     }
 
+ bailout:
+
     free(types);
+    free(vmap);
+    strings_array_free(vnames, nvar);
 
     if (lvars != NULL) {
         strings_array_free(lnames, lvars[0]);
@@ -2139,8 +2537,9 @@ static int new_style_dta_file (FILE *fp)
     }
 }
 
-int dta_get_data (const char *fname, DATASET *dset,
-                  gretlopt opt, PRN *prn)
+static int real_dta_get_data (const char *fname, DATASET *dset,
+                              const dta_select *sel, gretlopt opt,
+                              PRN *prn)
 {
     dta_table *dtab = NULL;
     int namelen = 32;
@@ -2205,27 +2604,26 @@ int dta_get_data (const char *fname, DATASET *dset,
         return E_ALLOC;
     }
 
-    newset->v = nvar + 1;
+    /* the data array is allocated once we know which
+       variables are wanted */
     newset->n = nobs;
     dataset_obs_info_default(newset);
 
-    err = start_new_Z(newset, 0);
-    if (err) {
-        pputs(prn, _("Out of memory\n"));
-        free_datainfo(newset);
-        fclose(fp);
-        return E_ALLOC;
-    }
-
     if (stata_13) {
         if (dtab == NULL) {
             fprintf(stderr, "Got stata_13 but @dtab is NULL!\n");
             err = E_DATA;
         } else {
-            err = read_dta_117_data(fp, newset, &st, dtab, prn, vprn);
+            err = read_dta_117_data(fp, newset, &st, dtab, sel,
+                                    prn, vprn);
         }
     } else {
-        err = read_old_dta_data(fp, newset, &st, namelen, prn, vprn);
+        err = read_old_dta_data(fp, newset, &st, nvar, namelen, sel,
+                                prn, vprn);
+    }
+
+    if (err == E_ALLOC) {
+        pputs(prn, _("Out of memory\n"));
     }
 
     if (err) {
@@ -2257,3 +2655,26 @@ int dta_get_data (const char *fname, DATASET *dset,
 
     return err;
 }
+
+int dta_get_data (const char *fname, DATASET *dset,
+                  gretlopt opt, PRN *prn)
+{
+    return real_dta_get_data(fname, dset, NULL, opt, prn);
+}
+
+/* Import only the variables of a Stata data file that are
+   selected by name (@S) or by 1-based position (@cols).
+*/
+
+int dta_get_data_subset (const char *fname, DATASET *dset,
+                         char **S, int ns, const int *cols,
+                         gretlopt opt, PRN *prn)
+{
+    dta_select sel;
+
+    sel.S = S;
+    sel.ns = ns;
+    sel.cols = cols;
+
+    return real_dta_get_data(fname, dset, &sel, opt, prn);
+}
@@ -49,10 +49,9 @@ typedef struct fwd_wspace_ {
 typedef struct bwd_wspace_ {
     gretl_matrix_block *B; /* holder */
     gretl_matrix *iR;      /* R-inverse: k x k */
-    gretl_matrix *g;       /* k x 1 */
+    gretl_matrix *g;       /* Q'y: k x 1 */
     gretl_matrix *b;       /* k x 1 */
-    gretl_matrix *V;       /* k x k */
-    gretl_matrix *e;       /* T x 1 */
+    gretl_matrix *se;      /* k x 1 */
 } bwd_wspace;
 
 static int fwd_wspace_alloc (fwd_wspace *mm, int n, int zc)
@@ -84,13 +83,12 @@ static void fwd_wspace_free (fwd_wspace *mm)
     gretl_matrix_block_destroy(mm->B);
 }
 
-static int bwd_wspace_alloc (bwd_wspace *mm, int T, int k)
+static int bwd_wspace_alloc (bwd_wspace *mm, int k)
 {
     mm->B = gretl_matrix_block_new(&mm->iR, k, k,
                                    &mm->g, k, 1,
                                    &mm->b, k, 1,
-                                   &mm->V, k, k,
-                                   &mm->e, T, 1,
+                                   &mm->se, k, 1,
                                    NULL);
     if (mm->B == NULL) {
         return E_ALLOC;
@@ -103,8 +101,7 @@ static void bwd_wspace_shrink (bwd_wspace *mm)
 {
     mm->g->rows -= 1;
     mm->b->rows -= 1;
-    mm->V->rows -= 1;
-    mm->V->cols -= 1;
+    mm->se->rows -= 1;
     mm->iR->rows -= 1;
     mm->iR->cols -= 1;
 }
@@ -324,121 +321,79 @@ static int qr_augment (gretl_matrix *Q,
     return err;
 }
 
-static void fill_aj (double *aj, int vj,
-                     const DATASET *dset,
-                     const MODEL *pmod)
-{
-    int t, i = 0;
-
-    for (t=pmod->t1; t<=pmod->t2; t++) {
-        if (!na(pmod->uhat[t])) {
-            aj[i++] = dset->Z[vj][t];
-        }
-    }
-}
-
-/* The following function fixes up the trailing columns of the QR
-   decomposition of the matrix X of regressors following deletion of
-   column @jmin, when @jmin was not the last column. We assume that @Q
-   contains the correct decomposition of the columns of X to the left
-   of @jmin.
-
-   The code here is based on the concise account of the Gram-Schmidt
-   algorithm given by Igor Yanovsky at
-   https://www.math.ucla.edu/~yanovsky/Teaching/Math151B/handouts/GramSchmidt.pdf
+/* Update the triangular factor @R of the QR decomposition of the
+   regressor matrix X, along with @g = Q'y, following deletion of
+   column @j of X. Dropping column j of R leaves an upper Hessenberg
+   matrix in the trailing columns, which is restored to triangular
+   form by a sequence of Givens rotations applied to adjacent rows of
+   R and of g. Since Q is never needed thereafter there's no need to
+   rotate it, or to revisit the data; the last element of the rotated
+   g gives the increase in the sum of squared residuals, which is
+   written into @dssr.
 */
 
-void qr_fixup (gretl_matrix *Q,
-               gretl_matrix *R,
-               const MODEL *pmod,
-               const DATASET *dset,
-               const int *xlist,
-               int jmin)
+static void qr_delete_column (gretl_matrix *R,
+                              gretl_matrix *g,
+                              int j,
+                              double *dssr)
 {
-    double *aj;
-    double tmp;
-    int n = Q->rows;
-    int m = R->rows;
-    int i, j, vj, k;
-
-    aj = malloc(n * sizeof *aj);
-
-#if SDEBUG
-    printlist(xlist, "xlist, in qr_fixup");
-#endif
-
-    /* complete Q */
-    for (j=jmin; j<m; j++) {
-        vj = xlist[j+2];
-#if SDEBUG
-        fprintf(stderr, "Q: work on col %d, using %s\n", j,
-                dset->varname[vj]);
-#endif
-        fill_aj(aj, vj, dset, pmod);
-        for (i=0; i<j; i++) {
-            tmp = 0.0;
-            for (k=0; k<n; k++) {
-                tmp += aj[k] * gretl_matrix_get(Q, k, i);
-            }
-            for (k=0; k<n; k++) {
-                aj[k] -= tmp * gretl_matrix_get(Q, k, i);
-            }
+    int k = R->rows;
+    double a, b, c, s, r;
+    double x, y;
+    int i, l;
+
+    matrix_drop_column(R, j);
+
+    for (i=j; i<k-1; i++) {
+        a = gretl_matrix_get(R, i, i);
+        b = gretl_matrix_get(R, i+1, i);
+        if (b == 0.0) {
+            continue;
         }
-        tmp = 0.0;
-        for (i=0; i<n; i++) {
-            tmp += aj[i] * aj[i];
-        }
-        tmp = sqrt(tmp);
-        for (i=0; i<n; i++) {
-            gretl_matrix_set(Q, i, j, aj[i]/tmp);
+        r = hypot(a, b);
+        c = a / r;
+        s = b / r;
+        for (l=i; l<k-1; l++) {
+            x = gretl_matrix_get(R, i, l);
+            y = gretl_matrix_get(R, i+1, l);
+            gretl_matrix_set(R, i, l, c * x + s * y);
+            gretl_matrix_set(R, i+1, l, -s * x + c * y);
         }
+        gretl_matrix_set(R, i+1, i, 0.0);
+        x = g->val[i];
+        y = g->val[i+1];
+        g->val[i] = c * x + s * y;
+        g->val[i+1] = -s * x + c * y;
     }
 
-    /* complete R */
-    for (i=jmin; i<m; i++) {
-        for (j=i; j<m; j++) {
-            vj = xlist[j+2];
-            fill_aj(aj, vj, dset, pmod);
-            tmp = 0.0;
-            for (k=0; k<n; k++) {
-                tmp += aj[k] * gretl_matrix_get(Q, k, i);
-            }
-            gretl_matrix_set(R, i, j, tmp);
-        }
-    }
+    *dssr = g->val[k-1] * g->val[k-1];
 
-    free(aj);
+    /* R is now k x (k-1) with a zero last row: trim it */
+    for (l=0; l<k-1; l++) {
+        memmove(R->val + l * (k-1), R->val + l * k,
+                (k-1) * sizeof(double));
+    }
+    R->rows -= 1;
 }
 
-static int qr_reduce (gretl_matrix *Q,
-                      gretl_matrix *R,
-                      const MODEL *pmod,
-                      const DATASET *dset,
-                      const int *xlist,
+/* Compute coefficients and standard errors from @R and @g = Q'y after
+   deletion of regressor @delcol. The diagonal of (X'X)^{-1} is given
+   by the squared row norms of R-inverse, so the k x k product
+   inv(R)*inv(R)' is not required.
+*/
+
+static int qr_reduce (gretl_matrix *R,
                       int delcol,
-                      const gretl_matrix *y,
+                      int T,
                       bwd_wspace *mm,
                       double *ssr)
 {
-    int T = Q->rows;
-    double s2, vii;
-    int i, k;
+    double s2, vii, rij, dssr;
+    int i, j, k;
     int err = 0;
 
-    matrix_drop_column(Q, delcol);
-    matrix_drop_index(R, delcol);
-
-    /* If we deleted any column other than the last, we have
-       some extra work to do.
-    */
-    if (delcol < Q->cols) {
-        qr_fixup(Q, R, pmod, dset, xlist, delcol);
-    }
-#if SDEBUG
-    fprintf(stderr, "dropped Q[,%d] (var %d, %s), %s\n", delcol,
-            xlist[delcol+1], dset->varname[xlist[delcol+1]],
-            delcol < Q->cols ? "fixup needed" : "no fixup");
-#endif
+    qr_delete_column(R, mm->g, delcol, &dssr);
+    *ssr += dssr;
 
     bwd_wspace_shrink(mm);
     k = R->rows;
@@ -450,39 +405,22 @@ static int qr_reduce (gretl_matrix *Q,
     }
 
 #if SDEBUG > 1
-    gretl_matrix_print(Q, "Q, in qr_reduce");
     gretl_matrix_print(R, "R, in qr_reduce");
     gretl_matrix_print(mm->iR, "iR, in qr_reduce");
 #endif
 
-    /* g = Q'y */
-    gretl_matrix_multiply_mod(Q, GRETL_MOD_TRANSPOSE,
-                              y, GRETL_MOD_NONE,
-                              mm->g, GRETL_MOD_NONE);
     /* b = inv(R) * g */
     gretl_matrix_multiply(mm->iR, mm->g, mm->b);
 
-    /* e = residuals */
-    gretl_matrix_copy_values(mm->e, y);
-    gretl_matrix_multiply_mod(Q, GRETL_MOD_NONE,
-                              mm->g, GRETL_MOD_NONE,
-                              mm->e, GRETL_MOD_DECREMENT);
-
-    /* V [= (X'X)^{-1}] = inv(R)*inv(R)' */
-    gretl_matrix_multiply_mod(mm->iR, GRETL_MOD_NONE,
-                              mm->iR, GRETL_MOD_TRANSPOSE,
-                              mm->V, GRETL_MOD_NONE);
-
-    *ssr = 0.0;
-    for (i=0; i<T; i++) {
-        *ssr += mm->e->val[i] * mm->e->val[i];
-    }
     s2 = *ssr / (T - k);
 
-    /* g <- std errors */
     for (i=0; i<k; i++) {
-        vii = gretl_matrix_get(mm->V, i, i);
-        mm->g->val[i] = sqrt(s2 * vii);
+        vii = 0.0;
+        for (j=i; j<k; j++) {
+            rij = gretl_matrix_get(mm->iR, i, j);
+            vii += rij * rij;
+        }
+        mm->se->val[i] = sqrt(s2 * vii);
     }
 
     return err;
@@ -692,10 +630,21 @@ static int crit_na_error (double ssr, int T, int k,
     return E_NAN;
 }
 
+/* Sequential elimination of regressors, starting from the QR
+   decomposition of the full regressor matrix. Each deletion is
+   handled by updating R and Q'y in place (see qr_delete_column()),
+   so the data are read only once. If @crit is C_SSR we work with
+   the p-value of the least significant coefficient, which is dropped
+   if it exceeds @alpha; otherwise the regressor with the smallest
+   absolute t-ratio is dropped provided this improves on the given
+   information criterion.
+*/
+
 int *backward_stepwise (MODEL *pmod,
                         const int *zlist,
                         DATASET *dset,
                         int crit,
+                        double alpha,
                         int verbose,
                         int droplen,
                         int namelen,
@@ -703,13 +652,16 @@ int *backward_stepwise (MODEL *pmod,
                         int *err)
 {
     const char *cstr;
+    const double *b = pmod->coeff;
+    const double *se = pmod->sderr;
     gretl_matrix *Q;
     gretl_matrix *R = NULL;
     gretl_matrix *y = NULL;
     char *mask = NULL;
     int *xlist = NULL;
     bwd_wspace mm = {0};
-    double cur, prev, ssr;
+    double cur = NADBL, prev, ssr;
+    double pval = NADBL;
     int ifc = pmod->ifc;
     int T = pmod->nobs;
     int k = pmod->ncoeff;
@@ -718,11 +670,11 @@ int *backward_stepwise (MODEL *pmod,
     int conv = 0;
     int trycol, delvar;
     int nz, dropped = 0;
+    int t;
 
     prev = ssr2crit(pmod->ess, T, k, crit);
     xlist = gretl_model_get_x_list(pmod);
-    trycol = tval_min_pos(pmod->coeff, pmod->sderr,
-                          xlist, zlist, ifc, k, err);
+    trycol = tval_min_pos(b, se, xlist, zlist, ifc, k, err);
     if (*err) {
         pprintf(prn, "Failed to find minimum absolute t-ratio\n");
         return NULL;
@@ -739,54 +691,88 @@ int *backward_stepwise (MODEL *pmod,
     if (!*err && (y == NULL || R == NULL)) {
         *err = E_ALLOC;
     }
+    if (!*err) {
+        *err = bwd_wspace_alloc(&mm, k);
+    }
     if (*err) {
         goto bailout;
     }
 
     gretl_matrix_QR_decomp(Q, R);
 
+    /* g = Q'y, and the SSR of the full model */
+    gretl_matrix_multiply_mod(Q, GRETL_MOD_TRANSPOSE,
+                              y, GRETL_MOD_NONE,
+                              mm.g, GRETL_MOD_NONE);
+    gretl_matrix_multiply_mod(Q, GRETL_MOD_NONE,
+                              mm.g, GRETL_MOD_NONE,
+                              y, GRETL_MOD_DECREMENT);
+    ssr = 0.0;
+    for (t=0; t<T; t++) {
+        ssr += y->val[t] * y->val[t];
+    }
+    /* from here on we don't need the data */
+    gretl_matrix_free(Q);
+    gretl_matrix_free(y);
+    Q = y = NULL;
+
     nz = zlist != NULL ? zlist[0] : xlist[0] - ifc;
     cstr = crit_string(crit);
-    bwd_wspace_alloc(&mm, Q->rows, R->rows);
 
-    if (verbose) {
+    if (verbose && crit != C_SSR) {
         pprintf(prn, " %-*s %s = %#g\n", droplen + namelen + 1,
                 _("Baseline"), cstr, prev);
     }
 
     while (!conv && dropped < nz) {
         delvar = xlist[trycol+1];
-        *err = qr_reduce(Q, R, pmod, dset, xlist, trycol, y, &mm, &ssr);
+        if (crit == C_SSR) {
+            pval = coeff_pval(OLS, fabs(b[trycol] / se[trycol]), T - k);
+            if (pval <= alpha) {
+                conv = 1;
+                break;
+            }
+        }
+        *err = qr_reduce(R, trycol, T, &mm, &ssr);
         if (*err) {
             pprintf(prn, "Error in qr_reduce when dropping %s\n",
                     dset->varname[delvar]);
             break;
         }
         k = R->rows;
-        cur = ssr2crit(ssr, T, k, crit);
-        if (na(cur)) {
-            *err = crit_na_error(ssr, T, k, cstr, prn);
-            break;
-        }
-        conv = cur > prev;
-        if (verbose) {
-            if (conv && dropped < nz) {
-                pprintf(prn, " [%-*s %s = %#g]\n", namelen + droplen,
-                        dset->varname[delvar], cstr, cur);
-            } else {
-                pprintf(prn, " %s %-*s %s = %#g\n", _("Drop"), namelen,
-                        dset->varname[delvar], cstr, cur);
+        if (crit == C_SSR) {
+            if (verbose) {
+                pprintf(prn, " %s %-*s p-value = %#g\n", _("Drop"),
+                        namelen, dset->varname[delvar], pval);
+            }
+        } else {
+            cur = ssr2crit(ssr, T, k, crit);
+            if (na(cur)) {
+                *err = crit_na_error(ssr, T, k, cstr, prn);
+                break;
+            }
+            conv = cur > prev;
+            if (verbose) {
+                if (conv && dropped < nz) {
+                    pprintf(prn, " [%-*s %s = %#g]\n", namelen + droplen,
+                            dset->varname[delvar], cstr, cur);
+                } else {
+                    pprintf(prn, " %s %-*s %s = %#g\n", _("Drop"), namelen,
+                            dset->varname[delvar], cstr, cur);
+                }
             }
         }
         if (!conv) {
             gretl_list_delete_at_pos(xlist, trycol+1);
-            trycol = tval_min_pos(mm.b->val, mm.g->val, xlist, zlist,
-                                  ifc, k, err);
-            if (*err) {
-                break;
-            } else {
-                dropped++;
-                prev = cur;
+            dropped++;
+            prev = cur;
+            if (dropped < nz) {
+                b = mm.b->val;
+                se = mm.se->val;
+                trycol = tval_min_pos(b, se, xlist, zlist, ifc, k, err);
+                if (*err) {
+                    break;
+                }
             }
         }
     }
@@ -1055,9 +1041,8 @@ static int *maybe_reorder_regressors (MODEL *pmod)
 }
 
 /* Implement "omit --auto=..." using backward stepwise procedure.
-   Note: @alpha is unused at present, since backward_stepwise() above
-   doesn't handle the p-value criterion for omission. (That's handled
-   in lib/src/compare.c.)
+   If @crit is C_SSR (the p-value criterion) @alpha gives the maximum
+   p-value for retention of a regressor.
 */
 
 MODEL stepwise_omit (MODEL *pmod,
@@ -1091,10 +1076,15 @@ MODEL stepwise_omit (MODEL *pmod,
         int droplen = verbose ? g_utf8_strlen(_("Drop"), -1) : 0;
 
 	if (verbose) {
-	    pprintf(prn, _("Sequential elimination using %s"), crit_string(crit));
+            if (crit == C_SSR) {
+                pprintf(prn, _("Sequential elimination using %s"), "p-value");
+                pprintf(prn, " (α = %.2f)", alpha);
+            } else {
+                pprintf(prn, _("Sequential elimination using %s"), crit_string(crit));
+            }
 	    pputs(prn, "\n\n");
 	}
-        xlist = backward_stepwise(mptr, zlist, dset, crit,
+        xlist = backward_stepwise(mptr, zlist, dset, crit, alpha,
                                   verbose, droplen, namelen + 2,
                                   prn, &err);
         if (mptr != pmod) {
@@ -1127,7 +1117,7 @@ MODEL stepwise_omit (MODEL *pmod,
             do_overall_test(pmod, &model);
         }
         dset->t1 = save_t1;
-        dset->t1 = save_t2;
+        dset->t2 = save_t2;
     }
 
     free(xlist);
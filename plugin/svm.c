@@ -1542,6 +1542,24 @@ static void print_xvalid_iter (sv_parm *parm,
     gretl_flush(prn);
 }
 
+/* print the criterion @crit, as computed by xvalidate_once() */
+
+static void print_xvalid_result (sv_parm *parm,
+				 sv_wrapper *w,
+				 double crit,
+				 int iter,
+				 PRN *prn)
+{
+    if (doing_regression(parm)) {
+	const char *s = (w->regcrit == REG_MSE)? "MSE" :
+	    (w->regcrit == REG_ROUND_MISS)? "miss ratio" : "MAD";
+
+	print_xvalid_iter(parm, w, -crit, s, iter, prn);
+    } else {
+	print_xvalid_iter(parm, w, crit, "percent correct", iter, prn);
+    }
+}
+
 static int *get_fold_sizes (const sv_data *data,
 			    sv_wrapper *w,
 			    const DATASET *dset)
@@ -1586,6 +1604,15 @@ static void custom_xvalidate (const sv_data *prob,
 {
     int i, vi, ni;
 
+    /* The folds are independent, and each writes its own elements
+       of @targ. But if probability estimates are wanted, training
+       draws random numbers, so we stay with a single thread to
+       keep the results reproducible.
+    */
+#if defined(_OPENMP)
+#pragma omp parallel for private(i, vi, ni) schedule(dynamic, 1) \
+    if (!parm->probability && gretl_use_openmp((guint64) prob->l * w->k))
+#endif
     for (i=0; i<w->nfold; i++) {
 	struct svm_problem subprob;
 	struct svm_model *submodel;
@@ -1684,12 +1711,6 @@ static int xvalidate_once (sv_data *prob,
 	    }
 	}
 	minimand /= n;
-	if (prn != NULL) {
-	    const char *s = (w->regcrit == REG_MSE)? "MSE" :
-		(w->regcrit == REG_ROUND_MISS)? "miss ratio" : "MAD";
-
-	    print_xvalid_iter(parm, w, minimand, s, iter, prn);
-	}
 	*crit = -minimand;
     } else {
 	/* classification */
@@ -1702,13 +1723,13 @@ static int xvalidate_once (sv_data *prob,
 	    }
 	}
 	pc_correct = 100.0 * n_correct / (double) n;
-	if (prn != NULL) {
-	    print_xvalid_iter(parm, w, pc_correct,
-			      "percent correct", iter, prn);
-	}
 	*crit = pc_correct;
     }
 
+    if (prn != NULL) {
+	print_xvalid_result(parm, w, *crit, iter, prn);
+    }
+
     return 0;
 }
 
@@ -2390,6 +2411,109 @@ static int call_mpi_cross_validation (sv_data *data,
 
 #endif /* HAVE_MPI */
 
+#if defined(_OPENMP)
+
+static void set_grid_point (sv_parm *parm, sv_grid *grid,
+			    int i, int j, int k)
+{
+    if (!grid->null[G_C]) {
+	parm->C = grid_get_C(grid, i);
+    }
+    if (!grid->null[G_g]) {
+	parm->gamma = grid_get_g(grid, j);
+    }
+    if (!grid->null[G_p]) {
+	if (uses_epsilon(parm)) {
+	    parm->p = grid_get_p(grid, k);
+	} else if (uses_nu(parm)) {
+	    parm->nu = grid_get_p(grid, k);
+	}
+    }
+}
+
+/* Decide how many threads to use for a parameter search over
+   @npts grid points. Each point is handled by a single thread,
+   which is OK provided the folds are the same at every point
+   (either given by the caller, or random folds regenerated
+   from the same seed).
+*/
+
+static int svm_grid_threads (const sv_data *data,
+			     const sv_wrapper *w,
+			     int npts)
+{
+    int nt = gretl_get_omp_threads();
+
+    if (nt < 2 || npts < 2) {
+	return 1;
+    } else if (w->fsize == NULL && (w->flags & W_REFOLD)) {
+	return 1;
+    } else if (!gretl_use_openmp((guint64) npts * data->l * w->k)) {
+	return 1;
+    }
+
+    return nt > npts ? npts : nt;
+}
+
+/* Compute the cross validation criterion at all points of the
+   search grid in parallel, if that looks worthwhile, returning
+   the values in the order in which the serial code visits the
+   points. A NULL return means the search should be done serially.
+*/
+
+static double *parallel_grid_search (sv_data *data,
+				     const sv_parm *parm,
+				     sv_wrapper *w)
+{
+    sv_grid *grid = w->grid;
+    int ng = grid->n[G_g];
+    int np = grid->n[G_p];
+    int npts = grid->n[G_C] * ng * np;
+    int nt = svm_grid_threads(data, w, npts);
+    double *crits;
+    int iter, err = 0;
+
+    if (nt < 2) {
+	return NULL;
+    }
+
+    crits = malloc(npts * sizeof *crits);
+    if (crits == NULL) {
+	return NULL;
+    }
+
+#pragma omp parallel num_threads(nt) private(iter)
+    {
+	sv_parm myparm = *parm;
+	double *mytarg = malloc(data->l * sizeof *mytarg);
+
+#pragma omp for schedule(dynamic, 1)
+	for (iter=0; iter<npts; iter++) {
+	    if (mytarg != NULL) {
+		set_grid_point(&myparm, grid, iter / (ng * np),
+			       (iter / np) % ng, iter % np);
+		xvalidate_once(data, &myparm, w, mytarg, &crits[iter],
+			       iter, NULL);
+	    }
+	}
+
+	if (mytarg == NULL) {
+#pragma omp critical (svm_grid_err)
+	    err = E_ALLOC;
+	}
+	free(mytarg);
+    }
+
+    if (err) {
+	free(crits);
+	crits = NULL;
+    }
+
+    return crits;
+}
+
+#endif /* _OPENMP */
+
 static int call_cross_validation (sv_data *data,
 				  sv_parm *parm,
 				  sv_wrapper *w,
@@ -2414,6 +2538,7 @@ static int call_cross_validation (sv_data *data,
 	sv_grid *grid = w->grid;
 	double cmax = -DBL_MAX;
 	double *p3 = NULL;
+	double *crits = NULL;
 	int nC = grid->n[G_C];
 	int ng = grid->n[G_g];
 	int np = grid->n[G_p];
@@ -2440,6 +2565,10 @@ static int call_cross_validation (sv_data *data,
 
 	maybe_hush(w);
 
+#if defined(_OPENMP)
+	crits = parallel_grid_search(data, parm, w);
+#endif
+
 	for (i=0; i<nC; i++) {
 	    if (!grid->null[G_C]) {
 		parm->C = grid_get_C(grid, i);
@@ -2452,7 +2581,14 @@ static int call_cross_validation (sv_data *data,
 		    if (!grid->null[G_p]) {
 			*p3 = grid_get_p(grid, k);
 		    }
-		    xvalidate_once(data, parm, w, targ, &crit, iter, prn);
+		    if (crits != NULL) {
+			crit = crits[iter];
+			if (prn != NULL) {
+			    print_xvalid_result(parm, w, crit, iter, prn);
+			}
+		    } else {
+			xvalidate_once(data, parm, w, targ, &crit, iter, prn);
+		    }
 		    if (crit > cmax) {
 			cmax = crit;
 			ibest = i;
@@ -2473,6 +2609,7 @@ static int call_cross_validation (sv_data *data,
 	}
 
 	maybe_resume_printing(w);
+	free(crits);
 
 	if (!grid->null[G_C]) {
 	    parm->C = grid_get_C(grid, ibest);
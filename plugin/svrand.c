@@ -5,6 +5,12 @@
 #include <stddef.h>
 
 static uint64_t smx;
+static uint64_t s[4];
+
+#if defined(_OPENMP)
+/* each thread doing cross validation gets its own stream */
+#pragma omp threadprivate(smx, s)
+#endif
 
 static inline uint64_t splitmix64_next() {
     uint64_t z = (smx += 0x9e3779b97f4a7c15);
@@ -18,8 +24,6 @@ static inline uint64_t xor_rotl (const uint64_t x, int k) {
     return (x << k) | (x >> (64 - k));
 }
 
-static uint64_t s[4];
-
 static void set_xor_state (uint64_t u)
 {
     s[0] = smx = u;
@@ -24,6 +24,11 @@
 #include "system.h"
 #include "tsls.h"
 #include "sysml.h"
+#include "gretl_mt.h"
+
+#ifdef _OPENMP
+# include <omp.h>
+#endif
 
 #define SDEBUG 0
 
@@ -504,45 +509,40 @@ static int hansen_sargan_test (equation_system *sys,
                                const DATASET *dset)
 {
     const int *exlist = system_get_instr_vars(sys);
-    const double *Wi, *Wj;
     int nx = exlist[0];
     int m = sys->neqns;
     int T = sys->T;
     int df = system_get_overid_df(sys);
     gretl_matrix_block *B;
-    gretl_matrix *WTW, *eW, *tmp;
-    double x, X2;
-    int i, j, t;
+    gretl_matrix *W, *WTW, *eW, *tmp, *eWe;
+    double X2;
+    int i, j;
     int err = 0;
 
     if (df <= 0) {
         return 1;
     }
 
-    B = gretl_matrix_block_new(&WTW, nx, nx,
+    B = gretl_matrix_block_new(&W, T, nx,
+                               &WTW, nx, nx,
                                &eW, m, nx,
                                &tmp, m, nx,
+                               &eWe, m, m,
                                NULL);
     if (B == NULL) {
         return E_ALLOC;
     }
 
-    /* construct W-transpose W in WTW */
     for (i=0; i<nx; i++) {
-        Wi = dset->Z[exlist[i+1]] + sys->t1;
-        for (j=i; j<nx; j++) {
-            Wj = dset->Z[exlist[j+1]] + sys->t1;
-            x = 0.0;
-            for (t=0; t<sys->T; t++) {
-                x += Wi[t] * Wj[t];
-            }
-            gretl_matrix_set(WTW, i, j, x);
-            if (i != j) {
-                gretl_matrix_set(WTW, j, i, x);
-            }
-        }
+        memcpy(W->val + (size_t) i * T, dset->Z[exlist[i+1]] + sys->t1,
+               T * sizeof(double));
     }
 
+    /* construct W-transpose W in WTW */
+    gretl_matrix_multiply_mod(W, GRETL_MOD_TRANSPOSE,
+                              W, GRETL_MOD_NONE,
+                              WTW, GRETL_MOD_NONE);
+
     err = gretl_invert_symmetric_matrix(WTW);
 #if SDEBUG
     fprintf(stderr, "hansen_sargan: on invert, err=%d\n", err);
@@ -555,39 +555,22 @@ static int hansen_sargan_test (equation_system *sys,
     /* set up vectors of SUR or 3SLS residuals, transposed,
        times W; these are stacked in the m * nx matrix eW
     */
-    for (i=0; i<m; i++) {
-        for (j=0; j<nx; j++) {
-            Wj = dset->Z[exlist[j+1]] + sys->t1;
-            x = 0.0;
-            for (t=0; t<T; t++) {
-                x += gretl_matrix_get(sys->E, t, i) * Wj[t];
-            }
-            gretl_matrix_set(eW, i, j, x);
-        }
-    }
+    gretl_matrix_multiply_mod(sys->E, GRETL_MOD_TRANSPOSE,
+                              W, GRETL_MOD_NONE,
+                              eW, GRETL_MOD_NONE);
 
-    /* multiply these vectors into (WTW)^{-1} */
-    for (i=0; i<m; i++) {
-        for (j=0; j<nx; j++) {
-            x = 0.0;
-            for (t=0; t<nx; t++) {
-                x += gretl_matrix_get(eW, i, t) *
-                    gretl_matrix_get(WTW, t, j);
-            }
-            gretl_matrix_set(tmp, i, j, x);
-        }
-    }
+    /* multiply these vectors into (WTW)^{-1} and back into eW */
+    gretl_matrix_multiply(eW, WTW, tmp);
+    gretl_matrix_multiply_mod(tmp, GRETL_MOD_NONE,
+                              eW, GRETL_MOD_TRANSPOSE,
+                              eWe, GRETL_MOD_NONE);
 
     /* cumulate the Chi-square value */
     X2 = 0.0;
     for (i=0; i<m; i++) {
         for (j=0; j<m; j++) {
-            x = 0.0;
-            for (t=0; t<nx; t++) {
-                x += gretl_matrix_get(tmp, i, t) *
-                    gretl_matrix_get(eW, j, t); /* transposed */
-            }
-            X2 += gretl_matrix_get(sys->S, i, j) * x;
+            X2 += gretl_matrix_get(sys->S, i, j) *
+                gretl_matrix_get(eWe, i, j);
         }
     }
 
@@ -947,19 +930,250 @@ static gretlopt sys_ols_opt (equation_system *sys,
     return  ols_opt;
 }
 
-static int allocate_Xi_etc (gretl_matrix **Xi,
-                            gretl_matrix **Xj,
-                            gretl_matrix **M,
-                            int T, int k)
+/* Cross-products of the regressors, and of the regressors with the
+   dependent variables, for all the equations in a system. These don't
+   change across iterations of SUR or 3SLS, so we compute them once and
+   then just reweight them by the elements of sigma-inverse on each
+   pass. In @ZZ only the diagonal blocks are computed when @full is
+   zero, as is the case for the single-equation estimators; in that
+   case column i of @Zy is filled only for the rows pertaining to
+   equation i.
+*/
+
+typedef struct sys_xprods_ sys_xprods;
+
+struct sys_xprods_ {
+    gretl_matrix *ZZ;  /* mk x mk: Z'Z, or Z'L for LIML */
+    gretl_matrix *Zy;  /* mk x m: Z'y_l, l = 1 to m */
+    int *eq;           /* equation to which each regressor belongs */
+    int full;          /* are the off-diagonal blocks wanted? */
+};
+
+static void sys_xprods_free (sys_xprods *xp)
 {
-    *Xi = gretl_matrix_alloc(T, k);
-    *Xj = gretl_matrix_alloc(T, k);
-    *M = gretl_matrix_alloc(k, k);
+    if (xp != NULL) {
+        gretl_matrix_free(xp->ZZ);
+        gretl_matrix_free(xp->Zy);
+        free(xp->eq);
+        free(xp);
+    }
+}
 
-    if (*Xi == NULL || *Xj == NULL || *M == NULL) {
-        return E_ALLOC;
+/* Fill the stacked T x mk matrix @Z with the regressors for each
+   equation (or the LIML k-class data if @liml is non-zero), one
+   equation per thread.
+*/
+
+static int sys_fill_stacked_X (equation_system *sys, DATASET *dset,
+                               gretl_matrix *Z, const int *offset,
+                               int liml)
+{
+    int T = sys->T;
+    int i, err = 0;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) T * Z->cols))
+#endif
+    for (i=0; i<sys->neqns; i++) {
+        gretl_matrix Zi;
+        int ierr;
+
+        gretl_matrix_init(&Zi);
+        Zi.rows = T;
+        Zi.val = Z->val + (size_t) offset[i] * T;
+        if (liml) {
+            ierr = make_liml_X_block(&Zi, sys->models[i], dset, sys->t1);
+        } else {
+            ierr = make_sys_X_block(&Zi, sys->models[i], dset, sys->t1,
+                                    sys->method);
+        }
+        if (ierr) {
+#if defined(_OPENMP)
+#pragma omp critical
+#endif
+            err = ierr;
+        }
+    }
+
+    return err;
+}
+
+static sys_xprods *sys_xprods_new (equation_system *sys, DATASET *dset,
+                                   int mk, int full, int *err)
+{
+    int liml = (sys->method == SYS_METHOD_LIML);
+    int m = sys->neqns;
+    int T = sys->T;
+    gretl_matrix *Z = NULL;
+    gretl_matrix *L = NULL;
+    gretl_matrix *Y = NULL;
+    sys_xprods *xp;
+    int *offset;
+    int i, j, r;
+
+    xp = malloc(sizeof *xp);
+    offset = malloc((m + 1) * sizeof *offset);
+    if (xp == NULL || offset == NULL) {
+        free(xp);
+        free(offset);
+        *err = E_ALLOC;
+        return NULL;
+    }
+
+    xp->ZZ = gretl_zero_matrix_new(mk, mk);
+    xp->Zy = gretl_zero_matrix_new(mk, m);
+    xp->eq = malloc(mk * sizeof *xp->eq);
+    xp->full = full;
+
+    Z = gretl_matrix_alloc(T, mk);
+    Y = gretl_matrix_alloc(T, m);
+    if (liml) {
+        L = gretl_matrix_alloc(T, mk);
     } else {
-        return 0;
+        L = Z;
+    }
+
+    if (xp->ZZ == NULL || xp->Zy == NULL || xp->eq == NULL ||
+        Z == NULL || Y == NULL || L == NULL) {
+        *err = E_ALLOC;
+        goto bailout;
+    }
+
+    offset[0] = r = 0;
+    for (i=0; i<m; i++) {
+        const double *yi;
+
+        for (j=0; j<sys->models[i]->ncoeff; j++) {
+            xp->eq[r++] = i;
+        }
+        offset[i+1] = r;
+        if (liml) {
+            yi = gretl_model_get_data(sys->models[i], "liml_y");
+        } else {
+            yi = dset->Z[system_get_depvar(sys, i)];
+        }
+        if (yi == NULL) {
+            *err = E_DATA;
+            goto bailout;
+        }
+        memcpy(Y->val + (size_t) i * T, yi + sys->t1, T * sizeof *yi);
+    }
+
+    *err = sys_fill_stacked_X(sys, dset, Z, offset, 0);
+    if (!*err && liml) {
+        *err = sys_fill_stacked_X(sys, dset, L, offset, 1);
+    }
+    if (*err) {
+        goto bailout;
+    }
+
+    if (full) {
+        *err = gretl_matrix_multiply_mod(Z, GRETL_MOD_TRANSPOSE,
+                                         L, GRETL_MOD_NONE,
+                                         xp->ZZ, GRETL_MOD_NONE);
+        if (!*err) {
+            *err = gretl_matrix_multiply_mod(Z, GRETL_MOD_TRANSPOSE,
+                                             Y, GRETL_MOD_NONE,
+                                             xp->Zy, GRETL_MOD_NONE);
+        }
+        goto bailout;
+    }
+
+    /* diagonal blocks only, one regressor per thread */
+#if defined(_OPENMP)
+#pragma omp parallel for private(j) if (gretl_use_openmp((guint64) T * mk))
+#endif
+    for (r=0; r<mk; r++) {
+        int ir = xp->eq[r];
+        const double *zr = Z->val + (size_t) r * T;
+        const double *yr = Y->val + (size_t) ir * T;
+        double x;
+        int t;
+
+        for (j=offset[ir]; j<offset[ir+1]; j++) {
+            const double *lj = L->val + (size_t) j * T;
+
+            x = 0.0;
+            for (t=0; t<T; t++) {
+                x += zr[t] * lj[t];
+            }
+            gretl_matrix_set(xp->ZZ, r, j, x);
+        }
+        x = 0.0;
+        for (t=0; t<T; t++) {
+            x += zr[t] * yr[t];
+        }
+        gretl_matrix_set(xp->Zy, r, ir, x);
+    }
+
+ bailout:
+
+    gretl_matrix_free(Z);
+    gretl_matrix_free(Y);
+    if (L != Z) {
+        gretl_matrix_free(L);
+    }
+    free(offset);
+
+    if (*err) {
+        sys_xprods_free(xp);
+        xp = NULL;
+    }
+
+    return xp;
+}
+
+/* Form the mk x mk normal-equations matrix in the top-left of @X and
+   the right-hand side in @y, weighting the cached cross-product
+   blocks by the elements of sigma-inverse (or by 1 if @unit is
+   non-zero). If @diag is non-zero the off-diagonal blocks are zeroed.
+   This is the Kronecker structure of SUR/3SLS, without the Kronecker
+   product: block (i,j) of X is s^{ij} X_i'X_j and segment i of y is
+   sum_l s^{il} X_i'y_l.
+*/
+
+static void sys_normal_equations (equation_system *sys,
+                                  const sys_xprods *xp,
+                                  gretl_matrix *X, gretl_matrix *y,
+                                  int mk, int diag, int unit)
+{
+    const gretl_matrix *S = sys->S;
+    int m = sys->neqns;
+    int c;
+
+#if defined(_OPENMP)
+#pragma omp parallel for if (gretl_use_openmp((guint64) mk * mk))
+#endif
+    for (c=0; c<mk; c++) {
+        int jc = xp->eq[c];
+        double sij, x;
+        int r, ir, l;
+
+        for (r=0; r<mk; r++) {
+            ir = xp->eq[r];
+            if (ir == jc) {
+                sij = unit ? 1.0 : gretl_matrix_get(S, ir, jc);
+            } else if (diag) {
+                sij = 0.0;
+            } else {
+                sij = gretl_matrix_get(S, ir, jc);
+            }
+            x = gretl_matrix_get(xp->ZZ, r, c);
+            gretl_matrix_set(X, r, c, sij * x);
+        }
+
+        /* element c of the right-hand side */
+        if (diag) {
+            sij = unit ? 1.0 : gretl_matrix_get(S, jc, jc);
+            x = sij * gretl_matrix_get(xp->Zy, c, jc);
+        } else {
+            x = 0.0;
+            for (l=0; l<m; l++) {
+                x += gretl_matrix_get(S, jc, l) *
+                    gretl_matrix_get(xp->Zy, c, l);
+            }
+        }
+        gretl_vector_set(y, c, x);
     }
 }
 
@@ -1017,15 +1231,13 @@ static int ols_data_to_sys (equation_system *sys, int mk)
 int system_estimate (equation_system *sys, DATASET *dset,
                      gretlopt opt, PRN *prn)
 {
-    int i, j, k, T, t;
-    int v, l, mk, krow, nr;
+    int i, T, t;
+    int mk, nr;
     int orig_t1 = dset->t1;
     int orig_t2 = dset->t2;
     gretl_matrix *X = NULL;
     gretl_matrix *y = NULL;
-    gretl_matrix *Xi = NULL;
-    gretl_matrix *Xj = NULL;
-    gretl_matrix *M = NULL;
+    sys_xprods *xp = NULL;
     gretl_matrix **pX = NULL;
     gretl_matrix **py = NULL;
     MODEL **models = NULL;
@@ -1085,9 +1297,6 @@ int system_estimate (equation_system *sys, DATASET *dset,
     dset->t1 = sys->t1;
     dset->t2 = sys->t2;
 
-    /* max indep vars per equation */
-    k = system_max_indep_vars(sys);
-
     /* total indep vars, all equations */
     mk = system_n_indep_vars(sys);
 
@@ -1213,10 +1422,9 @@ int system_estimate (equation_system *sys, DATASET *dset,
     gls_sigma_from_uhat(sys, sys->S, 0);
 
     if (method == SYS_METHOD_WLS) {
-        gretl_matrix_zero(X);
         err = gretl_invert_diagonal_matrix(sys->S);
     } else if (single_equation || rsingle) {
-        gretl_matrix_zero(X);
+        ; /* sigma is not used */
     } else {
         err = gretl_invert_symmetric_matrix(sys->S);
     }
@@ -1226,133 +1434,25 @@ int system_estimate (equation_system *sys, DATASET *dset,
     gretl_matrix_print(sys->S, "sys->S");
 #endif
 
-    if (!err && Xi == NULL) {
+    if (!err && xp == NULL) {
         /* the test against NULL here allows for the possibility
            that we're iterating
         */
-        err = allocate_Xi_etc(&Xi, &Xj, &M, T, k);
+        xp = sys_xprods_new(sys, dset, mk, !single_equation, &err);
     }
 
     if (err) goto cleanup;
 
-    /* form the big stacked X matrix: Xi = data matrix for equation i,
-       specified in lists[i]
+    /* form the X'X-type matrix and X'y-type vector from the cached
+       per-equation cross-products
     */
-
-    krow = 0;
-    for (i=0; i<sys->neqns && !err; i++) {
-        int kcol = 0;
-
-        err = make_sys_X_block(Xi, models[i], dset, sys->t1, method);
-
-        for (j=0; j<=i && !err; j++) {
-            const gretl_matrix *Xk;
-            double sij;
-
-            if (i != j) {
-                if (single_equation || rsingle) {
-                    kcol += models[j]->ncoeff;
-                    continue;
-                }
-                err = make_sys_X_block(Xj, models[j], dset, sys->t1, method);
-                Xk = Xj;
-            } else if (method == SYS_METHOD_LIML) {
-                err = make_liml_X_block(Xj, models[i], dset, sys->t1);
-                Xk = Xj;
-            } else {
-                Xk = Xi;
-            }
-
-            M->rows = Xi->cols;
-            M->cols = Xk->cols;
-
-            err = gretl_matrix_multiply_mod(Xi, GRETL_MOD_TRANSPOSE,
-                                            Xk, GRETL_MOD_NONE,
-                                            M, GRETL_MOD_NONE);
-
-            if (rsingle || (single_equation && method != SYS_METHOD_WLS)) {
-                sij = 1.0;
-            } else {
-                sij = gretl_matrix_get(sys->S, i, j);
-            }
-
-            insert_sys_X_block(X, M, krow, kcol, sij);
-            kcol += models[j]->ncoeff;
-        }
-
-        krow += models[i]->ncoeff;
-    }
-
-    if (err) {
-        fprintf(stderr, "after trying to make X matrix: err = %d\n", err);
-        goto cleanup;
-    }
+    sys_normal_equations(sys, xp, X, y, mk, single_equation || rsingle,
+                         rsingle || (single_equation &&
+                                     method != SYS_METHOD_WLS));
 
     if (nr > 0) {
         /* there are restrictions to be imposed */
         augment_X_with_restrictions(X, mk, sys);
-    }
-
-    if (!do_iteration && !rsingle) {
-        /* we're not coming back this way, so free some storage */
-        gretl_matrix_free(Xj);
-        Xj = NULL;
-        gretl_matrix_free(M);
-        M = NULL;
-    }
-
-    /* form stacked Y column vector (m x k) */
-
-    v = 0;
-    for (i=0; i<sys->neqns; i++) {
-
-        /* loop over the m vertically-arranged blocks */
-        make_sys_X_block(Xi, models[i], dset, sys->t1, method);
-
-        for (j=0; j<models[i]->ncoeff; j++) {
-            /* loop over the rows within each of the m blocks */
-            double yv = 0.0;
-            int lmin = 0, lmax = sys->neqns;
-
-            if (single_equation || rsingle) {
-                /* no cross terms wanted */
-                lmin = i;
-                lmax = i + 1;
-            }
-
-            for (l=lmin; l<lmax; l++) {
-                /* loop over the components that must be
-                   added to form each element */
-                const double *yl = NULL;
-                double xx = 0.0;
-
-                if (method == SYS_METHOD_LIML) {
-                    yl = gretl_model_get_data(models[l], "liml_y");
-                } else {
-                    yl = dset->Z[system_get_depvar(sys, l)];
-                }
-
-                /* multiply X'[l] into y */
-                for (t=0; t<T; t++) {
-                    xx += gretl_matrix_get(Xi, t, j) * yl[t + sys->t1];
-                }
-
-                if (rsingle || (single_equation && method != SYS_METHOD_WLS)) {
-                    ; /* leave xx unmodified */
-                } else if (method == SYS_METHOD_WLS && i == l) {
-                    xx *= gretl_matrix_get(sys->S, i, i);
-                } else {
-                    xx *= gretl_matrix_get(sys->S, i, l);
-                }
-
-                yv += xx;
-            }
-            gretl_vector_set(y, v++, yv);
-        }
-    }
-
-    if (nr > 0) {
-        /* there are restrictions */
         augment_y_with_restrictions(y, mk, nr, sys);
     }
 
@@ -1405,9 +1505,7 @@ int system_estimate (equation_system *sys, DATASET *dset,
 
  cleanup:
 
-    gretl_matrix_free(Xi);
-    gretl_matrix_free(Xj);
-    gretl_matrix_free(M);
+    sys_xprods_free(xp);
     gretl_matrix_free(X);
     gretl_matrix_free(y);
 
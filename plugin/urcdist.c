@@ -34,11 +34,10 @@ FILE *fdb;
    sample size.
 */
 
-static void eval_all_crit (double tau, double *b, int nb,
-			   int T, double *crit, int *imin)
+static void eval_all_crit (const double *b, int nb, int T,
+			   double *crit)
 {
     double d1 = 0, d2 = 0, d3 = 0;
-    double diff, diffm = 1000;
     int i;
 
     if (T > 0) {
@@ -55,13 +54,28 @@ static void eval_all_crit (double tau, double *b, int nb,
 	} else if (nb == 4) {
 	    crit[i] = b[0] + b[1]*d1 + b[2]*d2 + b[3]*d3;
 	}
+	b += nb;
+    }
+}
+
+/* Find the (1-based) index of the critical value closest to
+   the test statistic @tau.
+*/
+
+static int nearest_crit (const double *crit, double tau)
+{
+    double diff, diffm = 1000;
+    int i, imin = 0;
+
+    for (i=0; i<URCLEN; i++) {
 	diff = fabs(tau - crit[i]);
 	if (diff < diffm) {
 	    diffm = diff;
-	    *imin = i + 1; /* has to be 1-based */
+	    imin = i + 1;
 	}
-	b += nb;
     }
+
+    return imin;
 }
 
 /* Copyright (c) James G. MacKinnon, 1993.  This routine uses the
@@ -241,9 +255,9 @@ static int gls (double *xmat, double *yvec, double *omega,
    Routine to find P-value for any specified test statistic.
 */
 
-static double fpval (double *beta, int nbeta, double *wght,
-		     double *prob, double *cnorm,
-		     double tau, int T, int *err)
+static double fpval (const double *crits, const double *wght,
+		     const double *prob, const double *cnorm,
+		     double tau, int *err)
 {
     double d1, precrt = 2.0;
     int i, j, ic, jc, imin = 0;
@@ -252,20 +266,13 @@ static double fpval (double *beta, int nbeta, double *wght,
     double se3, ttest, crfit;
     double *yvec, *fits, *resid;
     double *xmat, *xomx, *gamma, *omega;
-    double crits[URCLEN];
     double pval = 0.0;
 
     /* sizes of arrays:
        yvec[20], fits[20], resid[20]
        xmat[80], xomx[16], gamma[4], omega[400]
     */
-    int wlen = 3*20 + 20 + 400;
-    double *wspace = malloc(wlen * sizeof *wspace);
-
-    if (wspace == NULL) {
-	*err = E_ALLOC;
-	return NADBL;
-    }
+    double wspace[3*20 + 80 + 16 + 4 + 400];
 
     /* set offsets into workspace */
     yvec = wspace;
@@ -276,11 +283,9 @@ static double fpval (double *beta, int nbeta, double *wght,
     gamma = xomx + 16;
     omega = gamma + 4;
 
-    /* first compute all the estimated critical values,
-       and find the one closest to the test statistic,
-       indexed by @imin.
-    */
-    eval_all_crit(tau, beta, nbeta, T, crits, &imin);
+    /* find the estimated critical value closest to the
+       test statistic, indexed by @imin */
+    imin = nearest_crit(crits, tau);
 
     nph = np / 2;
     nptop = URCLEN - nph;
@@ -426,7 +431,6 @@ static double fpval (double *beta, int nbeta, double *wght,
 
  bailout:
 
-    free(wspace);
     if (*err) {
 	pval = NADBL;
     }
@@ -434,35 +438,6 @@ static double fpval (double *beta, int nbeta, double *wght,
     return pval;
 }
 
-#if G_BYTE_ORDER == G_BIG_ENDIAN
-
-static void urc_swap_endianness (double *beta,
-				 int nbeta,
-				 double *wght,
-				 double *prob,
-				 double *cnorm)
-{
-    int i, n = nbeta * URCLEN;
-
-    for (i=0; i<n; i++) {
-	reverse_double(beta[i]);
-    }
-
-    /* the following arrays are padded by one */
-
-    for (i=1; i<=URCLEN; i++) {
-	reverse_double(wght[i]);
-    }
-    for (i=1; i<=URCLEN; i++) {
-	reverse_double(prob[i]);
-    }
-    for (i=1; i<=URCLEN; i++) {
-	reverse_double(cnorm[i]);
-    }
-}
-
-#endif
-
 struct urcinfo {
     int nz;
     int nreg;
@@ -471,147 +446,173 @@ struct urcinfo {
     int pos;
 };
 
+static const struct urcinfo uis[] = {
+    {0,  1, 2, 20,      0}, /* dfnc: table 1 */
+    {0,  2, 2, 20,   7072}, /* dfc */
+    {0,  3, 3, 20,  14144}, /* dfct */
+    {0,  4, 3, 20,  22984}, /* dfctt */
+    {1,  2, 2, 20,  31824}, /* conc: table 2 */
+    {1,  3, 2, 20,  38896}, /* coc */
+    {1,  4, 3, 25,  45968}, /* coct */
+    {1,  5, 3, 20,  54808}, /* coctt */
+    {2,  3, 2, 25,  63648}, /* conc: table 3 */
+    {2,  4, 2, 20,  70720}, /* coc */
+    {2,  5, 2, 20,  77792}, /* coct */
+    {2,  6, 3, 20,  84864}, /* coctt */
+    {3,  4, 3, 20,  93704}, /* conc: table 4 */
+    {3,  5, 2, 25, 102544}, /* coc */
+    {3,  6, 3, 20, 109616}, /* coct */
+    {3,  7, 2, 30, 118456}, /* coctt */
+    {4,  5, 2, 25, 125528}, /* conc: table 5 */
+    {4,  6, 3, 20, 132600}, /* coc */
+    {4,  7, 3, 20, 141440}, /* coct */
+    {4,  8, 3, 20, 150280}, /* coctt */
+    {5,  6, 2, 30, 159120}, /* conc: table 6 */
+    {5,  7, 2, 30, 166192}, /* coc */
+    {5,  8, 2, 30, 173264}, /* coct */
+    {5,  9, 3, 25, 180336}, /* coctt */
+    {6,  7, 3, 25, 189176}, /* conc: table 7 */
+    {6,  8, 3, 25, 198016}, /* coc */
+    {6,  9, 3, 30, 206856}, /* coct */
+    {6, 10, 3, 30, 215696}, /* coctt */
+    {7,  8, 2, 40, 224536}, /* conc: table 8 */
+    {7,  9, 2, 35, 231608}, /* coc */
+    {7, 10, 2, 40, 238680}, /* coct */
+    {7, 11, 2, 40, 245752}, /* coctt */
+    {0,  0, 0,  0, 252824}, /* prob */
+    {0,  0, 0, -1, 254592}  /* cnorm */
+};
+
+/* total number of doubles in urcdata.bin */
+#define URC_NDATA (254592 / sizeof(double) + URCLEN)
+
+/* The whole of MacKinnon's table file is read into memory on first
+   use and kept for the lifetime of the plugin, so that repeated
+   calls (e.g. in a simulation) don't have to go back to disk.
+*/
+
+static double *urc_data;
+G_LOCK_DEFINE_STATIC(urc_data);
+
+static const double *get_urc_data (int *err)
+{
+    G_LOCK(urc_data);
+
+    if (urc_data == NULL) {
+	gchar *datapath;
+	double *buf;
+	FILE *fp;
+
+	datapath = g_strdup_printf("%sdata%curcdata.bin",
+				   gretl_plugin_path(), SLASH);
+	fp = gretl_fopen(datapath, "rb");
+	if (fp == NULL) {
+	    fprintf(stderr, "Couldn't open %s\n", datapath);
+	    *err = E_FOPEN;
+	} else {
+	    buf = malloc(URC_NDATA * sizeof *buf);
+	    if (buf == NULL) {
+		*err = E_ALLOC;
+	    } else if (fread(buf, sizeof(double), URC_NDATA, fp) != URC_NDATA) {
+		fprintf(stderr, "error reading urcdata\n");
+		free(buf);
+		*err = E_DATA;
+	    } else {
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+		size_t i;
+
+		for (i=0; i<URC_NDATA; i++) {
+		    reverse_double(buf[i]);
+		}
+#endif
+		urc_data = buf;
+	    }
+	    fclose(fp);
+	}
+	g_free(datapath);
+    }
+
+    G_UNLOCK(urc_data);
+
+    return urc_data;
+}
+
 /*
+   tau = array of @n test statistics
+   pval = array to receive the @n p-values
    niv = # of integrated variables
    itv = appropriate ur_code for nc, c, ct, ctt models
    T = sample size (0 for asymptotic)
-   tau = test statistic
-   err = location to receive error code
 */
 
-static double urcval (int niv, int itv, int T, double tau,
-		      int *err)
+static int urcval (const double *tau, double *pval, int n,
+		   int niv, int itv, int T)
 {
-    FILE *fp;
-    gchar *datapath = NULL;
-    double beta[BIGLEN];
-    double wght[URCLEN+1];
-    double prob[URCLEN+1];
-    double cnorm[URCLEN+1];
-    struct urcinfo uis[] = {
-	{0,  1, 2, 20,      0}, /* dfnc: table 1 */
-	{0,  2, 2, 20,   7072}, /* dfc */
-	{0,  3, 3, 20,  14144}, /* dfct */
-	{0,  4, 3, 20,  22984}, /* dfctt */
-	{1,  2, 2, 20,  31824}, /* conc: table 2 */
-	{1,  3, 2, 20,  38896}, /* coc */
-	{1,  4, 3, 25,  45968}, /* coct */
-	{1,  5, 3, 20,  54808}, /* coctt */
-	{2,  3, 2, 25,  63648}, /* conc: table 3 */
-	{2,  4, 2, 20,  70720}, /* coc */
-	{2,  5, 2, 20,  77792}, /* coct */
-	{2,  6, 3, 20,  84864}, /* coctt */
-	{3,  4, 3, 20,  93704}, /* conc: table 4 */
-	{3,  5, 2, 25, 102544}, /* coc */
-	{3,  6, 3, 20, 109616}, /* coct */
-	{3,  7, 2, 30, 118456}, /* coctt */
-	{4,  5, 2, 25, 125528}, /* conc: table 5 */
-	{4,  6, 3, 20, 132600}, /* coc */
-	{4,  7, 3, 20, 141440}, /* coct */
-	{4,  8, 3, 20, 150280}, /* coctt */
-	{5,  6, 2, 30, 159120}, /* conc: table 6 */
-	{5,  7, 2, 30, 166192}, /* coc */
-	{5,  8, 2, 30, 173264}, /* coct */
-	{5,  9, 3, 25, 180336}, /* coctt */
-	{6,  7, 3, 25, 189176}, /* conc: table 7 */
-	{6,  8, 3, 25, 198016}, /* coc */
-	{6,  9, 3, 30, 206856}, /* coct */
-	{6, 10, 3, 30, 215696}, /* coctt */
-	{7,  8, 2, 40, 224536}, /* conc: table 8 */
-	{7,  9, 2, 35, 231608}, /* coc */
-	{7, 10, 2, 40, 238680}, /* coct */
-	{7, 11, 2, 40, 245752}, /* coctt */
-	{0,  0, 0,  0, 252824}, /* prob */
-	{0,  0, 0, -1, 254592}  /* cnorm */
-    };
-    struct urcinfo *ui;
-    size_t nr1, nr2;
-    int i, nbeta;
-    double pval = NADBL;
+    const struct urcinfo *ui;
+    const double *data, *beta;
+    const double *wght, *prob, *cnorm;
+    double crits[URCLEN];
+    int i, nbeta, err = 0;
+
+    for (i=0; i<n; i++) {
+	pval[i] = NADBL;
+    }
 
     /* Check that parameters are valid */
     if (niv < 1 || niv > NIVMAX) {
-	*err = E_DATA;
-	return pval;
+	return E_DATA;
     }
 
     if (itv < 1 || itv > 4) {
 	/* these limits correspond to UR_NO_CONST and UR_QUAD_TREND
 	   in lib/src/adf_kpss.c */
-	*err = E_DATA;
-	return pval;
+	return E_DATA;
     }
 
-    /* Open data file */
-    datapath = g_strdup_printf("%sdata%curcdata.bin",
-			       gretl_plugin_path(), SLASH);
-    fp = gretl_fopen(datapath, "rb");
-    if (fp == NULL) {
-	fprintf(stderr, "Couldn't open %s\n", datapath);
-	*err = E_FOPEN;
-	g_free(datapath);
-	return pval;
+    data = get_urc_data(&err);
+    if (err) {
+	return err;
     }
 
-    g_free(datapath);
-
-    /* skip to appropriate location in data file */
+    /* find the appropriate table */
     i = (niv-1) * 4 + (itv - 1);
     ui = &uis[i];
-    fseek(fp, ui->pos, SEEK_SET);
 
     /* the number of coefficients in the critical values
        equations */
     nbeta = ui->model == 2 ? 3 : 4;
 
 #if URDEBUG
-    fprintf(fdb, "nz=%d, nreg=%d, model=%d, Tmin=%d, offset=%d\n",
+    if (fdb != NULL) fprintf(fdb, "nz=%d, nreg=%d, model=%d, Tmin=%d, offset=%d\n",
 	    ui->nz, ui->nreg, ui->model, ui->Tmin, ui->pos);
-    fflush(fdb);
 #endif
 
-    /* these arrays are padded by one for fortran */
-    wght[0] = prob[0] = cnorm[0] = 0.0;
-
-    /* read coefficients and weights */
-    nr1 = fread(beta, sizeof(double), nbeta * URCLEN, fp);
-    nr2 = fread(wght + 1, sizeof(double), URCLEN, fp);
-    if (nr1 != nbeta * URCLEN || nr2 != URCLEN) {
-	fprintf(stderr, "error reading urcdata\n");
-	*err = E_DATA;
-    }
-
-    if (!*err) {
-	/* read from embedded "probs.tab" data */
-	fseek(fp, uis[32].pos, SEEK_SET);
-	nr1 = fread(prob + 1, sizeof(double), URCLEN, fp);
-	nr2 = fread(cnorm + 1, sizeof(double), URCLEN, fp);
-	if (nr1 != URCLEN || nr2 != URCLEN) {
-	    fprintf(stderr, "error reading urcdata\n");
-	    *err = E_DATA;
-	}
-    }
-
-    fclose(fp);
-
-#if G_BYTE_ORDER == G_BIG_ENDIAN
-    if (!*err) {
-	urc_swap_endianness(beta, nbeta, wght, prob, cnorm);
-    }
-#endif
+    /* the coefficients are followed by the weights; the
+       weights, probabilities and cnorm values are addressed
+       as 1-based, as in the fortran original
+    */
+    beta = data + ui->pos / sizeof(double);
+    wght = beta + nbeta * URCLEN - 1;
+    prob = data + uis[32].pos / sizeof(double) - 1;
+    cnorm = data + uis[33].pos / sizeof(double) - 1;
 
-    if (!*err && T > 0 && T < ui->Tmin) {
+    if (T > 0 && T < ui->Tmin) {
 	/* error, or warning? */
 	fprintf(stderr, "Warning, too few observations!\n");
-	/* *err = E_TOOFEW; */
+	/* err = E_TOOFEW; */
     }
 
-    if (!*err) {
-	pval = fpval(beta, nbeta, wght, prob, cnorm,
-		     tau, T, err);
+    /* the critical values depend only on T, so they are
+       computed once for all the test statistics */
+    eval_all_crit(beta, nbeta, T, crits);
+
+    for (i=0; i<n && !err; i++) {
+	if (!na(tau[i])) {
+	    pval[i] = fpval(crits, wght, prob, cnorm, tau[i], &err);
+	}
     }
 
-    return pval;
+    return err;
 }
 
 /*
@@ -626,7 +627,6 @@ static double urcval (int niv, int itv, int T, double tau,
 double mackinnon_pvalue (double tau, int T, int niv, int itv)
 {
     double pval = NADBL;
-    int err = 0;
 
 #if URDEBUG
     fdb = fopen("debug.txt", "w");
@@ -637,7 +637,7 @@ double mackinnon_pvalue (double tau, int T, int niv, int itv)
     }
 #endif
 
-    pval = urcval(niv, itv, T, tau, &err);
+    urcval(&tau, &pval, 1, niv, itv, T);
 
 #if URDEBUG
     if (fdb != NULL) {
@@ -648,6 +648,17 @@ double mackinnon_pvalue (double tau, int T, int niv, int itv)
     return pval;
 }
 
+/* As mackinnon_pvalue(), but for an array of @n test
+   statistics sharing the same sample size and specification.
+   Writes the p-values into @pval and returns an error code.
+*/
+
+int mackinnon_pvalues (const double *tau, double *pval, int n,
+		       int T, int niv, int itv)
+{
+    return urcval(tau, pval, n, niv, itv, T);
+}
+
 /* Extra: code to obtain approximate finite-sample p-values for
    DF-GLS tests a la Elliott-Rothenberg-Stock, using Sephton's
    response surfaces for the test-down cases, otherwise Cottrell
@@ -669,26 +680,48 @@ static const double alpha_t[N_ALPHA_T] = {
     0.5, 0.6, 0.7, 0.9, 0.99
 };
 
-static const char *bnames[] = {
-    "dfgls-beta-c.bin", "dfgls-beta-t.bin"
-};
+/* the DF-GLS tables: Cottrell-Komashko betas for the constant and
+   trend cases, Sephton's betas for the test-down cases, and
+   Sephton's alphas
+*/
 
-static const char *snames[] = {
-    "npc.bin", "npt.bin", "pqc.bin", "pqt.bin"
+static const char *dfgls_files[] = {
+    "dfgls-beta-c.bin", "dfgls-beta-t.bin",
+    "npc.bin", "npt.bin", "pqc.bin", "pqt.bin",
+    "s_alpha.bin"
 };
 
-static gretl_matrix *get_data_matrix (const char *base, int *err)
+#define N_DFGLS_FILES 7
+
+/* as with MacKinnon's tables, these are read once and retained */
+
+static gretl_matrix *dfgls_data[N_DFGLS_FILES];
+G_LOCK_DEFINE_STATIC(dfgls_data);
+
+static const gretl_matrix *get_data_matrix (int i, int *err)
 {
     gretl_matrix *m;
-    gchar *fname;
 
-    fname = g_strdup_printf("%sdata%c%s", gretl_plugin_path(),
-			    SLASH, base);
-    m = gretl_matrix_read_from_file(fname, 0, err);
-    if (*err) {
-	fprintf(stderr, "Couldn't open %s\n", fname);
+    G_LOCK(dfgls_data);
+
+    if (dfgls_data[i] == NULL) {
+	gchar *fname;
+
+	fname = g_strdup_printf("%sdata%c%s", gretl_plugin_path(),
+				SLASH, dfgls_files[i]);
+	dfgls_data[i] = gretl_matrix_read_from_file(fname, 0, err);
+	if (*err) {
+	    fprintf(stderr, "Couldn't open %s\n", fname);
+	}
+	g_free(fname);
+    }
+    m = dfgls_data[i];
+
+    G_UNLOCK(dfgls_data);
+
+    if (m == NULL && !*err) {
+	*err = E_DATA;
     }
-    g_free(fname);
 
     return m;
 }
@@ -698,10 +731,9 @@ static gretl_matrix *get_data_matrix (const char *base, int *err)
 double dfgls_pvalue (double tau, int T, int trend,
 		     int kmax, int PQ, int *err)
 {
-    const char *fbase;
     gretl_matrix_block *B;
-    gretl_matrix *alpha = NULL;
-    gretl_matrix *beta = NULL;
+    const gretl_matrix *alpha = NULL;
+    const gretl_matrix *beta = NULL;
     gretl_matrix *C, *V, *g;
     gretl_matrix *r, *y, *X;
     const double *a, *b;
@@ -712,11 +744,10 @@ double dfgls_pvalue (double tau, int T, int trend,
     int nreg, ncoeff, nalpha;
     int i, j, k, imin = 0;
 
-    fbase = sephton ? snames[trend + 2*PQ] : bnames[trend];
-    beta = get_data_matrix(fbase, err);
+    beta = get_data_matrix(sephton ? 2 + trend + 2*PQ : trend, err);
 
     if (!*err && sephton) {
-	alpha = get_data_matrix("s_alpha.bin", err);
+	alpha = get_data_matrix(N_DFGLS_FILES - 1, err);
 	if (!*err) {
 	    a = alpha->val;
 	    nalpha = alpha->rows;
@@ -729,7 +760,6 @@ double dfgls_pvalue (double tau, int T, int trend,
     }
 
     if (*err) {
-	gretl_matrix_free(beta);
 	return pval;
     }
 
@@ -884,8 +914,6 @@ double dfgls_pvalue (double tau, int T, int trend,
 
  bailout:
 
-    gretl_matrix_free(beta);
-    gretl_matrix_free(alpha);
     gretl_matrix_block_destroy(B);
 
     return pval;
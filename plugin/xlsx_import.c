@@ -31,6 +31,7 @@
 #endif
 
 #include <gtk/gtk.h>
+#include <libxml/xmlreader.h>
 
 #include <sys/stat.h>
 #include <unistd.h>
@@ -65,7 +66,8 @@ struct xlsx_info_ {
     char **filenames;
     int selsheet;
     int n_strings;
-    char **strings;
+    const char **strings;
+    GStringChunk *strchunk;
     DATASET *dset;
     int *codelist;
     gretl_string_table *st;
@@ -100,11 +102,23 @@ static void xlsx_info_init (xlsx_info *xinfo, gretlopt opt)
     xinfo->selsheet = 0;
     xinfo->n_strings = 0;
     xinfo->strings = NULL;
+    xinfo->strchunk = NULL;
     xinfo->dset = NULL;
     xinfo->codelist = NULL;
     xinfo->st = NULL;
 }
 
+static void xlsx_free_strings (xlsx_info *xinfo)
+{
+    free(xinfo->strings);
+    xinfo->strings = NULL;
+    xinfo->n_strings = 0;
+    if (xinfo->strchunk != NULL) {
+	g_string_chunk_free(xinfo->strchunk);
+	xinfo->strchunk = NULL;
+    }
+}
+
 static void xlsx_info_reset (xlsx_info *xinfo, gretlopt opt)
 {
     xinfo->flags = BOOK_TOP_LEFT_EMPTY;
@@ -114,9 +128,7 @@ static void xlsx_info_reset (xlsx_info *xinfo, gretlopt opt)
     xinfo->maxcol = 0;
     xinfo->namerow = -1;
     xinfo->obscol = -1;
-    strings_array_free(xinfo->strings, xinfo->n_strings);
-    xinfo->strings = NULL;
-    xinfo->n_strings = 0;
+    xlsx_free_strings(xinfo);
     destroy_dataset(xinfo->dset);
     xinfo->dset = NULL;
     free(xinfo->codelist);
@@ -132,7 +144,7 @@ static void xlsx_info_free (xlsx_info *xinfo)
     if (xinfo != NULL) {
 	strings_array_free(xinfo->sheetnames, xinfo->n_sheets);
 	strings_array_free(xinfo->filenames, xinfo->n_sheets);
-	strings_array_free(xinfo->strings, xinfo->n_strings);
+	xlsx_free_strings(xinfo);
 	destroy_dataset(xinfo->dset);
 	free(xinfo->codelist);
 	if (xinfo->st != NULL) {
@@ -141,19 +153,118 @@ static void xlsx_info_free (xlsx_info *xinfo)
     }
 }
 
+/* Streaming access to the worksheet and shared-strings XML files.
+   These can be very large, so rather than building a DOM tree for
+   the whole file we walk it with libxml2's xmlTextReader, expanding
+   just one <row> (or <si>) element at a time into a subtree that is
+   handed to the node-based code below; the reader frees each subtree
+   as it moves past it.
+*/
+
+static xmlTextReaderPtr xlsx_reader_open (const char *fname,
+					  const char *rootname,
+					  int *err)
+{
+    xmlTextReaderPtr reader;
+    int ret;
+
+    LIBXML_TEST_VERSION;
+
+    reader = xmlReaderForFile(fname, NULL, XML_PARSE_HUGE);
+    if (reader == NULL) {
+	gretl_errmsg_sprintf(_("xmlReadFile failed on %s"), fname);
+	*err = E_DATA;
+	return NULL;
+    }
+
+    /* advance to the root element */
+    while ((ret = xmlTextReaderRead(reader)) == 1 &&
+	   xmlTextReaderNodeType(reader) != XML_READER_TYPE_ELEMENT) {
+	;
+    }
+
+    if (ret != 1) {
+	gretl_errmsg_sprintf(_("%s: empty document"), fname);
+	*err = E_DATA;
+    } else if (xmlStrcmp(xmlTextReaderConstName(reader), (XUC) rootname)) {
+	gretl_errmsg_sprintf(_("File of the wrong type, root node not %s"),
+			     rootname);
+	*err = E_DATA;
+    }
+
+    if (*err) {
+	xmlFreeTextReader(reader);
+	reader = NULL;
+    }
+
+    return reader;
+}
+
+/* Position @reader on the next element named @name at @depth.
+   If @skip is non-zero on input the reader is first moved beyond
+   the element it's on, without visiting its content; it is set
+   to 1 when an element is found. Returns 1 on success, 0 at the
+   end of the document, or -1 on a parse error.
+*/
+
+static int xlsx_next_element (xmlTextReaderPtr reader,
+			      const char *name, int depth,
+			      int *skip)
+{
+    int ret;
+
+    while (1) {
+	if (*skip) {
+	    ret = xmlTextReaderNext(reader);
+	    *skip = 0;
+	} else {
+	    ret = xmlTextReaderRead(reader);
+	}
+	if (ret != 1) {
+	    return ret < 0 ? -1 : 0;
+	}
+	if (xmlTextReaderNodeType(reader) == XML_READER_TYPE_ELEMENT &&
+	    xmlTextReaderDepth(reader) == depth &&
+	    !xmlStrcmp(xmlTextReaderConstName(reader), (XUC) name)) {
+	    *skip = 1;
+	    return 1;
+	}
+    }
+}
+
+/* Add the content of @node to the shared strings table, at
+   position @i. The strings are interned in a string chunk, so
+   repeated values are stored only once.
+*/
+
+static int xlsx_add_shared_string (xlsx_info *xinfo, xmlNodePtr node,
+				   int i, PRN *prn)
+{
+    char *tmp = (char *) xmlNodeGetContent(node);
+
+    if (tmp == NULL) {
+	pprintf(prn, _("failed reading string %d\n"), i);
+	return E_DATA;
+    }
+
+    xinfo->strings[i] = g_string_chunk_insert_const(xinfo->strchunk,
+						    g_strstrip(tmp));
+    free(tmp);
+
+    return 0;
+}
+
 /* Parse what we need from sharedStrings.xml */
 
 static int xlsx_read_shared_strings (xlsx_info *xinfo, PRN *prn)
 {
-    xmlDocPtr doc = NULL;
-    xmlNodePtr cur = NULL;
-    xmlNodePtr val;
+    xmlTextReaderPtr reader;
+    xmlNodePtr cur, val;
     char *tmp;
-    int i, n = 0;
-    int err = 0;
+    int i, n = 0, skip = 0;
+    int ret, err = 0;
 
-    err = gretl_xml_open_doc_root(xinfo->stringsfile, "sst",
-				  &doc, &cur);
+    reader = xlsx_reader_open(xinfo->stringsfile, "sst", &err);
 
     if (err) {
 	pprintf(prn, _("Couldn't find shared strings table\n"));
@@ -161,9 +272,9 @@ static int xlsx_read_shared_strings (xlsx_info *xinfo, PRN *prn)
 	return err;
     }
 
-    tmp = (char *) xmlGetProp(cur, (XUC) "uniqueCount");
+    tmp = (char *) xmlTextReaderGetAttribute(reader, (XUC) "uniqueCount");
     if (tmp == NULL) {
-	tmp = (char *) xmlGetProp(cur, (XUC) "count");
+	tmp = (char *) xmlTextReaderGetAttribute(reader, (XUC) "count");
     }
 
     if (tmp == NULL) {
@@ -179,14 +290,13 @@ static int xlsx_read_shared_strings (xlsx_info *xinfo, PRN *prn)
     }
 
     if (!err) {
-	xinfo->strings = strings_array_new(n);
+	xinfo->strings = calloc(n, sizeof *xinfo->strings);
+	xinfo->strchunk = g_string_chunk_new(4096);
 	if (xinfo->strings == NULL) {
 	    err = E_ALLOC;
 	}
     }
 
-    cur = cur->xmlChildrenNode;
-
     /* The strings in an <sst> are mostly set up as
 
        <si><t>XXX</t></si>
@@ -202,47 +312,34 @@ static int xlsx_read_shared_strings (xlsx_info *xinfo, PRN *prn)
     */
 
     i = 0;
-    while (cur != NULL && !err) {
-	if (!xmlStrcmp(cur->name, (XUC) "si")) {
-	    int gotstr = 0;
+    while (!err && i < n &&
+	   (ret = xlsx_next_element(reader, "si", 1, &skip)) != 0) {
+	int gotstr = 0;
 
-	    val = cur->xmlChildrenNode;
-	    while (val != NULL && !err && !gotstr) {
-		if (!xmlStrcmp(val->name, (XUC) "t")) {
-		    /* got a regular <t> element */
-		    tmp = (char *) xmlNodeGetContent(val);
-		    if (tmp == NULL) {
-			pprintf(prn, _("failed reading string %d\n"), i);
-			err = E_DATA;
-		    } else {
-			xinfo->strings[i++] = g_strstrip(tmp);
+	if (ret < 0 || (cur = xmlTextReaderExpand(reader)) == NULL) {
+	    err = E_DATA;
+	    break;
+	}
+	val = cur->xmlChildrenNode;
+	while (val != NULL && !err && !gotstr) {
+	    if (!xmlStrcmp(val->name, (XUC) "t")) {
+		/* got a regular <t> element */
+		err = xlsx_add_shared_string(xinfo, val, i++, prn);
+		gotstr = 1;
+	    } else if (!xmlStrcmp(val->name, (XUC) "r")) {
+		/* hunt for <t> inside an <r> element */
+		xmlNodePtr sub = val->xmlChildrenNode;
+
+		while (sub != NULL && !err && i < n) {
+		    if (!xmlStrcmp(sub->name, (XUC) "t")) {
+			err = xlsx_add_shared_string(xinfo, sub, i++, prn);
 			gotstr = 1;
 		    }
-		} else if (!xmlStrcmp(val->name, (XUC) "r")) {
-		    /* hunt for <t> inside an <r> element */
-		    xmlNodePtr sub = val->xmlChildrenNode;
-
-		    while (sub != NULL && !err && i < n) {
-			if (!xmlStrcmp(sub->name, (XUC) "t")) {
-			    tmp = (char *) xmlNodeGetContent(sub);
-			    if (tmp == NULL) {
-				pprintf(prn, _("failed reading string %d\n"), i);
-				err = E_DATA;
-			    } else {
-				xinfo->strings[i++] = g_strstrip(tmp);
-				gotstr = 1;
-			    }
-			}
-			sub = sub->next;
-		    }
+		    sub = sub->next;
 		}
-		val = val->next;
 	    }
+	    val = val->next;
 	}
-	if (i == n) {
-	    break;
-	}
-	cur = cur->next;
     }
 
     if (!err && i < n) {
@@ -253,12 +350,11 @@ static int xlsx_read_shared_strings (xlsx_info *xinfo, PRN *prn)
 
     if (!err) {
 	xinfo->n_strings = i;
-    } else if (xinfo->strings != NULL) {
-	strings_array_free(xinfo->strings, n);
-	xinfo->strings = NULL;
+    } else {
+	xlsx_free_strings(xinfo);
     }
 
-    xmlFreeDoc(doc);
+    xmlFreeTextReader(reader);
 
     return err;
 }
@@ -1017,15 +1113,44 @@ static int xlsx_non_numeric_check (xlsx_info *xinfo, PRN *prn)
     return err;
 }
 
+/* Make one pass through the rows of the selected worksheet,
+   streaming the XML so that only a single row is held in
+   memory at any time.
+*/
+
+static int xlsx_read_rows (xlsx_info *xinfo, PRN *prn)
+{
+    xmlTextReaderPtr reader;
+    xmlNodePtr row;
+    int i = 0, skip = 0;
+    int ret, err = 0;
+
+    reader = xlsx_reader_open(xinfo->sheetfile, "worksheet", &err);
+
+    if (err) {
+	pprintf(prn, _("didn't get worksheet\n"));
+	pprintf(prn, "%s", gretl_errmsg_get());
+	return err;
+    }
+
+    while (!err && (ret = xlsx_next_element(reader, "row", 2, &skip)) != 0) {
+	if (ret < 0 || (row = xmlTextReaderExpand(reader)) == NULL) {
+	    pprintf(prn, _("error parsing worksheet\n"));
+	    err = E_DATA;
+	} else {
+	    err = xlsx_read_row(row, xinfo, i++, prn);
+	}
+    }
+
+    xmlFreeTextReader(reader);
+
+    return err;
+}
+
 static int xlsx_read_worksheet (xlsx_info *xinfo,
 				const char *fname,
 				PRN *prn)
 {
-    xmlDocPtr doc = NULL;
-    xmlNodePtr data_node = NULL;
-    xmlNodePtr cur = NULL;
-    xmlNodePtr c1;
-    int i, gotdata = 0;
     int err = 0;
 
     sprintf(xinfo->sheetfile, "xl%c%s", SLASH,
@@ -1038,31 +1163,8 @@ static int xlsx_read_worksheet (xlsx_info *xinfo,
 
     sprintf(xinfo->stringsfile, "xl%csharedStrings.xml", SLASH);
 
-    err = gretl_xml_open_doc_root(xinfo->sheetfile, "worksheet",
-				  &doc, &cur);
-
-    if (err) {
-	pprintf(prn, _("didn't get worksheet\n"));
-	pprintf(prn, "%s", gretl_errmsg_get());
-	return err;
-    }
-
-    /* walk the tree, first pass */
-    i = 0;
-    cur = cur->xmlChildrenNode;
-    while (cur != NULL && !err && !gotdata) {
-        if (!xmlStrcmp(cur->name, (XUC) "sheetData")) {
-	    data_node = c1 = cur->xmlChildrenNode;
-	    while (c1 != NULL && !err) {
-		if (!xmlStrcmp(c1->name, (XUC) "row")) {
-		    err = xlsx_read_row(c1, xinfo, i++, prn);
-		}
-		c1 = c1->next;
-	    }
-	    gotdata = 1;
-	}
-	cur = cur->next;
-    }
+    /* first pass: dimensions and top-left check */
+    err = xlsx_read_rows(xinfo, prn);
 
 #if XDEBUG
     if (!err) {
@@ -1076,15 +1178,8 @@ static int xlsx_read_worksheet (xlsx_info *xinfo,
 	err = xlsx_check_dimensions(xinfo, prn);
 	if (!err) {
 	    /* second pass: get actual data */
-	    i = 0;
 	    gretl_push_c_numeric_locale();
-	    c1 = data_node;
-	    while (c1 != NULL && !err) {
-		if (!xmlStrcmp(c1->name, (XUC) "row")) {
-		    err = xlsx_read_row(c1, xinfo, i++, prn);
-		}
-		c1 = c1->next;
-	    }
+	    err = xlsx_read_rows(xinfo, prn);
 	    gretl_pop_c_numeric_locale();
 	}
     }
@@ -1093,14 +1188,7 @@ static int xlsx_read_worksheet (xlsx_info *xinfo,
 	err = xlsx_non_numeric_check(xinfo, prn);
 	if (!err && xinfo->codelist != NULL) {
 	    /* third pass, if needed: get string-valued vars */
-	    c1 = data_node;
-	    i = 0;
-	    while (c1 != NULL && !err) {
-		if (!xmlStrcmp(c1->name, (XUC) "row")) {
-		    err = xlsx_read_row(c1, xinfo, i++, prn);
-		}
-		c1 = c1->next;
-	    }
+	    err = xlsx_read_rows(xinfo, prn);
 	    if (!err) {
 		err = gretl_string_table_validate(xinfo->st, OPT_S);
 		if (err) {
@@ -1112,40 +1200,26 @@ static int xlsx_read_worksheet (xlsx_info *xinfo,
 	}
     }
 
-    xmlFreeDoc(doc);
-
     return err;
 }
 
 /* A quick check to see if a worksheet XML file contains
-   any actual data. */
+   any actual data: we stop reading at the first row.
+*/
 
 static int xlsx_sheet_has_data (const char *fname)
 {
-    xmlDocPtr doc = NULL;
-    xmlNodePtr c1, cur = NULL;
+    xmlTextReaderPtr reader;
     gchar *fullname;
-    int err, ret = 0;
+    int skip = 0;
+    int err = 0, ret = 0;
 
     fullname = g_strdup_printf("xl%c%s", SLASH, fname);
 
-    err = gretl_xml_open_doc_root(fullname, "worksheet",
-				  &doc, &cur);
+    reader = xlsx_reader_open(fullname, "worksheet", &err);
     if (!err) {
-	cur = cur->xmlChildrenNode;
-	while (cur != NULL && ret == 0) {
-	    if (!xmlStrcmp(cur->name, (XUC) "sheetData")) {
-		c1 = cur->xmlChildrenNode;
-		while (c1 != NULL && ret == 0) {
-		    if (!xmlStrcmp(c1->name, (XUC) "row")) {
-			ret = 1;
-		    }
-		    c1 = c1->next;
-		}
-	    }
-	    cur = cur->next;
-	}
-	xmlFreeDoc(doc);
+	ret = xlsx_next_element(reader, "row", 2, &skip) == 1;
+	xmlFreeTextReader(reader);
     }
 
     if (!ret) {
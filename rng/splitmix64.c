@@ -26,10 +26,16 @@ IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE. */
 
 static uint64_t smx; /* The state can be seeded with any value. */
 
-static inline uint64_t splitmix64_next() {
-    uint64_t z = (smx += 0x9e3779b97f4a7c15);
-        
+/* get the next value, advancing the state pointed to by @x */
+
+static inline uint64_t splitmix64_next_s(uint64_t *x) {
+    uint64_t z = (*x += 0x9e3779b97f4a7c15);
+
     z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
     z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
     return z ^ (z >> 31);
 }
+
+static inline uint64_t splitmix64_next() {
+    return splitmix64_next_s(&smx);
+}
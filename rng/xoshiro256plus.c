@@ -39,100 +39,102 @@ static inline uint64_t xor_rotl (const uint64_t x, int k) {
 
 static uint64_t xor_state[4];
 
+/* seed state @s from @u, via splitmix64 */
+
+static void set_xor_state_s (uint64_t *s, uint64_t u)
+{
+    s[0] = u;
+    s[1] = splitmix64_next_s(&u);
+    s[2] = splitmix64_next_s(&u);
+    s[3] = splitmix64_next_s(&u);
+}
+
 static void set_xor_state (uint64_t u)
 {
-    xor_state[0] = smx = u;
-    xor_state[1] = splitmix64_next();
-    xor_state[2] = splitmix64_next();
-    xor_state[3] = splitmix64_next();
+    set_xor_state_s(xor_state, u);
 }
 
-/* get the next pseudo-random uint64_t */
+/* get the next pseudo-random uint64_t from state @s */
 
-static uint64_t xor_i64 (void) {
-    const uint64_t ret = xor_state[0] + xor_state[3];
-    const uint64_t t = xor_state[1] << 17;
+static inline uint64_t xor_i64_s (uint64_t *s) {
+    const uint64_t ret = s[0] + s[3];
+    const uint64_t t = s[1] << 17;
 
-    xor_state[2] ^= xor_state[0];
-    xor_state[3] ^= xor_state[1];
-    xor_state[1] ^= xor_state[2];
-    xor_state[0] ^= xor_state[3];
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
 
-    xor_state[2] ^= t;
-    xor_state[3] = xor_rotl(xor_state[3], 45);
+    s[2] ^= t;
+    s[3] = xor_rotl(s[3], 45);
 
     return ret;
 }
 
-/* This is the jump function for the generator. It is equivalent to
-   2^128 calls to xor_i64(); it can be used to generate 2^128
-   non-overlapping subsequences for parallel computations.
+/* get the next pseudo-random uint64_t from the global state */
+
+static uint64_t xor_i64 (void) {
+    return xor_i64_s(xor_state);
+}
+
+/* Apply to state @s the jump polynomial @J: this is shared by
+   the jump and long-jump functions below.
 */
 
-static void xor_jump (void) {
-    static const uint64_t JUMP[] = {
-        0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
-        0xa9582618e03fc9aa, 0x39abdc4529b1661c
-    };
+static void xor_apply_jump (uint64_t *s, const uint64_t *J) {
     uint64_t s0 = 0;
     uint64_t s1 = 0;
     uint64_t s2 = 0;
     uint64_t s3 = 0;
     int i, b;
 
-    for (i = 0; i < sizeof JUMP / sizeof *JUMP; i++) {
+    for (i = 0; i < 4; i++) {
         for (b = 0; b < 64; b++) {
-            if (JUMP[i] & UINT64_C(1) << b) {
-                s0 ^= xor_state[0];
-                s1 ^= xor_state[1];
-                s2 ^= xor_state[2];
-                s3 ^= xor_state[3];
+            if (J[i] & UINT64_C(1) << b) {
+                s0 ^= s[0];
+                s1 ^= s[1];
+                s2 ^= s[2];
+                s3 ^= s[3];
             }
-            xor_i64();
+            xor_i64_s(s);
         }
     }
 
-    xor_state[0] = s0;
-    xor_state[1] = s1;
-    xor_state[2] = s2;
-    xor_state[3] = s3;
+    s[0] = s0;
+    s[1] = s1;
+    s[2] = s2;
+    s[3] = s3;
+}
+
+/* This is the jump function for the generator. It is equivalent to
+   2^128 calls to xor_i64_s(); it can be used to generate 2^128
+   non-overlapping subsequences for parallel computations.
+*/
+
+static void xor_jump_s (uint64_t *s) {
+    static const uint64_t JUMP[] = {
+        0x180ec6d33cfd0aba, 0xd5a61266f0c9392c,
+        0xa9582618e03fc9aa, 0x39abdc4529b1661c
+    };
+
+    xor_apply_jump(s, JUMP);
 }
 
-#if 0 /* we might want this later? */
+static void xor_jump (void) {
+    xor_jump_s(xor_state);
+}
 
 /* This is the long-jump function for the generator. It is equivalent to
-   2^192 calls to xor_next(); it can be used to generate 2^64 starting
+   2^192 calls to xor_i64_s(); it can be used to generate 2^64 starting
    points, from each of which jump() will generate 2^64 non-overlapping
    subsequences for parallel distributed computations.
 */
 
-static void xor_long_jump (void) {
+static void xor_long_jump_s (uint64_t *s) {
     static const uint64_t LONG_JUMP[] = {
         0x76e15d3efefdcbbf, 0xc5004e441c522fb3,
         0x77710069854ee241, 0x39109bb02acbe635
     };
-    uint64_t s0 = 0;
-    uint64_t s1 = 0;
-    uint64_t s2 = 0;
-    uint64_t s3 = 0;
-    int i, b;
-
-    for (i = 0; i < sizeof LONG_JUMP / sizeof *LONG_JUMP; i++) {
-        for (b = 0; b < 64; b++) {
-            if (LONG_JUMP[i] & UINT64_C(1) << b) {
-                s0 ^= xor_state[0];
-                s1 ^= xor_state[1];
-                s2 ^= xor_state[2];
-                s3 ^= xor_state[3];
-            }
-            xor_i64();
-        }
-    }
 
-    xor_state[0] = s0;
-    xor_state[1] = s1;
-    xor_state[2] = s2;
-    xor_state[3] = s3;
+    xor_apply_jump(s, LONG_JUMP);
 }
-
-#endif
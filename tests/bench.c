@@ -0,0 +1,840 @@
+/* gretl - The Gnu Regression, Econometrics and Time-series Library
+ * Copyright (C) 2001 Allin Cottrell and Riccardo "Jack" Lucchetti
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* bench -- micro-benchmarks for some of libgretl's hot paths:
+   matrix multiplication, decompositions, OLS, the Kalman filter,
+   data-file I/O, genr and loop overhead, plus end-to-end timings
+   of a set of estimators on synthetic data. Timings are written
+   to stdout (or to the file given via -o) in JSON format, with a
+   view to comparing one build of gretl against another.
+*/
+
+#include "libgretl.h"
+#include "version.h"
+#include "kalman.h"
+#include "monte_carlo.h"
+#include "cmd_private.h"
+#include "gretl_xml.h"
+#include "csvdata.h"
+#include "gretl_mt.h"
+#include "gretl_memstats.h"
+
+#include <string.h>
+#include <glib.h>
+
+#define DEFAULT_MINTIME 0.25 /* seconds per timing round */
+#define DEFAULT_ROUNDS  5
+
+typedef struct bench_ bench;
+
+struct bench_ {
+    const char *name;   /* identifier of the benchmark */
+    int n, k;           /* size parameters */
+    int (*setup) (bench *b);
+    int (*run) (bench *b);
+    void (*cleanup) (bench *b);
+    gretl_matrix *A, *B, *C, *D;
+    DATASET *dset;
+    char *fname;
+    int u;              /* estimators: see make_est_data() */
+    const char *cmd;    /* estimators: command to time */
+};
+
+static double mintime = DEFAULT_MINTIME;
+static int rounds = DEFAULT_ROUNDS;
+static int scale = 1;    /* multiplier for estimator data sizes */
+static PRN *nullprn; /* sink for output we don't want */
+
+static double now (void)
+{
+    return g_get_monotonic_time() / 1.0e6;
+}
+
+static void bench_cleanup (bench *b)
+{
+    gretl_matrix_free(b->A);
+    gretl_matrix_free(b->B);
+    gretl_matrix_free(b->C);
+    gretl_matrix_free(b->D);
+    b->A = b->B = b->C = b->D = NULL;
+    if (b->dset != NULL) {
+	destroy_dataset(b->dset);
+	b->dset = NULL;
+    }
+    if (b->fname != NULL) {
+	gretl_remove(b->fname);
+	g_free(b->fname);
+	b->fname = NULL;
+    }
+}
+
+/* matrix products: A is n x k, B is k x n */
+
+static int matmul_setup (bench *b)
+{
+    b->A = gretl_matrix_alloc(b->n, b->k);
+    b->B = gretl_matrix_alloc(b->k, b->n);
+    b->C = gretl_matrix_alloc(b->n, b->n);
+    if (b->A == NULL || b->B == NULL || b->C == NULL) {
+	return E_ALLOC;
+    }
+    gretl_matrix_random_fill(b->A, D_NORMAL);
+    gretl_matrix_random_fill(b->B, D_NORMAL);
+
+    return 0;
+}
+
+static int matmul_run (bench *b)
+{
+    return gretl_matrix_multiply(b->A, b->B, b->C);
+}
+
+/* X'X for tall X (n x k): the typical regression shape */
+
+static int xtx_setup (bench *b)
+{
+    b->A = gretl_matrix_alloc(b->n, b->k);
+    b->C = gretl_matrix_alloc(b->k, b->k);
+    if (b->A == NULL || b->C == NULL) {
+	return E_ALLOC;
+    }
+    gretl_matrix_random_fill(b->A, D_NORMAL);
+
+    return 0;
+}
+
+static int xtx_run (bench *b)
+{
+    return gretl_matrix_multiply_mod(b->A, GRETL_MOD_TRANSPOSE,
+				     b->A, GRETL_MOD_NONE,
+				     b->C, GRETL_MOD_NONE);
+}
+
+/* decompositions of a k x k positive definite matrix, held in
+   B; each run works on a fresh copy, in C */
+
+static int pd_setup (bench *b)
+{
+    int err;
+
+    b->A = gretl_matrix_alloc(b->n, b->k);
+    if (b->A == NULL) {
+	return E_ALLOC;
+    }
+    gretl_matrix_random_fill(b->A, D_NORMAL);
+    b->B = gretl_matrix_XTX_new(b->A);
+    b->C = gretl_matrix_copy(b->B);
+    err = (b->B == NULL || b->C == NULL)? E_ALLOC : 0;
+
+    return err;
+}
+
+static int cholesky_run (bench *b)
+{
+    gretl_matrix_copy_values(b->C, b->B);
+    return gretl_matrix_cholesky_decomp(b->C);
+}
+
+static int eigensym_run (bench *b)
+{
+    gretl_matrix *ev;
+    int err = 0;
+
+    gretl_matrix_copy_values(b->C, b->B);
+    ev = gretl_symmetric_matrix_eigenvals(b->C, 1, &err);
+    gretl_matrix_free(ev);
+
+    return err;
+}
+
+/* QR decomposition of an n x k matrix */
+
+static int qr_setup (bench *b)
+{
+    b->A = gretl_matrix_alloc(b->n, b->k);
+    b->C = gretl_matrix_alloc(b->n, b->k);
+    b->D = gretl_matrix_alloc(b->k, b->k);
+    if (b->A == NULL || b->C == NULL || b->D == NULL) {
+	return E_ALLOC;
+    }
+    gretl_matrix_random_fill(b->A, D_NORMAL);
+
+    return 0;
+}
+
+static int qr_run (bench *b)
+{
+    gretl_matrix_copy_values(b->C, b->A);
+    return gretl_matrix_QR_decomp(b->C, b->D);
+}
+
+/* a synthetic dataset with n observations on a constant plus
+   series x1 to xk, and y = sum of the x's plus noise */
+
+static int make_dataset (bench *b)
+{
+    DATASET *dset;
+    int i, t, nv = b->k + 2;
+    int nobs = b->u > 1 ? b->n * b->u : b->n;
+
+    dset = create_new_dataset(nv, nobs, 0);
+    if (dset == NULL) {
+	return E_ALLOC;
+    }
+
+    for (i=1; i<nv; i++) {
+	gretl_rand_normal(dset->Z[i], 0, nobs - 1);
+	if (i < nv - 1) {
+	    sprintf(dset->varname[i], "x%d", i);
+	} else {
+	    strcpy(dset->varname[i], "y");
+	}
+    }
+    for (t=0; t<nobs; t++) {
+	for (i=1; i<nv-1; i++) {
+	    dset->Z[nv-1][t] += dset->Z[i][t];
+	}
+    }
+    b->dset = dset;
+
+    return 0;
+}
+
+static int ols_run (bench *b)
+{
+    int *list = gretl_list_new(b->k + 2);
+    MODEL model;
+    int i, err;
+
+    if (list == NULL) {
+	return E_ALLOC;
+    }
+
+    /* y const x1 ... xk */
+    list[1] = b->k + 1;
+    list[2] = 0;
+    for (i=1; i<=b->k; i++) {
+	list[i+2] = i;
+    }
+
+    model = lsq(list, b->dset, OLS, OPT_NONE);
+    err = model.errcode;
+    clear_model(&model);
+    free(list);
+
+    return err;
+}
+
+/* Kalman filter for the local level model, y_t = mu_t + e_t,
+   mu_t = mu_{t-1} + v_t, on a random walk of length n: y is held
+   in A and the forecast errors go into D; the system matrices
+   are in @kb.
+*/
+
+typedef struct kbench_ kbench;
+
+struct kbench_ {
+    gretl_matrix *a, *P, *T, *ZT, *VS, *VY;
+};
+
+static kbench kb;
+
+static int kalman_setup (bench *b)
+{
+    double *y;
+    int t;
+
+    b->A = gretl_matrix_alloc(b->n, 1);
+    b->D = gretl_matrix_alloc(b->n, 1);
+    if (b->A == NULL || b->D == NULL) {
+	return E_ALLOC;
+    }
+    y = b->A->val;
+    gretl_rand_normal(y, 0, b->n - 1);
+    for (t=1; t<b->n; t++) {
+	y[t] += y[t-1];
+    }
+
+    kb.a = gretl_zero_matrix_new(1, 1);
+    kb.P = gretl_matrix_alloc(1, 1);
+    kb.T = gretl_identity_matrix_new(1);
+    kb.ZT = gretl_identity_matrix_new(1);
+    kb.VS = gretl_matrix_alloc(1, 1);
+    kb.VY = gretl_matrix_alloc(1, 1);
+    if (kb.a == NULL || kb.P == NULL || kb.T == NULL ||
+	kb.ZT == NULL || kb.VS == NULL || kb.VY == NULL) {
+	return E_ALLOC;
+    }
+    kb.P->val[0] = 1.0e7;
+    kb.VS->val[0] = 1.0;
+    kb.VY->val[0] = 0.5;
+
+    return 0;
+}
+
+static int kalman_run (bench *b)
+{
+    kalman *K;
+    int err = 0;
+
+    K = kalman_new(kb.a, kb.P, kb.T, NULL, kb.ZT, kb.VS, kb.VY,
+		   b->A, NULL, NULL, b->D, &err);
+    if (!err) {
+	err = kfilter_standard(K, NULL);
+    }
+    kalman_free(K);
+
+    return err;
+}
+
+static void kalman_cleanup (bench *b)
+{
+    gretl_matrix_free(kb.a);
+    gretl_matrix_free(kb.P);
+    gretl_matrix_free(kb.T);
+    gretl_matrix_free(kb.ZT);
+    gretl_matrix_free(kb.VS);
+    gretl_matrix_free(kb.VY);
+    memset(&kb, 0, sizeof kb);
+    bench_cleanup(b);
+}
+
+/* data-file I/O: write and read back the synthetic dataset */
+
+static int io_setup (bench *b, const char *ext)
+{
+    int err = make_dataset(b);
+
+    if (!err) {
+	gchar *base = g_strdup_printf("gretl_bench%s", ext);
+
+	b->fname = g_build_filename(g_get_tmp_dir(), base, NULL);
+	g_free(base);
+    }
+
+    return err;
+}
+
+static int csv_setup (bench *b)
+{
+    return io_setup(b, ".csv");
+}
+
+static int gdtb_setup (bench *b)
+{
+    return io_setup(b, ".gdtb");
+}
+
+static int csv_write_run (bench *b)
+{
+    return write_data(b->fname, NULL, b->dset, OPT_C | OPT_Q, NULL);
+}
+
+static int gdtb_write_run (bench *b)
+{
+    return gretl_write_gdt(b->fname, NULL, b->dset, OPT_NONE, 0);
+}
+
+static int csv_read_setup (bench *b)
+{
+    int err = csv_setup(b);
+
+    return err ? err : csv_write_run(b);
+}
+
+static int gdtb_read_setup (bench *b)
+{
+    int err = gdtb_setup(b);
+
+    return err ? err : gdtb_write_run(b);
+}
+
+static int csv_read_run (bench *b)
+{
+    DATASET *dset = datainfo_new();
+    int err;
+
+    if (dset == NULL) {
+	return E_ALLOC;
+    }
+    err = import_csv(b->fname, dset, OPT_NONE, nullprn);
+    destroy_dataset(dset);
+
+    return err;
+}
+
+static int gdtb_read_run (bench *b)
+{
+    DATASET *dset = datainfo_new();
+    int err;
+
+    if (dset == NULL) {
+	return E_ALLOC;
+    }
+    err = gretl_read_gdt(b->fname, dset, OPT_NONE, nullprn);
+    destroy_dataset(dset);
+
+    return err;
+}
+
+/* genr: evaluation of a series expression over n observations */
+
+static int genr_run (bench *b)
+{
+    return generate("z = log(x1^2 + 1) + sin(x2) * x3 - sqrt(abs(x4))",
+		    b->dset, GRETL_TYPE_SERIES, OPT_Q, nullprn);
+}
+
+/* loop overhead: n iterations of a trivial scalar increment,
+   executed as the command-line client would do it
+*/
+
+static int loop_run (bench *b)
+{
+    const char *lines[] = {
+	"scalar bench_acc = 0",
+	"loop i=1..%d --quiet",
+	"bench_acc += i",
+	"endloop",
+	NULL
+    };
+    char line[MAXLINE];
+    ExecState state;
+    CMD cmd;
+    int i, err;
+
+    err = gretl_cmd_init(&cmd);
+    if (err) {
+	return err;
+    }
+
+    gretl_exec_state_init(&state, 0, line, &cmd, NULL, nullprn);
+
+    for (i=0; lines[i] != NULL && !err; i++) {
+	if (i == 1) {
+	    sprintf(line, lines[i], b->n);
+	} else {
+	    strcpy(line, lines[i]);
+	}
+	err = maybe_exec_line(&state, b->dset, NULL);
+    }
+
+    while (!err && gretl_execute_loop()) {
+	err = gretl_loop_exec(&state, b->dset);
+    }
+
+    gretl_exec_state_clear(&state);
+    user_var_delete_by_name("bench_acc", NULL);
+
+    return err;
+}
+
+/* execute the NULL-terminated array of command @lines on @dset,
+   as the command-line client would do it */
+
+static int exec_lines (DATASET *dset, const char **lines)
+{
+    char line[MAXLINE];
+    ExecState state;
+    CMD cmd;
+    int i, err;
+
+    err = gretl_cmd_init(&cmd);
+    if (err) {
+	return err;
+    }
+
+    gretl_exec_state_init(&state, 0, line, &cmd, NULL, nullprn);
+
+    for (i=0; lines[i] != NULL && !err; i++) {
+	strcpy(line, lines[i]);
+	err = maybe_exec_line(&state, dset, NULL);
+    }
+
+    gretl_exec_state_clear(&state);
+
+    return err;
+}
+
+/* Estimators: synthetic data from make_dataset(), with y, x1 to
+   xk gathered in the list X and a binary yb = (y > 0). The field
+   u gives the structure: 0 for cross-section data on n
+   observations, 1 for a time series of length n, and u > 1 for
+   a panel of u units observed over n periods.
+*/
+
+static int make_est_data (bench *b)
+{
+    char setobs[64];
+    const char *lines[] = {
+	"list X = x*",
+	"series yb = y > 0",
+	setobs,
+	NULL
+    };
+    int err;
+
+    if (b->u > 1) {
+	sprintf(setobs, "setobs %d 1:1 --stacked-time-series", b->n);
+    } else if (b->u == 1) {
+	strcpy(setobs, "setobs 1 1 --time-series");
+    } else {
+	lines[2] = NULL;
+    }
+
+    err = make_dataset(b);
+    if (!err) {
+	err = exec_lines(b->dset, lines);
+    }
+
+    return err;
+}
+
+static int estimator_run (bench *b)
+{
+    const char *lines[] = { b->cmd, NULL };
+
+    return exec_lines(b->dset, lines);
+}
+
+static void estimator_cleanup (bench *b)
+{
+    user_var_delete_by_name("X", NULL);
+    user_var_delete_by_name("bench_b", NULL);
+    bench_cleanup(b);
+}
+
+#define ESTIMATOR(name, n, k, u, cmd) \
+    { name, n, k, make_est_data, estimator_run, estimator_cleanup, \
+      NULL, NULL, NULL, NULL, NULL, NULL, u, cmd }
+
+static bench benchmarks[] = {
+    { "matmul",      50,   50,  matmul_setup, matmul_run },
+    { "matmul",      200,  200, matmul_setup, matmul_run },
+    { "matmul",      500,  500, matmul_setup, matmul_run },
+    { "matmul",      1000, 10,  matmul_setup, matmul_run },
+    { "xtx",         10000, 20, xtx_setup, xtx_run },
+    { "xtx",         100000, 5, xtx_setup, xtx_run },
+    { "cholesky",    400,  50,  pd_setup, cholesky_run },
+    { "cholesky",    2000, 500, pd_setup, cholesky_run },
+    { "qr",          2000, 50,  qr_setup, qr_run },
+    { "eigensym",    400,  50,  pd_setup, eigensym_run },
+    { "eigensym",    2000, 300, pd_setup, eigensym_run },
+    { "ols",         1000, 5,   make_dataset, ols_run },
+    { "ols",         100000, 10, make_dataset, ols_run },
+    { "kfilter",     5000, 1,   kalman_setup, kalman_run, kalman_cleanup },
+    { "csv_write",   10000, 10, csv_setup, csv_write_run },
+    { "csv_read",    10000, 10, csv_read_setup, csv_read_run },
+    { "gdtb_write",  100000, 10, gdtb_setup, gdtb_write_run },
+    { "gdtb_read",   100000, 10, gdtb_read_setup, gdtb_read_run },
+    { "genr",        100000, 4, make_dataset, genr_run },
+    { "loop",        10000, 1,  make_dataset, loop_run },
+    ESTIMATOR("ols",      10000, 10, 0, "ols y 0 X --quiet"),
+    ESTIMATOR("ols",      10000, 100, 0, "ols y 0 X --quiet"),
+    ESTIMATOR("probit",   10000, 10, 0, "probit yb 0 X --quiet"),
+    ESTIMATOR("logit",    10000, 10, 0, "logit yb 0 X --quiet"),
+    ESTIMATOR("quantreg", 5000, 10, 0, "quantreg 0.5 y 0 X --quiet"),
+    ESTIMATOR("regls",    5000, 50, 0, "bundle bench_b = regls(y, X)"),
+    ESTIMATOR("arma",     1000, 1,  1, "arma 1 1 ; y --quiet"),
+    ESTIMATOR("garch",    2000, 1,  1, "garch 1 1 ; y --quiet"),
+    ESTIMATOR("var",      1000, 5,  1, "var 4 X --quiet"),
+    ESTIMATOR("panel_fe", 10, 5, 1000, "panel y 0 X --fixed-effects --quiet"),
+    ESTIMATOR("panel_fe", 50, 5, 1000, "panel y 0 X --fixed-effects --quiet"),
+    ESTIMATOR("panel_re", 10, 5, 1000, "panel y 0 X --random-effects --quiet"),
+};
+
+static int cmp_double (const void *a, const void *b)
+{
+    const double *da = a, *db = b;
+
+    return (*da > *db) - (*da < *db);
+}
+
+/* run @rounds rounds of @reps repetitions of @b, recording the
+   per-repetition times in @tm, sorted */
+
+static int time_rounds (bench *b, int reps, double *tm)
+{
+    double t0;
+    int i, r, err = 0;
+
+    for (r=0; r<rounds && !err; r++) {
+	t0 = now();
+	for (i=0; i<reps && !err; i++) {
+	    err = b->run(b);
+	}
+	tm[r] = (now() - t0) / reps;
+	gretl_print_reset_buffer(nullprn);
+    }
+
+    if (!err) {
+	qsort(tm, rounds, sizeof *tm, cmp_double);
+    }
+
+    return err;
+}
+
+/* for estimators: the peak memory use (over matrices, bundles,
+   models and LAPACK workspace, as recorded by gretl_memstats)
+   for a single run of @b */
+
+static double run_memory_peak (bench *b, int *err)
+{
+    gretl_bundle *mb;
+    gretl_matrix *m;
+    double peak = 0;
+    int i;
+
+    gretl_memstats_start();
+    *err = b->run(b);
+    gretl_print_reset_buffer(nullprn);
+    mb = gretl_memstats_bundle(b->dset, err);
+    gretl_memstats_stop();
+
+    if (!*err) {
+	m = gretl_bundle_get_matrix(mb, "bytes", err);
+	/* skip the first row, the dataset, which is not the
+	   estimator's doing */
+	for (i=1; m != NULL && i<m->rows; i++) {
+	    peak += gretl_matrix_get(m, i, 1);
+	}
+    }
+    gretl_bundle_destroy(mb);
+
+    return peak;
+}
+
+/* for estimators: time @b at 1, 2, 4, ... OpenMP threads up to
+   the number available, printing the minimum time per
+   repetition and the parallel efficiency, t(1) / (p * t(p)) */
+
+static int print_thread_scaling (bench *b, int reps, double *tm,
+				 FILE *fp)
+{
+    int pmax = gretl_get_omp_threads();
+    double t1 = 0;
+    int p, err = 0;
+
+    fputs(",\n     \"threads\": [", fp);
+    if (pmax < 1) {
+	/* no OpenMP */
+	fputs("]", fp);
+	return 0;
+    }
+
+    for (p=1; p<=pmax && !err; ) {
+	err = gretl_set_omp_threads(p);
+	if (!err) {
+	    err = time_rounds(b, reps, tm);
+	}
+	if (!err) {
+	    if (p == 1) {
+		t1 = tm[0];
+	    }
+	    fprintf(fp, "%s{\"p\": %d, \"min\": %.6e, \"efficiency\": %.3f}",
+		    p > 1 ? ", " : "", p, tm[0], t1 / (p * tm[0]));
+	}
+	/* double up, but make sure we finish on pmax */
+	p = (p < pmax && 2*p > pmax)? pmax : 2*p;
+    }
+    fputs("]", fp);
+
+    gretl_set_omp_threads(pmax);
+
+    return err;
+}
+
+/* Time benchmark @b: the number of repetitions per round is
+   calibrated so that a round takes at least @mintime seconds;
+   we then record the per-repetition time for each of @rounds
+   rounds. For estimators we also record the peak memory use and
+   the scaling with the number of threads.
+*/
+
+static int time_benchmark (bench *b, FILE *fp, int first)
+{
+    double *tm, t0, dt;
+    double mem = 0;
+    int reps = 1;
+    int i, r;
+    int err;
+
+    tm = malloc(rounds * sizeof *tm);
+    if (tm == NULL) {
+	return E_ALLOC;
+    }
+
+    gretl_rand_set_seed(20250101);
+    err = b->setup(b);
+
+    /* calibrate */
+    while (!err) {
+	t0 = now();
+	for (i=0; i<reps && !err; i++) {
+	    err = b->run(b);
+	}
+	dt = now() - t0;
+	gretl_print_reset_buffer(nullprn);
+	if (dt >= mintime / 4 || reps >= (1 << 24)) {
+	    reps = (int) ceil(reps * mintime / (dt > 0 ? dt : 1e-9));
+	    if (reps < 1) {
+		reps = 1;
+	    }
+	    break;
+	}
+	reps *= 4;
+    }
+
+    if (!err) {
+	err = time_rounds(b, reps, tm);
+    }
+
+    if (!err && b->cmd != NULL) {
+	mem = run_memory_peak(b, &err);
+    }
+
+    if (!err) {
+	double mean = 0;
+
+	for (r=0; r<rounds; r++) {
+	    mean += tm[r];
+	}
+	mean /= rounds;
+	fprintf(fp, "%s    {\"name\": \"%s\", \"n\": %d, \"k\": %d, ",
+		first ? "" : ",\n", b->name, b->n, b->k);
+	if (b->u > 1) {
+	    fprintf(fp, "\"units\": %d, ", b->u);
+	}
+	fprintf(fp, "\"reps\": %d, \"rounds\": %d,\n"
+		"     \"min\": %.6e, \"median\": %.6e, \"mean\": %.6e",
+		reps, rounds, tm[0], tm[rounds/2], mean);
+	if (b->cmd != NULL) {
+	    fprintf(fp, ", \"mem_peak\": %.0f", mem);
+	    err = print_thread_scaling(b, reps, tm, fp);
+	}
+	fputc('}', fp);
+    }
+
+    if (err) {
+	fprintf(stderr, "%s (n=%d, k=%d): error %d\n", b->name,
+		b->n, b->k, err);
+    }
+
+    if (b->cleanup != NULL) {
+	b->cleanup(b);
+    } else {
+	bench_cleanup(b);
+    }
+    free(tm);
+
+    return err;
+}
+
+static void usage (const char *prog)
+{
+    fprintf(stderr, "usage: %s [-f filter] [-t mintime] [-r rounds] "
+	    "[-x scale] [-o outfile]\n"
+	    " -f: run only benchmarks whose name contains 'filter'\n"
+	    " -t: minimum seconds per timing round (default %g)\n"
+	    " -r: number of timing rounds (default %d)\n"
+	    " -x: multiply the number of observations (or panel units)\n"
+	    "     for the estimator benchmarks by 'scale'\n"
+	    " -o: write JSON to outfile rather than stdout\n",
+	    prog, DEFAULT_MINTIME, DEFAULT_ROUNDS);
+    exit(EXIT_FAILURE);
+}
+
+int main (int argc, char *argv[])
+{
+    const char *filter = NULL;
+    const char *outname = NULL;
+    FILE *fp = stdout;
+    int nb = sizeof benchmarks / sizeof benchmarks[0];
+    int i, first = 1;
+    int nerr = 0;
+
+    for (i=1; i<argc; i++) {
+	if (i < argc - 1 && !strcmp(argv[i], "-f")) {
+	    filter = argv[++i];
+	} else if (i < argc - 1 && !strcmp(argv[i], "-t")) {
+	    mintime = atof(argv[++i]);
+	} else if (i < argc - 1 && !strcmp(argv[i], "-r")) {
+	    rounds = atoi(argv[++i]);
+	} else if (i < argc - 1 && !strcmp(argv[i], "-x")) {
+	    scale = atoi(argv[++i]);
+	} else if (i < argc - 1 && !strcmp(argv[i], "-o")) {
+	    outname = argv[++i];
+	} else {
+	    usage(argv[0]);
+	}
+    }
+
+    if (mintime <= 0 || rounds < 1 || scale < 1) {
+	usage(argv[0]);
+    }
+
+    for (i=0; i<nb && scale > 1; i++) {
+	if (benchmarks[i].cmd == NULL) {
+	    continue;
+	} else if (benchmarks[i].u > 1) {
+	    benchmarks[i].u *= scale;
+	} else {
+	    benchmarks[i].n *= scale;
+	}
+    }
+
+    libgretl_init();
+    nullprn = gretl_print_new(GRETL_PRINT_BUFFER, NULL);
+
+    if (outname != NULL) {
+	fp = fopen(outname, "w");
+	if (fp == NULL) {
+	    fprintf(stderr, "couldn't open %s\n", outname);
+	    exit(EXIT_FAILURE);
+	}
+    }
+
+    fprintf(fp, "{\n  \"gretl_version\": \"%s\",\n", GRETL_VERSION);
+    fprintf(fp, "  \"n_processors\": %d,\n", gretl_n_processors());
+    fprintf(fp, "  \"omp_threads\": %d,\n", gretl_get_omp_threads());
+    fprintf(fp, "  \"mintime\": %g,\n", mintime);
+    fprintf(fp, "  \"scale\": %d,\n", scale);
+    fputs("  \"benchmarks\": [\n", fp);
+
+    for (i=0; i<nb; i++) {
+	if (filter != NULL && strstr(benchmarks[i].name, filter) == NULL) {
+	    continue;
+	}
+	if (time_benchmark(&benchmarks[i], fp, first)) {
+	    nerr++;
+	} else {
+	    first = 0;
+	}
+	fflush(fp);
+    }
+
+    fputs("\n  ]\n}\n", fp);
+
+    if (fp != stdout) {
+	fclose(fp);
+    }
+
+    gretl_print_destroy(nullprn);
+    libgretl_cleanup();
+
+    return nerr > 0;
+}
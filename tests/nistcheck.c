@@ -22,9 +22,12 @@
 
 #include "libgretl.h"
 #include "version.h"
+#include "libset.h"
+#include "gretl_mt.h"
 
 #include <string.h>
 #include <float.h>
+#include <glib.h>
 
 #ifdef LONGLEY_ONLY
 # define MAX_DIGITS 12
@@ -815,6 +818,173 @@ int run_gretl_comparison (const char *datname,
 
 #ifdef STANDALONE
 
+/* The table mode (-a): each dataset is estimated via several
+   paths -- Cholesky, QR, pivoted QR and the GMP plugin -- and
+   for each we print one line giving the worst-case log relative
+   error and the time per estimation. The format is fixed, so the
+   tables produced by two builds (or versions) of gretl can be
+   compared with diff; use -n to leave out the timings, which
+   will differ from run to run.
+*/
+
+enum {
+    EST_CHOL,
+    EST_QR,
+    EST_QRPIV,
+    EST_MP,
+    EST_MAX
+};
+
+static const char *path_names[] = {
+    "chol", "qr", "qrpiv", "mp"
+};
+
+#define TIMING_MIN 0.05 /* seconds per timing run */
+
+static int notimes;
+
+static int *nist_reglist (int nv)
+{
+    int *list = gretl_list_new(nv);
+    int i;
+
+    if (list == NULL) {
+	return NULL;
+    }
+
+    if (noint) {
+	list[0] = nv - 1;
+	for (i=1; i<=list[0]; i++) {
+	    list[i] = i;
+	}
+    } else {
+	list[0] = nv;
+	list[1] = 1;
+	list[2] = 0;
+	for (i=3; i<=list[0]; i++) {
+	    list[i] = i - 1;
+	}
+    }
+
+    return list;
+}
+
+static int estimate_via_path (int path, DATASET *dset, int npoly,
+			      const int *zdigits, MODEL *pmod)
+{
+    static int (*mplsq)(const int *, const int *, const int *,
+			const DATASET *, MODEL *, gretlopt);
+    int *list, *polylist = NULL;
+    int i, err = 0;
+
+    if (path == EST_MP) {
+	if (mplsq == NULL) {
+	    mplsq = get_mplsq();
+	    if (mplsq == NULL) {
+		return E_EXTERNAL;
+	    }
+	}
+	list = nist_reglist(dset->v - npoly);
+	if (npoly) {
+	    polylist = gretl_list_new(npoly);
+	    for (i=1; i<=npoly; i++) {
+		polylist[i] = i + 1;
+	    }
+	}
+	gretl_model_init(pmod, dset);
+	err = (*mplsq)(list, polylist, zdigits, dset, pmod, OPT_NONE);
+	free(polylist);
+    } else {
+	libset_set_int(USE_QR, path - EST_CHOL);
+	list = nist_reglist(dset->v);
+	*pmod = lsq(list, dset, OLS, OPT_Z);
+	err = pmod->errcode;
+	libset_set_int(USE_QR, 0);
+	if (!err && noint) {
+	    double xx = 0.0;
+	    int t;
+
+	    for (t=0; t<dset->n; t++) {
+		xx += dset->Z[1][t] * dset->Z[1][t];
+	    }
+	    pmod->rsq = 1.0 - pmod->ess / xx;
+	}
+    }
+
+    free(list);
+
+    return err;
+}
+
+static void print_table_header (PRN *prn)
+{
+    pprintf(prn, "# nistcheck: gretl %s\n", GRETL_VERSION);
+    pprintf(prn, "# blas %s, simd %s, threads %d\n",
+	    blas_variant_string(), gretl_matrix_simd_id(),
+	    gretl_get_omp_threads());
+    if (notimes) {
+	pprintf(prn, "# %-12s %-6s %7s\n", "dataset", "path", "LRE");
+    } else {
+	pprintf(prn, "# %-12s %-6s %7s %12s\n", "dataset", "path",
+		"LRE", "usec");
+    }
+}
+
+/* print the table lines for one dataset: a failure on a given
+   path (e.g. the GMP plugin is not available) shows up as NA */
+
+static void print_table_lines (const char *datname, DATASET *dset,
+			      mp_results *certvals, int npoly,
+			      const int *zdigits, PRN *prn)
+{
+    char dname[16], *p;
+    MODEL model;
+    double lre, t0, dt;
+    int path, reps, err;
+
+    /* strip the ".dat" */
+    *dname = '\0';
+    strncat(dname, datname, sizeof dname - 1);
+    if ((p = strrchr(dname, '.')) != NULL) {
+	*p = '\0';
+    }
+
+    for (path=0; path<EST_MAX; path++) {
+	err = estimate_via_path(path, dset, npoly, zdigits, &model);
+	lre = err ? NADBL : get_accuracy(&model, certvals, NULL);
+	clear_model(&model);
+	reps = 0;
+	dt = 0.0;
+	if (!err && !notimes) {
+	    t0 = g_get_monotonic_time() / 1.0e6;
+	    while (!err && dt < TIMING_MIN) {
+		err = estimate_via_path(path, dset, npoly, zdigits, &model);
+		clear_model(&model);
+		dt = g_get_monotonic_time() / 1.0e6 - t0;
+		reps++;
+	    }
+	}
+	pprintf(prn, "  %-12s %-6s ", dname, path_names[path]);
+	if (err) {
+	    pprintf(prn, "%7s", "NA");
+	} else {
+	    pprintf(prn, "%7.3f", lre);
+	}
+	if (!notimes) {
+	    if (err) {
+		pprintf(prn, " %12s", "NA");
+	    } else {
+		pprintf(prn, " %12.2f", 1.0e6 * dt / reps);
+	    }
+	}
+	pputc(prn, '\n');
+    }
+}
+
+#endif /* STANDALONE */
+
+#ifdef STANDALONE
+
 int main (int argc, char *argv[])
 {
     int j;
@@ -824,6 +994,7 @@ int main (int argc, char *argv[])
     int ntests, missing = 0, modelerrs = 0, poorvals = 0;
     int polyterms = 0, mpfails = 0;
     int *zdigits = NULL;
+    int table = 0;
     const char *prog;
 
 # ifdef LONGLEY_ONLY
@@ -850,26 +1021,45 @@ int main (int argc, char *argv[])
 
     prog = argv[0];
 
-    if (argc >= 2 && strcmp(argv[1], "-v") == 0) verbose = 1;
-    if (argc >= 2 && strcmp(argv[1], "-vv") == 0) verbose = 2;
-
     strcpy(datadir, ".");
-    if (argc == 2 && argv[1][0] != '-') {
-	strcpy(datadir, argv[1]);
-    } else if (argc == 3) {
-	strcpy(datadir, argv[2]);
+    for (j=1; j<argc; j++) {
+	if (strcmp(argv[j], "-v") == 0) {
+	    verbose = 1;
+	} else if (strcmp(argv[j], "-vv") == 0) {
+	    verbose = 2;
+	} else if (strcmp(argv[j], "-a") == 0) {
+	    table = 1;
+	} else if (strcmp(argv[j], "-n") == 0) {
+	    notimes = 1;
+	} else if (argv[j][0] != '-') {
+	    strcpy(datadir, argv[j]);
+	}
     }
 
     libgretl_init();
 
     prn = gretl_print_new(GRETL_PRINT_STDOUT, NULL); 
 
+    if (table) {
+	verbose = 0;
+	print_table_header(prn);
+    }
+
     for (j=0; j<ntests; j++) {
 	if (read_nist_file(nist_files[j], &dataset, &certvals,
-			   &polyterms, &zdigits, prn)) {
+			   &polyterms, &zdigits, table ? NULL : prn)) {
 	    pprintf(prn, "Error processing %s\n", nist_files[j]);
 	    missing++;
 
+	} else if (table) {
+	    print_table_lines(nist_files[j], dataset, certvals,
+			      polyterms, zdigits, prn);
+	    free_mp_results(certvals);
+	    certvals = NULL;
+	    destroy_dataset(dataset);
+	    dataset = NULL;
+	    free(zdigits);
+	    zdigits = NULL;
 	} else {
 	    run_gretl_comparison (nist_files[j], dataset, certvals,
 				  &modelerrs, &poorvals, prn);
@@ -886,8 +1076,10 @@ int main (int argc, char *argv[])
 	}
     }
 
-    print_nist_summary(ntests, missing, modelerrs, poorvals, mpfails,
-		       prog, prn);
+    if (!table) {
+	print_nist_summary(ntests, missing, modelerrs, poorvals, mpfails,
+			   prog, prn);
+    }
 
     gretl_print_destroy(prn);
 
@@ -0,0 +1,54 @@
+#!/bin/bash
+
+# Smoke test for "gretlcli --server": start a server, send it a
+# script over its socket and check the reply, then check that a
+# server will not start (nor remove anything) when the given path
+# is occupied by something other than a socket.
+#
+# Usage: ./run_server_smoke.sh [path-to-gretlcli]
+#
+# Requires socat; skipped if that is not available.
+
+GRETLCLI=${1:-gretlcli}
+
+if ! command -v socat > /dev/null 2>&1 ; then
+   echo "INFO: socat not found, skipping the server test"
+   exit 0
+fi
+
+WORK=$(mktemp -d)
+SOCK="$WORK/gretl.sock"
+trap 'rm -rf "$WORK"' EXIT
+
+echo 'scalar base = 40' > "$WORK/init.inp"
+echo 'printf "%d\n", base + 2' > "$WORK/job.inp"
+
+# 1. a request gets the result of the script sent
+$GRETLCLI --server="$SOCK" "$WORK/init.inp" > /dev/null 2>&1 &
+SERVER=$!
+for i in $(seq 50) ; do
+   [ -S "$SOCK" ] && break
+   sleep 0.1
+done
+REPLY=$(socat -t 30 - UNIX-CONNECT:"$SOCK" < "$WORK/job.inp")
+kill -TERM $SERVER
+wait $SERVER
+
+if ! echo "$REPLY" | grep -q '^42$' ; then
+   echo "ERROR: unexpected reply from server: $REPLY"
+   exit 1
+fi
+
+# 2. a regular file in place of the socket is left alone
+echo "keep me" > "$SOCK"
+if $GRETLCLI --server="$SOCK" "$WORK/init.inp" > /dev/null 2>&1 ; then
+   echo "ERROR: server started on a path holding a regular file"
+   exit 1
+fi
+if [ "$(cat "$SOCK")" != "keep me" ] ; then
+   echo "ERROR: server removed a regular file"
+   exit 1
+fi
+
+echo "INFO: server test passed"
+exit 0